@@ -8,10 +8,18 @@
 #include <getopt.h>
 #include <string.h>
 #include <inttypes.h>
+#include <unistd.h>
+#include <arpa/inet.h>
 
 #include "ofp.h"
 
-#define MAX_WORKERS		64
+#include "pktgen.h"
+
+#define MAX_WORKERS		PKTGEN_WORKERS_MAX
+
+/** Defaults of the generator mode */
+#define DEF_GEN_PREFIXES	10000
+#define DEF_GEN_FRAME_LEN	64
 
 /**
  * Parsed command line application arguments
@@ -22,9 +30,14 @@ typedef struct {
 	int if_count;		/**< Number of interfaces to be used */
 	char **if_names;	/**< Array of pointers to interface names */
 	char *cli_file;
+	int generate;		/**< Generator and sink mode */
+	struct pktgen_param gen;
+	int interval;		/**< Statistics print interval in seconds */
+	int duration;		/**< Generator run time in seconds, 0: no limit */
 } appl_args_t;
 
 struct worker_arg {
+	int id;
 	int num_pktin;
 	odp_pktin_queue_t pktin[OFP_FP_INTERFACE_MAX];
 	odp_bool_t process_timers;
@@ -54,14 +67,15 @@ ofp_global_param_t app_init_params; /**< global OFP init parms */
  */
 static int pkt_io_recv(void *_arg)
 {
-	odp_packet_t pkt, pkt_tbl[PKT_BURST_SIZE];
+	odp_packet_t pkt_tbl[PKT_BURST_SIZE];
 	odp_event_t events[PKT_BURST_SIZE], ev;
-	int pkt_idx, pkt_cnt, event_cnt;
+	int pkt_cnt, event_cnt;
 	struct worker_arg *arg;
-	int num_pktin, i;
+	int num_pktin, i, num;
 	odp_pktin_queue_t pktin[OFP_FP_INTERFACE_MAX];
 	uint8_t *ptr;
 	odp_bool_t process_timers;
+	uint64_t start;
 
 	arg = (struct worker_arg *)_arg;
 	process_timers = arg->process_timers;
@@ -80,9 +94,12 @@ static int pkt_io_recv(void *_arg)
 	       num_pktin, ptr[0], ptr[8]);
 
 	while (1) {
+		start = odp_cpu_cycles();
+		num = 0;
 		if (process_timers) {
 			event_cnt = odp_schedule_multi(NULL, ODP_SCHED_NO_WAIT,
 				events, PKT_BURST_SIZE);
+			num += event_cnt;
 			for (i = 0; i < event_cnt; i++) {
 				ev = events[i];
 
@@ -97,23 +114,100 @@ static int pkt_io_recv(void *_arg)
 			}
 		}
 		for (i = 0; i < num_pktin; i++) {
-			pkt_cnt = odp_pktin_recv(pktin[i], pkt_tbl,
-						 PKT_BURST_SIZE);
-
-			for (pkt_idx = 0; pkt_idx < pkt_cnt; pkt_idx++) {
-				pkt = pkt_tbl[pkt_idx];
-
-				ofp_packet_input(pkt, ODP_QUEUE_INVALID,
-						 ofp_eth_vlan_processing);
-			}
+			pkt_cnt = ofp_packet_input_burst(pktin[i], pkt_tbl,
+							 PKT_BURST_SIZE);
+			if (pkt_cnt > 0)
+				num += pkt_cnt;
 		}
 		ofp_send_pending_pkt();
+		/* Polls and processing interleave: a round with work is
+		 * all busy, an empty one all idle */
+		ofp_poll_idle(num, num ? odp_cpu_cycles() : start);
 	}
 
 	/* Never reached */
 	return 0;
 }
 
+/** pkt_gen() Generator and sink worker
+ *
+ * @param _arg void*  Worker argument
+ * @return int
+ *
+ */
+static int pkt_gen(void *_arg)
+{
+	struct worker_arg *arg = (struct worker_arg *)_arg;
+
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed.\n");
+		return -1;
+	}
+
+	printf("Generator %d starting on cpu: %i\n", arg->id, odp_cpu_id());
+
+	pktgen_run(arg->id, arg->pktin, arg->num_pktin, arg->process_timers);
+
+	if (ofp_term_local())
+		OFP_ERR("Error: ofp_term_local failed\n");
+
+	return 0;
+}
+
+/** print_gen_stats() Print generator rates every interval seconds,
+ *  until duration seconds have passed if duration is not 0
+ *
+ * @param num_workers int  Number of workers
+ * @param interval int  Print interval in seconds
+ * @param duration int  Run time in seconds
+ *
+ */
+static void print_gen_stats(int num_workers, int interval, int duration)
+{
+	static struct pktgen_stats prev[MAX_WORKERS];
+	struct pktgen_stats cur;
+	odp_time_t start, ts, ts_prev;
+	uint64_t pkts, cycles, sink;
+	double sec;
+	int i;
+
+	start = odp_time_local();
+	ts_prev = start;
+
+	while (!duration ||
+	       odp_time_to_ns(odp_time_diff(odp_time_local(), start)) <
+	       (uint64_t)duration * ODP_TIME_SEC_IN_NS) {
+		sleep(interval);
+
+		ts = odp_time_local();
+		sec = (double)odp_time_to_ns(odp_time_diff(ts, ts_prev)) /
+			ODP_TIME_SEC_IN_NS;
+		pkts = 0;
+		cycles = 0;
+		sink = 0;
+
+		for (i = 0; i < num_workers; i++) {
+			uint64_t n;
+
+			cur = pktgen_stats[i];
+			n = cur.pkts - prev[i].pkts;
+			printf("core %d: %.2f Mpps %.0f cycles/pkt, ", i,
+			       n / sec / 1000000, n ? (double)(cur.cycles -
+			       prev[i].cycles) / n : 0);
+			pkts += n;
+			cycles += cur.cycles - prev[i].cycles;
+			sink += cur.sink_pkts - prev[i].sink_pkts;
+			prev[i] = cur;
+		}
+		printf("total: %.2f Mpps %.0f cycles/pkt, sink %.2f Mpps\n",
+		       pkts / sec / 1000000,
+		       pkts ? (double)cycles / pkts : 0, sink / sec / 1000000);
+		fflush(NULL);
+
+		ts_prev = ts;
+	}
+}
+
 /** configure_interfaces() Create OFP interfaces with
  * pktios open in direct mode, thread unsafe.
  *
@@ -180,6 +274,7 @@ static int configure_workers_arg(int num_workers,
 	int i,j;
 
 	for (i = 0; i < num_workers; i++) {
+		workers_arg[i].id = i;
 		workers_arg[i].num_pktin = if_count;
 		workers_arg[i].process_timers = 0;
 	}
@@ -288,13 +383,25 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
+	if (params.generate) {
+		/* The generated routes use the addresses of the CLI file */
+		ofp_start_cli_thread(instance, app_init_params.linux_core_id,
+				     params.cli_file);
+		sleep(2);
+
+		if (pktgen_init(&params.gen)) {
+			OFP_ERR("Error: Failed to initialize generator.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
 	memset(thread_tbl, 0, sizeof(thread_tbl));
 
 	/* Create worker threads */
 	odp_cpumask_zero(&cpu_mask);
 	for (i = 0; i < num_workers; ++i) {
 		odph_thread_param_init(&thr_params[i]);
-		thr_params[i].start = pkt_io_recv;
+		thr_params[i].start = params.generate ? pkt_gen : pkt_io_recv;
 		thr_params[i].arg = &workers_arg[i];
 		thr_params[i].thr_type = ODP_THREAD_WORKER;
 		odp_cpumask_set(&cpu_mask, first_worker + i);
@@ -304,9 +411,14 @@ int main(int argc, char *argv[])
 	odph_thread_create(thread_tbl, &thr_common_param,
 				       thr_params, num_workers);
 
-	/* Start CLI */
-	ofp_start_cli_thread(instance, app_init_params.linux_core_id,
-			     params.cli_file);
+	if (params.generate) {
+		print_gen_stats(num_workers, params.interval, params.duration);
+		pktgen_stop();
+	} else {
+		/* Start CLI */
+		ofp_start_cli_thread(instance, app_init_params.linux_core_id,
+				     params.cli_file);
+	}
 
 	odph_thread_join(thread_tbl, num_workers);
 	printf("End Main()\n");
@@ -384,15 +496,30 @@ static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
 		{"help", no_argument, NULL, 'h'},		/* return 'h' */
 		{"cli-file", required_argument,
 			NULL, 'f'},/* return 'f' */
+		{"generate", required_argument, NULL, 'g'},
+		{"gw6", required_argument, NULL, 'G'},
+		{"fib", required_argument, NULL, 'F'},
+		{"prefixes", required_argument, NULL, 'N'},
+		{"dist", required_argument, NULL, 'D'},
+		{"length", required_argument, NULL, 'l'},
+		{"burst", required_argument, NULL, 'b'},
+		{"interval", required_argument, NULL, 'I'},
+		{"duration", required_argument, NULL, 'd'},
 		{NULL, 0, NULL, 0}
 	};
+	struct in_addr gw;
 
 	memset(appl_args, 0, sizeof(*appl_args));
 	appl_args->core_start = 1;
 	appl_args->core_count = 0; /* all above core start */
+	appl_args->gen.num_random = DEF_GEN_PREFIXES;
+	appl_args->gen.dist = PKTGEN_DIST_UNIFORM;
+	appl_args->gen.frame_len = DEF_GEN_FRAME_LEN;
+	appl_args->gen.burst = PKT_BURST_SIZE;
+	appl_args->interval = 1;
 
 	while (1) {
-		opt = getopt_long(argc, argv, "+c:s:i:hf:",
+		opt = getopt_long(argc, argv, "+c:s:i:hf:g:G:F:N:D:l:b:I:d:",
 				  longopts, &long_index);
 
 		if (opt == -1)
@@ -470,12 +597,59 @@ static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
 			strcpy(appl_args->cli_file, optarg);
 			break;
 
+		case 'g':
+			if (inet_pton(AF_INET, optarg, &gw) != 1) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			appl_args->gen.gw = gw.s_addr;
+			appl_args->generate = 1;
+			break;
+		case 'G':
+			if (inet_pton(AF_INET6, optarg,
+				      appl_args->gen.gw6) != 1) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'F':
+			appl_args->gen.fib_file = strdup(optarg);
+			break;
+		case 'N':
+			appl_args->gen.num_random = atoi(optarg);
+			break;
+		case 'D':
+			if (!strcmp(optarg, "uniform")) {
+				appl_args->gen.dist = PKTGEN_DIST_UNIFORM;
+			} else if (!strcmp(optarg, "size")) {
+				appl_args->gen.dist = PKTGEN_DIST_SIZE;
+			} else if (!strcmp(optarg, "zipf")) {
+				appl_args->gen.dist = PKTGEN_DIST_ZIPF;
+			} else {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'l':
+			appl_args->gen.frame_len = atoi(optarg);
+			break;
+		case 'b':
+			appl_args->gen.burst = atoi(optarg);
+			break;
+		case 'I':
+			appl_args->interval = atoi(optarg);
+			break;
+		case 'd':
+			appl_args->duration = atoi(optarg);
+			break;
+
 		default:
 			break;
 		}
 	}
 
-	if (appl_args->if_count == 0) {
+	if (appl_args->if_count == 0 || appl_args->interval < 1 ||
+	    appl_args->duration < 0) {
 		usage(argv[0]);
 		exit(EXIT_FAILURE);
 	}
@@ -533,6 +707,22 @@ static void usage(char *progname)
 		   "  -c, --core_count <number> Core count. Default 0: all above core start\n"
 		   "  -f, --cli-file <file> OFP CLI file.\n"
 		   "  -h, --help           Display help and exit.\n"
-		   "\n", NO_PATH(progname), NO_PATH(progname)
+		   "\n"
+		   "Generator OPTIONS\n"
+		   "  -g, --generate <addr> Generate traffic into the first interface,\n"
+		   "                       routed via next hop addr on that interface,\n"
+		   "                       and drop received packets.\n"
+		   "  -G, --gw6 <addr>     IPv6 next hop, needed for IPv6 prefixes.\n"
+		   "  -F, --fib <file>     Prefixes to route, one per line or in\n"
+		   "                       'bgpdump -m' format.\n"
+		   "  -N, --prefixes <number> Random /24 prefixes without -F. Default: %d.\n"
+		   "  -D, --dist <dist>    Destinations per prefix: uniform (default),\n"
+		   "                       size or zipf.\n"
+		   "  -l, --length <bytes> Frame length. Default: %d.\n"
+		   "  -b, --burst <number> Packets per input burst. Default: %d.\n"
+		   "  -I, --interval <sec> Statistics print interval. Default: 1.\n"
+		   "  -d, --duration <sec> Run time, 0 for no limit. Default: 0.\n"
+		   "\n", NO_PATH(progname), NO_PATH(progname),
+		   DEF_GEN_PREFIXES, DEF_GEN_FRAME_LEN, PKT_BURST_SIZE
 		);
 }
@@ -0,0 +1,574 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "ofp.h"
+
+#include "pktgen.h"
+
+/** Destinations cycled through by the workers, a power of two */
+#define DST_TABLE_SIZE (1 << 16)
+#define PREFIX_MAX (4 * 1024 * 1024)
+#define RANDOM_PREFIX_MAX (1 << 22)
+#define ROUTE_BATCH 1024
+#define BURST_MAX 256
+#define FRAME_MIN 64
+#define FRAME_MAX 1514
+
+/* 198.18.0.1 and 2001:db8::1, benchmarking and documentation ranges */
+#define SRC_ADDR 0xc6120001
+static const uint8_t src_addr6[16] = {
+	0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1
+};
+static const uint8_t src_mac[OFP_ETHER_ADDR_LEN] = {2, 0, 0, 0, 0, 2};
+#define UDP_SPORT 1024
+#define UDP_DPORT 9
+
+struct prefix {
+	uint8_t v6;
+	uint8_t masklen;
+	uint8_t addr[16];
+};
+
+struct dst {
+	uint8_t v6;
+	uint8_t addr[16];
+};
+
+struct pktgen_stats pktgen_stats[PKTGEN_WORKERS_MAX];
+
+static struct pktgen_param gen;
+static struct prefix *prefix;
+static int num_prefix;
+static struct dst *dst_table;
+static odp_queue_t in_queue;
+static odp_pool_t pool;
+static uint8_t frame4[FRAME_MAX], frame6[FRAME_MAX];
+/** One's complement sum of the IPv4 header, without destination */
+static uint32_t cksum4_base;
+static volatile int gen_exit;
+
+/** Deterministic so that runs can be compared */
+static uint64_t rnd_state = 0x9e3779b97f4a7c15ULL;
+
+static inline uint64_t rnd(void)
+{
+	rnd_state ^= rnd_state << 13;
+	rnd_state ^= rnd_state >> 7;
+	rnd_state ^= rnd_state << 17;
+	return rnd_state;
+}
+
+static int gw6_set(void)
+{
+#ifdef INET6
+	static const uint8_t zero[16];
+
+	return memcmp(gen.gw6, zero, sizeof(zero)) != 0;
+#else
+	return 0;
+#endif
+}
+
+static void prefix_normalize(struct prefix *p)
+{
+	int len = p->v6 ? 16 : 4;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (i * 8 >= p->masklen)
+			p->addr[i] = 0;
+		else if (i * 8 + 8 > p->masklen)
+			p->addr[i] &= 0xff << (8 - (p->masklen & 7));
+	}
+}
+
+static int prefix_parse(const char *tok, struct prefix *p)
+{
+	char buf[64];
+	char *slash;
+	int len;
+
+	if (strlen(tok) >= sizeof(buf))
+		return -1;
+	strcpy(buf, tok);
+	slash = strchr(buf, '/');
+	if (!slash)
+		return -1;
+	*slash = 0;
+	len = atoi(slash + 1);
+
+	memset(p, 0, sizeof(*p));
+	if (strchr(buf, ':')) {
+		/* IPv6 prefixes are only used with an IPv6 next hop */
+		if (!gw6_set())
+			return -1;
+		if (len < 0 || len > 128 ||
+		    inet_pton(AF_INET6, buf, p->addr) != 1)
+			return -1;
+		p->v6 = 1;
+	} else {
+		if (len < 0 || len > 32 || inet_pton(AF_INET, buf, p->addr) != 1)
+			return -1;
+	}
+	p->masklen = len;
+	prefix_normalize(p);
+
+	return 0;
+}
+
+static int prefix_cmp(const void *a, const void *b)
+{
+	const struct prefix *pa = a, *pb = b;
+
+	if (pa->v6 != pb->v6)
+		return pa->v6 - pb->v6;
+	if (pa->masklen != pb->masklen)
+		return pa->masklen - pb->masklen;
+	return memcmp(pa->addr, pb->addr, sizeof(pa->addr));
+}
+
+static int prefix_add(const struct prefix *p)
+{
+	static int size;
+
+	if (num_prefix == size) {
+		struct prefix *n;
+
+		if (size == PREFIX_MAX)
+			return -1;
+		size = size ? size * 2 : 1024;
+		n = realloc(prefix, size * sizeof(*prefix));
+		if (!n)
+			return -1;
+		prefix = n;
+	}
+	prefix[num_prefix++] = *p;
+	return 0;
+}
+
+/*
+ * One prefix per line, either as the first word or as the sixth field of
+ * a "bgpdump -m" line. Other lines are skipped.
+ */
+static int load_fib(const char *file)
+{
+	char line[512];
+	struct prefix p;
+	FILE *f;
+	char *tok, *save;
+	int i, n;
+
+	f = fopen(file, "r");
+	if (!f) {
+		OFP_ERR("Error: cannot open %s", file);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (strchr(line, '|')) {
+			tok = strtok_r(line, "|", &save);
+			for (i = 0; tok && i < 5; i++)
+				tok = strtok_r(NULL, "|", &save);
+		} else {
+			tok = strtok_r(line, " \t\r\n", &save);
+		}
+		if (!tok || tok[0] == '#' || prefix_parse(tok, &p))
+			continue;
+		if (prefix_add(&p)) {
+			OFP_ERR("Error: too many prefixes in %s", file);
+			fclose(f);
+			return -1;
+		}
+	}
+	fclose(f);
+
+	/* Dumps list a prefix once per peer */
+	qsort(prefix, num_prefix, sizeof(*prefix), prefix_cmp);
+	for (i = 0, n = 0; i < num_prefix; i++)
+		if (!n || prefix_cmp(&prefix[n - 1], &prefix[i]))
+			prefix[n++] = prefix[i];
+	num_prefix = n;
+
+	return 0;
+}
+
+/** Unicast /24 prefixes spread over the address space */
+static int random_fib(int num)
+{
+	struct prefix p;
+	uint32_t i, x, a, addr;
+
+	memset(&p, 0, sizeof(p));
+	p.masklen = 24;
+
+	for (i = 0; i < (1 << 24) && num_prefix < num; i++) {
+		/* An odd multiplier permutes the 24 bit values */
+		x = (i * 2654435761U) & 0xffffff;
+		a = x >> 16;
+		if (a == 0 || a == 127 || a >= 224)
+			continue;
+		addr = odp_cpu_to_be_32(x << 8);
+		memcpy(p.addr, &addr, 4);
+		if (prefix_add(&p))
+			return -1;
+	}
+	return 0;
+}
+
+static int install_routes(void)
+{
+	struct ofp_route_msg msg[ROUTE_BATCH];
+	int i, n = 0;
+
+	for (i = 0; i < num_prefix; i++) {
+		struct ofp_route_msg *m = &msg[n++];
+
+		memset(m, 0, sizeof(*m));
+		m->flags = OFP_RTF_GATEWAY;
+		m->port = gen.port;
+		m->masklen = prefix[i].masklen;
+		if (prefix[i].v6) {
+			m->type = OFP_ROUTE6_ADD;
+			memcpy(m->dst6, prefix[i].addr, 16);
+			memcpy(m->gw6, gen.gw6, 16);
+		} else {
+			m->type = OFP_ROUTE_ADD;
+			memcpy(&m->dst, prefix[i].addr, 4);
+			m->gw = gen.gw;
+		}
+		if (n == ROUTE_BATCH || i == num_prefix - 1) {
+			if (ofp_set_route_msgs(msg, n)) {
+				OFP_ERR("Error: route add failed");
+				return -1;
+			}
+			n = 0;
+		}
+	}
+	return 0;
+}
+
+/** Index of the first cumulative weight above r */
+static int pick(const double *cum, int num, double r)
+{
+	int lo = 0, hi = num - 1;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (cum[mid] > r)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/*
+ * Prefix weights. The size of a prefix is counted in host bits up to 24,
+ * for IPv6 within the /64, so that a few short prefixes do not take all
+ * the traffic.
+ */
+static double *weights(void)
+{
+	double *cum;
+	int *rank;
+	double sum = 0;
+	int i, j, t, bits;
+
+	cum = malloc(num_prefix * sizeof(*cum));
+	rank = malloc(num_prefix * sizeof(*rank));
+	if (!cum || !rank) {
+		free(cum);
+		free(rank);
+		return NULL;
+	}
+
+	/* Popularity does not follow the address order */
+	for (i = 0; i < num_prefix; i++)
+		rank[i] = i;
+	for (i = num_prefix - 1; i > 0; i--) {
+		j = rnd() % (i + 1);
+		t = rank[i];
+		rank[i] = rank[j];
+		rank[j] = t;
+	}
+
+	for (i = 0; i < num_prefix; i++) {
+		if (gen.dist == PKTGEN_DIST_ZIPF) {
+			sum += 1.0 / (rank[i] + 1);
+		} else {
+			bits = (prefix[i].v6 ? 64 : 32) - prefix[i].masklen;
+			if (bits < 0)
+				bits = 0;
+			if (bits > 24)
+				bits = 24;
+			sum += (double)(1 << bits);
+		}
+		cum[i] = sum;
+	}
+	free(rank);
+	return cum;
+}
+
+static int build_dst_table(void)
+{
+	double *cum = NULL;
+	int i, b, p;
+
+	dst_table = malloc(DST_TABLE_SIZE * sizeof(*dst_table));
+	if (!dst_table)
+		return -1;
+
+	if (gen.dist != PKTGEN_DIST_UNIFORM) {
+		cum = weights();
+		if (!cum)
+			return -1;
+	}
+
+	for (i = 0; i < DST_TABLE_SIZE; i++) {
+		struct dst *d = &dst_table[i];
+
+		if (cum)
+			p = pick(cum, num_prefix, (double)(rnd() >> 11) /
+				 (1ULL << 53) * cum[num_prefix - 1]);
+		else
+			p = rnd() % num_prefix;
+
+		d->v6 = prefix[p].v6;
+		memcpy(d->addr, prefix[p].addr, sizeof(d->addr));
+		/* Random host part */
+		for (b = prefix[p].masklen / 8; b < (d->v6 ? 16 : 4); b++) {
+			uint8_t mask = 0xff;
+
+			if (b == prefix[p].masklen / 8)
+				mask >>= prefix[p].masklen & 7;
+			d->addr[b] = (d->addr[b] & ~mask) | (rnd() & mask);
+		}
+	}
+
+	free(cum);
+	return 0;
+}
+
+static void build_frames(void)
+{
+	odp_pktio_t pktio = ofp_port_pktio_get(gen.port);
+	struct ofp_ether_header *eth;
+	struct ofp_ip *ip;
+	struct ofp_ip6_hdr *ip6;
+	struct ofp_udphdr *udp;
+	uint16_t w[sizeof(struct ofp_ip) / 2];
+	int i;
+
+	memset(frame4, 0, sizeof(frame4));
+	eth = (struct ofp_ether_header *)frame4;
+	odp_pktio_mac_addr(pktio, eth->ether_dhost, OFP_ETHER_ADDR_LEN);
+	memcpy(eth->ether_shost, src_mac, OFP_ETHER_ADDR_LEN);
+	memcpy(frame6, frame4, sizeof(*eth));
+
+	eth->ether_type = odp_cpu_to_be_16(OFP_ETHERTYPE_IP);
+	ip = (struct ofp_ip *)(eth + 1);
+	ip->ip_v = 4;
+	ip->ip_hl = sizeof(*ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(gen.frame_len - sizeof(*eth));
+	ip->ip_ttl = 64;
+	ip->ip_p = OFP_IPPROTO_UDP;
+	ip->ip_src.s_addr = odp_cpu_to_be_32(SRC_ADDR);
+	udp = (struct ofp_udphdr *)(ip + 1);
+	udp->uh_sport = odp_cpu_to_be_16(UDP_SPORT);
+	udp->uh_dport = odp_cpu_to_be_16(UDP_DPORT);
+	udp->uh_ulen = odp_cpu_to_be_16(gen.frame_len - sizeof(*eth) -
+					sizeof(*ip));
+
+	/* The destination and the checksum are zero */
+	memcpy(w, ip, sizeof(w));
+	for (i = 0; i < (int)(sizeof(w) / 2); i++)
+		cksum4_base += w[i];
+
+	eth = (struct ofp_ether_header *)frame6;
+	eth->ether_type = odp_cpu_to_be_16(OFP_ETHERTYPE_IPV6);
+	ip6 = (struct ofp_ip6_hdr *)(eth + 1);
+	ip6->ofp_ip6_vfc = 0x60;
+	ip6->ofp_ip6_plen = odp_cpu_to_be_16(gen.frame_len - sizeof(*eth) -
+					     sizeof(*ip6));
+	ip6->ofp_ip6_nxt = OFP_IPPROTO_UDP;
+	ip6->ofp_ip6_hlim = 64;
+	memcpy(&ip6->ip6_src, src_addr6, 16);
+	/* The UDP checksum is left out, forwarding does not check it */
+	udp = (struct ofp_udphdr *)(ip6 + 1);
+	udp->uh_sport = odp_cpu_to_be_16(UDP_SPORT);
+	udp->uh_dport = odp_cpu_to_be_16(UDP_DPORT);
+	udp->uh_ulen = ip6->ofp_ip6_plen;
+}
+
+int pktgen_init(const struct pktgen_param *param)
+{
+	struct ofp_ifnet *ifnet;
+	uint8_t gw_mac[OFP_ETHER_ADDR_LEN] = {2, 0, 0, 0, 0, 1};
+	int v6 = 0, i;
+
+	gen = *param;
+	if (gen.frame_len < FRAME_MIN || gen.frame_len > FRAME_MAX ||
+	    gen.burst < 1 || gen.burst > BURST_MAX) {
+		OFP_ERR("Error: invalid generator parameters");
+		return -1;
+	}
+
+	ifnet = ofp_get_ifnet(gen.port, 0);
+	pool = odp_pool_lookup(SHM_PKT_POOL_NAME);
+	if (!ifnet || pool == ODP_POOL_INVALID) {
+		OFP_ERR("Error: generator interface or pool not found");
+		return -1;
+	}
+
+	if (gen.fib_file) {
+		if (load_fib(gen.fib_file))
+			return -1;
+	} else if (gen.num_random < 1 || gen.num_random > RANDOM_PREFIX_MAX ||
+		   random_fib(gen.num_random)) {
+		OFP_ERR("Error: cannot generate %d prefixes", gen.num_random);
+		return -1;
+	}
+	if (num_prefix == 0) {
+		OFP_ERR("Error: no prefixes");
+		return -1;
+	}
+
+	for (i = 0; i < num_prefix; i++)
+		v6 += prefix[i].v6;
+	printf("Generator FIB: %d IPv4 and %d IPv6 prefixes\n",
+	       num_prefix - v6, v6);
+
+	if (install_routes())
+		return -1;
+
+	/* Static next hops, ARP and ND would only add noise */
+	ofp_add_mac(ifnet, gen.gw, gw_mac);
+#ifdef INET6
+	if (v6)
+		ofp_add_mac6(ifnet, gen.gw6, gw_mac);
+#endif
+
+	if (build_dst_table())
+		return -1;
+	build_frames();
+
+	/* Tells OFP the input interface of the generated packets */
+	in_queue = odp_queue_create("pktgen", NULL);
+	if (in_queue == ODP_QUEUE_INVALID ||
+	    odp_queue_context_set(in_queue, ifnet, sizeof(ifnet))) {
+		OFP_ERR("Error: generator input queue");
+		return -1;
+	}
+
+	gen_exit = 0;
+	return 0;
+}
+
+static int gen_burst(odp_packet_t pkt[], uint32_t *pos)
+{
+	int eth_len = sizeof(struct ofp_ether_header);
+	int i, n;
+
+	n = odp_packet_alloc_multi(pool, gen.frame_len, pkt, gen.burst);
+
+	for (i = 0; i < n; i++) {
+		const struct dst *d = &dst_table[(*pos)++ &
+						 (DST_TABLE_SIZE - 1)];
+		uint8_t *data = odp_packet_data(pkt[i]);
+
+		odp_packet_has_eth_set(pkt[i], 1);
+		odp_packet_l2_offset_set(pkt[i], 0);
+		odp_packet_l3_offset_set(pkt[i], eth_len);
+
+		if (!d->v6) {
+			struct ofp_ip *ip;
+			uint16_t w[2];
+			uint32_t sum;
+
+			memcpy(w, d->addr, sizeof(w));
+			sum = cksum4_base + w[0] + w[1];
+			memcpy(data, frame4, gen.frame_len);
+			ip = (struct ofp_ip *)(data + eth_len);
+			memcpy(&ip->ip_dst, d->addr, 4);
+			sum = (sum & 0xffff) + (sum >> 16);
+			sum = (sum & 0xffff) + (sum >> 16);
+			ip->ip_sum = ~sum;
+			odp_packet_has_ipv4_set(pkt[i], 1);
+			odp_packet_l4_offset_set(pkt[i], eth_len + sizeof(*ip));
+		} else {
+			struct ofp_ip6_hdr *ip6;
+
+			memcpy(data, frame6, gen.frame_len);
+			ip6 = (struct ofp_ip6_hdr *)(data + eth_len);
+			memcpy(&ip6->ip6_dst, d->addr, 16);
+			odp_packet_has_ipv6_set(pkt[i], 1);
+			odp_packet_l4_offset_set(pkt[i],
+						 eth_len + sizeof(*ip6));
+		}
+	}
+	return n > 0 ? n : 0;
+}
+
+void pktgen_run(int id, odp_pktin_queue_t pktin[], int num_pktin,
+		odp_bool_t process_timers)
+{
+	struct pktgen_stats *st = &pktgen_stats[id];
+	odp_packet_t pkt[BURST_MAX];
+	odp_event_t ev[BURST_MAX];
+	uint64_t c1, c2;
+	uint32_t pos;
+	int i, n;
+
+	/* Workers start at different points of the destination table */
+	pos = id * (DST_TABLE_SIZE / PKTGEN_WORKERS_MAX);
+
+	while (!gen_exit) {
+		if (process_timers) {
+			n = odp_schedule_multi(NULL, ODP_SCHED_NO_WAIT, ev,
+					       BURST_MAX);
+			for (i = 0; i < n; i++) {
+				if (odp_event_type(ev[i]) == ODP_EVENT_TIMEOUT)
+					ofp_timer_handle(ev[i]);
+				else
+					odp_buffer_free(
+						odp_buffer_from_event(ev[i]));
+			}
+		}
+
+		/* Sink */
+		for (i = 0; i < num_pktin; i++) {
+			n = odp_pktin_recv(pktin[i], pkt, BURST_MAX);
+			if (n > 0) {
+				odp_packet_free_multi(pkt, n);
+				st->sink_pkts += n;
+			}
+		}
+
+		n = gen_burst(pkt, &pos);
+		if (odp_unlikely(n == 0))
+			continue;
+
+		c1 = odp_cpu_cycles();
+		ofp_packet_input_multi(pkt, n, in_queue,
+				       ofp_eth_vlan_processing);
+		ofp_send_pending_pkt();
+		c2 = odp_cpu_cycles();
+
+		st->cycles += odp_cpu_cycles_diff(c2, c1);
+		st->pkts += n;
+	}
+}
+
+void pktgen_stop(void)
+{
+	gen_exit = 1;
+}
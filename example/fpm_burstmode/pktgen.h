@@ -0,0 +1,64 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef _PKTGEN_H_
+#define _PKTGEN_H_
+
+#include <odp_api.h>
+
+#define PKTGEN_WORKERS_MAX 64
+
+/**
+ * How destinations are spread over the prefixes of the FIB
+ */
+enum pktgen_dist {
+	PKTGEN_DIST_UNIFORM = 0,	/**< Every prefix equally often */
+	PKTGEN_DIST_SIZE,		/**< In proportion to prefix size */
+	PKTGEN_DIST_ZIPF		/**< Few popular prefixes, Zipf s=1 */
+};
+
+/**
+ * Generator parameters
+ */
+struct pktgen_param {
+	int port;		/**< Input and output interface */
+	const char *fib_file;	/**< Prefixes to install, NULL: random */
+	int num_random;		/**< Number of random /24 prefixes */
+	enum pktgen_dist dist;
+	uint32_t gw;		/**< IPv4 next hop, network order */
+	uint8_t gw6[16];	/**< IPv6 next hop, all zero: no IPv6 */
+	int frame_len;		/**< Frame length without FCS */
+	int burst;		/**< Packets per ofp_packet_input_multi() */
+};
+
+/**
+ * Counters of one worker
+ */
+struct pktgen_stats {
+	uint64_t pkts;		/**< Packets input to OFP */
+	uint64_t cycles;	/**< CPU cycles spent in OFP input and output */
+	uint64_t sink_pkts;	/**< Packets received and dropped */
+} ODP_ALIGNED_CACHE;
+
+extern struct pktgen_stats pktgen_stats[PKTGEN_WORKERS_MAX];
+
+/**
+ * Load the FIB, install its routes via the next hops and build the
+ * destination table. Called once after ofp_init_global() and the
+ * interface configuration.
+ */
+int pktgen_init(const struct pktgen_param *param);
+
+/**
+ * Input generated bursts and drop the packets received from pktin, until
+ * pktgen_stop() is called.
+ */
+void pktgen_run(int id, odp_pktin_queue_t pktin[], int num_pktin,
+		odp_bool_t process_timers);
+
+void pktgen_stop(void);
+
+#endif
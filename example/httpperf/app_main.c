@@ -0,0 +1,538 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#include <getopt.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "ofp.h"
+
+#include "http_client.h"
+#include "httpd.h"
+
+#define MAX_WORKERS		32
+
+/** Default concurrent connections per loader */
+#define DEF_CONNECTIONS		64
+
+/** Default requested path */
+#define DEF_URL			"/index.html"
+
+/**
+ * Parsed command line application arguments
+ */
+typedef struct {
+	int core_count;
+	int if_count;		/**< Number of interfaces to be used */
+	char **if_names;	/**< Array of pointers to interface names */
+	char *cli_file;
+	char *daddr;		/**< Server address */
+	uint16_t dport;		/**< Server port */
+	const char *url;	/**< Requested path */
+	int keep_alive;		/**< Reuse connections */
+	int connections;	/**< Connections per loader */
+	int loaders;		/**< Number of loader threads */
+	int interval;		/**< Statistics print interval in seconds */
+	int duration;		/**< Run time in seconds, 0: no limit */
+	char *root_dir;		/**< Also serve this directory, see -S */
+} appl_args_t;
+
+/* helper funcs */
+static void parse_args(int argc, char *argv[], appl_args_t *appl_args);
+static void print_info(char *progname, appl_args_t *appl_args);
+static void usage(char *progname);
+
+ofp_global_param_t app_init_params; /**< global OFP init parms */
+
+/** Get rid of path in filename - only for unix-type paths using '/' */
+#define NO_PATH(file_name) (strrchr((file_name), '/') ? \
+				strrchr((file_name), '/') + 1 : (file_name))
+
+static uint64_t hist_value(int idx)
+{
+	int e;
+
+	if (idx < HTTP_HIST_SUB)
+		return idx;
+	e = (idx >> HTTP_HIST_SUB_BITS) + HTTP_HIST_SUB_BITS - 1;
+	return (uint64_t)(HTTP_HIST_SUB + (idx & (HTTP_HIST_SUB - 1))) <<
+		(e - HTTP_HIST_SUB_BITS);
+}
+
+static uint64_t hist_percentile(const uint64_t *hist, uint64_t total,
+				double pct)
+{
+	uint64_t target, sum = 0;
+	int i;
+
+	target = (uint64_t)(total * pct / 100);
+	if (target >= total)
+		target = total - 1;
+
+	for (i = 0; i < HTTP_HIST_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum > target)
+			return hist_value(i);
+	}
+	return hist_value(HTTP_HIST_BUCKETS - 1);
+}
+
+static void sum_stats(struct http_stats *sum, int num)
+{
+	int i, j;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for (i = 0; i < num; i++) {
+		struct http_stats *st = &http_stats[i];
+
+		sum->connects += st->connects;
+		sum->conn_errors += st->conn_errors;
+		sum->requests += st->requests;
+		sum->responses += st->responses;
+		sum->bad_responses += st->bad_responses;
+		sum->rx_bytes += st->rx_bytes;
+		sum->tx_bytes += st->tx_bytes;
+		for (j = 0; j < HTTP_HIST_BUCKETS; j++)
+			sum->latency[j] += st->latency[j];
+	}
+}
+
+static void print_latency(const uint64_t *hist)
+{
+	uint64_t total = 0;
+	int i;
+
+	for (i = 0; i < HTTP_HIST_BUCKETS; i++)
+		total += hist[i];
+	if (total == 0)
+		return;
+
+	printf(", latency p50 %.1f us p99 %.1f us p999 %.1f us",
+	       (double)hist_percentile(hist, total, 50) / 1000,
+	       (double)hist_percentile(hist, total, 99) / 1000,
+	       (double)hist_percentile(hist, total, 99.9) / 1000);
+}
+
+/**
+ * Print connection and request rates every interval seconds, until
+ * duration seconds have passed if duration is not 0
+ */
+static void print_stats(int loaders, int interval, int duration)
+{
+	static struct http_stats cur, prev, diff;
+	odp_time_t start, ts, ts_prev;
+	double sec;
+	int i;
+
+	start = odp_time_local();
+	ts_prev = start;
+
+	while (!duration ||
+	       odp_time_to_ns(odp_time_diff(odp_time_local(), start)) <
+	       (uint64_t)duration * ODP_TIME_SEC_IN_NS) {
+		sleep(interval);
+
+		ts = odp_time_local();
+		sum_stats(&cur, loaders);
+		sec = (double)odp_time_to_ns(odp_time_diff(ts, ts_prev)) /
+			ODP_TIME_SEC_IN_NS;
+
+		for (i = 0; i < HTTP_HIST_BUCKETS; i++)
+			diff.latency[i] = cur.latency[i] - prev.latency[i];
+
+		printf("%.0f CPS, %.0f RPS, RX %.1f Mbps, "
+		       "errors %" PRIu64 ", bad responses %" PRIu64,
+		       (cur.connects - prev.connects) / sec,
+		       (cur.responses - prev.responses) / sec,
+		       (cur.rx_bytes - prev.rx_bytes) * 8 / sec / 1000000,
+		       cur.conn_errors - prev.conn_errors,
+		       cur.bad_responses - prev.bad_responses);
+		print_latency(diff.latency);
+		printf("\n");
+		fflush(NULL);
+
+		prev = cur;
+		ts_prev = ts;
+	}
+
+	sec = (double)odp_time_to_ns(odp_time_diff(ts_prev, start)) /
+		ODP_TIME_SEC_IN_NS;
+	printf("\nTotal %" PRIu64 " connections (%.0f CPS), %" PRIu64
+	       " responses (%.0f RPS), errors %" PRIu64
+	       ", bad responses %" PRIu64,
+	       cur.connects, cur.connects / sec, cur.responses,
+	       cur.responses / sec, cur.conn_errors, cur.bad_responses);
+	print_latency(cur.latency);
+	printf("\n");
+}
+
+/** main() Application entry point
+ *
+ * @param argc int
+ * @param argv[] char*
+ * @return int
+ *
+ */
+int main(int argc, char *argv[])
+{
+	odph_thread_t thread_tbl[MAX_WORKERS], loader_tbl[HTTP_LOADER_MAX];
+	appl_args_t params;
+	int core_count, num_workers, num_loaders, num_cpus, shared, cpu, i;
+	odp_cpumask_t cpumask, all_cpumask, loader_cpumask;
+	char cpumaskstr[64];
+	odph_thread_param_t thr_params[MAX_WORKERS];
+	odph_thread_common_param_t thr_common_param;
+	odp_instance_t instance;
+	struct http_client_param client;
+	struct in_addr daddr;
+
+	/* Parse and store the application arguments */
+	parse_args(argc, argv, &params);
+
+	if (inet_aton(params.daddr, &daddr) == 0) {
+		printf("Error: invalid server address: %s\n", params.daddr);
+		exit(EXIT_FAILURE);
+	}
+
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Print both system and application information */
+	print_info(NO_PATH(argv[0]), &params);
+
+	/*
+	 * By default core #0 runs Linux kernel background tasks.
+	 * Dispatchers and loaders share the remaining cores.
+	 */
+	core_count = odp_cpu_count();
+	num_loaders = params.loaders;
+	num_workers = params.core_count ? params.core_count :
+		core_count - 1 - num_loaders;
+	if (num_workers < 1)
+		num_workers = 1;
+	if (num_workers > MAX_WORKERS)
+		num_workers = MAX_WORKERS;
+
+	/*
+	 * Dispatchers run on the first worker CPUs and loaders on the rest.
+	 * If there are not enough CPUs, both share all of them.
+	 */
+	num_cpus = odp_cpumask_default_worker(&all_cpumask,
+					      num_workers + num_loaders);
+	shared = num_cpus <= num_loaders;
+	odp_cpumask_zero(&cpumask);
+	odp_cpumask_zero(&loader_cpumask);
+	for (cpu = odp_cpumask_first(&all_cpumask), i = 0; cpu >= 0;
+	     cpu = odp_cpumask_next(&all_cpumask, cpu), i++) {
+		if (shared || i < num_cpus - num_loaders)
+			odp_cpumask_set(&cpumask, cpu);
+		if (shared || i >= num_cpus - num_loaders)
+			odp_cpumask_set(&loader_cpumask, cpu);
+	}
+	num_workers = odp_cpumask_count(&cpumask);
+
+	odp_cpumask_to_str(&cpumask, cpumaskstr, sizeof(cpumaskstr));
+	printf("Num worker threads: %i\n", num_workers);
+	printf("cpu mask:           %s\n", cpumaskstr);
+	odp_cpumask_to_str(&loader_cpumask, cpumaskstr, sizeof(cpumaskstr));
+	printf("Num loader threads: %i\n", num_loaders);
+	printf("loader cpu mask:    %s\n", cpumaskstr);
+
+	ofp_init_global_param(&app_init_params);
+	app_init_params.if_count = params.if_count;
+	app_init_params.if_names = params.if_names;
+	if (ofp_init_global(instance, &app_init_params)) {
+		OFP_ERR("Error: OFP global init failed.\n");
+		exit(EXIT_FAILURE);
+	}
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(thread_tbl, 0, sizeof(thread_tbl));
+	/* Start dataplane dispatcher worker threads */
+	for (i = 0; i < num_workers; i++) {
+		odph_thread_param_init(&thr_params[i]);
+		thr_params[i].start = default_event_dispatcher;
+		thr_params[i].arg = ofp_eth_vlan_processing;
+		thr_params[i].thr_type = ODP_THREAD_WORKER;
+	}
+	odph_thread_common_param_init(&thr_common_param);
+	thr_common_param.cpumask = &cpumask;
+
+	odph_thread_create(thread_tbl,
+			       &thr_common_param,
+			       thr_params,
+			       num_workers);
+
+	/* Start CLI */
+	ofp_start_cli_thread(instance, app_init_params.linux_core_id,
+			     params.cli_file);
+
+	/* Wait for the interface configuration of the CLI file */
+	sleep(2);
+
+	/* Server in the same instance, e.g. over a loop interface */
+	if (params.root_dir &&
+	    setup_webserver(params.root_dir, NULL, params.dport)) {
+		OFP_ERR("Error: Failed to setup webserver.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	client.daddr = daddr.s_addr;
+	client.dport = params.dport;
+	client.url = params.url;
+	client.keep_alive = params.keep_alive;
+	client.connections = params.connections;
+	client.loaders = num_loaders;
+	if (http_client_start(instance, &loader_cpumask, &client, loader_tbl))
+		exit(EXIT_FAILURE);
+
+	print_stats(num_loaders, params.interval, params.duration);
+
+	http_client_stop(loader_tbl, num_loaders);
+	ofp_stop_processing();
+
+	odph_thread_join(thread_tbl, num_workers);
+
+	if (ofp_term_local())
+		OFP_ERR("Error: ofp_term_local failed\n");
+	if (ofp_term_global())
+		OFP_ERR("Error: ofp_term_global failed\n");
+
+	printf("End Main()\n");
+
+	return 0;
+}
+
+/**
+ * Parse and store the command line arguments
+ *
+ * @param argc       argument count
+ * @param argv[]     argument vector
+ * @param appl_args  Store application arguments here
+ */
+static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
+{
+	int opt;
+	int long_index;
+	char *names, *str, *token, *save;
+	size_t len;
+	int i;
+	static struct option longopts[] = {
+		{"count", required_argument, NULL, 'c'},
+		{"interface", required_argument, NULL, 'i'},
+		{"help", no_argument, NULL, 'h'},
+		{"cli-file", required_argument, NULL, 'f'},
+		{"server", required_argument, NULL, 'C'},
+		{"port", required_argument, NULL, 'P'},
+		{"url", required_argument, NULL, 'u'},
+		{"keep-alive", no_argument, NULL, 'k'},
+		{"connections", required_argument, NULL, 'n'},
+		{"loaders", required_argument, NULL, 'w'},
+		{"interval", required_argument, NULL, 'I'},
+		{"duration", required_argument, NULL, 'd'},
+		{"serve", required_argument, NULL, 'S'},
+		{NULL, 0, NULL, 0}
+	};
+
+	memset(appl_args, 0, sizeof(*appl_args));
+	appl_args->dport = DEFAULT_BIND_PORT;
+	appl_args->url = DEF_URL;
+	appl_args->connections = DEF_CONNECTIONS;
+	appl_args->loaders = 1;
+	appl_args->interval = 1;
+
+	while (1) {
+		opt = getopt_long(argc, argv, "+c:i:hf:C:P:u:kn:w:I:d:S:",
+				  longopts, &long_index);
+
+		if (opt == -1)
+			break;	/* No more options */
+
+		switch (opt) {
+		case 'c':
+			appl_args->core_count = atoi(optarg);
+			break;
+			/* parse packet-io interface names */
+		case 'i':
+			len = strlen(optarg);
+			if (len == 0) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			len += 1;	/* add room for '\0' */
+
+			names = malloc(len);
+			if (names == NULL) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+
+			/* count the number of tokens separated by ',' */
+			strcpy(names, optarg);
+			for (str = names, i = 0;; str = NULL, i++) {
+				token = strtok_r(str, ",", &save);
+				if (token == NULL)
+					break;
+			}
+			appl_args->if_count = i;
+
+			if (appl_args->if_count == 0) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+
+			/* allocate storage for the if names */
+			appl_args->if_names =
+				calloc(appl_args->if_count, sizeof(char *));
+
+			/* store the if names (reset names string) */
+			strcpy(names, optarg);
+			for (str = names, i = 0;; str = NULL, i++) {
+				token = strtok_r(str, ",", &save);
+				if (token == NULL)
+					break;
+				appl_args->if_names[i] = token;
+			}
+			break;
+
+		case 'h':
+			usage(argv[0]);
+			exit(EXIT_SUCCESS);
+			break;
+
+		case 'f':
+			appl_args->cli_file = strdup(optarg);
+			break;
+		case 'C':
+			appl_args->daddr = strdup(optarg);
+			break;
+		case 'P':
+			appl_args->dport = atoi(optarg);
+			break;
+		case 'u':
+			appl_args->url = strdup(optarg);
+			break;
+		case 'k':
+			appl_args->keep_alive = 1;
+			break;
+		case 'n':
+			appl_args->connections = atoi(optarg);
+			break;
+		case 'w':
+			appl_args->loaders = atoi(optarg);
+			break;
+		case 'I':
+			appl_args->interval = atoi(optarg);
+			break;
+		case 'd':
+			appl_args->duration = atoi(optarg);
+			break;
+		case 'S':
+			appl_args->root_dir = strdup(optarg);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if (appl_args->if_count == 0 || appl_args->daddr == NULL ||
+	    appl_args->url == NULL || appl_args->interval < 1 ||
+	    appl_args->duration < 0 || appl_args->loaders < 1 ||
+	    appl_args->loaders > MAX_WORKERS / 2 ||
+	    appl_args->connections < 1 ||
+	    appl_args->connections > HTTP_CONN_MAX) {
+		usage(argv[0]);
+		exit(EXIT_FAILURE);
+	}
+
+	optind = 1;		/* reset 'extern optind' from the getopt lib */
+}
+
+/**
+ * Print system and application info
+ */
+static void print_info(char *progname, appl_args_t *appl_args)
+{
+	int i;
+
+	printf("\n"
+		   "ODP system info\n"
+		   "---------------\n"
+		   "ODP API version: %s\n"
+		   "CPU model:       %s\n"
+		   "CPU freq (hz):   %"PRIu64"\n"
+		   "Cache line size: %i\n"
+		   "Core count:      %i\n"
+		   "\n",
+		   odp_version_api_str(), odp_cpu_model_str(),
+		   odp_cpu_hz(), odp_sys_cache_line_size(),
+		   odp_cpu_count());
+
+	printf("Running ODP appl: \"%s\"\n"
+		   "-----------------\n"
+		   "IF-count:        %i\n"
+		   "Using IFs:      ",
+		   progname, appl_args->if_count);
+	for (i = 0; i < appl_args->if_count; ++i)
+		printf(" %s", appl_args->if_names[i]);
+	printf("\n"
+	       "Server:          %s:%u%s\n"
+	       "Mode:            %s, %d loaders x %d connections\n\n",
+	       appl_args->daddr, appl_args->dport, appl_args->url,
+	       appl_args->keep_alive ? "keep-alive" : "connection per request",
+	       appl_args->loaders, appl_args->connections);
+	fflush(NULL);
+}
+
+/**
+ * Prinf usage information
+ */
+static void usage(char *progname)
+{
+	printf("\n"
+		   "Usage: %s OPTIONS\n"
+		   "  E.g. %s -i eth1 -f ofp.cli -C 192.168.100.1 -k -n 256 -w 2\n"
+		   "\n"
+		   "HTTP load generator for webserver2.\n"
+		   "\n"
+		   "Mandatory OPTIONS:\n"
+		   "  -i, --interface Eth interfaces (comma-separated, no spaces)\n"
+		   "  -C, --server <addr>  Server address.\n"
+		   "\n"
+		   "Optional OPTIONS\n"
+		   "  -c, --count <number> Dispatcher core count.\n"
+		   "  -f, --cli-file <file> OFP CLI file.\n"
+		   "  -P, --port <port>    Server port. Default: %d.\n"
+		   "  -u, --url <path>     Requested path. Default: %s.\n"
+		   "  -k, --keep-alive     Send all requests of a connection on the\n"
+		   "                       same connection. Default: one request per\n"
+		   "                       connection.\n"
+		   "  -n, --connections <number> Concurrent connections per loader.\n"
+		   "                       Default: %d.\n"
+		   "  -w, --loaders <number> Loader threads. Default: 1.\n"
+		   "  -I, --interval <sec> Statistics print interval. Default: 1.\n"
+		   "  -d, --duration <sec> Run time, 0 for no limit. Default: 0.\n"
+		   "  -S, --serve <dir>    Also run the webserver2 server on <dir>\n"
+		   "                       in this instance, e.g. over a loop interface.\n"
+		   "  -h, --help           Display help and exit.\n"
+		   "\n", NO_PATH(progname), NO_PATH(progname), DEFAULT_BIND_PORT,
+		   DEF_URL, DEF_CONNECTIONS
+		);
+}
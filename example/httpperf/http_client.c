@@ -0,0 +1,351 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <arpa/inet.h>
+
+#include "ofp.h"
+
+#include "http_client.h"
+
+#define REQ_LEN_MAX 512
+#define HDR_LEN_MAX 1024
+#define BODY_BUF_LEN (16 * 1024)
+
+/**
+ * Connection states
+ */
+enum conn_state {
+	CONN_CLOSED = 0,
+	CONN_CONNECTING,	/**< Waiting for the first send to succeed */
+	CONN_SEND,		/**< Sending the request */
+	CONN_RECV_HDR,		/**< Receiving the response header */
+	CONN_RECV_BODY		/**< Receiving the response body */
+};
+
+struct conn {
+	int fd;
+	enum conn_state state;
+	int sent;		/**< Request bytes sent */
+	int hdr_len;		/**< Header bytes received */
+	int status;		/**< Response status code */
+	int64_t body_left;	/**< Body bytes left, -1: until close */
+	odp_time_t start;	/**< Start of the request */
+	char hdr[HDR_LEN_MAX];
+};
+
+struct loader_arg {
+	int id;
+};
+
+struct http_stats http_stats[HTTP_LOADER_MAX];
+
+static struct http_client_param client;
+static struct loader_arg loader_arg[HTTP_LOADER_MAX];
+static char request[REQ_LEN_MAX];
+static int request_len;
+static volatile int loaders_exit;
+
+static void conn_close(struct conn *c)
+{
+	if (c->fd >= 0)
+		ofp_close(c->fd);
+	c->fd = -1;
+	c->state = CONN_CLOSED;
+}
+
+/**
+ * Start a non-blocking connect to the server
+ */
+static int conn_open(struct conn *c)
+{
+	struct ofp_sockaddr_in addr;
+	int on = 1;
+
+	c->fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	if (c->fd < 0)
+		return -1;
+
+	if (ofp_ioctl(c->fd, OFP_FIONBIO, &on) ||
+	    ofp_setsockopt(c->fd, OFP_IPPROTO_TCP, OFP_TCP_NODELAY,
+			   &on, sizeof(on))) {
+		conn_close(c);
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_len = sizeof(addr);
+	addr.sin_family = OFP_AF_INET;
+	addr.sin_port = odp_cpu_to_be_16(client.dport);
+	addr.sin_addr.s_addr = client.daddr;
+
+	if (ofp_connect(c->fd, (struct ofp_sockaddr *)&addr,
+			sizeof(addr)) < 0 && ofp_errno != OFP_EINPROGRESS) {
+		conn_close(c);
+		return -1;
+	}
+
+	c->state = CONN_CONNECTING;
+	c->sent = 0;
+	/* Without keep-alive the latency includes the connection setup */
+	c->start = odp_time_local();
+
+	return 0;
+}
+
+static inline int would_block(void)
+{
+	return ofp_errno == OFP_EAGAIN || ofp_errno == OFP_EWOULDBLOCK;
+}
+
+static void response_done(struct conn *c, struct http_stats *st)
+{
+	odp_time_t now = odp_time_local();
+
+	st->responses++;
+	if (c->status < 200 || c->status > 299)
+		st->bad_responses++;
+	st->latency[http_hist_index(odp_time_to_ns(odp_time_diff(now,
+							c->start)))]++;
+
+	if (!client.keep_alive) {
+		conn_close(c);
+		return;
+	}
+
+	c->state = CONN_SEND;
+	c->sent = 0;
+	c->start = now;
+}
+
+/**
+ * Parse a complete response header. Returns the header length, 0 if the
+ * header is not complete yet and -1 on a malformed header.
+ */
+static int parse_header(struct conn *c)
+{
+	char *end, *p;
+
+	c->hdr[c->hdr_len] = 0;
+	end = strstr(c->hdr, "\r\n\r\n");
+	if (!end)
+		return c->hdr_len == HDR_LEN_MAX - 1 ? -1 : 0;
+
+	if (strncmp(c->hdr, "HTTP/1.", 7) || strlen(c->hdr) < 12)
+		return -1;
+	c->status = atoi(c->hdr + 9);
+
+	c->body_left = -1;
+	for (p = strstr(c->hdr, "\r\n"); p && p < end;
+	     p = strstr(p + 2, "\r\n")) {
+		if (!strncasecmp(p + 2, "Content-Length:", 15)) {
+			c->body_left = strtoll(p + 17, NULL, 10);
+			break;
+		}
+	}
+
+	/* A persistent connection needs the length to find the end */
+	if (c->body_left < 0 && client.keep_alive)
+		return -1;
+
+	return end + 4 - c->hdr;
+}
+
+/**
+ * Advance a connection without blocking
+ */
+static void conn_service(struct conn *c, struct http_stats *st, char *buf)
+{
+	int ret, hlen;
+
+	switch (c->state) {
+	case CONN_CLOSED:
+		if (conn_open(c))
+			st->conn_errors++;
+		return;
+	case CONN_CONNECTING:
+	case CONN_SEND:
+		/* The first send tells when the connection is up */
+		ret = ofp_send(c->fd, request + c->sent,
+			       request_len - c->sent, OFP_MSG_NBIO);
+		if (ret < 0) {
+			if (would_block() || (c->state == CONN_CONNECTING &&
+					      ofp_errno == OFP_ENOTCONN))
+				return;
+			st->conn_errors++;
+			conn_close(c);
+			return;
+		}
+		if (c->state == CONN_CONNECTING) {
+			c->state = CONN_SEND;
+			st->connects++;
+		}
+		st->tx_bytes += ret;
+		c->sent += ret;
+		if (c->sent < request_len)
+			return;
+		st->requests++;
+		c->state = CONN_RECV_HDR;
+		c->hdr_len = 0;
+		return;
+	case CONN_RECV_HDR:
+		ret = ofp_recv(c->fd, c->hdr + c->hdr_len,
+			       HDR_LEN_MAX - 1 - c->hdr_len, OFP_MSG_NBIO);
+		if (ret < 0 && would_block())
+			return;
+		if (ret <= 0) {
+			st->conn_errors++;
+			conn_close(c);
+			return;
+		}
+		st->rx_bytes += ret;
+		c->hdr_len += ret;
+		hlen = parse_header(c);
+		if (hlen == 0)
+			return;
+		if (hlen < 0) {
+			st->responses++;
+			st->bad_responses++;
+			conn_close(c);
+			return;
+		}
+		/* Part of the body may have arrived with the header */
+		if (c->body_left >= 0) {
+			c->body_left -= c->hdr_len - hlen;
+			if (c->body_left <= 0) {
+				response_done(c, st);
+				return;
+			}
+		}
+		c->state = CONN_RECV_BODY;
+		return;
+	case CONN_RECV_BODY:
+		ret = ofp_recv(c->fd, buf, BODY_BUF_LEN, OFP_MSG_NBIO);
+		if (ret < 0 && would_block())
+			return;
+		if (ret == 0 && c->body_left < 0) {
+			/* The server closed the connection after the body */
+			response_done(c, st);
+			return;
+		}
+		if (ret <= 0) {
+			st->conn_errors++;
+			conn_close(c);
+			return;
+		}
+		st->rx_bytes += ret;
+		if (c->body_left >= 0) {
+			c->body_left -= ret;
+			if (c->body_left <= 0)
+				response_done(c, st);
+		}
+		return;
+	}
+}
+
+static int loader(void *arg)
+{
+	struct loader_arg *la = arg;
+	struct http_stats *st = &http_stats[la->id];
+	struct conn *conn;
+	char *buf;
+	int i;
+
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed.\n");
+		return -1;
+	}
+
+	printf("HTTP loader %d starting on CPU: %i, %d connections\n",
+	       la->id, odp_cpu_id(), client.connections);
+
+	conn = calloc(client.connections, sizeof(*conn));
+	buf = malloc(BODY_BUF_LEN);
+	if (conn == NULL || buf == NULL) {
+		OFP_ERR("Error: HTTP loader init failed.\n");
+		goto exit;
+	}
+	for (i = 0; i < client.connections; i++)
+		conn[i].fd = -1;
+
+	while (!loaders_exit) {
+		for (i = 0; i < client.connections; i++)
+			conn_service(&conn[i], st, buf);
+
+		/* NOP unless OFP_PKT_TX_BURST_SIZE > 1 */
+		ofp_send_pending_pkt();
+	}
+
+	for (i = 0; i < client.connections; i++)
+		conn_close(&conn[i]);
+exit:
+	free(conn);
+	free(buf);
+
+	if (ofp_term_local())
+		OFP_ERR("Error: ofp_term_local failed\n");
+
+	return 0;
+}
+
+int http_client_start(odp_instance_t instance, const odp_cpumask_t *cpumask,
+		      const struct http_client_param *param,
+		      odph_thread_t thread[])
+{
+	odph_thread_param_t thr_params[HTTP_LOADER_MAX];
+	odph_thread_common_param_t thr_common_param;
+	struct in_addr host;
+	int i;
+
+	if (param->loaders < 1 || param->loaders > HTTP_LOADER_MAX ||
+	    param->connections < 1 || param->connections > HTTP_CONN_MAX ||
+	    param->url == NULL || param->url[0] != '/') {
+		OFP_ERR("Error: invalid HTTP client parameters.\n");
+		return -1;
+	}
+
+	client = *param;
+	host.s_addr = client.daddr;
+	request_len = snprintf(request, sizeof(request),
+			       "GET %s HTTP/1.1\r\n"
+			       "Host: %s\r\n"
+			       "Connection: %s\r\n\r\n",
+			       client.url, inet_ntoa(host),
+			       client.keep_alive ? "keep-alive" : "close");
+	if (request_len >= (int)sizeof(request)) {
+		OFP_ERR("Error: URL too long.\n");
+		return -1;
+	}
+	loaders_exit = 0;
+
+	for (i = 0; i < param->loaders; i++) {
+		loader_arg[i].id = i;
+		odph_thread_param_init(&thr_params[i]);
+		thr_params[i].start = loader;
+		thr_params[i].arg = &loader_arg[i];
+		thr_params[i].thr_type = ODP_THREAD_WORKER;
+		thr_params[i]._deprecated_instance = instance;
+	}
+	odph_thread_common_param_init(&thr_common_param);
+	thr_common_param.cpumask = cpumask;
+
+	if (odph_thread_create(thread, &thr_common_param, thr_params,
+			       param->loaders) != param->loaders) {
+		OFP_ERR("Error: failed to start HTTP loaders.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+void http_client_stop(odph_thread_t thread[], int num)
+{
+	loaders_exit = 1;
+	odph_thread_join(thread, num);
+}
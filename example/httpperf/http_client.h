@@ -0,0 +1,77 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef _HTTP_CLIENT_H_
+#define _HTTP_CLIENT_H_
+
+#include <odp_api.h>
+#include <odp/helper/odph_api.h>
+
+#define HTTP_LOADER_MAX 32
+#define HTTP_CONN_MAX 4096
+
+/**
+ * Latency histogram. Values below HTTP_HIST_SUB ns are counted exactly,
+ * larger values in HTTP_HIST_SUB buckets per power of two.
+ */
+#define HTTP_HIST_SUB_BITS 4
+#define HTTP_HIST_SUB (1 << HTTP_HIST_SUB_BITS)
+#define HTTP_HIST_BUCKETS ((64 - HTTP_HIST_SUB_BITS + 1) * HTTP_HIST_SUB)
+
+/**
+ * Load generator parameters
+ */
+struct http_client_param {
+	uint32_t daddr;		/**< Server address, network order */
+	uint16_t dport;		/**< Server port */
+	const char *url;	/**< Requested path */
+	int keep_alive;		/**< Reuse connections for further requests */
+	int connections;	/**< Concurrent connections per loader */
+	int loaders;		/**< Number of loader threads */
+};
+
+/**
+ * Counters of one loader thread
+ */
+struct http_stats {
+	uint64_t connects;	/**< Established connections */
+	uint64_t conn_errors;	/**< Failed or reset connections */
+	uint64_t requests;	/**< Requests sent */
+	uint64_t responses;	/**< Complete responses received */
+	uint64_t bad_responses;	/**< Non-2xx or malformed responses */
+	uint64_t rx_bytes;
+	uint64_t tx_bytes;
+	/** Request to response latency in ns, connection setup included
+	 *  without keep-alive */
+	uint64_t latency[HTTP_HIST_BUCKETS];
+} ODP_ALIGNED_CACHE;
+
+/** Indexed by loader */
+extern struct http_stats http_stats[HTTP_LOADER_MAX];
+
+static inline int http_hist_index(uint64_t v)
+{
+	int e;
+
+	if (v < HTTP_HIST_SUB)
+		return v;
+	e = 63 - __builtin_clzll(v);
+	return ((e - HTTP_HIST_SUB_BITS + 1) << HTTP_HIST_SUB_BITS) +
+		((v >> (e - HTTP_HIST_SUB_BITS)) & (HTTP_HIST_SUB - 1));
+}
+
+/**
+ * Start loaders on the CPUs of cpumask. Each loader keeps its connections
+ * busy with GET requests, using non-blocking sockets.
+ */
+int http_client_start(odp_instance_t instance, const odp_cpumask_t *cpumask,
+		      const struct http_client_param *param,
+		      odph_thread_t thread[]);
+
+/** Stop the loaders started by http_client_start() */
+void http_client_stop(odph_thread_t thread[], int num);
+
+#endif
@@ -0,0 +1,111 @@
+#!/bin/bash
+
+# Run httpperf against webserver2 and print the httpperf report.
+#
+#   veth: webserver2 and httpperf run as separate OFP instances on the two
+#         ends of a veth pair.
+#   loop: httpperf serves the pages itself (-S) over an ODP loop pktio.
+#
+# Run the script once per build to compare builds, e.g. with and without
+# OFP_CONFIG_WEBSERVER or OFP_RSS, and keep the other parameters equal.
+
+usage() {
+	echo "Usage: ${0} [-b build_dir] [-m veth|loop] [-d sec] [-k]"
+	echo "       [-n connections] [-w loaders] [-s page_size] [-c cores]"
+	exit 1
+}
+
+build_dir=$(dirname ${0})/../..
+mode=veth
+duration=10
+keep_alive=
+connections=64
+loaders=1
+page_size=1024
+cores=1
+
+while getopts "b:m:d:kn:w:s:c:h" opt; do
+	case ${opt} in
+	b) build_dir=${OPTARG};;
+	m) mode=${OPTARG};;
+	d) duration=${OPTARG};;
+	k) keep_alive=-k;;
+	n) connections=${OPTARG};;
+	w) loaders=${OPTARG};;
+	s) page_size=${OPTARG};;
+	c) cores=${OPTARG};;
+	*) usage;;
+	esac
+done
+
+httpd=${build_dir}/example/webserver2/webserver2
+httpperf=${build_dir}/example/httpperf/httpperf
+for prog in ${httpd} ${httpperf}; do
+	if [ ! -x ${prog} ]; then
+		echo "Error: ${prog} not found."
+		exit 1
+	fi
+done
+
+if [ "$EUID" -ne 0 ]; then
+	echo "Error: Script must be executed with superuser rights."
+	exit 1
+fi
+
+work=$(mktemp -d)
+head -c ${page_size} /dev/zero | tr '\0' 'x' > ${work}/index.html
+
+cleanup() {
+	[ -n "${httpd_pid}" ] && kill ${httpd_pid} 2> /dev/null
+	wait 2> /dev/null
+	if [ ${mode} = veth ]; then
+		ip link del httpperf0 2> /dev/null
+	fi
+	rm -rf ${work}
+}
+trap cleanup EXIT
+
+case ${mode} in
+veth)
+	ip link add httpperf0 type veth peer name httpperf1 || exit 1
+	for i in httpperf0 httpperf1; do
+		ip link set ${i} up
+		ip addr flush dev ${i}
+		ip -6 addr flush dev ${i}
+	done
+
+	cat > ${work}/server.cli <<-EOC
+	debug 0
+	loglevel set error
+	ifconfig fp0 192.168.100.1/24
+	EOC
+	cat > ${work}/client.cli <<-EOC
+	debug 0
+	loglevel set error
+	ifconfig fp0 192.168.100.2/24
+	EOC
+
+	${httpd} -i httpperf0 -c ${cores} -f ${work}/server.cli \
+		-r ${work} > ${work}/server.log 2>&1 &
+	httpd_pid=$!
+	sleep 3
+
+	${httpperf} -i httpperf1 -c ${cores} -f ${work}/client.cli \
+		-C 192.168.100.1 -d ${duration} -n ${connections} \
+		-w ${loaders} ${keep_alive}
+	;;
+loop)
+	cat > ${work}/client.cli <<-EOC
+	debug 0
+	loglevel set error
+	ifconfig fp0 192.168.100.1/24
+	EOC
+
+	${httpperf} -i loop -c ${cores} -f ${work}/client.cli -S ${work} \
+		-C 192.168.100.1 -d ${duration} -n ${connections} \
+		-w ${loaders} ${keep_alive}
+	;;
+*)
+	usage
+	;;
+esac
@@ -10,8 +10,33 @@
 #include "netwrap_errno.h"
 #include "ofp.h"
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include <sys/epoll.h>
 
+/*
+ * An epoll instance created by the application is an OFP epoll
+ * instance for OFP sockets, a kernel epoll instance for the other
+ * fds, and an outer kernel epoll instance waiting on both the kernel
+ * instance and the eventfd of the OFP instance. A waiter with nothing
+ * ready arms the eventfd and blocks in the kernel, so that neither
+ * set is busy polled.
+ */
+
+#define NETWRAP_EPOLL_MAX 64
+
+struct netwrap_epoll {
+	int epfd;		/* OFP epoll instance, -1 if free */
+	int kfd;		/* kernel fds of the application */
+	int outer;		/* kfd and the OFP eventfd */
+};
+
+static struct netwrap_epoll netwrap_epolls[NETWRAP_EPOLL_MAX] = {
+	[0 ... NETWRAP_EPOLL_MAX - 1] = { -1, -1, -1 }
+};
+static pthread_mutex_t netwrap_epolls_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static int setup_epoll_wrappers_called;
 
 static int (*libc_epoll_create)(int size);
@@ -20,15 +45,87 @@ static int (*libc_epoll_ctl)(int epfd, int op, int fd, struct epoll_event *event
 
 static int (*libc_epoll_wait)(int epfd, struct epoll_event *events, int maxevents, int timeout);
 
+static int (*libc_close)(int fd);
+
 
 void setup_epoll_wrappers(void)
 {
 	LIBC_FUNCTION(epoll_create);
 	LIBC_FUNCTION(epoll_ctl);
 	LIBC_FUNCTION(epoll_wait);
+	LIBC_FUNCTION(close);
 	setup_epoll_wrappers_called = 1;
 }
 
+static struct netwrap_epoll *netwrap_epoll_get(int epfd)
+{
+	int i;
+
+	for (i = 0; i < NETWRAP_EPOLL_MAX; i++)
+		if (netwrap_epolls[i].epfd == epfd)
+			return &netwrap_epolls[i];
+
+	return NULL;
+}
+
+/* Add the kernel side of an OFP epoll instance, or leave it OFP only */
+static void netwrap_epoll_add(int epfd)
+{
+	struct netwrap_epoll *ep;
+	struct epoll_event event;
+	int evfd = ofp_epoll_eventfd(epfd);
+
+	if (evfd == -1)
+		return;
+
+	pthread_mutex_lock(&netwrap_epolls_lock);
+	ep = netwrap_epoll_get(-1);
+	if (!ep)
+		goto out;
+
+	ep->kfd = libc_epoll_create(1);
+	ep->outer = libc_epoll_create(2);
+	if (ep->kfd == -1 || ep->outer == -1)
+		goto err;
+
+	event.events = EPOLLIN;
+	event.data.fd = ep->kfd;
+	if (libc_epoll_ctl(ep->outer, EPOLL_CTL_ADD, ep->kfd, &event))
+		goto err;
+	event.data.fd = evfd;
+	if (libc_epoll_ctl(ep->outer, EPOLL_CTL_ADD, evfd, &event))
+		goto err;
+
+	ep->epfd = epfd;
+	goto out;
+
+err:
+	if (ep->kfd != -1)
+		libc_close(ep->kfd);
+	if (ep->outer != -1)
+		libc_close(ep->outer);
+	ep->kfd = -1;
+	ep->outer = -1;
+out:
+	pthread_mutex_unlock(&netwrap_epolls_lock);
+}
+
+void netwrap_epoll_close(int epfd)
+{
+	struct netwrap_epoll *ep;
+
+	pthread_mutex_lock(&netwrap_epolls_lock);
+	ep = netwrap_epoll_get(epfd);
+	if (ep) {
+		ep->epfd = -1;
+		libc_close(ep->kfd);
+		libc_close(ep->outer);
+		ep->kfd = -1;
+		ep->outer = -1;
+	}
+	pthread_mutex_unlock(&netwrap_epolls_lock);
+}
+
 int epoll_create(int size)
 {
 	int epfd = -1;
@@ -38,8 +135,10 @@ int epoll_create(int size)
 
 		if (epfd == -1)
 			errno = NETWRAP_ERRNO(ofp_errno);
-		else
+		else {
+			netwrap_epoll_add(epfd);
 			errno = 0;
+		}
 	} else {
 		LIBC_FUNCTION(epoll_create);
 
@@ -58,6 +157,13 @@ int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
 {
 	if (IS_OFP_SOCKET(epfd)) {
 		struct ofp_epoll_event ofp_event = { event->events, { .u64 = event->data.u64 } };
+		struct netwrap_epoll *ep;
+
+		if (!IS_OFP_SOCKET(fd)) {
+			ep = netwrap_epoll_get(epfd);
+			if (ep)
+				return libc_epoll_ctl(ep->kfd, op, fd, event);
+		}
 
 		if (ofp_epoll_ctl(epfd, op, fd, &ofp_event) == 0)
 			return 0;
@@ -77,22 +183,91 @@ int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
 	return -1;
 }
 
-int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+static int ofp_events_get(int epfd, struct epoll_event *events, int maxevents,
+			  int timeout)
 {
-	if (IS_OFP_SOCKET(epfd)) {
-		struct ofp_epoll_event ofp_events[maxevents];
-		const int ready = ofp_epoll_wait(epfd, ofp_events, maxevents, timeout);
-		int i;
+	struct ofp_epoll_event ofp_events[maxevents];
+	const int ready = ofp_epoll_wait(epfd, ofp_events, maxevents, timeout);
+	int i;
+
+	if (ready == -1)
+		errno = NETWRAP_ERRNO(ofp_errno);
+
+	for (i = 0; i < ready; ++i) {
+		events[i].events = ofp_events[i].events;
+		events[i].data.u64 = ofp_events[i].data.u64;
+	}
+
+	return ready;
+}
 
+static int64_t now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Collect the ready OFP sockets and kernel fds without blocking, and
+ * block in the outer instance when there are none.
+ */
+static int hybrid_wait(struct netwrap_epoll *ep, struct epoll_event *events,
+		       int maxevents, int timeout)
+{
+	const int64_t end = timeout > 0 ? now_ms() + timeout : 0;
+	struct epoll_event wake;
+	int ready, kready, armed;
+
+	while (1) {
+		ready = ofp_events_get(ep->epfd, events, maxevents, 0);
 		if (ready == -1)
+			return -1;
+
+		if (ready < maxevents) {
+			kready = libc_epoll_wait(ep->kfd, events + ready,
+						 maxevents - ready, 0);
+			if (kready > 0)
+				ready += kready;
+		}
+
+		if (ready || !timeout)
+			return ready;
+
+		if (timeout > 0) {
+			timeout = end - now_ms();
+			if (timeout <= 0)
+				return 0;
+		}
+
+		armed = ofp_epoll_arm(ep->epfd);
+		if (armed == -1) {
 			errno = NETWRAP_ERRNO(ofp_errno);
+			return -1;
+		}
+		if (armed)
+			continue;
+
+		if (libc_epoll_wait(ep->outer, &wake, 1, timeout) == -1)
+			return -1;
+	}
+}
 
-		for (i = 0; i < ready; ++i) {
-			events[i].events = ofp_events[i].events;
-			events[i].data.u64 = ofp_events[i].data.u64;
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+	if (IS_OFP_SOCKET(epfd)) {
+		struct netwrap_epoll *ep = netwrap_epoll_get(epfd);
+
+		if (maxevents < 1) {
+			errno = EINVAL;
+			return -1;
 		}
 
-		return ready;
+		if (ep)
+			return hybrid_wait(ep, events, maxevents, timeout);
+
+		return ofp_events_get(epfd, events, maxevents, timeout);
 	}
 
 	if (libc_epoll_wait)
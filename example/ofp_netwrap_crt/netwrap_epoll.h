@@ -10,4 +10,7 @@
 
 void setup_epoll_wrappers(void);
 
+/* Release the kernel side of an epoll instance being closed */
+void netwrap_epoll_close(int epfd);
+
 #endif /* __NETWRAP_EPOLL_H__ */
@@ -30,24 +30,28 @@ int select(int nfds, fd_set *readfds, fd_set *writefds,
 
 	if (IS_OFP_SOCKET((nfds - 1))) {
 		ofp_fd_set ofp_readfds, ofp_readfds_bku;
+		ofp_fd_set ofp_writefds, ofp_writefds_bku;
 		struct ofp_timeval ofp_timeout_local;
 		struct ofp_timeval *ofp_timeout;
 		int i;
 		uint32_t period_usec = 0;
 		uint32_t temp_period_usec = 0;
 
-		(void)writefds;
 		(void)exceptfds;
 
-		if (!readfds) {
+		if (!readfds && !writefds) {
 			errno = EBADF;
 			return -1;
 		}
 
 		OFP_FD_ZERO(&ofp_readfds_bku);
-		for (i = OFP_SOCK_NUM_OFFSET; i < nfds; i++)
-			if (FD_ISSET(i, readfds))
+		OFP_FD_ZERO(&ofp_writefds_bku);
+		for (i = OFP_SOCK_NUM_OFFSET; i < nfds; i++) {
+			if (readfds && FD_ISSET(i, readfds))
 				OFP_FD_SET(i, &ofp_readfds_bku);
+			if (writefds && FD_ISSET(i, writefds))
+				OFP_FD_SET(i, &ofp_writefds_bku);
+		}
 
 		ofp_timeout = &ofp_timeout_local;
 		ofp_timeout_local.tv_sec = 0;
@@ -60,7 +64,11 @@ int select(int nfds, fd_set *readfds, fd_set *writefds,
 		do {
 			memcpy(&ofp_readfds, &ofp_readfds_bku,
 					sizeof(ofp_readfds));
-			select_value = ofp_select(nfds, &ofp_readfds, NULL,
+			memcpy(&ofp_writefds, &ofp_writefds_bku,
+					sizeof(ofp_writefds));
+			select_value = ofp_select(nfds,
+				readfds ? &ofp_readfds : NULL,
+				writefds ? &ofp_writefds : NULL,
 				NULL, ofp_timeout);
 			if (select_value)
 				break;
@@ -79,12 +87,20 @@ int select(int nfds, fd_set *readfds, fd_set *writefds,
 		errno = NETWRAP_ERRNO(ofp_errno);
 
 		if (select_value > 0) {
-			for (i = OFP_SOCK_NUM_OFFSET; i < nfds; i++)
-				if (FD_ISSET(i, readfds) &&
+			for (i = OFP_SOCK_NUM_OFFSET; i < nfds; i++) {
+				if (readfds && FD_ISSET(i, readfds) &&
 					!OFP_FD_ISSET(i, &ofp_readfds))
 						FD_CLR(i, readfds);
-		} else if (select_value == 0)
-			FD_ZERO(readfds);
+				if (writefds && FD_ISSET(i, writefds) &&
+					!OFP_FD_ISSET(i, &ofp_writefds))
+						FD_CLR(i, writefds);
+			}
+		} else if (select_value == 0) {
+			if (readfds)
+				FD_ZERO(readfds);
+			if (writefds)
+				FD_ZERO(writefds);
+		}
 
 		if (!ofp_errno && timeout) {
 			timeout->tv_sec = ofp_timeout_local.tv_sec;
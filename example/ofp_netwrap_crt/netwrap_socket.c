@@ -18,6 +18,7 @@
 #include <unistd.h>
 #include "ofp.h"
 #include "netwrap_socket.h"
+#include "netwrap_epoll.h"
 #include "netwrap_errno.h"
 
 union _ofp_sockaddr_storage {
@@ -150,6 +151,7 @@ int close(int sockfd)
 	int close_value;
 
 	if (IS_OFP_SOCKET(sockfd)) {
+		netwrap_epoll_close(sockfd);
 		close_value = ofp_close(sockfd);
 		errno = NETWRAP_ERRNO(ofp_errno);
 	} else if (libc_close)
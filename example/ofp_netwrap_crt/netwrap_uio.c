@@ -6,6 +6,7 @@
  */
 
 #include "netwrap_common.h"
+#include <string.h>
 #include <sys/uio.h>
 #include <unistd.h>
 #include <odp_api.h>
@@ -14,47 +15,74 @@
 #include "netwrap_errno.h"
 
 static ssize_t (*libc_writev)(int, const struct iovec *, int);
+static ssize_t (*libc_readv)(int, const struct iovec *, int);
 
 void setup_uio_wrappers(void)
 {
 	LIBC_FUNCTION(writev);
+	LIBC_FUNCTION(readv);
 }
 
 
+/*
+ * All iovecs are handed to OFP at once, so that e.g. a header and a
+ * body are sent in the same segments.
+ */
 ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
 {
 	ssize_t writev_value = -1;
 
 	if (IS_OFP_SOCKET(fd)) {
-		int i;
+		struct ofp_iovec ofp_iov[iovcnt > 0 ? iovcnt : 1];
+		struct ofp_msghdr msg;
 		ssize_t writev_sum = 0;
-		ssize_t iov_len;
-		ssize_t iov_snt;
-		char *iov_base;
 		ofp_ssize_t ofp_send_res;
 
+		if (iovcnt < 0) {
+			errno = EINVAL;
+			return -1;
+		}
+		memcpy(ofp_iov, iov, iovcnt * sizeof(ofp_iov[0]));
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = ofp_iov;
+		msg.msg_iovlen = iovcnt;
 
-		for (i = 0; i < iovcnt; i++) {
-			iov_len = iov[i].iov_len;
-			iov_snt = 0;
-			iov_base = (char *)iov[i].iov_base;
+		while (1) {
+			/* Skip the iovecs sent */
+			while (msg.msg_iovlen > 0 && msg.msg_iov->iov_len == 0) {
+				msg.msg_iov++;
+				msg.msg_iovlen--;
+			}
+			if (msg.msg_iovlen == 0)
+				break;
 
-			while (iov_snt < iov_len) {
-				ofp_send_res = ofp_send(fd, iov_base + iov_snt,
-					iov_len - iov_snt, 0);
+			ofp_send_res = ofp_sendmsg(fd, &msg, 0);
 
-				if (ofp_send_res <= 0) {
-					if (ofp_send_res == 0 ||
-						ofp_errno == OFP_EAGAIN) {
-						usleep(100);
-						continue;
-					}
-					errno = NETWRAP_ERRNO(ofp_errno);
-					return -1;
+			if (ofp_send_res <= 0) {
+				if (ofp_send_res == 0 ||
+					ofp_errno == OFP_EAGAIN) {
+					usleep(100);
+					continue;
+				}
+				errno = NETWRAP_ERRNO(ofp_errno);
+				return -1;
+			}
+			writev_sum += ofp_send_res;
+
+			while (ofp_send_res > 0) {
+				size_t n = msg.msg_iov->iov_len;
+
+				if ((size_t)ofp_send_res < n)
+					n = ofp_send_res;
+				msg.msg_iov->iov_base =
+					(char *)msg.msg_iov->iov_base + n;
+				msg.msg_iov->iov_len -= n;
+				ofp_send_res -= n;
+				if (msg.msg_iov->iov_len == 0) {
+					msg.msg_iov++;
+					msg.msg_iovlen--;
 				}
-				iov_snt += ofp_send_res;
 			}
-			writev_sum += iov_len;
 		}
 		writev_value = writev_sum;
 	} else if (libc_writev)
@@ -72,3 +100,32 @@ ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
 
 	return writev_value;
 }
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	ssize_t readv_value = -1;
+
+	if (IS_OFP_SOCKET(fd)) {
+		struct ofp_msghdr msg;
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = (struct ofp_iovec *)(uintptr_t)iov;
+		msg.msg_iovlen = iovcnt;
+
+		readv_value = ofp_recvmsg(fd, &msg, 0);
+		errno = NETWRAP_ERRNO(ofp_errno);
+	} else if (libc_readv)
+		readv_value = (*libc_readv)(fd, iov, iovcnt);
+	else {
+		LIBC_FUNCTION(readv);
+
+		if (libc_readv)
+			readv_value = (*libc_readv)(fd, iov, iovcnt);
+		else {
+			readv_value = -1;
+			errno = EACCES;
+		}
+	}
+
+	return readv_value;
+}
@@ -32,6 +32,15 @@
 /** Number of worker threads */
 #define NUM_WORKERS 2
 
+/** Maximum number of worker threads in multi-connection mode */
+#define MAX_WORKERS 32
+
+/** Maximum number of connections per worker */
+#define MAX_CONNECTIONS 1024
+
+/** Default request and response size in request/response tests */
+#define DEF_MSG_SIZE 64
+
 /** Maximum number of packet in a burst */
 #define PKT_BURST_SIZE  16
 
@@ -64,6 +73,27 @@ typedef enum appl_mode_t {
 	MODE_CLIENT
 } appl_mode_t;
 
+/**
+ * Test types
+ */
+typedef enum test_mode_t {
+	TEST_STREAM = 0,	/**< Bulk transfer from client to server */
+	TEST_RR,		/**< Request/response on open connections */
+	TEST_CRR		/**< Connect, request/response, close */
+} test_mode_t;
+
+/**
+ * RTT histogram. Values below HIST_SUB ns are counted exactly, larger
+ * values in HIST_SUB buckets per power of two.
+ */
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+typedef struct {
+	uint64_t count[HIST_BUCKETS];
+} rtt_hist_t;
+
 /**
  * Packet counters
  */
@@ -88,6 +118,14 @@ typedef struct {
 	uint16_t lport;		/**< Listening port number */
 	char *cli_file;		/**< CLI file passed to CLI */
 	int single_thread;	/**< Run pktio and application in same thread */
+	test_mode_t test;	/**< Test type */
+	int workers;		/**< Number of workers */
+	int connections;	/**< Client connections per worker */
+	uint32_t req_size;	/**< Request size, or send size in stream test */
+	uint32_t resp_size;	/**< Response size */
+	int interval;		/**< Statistics print interval in seconds */
+	int duration;		/**< Test duration in seconds, 0 for no limit */
+	int multi;		/**< Use multi-connection workers */
 } appl_args_t;
 
 /**
@@ -95,15 +133,49 @@ typedef struct {
  */
 typedef struct {
 	odp_pktin_queue_t pktin;
+	int id;			/**< Worker index in multi-connection mode */
 } thread_args_t;
 
+/**
+ * Per worker statistics in multi-connection mode
+ */
+typedef struct ODP_ALIGNED_CACHE {
+	uint64_t recv_calls;
+	uint64_t recv_bytes;
+	uint64_t send_calls;
+	uint64_t send_bytes;
+	uint64_t transactions;	/**< Completed request/response exchanges */
+	uint64_t connects;	/**< Established connections */
+	uint64_t errors;	/**< Failed connections */
+	rtt_hist_t rtt;		/**< Transaction RTT in ns */
+} worker_stats_t;
+
+/**
+ * Connection states in multi-connection mode
+ */
+typedef enum conn_state_t {
+	CONN_CLOSED = 0,
+	CONN_CONNECTING,	/**< Waiting for the first send to succeed */
+	CONN_SEND,		/**< Sending a request or a response */
+	CONN_RECV		/**< Receiving a request or a response */
+} conn_state_t;
+
+typedef struct {
+	int fd;
+	conn_state_t state;
+	uint32_t left;		/**< Bytes left to send or receive */
+	odp_time_t start;	/**< Start of the transaction */
+} conn_t;
+
 /**
  * Grouping of all global data
  */
 typedef struct {
 	appl_args_t appl;	/**< Application (parsed) arguments */
 	/** Thread specific arguments */
-	thread_args_t thread[NUM_WORKERS];
+	thread_args_t thread[MAX_WORKERS];
+	/** Worker statistics in multi-connection mode */
+	worker_stats_t stats[MAX_WORKERS];
 	int server_fd;		/**< Socket for incoming client connections */
 	int client_fd;		/**< Socket for active client connection */
 	uint64_t recv_calls;	/**< Number of recv() function calls */
@@ -459,19 +531,23 @@ static int setup_client(char *daddr, uint16_t lport ODP_UNUSED)
 	int fd;
 	struct in_addr laddr_lin;
 
-	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
-	if (fd < 0) {
-		OFP_ERR("Error: ofp_socket failed\n");
+	if (inet_aton(daddr, &laddr_lin) == 0) {
+		OFP_ERR("Error: invalid address: %s", daddr);
 		return -1;
 	}
+	gbl_args->s_addr = laddr_lin.s_addr;
 
-	if (inet_aton(daddr, &laddr_lin) == 0) {
-		OFP_ERR("Error: invalid address: %s", daddr);
+	/* Multi-connection workers open their own sockets */
+	if (gbl_args->appl.multi)
+		return 0;
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	if (fd < 0) {
+		OFP_ERR("Error: ofp_socket failed\n");
 		return -1;
 	}
 
 	gbl_args->client_fd = fd;
-	gbl_args->s_addr = laddr_lin.s_addr;
 
 	return 0;
 }
@@ -643,6 +719,439 @@ static int run_client_single(void *arg ODP_UNUSED)
 	return 0;
 }
 
+static inline int hist_index(uint64_t v)
+{
+	int e;
+
+	if (v < HIST_SUB)
+		return v;
+	e = 63 - __builtin_clzll(v);
+	return ((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) +
+		((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/**
+ * Lower bound of the values counted in a histogram bucket
+ */
+static uint64_t hist_value(int idx)
+{
+	int e;
+
+	if (idx < HIST_SUB)
+		return idx;
+	e = (idx >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+	return (uint64_t)(HIST_SUB + (idx & (HIST_SUB - 1))) <<
+		(e - HIST_SUB_BITS);
+}
+
+static uint64_t hist_percentile(const rtt_hist_t *hist, uint64_t total,
+				double pct)
+{
+	uint64_t target, sum = 0;
+	int i;
+
+	if (total == 0)
+		return 0;
+
+	target = (uint64_t)(total * pct / 100);
+	if (target >= total)
+		target = total - 1;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		sum += hist->count[i];
+		if (sum > target)
+			return hist_value(i);
+	}
+	return hist_value(HIST_BUCKETS - 1);
+}
+
+static void print_rtt(const char *prefix, const rtt_hist_t *hist,
+		      uint64_t total)
+{
+	if (total == 0)
+		return;
+
+	printf("%sRTT p50 %.1f us, p99 %.1f us, p999 %.1f us\n", prefix,
+	       (double)hist_percentile(hist, total, 50) / 1000,
+	       (double)hist_percentile(hist, total, 99) / 1000,
+	       (double)hist_percentile(hist, total, 99.9) / 1000);
+}
+
+/**
+ * Sum the statistics of all workers
+ */
+static void sum_worker_stats(worker_stats_t *sum)
+{
+	int i, j;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for (i = 0; i < gbl_args->appl.workers; i++) {
+		worker_stats_t *st = &gbl_args->stats[i];
+
+		sum->recv_calls += st->recv_calls;
+		sum->recv_bytes += st->recv_bytes;
+		sum->send_calls += st->send_calls;
+		sum->send_bytes += st->send_bytes;
+		sum->transactions += st->transactions;
+		sum->connects += st->connects;
+		sum->errors += st->errors;
+		for (j = 0; j < HIST_BUCKETS; j++)
+			sum->rtt.count[j] += st->rtt.count[j];
+	}
+}
+
+static void conn_close(conn_t *conn)
+{
+	if (conn->fd >= 0)
+		ofp_close(conn->fd);
+	conn->fd = -1;
+	conn->state = CONN_CLOSED;
+}
+
+/**
+ * Start a non-blocking connect to the server
+ */
+static int conn_open(conn_t *conn)
+{
+	struct ofp_sockaddr_in addr = {0};
+	int on = 1;
+
+	conn->fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	if (conn->fd < 0)
+		return -1;
+
+	if (ofp_ioctl(conn->fd, OFP_FIONBIO, &on) ||
+	    (gbl_args->appl.test != TEST_STREAM &&
+	     ofp_setsockopt(conn->fd, OFP_IPPROTO_TCP, OFP_TCP_NODELAY,
+			    &on, sizeof(on)))) {
+		conn_close(conn);
+		return -1;
+	}
+
+	addr.sin_len = sizeof(struct ofp_sockaddr_in);
+	addr.sin_family = OFP_AF_INET;
+	addr.sin_port = odp_cpu_to_be_16(gbl_args->appl.lport);
+	addr.sin_addr.s_addr = gbl_args->s_addr;
+
+	if (ofp_connect(conn->fd, (struct ofp_sockaddr *)&addr,
+			sizeof(addr)) < 0 && ofp_errno != OFP_EINPROGRESS) {
+		conn_close(conn);
+		return -1;
+	}
+
+	conn->state = CONN_CONNECTING;
+	conn->left = gbl_args->appl.req_size;
+	conn->start = odp_time_local();
+
+	return 0;
+}
+
+/**
+ * Account a completed request/response exchange
+ */
+static inline void transaction_done(conn_t *conn, worker_stats_t *st)
+{
+	odp_time_t now = odp_time_local();
+
+	st->transactions++;
+	st->rtt.count[hist_index(odp_time_to_ns(odp_time_diff(now,
+							      conn->start)))]++;
+
+	if (gbl_args->appl.test == TEST_CRR) {
+		conn_close(conn);
+		return;
+	}
+
+	conn->state = CONN_SEND;
+	conn->left = gbl_args->appl.req_size;
+	conn->start = now;
+}
+
+/**
+ * Advance a client connection without blocking
+ */
+static void client_service(conn_t *conn, worker_stats_t *st, uint8_t *buf,
+			   uint32_t buf_len)
+{
+	int ret;
+
+	switch (conn->state) {
+	case CONN_CLOSED:
+		if (conn_open(conn))
+			st->errors++;
+		return;
+	case CONN_CONNECTING:
+	case CONN_SEND:
+		/* ToFix: there is no way to poll for connect completion, so
+		 * the first send tells when the connection is up. */
+		ret = ofp_send(conn->fd, buf, conn->left < buf_len ?
+			       conn->left : buf_len, OFP_MSG_NBIO);
+		if (ret < 0) {
+			if (ofp_errno == OFP_EAGAIN ||
+			    ofp_errno == OFP_EWOULDBLOCK ||
+			    (conn->state == CONN_CONNECTING &&
+			     ofp_errno == OFP_ENOTCONN))
+				return;
+			st->errors++;
+			conn_close(conn);
+			return;
+		}
+		if (conn->state == CONN_CONNECTING) {
+			conn->state = CONN_SEND;
+			st->connects++;
+			gbl_args->con_status = 1;
+			/* CRR transactions include the connection setup */
+			if (gbl_args->appl.test == TEST_RR)
+				conn->start = odp_time_local();
+		}
+		st->send_bytes += ret;
+		st->send_calls++;
+		conn->left -= ret;
+		if (conn->left)
+			return;
+		if (gbl_args->appl.test == TEST_STREAM) {
+			conn->left = gbl_args->appl.req_size;
+			return;
+		}
+		conn->state = CONN_RECV;
+		conn->left = gbl_args->appl.resp_size;
+		if (conn->left == 0)
+			transaction_done(conn, st);
+		return;
+	case CONN_RECV:
+		ret = ofp_recv(conn->fd, buf, conn->left < buf_len ?
+			       conn->left : buf_len, OFP_MSG_NBIO);
+		if (ret < 0 && (ofp_errno == OFP_EAGAIN ||
+				ofp_errno == OFP_EWOULDBLOCK))
+			return;
+		if (ret <= 0) {
+			st->errors++;
+			conn_close(conn);
+			return;
+		}
+		st->recv_bytes += ret;
+		st->recv_calls++;
+		conn->left -= ret;
+		if (conn->left == 0)
+			transaction_done(conn, st);
+		return;
+	}
+}
+
+/**
+ * Serve an accepted connection without blocking. Returns -1 when the
+ * connection has been closed.
+ */
+static int server_service(conn_t *conn, worker_stats_t *st, uint8_t *buf,
+			  uint32_t buf_len)
+{
+	uint32_t len = buf_len;
+	int ret;
+
+	if (conn->state == CONN_SEND) {
+		ret = ofp_send(conn->fd, buf, conn->left < buf_len ?
+			       conn->left : buf_len, OFP_MSG_NBIO);
+		if (ret < 0) {
+			if (ofp_errno == OFP_EAGAIN ||
+			    ofp_errno == OFP_EWOULDBLOCK)
+				return 0;
+			conn_close(conn);
+			return -1;
+		}
+		st->send_bytes += ret;
+		st->send_calls++;
+		conn->left -= ret;
+		if (conn->left == 0) {
+			st->transactions++;
+			conn->state = CONN_RECV;
+			conn->left = gbl_args->appl.req_size;
+		}
+		return 0;
+	}
+
+	if (gbl_args->appl.test != TEST_STREAM && conn->left < len)
+		len = conn->left;
+
+	ret = ofp_recv(conn->fd, buf, len, OFP_MSG_NBIO);
+	if (ret < 0 && (ofp_errno == OFP_EAGAIN ||
+			ofp_errno == OFP_EWOULDBLOCK))
+		return 0;
+	if (ret <= 0) {
+		conn_close(conn);
+		return -1;
+	}
+	st->recv_bytes += ret;
+	st->recv_calls++;
+
+	if (gbl_args->appl.test == TEST_STREAM)
+		return 0;
+
+	conn->left -= ret;
+	if (conn->left == 0) {
+		conn->state = CONN_SEND;
+		conn->left = gbl_args->appl.resp_size;
+		if (conn->left == 0) {
+			st->transactions++;
+			conn->state = CONN_RECV;
+			conn->left = gbl_args->appl.req_size;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Run a multi-connection client worker. Each worker receives packets from
+ * its own input queue and runs its own connections.
+ */
+static int run_client_multi(void *arg)
+{
+	thread_args_t *thr_args = arg;
+	worker_stats_t *st = &gbl_args->stats[thr_args->id];
+	uint8_t buf[SOCKET_TX_BUF_LEN] ODP_ALIGNED_CACHE;
+	int num = gbl_args->appl.connections;
+	int timer_count = 0;
+	conn_t *conn;
+	int i;
+
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed\n");
+		exit_threads = 1;
+		return -1;
+	}
+
+	printf("Client thread starting on CPU: %i, %d connections\n",
+	       odp_cpu_id(), num);
+
+	conn = malloc(num * sizeof(conn_t));
+	if (conn == NULL) {
+		OFP_ERR("Error: connection table alloc failed\n");
+		exit_threads = 1;
+		goto exit;
+	}
+	for (i = 0; i < num; i++) {
+		conn[i].fd = -1;
+		conn[i].state = CONN_CLOSED;
+	}
+	memset(buf, 0, sizeof(buf));
+
+	while (!exit_threads) {
+		int pkts;
+
+		timer_count++;
+		if (odp_unlikely(timer_count > TIMER_SCHED_INT)) {
+			timer_count = 0;
+			handle_timeouts();
+		}
+		pkts = rx_burst(thr_args->pktin);
+		if (odp_unlikely(pkts < 0)) {
+			OFP_ERR("Error: odp_pktin_recv failed\n");
+			exit_threads = 1;
+			break;
+		}
+		if (pkts == PKT_BURST_SIZE)
+			continue;
+
+		for (i = 0; i < num; i++)
+			client_service(&conn[i], st, buf, sizeof(buf));
+
+		/* NOP unless OFP_PKT_TX_BURST_SIZE > 1 */
+		ofp_send_pending_pkt();
+	}
+
+	for (i = 0; i < num; i++)
+		conn_close(&conn[i]);
+	free(conn);
+exit:
+	if (ofp_term_local())
+		OFP_ERR("Error: ofp_term_local failed\n");
+
+	return 0;
+}
+
+/**
+ * Run a multi-connection server worker. Workers accept connections from
+ * the shared listening socket and serve the connections they accepted.
+ */
+static int run_server_multi(void *arg)
+{
+	thread_args_t *thr_args = arg;
+	worker_stats_t *st = &gbl_args->stats[thr_args->id];
+	uint8_t buf[SOCKET_RX_BUF_LEN] ODP_ALIGNED_CACHE;
+	int timer_count = 0;
+	conn_t *conn;
+	int num = 0;
+	int i;
+
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed\n");
+		exit_threads = 1;
+		return -1;
+	}
+
+	printf("Server thread starting on CPU: %i\n", odp_cpu_id());
+
+	conn = malloc(MAX_CONNECTIONS * sizeof(conn_t));
+	if (conn == NULL) {
+		OFP_ERR("Error: connection table alloc failed\n");
+		exit_threads = 1;
+		goto exit;
+	}
+	memset(buf, 0, sizeof(buf));
+
+	while (!exit_threads) {
+		int pkts, fd;
+
+		timer_count++;
+		if (odp_unlikely(timer_count > TIMER_SCHED_INT)) {
+			timer_count = 0;
+			handle_timeouts();
+		}
+		pkts = rx_burst(thr_args->pktin);
+		if (odp_unlikely(pkts < 0)) {
+			OFP_ERR("Error: odp_pktin_recv failed\n");
+			exit_threads = 1;
+			break;
+		}
+		if (pkts == PKT_BURST_SIZE)
+			continue;
+
+		/* The listening socket is non-blocking */
+		fd = ofp_accept(gbl_args->server_fd, NULL, NULL);
+		if (fd >= 0) {
+			if (num == MAX_CONNECTIONS) {
+				ofp_close(fd);
+				st->errors++;
+			} else {
+				conn[num].fd = fd;
+				conn[num].state = CONN_RECV;
+				conn[num].left = gbl_args->appl.req_size;
+				num++;
+				st->connects++;
+				gbl_args->con_status = 1;
+			}
+		}
+
+		for (i = 0; i < num;)
+			if (server_service(&conn[i], st, buf, sizeof(buf)))
+				conn[i] = conn[--num];
+			else
+				i++;
+
+		/* NOP unless OFP_PKT_TX_BURST_SIZE > 1 */
+		ofp_send_pending_pkt();
+	}
+
+	for (i = 0; i < num; i++)
+		conn_close(&conn[i]);
+	free(conn);
+exit:
+	if (ofp_term_local())
+		OFP_ERR("Error: ofp_term_local failed\n");
+
+	return 0;
+}
+
 /**
  * Get pktio device capability
  */
@@ -690,21 +1199,37 @@ static void print_global_stats(void)
 	uint64_t rx_bits, rx_bits_prev = 0, rx_bps, rx_maximum_bps = 0;
 	uint64_t tx_calls, tx_calls_prev = 0, tx_cps, tx_maximum_cps = 0;
 	uint64_t tx_bits, tx_bits_prev = 0, tx_bps, tx_maximum_bps = 0;
-	odp_time_t ts_prev;
+	uint64_t trans_prev = 0, conn_prev = 0;
+	static worker_stats_t sum, sum_prev;
+	static rtt_hist_t hist;
+	odp_time_t ts_prev, ts_start;
 
 	ts_prev = odp_time_local();
+	ts_start = ts_prev;
 
 	while (!exit_threads) {
 		odp_time_t ts;
 		odp_time_t span;
 		uint64_t time_sec;
 
-		sleep(DEF_PRINT_INTERVAL);
+		sleep(gbl_args->appl.interval);
+		if (gbl_args->appl.duration &&
+		    odp_time_to_ns(odp_time_diff(odp_time_local(), ts_start)) >=
+		    (uint64_t)gbl_args->appl.duration * ODP_TIME_SEC_IN_NS)
+			exit_threads = 1;
 		if (gbl_args->con_status == 0)
 			continue;
 		if (exit_threads)
 			break;
 
+		if (gbl_args->appl.multi) {
+			sum_worker_stats(&sum);
+			gbl_args->recv_calls = sum.recv_calls;
+			gbl_args->recv_bytes = sum.recv_bytes;
+			gbl_args->send_calls = sum.send_calls;
+			gbl_args->send_bytes = sum.send_bytes;
+		}
+
 		rx_calls = gbl_args->recv_calls;
 		rx_bits = gbl_args->recv_bytes * 8;
 		tx_calls = gbl_args->send_calls;
@@ -745,6 +1270,27 @@ static void print_global_stats(void)
 			       (double)tx_maximum_bps / 1000000000, tx_cps,
 			       tx_maximum_cps);
 
+		if (gbl_args->appl.multi) {
+			int i;
+
+			/* RTT histogram of the interval */
+			for (i = 0; i < HIST_BUCKETS; i++)
+				hist.count[i] = sum.rtt.count[i] -
+					sum_prev.rtt.count[i];
+
+			printf("  %" PRIu64 " transactions per sec, "
+			       "%" PRIu64 " connections per sec, "
+			       "%" PRIu64 " errors\n",
+			       (sum.transactions - trans_prev) / time_sec,
+			       (sum.connects - conn_prev) / time_sec,
+			       sum.errors);
+			print_rtt("  ", &hist, sum.transactions - trans_prev);
+
+			sum_prev = sum;
+			trans_prev = sum.transactions;
+			conn_prev = sum.connects;
+		}
+
 		ts_prev = ts;
 		rx_calls_prev = rx_calls;
 		rx_bits_prev = rx_bits;
@@ -752,6 +1298,21 @@ static void print_global_stats(void)
 		tx_bits_prev = tx_bits;
 	}
 
+	if (gbl_args->appl.multi) {
+		sum_worker_stats(&sum);
+		gbl_args->recv_calls = sum.recv_calls;
+		gbl_args->recv_bytes = sum.recv_bytes;
+		gbl_args->send_calls = sum.send_calls;
+		gbl_args->send_bytes = sum.send_bytes;
+
+		if (sum.transactions) {
+			printf("\nTotal transactions %" PRIu64 ", "
+			       "connections %" PRIu64 ", errors %" PRIu64 "\n",
+			       sum.transactions, sum.connects, sum.errors);
+			print_rtt("", &sum.rtt, sum.transactions);
+		}
+	}
+
 	if (gbl_args->appl.mode == MODE_CLIENT) {
 		if (gbl_args->send_calls == 0)
 			return;
@@ -809,9 +1370,26 @@ static void usage(char *progname)
 	       "  -p, --port <port>    Port address\n"
 	       "                            Default: %d\n"
 	       "  -f, --cli-file <file> OFP CLI file\n"
+	       "  -m, --test <test>     stream: Bulk transfer (default)\n"
+	       "                        rr:     Request/response\n"
+	       "                        crr:    Connect, request/response, close\n"
+	       "  -w, --workers <num>   Number of worker cores, each receiving from its\n"
+	       "                        own input queue. Default: 1\n"
+	       "  -n, --connections <num> Client connections per worker. Default: 1\n"
+	       "  -q, --request-size <bytes> Request size, or send size in stream test\n"
+	       "                            Default: %d, stream: %d\n"
+	       "  -r, --response-size <bytes> Response size. Default: %d\n"
+	       "  -I, --interval <sec>  Statistics print interval. Default: %d\n"
+	       "  -d, --duration <sec>  Test duration, 0 for no limit. Default: 0\n"
 	       "  -h, --help            Display help and exit\n"
+	       "\n"
+	       "rr and crr tests, more than one worker or more than one connection\n"
+	       "run multi-connection workers that ignore --single-thread. The server\n"
+	       "must be given the same test and message sizes as the client.\n"
 	       "\n", NO_PATH(progname), NO_PATH(progname),
-	       ofp_print_ip_addr(DEF_BIND_ADDR), DEF_BIND_PORT);
+	       ofp_print_ip_addr(DEF_BIND_ADDR), DEF_BIND_PORT,
+	       DEF_MSG_SIZE, SOCKET_TX_BUF_LEN, DEF_MSG_SIZE,
+	       DEF_PRINT_INTERVAL);
 }
 
 /**
@@ -835,16 +1413,27 @@ static void parse_args(int argc, char *argv[], appl_args_t *args)
 		{"port", required_argument, NULL, 'p'},
 		{"server", no_argument, NULL, 's'},
 		{"single-thread", required_argument, NULL, 't'},
+		{"test", required_argument, NULL, 'm'},
+		{"workers", required_argument, NULL, 'w'},
+		{"connections", required_argument, NULL, 'n'},
+		{"request-size", required_argument, NULL, 'q'},
+		{"response-size", required_argument, NULL, 'r'},
+		{"interval", required_argument, NULL, 'I'},
+		{"duration", required_argument, NULL, 'd'},
 		{NULL, 0, NULL, 0}
 	};
+	int req_size = -1, resp_size = -1;
 
 	memset(args, 0, sizeof(appl_args_t));
 
 	args->lport = DEF_BIND_PORT;
 	args->single_thread = 1;
+	args->workers = 1;
+	args->connections = 1;
+	args->interval = DEF_PRINT_INTERVAL;
 
 	while (1) {
-		opt = getopt_long(argc, argv, "+c:f:hi:l:p:st:",
+		opt = getopt_long(argc, argv, "+c:d:f:hi:l:m:n:p:q:r:st:w:I:",
 				  longopts, &long_index);
 
 		if (opt == -1)
@@ -929,17 +1518,62 @@ static void parse_args(int argc, char *argv[], appl_args_t *args)
 		case 't':
 			args->single_thread = atoi(optarg);
 			break;
+		case 'm':
+			if (!strcmp(optarg, "stream")) {
+				args->test = TEST_STREAM;
+			} else if (!strcmp(optarg, "rr")) {
+				args->test = TEST_RR;
+			} else if (!strcmp(optarg, "crr")) {
+				args->test = TEST_CRR;
+			} else {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'w':
+			args->workers = atoi(optarg);
+			break;
+		case 'n':
+			args->connections = atoi(optarg);
+			break;
+		case 'q':
+			req_size = atoi(optarg);
+			break;
+		case 'r':
+			resp_size = atoi(optarg);
+			break;
+		case 'I':
+			args->interval = atoi(optarg);
+			break;
+		case 'd':
+			args->duration = atoi(optarg);
+			break;
 		default:
 			break;
 		}
 	}
 
 	if (args->if_name == NULL ||
-	    (args->mode == MODE_CLIENT && args->daddr == 0)) {
+	    (args->mode == MODE_CLIENT && args->daddr == 0) ||
+	    args->workers < 1 || args->workers > MAX_WORKERS ||
+	    args->connections < 1 || args->connections > MAX_CONNECTIONS ||
+	    args->interval < 1 || args->duration < 0 ||
+	    req_size == 0 || resp_size < -1) {
 		usage(argv[0]);
 		exit(EXIT_FAILURE);
 	}
 
+	if (req_size < 0)
+		req_size = args->test == TEST_STREAM ?
+			SOCKET_TX_BUF_LEN : DEF_MSG_SIZE;
+	if (resp_size < 0)
+		resp_size = DEF_MSG_SIZE;
+	args->req_size = req_size;
+	args->resp_size = resp_size;
+
+	args->multi = args->test != TEST_STREAM || args->workers > 1 ||
+		args->connections > 1;
+
 	optind = 1; /* reset 'extern optind' from the getopt lib */
 }
 
@@ -968,6 +1602,16 @@ static void print_info(char *progname, appl_args_t *appl_args)
 	       "Port:            %d\n",
 	       progname, appl_args->if_name, appl_args->daddr,
 	       appl_args->laddr, appl_args->lport);
+	if (appl_args->multi)
+		printf("Test:            %s\n"
+		       "Connections:     %d per worker\n"
+		       "Request size:    %" PRIu32 "\n"
+		       "Response size:   %" PRIu32 "\n",
+		       appl_args->test == TEST_STREAM ? "stream" :
+		       appl_args->test == TEST_RR ? "rr" : "crr",
+		       appl_args->connections, appl_args->req_size,
+		       appl_args->test == TEST_STREAM ? 0 :
+		       appl_args->resp_size);
 	fflush(NULL);
 }
 
@@ -980,9 +1624,9 @@ static void print_info(char *progname, appl_args_t *appl_args)
  */
 int main(int argc, char *argv[])
 {
-	odph_thread_t thread_tbl[NUM_WORKERS];
+	odph_thread_t thread_tbl[MAX_WORKERS];
 	odp_shm_t shm;
-	int num_workers, next_worker;
+	int num_workers, next_worker, i;
 	odp_cpumask_t cpu_mask;
 	thread_args_t thr_args;
 	odp_pktio_param_t pktio_param;
@@ -993,7 +1637,7 @@ int main(int argc, char *argv[])
 	odp_instance_t instance;
 	odp_pktio_t pktio;
 	odp_pktio_capability_t capa;
-	odp_pktin_queue_t pktin;
+	odp_pktin_queue_t pktin[MAX_WORKERS];
 	int num_output_q;
 
 	if (odp_init_global(&instance, NULL, NULL)) {
@@ -1030,7 +1674,10 @@ int main(int argc, char *argv[])
 	 * worker threads from core #1. Core #0 requires its own TX queue.
 	 */
 	next_worker = 1;
-	num_workers = (gbl_args->appl.single_thread) ? 1 : 2;
+	if (gbl_args->appl.multi)
+		num_workers = gbl_args->appl.workers;
+	else
+		num_workers = (gbl_args->appl.single_thread) ? 1 : 2;
 	if ((odp_cpu_count() - 1) < num_workers) {
 		OFP_ERR("ERROR: At least %d cores required\n", num_workers + 1);
 		exit(EXIT_FAILURE);
@@ -1063,9 +1710,29 @@ int main(int argc, char *argv[])
 	odp_pktin_queue_param_init(&pktin_param);
 	pktin_param.op_mode = ODP_PKTIO_OP_MT_UNSAFE;
 	pktin_param.num_queues = 1;
+	if (gbl_args->appl.multi && num_workers > 1) {
+		if (capa.max_input_queues < (unsigned)num_workers) {
+			OFP_ERR("Error: %s supports %u input queues, %d needed\n",
+				gbl_args->appl.if_name, capa.max_input_queues,
+				num_workers);
+			exit(EXIT_FAILURE);
+		}
+		pktin_param.num_queues = num_workers;
+		pktin_param.hash_enable = 1;
+		pktin_param.hash_proto.proto.ipv4_tcp = 1;
+	}
 
 	odp_pktout_queue_param_init(&pktout_param);
-	if (capa.max_output_queues > 1) {
+	if (gbl_args->appl.multi) {
+		/* One TX queue per worker and one for core #0 if possible */
+		if (capa.max_output_queues > (unsigned)num_workers) {
+			pktout_param.op_mode = ODP_PKTIO_OP_MT_UNSAFE;
+			num_output_q = num_workers + 1;
+		} else {
+			pktout_param.op_mode = ODP_PKTIO_OP_MT;
+			num_output_q = 1;
+		}
+	} else if (capa.max_output_queues > 1) {
 		pktout_param.op_mode    = ODP_PKTIO_OP_MT_UNSAFE;
 		num_output_q = 2;
 	} else {
@@ -1090,7 +1757,8 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	if (odp_pktin_queue(pktio, &pktin, 1) != 1) {
+	if (odp_pktin_queue(pktio, pktin, pktin_param.num_queues) !=
+	    (int)pktin_param.num_queues) {
 		OFP_ERR("Error: too few pktin queues for %s",
 			gbl_args->appl.if_name);
 		exit(EXIT_FAILURE);
@@ -1102,7 +1770,7 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	thr_args.pktin = pktin;
+	thr_args.pktin = pktin[0];
 
 	/* Start CLI */
 	ofp_start_cli_thread(instance, app_init_params.linux_core_id,
@@ -1120,6 +1788,16 @@ int main(int argc, char *argv[])
 			OFP_ERR("Error: failed to setup server\n");
 			exit(EXIT_FAILURE);
 		}
+		if (gbl_args->appl.multi) {
+			int on = 1;
+
+			/* Multi-connection workers poll for new connections */
+			if (ofp_ioctl(gbl_args->server_fd, OFP_FIONBIO, &on)) {
+				OFP_ERR("Error: failed to set server socket "
+					"non-blocking\n");
+				exit(EXIT_FAILURE);
+			}
+		}
 	} else {
 		if (setup_client(gbl_args->appl.daddr, gbl_args->appl.dport)) {
 			OFP_ERR("Error: failed to setup client\n");
@@ -1127,6 +1805,27 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (gbl_args->appl.multi) {
+		for (i = 0; i < num_workers; i++) {
+			thread_args_t *args = &gbl_args->thread[i];
+
+			args->pktin = pktin[i % pktin_param.num_queues];
+			args->id = i;
+			thr_params.start =
+				(gbl_args->appl.mode == MODE_SERVER) ?
+				run_server_multi : run_client_multi;
+			thr_params.arg = args;
+			thr_params.thr_type = ODP_THREAD_WORKER;
+			odp_cpumask_zero(&cpu_mask);
+			odp_cpumask_set(&cpu_mask, next_worker + i);
+			odph_thread_common_param_init(&thr_common_param);
+			thr_common_param.cpumask = &cpu_mask;
+			odph_thread_create(&thread_tbl[i], &thr_common_param,
+					   &thr_params, 1);
+		}
+		goto stats;
+	}
+
 	/*
 	 * We don't need a second thread iff we are a single thread
 	 * client.
@@ -1166,6 +1865,7 @@ int main(int argc, char *argv[])
 	thr_common_param.cpumask = &cpu_mask;
 	odph_thread_create(&thread_tbl[next_worker-1], &thr_common_param, &thr_params, 1);
 
+stats:
 	print_global_stats();
 
 	odph_thread_join(thread_tbl, num_workers);
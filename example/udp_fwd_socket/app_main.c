@@ -29,6 +29,8 @@ typedef struct {
 	char *cli_file;
 	char *laddr;
 	char *raddr;
+	enum udp_fwd_path path;	/**< Forwarding path */
+	int interval;		/**< Statistics print interval in seconds */
 } appl_args_t;
 
 struct pktio_thr_arg {
@@ -128,6 +130,47 @@ static int event_dispatcher(void *arg)
 	return 0;
 }
 
+/**
+ * Print forwarding rates every interval seconds
+ */
+static void print_stats(int interval)
+{
+	struct udp_fwd_stats cur, prev;
+	odp_time_t ts, ts_prev;
+	int i;
+
+	memset(&prev, 0, sizeof(prev));
+	ts_prev = odp_time_local();
+
+	while (1) {
+		double sec;
+
+		sleep(interval);
+
+		memset(&cur, 0, sizeof(cur));
+		for (i = 0; i < ODP_THREAD_COUNT_MAX; i++) {
+			cur.rx_pkts += udp_fwd_stats[i].rx_pkts;
+			cur.rx_bytes += udp_fwd_stats[i].rx_bytes;
+			cur.tx_pkts += udp_fwd_stats[i].tx_pkts;
+			cur.tx_errors += udp_fwd_stats[i].tx_errors;
+		}
+		ts = odp_time_local();
+		sec = (double)odp_time_to_ns(odp_time_diff(ts, ts_prev)) /
+			ODP_TIME_SEC_IN_NS;
+
+		printf("RX %.0f pps %.1f Mbps, forwarded %.0f pps, "
+		       "errors %" PRIu64 "\n",
+		       (cur.rx_pkts - prev.rx_pkts) / sec,
+		       (cur.rx_bytes - prev.rx_bytes) * 8 / sec / 1000000,
+		       (cur.tx_pkts - prev.tx_pkts) / sec,
+		       cur.tx_errors - prev.tx_errors);
+		fflush(NULL);
+
+		prev = cur;
+		ts_prev = ts;
+	}
+}
+
 /** main() Application entry point
  *
  * @param argc int
@@ -288,7 +331,12 @@ int main(int argc, char *argv[])
 		params.cli_file);
 	sleep(1);
 
-	udp_fwd_cfg(params.sock_count, params.laddr, params.raddr);
+	if (udp_fwd_cfg(params.sock_count, params.laddr, params.raddr,
+			params.path))
+		exit(EXIT_FAILURE);
+
+	/* Workers never return */
+	print_stats(params.interval);
 
 	odph_thread_join(thread_tbl, num_workers);
 
@@ -322,13 +370,17 @@ static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
 			NULL, 'r'},/* return 'r' */
 		{"local sockets", required_argument,
 			NULL, 's'},/* return 's' */
+		{"path", required_argument, NULL, 'p'},
+		{"interval", required_argument, NULL, 'I'},
 		{NULL, 0, NULL, 0}
 	};
 
 	memset(appl_args, 0, sizeof(*appl_args));
+	appl_args->path = UDP_FWD_ZEROCOPY;
+	appl_args->interval = 1;
 
 	while (1) {
-		opt = getopt_long(argc, argv, "+c:i:hf:l:r:s:",
+		opt = getopt_long(argc, argv, "+c:i:hf:l:r:s:p:I:",
 				  longopts, &long_index);
 
 		if (opt == -1)
@@ -440,6 +492,23 @@ static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
 			}
 			appl_args->sock_count = atoi(optarg);
 			break;
+		case 'p':
+			if (!strcmp(optarg, "zerocopy")) {
+				appl_args->path = UDP_FWD_ZEROCOPY;
+			} else if (!strcmp(optarg, "socket")) {
+				appl_args->path = UDP_FWD_SOCKET;
+			} else {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'I':
+			appl_args->interval = atoi(optarg);
+			if (appl_args->interval < 1) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
 
 		default:
 			break;
@@ -504,6 +573,9 @@ static void usage(char *progname)
 		   "\n"
 		   "Optional OPTIONS\n"
 		   "  -c, --count <number> Core count.\n"
+		   "  -p, --path <path>    Forwarding path: zerocopy (ofp_udp_pkt_sendto(),\n"
+		   "                       default) or socket (ofp_sendto()).\n"
+		   "  -I, --interval <sec> Statistics print interval. Default: 1.\n"
 		   "  -h, --help           Display help and exit.\n"
 		   "\n", NO_PATH(progname), NO_PATH(progname)
 		);
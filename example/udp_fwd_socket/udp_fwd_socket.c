@@ -20,7 +20,11 @@
 
 #define TEST_LPORT 5001
 #define TEST_RPORT 5000
+/** Largest payload forwarded through the socket path */
+#define FWD_BUF_LEN 9216
 struct ofp_sockaddr_in *raddr = NULL;
+struct udp_fwd_stats udp_fwd_stats[ODP_THREAD_COUNT_MAX];
+static enum udp_fwd_path fwd_path;
 static void notify(union ofp_sigval sv);
 
 static int create_local_sock(int lport, char *laddr_txt)
@@ -57,7 +61,7 @@ static int create_local_sock(int lport, char *laddr_txt)
 	ss.sockfd = sd;
 	ss.event = OFP_EVENT_INVALID;
 	ss.pkt = ODP_PACKET_INVALID;
-	ev.ofp_sigev_notify = OFP_SIGEV_HOOK;
+	ev.ofp_sigev_notify = OFP_SIGEV_BATCH;
 	ev.ofp_sigev_notify_function = notify;
 	ev.ofp_sigev_value.sival_ptr = &ss;
 	if (ofp_socket_sigevent(&ev) == -1) {
@@ -70,10 +74,13 @@ static int create_local_sock(int lport, char *laddr_txt)
 	return 0;
 }
 
-int udp_fwd_cfg(int sock_count, char *laddr_txt, char *raddr_txt)
+int udp_fwd_cfg(int sock_count, char *laddr_txt, char *raddr_txt,
+		enum udp_fwd_path path)
 {
 	int port_idx;
 
+	fwd_path = path;
+
 	for (port_idx = 0; port_idx < sock_count; port_idx++) {
 		int ret = create_local_sock(TEST_LPORT + port_idx, laddr_txt);
 		if (ret == -1)
@@ -98,18 +105,52 @@ int udp_fwd_cfg(int sock_count, char *laddr_txt, char *raddr_txt)
 
 
 
+static void fwd_pkt(struct udp_fwd_stats *st, int s, odp_packet_t pkt)
+{
+	uint8_t *p;
+	int n, ret;
+
+	p = ofp_udp_packet_parse(pkt, &n, NULL, NULL);
+
+	st->rx_pkts++;
+	st->rx_bytes += n;
+
+	if (fwd_path == UDP_FWD_ZEROCOPY) {
+		ret = ofp_udp_pkt_sendto(s, pkt,
+					 (struct ofp_sockaddr *)raddr,
+					 sizeof(*raddr));
+	} else {
+		uint8_t buf[FWD_BUF_LEN];
+
+		if (n > FWD_BUF_LEN)
+			n = FWD_BUF_LEN;
+		memcpy(buf, p, n);
+		ret = ofp_sendto(s, buf, n, 0, (struct ofp_sockaddr *)raddr,
+				 sizeof(*raddr));
+		odp_packet_free(pkt);
+	}
+
+	if (ret < 0)
+		st->tx_errors++;
+	else
+		st->tx_pkts++;
+}
+
 static void notify(union ofp_sigval sv)
 {
 	struct ofp_sock_sigval *ss = sv.sival_ptr;
+	struct udp_fwd_stats *st = &udp_fwd_stats[odp_thread_id()];
 	int s = ss->sockfd;
+	int i;
+
 	if (ss->event != OFP_EVENT_RECV)
 		return;
 
-	ofp_udp_packet_parse(ss->pkt, NULL, NULL, NULL);
-
-	ofp_udp_pkt_sendto(s,
-			ss->pkt, (struct ofp_sockaddr *)raddr, sizeof(*raddr));
-
-	/* mark packet as consumed*/
-	ss->pkt = ODP_PACKET_INVALID;
+	/* All packets received on the socket in the burst */
+	for (i = 0; i < ss->num; i++) {
+		fwd_pkt(st, s, ss->pkts[i]);
+		/* mark packet as consumed*/
+		ss->pkts[i] = ODP_PACKET_INVALID;
+	}
 }
+
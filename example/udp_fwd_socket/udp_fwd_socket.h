@@ -8,6 +8,30 @@
 #ifndef _UDP_FWD_H_
 #define _UDP_FWD_H_
 
-int udp_fwd_cfg(int sock_count, char *laddr_txt, char *raddr_txt);
+#include <odp_api.h>
+
+/**
+ * Forwarding path
+ */
+enum udp_fwd_path {
+	UDP_FWD_ZEROCOPY = 0,	/**< ofp_udp_pkt_sendto() of the received packet */
+	UDP_FWD_SOCKET		/**< ofp_sendto() of a copy of the payload */
+};
+
+/**
+ * Counters of one ODP thread
+ */
+struct udp_fwd_stats {
+	uint64_t rx_pkts;
+	uint64_t rx_bytes;
+	uint64_t tx_pkts;
+	uint64_t tx_errors;
+} ODP_ALIGNED_CACHE;
+
+/** Indexed by odp_thread_id() */
+extern struct udp_fwd_stats udp_fwd_stats[ODP_THREAD_COUNT_MAX];
+
+int udp_fwd_cfg(int sock_count, char *laddr_txt, char *raddr_txt,
+		enum udp_fwd_path path);
 
 #endif /*_UDP_FWD_H_*/
@@ -8,14 +8,20 @@
 #include <getopt.h>
 #include <string.h>
 #include <inttypes.h>
+#include <unistd.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
 
 #include "ofp.h"
 
 #include "udp_server.h"
+#include "udp_client.h"
 
 #define MAX_WORKERS		32
 
+/** Default UDP payload size of the load generator */
+#define DEF_PKT_SIZE		64
+
 /**
  * Parsed command line application arguments
  */
@@ -24,6 +30,14 @@ typedef struct {
 	int if_count;		/**< Number of interfaces to be used */
 	char **if_names;	/**< Array of pointers to interface names */
 	char *cli_file;
+	enum udp_path path;	/**< Send path */
+	char *daddr;		/**< Echo server address in client mode */
+	int size;		/**< UDP payload size */
+	int flows;		/**< Number of flows */
+	uint64_t rate;		/**< Datagrams per second per sender */
+	int senders;		/**< Number of sender threads */
+	int interval;		/**< Statistics print interval in seconds */
+	int duration;		/**< Client run time in seconds, 0: no limit */
 } appl_args_t;
 
 /* helper funcs */
@@ -38,6 +52,119 @@ ofp_global_param_t app_init_params; /**< global OFP init parms */
 				strrchr((file_name), '/') + 1 : (file_name))
 
 
+static uint64_t hist_value(int idx)
+{
+	int e;
+
+	if (idx < UDP_HIST_SUB)
+		return idx;
+	e = (idx >> UDP_HIST_SUB_BITS) + UDP_HIST_SUB_BITS - 1;
+	return (uint64_t)(UDP_HIST_SUB + (idx & (UDP_HIST_SUB - 1))) <<
+		(e - UDP_HIST_SUB_BITS);
+}
+
+static uint64_t hist_percentile(const uint64_t *hist, uint64_t total,
+				double pct)
+{
+	uint64_t target, sum = 0;
+	int i;
+
+	target = (uint64_t)(total * pct / 100);
+	if (target >= total)
+		target = total - 1;
+
+	for (i = 0; i < UDP_HIST_BUCKETS; i++) {
+		sum += hist[i];
+		if (sum > target)
+			return hist_value(i);
+	}
+	return hist_value(UDP_HIST_BUCKETS - 1);
+}
+
+static void sum_stats(struct udp_stats *sum)
+{
+	int i, j;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for (i = 0; i < ODP_THREAD_COUNT_MAX; i++) {
+		struct udp_stats *st = &udp_stats[i];
+
+		sum->rx_pkts += st->rx_pkts;
+		sum->rx_bytes += st->rx_bytes;
+		sum->tx_pkts += st->tx_pkts;
+		sum->tx_bytes += st->tx_bytes;
+		sum->tx_errors += st->tx_errors;
+		for (j = 0; j < UDP_HIST_BUCKETS; j++)
+			sum->rtt[j] += st->rtt[j];
+	}
+}
+
+static void print_rtt(const uint64_t *hist)
+{
+	uint64_t total = 0;
+	int i;
+
+	for (i = 0; i < UDP_HIST_BUCKETS; i++)
+		total += hist[i];
+	if (total == 0)
+		return;
+
+	printf(", RTT p50 %.1f us p99 %.1f us p999 %.1f us",
+	       (double)hist_percentile(hist, total, 50) / 1000,
+	       (double)hist_percentile(hist, total, 99) / 1000,
+	       (double)hist_percentile(hist, total, 99.9) / 1000);
+}
+
+/**
+ * Print packet rates every interval seconds, until duration seconds
+ * have passed if duration is not 0
+ */
+static void print_stats(int interval, int duration)
+{
+	static struct udp_stats cur, prev, diff;
+	odp_time_t start, ts, ts_prev;
+	int i;
+
+	start = odp_time_local();
+	ts_prev = start;
+
+	while (!duration ||
+	       odp_time_to_ns(odp_time_diff(odp_time_local(), start)) <
+	       (uint64_t)duration * ODP_TIME_SEC_IN_NS) {
+		double sec;
+
+		sleep(interval);
+
+		ts = odp_time_local();
+		sum_stats(&cur);
+		sec = (double)odp_time_to_ns(odp_time_diff(ts, ts_prev)) /
+			ODP_TIME_SEC_IN_NS;
+
+		for (i = 0; i < UDP_HIST_BUCKETS; i++)
+			diff.rtt[i] = cur.rtt[i] - prev.rtt[i];
+
+		printf("RX %.0f pps %.1f Mbps, TX %.0f pps %.1f Mbps, "
+		       "TX errors %" PRIu64,
+		       (cur.rx_pkts - prev.rx_pkts) / sec,
+		       (cur.rx_bytes - prev.rx_bytes) * 8 / sec / 1000000,
+		       (cur.tx_pkts - prev.tx_pkts) / sec,
+		       (cur.tx_bytes - prev.tx_bytes) * 8 / sec / 1000000,
+		       cur.tx_errors - prev.tx_errors);
+		print_rtt(diff.rtt);
+		printf("\n");
+		fflush(NULL);
+
+		prev = cur;
+		ts_prev = ts;
+	}
+
+	printf("\nTotal RX %" PRIu64 " packets, TX %" PRIu64 " packets, "
+	       "TX errors %" PRIu64, cur.rx_pkts, cur.tx_pkts, cur.tx_errors);
+	print_rtt(cur.rtt);
+	printf("\n");
+}
+
 /** local hook
  *
  * @param pkt odp_packet_t
@@ -65,12 +192,12 @@ static enum ofp_return_code fastpath_local_hook(odp_packet_t pkt, void *arg)
 
 int main(int argc, char *argv[])
 {
-	odph_thread_t thread_tbl[MAX_WORKERS];
+	odph_thread_t thread_tbl[MAX_WORKERS], sender_tbl[MAX_WORKERS];
 	appl_args_t params;
-	int core_count, num_workers;
-	odp_cpumask_t cpumask;
+	int core_count, num_workers, num_senders = 0, num_cpus, shared, cpu, i;
+	odp_cpumask_t cpumask, all_cpumask, sender_cpumask;
 	char cpumaskstr[64];
-	odph_thread_param_t thr_params;
+	odph_thread_param_t thr_params[MAX_WORKERS];
 	odph_thread_common_param_t thr_common_param;
 	odp_instance_t instance;
 
@@ -112,12 +239,45 @@ int main(int argc, char *argv[])
 	if (core_count > 1)
 		num_workers--;
 
-	num_workers = odp_cpumask_default_worker(&cpumask, num_workers);
+	if (params.daddr) {
+		/* Senders take worker CPUs from the dispatchers */
+		num_senders = params.senders;
+		if (num_workers + num_senders > core_count - 1)
+			num_workers = core_count - 1 - num_senders;
+		if (num_workers < 1)
+			num_workers = 1;
+	}
+
+	/*
+	 * Dispatchers run on the first worker CPUs and senders on the rest.
+	 * If there are not enough CPUs, both share all of them.
+	 */
+	num_cpus = odp_cpumask_default_worker(&all_cpumask,
+					      num_workers + num_senders);
+	shared = num_cpus <= num_senders;
+	odp_cpumask_zero(&cpumask);
+	odp_cpumask_zero(&sender_cpumask);
+	for (cpu = odp_cpumask_first(&all_cpumask), i = 0; cpu >= 0;
+	     cpu = odp_cpumask_next(&all_cpumask, cpu), i++) {
+		if (shared || i < num_cpus - num_senders)
+			odp_cpumask_set(&cpumask, cpu);
+		if (shared || i >= num_cpus - num_senders)
+			odp_cpumask_set(&sender_cpumask, cpu);
+	}
+	num_workers = odp_cpumask_count(&cpumask);
+	if (num_senders > odp_cpumask_count(&sender_cpumask))
+		num_senders = odp_cpumask_count(&sender_cpumask);
 	odp_cpumask_to_str(&cpumask, cpumaskstr, sizeof(cpumaskstr));
 
 	printf("Num worker threads: %i\n", num_workers);
 	printf("first CPU:          %i\n", odp_cpumask_first(&cpumask));
 	printf("cpu mask:           %s\n", cpumaskstr);
+	if (num_senders) {
+		odp_cpumask_to_str(&sender_cpumask, cpumaskstr,
+				   sizeof(cpumaskstr));
+		printf("Num sender threads: %i\n", num_senders);
+		printf("sender cpu mask:    %s\n", cpumaskstr);
+	}
 
 	app_init_params.if_count = params.if_count;
 	app_init_params.if_names = params.if_names;
@@ -129,24 +289,59 @@ int main(int argc, char *argv[])
 
 	memset(thread_tbl, 0, sizeof(thread_tbl));
 	/* Start dataplane dispatcher worker threads */
+	for (i = 0; i < num_workers; i++) {
+		odph_thread_param_init(&thr_params[i]);
+		thr_params[i].start = default_event_dispatcher;
+		thr_params[i].arg = ofp_eth_vlan_processing;
+		thr_params[i].thr_type = ODP_THREAD_WORKER;
+	}
 	odph_thread_common_param_init(&thr_common_param);
-	odph_thread_param_init(&thr_params);
 	thr_common_param.cpumask = &cpumask;
-	thr_params.start = default_event_dispatcher;
-	thr_params.arg = ofp_eth_vlan_processing;
-	thr_params.thr_type = ODP_THREAD_WORKER;
 
 	odph_thread_create(thread_tbl,
 			       &thr_common_param,
-			       &thr_params,
-				   1);
+			       thr_params,
+			       num_workers);
 
 	/* other app code here.*/
 	/* Start CLI */
 	ofp_start_cli_thread(instance, app_init_params.linux_core_id, params.cli_file);
 
-	/* udp echo server */
-	ofp_start_udpserver_thread(instance, app_init_params.linux_core_id);
+	if (params.daddr) {
+		/* udp load generator */
+		struct udp_client_param client;
+		struct in_addr daddr;
+
+		if (inet_aton(params.daddr, &daddr) == 0) {
+			OFP_ERR("Error: invalid address: %s\n", params.daddr);
+			exit(EXIT_FAILURE);
+		}
+
+		/* Wait for the interface configuration of the CLI file */
+		sleep(1);
+
+		client.daddr = daddr.s_addr;
+		client.path = params.path;
+		client.size = params.size;
+		client.flows = params.flows;
+		client.rate = params.rate;
+		client.senders = num_senders;
+		if (udp_client_start(instance, &sender_cpumask, &client,
+				     sender_tbl))
+			exit(EXIT_FAILURE);
+
+		print_stats(params.interval, params.duration);
+
+		udp_client_stop(sender_tbl, num_senders);
+		ofp_stop_processing();
+	} else {
+		/* udp echo server */
+		ofp_start_udpserver_thread(instance,
+					   app_init_params.linux_core_id,
+					   params.path);
+
+		print_stats(params.interval, 0);
+	}
 
 	odph_thread_join(thread_tbl, num_workers);
 	printf("End Main()\n");
@@ -174,13 +369,26 @@ static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
 		{"help", no_argument, NULL, 'h'},		/* return 'h' */
 		{"cli-file", required_argument,
 			NULL, 'f'},/* return 'f' */
+		{"path", required_argument, NULL, 'p'},
+		{"client", required_argument, NULL, 'C'},
+		{"size", required_argument, NULL, 's'},
+		{"flows", required_argument, NULL, 'F'},
+		{"rate", required_argument, NULL, 'R'},
+		{"senders", required_argument, NULL, 'w'},
+		{"interval", required_argument, NULL, 'I'},
+		{"duration", required_argument, NULL, 'd'},
 		{NULL, 0, NULL, 0}
 	};
 
 	memset(appl_args, 0, sizeof(*appl_args));
+	appl_args->path = UDP_PATH_ZEROCOPY;
+	appl_args->size = DEF_PKT_SIZE;
+	appl_args->flows = 1;
+	appl_args->senders = 1;
+	appl_args->interval = 1;
 
 	while (1) {
-		opt = getopt_long(argc, argv, "+c:i:hf:",
+		opt = getopt_long(argc, argv, "+c:i:hf:p:C:s:F:R:w:I:d:",
 				  longopts, &long_index);
 
 		if (opt == -1)
@@ -255,12 +463,51 @@ static void parse_args(int argc, char *argv[], appl_args_t *appl_args)
 			strcpy(appl_args->cli_file, optarg);
 			break;
 
+		case 'p':
+			if (!strcmp(optarg, "zerocopy")) {
+				appl_args->path = UDP_PATH_ZEROCOPY;
+			} else if (!strcmp(optarg, "socket")) {
+				appl_args->path = UDP_PATH_SOCKET;
+			} else {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'C':
+			appl_args->daddr = strdup(optarg);
+			if (appl_args->daddr == NULL) {
+				usage(argv[0]);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 's':
+			appl_args->size = atoi(optarg);
+			break;
+		case 'F':
+			appl_args->flows = atoi(optarg);
+			break;
+		case 'R':
+			appl_args->rate = strtoull(optarg, NULL, 0);
+			break;
+		case 'w':
+			appl_args->senders = atoi(optarg);
+			break;
+		case 'I':
+			appl_args->interval = atoi(optarg);
+			break;
+		case 'd':
+			appl_args->duration = atoi(optarg);
+			break;
+
 		default:
 			break;
 		}
 	}
 
-	if (appl_args->if_count == 0) {
+	if (appl_args->if_count == 0 || appl_args->interval < 1 ||
+	    appl_args->duration < 0 || appl_args->senders < 1 ||
+	    appl_args->senders > MAX_WORKERS / 2 ||
+	    appl_args->flows < appl_args->senders) {
 		usage(argv[0]);
 		exit(EXIT_FAILURE);
 	}
@@ -315,7 +562,19 @@ static void usage(char *progname)
 		   "\n"
 		   "Optional OPTIONS\n"
 		   "  -c, --count <number> Core count.\n"
+		   "  -f, --cli-file <file> OFP CLI file.\n"
+		   "  -p, --path <path>    Send path: zerocopy (ofp_udp_pkt_sendto(), default)\n"
+		   "                       or socket (ofp_sendto()).\n"
+		   "  -C, --client <addr>  Send datagrams to the echo server at addr and\n"
+		   "                       measure the round trip time of the echoes.\n"
+		   "  -s, --size <bytes>   Client UDP payload size. Default: %d.\n"
+		   "  -F, --flows <number> Client flows, i.e. source ports. Default: 1.\n"
+		   "  -R, --rate <pps>     Datagrams per second per sender, 0 for no\n"
+		   "                       limit. Default: 0.\n"
+		   "  -w, --senders <number> Client sender threads. Default: 1.\n"
+		   "  -I, --interval <sec> Statistics print interval. Default: 1.\n"
+		   "  -d, --duration <sec> Client run time, 0 for no limit. Default: 0.\n"
 		   "  -h, --help           Display help and exit.\n"
-		   "\n", NO_PATH(progname), NO_PATH(progname)
+		   "\n", NO_PATH(progname), NO_PATH(progname), DEF_PKT_SIZE
 		);
 }
@@ -0,0 +1,252 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ofp.h"
+
+#include "udp_client.h"
+
+#define MAX_SENDERS 32
+#define MAX_FLOWS 1024
+
+/** Header of generated payloads */
+struct udp_client_hdr {
+	uint64_t ts_ns;		/**< Send time, ODP global time */
+	uint32_t flow;
+	uint32_t seq;
+};
+
+struct sender_arg {
+	int id;
+	struct ofp_sock_sigval ss[MAX_FLOWS];
+};
+
+static struct udp_client_param client;
+static struct sender_arg sender_arg[MAX_SENDERS];
+static volatile int senders_exit;
+
+/*
+ * Echo replies are received here, in the context of the dispatcher
+ * thread that processed the packet.
+ */
+static void notify(union ofp_sigval sv)
+{
+	struct ofp_sock_sigval *ss = sv.sival_ptr;
+	struct udp_stats *st = &udp_stats[odp_thread_id()];
+	struct udp_client_hdr hdr;
+	uint8_t *p;
+	int n;
+
+	if (ss->event != OFP_EVENT_RECV)
+		return;
+
+	p = ofp_udp_packet_parse(ss->pkt, &n, NULL, NULL);
+
+	st->rx_pkts++;
+	st->rx_bytes += n;
+
+	if (n >= UDP_ECHO_PREFIX_LEN + (int)sizeof(hdr) &&
+	    !memcmp(p, UDP_ECHO_PREFIX, UDP_ECHO_PREFIX_LEN)) {
+		uint64_t now = odp_time_to_ns(odp_time_global());
+
+		memcpy(&hdr, p + UDP_ECHO_PREFIX_LEN, sizeof(hdr));
+		if (now >= hdr.ts_ns)
+			st->rtt[udp_hist_index(now - hdr.ts_ns)]++;
+	}
+
+	odp_packet_free(ss->pkt);
+	ss->pkt = ODP_PACKET_INVALID;
+}
+
+static int open_flow(int flow, struct ofp_sock_sigval *ss)
+{
+	struct ofp_sockaddr_in addr;
+	struct ofp_sigevent ev;
+	int sd;
+
+	sd = ofp_socket(OFP_AF_INET, OFP_SOCK_DGRAM, OFP_IPPROTO_UDP);
+	if (sd < 0) {
+		OFP_ERR("ofp_socket failed, err='%s'",
+			ofp_strerror(ofp_errno));
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = OFP_AF_INET;
+	addr.sin_port = odp_cpu_to_be_16(UDP_CLIENT_PORT + flow);
+	addr.sin_addr.s_addr = OFP_INADDR_ANY;
+	addr.sin_len = sizeof(addr);
+
+	if (ofp_bind(sd, (struct ofp_sockaddr *)&addr, sizeof(addr)) < 0) {
+		OFP_ERR("ofp_bind failed, port=%d, err='%s'",
+			UDP_CLIENT_PORT + flow, ofp_strerror(ofp_errno));
+		ofp_close(sd);
+		return -1;
+	}
+
+	ss->sockfd = sd;
+	ss->event = 0;
+	ss->pkt = ODP_PACKET_INVALID;
+	ev.ofp_sigev_notify = OFP_SIGEV_HOOK;
+	ev.ofp_sigev_notify_function = notify;
+	ev.ofp_sigev_value.sival_ptr = ss;
+	if (ofp_socket_sigevent(&ev) == -1) {
+		OFP_ERR("ofp_socket_sigevent failed, err='%s'",
+			ofp_strerror(ofp_errno));
+		ofp_close(sd);
+		return -1;
+	}
+
+	return sd;
+}
+
+static int send_one(int sd, odp_pool_t pool, uint8_t *buf,
+		    const struct ofp_sockaddr_in *dst)
+{
+	odp_packet_t pkt;
+
+	if (client.path == UDP_PATH_SOCKET)
+		return ofp_sendto(sd, buf, client.size, 0,
+				  (const struct ofp_sockaddr *)dst,
+				  sizeof(*dst)) < 0 ? -1 : 0;
+
+	pkt = odp_packet_alloc(pool, client.size);
+	if (pkt == ODP_PACKET_INVALID)
+		return -1;
+	memcpy(odp_packet_data(pkt), buf, client.size);
+
+	return ofp_udp_pkt_sendto(sd, pkt, (const struct ofp_sockaddr *)dst,
+				  sizeof(*dst)) < 0 ? -1 : 0;
+}
+
+static int sender(void *arg)
+{
+	struct sender_arg *sa = arg;
+	struct udp_stats *st;
+	struct ofp_sockaddr_in dst;
+	struct udp_client_hdr hdr;
+	uint8_t *buf;
+	odp_pool_t pool;
+	uint64_t period = 0, next = 0;
+	uint32_t seq = 0;
+	int num = 0, i, flow;
+
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed.\n");
+		return -1;
+	}
+	st = &udp_stats[odp_thread_id()];
+
+	printf("UDP sender %d starting on CPU: %i\n", sa->id, odp_cpu_id());
+
+	pool = odp_pool_lookup(SHM_PKT_POOL_NAME);
+	buf = calloc(1, client.size);
+	if (pool == ODP_POOL_INVALID || buf == NULL) {
+		OFP_ERR("Error: UDP sender init failed.\n");
+		free(buf);
+		return -1;
+	}
+
+	/* Flows are divided between senders round robin */
+	for (flow = sa->id; flow < client.flows; flow += client.senders) {
+		if (open_flow(flow, &sa->ss[num]) < 0)
+			break;
+		num++;
+	}
+
+	memset(&dst, 0, sizeof(dst));
+	dst.sin_family = OFP_AF_INET;
+	dst.sin_port = odp_cpu_to_be_16(UDP_ECHO_PORT);
+	dst.sin_addr.s_addr = client.daddr;
+	dst.sin_len = sizeof(dst);
+
+	if (client.rate)
+		period = ODP_TIME_SEC_IN_NS / client.rate;
+
+	while (!senders_exit && num) {
+		for (i = 0; i < num; i++) {
+			uint64_t now = odp_time_to_ns(odp_time_global());
+
+			if (period) {
+				if (now < next)
+					continue;
+				next = (next + period > now) ?
+					next + period : now + period;
+			}
+
+			hdr.ts_ns = now;
+			hdr.flow = sa->id + i * client.senders;
+			hdr.seq = seq++;
+			memcpy(buf, &hdr, sizeof(hdr));
+
+			if (send_one(sa->ss[i].sockfd, pool, buf, &dst)) {
+				st->tx_errors++;
+			} else {
+				st->tx_pkts++;
+				st->tx_bytes += client.size;
+			}
+		}
+		/* NOP unless OFP_PKT_TX_BURST_SIZE > 1 */
+		ofp_send_pending_pkt();
+	}
+
+	for (i = 0; i < num; i++)
+		ofp_close(sa->ss[i].sockfd);
+	free(buf);
+
+	if (ofp_term_local())
+		OFP_ERR("Error: ofp_term_local failed\n");
+
+	return 0;
+}
+
+int udp_client_start(odp_instance_t instance, const odp_cpumask_t *cpumask,
+		     const struct udp_client_param *param,
+		     odph_thread_t thread[])
+{
+	odph_thread_param_t thr_params[MAX_SENDERS];
+	odph_thread_common_param_t thr_common_param;
+	int i;
+
+	if (param->senders < 1 || param->senders > MAX_SENDERS ||
+	    param->flows < param->senders ||
+	    param->flows > MAX_FLOWS * param->senders ||
+	    param->size < (int)sizeof(struct udp_client_hdr)) {
+		OFP_ERR("Error: invalid UDP client parameters.\n");
+		return -1;
+	}
+
+	client = *param;
+	senders_exit = 0;
+
+	for (i = 0; i < param->senders; i++) {
+		sender_arg[i].id = i;
+		odph_thread_param_init(&thr_params[i]);
+		thr_params[i].start = sender;
+		thr_params[i].arg = &sender_arg[i];
+		thr_params[i].thr_type = ODP_THREAD_WORKER;
+		thr_params[i]._deprecated_instance = instance;
+	}
+	odph_thread_common_param_init(&thr_common_param);
+	thr_common_param.cpumask = cpumask;
+
+	if (odph_thread_create(thread, &thr_common_param, thr_params,
+			       param->senders) != param->senders) {
+		OFP_ERR("Error: failed to start UDP senders.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+void udp_client_stop(odph_thread_t thread[], int num)
+{
+	senders_exit = 1;
+	odph_thread_join(thread, num);
+}
@@ -0,0 +1,42 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef _UDP_CLIENT_H_
+#define _UDP_CLIENT_H_
+
+#include <odp_api.h>
+#include <odp/helper/odph_api.h>
+
+#include "udp_server.h"
+
+/** Source port of the first flow */
+#define UDP_CLIENT_PORT 20000
+
+/**
+ * Load generator parameters
+ */
+struct udp_client_param {
+	uint32_t daddr;		/**< Echo server address, network order */
+	enum udp_path path;	/**< Send path */
+	int size;		/**< UDP payload size */
+	int flows;		/**< Number of flows, i.e. source ports */
+	uint64_t rate;		/**< Datagrams per second per sender, 0: no limit */
+	int senders;		/**< Number of sender threads */
+};
+
+/**
+ * Start senders on the CPUs of cpumask. Each sender sends to the echo
+ * server on its share of the flows. Echo replies are received by the
+ * dispatcher threads, which record the RTT in udp_stats[].
+ */
+int udp_client_start(odp_instance_t instance, const odp_cpumask_t *cpumask,
+		     const struct udp_client_param *param,
+		     odph_thread_t thread[]);
+
+/** Stop the senders started by udp_client_start() */
+void udp_client_stop(odph_thread_t thread[], int num);
+
+#endif
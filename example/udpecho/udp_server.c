@@ -19,9 +19,17 @@
 #define INVALID_SOCKET  -1
 #define SOCKET_ERROR    -1
 
+/** Largest payload echoed through the socket path */
+#define ECHO_BUF_LEN 9216
+
+struct udp_stats udp_stats[ODP_THREAD_COUNT_MAX];
+
+static enum udp_path echo_path;
+
 static void notify(union ofp_sigval sv)
 {
 	struct ofp_sock_sigval *ss = sv.sival_ptr;
+	struct udp_stats *st = &udp_stats[odp_thread_id()];
 	int s = ss->sockfd;
 	int event = ss->event;
 	odp_packet_t pkt = ss->pkt;
@@ -48,29 +56,48 @@ static void notify(union ofp_sigval sv)
 	uint8_t *p = ofp_udp_packet_parse(pkt, &n,
 					    (struct ofp_sockaddr *)&addr,
 					    &addr_len);
-	/* Pointer and length are not used here. */
-	(void)p;
-	(void)n;
+
+	st->rx_pkts++;
+	st->rx_bytes += n;
 
 	/*
-	 * There are two alternatives to send a respond.
-	 */
-#if 1
-	/*
-	 * Reuse received packet.
-	 * Here we want to send the same payload back prepended with "ECHO:".
-	 */
-	odp_packet_push_head(pkt, 5);
-	memcpy(odp_packet_data(pkt), "ECHO:", 5);
-	ofp_udp_pkt_sendto(s, pkt, (struct ofp_sockaddr *)&addr, sizeof(addr));
-#else
-	/*
-	 * Send using usual sendto(). Remember to free the packet.
+	 * There are two alternatives to send a respond. In both the same
+	 * payload is sent back prepended with "ECHO:".
 	 */
-	ofp_sendto(s, p, r, 0,
-		     (struct ofp_sockaddr *)&addr, sizeof(addr));
-	odp_packet_free(pkt);
-#endif
+	if (echo_path == UDP_PATH_ZEROCOPY) {
+		/*
+		 * Reuse received packet.
+		 */
+		odp_packet_push_head(pkt, UDP_ECHO_PREFIX_LEN);
+		memcpy(odp_packet_data(pkt), UDP_ECHO_PREFIX,
+		       UDP_ECHO_PREFIX_LEN);
+		if (ofp_udp_pkt_sendto(s, pkt, (struct ofp_sockaddr *)&addr,
+				       sizeof(addr)) < 0) {
+			st->tx_errors++;
+		} else {
+			st->tx_pkts++;
+			st->tx_bytes += n + UDP_ECHO_PREFIX_LEN;
+		}
+	} else {
+		/*
+		 * Send using usual sendto(). Remember to free the packet.
+		 */
+		uint8_t buf[ECHO_BUF_LEN];
+
+		if (n > ECHO_BUF_LEN - UDP_ECHO_PREFIX_LEN)
+			n = ECHO_BUF_LEN - UDP_ECHO_PREFIX_LEN;
+		memcpy(buf, UDP_ECHO_PREFIX, UDP_ECHO_PREFIX_LEN);
+		memcpy(buf + UDP_ECHO_PREFIX_LEN, p, n);
+		if (ofp_sendto(s, buf, n + UDP_ECHO_PREFIX_LEN, 0,
+			       (struct ofp_sockaddr *)&addr,
+			       sizeof(addr)) < 0) {
+			st->tx_errors++;
+		} else {
+			st->tx_pkts++;
+			st->tx_bytes += n + UDP_ECHO_PREFIX_LEN;
+		}
+		odp_packet_free(pkt);
+	}
 	/*
 	 * Mark ss->pkt invalid to indicate it was released or reused by us.
 	 */
@@ -104,7 +131,7 @@ static int udpecho(void *arg)
 
 	memset(&my_addr, 0, sizeof(my_addr));
 	my_addr.sin_family = OFP_AF_INET;
-	my_addr.sin_port = odp_cpu_to_be_16(2048);
+	my_addr.sin_port = odp_cpu_to_be_16(UDP_ECHO_PORT);
 	my_addr.sin_addr.s_addr = my_ip_addr;
 	my_addr.sin_len = sizeof(my_addr);
 
@@ -136,7 +163,8 @@ static int udpecho(void *arg)
 	return 0;
 }
 
-void ofp_start_udpserver_thread(odp_instance_t instance, int core_id)
+void ofp_start_udpserver_thread(odp_instance_t instance, int core_id,
+				enum udp_path path)
 {
 	static odph_thread_t test_linux_udpserver_pthread;
 	odp_cpumask_t cpumask;
@@ -148,6 +176,7 @@ void ofp_start_udpserver_thread(odp_instance_t instance, int core_id)
 	odph_thread_common_param_init(&thr_common_param);
 	odph_thread_param_init(&thr_params);
 	thr_common_param.cpumask = &cpumask;
+	echo_path = path;
 	thr_params.start = udpecho;
 	thr_params.arg = NULL;
 	thr_params.thr_type = ODP_THREAD_CONTROL;
@@ -10,6 +10,55 @@
 
 #include <odp_api.h>
 
-void ofp_start_udpserver_thread(odp_instance_t instance, int core_id);
+#define UDP_ECHO_PORT 2048
+
+/** Prefix of the echoed payload */
+#define UDP_ECHO_PREFIX "ECHO:"
+#define UDP_ECHO_PREFIX_LEN 5
+
+/**
+ * Send path of echo replies and generated datagrams
+ */
+enum udp_path {
+	UDP_PATH_ZEROCOPY = 0,	/**< ofp_udp_pkt_sendto() of a packet */
+	UDP_PATH_SOCKET		/**< ofp_sendto() of a copy of the payload */
+};
+
+/**
+ * RTT histogram. Values below UDP_HIST_SUB ns are counted exactly, larger
+ * values in UDP_HIST_SUB buckets per power of two.
+ */
+#define UDP_HIST_SUB_BITS 4
+#define UDP_HIST_SUB (1 << UDP_HIST_SUB_BITS)
+#define UDP_HIST_BUCKETS ((64 - UDP_HIST_SUB_BITS + 1) * UDP_HIST_SUB)
+
+/**
+ * Counters of one ODP thread
+ */
+struct udp_stats {
+	uint64_t rx_pkts;
+	uint64_t rx_bytes;
+	uint64_t tx_pkts;
+	uint64_t tx_bytes;
+	uint64_t tx_errors;
+	uint64_t rtt[UDP_HIST_BUCKETS];	/**< Echo RTT in ns */
+} ODP_ALIGNED_CACHE;
+
+/** Indexed by odp_thread_id() */
+extern struct udp_stats udp_stats[ODP_THREAD_COUNT_MAX];
+
+static inline int udp_hist_index(uint64_t v)
+{
+	int e;
+
+	if (v < UDP_HIST_SUB)
+		return v;
+	e = 63 - __builtin_clzll(v);
+	return ((e - UDP_HIST_SUB_BITS + 1) << UDP_HIST_SUB_BITS) +
+		((v >> (e - UDP_HIST_SUB_BITS)) & (UDP_HIST_SUB - 1));
+}
+
+void ofp_start_udpserver_thread(odp_instance_t instance, int core_id,
+				enum udp_path path);
 
 #endif
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 #include <getopt.h>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -47,8 +48,39 @@ static int sendf(int fd, const char *fmt, ...)
 	return ret;
 }
 
+/*
+ * Return 1 if the connection is kept open after the response: HTTP/1.1
+ * without "Connection: close", or HTTP/1.0 with "Connection: keep-alive".
+ */
+static int keep_alive(const char *http)
+{
+	const char *eol = strstr(http, "\r\n");
+	const char *p;
+	int ka;
+
+	if (!eol)
+		return 0;
+	ka = eol - http >= 8 && !strncmp(eol - 8, "HTTP/1.1", 8);
+
+	for (p = eol + 2; *p && strncmp(p, "\r\n", 2); p = eol + 2) {
+		eol = strstr(p, "\r\n");
+		if (!eol)
+			break;
+		if (strncasecmp(p, "Connection:", 11))
+			continue;
+		p += 11;
+		while (*p == ' ')
+			p++;
+		if (!strncasecmp(p, "close", 5))
+			ka = 0;
+		else if (!strncasecmp(p, "keep-alive", 10))
+			ka = 1;
+	}
+	return ka;
+}
+
 /* Send one file. */
-static void get_file(int s, char *url)
+static void get_file(int s, char *url, int ka)
 {
 	int n, w;
 
@@ -92,7 +124,11 @@ static void get_file(int s, char *url)
 	FILE *f = fopen(bufo_in, "rb");
 
 	if (!f) {
-		sendf(s, "HTTP/1.0 404 NOK\r\n\r\n");
+		if (ka)
+			sendf(s, "HTTP/1.1 404 NOK\r\n"
+			      "Content-Length: 0\r\n\r\n");
+		else
+			sendf(s, "HTTP/1.0 404 NOK\r\n\r\n");
 		return;
 	}
 
@@ -100,7 +136,15 @@ static void get_file(int s, char *url)
 	/* disable push messages */
 	ofp_setsockopt(s, OFP_IPPROTO_TCP, OFP_TCP_NOPUSH, &state, sizeof(state));
 
-	sendf(s, "HTTP/1.0 200 OK\r\n");
+	if (ka) {
+		/* The length delimits the response on a persistent connection */
+		fseek(f, 0, SEEK_END);
+		sendf(s, "HTTP/1.1 200 OK\r\nContent-Length: %ld\r\n",
+		      ftell(f));
+		rewind(f);
+	} else {
+		sendf(s, "HTTP/1.0 200 OK\r\n");
+	}
 	if (mime)
 		sendf(s, "Content-Type: %s\r\n\r\n", mime);
 	else
@@ -118,7 +162,7 @@ static void get_file(int s, char *url)
 	fclose(f);
 }
 
-static int analyze_http(char *http, int s)
+static int analyze_http(char *http, int s, int ka)
 {
 	char *url;
 	char *p;
@@ -132,7 +176,7 @@ static int analyze_http(char *http, int s)
 			*p = 0;
 		else
 			return -1;
-		get_file(s, url);
+		get_file(s, url, ka);
 	} else if (!strncmp(http, "POST ", 5)) {
 		/* Post is not supported. */
 		OFP_INFO("%s", http);
@@ -147,7 +191,7 @@ static void notify(union ofp_sigval sv)
 	int s = ss->sockfd;
 	int event = ss->event;
 	odp_packet_t pkt = ss->pkt;
-	int r;
+	int r, ka;
 	char *buf, *tail;
 
 	if (event == OFP_EVENT_ACCEPT) {
@@ -188,9 +232,11 @@ static void notify(union ofp_sigval sv)
 		tail = odp_packet_push_tail(pkt, 1);
 		*tail = 0;
 
-		analyze_http(buf, s);
+		/* One request per segment, requests are not pipelined */
+		ka = keep_alive(buf);
+		analyze_http(buf, s, ka);
 
-		if (ofp_close(s) < 0)
+		if (!ka && ofp_close(s) < 0)
 			OFP_ERR("ofp_close failed fd=%d err='%s'",
 				s, ofp_strerror(ofp_errno));
 	} else if (r == 0) {
@@ -35,6 +35,7 @@ extern "C" {
 #include "ofp_portconf.h"
 #include "ofp_debug.h"
 #include "ofp_stat.h"
+#include "ofp_telemetry.h"
 #include "ofp_socket_types.h"
 #include "ofp_socket.h"
 #include "ofp_in.h"
@@ -53,8 +54,12 @@ extern "C" {
 #include "ofp_ip_var.h"
 #include "ofp_tcp.h"
 #include "ofp_epoll.h"
+#include "ofp_coroutine.h"
 #include "ofp_ipsec.h"
 #include "ofp_ipsec_init.h"
+#include "ofp_conntrack.h"
+#include "ofp_acl.h"
+#include "ofp_ipc.h"
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,122 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef __OFP_ACL_H__
+#define __OFP_ACL_H__
+
+#include <odp_api.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+/**
+ * @file
+ *
+ * @brief Access control lists of IPv4 packets
+ *
+ * An ACL is applied at a hook point, before the hooks of the point. Its
+ * rules are added and deleted one by one, and ofp_acl_commit() compiles
+ * them into a classifier that replaces the one in use at once. The
+ * first matching rule by priority decides, packets no rule matches are
+ * permitted. The number of rules of an ACL is limited by
+ * ofp_global_param_t.acl.
+ *
+ * Packet fragments after the first are matched with ports 0.
+ */
+
+/** Hook point of an ACL */
+enum ofp_acl_point {
+	OFP_ACL_LOCAL = 0,	/**< IPv4 packets to a local address, at
+				     OFP_HOOK_LOCAL */
+	OFP_ACL_FWD,		/**< IPv4 packets forwarded, at
+				     OFP_HOOK_FWD_IPv4 */
+	OFP_ACL_POINTS		/**< Number of hook points */
+};
+
+/** Action of a rule */
+enum ofp_acl_action {
+	OFP_ACL_PERMIT = 0,	/**< Continue processing */
+	OFP_ACL_DENY		/**< Drop the packet */
+};
+
+/** Any VRF */
+#define OFP_ACL_VRF_ANY (-1)
+/** Any DSCP value */
+#define OFP_ACL_DSCP_ANY 0xff
+
+/**
+ * ACL rule. Initialize with ofp_acl_rule_init() to match any packet.
+ */
+struct ofp_acl_rule {
+	/** Source prefix, network byte order, and its length */
+	uint32_t src;
+	uint8_t src_len;
+	/** Destination prefix, network byte order, and its length */
+	uint32_t dst;
+	uint8_t dst_len;
+	/** Source and destination port ranges, host byte order */
+	uint16_t sport_lo;
+	uint16_t sport_hi;
+	uint16_t dport_lo;
+	uint16_t dport_hi;
+	/** IP protocol, 0: any */
+	uint8_t proto;
+	/** DSCP value, OFP_ACL_DSCP_ANY: any */
+	uint8_t dscp;
+	/** VRF of the input interface, OFP_ACL_VRF_ANY: any */
+	int vrf;
+	/** Lower priority is matched first, rules of the same by id */
+	uint32_t priority;
+	enum ofp_acl_action action;
+};
+
+/** Initialize a rule to permit any packet, priority 0 */
+void ofp_acl_rule_init(struct ofp_acl_rule *rule);
+
+/**
+ * Add a rule to an ACL. The rule applies after ofp_acl_commit().
+ *
+ * @param point  Hook point of the ACL
+ * @param rule   Rule to add
+ *
+ * @retval Rule id >= 0 on success
+ * @retval -1 on failure
+ */
+int ofp_acl_rule_add(enum ofp_acl_point point,
+		     const struct ofp_acl_rule *rule);
+
+/**
+ * Delete a rule of an ACL. The rule applies until ofp_acl_commit().
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_acl_rule_del(enum ofp_acl_point point, int id);
+
+/**
+ * Compile the rules of an ACL and replace the classifier in use. The
+ * packets being processed finish with the previous rules.
+ *
+ * @retval 0 on success
+ * @retval -1 on failure, the previous rules stay in use
+ */
+int ofp_acl_commit(enum ofp_acl_point point);
+
+/**
+ * Packets and bytes matched by a rule since it was added
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_acl_rule_stats(enum ofp_acl_point point, int id,
+		       uint64_t *packets, uint64_t *bytes);
+
+#if __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+#endif /* __OFP_ACL_H__ */
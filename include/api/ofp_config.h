@@ -54,14 +54,25 @@
 
 /** Packet pool buffer size. */
 #define SHM_PKT_POOL_BUFFER_SIZE	1856
+/** Shortest packet segment, holds the headers OFP adds or pulls up. */
+#define OFP_PKT_POOL_SEG_LEN_MIN	256
 /** Packet pool name. */
 #define SHM_PKT_POOL_NAME "packet_pool"
+/** Packet length of the pool of short packets. */
+#define OFP_PKT_POOL_SMALL_SIZE		256
+/** Name of the pool of short packets. */
+#define SHM_PKT_POOL_SMALL_NAME "packet_pool_small"
+
+/** Name of the pool of input packet vectors. */
+#define SHM_PKT_VECTOR_POOL_NAME "packet_vector_pool"
 
 /** Maximum size of transmitted IP datagram fragments. */
 #define OFP_MTU_SIZE 1500
 
 /**Socket handle values returned are in the interval:
- * [OFP_SOCK_NUM_OFFSET, OFP_SOCK_NUM_OFFSET + OFP_NUM_SOCKETS_MAX] */
+ * [OFP_SOCK_NUM_OFFSET, OFP_SOCK_NUM_OFFSET + socket_max). The default
+ * of ofp_global_param_t.socket_max is OFP_NUM_SOCKETS_MAX, which also
+ * sets the size of ofp_fd_set. */
 #if defined(OFP_CONFIG_WEBSERVER)
 /**Maximum number of sockets. */
 # define OFP_NUM_SOCKETS_MAX 60000
@@ -92,36 +103,257 @@
 # define OFP_NUM_PCB_TCP_MAX 2048
 #endif /* OFP_CONFIGS*/
 
-/** Epoll set size */
-#define EPOLL_SET_SIZE 16
+/** Number of epoll instances a socket can be registered in */
+#define EPOLL_SOCKET_ITEMS 2
 
-/**Maximum number of fastpath interfaces used.
+/**Default number of fastpath interfaces used, see
+ * ofp_global_param_t.if_max.
  * For each fastpath interface a PKTIO in opened by OFP.*/
 #define OFP_FP_INTERFACE_MAX 8
+/**Highest possible ofp_global_param_t.if_max. */
+#define OFP_FP_INTERFACE_LIMIT 248
 
 /* Maximum number of VLANs. */
 #define OFP_NUM_VLAN 256
 
-/* Maximum number of IPs per ifnet */
+/**Maximum number of member interfaces of a link aggregation port*/
+#define OFP_LAG_MEMBER_MAX 4
+
+/**Interval of the link status checks of LAG members, in microseconds*/
+#define OFP_LAG_LINK_POLL_US 10000
+
+/* IPs per ifnet held in the ifnet, more come from a shared pool */
 #define OFP_NUM_IFNET_IP_ADDRS 8
 
+/* Default size of the pool of additional interface IPs */
+#define OFP_NUM_IFADDR 1024
+
 /**Maximum number of output queues that can be configured for an
  * OFP interface*/
 #define OFP_PKTOUT_QUEUE_MAX 64
 
+/**Maximum number of input queues of an OFP interface that have
+ * their own packet counters*/
+#define OFP_PKTIN_QUEUE_MAX 64
+
+/**Default number of input and output queues of an interface, 0: one
+ * per worker CPU. See ofp_global_param_t.if_queues.*/
+#define OFP_PKTIN_QUEUES 1
+#define OFP_PKTOUT_QUEUES 1
+
 /**Maximum number of events received at once in scheduling mode
  * in default_event_dispatcher().*/
 #define OFP_EVT_RX_BURST_SIZE 16
 
+/**Packets per input packet vector, 0 disables vectors, the longest
+ * wait of a partial vector in nanoseconds and the number of vectors.
+ * See ofp_global_param_t.pktin_vector.*/
+#define OFP_PKTIN_VECTOR_SIZE 0
+#define OFP_PKTIN_VECTOR_TMO_NS 10000
+#define OFP_PKTIN_VECTOR_NUM 4096
+
+/**Default stack size of a coroutine in bytes, see
+ * ofp_coroutine_create().*/
+#define OFP_COROUTINE_STACK_SIZE (64 * 1024)
+
+/**Initial number of buckets of the TCP and UDP PCB hash tables. The
+ * tables are allocated for the PCB limits and double, splitting
+ * OFP_PCBHASH_REHASH_STEP buckets at each PCB insertion, when there are
+ * more than OFP_PCBHASH_LOAD PCBs per bucket.*/
+#define OFP_PCBHASH_INIT_SIZE 256
+#define OFP_PCBHASH_LOAD 2
+#define OFP_PCBHASH_REHASH_STEP 8
+
+/**Maximum number of timer callbacks run for one timer event. Expired
+ * timers beyond this are run on the following ticks.*/
+#define OFP_TIMER_BUDGET 256
+
+/**Number of captured packets each thread can queue for the pcap
+ * writer thread (power of two).*/
+#define OFP_PCAP_RING_SIZE 256
+
+/**Maximum number of bytes captured from a packet.*/
+#define OFP_PCAP_SNAPLEN_MAX 256
+
+/**Number of sFlow samples each thread can queue for the exporter
+ * thread (power of two).*/
+#define OFP_SFLOW_RING_SIZE 256
+
+/**Bytes of the headers of a sampled packet, and their maximum. See
+ * ofp_global_param_t.sflow.*/
+#define OFP_SFLOW_HEADER_LEN 128
+#define OFP_SFLOW_HEADER_MAX 256
+
+/**UDP port of the sFlow collector.*/
+#define OFP_SFLOW_PORT 6343
+
+/**Number of IPv4 sources tracked from the sFlow samples for the top
+ * talkers of 'stat top'.*/
+#define OFP_SFLOW_TALKERS 32
+
+/**Number of messages each thread can queue for the logger thread
+ * (power of two), and the maximum length of a message.*/
+#define OFP_LOG_RING_SIZE 64
+#define OFP_LOG_LINE_MAX 256
+
+/**Messages logged per second from each call site, 0: no limit. See
+ * ofp_global_param_t.logging.*/
+#define OFP_LOG_RATE 10
+
+/**Operations each IPC client can queue (power of two), and the data
+ * copied by each send or receive operation. See ofp_ipc_attach().*/
+#define OFP_IPC_RING_SIZE 16
+#define OFP_IPC_DATA_MAX 8192
+
+/**Packets passed to each OFP_SIGEV_BATCH callback, and the sockets
+ * each thread batches per receive burst.*/
+#define OFP_SOCK_EVENT_BATCH 32
+#define OFP_SOCK_EVENT_SOCKETS 16
+
+/**Socket events of OFP_SIGEV_QUEUE sockets queued at once. See
+ * ofp_global_param_t.sock_event_num.*/
+#define OFP_SOCK_EVENT_NUM 1024
+
+/**Name of the pool of OFP_SIGEV_QUEUE socket events.*/
+#define SHM_SOCK_EVENT_POOL_NAME "sock_event_pool"
+
+/**Telemetry segment update interval in milliseconds, 0 disables the
+ * segment. See ofp_global_param_t.telemetry.*/
+#define OFP_TELEMETRY_INTERVAL_MS 0
+
+/**Memory pressure watermarks in percent of a packet pool or UMA zone in
+ * use, 0 disables the check, and the check interval in milliseconds. See
+ * ofp_global_param_t.mem_pressure.*/
+#define OFP_MEM_PRESSURE_LOW_PCT 0
+#define OFP_MEM_PRESSURE_HIGH_PCT 0
+#define OFP_MEM_PRESSURE_INTERVAL_MS 10
+
+/**ATOMIC queues of locally delivered packets in the ordered mode, 0:
+ * one per worker CPU. See ofp_global_param_t.flow_queues.*/
+#define OFP_FLOW_QUEUES 0
+
+/**Maximum number of flow queues.*/
+#define OFP_FLOW_QUEUES_MAX 256
+
+/**Flow queue rebalancing threshold in percent above the mean load, 0
+ * disables, intervals above it before buckets move, and the check
+ * interval in milliseconds. See ofp_global_param_t.flow_rebalance.*/
+#define OFP_FLOW_REBALANCE_PCT 0
+#define OFP_FLOW_REBALANCE_PERSIST 3
+#define OFP_FLOW_REBALANCE_INTERVAL_MS 100
+
+/**Connection tracking idle timeouts in seconds of established TCP and
+ * UDP flows, and of other flows. See ofp_global_param_t.conntrack.*/
+#define OFP_CT_TCP_TIMEOUT 3600
+#define OFP_CT_UDP_TIMEOUT 120
+#define OFP_CT_TIMEOUT 30
+
+/**Timeout in seconds of a TCP flow after a RST or FINs of both ends.*/
+#define OFP_CT_TCP_CLOSE_TIMEOUT 10
+
+/**Name prefix of the Linux interfaces of the slow path. See
+ * ofp_global_param_t.slow_path.*/
+#define OFP_SP_LINUX_IF "fp"
+
+/**Slow path policer rates in packets per second per interface, 0: no
+ * limit. See ofp_global_param_t.slow_path.*/
+#define OFP_SP_ROUTING_PPS 0
+#define OFP_SP_ARP_PPS 0
+#define OFP_SP_ICMP_PPS 0
+#define OFP_SP_OTHER_PPS 0
+
+/**Slow path policer burst in packets.*/
+#define OFP_SP_BURST 64
+
+/**ICMP and ICMPv6 errors a thread sends per second, in total and per
+ * error type and destination prefix. See ofp_global_param_t.icmp_err.*/
+#define OFP_ICMP_ERR_PPS 1000
+#define OFP_ICMP_ERR_PREFIX_PPS 100
+
+/**Maximum number of steering rules. See ofp_steer_rule_add().*/
+#define OFP_STEER_RULES_MAX 32
+
+/**Scheduling priorities that may have a CPU budget. See
+ * ofp_steer_budget_set().*/
+#define OFP_STEER_BUDGET_PRIOS 16
+
+/**Tenants and traffic classes of a tenant in the egress traffic manager
+ * of an interface. See ofp_tm_vlan_tenant_set().*/
+#define OFP_TM_TENANTS 16
+#define OFP_TM_CLASSES 4
+
+/**Egress traffic manager rate of an interface in kbit/s, 0: not shaped,
+ * and burst in bytes. See ofp_global_param_t.tm.*/
+#define OFP_TM_RATE_KBPS 0
+#define OFP_TM_BURST (64 * 1024)
+
+/**ICMP error burst.*/
+#define OFP_ICMP_ERR_BURST 20
+
+/**Empty polls of an idle thread that spin, then pause the CPU, before it
+ * starts to sleep. See ofp_global_param_t.idle.*/
+#define OFP_IDLE_SPIN 1000
+#define OFP_IDLE_PAUSE 10
+
+/**Longest sleep of an idle thread in microseconds, 0: never sleep.*/
+#define OFP_IDLE_MAX_SLEEP_US 0
+
 /**Number of packets sent at once (>= 1)   */
 #define OFP_PKT_TX_BURST_SIZE 1
 
+/**Maximum time in nanoseconds a packet waits for a burst to fill in
+ * the adaptive transmit mode.*/
+#define OFP_PKT_TX_HOLD_NS 20000
+
+/**Number of paced packets a thread may hold until their departure time.
+ * See ofp_global_param_t.pkt_tx_pace_max.*/
+#define OFP_PKT_TX_PACE_MAX 4096
+
+/**Packets a thread keeps per full output queue for a retry, and the time
+ * in nanoseconds they are kept at most. See
+ * ofp_global_param_t.pkt_tx_retry_max.*/
+#define OFP_PKT_TX_RETRY_MAX 64
+#define OFP_PKT_TX_RETRY_NS 500000
+
+/**Number of TCP flows per thread whose received segments are coalesced
+ * before TCP input. See ofp_global_param_t.tcp_gro_flows.*/
+#define OFP_TCP_GRO_FLOWS 8
+
+/**Receive timestamps of sockets, see ofp_global_param_t.rx_timestamp.*/
+#define OFP_RX_TIMESTAMP 0
+
+/**Number of IPv4 TCP connections in TIME_WAIT state per PCB table.
+ * See ofp_global_param_t.tcp_tw_max.*/
+#define OFP_TCP_TW_MAX 16384
+
+/**Number of TCP connections being set up that the syncache holds.
+ * See ofp_global_param_t.tcp_syncache_max.*/
+#define OFP_TCP_SYNCACHE_MAX (1024 * 30)
+
 /**Controls memory size for IPv4 MTRIE 16/8/8 data structure.
  * It defines the number of small tables (8) used to store routes.*/
 #define OFP_MTRIE_TABLE8_NODES 128
+/**Number of small tables added at a time when the MTRIE runs out of them.*/
+#define OFP_MTRIE_TABLE8_GROW 128
+/**Bits resolved by the first level of the IPv4 MTRIE: 8, 16 or 24.*/
+#define OFP_MTRIE_FIRST_LEVEL 16
+/**First level tables of the IPv4 MTRIE shared by the VRFs, 0: num_vrf.*/
+#define OFP_MTRIE_VRF_TABLES 0
+/**Maximum number of IPv4 routes per VRF, 0: no limit.*/
+#define OFP_MTRIE_VRF_ROUTES 0
+/**Maximum number of small IPv4 MTRIE tables per VRF, 0: no limit.*/
+#define OFP_MTRIE_VRF_TABLE8_NODES 0
 /** Defines the maximum number of routes that are stored in the MTRIE.*/
 #define OFP_ROUTES 65536
 
+/** Number of ECMP next hop groups and maximum members of a group. */
+#define OFP_NUM_NH_GROUPS 256
+#define OFP_NH_GROUP_MAX 16
+
+/**Controls memory size for IPv6 MTRIE 16/8/.../8 data structure.
+ * It defines the number of small tables (8) used to store routes.*/
+#define OFP_MTRIE6_TABLE8_NODES 1024
+
 /** Number of VRFs. */
 #define OFP_NUM_VRF 1
 
@@ -142,6 +374,39 @@
 /**Time interval(s) while a packet is saved and waiting for an ARP reply. */
 #define OFP_ARP_SAVED_PKT_TIMEOUT 10
 
+/**IPv6 neighbour cache hash bits. */
+#define OFP_ND6_HASH_BITS 10
+/**Total number of IPv6 neighbour cache entries. */
+#define OFP_ND6_ENTRIES 1024
+/**Time (in seconds) a neighbour is reachable after a confirmation. */
+#define OFP_ND6_REACHABLE_TIME 30
+/**Time (in seconds) an unconfirmed neighbour is kept. */
+#define OFP_ND6_ENTRY_TIMEOUT 1200
+
+/**Maximum number of IP datagrams being reassembled. */
+#define OFP_REASS_MAX_QUEUES 1024
+/**Maximum number of fragments stored per reassembled IP datagram. */
+#define OFP_REASS_MAX_FRAGS 16
+
+/**Number of MAC address to VTEP address mappings of VXLAN. */
+#define OFP_VXLAN_MAC_ENTRIES 8192
+/**Timeout (in seconds) of a VXLAN MAC address mapping. */
+#define OFP_VXLAN_MAC_TIMEOUT 3600
+
+/**Number of free objects a thread caches per memory zone (PCBs,
+ * sockets, tcpcbs, syncache entries, ...). 0 disables the caches.*/
+#define OFP_UMA_CACHE_SIZE 32
+
+/**Number of small socket buffer rings, 0: two per socket. */
+#define OFP_SOCKBUF_SMALL_RINGS 0
+/**Number of large socket buffer rings. */
+#define OFP_SOCKBUF_RINGS 256
+/**Number of packets in a large socket buffer ring. */
+#define OFP_SOCKBUF_RING_LEN 1024
+/**Kilobytes by which all TCP socket buffers together may grow beyond
+ * their initial size by autotuning. */
+#define OFP_SOCKBUF_AUTO_MEM_KB (256 * 1024)
+
 /**Enable IPv4 UDP checksum validation mechanism on input
  * packets. If enabled, validation is performed on input
  * packets. */
@@ -168,4 +433,8 @@
 #define OFP_CHKSUM_OFFLOAD_UDP_TX  1
 #define OFP_CHKSUM_OFFLOAD_TCP_TX  1
 
+/**Enable (1) or disable (0) TCP segmentation offload. See
+ * ofp_chksum_offload_config_t.*/
+#define OFP_TCP_TSO_OFFLOAD        1
+
 #endif
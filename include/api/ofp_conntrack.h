@@ -0,0 +1,100 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef __OFP_CONNTRACK_H__
+#define __OFP_CONNTRACK_H__
+
+#include <odp_api.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+/**
+ * @file
+ *
+ * @brief Connection tracking
+ *
+ * With ofp_global_param_t.conntrack.entries set, each thread keeps a
+ * table of the IPv4 and IPv6 flows it receives, keyed by VRF, protocol,
+ * addresses and ports, both directions in one flow. A received packet
+ * is looked up before the hooks, so hooks and later processing find
+ * its flow with ofp_ct_packet_flow() without classifying it again.
+ * Packets decapsulated from VXLAN, GRE or IPsec are looked up again by
+ * their inner headers.
+ *
+ * A flow holds OFP_CT_FLOW_DATA_LEN bytes of user data and an action.
+ * Flows expire after a timeout of their protocol and state, then
+ * ofp_global_param_t.conntrack.expire is called.
+ *
+ * The table is per thread: the two directions of a flow are the same
+ * flow only when they are received by the same thread, e.g. with a
+ * symmetric flow hash of the input queues.
+ */
+
+/** User data of a flow in bytes */
+#define OFP_CT_FLOW_DATA_LEN 16
+
+/** Tracked flow */
+struct ofp_ct_flow;
+
+/** State of a flow */
+enum ofp_ct_state {
+	OFP_CT_NEW = 0,		/**< No reply yet, TCP handshake pending */
+	OFP_CT_ESTABLISHED,	/**< Reply seen, TCP connection open */
+	OFP_CT_CLOSING		/**< TCP FIN or RST seen */
+};
+
+/** Action on the packets of a flow */
+enum ofp_ct_action {
+	OFP_CT_ACTION_CONTINUE = 0,	/**< Process the packets */
+	OFP_CT_ACTION_DROP		/**< Drop before the hooks */
+};
+
+/**
+ * Called when a flow expires, is evicted for a new flow or is reused
+ * by a new TCP connection, before its user data is cleared.
+ */
+typedef void (*ofp_ct_expire_cb)(struct ofp_ct_flow *flow);
+
+/**
+ * Flow of a received packet
+ *
+ * The flow remains valid while the thread that received the packet
+ * processes it.
+ *
+ * @param pkt    Packet
+ * @param reply  If not NULL, set to 1 if the packet is of the reply
+ *               direction of the flow, otherwise to 0
+ *
+ * @retval Flow, NULL if not tracked
+ */
+struct ofp_ct_flow *ofp_ct_packet_flow(odp_packet_t pkt, int *reply);
+
+/** State of a flow */
+enum ofp_ct_state ofp_ct_flow_state(const struct ofp_ct_flow *flow);
+
+/** Set the action on the later packets of a flow */
+void ofp_ct_flow_action_set(struct ofp_ct_flow *flow,
+			    enum ofp_ct_action action);
+
+/** User data of a flow, zero for a new flow */
+void *ofp_ct_flow_data(struct ofp_ct_flow *flow);
+
+/**
+ * Expire the flows of the calling thread whose timeout has passed.
+ * Packet input does this as time goes on; a thread that may idle for
+ * long calls this to expire its flows meanwhile.
+ *
+ * @retval Number of flows expired
+ */
+int ofp_ct_age(void);
+
+#if __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+#endif /* __OFP_CONNTRACK_H__ */
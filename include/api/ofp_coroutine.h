@@ -0,0 +1,76 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef __OFP_COROUTINE_H__
+#define __OFP_COROUTINE_H__
+
+#include <stddef.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+/**
+ * @file
+ *
+ * @brief Coroutines of dispatcher threads
+ *
+ * A coroutine runs a function on its own stack in the thread that
+ * created it, switched to by ofp_coroutine_run() between the bursts of
+ * default_event_dispatcher() and direct_event_dispatcher(). A blocking
+ * socket call of a coroutine, e.g. ofp_recv(), ofp_send(), ofp_accept(),
+ * ofp_epoll_wait() or ofp_connect() of a blocking socket, returns to
+ * the dispatcher instead of spinning, and the coroutine is resumed
+ * after the wakeup, so that straightforward blocking code runs to
+ * completion on the fast path cores.
+ *
+ * Unlike outside coroutines, ofp_connect() of a blocking socket waits
+ * for the connection to be established or to fail.
+ *
+ * Coroutines are not preempted: one that does not block or call
+ * ofp_coroutine_yield() stops the dispatcher of its thread.
+ */
+
+/**
+ * Create a coroutine on the calling thread
+ *
+ * func(arg) starts on the next ofp_coroutine_run() of the thread and
+ * the coroutine ends when it returns.
+ *
+ * @param func        Function of the coroutine
+ * @param arg         Argument of func
+ * @param stack_size  Stack size in bytes, 0 for OFP_COROUTINE_STACK_SIZE
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_coroutine_create(void (*func)(void *arg), void *arg,
+			 size_t stack_size);
+
+/**
+ * Let the other coroutines and the dispatcher run. The calling
+ * coroutine continues on the next ofp_coroutine_run(). Does nothing
+ * outside coroutines.
+ */
+void ofp_coroutine_yield(void);
+
+/**
+ * Run the coroutines of the calling thread that are not waiting, each
+ * until it blocks, yields or ends. The OFP dispatchers call this after
+ * each burst; an application dispatcher calls it in its loop.
+ *
+ * @retval Number of coroutines run
+ */
+int ofp_coroutine_run(void);
+
+/** Number of coroutines of the calling thread */
+int ofp_coroutine_count(void);
+
+#if __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+#endif /* __OFP_COROUTINE_H__ */
@@ -23,6 +23,8 @@
 #define OFP_DEBUG_PRINT_SEND_KNI 8
 #define OFP_DEBUG_PRINT_CONSOLE 16
 #define OFP_DEBUG_CAPTURE       64
+/* Fire the static tracepoints of a build with --enable-sdt */
+#define OFP_DEBUG_TRACEPOINTS   0x100
 
 void ofp_set_debug_flags(int flags);
 int ofp_get_debug_flags(void);
@@ -39,6 +41,82 @@ int ofp_get_debug_capture_ports(void);
 void ofp_set_capture_file(const char *filename);
 void ofp_get_capture_file(char *filename, int max_size);
 
+/* Bytes captured per packet, 1 .. OFP_PCAP_SNAPLEN_MAX */
+void ofp_set_capture_snaplen(uint32_t snaplen);
+uint32_t ofp_get_capture_snaplen(void);
+
+/*
+ * Filter applied to printed and captured packets. The expression is a
+ * list of primitives that must all match: ip, ip6, arp, tcp, udp, icmp,
+ * "proto N", "host A.B.C.D", "port N" and "vlan N". An empty expression
+ * or "none" matches all packets. Return -1 on a syntax error.
+ */
+int ofp_set_capture_filter(const char *expr);
+void ofp_get_capture_filter(char *expr, int max_size);
+
+/*
+ * Start a new file when the current one reaches size bytes, keeping
+ * count files: filename, filename.1, ... Size 0 disables rotation.
+ */
+void ofp_set_capture_rotate(uint64_t size, int count);
+
+/* Packets captured, and packets not captured because the writer lagged */
+uint64_t ofp_get_capture_count(void);
+uint64_t ofp_get_capture_drops(void);
+
+/*
+ * Debug TRACE interface
+ *
+ * With ofp_global_param_t.trace.entries set, each thread records its
+ * packets at the stages enabled below into a ring of its last records,
+ * at the cost of a few stores per packet. ofp_trace_dump() saves the
+ * rings for offline decoding.
+ */
+enum ofp_trace_stage {
+	OFP_TRACE_RX = 0,	/**< Received from an interface */
+	OFP_TRACE_DONE,		/**< Fast path processing done, verdict */
+	OFP_TRACE_TX,		/**< Queued to an interface */
+	OFP_TRACE_STAGES
+};
+
+#define OFP_TRACE_ALL ((1u << OFP_TRACE_STAGES) - 1)
+
+struct ofp_trace_record {
+	uint64_t ts_ns;		/* odp_time_local_ns() */
+	uint32_t hash;		/* Flow hash or hash of the L3 addresses */
+	uint8_t port;
+	uint8_t stage;		/* enum ofp_trace_stage */
+	uint8_t verdict;	/* enum ofp_return_code at OFP_TRACE_DONE */
+	uint8_t drop;		/* Last drop reason + 1 if dropped, else 0 */
+};
+
+#define OFP_TRACE_MAGIC 0x4f465054	/* "OFPT" */
+#define OFP_TRACE_VERSION 1
+
+/*
+ * A dump file is the header, then for each ring its thread id and
+ * number of records written, uint32_t each, and its entries records,
+ * oldest first. Unwritten records are zero.
+ */
+struct ofp_trace_file_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t num_rings;
+	uint32_t entries;
+	uint64_t local_ns;	/* odp_time_local_ns() at the dump */
+	uint64_t real_ns;	/* CLOCK_REALTIME at the dump */
+};
+
+/* Set the mask of stages recorded, bit n for stage n */
+void ofp_trace_stages_set(uint32_t stages);
+uint32_t ofp_trace_stages_get(void);
+
+/* Save the rings into a file. Returns 0 on success, -1 on failure. */
+int ofp_trace_dump(const char *filename);
+
+/* Print the last num records of each thread */
+void ofp_trace_print(int fd, int num);
+
 /*
  * Debug PRINT interface
  */
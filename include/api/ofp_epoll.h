@@ -29,6 +29,16 @@ struct ofp_epoll_event {
 enum OFP_EPOLL_EVENTS {
 	OFP_EPOLLIN = 0x001,
 #define OFP_EPOLLIN OFP_EPOLLIN
+	OFP_EPOLLOUT = 0x004,
+#define OFP_EPOLLOUT OFP_EPOLLOUT
+	OFP_EPOLLERR = 0x008,
+#define OFP_EPOLLERR OFP_EPOLLERR
+	OFP_EPOLLHUP = 0x010,
+#define OFP_EPOLLHUP OFP_EPOLLHUP
+	OFP_EPOLLONESHOT = 1u << 30,
+#define OFP_EPOLLONESHOT OFP_EPOLLONESHOT
+	OFP_EPOLLET = 1u << 31
+#define OFP_EPOLLET OFP_EPOLLET
 };
 
 #define OFP_EPOLL_CTL_ADD 1
@@ -41,6 +51,31 @@ int ofp_epoll_ctl(int epfd, int op, int fd, struct ofp_epoll_event *event);
 
 int ofp_epoll_wait(int epfd, struct ofp_epoll_event *events, int maxevents, int timeout);
 
+/**
+ * Kernel eventfd of an epoll instance, for waiting on OFP sockets and
+ * kernel file descriptors together. The eventfd is created on the
+ * first call and closed with the epoll instance.
+ *
+ * @param epfd epoll instance
+ * @retval eventfd on success
+ * @retval -1 on failure, see ofp_errno
+ */
+int ofp_epoll_eventfd(int epfd);
+
+/**
+ * Arm the eventfd of an epoll instance before blocking on it
+ *
+ * Clears the eventfd. While armed, the eventfd becomes readable when
+ * a socket of the instance may have become ready. The event is then
+ * retrieved with ofp_epoll_wait() using zero timeout.
+ *
+ * @param epfd epoll instance
+ * @retval 0 armed, the caller may block on the eventfd
+ * @retval 1 sockets may already be ready, the caller should not block
+ * @retval -1 on failure, see ofp_errno
+ */
+int ofp_epoll_arm(int epfd);
+
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
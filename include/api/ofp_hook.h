@@ -9,6 +9,7 @@
 #define __OFP_HOOK_H__
 
 #include <odp_api.h>
+#include "ofp_types.h"
 
 #if __GNUC__ >= 4
 #pragma GCC visibility push(default)
@@ -33,6 +34,24 @@
  */
 typedef enum ofp_return_code (*ofp_pkt_hook)(odp_packet_t pkt, void *arg);
 
+/**
+ * @brief Burst function callback format
+ *
+ * Called once for the packets of a received burst that reach the same
+ * hook point. The callback stores a result for each packet; the
+ * packets for which it returns OFP_PKT_CONTINUE continue in OFP. Where
+ * OFP processes packets one at a time, the callback is called with a
+ * single packet.
+ *
+ * @param pkt The packets received by the hook callback
+ * @param num Number of packets
+ * @param res Result of each packet, set by the callback
+ * @param arg As for ofp_pkt_hook(). For OFP_HOOK_FWD_IPv4 an array of
+ * the next hops of the packets when called for a burst.
+ */
+typedef void (*ofp_pkt_hook_burst)(odp_packet_t pkt[], int num,
+				   enum ofp_return_code res[], void *arg);
+
 /**
  * @brief Hook handles
  *
@@ -40,7 +59,10 @@ typedef enum ofp_return_code (*ofp_pkt_hook)(odp_packet_t pkt, void *arg);
  * is found. One can register any ofp_pkt_hook() function callback for any
  * handle.
  * The registration is done with ofp_init_global() by assigning function
- * callbacks on #ofp_global_param_t.pkt_hook[#ofp_hook_id]
+ * callbacks on #ofp_global_param_t.pkt_hook[#ofp_hook_id] or, for burst
+ * callbacks, on #ofp_global_param_t.pkt_hook_burst[#ofp_hook_id]. If both
+ * are set for a handle, the burst callback is called for bursts and the
+ * per packet callback for single packets.
  */
 enum ofp_hook_id {
 	OFP_HOOK_LOCAL = 0,	/**< Registers a function to handle all packets
@@ -43,6 +43,190 @@ int ofp_ifnet_create(odp_instance_t instance, char *if_name,
 	odp_pktio_param_t *pktio_param,
 	odp_pktin_queue_param_t *pktin_param,
 	odp_pktout_queue_param_t *pktout_param);
+
+/**
+ * Create a link aggregation (LAG) port of interfaces
+ *
+ * The members are ports created with ofp_ifnet_create() and are used
+ * only through the LAG port afterwards: addresses, routes and VLANs
+ * are configured on the LAG port. Packets are sent on a member chosen
+ * by a hash of their L3 and L4 addresses, and the flows of a member
+ * whose link goes down move to the other members. LACP and other
+ * slow protocol frames are not aggregated, they stay on the member
+ * and go to its slow path.
+ *
+ * The LAG port has the MAC address of the first member. The other
+ * members are given the same address, or put to promiscuous mode if
+ * they cannot change it.
+ *
+ * @param if_name Name of the LAG port
+ * @param member  Ports of the members
+ * @param num     Number of members, 1 ... OFP_LAG_MEMBER_MAX
+ *
+ * @retval Port of the LAG on success
+ * @retval -1 on failure
+ */
+int ofp_ifnet_lag_create(const char *if_name, const int member[], int num);
+
+/**
+ * Get the direct mode input queues a worker polls
+ *
+ * Queue i of the interface is polled by worker i % num_workers. With
+ * fewer queues than workers, worker w shares queue w % queues with
+ * the other workers, which needs the default ODP_PKTIO_OP_MT mode.
+ *
+ * @param port        Port of the interface
+ * @param worker      Index of the worker, 0 ... num_workers - 1
+ * @param num_workers Number of workers polling the interface
+ * @param queue       Queues of the worker
+ * @param num         Size of queue
+ *
+ * @retval Number of queues stored in queue
+ * @retval -1 on failure
+ */
+int ofp_ifnet_pktin_queues(int port, int worker, int num_workers,
+			   odp_pktin_queue_t queue[], int num);
+
+/**
+ * Traffic matched by a steering rule
+ */
+enum ofp_steer_match {
+	OFP_STEER_TCP_DPORT = 0,	/**< TCP destination port */
+	OFP_STEER_UDP_DPORT,		/**< UDP destination port */
+	OFP_STEER_IPSEC_SPI,		/**< SPI of IPsec ESP */
+	OFP_STEER_TCP_SPORT,		/**< TCP source port */
+	OFP_STEER_UDP_SPORT,		/**< UDP source port */
+	OFP_STEER_IP_DSCP,		/**< DSCP of IPv4 or IPv6, 0 - 63 */
+	OFP_STEER_IP_PROTO,		/**< IP protocol */
+	OFP_STEER_ETHTYPE		/**< Ethernet type, e.g. ARP */
+};
+
+/**
+ * Steering rule. Matching packets of an interface are classified by
+ * ODP to queues of their own, scheduled to the threads of a
+ * scheduling group. A group holding the worker threads of one core
+ * dedicates the core to the traffic. A priority above that of the
+ * other traffic keeps control traffic running when data saturates the
+ * cores, see also ofp_steer_budget_set().
+ */
+struct ofp_steer_rule {
+	enum ofp_steer_match match;
+	/** Port or SPI to match, in host byte order */
+	uint32_t value;
+	/** Scheduling group, ODP_SCHED_GROUP_INVALID: global sched_group */
+	odp_schedule_group_t group;
+	odp_schedule_prio_t prio;
+	odp_schedule_sync_t sync;
+	/** Queues the matches are hashed to, 1: no hashing */
+	uint32_t num_queues;
+};
+
+/**
+ * Initialize a steering rule to defaults: one atomic queue of default
+ * priority in the global scheduling group.
+ */
+void ofp_steer_rule_init(struct ofp_steer_rule *rule);
+
+/**
+ * Add a steering rule to an interface
+ *
+ * The interface must have been created with scheduled packet input
+ * while ofp_global_param_t.steering was set.
+ *
+ * @param port   Port of the interface
+ * @param rule   Rule to add
+ *
+ * @retval Rule id >= 0 on success
+ * @retval -1 on failure
+ */
+int ofp_steer_rule_add(int port, const struct ofp_steer_rule *rule);
+
+/**
+ * Remove a steering rule
+ *
+ * @param id     Rule id returned by ofp_steer_rule_add()
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_steer_rule_del(int id);
+
+/**
+ * Set the CPU budget of a scheduling priority
+ *
+ * default_event_dispatcher() lets the packets of the priority take up
+ * to percent of the time of a thread in each millisecond, and drops
+ * the packets of the priority over the budget until the next one.
+ * This keeps a flood of traffic steered to a high priority from
+ * starving the lower ones. Events other than packets are not limited.
+ *
+ * @param prio    Priority, 0 to odp_schedule_max_prio()
+ * @param percent Budget, 1 - 100, 0 removes the budget
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_steer_budget_set(odp_schedule_prio_t prio, uint32_t percent);
+
+/**
+ * Set the shaper of a tenant in the egress traffic manager
+ *
+ * An interface created with pktout_mode ODP_PKTOUT_MODE_TM sends
+ * through OFP_TM_TENANTS tenants, each of OFP_TM_CLASSES traffic
+ * classes by DSCP, under the shaper of the interface set by
+ * ofp_global_param_t.tm. Tenant 0 sends the traffic of VLANs not
+ * mapped to a tenant. Tenants are not shaped until set.
+ *
+ * @param port      Port of the interface
+ * @param tenant    Tenant, 0 to OFP_TM_TENANTS - 1
+ * @param rate_kbps Rate in kbit/s, 0: not shaped
+ * @param burst     Bytes sent back to back above the rate
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_tm_tenant_shaper_set(int port, int tenant, uint64_t rate_kbps,
+			     uint32_t burst);
+
+/**
+ * Send the traffic of a VLAN of an interface through a tenant
+ *
+ * @param port      Port of the interface
+ * @param vlan      VLAN id, 0: untagged traffic
+ * @param tenant    Tenant, 0 to OFP_TM_TENANTS - 1
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_tm_vlan_tenant_set(int port, uint16_t vlan, int tenant);
+
+/**
+ * Send the traffic of the interfaces of a VRF on a port through a
+ * tenant. Maps the VLANs that are in the VRF at the time of the call.
+ *
+ * @param port      Port of the interface
+ * @param vrf       VRF
+ * @param tenant    Tenant, 0 to OFP_TM_TENANTS - 1
+ *
+ * @retval Number of VLANs mapped
+ * @retval -1 on failure
+ */
+int ofp_tm_vrf_tenant_set(int port, uint16_t vrf, int tenant);
+
+/**
+ * Map a DSCP value to a traffic class of the tenants of an interface.
+ * The higher class is served first, or with a higher weight when
+ * ofp_global_param_t.tm.wfq is set. By default a class holds two IP
+ * precedence values, class 0 precedence 0 and 1.
+ *
+ * @param port      Port of the interface
+ * @param dscp      DSCP value, 0 to 63
+ * @param cls       Class, 0 to OFP_TM_CLASSES - 1
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_tm_dscp_class_set(int port, uint8_t dscp, int cls);
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
@@ -589,6 +589,44 @@ uint16_t ofp_cksum(const odp_packet_t pkt, unsigned int off, unsigned int len);
  */
 uint16_t ofp_in4_cksum(const odp_packet_t pkt);
 
+/**
+ * Update a checksum for a changed 16-bit field (RFC 1624).
+ *
+ * All values are in the same byte order, normally network order, as
+ * the checksum and the field are stored in the packet.
+ *
+ * @param sum Current checksum.
+ * @param old Old value of the field.
+ * @param new New value of the field.
+ * @return Updated checksum.
+ */
+static inline uint16_t ofp_cksum_adjust16(uint16_t sum, uint16_t old,
+					  uint16_t new)
+{
+	uint32_t s = (uint16_t)~sum + (uint16_t)~old + (uint32_t)new;
+
+	s = (s >> 16) + (s & 0xffff);
+	s += s >> 16;
+	return ~s;
+}
+
+/**
+ * Update a checksum for a changed 32-bit field (RFC 1624).
+ *
+ * @see ofp_cksum_adjust16()
+ */
+static inline uint16_t ofp_cksum_adjust32(uint16_t sum, uint32_t old,
+					  uint32_t new)
+{
+	uint32_t s = (uint16_t)~sum +
+		(uint16_t)~(old >> 16) + (uint16_t)~(old & 0xffff) +
+		(new >> 16) + (new & 0xffff);
+
+	s = (s >> 16) + (s & 0xffff);
+	s += s >> 16;
+	return ~s;
+}
+
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
@@ -26,6 +26,7 @@
 #include <odp_api.h>
 #include "ofp_hook.h"
 #include "ofp_ipsec_init.h"
+#include "ofp_conntrack.h"
 
 #if __GNUC__ >= 4
 #pragma GCC visibility push(default)
@@ -47,6 +48,30 @@
  * by HW (if packet_io supports offloading) or by SW (if packet_io doesn't
  * support offloading), if needed.
  */
+/**
+ * @name Protocol modules
+ * Bits of ofp_global_param_t.modules_disabled
+ * @{
+ */
+#define OFP_MODULE_IGMP		0x1	/**< IGMP group membership reports */
+#define OFP_MODULE_IPSEC	0x2	/**< IPsec: ESP and AH, SPs and SAs */
+#define OFP_MODULE_VXLAN	0x4	/**< VXLAN interfaces */
+#define OFP_MODULE_GRE		0x8	/**< GRE tunnel interfaces */
+/** @} */
+
+/**
+ * Output queue selection
+ */
+typedef enum ofp_tx_queue_map_t {
+	/** Queue of the CPU of the sending thread */
+	OFP_TX_QUEUE_MAP_CPU = 0,
+	/** Queue of the ODP thread id of the sending thread */
+	OFP_TX_QUEUE_MAP_THREAD,
+	/** Queue of the packet flow hash, if the packet has one.
+	 *  Otherwise as OFP_TX_QUEUE_MAP_CPU. */
+	OFP_TX_QUEUE_MAP_FLOW
+} ofp_tx_queue_map_t;
+
 typedef struct ofp_chksum_offload_config_t {
 	/** Enable IPv4 header checksum validation offload */
 	uint16_t ipv4_rx_ena : 1;
@@ -65,6 +90,12 @@ typedef struct ofp_chksum_offload_config_t {
 
 	/** Enable TCP checksum insertion offload */
 	uint16_t tcp_tx_ena  : 1;
+
+	/**
+	 * Enable TCP segmentation offload. TCP bursts to interfaces
+	 * without it are segmented in software.
+	 */
+	uint16_t tcp_tso_ena : 1;
 } ofp_chksum_offload_config_t;
 
 /**
@@ -109,6 +140,31 @@ typedef struct ofp_global_param_t {
 	 */
 	odp_pktout_mode_t pktout_mode;
 
+	/**
+	 * Queues of the interfaces created without pktin or pktout
+	 * queue parameters, as by ofp_init_global(). The counts are
+	 * limited by the interface capabilities.
+	 */
+	struct if_queues_s {
+		/**
+		 * Input queues, 0: one per worker CPU. More than one
+		 * spread the flows over the queues by hash_proto.
+		 * Default is OFP_PKTIN_QUEUES.
+		 */
+		int rx;
+		/**
+		 * Output queues, 0: one per worker CPU. The queue a
+		 * thread sends to is chosen by pkt_tx_queue_map.
+		 * Default is OFP_PKTOUT_QUEUES.
+		 */
+		int tx;
+		/**
+		 * Protocols hashed to select the input queue.
+		 * Default is IPv4 and IPv6 TCP and UDP.
+		 */
+		odp_pktin_hash_proto_t hash_proto;
+	} if_queues;
+
 	/**
 	 * Scheduler synchronization method of the pktin queues of the
 	 * interfaces initialized by OFP in the scheduled mode.
@@ -118,6 +174,49 @@ typedef struct ofp_global_param_t {
 	 */
 	odp_schedule_sync_t sched_sync;
 
+	/**
+	 * Number of ATOMIC queues that locally delivered packets are
+	 * handed to, by a hash of their flow, when sched_sync is
+	 * ODP_SCHED_SYNC_ORDERED. Forwarding stays in the ordered
+	 * context of the pktin queue while TCP, UDP and reassembly of
+	 * a flow run in the atomic context of its queue. Enqueues from
+	 * the ordered context keep the order, so pktout_mode
+	 * ODP_PKTOUT_MODE_QUEUE restores the order of forwarded
+	 * packets on output. 0: one queue per worker CPU. Ignored with
+	 * other sched_sync values.
+	 *
+	 * Default value is OFP_FLOW_QUEUES.
+	 */
+	int flow_queues;
+
+	/**
+	 * Rebalancing of the flow queues. Flows are hashed to buckets
+	 * and buckets to flow queues. A timer counts the packets of
+	 * each bucket and, when the busiest queue has stayed threshold
+	 * percent above the mean for persist intervals in a row, moves
+	 * buckets of it to the least loaded queue. Packets of a moved
+	 * flow that are still queued may be processed at the same time
+	 * as the next ones, so TCP may see them reordered once. Not
+	 * done with share_nothing, where flows stay on their core.
+	 */
+	struct flow_rebalance_s {
+		/**
+		 * Imbalance threshold in percent above the mean. Default
+		 * is OFP_FLOW_REBALANCE_PCT, 0 disables rebalancing.
+		 */
+		int threshold;
+		/**
+		 * Intervals in a row above the threshold before buckets
+		 * are moved. Default is OFP_FLOW_REBALANCE_PERSIST.
+		 */
+		int persist;
+		/**
+		 * Check interval in milliseconds. Default is
+		 * OFP_FLOW_REBALANCE_INTERVAL_MS.
+		 */
+		int interval_ms;
+	} flow_rebalance;
+
 	/**
 	 * ODP event scheduling group for all scheduled event queues
 	 * (pktio queues, timer queues and other queues) created in
@@ -126,6 +225,17 @@ typedef struct ofp_global_param_t {
 	 */
 	odp_schedule_group_t sched_group;
 
+	/**
+	 * Enable the ODP classifier on the interfaces created with
+	 * scheduled input, so that traffic can be steered to queues of
+	 * its own with ofp_steer_rule_add(). The traffic not steered is
+	 * classified to the queues the pktin queue parameters describe.
+	 * Ignored if the pktin queue parameters enable the classifier.
+	 *
+	 * Default value is FALSE.
+	 */
+	odp_bool_t steering;
+
 	/**
 	 * Packet processing hooks. The default value is NULL for
 	 * every hook.
@@ -134,6 +244,14 @@ typedef struct ofp_global_param_t {
 	 */
 	ofp_pkt_hook pkt_hook[OFP_HOOK_MAX];
 
+	/**
+	 * Burst packet processing hooks. The default value is NULL for
+	 * every hook.
+	 *
+	 * @see ofp_pkt_hook_burst
+	 */
+	ofp_pkt_hook_burst pkt_hook_burst[OFP_HOOK_MAX];
+
 	/**
 	 * Create netlink listener thread. If slow path is enabled,
 	 * then default is TRUE, otherwise default is FALSE.
@@ -172,8 +290,41 @@ typedef struct ofp_global_param_t {
 		 * Default value is 0.
 		 */
 		odp_bool_t check_interface;
+
+		/**
+		 * Age the ARP table only in ofp_arp_age(), called by the
+		 * application on its control core, instead of in a timer
+		 * of the worker cores.
+		 *
+		 * Default value is 0.
+		 */
+		odp_bool_t control_aging;
 	} arp;
 
+	/**
+	 * Global IPv6 neighbour cache parameters.
+	 */
+	struct nd6_s {
+		/** Maximum number of entries. Default is OFP_ND6_ENTRIES. */
+		int entries;
+
+		/** Hash bits. Default is OFP_ND6_HASH_BITS. */
+		int hash_bits;
+
+		/**
+		 * Time in seconds a neighbour is reachable after a
+		 * confirmation, then its MAC is confirmed again when used.
+		 * Default is OFP_ND6_REACHABLE_TIME.
+		 */
+		int reachable_time;
+
+		/**
+		 * Time in seconds an unconfirmed neighbour is kept.
+		 * Default is OFP_ND6_ENTRY_TIMEOUT.
+		 */
+		int entry_timeout;
+	} nd6;
+
 	/**
 	 * Maximum number of events received at once. Default is
 	 * OFP_EVT_RX_BURST_SIZE.
@@ -186,28 +337,390 @@ typedef struct ofp_global_param_t {
 	 */
 	uint32_t pkt_tx_burst_size;
 
+	/**
+	 * Selection of the output queue of packets sent to interfaces
+	 * with several output queues. See ofp_send_queue_set().
+	 *
+	 * Default value is OFP_TX_QUEUE_MAP_CPU.
+	 */
+	ofp_tx_queue_map_t pkt_tx_queue_map;
+
+	/**
+	 * Adapt the number of packets sent at once to the occupancy of
+	 * the received bursts, up to pkt_tx_burst_size. In the threads of
+	 * the default dispatcher, packets not sent by
+	 * ofp_send_pending_pkt() are held for at most pkt_tx_hold_ns.
+	 * Other threads send them on every ofp_send_pending_pkt().
+	 *
+	 * Default value is 0.
+	 */
+	odp_bool_t pkt_tx_burst_adaptive;
+
+	/**
+	 * Maximum time in nanoseconds a packet is held waiting for a
+	 * burst to fill in the adaptive mode. Default is
+	 * OFP_PKT_TX_HOLD_NS.
+	 */
+	uint32_t pkt_tx_hold_ns;
+
+	/**
+	 * Maximum number of packets of paced TCP connections a thread of
+	 * default_event_dispatcher() holds until their departure time.
+	 * Packets beyond it, and those of other threads, are sent at once.
+	 * 0 disables the holding: paced connections are then only limited
+	 * in TCP output, at the resolution of the TCP timers.
+	 *
+	 * Default value is OFP_PKT_TX_PACE_MAX.
+	 */
+	int pkt_tx_pace_max;
+
+	/**
+	 * Maximum number of packets a thread keeps per output queue
+	 * when the queue is full, to send them before the next packets
+	 * to the queue, at the latest on the next ofp_send_pending_pkt().
+	 * 0 drops the packets at once.
+	 *
+	 * Default value is OFP_PKT_TX_RETRY_MAX.
+	 */
+	int pkt_tx_retry_max;
+
+	/**
+	 * Time in nanoseconds after which a packet kept for a retry
+	 * is dropped. Default is OFP_PKT_TX_RETRY_NS.
+	 */
+	uint32_t pkt_tx_retry_ns;
+
+	/**
+	 * Process the packets of a received burst in stages in
+	 * default_event_dispatcher(), one stage over the whole burst
+	 * at a time. Packets of a flow are not reordered, packets of
+	 * different protocols may be. See ofp_packet_input_multi().
+	 *
+	 * Default value is 0.
+	 */
+	odp_bool_t pkt_vector_mode;
+
+	/**
+	 * Packet vectors of scheduled input queues, with ODP 1.26 or
+	 * later. Interfaces that support them deliver received packets
+	 * in ODP_EVENT_PACKET_VECTOR events, which
+	 * default_event_dispatcher() passes to ofp_packet_input_multi()
+	 * whole. Applications with their own dispatcher must handle the
+	 * vector events.
+	 */
+	struct pktin_vector_s {
+		/**
+		 * Maximum number of packets in a vector, 0 disables
+		 * vectors. Default is OFP_PKTIN_VECTOR_SIZE.
+		 */
+		uint32_t size;
+		/**
+		 * Longest time in nanoseconds a partial vector waits
+		 * for more packets. Default is OFP_PKTIN_VECTOR_TMO_NS.
+		 */
+		uint64_t tmo_ns;
+		/**
+		 * Number of vectors in the vector pool. Default is
+		 * OFP_PKTIN_VECTOR_NUM.
+		 */
+		uint32_t num;
+	} pktin_vector;
+
+	/**
+	 * Number of entries in the per thread flow cache of forwarded
+	 * IPv4 packets, rounded up to a power of two. A cache hit skips
+	 * the route and ARP lookups and the Ethernet header building.
+	 *
+	 * Default value is 0 (no flow cache).
+	 */
+	int flow_cache_size;
+
+	/**
+	 * Connection tracking of the received IPv4 and IPv6 flows, see
+	 * ofp_conntrack.h.
+	 */
+	struct conntrack_s {
+		/**
+		 * Flows tracked per thread, rounded up to a power of two.
+		 * Default is 0 (no connection tracking).
+		 */
+		int entries;
+		/**
+		 * Idle timeout in seconds of an established TCP flow.
+		 * Default is OFP_CT_TCP_TIMEOUT.
+		 */
+		int tcp_timeout;
+		/**
+		 * Idle timeout in seconds of an established UDP flow.
+		 * Default is OFP_CT_UDP_TIMEOUT.
+		 */
+		int udp_timeout;
+		/**
+		 * Idle timeout in seconds of other flows, and of TCP and
+		 * UDP flows not yet established or closing.
+		 * Default is OFP_CT_TIMEOUT.
+		 */
+		int timeout;
+		/**
+		 * Called for each expired flow. Default is NULL.
+		 */
+		ofp_ct_expire_cb expire;
+	} conntrack;
+
+	/**
+	 * Number of TCP flows per thread whose received segments are
+	 * coalesced before TCP input. Consecutive in-order data segments
+	 * of a flow in a burst of default_event_dispatcher() or
+	 * ofp_packet_input_multi() are merged into one packet, as far as
+	 * the packet buffer has room. 0 disables the coalescing.
+	 *
+	 * Default value is OFP_TCP_GRO_FLOWS.
+	 */
+	int tcp_gro_flows;
+
+	/**
+	 * Receive timestamps of sockets with OFP_SO_TIMESTAMPING.
+	 * 0: the software timestamp is taken when a datagram is queued
+	 * to the socket.
+	 * 1: it is taken when the receive burst of the datagram starts,
+	 * before any stack processing.
+	 * 2: as 1, and interfaces that can are configured to timestamp
+	 * all received packets for the hardware timestamp.
+	 *
+	 * Default value is OFP_RX_TIMESTAMP.
+	 */
+	int rx_timestamp;
+
 	/**
 	 * Maximum number of TCP PCBs.
 	 * Default value is OFP_NUM_PCB_TCP_MAX
 	 */
 	int pcb_tcp_max;
 
+	/**
+	 * Maximum number of sockets. Socket descriptors are in
+	 * [OFP_SOCK_NUM_OFFSET, OFP_SOCK_NUM_OFFSET + socket_max).
+	 * ofp_select() handles only the descriptors that fit in
+	 * ofp_fd_set, below OFP_SOCK_NUM_OFFSET + OFP_NUM_SOCKETS_MAX.
+	 *
+	 * Default value is OFP_NUM_SOCKETS_MAX.
+	 */
+	int socket_max;
+
+	/**
+	 * Number of socket events of OFP_SIGEV_QUEUE sockets that can
+	 * be queued at once, 0: OFP_SIGEV_QUEUE is not available.
+	 *
+	 * Default value is OFP_SOCK_EVENT_NUM.
+	 */
+	int sock_event_num;
+
+	/**
+	 * Maximum number of TCP connections being set up in the
+	 * syncache, i.e. SYNs received on listening sockets that are
+	 * waiting for the final ACK of the handshake.
+	 *
+	 * Default value is OFP_TCP_SYNCACHE_MAX.
+	 */
+	int tcp_syncache_max;
+
+	/**
+	 * Maximum number of IPv4 TCP connections in TIME_WAIT state per
+	 * PCB table (per core in share-nothing mode). Their state is kept
+	 * in a compact table apart from the PCBs, which are freed. When
+	 * the table is full, the oldest entry is reused.
+	 *
+	 * Default value is OFP_TCP_TW_MAX.
+	 */
+	int tcp_tw_max;
+
+	/**
+	 * Threads other than ODP worker threads that block in socket
+	 * calls sleep in the kernel until woken up. When 0, or in
+	 * worker threads, blocked threads yield the CPU in a loop.
+	 *
+	 * Default value is 1.
+	 */
+	odp_bool_t sleep_park;
+
+	/**
+	 * Share-nothing TCP mode. TCP PCB tables, syncache, timers and
+	 * TIME_WAIT queues are kept per core and socket, PCB, syncache and
+	 * socket buffer locks are not taken. Packet input is hashed over one queue per
+	 * worker core. A socket must only be used on the core that
+	 * receives the packets of its flows, e.g. by polling the input
+	 * queues of each core in its own thread.
+	 *
+	 * Default value is 0.
+	 */
+	odp_bool_t share_nothing;
+
+	/**
+	 * Core affine TCP timers outside of the share-nothing mode. The
+	 * timeouts of a connection are delivered to the timer queue of
+	 * the core that last armed them, see ofp_timer_queue_cpu(), if
+	 * its default dispatcher polls that queue, and to the shared
+	 * timer queue otherwise. The connection state then stays in the
+	 * cache of the core that processes its packets.
+	 *
+	 * Default value is 0.
+	 */
+	odp_bool_t tcp_timer_affinity;
+
+	/**
+	 * Maximum number of timer callbacks run for one timer event,
+	 * e.g. for one tick of the TCP callout wheel or of the one
+	 * second timers. The rest of the expired timers are run on the
+	 * following ticks, so that timer storms do not starve packet
+	 * processing.
+	 *
+	 * Default value is OFP_TIMER_BUDGET.
+	 */
+	int timer_budget;
+
+	/**
+	 * Number of free objects each thread caches per memory zone
+	 * of PCBs, sockets, tcpcbs, syncache entries and such. Caches
+	 * are refilled from and drained to the zone pool in bulk. The
+	 * pool of a zone has room for a full cache of each of the
+	 * odp_thread_count_max() threads. 0 disables the caches.
+	 *
+	 * Default value is OFP_UMA_CACHE_SIZE.
+	 */
+	int uma_cache_size;
+
 	struct pkt_pool_s {
 		/** Packet pool size; Default value is SHM_PKT_POOL_NB_PKTS */
 		int nb_pkts;
 
 		/**
-		 * Packet pool buffer size;
+		 * Packet pool buffer size, the longest packet without
+		 * segmentation. With seg_len set, the longest packet.
 		 * Default value is SHM_PKT_POOL_BUFFER_SIZE
 		 */
 		unsigned long buffer_size;
+
+		/**
+		 * Packet segment length. When set, the pool holds nb_pkts
+		 * segments of seg_len bytes and longer packets, up to
+		 * buffer_size, are made of several segments. Short and
+		 * jumbo frames then share the pool without every packet
+		 * taking buffer_size bytes. At least
+		 * OFP_PKT_POOL_SEG_LEN_MIN, smaller values are rounded up.
+		 *
+		 * Default value is 0, packets of a single buffer_size
+		 * segment.
+		 */
+		unsigned long seg_len;
+
+		/**
+		 * Give each interface created with ofp_ifnet_create() a
+		 * pool of nb_pkts packets of its own for the packets it
+		 * receives. The default pool is still used for packets
+		 * OFP allocates.
+		 *
+		 * The pool is initialized by the thread that creates the
+		 * interface. With the default Linux memory policy its
+		 * memory is then placed on the NUMA node of that thread.
+		 * To keep packet memory local to a NIC, create the
+		 * interface from a thread on the NIC's node.
+		 *
+		 * Default value is 0.
+		 */
+		odp_bool_t per_interface;
+
+		/**
+		 * Number of packets in a pool of short packets. Packets
+		 * OFP allocates, such as TCP ACKs, ARP requests, ICMP
+		 * errors and short socket sends, are taken from it when
+		 * they fit in small_size bytes, and from the default pool
+		 * otherwise or when it is empty.
+		 *
+		 * Default value is 0, no pool of short packets.
+		 */
+		int small_nb_pkts;
+
+		/**
+		 * Packet length of the pool of short packets.
+		 * Default value is OFP_PKT_POOL_SMALL_SIZE.
+		 */
+		unsigned long small_size;
 	} pkt_pool;
 
+	/**
+	 * Socket buffer parameters. A socket buffer takes a small ring
+	 * of 64 packets from a shared pool with its first packet and
+	 * returns it when drained, and takes a large ring when its size
+	 * limit allows more packets to be queued.
+	 */
+	struct sockbuf_s {
+		/**
+		 * Number of small rings shared by all socket buffers.
+		 * 0: two per socket, enough for all sockets to hold data
+		 * at the same time. Fewer rings fit more mostly idle
+		 * sockets in the same memory.
+		 * Default is OFP_SOCKBUF_SMALL_RINGS.
+		 */
+		int small_rings;
+		/**
+		 * Number of large rings shared by all socket buffers.
+		 * Default is OFP_SOCKBUF_RINGS.
+		 */
+		int rings;
+		/**
+		 * Number of packets in a large ring. Must be greater
+		 * than 64. Default is OFP_SOCKBUF_RING_LEN.
+		 */
+		int ring_len;
+		/**
+		 * Kilobytes by which all TCP socket buffers together may
+		 * grow beyond their initial size by receive and send
+		 * buffer autotuning, 0: no autotuning.
+		 * Default is OFP_SOCKBUF_AUTO_MEM_KB.
+		 */
+		int auto_mem_kb;
+	} sockbuf;
+
+	/**
+	 * Number of fast path interface ports, at most
+	 * OFP_FP_INTERFACE_LIMIT. The ports of the local, VXLAN and GRE
+	 * interfaces follow them. Default is OFP_FP_INTERFACE_MAX.
+	 */
+	int if_max;
+
+	/**
+	 * Number of per CPU tables, such as the timer wheels and the
+	 * share-nothing TCP and UDP tables. The ids of the CPUs that run
+	 * OFP threads must be below it. 0 sizes the tables for the
+	 * highest CPU id available to ODP. Default is 0.
+	 */
+	int cpu_max;
+
 	/**
 	 * Maximum number of VLANs. Default is OFP_NUM_VLAN.
 	 */
 	int num_vlan;
 
+	/**
+	 * Resolve VLAN interfaces through a two-level direct table
+	 * instead of the VLAN AVL trees. Costs up to 2 kB of shared
+	 * memory per VLAN. Default is 1.
+	 */
+	odp_bool_t vlan_table;
+
+	/**
+	 * Number of IPv4 addresses that interfaces may have in total
+	 * beyond the first OFP_NUM_IFNET_IP_ADDRS of each, such as the
+	 * local host routes of virtual IPs. Default is OFP_NUM_IFADDR.
+	 */
+	int num_ifaddr;
+
+	/**
+	 * Keep VLAN interfaces and IPv4 route rules in B+trees instead
+	 * of AVL trees. Default is 1.
+	 */
+	odp_bool_t use_btree;
+
 	/**
 	 * IPv4 route mtrie parameters.
 	 */
@@ -216,8 +729,89 @@ typedef struct ofp_global_param_t {
 		int routes;
 		/** Number of 8 bit mtrie nodes. Default is OFP_MTRIE_TABLE8_NODES. */
 		int table8_nodes;
+		/**
+		 * Number of 8 bit mtrie nodes added in a new shared memory
+		 * segment when the nodes run out. 0 disables growth.
+		 * Default is OFP_MTRIE_TABLE8_GROW.
+		 */
+		int table8_grow;
+		/**
+		 * Bits resolved by the first level table of each VRF: 8, 16
+		 * or 24. 24 gives the DIR-24-8 layout, which looks up most
+		 * routes in one access but takes 512 MB per VRF.
+		 * Default is OFP_MTRIE_FIRST_LEVEL.
+		 */
+		int first_level;
+		/**
+		 * Number of first level tables shared by the VRFs. A VRF
+		 * takes one when its first route is added and returns it
+		 * when its last route is removed, so VRFs without IPv4
+		 * routes take no table memory. 0 gives one per VRF.
+		 * Default is OFP_MTRIE_VRF_TABLES.
+		 */
+		int vrf_tables;
+		/**
+		 * Maximum number of routes of one VRF. 0 means no limit
+		 * besides the shared routes. Default is OFP_MTRIE_VRF_ROUTES.
+		 */
+		int vrf_routes;
+		/**
+		 * Maximum number of 8 bit mtrie nodes of one VRF. 0 means
+		 * no limit besides the shared nodes.
+		 * Default is OFP_MTRIE_VRF_TABLE8_NODES.
+		 */
+		int vrf_table8_nodes;
 	} mtrie;
 
+	/**
+	 * IPv6 route mtrie parameters.
+	 */
+	struct mtrie6_s {
+		/** Number of 8 bit mtrie nodes. Default is OFP_MTRIE6_TABLE8_NODES. */
+		int table8_nodes;
+	} mtrie6;
+
+	/**
+	 * IP reassembly parameters, applied to IPv4 and IPv6 separately.
+	 */
+	struct reass_s {
+		/**
+		 * Maximum number of datagrams being reassembled.
+		 * Default is OFP_REASS_MAX_QUEUES.
+		 */
+		int max_queues;
+		/**
+		 * Maximum number of fragments stored per datagram.
+		 * Default is OFP_REASS_MAX_FRAGS.
+		 */
+		int max_frags;
+		/**
+		 * Keep a separate reassembly table in each thread. Use
+		 * only when all fragments of a datagram are received by
+		 * the same thread, e.g. when the input queue is selected
+		 * by a hash of the source and destination addresses.
+		 *
+		 * Default value is 0.
+		 */
+		odp_bool_t per_thread;
+	} reass;
+
+	/**
+	 * VXLAN MAC address table parameters.
+	 */
+	struct vxlan_s {
+		/**
+		 * Number of MAC address to VTEP address mappings.
+		 * Default is OFP_VXLAN_MAC_ENTRIES.
+		 */
+		int mac_entries;
+		/**
+		 * Seconds after which a mapping that has not been learned
+		 * again is removed. Default is OFP_VXLAN_MAC_TIMEOUT.
+		 */
+		int mac_timeout;
+	} vxlan;
+
 	/**
 	 * Maximum number of VRFs. Default is OFP_NUM_VRF.
 	 *
@@ -235,6 +829,271 @@ typedef struct ofp_global_param_t {
 	 * IPsec parameters
 	 */
 	struct ofp_ipsec_param ipsec;
+
+	/**
+	 * Telemetry segment, see ofp_telemetry.h.
+	 */
+	struct telemetry_s {
+		/**
+		 * Update interval in milliseconds, at most 10000.
+		 * 0 disables the segment.
+		 * Default is OFP_TELEMETRY_INTERVAL_MS.
+		 */
+		int interval_ms;
+		/**
+		 * Name of the POSIX shared memory object.
+		 * Default is OFP_TELEMETRY_NAME.
+		 */
+		const char *name;
+	} telemetry;
+
+	/**
+	 * Warm restart, see ofp_warm_save().
+	 */
+	struct warm_restart_s {
+		/**
+		 * File of the saved state. When set, ofp_init_global()
+		 * restores the routes, next hop groups and ARP entries
+		 * saved in the file and ofp_term_global() saves them. A
+		 * missing file means a cold start. Default is NULL.
+		 */
+		const char *file;
+	} warm_restart;
+
+	/**
+	 * Slow path channel to the Linux stack, used when OFP is built
+	 * with the slow path.
+	 */
+	struct slow_path_s {
+		/**
+		 * Name prefix of an ODP packet I/O device per port, e.g.
+		 * "veth_sp" opens veth_sp0 for port 0. The Linux end of
+		 * the device, e.g. the veth peer, is named by linux_if.
+		 * Packets then move in bursts, without copies, with the
+		 * AF_XDP or packet mmap I/O of ODP. NULL: a TAP device
+		 * per port. Default is NULL.
+		 */
+		const char *pktio;
+		/**
+		 * Name prefix of the Linux interface of each port. OFP
+		 * sets its MAC address and MTU. Default is "fp".
+		 */
+		const char *linux_if;
+		/**
+		 * Policer rates of the slow path packet classes of an
+		 * interface, see enum ofp_sp_class, in packets per
+		 * second. 0: no limit. Defaults are OFP_SP_ROUTING_PPS,
+		 * OFP_SP_ARP_PPS, OFP_SP_ICMP_PPS and OFP_SP_OTHER_PPS.
+		 */
+		int routing_pps;
+		int arp_pps;
+		int icmp_pps;
+		int other_pps;
+		/**
+		 * Packets of a class let through back to back before the
+		 * rate applies. Default is OFP_SP_BURST.
+		 */
+		int burst;
+	} slow_path;
+
+	/**
+	 * Rate limit of the ICMP and ICMPv6 errors sent by a thread,
+	 * checked before an error is allocated.
+	 */
+	struct icmp_err_s {
+		/**
+		 * Errors per second, 0: no limit.
+		 * Default is OFP_ICMP_ERR_PPS.
+		 */
+		int pps;
+		/**
+		 * Errors of one type per second to one /24 or /48
+		 * prefix, 0: no limit. Prefixes that hash to the same
+		 * bucket share the rate. Default is OFP_ICMP_ERR_PREFIX_PPS.
+		 */
+		int prefix_pps;
+		/**
+		 * Errors sent back to back before the rates apply.
+		 * Default is OFP_ICMP_ERR_BURST.
+		 */
+		int burst;
+	} icmp_err;
+
+	/**
+	 * Adaptive back-off of idle polling threads, see ofp_poll_idle().
+	 */
+	struct idle_s {
+		/**
+		 * Empty polls that only spin before backing off.
+		 * Default is OFP_IDLE_SPIN.
+		 */
+		int spin;
+		/**
+		 * Empty polls after spinning that pause the CPU,
+		 * twice as long each time. Default is OFP_IDLE_PAUSE.
+		 */
+		int pause;
+		/**
+		 * Longest sleep in microseconds of an empty poll after
+		 * pausing, 0: back-off disabled and default_event_dispatcher()
+		 * waits in the scheduler. Default is OFP_IDLE_MAX_SLEEP_US.
+		 */
+		int max_sleep_us;
+	} idle;
+
+	/**
+	 * Egress traffic manager of the interfaces created with
+	 * pktout_mode ODP_PKTOUT_MODE_TM, see ofp_tm_vlan_tenant_set().
+	 */
+	struct tm_s {
+		/**
+		 * Rate of an interface in kbit/s, 0: not shaped.
+		 * Default is OFP_TM_RATE_KBPS.
+		 */
+		int rate_kbps;
+		/**
+		 * Bytes an interface sends back to back above its rate.
+		 * Default is OFP_TM_BURST.
+		 */
+		int burst;
+		/**
+		 * The classes of a tenant share its rate by weighted fair
+		 * queueing, class n with weight 2^n, instead of by strict
+		 * priority of the higher class. Default is FALSE.
+		 */
+		odp_bool_t wfq;
+	} tm;
+
+	/**
+	 * Access control lists, see ofp_acl.h.
+	 */
+	struct acl_s {
+		/**
+		 * Rules of an ACL. Default is 0 (no ACLs).
+		 */
+		int rules;
+		/**
+		 * Entries of the classifier of an ACL. A rule takes one
+		 * entry for each pair of the prefixes its port ranges
+		 * are split into. Default is 0 (8 per rule).
+		 */
+		int entries;
+	} acl;
+
+	/**
+	 * sFlow v5 packet sampling of the fast path interfaces.
+	 */
+	struct sflow_s {
+		/**
+		 * Mean number of packets per sample in each direction
+		 * of an interface, with a random skip between samples.
+		 * Default is 0 (no sampling).
+		 */
+		int rate;
+		/**
+		 * IPv4 address of the collector, reached through the
+		 * host stack. Default is NULL (no sampling).
+		 */
+		const char *collector;
+		/**
+		 * UDP port of the collector. Default is OFP_SFLOW_PORT.
+		 */
+		int port;
+		/**
+		 * IPv4 agent address of the datagrams.
+		 * Default is NULL (0.0.0.0).
+		 */
+		const char *agent;
+		/**
+		 * Bytes of a sampled packet exported, at most
+		 * OFP_SFLOW_HEADER_MAX. Default is OFP_SFLOW_HEADER_LEN.
+		 */
+		int header_len;
+	} sflow;
+
+	/**
+	 * Packet trace, see ofp_trace_dump().
+	 */
+	struct trace_s {
+		/**
+		 * Records kept per thread, rounded up to a power of two.
+		 * Default is 0 (no trace).
+		 */
+		int entries;
+		/**
+		 * Mask of the stages recorded, see enum ofp_trace_stage.
+		 * Default is OFP_TRACE_ALL.
+		 */
+		int stages;
+	} trace;
+
+	/**
+	 * Logging of OFP_ERR(), OFP_WARN(), OFP_INFO() and OFP_DBG().
+	 */
+	struct logging_s {
+		/**
+		 * Threads initialized with ofp_init_local() queue their
+		 * messages to a logger thread on the slow path core and
+		 * drop them when their queue is full.
+		 * Default is TRUE.
+		 */
+		odp_bool_t async;
+		/**
+		 * Messages logged per second from each call site, the
+		 * number suppressed is appended to the next one logged.
+		 * Default is OFP_LOG_RATE, 0: no limit.
+		 */
+		int rate;
+	} logging;
+
+	/**
+	 * Socket calls of other processes, see ofp_ipc_attach().
+	 */
+	struct ipc_s {
+		/**
+		 * Number of client processes that can attach, served by
+		 * a thread on the slow path core.
+		 * Default is 0 (disabled).
+		 */
+		int clients;
+	} ipc;
+
+	/**
+	 * Backpressure when the packet pools or UMA zones run low. A
+	 * timer compares the highest percentage in use of a pool or
+	 * zone with the watermarks. Above low, TCP advertises half
+	 * its receive window and only routing, ARP/ND and ICMP
+	 * packets are copied to the slow path. Above high, TCP
+	 * advertises a quarter, ICMP is not copied either and
+	 * received packets other than ARP, TCP and ICMP are dropped
+	 * on input. The packet pools are watched with pool statistics
+	 * of ODP 1.30 or later.
+	 */
+	struct mem_pressure_s {
+		/**
+		 * Low watermark in percent. Default is
+		 * OFP_MEM_PRESSURE_LOW_PCT, 0 disables the check.
+		 */
+		int low;
+		/**
+		 * High watermark in percent, 0: no high level. Default
+		 * is OFP_MEM_PRESSURE_HIGH_PCT.
+		 */
+		int high;
+		/**
+		 * Check interval in milliseconds. Default is
+		 * OFP_MEM_PRESSURE_INTERVAL_MS.
+		 */
+		int interval_ms;
+	} mem_pressure;
+
+	/**
+	 * OFP_MODULE_* bits of the protocol modules not used. A disabled
+	 * module is not initialized, its IP protocols go to the slow
+	 * path and its interfaces cannot be created. Modules left out
+	 * with configure options are always disabled. Default is 0.
+	 */
+	uint32_t modules_disabled;
 } ofp_global_param_t;
 
 /**
@@ -263,8 +1122,21 @@ typedef struct ofp_global_param_t {
  *     linux_core_id = integer
  *     pktin_mode = "direct" | "sched" | "queue" | "disabled"
  *     pktout_mode = "direct" | "queue" | "tm" | "disabled"
+ *     if_queues: {
+ *         rx = integer
+ *         tx = integer
+ *         hash = [ "ipv4" | "ipv4_udp" | "ipv4_tcp" |
+ *                  "ipv6" | "ipv6_udp" | "ipv6_tcp", ... ]
+ *     }
  *     sched_sync = "parallel" | "atomic" | ordered"
  *     sched_group = "all | "worker" | "control"
+ *     flow_queues = integer
+ *     flow_rebalance: {
+ *         threshold = integer
+ *         persist = integer
+ *         interval_ms = integer
+ *     }
+ *     steering = boolean
  *     enable_nl_thread = boolean
  *     arp: {
  *         entries = integer
@@ -272,18 +1144,87 @@ typedef struct ofp_global_param_t {
  *         entry_timeout = integer
  *         saved_pkt_timeout = integer
  *         check_interface = boolean
+ *         control_aging = boolean
+ *     }
+ *     nd6: {
+ *         entries = integer
+ *         hash_bits = integer
+ *         reachable_time = integer
+ *         entry_timeout = integer
  *     }
  *     evt_rx_burst_size = integer
  *     pkt_tx_burst_size = integer
+ *     pkt_tx_queue_map = "cpu" | "thread" | "flow"
+ *     pkt_tx_burst_adaptive = boolean
+ *     pkt_tx_hold_ns = integer
+ *     pkt_tx_pace_max = integer
+ *     pkt_tx_retry_max = integer
+ *     pkt_tx_retry_ns = integer
+ *     pkt_vector_mode = boolean
+ *     pktin_vector: {
+ *         size = integer
+ *         tmo_ns = integer
+ *         num = integer
+ *     }
+ *     flow_cache_size = integer
+ *     conntrack: {
+ *         entries = integer
+ *         tcp_timeout = integer
+ *         udp_timeout = integer
+ *         timeout = integer
+ *     }
+ *     tcp_gro_flows = integer
+ *     rx_timestamp = integer
  *     pcb_tcp_max = integer
+ *     socket_max = integer
+ *     sock_event_num = integer
+ *     tcp_syncache_max = integer
+ *     tcp_tw_max = integer
+ *     sleep_park = boolean
+ *     share_nothing = boolean
+ *     tcp_timer_affinity = boolean
+ *     timer_budget = integer
+ *     uma_cache_size = integer
  *     pkt_pool: {
  *         nb_pkts = integer
  *         buffer_size = integer
+ *         seg_len = integer
+ *         per_interface = boolean
+ *         small_nb_pkts = integer
+ *         small_size = integer
+ *     }
+ *     sockbuf: {
+ *         small_rings = integer
+ *         rings = integer
+ *         ring_len = integer
+ *         auto_mem_kb = integer
  *     }
+ *     if_max = integer
+ *     cpu_max = integer
  *     num_vlan = integer
+ *     vlan_table = boolean
+ *     num_ifaddr = integer
+ *     use_btree = boolean
  *     mtrie: {
  *         routes = integer
  *         table8_nodes = integer
+ *         table8_grow = integer
+ *         first_level = integer
+ *         vrf_tables = integer
+ *         vrf_routes = integer
+ *         vrf_table8_nodes = integer
+ *     }
+ *     mtrie6: {
+ *         table8_nodes = integer
+ *     }
+ *     reass: {
+ *         max_queues = integer
+ *         max_frags = integer
+ *         per_thread = boolean
+ *     }
+ *     vxlan: {
+ *         mac_entries = integer
+ *         mac_timeout = integer
  *     }
  *     num_vrf = integer
  *     chksum_offload: {
@@ -293,14 +1234,71 @@ typedef struct ofp_global_param_t {
  *         ipv4_tx_ena = true
  *         udp_tx_ena = true
  *         tcp_tx_ena = true
+ *         tcp_tso_ena = true
  *     }
  *     ipsec: {
  *         max_num_sp = integer
  *         max_num_sa = integer
  *         max_inbound_spi = integer
+ *         burst_size = integer
  *         inbound_op_mode = "sync" | "async" | "inline" | "disabled"
  *         outbound_op_mode = "sync" | "async" | "inline" | "disabled"
  *     }
+ *     warm_restart: {
+ *         file = string
+ *     }
+ *     slow_path: {
+ *         pktio = string
+ *         linux_if = string
+ *         routing_pps = integer
+ *         arp_pps = integer
+ *         icmp_pps = integer
+ *         other_pps = integer
+ *         burst = integer
+ *     }
+ *     icmp_err: {
+ *         pps = integer
+ *         prefix_pps = integer
+ *         burst = integer
+ *     }
+ *     idle: {
+ *         spin = integer
+ *         pause = integer
+ *         max_sleep_us = integer
+ *     }
+ *     tm: {
+ *         rate_kbps = integer
+ *         burst = integer
+ *         wfq = boolean
+ *     }
+ *     acl: {
+ *         rules = integer
+ *         entries = integer
+ *     }
+ *     sflow: {
+ *         rate = integer
+ *         collector = string
+ *         port = integer
+ *         agent = string
+ *         header_len = integer
+ *     }
+ *     trace: {
+ *         entries = integer
+ *         stages = integer
+ *     }
+ *     logging: {
+ *         async = boolean
+ *         rate = integer
+ *     }
+ *     ipc: {
+ *         clients = integer
+ *     }
+ *     mem_pressure: {
+ *         low = integer
+ *         high = integer
+ *         interval_ms = integer
+ *     }
+ *     modules_disabled = [ "igmp" | "ipsec" | "vxlan" | "gre", ... ]
  * }
  * </pre>
  *
@@ -373,6 +1371,36 @@ int ofp_init_local(void);
  */
 int ofp_term_global(void);
 
+/**
+ * Save the warm restart state
+ *
+ * Write the IPv4 routes via gateways, the ECMP next hop groups they
+ * use and the resolved ARP entries to file, to be restored by
+ * ofp_init_global() of the next process that has warm_restart.file set
+ * to it. Routes of interface addresses are not saved, they are added
+ * again when the interfaces are configured. The file is replaced
+ * atomically and may be saved at any time, for example before an
+ * upgrade.
+ *
+ * @param file Name of the file
+ *
+ * @retval 0 on success
+ * @retval -1 on failure
+ */
+int ofp_warm_save(const char *file);
+
+/**
+ * Remove the restored routes that were not added again
+ *
+ * Restored routes forward packets until the routing daemon has
+ * synchronized. A route added again replaces the restored one. Call
+ * this when the daemon has added its routes, to delete the rest.
+ *
+ * @retval >=0 number of routes removed
+ * @retval -1 on failure
+ */
+int ofp_warm_reconcile(void);
+
 /**
  * Thread local OFP termination
  *
@@ -230,6 +230,30 @@ struct ofp_ippseudo {
 	uint16_t		ippseudo_len;	/* protocol length */
 };
 
+/**
+ * Rewrite an IPv4 address with incremental checksum updates.
+ *
+ * Sets the source or destination address and updates the IPv4 header
+ * checksum. Unless the packet is a non-first fragment, also updates the
+ * TCP or UDP checksum, which covers the addresses through the pseudo
+ * header. The L4 header must follow the IP header in contiguous memory.
+ *
+ * @param ip   IPv4 header.
+ * @param addr New address in network byte order.
+ */
+void ofp_ip_rewrite_src(struct ofp_ip *ip, uint32_t addr);
+void ofp_ip_rewrite_dst(struct ofp_ip *ip, uint32_t addr);
+
+/**
+ * Rewrite a TCP or UDP port with an incremental checksum update.
+ *
+ * @param ip   IPv4 header. The L4 header must follow it in contiguous
+ *             memory.
+ * @param port Port field in the TCP or UDP header.
+ * @param new  New port in network byte order.
+ */
+void ofp_ip_rewrite_port(struct ofp_ip *ip, uint16_t *port, uint16_t new);
+
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
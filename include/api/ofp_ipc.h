@@ -0,0 +1,60 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef __OFP_IPC_H__
+#define __OFP_IPC_H__
+
+#include <odp_api.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+/**
+ * @file
+ *
+ * @brief Socket access from other processes
+ *
+ * A stack process initialized with ofp_global_param_t.ipc.clients runs
+ * the fast path and exports a ring of socket operations per client
+ * slot. An application process, with its own ODP instance and without
+ * ofp_init_global(), attaches a thread to a slot. The socket calls of
+ * that thread, ofp_socket(), ofp_bind(), ofp_listen(), ofp_accept(),
+ * ofp_connect(), ofp_send(), ofp_sendto(), ofp_recv(), ofp_recvfrom(),
+ * ofp_shutdown() and ofp_close(), are then executed by the stack
+ * process. A client uses only its own sockets, which the stack closes
+ * when the client exits or crashes.
+ *
+ * Blocking calls wait in the client, the stack does not block.
+ * Sending and receiving are limited to OFP_IPC_DATA_MAX bytes per
+ * operation; ofp_send() and ofp_sendto() split larger buffers, other
+ * socket calls are not forwarded.
+ */
+
+/**
+ * Attach the calling thread to a client slot of a stack process
+ *
+ * @param stack ODP instance of the stack process, as logged by it
+ * @param client Client slot, less than ofp_global_param_t.ipc.clients
+ *
+ * @retval 0 on success
+ * @retval -1 on failure, the slot is in use or the stack not found
+ */
+int ofp_ipc_attach(odp_instance_t stack, int client);
+
+/**
+ * Close the sockets of the calling thread and detach it from its slot
+ *
+ * @retval 0 on success
+ * @retval -1 if the thread is not attached
+ */
+int ofp_ipc_detach(void);
+
+#if __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+#endif /* __OFP_IPC_H__ */
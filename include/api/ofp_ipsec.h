@@ -274,6 +274,11 @@ typedef enum ofp_ipsec_sa_status_t {
 typedef struct ofp_ipsec_sa_info_t {
 	ofp_ipsec_sa_status_t status; /** SA status */
 	ofp_ipsec_sa_param_t  param;  /** Creation parameters of the SA */
+	/** Packets and bytes before encapsulation or after decapsulation.
+	 *  Threads add their counts in batches, at the latest when they
+	 *  call ofp_send_pending_pkt(). */
+	uint64_t packets;
+	uint64_t bytes;
 } ofp_ipsec_sa_info_t;
 
 /***********************************************************************
@@ -675,6 +680,19 @@ void ofp_ipsec_sp_get_info(ofp_ipsec_sp_handle sp, ofp_ipsec_sp_info_t *info);
  */
 void ofp_ipsec_packet_event(odp_event_t ev, odp_queue_t queue);
 
+/**
+ * Handle multiple IPsec packet events.
+ *
+ * Like ofp_ipsec_packet_event() for num events received together
+ * through the same queue.
+ *
+ * @param ev       Event handles
+ * @param num      Number of events
+ * @param queue    Handle of the queue through which the events were received
+ */
+void ofp_ipsec_packet_event_multi(odp_event_t ev[], int num,
+				  odp_queue_t queue);
+
 /**
  * Handle an IPsec packet event.
  *
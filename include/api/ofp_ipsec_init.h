@@ -19,6 +19,12 @@
 #define OFP_IPSEC_MAX_NUM_SA 8
 #define OFP_IPSEC_MAX_NUM_SP 8
 #define OFP_IPSEC_MAX_INBOUND_SPI 100
+#define OFP_IPSEC_BURST_SIZE 1
+
+/**
+ * Maximum value of the burst_size initialization parameter
+ */
+#define OFP_IPSEC_BURST_MAX 64
 
 /**
  * IPsec initialization parameters
@@ -31,6 +37,13 @@ struct ofp_ipsec_param {
 
 	/**
 	 * Outbound operation mode. Default is ODP_IPSEC_OP_MODE_SYNC.
+	 *
+	 * In inline mode packets of tunnel mode SAs are encapsulated and
+	 * sent by ODP directly to the interface towards the tunnel
+	 * endpoint, with the Ethernet header of the flow cache of the
+	 * thread (see ofp_global_param_t.flow_cache_size). Until the
+	 * endpoint is in the cache, and for transport mode SAs, packets
+	 * are processed as in async mode.
 	 */
 	odp_ipsec_op_mode_t outbound_op_mode;
 
@@ -49,6 +62,18 @@ struct ofp_ipsec_param {
 	 */
 	uint32_t max_inbound_spi;
 
+	/**
+	 * Maximum number of packets submitted to ODP IPsec at once in
+	 * async and inline operation mode. A thread collects the packets
+	 * it processes until it has burst_size of them or it calls
+	 * ofp_send_pending_pkt(), which the default dispatcher does after
+	 * every received burst. Value 1 submits each packet separately.
+	 *
+	 * Values from 1 to OFP_IPSEC_BURST_MAX. Default is
+	 * OFP_IPSEC_BURST_SIZE.
+	 */
+	uint32_t burst_size;
+
 	/**
 	 * Event queue for signaling the completion of asynchronous
 	 * inbound IPsec operations in async and inline operation mode.
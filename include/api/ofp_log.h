@@ -28,7 +28,10 @@
 
 /*
  * These logging macros can be used to send a message to the logging
- * destination. Currently, this is stderr.
+ * destination. Currently, this is stderr, written by a logger thread
+ * when ofp_global_param_t.logging.async is set. Each call site logs
+ * at most ofp_global_param_t.logging.rate messages per second, the
+ * number suppressed is appended to the next message of the site.
  *
  * Log line format:
  *
@@ -96,18 +99,22 @@ static inline int ofp_debug_logging_enabled(void)
 #define __FILENAME__ \
 	(strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 
+struct ofp_log_site {
+	uint64_t window;
+	uint32_t count;
+	uint32_t suppressed;
+};
+
+void ofp_log_printf(struct ofp_log_site *site, int level, const char *file,
+		    int line, const char *fmt, ...)
+	__attribute__((format(printf, 5, 6)));
+
 #define _OFP_LOG(level, fmt, ...) do {					\
+		static struct ofp_log_site _ofp_log_site;		\
 		if (level > ofp_loglevel)				\
 			break;						\
-		fprintf(stderr, "%s %d %d:%u %s:%d] " fmt "\n",		\
-			(level == OFP_LOG_ERROR)   ? "E" :		\
-			(level == OFP_LOG_WARNING) ? "W" :		\
-			(level == OFP_LOG_INFO)    ? "I" :		\
-			(level == OFP_LOG_DEBUG)   ? "D" : "?",		\
-			ofp_timer_ticks(0),				\
-			odp_cpu_id(), (unsigned int) pthread_self(),	\
-			__FILENAME__, __LINE__,				\
-			##__VA_ARGS__);					\
+		ofp_log_printf(&_ofp_log_site, level, __FILENAME__,	\
+			       __LINE__, fmt, ##__VA_ARGS__);		\
 	} while (0)
 
 #if __GNUC__ >= 4
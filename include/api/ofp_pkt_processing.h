@@ -21,6 +21,68 @@ struct ofp_ifnet;
 
 int default_event_dispatcher(void *arg);
 
+/**
+ * Arguments of direct_event_dispatcher()
+ */
+struct ofp_direct_dispatcher_arg {
+	/** Index of the worker, 0 ... num_workers - 1 */
+	int worker;
+	/** Number of workers sharing the input queues */
+	int num_workers;
+	/** Also process timers and other scheduled events */
+	odp_bool_t process_timers;
+};
+
+/**
+ * Event dispatcher of interfaces in the direct input mode
+ *
+ * Polls the input queues of the worker on all interfaces opened with
+ * ODP_PKTIN_MODE_DIRECT, as given by ofp_ifnet_pktin_queues(), with
+ * ofp_packet_input_burst(). Scheduled events, such as timeouts and
+ * packets of loop queues, are polled without waiting between the
+ * bursts if process_timers is set; one worker at least should set it.
+ * Idle polling is handled by ofp_poll_idle(). Runs until
+ * ofp_stop_processing() is called.
+ *
+ * @param arg    Pointer to struct ofp_direct_dispatcher_arg
+ */
+int direct_event_dispatcher(void *arg);
+
+/**
+ * Receive and process a burst from a direct mode input queue
+ *
+ * Receives up to num packets from pktin and processes them with
+ * ofp_packet_input_multi() and ofp_eth_vlan_processing(), then sends
+ * the packets pending as default_event_dispatcher() does after each
+ * burst.
+ *
+ * @param pktin  Input queue
+ * @param pkt    Scratch space for num packets
+ * @param num    Maximum number of packets to receive
+ *
+ * @retval Number of packets received
+ * @retval <0 on failure
+ */
+int ofp_packet_input_burst(odp_pktin_queue_t pktin, odp_packet_t pkt[],
+			   int num);
+
+/**
+ * Account and back off an idle polling loop.
+ *
+ * Call once per loop round after polling for packets or events, with
+ * the number received and odp_cpu_cycles() read before the poll. The
+ * poll and the back-off count as idle cycles of the thread, the rest
+ * of the round as busy. After idle.spin empty polls in a row, the
+ * thread pauses the CPU for twice as long on each of the next
+ * idle.pause polls and then sleeps, from 1 us doubling up to
+ * idle.max_sleep_us, until a poll returns work. With max_sleep_us 0
+ * only the cycles are counted.
+ *
+ * @param num    Packets or events received by the poll
+ * @param start  odp_cpu_cycles() before the poll
+ */
+void ofp_poll_idle(int num, uint64_t start);
+
 /**
  * Return the minimum size of the user area that must be present in all
  * ODP packets passed to OFP.
@@ -41,6 +103,34 @@ uint32_t ofp_packet_min_user_area(void);
 enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
 	odp_queue_t in_queue, ofp_pkt_processing_func pkt_func);
 
+/**
+ * Input a burst of packets and process them using the function supplied
+ * by the caller.
+ *
+ * When pkt_func is ofp_eth_vlan_processing(), the burst is processed in
+ * stages: L2 parsing of all packets first, then IPv4 header validation,
+ * route lookup and forwarding, each over the whole burst. Other
+ * processing functions are called on one packet at a time as in
+ * ofp_packet_input().
+ *
+ * The packets of a flow keep their order within the burst. Packets of
+ * different protocols may not: ARP and other non-IP packets are
+ * processed first, then IPv4 and last IPv6. The order between bursts
+ * processed by different threads depends on the synchronization of the
+ * input queues, as with ofp_packet_input().
+ *
+ * @param pkt      Packets to process. The array is used as scratch
+ *                 space and its content is undefined on return.
+ * @param num      Number of packets in the array.
+ * @param in_queue ODP queue from which the packets were dequeued, or
+ *                 ODP_QUEUE_INVALID.
+ * @param pkt_func Packet processing function.
+ *
+ * @see ofp_global_param_t.pkt_vector_mode
+ */
+void ofp_packet_input_multi(odp_packet_t pkt[], int num,
+	odp_queue_t in_queue, ofp_pkt_processing_func pkt_func);
+
 /**
  * Process a packet, starting with L2.
  *
@@ -108,6 +198,20 @@ enum ofp_return_code ofp_tcp4_processing(odp_packet_t *pkt);
 enum ofp_return_code ofp_send_frame(struct ofp_ifnet *dev, odp_packet_t pkt);
 enum ofp_return_code ofp_send_pending_pkt(void);
 
+/**
+ * Set the output queue of the calling thread.
+ *
+ * Packets sent by the thread to an interface with N output queues go
+ * to queue (queue % N), instead of the queue selected by
+ * ofp_global_param_t::pkt_tx_queue_map. With OFP_TX_QUEUE_MAP_FLOW
+ * packets with a flow hash still go to the queue of the hash.
+ * Packets already collected are sent to their original queue.
+ *
+ * @param queue Queue index, or -1 to restore the pkt_tx_queue_map
+ *              selection
+ */
+void ofp_send_queue_set(int queue);
+
 enum ofp_return_code ofp_ip_send(odp_packet_t pkt,
 				 struct ofp_nh_entry *nh_param);
 enum ofp_return_code ofp_ip6_send(odp_packet_t pkt,
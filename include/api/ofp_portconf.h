@@ -69,6 +69,25 @@ struct ofp_ifnet *ofp_get_ifnet_pktio(odp_pktio_t pktio);
 odp_queue_t ofp_pktio_spq_get(odp_pktio_t pktio);
 odp_queue_t ofp_pktio_loopq_get(odp_pktio_t pktio);
 
+/*
+ * Classes of slow path packets, from the highest priority. Each has
+ * its own queue and policer on an interface.
+ */
+enum ofp_sp_class {
+	OFP_SP_ROUTING = 0,	/* OSPF, BGP, BFD, RIP, LDP, PIM, VRRP */
+	OFP_SP_ARP,		/* ARP and IPv6 neighbor discovery */
+	OFP_SP_ICMP,		/* Other ICMP and ICMPv6 */
+	OFP_SP_OTHER,
+	OFP_SP_CLASS_MAX
+};
+
+/*
+ * Packets of each class dropped by the slow path policer of an
+ * interface, or when the queue of the class was full.
+ */
+int ofp_ifnet_sp_drops(uint16_t port, uint16_t vlan,
+		       uint64_t drops[OFP_SP_CLASS_MAX]);
+
 enum ofp_portconf_ip_type {
 	OFP_PORTCONF_IP_TYPE_IP_ADDR = 0,
 	OFP_PORTCONF_IP_TYPE_P2P,
@@ -37,6 +37,7 @@ struct ofp_route_msg {
 #define	OFP_RTF_LOCAL		0x200000/* route represents a local address */
 #define	OFP_RTF_BROADCAST	0x400000/* route represents a bcast address */
 #define	OFP_RTF_MULTICAST	0x800000/* route represents a mcast address */
+#define	OFP_RTF_MULTIPATH	0x1000000/* gw is an ECMP next hop group */
 	uint32_t dst;
 	uint32_t masklen;
 	uint32_t gw;
@@ -49,6 +50,36 @@ struct ofp_route_msg {
 
 int32_t ofp_set_route_msg(struct ofp_route_msg *msg);
 
+/*
+ * Apply num route messages in order. Runs of consecutive OFP_ROUTE_ADD
+ * messages are sorted by VRF and prefix and installed in batches, each
+ * under one route lock hold, with one flow cache flush and one RCU epoch
+ * advance per run. Either all routes of a run are added or none, an
+ * invalid message rejects its run. Returns 0 if all messages were
+ * applied, -1 otherwise.
+ */
+int32_t ofp_set_route_msgs(struct ofp_route_msg *msgs, int num);
+
+/*
+ * ECMP next hop groups. A route added with OFP_RTF_MULTIPATH and gw set
+ * to a group spreads its flows over the members of the group by a hash
+ * of the addresses, protocol and ports. Changing the members of a group
+ * moves only the flows of removed members and the share of added ones.
+ */
+struct ofp_nh_group_member {
+	uint32_t gw;
+	uint16_t port;
+	uint16_t vlan;
+};
+
+/* Return a new empty group, or -1 if there are none left */
+int32_t ofp_nh_group_alloc(void);
+/* Replace the members of a group. Routes using it see the change at once. */
+int ofp_nh_group_set(uint16_t vrf, int32_t group,
+		     const struct ofp_nh_group_member *members, int num);
+/* Free a group when the last route using it is deleted */
+int ofp_nh_group_del(int32_t group);
+
 static inline int32_t ofp_set_route_params(uint32_t type, uint16_t vrf,
 					   uint16_t vlan, uint32_t port,
 					   uint32_t dst, uint32_t masklen,
@@ -114,11 +145,30 @@ static inline int32_t ofp_set_route6_params(uint32_t type, uint16_t vrf,
 #define OFP_SHOW_ROUTES     1
 void ofp_show_routes(int fd, int what);
 
+/*
+ * Copy of the IPv4 (OFP_ROUTE_ADD, by VRF) and IPv6 (OFP_ROUTE6_ADD)
+ * routes as the messages that would add them, taken under one short
+ * hold of the route lock, to be read in pages without the lock.
+ * Returns NULL if out of memory.
+ */
+struct ofp_route_snapshot;
+struct ofp_route_snapshot *ofp_route_snapshot_create(void);
+/*
+ * Copy up to num next routes of the snapshot to msgs. Returns the
+ * number of routes copied, 0 at the end of the snapshot.
+ */
+int ofp_route_snapshot_read(struct ofp_route_snapshot *snap,
+			    struct ofp_route_msg *msgs, int num);
+void ofp_route_snapshot_free(struct ofp_route_snapshot *snap);
+
 /* ROUTE operations */
 struct ofp_nh_entry *ofp_get_next_hop(uint16_t vrf,
 		uint32_t addr, uint32_t *flags);
 struct ofp_nh6_entry *ofp_get_next_hop6(uint16_t vrf,
 		uint8_t *addr, uint32_t *flags);
+/* Look up the next hops of num addresses of the same VRF at once. */
+void ofp_get_next_hop_bulk(uint16_t vrf, const uint32_t addr[],
+		struct ofp_nh_entry *nh[], int num);
 
 /* ARP */
 struct ofp_ifnet;
@@ -126,6 +176,12 @@ int ofp_add_mac(struct ofp_ifnet *dev, uint32_t addr, uint8_t *mac);
 int ofp_get_mac(struct ofp_ifnet *dev, struct ofp_nh_entry *nh_data,
 		uint32_t addr, uint32_t is_link_local, uint8_t *mac_out);
 void ofp_add_mac6(struct ofp_ifnet *dev, uint8_t *addr, uint8_t *mac);
+/*
+ * Age the ARP table if an ageing pass is due, with arp.control_aging
+ * of ofp_global_param_t set. Returns the time in microseconds until
+ * the next call.
+ */
+uint64_t ofp_arp_age(void);
 
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
@@ -140,6 +140,64 @@ typedef	__ofp_uid_t		ofp_uid_t;
 #define	OFP_SO_PROTOCOL	0x1016		/* get socket protocol (Linux name) */
 #define	OFP_SO_PROTOTYPE	OFP_SO_PROTOCOL	/* alias for OFP_SO_PROTOCOL (SunOS name) */
 #define OFP_SO_L2INFO		0x1017		/* PROMISCUOUS_INET MAC addrs and tags */
+#define	OFP_SO_MAX_PACING_RATE	0x1018		/* TCP send rate limit, uint64_t bytes/s */
+#define	OFP_SO_TIMESTAMPING	0x1019		/* OFP_SOF_TIMESTAMPING_* flags */
+#define	OFP_SO_TIMESTAMPING_TX	0x101a		/* get last struct ofp_sock_txtime */
+#define	OFP_SO_BUSY_POLL	0x101b		/* struct ofp_sock_busy_poll */
+#define	OFP_SO_RXRING		0x101c		/* int, lock-free TCP receive */
+
+/*
+ * Flags of OFP_SO_TIMESTAMPING, for datagram sockets.
+ *
+ * RX_SOFTWARE: ofp_recvmsg() and ofp_recvmmsg() add an OFP_SCM_TIMESTAMPING
+ * control message of struct ofp_scm_timestamping with the time the
+ * datagram was received, see ofp_global_param_t.rx_timestamp.
+ * RX_HARDWARE: the message also has the interface timestamp, if any.
+ * TX_SOFTWARE: sent datagrams are numbered from 1 and the time the last
+ * one was passed to an interface output queue is read with the
+ * OFP_SO_TIMESTAMPING_TX option.
+ *
+ * Times are in nanoseconds, software ones of odp_time_global(), and 0
+ * if not available.
+ */
+#define	OFP_SOF_TIMESTAMPING_RX_SOFTWARE	0x1
+#define	OFP_SOF_TIMESTAMPING_RX_HARDWARE	0x2
+#define	OFP_SOF_TIMESTAMPING_TX_SOFTWARE	0x4
+
+struct ofp_scm_timestamping {
+	uint64_t	sw_ns;		/* stack receive time */
+	uint64_t	hw_ns;		/* odp_packet_ts() of the interface */
+};
+
+struct ofp_sock_txtime {
+	uint32_t	id;		/* number of the datagram, 0 if none */
+	uint64_t	ns;		/* time it was queued to the interface */
+};
+
+/*
+ * OFP_SO_BUSY_POLL: blocking receive, send and accept calls on the
+ * socket, or ofp_epoll_wait() on an epoll instance, receive and process
+ * packets of pktin with ofp_packet_input_burst() instead of sleeping,
+ * so that input, protocol processing and the application run in the
+ * calling thread. The queue is one of ofp_ifnet_pktin_queues() of an
+ * interface in the direct input mode that no dispatcher polls, and
+ * the thread must have called ofp_init_local(). The wait ends on the
+ * socket timeout as usual. Set enable to 0 to sleep again.
+ */
+struct ofp_sock_busy_poll {
+	int		enable;
+	odp_pktin_queue_t pktin;
+};
+
+/*
+ * OFP_SO_RXRING: received data of a TCP socket is passed from the
+ * protocol input, which still sends the ACKs, to the reading thread
+ * through a lock-free single-producer single-consumer ring, so that
+ * ofp_recv() copies and ofp_recv_pkt() takes the data on the
+ * application core without the socket buffer lock. OFP_MSG_PEEK and
+ * OFP_MSG_OOB are not supported. A nonzero value enables the ring, zero disables it if it
+ * is empty and fails with OFP_EBUSY otherwise.
+ */
 
 /*
  * Structure used for manipulating linger option.
@@ -149,6 +207,13 @@ struct ofp_linger {
 	int	l_linger;		/* linger time */
 };
 
+/*
+ * Argument of OFP_SO_ACCEPTFILTER on a listening TCP socket. Filters:
+ * "dataready" passes a connection to accept() once it has data or is
+ * closed, "httpready" once the first line of the request has arrived.
+ * Until then the connection waits on the incomplete queue. An empty
+ * option value removes the filter.
+ */
 struct accept_filter_arg {
 	char	af_name[16];
 	char	af_arg[256-16];
@@ -226,6 +291,11 @@ struct sockproto {
 #define	SOMAXCONN	128
 #endif
 
+struct ofp_iovec {
+	void   *iov_base;	/* Base address. */
+	size_t	iov_len;	/* Length. */
+};
+
 /*
  * Message header for recvmsg and sendmsg calls.
  * Used value-result for recvmsg, value only for sendmsg.
@@ -240,6 +310,14 @@ struct ofp_msghdr {
 	int		 msg_flags;		/* flags on received message */
 };
 
+/*
+ * Message header for ofp_recvmmsg() and ofp_sendmmsg().
+ */
+struct ofp_mmsghdr {
+	struct ofp_msghdr msg_hdr;		/* message header */
+	unsigned int	 msg_len;		/* bytes transferred */
+};
+
 #define	OFP_MSG_OOB		0x1		/* process out-of-band data */
 #define	OFP_MSG_PEEK		0x2		/* peek at incoming message */
 #define	OFP_MSG_DONTROUTE	0x4		/* send without using routing tables */
@@ -255,6 +333,7 @@ struct ofp_msghdr {
 #define	OFP_MSG_SOCALLBCK	0x10000		/* for use by socket callbacks - ofp_soreceive (TCP) */
 #define	OFP_MSG_NOSIGNAL	0x20000		/* do not generate SIGPIPE on EOF */
 #define	OFP_MSG_HOLE_BREAK	0x40000		/* stop at and indicate hole boundary */
+#define	OFP_MSG_FASTOPEN	0x80000		/* connect and send data in the SYN */
 
 /*
  * Header for ancillary data objects in msg_control buffer.
@@ -348,6 +427,7 @@ struct ofp_sockcred {
 #define	OFP_SCM_TIMESTAMP	0x02		/* timestamp (struct timeval) */
 #define	OFP_SCM_CREDS	0x03		/* process creds (struct cmsgcred) */
 #define	OFP_SCM_BINTIME	0x04		/* timestamp (struct bintime) */
+#define	OFP_SCM_TIMESTAMPING	0x05	/* struct ofp_scm_timestamping */
 
 /*
  * 4.3 compat sockaddr, move to compat file later
@@ -410,6 +490,10 @@ struct ofp_sock_sigval {
 	int		sockfd2;
 	int		event;
 	odp_packet_t	pkt;
+	/* OFP_SIGEV_BATCH: the packets received in the burst, owned by
+	 * the callback, and pkt is ODP_PACKET_INVALID */
+	odp_packet_t	*pkts;
+	int		num;
 };
 
 union ofp_sigval {          /* Data passed with notification */
@@ -421,6 +505,13 @@ union ofp_sigval {          /* Data passed with notification */
 #define OFP_SIGEV_HOOK 1
 #define OFP_SIGEV_SIGNAL 2
 #define OFP_SIGEV_THREAD 3
+/* As OFP_SIGEV_HOOK, but OFP_EVENT_RECV is raised once per socket at
+ * the end of the receive burst, with up to OFP_SOCK_EVENT_BATCH
+ * packets */
+#define OFP_SIGEV_BATCH 4
+/* Each event is an ODP event enqueued to ofp_sigev_queue instead of a
+ * call. See ofp_socket_event(). */
+#define OFP_SIGEV_QUEUE 5
 
 struct ofp_sigevent {
 	int          ofp_sigev_notify; /* Notification method */
@@ -435,6 +526,8 @@ struct ofp_sigevent {
 	   (SIGEV_THREAD) */
 	ofp_pid_t        ofp_sigev_notify_thread_id;
 	/* ID of thread to signal (SIGEV_THREAD_ID) */
+	odp_queue_t  ofp_sigev_queue;
+	/* Queue of the events (OFP_SIGEV_QUEUE) */
 };
 
 struct ofp_timeval {
@@ -451,9 +544,37 @@ int  OFP_FD_ISSET(int fd, ofp_fd_set *set);
 void OFP_FD_SET(int fd, ofp_fd_set *set);
 void OFP_FD_ZERO(ofp_fd_set *set);
 
+/*
+ * Only the sockets woken up since they were last found not ready are
+ * checked, so the cost grows with the number of ready sockets rather
+ * than with nfds. exceptfds is not used.
+ */
 int	ofp_select(int nfds, ofp_fd_set *readfds, ofp_fd_set *writefds,
 		ofp_fd_set *exceptfds, struct ofp_timeval *timeout);
 
+#define OFP_POLLIN	0x001
+#define OFP_POLLPRI	0x002
+#define OFP_POLLOUT	0x004
+#define OFP_POLLERR	0x008
+#define OFP_POLLHUP	0x010
+#define OFP_POLLNVAL	0x020
+
+typedef unsigned int ofp_nfds_t;
+
+struct ofp_pollfd {
+	int	fd;
+	short	events;
+	short	revents;
+};
+
+/*
+ * As poll(2), for OFP sockets, with the readiness tracking of
+ * ofp_select(). Entries with a negative fd are ignored. OFP_POLLPRI is
+ * not reported. The timeout is in milliseconds, negative to wait
+ * forever.
+ */
+int	ofp_poll(struct ofp_pollfd *fds, ofp_nfds_t nfds, int timeout);
+
 int	ofp_socket(int, int, int);
 int	ofp_socket_vrf(int, int, int, int);
 int	ofp_accept(int, struct ofp_sockaddr *, ofp_socklen_t *);
@@ -471,27 +592,83 @@ ofp_ssize_t	ofp_send(int, const void *, size_t, int);
 ofp_ssize_t	ofp_sendto(int, const void *,
 		size_t, int, const struct ofp_sockaddr *, ofp_socklen_t);
 
+/*
+ * Receive or send up to vlen messages at once. Return the number of
+ * messages transferred, or -1 with ofp_errno set if none was.
+ * ofp_recvmmsg() blocks until the first message is received, unless
+ * the socket is non-blocking or OFP_MSG_DONTWAIT is given, and returns
+ * the messages already queued after that. Ancillary data is not
+ * supported, and on stream sockets only the first iovec of each
+ * message is used.
+ */
+int	ofp_recvmmsg(int, struct ofp_mmsghdr *, unsigned int, int);
+int	ofp_sendmmsg(int, struct ofp_mmsghdr *, unsigned int, int);
+
+/*
+ * Zero-copy receive and send on TCP and UDP sockets.
+ * ofp_recv_pkt() hands over up to num packets queued on the socket,
+ * blocking like ofp_recv(). The payload of pkt[i] starts at offset
+ * off[i] and is len[i] bytes long; the caller owns and frees the
+ * packets. ofp_udp_packet_parse() may be used on UDP packets to get
+ * the source address. Returns the number of packets, 0 at end of
+ * stream, or -1 with ofp_errno set.
+ * ofp_send_pkt() sends the data of each packet, allocated from the OFP
+ * packet pool, on a connected socket. All packets are consumed. Returns
+ * the number of packets sent, or -1 with ofp_errno set if none was.
+ */
+int	ofp_recv_pkt(int, odp_packet_t *, uint32_t *, uint32_t *, int, int);
+int	ofp_send_pkt(int, odp_packet_t *, int, int);
+
+/*
+ * Send nbytes of the regular file fd, or up to its end if nbytes is 0,
+ * starting at offset on the connected stream socket s, as sendfile(2)
+ * on FreeBSD. A file sealed with F_SEAL_SHRINK, e.g. a memfd, is mapped
+ * and queued to the socket without a copy through a user buffer. Other
+ * files could be truncated by another process while mapped, which would
+ * raise SIGBUS, so they are read in 64 kB chunks and a truncation ends
+ * the send at the new end of the file. The headers and trailers of hdtr
+ * are sent before and after the file. The number of bytes sent is
+ * stored in sbytes. Returns 0, or -1 with ofp_errno set. Flags are
+ * ignored.
+ */
+int	ofp_sendfile(int fd, int s, ofp_off_t offset, size_t nbytes,
+		     struct ofp_sf_hdtr *hdtr, ofp_off_t *sbytes, int flags);
+
 int	ofp_setsockopt(int, int, int, const void *, ofp_socklen_t);
 int	ofp_getsockopt(int, int, int, void *, ofp_socklen_t *);
 
 int	ofp_ioctl(int, int, ...);
 
 int	ofp_socket_sigevent(struct ofp_sigevent *);
+/*
+ * The socket event of an OFP_SIGEV_QUEUE socket carried by ev, NULL
+ * if ev is not a socket event. An OFP_EVENT_RECV event has the
+ * received packet in pkt, owned by the application. When no event can
+ * be queued, a received packet is added to the socket buffer. The
+ * event is freed with ofp_socket_event_free().
+ */
+struct ofp_sock_sigval *ofp_socket_event(odp_event_t ev);
+void	ofp_socket_event_free(odp_event_t ev);
 void	*ofp_udp_packet_parse(odp_packet_t, int *,
 				struct ofp_sockaddr *,
 				ofp_socklen_t *);
 ofp_ssize_t ofp_udp_pkt_sendto(int, odp_packet_t,
 				   const struct ofp_sockaddr *, ofp_socklen_t);
 
+/*
+ * Receive into and send from the iovecs of a message. On stream
+ * sockets, the data of all iovecs is queued into the fewest packets
+ * and segmented by TCP, and received data is scattered over the
+ * iovecs. Control data is not supported and msg_controllen is set
+ * to 0 on receive.
+ */
+ofp_ssize_t	ofp_recvmsg(int, struct ofp_msghdr *, int);
+ofp_ssize_t	ofp_sendmsg(int, const struct ofp_msghdr *, int);
+
 #if 0 /* Not implemented */
 int	ofp_getpeername(int, struct ofp_sockaddr * __restrict, ofp_socklen_t * __restrict);
 int	ofp_getsockname(int, struct ofp_sockaddr * __restrict, ofp_socklen_t * __restrict);
 
-ofp_ssize_t	ofp_recvmsg(int, struct ofp_msghdr *, int);
-ofp_ssize_t	ofp_sendmsg(int, const struct ofp_msghdr *, int);
-int	ofp_sendfile(int, int, ofp_off_t, size_t, struct ofp_sf_hdtr *,
-		ofp_off_t *, int);
-
 int	ofp_setfib(int);
 int	ofp_sockatmark(int);
 int	ofp_socketpair(int, int, int, int *);
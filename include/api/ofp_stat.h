@@ -16,18 +16,96 @@
 
 #define OFP_LATENCY_SLICES 64
 
+/*
+ * Reasons a packet is dropped by the stack, as X(name, description).
+ * NAME becomes OFP_DROP_NAME in enum ofp_drop_reason. New reasons are added
+ * at the end of the list.
+ */
+#define OFP_DROP_REASONS(X)						\
+	X(INPUT, "input total")						\
+	X(ETH_PARSE, "bad ethernet header")				\
+	X(VLAN_NO_IF, "no vlan interface")				\
+	X(IP_BAD_HDR, "bad ip header")					\
+	X(IP_TTL, "ip ttl exceeded")					\
+	X(IP_IPSEC, "ipsec policy")					\
+	X(IP_NO_ROUTE, "no route")					\
+	X(IP_MTU, "mtu exceeded")					\
+	X(ARP_BAD, "bad arp packet")					\
+	X(ARP_PENDING_FULL, "arp pending queue full")			\
+	X(ARP_UNRESOLVED, "arp unresolved")				\
+	X(SP_ENQ, "slow path enqueue")					\
+	X(TX_PKTOUT, "pktout send")					\
+	X(SP_SEND, "slow path send to linux")				\
+	X(LAG_DOWN, "no lag member up")					\
+	X(CT_DROP, "conntrack action drop")				\
+	X(ACL_DENY, "acl deny")						\
+	X(MEM_PRESSURE, "memory pressure")				\
+	X(TX_RETRY_FULL, "tx retry backlog full")			\
+	X(TX_RETRY_AGE, "tx retry timeout")
+
+#define OFP_DROP_REASON_ENUM(_name, _descr) OFP_DROP_##_name,
+
+enum ofp_drop_reason {
+	OFP_DROP_REASONS(OFP_DROP_REASON_ENUM)
+	OFP_DROP_REASON_MAX
+};
+
+/*
+ * Profiled stages of the packet path, as X(name, description). Cycles
+ * are recorded when OFP_STAT_COMPUTE_PROFILE is set.
+ */
+#define OFP_PROF_STAGES(X)						\
+	X(ETH_CLASSIFY, "eth/vlan classify")				\
+	X(IP_INPUT, "ip input")						\
+	X(ROUTE_LOOKUP, "route lookup")					\
+	X(ARP_RESOLVE, "arp resolve")					\
+	X(L4_INPUT, "l4 input")						\
+	X(HOOK, "hooks")						\
+	X(TX_FLUSH, "tx flush")
+
+#define OFP_PROF_STAGE_ENUM(_name, _descr) OFP_PROF_##_name,
+
+enum ofp_prof_stage {
+	OFP_PROF_STAGES(OFP_PROF_STAGE_ENUM)
+	OFP_PROF_STAGE_MAX
+};
+
+/* Slots of the log2 cycle histogram of a stage */
+#define OFP_PROF_SLICES 32
+
 struct ofp_packet_stat {
+	/* Entries of per_thr[], odp_thread_count_max() */
+	uint32_t num_thr;
 	struct ODP_ALIGNED_CACHE {
 		uint64_t rx_fp;
 		uint64_t tx_fp;
 		uint64_t rx_sp;
 		uint64_t tx_sp;
 		uint64_t tx_eth_frag;
+		uint64_t tx_tcp_gso;
+		/* UDP sends of OFP_UDP_SEGMENT cut into datagrams */
+		uint64_t tx_udp_gso;
 		uint64_t rx_ip_frag;
 		uint64_t rx_ip_reass;
+		uint64_t rx_tcp_gro;
+		/* Datagrams chained to a record by OFP_UDP_GRO */
+		uint64_t rx_udp_gro;
+		uint64_t tx_paced;
+		/* Packets kept for a retry on a full output queue */
+		uint64_t tx_retry;
+		/* ARP set cache fills skipped while the set was written */
+		uint64_t arp_fill_busy;
+		/* Cycles spent polling empty queues and backing off */
+		uint64_t idle_cycles;
+		uint64_t busy_cycles;
 		uint64_t input_latency[OFP_LATENCY_SLICES];
 		odp_time_t last_input_cycles;
-	} per_thr[ODP_THREAD_COUNT_MAX];
+		uint64_t drop[OFP_DROP_REASON_MAX];
+		/* Cycles, calls and log2 cycle histogram per stage */
+		uint64_t prof_cycles[OFP_PROF_STAGE_MAX];
+		uint64_t prof_count[OFP_PROF_STAGE_MAX];
+		uint64_t prof_hist[OFP_PROF_STAGE_MAX][OFP_PROF_SLICES];
+	} per_thr[];
 };
 
 struct ofp_perf_stat {
@@ -39,13 +117,57 @@ struct ofp_perf_stat {
 struct ofp_packet_stat *ofp_get_packet_statistics(void);
 struct ofp_perf_stat *ofp_get_perf_statistics(void);
 
+/*
+ * Stats: Sum the drop counters of all threads into drop[]. Counters are
+ * read without locking, the result is a snapshot that may lag slightly.
+ */
+void ofp_get_drop_statistics(uint64_t drop[OFP_DROP_REASON_MAX]);
+
+/* Stats: Fast path packet and byte counters of an interface or queue */
+struct ofp_if_stat {
+	uint64_t rx_pkts;
+	uint64_t rx_bytes;
+	uint64_t tx_pkts;
+	uint64_t tx_bytes;
+};
+
+/*
+ * Stats: Sum the counters of all threads for interface port.vlan, which
+ * may also be a GRE, VXLAN or loopback interface. Return -1 if there is
+ * no such interface.
+ */
+int ofp_get_if_statistics(int port, uint16_t vlan, struct ofp_if_stat *st);
+
+/*
+ * Stats: Sum the counters of all threads per queue of a fast path port.
+ * The rx counters of queue[i] are those of input queue i and the tx
+ * counters those of output queue i. Return the number of entries filled,
+ * at most num, or -1 if port is not a fast path port.
+ */
+int ofp_get_if_queue_statistics(int port, struct ofp_if_stat queue[],
+				int num);
+
+/* Stats: Description of a drop reason, NULL if out of range */
+const char *ofp_drop_reason_str(int reason);
+
+/* Stats: Description of a profiled stage, NULL if out of range */
+const char *ofp_prof_stage_str(int stage);
+
 /* Stats: configure*/
 #define OFP_STAT_COMPUTE_LATENCY 1
 #define OFP_STAT_COMPUTE_PERF 2
+#define OFP_STAT_COMPUTE_PROFILE 4
 
 void ofp_set_stat_flags(unsigned long int flags);
 unsigned long int ofp_get_stat_flags(void);
 
+/*
+ * Stats: Print the memory reserved and used per subsystem to fd: shared
+ * memory blocks, UMA zone capacity, use and peak, packet pool occupancy
+ * and route table nodes per VRF.
+ */
+void ofp_show_memory(int fd);
+
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
@@ -104,6 +104,10 @@ struct ofp_tcphdr {
 #define OFP_TCPOLEN_TSTAMP_APPA	(OFP_TCPOLEN_TIMESTAMP+2) /* appendix A */
 #define OFP_TCPOPT_SIGNATURE		19	/* Keyed MD5: RFC 2385 */
 #define OFP_TCPOLEN_SIGNATURE		18
+#define OFP_TCPOPT_FAST_OPEN		34	/* TCP Fast Open: RFC 7413 */
+#define OFP_TCPOLEN_FAST_OPEN_EMPTY	2	/* cookie request */
+#define OFP_TCPOLEN_FAST_OPEN_MIN	6
+#define OFP_TCPOLEN_FAST_OPEN_MAX	18
 
 /* Miscellaneous constants */
 #define OFP_MAX_SACK_BLKS		6	/* Max # SACK blocks stored at receiver side */
@@ -170,6 +174,34 @@ struct ofp_tcphdr {
 #define OFP_TCP_KEEPCNT	0x400	/* L,N number of keepalives before close */
 #define OFP_TCP_REASSDL	0x800	/* wait this long for missing segments */
 #define OFP_TCP_CORK	0x1000	/* don't send partial messages */
+#define OFP_TCP_FASTOPEN	0x2000	/* accept data in SYNs (RFC 7413) */
+#define OFP_TCP_DEFER_ACCEPT	0x4000	/* accept only once data arrives */
+#define OFP_TCP_TXTLS_ENABLE	0x8000	/* send data as TLS records */
+
+/*
+ * OFP_TCP_TXTLS_ENABLE: after its TLS handshake the application hands
+ * the AES-GCM write keys of the connection to the stack, which from then
+ * on frames all data sent with ofp_send(), ofp_sendfile() and
+ * ofp_send_pkt() into TLS application data records and encrypts them.
+ * Each packet of ofp_send_pkt() becomes one record and may carry at most
+ * OFP_TLS_MAX_PLAINTEXT bytes. Setting the option again installs new
+ * keys, e.g. after a TLS 1.3 key update. The records of data already
+ * sent stay as they were. Getting the option returns 1 if records are
+ * sent. Only the sending direction is handled.
+ */
+#define OFP_TLS_VMAJOR		3
+#define OFP_TLS_VMINOR_12	3	/* TLS 1.2 */
+#define OFP_TLS_VMINOR_13	4	/* TLS 1.3 */
+#define OFP_TLS_MAX_PLAINTEXT	16384
+
+struct ofp_tls_enable {
+	uint8_t		cipher_key[32];	/* AES-128-GCM or AES-256-GCM key */
+	uint32_t	cipher_key_len;	/* 16 or 32 */
+	uint8_t		iv[12];		/* TLS 1.2: 4 byte salt, TLS 1.3: IV */
+	uint8_t		rec_seq[8];	/* next record number, big endian */
+	uint8_t		tls_vmajor;	/* OFP_TLS_VMAJOR */
+	uint8_t		tls_vminor;	/* OFP_TLS_VMINOR_12 or _13 */
+};
 
 #define	OFP_TCP_CA_NAME_MAX	16	/* max congestion control name length */
 
@@ -241,8 +273,18 @@ struct ofp_tcp_info {
 	uint32_t	tcpi_rcv_ooopack;	/* Out-of-order packets */
 	uint32_t	tcpi_snd_zerowin;	/* Zero-sized windows sent */
 
+	/* OFP extensions, times in usecs. */
+	uint32_t	tcpi_rcv_ooodrop;	/* Out-of-order packets dropped */
+	uint64_t	tcpi_pacing_rate;	/* Bytes per second, 0: none */
+	uint64_t	tcpi_delivery_rate;	/* Bytes acked per second */
+	uint64_t	tcpi_bytes_sent;	/* Data bytes sent */
+	uint64_t	tcpi_bytes_retrans;	/* Data bytes retransmitted */
+	uint64_t	tcpi_app_limited;	/* Sending limited by the app */
+	uint64_t	tcpi_rwnd_limited;	/* ... by the receive window */
+	uint64_t	tcpi_cwnd_limited;	/* ... by the congestion window */
+
 	/* Padding to grow without breaking ABI. */
-	uint32_t	__tcpi_pad[26];		/* Padding. */
+	uint32_t	__tcpi_pad[9];		/* Padding. */
 };
 
 /*
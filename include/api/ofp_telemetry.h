@@ -0,0 +1,210 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/**
+ * @file
+ *
+ * Telemetry segment layout. When enabled with the telemetry global
+ * parameters, OFP copies its counters periodically into a POSIX shared
+ * memory object that other processes can map read-only, e.g.
+ *
+ *   fd = shm_open(OFP_TELEMETRY_NAME, O_RDONLY, 0);
+ *   hdr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+ *
+ * The header only depends on <stdint.h> so that collectors can be built
+ * without ODP or OFP.
+ *
+ * Each record is written under its own sequence counter: the counter is
+ * odd while the record is being updated. Readers copy the record between
+ * ofp_telemetry_read_begin() and ofp_telemetry_read_retry() and repeat
+ * until the latter returns 0. Writers never wait for readers.
+ *
+ * A reader should check magic and version and use the offsets and sizes
+ * of the header to locate the records. New fields are only added to the
+ * end of records, and records only grow within a major version.
+ *
+ * Version 2 adds the fast path counters of struct ofp_telemetry_if and
+ * the interface records of struct ofp_telemetry_ifnet.
+ */
+
+#ifndef __OFP_TELEMETRY_H__
+#define __OFP_TELEMETRY_H__
+
+#include <stdint.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+/** Default name of the shared memory object */
+#define OFP_TELEMETRY_NAME "/ofp_telemetry"
+
+#define OFP_TELEMETRY_MAGIC 0x5446504fU /* "OFPT" */
+#define OFP_TELEMETRY_VERSION 2
+
+/** Size of the per thread drop counter array, see enum ofp_drop_reason */
+#define OFP_TELEMETRY_DROP_MAX 32
+/** Size of the per thread latency histogram */
+#define OFP_TELEMETRY_LATENCY_SLICES 64
+/** Maximum number of input and output queues reported per interface */
+#define OFP_TELEMETRY_QUEUE_MAX 64
+#define OFP_TELEMETRY_IFNAMSIZ 32
+
+/** Segment header, at offset 0 */
+struct ofp_telemetry_hdr {
+	uint32_t magic;
+	uint32_t version;
+	/** Size of the whole segment */
+	uint64_t size;
+	/** Process id of the OFP application */
+	uint64_t pid;
+	/** Update interval */
+	uint64_t interval_ns;
+	/** Time of the last update in ns, ODP global time */
+	uint64_t update_ns;
+	/** Number of completed updates */
+	uint64_t updates;
+
+	uint32_t num_thread;
+	uint32_t thread_size;
+	uint64_t thread_offset;
+
+	uint32_t num_if;
+	uint32_t if_size;
+	uint64_t if_offset;
+
+	/** Number of valid entries in the drop[] arrays */
+	uint32_t num_drop_reason;
+	uint32_t num_latency_slice;
+
+	/** Since version 2 */
+	uint32_t num_ifnet;
+	uint32_t ifnet_size;
+	uint64_t ifnet_offset;
+};
+
+/** Per ODP thread packet counters, see struct ofp_packet_stat */
+struct ofp_telemetry_thread {
+	uint32_t seq;
+	uint32_t thread_id;
+	uint64_t rx_fp;
+	uint64_t tx_fp;
+	uint64_t rx_sp;
+	uint64_t tx_sp;
+	uint64_t tx_eth_frag;
+	uint64_t tx_tcp_gso;
+	uint64_t rx_ip_frag;
+	uint64_t rx_ip_reass;
+	uint64_t rx_tcp_gro;
+	uint64_t tx_paced;
+	uint64_t drop[OFP_TELEMETRY_DROP_MAX];
+	uint64_t input_latency[OFP_TELEMETRY_LATENCY_SLICES];
+} __attribute__((aligned(64)));
+
+/** Packet counters of one interface queue */
+struct ofp_telemetry_queue {
+	uint64_t octets;
+	uint64_t packets;
+	uint64_t discards;
+	uint64_t errors;
+};
+
+/** Fast path counters of one interface or interface queue */
+struct ofp_telemetry_fp {
+	uint64_t rx_pkts;
+	uint64_t rx_bytes;
+	uint64_t tx_pkts;
+	uint64_t tx_bytes;
+};
+
+/** Per port counters, as reported by the packet IO and by the fast path */
+struct ofp_telemetry_if {
+	uint32_t seq;
+	/** Non-zero when the entry describes an interface in use */
+	uint32_t valid;
+	char name[OFP_TELEMETRY_IFNAMSIZ];
+	uint32_t port;
+	uint32_t num_in_queue;
+	uint32_t num_out_queue;
+	uint32_t pad;
+	uint64_t in_octets;
+	uint64_t in_ucast_pkts;
+	uint64_t in_discards;
+	uint64_t in_errors;
+	uint64_t out_octets;
+	uint64_t out_ucast_pkts;
+	uint64_t out_discards;
+	uint64_t out_errors;
+	struct ofp_telemetry_queue in_queue[OFP_TELEMETRY_QUEUE_MAX];
+	struct ofp_telemetry_queue out_queue[OFP_TELEMETRY_QUEUE_MAX];
+
+	/** Since version 2 */
+	uint32_t num_fp_queue;
+	uint32_t pad2;
+	struct ofp_telemetry_fp fp;
+	/** rx of input queue i and tx of output queue i */
+	struct ofp_telemetry_fp fp_queue[OFP_TELEMETRY_QUEUE_MAX];
+} __attribute__((aligned(64)));
+
+/**
+ * Fast path counters of a port, VLAN, GRE, VXLAN or loopback interface.
+ * Entries are packed in the order of the interfaces, a reader identifies
+ * an interface by port and vlan.
+ */
+struct ofp_telemetry_ifnet {
+	uint32_t seq;
+	/** Non-zero when the entry describes an interface in use */
+	uint32_t valid;
+	char name[OFP_TELEMETRY_IFNAMSIZ];
+	uint32_t port;
+	uint32_t vlan;
+	struct ofp_telemetry_fp fp;
+} __attribute__((aligned(64)));
+
+static inline const struct ofp_telemetry_thread *
+ofp_telemetry_thread(const struct ofp_telemetry_hdr *hdr, uint32_t i)
+{
+	return (const struct ofp_telemetry_thread *)((const char *)hdr +
+		hdr->thread_offset + (uint64_t)i * hdr->thread_size);
+}
+
+static inline const struct ofp_telemetry_if *
+ofp_telemetry_if(const struct ofp_telemetry_hdr *hdr, uint32_t i)
+{
+	return (const struct ofp_telemetry_if *)((const char *)hdr +
+		hdr->if_offset + (uint64_t)i * hdr->if_size);
+}
+
+static inline const struct ofp_telemetry_ifnet *
+ofp_telemetry_ifnet(const struct ofp_telemetry_hdr *hdr, uint32_t i)
+{
+	return (const struct ofp_telemetry_ifnet *)((const char *)hdr +
+		hdr->ifnet_offset + (uint64_t)i * hdr->ifnet_size);
+}
+
+/** Start reading a record with sequence counter seq */
+static inline uint32_t ofp_telemetry_read_begin(const uint32_t *seq)
+{
+	uint32_t s;
+
+	while ((s = __atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1)
+		;
+	return s;
+}
+
+/** Return non-zero if the record changed while it was being read */
+static inline int ofp_telemetry_read_retry(const uint32_t *seq,
+					   uint32_t start)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(seq, __ATOMIC_RELAXED) != start;
+}
+
+#if __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+#endif /* __OFP_TELEMETRY_H__ */
@@ -20,6 +20,8 @@ odp_timer_t ofp_timer_start(uint64_t tmo_us, ofp_timer_callback callback,
 		       void *arg, int arglen);
 int ofp_timer_cancel(odp_timer_t tim);
 void ofp_timer_handle(odp_event_t buf);
+/** Handle a burst of timeout events, prefetching their timer data ahead. */
+void ofp_timer_handle_multi(odp_event_t ev[], int num);
 int ofp_timer_ticks(int timer_num);
 odp_timer_pool_t ofp_timer(int timer_num);
 
@@ -30,6 +32,35 @@ odp_timer_t ofp_timer_start_cpu_id(uint64_t tmo_us, ofp_timer_callback callback,
 /** Get timer queue for a cpu id. */
 odp_queue_t ofp_timer_queue_cpu(int cpu_id);
 
+/**
+ * Timer state embedded in the object it times. Starting and stopping
+ * the timer only links it into or out of the timing wheel of a CPU,
+ * without ODP buffer, timeout or timer allocations and without the
+ * lock of long timeouts. Timeouts of OFP_TIMER_MAX_US or more are
+ * rounded up to whole seconds.
+ */
+struct ofp_timer_entry {
+	uint64_t priv[6];
+};
+
+/** Initialize t before it is first started. */
+void ofp_timer_entry_init(struct ofp_timer_entry *t);
+/**
+ * Start, or restart, t to call callback in tmo_us microseconds on the
+ * wheel of cpu_id, -1 for the calling CPU. The callback gets a pointer
+ * to a copy of arg. The object of t must stay until t is stopped or
+ * the callback has run.
+ */
+void ofp_timer_entry_start(struct ofp_timer_entry *t, uint64_t tmo_us,
+			   ofp_timer_callback callback, void *arg, int cpu_id);
+/**
+ * Stop t. Returns 1 if t was pending, 0 if it was not started or its
+ * callback has been taken to run.
+ */
+int ofp_timer_entry_stop(struct ofp_timer_entry *t);
+/** Nonzero if t is started and its callback has not been taken to run. */
+int ofp_timer_entry_pending(const struct ofp_timer_entry *t);
+
 #if __GNUC__ >= 4
 #pragma GCC visibility pop
 #endif
@@ -42,19 +42,17 @@ struct ofp_nh_entry {
 	uint32_t gw;
 	uint16_t port;
 	uint16_t vlan;
+	/* Next hop group of OFP_RTF_MULTIPATH routes */
 	uint32_t arp_ent_idx;
 };
 
-struct pkt6_entry;
-OFP_SLIST_HEAD(pkt6_list, pkt6_entry);
-
 struct ofp_nh6_entry {
 	uint32_t flags;
 	uint8_t  gw[16];
 	uint16_t port;
 	uint16_t vlan;
-	uint8_t  mac[6];
-	struct pkt6_list pkt6_hold;
+	/* Neighbour cache entry of the gateway, a lookup hint */
+	uint32_t nd6_idx;
 };
 
 #if __GNUC__ >= 4
@@ -61,6 +61,21 @@ struct ofp_udphdr {
  * User-settable options (used with setsockopt).
  */
 #define OFP_UDP_ENCAP			0x01
+/*
+ * Payload per datagram (int). A larger send is cut into datagrams of
+ * this size, the last one may be shorter. 0 disables. Also accepted
+ * as an OFP_IPPROTO_UDP control message of uint16_t for one send.
+ */
+#define OFP_UDP_SEGMENT			103
+/*
+ * Coalesce received datagrams (int, boolean). Datagrams of one source
+ * and size arriving in one receive burst are queued as one record. The
+ * receive call returns them together; ofp_recvmsg() and ofp_recvmmsg()
+ * add an OFP_IPPROTO_UDP/OFP_UDP_GRO control message of the datagram
+ * size (uint16_t) to a record of more than one. The last datagram of a
+ * record may be shorter.
+ */
+#define OFP_UDP_GRO			104
 
 
 /*
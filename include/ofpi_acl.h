@@ -0,0 +1,47 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_ACL_H__
+#define __OFPI_ACL_H__
+
+#include <odp_api.h>
+#include "api/ofp_acl.h"
+#include "api/ofp_types.h"
+
+/*
+ * ACLs compiled into a tuple space classifier: the entries of the
+ * rules are grouped by their masks, one hash table per mask, and a
+ * packet is looked up in the tables in the order of their best rule
+ * until no table can hold a better match. Each hook point has two
+ * classifiers, the one in use and the one the next commit compiles.
+ */
+
+/* Classifier in use at each point, 0: none. NULL without ACLs. */
+extern __thread odp_atomic_u32_t *ofp_acl_active;
+
+static inline int ofp_acl_enabled(enum ofp_acl_point point)
+{
+	return odp_unlikely(ofp_acl_active != NULL) &&
+		odp_atomic_load_u32(&ofp_acl_active[point]) != 0;
+}
+
+/* Apply the ACL of point to an IPv4 packet received in VRF vrf */
+enum ofp_return_code ofp_acl_apply(enum ofp_acl_point point,
+				   odp_packet_t pkt, uint16_t vrf);
+
+/* Apply the ACL of point to num IPv4 packets, res set for each */
+void ofp_acl_apply_burst(enum ofp_acl_point point, odp_packet_t pkt[],
+			 const uint16_t vrf[], int num,
+			 enum ofp_return_code res[]);
+
+void ofp_acl_print(int fd);
+
+int ofp_acl_lookup_shared_memory(void);
+void ofp_acl_init_prepare(void);
+int ofp_acl_init_global(void);
+int ofp_acl_term_global(void);
+
+#endif /* __OFPI_ACL_H__ */
@@ -38,16 +38,20 @@ struct arp_entry {
 #else /* ! OFP_USE_LIBCK */
 #include "ofpi_queue.h"
 
-struct pkt_entry {
+/* Packets waiting for the reply, per entry. A power of two. */
+#define ARP_ENTRY_PENDING 8
+
+/*
+ * A waiting packet. Workers enqueue without the table lock: a slot is
+ * claimed by moving its state to ARP_SLOT_BUSY, the oldest packet of a
+ * full queue is dropped.
+ */
+struct arp_pending_slot {
+	odp_atomic_u32_t state;
 	odp_packet_t pkt;
 	struct ofp_nh_entry *nh;
-	OFP_SLIST_ENTRY(pkt_entry) next;
 };
 
-struct pkt_list {
-	struct pkt_entry *slh_first;
-}; /* OFP_SLIST_HEAD */
-
 union arp_entry_flags {
 	uint8_t all;
 
@@ -61,16 +65,21 @@ union arp_entry_flags {
 struct arp_entry {
 	struct arp_key key;
 
+	/* Updated by ofp_arp_age_cb() from the seen bits of the threads */
 	odp_time_t usetime;
-	odp_timer_t usetime_upd_tmo;
-	odp_rwlock_t usetime_rwlock;
 
 	union arp_entry_flags flags;
 	uint64_t macaddr;
-	struct pkt_list pkt_list_head;
-	odp_timer_t pkt_tmo;
 	uint32_t ref_count;
 
+	/* Enqueue position, number of packets, and their timeout */
+	odp_atomic_u32_t pending_tail;
+	odp_atomic_u32_t pending_num;
+	odp_atomic_u32_t pending_armed;
+	uint32_t pending_gen;
+	struct ofp_timer_entry pkt_tmo;
+	struct arp_pending_slot pending[ARP_ENTRY_PENDING];
+
 	OFP_STAILQ_ENTRY(arp_entry) next;
 } ODP_ALIGNED_CACHE;
 #endif /* OFP_USE_LIBCK */
@@ -110,7 +119,7 @@ int ofp_arp_ipv4_insert_entry(uint32_t ipv4_addr, unsigned char *ll_addr,
 			      uint16_t vrf, odp_bool_t is_complete,
 			      odp_bool_t is_manual,
 			      uint32_t *entry_idx_out,
-			      struct pkt_list *send_list);
+			      odp_bool_t send_pending);
 #endif /* OFP_USE_LIBCK */
 int ofp_arp_ipv4_insert(uint32_t ipv4_addr, unsigned char *ll_addr,
 			struct ofp_ifnet *dev, odp_bool_t is_manual);
@@ -132,6 +141,10 @@ enum ofp_return_code ofp_arp_save_ipv4_pkt(odp_packet_t pkt,
 
 void ofp_arp_show_table(int fd);
 void ofp_arp_show_saved_packets(int fd);
+/* Call func for each complete entry, with the lock of its set held */
+void ofp_arp_walk(void (*func)(void *arg, uint16_t vrf, uint32_t addr,
+				const uint8_t *mac, odp_bool_t is_manual),
+		  void *arg);
 void ofp_arp_age_cb(void *arg);
 int ofp_arp_init_tables(void);
 void ofp_arp_init_tables_pkt_list(void);
@@ -0,0 +1,79 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_BTREE_H__
+#define __OFPI_BTREE_H__
+
+#include <odp_api.h>
+#include "ofpi_brlock.h"
+
+/*
+ * Ordered map of opaque keys stored in a B+tree. Keys live in the
+ * leaves, which are chained for in-order iteration, so that a lookup
+ * touches one node of a few cache lines per level instead of one
+ * node per comparison.
+ *
+ * The interface follows the AVL tree of ofpi_avl.h. Modifications take
+ * the tree lock for writing and lookups for reading. Iteration callbacks
+ * must not modify the tree.
+ */
+
+#define OFP_BTREE_KEYS 14
+
+struct ofp_btree_node {
+	uint16_t num;
+	uint16_t leaf;
+	void *keys[OFP_BTREE_KEYS];
+	union {
+		/* Internal node: keys[i] is the least key below child[i + 1] */
+		struct ofp_btree_node *child[OFP_BTREE_KEYS + 1];
+		/* Leaf node */
+		struct ofp_btree_node *next;
+	};
+};
+
+typedef int (*ofp_btree_compare_fun)(void *compare_arg, void *a, void *b);
+typedef int (*ofp_btree_iter_fun)(void *key, void *iter_arg);
+typedef int (*ofp_btree_free_key_fun)(void *key);
+
+typedef struct ofp_btree {
+	struct ofp_btree_node *root;
+	uint32_t height;
+	uint32_t length;
+	ofp_btree_compare_fun compare_fun;
+	void *compare_arg;
+	struct ofp_btree *next;
+	ofp_brlock_t lock_rw;
+} ofp_btree;
+
+ofp_btree *ofp_btree_new(ofp_btree_compare_fun compare_fun, void *compare_arg);
+void ofp_btree_free(ofp_btree *tree, ofp_btree_free_key_fun free_key_fun);
+
+/* Return 0 on success, -1 if the key exists or memory ran out */
+int ofp_btree_insert(ofp_btree *tree, void *key);
+int ofp_btree_delete(ofp_btree *tree, void *key,
+		     ofp_btree_free_key_fun free_key_fun);
+
+int ofp_btree_get_by_key(ofp_btree *tree, void *key, void **value_address);
+/* Least key greater than or equal to key */
+int ofp_btree_get_item_by_key_least(ofp_btree *tree, void *key,
+				    void **value_address);
+void *ofp_btree_get_first(ofp_btree *tree);
+
+int ofp_btree_iterate_inorder(ofp_btree *tree, ofp_btree_iter_fun iter_fun,
+			      void *iter_arg);
+/* Iterate in order from the least key greater than or equal to key */
+int ofp_btree_iterate_from(ofp_btree *tree, void *key,
+			   ofp_btree_iter_fun iter_fun, void *iter_arg);
+
+int ofp_btree_lookup_shared_memory(void);
+void ofp_btree_init_prepare(void);
+int ofp_btree_init_global(void);
+int ofp_btree_term_global(void);
+
+void ofp_print_btree_stat(int fd);
+
+#endif /* __OFPI_BTREE_H__ */
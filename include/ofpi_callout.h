@@ -46,23 +46,23 @@
 
 struct lock_object;
 
-OFP_SLIST_HEAD(callout_list, callout);
+OFP_LIST_HEAD(callout_list, callout);
 OFP_TAILQ_HEAD(callout_tailq, callout);
 
+/*
+ * Callouts are kept in per-CPU hierarchical timing wheels driven by one
+ * ODP timer per wheel, see ofp_timer.c. Arming and stopping a callout
+ * only links it into or out of a wheel slot. Coarse callouts are on a
+ * second wheel per CPU of one second slots, so that long idle timeouts
+ * do not keep the fine wheel ticking.
+ */
 struct callout {
-#if 0
-	union {
-		OFP_SLIST_ENTRY(callout) sle;
-		OFP_TAILQ_ENTRY(callout) tqe;
-	} c_links;
-	int	c_time;				/* ticks to the event */
+	OFP_LIST_ENTRY(callout) c_link;		/* wheel slot list */
+	uint32_t c_time;			/* tick of the event */
 	void	*c_arg;				/* function argument */
-	void	(*c_func)(void *);		/* function to call */
-	struct lock_object *c_lock;		/* lock to handle */
-#endif
+	ofp_timer_callback c_func;		/* function to call */
 	int	c_flags;			/* state of this entry */
 	volatile int c_cpu;			/* CPU we're scheduled on */
-	odp_timer_t odptmo;
 };
 
 #define	CALLOUT_LOCAL_ALLOC	0x0001 /* was allocated from callfree */
@@ -72,6 +72,7 @@ struct callout {
 #define	CALLOUT_RETURNUNLOCKED	0x0010 /* handler returns with mtx unlocked */
 #define	CALLOUT_SHAREDLOCK	0x0020 /* callout lock held in shared mode */
 #define	CALLOUT_DFRMIGRATION	0x0040 /* callout in deferred migration mode */
+#define	CALLOUT_COARSE		0x0080 /* callout is on the coarse wheel */
 
 struct callout_handle {
 	struct callout *callout;
@@ -81,7 +82,7 @@ extern int ncallout;
 
 #define	callout_active(c)	((c)->c_flags & CALLOUT_ACTIVE)
 #define	callout_deactivate(c)	((c)->c_flags &= ~CALLOUT_ACTIVE)
-#define	callout_pending(c)	(0 /* never true (c)->c_flags & CALLOUT_PENDING*/)
+#define	callout_pending(c)	((c)->c_flags & CALLOUT_PENDING)
 
 #define	callout_drain(c)	_callout_stop_safe(c, 1)
 
@@ -101,27 +102,24 @@ int	callout_schedule_on(struct callout *, int, int);
 #define	callout_schedule_curcpu(c, on_tick)				\
     callout_schedule_on((c), (on_tick), PCPU_GET(cpuid))
 
+/*
+ * The callback gets a pointer to a copy of arg. cpu selects the wheel,
+ * -1 is the wheel of the calling CPU.
+ */
+void	ofp_callout_init(struct callout *c);
+void	ofp_callout_reset(struct callout *c, int to_ticks,
+			  ofp_timer_callback func, void *arg, int cpu);
+/* As ofp_callout_reset(), to_ticks rounded up to whole seconds */
+void	ofp_callout_reset_coarse(struct callout *c, int to_ticks,
+				 ofp_timer_callback func, void *arg, int cpu);
+int	ofp_callout_stop(struct callout *c);
+
 #define callout_reset_on(_c, _ticks, _func, _arg, _cpu)			\
-	do {								\
-	    void *param = _arg;						\
-	    uint64_t us = ((uint64_t)_ticks)*OFP_TIMER_RESOLUTION_US;		\
-	    odp_timer_t tmp = (_c)->odptmo;				\
-	    (_c)->odptmo = ODP_TIMER_INVALID;				\
-	    ofp_timer_cancel(tmp);					\
-	    (_c)->odptmo = ofp_timer_start_cpu_id(us, _func, &param,    \
-			 sizeof(void *), _cpu);				\
-	    (_c)->c_flags |= CALLOUT_ACTIVE;				\
-	} while (0)
-
-#define callout_init(_t, _f)  do { (_t)->odptmo = ODP_TIMER_INVALID; } while (0)
-
-#define callout_stop(_t)					\
-	do {							\
-		odp_timer_t tmp = (_t)->odptmo;			\
-		(_t)->odptmo = ODP_TIMER_INVALID;		\
-		ofp_timer_cancel(tmp);			\
-		(_t)->c_flags &= ~CALLOUT_ACTIVE;		\
-	} while (0)
+	ofp_callout_reset((_c), (_ticks), (_func), (_arg), (_cpu))
+
+#define callout_init(_t, _f)	ofp_callout_init(_t)
+
+#define callout_stop(_t)	ofp_callout_stop(_t)
 
 void	callout_tick(void);
 int	callout_tickstofirst(int limit);
@@ -0,0 +1,149 @@
+/*-
+ * Copyright (c) 2007-2008
+ *	Swinburne University of Technology, Melbourne, Australia.
+ * Copyright (c) 2009-2010 Lawrence Stewart <lstewart@freebsd.org>
+ * Copyright (c) 2010 The FreeBSD Foundation
+ * Copyright (c) 2026 Nokia
+ * All rights reserved.
+ *
+ * This software was developed at the Centre for Advanced Internet
+ * Architectures, Swinburne University of Technology, by Lawrence Stewart and
+ * James Healy, made possible in part by a grant from the Cisco University
+ * Research Program Fund at Community Foundation Silicon Valley.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Congestion control framework. An algorithm is a set of hooks called by
+ * TCP input and output on ACKs, congestion signals and transmission. The
+ * algorithms are compiled in and listed in ofp_cc_list; the one used by new
+ * connections is selected with the net.inet.tcp.cc.algorithm sysctl and
+ * per socket with the OFP_TCP_CONGESTION socket option.
+ */
+
+#ifndef _OFPI_CC_H_
+#define _OFPI_CC_H_
+
+#include <odp_api.h>
+
+#include "ofpi_sysctl.h"
+#include "ofpi_tcp_var.h"
+
+#include "api/ofp_tcp.h"
+
+/* Size of the per connection private data of an algorithm. */
+#define CC_DATA_SIZE	256
+
+/*
+ * Wrapper around transport structs that contain same-named congestion
+ * control variables. Allows algos to be shared amongst multiple CC aware
+ * transprots.
+ */
+struct cc_var {
+	void		*cc_data; /* Per-connection private CC algorithm data. */
+	int		bytes_this_ack; /* # bytes acked by the current ACK. */
+	tcp_seq		curack; /* Most recent ACK. */
+	uint32_t	flags; /* Flags for cc_var (see below) */
+	int		type; /* Indicates which ptr is valid in ccvc. */
+	union ccv_container {
+		struct tcpcb		*tcp;
+	} ccvc;
+	/* Storage for cc_data, connections live in shared memory. */
+	uint64_t	cc_mem[CC_DATA_SIZE / sizeof(uint64_t)];
+};
+
+/* cc_var flags. */
+#define	CCF_ABC_SENTAWND	0x0001	/* ABC counted cwnd worth of bytes? */
+#define	CCF_CWND_LIMITED	0x0002	/* Are we currently cwnd limited? */
+
+/* ACK types passed to the ack_received() hook. */
+#define	CC_ACK		0x0001	/* Regular in sequence ACK. */
+#define	CC_DUPACK	0x0002	/* Duplicate ACK. */
+
+/* Congestion signal types passed to the cong_signal() hook. */
+#define	CC_ECN		0x01	/* ECN marked packet received. */
+#define	CC_RTO		0x02	/* RTO fired. */
+#define	CC_RTO_ERR	0x04	/* RTO fired in error. */
+#define	CC_NDUPACK	0x08	/* Threshold of dupack's reached. */
+
+/*
+ * Structure to hold data and function pointers that together represent a
+ * congestion control algorithm.
+ */
+struct cc_algo {
+	char	name[OFP_TCP_CA_NAME_MAX];
+
+	/* Init cc_data. Return non-zero on failure. */
+	int	(*cb_init)(struct cc_var *ccv);
+
+	/* Cleanup any state that is setup for the connection. */
+	void	(*cb_destroy)(struct cc_var *ccv);
+
+	/* Init variables for a newly established connection. */
+	void	(*conn_init)(struct cc_var *ccv);
+
+	/* Called on receipt of an ack. */
+	void	(*ack_received)(struct cc_var *ccv, uint16_t type);
+
+	/* Called on detection of a congestion signal. */
+	void	(*cong_signal)(struct cc_var *ccv, uint32_t type);
+
+	/* Called after exiting congestion recovery. */
+	void	(*post_recovery)(struct cc_var *ccv);
+
+	/* Called when data transfer resumes after an idle period. */
+	void	(*after_idle)(struct cc_var *ccv);
+
+	/* Called when new data extends snd_max. */
+	void	(*data_sent)(struct cc_var *ccv);
+};
+
+/* Macro to obtain the CC algo's struct ptr. */
+#define	CC_ALGO(tp)	((tp)->cc_algo)
+
+/* Macro to obtain the CC algo's data ptr. */
+#define	CC_DATA(tp)	((tp)->ccv->cc_data)
+
+/* Macro to obtain the system default CC algo's struct ptr. */
+#define	CC_DEFAULT()	ofp_cc_default
+
+/* Macro to access the tcpcb of a cc_var. */
+#define	CCV(ccv, what)	(ccv)->ccvc.tcp->what
+
+extern struct cc_algo ofp_newreno_cc_algo;
+extern struct cc_algo ofp_cubic_cc_algo;
+extern struct cc_algo ofp_bbr_cc_algo;
+
+/* Algorithms by name, NULL terminated. */
+extern struct cc_algo *const ofp_cc_list[];
+extern struct cc_algo *ofp_cc_default;
+
+struct cc_algo *ofp_cc_algo_find(const char *name);
+
+/* Time in nanoseconds for algorithms that need finer than ticks. */
+static inline uint64_t cc_time_ns(void)
+{
+	return odp_time_to_ns(odp_time_global());
+}
+
+#endif /* _OFPI_CC_H_ */
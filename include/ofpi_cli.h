@@ -53,6 +53,12 @@ void f_debug_show(struct cli_conn *conn, const char *s);
 void f_debug_capture(struct cli_conn *conn, const char *s);
 void f_debug_info(struct cli_conn *conn, const char *s);
 void f_debug_capture_file(struct cli_conn *conn, const char *s);
+void f_debug_capture_snaplen(struct cli_conn *conn, const char *s);
+void f_debug_capture_filter(struct cli_conn *conn, const char *s);
+void f_debug_capture_rotate(struct cli_conn *conn, const char *s);
+void f_debug_trace(struct cli_conn *conn, const char *s);
+void f_debug_trace_show(struct cli_conn *conn, const char *s);
+void f_debug_trace_dump(struct cli_conn *conn, const char *s);
 void f_help_debug(struct cli_conn *conn, const char *s);
 
 void f_loglevel(struct cli_conn *conn, const char *s);
@@ -81,10 +87,15 @@ void f_add_alias_command(const char *name);
 void f_stat_show(struct cli_conn *conn, const char *s);
 void f_stat_set(struct cli_conn *conn, const char *s);
 void f_stat_perf(struct cli_conn *conn, const char *s);
+void f_stat_top(struct cli_conn *conn, const char *s);
 void f_stat_clear(struct cli_conn *conn, const char *s);
+void f_stat_memory(struct cli_conn *conn, const char *s);
+void f_stat_locks(struct cli_conn *conn, const char *s);
+void f_stat_locks_clear(struct cli_conn *conn, const char *s);
 void f_help_stat(struct cli_conn *conn, const char *s);
 
 void f_ifconfig_show(struct cli_conn *conn, const char *s);
+void f_ifconfig_steer(struct cli_conn *conn, const char *s);
 void f_help_ifconfig(struct cli_conn *conn, const char *s);
 void f_ifconfig(struct cli_conn *conn, const char *s);
 void f_ifconfig_v6(struct cli_conn *conn, const char *s);
@@ -106,5 +117,7 @@ void f_help_netstat(struct cli_conn *conn, const char *s);
 void f_netstat_all(struct cli_conn *conn, const char *s);
 void f_netstat_tcp(struct cli_conn *conn, const char *s);
 void f_netstat_udp(struct cli_conn *conn, const char *s);
+void f_netstat_hash(struct cli_conn *conn, const char *s);
+void f_netstat_rexmit(struct cli_conn *conn, const char *s);
 
 #endif
@@ -8,9 +8,9 @@
 #define _OFPI_CONFIG_H_
 
 #include "api/ofp_config.h"
+#include "ofpi_init.h"
 
-/**Maximum number of CPUs.
- * Used to define the size of internal structures. */
-#define OFP_MAX_NUM_CPU 64
+/* Number of per CPU tables, see ofp_global_param_t.cpu_max */
+#define OFP_MAX_NUM_CPU (global_param->cpu_max)
 
 #endif
@@ -0,0 +1,39 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_CONNTRACK_H__
+#define __OFPI_CONNTRACK_H__
+
+#include <odp_api.h>
+
+#include "api/ofp_types.h"
+#include "api/ofp_conntrack.h"
+
+/*
+ * Per thread connection tracking table, see api/ofp_conntrack.h. Flows
+ * are hashed by a key of the lower address and port first, and linked
+ * to a timer wheel slot of their expiry second. A slot is processed
+ * when input passes its time: flows whose expiry was extended by later
+ * packets are linked again to their new slot.
+ */
+
+struct ofp_ct_table;
+
+/* NULL when the thread does not track connections */
+extern __thread struct ofp_ct_table *ofp_ct_table;
+
+/*
+ * Look up or create the flow of a received IPv4 or IPv6 packet and
+ * remember it in the user area. Returns OFP_PKT_DROP if the action of
+ * the flow is to drop, otherwise OFP_PKT_CONTINUE.
+ */
+enum ofp_return_code ofp_ct_ipv4_input(odp_packet_t pkt, uint16_t vrf);
+enum ofp_return_code ofp_ct_ipv6_input(odp_packet_t pkt, uint16_t vrf);
+
+int ofp_ct_init_local(void);
+int ofp_ct_term_local(void);
+
+#endif /* __OFPI_CONNTRACK_H__ */
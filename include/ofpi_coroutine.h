@@ -0,0 +1,35 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_COROUTINE_H__
+#define __OFPI_COROUTINE_H__
+
+#include <odp_api.h>
+#include "api/ofp_coroutine.h"
+
+struct ofp_coroutine;
+
+/* Coroutine the thread runs, NULL outside coroutines */
+extern __thread struct ofp_coroutine *ofp_coroutine_cur;
+
+static inline int ofp_in_coroutine(void)
+{
+	return odp_unlikely(ofp_coroutine_cur != NULL);
+}
+
+/*
+ * Switch back to the dispatcher until *go is set. The coroutine is
+ * resumed by the first ofp_coroutine_run() that finds it set.
+ */
+void ofp_coroutine_wait(int *go);
+
+/* Whether the next ofp_coroutine_run() would run a coroutine */
+int ofp_coroutine_runnable(void);
+
+/* Coroutines left are freed without running them */
+void ofp_coroutine_term_local(void);
+
+#endif /* __OFPI_COROUTINE_H__ */
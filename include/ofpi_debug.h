@@ -37,10 +37,47 @@ int ofp_pcap_lookup_shared_memory(void);
 void ofp_pcap_init_prepare(void);
 int ofp_pcap_init_global(void);
 int ofp_pcap_term_global(void);
+int ofp_pcap_start_writer(const odp_cpumask_t *cpumask);
+void ofp_pcap_stop_writer(void);
+/* Write the queued packets of all threads, return the number written */
+int ofp_pcap_flush(void);
 
 void ofp_save_packet_to_pcap_file(uint32_t flag, odp_packet_t pkt, int port);
+/* Return non-zero if the packet passes the capture filter */
+int ofp_debug_filter_match(odp_packet_t pkt);
 void ofp_print_packet_buffer(const char *comment, uint8_t *p);
 
+/*
+ * Packet trace. The ring of the thread is NULL without tracing.
+ */
+struct ofp_trace_ring {
+	uint32_t head;
+	uint32_t mask;
+	uint32_t stages;
+	uint32_t thr;
+	struct ofp_trace_record rec[];
+};
+
+extern __thread struct ofp_trace_ring *ofp_trace_ring;
+
+void ofp_trace_record(struct ofp_trace_ring *ring, odp_packet_t pkt,
+		      int port, int stage, int verdict);
+
+static inline void ofp_trace(odp_packet_t pkt, int port, int stage,
+			     int verdict)
+{
+	struct ofp_trace_ring *ring = ofp_trace_ring;
+
+	if (odp_unlikely(ring != NULL) && (ring->stages & (1u << stage)))
+		ofp_trace_record(ring, pkt, port, stage, verdict);
+}
+
+int ofp_trace_lookup_shared_memory(void);
+void ofp_trace_init_prepare(void);
+int ofp_trace_init_global(void);
+int ofp_trace_term_global(void);
+int ofp_trace_init_local(void);
+
 /*
  * Debug LOG interface
  */
@@ -59,7 +96,8 @@ enum ofp_log_packet {
 extern struct ofp_flag_descript_s ofp_flag_descript[];
 
 #define OFP_DEBUG_PACKET(_type_, pkt, port) do {\
-	if (ofp_debug_flags & ofp_flag_descript[_type_].flag) { \
+	if ((ofp_debug_flags & ofp_flag_descript[_type_].flag) && \
+	    ofp_debug_filter_match(pkt)) { \
 		ofp_print_packet( \
 			ofp_flag_descript[_type_].flag_descript, \
 				pkt); \
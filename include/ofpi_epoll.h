@@ -15,10 +15,20 @@ int _ofp_epoll_create(int size, int(*create_socket)(void));
 int _ofp_epoll_ctl(struct socket *epoll, int op, int fd, struct ofp_epoll_event *event);
 
 int _ofp_epoll_wait(struct socket *epoll, struct ofp_epoll_event *events, int maxevents, int timeout,
-		    int(*msleep)(int timeout));
+		    int(*msleep)(struct socket *epoll, int timeout));
+
+void ofp_epoll_set_init(struct socket *epoll);
+
+/* Socket may have become ready for events */
+void ofp_epoll_notify(struct socket *so, uint32_t events);
+
+/* Remove registrations of a closed socket or epoll instance */
+void ofp_epoll_socket_close(struct socket *so);
 
 void ofp_set_socket_getter(struct socket*(*socket_getter)(int fd));
 
 void ofp_set_is_readable_checker(int(*is_readable_checker)(int fd));
 
+void ofp_set_epoll_wakeup(int(*epoll_wakeup)(void *channel));
+
 #endif
@@ -0,0 +1,227 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_FLOW_CACHE_H__
+#define __OFPI_FLOW_CACHE_H__
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "api/ofp_types.h"
+#include "api/ofp_if_vlan.h"
+
+/*
+ * Per thread cache of the output of forwarded IPv4 packets, keyed by
+ * VRF and destination address. An entry holds the next hop, the output
+ * interface and the Ethernet header to prepend. Forwarded IPv6 packets
+ * have a table of their own with the same size.
+ *
+ * Changes of routes, ARP entries, interfaces and interface MTUs advance
+ * a global generation counter with ofp_flow_cache_flush(). Entries of
+ * an older generation are not valid.
+ *
+ * An entry may also be owned by a user of its own, such as the output
+ * route of a TCP connection, see ofp_flow_cache_entry_lookup().
+ */
+
+#define OFP_FLOW_CACHE_L2_MAX sizeof(struct ofp_ether_vlan_header)
+
+struct ofp_flow_cache_entry {
+	/* Generation of the entry, 0 if not valid */
+	uint32_t gen;
+	/* Generation when the entry was looked up and missed */
+	uint32_t fill_gen;
+	uint32_t dst;
+	uint16_t vrf;
+	uint16_t l2_len;
+	struct ofp_ifnet *dev_out;
+	struct ofp_nh_entry *nh;
+	uint8_t l2[OFP_FLOW_CACHE_L2_MAX];
+};
+
+struct ofp_flow_cache_slot {
+	struct ofp_flow_cache_entry e;
+} ODP_ALIGNED_CACHE;
+
+struct ofp_flow_cache6_entry {
+	uint32_t gen;
+	uint32_t fill_gen;
+	uint8_t dst[16];
+	uint16_t vrf;
+	uint16_t l2_len;
+	struct ofp_ifnet *dev_out;
+	struct ofp_nh6_entry *nh;
+	uint8_t l2[OFP_FLOW_CACHE_L2_MAX];
+};
+
+struct ofp_flow_cache6_slot {
+	struct ofp_flow_cache6_entry e;
+} ODP_ALIGNED_CACHE;
+
+struct ofp_flow_cache {
+	struct ofp_flow_cache_slot *slot;
+	struct ofp_flow_cache6_slot *slot6;
+	uint32_t mask;
+	odp_atomic_u32_t *gen;
+};
+
+extern __thread struct ofp_flow_cache ofp_flow_cache;
+
+static inline uint32_t ofp_flow_cache_hash(uint16_t vrf, uint32_t dst)
+{
+	return ((dst ^ vrf) * 0x9e3779b1) >> 16;
+}
+
+/*
+ * Check an entry for vrf and dst. If it is not valid, it is prepared
+ * for ofp_flow_cache_fill(). The generation must be known in the
+ * thread, see ofp_flow_cache_in_use().
+ */
+static inline void ofp_flow_cache_entry_lookup(struct ofp_flow_cache_entry *e,
+					       uint16_t vrf, uint32_t dst)
+{
+	uint32_t gen = odp_atomic_load_acq_u32(ofp_flow_cache.gen);
+
+	if (e->gen == gen && e->dst == dst && e->vrf == vrf)
+		return;
+
+	e->gen = 0;
+	e->fill_gen = gen;
+	e->dst = dst;
+	e->vrf = vrf;
+}
+
+/* The thread knows the generation, entries of users may be used */
+static inline odp_bool_t ofp_flow_cache_in_use(void)
+{
+	return ofp_flow_cache.gen != NULL;
+}
+
+/*
+ * Return the cache slot of vrf and dst, or NULL if the cache is not in
+ * use. The slot is valid if ofp_flow_cache_hit() is true, otherwise it
+ * may be filled with ofp_flow_cache_fill().
+ */
+static inline struct ofp_flow_cache_entry *
+ofp_flow_cache_lookup(uint16_t vrf, uint32_t dst)
+{
+	struct ofp_flow_cache_entry *e;
+
+	if (odp_likely(ofp_flow_cache.slot == NULL))
+		return NULL;
+
+	e = &ofp_flow_cache.slot[ofp_flow_cache_hash(vrf, dst) &
+				 ofp_flow_cache.mask].e;
+	ofp_flow_cache_entry_lookup(e, vrf, dst);
+
+	return e;
+}
+
+static inline odp_bool_t ofp_flow_cache_hit(struct ofp_flow_cache_entry *e)
+{
+	return e->gen != 0;
+}
+
+/* Entry is still valid for vrf and dst */
+static inline odp_bool_t ofp_flow_cache_match(struct ofp_flow_cache_entry *e,
+					      uint16_t vrf, uint32_t dst)
+{
+	return e->gen == odp_atomic_load_u32(ofp_flow_cache.gen) &&
+		e->dst == dst && e->vrf == vrf;
+}
+
+static inline void ofp_flow_cache_fill(struct ofp_flow_cache_entry *e,
+				       uint16_t vrf, uint32_t dst,
+				       struct ofp_ifnet *dev_out,
+				       struct ofp_nh_entry *nh,
+				       const void *l2, uint32_t l2_len)
+{
+	/* The slot was taken by another destination in the meantime */
+	if (e->dst != dst || e->vrf != vrf || l2_len > OFP_FLOW_CACHE_L2_MAX)
+		return;
+
+	e->dev_out = dev_out;
+	e->nh = nh;
+	e->l2_len = l2_len;
+	memcpy(e->l2, l2, l2_len);
+	e->gen = e->fill_gen;
+}
+
+static inline uint32_t ofp_flow_cache6_hash(uint16_t vrf, const uint8_t *dst)
+{
+	uint32_t w[4];
+
+	memcpy(w, dst, sizeof(w));
+
+	return ((w[0] ^ w[1] ^ w[2] ^ w[3] ^ vrf) * 0x9e3779b1) >> 16;
+}
+
+/* As ofp_flow_cache_lookup(), for an IPv6 destination */
+static inline struct ofp_flow_cache6_entry *
+ofp_flow_cache6_lookup(uint16_t vrf, const uint8_t *dst)
+{
+	struct ofp_flow_cache6_entry *e;
+	uint32_t gen;
+
+	if (odp_likely(ofp_flow_cache.slot6 == NULL))
+		return NULL;
+
+	gen = odp_atomic_load_acq_u32(ofp_flow_cache.gen);
+	e = &ofp_flow_cache.slot6[ofp_flow_cache6_hash(vrf, dst) &
+				  ofp_flow_cache.mask].e;
+
+	if (e->gen == gen && e->vrf == vrf && !memcmp(e->dst, dst, 16))
+		return e;
+
+	e->gen = 0;
+	e->fill_gen = gen;
+	memcpy(e->dst, dst, 16);
+	e->vrf = vrf;
+
+	return e;
+}
+
+static inline odp_bool_t ofp_flow_cache6_hit(struct ofp_flow_cache6_entry *e)
+{
+	return e->gen != 0;
+}
+
+static inline odp_bool_t
+ofp_flow_cache6_match(struct ofp_flow_cache6_entry *e, uint16_t vrf,
+		      const uint8_t *dst)
+{
+	return e->gen == odp_atomic_load_u32(ofp_flow_cache.gen) &&
+		e->vrf == vrf && !memcmp(e->dst, dst, 16);
+}
+
+static inline void ofp_flow_cache6_fill(struct ofp_flow_cache6_entry *e,
+					uint16_t vrf, const uint8_t *dst,
+					struct ofp_ifnet *dev_out,
+					struct ofp_nh6_entry *nh,
+					const void *l2, uint32_t l2_len)
+{
+	if (e->vrf != vrf || memcmp(e->dst, dst, 16) ||
+	    l2_len > OFP_FLOW_CACHE_L2_MAX)
+		return;
+
+	e->dev_out = dev_out;
+	e->nh = nh;
+	e->l2_len = l2_len;
+	memcpy(e->l2, l2, l2_len);
+	e->gen = e->fill_gen;
+}
+
+void ofp_flow_cache_flush(void);
+
+int ofp_flow_cache_lookup_shared_memory(void);
+void ofp_flow_cache_init_prepare(void);
+int ofp_flow_cache_init_global(void);
+int ofp_flow_cache_term_global(void);
+int ofp_flow_cache_init_local(void);
+int ofp_flow_cache_term_local(void);
+
+#endif /* __OFPI_FLOW_CACHE_H__ */
@@ -8,6 +8,12 @@
 #ifndef __OFPI_GRE_H__
 #define __OFPI_GRE_H__
 
+#include <odp_api.h>
+#include "api/ofp_types.h"
+
+struct ofp_ifnet;
+
+#ifdef OFP_GRE
 enum ofp_return_code ofp_gre_input(odp_packet_t *, int);
 
 enum ofp_return_code ofp_output_ipv4_to_gre(odp_packet_t pkt,
@@ -15,5 +21,23 @@ enum ofp_return_code ofp_output_ipv4_to_gre(odp_packet_t pkt,
 
 enum ofp_return_code ofp_output_ipv6_to_gre(odp_packet_t pkt,
 					    struct ofp_ifnet *dev_gre);
+#else
+/* No GRE interfaces are created without the module */
+static inline enum ofp_return_code
+ofp_output_ipv4_to_gre(odp_packet_t pkt, struct ofp_ifnet *dev_gre)
+{
+	(void)pkt;
+	(void)dev_gre;
+	return OFP_PKT_DROP;
+}
+
+static inline enum ofp_return_code
+ofp_output_ipv6_to_gre(odp_packet_t pkt, struct ofp_ifnet *dev_gre)
+{
+	(void)pkt;
+	(void)dev_gre;
+	return OFP_PKT_DROP;
+}
+#endif /* OFP_GRE */
 
 #endif /*__OFPI_GRE_H__*/
@@ -0,0 +1,132 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_GRO_H__
+#define __OFPI_GRO_H__
+
+#include <odp_api.h>
+
+#include "api/ofp_types.h"
+#include "api/ofp_ip.h"
+
+struct inpcb;
+
+/*
+ * Per thread coalescing of received TCP segments. Between
+ * ofp_gro_burst_begin() and ofp_gro_burst_end() the in-order data
+ * segments of a flow are appended to the first segment of the flow,
+ * which goes to TCP input at the end of the burst, or earlier when a
+ * segment of the flow cannot be appended.
+ *
+ * Segments are appended only when their headers differ from the held
+ * one only by the sequence number, the IP ID and the timestamps, whose
+ * TSval may not go back, and the payload fits in the tailroom of the
+ * held packet. The held packet takes the timestamps of the last one.
+ *
+ * TCP input also defers the ACKs it would send during a burst. Each
+ * connection is queued once and gets one cumulative ACK at the end of
+ * the burst, after the held segments are delivered.
+ *
+ * Datagrams for UDP sockets with OFP_UDP_GRO are held per socket in
+ * the same way. The datagrams of one source and size are chained to
+ * the first one, which is queued to the socket at the end of the burst
+ * with one sockbuf lock and wakeup.
+ *
+ * The packets for sockets with OFP_SIGEV_BATCH notification are
+ * passed to the socket callbacks last.
+ */
+
+/* Sockets with OFP_SIGEV_BATCH events pending, see ofp_uipc_sockbuf.c */
+extern __thread int ofp_sock_event_num;
+void ofp_sock_event_flush(void);
+
+/* Connections with a deferred ACK per burst */
+#define OFP_GRO_ACK_MAX 64
+/* UDP sockets holding a datagram record per burst */
+#define OFP_GRO_UDP_MAX 16
+
+struct ofp_gro_flow {
+	odp_packet_t pkt;
+	uint32_t src;
+	uint32_t dst;
+	uint32_t ports;
+	uint32_t next_seq;
+	uint16_t vrf;
+};
+
+struct ofp_gro_udp {
+	/* Referenced socket, see ofp_udp_gro_flush() */
+	struct inpcb *inp;
+	odp_packet_t pkt;
+	uint32_t dst;
+	uint16_t segsz;
+	/* A shorter datagram ended the record */
+	uint8_t closed;
+};
+
+struct ofp_gro {
+	struct ofp_gro_flow *flow;
+	int num_flows;
+	/* Flows holding a packet */
+	int num;
+	/* Flow to evict when all hold a packet */
+	int next;
+	/* Nesting of bursts */
+	int depth;
+	/* Referenced connections with a deferred ACK */
+	struct inpcb *ack[OFP_GRO_ACK_MAX];
+	int num_ack;
+	struct ofp_gro_udp udp[OFP_GRO_UDP_MAX];
+	int num_udp;
+	/* Start of the burst in ns if rx_timestamp is set, else 0 */
+	int rx_ts;
+	uint64_t rx_ns;
+};
+
+extern __thread struct ofp_gro ofp_gro;
+
+enum ofp_return_code ofp_gro_tcp4_hold(odp_packet_t pkt, struct ofp_ip *ip);
+void ofp_gro_flush(void);
+void ofp_tcp_ack_flush(void);
+void ofp_udp_gro_flush(void);
+
+/*
+ * Return OFP_PKT_PROCESSED if the packet was held or appended to a
+ * held one, OFP_PKT_CONTINUE if it is to be input now.
+ */
+static inline enum ofp_return_code ofp_gro_tcp4_input(odp_packet_t pkt,
+						      struct ofp_ip *ip)
+{
+	if (odp_likely(!ofp_gro.depth || !ofp_gro.num_flows))
+		return OFP_PKT_CONTINUE;
+	return ofp_gro_tcp4_hold(pkt, ip);
+}
+
+static inline void ofp_gro_burst_begin(void)
+{
+	if (!ofp_gro.depth++ && odp_unlikely(ofp_gro.rx_ts))
+		ofp_gro.rx_ns = odp_time_to_ns(odp_time_global());
+}
+
+static inline void ofp_gro_burst_end(void)
+{
+	if (--ofp_gro.depth)
+		return;
+	ofp_gro.rx_ns = 0;
+	if (ofp_gro.num)
+		ofp_gro_flush();
+	if (ofp_gro.num_ack)
+		ofp_tcp_ack_flush();
+	if (ofp_gro.num_udp)
+		ofp_udp_gro_flush();
+	if (ofp_sock_event_num)
+		ofp_sock_event_flush();
+}
+
+int ofp_gro_init_local(void);
+int ofp_gro_term_local(void);
+
+#endif /* __OFPI_GRO_H__ */
@@ -10,3 +10,17 @@ void ofp_hashword2(const uint32_t *k, size_t length, uint32_t *pc, uint32_t *pb)
 uint32_t ofp_hashlittle(const void *key, size_t length, uint32_t initval);
 void ofp_hashlittle2(const void *key, size_t length, uint32_t *pc, uint32_t *pb);
 uint32_t ofp_hashbig(const void *key, size_t length, uint32_t initval);
+
+/*
+ * Hash of a short key of 32-bit words for table lookups. The backend is
+ * selected by ofp_hash_init_global(): CRC32C instructions when the CPU
+ * has them, Jenkins ofp_hashword() otherwise. The multi variant hashes
+ * num keys of the same length, interleaving them to hide the latency of
+ * the CRC instruction.
+ */
+extern uint32_t (*ofp_hash_key)(const uint32_t *k, size_t length,
+				uint32_t initval);
+extern void (*ofp_hash_key_multi)(const uint32_t *k[], int num, size_t length,
+				  uint32_t initval, uint32_t hash[]);
+
+void ofp_hash_init_global(void);
@@ -13,17 +13,25 @@
 
 #define OFP_HOOK(_hook_id_, _pkt_, _arg_, _pres_) do { \
 	ofp_pkt_hook *_pkt_hook_ = ofp_get_packet_hooks(); \
+	ofp_pkt_hook_burst *_burst_hook_ = ofp_get_packet_burst_hooks(); \
 	if (_pkt_hook_ && _pkt_hook_[_hook_id_]) \
 		*_pres_ = _pkt_hook_[_hook_id_](_pkt_, _arg_); \
-	else \
+	else if (_burst_hook_ && _burst_hook_[_hook_id_]) { \
+		odp_packet_t _one_pkt_ = (_pkt_); \
+		enum ofp_return_code _one_res_; \
+		_burst_hook_[_hook_id_](&_one_pkt_, 1, &_one_res_, _arg_); \
+		*_pres_ = _one_res_; \
+	} else \
 		*_pres_ = OFP_PKT_CONTINUE; \
 } while(0)
 
 ofp_pkt_hook *ofp_get_packet_hooks(void);
+ofp_pkt_hook_burst *ofp_get_packet_burst_hooks(void);
 
 int ofp_hook_lookup_shared_memory(void);
 void ofp_hook_init_prepare(void);
-int ofp_hook_init_global(ofp_pkt_hook *pkt_hook_init);
+int ofp_hook_init_global(ofp_pkt_hook *pkt_hook_init,
+			 ofp_pkt_hook_burst *pkt_hook_burst_init);
 int ofp_hook_term_global(void);
 
 #endif /* __OFPI_HOOK_H__ */
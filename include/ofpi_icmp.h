@@ -13,6 +13,13 @@
 enum ofp_return_code ofp_icmp_input(odp_packet_t *pkt_icmp, int off);
 enum ofp_return_code ofp_icmp_error(odp_packet_t pkt_in, int type, int code, uint32_t dest, int mtu);
 
+/*
+ * Per thread rate limit of ICMP and ICMPv6 errors to the source of an
+ * offending packet. src is the IPv4 or IPv6 source address. Returns
+ * nonzero if the error must not be sent.
+ */
+int ofp_icmp_err_ratelimit(int af, const void *src, int type);
+
 enum ofp_return_code
 _ofp_icmp_input(odp_packet_t pkt_icmp, struct ofp_ip *ip, struct ofp_icmp *icp,
 		enum ofp_return_code (*reflect)(odp_packet_t pkt));
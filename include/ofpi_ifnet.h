@@ -29,5 +29,7 @@ void ofp_igmp_attach(struct ofp_ifnet *ifnet);
 #ifdef SP
 /* Create VIF local input queue */
 int ofp_sp_inq_create(struct ofp_ifnet *ifnet);
+/* Start the VIF slow path receiver and transmitter threads */
+void ofp_sp_threads_start(struct ofp_ifnet *ifnet);
 #endif /*SP*/
 #endif
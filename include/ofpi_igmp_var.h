@@ -199,6 +199,7 @@ CTASSERT(sizeof(struct igmpstat) == 168);
 struct ofp_igmp_ifinfo;
 struct ofp_in_multi;
 
+#ifdef OFP_IGMP
 int	ofp_igmp_change_state(struct ofp_in_multi *);
 struct ofp_igmp_ifinfo *
 	ofp_igmp_domifattach(struct ofp_ifnet *);
@@ -208,6 +209,33 @@ enum ofp_return_code ofp_igmp_input(odp_packet_t *, int);
 void	ofp_igmp_slowtimo(void);
 void	ofp_igmp_init(void);
 void	ofp_igmp_uninit(void *unused);
+#else
+/* Groups are joined and left without reports, as on a silent interface */
+void	ofp_inm_commit(struct ofp_in_multi *);
+
+static inline int ofp_igmp_change_state(struct ofp_in_multi *inm)
+{
+	ofp_inm_commit(inm);
+	return 0;
+}
+
+static inline struct ofp_igmp_ifinfo *
+ofp_igmp_domifattach(struct ofp_ifnet *ifp)
+{
+	(void)ifp;
+	return NULL;
+}
+
+static inline void ofp_igmp_domifdetach(struct ofp_ifnet *ifp)
+{
+	(void)ifp;
+}
+
+static inline void ofp_igmp_ifdetach(struct ofp_ifnet *ifp)
+{
+	(void)ifp;
+}
+#endif /* OFP_IGMP */
 
 SYSCTL_DECL(_net_inet_igmp);
 
@@ -50,6 +50,8 @@
 #include "ofpi_udp_var.h"
 #include "ofpi_systm.h"
 #include "ofpi_uma.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_lockstat.h"
 
 typedef	int64_t *	qaddr_t;
 
@@ -135,6 +137,9 @@ struct in_conninfo {
 
 struct	icmp6_filter;
 
+/* Number of per-core slices of the default auto port range */
+#define INP_LPORT_SLICES	64
+
 /*-
  * Global data structure for each high-level protocol (UDP, TCP, ...) in both
  * IPv4 and IPv6.  Holds inpcb lists and information for managing them.
@@ -179,6 +184,14 @@ struct inpcbinfo {
 	uint16_t		 ipi_lastlow;		/* (x) */
 	uint16_t		 ipi_lasthi;		/* (x) */
 
+	/*
+	 * Local ports that have inpcbs, one bit each, searched for a free
+	 * port before probing the hash. Cursor of each core's slice of the
+	 * default auto port range.
+	 */
+	uint64_t		 ipi_portmap[65536 / 64];	/* (h) */
+	uint16_t		 ipi_lastport_cpu[INP_LPORT_SLICES];	/* (h) */
+
 	/*
 	 * UMA zone from which inpcbs are allocated for this protocol.
 	 */
@@ -200,10 +213,15 @@ struct inpcbinfo {
 
 	/*
 	 * Global hash of inpcbs, hashed by local and foreign addresses and
-	 * port numbers.
+	 * port numbers. ipi_hashmaxmask + 1 buckets are allocated and
+	 * ipi_hashmask + 1 are in use. The table grows by splitting the
+	 * buckets one by one: those below ipi_hashsplit have been split and
+	 * are addressed with the doubled mask. See ofp_in_pcbhash_head().
 	 */
 	struct inpcbhead	*ipi_hashbase;		/* (h) */
 	uint64_t		 ipi_hashmask;		/* (h) */
+	uint64_t		 ipi_hashsplit;		/* (h) */
+	uint64_t		 ipi_hashmaxmask;	/* (c) */
 
 	/*
 	 * Global hash of inpcbs, hashed by only local port number.
@@ -211,6 +229,17 @@ struct inpcbinfo {
 	struct inpcbporthead	*ipi_porthashbase;	/* (h) */
 	uint64_t		 ipi_porthashmask;	/* (h) */
 
+	/*
+	 * Cuckoo index of the IPv4 inpcbs, searched instead of the hash
+	 * lists. The inpcbs it has no room or no unique key for are
+	 * counted, and any of them make the lookups use the lists.
+	 */
+	struct inpcb_idx_bucket	*ipi_idx;		/* (h) */
+	uint32_t		 ipi_idxmask;		/* (h) */
+	uint32_t		 ipi_idx_exact_miss;	/* (h) connected */
+	uint32_t		 ipi_idx_wild_miss;	/* (h) unconnected */
+	char			 ipi_idx_name[24];	/* (c) */
+
 	/*
 	 * List of wildcard inpcbs for use with pcbgroups.  In the past, was
 	 * per-pcbgroup but is now global.  All pcbgroup locks must be held
@@ -224,6 +253,14 @@ struct inpcbinfo {
 	 */
 	struct vnet		*ipi_vnet;		/* (c) */
 
+	/*
+	 * Hash tables and hash locks of the VRFs other than 0, allocated
+	 * with the first inpcb of the VRF. The tables and ipi_count of
+	 * such a child are used, its list and zone are those of the parent.
+	 */
+	struct inpcbinfo	**ipi_vrf;		/* (g) */
+	int			 ipi_nvrf;		/* (c) */
+
 	/*
 	 * general use 2
 	 */
@@ -288,37 +325,49 @@ struct inpcbgroup {
  *
  * The inp_vflag field is overloaded, and would otherwise ideally be (c).
  */
+/*
+ * Bucket of the cuckoo index: the signatures of four inpcbs on one
+ * cache line with the pointers to them.
+ */
+#define INP_IDX_WAYS 4
+
+struct inpcb_idx_bucket {
+	uint32_t	sig[INP_IDX_WAYS];
+	struct inpcb	*inp[INP_IDX_WAYS];
+} ODP_ALIGNED_CACHE;
+
 struct inpcb {
 	OFP_LIST_ENTRY(inpcb) inp_hash;	/* (i/p) hash list */
+	/* The lookup keys and what a match needs next, unlike FreeBSD */
+	struct	in_conninfo inp_inc;	/* (i/p) list for PCB's local port */
+	uint8_t	inp_vflag;		/* (i) IP version flag (v4/v6) */
+	int	inp_flags;		/* (i) generic IP/datagram flags */
+	void	*inp_ppcb;		/* (i) pointer to per-protocol pcb */
+	struct	socket *inp_socket;	/* (i) back pointer to socket */
 	OFP_LIST_ENTRY(inpcb) inp_pcbgrouphash;	/* (g/i) hash list */
 	OFP_LIST_ENTRY(inpcb) inp_list;	/* (i/p) list for all PCBs for proto */
-	void	*inp_ppcb;		/* (i) pointer to per-protocol pcb */
 	union {				/* HJo: static space allocation for inp_ppcp */
 		struct udpcb udp_ppcb;
 	} ppcb_space;
 	struct	inpcbinfo *inp_pcbinfo;	/* (c) PCB list info */
+	struct	inpcbinfo *inp_hashinfo; /* (c) hash tables of the VRF */
 	struct	inpcbinfo  static_pcbinfo;
 	struct	inpcbgroup *inp_pcbgroup; /* (g/i) PCB group list */
 	struct	inpcbgroup static_pcbgroup;
 	OFP_LIST_ENTRY(inpcb) inp_pcbgroup_wild; /* (g/i/p) group wildcard entry */
-	struct	socket *inp_socket;	/* (i) back pointer to socket */
 	struct	ofp_ucred	*inp_cred;	/* (c) cache of socket cred */
 	uint32_t inp_flow;		/* (i) IPv6 flow information */
-	int	inp_flags;		/* (i) generic IP/datagram flags */
 	int	inp_flags2;		/* (i) generic IP/datagram flags #2*/
-	uint8_t	inp_vflag;		/* (i) IP version flag (v4/v6) */
 	uint8_t	inp_ip_ttl;		/* (i) time to live proto */
 	uint8_t	inp_ip_p;		/* (c) protocol proto */
 	uint8_t	inp_ip_minttl;		/* (i) minimum TTL or drop */
 	uint32_t inp_flowid;		/* (x) flow id / queue id */
+	int	inp_cpu;		/* (i) CPU that created or listens */
 	odp_atomic_u32_t inp_refcount;	/* (i) refcount */
 	void	*inp_pspare[5];		/* (x) route caching / general use */
 	uint32_t	inp_ispare[6];	/* (x) route caching / user cookie /
 					 *     general use */
 
-	/* Local and foreign ports, local and foreign addr. */
-	struct	in_conninfo inp_inc;	/* (i/p) list for PCB's local port */
-
 	/* MAC and IPSEC policy information. */
 	struct	label *inp_label;	/* (i) MAC label */
 	struct	inpcbpolicy *inp_sp;    /* (s) for IPSEC */
@@ -344,6 +393,10 @@ struct inpcb {
 	} inp_depend6;
 	OFP_LIST_ENTRY(inpcb) inp_portlist;	/* (i/p) */
 	struct	inpcbport *inp_phd;	/* (i/p) head of this list */
+	uint32_t inp_idx_slot;		/* (h) slot + 1 in ipi_idx, 0: none */
+	uint8_t	inp_idx_miss;		/* (h) counted in ipi_idx_*_miss */
+	struct ofp_flow_cache_entry inp_fc; /* (x) IPv4 output route */
+	odp_spinlock_t	inp_fc_lock;	/* protects inp_fc */
 #define inp_zero_size offsetof(struct inpcb, inp_gencnt)
 	inp_gen_t	inp_gencnt;	/* (c) generation count */
 	struct llentry	*inp_lle;	/* cached L2 information */
@@ -384,7 +437,7 @@ struct inpcbport {
 	uint16_t phd_port;
 };
 
-#if (defined OFP_RSS) || (defined OFP_INP_LOCK_DISABLED)
+#if (defined OFP_INP_LOCK_DISABLED)
 # define INP_LOCK_INIT(inp, d, t)	do{(void)inp;(void)d;(void)t;} while (0)
 # define INP_RLOCK(inp)			do{(void)inp;} while (0)
 # define INP_WLOCK(inp)			do{(void)inp;} while (0)
@@ -397,12 +450,26 @@ struct inpcbport {
 # define INP_WLOCK_ASSERT(inp)		do{(void)inp;} while (0)
 # define INP_UNLOCK_ASSERT(inp)		do{(void)inp;} while (0)
 #else
+/* PCB locks are not taken in share-nothing mode */
 # define INP_LOCK_INIT(inp, d, t) odp_rwlock_recursive_init(&(inp)->inp_lock)
-# define INP_RLOCK(inp)		odp_rwlock_recursive_read_lock(&(inp)->inp_lock)
-# define INP_WLOCK(inp)		odp_rwlock_recursive_write_lock(&(inp)->inp_lock)
-# define INP_TRY_WLOCK(inp)	odp_rwlock_recursive_write_trylock(&(inp)->inp_lock)
-# define INP_RUNLOCK(inp)	odp_rwlock_recursive_read_unlock(&(inp)->inp_lock)
-# define INP_WUNLOCK(inp)	odp_rwlock_recursive_write_unlock(&(inp)->inp_lock)
+# define INP_RLOCK(inp) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_recursive_read_lock(&(inp)->inp_lock); \
+	} while (0)
+# define INP_WLOCK(inp) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_recursive_write_lock(&(inp)->inp_lock); \
+	} while (0)
+# define INP_TRY_WLOCK(inp) (OFP_SHARE_NOTHING ? 1 : \
+		odp_rwlock_recursive_write_trylock(&(inp)->inp_lock))
+# define INP_RUNLOCK(inp) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_recursive_read_unlock(&(inp)->inp_lock); \
+	} while (0)
+# define INP_WUNLOCK(inp) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_recursive_write_unlock(&(inp)->inp_lock); \
+	} while (0)
 /* TODO implement assert operations*/
 # define INP_LOCK_ASSERT(inp)	/*rw_assert(&(inp)->inp_lock, RA_LOCKED)*/
 # define INP_RLOCK_ASSERT(inp)	/*rw_assert(&(inp)->inp_lock, RA_RLOCKED)*/
@@ -448,7 +515,7 @@ struct tcpcb *
 	inp_inpcbtotcpcb(struct inpcb *inp);
 void	inp_4tuple_get(struct inpcb *inp, uint32_t *laddr, uint16_t *lp,
 		uint32_t *faddr, uint16_t *fp);
-#if (defined OFP_RSS) || (defined OFP_INP_INFO_DISABLE)
+#if (defined OFP_INP_INFO_DISABLE)
 # define INP_INFO_LOCK_INIT(ipi, d)	do{(void)ipi;(void)d;} while (0)
 # define INP_INFO_RLOCK(ipi)		do{(void)ipi;} while (0)
 # define INP_INFO_WLOCK(ipi)		do{(void)ipi;} while (0)
@@ -461,12 +528,26 @@ void	inp_4tuple_get(struct inpcb *inp, uint32_t *laddr, uint16_t *lp,
 # define INP_INFO_WLOCK_ASSERT(ipi)	do{(void)ipi;} while (0)
 # define INP_INFO_UNLOCK_ASSERT(ipi)	do{(void)ipi;} while (0)
 #else
+/* PCB info locks are not taken in share-nothing mode */
 # define INP_INFO_LOCK_INIT(ipi, d)	odp_rwlock_recursive_init(&(ipi)->ipi_lock)
-# define INP_INFO_RLOCK(ipi)		odp_rwlock_recursive_read_lock(&(ipi)->ipi_lock)
-# define INP_INFO_WLOCK(ipi)		odp_rwlock_recursive_write_lock(&(ipi)->ipi_lock)
-# define INP_INFO_TRY_WLOCK(ipi)	odp_rwlock_recursive_write_trylock(&(ipi)->ipi_lock)
-# define INP_INFO_RUNLOCK(ipi)		odp_rwlock_recursive_read_unlock(&(ipi)->ipi_lock)
-# define INP_INFO_WUNLOCK(ipi)		odp_rwlock_recursive_write_unlock(&(ipi)->ipi_lock)
+# define INP_INFO_RLOCK(ipi) do { \
+		if (!OFP_SHARE_NOTHING) \
+			ofp_rwlock_recursive_read_lock(&(ipi)->ipi_lock); \
+	} while (0)
+# define INP_INFO_WLOCK(ipi) do { \
+		if (!OFP_SHARE_NOTHING) \
+			ofp_rwlock_recursive_write_lock(&(ipi)->ipi_lock); \
+	} while (0)
+# define INP_INFO_TRY_WLOCK(ipi) (OFP_SHARE_NOTHING ? 1 : \
+		odp_rwlock_recursive_write_trylock(&(ipi)->ipi_lock))
+# define INP_INFO_RUNLOCK(ipi) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_recursive_read_unlock(&(ipi)->ipi_lock); \
+	} while (0)
+# define INP_INFO_WUNLOCK(ipi) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_recursive_write_unlock(&(ipi)->ipi_lock); \
+	} while (0)
 
 /* TODO implement assert operations*/
 # define INP_INFO_LOCK_ASSERT(ipi)	/*rw_assert(&(ipi)->ipi_lock, RA_LOCKED, __FILE__, __LINE__)*/
@@ -529,6 +610,34 @@ void	inp_4tuple_get(struct inpcb *inp, uint32_t *laddr, uint16_t *lp,
 #define INP_PCBPORTHASH(lport, mask) \
 	(odp_be_to_cpu_16((lport)) & (mask))
 
+/* Bucket of the hash of pcbinfo for the addresses and ports */
+static inline struct inpcbhead *
+ofp_in_pcbhash_head(struct inpcbinfo *pcbinfo, uint32_t faddr,
+    uint16_t lport, uint16_t fport)
+{
+	uint64_t bucket = INP_PCBHASH(faddr, lport, fport,
+	    pcbinfo->ipi_hashmask);
+
+	if (odp_unlikely(bucket < pcbinfo->ipi_hashsplit))
+		bucket = INP_PCBHASH(faddr, lport, fport,
+		    (pcbinfo->ipi_hashmask << 1) | 1);
+	return &pcbinfo->ipi_hashbase[bucket];
+}
+
+/*
+ * Hash tables of pcbinfo for the VRF, NULL if the VRF has no inpcbs
+ * yet. Those of VRF 0 are in pcbinfo itself.
+ */
+static inline struct inpcbinfo *
+ofp_in_pcbinfo_vrf(struct inpcbinfo *pcbinfo, int vrf)
+{
+	if (odp_likely(vrf == 0) || pcbinfo->ipi_vrf == NULL)
+		return pcbinfo;
+	if (vrf < 0 || vrf >= pcbinfo->ipi_nvrf)
+		return NULL;
+	return __atomic_load_n(&pcbinfo->ipi_vrf[vrf], __ATOMIC_ACQUIRE);
+}
+
 /*
  * Flags for inp_vflags -- historically version flags only
  */
@@ -625,6 +734,7 @@ VNET_DECLARE(int, ofp_ipport_lastauto);
 VNET_DECLARE(int, ofp_ipport_hifirstauto);
 VNET_DECLARE(int, ofp_ipport_hilastauto);
 VNET_DECLARE(int, ofp_ipport_randomized);
+VNET_DECLARE(int, ofp_ipport_percpu);
 VNET_DECLARE(int, ofp_ipport_randomcps);
 VNET_DECLARE(int, ofp_ipport_randomtime);
 VNET_DECLARE(int, ofp_ipport_stoprandom);
@@ -639,6 +749,7 @@ VNET_DECLARE(int, ofp_ipport_tcpallocs);
 #define	V_ipport_hifirstauto	VNET(ofp_ipport_hifirstauto)
 #define	V_ipport_hilastauto	VNET(ofp_ipport_hilastauto)
 #define	V_ipport_randomized	VNET(ofp_ipport_randomized)
+#define	V_ipport_percpu		VNET(ofp_ipport_percpu)
 #define	V_ipport_randomcps	VNET(ofp_ipport_randomcps)
 #define	V_ipport_randomtime	VNET(ofp_ipport_randomtime)
 #define	V_ipport_stoprandom	VNET(ofp_ipport_stoprandom)
@@ -647,12 +758,34 @@ VNET_DECLARE(int, ofp_ipport_tcpallocs);
 void	ofp_in_pcbinfo_destroy(struct inpcbinfo *);
 void	ofp_in_pcbinfo_init(struct inpcbinfo *, const char *, struct inpcbhead *,
 	    int, int, const char *, uma_init, uma_fini, uint32_t);
-#ifdef OFP_RSS
 void	ofp_tcp_rss_in_pcbinfo_init(int, int, uma_init, uma_fini, uint32_t);
-#endif
 
+/* UDP_NUM_CPU PCB tables, see ofp_udp_usrreq.c */
+extern struct inpcbhead *ofp_udb;
+extern struct inpcbinfo *ofp_udbinfo;
+
+/* Index of the PCB table of this core */
+#define UDP_CPU			(OFP_SHARE_NOTHING ? odp_cpu_id() : 0)
+/* Number of PCB tables in use */
+#define UDP_NUM_CPU		(OFP_SHARE_NOTHING ? odp_cpu_count() : 1)
+#define V_udb			ofp_udb[UDP_CPU]
+#define V_udbinfo		ofp_udbinfo[UDP_CPU]
+/* Is pcbinfo the PCB table of any core */
+#define UDP_PCBINFO(pcbinfo)						\
+	((pcbinfo) >= &ofp_udbinfo[0] &&				\
+	 (pcbinfo) <= &ofp_udbinfo[UDP_NUM_CPU - 1])
+
+/*
+ * Chain lengths of the hash of pcbinfo. If hist is not NULL, hist[i] is
+ * the number of buckets with i inpcbs, the last of nhist counting the
+ * longer chains too.
+ */
 void	ofp_in_pcbinfo_hashstats(struct inpcbinfo *pcbinfo, unsigned int *min,
-	    unsigned int *avg, unsigned int *max);
+	    unsigned int *avg, unsigned int *max, unsigned int *hist, int nhist);
+void	ofp_in_pcbinfo_hashprint(int fd, const char *name,
+	    struct inpcbinfo *pcbinfo);
+/* Buckets of a hash allocated for at most pcbs inpcbs */
+uint32_t ofp_in_pcbhash_size(int pcbs);
 
 struct inpcbgroup *
 	in_pcbgroup_byhash(struct inpcbinfo *, uint32_t, uint32_t);
@@ -673,6 +806,8 @@ int	ofp_in_pcballoc(struct socket *, struct inpcbinfo *);
 int	ofp_in_pcbbind(struct inpcb *, struct ofp_sockaddr *, struct ofp_ucred *);
 int	ofp_in_pcb_lport(struct inpcb *, struct ofp_in_addr *, uint16_t *,
 	    struct ofp_ucred *, int);
+int	ofp_in_pcb_lport_dest(struct inpcb *, struct ofp_in_addr *, uint16_t *,
+	    struct ofp_in_addr *, uint16_t, struct ofp_ucred *, int);
 int	ofp_in_pcbbind_setup(struct inpcb *, struct ofp_sockaddr *, ofp_in_addr_t *,
 	    uint16_t *, struct ofp_ucred *);
 int	ofp_in_pcbconnect(struct inpcb *, struct ofp_sockaddr *, struct ofp_ucred *);
@@ -682,11 +817,19 @@ int	ofp_in_pcbconnect_setup(struct inpcb *, struct ofp_sockaddr *, ofp_in_addr_t
 	    uint16_t *, ofp_in_addr_t *, uint16_t *, struct inpcb **,
 	    struct ofp_ucred *);
 void	ofp_in_pcbdetach(struct inpcb *);
+enum ofp_return_code
+	ofp_in_pcb_ip_output(struct inpcb *, odp_packet_t);
 void	ofp_in_pcbdisconnect(struct inpcb *);
 void	ofp_in_pcbdrop(struct inpcb *);
 void	ofp_in_pcbfree(struct inpcb *);
 int	ofp_in_pcbinshash(struct inpcb *);
 int	ofp_in_pcbinshash_nopcbgroup(struct inpcb *);
+int	ofp_in_pcbidx_demux(struct inpcbinfo *, int v6, const void *,
+	    uint16_t, const void *, uint16_t, int, struct inpcb **);
+uint32_t ofp_in_pcbidx_prefetch(struct inpcbinfo *, int v6, const void *,
+	    uint16_t, const void *, uint16_t);
+struct inpcb *
+	ofp_in_pcbidx_peek(struct inpcbinfo *, uint32_t);
 struct inpcb *
 	ofp_in_pcblookup_local(struct inpcbinfo *,
 	    struct ofp_in_addr, uint16_t, int, struct ofp_ucred *);
@@ -714,4 +857,16 @@ struct ofp_sockaddr *
 	ofp_in_sockaddr(ofp_in_port_t port, struct ofp_in_addr *addr);
 void	ofp_in_pcbsosetlabel(struct socket *so);
 
+/*
+ * Of several OFP_SO_REUSEPORT sockets bound to the same address, wildcard
+ * lookups prefer the one created or listening on the current CPU, so that
+ * each core accepts the connections it receives. Returns 1 when no
+ * better candidate than inp may follow.
+ */
+static inline int ofp_in_pcb_reuseport_local(struct inpcb *inp)
+{
+	return (inp->inp_flags2 & INP_REUSEPORT) == 0 ||
+		inp->inp_cpu == odp_cpu_id();
+}
+
 #endif /* !_NETINET_IN_PCB_H_ */
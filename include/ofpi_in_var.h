@@ -264,6 +264,8 @@ struct ofp_ip_moptions;
 
 int	ofp_imo_multi_filter(const struct ofp_ip_moptions *, const struct ofp_ifnet *,
 	    const struct ofp_sockaddr *, const struct ofp_sockaddr *);
+/* Nonzero if group may have been joined on ifp. Lockless. */
+int	ofp_in_mcast_member(const struct ofp_ifnet *, struct ofp_in_addr);
 void	ofp_inm_commit(struct ofp_in_multi *);
 void	ofp_inm_clear_recorded(struct ofp_in_multi *);
 void	ofp_inm_print(const struct ofp_in_multi *);
@@ -13,10 +13,33 @@
 #define SHM_NAME_GLOBAL_CONFIG "OfpGlobalConfigShMem"
 
 extern odp_pool_t ofp_packet_pool;
+/* Pool of short packets, see ofp_packet_alloc() */
+extern odp_pool_t ofp_packet_pool_small;
+extern uint32_t ofp_packet_small_len;
+
+/* Packet vector events, from ODP 1.26 on */
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 26
+#define OFP_PKTIN_VECTOR 1
+#endif
+
+/* Pool of input packet vectors, invalid if they are not used */
+extern odp_pool_t ofp_pktin_vector_pool;
+/* Pool of OFP_SIGEV_QUEUE socket events, invalid if there are none */
+extern odp_pool_t ofp_sock_event_pool;
 extern odp_cpumask_t cpumask;
 
 int ofp_term_post_global(const char *pool_name);
 
+/* Create a packet pool as configured in global_param->pkt_pool */
+odp_pool_t ofp_packet_pool_create(const char *name);
+
+/*
+ * Restore the state saved by ofp_warm_save(). Returns the number of
+ * saved routes that could not be restored, 0 also if nothing was saved,
+ * or -1 if the file is not valid.
+ */
+int ofp_warm_restore(const char *file);
+
 struct ofp_global_config_mem {
 	odp_bool_t is_running ODP_ALIGNED_CACHE;
 
@@ -33,6 +56,9 @@ struct ofp_global_config_mem {
 
 extern __thread ofp_global_param_t *global_param;
 
+/* Share-nothing TCP mode, see ofp_global_param_t::share_nothing */
+#define OFP_SHARE_NOTHING (global_param->share_nothing)
+
 struct ofp_global_config_mem *ofp_get_global_config(void);
 
 #endif /* __OFPI_INIT_H__ */
@@ -10,19 +10,63 @@
 #include <odp_api.h>
 #include "api/ofp_ip.h"
 #include "api/ofp_log.h"
+#include "api/ofp_config.h"
 #include "ofpi_shared_mem.h"
 
 #define SHM_NAME_IP "OfpIpShMem"
 
+/* Hash buckets of the flow queues, the unit of rebalancing */
+#define OFP_FLOW_BUCKETS 1024
+
+/*
+ * Optional features of the IPv4 input path. The path is built for each
+ * feature set below and ofp_ipv4_processing() runs the one of the
+ * features configured, so that the others cost nothing per packet.
+ */
+#define OFP_IP4_FEAT_VXLAN	0x1	/* a VXLAN interface has been up */
+#define OFP_IP4_FEAT_IPSEC	0x2	/* IPsec policies */
+#define OFP_IP4_FEAT_FILTER	0x4	/* hooks, ACLs, connection tracking */
+#define OFP_IP4_FEAT_ALL	(OFP_IP4_FEAT_VXLAN | OFP_IP4_FEAT_IPSEC | \
+				 OFP_IP4_FEAT_FILTER)
+
 struct ofp_global_ip_state {
 	union {
 		odp_atomic_u32_t ip_id;
 		uint8_t padding[ODP_CACHE_LINE_SIZE];
 	} ODP_ALIGNED_CACHE;
+
+	/* Atomic queues of local flows in the ordered mode */
+	uint32_t flow_queue_num;
+	odp_queue_t flow_queue[OFP_FLOW_QUEUES_MAX];
+	/* Flow queue of each hash bucket, moved by the rebalancing timer */
+	uint8_t flow_bucket_queue[OFP_FLOW_BUCKETS];
+	/* Packets of each bucket since the last check, if rebalancing */
+	int flow_rebalance;
+	uint32_t flow_bucket_cnt[OFP_FLOW_BUCKETS];
+	odp_timer_t flow_rebalance_tmr;
+	int flow_rebalance_hot;		/* intervals in a row above */
+	uint64_t flow_bucket_moves;
+
+	/* OFP_IP4_FEAT_* in use, written under feat_lock */
+	odp_atomic_u32_t ip4_feat;
+	odp_spinlock_t feat_lock;
+	int vxlan_used;
 };
 
 extern __thread struct ofp_global_ip_state *ofp_ip_shm;
 
+static inline uint32_t ofp_ip4_feat(void)
+{
+	return odp_atomic_load_u32(&ofp_ip_shm->ip4_feat);
+}
+
+/*
+ * Recompute the IPv4 input features after a configuration change:
+ * IPsec policies, ACLs, or vxlan set after a VXLAN interface is added.
+ * Packets being processed may still take the previous path.
+ */
+void ofp_ip4_feat_update(int vxlan);
+
 static inline void ofp_ip_id_assign(struct ofp_ip *ip)
 {
 	uint16_t id = odp_atomic_fetch_inc_u32(&ofp_ip_shm->ip_id) & 0xffff;
@@ -45,6 +89,13 @@ static inline int ofp_ip_init_global(void)
 		return -1;
 	}
 	odp_atomic_init_u32(&ofp_ip_shm->ip_id, 0);
+	ofp_ip_shm->flow_queue_num = 0;
+	ofp_ip_shm->flow_rebalance = 0;
+	ofp_ip_shm->flow_rebalance_tmr = ODP_TIMER_INVALID;
+	/* Everything is looked for until ofp_init_global() has run */
+	odp_atomic_init_u32(&ofp_ip_shm->ip4_feat, OFP_IP4_FEAT_ALL);
+	odp_spinlock_init(&ofp_ip_shm->feat_lock);
+	ofp_ip_shm->vxlan_used = 0;
 	return 0;
 }
 
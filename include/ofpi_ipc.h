@@ -0,0 +1,54 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_IPC_H__
+#define __OFPI_IPC_H__
+
+#include <odp_api.h>
+
+#include "api/ofp_ipc.h"
+#include "api/ofp_socket.h"
+
+/*
+ * Socket operations of other processes, see api/ofp_ipc.h. Each client
+ * slot is a single producer ring in exported shared memory, drained in
+ * order by a server thread of the stack process on the slow path core.
+ */
+
+struct ofp_ipc_client;
+
+/* Slot of the calling thread, NULL unless attached as a client */
+extern __thread struct ofp_ipc_client *ofp_ipc_self;
+
+static inline int ofp_ipc_attached(void)
+{
+	return odp_unlikely(ofp_ipc_self != NULL);
+}
+
+int ofp_ipc_socket(int domain, int type, int protocol, int vrf);
+int ofp_ipc_close(int fd);
+int ofp_ipc_shutdown(int fd, int how);
+int ofp_ipc_bind(int fd, const struct ofp_sockaddr *addr,
+		 ofp_socklen_t addrlen);
+int ofp_ipc_connect(int fd, const struct ofp_sockaddr *addr,
+		    ofp_socklen_t addrlen);
+int ofp_ipc_listen(int fd, int backlog);
+int ofp_ipc_accept(int fd, struct ofp_sockaddr *addr,
+		   ofp_socklen_t *addrlen);
+ofp_ssize_t ofp_ipc_sendto(int fd, const void *buf, size_t len, int flags,
+			   const struct ofp_sockaddr *addr,
+			   ofp_socklen_t addrlen);
+ofp_ssize_t ofp_ipc_recvfrom(int fd, void *buf, size_t len, int flags,
+			     struct ofp_sockaddr *addr,
+			     ofp_socklen_t *addrlen);
+
+int ofp_ipc_start_server(const odp_cpumask_t *cpumask);
+void ofp_ipc_stop_server(void);
+
+int ofp_ipc_init_global(odp_instance_t instance);
+int ofp_ipc_term_global(void);
+
+#endif /* __OFPI_IPC_H__ */
@@ -26,12 +26,16 @@ struct ofp_ipsec {
 	odp_ipsec_op_mode_t outbound_op_mode;
 	ofp_brlock_t processing_lock;
 	uint32_t max_num_sa;
+	uint32_t burst_size;
 	odp_queue_t in_queue;
 	odp_queue_t out_queue;
 };
 
 extern __thread struct ofp_ipsec *ofp_ipsec_shm;
 
+/* Nonzero if this thread has packets waiting for ODP IPsec submission */
+extern __thread int ofp_ipsec_pending;
+
 /*
  * Initialize IPsec parameters to their default values.
  */
@@ -55,6 +59,31 @@ int ofp_ipsec_init_global(const struct ofp_ipsec_param *param);
  */
 int ofp_ipsec_init_local(void);
 
+/*
+ * Drop the packets this thread has not yet submitted to ODP IPsec.
+ */
+int ofp_ipsec_term_local(void);
+
+/*
+ * Enable inline IPsec in the configuration of an interface if inline
+ * operation mode is in use and the interface supports it.
+ */
+void ofp_ipsec_pktio_config(const char *if_name,
+			    const odp_pktio_capability_t *capa,
+			    odp_pktio_config_t *config);
+
+/*
+ * Submit the packets this thread has collected for asynchronous
+ * processing to ODP IPsec.
+ */
+void ofp_ipsec_flush(void);
+
+static inline void ofp_ipsec_send_pending(void)
+{
+	if (odp_unlikely(ofp_ipsec_pending))
+		ofp_ipsec_flush();
+}
+
 /*
  * Stop IPsec before termination. This may generate status events that need
  * to be handled to finalize SA destruction.
@@ -74,6 +74,14 @@ const ofp_ipsec_sa_param_t *ofp_ipsec_sa_get_param(struct ofp_ipsec_sa *sa);
 int ofp_ipsec_sa_set_selectors(struct ofp_ipsec_sa *sa,
 			       const ofp_ipsec_selectors_t *sel);
 
+/*
+ * Count a packet processed with an SA. The counts of a thread are
+ * added to the SA in batches and by ofp_ipsec_sa_stat_flush().
+ */
+void ofp_ipsec_sa_stat_count(struct ofp_ipsec_sa *sa, uint32_t bytes);
+
+void ofp_ipsec_sa_stat_flush(void);
+
 /*
  * Get selectors associated with an SA.
  */
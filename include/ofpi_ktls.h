@@ -0,0 +1,60 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_KTLS_H__
+#define __OFPI_KTLS_H__
+
+#include <odp_api.h>
+#include "api/ofp_tcp.h"
+
+struct socket;
+struct sockopt;
+
+#define OFP_KTLS_HDR_LEN	5	/* type, version, length */
+#define OFP_KTLS_NONCE_LEN	8	/* TLS 1.2 explicit nonce */
+#define OFP_KTLS_TAG_LEN	16
+
+/*
+ * TLS sending state of a socket, used under the send lock of the
+ * socket buffer. Not in use while vminor is zero.
+ */
+struct ofp_ktls {
+	odp_crypto_session_t session;
+	uint64_t seq;			/* of the next record */
+	uint8_t iv[12];
+	uint8_t vminor;
+};
+
+/* Bytes before the data of a record: header and explicit nonce */
+static inline uint32_t ofp_ktls_hdr_len(const struct ofp_ktls *tls)
+{
+	return OFP_KTLS_HDR_LEN +
+		(tls->vminor == OFP_TLS_VMINOR_12 ? OFP_KTLS_NONCE_LEN : 0);
+}
+
+/* Bytes a record adds to its data, zero if not in use */
+static inline uint32_t ofp_ktls_overhead(const struct ofp_ktls *tls)
+{
+	if (odp_likely(!tls->vminor))
+		return 0;
+	/* TLS 1.3 appends the real content type to the data */
+	return ofp_ktls_hdr_len(tls) + OFP_KTLS_TAG_LEN +
+		(tls->vminor == OFP_TLS_VMINOR_13 ? 1 : 0);
+}
+
+/*
+ * Encrypt a record laid out in pkt: ofp_ktls_hdr_len() bytes of room,
+ * the data, and the rest of ofp_ktls_overhead() at the end.
+ */
+int ofp_ktls_seal(struct ofp_ktls *tls, odp_packet_t pkt);
+
+/* Add the room around the data of pkt and encrypt it as one record */
+int ofp_ktls_frame(struct ofp_ktls *tls, odp_packet_t *pkt);
+
+int ofp_ktls_setopt(struct socket *so, struct sockopt *sopt);
+void ofp_ktls_free(struct socket *so);
+
+#endif /* __OFPI_KTLS_H__ */
@@ -0,0 +1,54 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef __OFPI_LAG_H__
+#define __OFPI_LAG_H__
+
+#include <odp_api.h>
+
+#include "api/ofp_ethernet.h"
+#include "ofpi_portconf.h"
+
+/*
+ * Link aggregation. A LAG port is a port without a pktio of its own
+ * whose members are ordinary ports. The members receive, and packets
+ * to the LAG port are sent on the member of their flow hash bucket.
+ * The link status of the members is polled and the buckets of a
+ * member whose link is down are spread over the other members.
+ */
+
+/* Member port for sending pkt on lag, NULL if no member has its link up */
+struct ofp_ifnet *ofp_lag_tx_member(struct ofp_ifnet *lag, odp_packet_t pkt);
+
+/*
+ * Send pkt on members of lag. Packets that could not be sent are
+ * freed. Returns num.
+ */
+int ofp_lag_send_multi(struct ofp_ifnet *lag, odp_packet_t pkt[], int num,
+		       int queue_id);
+
+/* Stop polling the member links before the ports are closed */
+int ofp_lag_term(struct ofp_ifnet *lag);
+
+/*
+ * Interface of a packet received on a member: its LAG, or the member
+ * itself for slow protocol frames (LACP) that go to the member's
+ * slow path.
+ */
+static inline struct ofp_ifnet *ofp_lag_rx(struct ofp_ifnet *member,
+					   odp_packet_t pkt)
+{
+	struct ofp_ether_header *eth = odp_packet_data(pkt);
+
+	if (odp_unlikely(odp_packet_seg_len(pkt) >= sizeof(*eth) &&
+			 eth->ether_type ==
+			 odp_cpu_to_be_16(OFP_ETHERTYPE_SLOW)))
+		return member;
+
+	return member->lag;
+}
+
+#endif /* __OFPI_LAG_H__ */
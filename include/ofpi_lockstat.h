@@ -0,0 +1,81 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_LOCKSTAT_H__
+#define __OFPI_LOCKSTAT_H__
+
+#include <odp_api.h>
+
+/*
+ * Lock contention statistics, built with --enable-lock-stat. The lock
+ * macros below count acquisitions per call site and thread. A lock that
+ * is not free on the first try counts as contended and the cycles
+ * spent waiting for it are added up. Without OFP_LOCK_STAT the macros
+ * are the plain ODP calls.
+ *
+ * A call site is named by the lock expression, file and line. Sites
+ * register on their first acquisition after ofp_init_local().
+ */
+
+#define OFP_LOCKSTAT_SITES 256
+
+#ifdef OFP_LOCK_STAT
+
+int ofp_lockstat_site(const char *name, const char *file, int line);
+void ofp_lockstat_count(int site, int contended, uint64_t cycles);
+
+#define OFP_LOCKSTAT_ACQUIRE(lock_fn, trylock_fn, lock) do {		\
+		static int _site = -1;					\
+		uint64_t _start;					\
+									\
+		if (odp_unlikely(_site < 0))				\
+			_site = ofp_lockstat_site(#lock, __FILE__,	\
+						  __LINE__);		\
+		if (odp_likely(trylock_fn(lock))) {			\
+			ofp_lockstat_count(_site, 0, 0);		\
+			break;						\
+		}							\
+		_start = odp_cpu_cycles();				\
+		lock_fn(lock);						\
+		ofp_lockstat_count(_site, 1,				\
+			odp_cpu_cycles_diff(odp_cpu_cycles(), _start));	\
+	} while (0)
+
+#define ofp_rwlock_read_lock(lock) OFP_LOCKSTAT_ACQUIRE(		\
+		odp_rwlock_read_lock, odp_rwlock_read_trylock, lock)
+#define ofp_rwlock_write_lock(lock) OFP_LOCKSTAT_ACQUIRE(		\
+		odp_rwlock_write_lock, odp_rwlock_write_trylock, lock)
+#define ofp_rwlock_recursive_read_lock(lock) OFP_LOCKSTAT_ACQUIRE(	\
+		odp_rwlock_recursive_read_lock,				\
+		odp_rwlock_recursive_read_trylock, lock)
+#define ofp_rwlock_recursive_write_lock(lock) OFP_LOCKSTAT_ACQUIRE(	\
+		odp_rwlock_recursive_write_lock,			\
+		odp_rwlock_recursive_write_trylock, lock)
+#define ofp_spinlock_lock(lock) OFP_LOCKSTAT_ACQUIRE(			\
+		odp_spinlock_lock, odp_spinlock_trylock, lock)
+
+int ofp_lockstat_lookup_shared_memory(void);
+void ofp_lockstat_init_prepare(void);
+int ofp_lockstat_init_global(void);
+int ofp_lockstat_term_global(void);
+
+#else
+
+#define ofp_rwlock_read_lock(lock) odp_rwlock_read_lock(lock)
+#define ofp_rwlock_write_lock(lock) odp_rwlock_write_lock(lock)
+#define ofp_rwlock_recursive_read_lock(lock) \
+	odp_rwlock_recursive_read_lock(lock)
+#define ofp_rwlock_recursive_write_lock(lock) \
+	odp_rwlock_recursive_write_lock(lock)
+#define ofp_spinlock_lock(lock) odp_spinlock_lock(lock)
+
+#endif /* OFP_LOCK_STAT */
+
+/* CLI output, sites with the most wait cycles first */
+void ofp_lockstat_print(int fd);
+void ofp_lockstat_clear(void);
+
+#endif /* __OFPI_LOCKSTAT_H__ */
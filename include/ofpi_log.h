@@ -6,3 +6,25 @@
  */
 
 #include "api/ofp_log.h"
+
+#ifndef __OFPI_LOG_H__
+#define __OFPI_LOG_H__
+
+/*
+ * Asynchronous logging, see ofp_global_param_t.logging. Threads with
+ * an ODP thread id format their messages into their own single
+ * producer ring, drained by a logger thread on the slow path core.
+ * Other threads, and all before the logger starts, write directly.
+ */
+
+int ofp_log_start_logger(const odp_cpumask_t *cpumask);
+void ofp_log_stop_logger(void);
+
+int ofp_log_lookup_shared_memory(void);
+void ofp_log_init_prepare(void);
+int ofp_log_init_global(void);
+int ofp_log_term_global(void);
+int ofp_log_init_local(void);
+void ofp_log_term_local(void);
+
+#endif /* __OFPI_LOG_H__ */
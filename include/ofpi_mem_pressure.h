@@ -0,0 +1,57 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_MEM_PRESSURE_H__
+#define __OFPI_MEM_PRESSURE_H__
+
+#include <odp_api.h>
+#include "api/ofp_init.h"
+
+/*
+ * Memory pressure of the packet pools and UMA zones, checked from a
+ * timer against the watermarks of global_param->mem_pressure.
+ *
+ * OFP_MEM_PRESSURE_LOW: TCP advertises half the receive window and
+ * slow path copies of other than routing, ARP/ND and ICMP packets are
+ * dropped.
+ *
+ * OFP_MEM_PRESSURE_HIGH: TCP advertises a quarter of the receive
+ * window, only routing and ARP/ND packets are copied to the slow path
+ * and received packets other than ARP, TCP and ICMP are dropped before
+ * processing.
+ */
+enum ofp_mem_pressure_level {
+	OFP_MEM_PRESSURE_NONE = 0,
+	OFP_MEM_PRESSURE_LOW,
+	OFP_MEM_PRESSURE_HIGH,
+	OFP_MEM_PRESSURE_MAX
+};
+
+/* Level of the shared state, NULL if the check is disabled */
+extern __thread odp_atomic_u32_t *ofp_mem_pressure_lvl;
+
+static inline int ofp_mem_pressure(void)
+{
+	if (odp_likely(!ofp_mem_pressure_lvl))
+		return OFP_MEM_PRESSURE_NONE;
+	return odp_atomic_load_u32(ofp_mem_pressure_lvl);
+}
+
+/*
+ * Packets of a pool of capacity packets out of the pool, cached ones
+ * excluded. Returns -1 if the ODP implementation cannot tell.
+ */
+int ofp_pkt_pool_in_use(odp_pool_t pool, uint32_t capacity,
+			uint64_t *in_use);
+
+void ofp_mem_pressure_print(int fd);
+
+int ofp_mem_pressure_lookup_shared_memory(void);
+void ofp_mem_pressure_init_prepare(void);
+int ofp_mem_pressure_init_global(struct mem_pressure_s *param);
+int ofp_mem_pressure_term_global(void);
+
+#endif /* __OFPI_MEM_PRESSURE_H__ */
@@ -0,0 +1,82 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_MODULE_H__
+#define __OFPI_MODULE_H__
+
+#include <stdint.h>
+#include "ofpi_init.h"
+
+#ifdef OFP_IGMP
+#define OFP_MODULE_IGMP_BUILT	OFP_MODULE_IGMP
+#else
+#define OFP_MODULE_IGMP_BUILT	0
+#endif
+#ifdef OFP_VXLAN
+#define OFP_MODULE_VXLAN_BUILT	OFP_MODULE_VXLAN
+#else
+#define OFP_MODULE_VXLAN_BUILT	0
+#endif
+#ifdef OFP_GRE
+#define OFP_MODULE_GRE_BUILT	OFP_MODULE_GRE
+#else
+#define OFP_MODULE_GRE_BUILT	0
+#endif
+
+/* Modules in this build. IPsec is always built, for its API. */
+#define OFP_MODULES_BUILT	(OFP_MODULE_IGMP_BUILT | OFP_MODULE_IPSEC | \
+				 OFP_MODULE_VXLAN_BUILT | OFP_MODULE_GRE_BUILT)
+
+#define OFP_MODULE_PROTOS	3
+
+/*
+ * A protocol module. The hooks are called from the init and term
+ * phases of ofp_init.c, in the order of the modules, and only when the
+ * module is enabled. Any of them may be NULL.
+ */
+struct ofp_module {
+	const char *name;
+	uint32_t id;				/* OFP_MODULE_* */
+	/* IP protocols handled, zero terminated */
+	uint8_t protocols[OFP_MODULE_PROTOS];
+	/* Hooks called even when disabled, to keep the API working */
+	int keep_api;
+
+	void (*init_prepare)(void);
+	int (*init_global)(void);	/* last in ofp_init_pre_global() */
+	int (*init_ifnet)(void);	/* before interfaces are created */
+	int (*init_local)(void);
+	int (*term_local)(void);
+	int (*term_ifnet)(void);	/* after interfaces are cleaned */
+	int (*term_global)(void);	/* first in ofp_term_post_global() */
+	int (*stop_global)(void);	/* before the final event drain */
+	int (*term_drained)(void);	/* after the drain and the timers */
+};
+
+/*
+ * A constant zero for a module left out of the build, so that the
+ * code behind the check is compiled out.
+ */
+static inline int ofp_module_enabled(uint32_t id)
+{
+	return (OFP_MODULES_BUILT & id) &&
+		!(global_param->modules_disabled & id);
+}
+
+/* Whether IP protocol proto belongs to a disabled module */
+int ofp_module_proto_disabled(uint8_t proto);
+
+void ofp_module_init_prepare(void);
+int ofp_module_init_global(void);
+int ofp_module_init_ifnet(void);
+int ofp_module_init_local(void);
+int ofp_module_term_local(void);
+int ofp_module_term_ifnet(void);
+int ofp_module_term_global(void);
+int ofp_module_stop_global(void);
+int ofp_module_term_drained(void);
+
+#endif /* __OFPI_MODULE_H__ */
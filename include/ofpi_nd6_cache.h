@@ -0,0 +1,48 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#ifndef __OFPI_ND6_CACHE_H__
+#define __OFPI_ND6_CACHE_H__
+
+#include <odp_api.h>
+
+#include "ofpi_portconf.h"
+
+/*
+ * IPv6 neighbour cache. Entries are hashed by VRF and address, and a
+ * next hop keeps the index of its gateway entry as a lookup hint.
+ * Packets to a neighbour being resolved wait in a queue of the entry.
+ */
+
+int ofp_nd6_cache_lookup_shared_memory(void);
+void ofp_nd6_cache_init_prepare(void);
+int ofp_nd6_cache_init_global(void);
+int ofp_nd6_cache_term_global(void);
+
+/*
+ * Find the MAC of neighbour addr of dev, for sending pkt. Returns
+ * OFP_PKT_CONTINUE with the MAC in mac. Otherwise resolution was
+ * started and the packet is either queued (OFP_PKT_PROCESSED) or must
+ * be dropped. hint, if not NULL, is the entry index cached by the
+ * caller and is updated.
+ */
+enum ofp_return_code ofp_nd6_resolve(odp_packet_t pkt, struct ofp_ifnet *dev,
+				     uint8_t *addr, uint32_t *hint,
+				     uint8_t *mac);
+
+/*
+ * Update the MAC of neighbour addr of dev. Reachability is confirmed if
+ * confirmed is set, and manual entries are not aged nor changed by ND.
+ * The waiting packets are sent.
+ */
+void ofp_nd6_cache_update(struct ofp_ifnet *dev, uint8_t *addr,
+			  uint8_t *mac, odp_bool_t confirmed,
+			  odp_bool_t is_manual);
+
+void ofp_nd6_cache_show(int fd);
+void ofp_nd6_cache_age_cb(void *arg);
+
+#endif /* __OFPI_ND6_CACHE_H__ */
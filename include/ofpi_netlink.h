@@ -32,3 +32,15 @@ int start_quagga_nl_server(void *arg);
 int start_netlink_nl_server(void *arg);
 int ofp_create_ns_socket(int vrf);
 #endif
+
+struct nlmsghdr;
+
+/*
+ * Route messages in the netlink format, also used by the FPM of Quagga.
+ * IPv4 and IPv6 routes are collected and applied in bulk by
+ * ofp_netlink_route_flush(), which returns the number of messages that
+ * could not be applied.
+ */
+void ofp_netlink_route_init(void);
+void ofp_netlink_route_add(struct nlmsghdr *nlh, int vrf);
+int ofp_netlink_route_flush(void);
@@ -0,0 +1,45 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_NH_GROUP_H__
+#define __OFPI_NH_GROUP_H__
+
+#include <odp_api.h>
+#include "api/ofp_types.h"
+#include "api/ofp_ip.h"
+
+/*
+ * ECMP next hop groups. A route with OFP_RTF_MULTIPATH refers to a group
+ * by the index in arp_ent_idx of its next hop. Each group maps
+ * OFP_NH_GROUP_BUCKETS hash buckets to its members. A member change
+ * moves only the buckets of removed members and the share needed by
+ * new members, so that most flows keep their next hop.
+ */
+
+#define OFP_NH_GROUP_BUCKETS 256
+
+/* Take and release a reference of a group for a route using it */
+int ofp_nh_group_hold(uint32_t group, struct ofp_nh_entry *nh);
+void ofp_nh_group_release(uint32_t group);
+
+/*
+ * Copy the OFP_NH_GROUP_MAX members at most of a group to members.
+ * Returns their number, or -1 if the group is not allocated.
+ */
+struct ofp_nh_group_member;
+int ofp_nh_group_get(uint32_t group, uint16_t *vrf,
+		     struct ofp_nh_group_member *members);
+
+/* Next hop of the flow of ip in the group of nh */
+struct ofp_nh_entry *ofp_nh_group_select(struct ofp_nh_entry *nh,
+					 struct ofp_ip *ip);
+
+int ofp_nh_group_lookup_shared_memory(void);
+void ofp_nh_group_init_prepare(void);
+int ofp_nh_group_init_global(void);
+int ofp_nh_group_term_global(void);
+
+#endif /* __OFPI_NH_GROUP_H__ */
@@ -25,4 +25,13 @@
 #define OFP_SHM_SINGLE_VA 0
 #endif
 
+/*
+ * ODP 1.21.0.0 introduced ODP_SHM_HP for requiring huge pages.
+ */
+#ifdef ODP_SHM_HP
+#define OFP_SHM_HP ODP_SHM_HP
+#else
+#define OFP_SHM_HP 0
+#endif
+
 #endif /* OFPI_ODP_COMPAT_H */
@@ -9,6 +9,7 @@
 #define _OFPI_APP_H
 
 #include <odp_api.h>
+#include <stddef.h>
 #include <string.h>
 #include "api/ofp_types.h"
 #include "api/ofp_pkt_processing.h"
@@ -16,11 +17,16 @@
 #include "ofpi_init.h"
 #include "ofpi_vxlan.h"
 #include "ofpi_ipsec.h"
+#include "ofpi_tm.h"
+
+struct ofp_flow_cache_entry;
 
 struct ip_out {
 	struct ofp_ifnet *dev_out;
 	struct ofp_nh_entry *nh;
 	struct ofp_ip *ip;
+	/* Flow cache slot to fill with the output, or NULL */
+	struct ofp_flow_cache_entry *fc;
 	uint32_t gw;
 	uint16_t vrf;
 	uint8_t is_local_address;
@@ -38,18 +44,68 @@ struct ip_out {
 #define OFP_L4_CHKSUM_STATUS_VALID  0x2
 #define OFP_UDP_CHKSUM_INSERT       0x4
 #define OFP_TCP_CHKSUM_INSERT       0x8
+/* L4 checksum was checked before, see ofpi_gro.h */
+#define OFP_L4_CHKSUM_VERIFIED      0x10
+/* Parse flags are from the pktio, not from a packet built by OFP */
+#define OFP_PARSE_VALID             0x20
+
+/* Parts of the packet user area past OFP_UA_HOT_SIZE that are set */
+#define OFP_UA_PACE  0x1	/* tx_time, tx_gap */
+#define OFP_UA_CT    0x2	/* ct_flow, ct_reply */
+#define OFP_UA_TS    0x4	/* ts */
+#define OFP_UA_VXLAN 0x8	/* vxlan, set for packets of VXLAN ifnets */
+#define OFP_UA_HASH  0x10	/* flow_hash */
 
+/*
+ * Per packet metadata. The ingress ifnet is in the user pointer and
+ * the parse offsets in the ODP packet. Only the first OFP_UA_HOT_SIZE
+ * bytes are reset for each packet, the rest is valid as told by the
+ * OFP_UA_* bits of valid and written only when used, so that most
+ * packets touch a single line of the user area.
+ */
 struct ofp_packet_user_area {
 	uint8_t ipsec_flags;
 	uint8_t recursion_count;
 	uint8_t chksum_flags;
+	/* Handed to a flow queue, see ofp_global_param_t.flow_queues */
+	uint8_t flow_ctx;
+	/* OFP_UA_* */
+	uint8_t valid;
+	uint8_t ct_reply;
+	/* Payload per segment of a TCP burst, 0 if not segmented */
+	uint16_t tso_segsz;
+	/* Flow hash of a received packet, OFP_UA_HASH */
+	uint32_t flow_hash;
+	/* Size of the datagrams of a record coalesced by OFP_UDP_GRO */
+	uint16_t gro_segsz;
+
+	/* Not reset, see valid */
+
+	/* Departure time in ns of odp_time_global() of a paced packet */
+	uint64_t tx_time;
+	/* Time between the segments of a paced TCP burst in ns */
+	uint32_t tx_gap;
+	/* Connection tracking flow of a received packet */
+	struct ofp_ct_flow *ct_flow;
+	/* OFP_SO_TIMESTAMPING, see ofp_sock_tx_timestamp() */
+	union {
+		/* Receive time in ns, 0 if not taken */
+		uint64_t rx_ns;
+		/* Socket fd + 1 and datagram to stamp on transmit */
+		struct {
+			uint32_t fd;
+			uint32_t id;
+		} tx;
+	} ts;
 	struct vxlan_user_data vxlan;
 };
 
+#define OFP_UA_HOT_SIZE offsetof(struct ofp_packet_user_area, tx_time)
+
 static inline void ofp_packet_user_area_reset(odp_packet_t pkt)
 {
 	struct ofp_packet_user_area *ua = odp_packet_user_area(pkt);
-	memset(ua, 0, sizeof(*ua));
+	memset(ua, 0, OFP_UA_HOT_SIZE);
 }
 
 static inline struct ofp_packet_user_area *ofp_packet_user_area(odp_packet_t pkt)
@@ -66,11 +122,56 @@ static inline odp_packet_t ofp_packet_alloc_from_pool(odp_pool_t pool,
 	return pkt;
 }
 
+/*
+ * Packets of up to ofp_packet_small_len bytes come from the pool of
+ * short packets, longer ones and those it runs out of from the default
+ * pool.
+ */
 static inline odp_packet_t ofp_packet_alloc(uint32_t len)
 {
+	odp_packet_t pkt;
+
+	if (len <= ofp_packet_small_len) {
+		pkt = ofp_packet_alloc_from_pool(ofp_packet_pool_small, len);
+		if (odp_likely(pkt != ODP_PACKET_INVALID))
+			return pkt;
+	}
 	return ofp_packet_alloc_from_pool(ofp_packet_pool, len);
 }
 
+/*
+ * Remove len bytes from the head of *pkt. The packet handle changes if
+ * len crosses the first segment, as the head segments are then freed.
+ */
+static inline int ofp_packet_drop_head(odp_packet_t *pkt, uint32_t len)
+{
+	if (odp_likely(odp_packet_pull_head(*pkt, len) != NULL))
+		return 0;
+
+	return odp_packet_trunc_head(pkt, len, NULL, NULL) < 0 ? -1 : 0;
+}
+
+/*
+ * Bytes from the L3 header on that ofp_ipv4_processing() and
+ * ofp_ipv6_processing() make contiguous: IP and TCP headers with
+ * options.
+ */
+#define OFP_PKT_PULLUP_LEN 128
+
+/*
+ * Make len bytes from off on, or up to the end of the packet,
+ * contiguous in memory. The packet handle may change. Returns 0 on
+ * success, -1 if the packet could not be rearranged and was kept as is.
+ */
+int ofp_packet_pullup(odp_packet_t *pkt, uint32_t off, uint32_t len);
+
+/*
+ * Duplicate pkt for another receiver. The first hdr_len bytes are
+ * copied, the rest is shared by reference and must not be modified
+ * through either packet. Falls back to a full copy.
+ */
+odp_packet_t ofp_packet_clone(odp_packet_t pkt, uint32_t hdr_len);
+
 enum ofp_return_code send_pkt_out(struct ofp_ifnet *dev,
 			odp_packet_t pkt);
 enum ofp_return_code send_pkt_loop(struct ofp_ifnet *dev,
@@ -82,20 +183,36 @@ enum ofp_return_code ipv6_transport_classifier(odp_packet_t *pkt,
 			uint8_t ip6_nxt);
 
 int ofp_send_pkt_out_init_local(void);
+
+/* Adapt the transmit burst to a received burst of rx_cnt events */
+void ofp_send_burst_rx(uint32_t rx_cnt);
+/* Packets of the thread to stamp on transmit, see ofp_packet_user_area.ts */
+extern __thread uint32_t ofp_tx_ts_num;
+/* Schedule wait time until the held packets must be sent */
+uint64_t ofp_send_pending_wait(void);
+/*
+ * The thread polls ofp_send_pending_pkt() continuously: hold paced
+ * packets until their departure time, and adaptive bursts for at most
+ * pkt_tx_hold_ns, see ofp_send_pending_wait()
+ */
+void ofp_send_pace_poll(odp_bool_t poll);
 int ofp_send_pkt_out_term_local(void);
 
 
 static inline int ofp_send_pkt_multi(struct ofp_ifnet *ifnet,
 			odp_packet_t *pkt_tbl, uint32_t pkt_tbl_cnt,
-			int core_id)
+			int queue_id)
 {
 	int out_idx;
 
-	out_idx = core_id % ifnet->out_queue_num;
+	out_idx = queue_id % ifnet->out_queue_num;
 
 	if (ifnet->out_queue_type == OFP_OUT_QUEUE_TYPE_PKTOUT) {
 		return odp_pktout_send(ifnet->out_queue_pktout[out_idx],
 			pkt_tbl, pkt_tbl_cnt);
+	} else if (odp_unlikely(ifnet->out_queue_type ==
+				OFP_OUT_QUEUE_TYPE_TM)) {
+		return ofp_tm_send_multi(ifnet, pkt_tbl, pkt_tbl_cnt);
 	} else {
 		odp_event_t ev_tbl[pkt_tbl_cnt];
 
@@ -113,6 +230,34 @@ enum ofp_return_code ofp_ip_output_common(odp_packet_t pkt,
 
 enum ofp_return_code ofp_ip_output(odp_packet_t pkt, struct ofp_nh_entry *nh);
 
+/*
+ * As ofp_ip_output(), with the output interface and the Ethernet header
+ * remembered in fc of the caller while routes and ARP entries do not
+ * change, see ofpi_flow_cache.h.
+ */
+enum ofp_return_code ofp_ip_output_flow(odp_packet_t pkt,
+					struct ofp_flow_cache_entry *fc);
+
+/*
+ * Send a reply made in place of a received packet, addresses already
+ * swapped, back through the ingress interface dev: the received
+ * Ethernet header in front of the IP header, in the data or the
+ * headroom, is reused with the MAC addresses swapped and the route is
+ * not looked up. Packets of sources not on the subnet of dev (unless
+ * net.inet.ip.reflect is 2), or not fit for it otherwise, go to
+ * ofp_ip_output().
+ */
+enum ofp_return_code ofp_ip_output_reflect(odp_packet_t pkt,
+					   struct ofp_ifnet *dev);
+extern int ofp_ip_reflect;
+
+/*
+ * Output an IPv4 packet encapsulated by ODP IPsec. The output interface
+ * and the Ethernet header to the tunnel endpoint are remembered in the
+ * flow cache of the thread, see ofp_ipsec_output().
+ */
+enum ofp_return_code ofp_ip_output_ipsec(odp_packet_t pkt);
+
 enum ofp_return_code ofp_ip_output_recurse(odp_packet_t pkt,
 					   struct ofp_nh_entry *nh);
 
@@ -130,4 +275,8 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 enum ofp_return_code ofp_sp_input(odp_packet_t pkt,
 				  struct ofp_ifnet *ifnet);
 
+int ofp_flow_queue_init_global(void);
+int ofp_flow_queue_term_global(void);
+void ofp_flow_queue_print(int fd);
+
 #endif /* _OFPI_APP_H */
@@ -20,7 +20,9 @@
 #include "ofpi_ethernet.h"
 #include "ofpi_queue.h"
 
-#define NUM_PORTS (OFP_FP_INTERFACE_MAX + 3)
+/* Fast path interface ports, see ofp_global_param_t.if_max */
+#define FP_PORTS (global_param->if_max)
+#define NUM_PORTS (FP_PORTS + 3)
 
 /* GRE ports are the last port assigned in the port vector.
  * Ports start from 0, and the last value is NUM_PORTS - 1.
@@ -32,7 +34,7 @@
  */
 #define VXLAN_PORTS (NUM_PORTS - 2)
 #define LOCAL_PORTS (NUM_PORTS - 3)
-#define PHYS_PORT(_port) (_port < OFP_FP_INTERFACE_MAX)
+#define PHYS_PORT(_port) (_port < FP_PORTS)
 #define OFP_IFNAME_PREFIX "fp"
 #define OFP_GRE_IFNAME_PREFIX "gre"
 #define OFP_VXLAN_IFNAME_PREFIX "vxlan"
@@ -51,6 +53,7 @@ OFP_TAILQ_HEAD(ofp_ifmultihead, ofp_ifmultiaddr);
 
 struct ofp_ifnet_locks_str {
 	odp_rwlock_t lock_ifaddr_list_rw;
+	odp_rwlock_t lock_ifaddr_hash_rw;
 #ifdef INET6
 	odp_rwlock_t lock_ifaddr6_list_rw;
 #endif /* INET6 */
@@ -113,15 +116,63 @@ struct ofp_ifnet_ipaddr {
 	uint8_t  masklen;
 };
 
+/*
+ * Interface address hash, keyed by (vrf, address). Each interface has
+ * one node per ip_addr_info slot and one for its IPv6 address, which
+ * is hashed with vrf 0. GRE interfaces also have a node keyed by
+ * (vrf, local and remote tunnel endpoint). IPv4 addresses beyond the
+ * ip_addr_info slots have a node in their ofp_ifaddr_extra entry.
+ */
+#define OFP_IFADDR_HASH_SIZE 4096
+#define OFP_IFADDR_NODE_IP6 OFP_NUM_IFNET_IP_ADDRS
+#define OFP_IFADDR_NODE_TUN (OFP_IFADDR_NODE_IP6 + 1)
+#define OFP_IFADDR_NODES (OFP_IFADDR_NODE_TUN + 1)
+
+/*
+ * Counting bloom filter of the IPv4 keys of the address hash, checked
+ * before the hash so that most forwarded packets miss it cheaply.
+ */
+#define OFP_IFADDR_BLOOM_SIZE 16384
+#define OFP_IFADDR_BLOOM_SEED 0x9e3779b9
+
+struct ofp_ifaddr_key {
+	uint32_t vrf_af; /* vrf << 16 | address family */
+	uint32_t addr[4];
+};
+
+struct ofp_ifaddr_node {
+	struct ofp_ifaddr_node *next;
+	struct ofp_ifnet *ifnet;
+	struct ofp_ifaddr_key key;
+	int linked;
+};
+
+/*
+ * IPv4 address of an interface beyond its ip_addr_info slots, from a
+ * pool of global_param->num_ifaddr entries.
+ */
+struct ofp_ifaddr_extra {
+	struct ofp_ifaddr_node node;	/* must be first */
+	struct ofp_ifnet_ipaddr info;
+	struct ofp_ifaddr_extra *next;	/* of the interface or the pool */
+};
+
 #define IP_ADDR_LIST_INIT(if) odp_rwlock_init(&(if)->ip_addr_mtx)
 #define IP_ADDR_LIST_RLOCK(if)   odp_rwlock_read_lock(&(if)->ip_addr_mtx)
 #define IP_ADDR_LIST_RUNLOCK(if) odp_rwlock_read_unlock(&(if)->ip_addr_mtx)
 #define IP_ADDR_LIST_WLOCK(if)   odp_rwlock_write_lock(&(if)->ip_addr_mtx)
 #define IP_ADDR_LIST_WUNLOCK(if) odp_rwlock_write_unlock(&(if)->ip_addr_mtx)
 
+/* Flow hash buckets of a LAG port, each sent on one member */
+#define OFP_LAG_BUCKETS 64
+#define OFP_LAG_NONE 0xff
+
+/*
+ * The fields in the first cache line, up to out_queue_pktout, are the
+ * ones the packet paths read. Of the output queues a packet reads one
+ * entry. The rest is configuration and slow path state.
+ */
 struct ODP_ALIGNED_CACHE ofp_ifnet {
-	struct ofp_ifnet_ipaddr	ip_addr_info[OFP_NUM_IFNET_IP_ADDRS];
-	odp_rwlock_t ip_addr_mtx;
 	uint16_t	port;
 	uint16_t	vlan;
 	uint16_t	vrf;
@@ -159,14 +210,49 @@ struct ODP_ALIGNED_CACHE ofp_ifnet {
 #define	OFP_IFF_RENAMING	0x400000	/* (n) interface is being renamed */
 #define OFP_IFF_PROMISCINET 	0x800000	/* (n) interface is in PROMISCUOUS_INET mode */
 	uint32_t	if_flags;
-
 	uint8_t		mac[OFP_ETHER_ADDR_LEN];
 	uint16_t	if_mtu;
+	/* Index of the interface in the per thread counters */
+	uint16_t	stat_idx;
+#define OFP_OUT_QUEUE_TYPE_PKTOUT 0
+#define OFP_OUT_QUEUE_TYPE_QUEUE 1
+#define OFP_OUT_QUEUE_TYPE_TM 2
+	uint8_t		out_queue_type;
+	/* Members of a LAG port, and those with the link up */
+	uint8_t		lag_num;
+#define OFP_IF_IPV4_RX_CHKSUM 0x1
+#define OFP_IF_IPV4_TX_CHKSUM 0x2
+#define OFP_IF_UDP_RX_CHKSUM  0x4
+#define OFP_IF_UDP_TX_CHKSUM  0x8
+#define OFP_IF_TCP_RX_CHKSUM  0x10
+#define OFP_IF_TCP_TX_CHKSUM  0x20
+#define OFP_IF_TCP_TSO        0x40
+/* Received packets carry ODP parse results up to L4 */
+#define OFP_IF_RX_PARSED      0x80
+	uint32_t        chksum_offload_flags;
+	unsigned	out_queue_num;
+	uint16_t	physport;
+	uint16_t	physvlan;
+	/* Link aggregation, see ofpi_lag.h. LAG of a member port. */
+	struct ofp_ifnet *lag;
+	odp_pktio_t	pktio;
+	odp_pool_t	pkt_pool;
+
+	/* End of the hot part */
+	odp_pktout_queue_t out_queue_pktout[OFP_PKTOUT_QUEUE_MAX];
+	odp_queue_t out_queue_queue[OFP_PKTOUT_QUEUE_MAX];
+#ifdef ODP_LSO_PROFILE_INVALID
+	odp_lso_profile_t lso_profile;
+	uint32_t	lso_max_payload;
+#endif
+
+	struct ofp_ifnet_ipaddr	ip_addr_info[OFP_NUM_IFNET_IP_ADDRS];
+	odp_rwlock_t ip_addr_mtx;
+	/* Addresses added when ip_addr_info was full */
+	struct ofp_ifaddr_extra *ip_addr_extra;
 
 	uint32_t	ip_p2p; /* network byte order */
 	uint32_t	ip_local; /* network byte order */
-	uint16_t	physport;
-	uint16_t	physvlan;
 	uint32_t	ip_remote; /* network byte order */
 #ifdef INET6
 	uint8_t		link_local[16];
@@ -176,28 +262,39 @@ struct ODP_ALIGNED_CACHE ofp_ifnet {
 	void		*vlan_structs;
 
 	char		if_name[OFP_IFNAMSIZ];
-	odp_pktio_t	pktio;
-#define OFP_IF_IPV4_RX_CHKSUM 0x1
-#define OFP_IF_IPV4_TX_CHKSUM 0x2
-#define OFP_IF_UDP_RX_CHKSUM  0x4
-#define OFP_IF_UDP_TX_CHKSUM  0x8
-#define OFP_IF_TCP_RX_CHKSUM  0x10
-#define OFP_IF_TCP_TX_CHKSUM  0x20
-	uint32_t        chksum_offload_flags;
-	unsigned	out_queue_num;
-#define OFP_OUT_QUEUE_TYPE_PKTOUT 0
-#define OFP_OUT_QUEUE_TYPE_QUEUE 1
-	uint8_t		out_queue_type;
 
-	odp_pktout_queue_t out_queue_pktout[OFP_PKTOUT_QUEUE_MAX];
-	odp_queue_t out_queue_queue[OFP_PKTOUT_QUEUE_MAX];
+	/* Scheduled or plain input queues, for the per queue counters */
+	unsigned	in_queue_num;
+	odp_queue_t	in_queue_queue[OFP_PKTIN_QUEUE_MAX];
+	/* Default class of service of a steering interface */
+	odp_cos_t	cos_def;
+
+	uint32_t	lag_up;
+	uint16_t	lag_member[OFP_LAG_MEMBER_MAX];
+	/* Member index by flow hash bucket */
+	uint8_t		lag_bucket[OFP_LAG_BUCKETS];
+	odp_timer_t	lag_tmo;
 
 	odp_queue_t	loopq_def;
-	odp_pool_t	pkt_pool;
 #ifdef SP
 	int		linux_index;
 	int		fd;
-	odp_queue_t	spq_def;
+	/* Slow path queues by class, dequeued in priority order */
+	odp_queue_t	spq[OFP_SP_CLASS_MAX];
+	struct ofp_sp_police {
+		/* Theoretical arrival time of the next packet, GCRA */
+		odp_atomic_u64_t tat;
+		uint64_t interval_ns;	/* 0: no limit */
+		uint64_t burst_ns;
+		odp_atomic_u64_t drops;
+	} sp_police[OFP_SP_CLASS_MAX];
+	/* Wakes up the RX thread when it waits for spq */
+	int		sp_evfd;
+	odp_atomic_u32_t sp_rx_wait;
+	/* Packet I/O channel used instead of the tap, see slow_path */
+	odp_pktio_t	sp_pktio;
+	odp_pktin_queue_t sp_pktin;
+	odp_pktout_queue_t sp_pktout;
 #define OFP_SP_DOWN 0
 #define OFP_SP_UP 1
 	int		sp_status;
@@ -210,6 +307,7 @@ struct ODP_ALIGNED_CACHE ofp_ifnet {
 #ifdef INET6
 	OFP_TAILQ_ENTRY(ofp_ifnet) ia6_link; /* list of internet addresses */
 #endif /* INET6 */
+	struct ofp_ifaddr_node ifaddr_node[OFP_IFADDR_NODES];
 	odp_rwlock_t	if_addr_mtx;	/* mutex to protect address lists */
 	struct ofp_in_ifinfo ii_inet;
 	void	*if_afdata[OFP_AF_MAX];
@@ -218,6 +316,9 @@ struct ODP_ALIGNED_CACHE ofp_ifnet {
 };
 
 #define outq_def out_queue_queue[0]
+#ifdef SP
+#define spq_def spq[OFP_SP_OTHER]
+#endif /*SP*/
 
 static inline uint8_t ofp_if_type(struct ofp_ifnet *ifnet)
 {
@@ -362,6 +463,7 @@ struct ofp_ifnet *ofp_ifaddr6_elem_get(uint8_t *addr6);
 
 int sp_tx_thread(void *ifnet_void);
 int sp_rx_thread(void *ifnet_void);
+void sp_rx_wakeup(struct ofp_ifnet *ifnet);
 int sp_setup_device(struct ofp_ifnet *ifnet);
 
 int ofp_free_port_alloc(void);
@@ -386,8 +488,18 @@ int free_key(void *key);
 
 struct ofp_ifconf;
 void ofp_get_interfaces(struct ofp_ifconf *ifc);
+/* Call func for every fast path port and every VLAN, GRE, VXLAN and
+ * loopback interface. Ports are passed also when not in use. */
+void ofp_ifnet_iterate(int (*func)(void *key, void *iter_arg), void *arg);
 
+/*
+ * Index of addr in dev->ip_addr_info, OFP_NUM_IFNET_IP_ADDRS if it is
+ * one of the dev->ip_addr_extra addresses, -1 if dev does not have it.
+ */
 int ofp_ifnet_ip_find(struct ofp_ifnet *dev, uint32_t addr);
+/* Entry of addr in dev->ip_addr_info or dev->ip_addr_extra, or NULL */
+struct ofp_ifnet_ipaddr *ofp_ifnet_ip_get(struct ofp_ifnet *dev,
+					    uint32_t addr);
 int ofp_set_first_ifnet_addr(struct ofp_ifnet *dev, uint32_t addr, uint32_t bcast_addr, int masklen);
 void ofp_free_ifnet_ip_list(struct ofp_ifnet *dev);
 void ofp_ifnet_print_ip_info(int fd, struct ofp_ifnet *dev);
@@ -398,6 +510,8 @@ void ofp_ifnet_ip_remove(struct ofp_ifnet *dev, uint32_t addr);
 
 /* Finds the node interface by the local ip assigned regardless of vlan */
 struct ofp_ifnet *ofp_get_ifnet_by_ip(uint32_t ip, uint16_t vrf);
+/* Nonzero if ip is an address of any interface in vrf */
+int ofp_ifaddr_is_local(uint32_t ip, uint16_t vrf);
 /* Finds the tunnel interface by tunnel addresses  */
 struct ofp_ifnet *ofp_get_ifnet_by_tunnel(uint32_t tun_loc,
 					      uint32_t tun_rem, uint16_t vrf);
@@ -0,0 +1,53 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_RCU_H__
+#define __OFPI_RCU_H__
+
+#include <odp_api.h>
+
+/*
+ * Quiescent state based reclamation for data structures that are read
+ * without locks by the packet processing threads.
+ *
+ * A thread that reads such data structures without locks registers
+ * itself with ofp_rcu_thread_register(). It must not hold references
+ * to protected data across a call to ofp_rcu_quiescent() or
+ * ofp_rcu_thread_offline(), and must call one of them regularly.
+ *
+ * Writers serialize among themselves (e.g. with a write lock). Memory
+ * unlinked by a writer is tagged with ofp_rcu_epoch(), the epoch is
+ * advanced with ofp_rcu_advance() and the memory may be reused once
+ * ofp_rcu_is_safe() returns true for the tag.
+ *
+ * Threads that are not registered always take the corresponding read
+ * lock and are not waited for.
+ */
+
+extern __thread odp_bool_t ofp_rcu_thread_registered;
+
+static inline odp_bool_t ofp_rcu_thread_is_registered(void)
+{
+	return ofp_rcu_thread_registered;
+}
+
+void ofp_rcu_thread_register(void);
+void ofp_rcu_thread_unregister(void);
+
+void ofp_rcu_quiescent(void);
+void ofp_rcu_thread_offline(void);
+void ofp_rcu_thread_online(void);
+
+uint64_t ofp_rcu_epoch(void);
+void ofp_rcu_advance(void);
+odp_bool_t ofp_rcu_is_safe(uint64_t epoch);
+
+int ofp_rcu_lookup_shared_memory(void);
+void ofp_rcu_init_prepare(void);
+int ofp_rcu_init_global(void);
+int ofp_rcu_term_global(void);
+
+#endif /* __OFPI_RCU_H__ */
@@ -34,5 +34,19 @@ int ofp_reassembly_term_global(void);
 
 odp_packet_t ofp_ip_reass(odp_packet_t pkt);
 
+#ifdef INET6
+int ofp_reassembly6_lookup_shared_memory(void);
+void ofp_reassembly6_init_prepare(void);
+int ofp_reassembly6_init_global(void);
+int ofp_reassembly6_term_global(void);
+
+enum ofp_return_code ofp_frag6_input(odp_packet_t *pkt, int *offp, int *nxt);
+/* Lifetime of an IPv6 fragment queue in seconds */
+#define IP6REASS_TTL		60
+
+/* Age the queued datagrams by ticks seconds, as the timer does */
+void ofp_reassembly6_age(int ticks);
+#endif /* INET6 */
+
 
 #endif
@@ -13,10 +13,14 @@
 #include <odp_api.h>
 #include "api/ofp_route_arp.h"
 #include "ofpi_portconf.h"
+#include "ofpi_lockstat.h"
 
-#define OFP_LOCK_READ(name)       odp_rwlock_read_lock(&ofp_locks_shm->lock_##name##_rw)
+/* Route restored by ofp_warm_restore() and not added again since */
+#define OFP_RTF_WARM 0x80000000
+
+#define OFP_LOCK_READ(name)       ofp_rwlock_read_lock(&ofp_locks_shm->lock_##name##_rw)
 #define OFP_UNLOCK_READ(name)     odp_rwlock_read_unlock(&ofp_locks_shm->lock_##name##_rw)
-#define OFP_LOCK_WRITE(name)      odp_rwlock_write_lock(&ofp_locks_shm->lock_##name##_rw)
+#define OFP_LOCK_WRITE(name)      ofp_rwlock_write_lock(&ofp_locks_shm->lock_##name##_rw)
 #define OFP_UNLOCK_WRITE(name)    odp_rwlock_write_unlock(&ofp_locks_shm->lock_##name##_rw)
 
 struct ofp_locks_str {
@@ -32,7 +36,16 @@ void ofp_route_init_prepare(void);
 int ofp_route_init_global(void);
 int ofp_route_term_global(void);
 
-enum ofp_return_code ofp_route_save_ipv6_pkt(odp_packet_t pkt, uint8_t *addr,
-		struct ofp_ifnet *dev);
+/*
+ * ofp_set_route_msgs() for the route daemon and warm restart: a batch
+ * rejected for an invalid route is added again route by route, so that
+ * only the invalid routes are lost. Returns the number of messages that
+ * could not be applied.
+ */
+int ofp_set_route_msgs_each(struct ofp_route_msg *msgs, int num);
+
+/* Call func for each IPv4 route as the message that would add it */
+void ofp_route_walk(void (*func)(void *arg, const struct ofp_route_msg *msg),
+		    void *arg);
 
 #endif
@@ -72,8 +72,27 @@ struct ofp_rtl6_node {
 	struct ofp_rtl6_node *right;
 };
 
+#define IPV6_FIRST_LEVEL 16
+#define IPV6_LEVEL       8
+
+struct ofp_rtl6_mtrie_table;
+
+struct ofp_rtl6_mtrie_entry {
+	struct ofp_nh6_entry *nh;
+	struct ofp_rtl6_mtrie_table *next;
+	uint32_t masklen;
+};
+
+struct ofp_rtl6_mtrie_table {
+	struct ofp_rtl6_mtrie_entry entry[1 << IPV6_LEVEL];
+	uint32_t ref;
+	struct ofp_rtl6_mtrie_table *next_free;
+};
+
 struct ofp_rtl6_tree {
 		struct ofp_rtl6_node *root;
+		/* First level of the lookup MTRIE, NULL if not in use */
+		struct ofp_rtl6_mtrie_entry *mtrie;
 };
 
 extern int ofp_rtl_init(struct ofp_rtl_tree *tree);
@@ -82,19 +101,26 @@ extern struct ofp_nh_entry *ofp_rtl_insert(struct ofp_rtl_tree *tree, uint32_t a
 										   uint32_t masklen, struct ofp_nh_entry *data);
 extern struct ofp_nh_entry *ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr,
 										   uint32_t masklen);
+extern struct ofp_nh_entry *ofp_rtl_search_exact(struct ofp_rtl_tree *tree,
+								 uint32_t addr, uint32_t masklen);
 #ifdef MTRIE
 extern int ofp_rt_rule_add(uint16_t vrf, uint32_t addr, uint32_t masklen, struct ofp_nh_entry *data);
 extern int ofp_rt_rule_remove(uint16_t vrf, uint32_t addr, uint32_t masklen);
 extern void ofp_rt_rule_print(int fd, uint16_t vrf,
 					 void (*func)(int fd, uint32_t key, int level, struct ofp_nh_entry *data));
 #else
-extern struct ofp_nh_entry *ofp_rtl_search_exact(struct ofp_rtl_tree *tree,
-								 uint32_t addr, uint32_t masklen);
 extern void ofp_rtl_destroy(struct ofp_rtl_tree *tree,
 							void (*func)(void *data));
 extern void ofp_rtl_traverse(int fd, struct ofp_rtl_tree *tree,
 							 void (*func)(int fd, uint32_t key, int level, struct ofp_nh_entry *data));
+/* Free the retired nodes that RCU readers are done with. Returns the
+ * number of nodes still waiting. Called with the route write lock. */
+extern int ofp_rtl_reclaim(void);
 #endif
+/* Defer the reclaiming of retired nodes to the end of a batch of
+ * changes. Called with the route write lock. */
+extern void ofp_rtl_batch_begin(void);
+extern void ofp_rtl_batch_end(void);
 extern int ofp_rtl6_init(struct ofp_rtl6_tree *tree);
 extern struct ofp_nh6_entry *ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
 											uint32_t masklen, struct ofp_nh6_entry *data);
@@ -103,6 +129,13 @@ extern struct ofp_nh6_entry *ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t
 extern void ofp_rtl_traverse6(int fd, struct ofp_rtl6_tree *tree,
 							  void (*func)(int fd, uint8_t *key, int level, struct ofp_nh6_entry *data));
 extern void ofp_print_rt_stat(int fd);
+
+int ofp_rtl6_mtrie_init(struct ofp_rtl6_tree *tree);
+int ofp_rtl6_mtrie_insert(struct ofp_rtl6_tree *tree, uint8_t *addr,
+			  uint32_t masklen);
+int ofp_rtl6_mtrie_remove(struct ofp_rtl6_tree *tree, uint8_t *addr,
+			  uint32_t masklen);
+void ofp_print_rt6_mtrie_stat(int fd);
 #ifndef MTRIE
 static __inline struct ofp_nh_entry *ofp_rtl_search(struct ofp_rtl_tree *tree, uint32_t addr_be)
 {
@@ -131,8 +164,20 @@ static __inline struct ofp_nh_entry *ofp_rtl_search(struct ofp_rtl_tree *tree, u
 
 	return &(match_table[--matches]->data[0]);
 }
+
+static __inline void ofp_rtl_search_bulk(struct ofp_rtl_tree *tree,
+					 const uint32_t addr_be[],
+					 struct ofp_nh_entry *nh[], int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		nh[i] = ofp_rtl_search(tree, addr_be[i]);
+}
 #else
 struct ofp_nh_entry *ofp_rtl_search(struct ofp_rtl_tree *tree, uint32_t addr_be);
+void ofp_rtl_search_bulk(struct ofp_rtl_tree *tree, const uint32_t addr_be[],
+			 struct ofp_nh_entry *nh[], int num);
 struct ofp_rt_rule *ofp_rt_rule_find_prefix_match(uint16_t vrf, uint32_t addr,
 						  uint8_t masklen, uint8_t low);
 #endif
@@ -177,9 +222,39 @@ static __inline struct ofp_nh6_entry *ofp_rtl_search6(struct ofp_rtl6_tree *tree
 	return match ? &match->data : NULL;
 }
 
+static __inline struct ofp_nh6_entry *ofp_rtl_lookup6(struct ofp_rtl6_tree *tree, uint8_t *addr)
+{
+	struct ofp_rtl6_mtrie_entry *elem;
+	struct ofp_nh6_entry *nh = NULL;
+	int i = IPV6_FIRST_LEVEL / 8;
+
+	if (odp_unlikely(!tree->mtrie))
+		return ofp_rtl_search6(tree, addr);
+
+	/* The default route is stored only in the trie */
+	if (tree->root->flags & OFP_RTL_FLAGS_VALID_DATA)
+		nh = &tree->root->data;
+
+	elem = &tree->mtrie[(addr[0] << 8) | addr[1]];
+	for (;;) {
+		if (elem->masklen)
+			nh = elem->nh;
+		if (!elem->next)
+			break;
+		elem = &elem->next->entry[addr[i++]];
+	}
+
+	return nh;
+}
+
 int ofp_rt_lookup_lookup_shared_memory(void);
 void ofp_rt_lookup_init_prepare(void);
 int ofp_rt_lookup_init_global(void);
 int ofp_rt_lookup_term_global(void);
 
+int ofp_rt6_mtrie_lookup_shared_memory(void);
+void ofp_rt6_mtrie_init_prepare(void);
+int ofp_rt6_mtrie_init_global(void);
+int ofp_rt6_mtrie_term_global(void);
+
 #endif /* _OFPI_RT_LOOKUP_H */
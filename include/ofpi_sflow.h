@@ -0,0 +1,59 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_SFLOW_H__
+#define __OFPI_SFLOW_H__
+
+#include <odp_api.h>
+
+/*
+ * sFlow packet sampling, see ofp_global_param_t.sflow. Each thread
+ * counts down a random skip of mean rate packets per direction and
+ * copies the headers of the packet that reaches zero into its own
+ * single producer ring. An exporter thread on the slow path core
+ * drains the rings into sFlow v5 datagrams.
+ */
+
+#define OFP_SFLOW_RX 0
+#define OFP_SFLOW_TX 1
+
+/* Packets until the next sample of each direction, 0: not sampling */
+extern __thread uint32_t ofp_sflow_skip[2];
+
+void ofp_sflow_sample(odp_packet_t pkt, int port, int dir);
+
+static inline void ofp_sflow_packet(odp_packet_t pkt, int port, int dir)
+{
+	if (odp_unlikely(ofp_sflow_skip[dir] != 0) &&
+	    odp_unlikely(--ofp_sflow_skip[dir] == 0))
+		ofp_sflow_sample(pkt, port, dir);
+}
+
+/* Estimated traffic of a source seen in the RX samples */
+struct ofp_sflow_talker {
+	uint32_t addr;		/* IPv4, network byte order */
+	uint64_t pkts;
+	uint64_t bytes;
+};
+
+/*
+ * Copy the largest sources of the last completed window, largest
+ * first, and the length of the window. Returns the number copied, or
+ * -1 if sampling is not enabled.
+ */
+int ofp_sflow_top_talkers(struct ofp_sflow_talker *t, int num,
+			  uint64_t *window_ns);
+
+int ofp_sflow_start_exporter(const odp_cpumask_t *cpumask);
+void ofp_sflow_stop_exporter(void);
+
+int ofp_sflow_lookup_shared_memory(void);
+void ofp_sflow_init_prepare(void);
+int ofp_sflow_init_global(void);
+int ofp_sflow_term_global(void);
+int ofp_sflow_init_local(void);
+
+#endif /* __OFPI_SFLOW_H__ */
@@ -76,4 +76,10 @@ void *ofp_shared_memory_lookup(const char *name);
  */
 int ofp_shared_memory_free(const char *name);
 
+/*
+ * Print the size of every preallocated block and of the blocks that
+ * were allocated separately through the raw allocator.
+ */
+void ofp_shared_memory_print(int fd);
+
 #endif /*__OFP_SHARED_MEM_H__*/
@@ -39,6 +39,8 @@
 #include "ofpi_systm.h"
 #include "ofpi_util.h"
 #include "ofpi_config.h"
+#include "ofpi_tracepoint.h"
+#include "api/ofp_socket.h"
 
 #define	SB_MAX		(2*1024*1024)	/* default for max chars in sockbuf */
 
@@ -83,16 +85,18 @@ struct selinfo {
 #endif
 };
 
-struct ofp_iovec {
-	void   *iov_base;	/* Base address. */
-	size_t	iov_len;	/* Length. */
-};
-
+/*
+ * The socket layer does not modify the iovecs: uio_iov and uio_iovcnt
+ * advance over those consumed, uio_offset is the offset in the first.
+ */
 struct uio {
 	struct	ofp_iovec *uio_iov;		/* scatter/gather list */
 	int	uio_iovcnt;		/* length of scatter/gather list */
-	off_t	uio_offset;		/* offset in target object */
+	off_t	uio_offset;		/* offset in uio_iov */
 	ofp_ssize_t	uio_resid;		/* remaining bytes to process */
+	/* Received datagram, for ofp_sorecv_control() */
+	uint16_t	uio_segsz;		/* OFP_UDP_GRO size, 0 if one */
+	struct ofp_scm_timestamping uio_ts;	/* OFP_SO_TIMESTAMPING */
 };
 
 /*
@@ -107,7 +111,8 @@ struct	sockbuf {
 	short		sb_state;	/* (c/d) socket state on sockbuf */
 #define	sb_startzero	sb_mb
 #define SOCKBUF_LEN 64
-	odp_packet_t	sb_mb[SOCKBUF_LEN];	/* (c/d) the pkt table */
+	odp_packet_t	*sb_mb;		/* (c/d) the pkt ring, NULL if empty */
+	int		sb_size;	/* (c/d) number of slots in the ring */
 	int		sb_put, sb_get;
 	int		sb_mbtail;		/* (c/d) the last pkt in the table */
 	int		sb_lastrecord;		/* (c/d) first mbuf of last
@@ -116,6 +121,7 @@ struct	sockbuf {
 	uint32_t	sb_sndptroff;	/* (c/d) byte offset of ptr into chain */
 	uint32_t	sb_cc;		/* (c/d) actual chars in buffer */
 	uint32_t	sb_hiwat;	/* (c/d) max actual char count */
+	uint32_t	sb_autobase;	/* (c/d) sb_hiwat before autosizing */
 	uint32_t	sb_mbcnt;	/* (c/d) chars of mbufs used */
 	uint32_t	sb_mcnt;        /* (c/d) number of mbufs in buffer */
 	uint32_t	sb_ccnt;        /* (c/d) number of clusters in buffer */
@@ -127,6 +133,20 @@ struct	sockbuf {
 	int		(*sb_upcall)(struct socket *, void *, int); /* (c/d) */
 	void		*sb_upcallarg;	/* (c/d) */
 	struct socket	*sb_socket;
+	/* Input queue polled while waiting, NULL to sleep */
+	const struct ofp_sock_busy_poll *sb_busy_poll;
+	/*
+	 * OFP_SO_RXRING: single-producer single-consumer ring of received
+	 * stream data from the protocol input to the reader, used without
+	 * the sockbuf lock. Data spills to sb_mb when the ring is full and
+	 * goes to the ring again only once sb_mb is empty. NULL if off.
+	 */
+	odp_packet_t	*sb_rx;
+	int		sb_rxsize;	/* number of slots in the ring */
+	odp_atomic_u32_t sb_rxput;	/* written by the producer */
+	odp_atomic_u32_t sb_rxget;	/* written by the consumer */
+	odp_atomic_u32_t sb_rxcc;	/* bytes in the ring */
+	uint32_t	sb_rxrcvd;	/* consumer: bytes since pru_rcvd */
 	//const char      *lockedby_file;
 	//int             lockedby_line;
 };
@@ -136,12 +156,8 @@ struct	sockbuf {
  * Per-socket buffer mutex used to protect most fields in the socket
  * buffer.
  */
-#if (defined OFP_RSS) || (defined OFP_SOCKBUF_MTX_DISABLED)
-/* The same core that puts data to sockbuf must also read the data.
- * This works with notify callback when the ofp_read/ofp_write is done
- * on the same core as the one that does udp/tcp_input() processing.
- */
-# define SOCKBUF_MTX(_sb)		(void)_sb;
+#if (defined OFP_SOCKBUF_MTX_DISABLED)
+# define SOCKBUF_MTX(_sb)		((void)(_sb), (odp_rwlock_t *)NULL)
 
 # define SOCKBUF_LOCK_INIT(_sb, _name)	(void)_sb; (void)_name;
 # define SOCKBUF_LOCK(_sb)		(void)_sb;
@@ -149,13 +165,31 @@ struct	sockbuf {
 # define SOCKBUF_RLOCK(_sb)		(void)_sb;
 # define SOCKBUF_RUNLOCK(_sb)		(void)_sb;
 #else
-# define SOCKBUF_MTX(_sb)		(&(_sb)->sb_mtx)
+/*
+ * In share-nothing mode the same core that puts data to sockbuf must also
+ * read the data. This works with notify callback when the ofp_read/ofp_write
+ * is done on the same core as the one that does udp/tcp_input() processing.
+ */
+# define SOCKBUF_MTX(_sb) \
+	(OFP_SHARE_NOTHING ? (odp_rwlock_t *)NULL : &(_sb)->sb_mtx)
 
-# define SOCKBUF_LOCK_INIT(_sb, _name)	odp_rwlock_init(SOCKBUF_MTX(_sb))
-# define SOCKBUF_LOCK(_sb)		odp_rwlock_write_lock(SOCKBUF_MTX(_sb))
-# define SOCKBUF_UNLOCK(_sb)		odp_rwlock_write_unlock(SOCKBUF_MTX(_sb))
-# define SOCKBUF_RLOCK(_sb)		odp_rwlock_read_lock(SOCKBUF_MTX(_sb))
-# define SOCKBUF_RUNLOCK(_sb)		odp_rwlock_read_unlock(SOCKBUF_MTX(_sb))
+# define SOCKBUF_LOCK_INIT(_sb, _name)	odp_rwlock_init(&(_sb)->sb_mtx)
+# define SOCKBUF_LOCK(_sb) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_write_lock(&(_sb)->sb_mtx); \
+	} while (0)
+# define SOCKBUF_UNLOCK(_sb) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_write_unlock(&(_sb)->sb_mtx); \
+	} while (0)
+# define SOCKBUF_RLOCK(_sb) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_read_lock(&(_sb)->sb_mtx); \
+	} while (0)
+# define SOCKBUF_RUNLOCK(_sb) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_rwlock_read_unlock(&(_sb)->sb_mtx); \
+	} while (0)
 #endif
 #define SOCKBUF_LOCK_DESTROY(_sb)	/*mtx_destroy(SOCKBUF_MTX(_sb))*/
 #define SOCKBUF_OWNED(_sb)		/*mtx_owned(SOCKBUF_MTX(_sb))*/
@@ -185,6 +219,11 @@ void	ofp_sbcompress(struct sockbuf *sb, odp_packet_t m, int n);
 odp_packet_t
 	sbcreatecontrol(char * p, int size, int type, int level);
 void	ofp_sbdestroy(struct sockbuf *sb, struct socket *so);
+void	ofp_sbinit(struct sockbuf *sb);
+int	ofp_sbrx_enable(struct sockbuf *sb, int on);
+int	ofp_sbrx_refill_locked(struct sockbuf *sb);
+odp_packet_t ofp_sbrx_first(struct sockbuf *sb);
+void	ofp_sbrx_take(struct sockbuf *sb, uint32_t len);
 void	ofp_sbdrop(struct sockbuf *sb, int len);
 void	ofp_sbdrop_locked(struct sockbuf *sb, int len);
 void	sbdroprecord(struct sockbuf *sb);
@@ -198,6 +237,8 @@ int	ofp_sbreserve(struct sockbuf *sb, uint64_t cc, struct socket *so,
 		struct thread *td);
 int	ofp_sbreserve_locked(struct sockbuf *sb, uint64_t cc, struct socket *so,
 		struct thread *td);
+int	ofp_sbautosize_locked(struct sockbuf *sb, uint32_t cc, uint32_t seg);
+void	ofp_sbautoshrink_locked(struct sockbuf *sb, uint32_t floor);
 odp_packet_t
 	sbsndptr(struct sockbuf *sb, uint32_t off, uint32_t len, uint32_t *moff);
 void	sbtoxsockbuf(struct sockbuf *sb, struct xsockbuf *xsb);
@@ -214,20 +255,41 @@ void	ofp_sbunlock(struct sockbuf *sb);
 #if 1
 #define	sbspace(sb) \
 	((long)(global_param->pkt_pool.buffer_size * \
-		((sb)->sb_put >= (sb)->sb_get ?				\
-		 (SOCKBUF_LEN - ((sb)->sb_put - (sb)->sb_get) - 1) :	\
-		 ((sb)->sb_get - (sb)->sb_put - 1))))
+		imax(((sb)->sb_put >= (sb)->sb_get ?			\
+		      ((sb)->sb_size - ((sb)->sb_put - (sb)->sb_get) - 1) : \
+		      ((sb)->sb_get - (sb)->sb_put - 1)) -		\
+		     ofp_sbrx_used(sb), 0)))
 #else
 #define	sbspace(sb) \
     ((long) imin((int)((sb)->sb_hiwat - (sb)->sb_cc), \
 	 (int)((sb)->sb_mbmax - (sb)->sb_mbcnt)))
 #endif
 
+/* Packets in the OFP_SO_RXRING ring, counted against the window */
+static inline int ofp_sbrx_used(struct sockbuf *sb)
+{
+	int n;
+
+	if (odp_likely(sb->sb_rx == NULL))
+		return 0;
+	n = (int)odp_atomic_load_acq_u32(&sb->sb_rxput) -
+		(int)odp_atomic_load_acq_u32(&sb->sb_rxget);
+	return n < 0 ? n + sb->sb_rxsize : n;
+}
+
+static inline uint32_t ofp_sbrx_cc(struct sockbuf *sb)
+{
+	if (odp_likely(sb->sb_rx == NULL))
+		return 0;
+	return odp_atomic_load_u32(&sb->sb_rxcc);
+}
+
 /* adjust counters in sb reflecting allocation of m */
 #define	sballoc(sb, m) { \
 	(sb)->sb_cc += odp_packet_len(m); \
 	(sb)->sb_mbcnt += odp_packet_buf_len(m);	\
 	(sb)->sb_mcnt += 1; \
+	OFP_TRACEPOINT(sock_enqueue, (sb), odp_packet_len(m), (sb)->sb_cc); \
 }
 
 /* adjust counters in sb reflecting freeing of m */
@@ -235,6 +297,7 @@ void	ofp_sbunlock(struct sockbuf *sb);
 	(sb)->sb_cc -= odp_packet_len(m); \
 	(sb)->sb_mbcnt -= odp_packet_buf_len(m); \
 	(sb)->sb_mcnt -= 1; \
+	OFP_TRACEPOINT(sock_dequeue, (sb), odp_packet_len(m), (sb)->sb_cc); \
 	if ((sb)->sb_sndptr >= 0 && (sb)->sb_mb[(sb)->sb_sndptr] == (m)) { \
 		(sb)->sb_sndptr = -1; \
 		(sb)->sb_sndptroff = 0; \
@@ -270,6 +333,7 @@ odp_packet_t ofp_sockbuf_get_first(struct sockbuf *);
 odp_packet_t ofp_sockbuf_remove_first(struct sockbuf *);
 odp_packet_t ofp_sockbuf_get_first_remove(struct sockbuf *);
 void ofp_sockbuf_packet_free(odp_packet_t);
-void ofp_sockbuf_copy_out(struct sockbuf *sb, int off, int len, char *dst);
+void ofp_sockbuf_copy_out(struct sockbuf *sb, int off, int len,
+			  odp_packet_t dst, uint32_t dstoff);
 
 #endif /* _SYS_SOCKBUF_H_ */
@@ -41,6 +41,7 @@
 #include "ofpi_sockbuf.h"
 #include "ofpi_in_pcb.h"
 #include "ofpi_uma.h"
+#include "ofpi_ktls.h"
 
 struct vnet;
 struct in_l2info;
@@ -115,8 +116,7 @@ struct socket {
 	struct so_accf {
 		struct	accept_filter *so_accept_filter;
 		void	*so_accept_filter_arg;	/* saved filter args */
-		char	*so_accept_filter_str;	/* saved user args */
-	} *so_accf;
+	} so_accf;			/* of a listening socket */
 	/*
 	 * so_fibnum, so_user_cookie and friends can be used to attach
 	 * some user-specified metadata to a socket, which then can be
@@ -126,6 +126,12 @@ struct socket {
 	int so_fibnum;		/* routing domain for this socket */
 	int so_altfibnum;
 	uint32_t so_user_cookie;
+	uint64_t so_max_pacing_rate;	/* bytes per second, 0 = no limit */
+	int so_timestamping;		/* OFP_SO_TIMESTAMPING flags */
+	odp_atomic_u32_t so_ts_txid;	/* last datagram numbered for it */
+	struct ofp_sock_txtime so_ts_tx;	/* (so_snd lock) last stamped */
+	struct ofp_sock_busy_poll so_busy_poll;	/* OFP_SO_BUSY_POLL */
+	struct ofp_ktls so_tls;		/* OFP_TCP_TXTLS_ENABLE */
 
 	struct so_upcallprep {
 		void (*soup_accept)(struct socket *so, void *arg);
@@ -146,10 +152,27 @@ struct socket {
 	} pcb_space;
 	struct ofp_sigevent so_sigevent;
 
+	/* Epoll instance state, if so_type is OFP_SOCK_EPOLL */
 	struct epoll_set {
+		OFP_TAILQ_HEAD(, epoll_item) items;	/* registered sockets */
+		OFP_TAILQ_HEAD(, epoll_item) ready;	/* possibly ready */
+		int nready;
+		odp_rwlock_t lock;
+		int evfd;			/* kernel eventfd or -1 */
+		int armed;			/* evfd waited on */
+	} so_epoll;
+
+	/* Registrations of this socket in epoll instances */
+	struct epoll_item {
+		struct socket *epoll;		/* NULL if not in use */
+		struct socket *so;
 		int fd;
+		int ready;			/* on the ready list */
 		struct ofp_epoll_event event;
-	} epoll_set[EPOLL_SET_SIZE];
+		OFP_TAILQ_ENTRY(epoll_item) item_list;
+		OFP_TAILQ_ENTRY(epoll_item) ready_list;
+	} so_epoll_item[EPOLL_SOCKET_ITEMS];
+	int so_epoll_count;		/* items in use */
 };
 
 
@@ -229,7 +252,8 @@ struct xsocket {
 
 /* can we read something from so? */
 #define	soreadabledata(so) \
-    ((so)->so_rcv.sb_cc >= (so)->so_rcv.sb_lowat || \
+    ((so)->so_rcv.sb_cc + ofp_sbrx_cc(&(so)->so_rcv) >= \
+	(uint32_t)(so)->so_rcv.sb_lowat || \
 	!OFP_TAILQ_EMPTY(&(so)->so_comp) || (so)->so_error)
 #define	soreadable(so) \
 	(soreadabledata(so) || ((so)->so_rcv.sb_state & SBS_CANTRCVMORE))
@@ -276,7 +300,8 @@ struct xsocket {
  */
 #define	sorwakeup_locked(so) do {					\
 	SOCKBUF_LOCK_ASSERT(&(so)->so_rcv);				\
-	if (sb_notify(&(so)->so_rcv)) {					\
+	if (ofp_so_ready_set((so), OFP_SO_RCV) ||			\
+	    sb_notify(&(so)->so_rcv) || (so)->so_epoll_count) {		\
 		ofp_sowakeup((so), &(so)->so_rcv);				\
 	} else {							\
 		SOCKBUF_UNLOCK(&(so)->so_rcv);				\
@@ -291,7 +316,8 @@ struct xsocket {
 #define	sowwakeup_locked(so) do {					\
 	SOCKBUF_LOCK_ASSERT(&(so)->so_snd);				\
 	ofp_send_sock_event(so, so, OFP_EVENT_SEND);			\
-	if (sb_notify(&(so)->so_snd))					\
+	if (ofp_so_ready_set((so), OFP_SO_SND) ||			\
+	    sb_notify(&(so)->so_snd) || (so)->so_epoll_count)		\
 		ofp_sowakeup((so), &(so)->so_snd);				\
 	else								\
 		SOCKBUF_UNLOCK(&(so)->so_snd);				\
@@ -340,6 +366,16 @@ struct uio;
  * From uipc_socket and friends
  */
 struct socket *ofp_get_sock_by_fd(int fd);
+/* Number of socket descriptors, global_param->socket_max */
+int	ofp_socket_max(void);
+
+/*
+ * Readiness map of select and poll, see struct ofp_socket_mem. Setting
+ * a bit returns nonzero if a thread is waiting in select or poll.
+ */
+uint8_t	*ofp_so_ready_map(int which);
+int	ofp_so_ready_set(struct socket *so, int which);
+void	ofp_so_select_wait(int enter);
 
 int	sockargs(odp_packet_t *mp, char * buf, int buflen, int type);
 int	getsockaddr(struct ofp_sockaddr **namp, char * uaddr, size_t len);
@@ -379,6 +415,13 @@ int	ofp_soreceive_dgram(struct socket *so, struct ofp_sockaddr **paddr,
 int	ofp_soreceive_generic(struct socket *so, struct ofp_sockaddr **paddr,
 	    struct uio *uio, odp_packet_t *mp0, odp_packet_t *controlp,
 	    int *flagsp);
+int	ofp_soreceive_dgram_mmsg(struct socket *so, struct ofp_mmsghdr *msgvec,
+	    unsigned int vlen, int flags, unsigned int *count);
+void	ofp_sorecv_control(struct socket *so, struct ofp_msghdr *msg,
+	    uint16_t segsz, const struct ofp_scm_timestamping *ts);
+void	ofp_sock_tx_timestamp(int fd, uint32_t id, uint64_t ns);
+int	ofp_soreceive_pkt(struct socket *so, odp_packet_t pkts[],
+	    uint32_t offs[], uint32_t lens[], int num, int flags, int *count);
 int	ofp_soreserve(struct socket *so, uint64_t sndcc, uint64_t rcvcc);
 void	sorflush(struct socket *so);
 #if 0
@@ -392,6 +435,11 @@ int	ofp_sosend(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio,
 int	ofp_sosend_dgram(struct socket *so, struct ofp_sockaddr *addr,
 		     struct uio *uio, odp_packet_t top, odp_packet_t control,
 		     int flags, struct thread *td);
+int	ofp_sosend_dgram_mmsg(struct socket *so, struct ofp_mmsghdr *msgvec,
+			  unsigned int vlen, int flags, struct thread *td,
+			  unsigned int *count);
+int	ofp_sosend_pkt(struct socket *so, odp_packet_t pkts[], int num,
+		   int flags, struct thread *td, int *count);
 
 int	ofp_sosend_generic(struct socket *so, struct ofp_sockaddr *addr,
 		       struct uio *uio, odp_packet_t top, odp_packet_t control,
@@ -411,7 +459,11 @@ int	selsocket(struct socket *so, int events, struct timeval *tv,
  */
 int	accept_filt_add(struct accept_filter *filt);
 int	accept_filt_del(char *name);
-struct	accept_filter *accept_filt_get(char *name);
+struct	accept_filter *accept_filt_get(const char *name);
+/* Set or with a NULL name clear the accept filter of a listening socket */
+int	ofp_accept_filt_set(struct socket *so, const char *name, char *arg);
+int	ofp_accept_filt_setopt(struct socket *so, struct sockopt *sopt);
+int	ofp_accept_filt_getopt(struct socket *so, struct sockopt *sopt);
 #ifdef ACCEPT_FILTER_MOD
 #ifdef SYSCTL_DECL
 SYSCTL_DECL(_net_inet_accf);
@@ -420,6 +472,11 @@ int	accept_filt_generic_mod_event(module_t mod, int event, void *data);
 #endif
 
 odp_packet_t ofp_socket_packet_alloc(uint32_t len);
+odp_packet_t *ofp_socket_ring_alloc(int len);
+void ofp_socket_ring_free(odp_packet_t *ring, int len);
+int ofp_socket_ring_len(void);
+int ofp_socket_auto_mem_get(uint32_t bytes);
+void ofp_socket_auto_mem_put(uint32_t bytes);
 odp_rwlock_t *ofp_accept_mtx(void);
 void ofp_accept_lock(void);
 void ofp_accept_unlock(void);
@@ -427,9 +484,17 @@ void ofp_accept_unlock(void);
 /* Emulation for BSD wakeup mechanism */
 int ofp_msleep(void *channel, odp_rwlock_t *mtx, int priority, const char *wmesg,
 		 uint32_t timeout);
+int ofp_busy_poll(const struct ofp_sock_busy_poll *bp, odp_rwlock_t *mtx,
+		  uint32_t timeout);
 int ofp_wakeup(void *channel);
 int ofp_wakeup_one(void *channel);
 int ofp_send_sock_event(struct socket *head, struct socket *so, int event);
+/*
+ * Queue an event to the queue of an OFP_SIGEV_QUEUE socket, the new
+ * socket so of an accept on head. Returns 0 if the event was queued.
+ */
+int ofp_sock_event_enqueue(struct socket *head, struct socket *so, int event,
+			   odp_packet_t pkt);
 
 int is_readable(int fd);
 
@@ -9,7 +9,9 @@
 #define _STAT_H_
 
 #include "api/ofp_stat.h"
+#include "ofpi_config.h"
 #include "ofpi_timer.h"
+#include "ofpi_util.h"
 
 int ofp_stat_lookup_shared_memory(void);
 void ofp_stat_init_prepare(void);
@@ -22,8 +24,103 @@ int ofp_stat_term_global(void);
 		st->per_thr[odp_thread_id()]._s += _n;	\
 } while (0)
 
+/* Last drop reason + 1 counted by this thread, for the packet trace */
+extern __thread uint8_t ofp_drop_last;
+
+/* Count _n packets dropped for reason OFP_DROP_<_r> */
+#define OFP_DROP_STAT_N(_r, _n) do {					\
+	OFP_UPDATE_PACKET_STAT(drop[OFP_DROP_##_r], _n);		\
+	ofp_drop_last = OFP_DROP_##_r + 1;				\
+} while (0)
+
+/* Count one packet dropped for reason OFP_DROP_<_r> */
+#define OFP_DROP_STAT(_r) OFP_DROP_STAT_N(_r, 1)
+
 extern unsigned long int ofp_stat_flags;
 
+/*
+ * Interface counters. Every thread has a counter set per ifnet, indexed
+ * by ifnet->stat_idx, and per input and output queue of the fast path
+ * ports. Readers sum the counters of all threads.
+ */
+#define OFP_IFQ_STAT_MAX (OFP_PKTIN_QUEUE_MAX > OFP_PKTOUT_QUEUE_MAX ? \
+			  OFP_PKTIN_QUEUE_MAX : OFP_PKTOUT_QUEUE_MAX)
+
+/* Counters of this thread, NULL if the thread does not count */
+extern __thread struct ofp_if_stat *ofp_if_stat_thr;
+extern __thread struct ofp_if_stat *ofp_ifq_stat_thr;
+
+#define _IF_STAT_ADD(_st, _dir, _n, _len) do {				\
+	struct ofp_if_stat *_s = (_st);					\
+	_s->_dir##_pkts += (_n);					\
+	_s->_dir##_bytes += (_len);					\
+} while (0)
+
+#define OFP_IF_STAT_RX(_ifnet, _n, _len) do {				\
+	if (odp_likely(ofp_if_stat_thr))				\
+		_IF_STAT_ADD(&ofp_if_stat_thr[(_ifnet)->stat_idx], rx,	\
+			     _n, _len);					\
+} while (0)
+
+#define OFP_IF_STAT_TX(_ifnet, _n, _len) do {				\
+	if (odp_likely(ofp_if_stat_thr))				\
+		_IF_STAT_ADD(&ofp_if_stat_thr[(_ifnet)->stat_idx], tx,	\
+			     _n, _len);					\
+} while (0)
+
+/* _port is a fast path port, _queue a queue index of the port */
+#define OFP_IFQ_STAT_RX(_port, _queue, _n, _len) do {			\
+	if (odp_likely(ofp_ifq_stat_thr))				\
+		_IF_STAT_ADD(&ofp_ifq_stat_thr[(_port) * OFP_IFQ_STAT_MAX + \
+					       (_queue)], rx, _n, _len); \
+} while (0)
+
+#define OFP_IFQ_STAT_TX(_port, _queue, _n, _len) do {			\
+	if (odp_likely(ofp_ifq_stat_thr))				\
+		_IF_STAT_ADD(&ofp_ifq_stat_thr[(_port) * OFP_IFQ_STAT_MAX + \
+					       (_queue)], tx, _n, _len); \
+} while (0)
+
+/* Reset the counters of a reused ifnet in all threads */
+void ofp_if_stat_clear(uint16_t stat_idx);
+
+/*
+ * Stage profiling. OFP_PROF_START() declares a start cycle count that is
+ * zero when profiling is off, OFP_PROF_END_N() records the cycles since
+ * then for n packets in the stage OFP_PROF_<_stage>.
+ */
+#define OFP_PROF_NOW()							\
+	(odp_unlikely(ofp_stat_flags & OFP_STAT_COMPUTE_PROFILE) ?	\
+	 odp_cpu_cycles() : 0)
+
+#define OFP_PROF_START(_t) uint64_t _t = OFP_PROF_NOW()
+
+#define OFP_PROF_END_N(_stage, _t, _n) do {				\
+	if (odp_unlikely(_t))						\
+		ofp_prof_record(OFP_PROF_##_stage, _t, _n);		\
+} while (0)
+
+#define OFP_PROF_END(_stage, _t) OFP_PROF_END_N(_stage, _t, 1)
+
+static inline void ofp_prof_record(int stage, uint64_t start, uint32_t n)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+	uint64_t c;
+	int slot;
+
+	if (!st || !n)
+		return;
+
+	c = odp_cpu_cycles_diff(odp_cpu_cycles(), start);
+	slot = c / n ? ilog2(c / n) : 0;
+	if (slot >= OFP_PROF_SLICES)
+		slot = OFP_PROF_SLICES - 1;
+
+	st->per_thr[odp_thread_id()].prof_cycles[stage] += c;
+	st->per_thr[odp_thread_id()].prof_count[stage] += n;
+	st->per_thr[odp_thread_id()].prof_hist[stage][slot] += n;
+}
+
 #define _UPDATE_LATENCY(_thr, _current_cycle, _n) do {\
 	if (odp_time_to_ns(st->per_thr[_thr].last_input_cycles)) \
 		st->per_thr[_thr].input_latency[\
@@ -0,0 +1,44 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_STEER_H__
+#define __OFPI_STEER_H__
+
+#include <odp_api.h>
+#include "ofpi_portconf.h"
+
+/*
+ * Traffic steering with the ODP classifier. An interface created with
+ * ofp_global_param_t.steering gets a default class of service in place
+ * of its pktin queues, and each rule adds a class with queues of its
+ * own behind a pattern matching rule from the default class.
+ */
+
+/* Configure the pktin queues of ifnet with the classifier enabled */
+int ofp_steer_pktin_config(struct ofp_ifnet *ifnet,
+			   const odp_pktin_queue_param_t *pktin_param);
+
+/* Remove the rules and classes of ifnet, before its pktio is closed */
+int ofp_steer_ifnet_term(struct ofp_ifnet *ifnet);
+
+/*
+ * CPU budgets of scheduling priorities, checked by the dispatcher for
+ * each burst. ofp_steer_budget_begin() returns the class of a burst
+ * from queue, -1 if it has no budget, and sets *over if the packets of
+ * the burst are to be dropped. ofp_steer_budget_end() charges the
+ * class with the cycles of the burst and counts the drops.
+ */
+int ofp_steer_budget_begin(odp_queue_t queue, int *over);
+void ofp_steer_budget_end(int cls, uint32_t dropped);
+
+void ofp_steer_print(int fd);
+
+int ofp_steer_lookup_shared_memory(void);
+void ofp_steer_init_prepare(void);
+int ofp_steer_init_global(void);
+int ofp_steer_term_global(void);
+
+#endif /* __OFPI_STEER_H__ */
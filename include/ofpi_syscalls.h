@@ -13,4 +13,8 @@ int _ofp_select(int nfds, ofp_fd_set *readfds, ofp_fd_set *writefds,
 		int (*sleeper)(void *channel, odp_rwlock_t *mtx, int priority,
 			       const char *wmesg, uint32_t timeout));
 
+int _ofp_poll(struct ofp_pollfd *fds, ofp_nfds_t nfds, int timeout,
+	      int (*sleeper)(void *channel, odp_rwlock_t *mtx, int priority,
+			     const char *wmesg, uint32_t timeout));
+
 #endif
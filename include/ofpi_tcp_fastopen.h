@@ -0,0 +1,45 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_TCP_FASTOPEN_H__
+#define __OFPI_TCP_FASTOPEN_H__
+
+#include <odp_api.h>
+
+#include "ofpi_in_pcb.h"
+#include "api/ofp_tcp.h"
+
+/*
+ * TCP Fast Open (RFC 7413). Servers hand out a cookie that is a keyed
+ * hash of the client address, see ofp_tcp_syncache.c. Clients keep the
+ * cookies they received per server address in a direct mapped cache in
+ * shared memory.
+ */
+
+#define TCP_FASTOPEN_COOKIE_LEN		8	/* length of our cookies */
+#define TCP_FASTOPEN_MAX_COOKIE_LEN	\
+	(OFP_TCPOLEN_FAST_OPEN_MAX - OFP_TCPOLEN_FAST_OPEN_EMPTY)
+
+#define TCP_FASTOPEN_CCACHE_SIZE	256	/* power of two */
+
+struct tcp_fastopen_centry {
+	uint32_t	faddr[4];	/* IPv4 address in faddr[0] */
+	uint8_t		isipv6;
+	uint8_t		len;		/* 0 = unused */
+	uint8_t		cookie[TCP_FASTOPEN_MAX_COOKIE_LEN];
+};
+
+struct tcp_fastopen_ccache {
+	odp_spinlock_t	lock;
+	struct tcp_fastopen_centry entry[TCP_FASTOPEN_CCACHE_SIZE];
+};
+
+void	ofp_tcp_fastopen_init(void);
+int	ofp_tcp_fastopen_ccache_get(struct in_conninfo *inc, uint8_t *cookie);
+void	ofp_tcp_fastopen_ccache_set(struct in_conninfo *inc,
+				    const uint8_t *cookie, int len);
+
+#endif /* __OFPI_TCP_FASTOPEN_H__ */
@@ -11,51 +11,88 @@
 #include "ofpi_callout.h"
 #include "ofpi_tcp_var.h"
 #include "ofpi_tcp_syncache.h"
+#include "ofpi_tcp_fastopen.h"
 #include "ofpi_config.h"
 
 #include "api/ofp_timer.h"
 
+/*
+ * TIME_WAIT table of a core. Entries are linked by their index in the
+ * table, expired from a wheel of slots of TCP_TW_SLOT ticks and kept on
+ * shm_tcp->ctw[base ... base + tcp_tw_max - 1].
+ */
+#define TCP_TW_HASHSIZE		4096	/* power of two */
+#define TCP_TW_WHEEL		128
+#define TCP_TW_SLOT		(hz / 2)
+#define TCP_TW_NONE		UINT32_MAX
+#define TCP_TW_CONNECT_TRIES	16	/* ports tried by connect() */
+/* Entries per table, 0 keeps IPv4 connections on the tcptw path too */
+#define TCP_TW_MAX		(global_param->tcp_tw_max > 0 ? \
+				 (uint32_t)global_param->tcp_tw_max : 0)
+
+struct tcp_twtable {
+	odp_spinlock_t	lock;
+	uint32_t	hash[TCP_TW_HASHSIZE];
+	uint32_t	wheel[TCP_TW_WHEEL];
+	uint32_t	free;		/* free entries, linked by ctw_hnext */
+	uint32_t	count;		/* entries in the wheel */
+	uint32_t	slot;		/* next wheel slot to expire */
+	uint32_t	base;
+};
+
 /*
  * Shared data format
  */
 struct ofp_tcp_var_mem {
-#ifdef OFP_RSS
-	VNET_DEFINE(struct inpcbhead, ofp_tcb[OFP_MAX_NUM_CPU]);
-	VNET_DEFINE(struct inpcbinfo, ofp_tcbinfo[OFP_MAX_NUM_CPU]);
-	VNET_DEFINE(OFP_TAILQ_HEAD(, tcptw), twq_2msl[OFP_MAX_NUM_CPU]);
-	odp_timer_t ofp_tcp_slow_timer[OFP_MAX_NUM_CPU];
-#else
-	VNET_DEFINE(struct inpcbhead, ofp_tcb);/* queue of active tcpcb's */
-	VNET_DEFINE(struct inpcbinfo, ofp_tcbinfo);
-	VNET_DEFINE(OFP_TAILQ_HEAD(, tcptw), twq_2msl);
-	odp_timer_t ofp_tcp_slow_timer;
-#endif
+	/*
+	 * In share-nothing mode each core has its own PCB table and
+	 * TIME_WAIT queue. Otherwise there is only one. The TCP_NUM_CPU
+	 * tables are placed after the syncache hash.
+	 */
+	VNET_DEFINE(struct inpcbhead, *ofp_tcb);
+	VNET_DEFINE(struct inpcbinfo, *ofp_tcbinfo);
+	VNET_DEFINE(OFP_TAILQ_HEAD(tcptw_head, tcptw), *twq_2msl);
+	odp_timer_t *ofp_tcp_slow_timer;
 
-/* Target size of TCP PCB hash tables. Must be a power of two.*/
-#define TCBHASHSIZE			1024
-	struct inpcbhead	ofp_hashtbl[TCBHASHSIZE];
-	struct inpcbporthead	ofp_porthashtbl[TCBHASHSIZE];
-
-#define TCP_SYNCACHE_HASHSIZE		1024
-	struct syncache_head	syncache[TCP_SYNCACHE_HASHSIZE];
+	/*
+	 * TCP_NUM_CPU PCB hash tables of TCP_HASH_SIZE buckets each
+	 */
+	struct inpcbhead	*ofp_hashtbl;
+	struct inpcbporthead	*ofp_porthashtbl;
 
 	VNET_DEFINE(uma_zone_t, tcp_reass_zone);
 	VNET_DEFINE(uma_zone_t, tcp_syncache_zone);
 	VNET_DEFINE(uma_zone_t, tcpcb_zone);
 	VNET_DEFINE(uma_zone_t, tcptw_zone);
 	VNET_DEFINE(uma_zone_t, ofp_sack_hole_zone);
+
+	struct tcp_twtable	*twtbl;
+	struct tcp_fastopen_ccache	tfo_ccache;
+	/* TCP_NUM_CPU * global_param->tcp_tw_max compact TIME_WAIT entries */
+	struct tcp_ctw		ctw[];
+	/* Followed by the syncache hash, see TCP_SYNCACHE_OFFSET */
 };
 extern __thread struct ofp_tcp_var_mem *shm_tcp;
 
-#ifdef OFP_RSS
-#define	V_tcb			VNET(shm_tcp->ofp_tcb[odp_cpu_id()])
-#define	V_tcbinfo		VNET(shm_tcp->ofp_tcbinfo[odp_cpu_id()])
-#define	V_twq_2msl		VNET(shm_tcp->twq_2msl[odp_cpu_id()])
-#else
-#define	V_tcb			VNET(shm_tcp->ofp_tcb)
-#define	V_tcbinfo		VNET(shm_tcp->ofp_tcbinfo)
-#define	V_twq_2msl		VNET(shm_tcp->twq_2msl)
-#endif
+/* Syncache hash of ofp_syncache_hashsize() buckets */
+#define TCP_SYNCACHE_OFFSET						\
+	((sizeof(struct ofp_tcp_var_mem) +				\
+	  TCP_NUM_CPU * TCP_TW_MAX * sizeof(struct tcp_ctw) +		\
+	  ODP_CACHE_LINE_SIZE - 1) & ~(uint64_t)(ODP_CACHE_LINE_SIZE - 1))
+#define TCP_SYNCACHE_HASHBASE						\
+	((struct syncache_head *)((uint8_t *)shm_tcp + TCP_SYNCACHE_OFFSET))
+
+/* Index of the PCB table of this core */
+#define TCP_CPU			(OFP_SHARE_NOTHING ? odp_cpu_id() : 0)
+/* Number of PCB tables in use */
+#define TCP_NUM_CPU		(OFP_SHARE_NOTHING ? odp_cpu_count() : 1)
+/* Buckets of each PCB hash table */
+#define TCP_HASH_SIZE		ofp_in_pcbhash_size(global_param->pcb_tcp_max)
+
+#define	V_tcb			VNET(shm_tcp->ofp_tcb[TCP_CPU])
+#define	V_tcbinfo		VNET(shm_tcp->ofp_tcbinfo[TCP_CPU])
+#define	V_twq_2msl		VNET(shm_tcp->twq_2msl[TCP_CPU])
+#define	V_twtbl			VNET(shm_tcp->twtbl[TCP_CPU])
 
 #define	V_tcp_reass_zone	VNET(shm_tcp->tcp_reass_zone)
 #define	V_tcpcb_zone		VNET(shm_tcp->tcpcb_zone)
@@ -39,17 +39,23 @@
 struct toeopt;
 
 void	 ofp_syncache_init(void);
+void	 ofp_syncache_timer(void);
+uint32_t ofp_syncache_hashsize(void);
 int	 ofp_syncache_expand(struct in_conninfo *, struct tcpopt *,
 	     struct ofp_tcphdr *, struct socket **, odp_packet_t );
 int	 tcp_offload_syncache_expand(struct in_conninfo *inc, struct toeopt *toeo,
              struct ofp_tcphdr *th, struct socket **lsop, odp_packet_t m);
-void	 ofp_syncache_add(struct in_conninfo *, struct tcpopt *,
+int	 ofp_syncache_add(struct in_conninfo *, struct tcpopt *,
 		      struct ofp_tcphdr *, struct inpcb *, struct socket **, odp_packet_t ,
 		      int);
 void	 tcp_offload_syncache_add(struct in_conninfo *, struct toeopt *,
              struct ofp_tcphdr *, struct inpcb *, struct socket **,
              struct toe_usrreqs *tu, void *toepcb);
 
+int	 ofp_syncache_flood(void);
+int	 ofp_syncookie_respond(struct ofp_ip *, struct ofp_tcphdr *,
+	     struct tcpopt *, struct inpcb *, odp_packet_t);
+
 void	 ofp_syncache_chkrst(struct in_conninfo *, struct ofp_tcphdr *);
 void	 ofp_syncache_badack(struct in_conninfo *);
 int	 ofp_syncache_pcbcount(void);
@@ -99,6 +105,7 @@ struct syncache {
 #define SCF_PASSIVE_SYNACK	0x400			/* SYN|ACK captured in passive mode */
 #define SCF_NO_TIMEOUT_RESET	0x800			/* don't reset timeout on dup SYN */ 
 #define SCF_CONVERT_ON_TIMEOUT	0x1000			/* convert from passive to active on timeout */
+#define SCF_TFO			0x2000			/* send TCP Fast Open cookie */
 
 #define	SYNCOOKIE_SECRET_SIZE	8	/* dwords */
 #define	SYNCOOKIE_LIFETIME	16	/* seconds */
@@ -125,6 +132,8 @@ struct tcp_syncache {
 	uint32_t	cache_limit;
 	uint32_t	rexmt_limit;
 	uint32_t	hash_secret;
+	uint64_t	cookie_key[2];		/* stateless SYN cookies */
+	uint64_t	tfo_key[2];		/* TCP Fast Open cookies */
 };
 
 #endif /* !_NETINET_TCP_SYNCACHE_H_ */
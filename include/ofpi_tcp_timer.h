@@ -152,12 +152,14 @@ struct tcp_timer {
 	struct	callout tt_keep;	/* keepalive */
 	struct	callout tt_2msl;	/* 2*msl TIME_WAIT timer */
 	struct	callout tt_delack;	/* delayed ACK timer */
+	struct	callout tt_pace;	/* paced transmission */
 };
 #define TT_DELACK	0x01
 #define TT_REXMT	0x02
 #define TT_PERSIST	0x04
 #define TT_KEEP		0x08
 #define TT_2MSL		0x10
+#define TT_PACE		0x20
 
 #define	TP_KEEPINIT(tp)	((tp)->t_keepinit ? (int)(tp)->t_keepinit : ofp_tcp_keepinit)
 #define	TP_KEEPIDLE(tp)	((tp)->t_keepidle ? (int)(tp)->t_keepidle : ofp_tcp_keepidle)
@@ -188,6 +190,7 @@ void	ofp_tcp_timer_keep(void *xtp);
 void	ofp_tcp_timer_persist(void *xtp);
 void	ofp_tcp_timer_rexmt(void *xtp);
 void	ofp_tcp_timer_delack(void *xtp);
+void	ofp_tcp_timer_pace(void *xtp);
 void	tcp_timer_to_xtimer(struct tcpcb *tp, struct tcp_timer *timer,
 	struct xtcp_timer *xtimer);
 
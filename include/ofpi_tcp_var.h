@@ -38,6 +38,8 @@
 
 #include "ofpi_tcp.h"
 #include "ofpi_vnet.h"
+#include "ofpi_tree.h"
+#include "ofpi_tracepoint.h"
 
 /*
  * Kernel variables for tcp.
@@ -49,15 +51,18 @@ VNET_DECLARE(int, ofp_tcp_do_rfc1323);
 /* TCP segment queue entry */
 struct tseg_qent {
 	OFP_LIST_ENTRY(tseg_qent) tqe_q;
+	RB_ENTRY(tseg_qent) tqe_rb;	/* index by sequence number */
 	int	tqe_len;		/* TCP segment data length */
-	struct ofp_tcphdr *tqe_th;		/* a pointer to tcp header */
-	odp_packet_t tqe_m;		/* mbuf contains packet */
+	tcp_seq	tqe_seq;		/* sequence number of first byte */
+	int	tqe_flags;		/* OFP_TH_FIN of the last segment */
+	odp_packet_t tqe_m;		/* contiguous segments, concatenated */
 #ifdef PASSIVE_INET
 	OFP_TAILQ_ENTRY(tseg_qent) tqe_ageq;
 	int tqe_ticks;			/* ticks when queued */
 #endif
 };
 OFP_LIST_HEAD(tsegqe_head, tseg_qent);
+RB_HEAD(tsegq_tree, tseg_qent);
 
 struct sackblk {
 	tcp_seq start;		/* start seq no. of sack block */
@@ -68,8 +73,11 @@ struct sackhole {
 	tcp_seq start;		/* start seq no. of hole */
 	tcp_seq end;		/* end seq no. */
 	tcp_seq rxmit;		/* next seq. no in hole to be retransmitted */
+	uint32_t rxmit_ts;	/* tcp_ts_getticks() of last retransmission */
 	OFP_TAILQ_ENTRY(sackhole) scblink;	/* scoreboard linkage */
+	RB_ENTRY(sackhole) scbtree;		/* scoreboard index by end */
 };
+RB_HEAD(sackhole_tree, sackhole);
 
 struct sackhint {
 	struct sackhole	*nexthole;
@@ -103,43 +111,65 @@ do {								\
 #define ND6_HINT(tp)
 #endif
 
+/* What limits sending, accounted per connection for OFP_TCP_INFO */
+#define	TCP_LIM_APP	0	/* all data sent, or not established */
+#define	TCP_LIM_RWND	1	/* the send window of the peer */
+#define	TCP_LIM_CWND	2	/* the congestion window */
+#define	TCP_LIM_MAX	3
+
 /*
  * Tcp control block, one per tcp; fields:
  * Organized for 16 byte cacheline efficiency.
  */
 struct tcpcb {
-	struct	tsegqe_head t_segq;	/* segment reassembly queue */
-	void	*t_pspare[2];		/* new reassembly queue */
-	int	t_segqlen;		/* segment reassembly queue length */
-	int	t_dupacks;		/* consecutive dup acks recd */
-
-	struct tcp_timer *t_timers;	/* All the TCP timers in one struct */
-
+	/*
+	 * Fields used by every segment first, on the first two cache
+	 * lines, and the rest in the FreeBSD order.
+	 */
 	struct	inpcb *t_inpcb;		/* back pointer to internet pcb */
 	int	t_state;		/* state of this connection */
 	uint32_t	t_flags;
-
-	struct	vnet *t_vnet;		/* back pointer to parent vnet */
-
 	tcp_seq	snd_una;		/* send unacknowledged */
 	tcp_seq	snd_max;		/* highest sequence number sent;
 					 * used to recognize retransmits
 					 */
 	tcp_seq	snd_nxt;		/* send next */
-	tcp_seq	snd_up;			/* send urgent pointer */
-
 	tcp_seq	snd_wl1;		/* window update seg seq number */
 	tcp_seq	snd_wl2;		/* window update seg ack number */
-	tcp_seq	iss;			/* initial send sequence number */
-	tcp_seq	irs;			/* initial receive sequence number */
-
 	tcp_seq	rcv_nxt;		/* receive next */
 	tcp_seq	rcv_adv;		/* advertised window */
 	uint64_t	rcv_wnd;		/* receive window */
-	tcp_seq	rcv_up;			/* receive urgent pointer */
-
 	uint64_t	snd_wnd;		/* send window */
 	uint64_t	snd_cwnd;		/* congestion-controlled window */
+	uint32_t	t_maxseg;		/* maximum segment size */
+	uint32_t	t_maxopd;		/* mss plus options */
+	uint32_t	t_rcvtime;		/* inactivity time */
+	int	t_dupacks;		/* consecutive dup acks recd */
+	uint32_t  ts_recent;		/* timestamp echo data */
+	uint32_t	ts_recent_age;		/* when last updated */
+	uint32_t  ts_offset;		/* our timestamp offset */
+	tcp_seq	last_ack_sent;
+	uint8_t	snd_scale;		/* window scaling for send window */
+	uint8_t	rcv_scale;		/* window scaling for recv window */
+	int	t_segqlen;		/* segment reassembly queue length */
+	struct tcp_timer *t_timers;	/* All the TCP timers in one struct */
+
+	struct	tsegqe_head t_segq;	/* segment reassembly queue */
+	struct	tsegq_tree t_segqtree;	/* index of t_segq */
+	void	*t_pspare;
+	int	t_segqbytes;		/* bytes in reassembly queue */
+
+
+
+	struct	vnet *t_vnet;		/* back pointer to parent vnet */
+
+	tcp_seq	snd_up;			/* send urgent pointer */
+
+	tcp_seq	iss;			/* initial send sequence number */
+	tcp_seq	irs;			/* initial receive sequence number */
+
+	tcp_seq	rcv_up;			/* receive urgent pointer */
+
 	uint64_t	snd_spare1;		/* unused */
 	uint64_t	snd_ssthresh;		/* snd_cwnd size threshold for
 					 * for slow start exponential to
@@ -148,9 +178,7 @@ struct tcpcb {
 	uint64_t	snd_spare2;		/* unused */
 	tcp_seq	snd_recover;		/* for use in NewReno Fast Recovery */
 
-	uint32_t	t_maxopd;		/* mss plus options */
 
-	uint32_t	t_rcvtime;		/* inactivity time */
 	uint32_t	t_starttime;		/* time connection was established */
 	uint32_t	t_rtttime;		/* RTT measurement start time */
 	tcp_seq	t_rtseq;		/* sequence number being timed */
@@ -159,7 +187,6 @@ struct tcpcb {
 	tcp_seq	t_bw_spare2;		/* unused */
 
 	int	t_rxtcur;		/* current retransmit value (ticks) */
-	uint32_t	t_maxseg;		/* maximum segment size */
 	int	t_srtt;			/* smoothed round-trip time */
 	int	t_rttvar;		/* variance in round-trip time */
 
@@ -174,14 +201,8 @@ struct tcpcb {
 	char	t_oobflags;		/* have some */
 	char	t_iobc;			/* input character */
 /* RFC 1323 variables */
-	uint8_t	snd_scale;		/* window scaling for send window */
-	uint8_t	rcv_scale;		/* window scaling for recv window */
 	uint8_t	request_r_scale;	/* pending window scaling */
-	uint32_t  ts_recent;		/* timestamp echo data */
-	uint32_t	ts_recent_age;		/* when last updated */
-	uint32_t  ts_offset;		/* our timestamp offset */
 
-	tcp_seq	last_ack_sent;
 /* experimental */
 	uint64_t	snd_cwnd_prev;		/* cwnd prior to retransmit */
 	uint64_t	snd_ssthresh_prev;	/* ssthresh prior to retransmit */
@@ -193,6 +214,7 @@ struct tcpcb {
 	int	snd_numholes;		/* number of holes seen by sender */
 	OFP_TAILQ_HEAD(sackhole_head, sackhole) snd_holes;
 					/* SACK scoreboard (sorted) */
+	struct sackhole_tree snd_holes_tree;	/* index of snd_holes */
 	tcp_seq	snd_fack;		/* last seq number(+1) sack'd by rcv'r*/
 	int	rcv_numsacks;		/* # distinct sack blks present */
 	struct sackblk sackblks[OFP_MAX_SACK_BLKS]; /* seq nos. of sack blocks */
@@ -205,6 +227,7 @@ struct tcpcb {
 	struct toe_usrreqs *t_tu;	/* offload operations vector */
 	int	t_sndrexmitpack;	/* retransmit packets sent */
 	int	t_rcvoopack;		/* out-of-order packets received */
+	int	t_rcvoodrop;		/* out-of-order packets dropped */
 	void	*t_toe;			/* TOE pcb pointer */
 	int	t_bytes_acked;		/* # bytes acked during current RTT */
 	struct cc_algo	*cc_algo;	/* congestion control algorithm */
@@ -216,6 +239,27 @@ struct tcpcb {
 	uint32_t	t_keepintvl;		/* interval between keepalives */
 	uint32_t	t_keepcnt;		/* number of keepalives before close */
 
+	uint64_t	t_pacing_rate;		/* bytes per second, 0 = not paced */
+	uint64_t	t_pace_next;		/* ns, earliest time to send more */
+
+	/* Counters of OFP_TCP_INFO */
+	uint64_t	t_sndbyte;		/* data bytes sent */
+	uint64_t	t_sndrexmitbyte;	/* data bytes retransmitted */
+	uint64_t	t_delivered;		/* bytes acked */
+	uint64_t	t_dlv_mark;		/* t_delivered at t_dlv_start */
+	uint64_t	t_dlv_start;		/* ns, start of the rate sample */
+	uint64_t	t_delivery_rate;	/* bytes per second */
+	uint64_t	t_lim_start;		/* ns, t_lim since */
+	uint64_t	t_lim_ns[TCP_LIM_MAX];	/* ns limited by each */
+	uint8_t		t_lim;			/* TCP_LIM_*, what limits now */
+
+	uint8_t		t_tfo_len;		/* TFO cookie for our SYN */
+	uint8_t		t_tfo_cookie[OFP_TCPOLEN_FAST_OPEN_MAX -
+				     OFP_TCPOLEN_FAST_OPEN_EMPTY];
+
+	uint8_t		t_hdrlen;		/* IP header of t_hdr, 0 = none */
+	struct tcptemp	t_hdr;			/* header template */
+
 	uint32_t t_ispare[8];		/* 5 UTO, 3 TBD */
 	void	*t_pspare2[4];		/* 4 TBD */
 	uint64_t _pad[6];		/* 6 TBD (1-2 CC/RTT?) */
@@ -238,6 +282,8 @@ struct tcpcb {
 #define	TF_NEEDFIN	0x000800	/* send FIN (implicit state) */
 #define	TF_NOPUSH	0x001000	/* don't push */
 #define	TF_PREVVALID	0x002000	/* saved values for bad rxmit valid */
+#define	TF_ACKQUEUED	0x004000	/* ACK deferred to end of rx burst */
+#define	TF_FASTOPEN	0x008000	/* TCP Fast Open (RFC 7413) */
 #define	TF_MORETOCOME	0x010000	/* More data to be appended to sock */
 #define	TF_LQ_OVERFLOW	0x020000	/* listen queue overflow */
 #define	TF_LASTIDLE	0x040000	/* connection was previously idle */
@@ -291,14 +337,17 @@ struct tcpopt {
 #define	TOF_TS		0x0010		/* timestamp */
 #define	TOF_SIGNATURE	0x0040		/* TCP-MD5 signature option (RFC2385) */
 #define	TOF_SACK	0x0080		/* Peer sent SACK option */
-#define	TOF_MAXOPT	0x0100
+#define	TOF_FASTOPEN	0x0100		/* TCP Fast Open (TFO) cookie */
+#define	TOF_MAXOPT	0x0200
 	uint32_t	to_tsval;	/* new timestamp */
 	uint32_t	to_tsecr;	/* reflected timestamp */
 	uint8_t		*to_sacks;	/* pointer to the first SACK blocks */
 	uint8_t		*to_signature;	/* pointer to the TCP-MD5 signature */
+	uint8_t		*to_tfo_cookie;	/* pointer to the TFO cookie */
 	uint16_t	to_mss;		/* maximum segment size */
 	uint8_t	to_wscale;	/* window scaling */
 	uint8_t	to_nsacks;	/* number of SACK blocks */
+	uint8_t	to_tfo_len;	/* TFO cookie length */
 	uint32_t	to_spare;	/* UTO */
 };
 
@@ -338,6 +387,26 @@ struct tcptw {
 	OFP_TAILQ_ENTRY(tcptw) tw_2msl;
 };
 
+/*
+ * Compact TIME_WAIT state of an IPv4 connection. The inpcb and socket of
+ * the connection are freed when it enters TIME_WAIT, only this is kept in
+ * the TIME_WAIT table of the core until 2MSL expires.
+ */
+struct tcp_ctw {
+	ofp_in_addr_t	ctw_laddr;
+	ofp_in_addr_t	ctw_faddr;
+	uint16_t	ctw_lport;	/* 0 when removed from the hash */
+	uint16_t	ctw_fport;
+	tcp_seq		snd_nxt;
+	tcp_seq		rcv_nxt;
+	uint32_t	t_recent;
+	uint32_t	ts_offset;	/* our timestamp offset */
+	int		ctw_time;	/* expiry, in ticks */
+	uint32_t	ctw_hnext;	/* hash chain or free list */
+	uint32_t	ctw_wnext;	/* timer wheel slot chain */
+	uint16_t	last_win;	/* cached window value */
+};
+
 #define	intotcpcb(ip)	((struct tcpcb *)(ip)->inp_ppcb)
 #define	intotw(ip)	((struct tcptw *)(ip)->inp_ppcb)
 #define	sototcpcb(so)	(intotcpcb(sotoinpcb(so)))
@@ -377,6 +446,27 @@ struct tcptw {
 	max((tp)->t_rttmin, (((tp)->t_srtt >> (TCP_RTT_SHIFT - TCP_DELTA_SHIFT))  \
 	  + (tp)->t_rttvar) >> TCP_DELTA_SHIFT)
 
+/*
+ * Time spent limited by lim since the last change, from ofp_tcp_output()
+ * when the limit changes and from OFP_TCP_INFO.
+ */
+static inline void
+tcp_limit_account(struct tcpcb *tp, int lim, uint64_t now)
+{
+	if (tp->t_lim_start)
+		tp->t_lim_ns[tp->t_lim] += now - tp->t_lim_start;
+	tp->t_lim = lim;
+	tp->t_lim_start = now;
+}
+
+/* Change the state of the connection, see ofpi_tracepoint.h */
+static inline void
+tcp_state_change(struct tcpcb *tp, int newstate)
+{
+	OFP_TRACEPOINT(tcp_state, tp, tp->t_state, newstate);
+	tp->t_state = newstate;
+}
+
 /*
  * TCP statistics.
  * Many of these should be kept per connection,
@@ -595,6 +685,7 @@ extern	int ofp_tcp_log_in_vain;
 VNET_DECLARE(int, ofp_tcp_mssdflt);	/* XXX */
 VNET_DECLARE(int, ofp_tcp_minmss);
 VNET_DECLARE(int, ofp_tcp_delack_enabled);
+VNET_DECLARE(int, ofp_tcp_ack_coalesce);
 VNET_DECLARE(int, ofp_tcp_do_rfc3390);
 VNET_DECLARE(int, ofp_path_mtu_discovery);
 VNET_DECLARE(int, ofp_ss_fltsz);
@@ -605,6 +696,7 @@ VNET_DECLARE(int, ofp_tcp_abc_l_var);
 #define	V_tcp_mssdflt		VNET(ofp_tcp_mssdflt)
 #define	V_tcp_minmss		VNET(ofp_tcp_minmss)
 #define	V_tcp_delack_enabled	VNET(ofp_tcp_delack_enabled)
+#define	V_tcp_ack_coalesce	VNET(ofp_tcp_ack_coalesce)
 #define	V_tcp_do_rfc3390	VNET(ofp_tcp_do_rfc3390)
 #define	V_path_mtu_discovery	VNET(ofp_path_mtu_discovery)
 #define	V_ss_fltsz		VNET(ofp_ss_fltsz)
@@ -614,7 +706,9 @@ VNET_DECLARE(int, ofp_tcp_abc_l_var);
 
 VNET_DECLARE(int, ofp_tcp_do_sack);			/* SACK enabled/disabled */
 VNET_DECLARE(int, ofp_tcp_sc_rst_sock_fail);	/* RST on sock alloc failure */
+VNET_DECLARE(int, ofp_tcp_sack_rack);		/* lost rexmit detection */
 #define	V_tcp_do_sack		VNET(ofp_tcp_do_sack)
+#define	V_tcp_sack_rack		VNET(ofp_tcp_sack_rack)
 #define	V_tcp_sc_rst_sock_fail	VNET(ofp_tcp_sc_rst_sock_fail)
 
 VNET_DECLARE(int, ofp_tcp_do_ecn);			/* TCP ECN enabled/disabled */
@@ -640,10 +734,13 @@ int	 ofp_tcp_ctloutput(struct socket *, struct sockopt *);
 struct tcpcb *
 	 ofp_tcp_drop(struct tcpcb *, int);
 void	 ofp_tcp_drain(void);
-void	 ofp_tcp_tcbinfo_hashstats(unsigned int *min, unsigned int *avg, unsigned int *max);
+void	 ofp_tcp_tcbinfo_hashstats(unsigned int *min, unsigned int *avg, unsigned int *max,
+	    unsigned int *hist, int nhist);
 void	 ofp_tcp_init(void);
 void	 ofp_tcp_destroy(void);
 void	 ofp_tcp_netstat(int fd);
+void	 ofp_tcp_netstat_rexmit(int fd, int num);
+void	 ofp_tcp_hashprint(int fd);
 void	 ofp_tcp_fini(void *);
 char	*ofp_tcp_log_addrs(struct in_conninfo *, struct ofp_tcphdr *, void *,
 	    const void *);
@@ -652,6 +749,7 @@ char	*ofp_tcp_log_vain(struct in_conninfo *, struct ofp_tcphdr *, void *,
 int	 ofp_tcp_reass(struct tcpcb *, struct ofp_tcphdr *, int *, odp_packet_t );
 void	 ofp_tcp_reass_init(void);
 void	 ofp_tcp_reass_flush(struct tcpcb *);
+RB_PROTOTYPE(tsegq_tree, tseg_qent, tqe_rb, tcp_reass_cmp);
 
 enum ofp_return_code ofp_tcp_input(odp_packet_t *, int);
 #define	TI_UNLOCKED	1
@@ -679,11 +777,17 @@ void	 ofp_tcp_tw_zone_change(void);
 int	 ofp_tcp_twcheck(struct inpcb *, struct tcpopt *, struct ofp_tcphdr *,
 	    odp_packet_t , int);
 int	 ofp_tcp_twrespond(struct tcptw *, int);
+int	 ofp_tcp_twinput(struct ofp_ip *, struct ofp_tcphdr *, struct tcpopt *,
+	    odp_packet_t, int);
+int	 ofp_tcp_twreuse(struct tcpcb *);
+void	 ofp_tcp_twexpire(void);
 void	 ofp_tcp_setpersist(struct tcpcb *);
+void	 ofp_tcp_sbautoshrink(struct tcpcb *);
 void	 ofp_tcp_slowtimo(void *);
 struct tcptemp *
 	 ofp_tcpip_maketemplate(struct inpcb *);
 void	 ofp_tcpip_fillheaders(struct inpcb *, void *, void *);
+void	 ofp_tcpip_copyheaders(struct tcpcb *, void *, void *);
 void	 ofp_tcp_timer_activate(struct tcpcb *, int, uint32_t);
 int	 ofp_tcp_timer_active(struct tcpcb *, int);
 void	 tcp_trace(short, short, struct tcpcb *, void *, struct ofp_tcphdr *, int);
@@ -706,6 +810,7 @@ void	 ofp_tcp_update_sack_list(struct tcpcb *tp, tcp_seq rcv_laststart, tcp_seq
 void	 ofp_tcp_clean_sackreport(struct tcpcb *tp);
 void	 ofp_tcp_sack_adjust(struct tcpcb *tp);
 struct sackhole *ofp_tcp_sack_output(struct tcpcb *tp, int *sack_bytes_rexmt);
+RB_PROTOTYPE(sackhole_tree, sackhole, scbtree, tcp_sackhole_cmp);
 void	 ofp_tcp_sack_partialack(struct tcpcb *, struct ofp_tcphdr *);
 void	 ofp_tcp_free_sackholes(struct tcpcb *tp);
 int	 tcp_newreno(struct tcpcb *, struct ofp_tcphdr *);
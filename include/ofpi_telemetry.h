@@ -0,0 +1,19 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_TELEMETRY_H__
+#define __OFPI_TELEMETRY_H__
+
+#include "api/ofp_init.h"
+#include "api/ofp_telemetry.h"
+
+int ofp_telemetry_init_global(struct telemetry_s *param);
+int ofp_telemetry_term_global(void);
+
+/* Copy the counters into the telemetry segment now */
+void ofp_telemetry_update(void);
+
+#endif /* __OFPI_TELEMETRY_H__ */
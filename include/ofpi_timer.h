@@ -43,4 +43,18 @@ int ofp_timer_term_global(void);
 
 void ofp_timer_evt_cleanup(odp_event_t);
 
+/*
+ * The default dispatcher of cpu_id polls, or stops polling, the timer
+ * queue of the CPU. With tcp_timer_affinity the callout wheel of the
+ * CPU ticks on its own queue while it is polled.
+ */
+void ofp_timer_queue_cpu_polled(int cpu_id, int polled);
+
+/*
+ * Move the wheel ticks of cpu_id, no longer polled, to the shared
+ * queue. Returns 1 while a tick already fired is still to be handled
+ * from the queue of the CPU, the caller drains it and calls again.
+ */
+int ofp_timer_queue_cpu_release(int cpu_id);
+
 #endif
@@ -0,0 +1,36 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_TM_H__
+#define __OFPI_TM_H__
+
+#include <odp_api.h>
+
+/*
+ * Egress traffic manager. An interface with pktout mode TM gets an ODP
+ * TM system of a shaped root node, a node per tenant under it and a
+ * TM queue per traffic class of a tenant. Packets are enqueued to the
+ * queue of the tenant of their VLAN and the class of their DSCP.
+ */
+
+struct ofp_ifnet;
+
+/* Create the TM system of ifnet, after its pktio is opened */
+int ofp_tm_ifnet_create(struct ofp_ifnet *ifnet);
+/* Start the TM system, after the pktio is started */
+int ofp_tm_ifnet_start(struct ofp_ifnet *ifnet);
+/* Destroy the TM system of ifnet, before its pktio is closed */
+int ofp_tm_ifnet_term(struct ofp_ifnet *ifnet);
+
+/* Enqueue packets to the TM queues of ifnet. Returns the number sent. */
+int ofp_tm_send_multi(struct ofp_ifnet *ifnet, odp_packet_t pkt[], int num);
+
+int ofp_tm_lookup_shared_memory(void);
+void ofp_tm_init_prepare(void);
+int ofp_tm_init_global(void);
+int ofp_tm_term_global(void);
+
+#endif /* __OFPI_TM_H__ */
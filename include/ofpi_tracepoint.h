@@ -0,0 +1,45 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef __OFPI_TRACEPOINT_H__
+#define __OFPI_TRACEPOINT_H__
+
+#include <odp_api.h>
+#include "ofpi_debug.h"
+
+/*
+ * Static tracepoints for perf, bpftrace, SystemTap or LTTng. Built with
+ * --enable-sdt, each one is a USDT probe of provider "ofp", a nop in
+ * the code that a tracer attaches to by name, and fires while
+ * OFP_DEBUG_TRACEPOINTS is set in the debug flags. Without it, no code
+ * is generated.
+ *
+ * Probes and arguments, packets as odp_packet_to_u64():
+ *   pkt_input(pkt, port)
+ *   pkt_drop(pkt, port, reason)	last OFP_DROP_ reason + 1, 0: none
+ *   route_lookup(vrf, addr, nh)	nh NULL without a route
+ *   arp_miss(vrf, addr, pkt)
+ *   tcp_state(tp, old, new)
+ *   tcp_retransmit(tp, seq, len)
+ *   tcp_rexmt_timeout(tp, rxtshift)
+ *   sock_enqueue(sb, len, cc)		cc: bytes in sb after the change
+ *   sock_dequeue(sb, len, cc)
+ *   timer_fire(callback, arg)	arg: argument buffer, or callout arg
+ *   ipsec_submit(dir, num)		dir 0: inbound, 1: outbound
+ *   ipsec_complete(pkt, error)	error: odp_ipsec_op_status_t error.all
+ */
+#ifdef OFP_SDT
+#include <sys/sdt.h>
+
+#define OFP_TRACEPOINT(name, ...) do {					\
+	if (odp_unlikely(ofp_debug_flags & OFP_DEBUG_TRACEPOINTS))	\
+		STAP_PROBEV(ofp, name, __VA_ARGS__);			\
+} while (0)
+#else
+#define OFP_TRACEPOINT(name, ...) do { } while (0)
+#endif
+
+#endif /* __OFPI_TRACEPOINT_H__ */
@@ -69,8 +69,11 @@ typedef void(*udp_tun_func_t)(odp_packet_t , int off, struct inpcb *);
 struct udpcb {
 	udp_tun_func_t	u_tun_func;	/* UDP kernel tunneling callback. */
 	uint32_t		u_flags;	/* Generic UDP flags. */
+	uint16_t		u_gso_size;	/* OFP_UDP_SEGMENT, 0 if off */
 };
 
+#define	UF_GRO		0x0001		/* OFP_UDP_GRO */
+
 #define	intoudpcb(ip)	((struct udpcb *)(ip)->inp_ppcb)
 #define	sotoudpcb(so)	(intoudpcb(sotoinpcb(so)))
 
@@ -115,7 +118,6 @@ struct ofp_udpstat {
 
 SYSCTL_DECL(_net_inet_udp);
 
-extern struct inpcbinfo ofp_udbinfo;
 extern struct pr_usrreqs	ofp_udp_usrreqs;
 extern uint64_t			ofp_udp_sendspace;
 extern uint64_t			ofp_udp_recvspace;
@@ -129,6 +131,7 @@ int		 ofp_udp_ctloutput(struct socket *, struct sockopt *);
 void		 ofp_udp_init(void);
 void		 ofp_udp_destroy(void);
 void		 ofp_udp_netstat(int fd);
+void		 ofp_udp_hashprint(int fd);
 enum ofp_return_code ofp_udp_input(odp_packet_t *, int);
 struct inpcb	*ofp_udp_notify(struct inpcb *, int);
 int		 ofp_udp_shutdown(struct socket *so);
@@ -15,6 +15,8 @@
  * uma_zcreate() takes an additional parameter 'nitems' to specify the
  * max number of objects. uma_zone_set_max() does nothing.
  *
+ * Allocations and frees go through per-thread caches of free objects,
+ * see ofp_global_param_t::uma_cache_size.
  */
 
 #define	OFP_M_NOWAIT	0x0001		/* do not block */
@@ -48,6 +50,9 @@ uma_zone_t ofp_uma_pool_create(const char *name, int nitems, int size);
 int ofp_uma_pool_destroy(uma_zone_t zone);
 void *ofp_uma_pool_alloc(uma_zone_t zone, int flags);
 void ofp_uma_pool_free(void *item);
+void ofp_print_uma_stat(int fd);
+/* Highest percentage of a zone taken from its pool, and the zone */
+int ofp_uma_usage_max(const char **name);
 
 
 int ofp_uma_lookup_shared_memory(void);
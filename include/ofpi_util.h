@@ -27,6 +27,10 @@
 #define _BA0_(c, x) _BA1_(c, x)
 #define BUILD_ASSERT(cond) _BA0_(cond, __LINE__)
 
+/* Round a size up to a multiple of the cache line size */
+#define ROUNDUP_CACHE(x) \
+	(((x) + ODP_CACHE_LINE_SIZE - 1) & ~(uint64_t)(ODP_CACHE_LINE_SIZE - 1))
+
 #define KASSERT(x, y)  do {						\
 		if (!(x)) {						\
 			OFP_ERR y ;					\
@@ -105,11 +109,37 @@ int ofp_mask_length(int masklen, uint8_t *mask);
 int ofp_name_to_port_vlan(const char *dev, int *vlan);
 char *ofp_port_vlan_to_ifnet_name(int port, int vlan);
 int ofp_sendf(int fd, const char *fmt, ...);
+
+/*
+ * Output collected and written to fd in chunks of the buffer size, for
+ * dumps of many lines. ofp_sendbuf_flush() writes out the rest.
+ */
+struct ofp_sendbuf {
+	int fd;
+	int len;
+	char buf[4096];
+};
+
+void ofp_sendbuf_init(struct ofp_sendbuf *sb, int fd);
+int ofp_sendbuf_printf(struct ofp_sendbuf *sb, const char *fmt, ...);
+int ofp_sendbuf_flush(struct ofp_sendbuf *sb);
 int ofp_has_mac(uint8_t *mac);
+/* Select the checksum kernel for this CPU */
+void ofp_cksum_init_global(void);
 
 static inline odp_pool_t ofp_pool_create(const char *name,
 	odp_pool_param_t *params)
 {
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 30
+	odp_pool_capability_t capa;
+
+	/* Occupancy for ofp_show_memory(), where the pool can count it */
+	if (params->type == ODP_POOL_PACKET && !odp_pool_capability(&capa)) {
+		params->stats.bit.available = capa.pkt.stats.bit.available;
+		params->stats.bit.cache_available =
+			capa.pkt.stats.bit.cache_available;
+	}
+#endif
 	return odp_pool_create(name, params);
 }
 
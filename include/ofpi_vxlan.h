@@ -7,6 +7,9 @@
 #ifndef __OFPI_VXLAN_H__
 #define __OFPI_VXLAN_H__
 
+#include <odp_api.h>
+#include "api/ofp_types.h"
+
 struct vxlan_user_data {
 	uint32_t hdrlen;
 	uint32_t vni;
@@ -16,6 +19,8 @@ struct ofp_ifnet;
 struct ofp_nh_entry;
 struct ofp_arphdr;
 struct ip_out;
+
+#ifdef OFP_VXLAN
 enum ofp_return_code ofp_vxlan_input(odp_packet_t pkt);
 enum ofp_return_code ofp_vxlan_prepend_hdr(odp_packet_t pkt, struct ofp_ifnet *vxdev,
 			  struct ofp_nh_entry *nh);
@@ -38,5 +43,55 @@ void ofp_vxlan_restore_and_update_header(odp_packet_t pkt,
 void ofp_vxlan_send_arp_request(odp_packet_t pkt, struct ofp_ifnet *dev);
 enum ofp_return_code ofp_ip_output_vxlan(odp_packet_t pkt,
 					 struct ofp_ifnet *dev_out);
+#else
+/*
+ * No VXLAN interfaces are created without the module, the callers
+ * below check for one first.
+ */
+static inline enum ofp_return_code ofp_vxlan_input(odp_packet_t pkt)
+{
+	(void)pkt;
+	return OFP_PKT_CONTINUE;
+}
+
+static inline void ofp_vxlan_update_devices(odp_packet_t pkt,
+					    struct ofp_arphdr *arp,
+					    uint16_t *vlan,
+					    struct ofp_ifnet **dev,
+					    struct ofp_ifnet **outdev,
+					    uint8_t *save_space)
+{
+	(void)pkt;
+	(void)arp;
+	(void)vlan;
+	(void)dev;
+	(void)outdev;
+	(void)save_space;
+}
+
+static inline void ofp_vxlan_restore_and_update_header(odp_packet_t pkt,
+						       struct ofp_ifnet *outdev,
+						       uint8_t *saved_mac)
+{
+	(void)pkt;
+	(void)outdev;
+	(void)saved_mac;
+}
+
+static inline void ofp_vxlan_send_arp_request(odp_packet_t pkt,
+					      struct ofp_ifnet *dev)
+{
+	(void)dev;
+	odp_packet_free(pkt);
+}
+
+static inline enum ofp_return_code ofp_ip_output_vxlan(odp_packet_t pkt,
+							struct ofp_ifnet *dev_out)
+{
+	(void)pkt;
+	(void)dev_out;
+	return OFP_PKT_DROP;
+}
+#endif /* OFP_VXLAN */
 
 #endif /*__OFPI_VXLAN_H__*/
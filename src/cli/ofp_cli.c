@@ -34,6 +34,7 @@
 #ifdef CLI
 
 void ofpcli_ipsec_init(void);
+void ofpcli_acl_init(void);
 
 /*
  * Only core 0 runs this.
@@ -695,6 +696,41 @@ struct cli_command commands[] = {
 		"File to save captured packets",
 		f_debug_capture_file
 	},
+	{
+		"debug capture snaplen NUMBER",
+		"Bytes to save of each captured packet",
+		f_debug_capture_snaplen
+	},
+	{
+		"debug capture filter STRING",
+		"Print and capture only packets that match the filter",
+		f_debug_capture_filter
+	},
+	{
+		"debug capture rotate NUMBER NUMBER",
+		"Capture file size in kB and number of files to keep",
+		f_debug_capture_rotate
+	},
+	{
+		"debug trace",
+		"Show the last records of the packet trace",
+		f_debug_trace_show
+	},
+	{
+		"debug trace NUMBER",
+		"Bit mask of the packet trace stages to record",
+		f_debug_trace
+	},
+	{
+		"debug trace show NUMBER",
+		"Show the last records of the packet trace of each thread",
+		f_debug_trace_show
+	},
+	{
+		"debug trace dump STRING",
+		"Save the packet trace in binary format",
+		f_debug_trace_dump
+	},
 	{
 		"loglevel",
 		"Show or set log level",
@@ -884,6 +920,11 @@ struct cli_command commands[] = {
 		NULL,
 		f_ifconfig_show
 	},
+	{
+		"ifconfig steer",
+		"Show steering rules",
+		f_ifconfig_steer
+	},
 	{
 		"ifconfig DEV IP4NET",
 		"Create interface",
@@ -996,11 +1037,36 @@ struct cli_command commands[] = {
 		NULL,
 		f_stat_perf
 	},
+	{
+		"stat top",
+		NULL,
+		f_stat_top
+	},
+	{
+		"stat top NUMBER",
+		NULL,
+		f_stat_top
+	},
 	{
 		"stat clear",
 		NULL,
 		f_stat_clear
 	},
+	{
+		"stat memory",
+		NULL,
+		f_stat_memory
+	},
+	{
+		"stat locks",
+		NULL,
+		f_stat_locks
+	},
+	{
+		"stat locks clear",
+		NULL,
+		f_stat_locks_clear
+	},
 	{
 		"stat help",
 		NULL,
@@ -1041,6 +1107,16 @@ struct cli_command commands[] = {
 		"Show UDP open ports",
 		f_netstat_udp
 	},
+	{
+		"netstat -H",
+		"Show PCB hash chain lengths",
+		f_netstat_hash
+	},
+	{
+		"netstat -r NUMBER",
+		"Show TCP connections by retransmitted bytes",
+		f_netstat_rexmit
+	},
 	{
 		"netstat help",
 		NULL,
@@ -1246,6 +1322,9 @@ static void cli_init_commands(void)
 	/* Add IPsec commands */
 	ofpcli_ipsec_init();
 
+	/* Add ACL commands */
+	ofpcli_acl_init();
+
 	/* Print nodes */
 	if (ofp_debug_logging_enabled()) {
 	    ofp_sendf(conn.fd, "CLI Command nodes:\n");
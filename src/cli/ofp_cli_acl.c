@@ -0,0 +1,302 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "api/ofp_acl.h"
+#include "api/ofp_in.h"
+#include "ofpi_acl.h"
+#include "ofpi_cli.h"
+#include "ofpi_util.h"
+#include "ofpi_log.h"
+
+#define MAX_STR 128
+
+static int parse_ports(const char *v, uint16_t *lo, uint16_t *hi)
+{
+	unsigned int a, b;
+	int n = sscanf(v, "%u-%u", &a, &b);
+
+	if (n == 1)
+		b = a;
+	else if (n != 2)
+		return -1;
+	if (a > b || b > 0xffff)
+		return -1;
+	*lo = a;
+	*hi = b;
+	return 0;
+}
+
+static int parse_proto(const char *v, uint8_t *proto)
+{
+	unsigned int p;
+
+	if (!strcmp(v, "tcp"))
+		p = OFP_IPPROTO_TCP;
+	else if (!strcmp(v, "udp"))
+		p = OFP_IPPROTO_UDP;
+	else if (!strcmp(v, "icmp"))
+		p = OFP_IPPROTO_ICMP;
+	else if (sscanf(v, "%u", &p) != 1 || p > 255)
+		return -1;
+	*proto = p;
+	return 0;
+}
+
+/*
+ * Parse "key=value,..." with keys src, dst, sport, dport, proto, dscp,
+ * vrf and action. Returns the name of the invalid key or NULL.
+ */
+static const char *parse_rule(char *spec, struct ofp_acl_rule *rule)
+{
+	char *save = NULL, *tk, *v;
+	unsigned int n;
+	int len;
+
+	for (tk = strtok_r(spec, ",", &save); tk;
+	     tk = strtok_r(NULL, ",", &save)) {
+		v = strchr(tk, '=');
+		if (!v)
+			return tk;
+		*v++ = 0;
+
+		if (!strcmp(tk, "src") || !strcmp(tk, "dst")) {
+			uint32_t addr;
+
+			if (!ip4net_get(v, &addr, &len) || len < 0 || len > 32)
+				return tk;
+			if (tk[0] == 's') {
+				rule->src = addr;
+				rule->src_len = len;
+			} else {
+				rule->dst = addr;
+				rule->dst_len = len;
+			}
+		} else if (!strcmp(tk, "sport")) {
+			if (parse_ports(v, &rule->sport_lo, &rule->sport_hi))
+				return tk;
+		} else if (!strcmp(tk, "dport")) {
+			if (parse_ports(v, &rule->dport_lo, &rule->dport_hi))
+				return tk;
+		} else if (!strcmp(tk, "proto")) {
+			if (parse_proto(v, &rule->proto))
+				return tk;
+		} else if (!strcmp(tk, "dscp")) {
+			if (sscanf(v, "%u", &n) != 1 || n > 63)
+				return tk;
+			rule->dscp = n;
+		} else if (!strcmp(tk, "vrf")) {
+			if (sscanf(v, "%u", &n) != 1)
+				return tk;
+			rule->vrf = n;
+		} else if (!strcmp(tk, "action")) {
+			if (!strcmp(v, "permit"))
+				rule->action = OFP_ACL_PERMIT;
+			else if (!strcmp(v, "deny"))
+				rule->action = OFP_ACL_DENY;
+			else
+				return tk;
+		} else {
+			return tk;
+		}
+	}
+	return NULL;
+}
+
+static void acl_add(struct cli_conn *conn, const char *s,
+		    enum ofp_acl_point point)
+{
+	struct ofp_acl_rule rule;
+	char spec[MAX_STR];
+	const char *bad;
+	unsigned int prio;
+	int id;
+
+	ofp_acl_rule_init(&rule);
+	if (sscanf(s, "%u %127s", &prio, spec) != 2) {
+		ofp_sendf(conn->fd, "Syntax error\r\n");
+		sendcrlf(conn);
+		return;
+	}
+	rule.priority = prio;
+
+	bad = parse_rule(spec, &rule);
+	if (bad) {
+		ofp_sendf(conn->fd, "Invalid %s\r\n", bad);
+		sendcrlf(conn);
+		return;
+	}
+
+	id = ofp_acl_rule_add(point, &rule);
+	if (id < 0)
+		ofp_sendf(conn->fd, "Rule not added\r\n");
+	else
+		ofp_sendf(conn->fd, "Rule %d added\r\n", id);
+	sendcrlf(conn);
+}
+
+static void acl_del(struct cli_conn *conn, const char *s,
+		    enum ofp_acl_point point)
+{
+	int id;
+
+	if (sscanf(s, "%d", &id) != 1 || ofp_acl_rule_del(point, id))
+		ofp_sendf(conn->fd, "Rule not found\r\n");
+	sendcrlf(conn);
+}
+
+static void acl_commit(struct cli_conn *conn, enum ofp_acl_point point)
+{
+	if (ofp_acl_commit(point))
+		ofp_sendf(conn->fd, "Commit failed, see the log\r\n");
+	sendcrlf(conn);
+}
+
+static void cmd_local_add(struct cli_conn *conn, const char *s)
+{
+	acl_add(conn, s, OFP_ACL_LOCAL);
+}
+
+static void cmd_fwd_add(struct cli_conn *conn, const char *s)
+{
+	acl_add(conn, s, OFP_ACL_FWD);
+}
+
+static void cmd_local_del(struct cli_conn *conn, const char *s)
+{
+	acl_del(conn, s, OFP_ACL_LOCAL);
+}
+
+static void cmd_fwd_del(struct cli_conn *conn, const char *s)
+{
+	acl_del(conn, s, OFP_ACL_FWD);
+}
+
+static void cmd_local_commit(struct cli_conn *conn, const char *s)
+{
+	(void) s;
+	acl_commit(conn, OFP_ACL_LOCAL);
+}
+
+static void cmd_fwd_commit(struct cli_conn *conn, const char *s)
+{
+	(void) s;
+	acl_commit(conn, OFP_ACL_FWD);
+}
+
+static void cmd_show(struct cli_conn *conn, const char *s)
+{
+	(void) s;
+	ofp_acl_print(conn->fd);
+	sendcrlf(conn);
+}
+
+static const char *help_text[] = {
+	"Add a rule to the ACL of local or forwarded packets:",
+	"  acl local|fwd add <priority> <key>=<value>[,<key>=<value>...]",
+	"    src=<a.b.c.d/n>, dst=<a.b.c.d/n>: address prefixes",
+	"    sport=<port>[-<port>], dport=<port>[-<port>]: port ranges",
+	"    proto=tcp|udp|icmp|<number>, dscp=<0-63>, vrf=<number>",
+	"    action=permit|deny",
+	"  Lower priority matches first. Example:",
+	"    acl fwd add 10 dst=10.0.0.0/8,proto=tcp,dport=22,action=deny",
+	"Delete a rule:",
+	"  acl local|fwd delete <id>",
+	"Apply the added and deleted rules:",
+	"  acl local|fwd commit",
+	"Show the rules and their counters:",
+	"  acl show",
+	0};
+
+static void cmd_help(struct cli_conn *conn, const char *s)
+{
+	const char **line = help_text;
+	(void) s;
+
+	while (*line) {
+		ofp_sendf(conn->fd, *line);
+		ofp_sendf(conn->fd, "\r\n");
+		line++;
+	}
+	sendcrlf(conn);
+}
+
+struct cli_command {
+	const char *command;
+	const char *help;
+	void *func;
+};
+
+static struct cli_command commands[] = {
+	{
+		"acl local add NUMBER STRING",
+		"Add a rule to the ACL of local packets",
+		cmd_local_add
+	},
+	{
+		"acl fwd add NUMBER STRING",
+		"Add a rule to the ACL of forwarded packets",
+		cmd_fwd_add
+	},
+	{
+		"acl local delete NUMBER",
+		"Delete a rule of the ACL of local packets",
+		cmd_local_del
+	},
+	{
+		"acl fwd delete NUMBER",
+		"Delete a rule of the ACL of forwarded packets",
+		cmd_fwd_del
+	},
+	{
+		"acl local commit",
+		"Apply the rules of the ACL of local packets",
+		cmd_local_commit
+	},
+	{
+		"acl fwd commit",
+		"Apply the rules of the ACL of forwarded packets",
+		cmd_fwd_commit
+	},
+	{
+		"acl show",
+		"Show the ACL rules",
+		cmd_show
+	},
+	{
+		"acl help",
+		NULL,
+		cmd_help
+	},
+	{
+		"help acl",
+		NULL,
+		cmd_help
+	},
+	{ NULL, NULL, NULL }
+};
+
+void ofpcli_acl_init(void);
+
+void ofpcli_acl_init(void)
+{
+	struct cli_command *cmd = commands;
+	static int initialized = 0;
+
+	if (initialized)
+		return;
+	initialized = 1;
+
+	while (cmd->command) {
+		ofp_cli_add_command(cmd->command, cmd->help, cmd->func);
+		cmd++;
+	}
+}
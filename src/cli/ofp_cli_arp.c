@@ -13,6 +13,7 @@
 #include "ofpi_cli.h"
 #include "ofpi_route.h"
 #include "ofpi_arp.h"
+#include "ofpi_nd6_cache.h"
 #include "ofpi_util.h"
 
 
@@ -22,6 +23,10 @@ void f_arp(struct cli_conn *conn, const char *s)
 
 	ofp_show_routes(conn->fd, OFP_SHOW_ARP);
 	ofp_arp_show_saved_packets(conn->fd);
+#ifdef INET6
+	ofp_sendf(conn->fd, "\r\nIPv6 neighbours\r\n");
+	ofp_nd6_cache_show(conn->fd);
+#endif /* INET6 */
 	sendcrlf(conn);
 }
 
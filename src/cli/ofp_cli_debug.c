@@ -9,6 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "ofpi_config.h"
 #include "ofpi_debug.h"
 #include "ofpi_cli.h"
 #include "ofpi_util.h"
@@ -35,6 +36,7 @@ void f_debug_show(struct cli_conn *conn, const char *s)
 {
 	int i;
 	char filename[128];
+	char filter[128];
 
 	(void)s;
 
@@ -76,6 +78,13 @@ void f_debug_show(struct cli_conn *conn, const char *s)
 		ofp_get_capture_file(filename, sizeof(filename));
 
 		ofp_sendf(conn->fd, "  Capturing file: %s\r\n", filename);
+
+		ofp_get_capture_filter(filter, sizeof(filter));
+		ofp_sendf(conn->fd, "  Snaplen: %u  Filter: %s\r\n",
+			  ofp_get_capture_snaplen(),
+			  filter[0] ? filter : "none");
+		ofp_sendf(conn->fd, "  Captured: %lu  Dropped: %lu\r\n",
+			  ofp_get_capture_count(), ofp_get_capture_drops());
 	} else {
 		ofp_sendf(conn->fd, "Capturing NO traffic.\r\n");
 	}
@@ -115,6 +124,60 @@ void f_debug_capture_file(struct cli_conn *conn, const char *s)
 	sendcrlf(conn);
 }
 
+/* debug capture snaplen NUMBER */
+void f_debug_capture_snaplen(struct cli_conn *conn, const char *s)
+{
+	ofp_set_capture_snaplen(strtoul(s, NULL, 0));
+	sendcrlf(conn);
+}
+
+/* debug capture filter STRING */
+void f_debug_capture_filter(struct cli_conn *conn, const char *s)
+{
+	if (ofp_set_capture_filter(s))
+		ofp_sendf(conn->fd, "Invalid filter: %s\r\n", s);
+	sendcrlf(conn);
+}
+
+/* debug capture rotate NUMBER NUMBER */
+void f_debug_capture_rotate(struct cli_conn *conn, const char *s)
+{
+	unsigned long size;
+	int count;
+
+	if (sscanf(s, "%lu %d", &size, &count) != 2) {
+		sendcrlf(conn);
+		return;
+	}
+	ofp_set_capture_rotate((uint64_t)size * 1024, count);
+	sendcrlf(conn);
+}
+
+/* debug trace NUMBER */
+void f_debug_trace(struct cli_conn *conn, const char *s)
+{
+	ofp_trace_stages_set(strtoul(s, NULL, 0));
+	sendcrlf(conn);
+}
+
+/* debug trace */
+/* debug trace show NUMBER */
+void f_debug_trace_show(struct cli_conn *conn, const char *s)
+{
+	ofp_sendf(conn->fd, "Trace stages: 0x%x\r\n",
+		  ofp_trace_stages_get());
+	ofp_trace_print(conn->fd, s && *s ? atoi(s) : 16);
+	sendcrlf(conn);
+}
+
+/* debug trace dump STRING */
+void f_debug_trace_dump(struct cli_conn *conn, const char *s)
+{
+	if (ofp_trace_dump(s))
+		ofp_sendf(conn->fd, "Trace not saved\r\n");
+	sendcrlf(conn);
+}
+
 /* debug */
 /* debug help */
 /* help debug*/
@@ -137,6 +200,7 @@ void f_help_debug(struct cli_conn *conn, const char *s)
 		"    bit 4: print packets to console\r\n"
 		"    bit 6: capture packets to pcap file\r\n"
 		"           - set/reset automatically by capture function\r\n"
+		"    bit 8: fire the static tracepoints (--enable-sdt)\r\n"
 		"  Default text file name: '"
 		DEFAULT_DEBUG_TXT_FILE_NAME"'\r\n"
 		"  Default capture file name: '"
@@ -163,7 +227,28 @@ void f_help_debug(struct cli_conn *conn, const char *s)
 	  "Set packet capture file or fifo\r\n"
 	  "  debug capture file <filename>\r\n"
 	  "  Example:\r\n"
-	  "    debug capture file /root/my-fifo\r\n\r\n");
+	  "    debug capture file /root/my-fifo\r\n"
+	  "  Packets are written in pcapng format by a thread on the\r\n"
+	  "  slow path core.\r\n\r\n");
+
+	ofp_sendf(conn->fd,
+	  "Set number of bytes captured per packet\r\n"
+	  "  debug capture snaplen <bytes, max %d>\r\n\r\n",
+	  OFP_PCAP_SNAPLEN_MAX);
+
+	ofp_sendf(conn->fd,
+	  "Print and capture only matching packets\r\n"
+	  "  debug capture filter <primitive[,primitive...]>\r\n"
+	  "    primitives: ip, ip6, arp, tcp, udp, icmp, proto=N,\r\n"
+	  "    host=A.B.C.D, port=N, vlan=N, none\r\n"
+	  "  Example:\r\n"
+	  "    debug capture filter tcp,port=80\r\n\r\n");
+
+	ofp_sendf(conn->fd,
+	  "Rotate capture file\r\n"
+	  "  debug capture rotate <size in kB, 0 = off> <number of files>\r\n"
+	  "  Example:\r\n"
+	  "    debug capture rotate 10240 4\r\n\r\n");
 
 	ofp_sendf(conn->fd,
 	  "Set the first octet of the destination MAC address "
@@ -178,5 +263,14 @@ void f_help_debug(struct cli_conn *conn, const char *s)
 	  "  Example: tcpdump line:\r\n"
 	  "    '11:36:56.851469 b4:b5:2f:63:05:e5 > c0:9d:67:1a:97:7e, ethe...'\r\n"
 	  "    1st octet of dst = 0xc0 -> port = 0, tx via KNI\r\n\r\n");
+
+	ofp_sendf(conn->fd,
+	  "Set the stages recorded by the packet trace\r\n"
+	  "  debug trace <bit mask of stages>\r\n"
+	  "    bit 0: received, bit 1: verdict, bit 2: sent\r\n"
+	  "Show the last records of each thread\r\n"
+	  "  debug trace show <number of records>\r\n"
+	  "Save the trace of all threads in binary format\r\n"
+	  "  debug trace dump <filename>\r\n\r\n");
 	sendcrlf(conn);
 }
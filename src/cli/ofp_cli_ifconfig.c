@@ -12,6 +12,7 @@
 #include "ofpi_log.h"
 #include "ofpi_cli.h"
 #include "ofpi_portconf.h"
+#include "ofpi_steer.h"
 #include "ofpi_util.h"
 
 
@@ -27,6 +28,16 @@ void f_ifconfig_show(struct cli_conn *conn, const char *s)
 	sendcrlf(conn);
 }
 
+/* "ifconfig steer" */
+void f_ifconfig_steer(struct cli_conn *conn, const char *s)
+{
+	(void)s;
+
+	ofp_steer_print(conn->fd);
+
+	sendcrlf(conn);
+}
+
 /* "ifconfig help" */
 /* "help ifconfig" */
 void f_help_ifconfig(struct cli_conn *conn, const char *s)
@@ -36,6 +47,9 @@ void f_help_ifconfig(struct cli_conn *conn, const char *s)
 	ofp_sendf(conn->fd, "Show interfaces:\r\n"
 		"  ifconfig [show]\r\n\r\n");
 
+	ofp_sendf(conn->fd, "Show traffic steering rules:\r\n"
+		"  ifconfig steer\r\n\r\n");
+
 	ofp_sendf(conn->fd, "Create or configure an interface:\r\n"
 		"  ifconfig [-A inet4] DEV IP4NET [vrf VRF]\r\n"
 		"    DEV: ethernet, vlan or loopback interface name.\r\n"
@@ -886,7 +886,9 @@ static void show_sa(struct cli_conn *conn, ofp_ipsec_sa_handle sa)
 		  "   mode:       %s\r\n"
 		  "   cipher:     %s\r\n"
 		  "   auth-alg:   %s\r\n"
-		  "   window size %"PRIu32"\r\n",
+		  "   window size %"PRIu32"\r\n"
+		  "   packets:    %"PRIu64"\r\n"
+		  "   bytes:      %"PRIu64"\r\n",
 		  value_str_from_num("sa-status", info.status),
 		  info.param.vrf,
 		  info.param.spi,
@@ -895,7 +897,9 @@ static void show_sa(struct cli_conn *conn, ofp_ipsec_sa_handle sa)
 		  value_str_from_num("mode",     info.param.mode),
 		  value_str_from_num("cipher",   info.param.crypto.cipher_alg),
 		  value_str_from_num("auth-alg", info.param.crypto.auth_alg),
-		  info.param.antireplay_ws);
+		  info.param.antireplay_ws,
+		  info.packets,
+		  info.bytes);
 
 	if (info.param.mode == OFP_IPSEC_MODE_TUNNEL) {
 		ofp_ipsec_tunnel_param_t *tun = &info.param.tunnel;
@@ -34,6 +34,25 @@ void f_netstat_udp(struct cli_conn *conn, const char *s)
 	sendcrlf(conn);
 }
 
+/* "netstat -H" */
+void f_netstat_hash(struct cli_conn *conn, const char *s)
+{
+	(void)s;
+
+	ofp_tcp_hashprint(conn->fd);
+	ofp_udp_hashprint(conn->fd);
+
+	sendcrlf(conn);
+}
+
+/* "netstat -r NUMBER" */
+void f_netstat_rexmit(struct cli_conn *conn, const char *s)
+{
+	ofp_tcp_netstat_rexmit(conn->fd, strtol(s, NULL, 0));
+
+	sendcrlf(conn);
+}
+
 /* "help netstat" */
 void f_help_netstat(struct cli_conn *conn, const char *s)
 {
@@ -50,6 +69,15 @@ void f_help_netstat(struct cli_conn *conn, const char *s)
 		"Show UDP open ports:\r\n"
 		"  netstat -u\r\n\r\n");
 
+	ofp_sendf(conn->fd,
+		"Show PCB hash chain lengths:\r\n"
+		"  netstat -H\r\n\r\n");
+
+	ofp_sendf(conn->fd,
+		"Show the N TCP connections with the highest share of bytes\r\n"
+		"retransmitted, at most 64:\r\n"
+		"  netstat -r N\r\n\r\n");
+
 	ofp_sendf(conn->fd,
 		"Show (this) help:\r\n"
 		"  netstat help\r\n\r\n");
@@ -8,14 +8,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
 
 #include "ofpi_log.h"
 #include "ofpi_cli.h"
 #include "ofpi_avl.h"
+#include "ofpi_btree.h"
+#include "ofpi_init.h"
+#include "ofpi_lockstat.h"
+#include "ofpi_mem_pressure.h"
 #include "ofpi_rt_lookup.h"
+#include "ofpi_sflow.h"
 #include "ofpi_stat.h"
+#include "ofpi_uma.h"
 #include "ofpi_util.h"
 
+/* Refreshes of 'stat top' without a count, and at most */
+#define STAT_TOP_DEFAULT 10
+#define STAT_TOP_MAX 3600
+#define STAT_TOP_TALKERS 10
+
 static void print_latency_entry(struct cli_conn *conn,
 	struct ofp_packet_stat *st, int thread, int entry)
 {
@@ -43,11 +56,14 @@ static void print_thread_stat(struct cli_conn *conn,
 	int next_thr;
 
 	ofp_sendf(conn->fd, " Thread        ODP_to_FP        FP_to_ODP"
-		"     FP_to_SP    SP_to_ODP      Tx_frag   Rx_IP_frag"
-		"   Rx_IP_reas\r\n\r\n");
+		"     FP_to_SP    SP_to_ODP      Tx_frag   Tx_TCP_gso   Tx_UDP_gso"
+		"   Rx_IP_frag"
+		"   Rx_IP_reas   Rx_TCP_gro   Rx_UDP_gro     Tx_paced     Tx_retry"
+		"     ARP_busy\r\n\r\n");
 	next_thr = odp_thrmask_first(&thrmask);
 	while (next_thr >= 0) {
 		ofp_sendf(conn->fd, "%7u %16llu %16llu %12llu %12llu"
+			" %12llu %12llu %12llu %12llu %12llu %12llu %12llu"
 			" %12llu %12llu %12llu\r\n",
 			next_thr,
 			st->per_thr[next_thr].rx_fp,
@@ -55,13 +71,266 @@ static void print_thread_stat(struct cli_conn *conn,
 			st->per_thr[next_thr].rx_sp,
 			st->per_thr[next_thr].tx_sp,
 			st->per_thr[next_thr].tx_eth_frag,
+			st->per_thr[next_thr].tx_tcp_gso,
+			st->per_thr[next_thr].tx_udp_gso,
 			st->per_thr[next_thr].rx_ip_frag,
-			st->per_thr[next_thr].rx_ip_reass);
+			st->per_thr[next_thr].rx_ip_reass,
+			st->per_thr[next_thr].rx_tcp_gro,
+			st->per_thr[next_thr].rx_udp_gro,
+			st->per_thr[next_thr].tx_paced,
+			st->per_thr[next_thr].tx_retry,
+			st->per_thr[next_thr].arp_fill_busy);
+		next_thr = odp_thrmask_next(&thrmask, next_thr);
+	}
+	ofp_sendf(conn->fd, "\r\n");
+}
+
+static void print_idle_stat(struct cli_conn *conn,
+	struct ofp_packet_stat *st, odp_thrmask_t thrmask)
+{
+	uint64_t idle, busy;
+	int next_thr;
+
+	ofp_sendf(conn->fd, " Thread      Busy_cycles      Idle_cycles  Busy%%"
+		"\r\n\r\n");
+	next_thr = odp_thrmask_first(&thrmask);
+	while (next_thr >= 0) {
+		idle = st->per_thr[next_thr].idle_cycles;
+		busy = st->per_thr[next_thr].busy_cycles;
+		if (idle + busy)
+			ofp_sendf(conn->fd, "%7u %16llu %16llu %6.1f\r\n",
+				  next_thr, busy, idle,
+				  100.0 * busy / (idle + busy));
+		next_thr = odp_thrmask_next(&thrmask, next_thr);
+	}
+	ofp_sendf(conn->fd, "\r\n");
+}
+
+static void print_drop_stat(struct cli_conn *conn)
+{
+	uint64_t drop[OFP_DROP_REASON_MAX];
+	int r;
+
+	ofp_get_drop_statistics(drop);
+
+	ofp_sendf(conn->fd, "Dropped packets:\r\n\r\n");
+	for (r = 0; r < OFP_DROP_REASON_MAX; r++)
+		if (drop[r])
+			ofp_sendf(conn->fd, " %-24s %16llu\r\n",
+				  ofp_drop_reason_str(r), drop[r]);
+	ofp_sendf(conn->fd, "\r\n");
+}
+
+/* Upper bound in cycles of the histogram slot holding percentile pct */
+static uint64_t prof_percentile(const uint64_t *hist, uint64_t count, int pct)
+{
+	uint64_t sum = 0, target = (count * pct + 99) / 100;
+	int i;
+
+	for (i = 0; i < OFP_PROF_SLICES; i++) {
+		sum += hist[i];
+		if (sum >= target)
+			break;
+	}
+	return 2ULL << (i < OFP_PROF_SLICES ? i : OFP_PROF_SLICES - 1);
+}
+
+static void print_prof_stat(struct cli_conn *conn,
+	struct ofp_packet_stat *st, odp_thrmask_t thrmask)
+{
+	int next_thr, i;
+
+	ofp_sendf(conn->fd, "Stage profile of worker threads, cycles per"
+		  " packet:\r\n\r\n"
+		  " Thread Stage                         Count"
+		  "      Avg     <P50     <P99\r\n\r\n");
+	next_thr = odp_thrmask_first(&thrmask);
+	while (next_thr >= 0) {
+		for (i = 0; i < OFP_PROF_STAGE_MAX; i++) {
+			uint64_t cnt = st->per_thr[next_thr].prof_count[i];
+			const uint64_t *hist =
+				st->per_thr[next_thr].prof_hist[i];
+
+			if (!cnt)
+				continue;
+			ofp_sendf(conn->fd, "%7u %-18s %16llu %8llu %8llu"
+				  " %8llu\r\n", next_thr,
+				  ofp_prof_stage_str(i), cnt,
+				  st->per_thr[next_thr].prof_cycles[i] / cnt,
+				  prof_percentile(hist, cnt, 50),
+				  prof_percentile(hist, cnt, 99));
+		}
 		next_thr = odp_thrmask_next(&thrmask, next_thr);
 	}
 	ofp_sendf(conn->fd, "\r\n");
 }
 
+/*
+ * 'stat top' takes its rates from the differences of two snapshots of
+ * the per thread counters. The counters are only read, like the
+ * telemetry update does, so the workers are not disturbed.
+ */
+struct top_snap {
+	uint64_t rx;
+	uint64_t tx;
+	uint64_t busy;
+	uint64_t idle;
+	uint64_t drop[OFP_DROP_REASON_MAX];
+};
+
+#define TOP_READ(_v) __atomic_load_n(&(_v), __ATOMIC_RELAXED)
+
+static void top_snapshot(struct ofp_packet_stat *st, struct top_snap *snap)
+{
+	uint32_t thr;
+	int r;
+
+	for (thr = 0; thr < st->num_thr; thr++) {
+		snap[thr].rx = TOP_READ(st->per_thr[thr].rx_fp);
+		snap[thr].tx = TOP_READ(st->per_thr[thr].tx_fp);
+		snap[thr].busy = TOP_READ(st->per_thr[thr].busy_cycles);
+		snap[thr].idle = TOP_READ(st->per_thr[thr].idle_cycles);
+		for (r = 0; r < OFP_DROP_REASON_MAX; r++)
+			snap[thr].drop[r] = TOP_READ(st->per_thr[thr].drop[r]);
+	}
+}
+
+static void top_print_pool(struct cli_conn *conn, const char *name,
+			   odp_pool_t pool, uint32_t capacity)
+{
+	uint64_t in_use;
+
+	if (!capacity || ofp_pkt_pool_in_use(pool, capacity, &in_use))
+		return;
+	ofp_sendf(conn->fd, " %-24s %3llu%% %10llu of %u\r\n", name,
+		  in_use * 100 / capacity, in_use, capacity);
+}
+
+static void top_print(struct cli_conn *conn, struct ofp_packet_stat *st,
+		      const struct top_snap *prev, const struct top_snap *cur,
+		      double sec)
+{
+	struct ofp_sflow_talker talker[STAT_TOP_TALKERS];
+	uint64_t drop[OFP_DROP_REASON_MAX] = {0};
+	uint64_t busy, idle, window_ns, dropped;
+	odp_thrmask_t thrmask;
+	const char *zone = NULL;
+	int thr, r, n, i;
+
+	/* Home and clear screen */
+	ofp_sendf(conn->fd, "\033[H\033[2J");
+	ofp_sendf(conn->fd, "Worker threads, %.1f s, any key stops:\r\n\r\n"
+		  " Thread           Rx_pps           Tx_pps  Busy%%"
+		  "         Drop_pps\r\n\r\n", sec);
+
+	odp_thrmask_worker(&thrmask);
+	for (thr = odp_thrmask_first(&thrmask); thr >= 0;
+	     thr = odp_thrmask_next(&thrmask, thr)) {
+		if ((uint32_t)thr >= st->num_thr)
+			break;
+		busy = cur[thr].busy - prev[thr].busy;
+		idle = cur[thr].idle - prev[thr].idle;
+		dropped = 0;
+		for (r = 0; r < OFP_DROP_REASON_MAX; r++) {
+			drop[r] += cur[thr].drop[r] - prev[thr].drop[r];
+			dropped += cur[thr].drop[r] - prev[thr].drop[r];
+		}
+		ofp_sendf(conn->fd, "%7u %16.0f %16.0f %6.1f %16.0f\r\n", thr,
+			  (cur[thr].rx - prev[thr].rx) / sec,
+			  (cur[thr].tx - prev[thr].tx) / sec,
+			  busy + idle ? 100.0 * busy / (busy + idle) : 0.0,
+			  dropped / sec);
+	}
+
+	ofp_sendf(conn->fd, "\r\nDrops per second:\r\n\r\n");
+	for (r = 0; r < OFP_DROP_REASON_MAX; r++)
+		if (drop[r])
+			ofp_sendf(conn->fd, " %-24s %16.0f\r\n",
+				  ofp_drop_reason_str(r), drop[r] / sec);
+
+	ofp_sendf(conn->fd, "\r\nPool occupancy:\r\n\r\n");
+	top_print_pool(conn, SHM_PKT_POOL_NAME, ofp_packet_pool,
+		       global_param->pkt_pool.nb_pkts);
+	top_print_pool(conn, SHM_PKT_POOL_SMALL_NAME, ofp_packet_pool_small,
+		       global_param->pkt_pool.small_nb_pkts);
+	i = ofp_uma_usage_max(&zone);
+	if (zone)
+		ofp_sendf(conn->fd, " %-24s %3d%% (fullest uma zone)\r\n",
+			  zone, i);
+
+	n = ofp_sflow_top_talkers(talker, STAT_TOP_TALKERS, &window_ns);
+	if (n < 0)
+		return;
+	ofp_sendf(conn->fd, "\r\nTop IPv4 sources, estimated from sFlow"
+		  " samples:\r\n\r\n"
+		  " Address                     Pps             Mbps\r\n\r\n");
+	for (i = 0; i < n && window_ns; i++)
+		ofp_sendf(conn->fd, " %-15s %15.0f %16.2f\r\n",
+			  ofp_print_ip_addr(talker[i].addr),
+			  talker[i].pkts * 1e9 / window_ns,
+			  talker[i].bytes * 8e3 / window_ns);
+}
+
+/* Wait a second, return non-zero if input arrived meanwhile */
+static int top_wait(struct cli_conn *conn)
+{
+	struct timeval tv = { .tv_sec = 1, .tv_usec = 0 };
+	char buf[64];
+	fd_set fds;
+
+	FD_ZERO(&fds);
+	FD_SET(conn->fd, &fds);
+	if (select(conn->fd + 1, &fds, NULL, NULL, &tv) <= 0)
+		return 0;
+	/* Whatever was typed is consumed, it only stops the view */
+	if (read(conn->fd, buf, sizeof(buf)) < 0)
+		OFP_DBG("CLI read failed");
+	return 1;
+}
+
+void f_stat_top(struct cli_conn *conn, const char *s)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+	struct top_snap *snap, *prev, *cur, *tmp;
+	odp_time_t t0, t1;
+	long count = strtol(s, NULL, 0);
+	long i;
+
+	if (!st)
+		return;
+	if (count <= 0)
+		count = STAT_TOP_DEFAULT;
+	if (count > STAT_TOP_MAX)
+		count = STAT_TOP_MAX;
+
+	snap = malloc(2 * st->num_thr * sizeof(*snap));
+	if (!snap) {
+		ofp_sendf(conn->fd, "Out of memory\r\n");
+		sendcrlf(conn);
+		return;
+	}
+	prev = snap;
+	cur = snap + st->num_thr;
+
+	top_snapshot(st, prev);
+	t0 = odp_time_global();
+	for (i = 0; i < count; i++) {
+		if (top_wait(conn))
+			break;
+		top_snapshot(st, cur);
+		t1 = odp_time_global();
+		top_print(conn, st, prev, cur,
+			  odp_time_diff_ns(t1, t0) / 1e9);
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+		t0 = t1;
+	}
+
+	free(snap);
+	sendcrlf(conn);
+}
+
 void f_stat_show(struct cli_conn *conn, const char *s)
 {
 	struct ofp_packet_stat *st = ofp_get_packet_statistics();
@@ -77,9 +346,11 @@ void f_stat_show(struct cli_conn *conn, const char *s)
 
 	ofp_sendf(conn->fd, "Settings: \r\n"
 		"  compute latency - %s\r\n"
-		"  compute performance - %s\r\n\r\n",
+		"  compute performance - %s\r\n"
+		"  compute stage profile - %s\r\n\r\n",
 		ofp_stat_flags & OFP_STAT_COMPUTE_LATENCY ? "yes" : "no",
-		ofp_stat_flags & OFP_STAT_COMPUTE_PERF ? "yes" : "no");
+		ofp_stat_flags & OFP_STAT_COMPUTE_PERF ? "yes" : "no",
+		ofp_stat_flags & OFP_STAT_COMPUTE_PROFILE ? "yes" : "no");
 
 	odp_thrmask_control(&thrmask);
 	ofp_sendf(conn->fd, "Packet counters of control threads:\r\n\r\n");
@@ -88,11 +359,17 @@ void f_stat_show(struct cli_conn *conn, const char *s)
 	odp_thrmask_worker(&thrmask);
 	ofp_sendf(conn->fd, "Packet counters of worker threads:\r\n\r\n");
 	print_thread_stat(conn, st, thrmask);
+	ofp_sendf(conn->fd, "Polling load of worker threads:\r\n\r\n");
+	print_idle_stat(conn, st, thrmask);
+
+	print_drop_stat(conn);
 
 /*TODO: print interface related stats colected from ODP or linux IP stack*/
 
 	ofp_sendf(conn->fd, "Allocated memory:\r\n");
 	ofp_print_avl_stat(conn->fd);
+	ofp_print_btree_stat(conn->fd);
+	ofp_print_uma_stat(conn->fd);
 	ofp_print_rt_stat(conn->fd);
 
 	if (ofp_stat_flags & OFP_STAT_COMPUTE_LATENCY) {
@@ -123,6 +400,10 @@ void f_stat_show(struct cli_conn *conn, const char *s)
 			next_thr = odp_thrmask_next(&thrmask, next_thr);
 		}
 	}
+	if (ofp_stat_flags & OFP_STAT_COMPUTE_PROFILE) {
+		ofp_sendf(conn->fd, "\r\n");
+		print_prof_stat(conn, st, thrmask);
+	}
 	if (ofp_stat_flags & OFP_STAT_COMPUTE_PERF) {
 		struct ofp_perf_stat *ps = ofp_get_perf_statistics();
 
@@ -162,7 +443,34 @@ void f_stat_clear(struct cli_conn *conn, const char *s)
 
 	(void)s;
 
-	memset(st, 0, sizeof(struct ofp_packet_stat));
+	memset(st->per_thr, 0, st->num_thr * sizeof(st->per_thr[0]));
+
+	sendcrlf(conn);
+}
+
+void f_stat_memory(struct cli_conn *conn, const char *s)
+{
+	(void)s;
+
+	ofp_show_memory(conn->fd);
+
+	sendcrlf(conn);
+}
+
+void f_stat_locks(struct cli_conn *conn, const char *s)
+{
+	(void)s;
+
+	ofp_lockstat_print(conn->fd);
+
+	sendcrlf(conn);
+}
+
+void f_stat_locks_clear(struct cli_conn *conn, const char *s)
+{
+	(void)s;
+
+	ofp_lockstat_clear();
 
 	sendcrlf(conn);
 }
@@ -178,15 +486,31 @@ void f_help_stat(struct cli_conn *conn, const char *s)
 		"  stat set <bit mask of options>\r\n"
 		"    bit 0: compute packets latency\r\n"
 		"    bit 1: compute throughput (mpps)\r\n"
+		"    bit 2: compute cycles per packet path stage\r\n"
 		"  Example:\r\n"
 		"    stat set 0x1\r\n\r\n");
 
 	ofp_sendf(conn->fd, "Get performance statistics:\r\n"
 		"  stat perf\r\n\r\n");
 
+	ofp_sendf(conn->fd, "Show per thread rates, drops, pool occupancy "
+		"and top talkers once a second, 10 times or count times:\r\n"
+		"  stat top [<count>]\r\n\r\n");
+
 	ofp_sendf(conn->fd, "Clear statistics:\r\n"
 		"  stat clear\r\n\r\n");
 
+	ofp_sendf(conn->fd, "Show memory reserved and used per shared "
+		"memory block, uma zone, packet pool and vrf:\r\n"
+		"  stat memory\r\n\r\n");
+
+	ofp_sendf(conn->fd, "Show lock contention per call site and "
+		"thread, most wait cycles first:\r\n"
+		"  stat locks\r\n\r\n");
+
+	ofp_sendf(conn->fd, "Clear lock contention statistics:\r\n"
+		"  stat locks clear\r\n\r\n");
+
 	ofp_sendf(conn->fd, "Show (this) help:\r\n"
 		"  stat help\r\n\r\n");
 
@@ -0,0 +1,824 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_acl.h"
+#include "ofpi_rcu.h"
+#include "ofpi_hash.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_stat.h"
+#include "ofpi_ip.h"
+
+#include "api/ofp_ip.h"
+#include "api/ofp_in.h"
+
+#define SHM_NAME_ACL "OfpAclShMem"
+
+#define ACL_HASH_SEED 0x61636c73
+
+/* Key: source, destination, ports, VRF << 16 | protocol << 8 | DSCP */
+#define ACL_KEY_WORDS 4
+/* Different masks of the entries of an ACL */
+#define ACL_TUPLES_MAX 64
+/* Prefixes of a 16 bit range */
+#define ACL_PORT_PREFIXES 30
+/* Wait for the packets using the previous rules before a commit */
+#define ACL_COMMIT_WAIT_US 1000
+#define ACL_COMMIT_TRIES 1000
+
+#define NUM_RULES (global_param->acl.rules)
+#define NUM_ENTRIES (global_param->acl.entries ? global_param->acl.entries : \
+		     8 * global_param->acl.rules)
+/* Tables of a tuple are at most half full, below 4 slots per entry */
+#define NUM_SLOTS (4 * NUM_ENTRIES)
+
+#define SIZEOF_RULES (sizeof(struct acl_rule) * NUM_RULES)
+#define SIZEOF_MATCHES (sizeof(struct acl_match) * NUM_RULES)
+#define SIZEOF_SLOTS (sizeof(struct acl_slot) * NUM_SLOTS)
+#define SHM_SIZE_ACL (sizeof(struct ofp_acl_mem) + OFP_ACL_POINTS * \
+		      (SIZEOF_RULES + 2 * (SIZEOF_MATCHES + SIZEOF_SLOTS)))
+
+/* Rule states. Deleted rules are retired at commit and freed at the
+ * next commit, when the classifier that matched them is no longer
+ * read. */
+#define ACL_RULE_FREE 0
+#define ACL_RULE_USED 1
+#define ACL_RULE_DELETED 2
+#define ACL_RULE_RETIRED 3
+
+struct acl_rule {
+	struct ofp_acl_rule rule;
+	uint32_t state;
+	odp_atomic_u64_t packets;
+	odp_atomic_u64_t bytes;
+};
+
+/* Rule at a position of a classifier */
+struct acl_match {
+	uint32_t id;
+	uint32_t action;
+};
+
+struct acl_slot {
+	uint32_t key[ACL_KEY_WORDS];
+	/* Position + 1 of the rule, 0: empty */
+	uint32_t pos;
+};
+
+/* Hash table of the entries of one mask */
+struct acl_tuple {
+	uint32_t mask[ACL_KEY_WORDS];
+	/* Best position of the entries, tuples are in its order */
+	uint32_t min_pos;
+	uint32_t num;
+	uint32_t size_mask;
+	struct acl_slot *slot;
+};
+
+struct acl_bank {
+	int num_tuples;
+	uint32_t num_rules;
+	int retired;
+	uint64_t epoch;
+	struct acl_tuple tuple[ACL_TUPLES_MAX];
+	struct acl_match *match;
+	struct acl_slot *slot;
+};
+
+struct acl_point {
+	struct acl_rule *rule;
+	struct acl_bank bank[2];
+	odp_spinlock_t lock;
+};
+
+struct ofp_acl_mem {
+	/* Bank + 1 in use of each point, 0: none */
+	odp_atomic_u32_t active[OFP_ACL_POINTS];
+	/* Taken for reading by the threads not registered to RCU */
+	odp_rwlock_t swap_lock;
+	struct acl_point point[OFP_ACL_POINTS];
+};
+
+static __thread struct ofp_acl_mem *shm;
+
+__thread odp_atomic_u32_t *ofp_acl_active;
+
+static const char *acl_point_str[OFP_ACL_POINTS] = {"local", "fwd"};
+
+static inline uint32_t prefix_mask(int len)
+{
+	return len ? ~0u << (32 - len) : 0;
+}
+
+/* Masked key and mask of a rule entry with the given port prefixes */
+static void acl_entry(const struct ofp_acl_rule *r, uint32_t sport,
+		      int sport_len, uint32_t dport, int dport_len,
+		      uint32_t key[], uint32_t mask[])
+{
+	mask[0] = prefix_mask(r->src_len);
+	mask[1] = prefix_mask(r->dst_len);
+	mask[2] = prefix_mask(sport_len) | prefix_mask(dport_len) >> 16;
+	mask[3] = (r->vrf == OFP_ACL_VRF_ANY ? 0 : 0xffff0000) |
+		(r->proto ? 0xff00 : 0) |
+		(r->dscp == OFP_ACL_DSCP_ANY ? 0 : 0xff);
+
+	key[0] = odp_be_to_cpu_32(r->src) & mask[0];
+	key[1] = odp_be_to_cpu_32(r->dst) & mask[1];
+	key[2] = (sport << 16 | dport) & mask[2];
+	key[3] = ((uint32_t)(r->vrf & 0xffff) << 16 | r->proto << 8 |
+		  r->dscp) & mask[3];
+}
+
+/* Cover lo..hi with the fewest prefixes, returns their number */
+static int acl_port_prefixes(uint32_t lo, uint32_t hi, uint32_t val[],
+			     int len[])
+{
+	int k, n = 0;
+
+	while (lo <= hi) {
+		for (k = 0; k < 16 && !(lo & (1u << k)) &&
+			     lo + (2u << k) - 1 <= hi; k++)
+			;
+		val[n] = lo;
+		len[n++] = 16 - k;
+		lo += 1u << k;
+	}
+	return n;
+}
+
+static inline uint32_t acl_tuple_find(const struct acl_tuple *t,
+				      const uint32_t key[], uint32_t hash)
+{
+	const struct acl_slot *s;
+	uint32_t i = hash & t->size_mask;
+
+	for (;; i = (i + 1) & t->size_mask) {
+		s = &t->slot[i];
+		if (!s->pos)
+			return UINT32_MAX;
+		if (s->key[0] == key[0] && s->key[1] == key[1] &&
+		    s->key[2] == key[2] && s->key[3] == key[3])
+			return s->pos - 1;
+	}
+}
+
+static inline void acl_key_mask(uint32_t m[], const uint32_t key[],
+				const uint32_t mask[])
+{
+	m[0] = key[0] & mask[0];
+	m[1] = key[1] & mask[1];
+	m[2] = key[2] & mask[2];
+	m[3] = key[3] & mask[3];
+}
+
+/* Key of an IPv4 packet, returns the packet length */
+static inline uint32_t acl_packet_key(odp_packet_t pkt, uint16_t vrf,
+				      uint32_t key[])
+{
+	uint32_t len, hlen;
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, &len);
+	uint8_t *l4;
+
+	key[0] = odp_be_to_cpu_32(ip->ip_src.s_addr);
+	key[1] = odp_be_to_cpu_32(ip->ip_dst.s_addr);
+	key[2] = 0;
+	key[3] = (uint32_t)vrf << 16 | ip->ip_p << 8 | ip->ip_tos >> 2;
+
+	hlen = ip->ip_hl << 2;
+	if ((ip->ip_p == OFP_IPPROTO_TCP || ip->ip_p == OFP_IPPROTO_UDP ||
+	     ip->ip_p == OFP_IPPROTO_SCTP) && len >= hlen + 4 &&
+	    !(odp_be_to_cpu_16(ip->ip_off) & OFP_IP_OFFMASK)) {
+		l4 = (uint8_t *)ip + hlen;
+		key[2] = (uint32_t)l4[0] << 24 | l4[1] << 16 | l4[2] << 8 |
+			l4[3];
+	}
+
+	return odp_packet_len(pkt);
+}
+
+static uint32_t acl_lookup(const struct acl_bank *b, const uint32_t key[])
+{
+	const struct acl_tuple *t;
+	uint32_t m[ACL_KEY_WORDS];
+	uint32_t pos, best = UINT32_MAX;
+	int i;
+
+	for (i = 0; i < b->num_tuples; i++) {
+		t = &b->tuple[i];
+		if (t->min_pos >= best)
+			break;
+		acl_key_mask(m, key, t->mask);
+		pos = acl_tuple_find(t, m,
+				     ofp_hash_key(m, ACL_KEY_WORDS,
+						  ACL_HASH_SEED));
+		if (pos < best)
+			best = pos;
+	}
+	return best;
+}
+
+static inline const struct acl_bank *acl_read_begin(enum ofp_acl_point point)
+{
+	uint32_t active;
+
+	if (odp_unlikely(!ofp_rcu_thread_is_registered()))
+		odp_rwlock_read_lock(&shm->swap_lock);
+
+	active = odp_atomic_load_acq_u32(&ofp_acl_active[point]);
+	return active ? &shm->point[point].bank[active - 1] : NULL;
+}
+
+static inline void acl_read_end(void)
+{
+	if (odp_unlikely(!ofp_rcu_thread_is_registered()))
+		odp_rwlock_read_unlock(&shm->swap_lock);
+}
+
+static inline enum ofp_return_code acl_match(enum ofp_acl_point point,
+					     const struct acl_bank *b,
+					     uint32_t pos, uint32_t packets,
+					     uint64_t bytes)
+{
+	struct acl_rule *r = &shm->point[point].rule[b->match[pos].id];
+
+	odp_atomic_add_u64(&r->packets, packets);
+	odp_atomic_add_u64(&r->bytes, bytes);
+
+	if (b->match[pos].action == OFP_ACL_DENY) {
+		OFP_DROP_STAT_N(ACL_DENY, packets);
+		return OFP_PKT_DROP;
+	}
+	return OFP_PKT_CONTINUE;
+}
+
+enum ofp_return_code ofp_acl_apply(enum ofp_acl_point point,
+				   odp_packet_t pkt, uint16_t vrf)
+{
+	const struct acl_bank *b;
+	enum ofp_return_code res = OFP_PKT_CONTINUE;
+	uint32_t key[ACL_KEY_WORDS];
+	uint32_t len, pos;
+
+	b = acl_read_begin(point);
+	if (b) {
+		len = acl_packet_key(pkt, vrf, key);
+		pos = acl_lookup(b, key);
+		if (pos != UINT32_MAX)
+			res = acl_match(point, b, pos, 1, len);
+	}
+	acl_read_end();
+
+	return res;
+}
+
+/*
+ * Each tuple is looked up for the packets of the burst whose best
+ * match so far may still be beaten, with their hashes computed
+ * together. Counters are updated once per run of packets that match
+ * the same rule.
+ */
+void ofp_acl_apply_burst(enum ofp_acl_point point, odp_packet_t pkt[],
+			 const uint16_t vrf[], int num,
+			 enum ofp_return_code res[])
+{
+	const struct acl_bank *b;
+	const struct acl_tuple *t;
+	uint32_t key[num][ACL_KEY_WORDS], m[num][ACL_KEY_WORDS];
+	const uint32_t *mp[num];
+	uint32_t hash[num], best[num], len[num];
+	uint32_t pos;
+	uint64_t bytes;
+	int sel[num];
+	int i, j, k, n;
+
+	b = acl_read_begin(point);
+	if (!b) {
+		acl_read_end();
+		for (i = 0; i < num; i++)
+			res[i] = OFP_PKT_CONTINUE;
+		return;
+	}
+
+	for (i = 0; i < num; i++) {
+		len[i] = acl_packet_key(pkt[i], vrf[i], key[i]);
+		best[i] = UINT32_MAX;
+	}
+
+	for (j = 0; j < b->num_tuples; j++) {
+		t = &b->tuple[j];
+		for (i = 0, n = 0; i < num; i++) {
+			if (best[i] <= t->min_pos)
+				continue;
+			acl_key_mask(m[n], key[i], t->mask);
+			mp[n] = m[n];
+			sel[n++] = i;
+		}
+		/* Later tuples have no better entries either */
+		if (!n)
+			break;
+		ofp_hash_key_multi(mp, n, ACL_KEY_WORDS, ACL_HASH_SEED, hash);
+		for (k = 0; k < n; k++) {
+			pos = acl_tuple_find(t, m[k], hash[k]);
+			if (pos < best[sel[k]])
+				best[sel[k]] = pos;
+		}
+	}
+
+	for (i = 0; i < num; i = k) {
+		if (best[i] == UINT32_MAX) {
+			res[i] = OFP_PKT_CONTINUE;
+			k = i + 1;
+			continue;
+		}
+		bytes = len[i];
+		for (k = i + 1; k < num && best[k] == best[i]; k++)
+			bytes += len[k];
+		res[i] = acl_match(point, b, best[i], k - i, bytes);
+		for (j = i + 1; j < k; j++)
+			res[j] = res[i];
+	}
+
+	acl_read_end();
+}
+
+static int acl_rule_check(const struct ofp_acl_rule *r)
+{
+	if (r->src_len > 32 || r->dst_len > 32 ||
+	    r->sport_lo > r->sport_hi || r->dport_lo > r->dport_hi ||
+	    (r->dscp > 63 && r->dscp != OFP_ACL_DSCP_ANY) ||
+	    r->vrf < OFP_ACL_VRF_ANY || r->vrf >= global_param->num_vrf ||
+	    (r->action != OFP_ACL_PERMIT && r->action != OFP_ACL_DENY))
+		return -1;
+	return 0;
+}
+
+void ofp_acl_rule_init(struct ofp_acl_rule *rule)
+{
+	memset(rule, 0, sizeof(*rule));
+	rule->sport_hi = 0xffff;
+	rule->dport_hi = 0xffff;
+	rule->dscp = OFP_ACL_DSCP_ANY;
+	rule->vrf = OFP_ACL_VRF_ANY;
+	rule->action = OFP_ACL_PERMIT;
+}
+
+int ofp_acl_rule_add(enum ofp_acl_point point,
+		     const struct ofp_acl_rule *rule)
+{
+	struct acl_point *p;
+	struct acl_rule *r;
+	int i;
+
+	if (!shm || (unsigned int)point >= OFP_ACL_POINTS) {
+		OFP_ERR("ACLs not enabled or invalid point %d", point);
+		return -1;
+	}
+	if (acl_rule_check(rule)) {
+		OFP_ERR("Invalid ACL rule");
+		return -1;
+	}
+
+	p = &shm->point[point];
+	odp_spinlock_lock(&p->lock);
+	for (i = 0; i < NUM_RULES; i++) {
+		r = &p->rule[i];
+		if (r->state != ACL_RULE_FREE)
+			continue;
+		r->rule = *rule;
+		odp_atomic_store_u64(&r->packets, 0);
+		odp_atomic_store_u64(&r->bytes, 0);
+		r->state = ACL_RULE_USED;
+		odp_spinlock_unlock(&p->lock);
+		return i;
+	}
+	odp_spinlock_unlock(&p->lock);
+
+	OFP_ERR("ACL %s is full", acl_point_str[point]);
+	return -1;
+}
+
+int ofp_acl_rule_del(enum ofp_acl_point point, int id)
+{
+	struct acl_point *p;
+	int rc = -1;
+
+	if (!shm || (unsigned int)point >= OFP_ACL_POINTS ||
+	    id < 0 || id >= NUM_RULES)
+		return -1;
+
+	p = &shm->point[point];
+	odp_spinlock_lock(&p->lock);
+	if (p->rule[id].state == ACL_RULE_USED) {
+		p->rule[id].state = ACL_RULE_DELETED;
+		rc = 0;
+	}
+	odp_spinlock_unlock(&p->lock);
+
+	return rc;
+}
+
+int ofp_acl_rule_stats(enum ofp_acl_point point, int id,
+		       uint64_t *packets, uint64_t *bytes)
+{
+	struct acl_rule *r;
+
+	if (!shm || (unsigned int)point >= OFP_ACL_POINTS ||
+	    id < 0 || id >= NUM_RULES)
+		return -1;
+
+	r = &shm->point[point].rule[id];
+	if (r->state != ACL_RULE_USED && r->state != ACL_RULE_DELETED)
+		return -1;
+
+	if (packets)
+		*packets = odp_atomic_load_u64(&r->packets);
+	if (bytes)
+		*bytes = odp_atomic_load_u64(&r->bytes);
+	return 0;
+}
+
+struct acl_order {
+	uint32_t priority;
+	uint32_t id;
+};
+
+static int acl_order_cmp(const void *a, const void *b)
+{
+	const struct acl_order *x = a, *y = b;
+
+	if (x->priority != y->priority)
+		return x->priority < y->priority ? -1 : 1;
+	return x->id < y->id ? -1 : x->id > y->id;
+}
+
+static int acl_tuple_get(struct acl_bank *b, const uint32_t mask[],
+			 uint32_t pos)
+{
+	struct acl_tuple *t;
+	int i;
+
+	for (i = 0; i < b->num_tuples; i++)
+		if (!memcmp(b->tuple[i].mask, mask, sizeof(b->tuple[i].mask)))
+			return i;
+
+	if (b->num_tuples == ACL_TUPLES_MAX)
+		return -1;
+
+	t = &b->tuple[b->num_tuples];
+	memcpy(t->mask, mask, sizeof(t->mask));
+	t->min_pos = pos;
+	t->num = 0;
+	return b->num_tuples++;
+}
+
+static void acl_tuple_insert(struct acl_tuple *t, const uint32_t key[],
+			     uint32_t pos)
+{
+	struct acl_slot *s;
+	uint32_t i = ofp_hash_key(key, ACL_KEY_WORDS, ACL_HASH_SEED) &
+		t->size_mask;
+
+	for (;; i = (i + 1) & t->size_mask) {
+		s = &t->slot[i];
+		if (!s->pos)
+			break;
+		/* The rule of the earlier position wins */
+		if (!memcmp(s->key, key, sizeof(s->key)))
+			return;
+	}
+	memcpy(s->key, key, sizeof(s->key));
+	s->pos = pos + 1;
+}
+
+/*
+ * Expand the rules in order into entries, first only counting them per
+ * tuple, then inserting them into the tables of the tuples.
+ */
+static int acl_compile(struct acl_point *p, struct acl_bank *b,
+		       const struct acl_order *order, uint32_t num)
+{
+	uint32_t sval[ACL_PORT_PREFIXES], dval[ACL_PORT_PREFIXES];
+	int slen[ACL_PORT_PREFIXES], dlen[ACL_PORT_PREFIXES];
+	uint32_t key[ACL_KEY_WORDS], mask[ACL_KEY_WORDS];
+	uint32_t pos, entries = 0, slots = 0, size;
+	int pass, ns, nd, i, j, t;
+	const struct ofp_acl_rule *r;
+
+	b->num_tuples = 0;
+	b->num_rules = num;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (pos = 0; pos < num; pos++) {
+			r = &p->rule[order[pos].id].rule;
+			ns = acl_port_prefixes(r->sport_lo, r->sport_hi,
+					       sval, slen);
+			nd = acl_port_prefixes(r->dport_lo, r->dport_hi,
+					       dval, dlen);
+			for (i = 0; i < ns; i++)
+				for (j = 0; j < nd; j++) {
+					acl_entry(r, sval[i], slen[i], dval[j],
+						  dlen[j], key, mask);
+					t = acl_tuple_get(b, mask, pos);
+					if (t < 0) {
+						OFP_ERR("More than %d masks in "
+							"an ACL",
+							ACL_TUPLES_MAX);
+						return -1;
+					}
+					if (pass)
+						acl_tuple_insert(&b->tuple[t],
+								 key, pos);
+					else
+						b->tuple[t].num++;
+				}
+			if (pass)
+				continue;
+			b->match[pos].id = order[pos].id;
+			b->match[pos].action = r->action;
+			entries += ns * nd;
+			if (entries > (uint32_t)NUM_ENTRIES) {
+				OFP_ERR("More than %d entries in an ACL",
+					NUM_ENTRIES);
+				return -1;
+			}
+		}
+
+		if (pass)
+			break;
+
+		for (t = 0; t < b->num_tuples; t++) {
+			for (size = 2; size < 2 * b->tuple[t].num; size <<= 1)
+				;
+			b->tuple[t].slot = &b->slot[slots];
+			b->tuple[t].size_mask = size - 1;
+			slots += size;
+		}
+		memset(b->slot, 0, slots * sizeof(*b->slot));
+	}
+
+	return 0;
+}
+
+/* Wait until the packets that used a classifier are processed */
+static int acl_bank_wait(struct acl_bank *b)
+{
+	int i;
+
+	if (!b->retired)
+		return 0;
+
+	for (i = 0; i < ACL_COMMIT_TRIES; i++) {
+		if (ofp_rcu_is_safe(b->epoch)) {
+			b->retired = 0;
+			return 0;
+		}
+		usleep(ACL_COMMIT_WAIT_US);
+	}
+	return -1;
+}
+
+int ofp_acl_commit(enum ofp_acl_point point)
+{
+	struct acl_point *p;
+	struct acl_bank *b;
+	struct acl_order *order;
+	uint32_t active, num = 0;
+	int i, next;
+
+	if (!shm || (unsigned int)point >= OFP_ACL_POINTS)
+		return -1;
+
+	order = malloc(sizeof(*order) * NUM_RULES);
+	if (!order) {
+		OFP_ERR("malloc failed");
+		return -1;
+	}
+
+	p = &shm->point[point];
+	odp_spinlock_lock(&p->lock);
+
+	active = odp_atomic_load_u32(&shm->active[point]);
+	next = active == 1 ? 1 : 0;
+	b = &p->bank[next];
+
+	if (acl_bank_wait(b)) {
+		odp_spinlock_unlock(&p->lock);
+		free(order);
+		OFP_ERR("ACL %s: previous rules still in use",
+			acl_point_str[point]);
+		return -1;
+	}
+
+	/* Rules deleted before the previous commit are not matched */
+	for (i = 0; i < NUM_RULES; i++) {
+		if (p->rule[i].state == ACL_RULE_RETIRED)
+			p->rule[i].state = ACL_RULE_FREE;
+		else if (p->rule[i].state == ACL_RULE_USED) {
+			order[num].priority = p->rule[i].rule.priority;
+			order[num++].id = i;
+		}
+	}
+	qsort(order, num, sizeof(*order), acl_order_cmp);
+
+	if (acl_compile(p, b, order, num)) {
+		odp_spinlock_unlock(&p->lock);
+		free(order);
+		return -1;
+	}
+	free(order);
+
+	odp_rwlock_write_lock(&shm->swap_lock);
+	odp_atomic_store_rel_u32(&shm->active[point], num ? next + 1 : 0);
+	odp_rwlock_write_unlock(&shm->swap_lock);
+	ofp_ip4_feat_update(0);
+
+	if (active) {
+		p->bank[active - 1].epoch = ofp_rcu_epoch();
+		p->bank[active - 1].retired = 1;
+		ofp_rcu_advance();
+	}
+
+	for (i = 0; i < NUM_RULES; i++)
+		if (p->rule[i].state == ACL_RULE_DELETED)
+			p->rule[i].state = ACL_RULE_RETIRED;
+
+	odp_spinlock_unlock(&p->lock);
+
+	OFP_INFO("ACL %s: %u rules in %d tuples", acl_point_str[point], num,
+		 b->num_tuples);
+	return 0;
+}
+
+static const char *acl_port_str(char *buf, uint16_t lo, uint16_t hi)
+{
+	if (lo == 0 && hi == 0xffff)
+		return "any";
+	if (lo == hi)
+		sprintf(buf, "%u", lo);
+	else
+		sprintf(buf, "%u-%u", lo, hi);
+	return buf;
+}
+
+void ofp_acl_print(int fd)
+{
+	struct acl_point *p;
+	struct acl_rule *r;
+	char sport[16], dport[16];
+	int point, i;
+
+	if (!shm) {
+		ofp_sendf(fd, "ACLs not enabled\r\n");
+		return;
+	}
+
+	for (point = 0; point < OFP_ACL_POINTS; point++) {
+		p = &shm->point[point];
+		ofp_sendf(fd, "ACL %s:\r\n"
+			  " id  prio       source             destination"
+			  "        sport       dport       proto dscp vrf "
+			  "action  packets      bytes\r\n",
+			  acl_point_str[point]);
+		for (i = 0; i < NUM_RULES; i++) {
+			r = &p->rule[i];
+			if (r->state != ACL_RULE_USED &&
+			    r->state != ACL_RULE_DELETED)
+				continue;
+			ofp_sendf(fd, " %-3d %-10u %15s/%-2u",
+				  i, r->rule.priority,
+				  ofp_print_ip_addr(r->rule.src),
+				  r->rule.src_len);
+			ofp_sendf(fd, " %15s/%-2u %-11s %-11s %-5u",
+				  ofp_print_ip_addr(r->rule.dst),
+				  r->rule.dst_len,
+				  acl_port_str(sport, r->rule.sport_lo,
+					       r->rule.sport_hi),
+				  acl_port_str(dport, r->rule.dport_lo,
+					       r->rule.dport_hi),
+				  r->rule.proto);
+			if (r->rule.dscp == OFP_ACL_DSCP_ANY)
+				ofp_sendf(fd, " any ");
+			else
+				ofp_sendf(fd, " %-4u", r->rule.dscp);
+			if (r->rule.vrf == OFP_ACL_VRF_ANY)
+				ofp_sendf(fd, " any");
+			else
+				ofp_sendf(fd, " %-3d", r->rule.vrf);
+			ofp_sendf(fd, " %-7s %-12" PRIu64 " %" PRIu64 "%s\r\n",
+				  r->rule.action == OFP_ACL_DENY ?
+				  "deny" : "permit",
+				  odp_atomic_load_u64(&r->packets),
+				  odp_atomic_load_u64(&r->bytes),
+				  r->state == ACL_RULE_DELETED ?
+				  " (deleted)" : "");
+		}
+		ofp_sendf(fd, "\r\n");
+	}
+}
+
+static int ofp_acl_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_ACL, SHM_SIZE_ACL);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_acl_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_ACL) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	ofp_acl_active = NULL;
+	return rc;
+}
+
+int ofp_acl_lookup_shared_memory(void)
+{
+	if (NUM_RULES <= 0)
+		return 0;
+
+	shm = ofp_shared_memory_lookup(SHM_NAME_ACL);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	ofp_acl_active = shm->active;
+	return 0;
+}
+
+void ofp_acl_init_prepare(void)
+{
+	if (NUM_RULES > 0)
+		ofp_shared_memory_prealloc(SHM_NAME_ACL, SHM_SIZE_ACL);
+}
+
+int ofp_acl_init_global(void)
+{
+	struct acl_point *p;
+	char *mem;
+	int point, i;
+
+	if (NUM_RULES <= 0)
+		return 0;
+
+	HANDLE_ERROR(ofp_acl_alloc_shared_memory());
+
+	memset(shm, 0, SHM_SIZE_ACL);
+	odp_rwlock_init(&shm->swap_lock);
+
+	mem = (char *)shm + sizeof(*shm);
+	for (point = 0; point < OFP_ACL_POINTS; point++) {
+		p = &shm->point[point];
+		odp_atomic_init_u32(&shm->active[point], 0);
+		odp_spinlock_init(&p->lock);
+		p->rule = (struct acl_rule *)mem;
+		mem += SIZEOF_RULES;
+		for (i = 0; i < NUM_RULES; i++) {
+			odp_atomic_init_u64(&p->rule[i].packets, 0);
+			odp_atomic_init_u64(&p->rule[i].bytes, 0);
+		}
+		for (i = 0; i < 2; i++) {
+			p->bank[i].match = (struct acl_match *)mem;
+			mem += SIZEOF_MATCHES;
+			p->bank[i].slot = (struct acl_slot *)mem;
+			mem += SIZEOF_SLOTS;
+		}
+	}
+	ofp_acl_active = shm->active;
+
+	return 0;
+}
+
+int ofp_acl_term_global(void)
+{
+	int rc = 0;
+
+	if (NUM_RULES <= 0)
+		return 0;
+
+	if (ofp_acl_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_acl_free_shared_memory(), rc);
+
+	return rc;
+}
@@ -15,29 +15,36 @@
 
 #include "ofpi_config.h"
 #include "ofpi_portconf.h"
+#include "ofpi_route.h"
 #include "ofpi_timer.h"
 #include "ofpi_arp.h"
 #include "ofpi_hash.h"
+#include "ofpi_stat.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_lockstat.h"
+#include "ofpi_tracepoint.h"
 
 #define SHM_NAME_ARP "OfpArpShMem"
 #define SIZEOF_ENTRIES (sizeof(struct arp_entry) * NUM_ARPS)
 #define SIZEOF_SETS (sizeof(struct set_s) * NUM_SETS)
+#define SIZEOF_SEEN (sizeof(odp_atomic_u64_t) * SEEN_ROW_WORDS * \
+		     ODP_THREAD_COUNT_MAX)
 #define SHM_SIZE_ARP (sizeof(struct ofp_arp_mem) + \
-		      SIZEOF_ENTRIES + SIZEOF_SETS)
+		      SIZEOF_ENTRIES + SIZEOF_SETS + SIZEOF_SEEN)
 
 /* Default ARP age interval (in seconds). If set to 0, then age interval is half of OFP_ARP_ENTRY_TIMEOUT. */
 #define ARP_AGE_INTERVAL 0
-/* Timer interval for entry use time update. */
-#define ARP_ENTRY_UPD_TIMEOUT 2
-/* Maximum number of saved packets waiting for an ARP reply. */
-#define ARP_WAITING_PKTS_SIZE 2048
 
 #define NUM_SETS (1<<global_param->arp.hash_bits)
 /* Plus one because zeroth entry is used as the invalid entry. */
 #define NUM_ARPS (global_param->arp.entries + 1)
-#define ENTRY_UPD_TIMEOUT (ARP_ENTRY_UPD_TIMEOUT * US_PER_SEC)
+/* Seen bits of a thread, rounded up to a cache line */
+#define SEEN_WORDS_PER_LINE (ODP_CACHE_LINE_SIZE / sizeof(odp_atomic_u64_t))
+#define SEEN_ROW_WORDS \
+	((((NUM_ARPS + 63) / 64) + SEEN_WORDS_PER_LINE - 1) / \
+	 SEEN_WORDS_PER_LINE * SEEN_WORDS_PER_LINE)
 #define SAVED_PKT_TIMEOUT (global_param->arp.saved_pkt_timeout * US_PER_SEC)
 #define AGE_DIVISOR 2
 
@@ -50,10 +57,16 @@ struct arp_entry_tailq {
 	struct arp_entry **stqh_last;
 }; /* OFP_STAILQ_HEAD */
 
+/*
+ * Lookups do not take table_rwlock. Writers of the table, holding
+ * table_rwlock, make seq odd for the duration of the update, and
+ * lookups retry if seq was odd or changed.
+ */
 struct set_s {
 	struct arp_entry_tailq table;
 	struct arp_cache cache;
 	odp_rwlock_t table_rwlock;
+	odp_atomic_u32_t seq;
 } ODP_ALIGNED_CACHE;
 
 struct _arp {
@@ -61,24 +74,34 @@ struct _arp {
 	struct arp_entry_tailq free_entries;
 	odp_rwlock_t fr_ent_rwlock;
 	struct set_s *set;
+	/*
+	 * A bit per entry and thread, set when the thread looks up the
+	 * entry and collected by ofp_arp_age_cb().
+	 */
+	odp_atomic_u64_t *seen;
 };
 
-struct _pkt {
-	struct pkt_entry entries[ARP_WAITING_PKTS_SIZE] ODP_ALIGNED_CACHE;
-	struct pkt_list free_entries;
-	odp_rwlock_t fr_ent_rwlock;
+enum arp_slot_state {
+	ARP_SLOT_EMPTY = 0,
+	ARP_SLOT_BUSY,
+	ARP_SLOT_FULL
 };
 
 struct ofp_arp_mem {
 	struct _arp arp;
-	struct _pkt pkt;
 
 	odp_time_t entry_timeout;        /* ARP entry timeout */
 	unsigned int age_interval;       /* ageing interval (in seconds) */
 	odp_timer_t age_timer;
+	int age_word;                    /* next seen word of the pass */
+	int age_set;                     /* next set of the ageing pass */
+	odp_time_t age_now;              /* start time of the ageing pass */
+	odp_time_t age_next;             /* next pass, arp.control_aging */
+	int age_threads;                 /* rows of seen in use */
 };
 
 static __thread struct ofp_arp_mem *shm;
+static __thread odp_atomic_u64_t *seen_row;
 
 /*
  * Private functions
@@ -86,7 +109,7 @@ static __thread struct ofp_arp_mem *shm;
 
 static inline uint32_t ipv4_hash(struct arp_key *key)
 {
-	return ofp_hashword((const uint32_t *)key, sizeof(*key)/sizeof(uint32_t), 0) & (NUM_SETS - 1);
+	return ofp_hash_key((const uint32_t *)key, sizeof(*key)/sizeof(uint32_t), 0) & (NUM_SETS - 1);
 }
 
 static inline uint32_t set_key_and_hash(uint32_t vrf, uint32_t ipv4_addr,
@@ -101,36 +124,42 @@ static inline uint32_t set_key_and_hash(uint32_t vrf, uint32_t ipv4_addr,
 	return set;
 }
 
+static inline void set_write_begin(int set)
+{
+	odp_atomic_inc_u32(&shm->arp.set[set].seq);
+	odp_mb_release();
+}
+
+static inline void set_write_end(int set)
+{
+	odp_mb_release();
+	odp_atomic_inc_u32(&shm->arp.set[set].seq);
+}
+
 static int ofp_arp_entry_reset(struct arp_entry *entry)
 {
 	int rc;
 
 	rc = 0;
 
-	if (entry->pkt_tmo != ODP_TIMER_INVALID)
-		CHECK_ERROR(ofp_timer_cancel(entry->pkt_tmo), rc);
-
-	odp_rwlock_write_lock(&entry->usetime_rwlock);
-	if (entry->usetime_upd_tmo != ODP_TIMER_INVALID) {
-		CHECK_ERROR(ofp_timer_cancel(entry->usetime_upd_tmo), rc);
-		entry->usetime_upd_tmo = ODP_TIMER_INVALID;
-	}
-	odp_rwlock_write_unlock(&entry->usetime_rwlock);
-
-	entry->pkt_tmo = ODP_TIMER_INVALID;
+	ofp_timer_entry_stop(&entry->pkt_tmo);
 
 	memset(&entry->key, 0, sizeof(entry->key));
 	entry->macaddr = 0;
 	entry->ref_count = 0;
 	entry->flags.all = 0;
 
+	/* A timeout still running for the previous use is ignored */
+	entry->pending_gen++;
+	odp_atomic_store_u32(&entry->pending_armed, 0);
+
 	return rc;
 }
 static inline void *entry_alloc(void)
 {
 	struct arp_entry *entry = NULL;
 
-	odp_rwlock_write_lock(&shm->arp.fr_ent_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.fr_ent_rwlock);
 
 	entry = OFP_STAILQ_FIRST(&shm->arp.free_entries);
 
@@ -141,7 +170,6 @@ static inline void *entry_alloc(void)
 			odp_rwlock_write_unlock(&shm->arp.fr_ent_rwlock);
 			return NULL;
 		}
-		memset(&entry->pkt_list_head, 0, sizeof(entry->pkt_list_head));
 	}
 
 	odp_rwlock_write_unlock(&shm->arp.fr_ent_rwlock);
@@ -152,9 +180,7 @@ static inline void *entry_alloc(void)
 /*Assumption: entry to be reset in entry_alloc()*/
 static inline void entry_free(struct arp_entry *entry)
 {
-	entry->pkt_tmo = ODP_TIMER_INVALID;
-
-	odp_rwlock_write_lock(&shm->arp.fr_ent_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.fr_ent_rwlock);
 	/* Inserting freed entry to tail of the list so a freed entry */
 	/* is not reused soon, as other worker threads may have reference */
 	OFP_STAILQ_INSERT_TAIL(&shm->arp.free_entries, entry, next);
@@ -174,11 +200,101 @@ static inline struct arp_entry *arp_lookup(int set, struct arp_key *key)
 	return NULL;
 }
 
-static inline void *insert_new_entry(int set, struct arp_key *key)
+/*
+ * Lookup without the table lock. Entries are never unmapped, but an
+ * entry may move to another list while it is traversed, so the walk
+ * is bounded and retried if the set changed.
+ */
+static inline struct arp_entry *arp_lookup_lockless(int set,
+						    struct arp_key *key,
+						    odp_bool_t *pending)
+{
+	odp_atomic_u32_t *seq = &shm->arp.set[set].seq;
+	struct arp_entry *entry;
+	uint32_t s;
+	int n;
+
+	for (;;) {
+		s = odp_atomic_load_acq_u32(seq);
+		if (odp_unlikely(s & 1)) {
+			odp_cpu_pause();
+			continue;
+		}
+
+		entry = OFP_STAILQ_FIRST(&shm->arp.set[set].table);
+		for (n = 0; entry && n < NUM_ARPS; n++) {
+			if (entry->key.ipv4_addr == key->ipv4_addr &&
+			    entry->key.vrf == key->vrf)
+				break;
+			entry = OFP_STAILQ_NEXT(entry, next);
+		}
+		*pending = entry && odp_atomic_load_u32(&entry->pending_num);
+
+		odp_mb_acquire();
+		if (odp_likely(odp_atomic_load_u32(seq) == s))
+			return n < NUM_ARPS ? entry : NULL;
+	}
+}
+
+/* Mark the entry used by this thread */
+static inline void arp_entry_seen(uint32_t entry_idx)
+{
+	odp_atomic_u64_t *word;
+	uint64_t bit, old;
+
+	if (odp_unlikely(!seen_row))
+		return;
+
+	word = &seen_row[entry_idx / 64];
+	bit = 1ULL << (entry_idx % 64);
+	old = odp_atomic_load_u64(word);
+
+	/* Written once per entry and age interval */
+	while (!(old & bit) &&
+	       !odp_atomic_cas_u64(word, &old, old | bit))
+		;
+}
+
+/*
+ * Update use time of the entries seen by any thread since last call,
+ * from seen word first on for num words. Returns the next word.
+ */
+static uint32_t arp_collect_seen(uint32_t first, uint32_t num, odp_time_t now)
+{
+	odp_atomic_u64_t *word;
+	uint64_t bits;
+	uint32_t w, b;
+	int thr;
+
+	for (w = first; w < SEEN_ROW_WORDS && w - first < num; w++) {
+		bits = 0;
+		for (thr = 0; thr < shm->age_threads; thr++) {
+			word = &shm->arp.seen[thr * SEEN_ROW_WORDS + w];
+			/* Words nobody wrote stay shared in the caches */
+			if (odp_atomic_load_u64(word))
+				bits |= odp_atomic_xchg_u64(word, 0);
+		}
+
+		while (bits) {
+			b = __builtin_ctzll(bits);
+			bits &= bits - 1;
+			if (w * 64 + b < (uint32_t)NUM_ARPS)
+				shm->arp.entries[w * 64 + b].usetime = now;
+		}
+	}
+
+	return w;
+}
+
+/* Return the entry of key, created (if not NULL) tells if it is new */
+static inline void *insert_new_entry(int set, struct arp_key *key,
+				     odp_bool_t *created)
 {
 	struct arp_entry *new;
 
 	new = arp_lookup(set, key);
+	if (created)
+		*created = (new == NULL);
 
 	if (odp_likely(new == NULL)) {
 		new = entry_alloc();
@@ -186,11 +302,12 @@ static inline void *insert_new_entry(int set, struct arp_key *key)
 		if (odp_unlikely(new == NULL))
 			return NULL;
 
+		set_write_begin(set);
 		new->key.ipv4_addr = key->ipv4_addr;
 		new->key.vrf = key->vrf;
-		new->usetime_upd_tmo = ODP_TIMER_INVALID;
 		new->flags.is_used = 1;
 		OFP_STAILQ_INSERT_HEAD(&shm->arp.set[set].table, new, next);
+		set_write_end(set);
 	}
 
 	return new;
@@ -200,7 +317,6 @@ static inline int remove_entry(int set, struct arp_entry *entry)
 {
 	struct arp_cache *cache;
 	struct arp_entry *cache_entry;
-	int rc = 0;
 
 	/* remove from set's cache */
 	cache = &shm->arp.set[set].cache;
@@ -210,27 +326,33 @@ static inline int remove_entry(int set, struct arp_entry *entry)
 	if (ARP_IS_CACHE_HIT(cache_entry, &entry->key))
 		ARP_DEL_CACHE(cache);
 
+	set_write_begin(set);
+
 	/* remove from set */
 	OFP_STAILQ_REMOVE(&shm->arp.set[set].table, entry, arp_entry, next);
 
-	/* kill update timer*/
-	odp_rwlock_write_lock(&entry->usetime_rwlock);
-
-	if (entry->usetime_upd_tmo != ODP_TIMER_INVALID) {
-		CHECK_ERROR(ofp_timer_cancel(entry->usetime_upd_tmo), rc);
-		entry->usetime_upd_tmo = ODP_TIMER_INVALID;
-	}
 	entry->flags.all = 0;
 
-	odp_rwlock_write_unlock(&entry->usetime_rwlock);
-
 	/* free */
 	entry_free(entry);
-	return rc;
+
+	set_write_end(set);
+
+	ofp_flow_cache_flush();
+	return 0;
 }
 
+/* What is shown of an entry, copied under the lock of its set */
+struct arp_show {
+	struct arp_key key;
+	odp_time_t usetime;
+	union arp_entry_flags flags;
+	uint64_t macaddr;
+};
+
 #define APR_FLAGS_SIZE_MAX 3
-static inline void show_arp_entry(int fd, struct arp_entry *entry)
+static inline void show_arp_entry(struct ofp_sendbuf *sb,
+				  struct arp_show *entry, odp_time_t now)
 {
 	char flags[APR_FLAGS_SIZE_MAX];
 	uint8_t flags_idx = 0;
@@ -243,10 +365,9 @@ static inline void show_arp_entry(int fd, struct arp_entry *entry)
 
 	/* Age */
 	if (entry->flags.is_complete && !entry->flags.is_manual) {
-		odp_time_t t, time_diff;
+		odp_time_t time_diff;
 
-		t = odp_time_global();
-		time_diff = odp_time_diff(t, entry->usetime);
+		time_diff = odp_time_diff(now, entry->usetime);
 
 		age = odp_time_to_ns(time_diff) / ODP_TIME_SEC_IN_NS;
 	}
@@ -259,60 +380,141 @@ static inline void show_arp_entry(int fd, struct arp_entry *entry)
 	}
 	flags[flags_idx] = 0;
 
-	ofp_sendf(fd, "%3d  %-15s %-17s %4u    %s\r\n",
-		  entry->key.vrf,
-		  ofp_print_ip_addr(entry->key.ipv4_addr),
-		  mac_addr,
-		  age,
-		  flags);
+	ofp_sendbuf_printf(sb, "%3d  %-15s %-17s %4u    %s\r\n",
+			   entry->key.vrf,
+			   ofp_print_ip_addr(entry->key.ipv4_addr),
+			   mac_addr,
+			   (unsigned int)age,
+			   flags);
 }
 
-static inline void *pkt_entry_alloc(void)
+/*
+ * Queue a packet waiting for the reply. Called without the table lock,
+ * the slot is claimed by its state. If the queue is full the oldest
+ * packet is dropped.
+ */
+static enum ofp_return_code arp_pending_push(struct arp_entry *entry,
+					     odp_packet_t pkt,
+					     struct ofp_nh_entry *nh)
 {
-	struct pkt_entry *pktentry;
-
-	odp_rwlock_write_lock(&shm->pkt.fr_ent_rwlock);
+	struct arp_pending_slot *slot;
+	uint32_t old = ARP_SLOT_EMPTY;
+	uint32_t pos;
+
+	pos = odp_atomic_fetch_inc_u32(&entry->pending_tail);
+	slot = &entry->pending[pos & (ARP_ENTRY_PENDING - 1)];
+
+	if (!odp_atomic_cas_acq_u32(&slot->state, &old, ARP_SLOT_BUSY)) {
+		/* Busy: being queued or sent by another thread */
+		if (old != ARP_SLOT_FULL ||
+		    !odp_atomic_cas_acq_u32(&slot->state, &old,
+					    ARP_SLOT_BUSY)) {
+			OFP_DROP_STAT(ARP_PENDING_FULL);
+			return OFP_PKT_DROP;
+		}
+		odp_packet_free(slot->pkt);
+		odp_atomic_dec_u32(&entry->pending_num);
+		OFP_DROP_STAT(ARP_PENDING_FULL);
+	}
 
-	pktentry = OFP_SLIST_FIRST(&shm->pkt.free_entries);
+	slot->pkt = pkt;
+	slot->nh = nh;
+	odp_atomic_inc_u32(&entry->pending_num);
+	odp_atomic_store_rel_u32(&slot->state, ARP_SLOT_FULL);
 
-	if (pktentry)
-		OFP_SLIST_REMOVE_HEAD(&shm->pkt.free_entries, next);
+	return OFP_PKT_PROCESSED;
+}
 
-	odp_rwlock_write_unlock(&shm->pkt.fr_ent_rwlock);
+/* Take the waiting packets, oldest first. Returns the number taken. */
+static int arp_pending_take(struct arp_entry *entry, odp_packet_t pkt[],
+			    struct ofp_nh_entry *nh[])
+{
+	struct arp_pending_slot *slot;
+	uint32_t old, pos;
+	int i, num = 0;
+
+	if (!odp_atomic_load_u32(&entry->pending_num))
+		return 0;
+
+	pos = odp_atomic_load_u32(&entry->pending_tail);
+	for (i = 0; i < ARP_ENTRY_PENDING; i++) {
+		slot = &entry->pending[(pos + i) & (ARP_ENTRY_PENDING - 1)];
+		old = ARP_SLOT_FULL;
+		if (!odp_atomic_cas_acq_u32(&slot->state, &old, ARP_SLOT_BUSY))
+			continue;
+		pkt[num] = slot->pkt;
+		nh[num++] = slot->nh;
+		odp_atomic_dec_u32(&entry->pending_num);
+		odp_atomic_store_rel_u32(&slot->state, ARP_SLOT_EMPTY);
+	}
+	return num;
+}
 
-	return pktentry;
+static void arp_pending_drop(struct arp_entry *entry)
+{
+	odp_packet_t pkt[ARP_ENTRY_PENDING];
+	struct ofp_nh_entry *nh[ARP_ENTRY_PENDING];
+	int i, num;
+
+	num = arp_pending_take(entry, pkt, nh);
+	for (i = 0; i < num; i++) {
+		OFP_DROP_STAT(ARP_UNRESOLVED);
+		odp_packet_free(pkt[i]);
+	}
 }
 
-static inline void pkt_entry_free(struct pkt_entry *pktentry)
+/*
+ * Send the waiting packets of a complete entry as one burst. Called
+ * without the table lock.
+ */
+static void arp_pending_send(struct arp_entry *entry)
 {
-	memset(pktentry, 0, sizeof(*pktentry));
+	odp_packet_t pkt[ARP_ENTRY_PENDING];
+	struct ofp_nh_entry *nh[ARP_ENTRY_PENDING];
+	int i, num;
 
-	odp_rwlock_write_lock(&shm->pkt.fr_ent_rwlock);
-	OFP_SLIST_INSERT_HEAD(&shm->pkt.free_entries, pktentry, next);
-	odp_rwlock_write_unlock(&shm->pkt.fr_ent_rwlock);
+	num = arp_pending_take(entry, pkt, nh);
+	if (!num)
+		return;
+
+	for (i = 0; i < num; i++) {
+		OFP_DBG("Sending saved packet %" PRIX64 " to %s",
+			odp_packet_to_u64(pkt[i]),
+			ofp_print_ip_addr(entry->key.ipv4_addr));
+
+		if (ofp_ip_output_common(pkt[i], nh[i], 0,
+					 OFP_IPSEC_SA_INVALID) == OFP_PKT_DROP)
+			odp_packet_free(pkt[i]);
+	}
+	ofp_send_pending_pkt();
 }
 
 int ofp_arp_ipv4_insert_entry(uint32_t ipv4_addr, unsigned char *ll_addr,
 			      uint16_t vrf, odp_bool_t is_complete,
 			      odp_bool_t is_manual,
-			      uint32_t *entry_idx_out, struct pkt_list *send_list)
+			      uint32_t *entry_idx_out, odp_bool_t send_pending)
 {
 	struct arp_entry *new;
 	struct arp_key key;
 	uint32_t set;
-	odp_time_t tnow;
+	odp_bool_t changed;
 
 	set = set_key_and_hash(vrf, ipv4_addr, &key);
 
-	odp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
 
-	new = insert_new_entry(set, &key);
+	new = insert_new_entry(set, &key, &changed);
 
 	if (odp_unlikely(new == NULL)) {
 		odp_rwlock_write_unlock(&shm->arp.set[set].table_rwlock);
 		return -1;
 	}
 
+	/* Cached outputs of the entry are stale only if it changes */
+	if (memcmp(&new->macaddr, ll_addr, OFP_ETHER_ADDR_LEN) ||
+	    (is_complete && !new->flags.is_complete))
+		changed = TRUE;
+
 	memcpy(&new->macaddr, ll_addr, OFP_ETHER_ADDR_LEN);
 
 	if (is_complete) {
@@ -322,20 +524,8 @@ int ofp_arp_ipv4_insert_entry(uint32_t ipv4_addr, unsigned char *ll_addr,
 			new->flags.is_manual = 1;
 	}
 
-	if (new->flags.is_complete && send_list != NULL) {
-
-		tnow = odp_time_global();
-		new->usetime = tnow;
-
-		OFP_SLIST_INIT(send_list);
-
-		OFP_SLIST_SWAP(send_list, &new->pkt_list_head, pkt_entry);
-
-		if (OFP_SLIST_FIRST(send_list)) {
-			ofp_timer_cancel(new->pkt_tmo);
-			new->pkt_tmo = ODP_TIMER_INVALID;
-		}
-	}
+	if (new->flags.is_complete && send_pending)
+		new->usetime = odp_time_global();
 
 	*entry_idx_out = ARP_GET_IDX(new);
 
@@ -344,6 +534,17 @@ int ofp_arp_ipv4_insert_entry(uint32_t ipv4_addr, unsigned char *ll_addr,
 
 	odp_rwlock_write_unlock(&shm->arp.set[set].table_rwlock);
 
+	if (changed)
+		ofp_flow_cache_flush();
+
+	/*
+	 * The entry is not removed while referenced by a next hop or
+	 * while it has packets, the timeout of the packets takes the
+	 * table lock.
+	 */
+	if (new->flags.is_complete && send_pending)
+		arp_pending_send(new);
+
 	return 0;
 }
 
@@ -354,46 +555,16 @@ int ofp_arp_ipv4_insert_entry(uint32_t ipv4_addr, unsigned char *ll_addr,
 int ofp_arp_ipv4_insert(uint32_t ipv4_addr, unsigned char *ll_addr,
 			struct ofp_ifnet *dev, odp_bool_t is_manual)
 {
-	struct pkt_entry *pktentry;
-	struct pkt_list send_list;
 	uint32_t entry_idx;
-	int ret_val;
 
-	ret_val = ofp_arp_ipv4_insert_entry(ipv4_addr, ll_addr, dev->vrf,
-					    TRUE, is_manual, &entry_idx,
-					    &send_list);
-	if (ret_val < 0)
-		return ret_val;
-
-	/* Send queued packets */
-	pktentry = OFP_SLIST_FIRST(&send_list);
-	while (pktentry) {
-		OFP_DBG("Sending saved packet %" PRIX64 " to %s",
-			odp_packet_to_u64(pktentry->pkt),
-			ofp_print_ip_addr(ipv4_addr));
-
-		if (ofp_ip_output_common(pktentry->pkt, pktentry->nh, 0,
-			    OFP_IPSEC_SA_INVALID) == OFP_PKT_DROP)
-			odp_packet_free(pktentry->pkt);
-
-		OFP_SLIST_REMOVE_HEAD(&send_list, next);
-		pkt_entry_free(pktentry);
-
-		pktentry = OFP_SLIST_FIRST(&send_list);
-	}
-
-	return 0;
+	return ofp_arp_ipv4_insert_entry(ipv4_addr, ll_addr, dev->vrf,
+					 TRUE, is_manual, &entry_idx, TRUE);
 }
 
 void ofp_arp_ipv4_remove_entry(uint32_t set, struct arp_entry *entry)
 {
-	struct pkt_entry *pktentry;
-
 	if (entry->ref_count == 0 && entry->flags.is_used) {
-		while ((pktentry = OFP_SLIST_FIRST(&entry->pkt_list_head))) {
-			OFP_SLIST_REMOVE_HEAD(&entry->pkt_list_head, next);
-			pkt_entry_free(pktentry);
-		}
+		arp_pending_drop(entry);
 		remove_entry(set, entry);
 	} else {
 		OFP_DBG("Remove ARP entry bypassed as ref_count= %u > 0",
@@ -411,7 +582,7 @@ void ofp_arp_ipv4_remove_entry_idx(uint32_t entry_idx)
 
 	set = set_key_and_hash(entry->key.vrf, entry->key.ipv4_addr, &key);
 
-	odp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
 
 	ofp_arp_ipv4_remove_entry(set, entry);
 
@@ -426,7 +597,7 @@ int ofp_arp_inc_ref_count(uint32_t entry_idx)
 
 	set = set_key_and_hash(entry->key.vrf, entry->key.ipv4_addr, &key);
 
-	odp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
 
 	++entry->ref_count;
 
@@ -443,7 +614,7 @@ int ofp_arp_dec_ref_count(uint32_t entry_idx)
 
 	set = set_key_and_hash(entry->key.vrf, entry->key.ipv4_addr, &key);
 
-	odp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
 
 	--entry->ref_count;
 
@@ -463,20 +634,28 @@ odp_bool_t ofp_arp_entry_is_complete(uint32_t entry_idx)
 	return entry->flags.is_complete;
 }
 
-static void ofp_arp_entry_usetime_tmo(void *arg)
+/*
+ * Point the cache of set to the entry of key. The cache is written only
+ * under the write lock of the set, so that it is not left pointing to an
+ * entry remove_entry() just took out. Skipped if the set is busy, the
+ * lookup that follows fills it instead. The skipped fills are counted
+ * in arp_fill_busy of the packet statistics.
+ */
+static void arp_cache_fill(uint32_t set, struct arp_key *key)
 {
+	odp_rwlock_t *lock = &shm->arp.set[set].table_rwlock;
 	struct arp_entry *entry;
-	uint32_t entry_idx;
 
-	entry_idx = *(uint32_t *)arg;
-
-	entry = ARP_GET_ENTRY(entry_idx);
-
-	odp_rwlock_write_lock(&entry->usetime_rwlock);
+	if (!odp_rwlock_write_trylock(lock)) {
+		OFP_UPDATE_PACKET_STAT(arp_fill_busy, 1);
+		return;
+	}
 
-	entry->usetime_upd_tmo = ODP_TIMER_INVALID;
+	entry = arp_lookup(set, key);
+	if (entry)
+		ARP_SET_CACHE(&shm->arp.set[set].cache, entry);
 
-	odp_rwlock_write_unlock(&entry->usetime_rwlock);
+	odp_rwlock_write_unlock(lock);
 }
 
 int ofp_ipv4_lookup_arp_entry_idx(uint32_t ipv4_addr, uint16_t vrf,
@@ -485,9 +664,8 @@ int ofp_ipv4_lookup_arp_entry_idx(uint32_t ipv4_addr, uint16_t vrf,
 	struct arp_entry *entry = NULL;
 	struct arp_key key;
 	uint32_t set;
-	odp_time_t tnew;
-	uint32_t entry_idx;
 	struct arp_cache *cache;
+	odp_bool_t pending;
 
 	set = set_key_and_hash(vrf, ipv4_addr, &key);
 
@@ -496,41 +674,19 @@ int ofp_ipv4_lookup_arp_entry_idx(uint32_t ipv4_addr, uint16_t vrf,
 	entry = ARP_GET_CACHE(cache);
 
 	if (!ARP_IS_CACHE_HIT(entry, &key)) {
-		odp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
+		entry = arp_lookup_lockless(set, &key, &pending);
 
-		entry = arp_lookup(set, &key);
-
-		if (odp_unlikely(entry == NULL) ||
-		    OFP_SLIST_FIRST(&entry->pkt_list_head)) {
-			odp_rwlock_write_unlock(&shm->arp.set[set].table_rwlock);
+		if (odp_unlikely(entry == NULL) || pending)
 			return -1;
-		}
 
-		ARP_SET_CACHE(cache, entry);
-
-		odp_rwlock_write_unlock(&shm->arp.set[set].table_rwlock);
-	}
-
-
-	if (!entry->flags.is_manual &&
-	    odp_unlikely(entry->usetime_upd_tmo == ODP_TIMER_INVALID)) {
-		odp_rwlock_write_lock(&entry->usetime_rwlock);
-		if (!entry->flags.is_manual &&
-		    entry->usetime_upd_tmo == ODP_TIMER_INVALID) {
-			tnew = odp_time_global();
-			entry->usetime = tnew;
-
-			entry_idx = ARP_GET_IDX(entry);
-			entry->usetime_upd_tmo = ofp_timer_start(
-				ENTRY_UPD_TIMEOUT,
-				ofp_arp_entry_usetime_tmo,
-				&entry_idx, sizeof(entry_idx));
-		}
-		odp_rwlock_write_unlock(&entry->usetime_rwlock);
+		arp_cache_fill(set, &key);
 	}
 
 	*entry_idx_out = ARP_GET_IDX(entry);
 
+	if (!entry->flags.is_manual)
+		arp_entry_seen(*entry_idx_out);
+
 	return 0;
 }
 
@@ -570,27 +726,65 @@ int ofp_ipv4_get_mac_by_idx(unsigned char *ll_addr, uint32_t entry_idx)
 	return 0;
 }
 
-struct cleanup_arg {
-	uint32_t entry_idx;
-};
+/*
+ * The argument of the timeout is the entry index and the low bits of
+ * the generation of the waiting packets
+ */
+#define ARP_TMO_ARG(idx, gen) \
+	((void *)(((uintptr_t)(idx) << 16) | (uint16_t)(gen)))
+#define ARP_TMO_IDX(arg) ((uint32_t)((uintptr_t)(arg) >> 16))
+#define ARP_TMO_GEN(arg) ((uint16_t)(uintptr_t)(arg))
 
+/*
+ * Timeout of the waiting packets of an entry. The packets left are
+ * dropped, and an entry that is still incomplete is removed.
+ */
 static void ofp_arp_cleanup_pkt_list(void *arg)
 {
-	struct cleanup_arg *args;
+	void *tmo_arg = *(void **)arg;
 	struct arp_entry *entry;
+	struct arp_key key;
+	uint32_t set;
 
-	args = (struct cleanup_arg *)arg;
-#ifdef OFP_DEBUG
-	entry = ARP_GET_ENTRY(args->entry_idx);
-	OFP_DBG("Arp reply did not arrive on time, %s",
-		ofp_print_ip_addr(entry->key.ipv4_addr));
-#else
-	(void)entry;
-#endif
+	entry = ARP_GET_ENTRY(ARP_TMO_IDX(tmo_arg));
+	set = set_key_and_hash(entry->key.vrf, entry->key.ipv4_addr, &key);
 
-	ofp_arp_ipv4_remove_entry_idx(args->entry_idx);
+	ofp_rwlock_write_lock(&shm->arp.set[set].table_rwlock);
+
+	if ((uint16_t)entry->pending_gen == ARP_TMO_GEN(tmo_arg)) {
+		odp_atomic_store_u32(&entry->pending_armed, 0);
+		if (!entry->flags.is_complete) {
+			OFP_DBG("Arp reply did not arrive on time, %s",
+				ofp_print_ip_addr(entry->key.ipv4_addr));
+			arp_pending_drop(entry);
+			ofp_arp_ipv4_remove_entry(set, entry);
+		}
+	}
+
+	odp_rwlock_write_unlock(&shm->arp.set[set].table_rwlock);
 }
 
+/* Start the timeout of the waiting packets, once per incomplete period */
+static void arp_pending_arm(struct arp_entry *entry)
+{
+	uint32_t old = 0;
+
+	if (odp_atomic_load_u32(&entry->pending_armed) ||
+	    !odp_atomic_cas_acq_u32(&entry->pending_armed, &old, 1))
+		return;
+
+	/* Embedded in the entry, arming allocates nothing */
+	ofp_timer_entry_start(&entry->pkt_tmo, SAVED_PKT_TIMEOUT,
+			      ofp_arp_cleanup_pkt_list,
+			      ARP_TMO_ARG(ARP_GET_IDX(entry),
+					  entry->pending_gen), -1);
+}
+
+/*
+ * Save a packet until the ARP reply arrives. Packets via a next hop are
+ * queued without the table lock, the entry is kept by the reference of
+ * the next hop.
+ */
 enum ofp_return_code ofp_arp_save_ipv4_pkt(odp_packet_t pkt,
 					   struct ofp_nh_entry *nh_param,
 					   uint32_t ipv4_addr,
@@ -599,25 +793,24 @@ enum ofp_return_code ofp_arp_save_ipv4_pkt(odp_packet_t pkt,
 {
 	struct arp_entry *newarp;
 	struct arp_key key;
-	struct pkt_entry *newpkt;
 	uint32_t set;
-	struct cleanup_arg cl_arg;
-	odp_rwlock_t *lock;
+	odp_rwlock_t *lock = NULL;
+	enum ofp_return_code res;
 
 	OFP_DBG("Saving packet %" PRIX64 " to %s", odp_packet_to_u64(pkt),
 		  ofp_print_ip_addr(ipv4_addr));
-
-	set = set_key_and_hash(dev->vrf, ipv4_addr, &key);
-
-	lock = &shm->arp.set[set].table_rwlock;
-
-	odp_rwlock_write_lock(lock);
+	OFP_TRACEPOINT(arp_miss, dev->vrf, ipv4_addr, odp_packet_to_u64(pkt));
 
 	if (is_link_local) {
-		newarp = insert_new_entry(set, &key);
+		set = set_key_and_hash(dev->vrf, ipv4_addr, &key);
+		lock = &shm->arp.set[set].table_rwlock;
+		ofp_rwlock_write_lock(lock);
+
+		newarp = insert_new_entry(set, &key, NULL);
 		if (!newarp) {
 			OFP_ERR("ARP Entry lookup/alloc failed!");
 			odp_rwlock_write_unlock(lock);
+			OFP_DROP_STAT(ARP_PENDING_FULL);
 			return OFP_PKT_DROP;
 		}
 		if (newarp->flags.is_complete) {
@@ -630,32 +823,18 @@ enum ofp_return_code ofp_arp_save_ipv4_pkt(odp_packet_t pkt,
 	}
 	newarp->usetime = ODP_TIME_NULL;
 
-	newpkt = pkt_entry_alloc();
-	if (newpkt == NULL) {
-		OFP_ERR("PKT entry alloc failed, %" PRIX64 " to %s",
-			  odp_packet_to_u64(pkt),
-			  ofp_print_ip_addr(ipv4_addr));
-		if (OFP_SLIST_FIRST(&newarp->pkt_list_head) == NULL)
-			ofp_arp_ipv4_remove_entry(set, newarp);
-		odp_rwlock_write_unlock(lock);
-		return OFP_PKT_DROP;
-	}
-	newpkt->pkt = pkt;
-	newpkt->nh = nh_param;
-
-	/* Start timer only when the first pkt is saved */
-	if (OFP_SLIST_FIRST(&newarp->pkt_list_head) == NULL) {
-		cl_arg.entry_idx = ARP_GET_IDX(newarp);
-		newarp->pkt_tmo = ofp_timer_start(SAVED_PKT_TIMEOUT,
-						    ofp_arp_cleanup_pkt_list,
-						    &cl_arg, sizeof(cl_arg));
-	}
+	res = arp_pending_push(newarp, pkt, nh_param);
+	if (res == OFP_PKT_PROCESSED)
+		arp_pending_arm(newarp);
 
-	OFP_SLIST_INSERT_HEAD(&newarp->pkt_list_head, newpkt, next);
+	if (lock)
+		odp_rwlock_write_unlock(lock);
 
-	odp_rwlock_write_unlock(lock);
+	/* The reply may have arrived while the packet was queued */
+	if (res == OFP_PKT_PROCESSED && newarp->flags.is_complete)
+		arp_pending_send(newarp);
 
-	return OFP_PKT_PROCESSED;
+	return res;
 }
 
 static void ofp_arp_entry_cleanup_on_tmo(int set, struct arp_entry *entry)
@@ -675,100 +854,253 @@ static odp_bool_t ofp_arp_entry_is_timeout(struct arp_entry *entry,
 	return res;
 }
 
-void ofp_arp_age_cb(void *arg)
+/* A set has an entry to remove. Called with the set locked. */
+static int arp_set_expired(int set, odp_time_t now)
+{
+	struct arp_entry *entry;
+
+	OFP_STAILQ_FOREACH(entry, &shm->arp.set[set].table, next)
+		if (!entry->flags.is_manual &&
+		    !odp_atomic_load_u32(&entry->pending_num) &&
+		    ofp_arp_entry_is_timeout(entry, now))
+			return 1;
+	return 0;
+}
+
+/*
+ * Age the sets from first on until at least budget entries have been
+ * visited. Returns the next set to age. The sets are checked under the
+ * read lock, only those with an entry to remove are write locked.
+ */
+static int arp_age_sets(int first, int budget, odp_time_t now)
 {
 	struct arp_entry *entry, *next_entry;
-	int i, cli;
-	odp_time_t now;
+	int i, expired;
 
-	cli =  *(int *)arg;
-	now = odp_time_global();
+	for (i = first; i < NUM_SETS && budget > 0; ++i) {
+		if (OFP_STAILQ_EMPTY(&shm->arp.set[i].table)) {
+			budget--;
+			continue;
+		}
 
-	for (i = 0; i < NUM_SETS; ++i) {
-		odp_rwlock_write_lock(&shm->arp.set[i].table_rwlock);
+		ofp_rwlock_read_lock(&shm->arp.set[i].table_rwlock);
+		expired = arp_set_expired(i, now);
+		odp_rwlock_read_unlock(&shm->arp.set[i].table_rwlock);
+		if (!expired) {
+			budget--;
+			continue;
+		}
+
+		ofp_rwlock_write_lock(&shm->arp.set[i].table_rwlock);
 
 		entry = OFP_STAILQ_FIRST(&shm->arp.set[i].table);
 		while (entry) {
 			next_entry = OFP_STAILQ_NEXT(entry, next);
 			if (!entry->flags.is_manual &&
-			    OFP_SLIST_FIRST(&entry->pkt_list_head) == NULL &&
+			    !odp_atomic_load_u32(&entry->pending_num) &&
 			    ofp_arp_entry_is_timeout(entry, now))
 				ofp_arp_entry_cleanup_on_tmo(i, entry);
 			entry = next_entry;
+			budget--;
 		}
 
 		odp_rwlock_write_unlock(&shm->arp.set[i].table_rwlock);
 	}
 
-	if (!cli) {
-		shm->age_timer = ofp_timer_start(
-			shm->age_interval * US_PER_SEC, ofp_arp_age_cb,
-			&cli, sizeof(cli));
+	return i;
+}
+
+/*
+ * A slice of the ageing pass of about budget entries: the seen bits
+ * are collected first, then the sets are aged. Returns 1 at the end of
+ * the pass.
+ */
+static int arp_age_slice(int budget)
+{
+	uint32_t words;
+
+	if (shm->age_word == 0 && shm->age_set == 0)
+		shm->age_now = odp_time_global();
+
+	if ((uint32_t)shm->age_word < SEEN_ROW_WORDS) {
+		/* A word is a load per thread */
+		words = budget / (shm->age_threads ? shm->age_threads : 1);
+		shm->age_word = arp_collect_seen(shm->age_word,
+						 words ? words : 1,
+						 shm->age_now);
+		return 0;
+	}
+
+	shm->age_set = arp_age_sets(shm->age_set, budget, shm->age_now);
+	if (shm->age_set < NUM_SETS)
+		return 0;
+
+	shm->age_word = 0;
+	shm->age_set = 0;
+	return 1;
+}
+
+void ofp_arp_age_cb(void *arg)
+{
+	int cli, budget;
+	uint64_t tmo_us;
+
+	cli =  *(int *)arg;
+
+	if (cli) {
+		odp_time_t now = odp_time_global();
+
+		arp_collect_seen(0, SEEN_ROW_WORDS, now);
+		arp_age_sets(0, NUM_ARPS + NUM_SETS, now);
+		return;
+	}
+
+	/* A pass over a large table is spread over timer ticks */
+	budget = global_param->timer_budget > 0 ?
+		global_param->timer_budget : OFP_TIMER_BUDGET;
+	if (arp_age_slice(budget))
+		tmo_us = shm->age_interval * US_PER_SEC;
+	else
+		tmo_us = OFP_TIMER_RESOLUTION_US;
+
+	shm->age_timer = ofp_timer_start(tmo_us, ofp_arp_age_cb,
+					 &cli, sizeof(cli));
+}
+
+uint64_t ofp_arp_age(void)
+{
+	odp_time_t now;
+	uint64_t ns;
+
+	if (!shm || !global_param->arp.control_aging)
+		return shm ? shm->age_interval * US_PER_SEC : US_PER_SEC;
+
+	/* Off the fast path, a pass is done at once */
+	now = odp_time_global();
+	if (odp_time_cmp(now, shm->age_next) >= 0) {
+		while (!arp_age_slice(NUM_ARPS + NUM_SETS))
+			;
+		shm->age_next = odp_time_sum(now, odp_time_global_from_ns(
+			shm->age_interval * NS_PER_SEC));
 	}
+
+	ns = odp_time_to_ns(odp_time_diff(shm->age_next, now));
+	return ns / NS_PER_US;
 }
 
 void ofp_arp_show_table(int fd)
 {
-	int i;
 	struct arp_entry *entry;
+	struct arp_show *show;
+	struct ofp_sendbuf sb;
+	int i, n = 0;
+	odp_time_t now;
 
-	ofp_sendf(fd,
-		  "VRF  ADDRESS          MAC                AGE    FLAGS\r\n");
+	/* Room for all entries, the free ones included */
+	show = malloc(NUM_ARPS * sizeof(*show));
+	if (!show) {
+		ofp_sendf(fd, "Out of memory\r\n");
+		return;
+	}
 
-	/* zeroth entry is used as the invalid entry.*/
-	for (i = 1; i < NUM_ARPS; ++i) {
-		entry = &shm->arp.entries[i];
+	/* Each set is copied under its lock, the output is written after */
+	for (i = 0; i < NUM_SETS; ++i) {
+		ofp_rwlock_read_lock(&shm->arp.set[i].table_rwlock);
+		OFP_STAILQ_FOREACH(entry, &shm->arp.set[i].table, next) {
+			if (n == NUM_ARPS)
+				break;
+			if (!entry->flags.is_complete &&
+			    !odp_atomic_load_u32(&entry->pending_num))
+				continue;
+			show[n].key = entry->key;
+			show[n].usetime = entry->usetime;
+			show[n].flags = entry->flags;
+			show[n].macaddr = entry->macaddr;
+			n++;
+		}
+		odp_rwlock_read_unlock(&shm->arp.set[i].table_rwlock);
+	}
+
+	ofp_sendbuf_init(&sb, fd);
+	ofp_sendbuf_printf(&sb, "VRF  ADDRESS          MAC                "
+			   "AGE    FLAGS\r\n");
+	now = odp_time_global();
+	for (i = 0; i < n; i++)
+		show_arp_entry(&sb, &show[i], now);
+	ofp_sendbuf_flush(&sb);
+
+	free(show);
+}
 
-		if (entry->flags.is_complete ||
-		    OFP_SLIST_FIRST(&entry->pkt_list_head) != NULL)
-			show_arp_entry(fd, entry);
+void ofp_arp_walk(void (*func)(void *arg, uint16_t vrf, uint32_t addr,
+				const uint8_t *mac, odp_bool_t is_manual),
+		  void *arg)
+{
+	struct arp_entry *entry;
+	int i;
+
+	for (i = 0; i < NUM_SETS; ++i) {
+		ofp_rwlock_read_lock(&shm->arp.set[i].table_rwlock);
+		OFP_STAILQ_FOREACH(entry, &shm->arp.set[i].table, next)
+			if (entry->flags.is_complete)
+				func(arg, entry->key.vrf, entry->key.ipv4_addr,
+				     (uint8_t *)&entry->macaddr,
+				     entry->flags.is_manual);
+		odp_rwlock_read_unlock(&shm->arp.set[i].table_rwlock);
 	}
 }
 
 void ofp_arp_show_saved_packets(int fd)
 {
-	int i;
-	struct pkt_entry *pktentry;
+	int i, j;
 	struct arp_entry *entry;
+	struct arp_pending_slot *slot;
 
 	ofp_sendf(fd, "Saved packets:\r\n");
 
 	/* zeroth entry is used as the invalid entry.*/
 	for (i = 1; i < NUM_ARPS; ++i) {
 		entry = &shm->arp.entries[i];
-		if (entry->key.ipv4_addr &&
-		    OFP_SLIST_FIRST(&entry->pkt_list_head) != NULL) {
-			ofp_sendf(fd, "IP: %-15s: ",
-				    ofp_print_ip_addr(entry->key.ipv4_addr));
+		if (!entry->key.ipv4_addr ||
+		    !odp_atomic_load_u32(&entry->pending_num))
+			continue;
 
-			OFP_SLIST_FOREACH(pktentry, &entry->pkt_list_head, next)
-				ofp_sendf(fd, "%" PRIX64 "\t",
-					    odp_packet_to_u64(pktentry->pkt));
+		ofp_sendf(fd, "IP: %-15s: ",
+			  ofp_print_ip_addr(entry->key.ipv4_addr));
 
-			ofp_sendf(fd, "\r\n");
+		/* A snapshot, the slots may change while printed */
+		for (j = 0; j < ARP_ENTRY_PENDING; j++) {
+			slot = &entry->pending[j];
+			if (odp_atomic_load_u32(&slot->state) == ARP_SLOT_FULL)
+				ofp_sendf(fd, "%" PRIX64 "\t",
+					  odp_packet_to_u64(slot->pkt));
 		}
+
+		ofp_sendf(fd, "\r\n");
 	}
 }
-void ofp_arp_init_tables_pkt_list(void)
+
+static void arp_pending_init(struct arp_entry *entry)
 {
 	int i;
 
-	odp_rwlock_write_lock(&shm->pkt.fr_ent_rwlock);
-
-	for (i = 0; i < NUM_ARPS; ++i)
-		memset(&shm->arp.entries[i].pkt_list_head, 0,
-		       sizeof(shm->arp.entries[i].pkt_list_head));
-
-	memset(shm->pkt.entries, 0, sizeof(shm->pkt.entries));
-
-	OFP_SLIST_INIT(&shm->pkt.free_entries);
-
-	for (i = ARP_WAITING_PKTS_SIZE - 1; i >= 0; --i)
-		OFP_SLIST_INSERT_HEAD(&shm->pkt.free_entries, &shm->pkt.entries[i],
-				      next);
+	odp_atomic_init_u32(&entry->pending_tail, 0);
+	odp_atomic_init_u32(&entry->pending_num, 0);
+	odp_atomic_init_u32(&entry->pending_armed, 0);
+	for (i = 0; i < ARP_ENTRY_PENDING; i++) {
+		odp_atomic_init_u32(&entry->pending[i].state, ARP_SLOT_EMPTY);
+		entry->pending[i].pkt = ODP_PACKET_INVALID;
+		entry->pending[i].nh = NULL;
+	}
+}
 
-	odp_rwlock_write_unlock(&shm->pkt.fr_ent_rwlock);
+void ofp_arp_init_tables_pkt_list(void)
+{
+	int i;
 
+	/* Forget the saved packets without freeing them */
+	for (i = 0; i < NUM_ARPS; ++i)
+		arp_pending_init(&shm->arp.entries[i]);
 }
 int ofp_arp_init_tables(void)
 {
@@ -776,14 +1108,15 @@ int ofp_arp_init_tables(void)
 	int rc = 0;
 
 	for (i = 0; i < NUM_SETS; ++i)
-		odp_rwlock_write_lock(&shm->arp.set[i].table_rwlock);
-	odp_rwlock_write_lock(&shm->arp.fr_ent_rwlock);
+		ofp_rwlock_write_lock(&shm->arp.set[i].table_rwlock);
+	ofp_rwlock_write_lock(&shm->arp.fr_ent_rwlock);
 
 	/* zeroth entry is used as the invalid entry.*/
 	for (i = 1; i < NUM_ARPS; ++i)
 		CHECK_ERROR(ofp_arp_entry_reset(&shm->arp.entries[i]), rc);
 
 	for (i = 0; i < NUM_SETS; ++i) {
+		set_write_begin(i);
 		memset(&shm->arp.set[i].table, 0, sizeof(shm->arp.set[i].table));
 		memset(&shm->arp.set[i].cache, 0, sizeof(shm->arp.set[i].cache));
 	}
@@ -795,8 +1128,10 @@ int ofp_arp_init_tables(void)
 				  next);
 	memset(&shm->arp.entries[0], 1, sizeof(shm->arp.entries[0]));
 
-	for (i = 0; i < NUM_SETS; ++i)
+	for (i = 0; i < NUM_SETS; ++i) {
+		set_write_end(i);
 		odp_rwlock_write_unlock(&shm->arp.set[i].table_rwlock);
+	}
 
 	odp_rwlock_write_unlock(&shm->arp.fr_ent_rwlock);
 
@@ -845,18 +1180,18 @@ int ofp_arp_init_global(void)
 	shm->age_timer = ODP_TIMER_INVALID;
 	shm->arp.entries = (struct arp_entry *)((char *)shm + sizeof(*shm));
 	shm->arp.set = (struct set_s *)((char *)shm->arp.entries + SIZEOF_ENTRIES);
+	shm->arp.seen = (odp_atomic_u64_t *)((char *)shm->arp.set + SIZEOF_SETS);
 
-	for (i = 0; i < NUM_SETS; ++i)
+	for (i = 0; i < NUM_SETS; ++i) {
 		odp_rwlock_init(&shm->arp.set[i].table_rwlock);
+		odp_atomic_init_u32(&shm->arp.set[i].seq, 0);
+	}
+	for (i = 0; i < (int)(SEEN_ROW_WORDS * ODP_THREAD_COUNT_MAX); ++i)
+		odp_atomic_init_u64(&shm->arp.seen[i], 0);
 	odp_rwlock_init(&shm->arp.fr_ent_rwlock);
-	odp_rwlock_init(&shm->pkt.fr_ent_rwlock);
-
-	for (i = 0; i < NUM_ARPS; ++i) {
-		shm->arp.entries[i].pkt_tmo = ODP_TIMER_INVALID;
-		shm->arp.entries[i].usetime_upd_tmo = ODP_TIMER_INVALID;
-		odp_rwlock_init(&shm->arp.entries[i].usetime_rwlock);
 
-	}
+	for (i = 0; i < NUM_ARPS; ++i)
+		ofp_timer_entry_init(&shm->arp.entries[i].pkt_tmo);
 
 	HANDLE_ERROR(ofp_arp_init_tables());
 
@@ -872,6 +1207,17 @@ int ofp_arp_init_global(void)
 	shm->entry_timeout =
 		odp_time_global_from_ns(entry_timeout * NS_PER_SEC);
 	shm->age_interval = age_interval;
+	shm->age_threads = odp_thread_count_max();
+	if (shm->age_threads > ODP_THREAD_COUNT_MAX)
+		shm->age_threads = ODP_THREAD_COUNT_MAX;
+	shm->age_next = odp_time_sum(odp_time_global(),
+				     odp_time_global_from_ns(age_interval *
+							     NS_PER_SEC));
+
+	/* With arp.control_aging the application calls ofp_arp_age() */
+	if (global_param->arp.control_aging)
+		return 0;
+
 	shm->age_timer = ofp_timer_start(
 		shm->age_interval * US_PER_SEC, ofp_arp_age_cb, &cli, sizeof(cli));
 	if (shm->age_timer == ODP_TIMER_INVALID) {
@@ -886,7 +1232,6 @@ int ofp_arp_term_global(void)
 {
 	int i;
 	struct arp_entry *entry, *next_entry;
-	struct pkt_entry *pktentry;
 	int rc = 0;
 
 	if (ofp_arp_lookup_shared_memory())
@@ -901,20 +1246,9 @@ int ofp_arp_term_global(void)
 		while (entry) {
 			next_entry = OFP_STAILQ_NEXT(entry, next);
 
-			if (entry->pkt_tmo != ODP_TIMER_INVALID)
-				CHECK_ERROR(ofp_timer_cancel(entry->pkt_tmo),
-					rc);
-
-			pktentry = OFP_SLIST_FIRST(&entry->pkt_list_head);
-			while (pktentry) {
-				OFP_SLIST_REMOVE_HEAD(&entry->pkt_list_head,
-						next);
+			ofp_timer_entry_stop(&entry->pkt_tmo);
 
-				pkt_entry_free(pktentry);
-
-				pktentry =
-					OFP_SLIST_FIRST(&entry->pkt_list_head);
-			}
+			arp_pending_drop(entry);
 
 			CHECK_ERROR(remove_entry(i, entry), rc);
 			entry = next_entry;
@@ -928,11 +1262,17 @@ int ofp_arp_term_global(void)
 
 int ofp_arp_init_local(void)
 {
+	int thr = odp_thread_id();
+
+	if (thr >= 0 && thr < ODP_THREAD_COUNT_MAX)
+		seen_row = &shm->arp.seen[thr * SEEN_ROW_WORDS];
+
 	return 0;
 }
 
 void ofp_arp_term_local(void)
 {
+	seen_row = NULL;
 }
 
 int ofp_arp_lookup_shared_memory(void)
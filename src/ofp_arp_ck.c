@@ -21,10 +21,13 @@
 
 #include "api/ofp_types.h"
 #include "ofpi_portconf.h"
+#include "ofpi_route.h"
 #include "ofpi_arp.h"
 #include "ofpi_hash.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_timer.h"
 
 #include <config.h>
 
@@ -119,10 +122,17 @@ inline int ofp_arp_ipv4_insert(uint32_t ipv4_addr, unsigned char *ll_addr,
 	  we should swap the addresses atomically.
 	*/
 	if (odp_unlikely(new != NULL)) {
+		/* Cached outputs of the entry are stale only if it changes */
+		if (new->ifx == dev->port &&
+		    !memcmp(&new->macaddr, ll_addr, ETH_ALEN)) {
+			ck_epoch_end(&record, &section);
+			return 0;
+		}
 		new->ifx = dev->port;
 		memcpy(&new->macaddr, ll_addr, ETH_ALEN);
 		odp_mb_release();
 		ck_epoch_end(&record, &section);
+		ofp_flow_cache_flush();
 		return 0;
 	}
 
@@ -136,6 +146,7 @@ inline int ofp_arp_ipv4_insert(uint32_t ipv4_addr, unsigned char *ll_addr,
 	memcpy(&new->macaddr, ll_addr, ETH_ALEN);
 	CK_SLIST_INSERT_HEAD(&(shm->arp_table[set]), new, next);
 	ck_epoch_end(&record, &section);
+	ofp_flow_cache_flush();
 
 	return 0;
 }
@@ -165,6 +176,7 @@ inline int ofp_arp_ipv4_remove(uint32_t ipv4_addr, struct ofp_ifnet *dev)
 		ck_epoch_barrier(&record);
 		/* epoch has passed, we can now safely free object */
 		arp_free(new);
+		ofp_flow_cache_flush();
 	}
 
 	return ret;
@@ -240,6 +252,12 @@ void ofp_arp_show_saved_packets(int fd)
 	(void) fd;
 }
 
+uint64_t ofp_arp_age(void)
+{
+	/* Aging not defined in arp ck impl */
+	return US_PER_SEC;
+}
+
 int ofp_arp_init_tables(void)
 {
 	return 0;
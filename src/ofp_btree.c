@@ -0,0 +1,702 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "api/ofp_config.h"
+#include "ofpi_btree.h"
+#include "ofpi_init.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+
+#define SHM_NAME_BTREE "OfpBtreeShMem"
+
+#define NUM_TREES 64
+#define BTREE_MIN (OFP_BTREE_KEYS / 2)
+
+/*
+ * Leaves other than the root are at least half full. The rest covers
+ * internal nodes and the partly filled edges of the trees.
+ */
+#ifdef MTRIE
+#define NUM_KEYS (global_param->num_vlan + global_param->mtrie.routes)
+#else
+#define NUM_KEYS (global_param->num_vlan)
+#endif
+#define NUM_NODES ((uint32_t)(global_param->use_btree ? \
+			      NUM_TREES * 8 + NUM_KEYS / (BTREE_MIN - 1) : 0))
+
+#define SHM_SIZE_BTREE (sizeof(struct ofp_btree_mem) + \
+			sizeof(struct ofp_btree_node) * NUM_NODES)
+
+/* Enough nodes for a split on every level and a new root */
+#define BTREE_MAX_HEIGHT 16
+
+/*
+ * Shared data
+ */
+struct ofp_btree_mem {
+	odp_spinlock_t lock;
+	struct ofp_btree_node *free_nodes;
+	ofp_btree *free_trees;
+	uint32_t nodes_allocated, max_nodes_allocated;
+	ofp_btree trees[NUM_TREES];
+	struct ofp_btree_node node_list[0];
+};
+
+/*
+ * Data per core
+ */
+static __thread struct ofp_btree_mem *shm;
+
+static struct ofp_btree_node *node_alloc(void)
+{
+	struct ofp_btree_node *node;
+
+	odp_spinlock_lock(&shm->lock);
+	node = shm->free_nodes;
+	if (node) {
+		shm->free_nodes = node->next;
+		shm->nodes_allocated++;
+		if (shm->nodes_allocated > shm->max_nodes_allocated)
+			shm->max_nodes_allocated = shm->nodes_allocated;
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	return node;
+}
+
+static void node_free(struct ofp_btree_node *node)
+{
+	odp_spinlock_lock(&shm->lock);
+	node->next = shm->free_nodes;
+	shm->free_nodes = node;
+	shm->nodes_allocated--;
+	odp_spinlock_unlock(&shm->lock);
+}
+
+/*
+ * Nodes reserved before an insertion, so that a split never fails half
+ * way up the tree.
+ */
+struct node_reserve {
+	struct ofp_btree_node *node[BTREE_MAX_HEIGHT + 1];
+	int num;
+};
+
+static int reserve_nodes(struct node_reserve *res, uint32_t num)
+{
+	res->num = 0;
+
+	if (num > BTREE_MAX_HEIGHT + 1)
+		return -1;
+
+	while ((uint32_t)res->num < num) {
+		res->node[res->num] = node_alloc();
+		if (!res->node[res->num])
+			return -1;
+		res->num++;
+	}
+
+	return 0;
+}
+
+static void release_nodes(struct node_reserve *res)
+{
+	while (res->num)
+		node_free(res->node[--res->num]);
+}
+
+static struct ofp_btree_node *reserved_node(struct node_reserve *res,
+					    int leaf)
+{
+	struct ofp_btree_node *node = res->node[--res->num];
+
+	memset(node, 0, sizeof(*node));
+	node->leaf = leaf;
+
+	return node;
+}
+
+/* Index of the first key in node not less than key */
+static int lower_bound(ofp_btree *tree, struct ofp_btree_node *node, void *key)
+{
+	int lo = 0, hi = node->num;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (tree->compare_fun(tree->compare_arg, node->keys[mid], key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Index of the child of an internal node that may hold key */
+static int child_index(ofp_btree *tree, struct ofp_btree_node *node, void *key)
+{
+	int lo = 0, hi = node->num;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+
+		if (tree->compare_fun(tree->compare_arg, node->keys[mid], key) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/* Leaf that holds key, or where key would be inserted */
+static struct ofp_btree_node *find_leaf(ofp_btree *tree, void *key)
+{
+	struct ofp_btree_node *node = tree->root;
+
+	while (!node->leaf)
+		node = node->child[child_index(tree, node, key)];
+
+	return node;
+}
+
+ofp_btree *ofp_btree_new(ofp_btree_compare_fun compare_fun, void *compare_arg)
+{
+	struct node_reserve res;
+	ofp_btree *tree;
+
+	odp_spinlock_lock(&shm->lock);
+	tree = shm->free_trees;
+	if (tree)
+		shm->free_trees = tree->next;
+	odp_spinlock_unlock(&shm->lock);
+
+	if (!tree) {
+		OFP_ERR("B-tree allocation failed");
+		return NULL;
+	}
+
+	if (reserve_nodes(&res, 1)) {
+		OFP_ERR("B-tree node allocation failed");
+		odp_spinlock_lock(&shm->lock);
+		tree->next = shm->free_trees;
+		shm->free_trees = tree;
+		odp_spinlock_unlock(&shm->lock);
+		return NULL;
+	}
+
+	tree->root = reserved_node(&res, 1);
+	tree->height = 1;
+	tree->length = 0;
+	tree->compare_fun = compare_fun;
+	tree->compare_arg = compare_arg;
+	tree->next = NULL;
+	ofp_brlock_init(&tree->lock_rw);
+
+	return tree;
+}
+
+static void free_subtree(struct ofp_btree_node *node,
+			 ofp_btree_free_key_fun free_key_fun)
+{
+	int i;
+
+	if (node->leaf) {
+		if (free_key_fun)
+			for (i = 0; i < node->num; i++)
+				free_key_fun(node->keys[i]);
+	} else {
+		for (i = 0; i <= node->num; i++)
+			free_subtree(node->child[i], free_key_fun);
+	}
+
+	node_free(node);
+}
+
+void ofp_btree_free(ofp_btree *tree, ofp_btree_free_key_fun free_key_fun)
+{
+	free_subtree(tree->root, free_key_fun);
+	tree->root = NULL;
+
+	odp_spinlock_lock(&shm->lock);
+	tree->next = shm->free_trees;
+	shm->free_trees = tree;
+	odp_spinlock_unlock(&shm->lock);
+}
+
+/*
+ * Insert key below node. On split, return 1 with the new right sibling
+ * in *right and its least key in *sep.
+ */
+static int insert_rec(ofp_btree *tree, struct ofp_btree_node *node, void *key,
+		      struct node_reserve *res, void **sep,
+		      struct ofp_btree_node **right)
+{
+	struct ofp_btree_node *new;
+	void *keys[OFP_BTREE_KEYS + 1];
+	struct ofp_btree_node *child[OFP_BTREE_KEYS + 2];
+	int pos, num, mid, ret;
+
+	if (node->leaf) {
+		pos = lower_bound(tree, node, key);
+		if (pos < node->num &&
+		    !tree->compare_fun(tree->compare_arg, node->keys[pos], key))
+			return -1;
+
+		if (node->num < OFP_BTREE_KEYS) {
+			memmove(&node->keys[pos + 1], &node->keys[pos],
+				(node->num - pos) * sizeof(void *));
+			node->keys[pos] = key;
+			node->num++;
+			return 0;
+		}
+
+		memcpy(keys, node->keys, pos * sizeof(void *));
+		keys[pos] = key;
+		memcpy(&keys[pos + 1], &node->keys[pos],
+		       (OFP_BTREE_KEYS - pos) * sizeof(void *));
+
+		num = OFP_BTREE_KEYS + 1;
+		mid = num / 2;
+		new = reserved_node(res, 1);
+		memcpy(node->keys, keys, mid * sizeof(void *));
+		node->num = mid;
+		memcpy(new->keys, &keys[mid], (num - mid) * sizeof(void *));
+		new->num = num - mid;
+		new->next = node->next;
+		node->next = new;
+
+		*sep = new->keys[0];
+		*right = new;
+		return 1;
+	}
+
+	pos = child_index(tree, node, key);
+	ret = insert_rec(tree, node->child[pos], key, res, sep, right);
+	if (ret != 1)
+		return ret;
+
+	if (node->num < OFP_BTREE_KEYS) {
+		memmove(&node->keys[pos + 1], &node->keys[pos],
+			(node->num - pos) * sizeof(void *));
+		memmove(&node->child[pos + 2], &node->child[pos + 1],
+			(node->num - pos) * sizeof(void *));
+		node->keys[pos] = *sep;
+		node->child[pos + 1] = *right;
+		node->num++;
+		return 0;
+	}
+
+	memcpy(keys, node->keys, pos * sizeof(void *));
+	keys[pos] = *sep;
+	memcpy(&keys[pos + 1], &node->keys[pos],
+	       (OFP_BTREE_KEYS - pos) * sizeof(void *));
+	memcpy(child, node->child, (pos + 1) * sizeof(void *));
+	child[pos + 1] = *right;
+	memcpy(&child[pos + 2], &node->child[pos + 1],
+	       (OFP_BTREE_KEYS - pos) * sizeof(void *));
+
+	/* keys[mid] moves up, the halves keep mid keys either side */
+	num = OFP_BTREE_KEYS + 1;
+	mid = num / 2;
+	new = reserved_node(res, 0);
+	memcpy(node->keys, keys, mid * sizeof(void *));
+	memcpy(node->child, child, (mid + 1) * sizeof(void *));
+	node->num = mid;
+	memcpy(new->keys, &keys[mid + 1], (num - mid - 1) * sizeof(void *));
+	memcpy(new->child, &child[mid + 1], (num - mid) * sizeof(void *));
+	new->num = num - mid - 1;
+
+	*sep = keys[mid];
+	*right = new;
+	return 1;
+}
+
+int ofp_btree_insert(ofp_btree *tree, void *key)
+{
+	struct ofp_btree_node *right, *root;
+	struct node_reserve res;
+	void *sep;
+	int ret;
+
+	ofp_brlock_write_lock(&tree->lock_rw);
+
+	if (reserve_nodes(&res, tree->height + 1)) {
+		release_nodes(&res);
+		ofp_brlock_write_unlock(&tree->lock_rw);
+		OFP_ERR("B-tree node allocation failed");
+		return -1;
+	}
+
+	ret = insert_rec(tree, tree->root, key, &res, &sep, &right);
+	if (ret == 1) {
+		root = reserved_node(&res, 0);
+		root->num = 1;
+		root->keys[0] = sep;
+		root->child[0] = tree->root;
+		root->child[1] = right;
+		tree->root = root;
+		tree->height++;
+		ret = 0;
+	}
+	if (!ret)
+		tree->length++;
+
+	release_nodes(&res);
+	ofp_brlock_write_unlock(&tree->lock_rw);
+
+	return ret;
+}
+
+static void remove_child(struct ofp_btree_node *node, int pos)
+{
+	/* Drops keys[pos - 1] and child[pos] */
+	memmove(&node->keys[pos - 1], &node->keys[pos],
+		(node->num - pos) * sizeof(void *));
+	memmove(&node->child[pos], &node->child[pos + 1],
+		(node->num - pos) * sizeof(void *));
+	node->num--;
+}
+
+/* Refill child[pos] of node, which has fallen below the minimum */
+static void rebalance(struct ofp_btree_node *node, int pos)
+{
+	struct ofp_btree_node *c = node->child[pos];
+	struct ofp_btree_node *l = pos > 0 ? node->child[pos - 1] : NULL;
+	struct ofp_btree_node *r = pos < node->num ? node->child[pos + 1] : NULL;
+
+	if (l && l->num > BTREE_MIN) {
+		memmove(&c->keys[1], &c->keys[0], c->num * sizeof(void *));
+		if (c->leaf) {
+			c->keys[0] = l->keys[l->num - 1];
+			node->keys[pos - 1] = c->keys[0];
+		} else {
+			memmove(&c->child[1], &c->child[0],
+				(c->num + 1) * sizeof(void *));
+			c->keys[0] = node->keys[pos - 1];
+			c->child[0] = l->child[l->num];
+			node->keys[pos - 1] = l->keys[l->num - 1];
+		}
+		l->num--;
+		c->num++;
+		return;
+	}
+
+	if (r && r->num > BTREE_MIN) {
+		if (c->leaf) {
+			c->keys[c->num] = r->keys[0];
+			memmove(&r->keys[0], &r->keys[1],
+				(r->num - 1) * sizeof(void *));
+			node->keys[pos] = r->keys[0];
+		} else {
+			c->keys[c->num] = node->keys[pos];
+			c->child[c->num + 1] = r->child[0];
+			node->keys[pos] = r->keys[0];
+			memmove(&r->keys[0], &r->keys[1],
+				(r->num - 1) * sizeof(void *));
+			memmove(&r->child[0], &r->child[1],
+				r->num * sizeof(void *));
+		}
+		r->num--;
+		c->num++;
+		return;
+	}
+
+	/* Merge with a sibling, r into c or c into l */
+	if (!l) {
+		l = c;
+		c = r;
+		pos++;
+	}
+
+	if (c->leaf) {
+		memcpy(&l->keys[l->num], c->keys, c->num * sizeof(void *));
+		l->num += c->num;
+		l->next = c->next;
+	} else {
+		l->keys[l->num] = node->keys[pos - 1];
+		memcpy(&l->keys[l->num + 1], c->keys, c->num * sizeof(void *));
+		memcpy(&l->child[l->num + 1], c->child,
+		       (c->num + 1) * sizeof(void *));
+		l->num += c->num + 1;
+	}
+
+	remove_child(node, pos);
+	node_free(c);
+}
+
+static int delete_rec(ofp_btree *tree, struct ofp_btree_node *node, void *key,
+		      void **found)
+{
+	int pos;
+
+	if (node->leaf) {
+		pos = lower_bound(tree, node, key);
+		if (pos == node->num ||
+		    tree->compare_fun(tree->compare_arg, node->keys[pos], key))
+			return -1;
+
+		*found = node->keys[pos];
+		memmove(&node->keys[pos], &node->keys[pos + 1],
+			(node->num - pos - 1) * sizeof(void *));
+		node->num--;
+		return 0;
+	}
+
+	pos = child_index(tree, node, key);
+	if (delete_rec(tree, node->child[pos], key, found))
+		return -1;
+
+	/* Separators point to keys, so one must not outlive its key */
+	if (pos > 0 && node->keys[pos - 1] == *found) {
+		struct ofp_btree_node *c = node->child[pos];
+
+		while (!c->leaf)
+			c = c->child[0];
+		if (c->num)
+			node->keys[pos - 1] = c->keys[0];
+	}
+
+	if (node->child[pos]->num < BTREE_MIN)
+		rebalance(node, pos);
+
+	return 0;
+}
+
+int ofp_btree_delete(ofp_btree *tree, void *key,
+		     ofp_btree_free_key_fun free_key_fun)
+{
+	struct ofp_btree_node *root;
+	void *found;
+
+	ofp_brlock_write_lock(&tree->lock_rw);
+
+	if (delete_rec(tree, tree->root, key, &found)) {
+		ofp_brlock_write_unlock(&tree->lock_rw);
+		return -1;
+	}
+
+	root = tree->root;
+	if (!root->leaf && !root->num) {
+		tree->root = root->child[0];
+		tree->height--;
+		node_free(root);
+	}
+	tree->length--;
+
+	ofp_brlock_write_unlock(&tree->lock_rw);
+
+	if (free_key_fun)
+		free_key_fun(found);
+
+	return 0;
+}
+
+int ofp_btree_get_by_key(ofp_btree *tree, void *key, void **value_address)
+{
+	struct ofp_btree_node *leaf;
+	int pos, ret = -1;
+
+	ofp_brlock_read_lock(&tree->lock_rw);
+
+	leaf = find_leaf(tree, key);
+	pos = lower_bound(tree, leaf, key);
+	if (pos < leaf->num &&
+	    !tree->compare_fun(tree->compare_arg, leaf->keys[pos], key)) {
+		*value_address = leaf->keys[pos];
+		ret = 0;
+	}
+
+	ofp_brlock_read_unlock(&tree->lock_rw);
+
+	return ret;
+}
+
+/* First position not less than key, possibly in a following leaf */
+static struct ofp_btree_node *seek(ofp_btree *tree, void *key, int *pos)
+{
+	struct ofp_btree_node *leaf = find_leaf(tree, key);
+
+	*pos = lower_bound(tree, leaf, key);
+	if (*pos == leaf->num) {
+		leaf = leaf->next;
+		*pos = 0;
+	}
+
+	return leaf;
+}
+
+int ofp_btree_get_item_by_key_least(ofp_btree *tree, void *key,
+				    void **value_address)
+{
+	struct ofp_btree_node *leaf;
+	int pos, ret = -1;
+
+	ofp_brlock_read_lock(&tree->lock_rw);
+
+	leaf = seek(tree, key, &pos);
+	if (leaf) {
+		*value_address = leaf->keys[pos];
+		ret = 0;
+	}
+
+	ofp_brlock_read_unlock(&tree->lock_rw);
+
+	return ret;
+}
+
+static struct ofp_btree_node *first_leaf(ofp_btree *tree)
+{
+	struct ofp_btree_node *node = tree->root;
+
+	while (!node->leaf)
+		node = node->child[0];
+
+	return node;
+}
+
+void *ofp_btree_get_first(ofp_btree *tree)
+{
+	struct ofp_btree_node *leaf;
+	void *key = NULL;
+
+	ofp_brlock_read_lock(&tree->lock_rw);
+
+	leaf = first_leaf(tree);
+	if (leaf->num)
+		key = leaf->keys[0];
+
+	ofp_brlock_read_unlock(&tree->lock_rw);
+
+	return key;
+}
+
+static int iterate(struct ofp_btree_node *leaf, int pos,
+		   ofp_btree_iter_fun iter_fun, void *iter_arg)
+{
+	int ret;
+
+	for (; leaf; leaf = leaf->next, pos = 0)
+		for (; pos < leaf->num; pos++) {
+			ret = iter_fun(leaf->keys[pos], iter_arg);
+			if (ret)
+				return ret;
+		}
+
+	return 0;
+}
+
+int ofp_btree_iterate_inorder(ofp_btree *tree, ofp_btree_iter_fun iter_fun,
+			      void *iter_arg)
+{
+	int ret;
+
+	ofp_brlock_read_lock(&tree->lock_rw);
+	ret = iterate(first_leaf(tree), 0, iter_fun, iter_arg);
+	ofp_brlock_read_unlock(&tree->lock_rw);
+
+	return ret;
+}
+
+int ofp_btree_iterate_from(ofp_btree *tree, void *key,
+			   ofp_btree_iter_fun iter_fun, void *iter_arg)
+{
+	struct ofp_btree_node *leaf;
+	int pos, ret;
+
+	ofp_brlock_read_lock(&tree->lock_rw);
+	leaf = seek(tree, key, &pos);
+	ret = iterate(leaf, pos, iter_fun, iter_arg);
+	ofp_brlock_read_unlock(&tree->lock_rw);
+
+	return ret;
+}
+
+void ofp_print_btree_stat(int fd)
+{
+	if (!NUM_NODES)
+		return;
+
+	ofp_sendf(fd, "btree node alloc now=%u max=%u total=%u\r\n",
+		  shm->nodes_allocated, shm->max_nodes_allocated, NUM_NODES);
+}
+
+static int ofp_btree_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_BTREE, SHM_SIZE_BTREE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+
+	memset(shm, 0, SHM_SIZE_BTREE);
+
+	return 0;
+}
+
+static int ofp_btree_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_BTREE) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_btree_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_BTREE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+void ofp_btree_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_BTREE, SHM_SIZE_BTREE);
+}
+
+int ofp_btree_init_global(void)
+{
+	uint32_t i;
+
+	HANDLE_ERROR(ofp_btree_alloc_shared_memory());
+
+	odp_spinlock_init(&shm->lock);
+
+	for (i = 0; i < NUM_NODES; i++)
+		shm->node_list[i].next = (i == NUM_NODES - 1) ?
+			NULL : &shm->node_list[i + 1];
+	shm->free_nodes = NUM_NODES ? &shm->node_list[0] : NULL;
+
+	for (i = 0; i < NUM_TREES; i++)
+		shm->trees[i].next = (i == NUM_TREES - 1) ?
+			NULL : &shm->trees[i + 1];
+	shm->free_trees = &shm->trees[0];
+
+	return 0;
+}
+
+int ofp_btree_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_btree_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_btree_free_shared_memory(), rc);
+
+	return rc;
+}
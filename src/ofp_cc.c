@@ -0,0 +1,120 @@
+/*-
+ * Copyright (c) 2007-2008
+ *	Swinburne University of Technology, Melbourne, Australia.
+ * Copyright (c) 2009-2010 Lawrence Stewart <lstewart@freebsd.org>
+ * Copyright (c) 2010 The FreeBSD Foundation
+ * Copyright (c) 2026 Nokia
+ * All rights reserved.
+ *
+ * This software was developed at the Centre for Advanced Internet
+ * Architectures, Swinburne University of Technology, by Lawrence Stewart and
+ * James Healy, made possible in part by a grant from the Cisco University
+ * Research Program Fund at Community Foundation Silicon Valley.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ofpi_errno.h"
+#include "ofpi_sysctl.h"
+#include "ofpi_cc.h"
+
+struct cc_algo *const ofp_cc_list[] = {
+	&ofp_newreno_cc_algo,
+	&ofp_cubic_cc_algo,
+	&ofp_bbr_cc_algo,
+	NULL
+};
+
+/* Algorithm of new connections */
+struct cc_algo *ofp_cc_default = &ofp_newreno_cc_algo;
+
+struct cc_algo *ofp_cc_algo_find(const char *name)
+{
+	int i;
+
+	for (i = 0; ofp_cc_list[i]; i++)
+		if (!strncmp(name, ofp_cc_list[i]->name, OFP_TCP_CA_NAME_MAX))
+			return ofp_cc_list[i];
+	return NULL;
+}
+
+/*
+ * Sysctl handler to show and change the default CC algorithm.
+ */
+static int
+cc_default_algo(OFP_SYSCTL_HANDLER_ARGS)
+{
+	char default_cc[OFP_TCP_CA_NAME_MAX];
+	struct cc_algo *algo;
+	int error;
+
+	(void)arg1;
+	(void)arg2;
+
+	snprintf(default_cc, sizeof(default_cc), "%s", CC_DEFAULT()->name);
+	error = sysctl_handle_string(oidp, default_cc, sizeof(default_cc), req);
+	if (error || req->newptr == NULL)
+		return error;
+
+	algo = ofp_cc_algo_find(default_cc);
+	if (algo == NULL)
+		return OFP_ESRCH;
+
+	ofp_cc_default = algo;
+	return 0;
+}
+
+/*
+ * Sysctl handler to display the list of available CC algorithms.
+ */
+static int
+cc_list_available(OFP_SYSCTL_HANDLER_ARGS)
+{
+	char buf[OFP_TCP_CA_NAME_MAX * 4];
+	size_t len = 0;
+	int i;
+
+	(void)arg1;
+	(void)arg2;
+	(void)oidp;
+
+	buf[0] = '\0';
+	for (i = 0; ofp_cc_list[i]; i++)
+		len += snprintf(buf + len, sizeof(buf) - len, "%s%s",
+				i ? ", " : "", ofp_cc_list[i]->name);
+
+	return SYSCTL_OUT(req, buf, len + 1);
+}
+
+OFP_SYSCTL_NODE(_net_inet_tcp, OFP_OID_AUTO, cc, OFP_CTLFLAG_RW, 0,
+    "congestion control related settings");
+
+OFP_SYSCTL_PROC(_net_inet_tcp_cc, OFP_OID_AUTO, algorithm,
+    OFP_CTLTYPE_STRING|OFP_CTLFLAG_RW, NULL, 0, cc_default_algo, "A",
+    "default congestion control algorithm");
+
+OFP_SYSCTL_PROC(_net_inet_tcp_cc, OFP_OID_AUTO, available,
+    OFP_CTLTYPE_STRING|OFP_CTLFLAG_RD, NULL, 0, cc_list_available, "A",
+    "list available congestion control algorithms");
@@ -0,0 +1,494 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * BBR (version 1) congestion control, after "BBR: Congestion-Based
+ * Congestion Control" by Cardwell, Cheng, Gunn, Hassas Yeganeh and
+ * Jacobson, and draft-cardwell-iccrg-bbr-congestion-control-00.
+ *
+ * The model of the path is the maximum delivery rate seen in the last
+ * BBR_BW_RTTS rounds and the minimum RTT seen in the last
+ * BBR_MIN_RTT_WIN_NS. The sending rate (tp->t_pacing_rate, enforced by
+ * ofp_tcp_output()) and cwnd are set from the model with the gains of
+ * the current mode.
+ *
+ * Delivery rate and RTT are measured with one sample in flight at a
+ * time: the sample starts when new data is sent and ends when that data
+ * is acked, the rate being the bytes acked in between divided by the
+ * elapsed time.
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_systm.h"
+#include "ofpi_timer.h"
+#include "ofpi_tcp_seq.h"
+#include "ofpi_tcp_fsm.h"
+#include "ofpi_cc.h"
+
+#define	BBR_SCALE	8
+#define	BBR_UNIT	(1 << BBR_SCALE)
+
+/* 2/ln(2), the smallest gain that doubles the rate each round. */
+#define	BBR_HIGH_GAIN	(BBR_UNIT * 2885 / 1000 + 1)
+#define	BBR_DRAIN_GAIN	(BBR_UNIT * 1000 / 2885)
+#define	BBR_CWND_GAIN	(BBR_UNIT * 2)
+
+/* Window of the max delivery rate filter in rounds. */
+#define	BBR_BW_RTTS	10
+/* Window of the min RTT filter. */
+#define	BBR_MIN_RTT_WIN_NS	(10 * ODP_TIME_SEC_IN_NS)
+/* Time spent at the minimum cwnd in PROBE_RTT. */
+#define	BBR_PROBE_RTT_NS	(200 * ODP_TIME_MSEC_IN_NS)
+#define	BBR_MIN_CWND_SEGS	4
+/* The pipe is full when the rate grows less than 25% in 3 rounds. */
+#define	BBR_FULL_BW_THRESH	(BBR_UNIT * 5 / 4)
+#define	BBR_FULL_BW_CNT		3
+/* RTT used for the initial pacing rate when there is no sample. */
+#define	BBR_DEFAULT_RTT_US	1000
+
+#define	BBR_CYCLE_LEN	8
+
+static const uint32_t bbr_pacing_gain[BBR_CYCLE_LEN] = {
+	BBR_UNIT * 5 / 4,	/* probe for more available bandwidth */
+	BBR_UNIT * 3 / 4,	/* drain the queue created while probing */
+	BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT, BBR_UNIT
+};
+
+enum bbr_mode {
+	BBR_STARTUP,	/* ramp up the sending rate rapidly */
+	BBR_DRAIN,	/* drain the queue created in startup */
+	BBR_PROBE_BW,	/* cycle the pacing gain around the bottleneck rate */
+	BBR_PROBE_RTT,	/* cut inflight to measure the min RTT */
+};
+
+struct bbr {
+	/* Max delivery rate of the recent rounds, bytes per second */
+	uint64_t	bw_round[BBR_BW_RTTS];
+	/* Bytes acked on the connection */
+	uint64_t	delivered;
+	uint64_t	full_bw;
+	uint64_t	prior_cwnd;
+	uint64_t	min_rtt_stamp;
+	uint64_t	cycle_stamp;
+	uint64_t	probe_rtt_done_stamp;
+	/* Rate sample in flight */
+	uint64_t	rs_stamp;
+	uint64_t	rs_delivered;
+	tcp_seq		rs_seq;
+	/* The round ends when round_seq is acked */
+	tcp_seq		round_seq;
+	uint32_t	round_count;
+	uint32_t	min_rtt_us;
+	uint32_t	pacing_gain;
+	uint32_t	cwnd_gain;
+	uint8_t		mode;
+	uint8_t		cycle_idx;
+	uint8_t		full_bw_cnt;
+	uint8_t		full_bw_reached;
+	uint8_t		rs_pending;
+	uint8_t		round_start;
+	uint8_t		probe_rtt_round_done;
+	uint8_t		idle_restart;
+};
+
+ODP_STATIC_ASSERT(sizeof(struct bbr) <= CC_DATA_SIZE, "CC_DATA_SIZE");
+
+static int	bbr_cb_init(struct cc_var *ccv);
+static void	bbr_cb_destroy(struct cc_var *ccv);
+static void	bbr_conn_init(struct cc_var *ccv);
+static void	bbr_ack_received(struct cc_var *ccv, uint16_t type);
+static void	bbr_cong_signal(struct cc_var *ccv, uint32_t type);
+static void	bbr_post_recovery(struct cc_var *ccv);
+static void	bbr_after_idle(struct cc_var *ccv);
+static void	bbr_data_sent(struct cc_var *ccv);
+
+struct cc_algo ofp_bbr_cc_algo = {
+	.name = "bbr",
+	.cb_init = bbr_cb_init,
+	.cb_destroy = bbr_cb_destroy,
+	.conn_init = bbr_conn_init,
+	.ack_received = bbr_ack_received,
+	.cong_signal = bbr_cong_signal,
+	.post_recovery = bbr_post_recovery,
+	.after_idle = bbr_after_idle,
+	.data_sent = bbr_data_sent,
+};
+
+static uint64_t bbr_max_bw(struct bbr *bbr)
+{
+	uint64_t bw = 0;
+	int i;
+
+	for (i = 0; i < BBR_BW_RTTS; i++)
+		if (bbr->bw_round[i] > bw)
+			bw = bbr->bw_round[i];
+	return bw;
+}
+
+static uint32_t bbr_inflight(struct cc_var *ccv)
+{
+	return CCV(ccv, snd_max) - CCV(ccv, snd_una);
+}
+
+/* Bandwidth-delay product scaled by gain, 0 before the first sample */
+static uint64_t bbr_bdp(struct bbr *bbr, uint32_t gain)
+{
+	uint64_t bdp;
+
+	if (bbr->min_rtt_us == UINT32_MAX)
+		return 0;
+
+	bdp = bbr_max_bw(bbr) * bbr->min_rtt_us / 1000000;
+	return (bdp * gain) >> BBR_SCALE;
+}
+
+static void bbr_set_pacing_rate(struct cc_var *ccv, struct bbr *bbr,
+				uint32_t gain)
+{
+	uint64_t rate = (bbr_max_bw(bbr) * gain) >> BBR_SCALE;
+
+	if (rate == 0)
+		return;
+	/* Keep the initial rate until the model says more */
+	if (bbr->full_bw_reached || rate > CCV(ccv, t_pacing_rate))
+		CCV(ccv, t_pacing_rate) = rate;
+}
+
+/* Pace the initial window over an RTT, before there is a rate sample */
+static void bbr_init_pacing_rate(struct cc_var *ccv)
+{
+	uint64_t rtt_us = BBR_DEFAULT_RTT_US;
+
+	if (CCV(ccv, t_srtt))
+		rtt_us = (uint64_t)(CCV(ccv, t_srtt) >> TCP_RTT_SHIFT) *
+			OFP_TIMER_RESOLUTION_US;
+	if (rtt_us == 0)
+		rtt_us = BBR_DEFAULT_RTT_US;
+
+	CCV(ccv, t_pacing_rate) = ((CCV(ccv, snd_cwnd) * 1000000 / rtt_us) *
+				   BBR_HIGH_GAIN) >> BBR_SCALE;
+}
+
+static void bbr_enter_startup(struct bbr *bbr)
+{
+	bbr->mode = BBR_STARTUP;
+	bbr->pacing_gain = BBR_HIGH_GAIN;
+	bbr->cwnd_gain = BBR_HIGH_GAIN;
+}
+
+static void bbr_enter_probe_bw(struct bbr *bbr, uint64_t now)
+{
+	bbr->mode = BBR_PROBE_BW;
+	bbr->cwnd_gain = BBR_CWND_GAIN;
+	/* Any phase but the draining one, so flows do not probe together */
+	bbr->cycle_idx = (now >> 10) % (BBR_CYCLE_LEN - 1);
+	if (bbr->cycle_idx >= 1)
+		bbr->cycle_idx++;
+	bbr->cycle_stamp = now;
+	bbr->pacing_gain = bbr_pacing_gain[bbr->cycle_idx];
+}
+
+static void bbr_save_cwnd(struct cc_var *ccv, struct bbr *bbr)
+{
+	if (!IN_RECOVERY(CCV(ccv, t_flags)) && bbr->mode != BBR_PROBE_RTT)
+		bbr->prior_cwnd = CCV(ccv, snd_cwnd);
+	else
+		bbr->prior_cwnd = ulmax(bbr->prior_cwnd, CCV(ccv, snd_cwnd));
+}
+
+static void bbr_update_sample(struct cc_var *ccv, struct bbr *bbr,
+			      uint64_t now)
+{
+	uint64_t interval, bw;
+	uint32_t rtt_us;
+	int slot;
+
+	if (!bbr->rs_pending || SEQ_LT(ccv->curack, bbr->rs_seq))
+		return;
+	bbr->rs_pending = 0;
+
+	interval = now - bbr->rs_stamp;
+	if (interval == 0)
+		return;
+
+	rtt_us = interval / 1000 ? interval / 1000 : 1;
+	if (rtt_us <= bbr->min_rtt_us ||
+	    now - bbr->min_rtt_stamp > BBR_MIN_RTT_WIN_NS) {
+		bbr->min_rtt_us = rtt_us;
+		bbr->min_rtt_stamp = now;
+	}
+
+	/*
+	 * A rate below the model while not cwnd limited likely only shows
+	 * that the application had nothing to send.
+	 */
+	bw = (bbr->delivered - bbr->rs_delivered) * ODP_TIME_SEC_IN_NS /
+		interval;
+	if (bw < bbr_max_bw(bbr) && !(ccv->flags & CCF_CWND_LIMITED))
+		return;
+
+	slot = bbr->round_count % BBR_BW_RTTS;
+	if (bw > bbr->bw_round[slot])
+		bbr->bw_round[slot] = bw;
+}
+
+static void bbr_check_full_bw_reached(struct bbr *bbr)
+{
+	uint64_t bw = bbr_max_bw(bbr);
+
+	if (bbr->full_bw_reached || !bbr->round_start)
+		return;
+
+	if (bw >= (bbr->full_bw * BBR_FULL_BW_THRESH) >> BBR_SCALE) {
+		bbr->full_bw = bw;
+		bbr->full_bw_cnt = 0;
+		return;
+	}
+	if (++bbr->full_bw_cnt >= BBR_FULL_BW_CNT)
+		bbr->full_bw_reached = 1;
+}
+
+static void bbr_check_drain(struct cc_var *ccv, struct bbr *bbr,
+			    uint64_t now)
+{
+	if (bbr->mode == BBR_STARTUP && bbr->full_bw_reached) {
+		bbr->mode = BBR_DRAIN;
+		bbr->pacing_gain = BBR_DRAIN_GAIN;
+		bbr->cwnd_gain = BBR_HIGH_GAIN;
+	}
+	if (bbr->mode == BBR_DRAIN &&
+	    bbr_inflight(ccv) <= bbr_bdp(bbr, BBR_UNIT))
+		bbr_enter_probe_bw(bbr, now);
+}
+
+static void bbr_update_cycle(struct cc_var *ccv, struct bbr *bbr,
+			     uint64_t now)
+{
+	uint64_t inflight = bbr_inflight(ccv);
+	int full_length;
+
+	if (bbr->mode != BBR_PROBE_BW)
+		return;
+
+	full_length = now - bbr->cycle_stamp >
+		(uint64_t)bbr->min_rtt_us * 1000;
+
+	if (bbr->pacing_gain > BBR_UNIT) {
+		/* Probe until the extra data is in flight */
+		if (!full_length ||
+		    (inflight < bbr_bdp(bbr, bbr->pacing_gain) &&
+		     !IN_RECOVERY(CCV(ccv, t_flags))))
+			return;
+	} else if (bbr->pacing_gain < BBR_UNIT) {
+		/* Drain until the queue is gone */
+		if (!full_length && inflight > bbr_bdp(bbr, BBR_UNIT))
+			return;
+	} else if (!full_length)
+		return;
+
+	bbr->cycle_idx = (bbr->cycle_idx + 1) % BBR_CYCLE_LEN;
+	bbr->cycle_stamp = now;
+	bbr->pacing_gain = bbr_pacing_gain[bbr->cycle_idx];
+}
+
+static void bbr_update_min_rtt(struct cc_var *ccv, struct bbr *bbr,
+			       uint64_t now, int expired)
+{
+	uint32_t min_cwnd = BBR_MIN_CWND_SEGS * CCV(ccv, t_maxseg);
+
+	if (expired && !bbr->idle_restart && bbr->mode != BBR_PROBE_RTT) {
+		bbr->mode = BBR_PROBE_RTT;
+		bbr->pacing_gain = BBR_UNIT;
+		bbr->cwnd_gain = BBR_UNIT;
+		bbr_save_cwnd(ccv, bbr);
+		bbr->probe_rtt_done_stamp = 0;
+	}
+
+	if (bbr->mode == BBR_PROBE_RTT) {
+		if (!bbr->probe_rtt_done_stamp &&
+		    bbr_inflight(ccv) <= min_cwnd) {
+			bbr->probe_rtt_done_stamp = now + BBR_PROBE_RTT_NS;
+			bbr->probe_rtt_round_done = 0;
+			bbr->round_seq = CCV(ccv, snd_max);
+		} else if (bbr->probe_rtt_done_stamp) {
+			if (bbr->round_start)
+				bbr->probe_rtt_round_done = 1;
+			if (bbr->probe_rtt_round_done &&
+			    now > bbr->probe_rtt_done_stamp) {
+				bbr->min_rtt_stamp = now;
+				CCV(ccv, snd_cwnd) = ulmax(CCV(ccv, snd_cwnd),
+							   bbr->prior_cwnd);
+				if (bbr->full_bw_reached)
+					bbr_enter_probe_bw(bbr, now);
+				else
+					bbr_enter_startup(bbr);
+			}
+		}
+	}
+}
+
+static void bbr_set_cwnd(struct cc_var *ccv, struct bbr *bbr, uint32_t acked)
+{
+	uint32_t maxseg = CCV(ccv, t_maxseg);
+	uint64_t cwnd = CCV(ccv, snd_cwnd);
+	uint64_t target;
+
+	/* Fast recovery sets the window itself, see ofp_tcp_input() */
+	if (IN_RECOVERY(CCV(ccv, t_flags)))
+		return;
+
+	/* Room for the ACK aggregation of delayed ACKs and bursts */
+	target = bbr_bdp(bbr, bbr->cwnd_gain) + 3 * maxseg;
+
+	if (bbr->full_bw_reached)
+		cwnd = ulmin(cwnd + acked, target);
+	else if (cwnd < target || bbr_bdp(bbr, BBR_UNIT) == 0)
+		cwnd += acked;
+
+	cwnd = ulmax(cwnd, BBR_MIN_CWND_SEGS * maxseg);
+	if (bbr->mode == BBR_PROBE_RTT)
+		cwnd = ulmin(cwnd, BBR_MIN_CWND_SEGS * maxseg);
+
+	CCV(ccv, snd_cwnd) = ulmin(cwnd,
+		(uint64_t)OFP_TCP_MAXWIN << CCV(ccv, snd_scale));
+}
+
+static void
+bbr_ack_received(struct cc_var *ccv, uint16_t type)
+{
+	struct bbr *bbr = ccv->cc_data;
+	uint64_t now;
+	int expired;
+
+	if (type != CC_ACK || ccv->bytes_this_ack <= 0)
+		return;
+
+	now = cc_time_ns();
+	expired = now - bbr->min_rtt_stamp > BBR_MIN_RTT_WIN_NS;
+	bbr->delivered += ccv->bytes_this_ack;
+
+	bbr->round_start = 0;
+	if (SEQ_GEQ(ccv->curack, bbr->round_seq)) {
+		bbr->round_seq = CCV(ccv, snd_max);
+		bbr->round_count++;
+		bbr->round_start = 1;
+		bbr->bw_round[bbr->round_count % BBR_BW_RTTS] = 0;
+	}
+
+	bbr_update_sample(ccv, bbr, now);
+	bbr_check_full_bw_reached(bbr);
+	bbr_check_drain(ccv, bbr, now);
+	bbr_update_cycle(ccv, bbr, now);
+	bbr_update_min_rtt(ccv, bbr, now, expired);
+	bbr->idle_restart = 0;
+
+	bbr_set_pacing_rate(ccv, bbr, bbr->pacing_gain);
+	bbr_set_cwnd(ccv, bbr, ccv->bytes_this_ack);
+}
+
+static void
+bbr_data_sent(struct cc_var *ccv)
+{
+	struct bbr *bbr = ccv->cc_data;
+
+	if (bbr->rs_pending)
+		return;
+
+	bbr->rs_pending = 1;
+	bbr->rs_seq = CCV(ccv, snd_max);
+	bbr->rs_stamp = cc_time_ns();
+	bbr->rs_delivered = bbr->delivered;
+}
+
+/*
+ * Losses do not change the model. Fast recovery keeps what is in
+ * flight: ssthresh, from which ofp_tcp_input() sets cwnd during the
+ * recovery, is the data in flight. The window before the loss returns
+ * when the recovery ends.
+ */
+static void
+bbr_cong_signal(struct cc_var *ccv, uint32_t type)
+{
+	struct bbr *bbr = ccv->cc_data;
+
+	switch (type) {
+	case CC_NDUPACK:
+		if (!IN_FASTRECOVERY(CCV(ccv, t_flags))) {
+			bbr_save_cwnd(ccv, bbr);
+			CCV(ccv, snd_ssthresh) = ulmax(bbr_inflight(ccv),
+				BBR_MIN_CWND_SEGS * CCV(ccv, t_maxseg));
+			ENTER_RECOVERY(CCV(ccv, t_flags));
+		}
+		/* The sample may be acked by a retransmission */
+		bbr->rs_pending = 0;
+		break;
+	case CC_RTO:
+		if (CCV(ccv, t_flags) & TF_PREVVALID)
+			bbr->prior_cwnd = ulmax(bbr->prior_cwnd,
+						CCV(ccv, snd_cwnd_prev));
+		bbr->rs_pending = 0;
+		bbr->full_bw = 0;
+		bbr->full_bw_cnt = 0;
+		break;
+	}
+}
+
+static void
+bbr_post_recovery(struct cc_var *ccv)
+{
+	struct bbr *bbr = ccv->cc_data;
+
+	CCV(ccv, snd_cwnd) = ulmax(CCV(ccv, snd_cwnd), bbr->prior_cwnd);
+}
+
+static void
+bbr_after_idle(struct cc_var *ccv)
+{
+	struct bbr *bbr = ccv->cc_data;
+
+	/* Restart at the estimated rate rather than probing above it */
+	bbr->idle_restart = 1;
+	if (bbr->mode == BBR_PROBE_BW)
+		bbr_set_pacing_rate(ccv, bbr, BBR_UNIT);
+}
+
+static void
+bbr_conn_init(struct cc_var *ccv)
+{
+	struct bbr *bbr = ccv->cc_data;
+
+	bbr->round_seq = CCV(ccv, snd_max);
+	bbr_init_pacing_rate(ccv);
+}
+
+static int
+bbr_cb_init(struct cc_var *ccv)
+{
+	struct bbr *bbr = (struct bbr *)ccv->cc_mem;
+
+	memset(bbr, 0, sizeof(*bbr));
+	bbr->min_rtt_us = UINT32_MAX;
+	bbr->min_rtt_stamp = cc_time_ns();
+	bbr->round_seq = CCV(ccv, snd_max);
+	bbr_enter_startup(bbr);
+
+	ccv->cc_data = bbr;
+
+	/* Switched to on an established connection */
+	if (TCPS_HAVEESTABLISHED(CCV(ccv, t_state)))
+		bbr_init_pacing_rate(ccv);
+
+	return 0;
+}
+
+static void
+bbr_cb_destroy(struct cc_var *ccv)
+{
+	CCV(ccv, t_pacing_rate) = 0;
+}
@@ -0,0 +1,531 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_conntrack.h"
+#include "ofpi_pkt_processing.h"
+#include "ofpi_hash.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_stat.h"
+
+#include "api/ofp_ip.h"
+#include "api/ofp_ip6.h"
+#include "api/ofp_icmp.h"
+#include "api/ofp_icmp6.h"
+#include "api/ofp_tcp.h"
+
+#define CT_HASH_SEED 0x636f6e6e
+
+/* Slots of one tick of about a second, odp_time_local_ns() >> 30 */
+#define CT_WHEEL_SLOTS 1024
+#define CT_TICK_SHIFT 30
+
+/* Slots searched ahead for a flow to evict when the table is full */
+#define CT_EVICT_SLOTS 16
+
+/* Flow states, TCP goes through all of them, others NEW and EST */
+#define CT_NEW 0
+#define CT_SYN_RECV 1
+#define CT_EST 2
+#define CT_FIN 3
+#define CT_CLOSE 4
+
+#define CT_FAMILY_V4 4
+#define CT_FAMILY_V6 6
+
+struct ofp_ct_key {
+	/* addr[0] and port[0] are the lower of the two ends */
+	uint32_t addr[2][4];
+	uint16_t port[2];
+	uint16_t vrf;
+	uint8_t proto;
+	uint8_t family;
+};
+
+struct ofp_ct_flow {
+	struct ofp_ct_key key;
+	/* Indexes + 1 of the next flows of the bucket and wheel slot */
+	uint32_t hash_next;
+	uint32_t wheel_next;
+	uint32_t wheel_prev;
+	/* Tick at which the flow expires */
+	uint32_t expire;
+	uint16_t slot;
+	uint8_t state;
+	uint8_t action;
+	/* Key end of the sender of the first packet */
+	uint8_t orig;
+	/* FIN seen, bit 0 from the original direction */
+	uint8_t fin;
+	uint64_t data[OFP_CT_FLOW_DATA_LEN / sizeof(uint64_t)];
+};
+
+struct ofp_ct_table {
+	struct ofp_ct_flow *flow;
+	uint32_t *bucket;
+	uint32_t mask;
+	uint32_t free;
+	uint32_t tick;
+	uint32_t tmo_tcp;
+	uint32_t tmo_udp;
+	uint32_t tmo_close;
+	uint32_t tmo;
+	uint32_t wheel[CT_WHEEL_SLOTS];
+};
+
+__thread struct ofp_ct_table *ofp_ct_table;
+
+static inline uint32_t ct_now(void)
+{
+	return (uint32_t)(odp_time_local_ns() >> CT_TICK_SHIFT);
+}
+
+static inline uint32_t ct_idx(struct ofp_ct_table *ct, struct ofp_ct_flow *f)
+{
+	return (uint32_t)(f - ct->flow) + 1;
+}
+
+static inline uint32_t ct_hash(const struct ofp_ct_key *key)
+{
+	return ofp_hash_key((const uint32_t *)key, sizeof(*key) / 4,
+			    CT_HASH_SEED);
+}
+
+static void ct_wheel_link(struct ofp_ct_table *ct, struct ofp_ct_flow *f)
+{
+	uint32_t idx = ct_idx(ct, f);
+
+	f->slot = f->expire & (CT_WHEEL_SLOTS - 1);
+	f->wheel_prev = 0;
+	f->wheel_next = ct->wheel[f->slot];
+	if (f->wheel_next)
+		ct->flow[f->wheel_next - 1].wheel_prev = idx;
+	ct->wheel[f->slot] = idx;
+}
+
+static void ct_wheel_unlink(struct ofp_ct_table *ct, struct ofp_ct_flow *f)
+{
+	if (f->wheel_prev)
+		ct->flow[f->wheel_prev - 1].wheel_next = f->wheel_next;
+	else
+		ct->wheel[f->slot] = f->wheel_next;
+	if (f->wheel_next)
+		ct->flow[f->wheel_next - 1].wheel_prev = f->wheel_prev;
+}
+
+static void ct_hash_unlink(struct ofp_ct_table *ct, struct ofp_ct_flow *f)
+{
+	uint32_t *p = &ct->bucket[ct_hash(&f->key) & ct->mask];
+	uint32_t idx = ct_idx(ct, f);
+
+	while (*p != idx)
+		p = &ct->flow[*p - 1].hash_next;
+	*p = f->hash_next;
+}
+
+static inline uint32_t ct_timeout(struct ofp_ct_table *ct,
+				  struct ofp_ct_flow *f)
+{
+	if (f->state == CT_CLOSE)
+		return ct->tmo_close;
+	if (f->state != CT_EST)
+		return ct->tmo;
+	if (f->key.proto == OFP_IPPROTO_TCP)
+		return ct->tmo_tcp;
+	if (f->key.proto == OFP_IPPROTO_UDP)
+		return ct->tmo_udp;
+	return ct->tmo;
+}
+
+/* The expire callback sees the flow before its data is cleared */
+static void ct_flow_expire(struct ofp_ct_flow *f)
+{
+	if (global_param->conntrack.expire)
+		global_param->conntrack.expire(f);
+	memset(f->data, 0, sizeof(f->data));
+	f->action = OFP_CT_ACTION_CONTINUE;
+}
+
+static void ct_flow_free(struct ofp_ct_table *ct, struct ofp_ct_flow *f)
+{
+	ct_flow_expire(f);
+	ct_hash_unlink(ct, f);
+	f->hash_next = ct->free;
+	ct->free = ct_idx(ct, f);
+}
+
+/* Expire the flows of the slots up to now, relink the extended ones */
+static int ct_advance(struct ofp_ct_table *ct, uint32_t now)
+{
+	uint32_t n = now - ct->tick;
+	uint32_t i, idx;
+	int num = 0;
+
+	if (n > CT_WHEEL_SLOTS)
+		n = CT_WHEEL_SLOTS;
+
+	for (i = 1; i <= n; i++) {
+		uint32_t slot = (ct->tick + i) & (CT_WHEEL_SLOTS - 1);
+
+		idx = ct->wheel[slot];
+		ct->wheel[slot] = 0;
+		while (idx) {
+			struct ofp_ct_flow *f = &ct->flow[idx - 1];
+
+			idx = f->wheel_next;
+			if ((int32_t)(f->expire - now) <= 0) {
+				ct_flow_free(ct, f);
+				num++;
+			} else {
+				ct_wheel_link(ct, f);
+			}
+		}
+	}
+	ct->tick = now;
+	return num;
+}
+
+/* A free flow, or the flow expiring next taken over */
+static struct ofp_ct_flow *ct_flow_alloc(struct ofp_ct_table *ct)
+{
+	struct ofp_ct_flow *f;
+	uint32_t i;
+
+	if (odp_likely(ct->free)) {
+		f = &ct->flow[ct->free - 1];
+		ct->free = f->hash_next;
+		return f;
+	}
+
+	for (i = 1; i <= CT_EVICT_SLOTS; i++) {
+		uint32_t idx = ct->wheel[(ct->tick + i) & (CT_WHEEL_SLOTS - 1)];
+
+		if (!idx)
+			continue;
+		f = &ct->flow[idx - 1];
+		ct_wheel_unlink(ct, f);
+		ct_flow_expire(f);
+		ct_hash_unlink(ct, f);
+		return f;
+	}
+	return NULL;
+}
+
+static void ct_tcp_update(struct ofp_ct_flow *f, int reply, uint8_t flags)
+{
+	if (flags & OFP_TH_RST) {
+		f->state = CT_CLOSE;
+		return;
+	}
+
+	switch (f->state) {
+	case CT_NEW:
+		if (reply && (flags & OFP_TH_SYN) && (flags & OFP_TH_ACK))
+			f->state = CT_SYN_RECV;
+		break;
+	case CT_SYN_RECV:
+		if (!reply && (flags & OFP_TH_ACK) && !(flags & OFP_TH_SYN))
+			f->state = CT_EST;
+		break;
+	case CT_EST:
+	case CT_FIN:
+		if (flags & OFP_TH_FIN) {
+			f->fin |= 1 << reply;
+			f->state = f->fin == 3 ? CT_CLOSE : CT_FIN;
+		}
+		break;
+	}
+}
+
+static enum ofp_return_code ct_input(odp_packet_t pkt, struct ofp_ct_key *key,
+				     uint8_t tcp_flags)
+{
+	struct ofp_ct_table *ct = ofp_ct_table;
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(pkt);
+	struct ofp_ct_flow *f;
+	uint32_t now = ct_now(), hash, idx;
+	uint8_t side = 0, state;
+	int tcp = key->proto == OFP_IPPROTO_TCP;
+	int new_conn = tcp && (tcp_flags & (OFP_TH_SYN | OFP_TH_ACK)) ==
+		OFP_TH_SYN;
+	int reply;
+
+	if (odp_unlikely(now != ct->tick))
+		ct_advance(ct, now);
+
+	/* Both directions of the flow have the same key */
+	if (memcmp(key->addr[0], key->addr[1], sizeof(key->addr[0])) > 0 ||
+	    (!memcmp(key->addr[0], key->addr[1], sizeof(key->addr[0])) &&
+	     key->port[0] > key->port[1])) {
+		uint32_t a[4];
+		uint16_t p = key->port[0];
+
+		memcpy(a, key->addr[0], sizeof(a));
+		memcpy(key->addr[0], key->addr[1], sizeof(a));
+		memcpy(key->addr[1], a, sizeof(a));
+		key->port[0] = key->port[1];
+		key->port[1] = p;
+		side = 1;
+	}
+
+	hash = ct_hash(key);
+	for (idx = ct->bucket[hash & ct->mask]; idx; idx = f->hash_next) {
+		f = &ct->flow[idx - 1];
+		if (!memcmp(&f->key, key, sizeof(*key)))
+			break;
+	}
+
+	if (idx && tcp && new_conn && f->state == CT_CLOSE) {
+		/* A new connection of the same ports */
+		ct_flow_expire(f);
+		f->orig = side;
+		f->state = CT_NEW;
+		f->fin = 0;
+	} else if (!idx) {
+		if (tcp && (tcp_flags & OFP_TH_RST))
+			return OFP_PKT_CONTINUE;
+		f = ct_flow_alloc(ct);
+		if (!f)
+			return OFP_PKT_CONTINUE;
+		f->key = *key;
+		f->orig = side;
+		/* TCP picked up in the middle is taken as established */
+		f->state = (tcp && !new_conn) ? CT_EST : CT_NEW;
+		f->fin = 0;
+		f->hash_next = ct->bucket[hash & ct->mask];
+		ct->bucket[hash & ct->mask] = ct_idx(ct, f);
+		f->expire = now + ct_timeout(ct, f);
+		ct_wheel_link(ct, f);
+	}
+
+	reply = side != f->orig;
+	state = f->state;
+	if (tcp)
+		ct_tcp_update(f, reply, tcp_flags);
+	else if (reply)
+		f->state = CT_EST;
+
+	f->expire = now + ct_timeout(ct, f);
+	/* An earlier expiry than the slot must be linked again */
+	if (f->state != state) {
+		ct_wheel_unlink(ct, f);
+		ct_wheel_link(ct, f);
+	}
+
+	ua->valid |= OFP_UA_CT;
+	ua->ct_flow = f;
+	ua->ct_reply = reply;
+
+	if (odp_unlikely(f->action == OFP_CT_ACTION_DROP)) {
+		OFP_DROP_STAT(CT_DROP);
+		return OFP_PKT_DROP;
+	}
+	return OFP_PKT_CONTINUE;
+}
+
+/* Ports, or the identifier of ICMP echo, and TCP flags */
+static inline void ct_l4_key(struct ofp_ct_key *key, const uint8_t *l4,
+			     uint32_t len, uint8_t *tcp_flags)
+{
+	switch (key->proto) {
+	case OFP_IPPROTO_TCP:
+		if (len < sizeof(struct ofp_tcphdr))
+			return;
+		*tcp_flags = ((const struct ofp_tcphdr *)l4)->th_flags;
+		/* Fallthrough */
+	case OFP_IPPROTO_UDP:
+	case OFP_IPPROTO_SCTP:
+		if (len < 4)
+			return;
+		memcpy(&key->port[0], l4, sizeof(key->port[0]));
+		memcpy(&key->port[1], l4 + 2, sizeof(key->port[1]));
+		break;
+	case OFP_IPPROTO_ICMP:
+		if (len < 6 || (l4[0] != OFP_ICMP_ECHO &&
+				l4[0] != OFP_ICMP_ECHOREPLY))
+			return;
+		memcpy(&key->port[0], l4 + 4, sizeof(key->port[0]));
+		key->port[1] = key->port[0];
+		break;
+	case OFP_IPPROTO_ICMPV6:
+		if (len < 6 || (l4[0] != OFP_ICMP6_ECHO_REQUEST &&
+				l4[0] != OFP_ICMP6_ECHO_REPLY))
+			return;
+		memcpy(&key->port[0], l4 + 4, sizeof(key->port[0]));
+		key->port[1] = key->port[0];
+		break;
+	}
+}
+
+enum ofp_return_code ofp_ct_ipv4_input(odp_packet_t pkt, uint16_t vrf)
+{
+	struct ofp_ct_key key;
+	uint32_t len, hlen;
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, &len);
+	uint8_t tcp_flags = 0;
+
+	/* Forwarded fragments lack the ports of the flow */
+	if (odp_be_to_cpu_16(ip->ip_off) & (OFP_IP_MF | OFP_IP_OFFMASK))
+		return OFP_PKT_CONTINUE;
+
+	memset(&key, 0, sizeof(key));
+	key.addr[0][0] = ip->ip_src.s_addr;
+	key.addr[1][0] = ip->ip_dst.s_addr;
+	key.vrf = vrf;
+	key.proto = ip->ip_p;
+	key.family = CT_FAMILY_V4;
+
+	hlen = ip->ip_hl << 2;
+	if (len > hlen)
+		ct_l4_key(&key, (uint8_t *)ip + hlen, len - hlen, &tcp_flags);
+
+	return ct_input(pkt, &key, tcp_flags);
+}
+
+enum ofp_return_code ofp_ct_ipv6_input(odp_packet_t pkt, uint16_t vrf)
+{
+	struct ofp_ct_key key;
+	uint32_t len;
+	struct ofp_ip6_hdr *ip6 = odp_packet_l3_ptr(pkt, &len);
+	uint8_t tcp_flags = 0;
+
+	if (ip6->ofp_ip6_nxt == OFP_IPPROTO_FRAGMENT)
+		return OFP_PKT_CONTINUE;
+
+	memset(&key, 0, sizeof(key));
+	memcpy(key.addr[0], &ip6->ip6_src, sizeof(key.addr[0]));
+	memcpy(key.addr[1], &ip6->ip6_dst, sizeof(key.addr[1]));
+	key.vrf = vrf;
+	key.proto = ip6->ofp_ip6_nxt;
+	key.family = CT_FAMILY_V6;
+
+	if (len > sizeof(*ip6))
+		ct_l4_key(&key, (uint8_t *)(ip6 + 1), len - sizeof(*ip6),
+			  &tcp_flags);
+
+	return ct_input(pkt, &key, tcp_flags);
+}
+
+struct ofp_ct_flow *ofp_ct_packet_flow(odp_packet_t pkt, int *reply)
+{
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(pkt);
+
+	if (!(ua->valid & OFP_UA_CT))
+		return NULL;
+	if (reply)
+		*reply = ua->ct_reply;
+	return ua->ct_flow;
+}
+
+enum ofp_ct_state ofp_ct_flow_state(const struct ofp_ct_flow *flow)
+{
+	switch (flow->state) {
+	case CT_EST:
+		return OFP_CT_ESTABLISHED;
+	case CT_FIN:
+	case CT_CLOSE:
+		return OFP_CT_CLOSING;
+	default:
+		return OFP_CT_NEW;
+	}
+}
+
+void ofp_ct_flow_action_set(struct ofp_ct_flow *flow,
+			    enum ofp_ct_action action)
+{
+	flow->action = action;
+}
+
+void *ofp_ct_flow_data(struct ofp_ct_flow *flow)
+{
+	return flow->data;
+}
+
+int ofp_ct_age(void)
+{
+	struct ofp_ct_table *ct = ofp_ct_table;
+	uint32_t now;
+
+	if (!ct)
+		return 0;
+	now = ct_now();
+	if (now == ct->tick)
+		return 0;
+	return ct_advance(ct, now);
+}
+
+static uint32_t ct_ticks(int sec)
+{
+	return (uint32_t)(((uint64_t)sec * ODP_TIME_SEC_IN_NS) >>
+			  CT_TICK_SHIFT) + 1;
+}
+
+int ofp_ct_init_local(void)
+{
+	struct ofp_ct_table *ct;
+	uint32_t size = 1, i;
+	void *p;
+
+	ofp_ct_table = NULL;
+
+	if (global_param->conntrack.entries <= 0)
+		return 0;
+
+	while (size < (uint32_t)global_param->conntrack.entries)
+		size <<= 1;
+
+	ct = calloc(1, sizeof(*ct));
+	if (!ct ||
+	    posix_memalign(&p, ODP_CACHE_LINE_SIZE,
+			   size * sizeof(struct ofp_ct_flow))) {
+		OFP_ERR("Connection tracking table allocation failed");
+		free(ct);
+		return -1;
+	}
+	memset(p, 0, size * sizeof(struct ofp_ct_flow));
+	ct->flow = p;
+	ct->bucket = calloc(size, sizeof(*ct->bucket));
+	if (!ct->bucket) {
+		OFP_ERR("Connection tracking table allocation failed");
+		free(ct->flow);
+		free(ct);
+		return -1;
+	}
+
+	ct->mask = size - 1;
+	/* Free list through hash_next */
+	for (i = 0; i < size; i++)
+		ct->flow[i].hash_next = i + 1 < size ? i + 2 : 0;
+	ct->free = 1;
+	ct->tick = ct_now();
+	ct->tmo_tcp = ct_ticks(global_param->conntrack.tcp_timeout);
+	ct->tmo_udp = ct_ticks(global_param->conntrack.udp_timeout);
+	ct->tmo_close = ct_ticks(OFP_CT_TCP_CLOSE_TIMEOUT);
+	ct->tmo = ct_ticks(global_param->conntrack.timeout);
+
+	ofp_ct_table = ct;
+	return 0;
+}
+
+int ofp_ct_term_local(void)
+{
+	struct ofp_ct_table *ct = ofp_ct_table;
+
+	if (!ct)
+		return 0;
+
+	ofp_ct_table = NULL;
+	free(ct->bucket);
+	free(ct->flow);
+	free(ct);
+	return 0;
+}
@@ -0,0 +1,175 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include <odp_api.h>
+
+#include "ofpi_coroutine.h"
+#include "ofpi_config.h"
+#include "ofpi_log.h"
+
+struct ofp_coroutine {
+	ucontext_t ctx;
+	void (*func)(void *arg);
+	void *arg;
+	/* Flag that ends the wait, NULL if runnable */
+	int *wait;
+	int done;
+	struct ofp_coroutine *next;
+	void *stack;
+};
+
+/*
+ * Coroutines of the thread. New ones are kept apart until the next
+ * ofp_coroutine_run() so that the list does not change under it.
+ */
+static __thread struct {
+	ucontext_t main;
+	struct ofp_coroutine *list;
+	struct ofp_coroutine *added;
+	int num;
+} co;
+
+__thread struct ofp_coroutine *ofp_coroutine_cur;
+
+static void coroutine_main(void)
+{
+	struct ofp_coroutine *c = ofp_coroutine_cur;
+
+	c->func(c->arg);
+	c->done = 1;
+	/* Returns to co.main through uc_link */
+}
+
+static void coroutine_free(struct ofp_coroutine *c)
+{
+	free(c->stack);
+	free(c);
+	co.num--;
+}
+
+int ofp_coroutine_create(void (*func)(void *arg), void *arg,
+			 size_t stack_size)
+{
+	struct ofp_coroutine *c, **pp;
+
+	if (!func)
+		return -1;
+	if (!stack_size)
+		stack_size = OFP_COROUTINE_STACK_SIZE;
+
+	c = calloc(1, sizeof(*c));
+	if (!c)
+		return -1;
+	c->stack = malloc(stack_size);
+	if (!c->stack || getcontext(&c->ctx)) {
+		OFP_ERR("Coroutine allocation failed");
+		free(c->stack);
+		free(c);
+		return -1;
+	}
+	c->ctx.uc_stack.ss_sp = c->stack;
+	c->ctx.uc_stack.ss_size = stack_size;
+	c->ctx.uc_link = &co.main;
+	makecontext(&c->ctx, coroutine_main, 0);
+	c->func = func;
+	c->arg = arg;
+
+	for (pp = &co.added; *pp; pp = &(*pp)->next)
+		;
+	*pp = c;
+	co.num++;
+
+	return 0;
+}
+
+void ofp_coroutine_yield(void)
+{
+	if (ofp_in_coroutine())
+		swapcontext(&ofp_coroutine_cur->ctx, &co.main);
+}
+
+void ofp_coroutine_wait(int *go)
+{
+	ofp_coroutine_cur->wait = go;
+	swapcontext(&ofp_coroutine_cur->ctx, &co.main);
+}
+
+int ofp_coroutine_run(void)
+{
+	struct ofp_coroutine *c, **pp;
+	int num = 0;
+
+	if (odp_likely(!co.list && !co.added) || ofp_in_coroutine())
+		return 0;
+
+	/* Coroutines created since the last run go first */
+	if (co.added) {
+		for (pp = &co.added; *pp; pp = &(*pp)->next)
+			;
+		*pp = co.list;
+		co.list = co.added;
+		co.added = NULL;
+	}
+
+	pp = &co.list;
+	while ((c = *pp)) {
+		if (c->wait && !__atomic_load_n(c->wait, __ATOMIC_ACQUIRE)) {
+			pp = &c->next;
+			continue;
+		}
+		c->wait = NULL;
+		ofp_coroutine_cur = c;
+		swapcontext(&co.main, &c->ctx);
+		ofp_coroutine_cur = NULL;
+		num++;
+
+		if (c->done) {
+			*pp = c->next;
+			coroutine_free(c);
+		} else {
+			pp = &c->next;
+		}
+	}
+
+	return num;
+}
+
+int ofp_coroutine_runnable(void)
+{
+	struct ofp_coroutine *c;
+
+	if (co.added)
+		return 1;
+	for (c = co.list; c; c = c->next)
+		if (!c->wait || __atomic_load_n(c->wait, __ATOMIC_ACQUIRE))
+			return 1;
+	return 0;
+}
+
+int ofp_coroutine_count(void)
+{
+	return co.num;
+}
+
+void ofp_coroutine_term_local(void)
+{
+	struct ofp_coroutine *c;
+
+	if (co.num)
+		OFP_INFO("%d coroutines freed unfinished", co.num);
+
+	while ((c = co.added)) {
+		co.added = c->next;
+		coroutine_free(c);
+	}
+	while ((c = co.list)) {
+		co.list = c->next;
+		coroutine_free(c);
+	}
+}
@@ -5,21 +5,79 @@
  * SPDX-License-Identifier:     BSD-3-Clause
  */
 
+/*
+ * Packet capture. Threads that see a captured packet copy up to snaplen
+ * bytes of it into their own single producer ring. A writer thread on
+ * the slow path core drains the rings into a pcapng file, so that the
+ * packet path does not do file IO. When a ring is full the packet is
+ * not captured and the drop counter of the ring is increased.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <odp/helper/odph_api.h>
+
+#include "ofpi_config.h"
 #include "ofpi_debug.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
+#include "ofpi_ethernet.h"
+#include "ofpi_in.h"
 
 #define SHM_NAME_PCAP "OfpPcapShMem"
 #define PCAP_FILE_NAME_MAX_SIZE 128
+#define PCAP_FILTER_MAX 128
+#define PCAP_RING_MASK (OFP_PCAP_RING_SIZE - 1)
+#define PCAP_PORTS (OFP_DEBUG_PCAP_PORT_MASK + 1)
+/* Idle sleep of the writer thread */
+#define PCAP_WRITER_IDLE_US 1000
+
+ODP_STATIC_ASSERT((OFP_PCAP_RING_SIZE & PCAP_RING_MASK) == 0,
+		  "OFP_PCAP_RING_SIZE not a power of two");
+
+/* Filter fields in use */
+#define PF_ETHER 0x1
+#define PF_VLAN  0x2
+#define PF_PROTO 0x4
+#define PF_HOST  0x8
+#define PF_PORT  0x10
+
+struct ofp_pcap_filter {
+	uint32_t flags;
+	uint16_t ethertype;
+	uint16_t vlan;
+	uint32_t host;		/* Network byte order */
+	uint16_t port;
+	uint8_t  proto;
+	char     expr[PCAP_FILTER_MAX];
+};
+
+struct pcap_slot {
+	uint64_t ts_ns;		/* Real time */
+	uint32_t len;
+	uint32_t caplen;
+	uint32_t flag;
+	uint16_t port;
+	uint8_t  data[OFP_PCAP_SNAPLEN_MAX];
+};
+
+struct pcap_ring {
+	/* Written by the capturing thread */
+	uint32_t head ODP_ALIGNED_CACHE;
+	uint64_t drops;
+	uint64_t captured;
+	/* Written by the writer thread */
+	uint32_t tail ODP_ALIGNED_CACHE;
+	struct pcap_slot slot[OFP_PCAP_RING_SIZE] ODP_ALIGNED_CACHE;
+};
 
 struct ofp_pcap_mem {
 	odp_rwlock_t lock_pcap_rw;
@@ -27,6 +85,26 @@ struct ofp_pcap_mem {
 	int   pcap_first;
 	int   pcap_is_fifo;
 	char  pcap_file_name[PCAP_FILE_NAME_MAX_SIZE];
+
+	uint32_t snaplen;
+	/* Filters are switched, not modified in place */
+	struct ofp_pcap_filter filter[2];
+	uint32_t filter_idx;
+
+	/* Rotation, done by the writer thread only */
+	uint64_t rotate_size;
+	int rotate_count;
+	uint64_t file_bytes;
+	/* pcapng interface id of each port in the current file, or -1 */
+	int idb[PCAP_PORTS];
+	int num_idb;
+
+	odph_thread_t writer;
+	int writer_run;
+	int writer_started;
+
+	int num_ring;
+	struct pcap_ring ring[];
 };
 static __thread struct ofp_pcap_mem *shm;
 
@@ -43,79 +121,536 @@ static __thread struct ofp_pcap_mem *shm;
 	(IS_KNI(flag) ? OFP_DEBUG_PCAP_KNI : 0) | \
 	(IS_TX(flag) ? OFP_DEBUG_PCAP_TX : 0))
 
-/* PCAP */
+static uint64_t pcap_shm_size(int num_ring)
+{
+	return sizeof(struct ofp_pcap_mem) +
+		(uint64_t)num_ring * sizeof(struct pcap_ring);
+}
+
+/*
+ * Filter
+ */
+static int filter_match(const struct ofp_pcap_filter *f, odp_packet_t pkt)
+{
+	const uint8_t *p = odp_packet_data(pkt);
+	uint32_t len = odp_packet_seg_len(pkt);
+	uint32_t off = 14, l4 = 0;
+	uint16_t ethertype, vlan = 0;
+	const uint8_t *ip;
+	uint8_t proto;
+
+	if (len < 14)
+		return 0;
+
+	ethertype = p[12] << 8 | p[13];
+	if (ethertype == OFP_ETHERTYPE_VLAN && len >= 18) {
+		vlan = (p[14] << 8 | p[15]) & 0xfff;
+		ethertype = p[16] << 8 | p[17];
+		off = 18;
+	}
+
+	if ((f->flags & PF_VLAN) && vlan != f->vlan)
+		return 0;
+	if ((f->flags & PF_ETHER) && ethertype != f->ethertype)
+		return 0;
+	if (!(f->flags & (PF_PROTO | PF_HOST | PF_PORT)))
+		return 1;
+
+	ip = p + off;
+	if (ethertype == OFP_ETHERTYPE_IP && len >= off + 20) {
+		proto = ip[9];
+		if ((f->flags & PF_HOST) && memcmp(ip + 12, &f->host, 4) &&
+		    memcmp(ip + 16, &f->host, 4))
+			return 0;
+		/* No ports in non-first fragments */
+		if (!((ip[6] & 0x1f) | ip[7]))
+			l4 = off + (ip[0] & 0xf) * 4;
+	} else if (ethertype == OFP_ETHERTYPE_IPV6 && len >= off + 40) {
+		proto = ip[6];
+		if (f->flags & PF_HOST)
+			return 0;
+		l4 = off + 40;
+	} else {
+		return 0;
+	}
+
+	if ((f->flags & PF_PROTO) && proto != f->proto)
+		return 0;
+
+	if (f->flags & PF_PORT) {
+		uint16_t sport, dport;
+
+		if ((proto != OFP_IPPROTO_TCP && proto != OFP_IPPROTO_UDP) ||
+		    !l4 || len < l4 + 4)
+			return 0;
+		sport = p[l4] << 8 | p[l4 + 1];
+		dport = p[l4 + 2] << 8 | p[l4 + 3];
+		if (sport != f->port && dport != f->port)
+			return 0;
+	}
+
+	return 1;
+}
+
+int ofp_debug_filter_match(odp_packet_t pkt)
+{
+	const struct ofp_pcap_filter *f;
+
+	f = &shm->filter[__atomic_load_n(&shm->filter_idx, __ATOMIC_ACQUIRE)];
+	if (odp_likely(!f->flags))
+		return 1;
+	return filter_match(f, pkt);
+}
+
+static int parse_proto(const char *s, uint8_t *proto)
+{
+	char *end;
+	long v;
+
+	if (!strcmp(s, "tcp"))
+		*proto = OFP_IPPROTO_TCP;
+	else if (!strcmp(s, "udp"))
+		*proto = OFP_IPPROTO_UDP;
+	else if (!strcmp(s, "icmp"))
+		*proto = OFP_IPPROTO_ICMP;
+	else {
+		v = strtol(s, &end, 0);
+		if (*end || v < 0 || v > 255)
+			return -1;
+		*proto = v;
+	}
+	return 0;
+}
+
+static int parse_filter(const char *expr, struct ofp_pcap_filter *f)
+{
+	char buf[PCAP_FILTER_MAX], *tok, *arg, *save = NULL, *end;
+	const char *sep = " ,=";
+	unsigned int a, b, c, d;
+	long v;
+
+	memset(f, 0, sizeof(*f));
+	strncpy(buf, expr, sizeof(buf) - 1);
+	buf[sizeof(buf) - 1] = 0;
+	strcpy(f->expr, buf);
+
+	for (tok = strtok_r(buf, sep, &save); tok;
+	     tok = strtok_r(NULL, sep, &save)) {
+		if (!strcmp(tok, "none"))
+			continue;
+		if (!strcmp(tok, "ip")) {
+			f->flags |= PF_ETHER;
+			f->ethertype = OFP_ETHERTYPE_IP;
+			continue;
+		}
+		if (!strcmp(tok, "ip6")) {
+			f->flags |= PF_ETHER;
+			f->ethertype = OFP_ETHERTYPE_IPV6;
+			continue;
+		}
+		if (!strcmp(tok, "arp")) {
+			f->flags |= PF_ETHER;
+			f->ethertype = OFP_ETHERTYPE_ARP;
+			continue;
+		}
+		if (!parse_proto(tok, &f->proto) && strcmp(tok, "0") &&
+		    (tok[0] < '0' || tok[0] > '9')) {
+			f->flags |= PF_PROTO;
+			continue;
+		}
+
+		/* Primitives with an argument */
+		arg = strtok_r(NULL, sep, &save);
+		if (!arg)
+			return -1;
+
+		if (!strcmp(tok, "proto")) {
+			if (parse_proto(arg, &f->proto))
+				return -1;
+			f->flags |= PF_PROTO;
+		} else if (!strcmp(tok, "host")) {
+			if (sscanf(arg, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 ||
+			    a > 255 || b > 255 || c > 255 || d > 255)
+				return -1;
+			f->host = odp_cpu_to_be_32(a << 24 | b << 16 |
+						   c << 8 | d);
+			f->flags |= PF_HOST;
+		} else if (!strcmp(tok, "port")) {
+			v = strtol(arg, &end, 0);
+			if (*end || v < 0 || v > 0xffff)
+				return -1;
+			f->port = v;
+			f->flags |= PF_PORT;
+		} else if (!strcmp(tok, "vlan")) {
+			v = strtol(arg, &end, 0);
+			if (*end || v < 0 || v > 0xfff)
+				return -1;
+			f->vlan = v;
+			f->flags |= PF_VLAN;
+		} else {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int ofp_set_capture_filter(const char *expr)
+{
+	struct ofp_pcap_filter *f;
+	uint32_t idx;
+
+	odp_rwlock_write_lock(&shm->lock_pcap_rw);
+
+	idx = shm->filter_idx ^ 1;
+	f = &shm->filter[idx];
+	if (parse_filter(expr ? expr : "", f)) {
+		odp_rwlock_write_unlock(&shm->lock_pcap_rw);
+		return -1;
+	}
+	__atomic_store_n(&shm->filter_idx, idx, __ATOMIC_RELEASE);
+
+	odp_rwlock_write_unlock(&shm->lock_pcap_rw);
+	return 0;
+}
+
+void ofp_get_capture_filter(char *expr, int max_size)
+{
+	odp_rwlock_write_lock(&shm->lock_pcap_rw);
+
+	strncpy(expr, shm->filter[shm->filter_idx].expr, max_size - 1);
+	expr[max_size - 1] = 0;
+
+	odp_rwlock_write_unlock(&shm->lock_pcap_rw);
+}
+
+void ofp_set_capture_snaplen(uint32_t snaplen)
+{
+	if (snaplen == 0 || snaplen > OFP_PCAP_SNAPLEN_MAX)
+		snaplen = OFP_PCAP_SNAPLEN_MAX;
+	shm->snaplen = snaplen;
+}
+
+uint32_t ofp_get_capture_snaplen(void)
+{
+	return shm->snaplen;
+}
+
+void ofp_set_capture_rotate(uint64_t size, int count)
+{
+	odp_rwlock_write_lock(&shm->lock_pcap_rw);
+	shm->rotate_size = size;
+	shm->rotate_count = count > 1 ? count : 1;
+	odp_rwlock_write_unlock(&shm->lock_pcap_rw);
+}
+
+uint64_t ofp_get_capture_drops(void)
+{
+	uint64_t drops = 0;
+	int i;
+
+	for (i = 0; i < shm->num_ring; i++)
+		drops += __atomic_load_n(&shm->ring[i].drops,
+					 __ATOMIC_RELAXED);
+	return drops;
+}
+
+uint64_t ofp_get_capture_count(void)
+{
+	uint64_t cnt = 0;
+	int i;
+
+	for (i = 0; i < shm->num_ring; i++)
+		cnt += __atomic_load_n(&shm->ring[i].captured,
+				       __ATOMIC_RELAXED);
+	return cnt;
+}
+
+/*
+ * Capture, called on the packet path
+ */
 void ofp_save_packet_to_pcap_file(uint32_t flag, odp_packet_t pkt, int port)
 {
-#define PUT16(x) do {					\
-uint16_t val16 = x; fwrite(&val16, 2, 1, shm->pcap_fd);	\
-} while (0)
-#define PUT32(x) do {					\
-uint32_t val32 = x; fwrite(&val32, 4, 1, shm->pcap_fd);	\
-} while (0)
-	struct timeval t;
+	struct pcap_ring *ring;
+	struct pcap_slot *slot;
+	struct timespec ts;
+	uint32_t head, len;
+	int thr;
 
 	if ((ofp_debug_capture_ports &
 	     (1 << (port & OFP_DEBUG_PCAP_PORT_MASK))) == 0)
 		return;
 
-	odp_rwlock_write_lock(&shm->lock_pcap_rw);
+	thr = odp_thread_id();
+	if (odp_unlikely(thr < 0 || thr >= shm->num_ring))
+		return;
+	ring = &shm->ring[thr];
 
-	if (shm->pcap_first) {
-		/*int n = ufp_get_num_ports(), i;*/
-		struct stat st;
-
-		shm->pcap_is_fifo = 0;
-		if (stat(shm->pcap_file_name, &st) == 0)
-			shm->pcap_is_fifo = (st.st_mode & S_IFIFO) != 0;
-
-		shm->pcap_fd = fopen(shm->pcap_file_name, "w");
-		if (!shm->pcap_fd)
-			goto out;
-
-		/* Global header */
-		PUT32(0xa1b2c3d4); /* Byte order magic */
-		PUT16(2); PUT16(4); /* Version major & minor */
-		PUT32(0); /* Timezone */
-		PUT32(0); /* Accuracy */
-		PUT32(0xffff); /* Snaplen */
-		PUT32(1); /* Ethernet */
-
-		shm->pcap_first = 0;
-	} else if (shm->pcap_fd == NULL) {
-		shm->pcap_fd = fopen(shm->pcap_file_name, "a");
-		if (!shm->pcap_fd)
-			goto out;
-	}
-
-	/* Header */
-	/* Timestamp */
-	gettimeofday(&t, NULL);
-	PUT32(t.tv_sec);
-	PUT32(t.tv_usec);
-
-	PUT32(odp_packet_len(pkt)); /* Saved packet len -- segment len */
-	PUT32(odp_packet_len(pkt)); /* Captured packet len -- packet len */
-
-	/* Data */
-	if (ofp_debug_capture_ports & OFP_DEBUG_PCAP_CONF_ADD_INFO) {
-		fputc(GET_PCAP_CONF_ADD_INFO(port, flag), shm->pcap_fd);
-		/* Packet data */
-		fwrite((uint8_t *) odp_packet_data(pkt) + 1, 1,
-		       odp_packet_len(pkt) - 1, shm->pcap_fd);
-	} else {
-		/* Packet data */
-		fwrite(odp_packet_data(pkt), 1,
-		       odp_packet_len(pkt), shm->pcap_fd);
+	head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+	    OFP_PCAP_RING_SIZE) {
+		ring->drops++;
+		return;
 	}
 
-	if (!shm->pcap_is_fifo) {
+	slot = &ring->slot[head & PCAP_RING_MASK];
+	len = odp_packet_len(pkt);
+	slot->len = len;
+	slot->caplen = len < shm->snaplen ? len : shm->snaplen;
+	slot->flag = flag;
+	slot->port = port & OFP_DEBUG_PCAP_PORT_MASK;
+	odp_packet_copy_to_mem(pkt, 0, slot->caplen, slot->data);
+
+	if ((ofp_debug_capture_ports & OFP_DEBUG_PCAP_CONF_ADD_INFO) &&
+	    slot->caplen)
+		slot->data[0] = GET_PCAP_CONF_ADD_INFO(slot->port, flag);
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	slot->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+	ring->captured++;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * pcapng output, done by the writer thread with lock_pcap_rw held
+ */
+#define PCAPNG_SHB 0x0a0d0d0a
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER 0x1a2b3c4d
+#define PCAPNG_OPT_END 0
+#define PCAPNG_OPT_COMMENT 1
+#define PCAPNG_IF_NAME 2
+#define PCAPNG_IF_TSRESOL 9
+#define PCAPNG_EPB_FLAGS 2
+#define PCAPNG_LINKTYPE_ETHERNET 1
+
+#define PAD4(x) (((x) + 3) & ~3U)
+
+static void put32(uint32_t v)
+{
+	fwrite(&v, 4, 1, shm->pcap_fd);
+}
+
+static void put16(uint16_t v)
+{
+	fwrite(&v, 2, 1, shm->pcap_fd);
+}
+
+static void put_opt(uint16_t code, const void *val, uint16_t len)
+{
+	static const uint8_t zero[4];
+
+	put16(code);
+	put16(len);
+	fwrite(val, 1, len, shm->pcap_fd);
+	fwrite(zero, 1, PAD4(len) - len, shm->pcap_fd);
+}
+
+static void write_shb(void)
+{
+	uint32_t total = 28;
+
+	put32(PCAPNG_SHB);
+	put32(total);
+	put32(PCAPNG_BYTE_ORDER);
+	put16(1); put16(0); /* Version major & minor */
+	put32(0xffffffff); put32(0xffffffff); /* Section length unknown */
+	put32(total);
+	shm->file_bytes += total;
+}
+
+static int write_idb(int port)
+{
+	char name[16];
+	uint8_t tsresol = 9; /* Nanoseconds */
+	uint16_t nlen;
+	uint32_t total;
+
+	nlen = snprintf(name, sizeof(name), "port%d", port);
+	total = 20 + 4 + PAD4(nlen) + 4 + PAD4(1) + 4;
+
+	put32(PCAPNG_IDB);
+	put32(total);
+	put16(PCAPNG_LINKTYPE_ETHERNET);
+	put16(0);
+	put32(shm->snaplen);
+	put_opt(PCAPNG_IF_NAME, name, nlen);
+	put_opt(PCAPNG_IF_TSRESOL, &tsresol, 1);
+	put16(PCAPNG_OPT_END); put16(0);
+	put32(total);
+	shm->file_bytes += total;
+
+	shm->idb[port] = shm->num_idb;
+	return shm->num_idb++;
+}
+
+static void write_epb(const struct pcap_slot *slot)
+{
+	static const char sp[] = "slow path";
+	static const uint8_t zero[4];
+	uint32_t epb_flags = IS_TX(slot->flag) ? 2 : 1; /* Out : in */
+	uint32_t total;
+	int id;
+
+	id = shm->idb[slot->port];
+	if (id < 0)
+		id = write_idb(slot->port);
+
+	total = 28 + PAD4(slot->caplen) + 8 + 4;
+	if (IS_KNI(slot->flag))
+		total += 4 + PAD4(sizeof(sp) - 1);
+
+	put32(PCAPNG_EPB);
+	put32(total);
+	put32(id);
+	put32(slot->ts_ns >> 32);
+	put32(slot->ts_ns);
+	put32(slot->caplen);
+	put32(slot->len);
+	fwrite(slot->data, 1, slot->caplen, shm->pcap_fd);
+	fwrite(zero, 1, PAD4(slot->caplen) - slot->caplen, shm->pcap_fd);
+	put_opt(PCAPNG_EPB_FLAGS, &epb_flags, 4);
+	if (IS_KNI(slot->flag))
+		put_opt(PCAPNG_OPT_COMMENT, sp, sizeof(sp) - 1);
+	put16(PCAPNG_OPT_END); put16(0);
+	put32(total);
+	shm->file_bytes += total;
+}
+
+static void pcap_close_file(void)
+{
+	if (shm->pcap_fd) {
 		fclose(shm->pcap_fd);
 		shm->pcap_fd = NULL;
-	} else {
-		fflush(shm->pcap_fd);
 	}
-out:
+}
+
+/* Shift name.N-2 to name.N-1, ..., name to name.1 */
+static void pcap_rotate(void)
+{
+	char from[PCAP_FILE_NAME_MAX_SIZE + 8], to[PCAP_FILE_NAME_MAX_SIZE + 8];
+	int i;
+
+	pcap_close_file();
+
+	for (i = shm->rotate_count - 1; i > 0; i--) {
+		if (i > 1)
+			snprintf(from, sizeof(from), "%s.%d",
+				 shm->pcap_file_name, i - 1);
+		else
+			snprintf(from, sizeof(from), "%s",
+				 shm->pcap_file_name);
+		snprintf(to, sizeof(to), "%s.%d", shm->pcap_file_name, i);
+		rename(from, to);
+	}
+	shm->pcap_first = 1;
+}
+
+static int pcap_open_file(void)
+{
+	struct stat st;
+	int i;
+
+	if (shm->pcap_fd)
+		return 0;
+
+	shm->pcap_is_fifo = 0;
+	if (stat(shm->pcap_file_name, &st) == 0)
+		shm->pcap_is_fifo = (st.st_mode & S_IFIFO) != 0;
+
+	/* Files are always written from the start, see pcap_first */
+	shm->pcap_fd = fopen(shm->pcap_file_name, "w");
+	if (!shm->pcap_fd)
+		return -1;
+
+	shm->pcap_first = 0;
+	shm->file_bytes = 0;
+	shm->num_idb = 0;
+	for (i = 0; i < PCAP_PORTS; i++)
+		shm->idb[i] = -1;
+	write_shb();
+	return 0;
+}
+
+int ofp_pcap_flush(void)
+{
+	struct pcap_ring *ring;
+	uint32_t head, tail;
+	int i, n = 0;
+
+	odp_rwlock_write_lock(&shm->lock_pcap_rw);
+
+	for (i = 0; i < shm->num_ring; i++) {
+		ring = &shm->ring[i];
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		tail = ring->tail;
+
+		for (; tail != head; tail++, n++) {
+			if (shm->rotate_size && !shm->pcap_is_fifo &&
+			    shm->file_bytes >= shm->rotate_size)
+				pcap_rotate();
+			/* Packets are discarded while the file cannot be */
+			/* opened */
+			if (pcap_open_file() == 0)
+				write_epb(&ring->slot[tail & PCAP_RING_MASK]);
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	if (n && shm->pcap_fd)
+		fflush(shm->pcap_fd);
+
 	odp_rwlock_write_unlock(&shm->lock_pcap_rw);
+	return n;
+}
+
+static int pcap_writer(void *arg)
+{
+	shm = arg;
+
+	while (__atomic_load_n(&shm->writer_run, __ATOMIC_ACQUIRE)) {
+		if (!ofp_pcap_flush())
+			usleep(PCAP_WRITER_IDLE_US);
+	}
+	ofp_pcap_flush();
+
+	return 0;
+}
+
+int ofp_pcap_start_writer(const odp_cpumask_t *cpumask)
+{
+	odph_thread_common_param_t common_param;
+	odph_thread_param_t thr_params;
+
+	odph_thread_common_param_init(&common_param);
+	common_param.cpumask = cpumask;
+	odph_thread_param_init(&thr_params);
+	thr_params.start = pcap_writer;
+	thr_params.arg = shm;
+	thr_params.thr_type = ODP_THREAD_CONTROL;
+
+	shm->writer_run = 1;
+	if (odph_thread_create(&shm->writer, &common_param, &thr_params,
+			       1) != 1) {
+		OFP_ERR("Failed to start pcap writer thread.");
+		shm->writer_run = 0;
+		return -1;
+	}
+	shm->writer_started = 1;
+
+	return 0;
+}
+
+void ofp_pcap_stop_writer(void)
+{
+	if (!shm->writer_started)
+		return;
+
+	__atomic_store_n(&shm->writer_run, 0, __ATOMIC_RELEASE);
+	odph_thread_join(&shm->writer, 1);
+	shm->writer_started = 0;
 }
 
 void ofp_set_capture_file(const char *filename)
@@ -134,10 +669,7 @@ void ofp_set_capture_file(const char *filename)
 			break;
 		}
 
-	if (shm->pcap_fd) {
-		fclose(shm->pcap_fd);
-		shm->pcap_fd = NULL;
-	}
+	pcap_close_file();
 	shm->pcap_first = 1;
 
 	odp_rwlock_write_unlock(&shm->lock_pcap_rw);
@@ -156,6 +688,8 @@ void ofp_get_capture_file(char *filename, int max_size)
 static void sigpipe_handler(int s)
 {
 	(void) s;
+	/* The reader of the fifo went away, start a new file on the next
+	 * packet. */
 	if (shm->pcap_fd) {
 		fclose(shm->pcap_fd);
 		shm->pcap_fd = NULL;
@@ -165,7 +699,8 @@ static void sigpipe_handler(int s)
 
 static int ofp_pcap_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_PCAP, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_PCAP,
+				      pcap_shm_size(odp_thread_count_max()));
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -199,20 +734,28 @@ int ofp_pcap_lookup_shared_memory(void)
 
 void ofp_pcap_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_PCAP, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_PCAP,
+				   pcap_shm_size(odp_thread_count_max()));
 }
 
 int ofp_pcap_init_global(void)
 {
+	int i;
+
 	HANDLE_ERROR(ofp_pcap_alloc_shared_memory());
 
-	memset(shm, 0, sizeof(*shm));
+	memset(shm, 0, pcap_shm_size(odp_thread_count_max()));
 	odp_rwlock_init(&shm->lock_pcap_rw);
 	strncpy(shm->pcap_file_name, DEFAULT_DEBUG_PCAP_FILE_NAME,
 		PCAP_FILE_NAME_MAX_SIZE);
 	shm->pcap_file_name[PCAP_FILE_NAME_MAX_SIZE - 1] = 0;
 	shm->pcap_first = 1;
 	shm->pcap_fd = NULL;
+	shm->snaplen = OFP_PCAP_SNAPLEN_MAX;
+	shm->rotate_count = 1;
+	shm->num_ring = odp_thread_count_max();
+	for (i = 0; i < PCAP_PORTS; i++)
+		shm->idb[i] = -1;
 
 	if (signal(SIGPIPE, sigpipe_handler) == SIG_ERR) {
 		OFP_ERR("Failed to set SIGPIPE handler.");
@@ -0,0 +1,321 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * Packet trace. Each thread writes fixed size records into its own
+ * ring, overwriting the oldest, without locks or formatting. Readers
+ * copy the rings while they are written: the records being written
+ * during a dump may be torn, which is accepted for post-mortem use.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_debug.h"
+#include "ofpi_hash.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_stat.h"
+
+#include "api/ofp_ethernet.h"
+#include "api/ofp_stat.h"
+
+#define SHM_NAME_TRACE "OfpTraceShMem"
+#define TRACE_HASH_SEED 0x74726163
+
+struct ofp_trace_mem {
+	uint32_t num_ring;
+	uint32_t entries;
+	uint64_t ring_size;
+	uint8_t data[] ODP_ALIGNED_CACHE;
+};
+
+static __thread struct ofp_trace_mem *shm;
+
+__thread struct ofp_trace_ring *ofp_trace_ring;
+
+static uint32_t trace_entries(void)
+{
+	uint32_t n = 1;
+
+	if (global_param->trace.entries <= 0)
+		return 0;
+	while (n < (uint32_t)global_param->trace.entries)
+		n <<= 1;
+	return n;
+}
+
+static uint64_t trace_ring_size(uint32_t entries)
+{
+	uint64_t size = sizeof(struct ofp_trace_ring) +
+		entries * sizeof(struct ofp_trace_record);
+
+	return (size + ODP_CACHE_LINE_SIZE - 1) & ~(ODP_CACHE_LINE_SIZE - 1);
+}
+
+static uint64_t trace_shm_size(void)
+{
+	return sizeof(struct ofp_trace_mem) +
+		odp_thread_count_max() * trace_ring_size(trace_entries());
+}
+
+static inline struct ofp_trace_ring *trace_ring(uint32_t i)
+{
+	return (struct ofp_trace_ring *)(shm->data + i * shm->ring_size);
+}
+
+/* The flow hash, or a hash of the addresses and ports of the packet */
+static inline uint32_t trace_pkt_hash(odp_packet_t pkt)
+{
+	uint32_t key[4], off, len;
+	uint8_t *p;
+
+	if (odp_packet_has_flow_hash(pkt))
+		return odp_packet_flow_hash(pkt);
+
+	off = odp_packet_l3_offset(pkt);
+	if (off == ODP_PACKET_OFFSET_INVALID)
+		off = OFP_ETHER_HDR_LEN;
+	/* IPv4 addresses and ports, without the TTL and checksum */
+	p = odp_packet_offset(pkt, off + 12, &len, NULL);
+	if (!p || len < sizeof(key))
+		return 0;
+	memcpy(key, p, sizeof(key));
+
+	return ofp_hash_key(key, 4, TRACE_HASH_SEED);
+}
+
+void ofp_trace_record(struct ofp_trace_ring *ring, odp_packet_t pkt,
+		      int port, int stage, int verdict)
+{
+	struct ofp_trace_record *r = &ring->rec[ring->head & ring->mask];
+
+	if (stage == OFP_TRACE_RX)
+		ofp_drop_last = 0;
+
+	r->ts_ns = odp_time_local_ns();
+	r->hash = trace_pkt_hash(pkt);
+	r->port = port;
+	r->stage = stage;
+	r->verdict = verdict;
+	r->drop = (stage == OFP_TRACE_DONE && verdict == OFP_PKT_DROP) ?
+		ofp_drop_last : 0;
+
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+void ofp_trace_stages_set(uint32_t stages)
+{
+	uint32_t i;
+
+	if (!shm)
+		return;
+
+	for (i = 0; i < shm->num_ring; i++)
+		__atomic_store_n(&trace_ring(i)->stages, stages & OFP_TRACE_ALL,
+				 __ATOMIC_RELAXED);
+}
+
+uint32_t ofp_trace_stages_get(void)
+{
+	if (!shm)
+		return 0;
+
+	return __atomic_load_n(&trace_ring(0)->stages, __ATOMIC_RELAXED);
+}
+
+int ofp_trace_dump(const char *filename)
+{
+	struct ofp_trace_file_hdr hdr;
+	struct ofp_trace_ring *ring;
+	struct timespec ts;
+	uint32_t i, j, head, word[2];
+	FILE *f;
+	int rc = 0;
+
+	if (!shm) {
+		OFP_ERR("Packet trace not enabled");
+		return -1;
+	}
+
+	f = fopen(filename, "w");
+	if (!f) {
+		OFP_ERR("Failed to open %s", filename);
+		return -1;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = OFP_TRACE_MAGIC;
+	hdr.version = OFP_TRACE_VERSION;
+	hdr.num_rings = shm->num_ring;
+	hdr.entries = shm->entries;
+	hdr.local_ns = odp_time_local_ns();
+	hdr.real_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+		rc = -1;
+
+	for (i = 0; i < shm->num_ring && !rc; i++) {
+		ring = trace_ring(i);
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		word[0] = ring->thr;
+		word[1] = head;
+		if (fwrite(word, sizeof(word), 1, f) != 1)
+			rc = -1;
+		for (j = 0; j < shm->entries && !rc; j++)
+			if (fwrite(&ring->rec[(head + j) & ring->mask],
+				   sizeof(ring->rec[0]), 1, f) != 1)
+				rc = -1;
+	}
+
+	if (fclose(f))
+		rc = -1;
+	if (rc)
+		OFP_ERR("Failed to write %s", filename);
+	return rc;
+}
+
+static const char *trace_stage_str[OFP_TRACE_STAGES] = {"rx", "done", "tx"};
+static const char *trace_verdict_str[] = {"continue", "processed", "drop"};
+
+void ofp_trace_print(int fd, int num)
+{
+	struct ofp_trace_ring *ring;
+	struct ofp_trace_record r;
+	uint64_t now;
+	uint32_t i, head, n, j;
+
+	if (!shm) {
+		ofp_sendf(fd, "Packet trace not enabled\r\n");
+		return;
+	}
+
+	now = odp_time_local_ns();
+	for (i = 0; i < shm->num_ring; i++) {
+		ring = trace_ring(i);
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		if (!head)
+			continue;
+
+		n = head < shm->entries ? head : shm->entries;
+		if (num > 0 && (uint32_t)num < n)
+			n = num;
+
+		ofp_sendf(fd, "Thread %u, %u records:\r\n"
+			  "         age_us port stage  verdict    hash"
+			  "       drop\r\n", ring->thr, head);
+		for (j = head - n; j != head; j++) {
+			r = ring->rec[j & ring->mask];
+			ofp_sendf(fd, " %14lu %4u %-6s %-10s 0x%08x %s\r\n",
+				  (unsigned long)((now - r.ts_ns) / 1000),
+				  r.port,
+				  r.stage < OFP_TRACE_STAGES ?
+				  trace_stage_str[r.stage] : "?",
+				  r.stage != OFP_TRACE_DONE ? "" :
+				  r.verdict <= OFP_PKT_DROP ?
+				  trace_verdict_str[r.verdict] : "?",
+				  r.hash,
+				  r.drop && ofp_drop_reason_str(r.drop - 1) ?
+				  ofp_drop_reason_str(r.drop - 1) : "");
+		}
+		ofp_sendf(fd, "\r\n");
+	}
+}
+
+int ofp_trace_init_local(void)
+{
+	int thr = odp_thread_id();
+
+	ofp_trace_ring = NULL;
+	if (shm && thr >= 0 && (uint32_t)thr < shm->num_ring)
+		ofp_trace_ring = trace_ring(thr);
+
+	return 0;
+}
+
+static int ofp_trace_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_TRACE, trace_shm_size());
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_trace_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_TRACE) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_trace_lookup_shared_memory(void)
+{
+	if (!trace_entries())
+		return 0;
+
+	shm = ofp_shared_memory_lookup(SHM_NAME_TRACE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_trace_init_prepare(void)
+{
+	if (trace_entries())
+		ofp_shared_memory_prealloc(SHM_NAME_TRACE, trace_shm_size());
+}
+
+int ofp_trace_init_global(void)
+{
+	struct ofp_trace_ring *ring;
+	uint32_t i;
+
+	if (!trace_entries())
+		return 0;
+
+	HANDLE_ERROR(ofp_trace_alloc_shared_memory());
+
+	memset(shm, 0, trace_shm_size());
+	shm->num_ring = odp_thread_count_max();
+	shm->entries = trace_entries();
+	shm->ring_size = trace_ring_size(shm->entries);
+	for (i = 0; i < shm->num_ring; i++) {
+		ring = trace_ring(i);
+		ring->mask = shm->entries - 1;
+		ring->stages = global_param->trace.stages & OFP_TRACE_ALL;
+		ring->thr = i;
+	}
+
+	return 0;
+}
+
+int ofp_trace_term_global(void)
+{
+	int rc = 0;
+
+	if (!trace_entries())
+		return 0;
+
+	if (ofp_trace_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_trace_free_shared_memory(), rc);
+
+	return rc;
+}
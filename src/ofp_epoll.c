@@ -5,35 +5,57 @@
  * SPDX-License-Identifier:     BSD-3-Clause
  */
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include "ofp_epoll.h"
 #include "ofpi_epoll.h"
 #include "ofp_errno.h"
+#include "ofpi_sockstate.h"
+#include "ofpi_protosw.h"
+
+/*
+ * Each socket has EPOLL_SOCKET_ITEMS registration items. An item in use
+ * is on the item list of its epoll instance, and on the ready list when
+ * the socket may be ready. Socket wakeups put items on the ready list,
+ * and epoll_wait() only visits the ready list.
+ *
+ * Item and list changes are protected by the lock of the epoll
+ * instance. Allocation of items is serialized by the so_rcv lock of
+ * the socket, which is taken before the epoll lock.
+ *
+ * A thread waiting outside OFP, e.g. in the kernel together with
+ * kernel fds, arms the eventfd of the instance with an empty ready
+ * list. The first item put on the ready list then signals it once.
+ */
 
-#define LENGTH(array) \
-	sizeof(array)/sizeof(*array)
-#define FOREACH(item, array) \
-	int i, l, breaked; \
-	for (i = 0, l = LENGTH(array), breaked = 0; i < l && !breaked; ++i, breaked = !breaked) \
-		for (item = &array[i]; !breaked; breaked = !breaked)
+#define EPOLL_FLAGS (OFP_EPOLLET | OFP_EPOLLONESHOT)
 
 static int epoll_socket_creator(void)
 {
 	const int epfd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, 0);
 	struct socket *epoll;
-	struct epoll_set *epoll_set;
 
 	if (epfd == -1)
 		return -1;
 
 	epoll = ofp_get_sock_by_fd(epfd);
 	epoll->so_type = OFP_SOCK_EPOLL;
-
-	FOREACH(epoll_set, epoll->epoll_set)
-		epoll_set->fd = -1;
+	ofp_epoll_set_init(epoll);
 
 	return epfd;
 }
 
+void ofp_epoll_set_init(struct socket *epoll)
+{
+	OFP_TAILQ_INIT(&epoll->so_epoll.items);
+	OFP_TAILQ_INIT(&epoll->so_epoll.ready);
+	epoll->so_epoll.nready = 0;
+	odp_rwlock_init(&epoll->so_epoll.lock);
+	epoll->so_epoll.evfd = -1;
+	epoll->so_epoll.armed = 0;
+}
+
 int ofp_epoll_create(int size)
 {
 	return _ofp_epoll_create(size, epoll_socket_creator);
@@ -68,156 +90,331 @@ static inline int is_epoll_socket(struct socket *epoll)
 	return (epoll->so_type == OFP_SOCK_EPOLL);
 }
 
-static inline int get_fd(struct epoll_set *epoll_set)
+static inline void epoll_lock(struct socket *epoll)
+{
+	odp_rwlock_write_lock(&epoll->so_epoll.lock);
+}
+
+static inline void epoll_unlock(struct socket *epoll)
+{
+	odp_rwlock_write_unlock(&epoll->so_epoll.lock);
+}
+
+static inline int is_item_used(struct epoll_item *item)
 {
-	return epoll_set->fd;
+	return (item->epoll != NULL);
 }
 
-static inline int is_fd(struct epoll_set *epoll_set, int fd)
+static struct epoll_item *find_item(struct socket *epoll, struct socket *so, int fd)
 {
-	return (get_fd(epoll_set) == fd);
+	int i;
+
+	for (i = 0; i < EPOLL_SOCKET_ITEMS; i++) {
+		struct epoll_item *item = &so->so_epoll_item[i];
+
+		if (item->epoll == epoll && item->fd == fd)
+			return item;
+	}
+
+	return NULL;
 }
 
-static inline struct epoll_set *find_fd(struct socket *epoll, int fd)
+static struct epoll_item *free_item(struct socket *so)
 {
-	struct epoll_set *epoll_set;
+	int i;
 
-	FOREACH(epoll_set, epoll->epoll_set)
-		if (is_fd(epoll_set, fd))
-			return epoll_set;
+	for (i = 0; i < EPOLL_SOCKET_ITEMS; i++)
+		if (!is_item_used(&so->so_epoll_item[i]))
+			return &so->so_epoll_item[i];
 
 	return NULL;
 }
 
-static inline int is_registered(struct socket *epoll, int fd)
+static inline void set_ready(struct socket *epoll, struct epoll_item *item)
 {
-	return (find_fd(epoll, fd) != NULL);
+	if (item->ready)
+		return;
+
+	item->ready = 1;
+	OFP_TAILQ_INSERT_TAIL(&epoll->so_epoll.ready, item, ready_list);
+	epoll->so_epoll.nready++;
+
+	if (epoll->so_epoll.armed) {
+		epoll->so_epoll.armed = 0;
+		(void)eventfd_write(epoll->so_epoll.evfd, 1);
+	}
 }
 
-static inline int set_fd(struct epoll_set *epoll_set, int fd, struct ofp_epoll_event *event)
+static inline void clear_ready(struct socket *epoll, struct epoll_item *item)
 {
-	if (!epoll_set)
-		return failure(OFP_ENOSPC);
+	if (!item->ready)
+		return;
 
-	epoll_set->fd = fd;
-	epoll_set->event = *event;
-	return 0;
+	item->ready = 0;
+	OFP_TAILQ_REMOVE(&epoll->so_epoll.ready, item, ready_list);
+	epoll->so_epoll.nready--;
 }
 
-static inline int modify_epoll_set(struct socket *epoll, int old_fd, int new_fd, struct ofp_epoll_event *event)
+/* Called with the epoll lock held */
+static void unlink_item(struct socket *epoll, struct epoll_item *item)
 {
-	return set_fd(find_fd(epoll, old_fd), new_fd, event);
+	clear_ready(epoll, item);
+	OFP_TAILQ_REMOVE(&epoll->so_epoll.items, item, item_list);
+	__atomic_fetch_sub(&item->so->so_epoll_count, 1, __ATOMIC_RELAXED);
+	item->epoll = NULL;
 }
 
-static int ofp_epoll_ctl_add(struct socket *epoll, int fd, struct ofp_epoll_event *event)
+static int ofp_epoll_ctl_add(struct socket *epoll, struct socket *so, int fd,
+			     struct ofp_epoll_event *event)
 {
-	if (is_registered(epoll, fd))
+	struct epoll_item *item;
+
+	if (find_item(epoll, so, fd))
 		return failure(OFP_EEXIST);
 
-	return modify_epoll_set(epoll, -1, fd, event);
+	item = free_item(so);
+	if (!item)
+		return failure(OFP_ENOSPC);
+
+	item->so = so;
+	item->fd = fd;
+	item->event = *event;
+	item->ready = 0;
+	item->epoll = epoll;
+	OFP_TAILQ_INSERT_TAIL(&epoll->so_epoll.items, item, item_list);
+	__atomic_fetch_add(&so->so_epoll_count, 1, __ATOMIC_RELAXED);
+
+	/* Report the current state on the next wait */
+	set_ready(epoll, item);
+
+	return 0;
 }
 
-static int ofp_epoll_ctl_del(struct socket *epoll, int fd)
+static int ofp_epoll_ctl_del(struct socket *epoll, struct socket *so, int fd)
 {
-	struct ofp_epoll_event event = { 0 };
+	struct epoll_item *item = find_item(epoll, so, fd);
 
-	if (!is_registered(epoll, fd))
+	if (!item)
 		return failure(OFP_ENOENT);
 
-	return modify_epoll_set(epoll, fd, -1, &event);
+	unlink_item(epoll, item);
+
+	return 0;
 }
 
-static int ofp_epoll_ctl_mod(struct socket *epoll, int fd, struct ofp_epoll_event *event)
+static int ofp_epoll_ctl_mod(struct socket *epoll, struct socket *so, int fd,
+			     struct ofp_epoll_event *event)
 {
-	if (!is_registered(epoll, fd))
+	struct epoll_item *item = find_item(epoll, so, fd);
+
+	if (!item)
 		return failure(OFP_ENOENT);
 
-	return modify_epoll_set(epoll, fd, fd, event);
+	item->event = *event;
+	set_ready(epoll, item);
+
+	return 0;
 }
 
 int _ofp_epoll_ctl(struct socket *epoll, int op, int fd, struct ofp_epoll_event *event)
 {
-	if (!epoll || !get_socket(fd))
+	struct socket *so;
+	int ret;
+
+	if (!epoll || !(so = get_socket(fd)))
 		return failure(OFP_EBADF);
 
 	if (!is_epoll_socket(epoll))
 		return failure(OFP_EINVAL);
 
+	if (op != OFP_EPOLL_CTL_ADD && op != OFP_EPOLL_CTL_DEL &&
+	    op != OFP_EPOLL_CTL_MOD)
+		return failure(OFP_EINVAL);
+
+	SOCKBUF_LOCK(&so->so_rcv);
+	epoll_lock(epoll);
+
 	switch (op) {
 	case OFP_EPOLL_CTL_ADD:
-		return ofp_epoll_ctl_add(epoll, fd, event);
+		ret = ofp_epoll_ctl_add(epoll, so, fd, event);
+		break;
 	case OFP_EPOLL_CTL_DEL:
-		return ofp_epoll_ctl_del(epoll, fd);
-	case OFP_EPOLL_CTL_MOD:
-		return ofp_epoll_ctl_mod(epoll, fd, event);
+		ret = ofp_epoll_ctl_del(epoll, so, fd);
+		break;
 	default:
-		ofp_errno = OFP_EINVAL;
+		ret = ofp_epoll_ctl_mod(epoll, so, fd, event);
 	}
 
-	return -1;
-}
+	epoll_unlock(epoll);
+	SOCKBUF_UNLOCK(&so->so_rcv);
 
-static int sleeper(int timeout)
-{
-	return ofp_msleep(NULL, NULL, 0, "epoll", timeout * 1000);
+	return ret;
 }
 
-int ofp_epoll_wait(int epfd, struct ofp_epoll_event *events, int maxevents, int timeout)
+static int (*wakeup)(void *channel) = ofp_wakeup;
+
+void ofp_epoll_notify(struct socket *so, uint32_t events)
 {
-	return _ofp_epoll_wait(get_socket(epfd), events, maxevents, timeout, sleeper);
+	int i;
+
+	for (i = 0; i < EPOLL_SOCKET_ITEMS; i++) {
+		struct epoll_item *item = &so->so_epoll_item[i];
+		struct socket *epoll = item->epoll;
+
+		if (!epoll)
+			continue;
+
+		epoll_lock(epoll);
+		/* Errors and hangups are reported regardless of the mask */
+		if (item->epoll == epoll && !item->ready &&
+		    (item->event.events & ~EPOLL_FLAGS) &&
+		    ((item->event.events & events) || so->so_error ||
+		     (so->so_rcv.sb_state & SBS_CANTRCVMORE))) {
+			set_ready(epoll, item);
+			wakeup(&epoll->so_epoll);
+		}
+		epoll_unlock(epoll);
+	}
 }
 
-static inline int is_fd_set(struct epoll_set *epoll_set)
+void ofp_epoll_socket_close(struct socket *so)
 {
-	return !is_fd(epoll_set, -1);
-}
+	struct epoll_item *item;
+	int i;
+
+	if (is_epoll_socket(so)) {
+		epoll_lock(so);
+		while ((item = OFP_TAILQ_FIRST(&so->so_epoll.items)))
+			unlink_item(so, item);
+		if (so->so_epoll.evfd != -1) {
+			close(so->so_epoll.evfd);
+			so->so_epoll.evfd = -1;
+			so->so_epoll.armed = 0;
+		}
+		epoll_unlock(so);
+		wakeup(&so->so_epoll);
+	}
 
-static int (*is_fd_readable)(int fd) = is_readable;
+	if (!so->so_epoll_count)
+		return;
 
-static inline struct ofp_epoll_event get_event(struct epoll_set *epoll_set)
-{
-	return epoll_set->event;
+	SOCKBUF_LOCK(&so->so_rcv);
+	for (i = 0; i < EPOLL_SOCKET_ITEMS; i++) {
+		struct socket *epoll;
+
+		item = &so->so_epoll_item[i];
+		epoll = item->epoll;
+		if (!epoll)
+			continue;
+
+		epoll_lock(epoll);
+		if (item->epoll == epoll)
+			unlink_item(epoll, item);
+		epoll_unlock(epoll);
+	}
+	SOCKBUF_UNLOCK(&so->so_rcv);
 }
 
-static inline int is_waiting_read_event(struct epoll_set *epoll_set)
+/* OFP_SO_BUSY_POLL: process input until an item is ready */
+static int busy_poller(struct socket *epoll, int timeout)
 {
-	return (get_event(epoll_set).events & OFP_EPOLLIN);
+	uint64_t now, end = 0;
+	uint32_t left = 0;
+	int ret;
+
+	if (timeout)
+		end = odp_time_to_ns(odp_time_global()) +
+			(uint64_t)timeout * ODP_TIME_MSEC_IN_NS;
+	do {
+		if (end) {
+			now = odp_time_to_ns(odp_time_global());
+			if (now >= end)
+				return OFP_EWOULDBLOCK;
+			left = (end - now + ODP_TIME_USEC_IN_NS - 1) /
+				ODP_TIME_USEC_IN_NS;
+		}
+		ret = ofp_busy_poll(&epoll->so_busy_poll, &epoll->so_epoll.lock,
+				    left);
+	} while (!ret && !epoll->so_epoll.nready);
+
+	return ret;
 }
 
-static int is_ready(struct epoll_set *epoll_set)
+static int sleeper(struct socket *epoll, int timeout)
 {
-	if (!is_fd_set(epoll_set))
-		return 0;
-
-	return (is_waiting_read_event(epoll_set) && is_fd_readable(get_fd(epoll_set)));
+	if (epoll->so_busy_poll.enable)
+		return busy_poller(epoll, timeout);
+	return ofp_msleep(&epoll->so_epoll, &epoll->so_epoll.lock, 0, "epoll",
+			  timeout * 1000);
 }
 
-static int none_of_ready(struct socket *epoll)
+int ofp_epoll_wait(int epfd, struct ofp_epoll_event *events, int maxevents, int timeout)
 {
-	struct epoll_set *epoll_set;
+	return _ofp_epoll_wait(get_socket(epfd), events, maxevents, timeout, sleeper);
+}
 
-	FOREACH(epoll_set, epoll->epoll_set)
-		if (is_ready(epoll_set))
-			return 0;
+static int (*is_fd_readable)(int fd) = is_readable;
 
-	return 1;
+static uint32_t poll_events(struct epoll_item *item)
+{
+	struct socket *so = item->so;
+	uint32_t events = 0;
+
+	if (is_fd_readable(item->fd) ||
+	    (so->so_rcv.sb_state & SBS_CANTRCVMORE))
+		events |= OFP_EPOLLIN;
+	if ((item->event.events & OFP_EPOLLOUT) && sowriteable(so))
+		events |= OFP_EPOLLOUT;
+	if (so->so_error)
+		events |= OFP_EPOLLERR;
+	if ((so->so_rcv.sb_state & SBS_CANTRCVMORE) &&
+	    (so->so_snd.sb_state & SBS_CANTSENDMORE))
+		events |= OFP_EPOLLHUP;
+
+	return events & (item->event.events | OFP_EPOLLERR | OFP_EPOLLHUP);
 }
 
+/*
+ * Report ready items of the ready list. Level triggered items stay on
+ * the list, at the tail, and are dropped when they are no longer ready.
+ */
 static int available_events(struct socket *epoll, struct ofp_epoll_event *events, int maxevents)
 {
-	struct epoll_set *epoll_set;
+	struct epoll_item *item;
+	int visit = epoll->so_epoll.nready;
 	int ready = 0;
 
-	FOREACH(epoll_set, epoll->epoll_set)
-		if (ready < maxevents && is_ready(epoll_set))
-			events[ready++] = get_event(epoll_set);
+	while (ready < maxevents && visit-- > 0) {
+		uint32_t revents;
+
+		item = OFP_TAILQ_FIRST(&epoll->so_epoll.ready);
+		clear_ready(epoll, item);
+
+		if (!(item->event.events & ~EPOLL_FLAGS))
+			continue;
+
+		revents = poll_events(item);
+		if (!revents)
+			continue;
+
+		events[ready].events = revents;
+		events[ready].data = item->event.data;
+		ready++;
+
+		if (item->event.events & OFP_EPOLLONESHOT)
+			item->event.events &= EPOLL_FLAGS;
+		else if (!(item->event.events & OFP_EPOLLET))
+			set_ready(epoll, item);
+	}
 
 	return ready;
 }
 
 int _ofp_epoll_wait(struct socket *epoll, struct ofp_epoll_event *events, int maxevents, int timeout,
-		    int(*msleep)(int timeout))
+		    int(*msleep)(struct socket *epoll, int timeout))
 {
+	int ready;
+
 	if (!epoll)
 		return failure(OFP_EBADF);
 
@@ -230,13 +427,65 @@ int _ofp_epoll_wait(struct socket *epoll, struct ofp_epoll_event *events, int ma
 	if (timeout < 0 && timeout != -1)
 		return failure(OFP_EINVAL);
 
-	if (timeout && none_of_ready(epoll)) {
+	epoll_lock(epoll);
+
+	ready = available_events(epoll, events, maxevents);
+	if (!ready && timeout) {
 		if (timeout == -1)
 			timeout = 0; /* wait forver */
-		msleep(timeout);
+		msleep(epoll, timeout);
+		ready = available_events(epoll, events, maxevents);
 	}
 
-	return available_events(epoll, events, maxevents);
+	epoll_unlock(epoll);
+
+	return ready;
+}
+
+int ofp_epoll_eventfd(int epfd)
+{
+	struct socket *epoll = get_socket(epfd);
+	int evfd;
+
+	if (!epoll)
+		return failure(OFP_EBADF);
+
+	if (!is_epoll_socket(epoll))
+		return failure(OFP_EINVAL);
+
+	epoll_lock(epoll);
+	if (epoll->so_epoll.evfd == -1)
+		epoll->so_epoll.evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	evfd = epoll->so_epoll.evfd;
+	epoll_unlock(epoll);
+
+	if (evfd == -1)
+		return failure(OFP_ENFILE);
+
+	return evfd;
+}
+
+int ofp_epoll_arm(int epfd)
+{
+	struct socket *epoll = get_socket(epfd);
+	eventfd_t value;
+	int ret = 0;
+
+	if (!epoll)
+		return failure(OFP_EBADF);
+
+	if (!is_epoll_socket(epoll) || epoll->so_epoll.evfd == -1)
+		return failure(OFP_EINVAL);
+
+	epoll_lock(epoll);
+	(void)eventfd_read(epoll->so_epoll.evfd, &value);
+	if (epoll->so_epoll.nready)
+		ret = 1;
+	else
+		epoll->so_epoll.armed = 1;
+	epoll_unlock(epoll);
+
+	return ret;
 }
 
 void ofp_set_socket_getter(struct socket*(*socket_getter)(int fd))
@@ -248,3 +497,8 @@ void ofp_set_is_readable_checker(int(*is_readable_checker)(int fd))
 {
 	is_fd_readable = is_readable_checker;
 }
+
+void ofp_set_epoll_wakeup(int(*epoll_wakeup)(void *channel))
+{
+	wakeup = epoll_wakeup;
+}
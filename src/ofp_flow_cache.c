@@ -0,0 +1,148 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+
+#define SHM_NAME_FLOW_CACHE "OfpFlowCacheShMem"
+
+/*
+ * Shared data
+ */
+struct ofp_flow_cache_mem {
+	odp_atomic_u32_t gen ODP_ALIGNED_CACHE;
+};
+
+/*
+ * Data per thread
+ */
+static __thread struct ofp_flow_cache_mem *shm;
+__thread struct ofp_flow_cache ofp_flow_cache;
+
+void ofp_flow_cache_flush(void)
+{
+	if (odp_unlikely(!shm) && ofp_flow_cache_lookup_shared_memory())
+		return;
+
+	/* Generation 0 marks an invalid entry */
+	if (odp_atomic_fetch_inc_u32(&shm->gen) == UINT32_MAX)
+		odp_atomic_inc_u32(&shm->gen);
+}
+
+static int ofp_flow_cache_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_FLOW_CACHE, sizeof(*shm));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_flow_cache_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_FLOW_CACHE) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_flow_cache_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_FLOW_CACHE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_flow_cache_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_FLOW_CACHE, sizeof(*shm));
+}
+
+int ofp_flow_cache_init_global(void)
+{
+	HANDLE_ERROR(ofp_flow_cache_alloc_shared_memory());
+
+	memset(shm, 0, sizeof(*shm));
+	odp_atomic_init_u32(&shm->gen, 1);
+
+	return 0;
+}
+
+int ofp_flow_cache_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_flow_cache_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_flow_cache_free_shared_memory(), rc);
+
+	return rc;
+}
+
+int ofp_flow_cache_init_local(void)
+{
+	uint32_t size = 1;
+	void *p;
+
+	memset(&ofp_flow_cache, 0, sizeof(ofp_flow_cache));
+	ofp_flow_cache.gen = &shm->gen;
+
+	if (global_param->flow_cache_size <= 0)
+		return 0;
+
+	while (size < (uint32_t)global_param->flow_cache_size)
+		size <<= 1;
+
+	if (posix_memalign(&p, ODP_CACHE_LINE_SIZE,
+			   size * sizeof(struct ofp_flow_cache_slot))) {
+		OFP_ERR("Flow cache allocation failed");
+		return -1;
+	}
+	memset(p, 0, size * sizeof(struct ofp_flow_cache_slot));
+
+	ofp_flow_cache.slot = p;
+	ofp_flow_cache.mask = size - 1;
+
+#ifdef INET6
+	if (posix_memalign(&p, ODP_CACHE_LINE_SIZE,
+			   size * sizeof(struct ofp_flow_cache6_slot))) {
+		OFP_ERR("Flow cache allocation failed");
+		ofp_flow_cache_term_local();
+		return -1;
+	}
+	memset(p, 0, size * sizeof(struct ofp_flow_cache6_slot));
+
+	ofp_flow_cache.slot6 = p;
+#endif
+
+	return 0;
+}
+
+int ofp_flow_cache_term_local(void)
+{
+	free(ofp_flow_cache.slot);
+	free(ofp_flow_cache.slot6);
+	memset(&ofp_flow_cache, 0, sizeof(ofp_flow_cache));
+
+	return 0;
+}
@@ -22,6 +22,7 @@
 #include "ofpi_hook.h"
 #include "ofpi_util.h"
 #include "ofpi_ipsec.h"
+#include "ofpi_stat.h"
 
 enum ofp_return_code ofp_gre_input(odp_packet_t *pkt, int off0)
 {
@@ -47,6 +48,7 @@ enum ofp_return_code ofp_gre_input(odp_packet_t *pkt, int off0)
 		OFP_HOOK(OFP_HOOK_GRE, *pkt, NULL, &res);
 		return res;
 	}
+	OFP_IF_STAT_RX(dev_in, 1, odp_packet_len(*pkt));
 
 	/* save eth hdr data */
 	if (dev->vlan) {
@@ -118,17 +120,31 @@ enum ofp_return_code ofp_gre_input(odp_packet_t *pkt, int off0)
 	return OFP_PKT_CONTINUE;
 }
 
-enum ofp_return_code ofp_output_ipv4_to_gre(odp_packet_t pkt,
-					    struct ofp_ifnet *dev_gre)
+/*
+ * Outer headers of all GRE packets. The lengths, TOS, TTL, payload
+ * type and tunnel endpoints are set per packet, the checksum by IP
+ * output.
+ */
+static const struct ofp_greip gre_hdr_template = {
+	.gi_i = {
+		.ip_hl = 5,
+		.ip_v = OFP_IPVERSION,
+		.ip_p = OFP_IPPROTO_GRE,
+	},
+};
+
+/* Replace the Ethernet header of pkt with the outer IP and GRE headers */
+static inline struct ofp_greip *gre_encap(odp_packet_t pkt,
+					  struct ofp_ifnet *dev_gre,
+					  uint16_t ptype, uint8_t tos,
+					  uint8_t ttl, uint16_t len)
 {
-	struct ofp_ip	*ip;
 	struct ofp_greip *greip;
 	uint8_t	l2_size = 0;
 	int32_t	offset;
 
-	ip = odp_packet_l3_ptr(pkt, NULL);
+	OFP_IF_STAT_TX(dev_gre, 1, odp_packet_len(pkt));
 
-	/* Remove eth header, prepend gre + ip */
 	if (odp_packet_has_l2(pkt))
 		l2_size = odp_packet_l3_offset(pkt) - odp_packet_l2_offset(pkt);
 
@@ -142,70 +158,41 @@ enum ofp_return_code ofp_output_ipv4_to_gre(odp_packet_t pkt,
 	odp_packet_l3_offset_set(pkt, 0);
 
 	if (!greip)
-		return OFP_PKT_DROP;
+		return NULL;
 
-	greip->gi_flags = 0;
-	greip->gi_ptype = odp_cpu_to_be_16(OFP_GREPROTO_IP);
-
-	greip->gi_i.ip_hl = 5;
-	greip->gi_i.ip_v = OFP_IPVERSION;
-	greip->gi_i.ip_tos = ip->ip_tos;
-	greip->gi_i.ip_len =
-		odp_cpu_to_be_16(odp_be_to_cpu_16(ip->ip_len) +
-				 sizeof(*greip));
-	greip->gi_i.ip_off = 0;
-	greip->gi_i.ip_ttl = ip->ip_ttl;
-	greip->gi_i.ip_p = OFP_IPPROTO_GRE;
-	greip->gi_i.ip_sum = 0;
+	memcpy(greip, &gre_hdr_template, sizeof(*greip));
+	greip->gi_ptype = odp_cpu_to_be_16(ptype);
+	greip->gi_i.ip_tos = tos;
+	greip->gi_i.ip_len = odp_cpu_to_be_16(len + sizeof(*greip));
+	greip->gi_i.ip_ttl = ttl;
 	greip->gi_i.ip_src.s_addr = dev_gre->ip_local;
 	greip->gi_i.ip_dst.s_addr = dev_gre->ip_remote;
 
-	return ofp_ip_output_recurse(pkt, NULL);
+	return greip;
 }
 
-#ifdef INET6
-enum ofp_return_code ofp_output_ipv6_to_gre(odp_packet_t pkt,
+enum ofp_return_code ofp_output_ipv4_to_gre(odp_packet_t pkt,
 					    struct ofp_ifnet *dev_gre)
 {
-	struct ofp_ip6_hdr *ip6;
-	struct ofp_greip *greip;
-	uint8_t	l2_size = 0;
-	int32_t	offset;
-
-	ip6 = odp_packet_l3_ptr(pkt, NULL);
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, NULL);
 
-	/* Remove eth header, prepend gre + ip */
-	if (odp_packet_has_l2(pkt))
-		l2_size = odp_packet_l3_offset(pkt) - odp_packet_l2_offset(pkt);
+	if (!gre_encap(pkt, dev_gre, OFP_GREPROTO_IP, ip->ip_tos, ip->ip_ttl,
+		       odp_be_to_cpu_16(ip->ip_len)))
+		return OFP_PKT_DROP;
 
-	offset = sizeof(*greip) - l2_size;
-	if (offset >= 0)
-		greip = odp_packet_push_head(pkt, offset);
-	else
-		greip = odp_packet_pull_head(pkt, -offset);
+	return ofp_ip_output_recurse(pkt, NULL);
+}
 
-	odp_packet_has_l2_set(pkt, 0);
-	odp_packet_l3_offset_set(pkt, 0);
+#ifdef INET6
+enum ofp_return_code ofp_output_ipv6_to_gre(odp_packet_t pkt,
+					    struct ofp_ifnet *dev_gre)
+{
+	struct ofp_ip6_hdr *ip6 = odp_packet_l3_ptr(pkt, NULL);
 
-	if (!greip)
+	if (!gre_encap(pkt, dev_gre, OFP_ETHERTYPE_IPV6, 0, ip6->ofp_ip6_hlim,
+		       odp_be_to_cpu_16(ip6->ofp_ip6_plen) + sizeof(*ip6)))
 		return OFP_PKT_DROP;
 
-	greip->gi_flags = 0;
-	greip->gi_ptype = odp_cpu_to_be_16(OFP_ETHERTYPE_IPV6);
-
-	greip->gi_i.ip_hl = 5;
-	greip->gi_i.ip_v = OFP_IPVERSION;
-	greip->gi_i.ip_tos = 0;
-	greip->gi_i.ip_len = odp_cpu_to_be_16(
-		odp_be_to_cpu_16(ip6->ofp_ip6_plen) +
-		sizeof(*ip6) + sizeof(*greip));
-	greip->gi_i.ip_off = 0;
-	greip->gi_i.ip_ttl = ip6->ofp_ip6_hlim;
-	greip->gi_i.ip_p = OFP_IPPROTO_GRE;
-	greip->gi_i.ip_sum = 0;
-	greip->gi_i.ip_src.s_addr = dev_gre->ip_local;
-	greip->gi_i.ip_dst.s_addr = dev_gre->ip_remote;
-
 	odp_packet_has_ipv6_set(pkt, 0);
 	odp_packet_has_ipv4_set(pkt, 1);
 
@@ -0,0 +1,300 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_gro.h"
+#include "ofpi_pkt_processing.h"
+#include "ofpi_portconf.h"
+#include "ofpi_stat.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+
+#include "ofpi_tcp_seq.h"
+
+#include "api/ofp_tcp.h"
+
+#define GRO_MAX_LEN 0xffff
+
+__thread struct ofp_gro ofp_gro;
+
+static inline struct ofp_tcphdr *tcp_hdr(struct ofp_ip *ip)
+{
+	return (struct ofp_tcphdr *)((uint8_t *)ip + (ip->ip_hl << 2));
+}
+
+static void gro_deliver(struct ofp_gro_flow *f)
+{
+	odp_packet_t pkt = f->pkt;
+	struct ofp_ifnet *dev = odp_packet_user_ptr(pkt);
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, NULL);
+	enum ofp_return_code res;
+
+	f->pkt = ODP_PACKET_INVALID;
+	ofp_gro.num--;
+
+	ip->ip_sum = 0;
+	ip->ip_sum = ofp_cksum_iph(ip, ip->ip_hl);
+
+	res = ipv4_transport_classifier(&pkt, OFP_IPPROTO_TCP);
+	if (res == OFP_PKT_DROP)
+		odp_packet_free(pkt);
+	else if (res == OFP_PKT_CONTINUE)
+		ofp_sp_input(pkt, dev);
+}
+
+/* Checksum has to be valid before the payload is appended */
+static int gro_chksum_ok(odp_packet_t pkt)
+{
+	if (ofp_packet_user_area(pkt)->chksum_flags &
+	    OFP_L4_CHKSUM_STATUS_VALID) {
+		switch (odp_packet_l4_chksum_status(pkt)) {
+		case ODP_PACKET_CHKSUM_OK:
+			return 1;
+		case ODP_PACKET_CHKSUM_BAD:
+			return 0;
+		default:
+			break;
+		}
+	}
+	return !ofp_in4_cksum(pkt);
+}
+
+/* Offset of the timestamp option in the options, -1 if there is none */
+static int gro_ts_offset(const uint8_t *cp, int cnt)
+{
+	int off, optlen;
+
+	for (off = 0; off < cnt; off += optlen) {
+		if (cp[off] == OFP_TCPOPT_EOL)
+			break;
+		if (cp[off] == OFP_TCPOPT_NOP) {
+			optlen = 1;
+			continue;
+		}
+		if (cnt - off < 2)
+			break;
+		optlen = cp[off + 1];
+		if (optlen < 2 || optlen > cnt - off)
+			break;
+		if (cp[off] == OFP_TCPOPT_TIMESTAMP &&
+		    optlen == OFP_TCPOLEN_TIMESTAMP)
+			return off;
+	}
+	return -1;
+}
+
+/*
+ * The options of th have to be those of the held hth, but for the
+ * timestamps, of which TSval may not go back. Returns the offset of the
+ * timestamp option, -1 if there is none, or -2 if the options differ.
+ */
+static int gro_opts_match(struct ofp_tcphdr *hth, struct ofp_tcphdr *th)
+{
+	const uint8_t *hcp = (const uint8_t *)(hth + 1);
+	const uint8_t *cp = (const uint8_t *)(th + 1);
+	int cnt = (th->th_off << 2) - sizeof(*th);
+	int ts = gro_ts_offset(cp, cnt);
+	int end = ts + OFP_TCPOLEN_TIMESTAMP;
+	uint32_t tsval, htsval;
+
+	if (ts < 0)
+		return memcmp(hcp, cp, cnt) ? -2 : -1;
+
+	if (memcmp(hcp, cp, ts + 2) || memcmp(hcp + end, cp + end, cnt - end))
+		return -2;
+	memcpy(&tsval, cp + ts + 2, sizeof(tsval));
+	memcpy(&htsval, hcp + ts + 2, sizeof(htsval));
+	if (TSTMP_LT(odp_be_to_cpu_32(tsval), odp_be_to_cpu_32(htsval)))
+		return -2;
+	return ts;
+}
+
+static int gro_append(struct ofp_gro_flow *f, odp_packet_t pkt,
+		      struct ofp_ip *ip, struct ofp_tcphdr *th,
+		      int hlen, int plen)
+{
+	struct ofp_ip *hip = odp_packet_l3_ptr(f->pkt, NULL);
+	struct ofp_tcphdr *hth = tcp_hdr(hip);
+	int hip_len = odp_be_to_cpu_16(hip->ip_len);
+	void *dst;
+	int ts;
+
+	if (hip->ip_tos != ip->ip_tos || hip->ip_ttl != ip->ip_ttl ||
+	    hth->th_ack != th->th_ack || hth->th_win != th->th_win ||
+	    hth->th_off != th->th_off ||
+	    (ts = gro_opts_match(hth, th)) == -2 ||
+	    hip_len + plen > GRO_MAX_LEN ||
+	    odp_packet_tailroom(f->pkt) < (uint32_t)plen)
+		return -1;
+
+	dst = odp_packet_push_tail(f->pkt, plen);
+	if (dst == NULL)
+		return -1;
+	if (odp_packet_copy_to_mem(pkt, odp_packet_l3_offset(pkt) + hlen,
+				   plen, dst) < 0) {
+		odp_packet_pull_tail(f->pkt, plen);
+		return -1;
+	}
+
+	hip->ip_len = odp_cpu_to_be_16(hip_len + plen);
+	hth->th_flags |= th->th_flags;
+	/* TCP input sees the timestamps of the last segment */
+	if (ts >= 0)
+		memcpy((uint8_t *)(hth + 1) + ts + 2,
+		       (uint8_t *)(th + 1) + ts + 2,
+		       OFP_TCPOLEN_TIMESTAMP - 2);
+	f->next_seq += plen;
+
+	odp_packet_free(pkt);
+	OFP_UPDATE_PACKET_STAT(rx_tcp_gro, 1);
+	return 0;
+}
+
+static struct ofp_gro_flow *gro_slot(void)
+{
+	struct ofp_gro_flow *f;
+	int i;
+
+	if (ofp_gro.num < ofp_gro.num_flows) {
+		for (i = 0; i < ofp_gro.num_flows; i++)
+			if (ofp_gro.flow[i].pkt == ODP_PACKET_INVALID)
+				return &ofp_gro.flow[i];
+	}
+
+	f = &ofp_gro.flow[ofp_gro.next];
+	if (++ofp_gro.next == ofp_gro.num_flows)
+		ofp_gro.next = 0;
+	gro_deliver(f);
+	return f;
+}
+
+enum ofp_return_code ofp_gro_tcp4_hold(odp_packet_t pkt, struct ofp_ip *ip)
+{
+	struct ofp_ifnet *dev = odp_packet_user_ptr(pkt);
+	struct ofp_tcphdr *th = tcp_hdr(ip);
+	struct ofp_gro_flow *f = NULL;
+	uint32_t ports, seq, len;
+	int i, hlen, plen, can_merge;
+
+	memcpy(&ports, th, sizeof(ports));
+	seq = odp_be_to_cpu_32(th->th_seq);
+	hlen = (ip->ip_hl << 2) + (th->th_off << 2);
+	plen = odp_be_to_cpu_16(ip->ip_len) - hlen;
+
+	if (ofp_gro.num) {
+		for (i = 0; i < ofp_gro.num_flows; i++) {
+			struct ofp_gro_flow *e = &ofp_gro.flow[i];
+
+			if (e->pkt != ODP_PACKET_INVALID &&
+			    e->ports == ports &&
+			    e->src == ip->ip_src.s_addr &&
+			    e->dst == ip->ip_dst.s_addr &&
+			    e->vrf == dev->vrf) {
+				f = e;
+				break;
+			}
+		}
+	}
+
+	/* Plain data segments only, options are compared when appending */
+	can_merge = ip->ip_hl == sizeof(struct ofp_ip) >> 2 &&
+		!(odp_be_to_cpu_16(ip->ip_off) & (OFP_IP_MF | OFP_IP_OFFMASK)) &&
+		th->th_off >= sizeof(struct ofp_tcphdr) >> 2 && plen > 0 &&
+		(th->th_flags & ~OFP_TH_PUSH) == OFP_TH_ACK;
+
+	/*
+	 * Checksum the segment once if it is to be appended or held, TCP
+	 * input does not verify it again.
+	 */
+	if (can_merge && (!(th->th_flags & OFP_TH_PUSH) ||
+			  (f && seq == f->next_seq))) {
+		if (gro_chksum_ok(pkt))
+			ofp_packet_user_area(pkt)->chksum_flags |=
+				OFP_L4_CHKSUM_VERIFIED;
+		else
+			can_merge = 0;
+	}
+
+	if (f) {
+		if (can_merge && seq == f->next_seq &&
+		    !gro_append(f, pkt, ip, th, hlen, plen)) {
+			if (th->th_flags & OFP_TH_PUSH)
+				gro_deliver(f);
+			return OFP_PKT_PROCESSED;
+		}
+		/* Keep the order of the segments of the flow */
+		gro_deliver(f);
+	}
+
+	if (!can_merge || (th->th_flags & OFP_TH_PUSH))
+		return OFP_PKT_CONTINUE;
+
+	/* Padding of short frames must not end up in the middle */
+	len = odp_packet_l3_offset(pkt) + hlen + plen;
+	if (odp_packet_len(pkt) > len)
+		odp_packet_pull_tail(pkt, odp_packet_len(pkt) - len);
+
+	f = gro_slot();
+	f->pkt = pkt;
+	f->src = ip->ip_src.s_addr;
+	f->dst = ip->ip_dst.s_addr;
+	f->ports = ports;
+	f->vrf = dev->vrf;
+	f->next_seq = seq + plen;
+	ofp_gro.num++;
+
+	return OFP_PKT_PROCESSED;
+}
+
+void ofp_gro_flush(void)
+{
+	int i;
+
+	for (i = 0; i < ofp_gro.num_flows && ofp_gro.num; i++)
+		if (ofp_gro.flow[i].pkt != ODP_PACKET_INVALID)
+			gro_deliver(&ofp_gro.flow[i]);
+}
+
+int ofp_gro_init_local(void)
+{
+	int i;
+
+	memset(&ofp_gro, 0, sizeof(ofp_gro));
+	ofp_gro.rx_ts = global_param->rx_timestamp > 0;
+
+	if (global_param->tcp_gro_flows <= 0)
+		return 0;
+
+	ofp_gro.flow = malloc(global_param->tcp_gro_flows *
+			      sizeof(struct ofp_gro_flow));
+	if (ofp_gro.flow == NULL) {
+		OFP_ERR("GRO flow table allocation failed");
+		return -1;
+	}
+	for (i = 0; i < global_param->tcp_gro_flows; i++)
+		ofp_gro.flow[i].pkt = ODP_PACKET_INVALID;
+	ofp_gro.num_flows = global_param->tcp_gro_flows;
+
+	return 0;
+}
+
+int ofp_gro_term_local(void)
+{
+	int i;
+
+	for (i = 0; i < ofp_gro.num_flows; i++)
+		if (ofp_gro.flow[i].pkt != ODP_PACKET_INVALID)
+			odp_packet_free(ofp_gro.flow[i].pkt);
+	free(ofp_gro.flow);
+	memset(&ofp_gro, 0, sizeof(ofp_gro));
+
+	return 0;
+}
@@ -888,3 +888,98 @@ uint32_t ofp_hashbig(const void *key, size_t length, uint32_t initval)
 	final(a, b, c);
 	return c;
 }
+
+/*
+ * Short key hashing backends
+ */
+
+static void hashword_multi(const uint32_t *k[], int num, size_t length,
+			   uint32_t initval, uint32_t hash[])
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		hash[i] = ofp_hashword(k[i], length, initval);
+}
+
+uint32_t (*ofp_hash_key)(const uint32_t *k, size_t length,
+			 uint32_t initval) = ofp_hashword;
+void (*ofp_hash_key_multi)(const uint32_t *k[], int num, size_t length,
+			   uint32_t initval, uint32_t hash[]) = hashword_multi;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+# define HASH_CRC32C 1
+# define CRC32C_TARGET __attribute__((target("sse4.2")))
+# define CRC32C_U32(crc, v) _mm_crc32_u32(crc, v)
+
+static int crc32c_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+# define HASH_CRC32C 1
+# define CRC32C_TARGET __attribute__((target("+crc")))
+# define CRC32C_U32(crc, v) __crc32cw(crc, v)
+
+static int crc32c_supported(void)
+{
+	return !!(getauxval(AT_HWCAP) & HWCAP_CRC32);
+}
+#else
+# define HASH_CRC32C 0
+#endif
+
+#if HASH_CRC32C
+CRC32C_TARGET
+static uint32_t hash_crc32c(const uint32_t *k, size_t length, uint32_t initval)
+{
+	uint32_t crc = initval;
+
+	while (length--)
+		crc = CRC32C_U32(crc, *k++);
+
+	return crc;
+}
+
+CRC32C_TARGET
+static void hash_crc32c_multi(const uint32_t *k[], int num, size_t length,
+			      uint32_t initval, uint32_t hash[])
+{
+	int i = 0;
+	size_t n;
+
+	/* Four independent CRC chains keep the pipeline busy */
+	for (; i + 4 <= num; i += 4) {
+		uint32_t c0 = initval, c1 = initval, c2 = initval, c3 = initval;
+
+		for (n = 0; n < length; n++) {
+			c0 = CRC32C_U32(c0, k[i][n]);
+			c1 = CRC32C_U32(c1, k[i + 1][n]);
+			c2 = CRC32C_U32(c2, k[i + 2][n]);
+			c3 = CRC32C_U32(c3, k[i + 3][n]);
+		}
+		hash[i] = c0;
+		hash[i + 1] = c1;
+		hash[i + 2] = c2;
+		hash[i + 3] = c3;
+	}
+
+	for (; i < num; i++)
+		hash[i] = hash_crc32c(k[i], length, initval);
+}
+#endif
+
+void ofp_hash_init_global(void)
+{
+#if HASH_CRC32C
+	if (crc32c_supported()) {
+		ofp_hash_key = hash_crc32c;
+		ofp_hash_key_multi = hash_crc32c_multi;
+	}
+#endif
+}
@@ -18,6 +18,7 @@
 
 typedef struct {
 	ofp_pkt_hook pkt_hook[OFP_HOOK_MAX];
+	ofp_pkt_hook_burst pkt_hook_burst[OFP_HOOK_MAX];
 } hook_shm_t;
 
 static __thread hook_shm_t *shm_hook;
@@ -30,6 +31,14 @@ ofp_pkt_hook *ofp_get_packet_hooks(void)
 	return &(shm_hook->pkt_hook[0]);
 }
 
+ofp_pkt_hook_burst *ofp_get_packet_burst_hooks(void)
+{
+	if (!shm_hook)
+		return NULL;
+
+	return &(shm_hook->pkt_hook_burst[0]);
+}
+
 static int ofp_hook_alloc_shared_memory(void)
 {
 	shm_hook = ofp_shared_memory_alloc(SHM_NAME_HOOK, sizeof(*shm_hook));
@@ -67,12 +76,15 @@ void ofp_hook_init_prepare(void)
 	ofp_shared_memory_prealloc(SHM_NAME_HOOK, sizeof(*shm_hook));
 }
 
-int ofp_hook_init_global(ofp_pkt_hook *pkt_hook_init)
+int ofp_hook_init_global(ofp_pkt_hook *pkt_hook_init,
+			 ofp_pkt_hook_burst *pkt_hook_burst_init)
 {
 	HANDLE_ERROR(ofp_hook_alloc_shared_memory());
 
 	memcpy(&shm_hook->pkt_hook[0], pkt_hook_init,
 		OFP_HOOK_MAX * sizeof(ofp_pkt_hook));
+	memcpy(&shm_hook->pkt_hook_burst[0], pkt_hook_burst_init,
+		OFP_HOOK_MAX * sizeof(ofp_pkt_hook_burst));
 	return 0;
 }
 
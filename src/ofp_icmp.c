@@ -124,7 +124,9 @@ int	icmpprintfs = 0;
 #endif
 
 static enum ofp_return_code icmp_reflect(odp_packet_t pkt);
-static void	icmp_send(odp_packet_t pkt, struct ofp_nh_entry *nh);
+static enum ofp_return_code icmp_reflect_out(odp_packet_t pkt, int in_place);
+static void	icmp_send(odp_packet_t pkt, struct ofp_nh_entry *nh,
+			  struct ofp_ifnet *ifp);
 
 extern	struct protosw inetsw[];
 
@@ -160,6 +162,63 @@ kmod_icmpstat_inc(int statnum)
 }
 */
 
+/*
+ * Limiter buckets of a thread, hashed by prefix and error type. The
+ * buckets hold GCRA theoretical arrival times in ns. Prefixes that
+ * collide share a bucket and its rate, a new prefix never resets it.
+ */
+#define ICMP_RL_BITS 8
+
+static __thread struct {
+	uint64_t tat[1 << ICMP_RL_BITS];
+	uint64_t total_tat;
+} icmp_rl;
+
+/* GCRA, as the slow path policer, without atomics */
+static inline int icmp_rl_check(uint64_t *tat, uint64_t now, int pps)
+{
+	uint64_t interval, burst;
+
+	if (pps <= 0)
+		return 0;
+
+	interval = ODP_TIME_SEC_IN_NS / pps;
+	burst = interval * global_param->icmp_err.burst;
+	if (*tat > now + burst)
+		return -1;
+	*tat = (*tat > now ? *tat : now) + interval;
+	return 0;
+}
+
+int ofp_icmp_err_ratelimit(int af, const void *src, int type)
+{
+	const uint8_t *a = src;
+	uint64_t *tat;
+	uint64_t key, now;
+
+	if (global_param->icmp_err.pps <= 0 &&
+	    global_param->icmp_err.prefix_pps <= 0)
+		return 0;
+
+	/* The /24 or /48 of the source, the error type and the family */
+	if (af == OFP_AF_INET6)
+		key = (uint64_t)a[0] << 40 | (uint64_t)a[1] << 32 |
+			(uint64_t)a[2] << 24 | a[3] << 16 | a[4] << 8 | a[5];
+	else
+		key = a[0] << 16 | a[1] << 8 | a[2];
+	key |= (uint64_t)(type & 0xff) << 48 |
+		(uint64_t)(af == OFP_AF_INET6) << 56;
+
+	now = odp_time_to_ns(odp_time_local());
+
+	tat = &icmp_rl.tat[(key * 0x9e3779b97f4a7c15ULL) >>
+			   (64 - ICMP_RL_BITS)];
+	if (icmp_rl_check(tat, now, global_param->icmp_err.prefix_pps))
+		return 1;
+	return icmp_rl_check(&icmp_rl.total_tat, now,
+			     global_param->icmp_err.pps) ? 1 : 0;
+}
+
 /*
  * Generate an error packet of type error
  * in response to bad packet ip.
@@ -203,6 +262,9 @@ ofp_icmp_error(odp_packet_t pkt_in, int type, int code, uint32_t dest, int mtu)
 		/*ICMPSTAT_INC(icps_oldicmp);*/
 		goto freeit;
 	}
+	/* Before the error is allocated */
+	if (ofp_icmp_err_ratelimit(OFP_AF_INET, &ip_in->ip_src, type))
+		goto freeit;
 	/*
 	 * Calculate length to quote from original packet and
 	 * prevent the ICMP mbuf from overflowing.
@@ -291,9 +353,14 @@ stdreply:	icmpelen = max(8, min(V_icmp_quotelen, ip_in->ip_len - ip_hlen));
 	ip->ip_p = OFP_IPPROTO_ICMP;
 	ip->ip_tos = 0;
 
+	icp->icmp_cksum = 0;
+	icp->icmp_cksum = ofp_cksum(pkt, odp_packet_l3_offset(pkt) + ip_hlen,
+				    icmp_len - ip_hlen);
+
 	odp_packet_user_ptr_set(pkt, odp_packet_user_ptr(pkt_in));
 
-	return icmp_reflect(pkt);
+	/* A new packet, without the ingress Ethernet header */
+	return icmp_reflect_out(pkt, 0);
 freeit:
 	return OFP_PKT_DROP;
 }
@@ -423,7 +490,12 @@ static enum ofp_return_code
 icmp_echo(odp_packet_t pkt, struct ofp_icmp *icp,
 	  enum ofp_return_code (*reflect)(odp_packet_t pkt))
 {
+	uint16_t old = *(uint16_t *)icp;
+
+	/* The checksum was verified, adjust it for the type */
 	icp->icmp_type = OFP_ICMP_ECHOREPLY;
+	icp->icmp_cksum = ofp_cksum_adjust16(icp->icmp_cksum, old,
+					     *(uint16_t *)icp);
 	return reflect(pkt);
 }
 
@@ -434,9 +506,19 @@ icmp_timestamp_request(odp_packet_t pkt, struct ofp_icmp *icp, int icmplen,
 	if ((unsigned int)icmplen < OFP_ICMP_TSLEN)
 		return OFP_PKT_DROP;
 
+	uint16_t old = *(uint16_t *)icp;
+	uint32_t old_rtime = icp->ofp_icmp_rtime;
+	uint32_t old_ttime = icp->ofp_icmp_ttime;
+	uint16_t sum = icp->icmp_cksum;
+
 	icp->icmp_type = OFP_ICMP_TSTAMPREPLY;
 	icp->ofp_icmp_rtime = iptime();
 	icp->ofp_icmp_ttime = icp->ofp_icmp_rtime;      /* bogus, do later! */
+
+	sum = ofp_cksum_adjust16(sum, old, *(uint16_t *)icp);
+	sum = ofp_cksum_adjust32(sum, old_rtime, icp->ofp_icmp_rtime);
+	icp->icmp_cksum = ofp_cksum_adjust32(sum, old_ttime,
+					     icp->ofp_icmp_ttime);
 	return reflect(pkt);
 }
 
@@ -566,13 +648,24 @@ _ofp_icmp_input(odp_packet_t pkt, struct ofp_ip *ip, struct ofp_icmp *icp,
 /*
  * Reflect the ip packet back to the source
  */
+/*
+ * Reflect the ICMP packet back to the source. In place replies to
+ * packets addressed to us are sent back through the ingress header.
+ */
 static enum ofp_return_code
 icmp_reflect(odp_packet_t pkt)
+{
+	return icmp_reflect_out(pkt, 1);
+}
+
+static enum ofp_return_code
+icmp_reflect_out(odp_packet_t pkt, int in_place)
 {
 	struct ofp_ip *ip = (struct ofp_ip *)odp_packet_l3_ptr(pkt, NULL);
 	struct ofp_in_addr t;
 	struct ofp_nh_entry *nh = NULL;
 	struct ofp_ifnet *dev_out, *ifp = odp_packet_user_ptr(pkt);
+	struct ofp_ifnet *ifp_reflect = NULL;
 	int optlen = (ip->ip_hl << 2) - sizeof(*ip);
 
 /*	if (IN_MULTICAST(odp_be_to_cpu_32(ip->ip_src.s_addr)) ||
@@ -596,6 +689,8 @@ icmp_reflect(odp_packet_t pkt)
 	 * own addresses, use dst as the src for the reply.
 	 */
 	if ((dev_out = ofp_get_ifnet_match(t.s_addr, ifp->vrf, ifp->vlan))) {
+		if (in_place)
+			ifp_reflect = ifp;
 		goto match;
 	}
 
@@ -743,26 +838,23 @@ match:
 		ip->ip_len = odp_cpu_to_be_16(ip_len);
 	}
 
-	icmp_send(pkt, nh/*, opts*/);
+	icmp_send(pkt, nh, ifp_reflect/*, opts*/);
 	return OFP_PKT_PROCESSED;
 drop:
 	return OFP_PKT_DROP;
 }
 
 /*
- * Send an icmp packet back to the ip level,
- * after supplying a checksum.
+ * Send an icmp packet, checksum already in place, back to the ip level.
+ * Replies to packets addressed to us go back through the ingress
+ * interface ifp, if any.
  */
 static void
-icmp_send(odp_packet_t pkt, struct ofp_nh_entry *nh)
+icmp_send(odp_packet_t pkt, struct ofp_nh_entry *nh, struct ofp_ifnet *ifp)
 {
+#ifdef ICMPPRINTFS
 	register struct ofp_ip *ip = (struct ofp_ip *)odp_packet_l3_ptr(pkt, NULL);
-	register uint16_t hlen = ip->ip_hl << 2;
-	register struct ofp_icmp *icp = (struct ofp_icmp *)((uint8_t *)ip + hlen);
-
-	icp->icmp_cksum = 0;
-	icp->icmp_cksum = ofp_cksum(pkt, odp_packet_l3_offset(pkt) + hlen,
-				      odp_be_to_cpu_16(ip->ip_len) - hlen);
+#endif
 
 #ifdef ICMPPRINTFS
 	if (icmpprintfs) {
@@ -772,6 +864,9 @@ icmp_send(odp_packet_t pkt, struct ofp_nh_entry *nh)
 		       buf, inet_ntoa(ip->ip_src));
 	}
 #endif
-	(void) ofp_ip_output(pkt, nh);
+	if (ifp)
+		(void) ofp_ip_output_reflect(pkt, ifp);
+	else
+		(void) ofp_ip_output(pkt, nh);
 }
 
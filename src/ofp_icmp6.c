@@ -352,13 +352,11 @@ ofp_icmp6_error(odp_packet_t m, int type, int code, int param)
 #endif
 
 
-#if 0
 	/* Finally, do rate limitation check. */
-	if (icmp6_ratelimit(&oip6->ip6_src, type, code)) {
-		ICMP6STAT_INC(icp6s_toofreq);
+	if (ofp_icmp_err_ratelimit(OFP_AF_INET6, &oip6->ip6_src, type)) {
+		/*ICMP6STAT_INC(icp6s_toofreq);*/
 		goto freeit;
 	}
-#endif
 	/*
 	 * OK, ICMP6 can be generated.
 	 */
@@ -377,9 +375,13 @@ ofp_icmp6_error(odp_packet_t m, int type, int code, int param)
 	odp_packet_l2_offset_set(pkt, odp_packet_l2_offset(m));
 	odp_packet_l3_offset_set(pkt, odp_packet_l3_offset(m));
 
-	memcpy((uint8_t *)odp_packet_l3_ptr(pkt, NULL) + preplen,
-		odp_packet_l3_ptr(m, NULL),
-		oip6_cpy_len);
+	/* Neither packet need be contiguous over the quoted bytes */
+	if (odp_packet_copy_from_pkt(pkt, odp_packet_l3_offset(pkt) + preplen,
+				     m, odp_packet_l3_offset(m),
+				     oip6_cpy_len) < 0) {
+		odp_packet_free(pkt);
+		goto freeit;
+	}
 	odp_packet_free(m);
 
 	oip6 = (struct ofp_ip6_hdr *)((uint8_t *)odp_packet_l3_ptr(pkt, NULL) +
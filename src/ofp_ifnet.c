@@ -9,6 +9,10 @@
 #include "ofpi_ifnet.h"
 #include "ofpi_igmp_var.h"
 #include "ofpi_util.h"
+#include "ofpi_stat.h"
+#include "ofpi_ipsec.h"
+#include "ofpi_steer.h"
+#include "ofpi_tm.h"
 
 #include "ofp_errno.h"
 #include "ofp_log.h"
@@ -98,8 +102,48 @@ static int ofp_pktio_config(struct ofp_ifnet *ifnet)
                         ifnet->if_name);
         }
 
+	if (capa.config.pktin.bit.ts_all &&
+	    global_param->rx_timestamp >= 2) {
+		config.pktin.bit.ts_all = 1;
+		OFP_DBG("Interface '%s' timestamps received packets",
+			ifnet->if_name);
+	}
+
+	if (capa.config.parser.layer >= ODP_PROTO_LAYER_L4 &&
+	    config.parser.layer >= ODP_PROTO_LAYER_L4) {
+		ifnet->chksum_offload_flags |= OFP_IF_RX_PARSED;
+		OFP_DBG("Interface '%s' parses received packets",
+			ifnet->if_name);
+	}
+
+#ifdef ODP_LSO_PROFILE_INVALID
+	ifnet->lso_profile = ODP_LSO_PROFILE_INVALID;
+	if (capa.lso.proto.tcp_ipv4 && capa.lso.max_profiles &&
+	    global_param->chksum_offload.tcp_tso_ena)
+		config.enable_lso = 1;
+#endif
+
+	ofp_ipsec_pktio_config(ifnet->if_name, &capa, &config);
+
 	HANDLE_ERROR(odp_pktio_config(ifnet->pktio, &config));
 
+#ifdef ODP_LSO_PROFILE_INVALID
+	if (config.enable_lso) {
+		odp_lso_profile_param_t lso_param;
+
+		odp_lso_profile_param_init(&lso_param);
+		lso_param.lso_proto = ODP_LSO_PROTO_TCP_IPV4;
+		ifnet->lso_profile = odp_lso_profile_create(ifnet->pktio,
+							    &lso_param);
+		if (ifnet->lso_profile != ODP_LSO_PROFILE_INVALID) {
+			ifnet->chksum_offload_flags |= OFP_IF_TCP_TSO;
+			ifnet->lso_max_payload = capa.lso.max_payload_len;
+			OFP_DBG("Interface '%s' supports TCP segmentation offload",
+				ifnet->if_name);
+		}
+	}
+#endif
+
 	return 0;
 }
 
@@ -109,10 +153,17 @@ void ofp_pktin_queue_param_init(odp_pktin_queue_param_t *param,
 				odp_schedule_group_t sched_group)
 {
 	odp_queue_param_t *queue_param;
+	int num = global_param->if_queues.rx;
 
 	odp_pktin_queue_param_init(param);
 
-	param->num_queues = 1;
+	if (num <= 0)
+		num = odp_cpumask_default_worker(NULL, 0);
+	param->num_queues = num > 1 ? num : 1;
+	if (num > 1) {
+		param->hash_enable = 1;
+		param->hash_proto = global_param->if_queues.hash_proto;
+	}
 	queue_param = &param->queue_param;
 	odp_queue_param_init(queue_param);
 	if (in_mode == ODP_PKTIN_MODE_SCHED) {
@@ -131,9 +182,104 @@ void ofp_pktin_queue_param_init(odp_pktin_queue_param_t *param,
 	}
 }
 
+/*
+ * In share-nothing mode input is spread over one queue per worker CPU
+ * with flow hashing, so that all packets of a flow land on one core.
+ */
+static void ofp_pktin_queue_hash(struct ofp_ifnet *ifnet,
+				 odp_pktin_queue_param_t *pktin_param)
+{
+	odp_pktio_capability_t capa;
+	int num = odp_cpumask_default_worker(NULL, 0);
+
+	if (odp_pktio_capability(ifnet->pktio, &capa)) {
+		OFP_ERR("odp_pktio_capability failed");
+		return;
+	}
+
+	if (num > (int)capa.max_input_queues)
+		num = capa.max_input_queues;
+	if (num <= 1)
+		return;
+
+	pktin_param->num_queues = num;
+	pktin_param->hash_enable = 1;
+	pktin_param->hash_proto = global_param->if_queues.hash_proto;
+}
+
+/*
+ * Scheduled input queues deliver packet vectors if the interface
+ * supports them, see ofp_global_param_t.pktin_vector.
+ */
+static void ofp_pktin_queue_vector(struct ofp_ifnet *ifnet,
+				   odp_pktin_queue_param_t *pktin_param)
+{
+#ifdef OFP_PKTIN_VECTOR
+	odp_pktio_capability_t capa;
+	uint32_t size = global_param->pktin_vector.size;
+	uint64_t tmo_ns = global_param->pktin_vector.tmo_ns;
+
+	if (ofp_pktin_vector_pool == ODP_POOL_INVALID ||
+	    pktin_param->queue_param.type != ODP_QUEUE_TYPE_SCHED ||
+	    odp_pktio_capability(ifnet->pktio, &capa) ||
+	    capa.vector.supported == ODP_SUPPORT_NO)
+		return;
+
+	if (size > capa.vector.max_size)
+		size = capa.vector.max_size;
+	if (size < capa.vector.min_size)
+		return;
+	if (tmo_ns > capa.vector.max_tmo_ns)
+		tmo_ns = capa.vector.max_tmo_ns;
+	if (tmo_ns < capa.vector.min_tmo_ns)
+		tmo_ns = capa.vector.min_tmo_ns;
+
+	pktin_param->vector.enable = 1;
+	pktin_param->vector.pool = ofp_pktin_vector_pool;
+	pktin_param->vector.max_size = size;
+	pktin_param->vector.max_tmo_ns = tmo_ns;
+	OFP_DBG("Interface '%s' receives vectors of up to %u packets",
+		ifnet->if_name, size);
+#else
+	(void)ifnet;
+	(void)pktin_param;
+#endif /* OFP_PKTIN_VECTOR */
+}
+
 static int ofp_pktin_queue_config(struct ofp_ifnet *ifnet,
 	odp_pktin_queue_param_t *pktin_param)
 {
+	odp_pktin_queue_param_t hash_param;
+	odp_pktio_capability_t capa;
+
+	if (OFP_SHARE_NOTHING && pktin_param->num_queues == 1 &&
+	    !pktin_param->hash_enable) {
+		hash_param = *pktin_param;
+		ofp_pktin_queue_hash(ifnet, &hash_param);
+		pktin_param = &hash_param;
+	} else if (pktin_param->num_queues > 1 &&
+		   odp_pktio_capability(ifnet->pktio, &capa) == 0 &&
+		   pktin_param->num_queues > capa.max_input_queues) {
+		hash_param = *pktin_param;
+		hash_param.num_queues = capa.max_input_queues > 1 ?
+			capa.max_input_queues : 1;
+		hash_param.hash_enable = hash_param.num_queues > 1;
+		OFP_INFO("Interface '%s' limited to %u input queues",
+			 ifnet->if_name, hash_param.num_queues);
+		pktin_param = &hash_param;
+	}
+
+	ifnet->cos_def = ODP_COS_INVALID;
+	if (global_param->steering && !pktin_param->classifier_enable &&
+	    pktin_param->queue_param.type == ODP_QUEUE_TYPE_SCHED)
+		return ofp_steer_pktin_config(ifnet, pktin_param);
+
+	if (pktin_param != &hash_param) {
+		hash_param = *pktin_param;
+		pktin_param = &hash_param;
+	}
+	ofp_pktin_queue_vector(ifnet, pktin_param);
+
 	if (odp_pktin_queue_config(ifnet->pktio, pktin_param) < 0) {
 		OFP_ERR("Failed to create input queues.");
 		return -1;
@@ -142,12 +288,24 @@ static int ofp_pktin_queue_config(struct ofp_ifnet *ifnet,
 	return 0;
 }
 
-static void ofp_pktout_queue_param_init(odp_pktout_queue_param_t *param)
+static void ofp_pktout_queue_param_init(struct ofp_ifnet *ifnet,
+					odp_pktout_queue_param_t *param)
 {
+	odp_pktio_capability_t capa;
+	int num = global_param->if_queues.tx;
+
 	odp_pktout_queue_param_init(param);
 
+	if (num <= 0)
+		num = odp_cpumask_default_worker(NULL, 0);
+	if (num > OFP_PKTOUT_QUEUE_MAX)
+		num = OFP_PKTOUT_QUEUE_MAX;
+	if (num > 1 && odp_pktio_capability(ifnet->pktio, &capa) == 0 &&
+	    num > (int)capa.max_output_queues)
+		num = capa.max_output_queues;
+
 	param->op_mode = ODP_PKTIO_OP_MT;
-	param->num_queues = 1;
+	param->num_queues = num > 1 ? num : 1;
 }
 
 static int ofp_pktout_queue_config(struct ofp_ifnet *ifnet,
@@ -167,6 +325,38 @@ static int ofp_pktout_queue_config(struct ofp_ifnet *ifnet,
 	return 0;
 }
 
+int ofp_ifnet_pktin_queues(int port, int worker, int num_workers,
+			   odp_pktin_queue_t queue[], int num)
+{
+	struct ofp_ifnet *ifnet = ofp_get_ifnet((uint16_t)port, 0);
+	odp_pktin_queue_t all[OFP_PKTIN_QUEUE_MAX];
+	int n, i, ret = 0;
+
+	if (!PHYS_PORT(port) || !ifnet || ifnet->pktio == ODP_PKTIO_INVALID ||
+	    worker < 0 || worker >= num_workers) {
+		OFP_ERR("Invalid port %d or worker %d", port, worker);
+		return -1;
+	}
+
+	n = odp_pktin_queue(ifnet->pktio, all, OFP_PKTIN_QUEUE_MAX);
+	if (n <= 0) {
+		OFP_ERR("No direct input queues on %s", ifnet->if_name);
+		return -1;
+	}
+	if (n > OFP_PKTIN_QUEUE_MAX)
+		n = OFP_PKTIN_QUEUE_MAX;
+
+	/* Fewer queues than workers are shared */
+	if (n < num_workers) {
+		if (num > 0)
+			queue[ret++] = all[worker % n];
+		return ret;
+	}
+	for (i = worker; i < n && ret < num; i += num_workers)
+		queue[ret++] = all[i];
+	return ret;
+}
+
 /* Create loop queue */
 int ofp_loopq_create(struct ofp_ifnet *ifnet)
 {
@@ -260,18 +450,70 @@ int ofp_sp_inq_create(struct ofp_ifnet *ifnet)
 	qparam.sched.sync  = ODP_SCHED_SYNC_ATOMIC;
 	qparam.sched.group = ODP_SCHED_GROUP_ALL;
 
-	snprintf(q_name, sizeof(q_name), "%.20s_inq_def", ifnet->if_name);
-	q_name[ODP_QUEUE_NAME_LEN - 1] = '\0';
-
-	ifnet->spq_def = odp_queue_create(q_name, &qparam);
+	const int pps[OFP_SP_CLASS_MAX] = {
+		[OFP_SP_ROUTING] = global_param->slow_path.routing_pps,
+		[OFP_SP_ARP] = global_param->slow_path.arp_pps,
+		[OFP_SP_ICMP] = global_param->slow_path.icmp_pps,
+		[OFP_SP_OTHER] = global_param->slow_path.other_pps,
+	};
+	struct ofp_sp_police *police;
+	int i;
+
+	for (i = 0; i < OFP_SP_CLASS_MAX; i++) {
+		if (i == OFP_SP_OTHER)
+			snprintf(q_name, sizeof(q_name), "%.20s_inq_def",
+				 ifnet->if_name);
+		else
+			snprintf(q_name, sizeof(q_name), "%.20s_inq_sp%d",
+				 ifnet->if_name, i);
+		q_name[ODP_QUEUE_NAME_LEN - 1] = '\0';
+
+		ifnet->spq[i] = odp_queue_create(q_name, &qparam);
+
+		if (ifnet->spq[i] == ODP_QUEUE_INVALID) {
+			OFP_ERR("odp_queue_create failed");
+			return -1;
+		}
 
-	if (ifnet->spq_def == ODP_QUEUE_INVALID) {
-		OFP_ERR("odp_queue_create failed");
-		return -1;
+		police = &ifnet->sp_police[i];
+		odp_atomic_init_u64(&police->tat, 0);
+		odp_atomic_init_u64(&police->drops, 0);
+		police->interval_ns = pps[i] > 0 ? ODP_TIME_SEC_IN_NS / pps[i] : 0;
+		police->burst_ns = police->interval_ns *
+			(global_param->slow_path.burst > 0 ?
+			 global_param->slow_path.burst : 1);
 	}
 
 	return 0;
 }
+
+/* Start the VIF slow path receiver and transmitter threads */
+void ofp_sp_threads_start(struct ofp_ifnet *ifnet)
+{
+	odph_thread_param_t thr_params;
+	odph_thread_common_param_t thr_common_param;
+
+	odph_thread_param_init(&thr_params);
+	thr_params.start = sp_rx_thread;
+	thr_params.arg = ifnet;
+	thr_params.thr_type = ODP_THREAD_CONTROL;
+	odph_thread_common_param_init(&thr_common_param);
+	thr_common_param.cpumask = &cpumask;
+	odph_thread_create(ifnet->rx_tbl,
+			       &thr_common_param,
+			       &thr_params,
+				   1);
+
+	thr_params.start = sp_tx_thread;
+	thr_params.arg = ifnet;
+	thr_params.thr_type = ODP_THREAD_CONTROL;
+	odph_thread_common_param_init(&thr_common_param);
+	thr_common_param.cpumask = &cpumask;
+	odph_thread_create(ifnet->tx_tbl,
+			       &thr_common_param,
+			       &thr_params,
+				   1);
+}
 #endif /*SP*/
 
 int ofp_ifnet_create(odp_instance_t ,
@@ -285,10 +527,6 @@ int ofp_ifnet_create(odp_instance_t ,
 	odp_pktio_param_t pktio_param_local;
 	odp_pktin_queue_param_t pktin_param_local;
 	odp_pktout_queue_param_t pktout_param_local;
-#ifdef SP
-	odph_thread_param_t thr_params;
-	odph_thread_common_param_t thr_common_param;
-#endif /* SP */
 
 	//(void)instance;
 
@@ -307,6 +545,19 @@ int ofp_ifnet_create(odp_instance_t ,
 	ifnet->if_name[OFP_IFNAMSIZ-1] = 0;
 	ifnet->pkt_pool = ofp_packet_pool;
 
+	if (global_param->pkt_pool.per_interface) {
+		char name[ODP_POOL_NAME_LEN];
+
+		snprintf(name, sizeof(name), "%s_%d", SHM_PKT_POOL_NAME, port);
+		ifnet->pkt_pool = ofp_packet_pool_create(name);
+		if (ifnet->pkt_pool == ODP_POOL_INVALID) {
+			OFP_ERR("Failed to create packet pool for %s",
+				ifnet->if_name);
+			ifnet->pkt_pool = ofp_packet_pool;
+			return -1;
+		}
+	}
+
 	if (!pktio_param) {
 		pktio_param = &pktio_param_local;
 		odp_pktio_param_init(&pktio_param_local);
@@ -335,12 +586,17 @@ int ofp_ifnet_create(odp_instance_t ,
 
 	HANDLE_ERROR(ofp_pktin_queue_config(ifnet, pktin_param));
 
-	if (!pktout_param) {
-		pktout_param = &pktout_param_local;
-		ofp_pktout_queue_param_init(pktout_param);
-	}
+	if (pktio_param->out_mode == ODP_PKTOUT_MODE_TM) {
+		/* Output goes through the TM queues, no pktout queues */
+		HANDLE_ERROR(ofp_tm_ifnet_create(ifnet));
+	} else {
+		if (!pktout_param) {
+			pktout_param = &pktout_param_local;
+			ofp_pktout_queue_param_init(ifnet, pktout_param);
+		}
 
-	HANDLE_ERROR(ofp_pktout_queue_config(ifnet, pktout_param));
+		HANDLE_ERROR(ofp_pktout_queue_config(ifnet, pktout_param));
+	}
 
 	HANDLE_ERROR(ofp_loopq_create(ifnet));
 
@@ -390,33 +646,32 @@ int ofp_ifnet_create(odp_instance_t ,
 				ifnet->if_name);
 			return -1;
 		}
+	} else if (pktio_param->out_mode == ODP_PKTOUT_MODE_TM) {
+		HANDLE_ERROR(ofp_tm_ifnet_start(ifnet));
+		ifnet->out_queue_type = OFP_OUT_QUEUE_TYPE_TM;
+		ifnet->out_queue_num = 1;
+	}
+
+	/* No event queues in direct input mode, steering set them */
+	if (ifnet->cos_def == ODP_COS_INVALID)
+		ifnet->in_queue_num = 0;
+	if (pktio_param->in_mode != ODP_PKTIN_MODE_DIRECT &&
+	    ifnet->cos_def == ODP_COS_INVALID) {
+		int num = odp_pktin_event_queue(ifnet->pktio,
+						ifnet->in_queue_queue,
+						OFP_PKTIN_QUEUE_MAX);
+
+		if (num > OFP_PKTIN_QUEUE_MAX)
+			num = OFP_PKTIN_QUEUE_MAX;
+		if (num > 0)
+			ifnet->in_queue_num = num;
 	}
+	ofp_if_stat_clear(ifnet->stat_idx);
 
 	odp_pktio_stats_reset(ifnet->pktio);
 
 #ifdef SP
-	/* Start VIF slowpath receiver thread */
-	odph_thread_param_init(&thr_params);
-	thr_params.start = sp_rx_thread;
-	thr_params.arg = ifnet;
-	thr_params.thr_type = ODP_THREAD_CONTROL;
-	odph_thread_common_param_init(&thr_common_param);
-	thr_common_param.cpumask = &cpumask;
-	odph_thread_create(ifnet->rx_tbl,
-			       &thr_common_param,
-			       &thr_params,
-				   1);
-
-	/* Start VIF slowpath transmitter thread */
-	thr_params.start = sp_tx_thread;
-	thr_params.arg = ifnet;
-	thr_params.thr_type = ODP_THREAD_CONTROL;
-	odph_thread_common_param_init(&thr_common_param);
-	thr_common_param.cpumask = &cpumask;
-	odph_thread_create(ifnet->tx_tbl,
-			       &thr_common_param,
-			       &thr_params,
-				   1);
+	ofp_sp_threads_start(ifnet);
 #endif /* SP */
 
 	return 0;
@@ -78,6 +78,7 @@
 #include "ofp_log.h"
 #include "ofp_pkt_processing.h"
 #include "ofpi_pkt_processing.h"
+#include "ofpi_module.h"
 
 #ifndef KTR_IGMPV3
 #define KTR_IGMPV3 0x00200000 /* KTR_INET */
@@ -157,7 +158,6 @@ static const struct netisr_handler igmp_nh = {
 #define HDR2PKT(_hdr) (_hdr ? _hdr->pkt : ODP_PACKET_INVALID)
 
 struct socket *ofp_ip_mrouter = NULL;	/* multicast routing daemon */
-VNET_DEFINE(struct ofp_ipstat, ofp_ipstat);
 
 #if 0
 static void ofp_packet_set_flags(odp_packet_t pkt, int flags)
@@ -638,6 +638,10 @@ ofp_igmp_domifattach(struct ofp_ifnet *ifp)
 	CTR3(KTR_IGMPV3, "%s: called for ifp %p(%s)",
 	    __func__, ifp, ifp->if_name);
 
+	/* Groups are joined without reports */
+	if (!ofp_module_enabled(OFP_MODULE_IGMP))
+		return (NULL);
+
 	IGMP_LOCK();
 
 	igi = igi_alloc_locked(ifp);
@@ -706,6 +710,9 @@ ofp_igmp_ifdetach(struct ofp_ifnet *ifp)
 	CTR3(KTR_IGMPV3, "%s: called for ifp %p(%s)", __func__, ifp,
 	    ifp->if_name);
 
+	if (!ofp_module_enabled(OFP_MODULE_IGMP))
+		return;
+
 	IGMP_LOCK();
 
 	igi = ((struct ofp_in_ifinfo *)ifp->if_afdata[OFP_AF_INET])->ii_igmp;
@@ -751,6 +758,9 @@ ofp_igmp_domifdetach(struct ofp_ifnet *ifp)
 	CTR3(KTR_IGMPV3, "%s: called for ifp %p(%s)",
 	    __func__, ifp, ifp->if_name);
 
+	if (!ofp_module_enabled(OFP_MODULE_IGMP))
+		return;
+
 	IGMP_LOCK();
 
 	igi = ((struct ofp_in_ifinfo *)ifp->if_afdata[OFP_AF_INET])->ii_igmp;
@@ -2317,6 +2327,12 @@ ofp_igmp_change_state(struct ofp_in_multi *inm)
 
 	error = 0;
 
+	/* As on a silent interface, the change is complete at once */
+	if (!ofp_module_enabled(OFP_MODULE_IGMP)) {
+		ofp_inm_commit(inm);
+		return (error);
+	}
+
 	/*
 	 * Try to detect if the upper layer just asked us to change state
 	 * for an interface which has now gone away.
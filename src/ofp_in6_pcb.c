@@ -131,7 +131,7 @@ ofp_in6_pcbbind(register struct inpcb *inp, struct ofp_sockaddr *nam,
 
 	struct socket *so = inp->inp_socket;
 	struct ofp_sockaddr_in6 *sin6 = (struct ofp_sockaddr_in6 *)NULL;
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 	u_short	lport = 0;
 	int error, lookupflags = 0;
 	int reuseport = (so->so_options & OFP_SO_REUSEPORT);
@@ -326,6 +326,8 @@ ofp_in6_pcbbind(register struct inpcb *inp, struct ofp_sockaddr *nam,
 			return (OFP_EAGAIN);
 		}
 	}
+	if (reuseport)
+		inp->inp_flags2 |= INP_REUSEPORT;
 
 	return (0);
 }
@@ -355,7 +357,7 @@ ofp_in6_pcbladdr(register struct inpcb *inp, struct ofp_sockaddr *nam,
 	struct ofp_in6_addr in6a;
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);	/* XXXRW: why? */
+	INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);	/* XXXRW: why? */
 
 	if (nam->sa_len != sizeof (*sin6))
 		return (OFP_EINVAL);
@@ -433,7 +435,7 @@ int
 ofp_in6_pcbconnect_mbuf(register struct inpcb *inp, struct ofp_sockaddr *nam,
     struct ofp_ucred *cred, odp_packet_t m)
 {
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 	register struct ofp_sockaddr_in6 *sin6 =
 		(struct ofp_sockaddr_in6 *)nam;
 	struct ofp_in6_addr addr6;
@@ -493,7 +495,7 @@ ofp_in6_pcbdisconnect(struct inpcb *inp)
 {
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+	INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);
 
 	bzero((caddr_t)&inp->in6p_faddr, sizeof(inp->in6p_faddr));
 	inp->inp_fport = 0;
@@ -761,8 +763,7 @@ ofp_in6_pcblookup_local(struct inpcbinfo *pcbinfo, struct ofp_in6_addr *laddr,
 		 * Look for an unconnected (wildcard foreign addr) PCB that
 		 * matches the local address and port we're looking for.
 		 */
-		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(OFP_INADDR_ANY, lport,
-		    0, pcbinfo->ipi_hashmask)];
+		head = ofp_in_pcbhash_head(pcbinfo, OFP_INADDR_ANY, lport, 0);
 		OFP_LIST_FOREACH(inp, head, inp_hash) {
 			/* XXX inp locking */
 			if ((inp->inp_vflag & INP_IPV6) == 0)
@@ -1056,7 +1057,7 @@ ofp_in6_pcbsetport(struct ofp_in6_addr *laddr, struct inpcb *inp, struct ofp_ucr
 	uint16_t lport = 0;
 	int error, lookupflags = 0;
 #ifdef INVARIANTS
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 #endif
 
 	INP_WLOCK_ASSERT(inp);
@@ -1109,12 +1110,15 @@ ofp_in6_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in6_addr *fa
 
 	INP_HASH_LOCK_ASSERT(pcbinfo);
 
+	if (ofp_in_pcbidx_demux(pcbinfo, 1, faddr, fport, laddr, lport,
+				lookupflags, &inp))
+		return (inp);
+
 	/*
 	 * First look for an exact match.
 	 */
-	head = &pcbinfo->ipi_hashbase[
-	    INP_PCBHASH(faddr->ofp_s6_addr32[3] /* XXX */, lport, fport,
-	    pcbinfo->ipi_hashmask)];
+	head = ofp_in_pcbhash_head(pcbinfo,
+	    faddr->ofp_s6_addr32[3] /* XXX */, lport, fport);
 
 	OFP_LIST_FOREACH(inp, head, inp_hash) {
 		/* XXX inp locking */
@@ -1149,8 +1153,7 @@ ofp_in6_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in6_addr *fa
 		 *      3. non-jailed, non-wild.
 		 *      4. non-jailed, wild.
 		 */
-		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(OFP_INADDR_ANY, lport,
-		    0, pcbinfo->ipi_hashmask)];
+		head = ofp_in_pcbhash_head(pcbinfo, OFP_INADDR_ANY, lport, 0);
 
 		OFP_LIST_FOREACH(inp, head, inp_hash) {
 			/* XXX inp locking */
@@ -1179,12 +1182,14 @@ ofp_in6_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in6_addr *fa
 			if (OFP_IN6_ARE_ADDR_EQUAL(&inp->in6p_laddr, laddr)) {
 				if (injail)
 					return (inp);
-				else
+				else if (local_exact == NULL ||
+					 ofp_in_pcb_reuseport_local(inp))
 					local_exact = inp;
 			} else if (OFP_IN6_IS_ADDR_UNSPECIFIED(&inp->in6p_laddr)) {
 				if (injail)
 					jail_wild = inp;
-				else
+				else if (local_wild == NULL ||
+					 ofp_in_pcb_reuseport_local(inp))
 					local_wild = inp;
 			}
 		} /* OFP_LIST_FOREACH */
@@ -1267,6 +1272,10 @@ ofp_in6_pcblookup(struct inpcbinfo *pcbinfo, struct ofp_in6_addr *faddr, u_int f
 	}
 #endif
 
+	pcbinfo = ofp_in_pcbinfo_vrf(pcbinfo, ifp ? ifp->vrf : 0);
+	if (pcbinfo == NULL)
+		return (NULL);
+
 	return (in6_pcblookup_hash(pcbinfo, faddr, fport, laddr, lport,
 	    lookupflags, ifp));
 }
@@ -1302,6 +1311,10 @@ ofp_in6_pcblookup_mbuf(struct inpcbinfo *pcbinfo, struct ofp_in6_addr *faddr,
 	}
 #endif
 
+	pcbinfo = ofp_in_pcbinfo_vrf(pcbinfo, ifp ? ifp->vrf : 0);
+	if (pcbinfo == NULL)
+		return (NULL);
+
 	return (in6_pcblookup_hash(pcbinfo, faddr, fport, laddr, lport,
 	    lookupflags, ifp));
 }
@@ -72,6 +72,7 @@
 #include "ofpi_ip6_var.h"
 #include "ofpi_socket.h"
 #include "ofpi_icmp6.h"
+#include "ofpi_reass.h"
 
 /*
  * TCP/IP protocol family: IP6, ICMP6, UDP, TCP.
@@ -233,7 +234,7 @@ struct ip6protosw ofp_inet6sw[] = {
 	.pr_init =		NULL,
 	.pr_destroy =		NULL,
 	.pr_flags =		PR_ATOMIC|PR_ADDR,
-	.pr_input =		ofp_ip6_unrecognized_hdr_input,
+	.pr_input =		ofp_frag6_input,
 	.pr_usrreqs =		&nousrreqs
 },
 {
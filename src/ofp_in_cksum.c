@@ -9,6 +9,8 @@
 #include <odp_api.h>
 #include "ofpi_in.h"
 #include "ofpi_ip.h"
+#include "ofpi_tcp.h"
+#include "ofpi_udp.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
 
@@ -63,7 +65,8 @@ uint16_t ofp_cksum_iph(const void *addr, int ip_hl)
 	return ~ofp_cksum_fold(sum);
 }
 
-uint16_t ofp_cksum_buffer(const void *addr, int len)
+/* Unfolded sum of the 16-bit words of a buffer */
+static uint64_t cksum_sum_scalar(const void *addr, int len)
 {
 	register int nleft = len;
 	register uint64_t sum = 0;
@@ -126,7 +129,108 @@ uint16_t ofp_cksum_buffer(const void *addr, int len)
 	if (nleft == 1)
 		sum += odp_cpu_to_be_16(*(const uint8_t *)w << 8);
 
-	return ~ofp_cksum_fold(sum);
+	return sum;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+# define CKSUM_VECTOR 1
+
+/*
+ * 32-bit words are widened to 64-bit lanes, so the lanes cannot
+ * overflow for any int length.
+ */
+__attribute__((target("avx2")))
+static uint64_t cksum_sum_avx2(const void *addr, int len)
+{
+	const uint8_t *p = addr;
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc0 = zero, acc1 = zero;
+	uint64_t lane[4];
+
+	while (len >= 64) {
+		__m256i v0 = _mm256_loadu_si256((const __m256i *)p);
+		__m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v0, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v0, zero));
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v1, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v1, zero));
+		p += 64;
+		len -= 64;
+	}
+
+	_mm256_storeu_si256((__m256i *)lane, _mm256_add_epi64(acc0, acc1));
+
+	return lane[0] + lane[1] + lane[2] + lane[3] +
+		cksum_sum_scalar(p, len);
+}
+
+static int cksum_vector_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+# define cksum_sum_vector cksum_sum_avx2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+# define CKSUM_VECTOR 1
+
+/* Pairwise add and accumulate into 64-bit lanes */
+static uint64_t cksum_sum_neon(const void *addr, int len)
+{
+	const uint8_t *p = addr;
+	uint64x2_t acc0 = vdupq_n_u64(0), acc1 = vdupq_n_u64(0);
+
+	while (len >= 64) {
+		acc0 = vpadalq_u32(acc0, vld1q_u32((const uint32_t *)p));
+		acc1 = vpadalq_u32(acc1, vld1q_u32((const uint32_t *)(p + 16)));
+		acc0 = vpadalq_u32(acc0, vld1q_u32((const uint32_t *)(p + 32)));
+		acc1 = vpadalq_u32(acc1, vld1q_u32((const uint32_t *)(p + 48)));
+		p += 64;
+		len -= 64;
+	}
+
+	return vaddvq_u64(vaddq_u64(acc0, acc1)) + cksum_sum_scalar(p, len);
+}
+
+/* Advanced SIMD is mandatory on ARMv8 */
+static int cksum_vector_supported(void)
+{
+	return 1;
+}
+
+# define cksum_sum_vector cksum_sum_neon
+#else
+# define CKSUM_VECTOR 0
+#endif
+
+/* Below this length the vector setup costs more than it saves */
+#define CKSUM_VECTOR_MIN 128
+
+static uint64_t (*cksum_sum_bulk)(const void *addr, int len) =
+	cksum_sum_scalar;
+
+void ofp_cksum_init_global(void)
+{
+#if CKSUM_VECTOR
+	if (cksum_vector_supported())
+		cksum_sum_bulk = cksum_sum_vector;
+#endif
+}
+
+static inline uint64_t cksum_sum(const void *addr, int len)
+{
+	if (len < CKSUM_VECTOR_MIN)
+		return cksum_sum_scalar(addr, len);
+
+	return cksum_sum_bulk(addr, len);
+}
+
+uint16_t ofp_cksum_buffer(const void *addr, int len)
+{
+	return ~ofp_cksum_fold(cksum_sum(addr, len));
 }
 
 #define ADDCARRY(x)  (x > 65535 ? x -= 65535 : x)
@@ -152,6 +256,7 @@ uint16_t ofp_cksum(const odp_packet_t pkt, unsigned int off, unsigned int len)
 
 		if (off >= seglen) {
 			off -= seglen;
+			seg = odp_packet_next_seg(pkt, seg);
 			continue;
 		}
 
@@ -160,7 +265,7 @@ uint16_t ofp_cksum(const odp_packet_t pkt, unsigned int off, unsigned int len)
 			cksum_len = len;
 
 		cksum_data = (uint8_t *)odp_packet_seg_data(pkt, seg) + off;
-		tmp = ~ofp_cksum_buffer(cksum_data, cksum_len);
+		tmp = ofp_cksum_fold(cksum_sum(cksum_data, cksum_len));
 
 		/* swap bytes on odd boundary */
 		if (done % 2)
@@ -221,3 +326,76 @@ uint16_t ofp_in4_cksum(const odp_packet_t pkt)
 	REDUCE;
 	return (~sum & 0xffff);
 }
+
+/* TCP or UDP checksum covering the IP header, NULL if none */
+static uint16_t *l4_cksum_ptr(struct ofp_ip *ip)
+{
+	uint8_t *l4;
+	uint16_t *sum;
+
+	if (ip->ip_off & odp_cpu_to_be_16(OFP_IP_OFFMASK))
+		return NULL;
+
+	l4 = (uint8_t *)ip + (ip->ip_hl << 2);
+
+	switch (ip->ip_p) {
+	case OFP_IPPROTO_TCP:
+		return (uint16_t *)(void *)
+			(l4 + offsetof(struct ofp_tcphdr, th_sum));
+	case OFP_IPPROTO_UDP:
+		sum = (uint16_t *)(void *)
+			(l4 + offsetof(struct ofp_udphdr, uh_sum));
+		/* Zero UDP checksum means none */
+		return *sum ? sum : NULL;
+	default:
+		return NULL;
+	}
+}
+
+static inline void l4_cksum_set(struct ofp_ip *ip, uint16_t *sum,
+				uint16_t value)
+{
+	/* A computed zero UDP checksum is sent as all ones */
+	if (value == 0 && ip->ip_p == OFP_IPPROTO_UDP)
+		value = 0xffff;
+	*sum = value;
+}
+
+static void rewrite_addr(struct ofp_ip *ip, uint32_t old, uint32_t new)
+{
+	uint16_t *sum;
+
+	ip->ip_sum = ofp_cksum_adjust32(ip->ip_sum, old, new);
+
+	sum = l4_cksum_ptr(ip);
+	if (sum)
+		l4_cksum_set(ip, sum, ofp_cksum_adjust32(*sum, old, new));
+}
+
+void ofp_ip_rewrite_src(struct ofp_ip *ip, uint32_t addr)
+{
+	uint32_t old = ip->ip_src.s_addr;
+
+	ip->ip_src.s_addr = addr;
+	rewrite_addr(ip, old, addr);
+}
+
+void ofp_ip_rewrite_dst(struct ofp_ip *ip, uint32_t addr)
+{
+	uint32_t old = ip->ip_dst.s_addr;
+
+	ip->ip_dst.s_addr = addr;
+	rewrite_addr(ip, old, addr);
+}
+
+void ofp_ip_rewrite_port(struct ofp_ip *ip, uint16_t *port, uint16_t new)
+{
+	uint16_t old = *port;
+	uint16_t *sum;
+
+	*port = new;
+
+	sum = l4_cksum_ptr(ip);
+	if (sum)
+		l4_cksum_set(ip, sum, ofp_cksum_adjust16(*sum, old, new));
+}
@@ -38,6 +38,7 @@
 #include "ofpi.h"
 #include "ofpi_tree.h"
 #include "ofpi_util.h"
+#include "ofpi_hash.h"
 #include "ofpi_debug.h"
 #include "ofpi_systm.h"
 #include "ofpi_protosw.h"
@@ -354,6 +355,138 @@ imo_grow(struct ofp_ip_moptions *imo)
 	return (0);
 }
 
+/*
+ * Index of the in_multi records by (group, interface), read without
+ * locks by the receive path and updated under the IN_MULTI lock when
+ * a record is created or freed. The interface implies the VRF.
+ *
+ * A key may be stored in either of two buckets of INM_INDEX_WAYS
+ * entries. Records that fit in neither are counted in
+ * inm_index_overflow, and while there are any, a key missing from the
+ * index means "unknown" instead of "not joined".
+ *
+ * Readers only compare the record pointers found in the index, they
+ * never dereference them.
+ */
+#define INM_INDEX_WAYS 4
+#define INM_INDEX_BUCKETS 4096
+
+struct inm_index_bucket {
+	struct {
+		uint64_t key;
+		struct ofp_in_multi *inm;
+	} e[INM_INDEX_WAYS];
+} ODP_ALIGNED_CACHE;
+
+static struct inm_index_bucket inm_index[INM_INDEX_BUCKETS];
+static uint32_t inm_index_overflow;
+
+static inline uint64_t
+inm_index_key(const struct ofp_ifnet *ifp, struct ofp_in_addr group)
+{
+	return (uint64_t)group.s_addr << 32 | (uint32_t)ifp->port << 16 |
+		ifp->vlan;
+}
+
+static inline void
+inm_index_buckets(uint64_t key, struct inm_index_bucket *b[2])
+{
+	uint32_t k[2] = { (uint32_t)key, (uint32_t)(key >> 32) };
+	uint32_t hash = ofp_hash_key(k, 2, 0);
+
+	b[0] = &inm_index[hash & (INM_INDEX_BUCKETS - 1)];
+	b[1] = &inm_index[(hash >> 16) & (INM_INDEX_BUCKETS - 1)];
+}
+
+static void
+inm_index_add(struct ofp_in_multi *inm)
+{
+	struct inm_index_bucket *b[2];
+	uint64_t key = inm_index_key(inm->inm_ifp, inm->inm_addr);
+	int i, w;
+
+	IN_MULTI_LOCK_ASSERT();
+
+	inm_index_buckets(key, b);
+	for (i = 0; i < 2; i++)
+		for (w = 0; w < INM_INDEX_WAYS; w++)
+			if (b[i]->e[w].key == 0) {
+				b[i]->e[w].inm = inm;
+				__atomic_store_n(&b[i]->e[w].key, key,
+						 __ATOMIC_RELEASE);
+				return;
+			}
+
+	__atomic_store_n(&inm_index_overflow, inm_index_overflow + 1,
+			 __ATOMIC_RELEASE);
+}
+
+static void
+inm_index_del(struct ofp_in_multi *inm)
+{
+	struct inm_index_bucket *b[2];
+	uint64_t key = inm_index_key(inm->inm_ifp, inm->inm_addr);
+	int i, w;
+
+	IN_MULTI_LOCK_ASSERT();
+
+	inm_index_buckets(key, b);
+	for (i = 0; i < 2; i++)
+		for (w = 0; w < INM_INDEX_WAYS; w++)
+			if (b[i]->e[w].key == key &&
+			    b[i]->e[w].inm == inm) {
+				__atomic_store_n(&b[i]->e[w].key, 0,
+						 __ATOMIC_RELEASE);
+				return;
+			}
+
+	__atomic_store_n(&inm_index_overflow, inm_index_overflow - 1,
+			 __ATOMIC_RELEASE);
+}
+
+/*
+ * Find the record of group on ifp. Returns 0 and sets *inm, which is
+ * NULL if the group has not been joined on ifp, or -1 if the index
+ * cannot tell.
+ */
+static int
+inm_index_lookup(const struct ofp_ifnet *ifp, struct ofp_in_addr group,
+		 struct ofp_in_multi **inm)
+{
+	struct inm_index_bucket *b[2];
+	uint64_t key = inm_index_key(ifp, group);
+	int i, w;
+
+	inm_index_buckets(key, b);
+	for (i = 0; i < 2; i++)
+		for (w = 0; w < INM_INDEX_WAYS; w++) {
+			if (__atomic_load_n(&b[i]->e[w].key,
+					    __ATOMIC_ACQUIRE) != key)
+				continue;
+			*inm = __atomic_load_n(&b[i]->e[w].inm,
+					       __ATOMIC_RELAXED);
+			/* The entry may have been reused meanwhile */
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&b[i]->e[w].key,
+					    __ATOMIC_RELAXED) == key)
+				return 0;
+		}
+
+	if (__atomic_load_n(&inm_index_overflow, __ATOMIC_ACQUIRE))
+		return -1;
+
+	*inm = NULL;
+	return 0;
+}
+
+int
+ofp_in_mcast_member(const struct ofp_ifnet *ifp, struct ofp_in_addr group)
+{
+	struct ofp_in_multi *inm;
+
+	return inm_index_lookup(ifp, group, &inm) || inm != NULL;
+}
+
 /*
  * Find an IPv4 multicast group entry for this ip_moptions instance
  * which matches the specified group, and optionally an interface.
@@ -365,6 +498,7 @@ imo_match_group(const struct ofp_ip_moptions *imo, const struct ofp_ifnet *ifp,
 {
 	const struct ofp_sockaddr_in *gsin;
 	struct ofp_in_multi	**pinm;
+	struct ofp_in_multi	*inm;
 	int		  idx;
 	int		  nmships;
 
@@ -376,6 +510,18 @@ imo_match_group(const struct ofp_ip_moptions *imo, const struct ofp_ifnet *ifp,
 
 	nmships = imo->imo_num_memberships;
 	pinm = &imo->imo_membership[0];
+
+	/* With an interface, look for the record without touching it */
+	if (ifp != NULL &&
+	    inm_index_lookup(ifp, gsin->sin_addr, &inm) == 0) {
+		if (inm == NULL)
+			return (-1);
+		for (idx = 0; idx < nmships; idx++)
+			if (pinm[idx] == inm)
+				return (idx);
+		return (-1);
+	}
+
 	for (idx = 0; idx < nmships; idx++, pinm++) {
 		if (*pinm == NULL)
 			continue;
@@ -571,6 +717,7 @@ in_getmulti(struct ofp_ifnet *ifp, const struct ofp_in_addr *group,
 	RB_INIT(&inm->inm_srcs);
 
 	ifma->ifma_protospec = inm;
+	inm_index_add(inm);
 
 	*pinm = inm;
 
@@ -608,6 +755,7 @@ ofp_inm_release_locked(struct ofp_in_multi *inm)
 	KASSERT(ifma->ifma_protospec == inm,
 	    ("%s: ifma_protospec != inm", __func__));
 	ifma->ifma_protospec = NULL;
+	inm_index_del(inm);
 
 	inm_purge(inm);
 
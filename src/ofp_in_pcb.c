@@ -36,6 +36,8 @@
  *
  */
 
+#include <inttypes.h>
+#include <string.h>
 #include <strings.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -60,15 +62,23 @@
 
 #include "ofpi_log.h"
 #include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define	HASH_NOWAIT	0x00000001
 #define	HASH_WAITOK	0x00000002
 extern void *ofp_hashinit(int count, void *type, uint64_t *hashmask);
 extern void  ofp_hashdestroy(void *vhashtbl, void *type, uint64_t hashmask);
 
-extern struct inpcbinfo ofp_udbinfo;
 
 static void in_pcbremlists(struct inpcb *inp);
+static void in_pcbidx_init(struct inpcbinfo *pcbinfo, const char *name,
+			   int nitems);
+static void in_pcbidx_add(struct inpcb *inp);
+static void in_pcbidx_del(struct inpcb *inp);
 static struct inpcb *
 in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 			 uint32_t fport_arg, struct ofp_in_addr laddr,
@@ -97,7 +107,175 @@ refcount_release(odp_atomic_u32_t *count)
 	return (old == 1);
 }
 
-#ifdef OFP_RSS
+uint32_t
+ofp_in_pcbhash_size(int pcbs)
+{
+	uint32_t size = OFP_PCBHASH_INIT_SIZE;
+
+	while (size < (uint32_t)pcbs && size < (1U << 30))
+		size <<= 1;
+	return size;
+}
+
+/*
+ * Start a hash allocated for ipi_hashmask + 1 buckets with
+ * OFP_PCBHASH_INIT_SIZE of them in use.
+ */
+static void
+in_pcbhash_setup(struct inpcbinfo *pcbinfo)
+{
+	pcbinfo->ipi_hashmaxmask = pcbinfo->ipi_hashmask;
+	if (pcbinfo->ipi_hashmask >= OFP_PCBHASH_INIT_SIZE)
+		pcbinfo->ipi_hashmask = OFP_PCBHASH_INIT_SIZE - 1;
+	pcbinfo->ipi_hashsplit = 0;
+}
+
+static inline uint32_t
+in_pcbhash_faddr(struct inpcb *inp)
+{
+#ifdef INET6
+	if (inp->inp_vflag & INP_IPV6)
+		return inp->in6p_faddr.ofp_s6_addr32[3] /* XXX */;
+#endif /* INET6 */
+	return inp->inp_faddr.s_addr;
+}
+
+/*
+ * Split the next bucket of the hash, moving the inpcbs that the doubled
+ * mask puts in the upper half.
+ */
+static void
+in_pcbhash_split(struct inpcbinfo *pcbinfo)
+{
+	uint64_t size = pcbinfo->ipi_hashmask + 1;
+	uint64_t mask = (pcbinfo->ipi_hashmask << 1) | 1;
+	uint64_t bucket = pcbinfo->ipi_hashsplit;
+	struct inpcbhead *head = &pcbinfo->ipi_hashbase[bucket];
+	struct inpcbhead *upper = &pcbinfo->ipi_hashbase[bucket + size];
+	struct inpcb *inp, *inp_temp;
+
+	OFP_LIST_FOREACH_SAFE(inp, head, inp_hash, inp_temp) {
+		if (INP_PCBHASH(in_pcbhash_faddr(inp), inp->inp_lport,
+				inp->inp_fport, mask) == bucket)
+			continue;
+		OFP_LIST_REMOVE(inp, inp_hash);
+		OFP_LIST_INSERT_HEAD(upper, inp, inp_hash);
+	}
+
+	if (++pcbinfo->ipi_hashsplit == size) {
+		pcbinfo->ipi_hashmask = mask;
+		pcbinfo->ipi_hashsplit = 0;
+	}
+}
+
+/*
+ * Grow the hash when the chains get long. The doubling is spread over
+ * the following insertions so that none of them moves the whole table.
+ */
+static void
+in_pcbhash_grow(struct inpcbinfo *pcbinfo)
+{
+	int i;
+
+	INP_HASH_WLOCK_ASSERT(pcbinfo);
+
+	if (pcbinfo->ipi_hashmask == pcbinfo->ipi_hashmaxmask)
+		return;
+	if (!pcbinfo->ipi_hashsplit && pcbinfo->ipi_count <=
+	    (pcbinfo->ipi_hashmask + 1) * OFP_PCBHASH_LOAD)
+		return;
+
+	for (i = 0; i < OFP_PCBHASH_REHASH_STEP; i++) {
+		in_pcbhash_split(pcbinfo);
+		if (!pcbinfo->ipi_hashsplit)
+			break;
+	}
+}
+
+/*
+ * Room for the hash tables of the other VRFs, allocated on first use.
+ */
+static void
+in_pcbinfo_vrf_init(struct inpcbinfo *pcbinfo)
+{
+	pcbinfo->ipi_vrf = NULL;
+	pcbinfo->ipi_nvrf = 0;
+	if (global_param->num_vrf <= 1)
+		return;
+
+	pcbinfo->ipi_vrf = calloc(global_param->num_vrf,
+				  sizeof(*pcbinfo->ipi_vrf));
+	if (pcbinfo->ipi_vrf == NULL) {
+		OFP_ERR("VRF hash tables not allocated, VRFs share one");
+		return;
+	}
+	pcbinfo->ipi_nvrf = global_param->num_vrf;
+}
+
+/*
+ * Hash tables of a VRF, sized like those of the parent.
+ */
+static struct inpcbinfo *
+in_pcbinfo_vrf_alloc(struct inpcbinfo *pcbinfo)
+{
+	struct inpcbinfo *hashinfo;
+
+	hashinfo = calloc(1, sizeof(*hashinfo));
+	if (hashinfo == NULL)
+		return NULL;
+
+	INP_HASH_LOCK_INIT(hashinfo, "pcbinfohash");
+	hashinfo->ipi_zone = pcbinfo->ipi_zone;
+	hashinfo->ipi_hashbase = ofp_hashinit(pcbinfo->ipi_hashmaxmask + 1, 0,
+					      &hashinfo->ipi_hashmask);
+	hashinfo->ipi_porthashbase = ofp_hashinit(pcbinfo->ipi_porthashmask + 1,
+						  0, &hashinfo->ipi_porthashmask);
+	if (hashinfo->ipi_hashbase == NULL ||
+	    hashinfo->ipi_porthashbase == NULL) {
+		free(hashinfo->ipi_hashbase);
+		free(hashinfo->ipi_porthashbase);
+		free(hashinfo);
+		return NULL;
+	}
+	in_pcbhash_setup(hashinfo);
+
+	return hashinfo;
+}
+
+/*
+ * Hash tables for a new inpcb of the VRF, allocated if it is the first.
+ */
+static int
+in_pcbinfo_vrf_get(struct inpcbinfo *pcbinfo, int vrf,
+		   struct inpcbinfo **hashinfop)
+{
+	struct inpcbinfo *hashinfo;
+
+	INP_INFO_WLOCK_ASSERT(pcbinfo);
+
+	if (vrf == 0 || pcbinfo->ipi_vrf == NULL) {
+		*hashinfop = pcbinfo;
+		return 0;
+	}
+	if (vrf < 0 || vrf >= pcbinfo->ipi_nvrf)
+		return (OFP_EINVAL);
+
+	hashinfo = pcbinfo->ipi_vrf[vrf];
+	if (hashinfo == NULL) {
+		hashinfo = in_pcbinfo_vrf_alloc(pcbinfo);
+		if (hashinfo == NULL)
+			return (OFP_ENOBUFS);
+		/* Lookups read it without ipi_lock */
+		__atomic_store_n(&pcbinfo->ipi_vrf[vrf], hashinfo,
+				 __ATOMIC_RELEASE);
+	}
+	*hashinfop = hashinfo;
+	return 0;
+}
+
+/*
+ * Initialize the TCP inpcbinfo of each core for share-nothing mode.
+ */
 void ofp_tcp_rss_in_pcbinfo_init( int hash_nelements, int porthash_nelements,
     uma_init inpcbzone_init, uma_fini inpcbzone_fini, uint32_t inpcbzone_flags)
 {
@@ -108,7 +286,7 @@ void ofp_tcp_rss_in_pcbinfo_init( int hash_nelements, int porthash_nelements,
 	(void)inpcbzone_fini;
 	(void)inpcbzone_flags;
 
-	for (cpu_id = 0; cpu_id < odp_cpu_count(); cpu_id++) {
+	for (cpu_id = 0; cpu_id < TCP_NUM_CPU; cpu_id++) {
 		struct inpcbinfo *pcbinfo = &shm_tcp->ofp_tcbinfo[cpu_id];
 		struct inpcbhead *listhead = &shm_tcp->ofp_tcb[cpu_id];
 		char name_cpu[16];
@@ -122,13 +300,16 @@ void ofp_tcp_rss_in_pcbinfo_init( int hash_nelements, int porthash_nelements,
 		OFP_LIST_INIT(pcbinfo->ipi_listhead);
 		pcbinfo->ipi_count = 0;
 
-		pcbinfo->ipi_hashbase = shm_tcp->ofp_hashtbl;
+		pcbinfo->ipi_hashbase =
+			&shm_tcp->ofp_hashtbl[cpu_id * hash_nelements];
 		ofp_tcp_hashinit(hash_nelements, &pcbinfo->ipi_hashmask,
 				pcbinfo->ipi_hashbase);
+		in_pcbhash_setup(pcbinfo);
 
-		pcbinfo->ipi_porthashbase = shm_tcp->ofp_porthashtbl;
+		pcbinfo->ipi_porthashbase =
+			&shm_tcp->ofp_porthashtbl[cpu_id * porthash_nelements];
 		ofp_tcp_hashinit(porthash_nelements,
-			&pcbinfo->ipi_hashmask,
+			&pcbinfo->ipi_porthashmask,
 			pcbinfo->ipi_porthashbase);
 
 		sprintf (name_cpu, "tcp_inpcb_%u", cpu_id);
@@ -140,12 +321,15 @@ void ofp_tcp_rss_in_pcbinfo_init( int hash_nelements, int porthash_nelements,
 		if (pcbinfo->ipi_zone == -1)
 			OFP_ERR("ipi_zone for pcbinfo NOT allocated!");
 
+		sprintf (name_cpu, "tcp_%u", cpu_id);
+		in_pcbidx_init(pcbinfo, name_cpu, global_param->pcb_tcp_max);
+		in_pcbinfo_vrf_init(pcbinfo);
+
 		uma_zone_set_max(pcbinfo->ipi_zone, maxsockets);
 	}
 
 	return;
 }
-#endif
 
 /*
  * Initialize an inpcbinfo -- we should be able to reduce the number of
@@ -157,7 +341,7 @@ ofp_in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
     const char *inpcbzone_name, uma_init inpcbzone_init, uma_fini inpcbzone_fini,
     uint32_t inpcbzone_flags)
 {
-	int pcb_size = OFP_NUM_SOCKETS_MAX;
+	int pcb_size = global_param->socket_max;
 
 	/* make compiler happy */
 	(void)inpcbzone_init;
@@ -176,8 +360,8 @@ ofp_in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
 			pcbinfo->ipi_hashbase);
 
 		pcbinfo->ipi_porthashbase = shm_tcp->ofp_porthashtbl;
-		ofp_tcp_hashinit(porthash_nelements, &pcbinfo->ipi_hashmask,
-                        pcbinfo->ipi_porthashbase);
+		ofp_tcp_hashinit(porthash_nelements, &pcbinfo->ipi_porthashmask,
+			pcbinfo->ipi_porthashbase);
 		pcb_size = global_param->pcb_tcp_max;
 	} else {
 		pcbinfo->ipi_hashbase = ofp_hashinit(hash_nelements, 0,
@@ -185,12 +369,19 @@ ofp_in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
 		pcbinfo->ipi_porthashbase = ofp_hashinit(porthash_nelements, 0,
 		    &pcbinfo->ipi_porthashmask);
 	}
+	in_pcbhash_setup(pcbinfo);
 
-	pcbinfo->ipi_zone = uma_zcreate(
-		inpcbzone_name, pcb_size, sizeof(struct inpcb),
-		NULL, NULL, inpcbzone_init, inpcbzone_fini, UMA_ALIGN_PTR,
-		inpcbzone_flags);
-	uma_zone_set_max(pcbinfo->ipi_zone, maxsockets);
+	/* Without a zone name the caller sets a zone shared by tables */
+	if (inpcbzone_name) {
+		pcbinfo->ipi_zone = uma_zcreate(
+			inpcbzone_name, pcb_size, sizeof(struct inpcb),
+			NULL, NULL, inpcbzone_init, inpcbzone_fini,
+			UMA_ALIGN_PTR, inpcbzone_flags);
+		uma_zone_set_max(pcbinfo->ipi_zone, maxsockets);
+	}
+
+	in_pcbidx_init(pcbinfo, name, pcb_size);
+	in_pcbinfo_vrf_init(pcbinfo);
 }
 
 /*
@@ -199,35 +390,61 @@ ofp_in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
 void
 ofp_in_pcbinfo_destroy(struct inpcbinfo *pcbinfo)
 {
+	struct inpcbinfo *hashinfo;
+	int vrf;
+
 	KASSERT(pcbinfo->ipi_count == 0,
 		("%s: ipi_count = %u", __func__, pcbinfo->ipi_count));
 
-	ofp_hashdestroy(pcbinfo->ipi_hashbase, 0, pcbinfo->ipi_hashmask);
+	for (vrf = 1; vrf < pcbinfo->ipi_nvrf; vrf++) {
+		hashinfo = pcbinfo->ipi_vrf[vrf];
+		if (hashinfo == NULL)
+			continue;
+		ofp_hashdestroy(hashinfo->ipi_hashbase, 0,
+				hashinfo->ipi_hashmaxmask);
+		ofp_hashdestroy(hashinfo->ipi_porthashbase, 0,
+				hashinfo->ipi_porthashmask);
+		free(hashinfo);
+	}
+	free(pcbinfo->ipi_vrf);
+	pcbinfo->ipi_vrf = NULL;
+	pcbinfo->ipi_nvrf = 0;
+
+	ofp_hashdestroy(pcbinfo->ipi_hashbase, 0, pcbinfo->ipi_hashmaxmask);
 	ofp_hashdestroy(pcbinfo->ipi_porthashbase, 0,
 		    pcbinfo->ipi_porthashmask);
+	if (pcbinfo->ipi_idx &&
+	    ofp_shared_memory_free(pcbinfo->ipi_idx_name) == -1)
+		OFP_ERR("ofp_shared_memory_free failed");
+	pcbinfo->ipi_idx = NULL;
 	/* INP_HASH_LOCK_DESTROY(pcbinfo);
 	   INP_INFO_LOCK_DESTROY(pcbinfo);*/
 }
 
 void
 ofp_in_pcbinfo_hashstats(struct inpcbinfo *pcbinfo, unsigned int *min,
-		     unsigned int *avg, unsigned int *max)
+		     unsigned int *avg, unsigned int *max, unsigned int *hist,
+		     int nhist)
 {
-	unsigned int bucket;
+	uint64_t bucket, nbuckets;
 	unsigned int bucket_count;
 	unsigned int occupied;
 	unsigned int lmin, lsum, lmax;
 	struct inpcb *inp;
 	struct inpcbhead *head;
 
+	if (hist)
+		memset(hist, 0, nhist * sizeof(*hist));
+
 	INP_HASH_WLOCK(pcbinfo);
 
 	lmin = (unsigned int)-1;
 	lsum = 0;
 	lmax = 0;
 	occupied = 0;
+	nbuckets = pcbinfo->ipi_hashmask + 1 + pcbinfo->ipi_hashsplit;
 
-	for (bucket = 0; bucket <= pcbinfo->ipi_hashmask; bucket++) {
+	for (bucket = 0; bucket < nbuckets; bucket++) {
 
 		bucket_count = 0;
 
@@ -243,15 +460,41 @@ ofp_in_pcbinfo_hashstats(struct inpcbinfo *pcbinfo, unsigned int *min,
 			occupied++;
 		}
 		if (bucket_count > lmax) lmax = bucket_count;
+
+		if (hist)
+			hist[bucket_count < (unsigned int)nhist ?
+			     bucket_count : (unsigned int)nhist - 1]++;
 	}
 
 	*min = lmin;
-	*avg = lsum / occupied;
+	*avg = occupied ? lsum / occupied : 0;
 	*max = lmax;
 
 	INP_HASH_WUNLOCK(pcbinfo);
 }
 
+#define PCBHASH_HIST 8
+
+void
+ofp_in_pcbinfo_hashprint(int fd, const char *name, struct inpcbinfo *pcbinfo)
+{
+	unsigned int min, avg, max, hist[PCBHASH_HIST];
+	int i;
+
+	ofp_in_pcbinfo_hashstats(pcbinfo, &min, &avg, &max, hist,
+				 PCBHASH_HIST);
+
+	ofp_sendf(fd, "%s: %u pcbs, %" PRIu64 "/%" PRIu64 " buckets, "
+		  "chain min %u avg %u max %u\r\n", name, pcbinfo->ipi_count,
+		  pcbinfo->ipi_hashmask + 1 + pcbinfo->ipi_hashsplit,
+		  pcbinfo->ipi_hashmaxmask + 1, min, avg, max);
+	ofp_sendf(fd, "  length:");
+	for (i = 0; i < PCBHASH_HIST; i++)
+		ofp_sendf(fd, " %d%s=%u", i, i == PCBHASH_HIST - 1 ? "+" : "",
+			  hist[i]);
+	ofp_sendf(fd, "\r\n");
+}
+
 /*
  * Allocate a PCB and associate it with the socket.
  * On success return with the PCB locked.
@@ -259,18 +502,24 @@ ofp_in_pcbinfo_hashstats(struct inpcbinfo *pcbinfo, unsigned int *min,
 int
 ofp_in_pcballoc(struct socket *so, struct inpcbinfo *pcbinfo)
 {
+	struct inpcbinfo *hashinfo;
 	struct inpcb *inp;
 	int error;
 
 	INP_INFO_WLOCK_ASSERT(pcbinfo);
-	error = 0;
+	error = in_pcbinfo_vrf_get(pcbinfo, so->so_fibnum, &hashinfo);
+	if (error)
+		return (error);
 	inp = uma_zalloc(pcbinfo->ipi_zone, OFP_M_NOWAIT);
 	if (inp == NULL)
 		return (OFP_ENOBUFS);
 	bzero(inp, inp_zero_size);
+	odp_spinlock_init(&inp->inp_fc_lock);
 	inp->inp_pcbinfo = pcbinfo;
+	inp->inp_hashinfo = hashinfo;
 	inp->inp_socket = so;
 	inp->inp_cred = so->so_cred; // HJo: ref inc removed
+	inp->inp_cpu = odp_cpu_id();
 	inp->inp_inc.inc_fibnum = so->so_fibnum;
 	inp->inp_options = ODP_PACKET_INVALID;
 #ifdef INET6
@@ -299,7 +548,7 @@ ofp_in_pcbbind(struct inpcb *inp, struct ofp_sockaddr *nam, struct ofp_ucred *cr
 	int anonport, error;
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+	INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);
 
 	if (inp->inp_lport != 0 || inp->inp_laddr.s_addr != OFP_INADDR_ANY)
 		return (OFP_EINVAL);
@@ -317,6 +566,8 @@ ofp_in_pcbbind(struct inpcb *inp, struct ofp_sockaddr *nam, struct ofp_ucred *cr
 	}
 	if (anonport)
 		inp->inp_flags |= INP_ANONPORT;
+	if (inp->inp_socket->so_options & OFP_SO_REUSEPORT)
+		inp->inp_flags2 |= INP_REUSEPORT;
 	return (0);
 }
 
@@ -338,6 +589,7 @@ VNET_DEFINE(int, ofp_ipport_reservedlow);
 
 /* Variables dealing with random ephemeral port allocation. */
 VNET_DEFINE(int, ofp_ipport_randomized) = 1;	/* user controlled via sysctl */
+VNET_DEFINE(int, ofp_ipport_percpu) = 1;	/* user controlled via sysctl */
 VNET_DEFINE(int, ofp_ipport_randomcps) = 10;	/* user controlled via sysctl */
 VNET_DEFINE(int, ofp_ipport_randomtime) = 45;	/* user controlled via sysctl */
 VNET_DEFINE(int, ofp_ipport_stoprandom);		/* toggled by ipport_tick */
@@ -397,6 +649,9 @@ SYSCTL_VNET_INT(_net_inet_ip_portrange, OFP_OID_AUTO, reservedlow,
 	OFP_CTLFLAG_RW|OFP_CTLFLAG_SECURE, &VNET_NAME(ofp_ipport_reservedlow), 0, "");
 SYSCTL_VNET_INT(_net_inet_ip_portrange, OFP_OID_AUTO, randomized, OFP_CTLFLAG_RW,
 	&VNET_NAME(ofp_ipport_randomized), 0, "Enable random port allocation");
+SYSCTL_VNET_INT(_net_inet_ip_portrange, OFP_OID_AUTO, percpu, OFP_CTLFLAG_RW,
+	&VNET_NAME(ofp_ipport_percpu), 0,
+	"Allocate ports from a slice of the range of each core first");
 SYSCTL_VNET_INT(_net_inet_ip_portrange, OFP_OID_AUTO, randomcps, OFP_CTLFLAG_RW,
 	&VNET_NAME(ofp_ipport_randomcps), 0, "Maximum number of random port "
 	"allocations before switching to a sequental one");
@@ -406,22 +661,132 @@ SYSCTL_VNET_INT(_net_inet_ip_portrange, OFP_OID_AUTO, randomtime, OFP_CTLFLAG_RW
 	"allocation before switching to a random one");
 
 
+#define LPORT_BIT(port)		(1ULL << ((port) & 63))
+
+static inline void
+in_pcb_lport_set(struct inpcbinfo *pcbinfo, uint16_t lport)
+{
+	uint16_t port = odp_be_to_cpu_16(lport);
+
+	pcbinfo->ipi_portmap[port >> 6] |= LPORT_BIT(port);
+}
+
+static inline void
+in_pcb_lport_clr(struct inpcbinfo *pcbinfo, uint16_t lport)
+{
+	uint16_t port = odp_be_to_cpu_16(lport);
+
+	pcbinfo->ipi_portmap[port >> 6] &= ~LPORT_BIT(port);
+}
+
+/*
+ * Find a port of [first, last] that no inpcb has, from the one after
+ * *lastport on. Returns 0 if there is none.
+ */
+static uint16_t
+in_pcb_lport_free(struct inpcbinfo *pcbinfo, uint16_t first, uint16_t last,
+    uint16_t *lastport)
+{
+	uint32_t n = (uint32_t)last - first + 1;
+	uint32_t port = *lastport + 1;
+	uint32_t scanned, span, bit;
+	uint64_t free;
+
+	if (port < first || port > last)
+		port = first;
+
+	for (scanned = 0; scanned < n; scanned += span) {
+		bit = port & 63;
+		span = 64 - bit;
+		if (span > last - port + 1)
+			span = last - port + 1;
+
+		free = ~pcbinfo->ipi_portmap[port >> 6] >> bit;
+		if (free && (uint32_t)__builtin_ctzll(free) < span) {
+			*lastport = port + __builtin_ctzll(free);
+			return *lastport;
+		}
+
+		port += span;
+		if (port > last)
+			port = first;
+	}
+	return 0;
+}
+
+/*
+ * Pick a port of [first, last]. A port of no inpcb is taken from the
+ * bitmap if there is one. Otherwise the ports are probed one by one:
+ * with faddr, a port is free if the 4-tuple is, without, if there is
+ * no inpcb bound to the port and the local address.
+ */
+static int
+in_pcb_lport_range(struct inpcb *inp, struct ofp_in_addr laddr,
+    uint16_t *lportp, struct ofp_in_addr *faddr, uint16_t fport,
+    uint16_t first, uint16_t last, uint16_t *lastport, int dorandom,
+    struct ofp_ucred *cred, int lookupflags)
+{
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
+	struct inpcb *tmpinp;
+	uint16_t lport;
+	int count;
+
+	(void)cred;
+
+	if (dorandom && first != last)
+		*lastport = first + (random() % (last - first));
+
+	if (in_pcb_lport_free(pcbinfo, first, last, lastport)) {
+		*lportp = odp_cpu_to_be_16(*lastport);
+		return (0);
+	}
+
+	count = last - first;
+
+	do {
+		if (count-- < 0)	/* completely used? */
+			return (OFP_EADDRNOTAVAIL);
+		++*lastport;
+		if (*lastport < first || *lastport > last)
+			*lastport = first;
+		lport = odp_cpu_to_be_16(*lastport);
+
+		if (faddr != NULL)
+			tmpinp = in_pcblookup_hash_locked(pcbinfo, *faddr,
+			    fport, laddr, lport,
+			    lookupflags & ~INPLOOKUP_WILDCARD, NULL);
+#ifdef INET6
+		else if ((inp->inp_vflag & INP_IPV6) != 0)
+			tmpinp = ofp_in6_pcblookup_local(pcbinfo,
+			    &inp->in6p_laddr, lport, lookupflags, cred);
+#endif
+		else
+			tmpinp = ofp_in_pcblookup_local(pcbinfo, laddr,
+			    lport, lookupflags, cred);
+	} while (tmpinp != NULL);
+
+	*lportp = lport;
+	return (0);
+}
+
+/*
+ * Assign a local port. With faddr, the connection to faddr and fport
+ * only needs a unique 4-tuple, and the port may be shared with the
+ * connections to other destinations.
+ */
 int
-ofp_in_pcb_lport(struct inpcb *inp, struct ofp_in_addr *laddrp, uint16_t *lportp,
-	     struct ofp_ucred *cred, int lookupflags)
+ofp_in_pcb_lport_dest(struct inpcb *inp, struct ofp_in_addr *laddrp,
+    uint16_t *lportp, struct ofp_in_addr *faddr, uint16_t fport,
+    struct ofp_ucred *cred, int lookupflags)
 {
 	struct inpcbinfo *pcbinfo;
-	struct inpcb *tmpinp;
 	unsigned short *lastport;
-	int count, dorandom;
+	int dorandom, nslice, slice, error;
 	uint16_t aux, first, last, lport;
+	uint32_t n;
 	struct ofp_in_addr laddr;
 
-	/* make compiler happy */
-	(void)cred;
-	(void)lookupflags;
-
-	pcbinfo = inp->inp_pcbinfo;
+	pcbinfo = inp->inp_hashinfo;
 
 	/*
 	 * Because no actual state changes occur here, a global write lock on
@@ -450,7 +815,7 @@ ofp_in_pcb_lport(struct inpcb *inp, struct ofp_in_addr *laddrp, uint16_t *lportp
 	 * ipport_tick() allows it.
 	 */
 
-	if (ofp_ipport_randomized && pcbinfo == &ofp_udbinfo)
+	if (ofp_ipport_randomized && UDP_PCBINFO(inp->inp_pcbinfo))
 		dorandom = 1;
 	else
 		dorandom = 0;
@@ -479,34 +844,34 @@ ofp_in_pcb_lport(struct inpcb *inp, struct ofp_in_addr *laddrp, uint16_t *lportp
 		KASSERT(laddrp != NULL, ("%s: laddrp NULL for v4 inp %p",
 					 __func__, inp));
 		laddr = *laddrp;
-		(void)laddr; /* Compiler happy */
-	}
+	} else
+		faddr = NULL;	/* XXX IPv4 4-tuples only */
 
-	tmpinp = NULL;	/* Make compiler happy. */
 	lport = *lportp;
+	error = OFP_EADDRNOTAVAIL;
 
-	if (dorandom)
-		*lastport = first + (random() % (last - first));
-
-	count = last - first;
-
-	do {
-		if (count-- < 0)	/* completely used? */
-			return (OFP_EADDRNOTAVAIL);
-		++*lastport;
-		if (*lastport < first || *lastport > last)
-			*lastport = first;
-		lport = odp_cpu_to_be_16(*lastport);
-
-#ifdef INET6
-		if ((inp->inp_vflag & INP_IPV6) != 0)
-			tmpinp = ofp_in6_pcblookup_local(pcbinfo,
-			    &inp->in6p_laddr, lport, lookupflags, cred);
-		else
-#endif
-			tmpinp = ofp_in_pcblookup_local(pcbinfo, laddr,
-			    lport, lookupflags, cred);
-	} while (tmpinp != NULL);
+	/*
+	 * The cores start from their own slices of the default range so
+	 * that they do not contend for the same ports.
+	 */
+	nslice = odp_cpu_count();
+	if (nslice > INP_LPORT_SLICES)
+		nslice = INP_LPORT_SLICES;
+	n = (uint32_t)last - first + 1;
+	if (ofp_ipport_percpu && lastport == &pcbinfo->ipi_lastport &&
+	    nslice > 1 && n >= (uint32_t)nslice * 64) {
+		slice = odp_cpu_id() % nslice;
+		error = in_pcb_lport_range(inp, laddr, &lport, faddr, fport,
+		    first + n * slice / nslice,
+		    first + n * (slice + 1) / nslice - 1,
+		    &pcbinfo->ipi_lastport_cpu[slice], dorandom, cred,
+		    lookupflags);
+	}
+	if (error)
+		error = in_pcb_lport_range(inp, laddr, &lport, faddr, fport,
+		    first, last, lastport, dorandom, cred, lookupflags);
+	if (error)
+		return (error);
 
 	if ((inp->inp_vflag & (INP_IPV4|INP_IPV6)) == INP_IPV4)
 		laddrp->s_addr = laddr.s_addr;
@@ -516,6 +881,14 @@ ofp_in_pcb_lport(struct inpcb *inp, struct ofp_in_addr *laddrp, uint16_t *lportp
 	return (0);
 }
 
+int
+ofp_in_pcb_lport(struct inpcb *inp, struct ofp_in_addr *laddrp, uint16_t *lportp,
+	     struct ofp_ucred *cred, int lookupflags)
+{
+	return (ofp_in_pcb_lport_dest(inp, laddrp, lportp, NULL, 0, cred,
+	    lookupflags));
+}
+
 /*
  * Set up a bind operation on a PCB, performing port allocation
  * as required, but do not actually modify the PCB. Callers can
@@ -532,7 +905,7 @@ ofp_in_pcbbind_setup(struct inpcb *inp, struct ofp_sockaddr *nam,
 {
 	struct socket *so = inp->inp_socket;
 	struct ofp_sockaddr_in *sin;
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 	struct ofp_in_addr laddr;
 	uint16_t lport = 0;
 	int lookupflags = 0, reuseport = (so->so_options & OFP_SO_REUSEPORT);
@@ -676,7 +1049,7 @@ ofp_in_pcbconnect_mbuf(struct inpcb *inp, struct ofp_sockaddr *nam,
 	int anonport, error;
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+	INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);
 
 	lport = inp->inp_lport;
 	laddr = inp->inp_laddr.s_addr;
@@ -723,7 +1096,7 @@ ofp_in_pcbconnect(struct inpcb *inp, struct ofp_sockaddr *nam, struct ofp_ucred
 	int anonport, error;
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+	INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);
 
 	lport = inp->inp_lport;
 	laddr = inp->inp_laddr.s_addr;
@@ -818,7 +1191,7 @@ ofp_in_pcbconnect_setup(struct inpcb *inp, struct ofp_sockaddr *nam,
 	 * lock is sufficient.
 	 */
 	INP_LOCK_ASSERT(inp);
-	INP_HASH_LOCK_ASSERT(inp->inp_pcbinfo);
+	INP_HASH_LOCK_ASSERT(inp->inp_hashinfo);
 
 	if (oinpp != NULL)
 		*oinpp = NULL;
@@ -880,7 +1253,7 @@ ofp_in_pcbconnect_setup(struct inpcb *inp, struct ofp_sockaddr *nam,
 		if (error)
 			return (error);
 	}
-	oinp = in_pcblookup_hash_locked(inp->inp_pcbinfo, faddr, fport,
+	oinp = in_pcblookup_hash_locked(inp->inp_hashinfo, faddr, fport,
 	    laddr, lport, 0, NULL);
 
 	if (oinp != NULL) {
@@ -889,8 +1262,8 @@ ofp_in_pcbconnect_setup(struct inpcb *inp, struct ofp_sockaddr *nam,
 		return (OFP_EADDRINUSE);
 	}
 	if (lport == 0) {
-		error = ofp_in_pcbbind_setup(inp, NULL, &laddr.s_addr, &lport,
-		    cred);
+		error = ofp_in_pcb_lport_dest(inp, &laddr, &lport, &faddr,
+		    fport, cred, INPLOOKUP_WILDCARD);
 		if (error)
 			return (error);
 	}
@@ -907,13 +1280,34 @@ ofp_in_pcbdisconnect(struct inpcb *inp)
 {
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK_ASSERT(inp->inp_pcbinfo);
+	INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);
 
 	inp->inp_faddr.s_addr = OFP_INADDR_ANY;
 	inp->inp_fport = 0;
 	ofp_in_pcbrehash(inp);
 }
 
+/*
+ * Send a locally originated IPv4 packet of inp. The output interface
+ * and the Ethernet header of the destination are kept in inp_fc while
+ * routes and ARP entries do not change. Sender threads sharing the
+ * inpcb for reading do not wait for each other, the one that does not
+ * get inp_fc_lock does the route lookup.
+ */
+enum ofp_return_code
+ofp_in_pcb_ip_output(struct inpcb *inp, odp_packet_t pkt)
+{
+	enum ofp_return_code ret;
+
+	if (odp_unlikely(!odp_spinlock_trylock(&inp->inp_fc_lock)))
+		return ofp_ip_output(pkt, NULL);
+
+	ret = ofp_ip_output_flow(pkt, &inp->inp_fc);
+	odp_spinlock_unlock(&inp->inp_fc_lock);
+
+	return ret;
+}
+
 /*
  * ofp_in_pcbdetach() is responsibe for disassociating a socket from an inpcb.
  * For most protocols, this will be invoked immediately prior to calling
@@ -1051,6 +1445,31 @@ ofp_in_pcbfree(struct inpcb *inp)
 		INP_WUNLOCK(inp);
 }
 
+/*
+ * Remove PCB from the hash lists.
+ */
+static void
+in_pcbremhash(struct inpcb *inp)
+{
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
+	struct inpcbport *phd = inp->inp_phd;
+
+	INP_HASH_WLOCK_ASSERT(pcbinfo);
+
+	in_pcbidx_del(inp);
+	OFP_LIST_REMOVE(inp, inp_hash);
+	OFP_LIST_REMOVE(inp, inp_portlist);
+	if (OFP_LIST_FIRST(&phd->phd_pcblist) == NULL) {
+		in_pcb_lport_clr(pcbinfo, phd->phd_port);
+		OFP_LIST_REMOVE(phd, phd_hash);
+		free(phd);
+	}
+	/* The count of the parent is that of its list */
+	if (pcbinfo != inp->inp_pcbinfo)
+		pcbinfo->ipi_count--;
+	inp->inp_flags &= ~INP_INHASHLIST;
+}
+
 /*
  * ofp_in_pcbdrop() removes an inpcb from hashed lists, releasing its address and
  * port reservation, and preventing it from being returned by inpcb lookups.
@@ -1076,17 +1495,9 @@ ofp_in_pcbdrop(struct inpcb *inp)
 	 */
 	inp->inp_flags |= INP_DROPPED;
 	if (inp->inp_flags & INP_INHASHLIST) {
-		struct inpcbport *phd = inp->inp_phd;
-
-		INP_HASH_WLOCK(inp->inp_pcbinfo);
-		OFP_LIST_REMOVE(inp, inp_hash);
-		OFP_LIST_REMOVE(inp, inp_portlist);
-		if (OFP_LIST_FIRST(&phd->phd_pcblist) == NULL) {
-			OFP_LIST_REMOVE(phd, phd_hash);
-			free(phd);
-		}
-		INP_HASH_WUNLOCK(inp->inp_pcbinfo);
-		inp->inp_flags &= ~INP_INHASHLIST;
+		INP_HASH_WLOCK(inp->inp_hashinfo);
+		in_pcbremhash(inp);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	}
 }
 
@@ -1200,8 +1611,7 @@ ofp_in_pcblookup_local(struct inpcbinfo *pcbinfo, struct ofp_in_addr laddr,
 		 * Look for an unconnected (wildcard foreign addr) PCB that
 		 * matches the local address and port we're looking for.
 		 */
-		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(OFP_INADDR_ANY, lport,
-		    0, pcbinfo->ipi_hashmask)];
+		head = ofp_in_pcbhash_head(pcbinfo, OFP_INADDR_ANY, lport, 0);
 		OFP_LIST_FOREACH(inp, head, inp_hash) {
 #ifdef INET6
 			/* XXX inp locking */
@@ -1287,6 +1697,347 @@ ofp_in_pcblookup_local(struct inpcbinfo *pcbinfo, struct ofp_in_addr laddr,
 	}
 }
 
+/*
+ * Cuckoo index of the inpcbs of both families. An inpcb has a 32 bit
+ * signature of its 4-tuple and family and two candidate buckets, the
+ * second one derived from the first and the signature. A lookup
+ * compares the signatures of the two buckets and reads only the inpcbs
+ * whose signature matches.
+ *
+ * An inpcb that takes IPv4 packets, including an IPv6 socket bound to
+ * :: that also accepts IPv4, is keyed by its IPv4 addresses, other
+ * IPv6 inpcbs by their IPv6 addresses. Addresses are passed by
+ * pointer, 4 bytes for IPv4 and 16 for IPv6.
+ *
+ * The hash lists stay the reference: an inpcb the index cannot hold,
+ * or whose key is already used, is counted in ipi_idx_exact_miss or
+ * ipi_idx_wild_miss, and while any are counted the lookups of that
+ * kind use the hash lists. So the lookup result is the same with and
+ * without the index. Called with the hash lock held.
+ */
+#define INP_IDX_KICKS 64
+
+static void
+in_pcbidx_init(struct inpcbinfo *pcbinfo, const char *name, int nitems)
+{
+	uint32_t num = 16;
+	uint64_t size;
+
+	/* Half full with all inpcbs in use */
+	while (num * INP_IDX_WAYS < 2 * (uint32_t)nitems)
+		num <<= 1;
+	size = num * sizeof(struct inpcb_idx_bucket);
+
+	snprintf(pcbinfo->ipi_idx_name, sizeof(pcbinfo->ipi_idx_name),
+		 "OfpPcbIdx_%s", name);
+	pcbinfo->ipi_idx = ofp_shared_memory_alloc(pcbinfo->ipi_idx_name,
+						   size);
+	if (pcbinfo->ipi_idx == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed, %s uses the hash "
+			"lists only", name);
+		return;
+	}
+	memset(pcbinfo->ipi_idx, 0, size);
+	pcbinfo->ipi_idxmask = num - 1;
+	pcbinfo->ipi_idx_exact_miss = 0;
+	pcbinfo->ipi_idx_wild_miss = 0;
+}
+
+/* Family of the key of an inpcb, 1 for IPv6 */
+#define INP_IDX_V6(inp) \
+	(((inp)->inp_vflag & (INP_IPV4 | INP_IPV6)) == INP_IPV6)
+#define INP_IDX_FADDR(inp, v6) \
+	((v6) ? (const void *)&(inp)->in6p_faddr : \
+	 (const void *)&(inp)->inp_faddr)
+#define INP_IDX_LADDR(inp, v6) \
+	((v6) ? (const void *)&(inp)->in6p_laddr : \
+	 (const void *)&(inp)->inp_laddr)
+
+static const uint32_t in_pcbidx_any[4];
+
+static inline uint32_t
+in_pcbidx_addr(int v6, const void *a)
+{
+	uint32_t w[4];
+
+	if (!v6) {
+		memcpy(w, a, 4);
+		return w[0];
+	}
+	memcpy(w, a, 16);
+	return w[0] * 0x85ebca6b ^ w[1] * 0xc2b2ae35 ^ w[2] * 0x27d4eb2f ^
+		w[3];
+}
+
+static inline int
+in_pcbidx_addr_eq(int v6, const void *a, const void *b)
+{
+	return v6 ? !memcmp(a, b, 16) : !memcmp(a, b, 4);
+}
+
+static inline uint32_t
+in_pcbidx_sig(int v6, const void *faddr, const void *laddr,
+	      uint16_t fport, uint16_t lport)
+{
+	uint32_t h;
+
+	h = in_pcbidx_addr(v6, faddr) * 0x9e3779b1 ^ in_pcbidx_addr(v6, laddr);
+	h ^= ((uint32_t)lport << 16 | fport) * 0x85ebca6b;
+	/* Keeps the keys of the two families apart */
+	h ^= v6 ? 0x165667b1 : 0;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	/* 0 marks an empty slot */
+	return h ? h : 1;
+}
+
+/* The other bucket of a signature, from either one */
+static inline uint32_t
+in_pcbidx_alt(uint32_t bucket, uint32_t sig, uint32_t mask)
+{
+	return (bucket ^ ((sig >> 16 | 1) * 0x5bd1e995)) & mask;
+}
+
+static inline uint32_t
+in_pcbidx_match(const struct inpcb_idx_bucket *b, uint32_t sig)
+{
+#if defined(__SSE2__)
+	__m128i s = _mm_load_si128((const __m128i *)b->sig);
+	__m128i eq = _mm_cmpeq_epi32(s, _mm_set1_epi32(sig));
+
+	return _mm_movemask_ps(_mm_castsi128_ps(eq));
+#else
+	uint32_t i, mask = 0;
+
+	for (i = 0; i < INP_IDX_WAYS; i++)
+		mask |= (uint32_t)(b->sig[i] == sig) << i;
+	return mask;
+#endif
+}
+
+static struct inpcb *
+in_pcbidx_lookup(struct inpcbinfo *pcbinfo, int v6, const void *faddr,
+		 uint16_t fport, const void *laddr, uint16_t lport)
+{
+	uint32_t sig = in_pcbidx_sig(v6, faddr, laddr, fport, lport);
+	uint32_t bucket = sig & pcbinfo->ipi_idxmask;
+	struct inpcb_idx_bucket *b;
+	struct inpcb *inp;
+	uint32_t match;
+	int i, n;
+
+	for (n = 0; n < 2; n++) {
+		b = &pcbinfo->ipi_idx[bucket];
+		match = in_pcbidx_match(b, sig);
+		while (match) {
+			i = __builtin_ctz(match);
+			match &= match - 1;
+			inp = b->inp[i];
+			if (inp->inp_fport == fport &&
+			    inp->inp_lport == lport &&
+			    INP_IDX_V6(inp) == v6 &&
+			    in_pcbidx_addr_eq(v6, INP_IDX_FADDR(inp, v6), faddr) &&
+			    in_pcbidx_addr_eq(v6, INP_IDX_LADDR(inp, v6), laddr))
+				return inp;
+		}
+		bucket = in_pcbidx_alt(bucket, sig, pcbinfo->ipi_idxmask);
+	}
+
+	return NULL;
+}
+
+static inline void
+in_pcbidx_set(struct inpcbinfo *pcbinfo, uint32_t bucket, int i,
+	      uint32_t sig, struct inpcb *inp)
+{
+	pcbinfo->ipi_idx[bucket].sig[i] = sig;
+	pcbinfo->ipi_idx[bucket].inp[i] = inp;
+	inp->inp_idx_slot = bucket * INP_IDX_WAYS + i + 1;
+}
+
+static int
+in_pcbidx_free_way(struct inpcbinfo *pcbinfo, uint32_t bucket)
+{
+	int i;
+
+	for (i = 0; i < INP_IDX_WAYS; i++)
+		if (pcbinfo->ipi_idx[bucket].inp[i] == NULL)
+			return i;
+	return -1;
+}
+
+static void
+in_pcbidx_miss(struct inpcb *inp)
+{
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
+	int v6 = INP_IDX_V6(inp);
+
+	inp->inp_idx_slot = 0;
+	if (in_pcbidx_addr_eq(v6, INP_IDX_FADDR(inp, v6), in_pcbidx_any)) {
+		inp->inp_idx_miss = 2;
+		pcbinfo->ipi_idx_wild_miss++;
+	} else {
+		inp->inp_idx_miss = 1;
+		pcbinfo->ipi_idx_exact_miss++;
+	}
+}
+
+static void
+in_pcbidx_add(struct inpcb *inp)
+{
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
+	uint32_t mask = pcbinfo->ipi_idxmask;
+	uint32_t sig, bucket, evict_sig;
+	struct inpcb *evict;
+	int i, kick, v6;
+
+	if (pcbinfo->ipi_idx == NULL)
+		return;
+
+	v6 = INP_IDX_V6(inp);
+	if (in_pcbidx_lookup(pcbinfo, v6, INP_IDX_FADDR(inp, v6),
+			     inp->inp_fport, INP_IDX_LADDR(inp, v6),
+			     inp->inp_lport)) {
+		in_pcbidx_miss(inp);
+		return;
+	}
+
+	sig = in_pcbidx_sig(v6, INP_IDX_FADDR(inp, v6), INP_IDX_LADDR(inp, v6),
+			    inp->inp_fport, inp->inp_lport);
+	bucket = sig & mask;
+	if ((i = in_pcbidx_free_way(pcbinfo, bucket)) < 0) {
+		bucket = in_pcbidx_alt(bucket, sig, mask);
+		i = in_pcbidx_free_way(pcbinfo, bucket);
+	}
+
+	/* Both full: move residents to their other bucket */
+	for (kick = 0; i < 0 && kick < INP_IDX_KICKS; kick++) {
+		i = (sig + kick) % INP_IDX_WAYS;
+		evict = pcbinfo->ipi_idx[bucket].inp[i];
+		evict_sig = pcbinfo->ipi_idx[bucket].sig[i];
+		in_pcbidx_set(pcbinfo, bucket, i, sig, inp);
+
+		inp = evict;
+		sig = evict_sig;
+		bucket = in_pcbidx_alt(bucket, sig, mask);
+		i = in_pcbidx_free_way(pcbinfo, bucket);
+	}
+
+	if (i < 0) {
+		/* The inpcb left without a slot may be another one */
+		in_pcbidx_miss(inp);
+		return;
+	}
+	in_pcbidx_set(pcbinfo, bucket, i, sig, inp);
+}
+
+static void
+in_pcbidx_del(struct inpcb *inp)
+{
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
+	uint32_t slot = inp->inp_idx_slot;
+
+	if (slot) {
+		slot--;
+		pcbinfo->ipi_idx[slot / INP_IDX_WAYS].sig[slot % INP_IDX_WAYS] = 0;
+		pcbinfo->ipi_idx[slot / INP_IDX_WAYS].inp[slot % INP_IDX_WAYS] =
+			NULL;
+		inp->inp_idx_slot = 0;
+	} else if (inp->inp_idx_miss == 1) {
+		pcbinfo->ipi_idx_exact_miss--;
+	} else if (inp->inp_idx_miss == 2) {
+		pcbinfo->ipi_idx_wild_miss--;
+	}
+	inp->inp_idx_miss = 0;
+}
+
+/*
+ * Prefetch of a burst, without the hash lock: the first pass prefetches
+ * the buckets of each 4-tuple and keeps its signature, the second one
+ * takes the inpcb of the first matching signature to prefetch it. Only
+ * a hint, the lookup under the lock decides.
+ */
+uint32_t
+ofp_in_pcbidx_prefetch(struct inpcbinfo *pcbinfo, int v6, const void *faddr,
+		       uint16_t fport, const void *laddr, uint16_t lport)
+{
+	uint32_t sig, bucket;
+
+	if (odp_unlikely(pcbinfo->ipi_idx == NULL))
+		return (0);
+
+	sig = in_pcbidx_sig(v6, faddr, laddr, fport, lport);
+	bucket = sig & pcbinfo->ipi_idxmask;
+	odp_prefetch(&pcbinfo->ipi_idx[bucket]);
+	odp_prefetch(&pcbinfo->ipi_idx[in_pcbidx_alt(bucket, sig,
+						     pcbinfo->ipi_idxmask)]);
+	return (sig);
+}
+
+struct inpcb *
+ofp_in_pcbidx_peek(struct inpcbinfo *pcbinfo, uint32_t sig)
+{
+	uint32_t bucket, match;
+	struct inpcb_idx_bucket *b;
+	int n;
+
+	if (!sig)
+		return (NULL);
+
+	bucket = sig & pcbinfo->ipi_idxmask;
+	for (n = 0; n < 2; n++) {
+		b = &pcbinfo->ipi_idx[bucket];
+		match = in_pcbidx_match(b, sig);
+		if (match)
+			return (__atomic_load_n(&b->inp[__builtin_ctz(match)],
+						__ATOMIC_RELAXED));
+		bucket = in_pcbidx_alt(bucket, sig, pcbinfo->ipi_idxmask);
+	}
+	return (NULL);
+}
+
+/*
+ * Demux by the index, for the lookups of both families. Returns 1 if
+ * the index decides, with the inpcb or NULL in *inpp, and 0 if the hash
+ * lists must be searched.
+ */
+int
+ofp_in_pcbidx_demux(struct inpcbinfo *pcbinfo, int v6, const void *faddr,
+		    uint16_t fport, const void *laddr, uint16_t lport,
+		    int lookupflags, struct inpcb **inpp)
+{
+	struct inpcb *inp;
+
+	INP_HASH_LOCK_ASSERT(pcbinfo);
+
+	if (odp_unlikely(pcbinfo->ipi_idx == NULL) ||
+	    pcbinfo->ipi_idx_exact_miss)
+		return (0);
+
+	inp = in_pcbidx_lookup(pcbinfo, v6, faddr, fport, laddr, lport);
+	if (inp == NULL && (lookupflags & INPLOOKUP_WILDCARD)) {
+		if (pcbinfo->ipi_idx_wild_miss)
+			return (0);
+		/* A local address match before a wildcard one */
+		inp = in_pcbidx_lookup(pcbinfo, v6, in_pcbidx_any, 0, laddr,
+				       lport);
+		if (inp == NULL && !in_pcbidx_addr_eq(v6, laddr, in_pcbidx_any))
+			inp = in_pcbidx_lookup(pcbinfo, v6, in_pcbidx_any, 0,
+					       in_pcbidx_any, lport);
+		/* An IPv6 socket bound to :: taking IPv4 has an IPv4 key */
+		if (inp == NULL && v6) {
+			inp = in_pcbidx_lookup(pcbinfo, 0, in_pcbidx_any, 0,
+					       in_pcbidx_any, lport);
+			if (inp && (inp->inp_vflag & INP_IPV6) == 0)
+				inp = NULL;
+		}
+	}
+	*inpp = inp;
+	return (1);
+}
+
 /*
  * Insert PCB onto various hash lists.
  */
@@ -1295,9 +2046,8 @@ in_pcbinshash_internal(struct inpcb *inp, int do_pcbgroup_update)
 {
 	struct inpcbhead *pcbhash;
 	struct inpcbporthead *pcbporthash;
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 	struct inpcbport *phd;
-	uint32_t hashkey_faddr;
 	uint32_t hashkey;
 
 	(void)do_pcbgroup_update;
@@ -1308,17 +2058,8 @@ in_pcbinshash_internal(struct inpcb *inp, int do_pcbgroup_update)
 	KASSERT((inp->inp_flags & INP_INHASHLIST) == 0,
 	    ("ofp_in_pcbinshash: INP_INHASHLIST"));
 
-#ifdef INET6
-	if (inp->inp_vflag & INP_IPV6)
-		hashkey_faddr = inp->in6p_faddr.ofp_s6_addr32[3] /* XXX */;
-	else
-#endif /* INET6 */
-	hashkey_faddr = inp->inp_faddr.s_addr;
-
-	hashkey = INP_PCBHASH(hashkey_faddr,
-		 inp->inp_lport, inp->inp_fport, pcbinfo->ipi_hashmask);
-
-	pcbhash = &pcbinfo->ipi_hashbase[hashkey];
+	pcbhash = ofp_in_pcbhash_head(pcbinfo, in_pcbhash_faddr(inp),
+		 inp->inp_lport, inp->inp_fport);
 
 	hashkey = INP_PCBPORTHASH(inp->inp_lport, pcbinfo->ipi_porthashmask);
 
@@ -1341,11 +2082,16 @@ in_pcbinshash_internal(struct inpcb *inp, int do_pcbgroup_update)
 		phd->phd_port = inp->inp_lport;
 		OFP_LIST_INIT(&phd->phd_pcblist);
 		OFP_LIST_INSERT_HEAD(pcbporthash, phd, phd_hash);
+		in_pcb_lport_set(pcbinfo, inp->inp_lport);
 	}
 	inp->inp_phd = phd;
 	OFP_LIST_INSERT_HEAD(&phd->phd_pcblist, inp, inp_portlist);
 	OFP_LIST_INSERT_HEAD(pcbhash, inp, inp_hash);
 	inp->inp_flags |= INP_INHASHLIST;
+	if (pcbinfo != inp->inp_pcbinfo)
+		pcbinfo->ipi_count++;
+	in_pcbidx_add(inp);
+	in_pcbhash_grow(pcbinfo);
 
 	return (0);
 }
@@ -1397,11 +2143,14 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 
 	INP_HASH_LOCK_ASSERT(pcbinfo);
 
+	if (ofp_in_pcbidx_demux(pcbinfo, 0, &faddr, fport, &laddr, lport,
+				lookupflags, &inp))
+		return (inp);
+
 	/*
 	 * First look for an exact match.
 	 */
-	head = &pcbinfo->ipi_hashbase[INP_PCBHASH(faddr.s_addr, lport, fport,
-	    pcbinfo->ipi_hashmask)];
+	head = ofp_in_pcbhash_head(pcbinfo, faddr.s_addr, lport, fport);
 	OFP_LIST_FOREACH(inp, head, inp_hash) {
 #ifdef INET6
 		/* XXX inp locking */
@@ -1440,8 +2189,7 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 		 *      4. non-jailed, wild.
 		 */
 
-		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(OFP_INADDR_ANY, lport,
-		    0, pcbinfo->ipi_hashmask)];
+		head = ofp_in_pcbhash_head(pcbinfo, OFP_INADDR_ANY, lport, 0);
 		OFP_LIST_FOREACH(inp, head, inp_hash) {
 #ifdef _INET6
 			/* XXX inp locking */
@@ -1467,14 +2215,16 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 					continue;
 #endif
 			} else {
-				if (local_exact != NULL)
+				if (local_exact != NULL &&
+				    ofp_in_pcb_reuseport_local(local_exact))
 					continue;
 			}
 
 			if (inp->inp_laddr.s_addr == laddr.s_addr) {
 				if (injail)
 					return (inp);
-				else
+				else if (local_exact == NULL ||
+					 ofp_in_pcb_reuseport_local(inp))
 					local_exact = inp;
 			} else if (inp->inp_laddr.s_addr == OFP_INADDR_ANY) {
 #ifdef _INET6
@@ -1485,7 +2235,8 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 #endif /* INET6 */
 					if (injail)
 						jail_wild = inp;
-					else
+					else if (local_wild == NULL ||
+						 ofp_in_pcb_reuseport_local(inp))
 						local_wild = inp;
 			}
 		} /* OFP_LIST_FOREACH */
@@ -1557,6 +2308,10 @@ ofp_in_pcblookup(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 	KASSERT((lookupflags & (INPLOOKUP_RLOCKPCB | INPLOOKUP_WLOCKPCB)) != 0,
 	    ("%s: LOCKPCB not set", __func__));
 
+	pcbinfo = ofp_in_pcbinfo_vrf(pcbinfo, ifp ? ifp->vrf : 0);
+	if (pcbinfo == NULL)
+		return (NULL);
+
 	return (in_pcblookup_hash(pcbinfo, faddr, fport, laddr, lport,
 				  lookupflags, ifp));
 }
@@ -1572,6 +2327,10 @@ ofp_in_pcblookup_mbuf(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 	KASSERT((lookupflags & (INPLOOKUP_RLOCKPCB | INPLOOKUP_WLOCKPCB)) != 0,
 	    ("%s: LOCKPCB not set", __func__));
 
+	pcbinfo = ofp_in_pcbinfo_vrf(pcbinfo, ifp ? ifp->vrf : 0);
+	if (pcbinfo == NULL)
+		return (NULL);
+
 	return (in_pcblookup_hash(pcbinfo, faddr, fport, laddr, lport,
 				  lookupflags, ifp));
 }
@@ -1585,10 +2344,8 @@ ofp_in_pcblookup_mbuf(struct inpcbinfo *pcbinfo, struct ofp_in_addr faddr,
 void
 ofp_in_pcbrehash_mbuf(struct inpcb *inp, odp_packet_t m)
 {
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 	struct inpcbhead *head;
-	uint32_t hashkey_faddr;
-	uint32_t hashkey;
 	(void)m;
 
 	INP_WLOCK_ASSERT(inp);
@@ -1597,20 +2354,13 @@ ofp_in_pcbrehash_mbuf(struct inpcb *inp, odp_packet_t m)
 	KASSERT(inp->inp_flags & INP_INHASHLIST,
 	    ("ofp_in_pcbrehash: !INP_INHASHLIST"));
 
-#ifdef INET6
-	if (inp->inp_vflag & INP_IPV6)
-		hashkey_faddr = inp->in6p_faddr.ofp_s6_addr32[3] /* XXX */;
-	else
-#endif /* INET6 */
-	hashkey_faddr = inp->inp_faddr.s_addr;
-
-	hashkey = INP_PCBHASH(hashkey_faddr,
-			      inp->inp_lport, inp->inp_fport, pcbinfo->ipi_hashmask);
-
-	head = &pcbinfo->ipi_hashbase[hashkey];
+	head = ofp_in_pcbhash_head(pcbinfo, in_pcbhash_faddr(inp),
+				   inp->inp_lport, inp->inp_fport);
 
 	OFP_LIST_REMOVE(inp, inp_hash);
 	OFP_LIST_INSERT_HEAD(head, inp, inp_hash);
+	in_pcbidx_del(inp);
+	in_pcbidx_add(inp);
 
 }
 
@@ -1623,10 +2373,8 @@ ofp_in_pcbrehash_mbuf(struct inpcb *inp, odp_packet_t m)
 void
 ofp_in_pcbrehash(struct inpcb *inp)
 {
-	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbinfo *pcbinfo = inp->inp_hashinfo;
 	struct inpcbhead *head;
-	uint32_t hashkey_faddr;
-	uint32_t hashkey;
 
 	INP_WLOCK_ASSERT(inp);
 	INP_HASH_WLOCK_ASSERT(pcbinfo);
@@ -1634,20 +2382,13 @@ ofp_in_pcbrehash(struct inpcb *inp)
 	KASSERT(inp->inp_flags & INP_INHASHLIST,
 		("ofp_in_pcbrehash: !INP_INHASHLIST"));
 
-#ifdef INET6
-	if (inp->inp_vflag & INP_IPV6)
-		hashkey_faddr = inp->in6p_faddr.ofp_s6_addr32[3] /* XXX */;
-	else
-#endif /* INET6 */
-	hashkey_faddr = inp->inp_faddr.s_addr;
-
-	hashkey = INP_PCBHASH(hashkey_faddr,
-			      inp->inp_lport, inp->inp_fport, pcbinfo->ipi_hashmask);
-
-	head = &pcbinfo->ipi_hashbase[hashkey];
+	head = ofp_in_pcbhash_head(pcbinfo, in_pcbhash_faddr(inp),
+				   inp->inp_lport, inp->inp_fport);
 
 	OFP_LIST_REMOVE(inp, inp_hash);
 	OFP_LIST_INSERT_HEAD(head, inp, inp_hash);
+	in_pcbidx_del(inp);
+	in_pcbidx_add(inp);
 }
 
 /*
@@ -1663,17 +2404,9 @@ in_pcbremlists(struct inpcb *inp)
 
 	inp->inp_gencnt = ++pcbinfo->ipi_gencnt;
 	if (inp->inp_flags & INP_INHASHLIST) {
-		struct inpcbport *phd = inp->inp_phd;
-
-		INP_HASH_WLOCK(pcbinfo);
-		OFP_LIST_REMOVE(inp, inp_hash);
-		OFP_LIST_REMOVE(inp, inp_portlist);
-		if (OFP_LIST_FIRST(&phd->phd_pcblist) == NULL) {
-			OFP_LIST_REMOVE(phd, phd_hash);
-			free(phd);
-		}
-		INP_HASH_WUNLOCK(pcbinfo);
-		inp->inp_flags &= ~INP_INHASHLIST;
+		INP_HASH_WLOCK(inp->inp_hashinfo);
+		in_pcbremhash(inp);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	}
 	OFP_LIST_REMOVE(inp, inp_list);
 	pcbinfo->ipi_count--;
@@ -131,6 +131,7 @@ struct protosw ofp_inetsw[] = {
 		.pr_usrreqs =		&rip_usrreqs
 	},
 #endif
+#ifdef OFP_GRE
 	{
 		.pr_type =		OFP_SOCK_RAW,
 		.pr_domain =		&ofp_inetdomain,
@@ -143,6 +144,7 @@ struct protosw ofp_inetsw[] = {
 		.pr_ctloutput =		NULL/*rip_ctloutput*/,
 		.pr_usrreqs =		&nousrreqs
 	},
+#endif /* OFP_GRE */
 	{
 		.pr_type =		OFP_SOCK_RAW,
 		.pr_domain =		&ofp_inetdomain,
@@ -155,19 +157,22 @@ struct protosw ofp_inetsw[] = {
 		.pr_ctloutput =		NULL/*rip_ctloutput*/,
 		.pr_usrreqs =		&nousrreqs
 	},
+#ifdef OFP_IGMP
 	{
 		.pr_type =		OFP_SOCK_RAW,
 		.pr_domain =		&ofp_inetdomain,
 		.pr_protocol =		OFP_IPPROTO_IGMP,
 		.pr_flags =		PR_ATOMIC|PR_ADDR|PR_LASTHDR,
 		.pr_input =		ofp_igmp_input,
-		.pr_init =		ofp_igmp_init,
+		/* Initialized as a module, see ofp_module.c */
+		.pr_init =		NULL,
 		.pr_destroy =		NULL,
 		.pr_ctloutput =		NULL /*rip_ctloutput*/,
 		.pr_fasttimo =		NULL /*igmp_fasttimo*/,
 		.pr_slowtimo =		NULL /*ofp_igmp_slowtimo*/,
 		.pr_usrreqs =		&nousrreqs /*rip_usrreqs*/
 	},
+#endif /* OFP_IGMP */
 	{
 		.pr_type =		OFP_SOCK_RAW,
 		.pr_domain =		&ofp_inetdomain,
@@ -22,13 +22,28 @@
 #include "ofpi.h"
 #include "ofpi_sysctl.h"
 #include "ofpi_util.h"
+#include "ofpi_lockstat.h"
 #include "ofpi_stat.h"
+#include "ofpi_telemetry.h"
+#include "ofpi_mem_pressure.h"
 #include "ofpi_netlink.h"
 #include "ofpi_portconf.h"
 #include "ofpi_route.h"
 #include "ofpi_rt_lookup.h"
+#include "ofpi_rcu.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_conntrack.h"
+#include "ofpi_acl.h"
+#include "ofpi_sflow.h"
+#include "ofpi_ipc.h"
+#include "ofpi_steer.h"
+#include "ofpi_tm.h"
+#include "ofpi_lag.h"
+#include "ofpi_gro.h"
+#include "ofpi_coroutine.h"
 #include "ofpi_arp.h"
 #include "ofpi_avl.h"
+#include "ofpi_btree.h"
 #include "ofpi_pkt_processing.h"
 #include "ofpi_ifnet.h"
 #include "ofpi_ip.h"
@@ -38,8 +53,9 @@
 #include "ofpi_reass.h"
 #include "ofpi_inet.h"
 #include "ofpi_igmp_var.h"
-#include "ofpi_vxlan.h"
+#include "ofpi_module.h"
 #include "ofpi_uma.h"
+#include "ofpi_hash.h"
 #include "ofpi_ipsec.h"
 
 #include "ofpi_log.h"
@@ -149,6 +165,12 @@ struct lookup_entry lt_sched_group[] = {
 	ENTRY(ODP_SCHED_GROUP_CONTROL),
 };
 
+struct lookup_entry lt_tx_queue_map[] = {
+	ENTRY(OFP_TX_QUEUE_MAP_CPU),
+	ENTRY(OFP_TX_QUEUE_MAP_THREAD),
+	ENTRY(OFP_TX_QUEUE_MAP_FLOW),
+};
+
 struct lookup_entry lt_ipsec_op_mode[] = {
 	ENTRY(ODP_IPSEC_OP_MODE_SYNC),
 	ENTRY(ODP_IPSEC_OP_MODE_ASYNC),
@@ -156,6 +178,13 @@ struct lookup_entry lt_ipsec_op_mode[] = {
 	ENTRY(ODP_IPSEC_OP_MODE_DISABLED),
 };
 
+struct lookup_entry lt_module[] = {
+	ENTRY(OFP_MODULE_IGMP),
+	ENTRY(OFP_MODULE_IPSEC),
+	ENTRY(OFP_MODULE_VXLAN),
+	ENTRY(OFP_MODULE_GRE),
+};
+
 /*
  * Based on a string, lookup a value in a struct lookup_entry
  * array. Return the value from the entry or -1 if not found.
@@ -179,6 +208,24 @@ static int lookup(const struct lookup_entry *table, int n, const char *str)
 	return -1;
 }
 
+static void hash_proto_set(odp_pktin_hash_proto_t *hash, const char *str)
+{
+	if (!strcmp(str, "ipv4"))
+		hash->proto.ipv4 = 1;
+	else if (!strcmp(str, "ipv4_udp"))
+		hash->proto.ipv4_udp = 1;
+	else if (!strcmp(str, "ipv4_tcp"))
+		hash->proto.ipv4_tcp = 1;
+	else if (!strcmp(str, "ipv6"))
+		hash->proto.ipv6 = 1;
+	else if (!strcmp(str, "ipv6_udp"))
+		hash->proto.ipv6_udp = 1;
+	else if (!strcmp(str, "ipv6_tcp"))
+		hash->proto.ipv6_tcp = 1;
+	else
+		OFP_ERR("Unknown hash protocol: %s", str);
+}
+
 static void read_conf_file(ofp_global_param_t *params, const char *filename)
 {
 	config_t conf;
@@ -217,6 +264,34 @@ static void read_conf_file(ofp_global_param_t *params, const char *filename)
 		}
 	}
 
+	setting = config_lookup(&conf, "ofp_global_param.if_queues.hash");
+	if (setting && (length = config_setting_length(setting)) > 0) {
+		params->if_queues.hash_proto.all_bits = 0;
+		for (i = 0; i < length; i++) {
+			str = config_setting_get_string_elem(setting, i);
+			if (str)
+				hash_proto_set(&params->if_queues.hash_proto,
+					       str);
+		}
+	}
+
+	setting = config_lookup(&conf, "ofp_global_param.modules_disabled");
+	if (setting && (length = config_setting_length(setting)) > 0) {
+		params->modules_disabled = 0;
+		for (i = 0; i < length; i++) {
+			int m = -1;
+
+			str = config_setting_get_string_elem(setting, i);
+			if (str)
+				m = lookup(lt_module, sizeof(lt_module) /
+					   sizeof(lt_module[0]), str);
+			if (m > 0)
+				params->modules_disabled |= m;
+			else
+				OFP_ERR("Unknown module: %s", str ? str : "");
+		}
+	}
+
 #define GET_CONF_STR(lt, p)							\
 	if (config_lookup_string(&conf, "ofp_global_param." STR(p), &str)) { \
 		i = lookup(lt_ ## lt, sizeof(lt_ ## lt) / sizeof(lt_ ## lt[0]), str); \
@@ -227,26 +302,112 @@ static void read_conf_file(ofp_global_param_t *params, const char *filename)
 	GET_CONF_STR(pktout_mode, pktout_mode);
 	GET_CONF_STR(sched_sync, sched_sync);
 	GET_CONF_STR(sched_group, sched_group);
+	GET_CONF_STR(tx_queue_map, pkt_tx_queue_map);
 
 #define GET_CONF_INT(type, p)						\
 	if (config_lookup_ ## type(&conf, "ofp_global_param." STR(p), &i)) \
 		params->p = i;
 
 	GET_CONF_INT(int, linux_core_id);
+	GET_CONF_INT(int, if_queues.rx);
+	GET_CONF_INT(int, if_queues.tx);
+	GET_CONF_INT(int, flow_queues);
+	GET_CONF_INT(int, flow_rebalance.threshold);
+	GET_CONF_INT(int, flow_rebalance.persist);
+	GET_CONF_INT(int, flow_rebalance.interval_ms);
+	GET_CONF_INT(bool, steering);
 	GET_CONF_INT(bool, enable_nl_thread);
 	GET_CONF_INT(int, arp.entries);
 	GET_CONF_INT(int, arp.hash_bits);
 	GET_CONF_INT(int, arp.entry_timeout);
 	GET_CONF_INT(int, arp.saved_pkt_timeout);
 	GET_CONF_INT(bool, arp.check_interface);
+	GET_CONF_INT(bool, arp.control_aging);
+	GET_CONF_INT(int, nd6.entries);
+	GET_CONF_INT(int, nd6.hash_bits);
+	GET_CONF_INT(int, nd6.reachable_time);
+	GET_CONF_INT(int, nd6.entry_timeout);
 	GET_CONF_INT(int, evt_rx_burst_size);
 	GET_CONF_INT(int, pkt_tx_burst_size);
+	GET_CONF_INT(bool, pkt_tx_burst_adaptive);
+	GET_CONF_INT(int, pkt_tx_hold_ns);
+	GET_CONF_INT(int, pkt_tx_pace_max);
+	GET_CONF_INT(int, pkt_tx_retry_max);
+	GET_CONF_INT(int, pkt_tx_retry_ns);
+	GET_CONF_INT(bool, pkt_vector_mode);
+	GET_CONF_INT(int, pktin_vector.size);
+	GET_CONF_INT(int, pktin_vector.tmo_ns);
+	GET_CONF_INT(int, pktin_vector.num);
+	GET_CONF_INT(int, flow_cache_size);
+	GET_CONF_INT(int, conntrack.entries);
+	GET_CONF_INT(int, conntrack.tcp_timeout);
+	GET_CONF_INT(int, conntrack.udp_timeout);
+	GET_CONF_INT(int, conntrack.timeout);
+	GET_CONF_INT(int, tcp_gro_flows);
+	GET_CONF_INT(int, rx_timestamp);
 	GET_CONF_INT(int, pcb_tcp_max);
+	GET_CONF_INT(int, socket_max);
+	GET_CONF_INT(int, sock_event_num);
+	GET_CONF_INT(int, tcp_syncache_max);
+	GET_CONF_INT(int, tcp_tw_max);
+	GET_CONF_INT(bool, sleep_park);
+	GET_CONF_INT(bool, share_nothing);
+	GET_CONF_INT(bool, tcp_timer_affinity);
+	GET_CONF_INT(int, timer_budget);
+	GET_CONF_INT(int, uma_cache_size);
 	GET_CONF_INT(int, pkt_pool.nb_pkts);
 	GET_CONF_INT(int, pkt_pool.buffer_size);
+	GET_CONF_INT(int, pkt_pool.seg_len);
+	GET_CONF_INT(bool, pkt_pool.per_interface);
+	GET_CONF_INT(int, pkt_pool.small_nb_pkts);
+	GET_CONF_INT(int, pkt_pool.small_size);
+	GET_CONF_INT(int, sockbuf.small_rings);
+	GET_CONF_INT(int, sockbuf.rings);
+	GET_CONF_INT(int, sockbuf.ring_len);
+	GET_CONF_INT(int, sockbuf.auto_mem_kb);
+	GET_CONF_INT(int, if_max);
+	GET_CONF_INT(int, cpu_max);
 	GET_CONF_INT(int, num_vlan);
+	GET_CONF_INT(bool, vlan_table);
+	GET_CONF_INT(int, num_ifaddr);
+	GET_CONF_INT(bool, use_btree);
 	GET_CONF_INT(int, mtrie.routes);
 	GET_CONF_INT(int, mtrie.table8_nodes);
+	GET_CONF_INT(int, mtrie.table8_grow);
+	GET_CONF_INT(int, mtrie.first_level);
+	GET_CONF_INT(int, mtrie.vrf_tables);
+	GET_CONF_INT(int, mtrie.vrf_routes);
+	GET_CONF_INT(int, mtrie.vrf_table8_nodes);
+	GET_CONF_INT(int, slow_path.routing_pps);
+	GET_CONF_INT(int, slow_path.arp_pps);
+	GET_CONF_INT(int, slow_path.icmp_pps);
+	GET_CONF_INT(int, slow_path.other_pps);
+	GET_CONF_INT(int, slow_path.burst);
+	GET_CONF_INT(int, icmp_err.pps);
+	GET_CONF_INT(int, icmp_err.prefix_pps);
+	GET_CONF_INT(int, icmp_err.burst);
+	GET_CONF_INT(int, idle.spin);
+	GET_CONF_INT(int, idle.pause);
+	GET_CONF_INT(int, idle.max_sleep_us);
+	GET_CONF_INT(int, tm.rate_kbps);
+	GET_CONF_INT(int, tm.burst);
+	GET_CONF_INT(bool, tm.wfq);
+	GET_CONF_INT(int, acl.rules);
+	GET_CONF_INT(int, acl.entries);
+	GET_CONF_INT(int, sflow.rate);
+	GET_CONF_INT(int, sflow.port);
+	GET_CONF_INT(int, sflow.header_len);
+	GET_CONF_INT(int, trace.entries);
+	GET_CONF_INT(int, trace.stages);
+	GET_CONF_INT(bool, logging.async);
+	GET_CONF_INT(int, logging.rate);
+	GET_CONF_INT(int, ipc.clients);
+	GET_CONF_INT(int, mtrie6.table8_nodes);
+	GET_CONF_INT(int, reass.max_queues);
+	GET_CONF_INT(int, reass.max_frags);
+	GET_CONF_INT(bool, reass.per_thread);
+	GET_CONF_INT(int, vxlan.mac_entries);
+	GET_CONF_INT(int, vxlan.mac_timeout);
 	GET_CONF_INT(int, num_vrf);
 	GET_CONF_INT(bool, chksum_offload.ipv4_rx_ena);
 	GET_CONF_INT(bool, chksum_offload.udp_rx_ena);
@@ -254,11 +415,41 @@ static void read_conf_file(ofp_global_param_t *params, const char *filename)
 	GET_CONF_INT(bool, chksum_offload.ipv4_tx_ena);
 	GET_CONF_INT(bool, chksum_offload.udp_tx_ena);
 	GET_CONF_INT(bool, chksum_offload.tcp_tx_ena);
+	GET_CONF_INT(bool, chksum_offload.tcp_tso_ena);
 	GET_CONF_INT(int, ipsec.max_num_sp);
 	GET_CONF_INT(int, ipsec.max_num_sa);
 	GET_CONF_INT(int, ipsec.max_inbound_spi);
+	GET_CONF_INT(int, ipsec.burst_size);
 	GET_CONF_STR(ipsec_op_mode, ipsec.inbound_op_mode);
 	GET_CONF_STR(ipsec_op_mode, ipsec.outbound_op_mode);
+	GET_CONF_INT(int, telemetry.interval_ms);
+	GET_CONF_INT(int, mem_pressure.low);
+	GET_CONF_INT(int, mem_pressure.high);
+	GET_CONF_INT(int, mem_pressure.interval_ms);
+
+	if (config_lookup_string(&conf, "ofp_global_param.telemetry.name",
+				 &str))
+		/* Never freed, like the interface names. */
+		params->telemetry.name = strdup(str);
+
+	if (config_lookup_string(&conf, "ofp_global_param.warm_restart.file",
+				 &str))
+		params->warm_restart.file = strdup(str);
+
+	if (config_lookup_string(&conf, "ofp_global_param.sflow.collector",
+				 &str))
+		params->sflow.collector = strdup(str);
+
+	if (config_lookup_string(&conf, "ofp_global_param.sflow.agent", &str))
+		params->sflow.agent = strdup(str);
+
+	if (config_lookup_string(&conf, "ofp_global_param.slow_path.pktio",
+				 &str))
+		params->slow_path.pktio = strdup(str);
+
+	if (config_lookup_string(&conf, "ofp_global_param.slow_path.linux_if",
+				 &str))
+		params->slow_path.linux_if = strdup(str);
 
 done:
 	config_destroy(&conf);
@@ -274,6 +465,10 @@ void ofp_init_global_param_from_file(ofp_global_param_t *params, const char *fil
 	params->pktin_mode = ODP_PKTIN_MODE_SCHED;
 	params->pktout_mode = ODP_PKTOUT_MODE_DIRECT;
 	params->sched_sync = ODP_SCHED_SYNC_ATOMIC;
+	params->flow_queues = OFP_FLOW_QUEUES;
+	params->flow_rebalance.threshold = OFP_FLOW_REBALANCE_PCT;
+	params->flow_rebalance.persist = OFP_FLOW_REBALANCE_PERSIST;
+	params->flow_rebalance.interval_ms = OFP_FLOW_REBALANCE_INTERVAL_MS;
 	params->sched_group = ODP_SCHED_GROUP_ALL;
 #ifdef SP
 	params->enable_nl_thread = 1;
@@ -282,14 +477,63 @@ void ofp_init_global_param_from_file(ofp_global_param_t *params, const char *fil
 	params->arp.hash_bits = OFP_ARP_HASH_BITS;
 	params->arp.entry_timeout = OFP_ARP_ENTRY_TIMEOUT;
 	params->arp.saved_pkt_timeout = OFP_ARP_SAVED_PKT_TIMEOUT;
+	params->nd6.entries = OFP_ND6_ENTRIES;
+	params->nd6.hash_bits = OFP_ND6_HASH_BITS;
+	params->nd6.reachable_time = OFP_ND6_REACHABLE_TIME;
+	params->nd6.entry_timeout = OFP_ND6_ENTRY_TIMEOUT;
 	params->evt_rx_burst_size = OFP_EVT_RX_BURST_SIZE;
+	params->pktin_vector.size = OFP_PKTIN_VECTOR_SIZE;
+	params->pktin_vector.tmo_ns = OFP_PKTIN_VECTOR_TMO_NS;
+	params->pktin_vector.num = OFP_PKTIN_VECTOR_NUM;
 	params->pcb_tcp_max = OFP_NUM_PCB_TCP_MAX;
+	params->if_max = OFP_FP_INTERFACE_MAX;
+	params->cpu_max = 0;
+	params->socket_max = OFP_NUM_SOCKETS_MAX;
+	params->sock_event_num = OFP_SOCK_EVENT_NUM;
+	params->tcp_syncache_max = OFP_TCP_SYNCACHE_MAX;
+	params->tcp_tw_max = OFP_TCP_TW_MAX;
+	params->sleep_park = 1;
+	params->share_nothing = 0;
+	params->tcp_timer_affinity = 0;
+	params->timer_budget = OFP_TIMER_BUDGET;
+	params->uma_cache_size = OFP_UMA_CACHE_SIZE;
 	params->pkt_pool.nb_pkts = SHM_PKT_POOL_NB_PKTS;
 	params->pkt_pool.buffer_size = SHM_PKT_POOL_BUFFER_SIZE;
+	params->pkt_pool.small_size = OFP_PKT_POOL_SMALL_SIZE;
+	params->sockbuf.small_rings = OFP_SOCKBUF_SMALL_RINGS;
+	params->sockbuf.rings = OFP_SOCKBUF_RINGS;
+	params->sockbuf.ring_len = OFP_SOCKBUF_RING_LEN;
+	params->sockbuf.auto_mem_kb = OFP_SOCKBUF_AUTO_MEM_KB;
 	params->pkt_tx_burst_size = OFP_PKT_TX_BURST_SIZE;
+	params->pkt_tx_queue_map = OFP_TX_QUEUE_MAP_CPU;
+	params->if_queues.rx = OFP_PKTIN_QUEUES;
+	params->if_queues.tx = OFP_PKTOUT_QUEUES;
+	params->if_queues.hash_proto.proto.ipv4_tcp = 1;
+	params->if_queues.hash_proto.proto.ipv4_udp = 1;
+	params->if_queues.hash_proto.proto.ipv6_tcp = 1;
+	params->if_queues.hash_proto.proto.ipv6_udp = 1;
+	params->pkt_tx_hold_ns = OFP_PKT_TX_HOLD_NS;
+	params->pkt_tx_pace_max = OFP_PKT_TX_PACE_MAX;
+	params->pkt_tx_retry_max = OFP_PKT_TX_RETRY_MAX;
+	params->pkt_tx_retry_ns = OFP_PKT_TX_RETRY_NS;
+	params->tcp_gro_flows = OFP_TCP_GRO_FLOWS;
+	params->rx_timestamp = OFP_RX_TIMESTAMP;
 	params->num_vlan = OFP_NUM_VLAN;
+	params->vlan_table = 1;
+	params->num_ifaddr = OFP_NUM_IFADDR;
+	params->use_btree = 1;
 	params->mtrie.routes = OFP_ROUTES;
 	params->mtrie.table8_nodes = OFP_MTRIE_TABLE8_NODES;
+	params->mtrie.table8_grow = OFP_MTRIE_TABLE8_GROW;
+	params->mtrie.first_level = OFP_MTRIE_FIRST_LEVEL;
+	params->mtrie.vrf_tables = OFP_MTRIE_VRF_TABLES;
+	params->mtrie.vrf_routes = OFP_MTRIE_VRF_ROUTES;
+	params->mtrie.vrf_table8_nodes = OFP_MTRIE_VRF_TABLE8_NODES;
+	params->mtrie6.table8_nodes = OFP_MTRIE6_TABLE8_NODES;
+	params->reass.max_queues = OFP_REASS_MAX_QUEUES;
+	params->reass.max_frags = OFP_REASS_MAX_FRAGS;
+	params->vxlan.mac_entries = OFP_VXLAN_MAC_ENTRIES;
+	params->vxlan.mac_timeout = OFP_VXLAN_MAC_TIMEOUT;
 	params->num_vrf = OFP_NUM_VRF;
 	params->chksum_offload.ipv4_rx_ena = OFP_CHKSUM_OFFLOAD_IPV4_RX;
 	params->chksum_offload.udp_rx_ena = OFP_CHKSUM_OFFLOAD_UDP_RX;
@@ -297,7 +541,35 @@ void ofp_init_global_param_from_file(ofp_global_param_t *params, const char *fil
 	params->chksum_offload.ipv4_tx_ena = OFP_CHKSUM_OFFLOAD_IPV4_TX;
 	params->chksum_offload.udp_tx_ena = OFP_CHKSUM_OFFLOAD_UDP_TX;
 	params->chksum_offload.tcp_tx_ena = OFP_CHKSUM_OFFLOAD_TCP_TX;
+	params->chksum_offload.tcp_tso_ena = OFP_TCP_TSO_OFFLOAD;
 	ofp_ipsec_param_init(&params->ipsec);
+	params->telemetry.interval_ms = OFP_TELEMETRY_INTERVAL_MS;
+	params->telemetry.name = OFP_TELEMETRY_NAME;
+	params->mem_pressure.low = OFP_MEM_PRESSURE_LOW_PCT;
+	params->mem_pressure.high = OFP_MEM_PRESSURE_HIGH_PCT;
+	params->mem_pressure.interval_ms = OFP_MEM_PRESSURE_INTERVAL_MS;
+	params->slow_path.linux_if = OFP_SP_LINUX_IF;
+	params->slow_path.routing_pps = OFP_SP_ROUTING_PPS;
+	params->slow_path.arp_pps = OFP_SP_ARP_PPS;
+	params->slow_path.icmp_pps = OFP_SP_ICMP_PPS;
+	params->slow_path.other_pps = OFP_SP_OTHER_PPS;
+	params->slow_path.burst = OFP_SP_BURST;
+	params->icmp_err.pps = OFP_ICMP_ERR_PPS;
+	params->icmp_err.prefix_pps = OFP_ICMP_ERR_PREFIX_PPS;
+	params->icmp_err.burst = OFP_ICMP_ERR_BURST;
+	params->idle.spin = OFP_IDLE_SPIN;
+	params->idle.pause = OFP_IDLE_PAUSE;
+	params->idle.max_sleep_us = OFP_IDLE_MAX_SLEEP_US;
+	params->conntrack.tcp_timeout = OFP_CT_TCP_TIMEOUT;
+	params->conntrack.udp_timeout = OFP_CT_UDP_TIMEOUT;
+	params->conntrack.timeout = OFP_CT_TIMEOUT;
+	params->tm.rate_kbps = OFP_TM_RATE_KBPS;
+	params->tm.burst = OFP_TM_BURST;
+	params->sflow.port = OFP_SFLOW_PORT;
+	params->sflow.header_len = OFP_SFLOW_HEADER_LEN;
+	params->trace.stages = OFP_TRACE_ALL;
+	params->logging.async = 1;
+	params->logging.rate = OFP_LOG_RATE;
 
 	read_conf_file(params, filename);
 }
@@ -317,22 +589,74 @@ static void ofp_init_prepare(void)
 	 * global_param can be accessed and ofp_shared_memory_prealloc()
 	 * can be called.
 	 */
+#ifdef OFP_LOCK_STAT
+	ofp_lockstat_init_prepare();
+#endif
         ofp_uma_init_prepare();
 	ofp_avl_init_prepare();
+	ofp_btree_init_prepare();
 	ofp_reassembly_init_prepare();
+#ifdef INET6
+	ofp_reassembly6_init_prepare();
+#endif /* INET6 */
 	ofp_pcap_init_prepare();
 	ofp_stat_init_prepare();
 	ofp_timer_init_prepare();
+	ofp_mem_pressure_init_prepare();
 	ofp_hook_init_prepare();
 	ofp_arp_init_prepare();
+	ofp_rcu_init_prepare();
+	ofp_flow_cache_init_prepare();
 	ofp_route_init_prepare();
 	ofp_portconf_init_prepare();
+	ofp_steer_init_prepare();
+	ofp_tm_init_prepare();
+	ofp_acl_init_prepare();
+	ofp_sflow_init_prepare();
+	ofp_trace_init_prepare();
+	ofp_log_init_prepare();
 	ofp_vlan_init_prepare();
-	ofp_vxlan_init_prepare();
 	ofp_socket_init_prepare();
 	ofp_tcp_var_init_prepare();
 	ofp_ip_init_prepare();
-	ofp_ipsec_init_prepare(&global_param->ipsec);
+	ofp_module_init_prepare();
+}
+
+static int ofp_pktin_vector_pool_create(void)
+{
+#ifdef OFP_PKTIN_VECTOR
+	odp_pool_capability_t capa;
+	odp_pool_param_t pool_params;
+	uint32_t size = global_param->pktin_vector.size;
+	uint32_t num = global_param->pktin_vector.num;
+
+	if (!size || !num)
+		return 0;
+
+	if (odp_pool_capability(&capa) || !capa.vector.max_pools) {
+		OFP_INFO("Packet vector pools not supported");
+		return 0;
+	}
+	if (capa.vector.max_size && size > capa.vector.max_size)
+		size = capa.vector.max_size;
+	if (capa.vector.max_num && num > capa.vector.max_num)
+		num = capa.vector.max_num;
+
+	odp_pool_param_init(&pool_params);
+	pool_params.type            = ODP_POOL_VECTOR;
+	pool_params.vector.num      = num;
+	pool_params.vector.max_size = size;
+
+	ofp_pktin_vector_pool = odp_pool_create(SHM_PKT_VECTOR_POOL_NAME,
+						&pool_params);
+	if (ofp_pktin_vector_pool == ODP_POOL_INVALID) {
+		OFP_ERR("odp_pool_create failed");
+		return -1;
+	}
+	/* Vectors are sized by the pool from here on */
+	global_param->pktin_vector.size = size;
+#endif /* OFP_PKTIN_VECTOR */
+	return 0;
 }
 
 static int ofp_init_pre_global(ofp_global_param_t *params)
@@ -351,6 +675,34 @@ static int ofp_init_pre_global(ofp_global_param_t *params)
 
 	*global_param = *params;
 
+	if (global_param->if_max <= 0 ||
+	    global_param->if_max > OFP_FP_INTERFACE_LIMIT) {
+		OFP_ERR("Invalid if_max %d", global_param->if_max);
+		return -1;
+	}
+
+	if (global_param->cpu_max <= 0) {
+		odp_cpumask_t all;
+
+		odp_cpumask_all_available(&all);
+		global_param->cpu_max = odp_cpumask_last(&all) + 1;
+	}
+
+	if (params->share_nothing && odp_cpu_count() > OFP_MAX_NUM_CPU) {
+		OFP_ERR("Share-nothing mode supports up to %d CPUs",
+			OFP_MAX_NUM_CPU);
+		return -1;
+	}
+	if (params->tcp_timer_affinity && odp_cpu_count() > OFP_MAX_NUM_CPU) {
+		OFP_WARN("TCP timer affinity supports up to %d CPUs, disabled",
+			 OFP_MAX_NUM_CPU);
+		global_param->tcp_timer_affinity = 0;
+	}
+
+	/* Select CPU specific hash and checksum kernels */
+	ofp_hash_init_global();
+	ofp_cksum_init_global();
+
 	/* Initialize shared memory infra before preallocations */
 	HANDLE_ERROR(ofp_shared_memory_init_global());
 	/* Let different code modules preallocate shared memory */
@@ -358,14 +710,23 @@ static int ofp_init_pre_global(ofp_global_param_t *params)
 	/* Finish preallocation phase before the corresponding allocations */
 	HANDLE_ERROR(ofp_shared_memory_prealloc_finish());
 
+#ifdef OFP_LOCK_STAT
+	/* Locks taken before this are not counted */
+	HANDLE_ERROR(ofp_lockstat_init_global());
+#endif
+
         /* Initialize the UM allocator before doing other inits */
 	HANDLE_ERROR(ofp_uma_init_global());
 
 	ofp_register_sysctls();
 
 	HANDLE_ERROR(ofp_avl_init_global());
+	HANDLE_ERROR(ofp_btree_init_global());
 
 	HANDLE_ERROR(ofp_reassembly_init_global());
+#ifdef INET6
+	HANDLE_ERROR(ofp_reassembly6_init_global());
+#endif /* INET6 */
 
 	HANDLE_ERROR(ofp_pcap_init_global());
 
@@ -377,49 +738,123 @@ static int ofp_init_pre_global(ofp_global_param_t *params)
 			OFP_TIMER_TMO_COUNT,
 			params->sched_group));
 
-	HANDLE_ERROR(ofp_hook_init_global(params->pkt_hook));
+	HANDLE_ERROR(ofp_telemetry_init_global(&params->telemetry));
+	HANDLE_ERROR(ofp_mem_pressure_init_global(&params->mem_pressure));
+
+	HANDLE_ERROR(ofp_hook_init_global(params->pkt_hook,
+					   params->pkt_hook_burst));
 
 	HANDLE_ERROR(ofp_arp_init_global());
 
+	HANDLE_ERROR(ofp_rcu_init_global());
+
+	HANDLE_ERROR(ofp_flow_cache_init_global());
+
 	HANDLE_ERROR(ofp_route_init_global());
 
 	HANDLE_ERROR(ofp_vlan_init_global());
 
 	HANDLE_ERROR(ofp_portconf_init_global());
 
-	HANDLE_ERROR(ofp_vxlan_init_global());
-
-	odp_pool_param_t pool_params;
-	odp_pool_param_init(&pool_params);
-	/* Define pkt.seg_len so that l2/l3/l4 offset fits in first segment */
-	pool_params.pkt.seg_len    = global_param->pkt_pool.buffer_size;
-	pool_params.pkt.len        = global_param->pkt_pool.buffer_size;
-	pool_params.pkt.num        = params->pkt_pool.nb_pkts;
-	pool_params.pkt.uarea_size = ofp_packet_min_user_area();
-	pool_params.type           = ODP_POOL_PACKET;
+	HANDLE_ERROR(ofp_steer_init_global());
+	HANDLE_ERROR(ofp_tm_init_global());
+	HANDLE_ERROR(ofp_acl_init_global());
+	HANDLE_ERROR(ofp_sflow_init_global());
+	HANDLE_ERROR(ofp_trace_init_global());
+	HANDLE_ERROR(ofp_log_init_global());
 
-	ofp_packet_pool = ofp_pool_create(SHM_PKT_POOL_NAME, &pool_params);
+	ofp_packet_pool = ofp_packet_pool_create(SHM_PKT_POOL_NAME);
 	if (ofp_packet_pool == ODP_POOL_INVALID) {
 		OFP_ERR("odp_pool_create failed");
 		return -1;
 	}
 
+	if (global_param->pkt_pool.small_nb_pkts > 0) {
+		odp_pool_param_t pool_params;
+
+		odp_pool_param_init(&pool_params);
+		pool_params.pkt.seg_len    = global_param->pkt_pool.small_size;
+		pool_params.pkt.len        = global_param->pkt_pool.small_size;
+		pool_params.pkt.num        = global_param->pkt_pool.small_nb_pkts;
+		pool_params.pkt.uarea_size = ofp_packet_min_user_area();
+		pool_params.type           = ODP_POOL_PACKET;
+
+		ofp_packet_pool_small = ofp_pool_create(SHM_PKT_POOL_SMALL_NAME,
+							&pool_params);
+		if (ofp_packet_pool_small == ODP_POOL_INVALID) {
+			OFP_ERR("odp_pool_create failed");
+			return -1;
+		}
+		ofp_packet_small_len = global_param->pkt_pool.small_size;
+	}
+
+	HANDLE_ERROR(ofp_pktin_vector_pool_create());
+
+	if (global_param->sock_event_num > 0) {
+		odp_pool_param_t pool_params;
+
+		odp_pool_param_init(&pool_params);
+		pool_params.buf.num  = global_param->sock_event_num;
+		pool_params.buf.size = sizeof(struct ofp_sock_sigval);
+		pool_params.type     = ODP_POOL_BUFFER;
+
+		ofp_sock_event_pool = ofp_pool_create(SHM_SOCK_EVENT_POOL_NAME,
+						      &pool_params);
+		if (ofp_sock_event_pool == ODP_POOL_INVALID) {
+			OFP_ERR("odp_pool_create failed");
+			return -1;
+		}
+	}
+
 	HANDLE_ERROR(ofp_socket_init_global(ofp_packet_pool));
 	HANDLE_ERROR(ofp_tcp_var_init_global());
 	HANDLE_ERROR(ofp_inet_init());
 	HANDLE_ERROR(ofp_ip_init_global());
-	HANDLE_ERROR(ofp_ipsec_init_global(&params->ipsec));
+	HANDLE_ERROR(ofp_flow_queue_init_global());
+	/* Protocol modules, after the IP protocol switch and timers */
+	HANDLE_ERROR(ofp_module_init_global());
+	/* Hooks, ACLs and connection tracking are set up by now */
+	ofp_ip4_feat_update(0);
 
 	return 0;
 }
 
+odp_pool_t ofp_packet_pool_create(const char *name)
+{
+	odp_pool_param_t pool_params;
+	uint32_t seg_len = global_param->pkt_pool.seg_len;
+
+	odp_pool_param_init(&pool_params);
+	if (seg_len) {
+		/* Multi-segment packets, headers are pulled up as needed */
+		if (seg_len < OFP_PKT_POOL_SEG_LEN_MIN)
+			seg_len = OFP_PKT_POOL_SEG_LEN_MIN;
+		pool_params.pkt.seg_len = seg_len;
+		pool_params.pkt.len     = seg_len;
+		pool_params.pkt.max_len = global_param->pkt_pool.buffer_size;
+	} else {
+		/* Define pkt.seg_len so that l2/l3/l4 offset fits in first segment */
+		pool_params.pkt.seg_len = global_param->pkt_pool.buffer_size;
+		pool_params.pkt.len     = global_param->pkt_pool.buffer_size;
+	}
+	pool_params.pkt.num        = global_param->pkt_pool.nb_pkts;
+	pool_params.pkt.uarea_size = ofp_packet_min_user_area();
+	pool_params.type           = ODP_POOL_PACKET;
+
+	return ofp_pool_create(name, &pool_params);
+}
+
 odp_pool_t ofp_packet_pool;
+odp_pool_t ofp_packet_pool_small = ODP_POOL_INVALID;
+odp_pool_t ofp_pktin_vector_pool = ODP_POOL_INVALID;
+odp_pool_t ofp_sock_event_pool = ODP_POOL_INVALID;
+uint32_t ofp_packet_small_len;
 odp_cpumask_t cpumask;
 int ofp_init_global_called = 0;
 
 int ofp_init_global(odp_instance_t instance, ofp_global_param_t *params)
 {
-	int i;
+	int i, ret;
 	odp_pktio_param_t pktio_param;
 	odp_pktin_queue_param_t pktin_param;
 	odph_thread_common_param_t thd_common_param;
@@ -440,7 +875,7 @@ int ofp_init_global(odp_instance_t instance, ofp_global_param_t *params)
 
 	OFP_INFO("Slow path threads on core %d", odp_cpumask_first(&cpumask));
 
-	HANDLE_ERROR(ofp_set_vxlan_interface_queue());
+	HANDLE_ERROR(ofp_module_init_ifnet());
 
 	/* Create interfaces */
 	odp_pktio_param_init(&pktio_param);
@@ -474,6 +909,22 @@ int ofp_init_global(odp_instance_t instance, ofp_global_param_t *params)
 	}
 #endif /* SP */
 
+	/* Captured packets are written by a thread on the slow path core */
+	HANDLE_ERROR(ofp_pcap_start_writer(&cpumask));
+	HANDLE_ERROR(ofp_sflow_start_exporter(&cpumask));
+	HANDLE_ERROR(ofp_ipc_init_global(instance));
+	HANDLE_ERROR(ofp_ipc_start_server(&cpumask));
+	HANDLE_ERROR(ofp_log_start_logger(&cpumask));
+
+	/* Before any packet is received, a bad file means a cold start */
+	if (params->warm_restart.file) {
+		ret = ofp_warm_restore(params->warm_restart.file);
+		if (ret < 0)
+			OFP_WARN("Warm restart failed, starting cold");
+		else if (ret)
+			OFP_WARN("Warm restart lost %d routes", ret);
+	}
+
 	odp_schedule_resume();
 	return 0;
 }
@@ -485,26 +936,47 @@ int ofp_init_local(void)
 	HANDLE_ERROR(ofp_shared_memory_init_local());
 
 	/* Lookup shared memories */
+#ifdef OFP_LOCK_STAT
+	HANDLE_ERROR(ofp_lockstat_lookup_shared_memory());
+#endif
 	HANDLE_ERROR(ofp_uma_lookup_shared_memory());
 	HANDLE_ERROR(ofp_global_config_lookup_shared_memory());
 	HANDLE_ERROR(ofp_portconf_lookup_shared_memory());
+	HANDLE_ERROR(ofp_steer_lookup_shared_memory());
+	HANDLE_ERROR(ofp_tm_lookup_shared_memory());
+	HANDLE_ERROR(ofp_acl_lookup_shared_memory());
+	HANDLE_ERROR(ofp_sflow_lookup_shared_memory());
+	HANDLE_ERROR(ofp_trace_lookup_shared_memory());
+	HANDLE_ERROR(ofp_log_lookup_shared_memory());
 	HANDLE_ERROR(ofp_vlan_lookup_shared_memory());
+	HANDLE_ERROR(ofp_rcu_lookup_shared_memory());
+	HANDLE_ERROR(ofp_flow_cache_lookup_shared_memory());
 	HANDLE_ERROR(ofp_route_lookup_shared_memory());
 	HANDLE_ERROR(ofp_vrf_route_lookup_shared_memory());
 	HANDLE_ERROR(ofp_avl_lookup_shared_memory());
+	HANDLE_ERROR(ofp_btree_lookup_shared_memory());
 	HANDLE_ERROR(ofp_reassembly_lookup_shared_memory());
+#ifdef INET6
+	HANDLE_ERROR(ofp_reassembly6_lookup_shared_memory());
+#endif /* INET6 */
 	HANDLE_ERROR(ofp_pcap_lookup_shared_memory());
 	HANDLE_ERROR(ofp_stat_lookup_shared_memory());
 	HANDLE_ERROR(ofp_socket_lookup_shared_memory());
 	HANDLE_ERROR(ofp_timer_lookup_shared_memory());
+	HANDLE_ERROR(ofp_mem_pressure_lookup_shared_memory());
 	HANDLE_ERROR(ofp_hook_lookup_shared_memory());
 	HANDLE_ERROR(ofp_arp_lookup_shared_memory());
-	HANDLE_ERROR(ofp_vxlan_lookup_shared_memory());
 	HANDLE_ERROR(ofp_arp_init_local());
 	HANDLE_ERROR(ofp_tcp_var_lookup_shared_memory());
 	HANDLE_ERROR(ofp_send_pkt_out_init_local());
+	HANDLE_ERROR(ofp_flow_cache_init_local());
+	HANDLE_ERROR(ofp_ct_init_local());
+	HANDLE_ERROR(ofp_sflow_init_local());
+	HANDLE_ERROR(ofp_trace_init_local());
+	HANDLE_ERROR(ofp_log_init_local());
+	HANDLE_ERROR(ofp_gro_init_local());
 	HANDLE_ERROR(ofp_ip_init_local());
-	HANDLE_ERROR(ofp_ipsec_init_local());
+	HANDLE_ERROR(ofp_module_init_local());
 
 	return 0;
 }
@@ -516,6 +988,9 @@ int ofp_term_global(void)
 	struct ofp_ifnet *ifnet;
 
 	ofp_stop_processing();
+
+	if (global_param->warm_restart.file)
+		CHECK_ERROR(ofp_warm_save(global_param->warm_restart.file), rc);
 #ifdef CLI
 	/* Terminate CLI thread*/
 	CHECK_ERROR(ofp_stop_cli_thread(), rc);
@@ -529,6 +1004,11 @@ int ofp_term_global(void)
 	}
 #endif /* SP */
 
+	ofp_pcap_stop_writer();
+	ofp_sflow_stop_exporter();
+	/* Closes the sockets of the clients still attached */
+	CHECK_ERROR(ofp_ipc_term_global(), rc);
+
 	/* Cleanup interfaces: queues and pktios*/
 	for (i = 0; PHYS_PORT(i); i++) {
 		ifnet = ofp_get_ifnet((uint16_t)i, 0);
@@ -540,17 +1020,27 @@ int ofp_term_global(void)
 		if (ifnet->if_state == OFP_IFT_STATE_FREE)
 			continue;
 
-		if (ifnet->pktio == ODP_PKTIO_INVALID)
+		/* A LAG port has queues and threads but no pktio */
+		if (ifnet->lag_num)
+			CHECK_ERROR(ofp_lag_term(ifnet), rc);
+		else if (ifnet->pktio == ODP_PKTIO_INVALID)
 			continue;
 
 		OFP_INFO("Cleaning device '%s' addr %s", ifnet->if_name,
 			ofp_print_mac((uint8_t *)ifnet->mac));
 
-		CHECK_ERROR(odp_pktio_stop(ifnet->pktio), rc);
+		if (ifnet->pktio != ODP_PKTIO_INVALID)
+			CHECK_ERROR(odp_pktio_stop(ifnet->pktio), rc);
 #ifdef SP
 		odph_thread_join(ifnet->rx_tbl, 1);
 		odph_thread_join(ifnet->tx_tbl, 1);
-		close(ifnet->fd);
+		if (ifnet->sp_pktio != ODP_PKTIO_INVALID) {
+			CHECK_ERROR(odp_pktio_stop(ifnet->sp_pktio), rc);
+			CHECK_ERROR(odp_pktio_close(ifnet->sp_pktio), rc);
+			ifnet->sp_pktio = ODP_PKTIO_INVALID;
+		}
+		if (ifnet->fd >= 0)
+			close(ifnet->fd);
 		ifnet->fd = -1;
 #endif /*SP*/
 
@@ -567,19 +1057,28 @@ int ofp_term_global(void)
 			ifnet->loopq_def = ODP_QUEUE_INVALID;
 		}
 #ifdef SP
-		if (ifnet->spq_def != ODP_QUEUE_INVALID) {
-			cleanup_pkt_queue(ifnet->spq_def);
-			if (odp_queue_destroy(ifnet->spq_def) < 0) {
+		for (j = 0; j < OFP_SP_CLASS_MAX; j++) {
+			if (ifnet->spq[j] == ODP_QUEUE_INVALID)
+				continue;
+			cleanup_pkt_queue(ifnet->spq[j]);
+			if (odp_queue_destroy(ifnet->spq[j]) < 0) {
 				OFP_ERR("Failed to destroy slow path "
 					"queue for %s", ifnet->if_name);
 				rc = -1;
 			}
-			ifnet->spq_def = ODP_QUEUE_INVALID;
+			ifnet->spq[j] = ODP_QUEUE_INVALID;
+		}
+		if (ifnet->sp_evfd >= 0) {
+			close(ifnet->sp_evfd);
+			ifnet->sp_evfd = -1;
 		}
 #endif /*SP*/
 		for (j = 0; j < OFP_PKTOUT_QUEUE_MAX; j++)
 			ifnet->out_queue_queue[j] = ODP_QUEUE_INVALID;
 
+		CHECK_ERROR(ofp_steer_ifnet_term(ifnet), rc);
+		CHECK_ERROR(ofp_tm_ifnet_term(ifnet), rc);
+
 		if (ifnet->pktio != ODP_PKTIO_INVALID) {
 			int num_queues = odp_pktin_event_queue(ifnet->pktio, NULL, 0);
 			odp_queue_t in_queue[num_queues];
@@ -590,17 +1089,34 @@ int ofp_term_global(void)
 			for (idx = 0; idx < num_in_queue; idx++)
 				cleanup_pkt_queue(in_queue[idx]);
 
+#ifdef ODP_LSO_PROFILE_INVALID
+			if (ifnet->lso_profile != ODP_LSO_PROFILE_INVALID &&
+			    odp_lso_profile_destroy(ifnet->lso_profile)) {
+				OFP_ERR("Failed to destroy LSO profile for %s",
+					ifnet->if_name);
+				rc = -1;
+			}
+			ifnet->lso_profile = ODP_LSO_PROFILE_INVALID;
+#endif
 			if (odp_pktio_close(ifnet->pktio) < 0) {
 				OFP_ERR("Failed to destroy pktio for %s",
 					ifnet->if_name);
 				rc = -1;
 			}
 			ifnet->pktio = ODP_PKTIO_INVALID;
+
+			if (ifnet->pkt_pool != ofp_packet_pool &&
+			    odp_pool_destroy(ifnet->pkt_pool)) {
+				OFP_ERR("Failed to destroy packet pool of %s",
+					ifnet->if_name);
+				rc = -1;
+			}
+			ifnet->pkt_pool = ofp_packet_pool;
 		}
 
 	}
 
-	CHECK_ERROR(ofp_clean_vxlan_interface_queue(), rc);
+	CHECK_ERROR(ofp_module_term_ifnet(), rc);
 	CHECK_ERROR(ofp_local_interfaces_destroy(), rc);
 
 	if (ofp_term_post_global(SHM_PKT_POOL_NAME)) {
@@ -608,6 +1124,10 @@ int ofp_term_global(void)
 		rc = -1;
 	}
 
+#ifdef OFP_LOCK_STAT
+	CHECK_ERROR(ofp_lockstat_term_global(), rc);
+#endif
+
 	/* Terminate shared memory now that all blocks have been freed. */
 	CHECK_ERROR(ofp_shared_memory_term_global(), rc);
 
@@ -619,8 +1139,9 @@ int ofp_term_post_global(const char *pool_name)
 	odp_pool_t pool;
 	int rc = 0;
 
-	ofp_igmp_uninit(NULL);
+	CHECK_ERROR(ofp_module_term_global(), rc);
 
+	CHECK_ERROR(ofp_flow_queue_term_global(), rc);
 	CHECK_ERROR(ofp_ip_term_global(), rc);
 
 	/* Cleanup sockets */
@@ -629,23 +1150,30 @@ int ofp_term_post_global(const char *pool_name)
 	/* Cleanup of TCP content */
 	CHECK_ERROR(ofp_tcp_var_term_global(), rc);
 
-	/* Cleanup vxlan */
-	CHECK_ERROR(ofp_vxlan_term_global(), rc);
-
 	/* Cleanup interface related objects */
+	CHECK_ERROR(ofp_steer_term_global(), rc);
+	CHECK_ERROR(ofp_tm_term_global(), rc);
+	CHECK_ERROR(ofp_acl_term_global(), rc);
+	CHECK_ERROR(ofp_sflow_term_global(), rc);
+	CHECK_ERROR(ofp_trace_term_global(), rc);
+	CHECK_ERROR(ofp_log_term_global(), rc);
 	CHECK_ERROR(ofp_portconf_term_global(), rc);
 	CHECK_ERROR(ofp_vlan_term_global(), rc);
 
 	/* Cleanup routes */
 	CHECK_ERROR(ofp_route_term_global(), rc);
+	CHECK_ERROR(ofp_rcu_term_global(), rc);
 
 	/* Cleanup ARP*/
 	CHECK_ERROR(ofp_arp_term_global(), rc);
+	CHECK_ERROR(ofp_flow_cache_term_global(), rc);
 
 	/* Cleanup hooks */
 	CHECK_ERROR(ofp_hook_term_global(), rc);
 
 	/* Cleanup stats */
+	CHECK_ERROR(ofp_telemetry_term_global(), rc);
+	CHECK_ERROR(ofp_mem_pressure_term_global(), rc);
 	CHECK_ERROR(ofp_stat_term_global(), rc);
 
 	/* Cleanup packet capture */
@@ -653,15 +1181,22 @@ int ofp_term_post_global(const char *pool_name)
 
 	/* Cleanup reassembly queues*/
 	CHECK_ERROR(ofp_reassembly_term_global(), rc);
+#ifdef INET6
+	CHECK_ERROR(ofp_reassembly6_term_global(), rc);
+#endif /* INET6 */
 
 	/* Cleanup avl trees*/
 	CHECK_ERROR(ofp_avl_term_global(), rc);
+	CHECK_ERROR(ofp_btree_term_global(), rc);
 
 	/* Cleanup timers - phase 1*/
 	CHECK_ERROR(ofp_timer_stop_global(), rc);
 
-	/* Stop IPsec. This may generate events that need to be handled. */
-	CHECK_ERROR(ofp_ipsec_stop_global(), rc);
+	/*
+	 * Stop the protocol modules. IPsec may generate events that need
+	 * to be handled.
+	 */
+	CHECK_ERROR(ofp_module_stop_global(), rc);
 
 	/*
 	 * ofp_term_local() has paused scheduling for this thread. Resume
@@ -683,10 +1218,36 @@ int ofp_term_post_global(const char *pool_name)
 	/* Cleanup timers - phase 2*/
 	CHECK_ERROR(ofp_timer_term_global(), rc);
 
-	/* Cleanup IPsec */
-	CHECK_ERROR(ofp_ipsec_term_global(), rc);
+	/* Cleanup the protocol modules that needed the drain, IPsec */
+	CHECK_ERROR(ofp_module_term_drained(), rc);
+
+	/* Cleanup packet pools */
+	if (ofp_packet_pool_small != ODP_POOL_INVALID) {
+		ofp_packet_small_len = 0;
+		if (odp_pool_destroy(ofp_packet_pool_small) < 0) {
+			OFP_ERR("Failed to destroy pool %s.\n",
+				SHM_PKT_POOL_SMALL_NAME);
+			rc = -1;
+		}
+		ofp_packet_pool_small = ODP_POOL_INVALID;
+	}
+	if (ofp_pktin_vector_pool != ODP_POOL_INVALID) {
+		if (odp_pool_destroy(ofp_pktin_vector_pool) < 0) {
+			OFP_ERR("Failed to destroy pool %s.\n",
+				SHM_PKT_VECTOR_POOL_NAME);
+			rc = -1;
+		}
+		ofp_pktin_vector_pool = ODP_POOL_INVALID;
+	}
+	if (ofp_sock_event_pool != ODP_POOL_INVALID) {
+		if (odp_pool_destroy(ofp_sock_event_pool) < 0) {
+			OFP_ERR("Failed to destroy pool %s.\n",
+				SHM_SOCK_EVENT_POOL_NAME);
+			rc = -1;
+		}
+		ofp_sock_event_pool = ODP_POOL_INVALID;
+	}
 
-	/* Cleanup packet pool */
 	pool = odp_pool_lookup(pool_name);
 	if (pool == ODP_POOL_INVALID) {
 		OFP_ERR("Failed to locate pool %s\n", pool_name);
@@ -712,8 +1273,15 @@ int ofp_term_local(void)
 	odp_schedule_pause();
 	drain_scheduler();
 
+	CHECK_ERROR(ofp_module_term_local(), rc);
 	CHECK_ERROR(ofp_ip_term_local(), rc);
 	CHECK_ERROR(ofp_send_pkt_out_term_local(), rc);
+	CHECK_ERROR(ofp_flow_cache_term_local(), rc);
+	CHECK_ERROR(ofp_ct_term_local(), rc);
+	CHECK_ERROR(ofp_gro_term_local(), rc);
+	ofp_socket_term_local();
+	ofp_coroutine_term_local();
+	ofp_log_term_local();
 
 	return rc;
 }
@@ -34,6 +34,7 @@
 #include "ofpi_in.h"
 #include "ofpi_ip_var.h"
 #include "ofpi_protosw.h"
+#include "ofpi_module.h"
 
 
 uint8_t ofp_ip_protox[OFP_IPPROTO_MAX];
@@ -41,9 +42,11 @@ uint8_t ofp_ip_protox_udp;
 uint8_t ofp_ip_protox_tcp;
 uint8_t ofp_ip_protox_gre;
 
+VNET_DEFINE(struct ofp_ipstat, ofp_ipstat);
+
 /*
  * IP initialization: fill in IP protocol switch table.
- * All protocols not implemented go to slow path.
+ * All protocols not implemented or disabled go to slow path.
  */
 void ofp_ip_init(void)
 {
@@ -55,7 +58,8 @@ void ofp_ip_init(void)
 
 	for (pr = ofp_inetdomain.dom_protosw;
 	    pr < ofp_inetdomain.dom_protoswNPROTOSW; pr++)
-		if (pr->pr_protocol < OFP_IPPROTO_MAX)
+		if (pr->pr_protocol < OFP_IPPROTO_MAX &&
+		    !ofp_module_proto_disabled(pr->pr_protocol))
 			ofp_ip_protox[pr->pr_protocol] = pr -
 				ofp_inetdomain.dom_protosw;
 	ofp_ip_protox_udp = ofp_ip_protox[OFP_IPPROTO_UDP];
@@ -0,0 +1,615 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * Socket operations of client processes. The shared memory of the
+ * rings is reserved with ODP_SHM_EXPORT and imported by the clients,
+ * so it holds no pointers. A client has one operation in flight:
+ * it fills the slot of the ring head, advances sq and waits for the
+ * server to advance cq. A blocking operation that would block stays
+ * at the tail of its ring and is retried on the next server round.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include <odp/helper/odph_api.h>
+
+#include "ofpi.h"
+#include "ofpi_ipc.h"
+#include "ofpi_in.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+
+#include "api/ofp_errno.h"
+#include "api/ofp_ioctl.h"
+
+#define SHM_NAME_IPC "OfpIpcShMem"
+#define IPC_MAGIC 0x4f495043
+#define IPC_SERVER_IDLE_US 20
+#define IPC_SERVER_SPIN 100
+#define IPC_CLIENT_SPIN 1000
+#define IPC_LIVENESS_NS 1000000000ULL
+
+ODP_STATIC_ASSERT((OFP_IPC_RING_SIZE & (OFP_IPC_RING_SIZE - 1)) == 0,
+		  "OFP_IPC_RING_SIZE not a power of two");
+
+enum ipc_op_code {
+	IPC_SOCKET = 1,
+	IPC_CLOSE,
+	IPC_SHUTDOWN,
+	IPC_BIND,
+	IPC_CONNECT,
+	IPC_LISTEN,
+	IPC_ACCEPT,
+	IPC_SENDTO,
+	IPC_RECVFROM,
+	IPC_DETACH
+};
+
+struct ipc_op {
+	uint32_t code;
+	int32_t fd;
+	int32_t arg[4];
+	uint32_t block;		/* wait until the operation would not block */
+	uint32_t retry;		/* retried by the server */
+	uint32_t len;
+	uint32_t addrlen;
+	int64_t ret;
+	int32_t err;
+	union ofp_sockaddr_store addr;
+	uint8_t data[OFP_IPC_DATA_MAX];
+};
+
+struct ofp_ipc_client {
+	int32_t pid;		/* attached process, 0 if free */
+	/* Written by the client */
+	uint32_t sq ODP_ALIGNED_CACHE;
+	/* Written by the server */
+	uint32_t cq ODP_ALIGNED_CACHE;
+	struct ipc_op op[OFP_IPC_RING_SIZE] ODP_ALIGNED_CACHE;
+};
+
+struct ofp_ipc_mem {
+	uint32_t magic;
+	int32_t num_client;
+	/* Server state, not used by the clients */
+	odph_thread_t server;
+	int server_run;
+	int server_started;
+	uint64_t liveness_ns;
+	int socket_max;
+	struct ofp_ipc_client client[] ODP_ALIGNED_CACHE;
+	/* Followed by socket_max + 1 owners: client + 1, 0: none */
+};
+
+static __thread struct ofp_ipc_mem *shm;
+static __thread odp_shm_t ipc_shm_h = ODP_SHM_INVALID;
+
+__thread struct ofp_ipc_client *ofp_ipc_self;
+
+static uint64_t ipc_shm_size(int num_client, int socket_max)
+{
+	return sizeof(struct ofp_ipc_mem) +
+		(uint64_t)num_client * sizeof(struct ofp_ipc_client) +
+		socket_max + 1;
+}
+
+/*
+ * Server
+ */
+
+static uint8_t *ipc_owner(void)
+{
+	return (uint8_t *)&shm->client[shm->num_client];
+}
+
+static int ipc_owned(int client, int fd)
+{
+	return fd >= OFP_SOCK_NUM_OFFSET &&
+		fd <= OFP_SOCK_NUM_OFFSET + shm->socket_max &&
+		ipc_owner()[fd - OFP_SOCK_NUM_OFFSET] == client + 1;
+}
+
+static void ipc_own(int client, int fd)
+{
+	int on = 1;
+
+	ipc_owner()[fd - OFP_SOCK_NUM_OFFSET] = client + 1;
+	/* The server must not block on a socket of a client */
+	ofp_ioctl(fd, OFP_FIONBIO, &on);
+}
+
+static void ipc_close_all(int client)
+{
+	uint8_t *owner = ipc_owner();
+	int i;
+
+	for (i = 0; i <= shm->socket_max; i++) {
+		if (owner[i] != client + 1)
+			continue;
+		owner[i] = 0;
+		ofp_close(i + OFP_SOCK_NUM_OFFSET);
+	}
+}
+
+static struct ofp_sockaddr *ipc_addr(struct ipc_op *op, ofp_socklen_t addrlen)
+{
+	return addrlen ? (struct ofp_sockaddr *)&op->addr : NULL;
+}
+
+/*
+ * Execute an operation, returns 0 if it is to be retried. The client
+ * may write to op at any time, so the fields that are checked are read
+ * once and only the checked copies are used.
+ */
+static int ipc_exec(int client, struct ipc_op *op)
+{
+	uint32_t code = __atomic_load_n(&op->code, __ATOMIC_RELAXED);
+	int fd = __atomic_load_n(&op->fd, __ATOMIC_RELAXED);
+	uint32_t len = __atomic_load_n(&op->len, __ATOMIC_RELAXED);
+	ofp_socklen_t addrlen = __atomic_load_n(&op->addrlen,
+						__ATOMIC_RELAXED);
+	int64_t ret = -1;
+
+	ofp_errno = 0;
+	if (len > OFP_IPC_DATA_MAX || addrlen > sizeof(op->addr)) {
+		ofp_errno = OFP_EINVAL;
+		goto out;
+	}
+	if (code != IPC_SOCKET && code != IPC_DETACH &&
+	    !ipc_owned(client, fd)) {
+		ofp_errno = OFP_EBADF;
+		goto out;
+	}
+
+	switch (code) {
+	case IPC_SOCKET:
+		ret = ofp_socket_vrf(op->arg[0], op->arg[1], op->arg[2],
+				     op->arg[3]);
+		if (ret >= 0)
+			ipc_own(client, ret);
+		break;
+	case IPC_CLOSE:
+		ipc_owner()[fd - OFP_SOCK_NUM_OFFSET] = 0;
+		ret = ofp_close(fd);
+		break;
+	case IPC_SHUTDOWN:
+		ret = ofp_shutdown(fd, op->arg[0]);
+		break;
+	case IPC_BIND:
+		ret = ofp_bind(fd, ipc_addr(op, addrlen), addrlen);
+		break;
+	case IPC_CONNECT:
+		ret = ofp_connect(fd, ipc_addr(op, addrlen), addrlen);
+		if (ret && op->block && (ofp_errno == OFP_EINPROGRESS ||
+					 ofp_errno == OFP_EALREADY)) {
+			op->retry = 1;
+			return 0;
+		}
+		/* Connected since the first try */
+		if (ret && op->retry && ofp_errno == OFP_EISCONN) {
+			ofp_errno = 0;
+			ret = 0;
+		}
+		goto out;
+	case IPC_LISTEN:
+		ret = ofp_listen(fd, op->arg[0]);
+		break;
+	case IPC_ACCEPT:
+		addrlen = sizeof(op->addr);
+		ret = ofp_accept(fd, (struct ofp_sockaddr *)&op->addr,
+				 &addrlen);
+		op->addrlen = ret >= 0 ? addrlen : 0;
+		if (ret >= 0)
+			ipc_own(client, ret);
+		break;
+	case IPC_SENDTO:
+		ret = ofp_sendto(fd, op->data, len, op->arg[0],
+				 ipc_addr(op, addrlen), addrlen);
+		break;
+	case IPC_RECVFROM:
+		addrlen = sizeof(op->addr);
+		ret = ofp_recvfrom(fd, op->data, len, op->arg[0],
+				   (struct ofp_sockaddr *)&op->addr, &addrlen);
+		op->addrlen = ret >= 0 ? addrlen : 0;
+		break;
+	case IPC_DETACH:
+		ipc_close_all(client);
+		ret = 0;
+		break;
+	default:
+		ofp_errno = OFP_EINVAL;
+	}
+
+	if (ret < 0 && op->block && ofp_errno == OFP_EWOULDBLOCK) {
+		op->retry = 1;
+		return 0;
+	}
+out:
+	op->ret = ret;
+	op->err = ret < 0 ? ofp_errno : 0;
+	return 1;
+}
+
+/* Release the slots of clients that exited without detaching */
+static void ipc_liveness(void)
+{
+	struct ofp_ipc_client *c;
+	int i;
+
+	for (i = 0; i < shm->num_client; i++) {
+		c = &shm->client[i];
+		if (!c->pid || kill(c->pid, 0) == 0 || errno != ESRCH)
+			continue;
+		OFP_INFO("IPC client %d (pid %d) gone, closing its sockets",
+			 i, c->pid);
+		ipc_close_all(i);
+		c->cq = __atomic_load_n(&c->sq, __ATOMIC_ACQUIRE);
+		__atomic_store_n(&c->pid, 0, __ATOMIC_RELEASE);
+	}
+}
+
+/* Run the submitted operations of all clients, returns their number */
+static int ipc_serve(void)
+{
+	struct ofp_ipc_client *c;
+	struct ipc_op *op;
+	uint32_t sq;
+	int i, n = 0;
+
+	for (i = 0; i < shm->num_client; i++) {
+		c = &shm->client[i];
+		if (!__atomic_load_n(&c->pid, __ATOMIC_ACQUIRE))
+			continue;
+
+		sq = __atomic_load_n(&c->sq, __ATOMIC_ACQUIRE);
+		while (c->cq != sq) {
+			op = &c->op[c->cq & (OFP_IPC_RING_SIZE - 1)];
+			if (!ipc_exec(i, op))
+				break;
+			__atomic_store_n(&c->cq, c->cq + 1, __ATOMIC_RELEASE);
+			n++;
+			if (op->code == IPC_DETACH)
+				__atomic_store_n(&c->pid, 0, __ATOMIC_RELEASE);
+		}
+	}
+
+	if (odp_time_local_ns() - shm->liveness_ns >= IPC_LIVENESS_NS) {
+		shm->liveness_ns = odp_time_local_ns();
+		ipc_liveness();
+	}
+
+	return n;
+}
+
+static int ipc_server(void *arg)
+{
+	int idle = 0;
+
+	if (ofp_init_local()) {
+		OFP_ERR("Error: OFP local init failed.");
+		return -1;
+	}
+	shm = arg;
+
+	while (__atomic_load_n(&shm->server_run, __ATOMIC_ACQUIRE)) {
+		if (ipc_serve())
+			idle = 0;
+		else if (++idle > IPC_SERVER_SPIN)
+			usleep(IPC_SERVER_IDLE_US);
+	}
+
+	ofp_term_local();
+	return 0;
+}
+
+int ofp_ipc_start_server(const odp_cpumask_t *cpumask)
+{
+	odph_thread_common_param_t common_param;
+	odph_thread_param_t thr_params;
+
+	if (!shm)
+		return 0;
+
+	odph_thread_common_param_init(&common_param);
+	common_param.cpumask = cpumask;
+	odph_thread_param_init(&thr_params);
+	thr_params.start = ipc_server;
+	thr_params.arg = shm;
+	thr_params.thr_type = ODP_THREAD_CONTROL;
+
+	shm->server_run = 1;
+	if (odph_thread_create(&shm->server, &common_param, &thr_params,
+			       1) != 1) {
+		OFP_ERR("Failed to start IPC server thread.");
+		shm->server_run = 0;
+		return -1;
+	}
+	shm->server_started = 1;
+
+	return 0;
+}
+
+void ofp_ipc_stop_server(void)
+{
+	if (!shm || !shm->server_started)
+		return;
+
+	__atomic_store_n(&shm->server_run, 0, __ATOMIC_RELEASE);
+	odph_thread_join(&shm->server, 1);
+	shm->server_started = 0;
+}
+
+int ofp_ipc_init_global(odp_instance_t instance)
+{
+	int num = global_param->ipc.clients;
+	int socket_max = global_param->socket_max;
+
+	if (num <= 0)
+		return 0;
+	if (num > UINT8_MAX - 1) {
+		OFP_ERR("Too many IPC clients: %d", num);
+		return -1;
+	}
+
+	ipc_shm_h = odp_shm_reserve(SHM_NAME_IPC, ipc_shm_size(num, socket_max),
+				    ODP_CACHE_LINE_SIZE, ODP_SHM_EXPORT);
+	if (ipc_shm_h == ODP_SHM_INVALID) {
+		OFP_ERR("odp_shm_reserve failed");
+		return -1;
+	}
+	shm = odp_shm_addr(ipc_shm_h);
+
+	memset(shm, 0, ipc_shm_size(num, socket_max));
+	shm->num_client = num;
+	shm->socket_max = socket_max;
+	shm->liveness_ns = odp_time_local_ns();
+	__atomic_store_n(&shm->magic, IPC_MAGIC, __ATOMIC_RELEASE);
+
+	OFP_INFO("IPC: %d clients, stack instance %" PRIu64, num,
+		 (uint64_t)instance);
+	return 0;
+}
+
+int ofp_ipc_term_global(void)
+{
+	int rc = 0;
+
+	if (!shm)
+		return 0;
+
+	ofp_ipc_stop_server();
+	shm = NULL;
+	if (odp_shm_free(ipc_shm_h)) {
+		OFP_ERR("odp_shm_free failed");
+		rc = -1;
+	}
+	ipc_shm_h = ODP_SHM_INVALID;
+	return rc;
+}
+
+/*
+ * Client
+ */
+
+int ofp_ipc_attach(odp_instance_t stack, int client)
+{
+	struct ofp_ipc_mem *mem;
+	struct ofp_ipc_client *c;
+	int32_t pid = 0;
+
+	if (ofp_ipc_self) {
+		OFP_ERR("Thread already attached");
+		return -1;
+	}
+
+	ipc_shm_h = odp_shm_import(SHM_NAME_IPC, stack, SHM_NAME_IPC);
+	if (ipc_shm_h == ODP_SHM_INVALID) {
+		OFP_ERR("odp_shm_import failed");
+		return -1;
+	}
+	mem = odp_shm_addr(ipc_shm_h);
+
+	if (!mem || __atomic_load_n(&mem->magic, __ATOMIC_ACQUIRE) !=
+	    IPC_MAGIC || client < 0 || client >= mem->num_client) {
+		OFP_ERR("Invalid IPC client %d", client);
+		goto err;
+	}
+
+	c = &mem->client[client];
+	if (!__atomic_compare_exchange_n(&c->pid, &pid, getpid(), 0,
+					 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		OFP_ERR("IPC client %d in use by pid %d", client, pid);
+		goto err;
+	}
+
+	ofp_ipc_self = c;
+	return 0;
+
+err:
+	odp_shm_free(ipc_shm_h);
+	ipc_shm_h = ODP_SHM_INVALID;
+	return -1;
+}
+
+static struct ipc_op *ipc_op_get(uint32_t code, int fd)
+{
+	struct ofp_ipc_client *c = ofp_ipc_self;
+	struct ipc_op *op = &c->op[c->sq & (OFP_IPC_RING_SIZE - 1)];
+
+	op->code = code;
+	op->fd = fd;
+	op->block = 0;
+	op->retry = 0;
+	op->len = 0;
+	op->addrlen = 0;
+	return op;
+}
+
+static void ipc_addr_set(struct ipc_op *op, const struct ofp_sockaddr *addr,
+			 ofp_socklen_t addrlen)
+{
+	if (!addr || !addrlen)
+		return;
+	if (addrlen > sizeof(op->addr))
+		addrlen = sizeof(op->addr);
+	memcpy(&op->addr, addr, addrlen);
+	op->addrlen = addrlen;
+}
+
+/* Submit the operation at the head and wait for its completion */
+static int64_t ipc_call(struct ipc_op *op)
+{
+	struct ofp_ipc_client *c = ofp_ipc_self;
+	uint32_t sq = c->sq + 1;
+	int spin = 0;
+
+	__atomic_store_n(&c->sq, sq, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&c->cq, __ATOMIC_ACQUIRE) != sq) {
+		if (++spin < IPC_CLIENT_SPIN)
+			odp_cpu_pause();
+		else
+			usleep(IPC_SERVER_IDLE_US);
+	}
+
+	ofp_errno = op->err;
+	return op->ret;
+}
+
+int ofp_ipc_detach(void)
+{
+	if (!ofp_ipc_self)
+		return -1;
+
+	ipc_call(ipc_op_get(IPC_DETACH, -1));
+	ofp_ipc_self = NULL;
+	odp_shm_free(ipc_shm_h);
+	ipc_shm_h = ODP_SHM_INVALID;
+	return 0;
+}
+
+int ofp_ipc_socket(int domain, int type, int protocol, int vrf)
+{
+	struct ipc_op *op = ipc_op_get(IPC_SOCKET, -1);
+
+	op->arg[0] = domain;
+	op->arg[1] = type;
+	op->arg[2] = protocol;
+	op->arg[3] = vrf;
+	return ipc_call(op);
+}
+
+int ofp_ipc_close(int fd)
+{
+	return ipc_call(ipc_op_get(IPC_CLOSE, fd));
+}
+
+int ofp_ipc_shutdown(int fd, int how)
+{
+	struct ipc_op *op = ipc_op_get(IPC_SHUTDOWN, fd);
+
+	op->arg[0] = how;
+	return ipc_call(op);
+}
+
+int ofp_ipc_bind(int fd, const struct ofp_sockaddr *addr,
+		 ofp_socklen_t addrlen)
+{
+	struct ipc_op *op = ipc_op_get(IPC_BIND, fd);
+
+	ipc_addr_set(op, addr, addrlen);
+	return ipc_call(op);
+}
+
+int ofp_ipc_connect(int fd, const struct ofp_sockaddr *addr,
+		    ofp_socklen_t addrlen)
+{
+	struct ipc_op *op = ipc_op_get(IPC_CONNECT, fd);
+
+	op->block = 1;
+	ipc_addr_set(op, addr, addrlen);
+	return ipc_call(op);
+}
+
+int ofp_ipc_listen(int fd, int backlog)
+{
+	struct ipc_op *op = ipc_op_get(IPC_LISTEN, fd);
+
+	op->arg[0] = backlog;
+	return ipc_call(op);
+}
+
+int ofp_ipc_accept(int fd, struct ofp_sockaddr *addr, ofp_socklen_t *addrlen)
+{
+	struct ipc_op *op = ipc_op_get(IPC_ACCEPT, fd);
+	int ret;
+
+	op->block = 1;
+	ret = ipc_call(op);
+	if (ret >= 0 && addr && addrlen) {
+		if (*addrlen > op->addrlen)
+			*addrlen = op->addrlen;
+		memcpy(addr, &op->addr, *addrlen);
+	}
+	return ret;
+}
+
+ofp_ssize_t ofp_ipc_sendto(int fd, const void *buf, size_t len, int flags,
+			   const struct ofp_sockaddr *addr,
+			   ofp_socklen_t addrlen)
+{
+	const uint8_t *p = buf;
+	struct ipc_op *op;
+	ofp_ssize_t sent = 0;
+	int64_t ret;
+
+	do {
+		op = ipc_op_get(IPC_SENDTO, fd);
+		op->block = !(flags & OFP_MSG_DONTWAIT);
+		op->arg[0] = flags | OFP_MSG_DONTWAIT;
+		op->len = len - sent < OFP_IPC_DATA_MAX ?
+			len - sent : OFP_IPC_DATA_MAX;
+		memcpy(op->data, p + sent, op->len);
+		ipc_addr_set(op, addr, addrlen);
+
+		ret = ipc_call(op);
+		if (ret < 0)
+			return sent ? sent : -1;
+		sent += ret;
+	} while ((size_t)sent < len && ret == op->len);
+
+	if (sent)
+		ofp_errno = 0;
+	return sent;
+}
+
+ofp_ssize_t ofp_ipc_recvfrom(int fd, void *buf, size_t len, int flags,
+			     struct ofp_sockaddr *addr,
+			     ofp_socklen_t *addrlen)
+{
+	struct ipc_op *op = ipc_op_get(IPC_RECVFROM, fd);
+	int64_t ret;
+
+	op->block = !(flags & OFP_MSG_DONTWAIT);
+	op->arg[0] = flags | OFP_MSG_DONTWAIT;
+	op->len = len < OFP_IPC_DATA_MAX ? len : OFP_IPC_DATA_MAX;
+
+	ret = ipc_call(op);
+	if (ret > 0)
+		memcpy(buf, op->data, ret);
+	if (ret >= 0 && addr && addrlen) {
+		if (*addrlen > op->addrlen)
+			*addrlen = op->addrlen;
+		memcpy(addr, &op->addr, *addrlen);
+	}
+	return ret;
+}
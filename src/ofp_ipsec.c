@@ -17,10 +17,25 @@
 #include "ofpi_ipsec.h"
 #include "ofpi_ipsec_spd.h"
 #include "ofpi_ipsec_sad.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_portconf.h"
+#include "ofpi_tracepoint.h"
 
 #define SHM_NAME_IPSEC "ofp_ipsec"
 __thread struct ofp_ipsec *ofp_ipsec_shm;
 
+/*
+ * Packets collected for asynchronous ODP IPsec processing, see
+ * ofp_ipsec_param_t.burst_size. Outbound packets hold a reference to
+ * their SA until they are submitted.
+ */
+__thread int ofp_ipsec_pending;
+static __thread odp_packet_t in_burst[OFP_IPSEC_BURST_MAX];
+static __thread int in_burst_cnt;
+static __thread odp_packet_t out_burst[OFP_IPSEC_BURST_MAX];
+static __thread ofp_ipsec_sa_handle out_burst_sa[OFP_IPSEC_BURST_MAX];
+static __thread int out_burst_cnt;
+
 static int ipsec_sa_flush(int check_vrf, uint16_t vrf);
 static int ipsec_sp_flush(int check_vrf, uint16_t vrf);
 
@@ -65,6 +80,7 @@ void ofp_ipsec_param_init(struct ofp_ipsec_param *param)
 	param->max_num_sp = OFP_IPSEC_MAX_NUM_SP;
 	param->max_num_sa = OFP_IPSEC_MAX_NUM_SA;
 	param->max_inbound_spi = OFP_IPSEC_MAX_INBOUND_SPI;
+	param->burst_size = OFP_IPSEC_BURST_SIZE;
 	param->inbound_queue = ODP_QUEUE_INVALID;
 	param->outbound_queue = ODP_QUEUE_INVALID;
 }
@@ -176,6 +192,12 @@ int ofp_ipsec_init_global(const struct ofp_ipsec_param *param)
 	uint32_t max_num_sa = param->max_num_sa;
 	uint32_t max_num_sp = param->max_num_sp;
 
+	if (param->burst_size < 1 || param->burst_size > OFP_IPSEC_BURST_MAX) {
+		OFP_ERR("IPsec burst size must be between 1 and %d",
+			OFP_IPSEC_BURST_MAX);
+		return -1;
+	}
+
 	if (odp_ipsec_capability(&capa)) {
 		OFP_ERR("odp_ipsec_capability failed");
 		OFP_ERR("Setting maximum number of IPsec SAs to zero");
@@ -190,13 +212,6 @@ int ofp_ipsec_init_global(const struct ofp_ipsec_param *param)
 	}
 #endif
 
-	if (max_num_sa > 0 &&
-	    (param->inbound_op_mode == ODP_IPSEC_OP_MODE_INLINE ||
-	     param->outbound_op_mode == ODP_IPSEC_OP_MODE_INLINE)) {
-		OFP_ERR("Inline IPsec operation mode is not supported");
-		return -1;
-	}
-
 	if (max_num_sa > 0 &&
 	    (!op_mode_supported_by_odp(param->inbound_op_mode, &capa, 0) ||
 	     !op_mode_supported_by_odp(param->outbound_op_mode, &capa, 1))) {
@@ -273,6 +288,7 @@ int ofp_ipsec_init_global(const struct ofp_ipsec_param *param)
 	odp_atomic_init_u32(&ofp_ipsec_shm->ipsec_active, 0);
 	ofp_brlock_init(&ofp_ipsec_shm->processing_lock);
 	ofp_ipsec_shm->max_num_sa = max_num_sa;
+	ofp_ipsec_shm->burst_size = param->burst_size;
 	ofp_ipsec_shm->inbound_op_mode = param->inbound_op_mode;
 	ofp_ipsec_shm->outbound_op_mode = param->outbound_op_mode;
 	ofp_ipsec_shm->in_queue = in_queue;
@@ -305,6 +321,122 @@ int ofp_ipsec_init_local(void)
 	return 0;
 }
 
+void ofp_ipsec_pktio_config(const char *if_name,
+			    const odp_pktio_capability_t *capa,
+			    odp_pktio_config_t *config)
+{
+	if (!ofp_ipsec_shm || ofp_ipsec_shm->max_num_sa == 0)
+		return;
+
+	if (ofp_ipsec_shm->inbound_op_mode == ODP_IPSEC_OP_MODE_INLINE) {
+		if (capa->config.inbound_ipsec)
+			config->inbound_ipsec = 1;
+		else
+			OFP_INFO("Interface '%s' does not support inline "
+				 "IPsec input", if_name);
+	}
+	if (ofp_ipsec_shm->outbound_op_mode == ODP_IPSEC_OP_MODE_INLINE) {
+		if (capa->config.outbound_ipsec)
+			config->outbound_ipsec = 1;
+		else
+			OFP_INFO("Interface '%s' does not support inline "
+				 "IPsec output", if_name);
+	}
+}
+
+static void in_burst_submit(void)
+{
+	odp_ipsec_in_param_t param = {.num_sa = 0}; /* offload SA lookup */
+	int n = 0;
+	int ret;
+
+	OFP_TRACEPOINT(ipsec_submit, 0, in_burst_cnt);
+	while (n < in_burst_cnt) {
+		ret = odp_ipsec_in_enq(&in_burst[n], in_burst_cnt - n, &param);
+		if (odp_unlikely(ret <= 0)) {
+			OFP_ERR("odp_ipsec_in_enq() failed: %d", ret);
+			odp_packet_free_multi(&in_burst[n], in_burst_cnt - n);
+			break;
+		}
+		n += ret;
+	}
+	in_burst_cnt = 0;
+}
+
+/*
+ * Submit the collected outbound packets. Must be called with the
+ * processing lock held so that the SAs found enabled stay so until
+ * the packets are with ODP.
+ */
+static void out_burst_submit(void)
+{
+	odp_ipsec_out_param_t param = {0};
+	odp_ipsec_sa_t odp_sa[OFP_IPSEC_BURST_MAX];
+	odp_packet_t pkt[OFP_IPSEC_BURST_MAX];
+	int num = 0;
+	int n = 0;
+	int ret;
+	int i;
+
+	for (i = 0; i < out_burst_cnt; i++) {
+		if (odp_unlikely(ofp_ipsec_sa_disabled(out_burst_sa[i]))) {
+			odp_packet_free(out_burst[i]);
+			continue;
+		}
+		pkt[num] = out_burst[i];
+		odp_sa[num] = ofp_ipsec_sa_get_odp_sa(out_burst_sa[i]);
+		num++;
+	}
+
+	OFP_TRACEPOINT(ipsec_submit, 1, num);
+	while (n < num) {
+		param.num_sa = num - n;
+		param.sa = &odp_sa[n];
+		ret = odp_ipsec_out_enq(&pkt[n], num - n, &param);
+		if (odp_unlikely(ret <= 0)) {
+			OFP_ERR("odp_ipsec_out_enq() failed: %d", ret);
+			odp_packet_free_multi(&pkt[n], num - n);
+			break;
+		}
+		n += ret;
+	}
+
+	for (i = 0; i < out_burst_cnt; i++)
+		ofp_ipsec_sa_unref(out_burst_sa[i]);
+	out_burst_cnt = 0;
+}
+
+void ofp_ipsec_flush(void)
+{
+	ofp_ipsec_sa_stat_flush();
+
+	if (in_burst_cnt)
+		in_burst_submit();
+
+	if (out_burst_cnt) {
+		ofp_brlock_read_lock(&ofp_ipsec_shm->processing_lock);
+		out_burst_submit();
+		ofp_brlock_read_unlock(&ofp_ipsec_shm->processing_lock);
+	}
+	ofp_ipsec_pending = 0;
+}
+
+int ofp_ipsec_term_local(void)
+{
+	int i;
+
+	odp_packet_free_multi(in_burst, in_burst_cnt);
+	in_burst_cnt = 0;
+
+	odp_packet_free_multi(out_burst, out_burst_cnt);
+	for (i = 0; i < out_burst_cnt; i++)
+		ofp_ipsec_sa_unref(out_burst_sa[i]);
+	out_burst_cnt = 0;
+
+	ofp_ipsec_pending = 0;
+	return 0;
+}
+
 int ofp_ipsec_stop_global(void)
 {
 	(void) ipsec_sp_flush(0, 0);
@@ -370,6 +502,14 @@ enum ofp_return_code ofp_ipsec_input(odp_packet_t *pkt, int off)
 	 * Async processing in async and inline mode
 	 */
 	if (ofp_ipsec_shm->inbound_op_mode != ODP_IPSEC_OP_MODE_SYNC) {
+		if (ofp_ipsec_shm->burst_size > 1) {
+			in_burst[in_burst_cnt++] = *pkt;
+			ofp_ipsec_pending = 1;
+			if (in_burst_cnt >= (int)ofp_ipsec_shm->burst_size)
+				in_burst_submit();
+			return OFP_PKT_PROCESSED;
+		}
+		OFP_TRACEPOINT(ipsec_submit, 0, 1);
 		ret = odp_ipsec_in_enq(pkt, 1, &param);
 		if (odp_unlikely(ret <= 0)) {
 			OFP_ERR("odp_ipsec_in_enq() failed: %d", ret);
@@ -409,7 +549,20 @@ static enum ofp_return_code ipsec_input_continue(odp_packet_t *pktp,
 	ofp_ipsec_mode_t  mode = sa_param->mode;
 	ofp_ipsec_selectors_t *sel;
 	struct ofp_ifnet *ifnet = odp_packet_user_ptr(pkt);
-	uint16_t vrf = ifnet ? ifnet->vrf : 0;
+	uint16_t vrf;
+
+	/*
+	 * Inline processed packets come from the interface without
+	 * passing OFP packet input.
+	 */
+	if (ifnet == NULL &&
+	    ofp_ipsec_shm->inbound_op_mode == ODP_IPSEC_OP_MODE_INLINE &&
+	    odp_packet_input(pkt) != ODP_PKTIO_INVALID) {
+		ifnet = ofp_get_ifnet_pktio(odp_packet_input(pkt));
+		ofp_packet_user_area_reset(pkt);
+		odp_packet_user_ptr_set(pkt, ifnet);
+	}
+	vrf = ifnet ? ifnet->vrf : 0;
 
 	/*
 	 * Drop the decapsulated packet if it does not match the policy
@@ -427,6 +580,8 @@ static enum ofp_return_code ipsec_input_continue(odp_packet_t *pktp,
 	if (odp_unlikely(vrf != sa_param->vrf))
 		return OFP_PKT_DROP;
 
+	ofp_ipsec_sa_stat_count(sa, odp_packet_len(pkt));
+	ofp_ipsec_pending = 1;
 	ofp_ipsec_flags_set(pkt, OFP_IPSEC_INBOUND_DONE);
 
 	if (*lock_held) {
@@ -452,6 +607,42 @@ static enum ofp_return_code ipsec_input_continue(odp_packet_t *pktp,
 	return OFP_PKT_DROP;
 }
 
+/*
+ * Return nonzero if the packet was not consumed
+ */
+static int ipsec_output_inline(odp_packet_t pkt,
+			       const ofp_ipsec_sa_param_t *sa_param,
+			       const odp_ipsec_out_param_t *param)
+{
+	struct ofp_ifnet *send_ctx = odp_packet_user_ptr(pkt);
+	odp_ipsec_out_inline_param_t inline_param;
+	struct ofp_flow_cache_entry *fc;
+	struct ofp_ifnet *port;
+	int ret;
+
+	/* Same key as in ofp_ip_output_ipsec() that fills the entry */
+	fc = ofp_flow_cache_lookup(send_ctx ? send_ctx->vrf : 0,
+				   sa_param->tunnel.ipv4.dst_addr.s_addr);
+	if (!fc || !ofp_flow_cache_hit(fc))
+		return -1;
+
+	port = ofp_get_ifnet(fc->dev_out->port, 0);
+	if (odp_unlikely(!port || port->pktio == ODP_PKTIO_INVALID))
+		return -1;
+
+	inline_param.pktio = port->pktio;
+	inline_param.outer_hdr.ptr = fc->l2;
+	inline_param.outer_hdr.len = fc->l2_len;
+
+	OFP_TRACEPOINT(ipsec_submit, 1, 1);
+	ret = odp_ipsec_out_inline(&pkt, 1, param, &inline_param);
+	if (odp_unlikely(ret <= 0)) {
+		OFP_ERR("odp_ipsec_out_inline() failed: %d", ret);
+		odp_packet_free(pkt);
+	}
+	return 0;
+}
+
 static enum ofp_return_code ipsec_output(odp_packet_t pkt,
 					 ofp_ipsec_sa_handle sa,
 					 int *lock_held)
@@ -470,10 +661,34 @@ static enum ofp_return_code ipsec_output(odp_packet_t pkt,
 	param.num_sa = 1;
 	param.sa = &odp_sa;
 
+	ofp_ipsec_sa_stat_count(sa, odp_packet_len(pkt));
+	ofp_ipsec_pending = 1;
+
+	/*
+	 * Inline processing of tunnel mode SAs whose endpoint is in the
+	 * flow cache of the thread. The encapsulated packet goes from ODP
+	 * directly to the interface with the cached Ethernet header.
+	 */
+	if (ofp_ipsec_shm->outbound_op_mode == ODP_IPSEC_OP_MODE_INLINE &&
+	    sa_param->mode == OFP_IPSEC_MODE_TUNNEL &&
+	    ipsec_output_inline(pkt, sa_param, &param) == 0)
+		return OFP_PKT_PROCESSED;
+
 	/*
 	 * Async and inline processing
 	 */
 	if (ofp_ipsec_shm->outbound_op_mode != ODP_IPSEC_OP_MODE_SYNC) {
+		if (ofp_ipsec_shm->burst_size > 1) {
+			ofp_ipsec_sa_ref(sa);
+			out_burst[out_burst_cnt] = pkt;
+			out_burst_sa[out_burst_cnt++] = sa;
+			ofp_ipsec_pending = 1;
+			/* The caller holds the processing lock */
+			if (out_burst_cnt >= (int)ofp_ipsec_shm->burst_size)
+				out_burst_submit();
+			return OFP_PKT_PROCESSED;
+		}
+		OFP_TRACEPOINT(ipsec_submit, 1, 1);
 		ret = odp_ipsec_out_enq(&pkt, 1, &param);
 		if (odp_unlikely(ret <= 0)) {
 			OFP_ERR("odp_ipsec_out_enq() failed: %d", ret);
@@ -504,7 +719,7 @@ static enum ofp_return_code ipsec_output_continue(odp_packet_t pkt)
 		 * IP ID and header checksum have now been set by ODP.
 		 * Output the packet without rewriting them.
 		 */
-		return ofp_ip_output_common(pkt, NULL, 0, OFP_IPSEC_SA_INVALID);
+		return ofp_ip_output_ipsec(pkt);
 	} else
 		OFP_ERR("Non-IPv4 packet after IPsec encapsulation");
 
@@ -521,6 +736,22 @@ void ofp_ipsec_packet_event(odp_event_t ev, odp_queue_t queue)
 	process_result_packet(pkt, &lock_held);
 }
 
+void ofp_ipsec_packet_event_multi(odp_event_t ev[], int num,
+				  odp_queue_t queue)
+{
+	odp_packet_t pkt[num];
+	int lock_held = 0;
+	int i;
+
+	(void) queue;
+	for (i = 0; i < num; i++) {
+		pkt[i] = odp_ipsec_packet_from_event(ev[i]);
+		odp_packet_prefetch(pkt[i], 0, ODP_CACHE_LINE_SIZE);
+	}
+	for (i = 0; i < num; i++)
+		process_result_packet(pkt[i], &lock_held);
+}
+
 static void process_result_packet(odp_packet_t pkt, int *lock_held)
 {
 	odp_ipsec_packet_result_t result;
@@ -558,6 +789,8 @@ static enum ofp_return_code process_result(odp_packet_t *pkt_ptr,
 	ofp_ipsec_sa_handle sa;
 	uint32_t garbage_len;
 
+	OFP_TRACEPOINT(ipsec_complete, odp_packet_to_u64(pkt),
+		       status.error.all);
 	if (odp_unlikely(status.error.all))
 		return OFP_PKT_DROP;
 
@@ -580,13 +813,10 @@ static enum ofp_return_code process_result(odp_packet_t *pkt_ptr,
 	}
 	odp_packet_l2_offset_set(pkt, 0);
 
-	/*
-	 * OFP does not support segmented packets
-	 */
-	if (odp_unlikely(odp_packet_is_segmented(pkt))) {
-		OFP_ERR("Got segmented packet from ODP IPsec, giving up\n");
+	/* The headers are accessed through pointers */
+	if (odp_unlikely(ofp_packet_pullup(&pkt, 0, OFP_PKT_PULLUP_LEN)))
 		return OFP_PKT_DROP;
-	}
+	*pkt_ptr = pkt;
 
 	if (ret == OFP_PKT_CONTINUE) {
 		sa_param = ofp_ipsec_sa_get_param(sa);
@@ -619,8 +849,10 @@ ofp_ipsec_sp_handle ofp_ipsec_sp_create(const ofp_ipsec_sp_param_t *param)
 		ofp_ipsec_sp_lookup_add_sp(sp);
 
 		active = odp_atomic_load_u32(&ofp_ipsec_shm->ipsec_active);
-		if (!active)
+		if (!active) {
 			odp_atomic_store_u32(&ofp_ipsec_shm->ipsec_active, 1);
+			ofp_ip4_feat_update(0);
+		}
 
 		ofp_brlock_write_unlock(&ofp_ipsec_shm->processing_lock);
 	}
@@ -648,8 +880,10 @@ int ofp_ipsec_sp_destroy(ofp_ipsec_sp_handle sp)
 		ofp_brlock_write_unlock(&ofp_ipsec_shm->processing_lock);
 		return -1;
 	}
-	if (empty)
+	if (empty) {
 		odp_atomic_store_u32(&ofp_ipsec_shm->ipsec_active, 0);
+		ofp_ip4_feat_update(0);
+	}
 
 	ofp_brlock_write_unlock(&ofp_ipsec_shm->processing_lock);
 	ofp_ipsec_sa_unref(sa);
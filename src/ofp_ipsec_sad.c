@@ -13,6 +13,8 @@
 #include "ofpi_in.h"
 #include "ofpi_ip.h"
 #include "ofpi_shared_mem.h"
+#include "ofpi_hash.h"
+#include "ofpi_lockstat.h"
 #include "ofpi_ipsec_sad.h"
 
 struct ofp_ipsec_sad {
@@ -21,6 +23,9 @@ struct ofp_ipsec_sad {
 	odp_queue_t outbound_queue;
 	struct ofp_ipsec_sa *sa_list;
 	struct ofp_ipsec_sa *free_sa_list;
+	uint32_t sa_high;		/* never used SAs from here on */
+	uint32_t max_num_sa;
+	uint32_t hash_mask;
 };
 
 struct ofp_ipsec_sa {
@@ -29,9 +34,26 @@ struct ofp_ipsec_sa {
 	ofp_ipsec_sa_param_t param;
 	odp_atomic_u32_t selectors_set;  /* Selectors field has been set */
 	ofp_ipsec_selectors_t selectors; /* For inbound SAs */
-	uint32_t refcount;
+	odp_atomic_u32_t refcount;
 	int destroyed;		     /* SA has been destroyed */
+	uint32_t gen;		     /* incremented when the SA is reused */
+	odp_atomic_u64_t packets;    /* see ofp_ipsec_sa_stat_count() */
+	odp_atomic_u64_t bytes;
 	struct ofp_ipsec_sa *next;   /* next SA in a linked list */
+	struct ofp_ipsec_sa **prev_link; /* link to this SA in sa_list */
+	struct ofp_ipsec_sa *next_by_id;  /* hash chain by ID */
+	struct ofp_ipsec_sa *next_by_spi; /* hash chain by inbound SPI */
+};
+
+/*
+ * The SAs of the SAD are hashed by ID and inbound SAs also by SPI. The
+ * SPI is global since the offloaded ODP lookup does not know VRFs or
+ * destination addresses. The tables are modified and searched with
+ * the SAD lock held.
+ */
+struct ofp_ipsec_sa_hash {
+	struct ofp_ipsec_sa *by_id;
+	struct ofp_ipsec_sa *by_spi;
 };
 
 #define SHM_NAME_IPSEC_SAD "ofp_ipsec_sad"
@@ -40,6 +62,27 @@ static __thread struct ofp_ipsec_sad *shm;
 #define SHM_NAME_IPSEC_SA_TABLE "ofp_ipsec_sa_table"
 static __thread struct ofp_ipsec_sa *shm_sa_table;
 
+#define SHM_NAME_IPSEC_SA_HASH "ofp_ipsec_sa_hash"
+static __thread struct ofp_ipsec_sa_hash *shm_sa_hash;
+
+/*
+ * SA packet and byte counts of a thread not yet added to the SAs. A
+ * slot is flushed when it is needed for another SA, when it has
+ * SA_STAT_BATCH packets or on ofp_ipsec_sa_stat_flush(). The SA
+ * generation keeps a late flush from counting to a reused SA.
+ */
+#define SA_STAT_SLOTS 16
+#define SA_STAT_BATCH 64
+
+struct sa_stat_slot {
+	struct ofp_ipsec_sa *sa;
+	uint32_t gen;
+	uint32_t packets;
+	uint64_t bytes;
+};
+
+static __thread struct sa_stat_slot sa_stat[SA_STAT_SLOTS];
+
 static struct ofp_ipsec_sa *sa_find_by_id(uint32_t id);
 static int sa_init(struct ofp_ipsec_sa *sa, const ofp_ipsec_sa_param_t *param);
 static struct ofp_ipsec_sa *sa_in_lookup(uint32_t spi);
@@ -58,9 +101,12 @@ static struct ofp_ipsec_sa *sa_alloc(void)
 	struct ofp_ipsec_sa *sa;
 
 	sa = shm->free_sa_list;
-	if (sa) {
+	if (sa)
 		shm->free_sa_list = sa->next;
-		sa->refcount = 1;
+	else if (shm->sa_high < shm->max_num_sa)
+		sa = &shm_sa_table[shm->sa_high++];
+	if (sa) {
+		odp_atomic_init_u32(&sa->refcount, 1);
 	}
 	return sa;
 }
@@ -71,30 +117,72 @@ static void sa_free(struct ofp_ipsec_sa *sa)
 	shm->free_sa_list = sa;
 }
 
+/*
+ * Reference counts are atomic so that taking and releasing a reference
+ * does not need the SAD lock. Only the release of the last reference
+ * takes the lock to return the SA to the free list.
+ */
 static void sa_ref(struct ofp_ipsec_sa *sa)
 {
 	if (sa)
-		sa->refcount++;
+		odp_atomic_inc_u32(&sa->refcount);
 }
 
+/* Called with the SAD lock held */
 static void sa_unref(struct ofp_ipsec_sa *sa)
 {
-	if (sa && --sa->refcount == 0)
+	if (sa && odp_atomic_fetch_dec_u32(&sa->refcount) == 1)
 		sa_free(sa);
 }
 
 void ofp_ipsec_sa_ref(struct ofp_ipsec_sa *sa)
 {
-	odp_rwlock_write_lock(&shm->lock);
 	sa_ref(sa);
-	odp_rwlock_write_unlock(&shm->lock);
 }
 
 void ofp_ipsec_sa_unref(struct ofp_ipsec_sa *sa)
 {
-	odp_rwlock_write_lock(&shm->lock);
-	sa_unref(sa);
-	odp_rwlock_write_unlock(&shm->lock);
+	if (sa && odp_atomic_fetch_dec_u32(&sa->refcount) == 1) {
+		ofp_rwlock_write_lock(&shm->lock);
+		sa_free(sa);
+		odp_rwlock_write_unlock(&shm->lock);
+	}
+}
+
+static inline struct ofp_ipsec_sa_hash *sa_hash(uint32_t key)
+{
+	return &shm_sa_hash[ofp_hash_key(&key, 1, 0) & shm->hash_mask];
+}
+
+static void sa_hash_add(struct ofp_ipsec_sa *sa)
+{
+	struct ofp_ipsec_sa_hash *h = sa_hash(sa->param.id);
+
+	sa->next_by_id = h->by_id;
+	h->by_id = sa;
+
+	if (sa->param.dir == OFP_IPSEC_DIR_INBOUND) {
+		h = sa_hash(sa->param.spi);
+		sa->next_by_spi = h->by_spi;
+		h->by_spi = sa;
+	}
+}
+
+static void sa_hash_del(struct ofp_ipsec_sa *sa)
+{
+	struct ofp_ipsec_sa **link;
+
+	link = &sa_hash(sa->param.id)->by_id;
+	while (*link != sa)
+		link = &(*link)->next_by_id;
+	*link = sa->next_by_id;
+
+	if (sa->param.dir == OFP_IPSEC_DIR_INBOUND) {
+		link = &sa_hash(sa->param.spi)->by_spi;
+		while (*link != sa)
+			link = &(*link)->next_by_spi;
+		*link = sa->next_by_spi;
+	}
 }
 
 static uint64_t sa_table_size(uint32_t max_num_sa)
@@ -102,19 +190,34 @@ static uint64_t sa_table_size(uint32_t max_num_sa)
 	return sizeof(*shm_sa_table) * max_num_sa;
 }
 
+/* Power of two, at least max_num_sa */
+static uint32_t sa_hash_buckets(uint32_t max_num_sa)
+{
+	uint32_t n = 1;
+
+	while (n < max_num_sa)
+		n <<= 1;
+	return n;
+}
+
+static uint64_t sa_hash_size(uint32_t max_num_sa)
+{
+	return sizeof(*shm_sa_hash) * sa_hash_buckets(max_num_sa);
+}
+
 void ofp_ipsec_sad_init_prepare(uint32_t max_num_sa)
 {
 	ofp_shared_memory_prealloc(SHM_NAME_IPSEC_SAD, sizeof(*shm));
 	ofp_shared_memory_prealloc(SHM_NAME_IPSEC_SA_TABLE,
 				   sa_table_size(max_num_sa));
+	ofp_shared_memory_prealloc(SHM_NAME_IPSEC_SA_HASH,
+				   sa_hash_size(max_num_sa));
 }
 
 int ofp_ipsec_sad_init_global(uint32_t max_num_sa,
 			      odp_queue_t inbound_queue,
 			      odp_queue_t outbound_queue)
 {
-	uint32_t n;
-
 	shm = ofp_shared_memory_alloc(SHM_NAME_IPSEC_SAD, sizeof(*shm));
 	if (!shm) {
 		OFP_ERR("Failed to allocate IPsec SAD shared memory");
@@ -125,6 +228,7 @@ int ofp_ipsec_sad_init_global(uint32_t max_num_sa,
 	shm->free_sa_list = NULL;
 	shm->inbound_queue = inbound_queue;
 	shm->outbound_queue = outbound_queue;
+	shm->hash_mask = sa_hash_buckets(max_num_sa) - 1;
 
 	shm_sa_table = ofp_shared_memory_alloc(SHM_NAME_IPSEC_SA_TABLE,
 					       sa_table_size(max_num_sa));
@@ -133,8 +237,19 @@ int ofp_ipsec_sad_init_global(uint32_t max_num_sa,
 		ofp_shared_memory_free(SHM_NAME_IPSEC_SAD);
 		return -1;
 	}
-	for (n = 0; n < max_num_sa; n++)
-		sa_free(&shm_sa_table[n]);
+	/* The free list grows as SAs are released, see sa_alloc() */
+	shm->sa_high = 0;
+	shm->max_num_sa = max_num_sa;
+
+	shm_sa_hash = ofp_shared_memory_alloc(SHM_NAME_IPSEC_SA_HASH,
+					      sa_hash_size(max_num_sa));
+	if (!shm_sa_hash) {
+		OFP_ERR("shared memory allocation for SA hash failed");
+		ofp_shared_memory_free(SHM_NAME_IPSEC_SA_TABLE);
+		ofp_shared_memory_free(SHM_NAME_IPSEC_SAD);
+		return -1;
+	}
+	memset(shm_sa_hash, 0, sa_hash_size(max_num_sa));
 	return 0;
 }
 
@@ -150,6 +265,11 @@ int ofp_ipsec_sad_init_local(void)
 		OFP_ERR("Failed to lookup IPsec SA table shared memory");
 		return -1;
 	}
+	shm_sa_hash = ofp_shared_memory_lookup(SHM_NAME_IPSEC_SA_HASH);
+	if (!shm_sa_hash) {
+		OFP_ERR("Failed to lookup IPsec SA hash shared memory");
+		return -1;
+	}
 	return 0;
 }
 
@@ -157,6 +277,7 @@ int ofp_ipsec_sad_term_global(void)
 {
 	ofp_shared_memory_free(SHM_NAME_IPSEC_SAD);
 	ofp_shared_memory_free(SHM_NAME_IPSEC_SA_TABLE);
+	ofp_shared_memory_free(SHM_NAME_IPSEC_SA_HASH);
 	return 0;
 }
 
@@ -263,6 +384,9 @@ static int sa_init(struct ofp_ipsec_sa *sa,
 	odp_atomic_store_u32(&sa->disabled, 0);
 	odp_atomic_store_u32(&sa->selectors_set, 0);
 	sa->destroyed = 0;
+	sa->gen++;
+	odp_atomic_init_u64(&sa->packets, 0);
+	odp_atomic_init_u64(&sa->bytes, 0);
 
 	odp_mb_full();
 
@@ -273,7 +397,11 @@ static int sa_init(struct ofp_ipsec_sa *sa,
 	}
 
 	sa->next = shm->sa_list;
+	if (sa->next)
+		sa->next->prev_link = &sa->next;
+	sa->prev_link = &shm->sa_list;
 	shm->sa_list = sa;
+	sa_hash_add(sa);
 	return 0;
 }
 
@@ -286,7 +414,7 @@ ofp_ipsec_sa_handle ofp_ipsec_sa_create(const ofp_ipsec_sa_param_t *param)
 {
 	struct ofp_ipsec_sa *sa;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sa = sa_alloc();
 	if (!sa) {
 		OFP_ERR("Out of free IPsec SAs");
@@ -309,7 +437,7 @@ ofp_ipsec_sa_handle ofp_ipsec_sa_create(const ofp_ipsec_sa_param_t *param)
 
 int ofp_ipsec_sa_disable(struct ofp_ipsec_sa *sa)
 {
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 
 	if (odp_atomic_load_u32(&sa->disabled)) {
 		OFP_ERR("Disabling SA that has already been disabled");
@@ -355,27 +483,20 @@ int ofp_ipsec_sa_disable_finish(struct ofp_ipsec_sa *sa)
 
 int ofp_ipsec_sa_destroy_finish(struct ofp_ipsec_sa *sa)
 {
-	struct ofp_ipsec_sa **link;
-	int found = 0;
-
-	odp_rwlock_write_lock(&shm->lock);
-
-	link = &shm->sa_list;
-	while (*link) {
-		if (*link == sa) {
-			found = 1;
-			*link = sa->next;
-			break;
-		}
-		link = &(*link)->next;
-	}
+	ofp_rwlock_write_lock(&shm->lock);
 
-	if (!found) {
+	if (sa->destroyed || sa->prev_link == NULL) {
 		odp_rwlock_write_unlock(&shm->lock);
 		OFP_ERR("IPsec SA destroy failed. Could not find the SA.");
 		return -1;
 	}
 
+	*sa->prev_link = sa->next;
+	if (sa->next)
+		sa->next->prev_link = sa->prev_link;
+	sa->prev_link = NULL;
+	sa_hash_del(sa);
+
 	if (odp_ipsec_sa_destroy(sa->odp_sa)) {
 		OFP_ERR("odp_ipsec_sa_destroy() failed");
 		odp_rwlock_write_unlock(&shm->lock);
@@ -397,7 +518,7 @@ ofp_ipsec_sa_handle ofp_ipsec_sa_first(void)
 {
 	ofp_ipsec_sa_handle sa;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sa = shm->sa_list;
 	sa_ref(sa);
 	odp_rwlock_write_unlock(&shm->lock);
@@ -408,7 +529,7 @@ ofp_ipsec_sa_handle ofp_ipsec_sa_next(ofp_ipsec_sa_handle sa)
 {
 	ofp_ipsec_sa_handle next;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	next = sa->next;
 	sa_ref(next);
 	sa_unref(sa);
@@ -418,7 +539,7 @@ ofp_ipsec_sa_handle ofp_ipsec_sa_next(ofp_ipsec_sa_handle sa)
 
 void ofp_ipsec_sa_get_info(ofp_ipsec_sa_handle sa, ofp_ipsec_sa_info_t *info)
 {
-	odp_rwlock_read_lock(&shm->lock);
+	ofp_rwlock_read_lock(&shm->lock);
 	if (sa->destroyed)
 		info->status = OFP_IPSEC_SA_DESTROYED;
 	else if (odp_atomic_load_u32(&sa->disabled))
@@ -427,31 +548,65 @@ void ofp_ipsec_sa_get_info(ofp_ipsec_sa_handle sa, ofp_ipsec_sa_info_t *info)
 		info->status = OFP_IPSEC_SA_ACTIVE;
 	odp_rwlock_read_unlock(&shm->lock);
 	info->param = sa->param;
+	info->packets = odp_atomic_load_u64(&sa->packets);
+	info->bytes = odp_atomic_load_u64(&sa->bytes);
+}
+
+static void sa_stat_slot_flush(struct sa_stat_slot *s)
+{
+	if (s->packets && s->sa->gen == s->gen) {
+		odp_atomic_add_u64(&s->sa->packets, s->packets);
+		odp_atomic_add_u64(&s->sa->bytes, s->bytes);
+	}
+	s->packets = 0;
+	s->bytes = 0;
+}
+
+void ofp_ipsec_sa_stat_count(struct ofp_ipsec_sa *sa, uint32_t bytes)
+{
+	struct sa_stat_slot *s = &sa_stat[(sa - shm_sa_table) &
+					  (SA_STAT_SLOTS - 1)];
+
+	if (odp_unlikely(s->sa != sa || s->gen != sa->gen)) {
+		if (s->sa)
+			sa_stat_slot_flush(s);
+		s->sa = sa;
+		s->gen = sa->gen;
+	}
+	s->bytes += bytes;
+	if (++s->packets >= SA_STAT_BATCH)
+		sa_stat_slot_flush(s);
+}
+
+void ofp_ipsec_sa_stat_flush(void)
+{
+	int i;
+
+	for (i = 0; i < SA_STAT_SLOTS; i++)
+		if (sa_stat[i].packets)
+			sa_stat_slot_flush(&sa_stat[i]);
 }
 
 static struct ofp_ipsec_sa *sa_in_lookup(uint32_t spi)
 {
-	struct ofp_ipsec_sa *sa = shm->sa_list;
+	struct ofp_ipsec_sa *sa = sa_hash(spi)->by_spi;
 
 	while (sa) {
-		if (sa->param.dir == OFP_IPSEC_DIR_INBOUND &&
-		    sa->param.spi == spi) {
+		if (sa->param.spi == spi)
 			break;
-		}
-		sa = sa->next;
+		sa = sa->next_by_spi;
 	}
 	return sa;
 }
 
 static struct ofp_ipsec_sa *sa_find_by_id(uint32_t id)
 {
-	struct ofp_ipsec_sa *sa = shm->sa_list;
+	struct ofp_ipsec_sa *sa = sa_hash(id)->by_id;
 
 	while (sa) {
-		if (sa->param.id == id) {
+		if (sa->param.id == id)
 			break;
-		}
-		sa = sa->next;
+		sa = sa->next_by_id;
 	}
 	return sa;
 }
@@ -460,7 +615,7 @@ struct ofp_ipsec_sa *ofp_ipsec_sa_find_by_id(uint32_t id)
 {
 	struct ofp_ipsec_sa *sa = NULL;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sa = sa_find_by_id(id);
 	sa_ref(sa);
 	odp_rwlock_write_unlock(&shm->lock);
@@ -485,7 +640,7 @@ int ofp_ipsec_sa_disabled(struct ofp_ipsec_sa *sa)
 int ofp_ipsec_sa_set_selectors(struct ofp_ipsec_sa *sa,
 			       const ofp_ipsec_selectors_t *sel)
 {
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	if (odp_atomic_load_acq_u32(&sa->selectors_set)) {
 		odp_rwlock_write_unlock(&shm->lock);
 		OFP_ERR("Selectors already set in an SA");
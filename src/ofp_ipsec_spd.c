@@ -14,24 +14,58 @@
 #include "ofpi_in.h"
 #include "ofpi_ip.h"
 #include "ofpi_shared_mem.h"
+#include "ofpi_hash.h"
+#include "ofpi_lockstat.h"
 #include "ofpi_ipsec_spd.h"
 #include "ofpi_ipsec_sad.h"
 
+/*
+ * Policy lookup is a tuple space search. An SP whose source and
+ * destination ranges are both prefixes is stored in a hash table keyed
+ * by the masked addresses, the VRF, the direction and the two prefix
+ * lengths (the tuple). A packet is looked up with one hash probe per
+ * tuple in use. SPs with other ranges are kept in a priority ordered
+ * list that is walked linearly, as all SPs were before.
+ */
+#define SP_PREFIX_NONE 0xff
+#define SP_NUM_LEN 33				/* prefix lengths 0..32 */
+#define SP_NUM_TUPLES (SP_NUM_LEN * SP_NUM_LEN)
+#define SP_TUPLE_NONE 0xffff
+#define SP_DIR_IN 0
+#define SP_DIR_OUT 1
+
 struct ofp_ipsec_sp {
 	ofp_ipsec_sp_param_t param;
-	struct ofp_ipsec_sp *next_in_lookup;
+	struct ofp_ipsec_sp *next_in_lookup;	/* hash chain or range list */
 	ofp_ipsec_sa_handle sa;			/* user managed */
 	uint32_t refcount;
 	int destroyed;
 	struct ofp_ipsec_sp *next;
+	/* Lookup state, valid while in_lookup is set */
+	uint32_t key[3];
+	uint32_t seq;
+	uint16_t tuple;
+	uint8_t in_lookup;
+};
+
+struct sp_classifier {
+	/* SPs with non-prefix ranges, in priority order */
+	struct ofp_ipsec_sp *range_list;
+	uint32_t num_sp;
+	uint32_t num_tuples;
+	uint16_t tuples[SP_NUM_TUPLES];		/* tuples in use */
+	uint32_t tuple_refs[SP_NUM_TUPLES];	/* SPs per tuple */
 };
 
 struct ofp_ipsec_spd {
 	odp_rwlock_t lock;
 	struct ofp_ipsec_sp *sp_list;
-	struct ofp_ipsec_sp *outbound_lookup_list;
-	struct ofp_ipsec_sp *inbound_lookup_list;
 	struct ofp_ipsec_sp *free_sp_list;
+	uint32_t sp_high;		/* never used SPs from here on */
+	uint32_t max_num_sp;
+	struct sp_classifier lookup[2];		/* SP_DIR_IN, SP_DIR_OUT */
+	uint32_t seq;
+	uint32_t hash_mask;
 };
 
 struct ofp_ipsec_selector_values {
@@ -46,13 +80,19 @@ static __thread struct ofp_ipsec_spd *shm;
 #define SHM_NAME_IPSEC_SP_TABLE "ofp_ipsec_sp_table"
 static __thread struct ofp_ipsec_sp *shm_sp_table;
 
+#define SHM_NAME_IPSEC_SP_HASH "ofp_ipsec_sp_hash"
+static __thread struct ofp_ipsec_sp **shm_sp_hash;
+
 static struct ofp_ipsec_sp *sp_alloc(void)
 {
 	struct ofp_ipsec_sp *sp;
 
 	sp = shm->free_sp_list;
-	if (sp) {
+	if (sp)
 		shm->free_sp_list = sp->next;
+	else if (shm->sp_high < shm->max_num_sp)
+		sp = &shm_sp_table[shm->sp_high++];
+	if (sp) {
 		sp->refcount = 1;
 	}
 	return sp;
@@ -78,14 +118,14 @@ static void sp_unref(struct ofp_ipsec_sp *sp)
 
 void ofp_ipsec_sp_ref(struct ofp_ipsec_sp *sp)
 {
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sp_ref(sp);
 	odp_rwlock_write_unlock(&shm->lock);
 }
 
 void ofp_ipsec_sp_unref(struct ofp_ipsec_sp *sp)
 {
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sp_unref(sp);
 	odp_rwlock_write_unlock(&shm->lock);
 }
@@ -105,27 +145,40 @@ static uint64_t sp_table_size(uint32_t max_num_sp)
 	return max_num_sp * sizeof(struct ofp_ipsec_sp);
 }
 
+/* Power of two, at least max_num_sp */
+static uint32_t sp_hash_buckets(uint32_t max_num_sp)
+{
+	uint32_t n = 1;
+
+	while (n < max_num_sp)
+		n <<= 1;
+	return n;
+}
+
+static uint64_t sp_hash_size(uint32_t max_num_sp)
+{
+	return sp_hash_buckets(max_num_sp) * sizeof(struct ofp_ipsec_sp *);
+}
+
 void ofp_ipsec_spd_init_prepare(uint32_t max_num_sp)
 {
 	ofp_shared_memory_prealloc(SHM_NAME_IPSEC_SPD, sizeof(*shm));
 	ofp_shared_memory_prealloc(SHM_NAME_IPSEC_SP_TABLE,
 				   sp_table_size(max_num_sp));
+	ofp_shared_memory_prealloc(SHM_NAME_IPSEC_SP_HASH,
+				   sp_hash_size(max_num_sp));
 }
 
 int ofp_ipsec_spd_init_global(uint32_t max_num_sp)
 {
-	uint32_t n;
-
 	shm = ofp_shared_memory_alloc(SHM_NAME_IPSEC_SPD, sizeof(*shm));
 	if (!shm) {
 		OFP_ERR("Failed to allocate IPsec SPD shared memory");
 		return -1;
 	}
+	memset(shm, 0, sizeof(*shm));
 	odp_rwlock_init(&shm->lock);
-	shm->sp_list = NULL;
-	shm->outbound_lookup_list = NULL;
-	shm->inbound_lookup_list = NULL;
-	shm->free_sp_list = NULL;
+	shm->hash_mask = sp_hash_buckets(max_num_sp) - 1;
 
 	shm_sp_table = ofp_shared_memory_alloc(SHM_NAME_IPSEC_SP_TABLE,
 					       sp_table_size(max_num_sp));
@@ -134,8 +187,19 @@ int ofp_ipsec_spd_init_global(uint32_t max_num_sp)
 		ofp_shared_memory_free(SHM_NAME_IPSEC_SPD);
 		return -1;
 	}
-	for (n = 0; n < max_num_sp; n++)
-		sp_free(&shm_sp_table[n]);
+	/* The free list grows as SPs are released, see sp_alloc() */
+	shm->sp_high = 0;
+	shm->max_num_sp = max_num_sp;
+
+	shm_sp_hash = ofp_shared_memory_alloc(SHM_NAME_IPSEC_SP_HASH,
+					      sp_hash_size(max_num_sp));
+	if (!shm_sp_hash) {
+		OFP_ERR("Failed to allocate IPsec SP hash table");
+		ofp_shared_memory_free(SHM_NAME_IPSEC_SP_TABLE);
+		ofp_shared_memory_free(SHM_NAME_IPSEC_SPD);
+		return -1;
+	}
+	memset(shm_sp_hash, 0, sp_hash_size(max_num_sp));
 	return 0;
 }
 
@@ -148,10 +212,16 @@ int ofp_ipsec_spd_init_local(void)
 	}
 
 	shm_sp_table = ofp_shared_memory_lookup(SHM_NAME_IPSEC_SP_TABLE);
-	if (!shm) {
+	if (!shm_sp_table) {
 		OFP_ERR("Failed to lookup IPsec SP table shared memory");
 		return -1;
 	}
+
+	shm_sp_hash = ofp_shared_memory_lookup(SHM_NAME_IPSEC_SP_HASH);
+	if (!shm_sp_hash) {
+		OFP_ERR("Failed to lookup IPsec SP hash shared memory");
+		return -1;
+	}
 	return 0;
 }
 
@@ -159,6 +229,7 @@ int ofp_ipsec_spd_term_global(void)
 {
 	ofp_shared_memory_free(SHM_NAME_IPSEC_SPD);
 	ofp_shared_memory_free(SHM_NAME_IPSEC_SP_TABLE);
+	ofp_shared_memory_free(SHM_NAME_IPSEC_SP_HASH);
 	return 0;
 }
 
@@ -180,7 +251,7 @@ struct ofp_ipsec_sp *ofp_ipsec_sp_find_by_id(uint32_t id)
 {
 	struct ofp_ipsec_sp *sp;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sp = sp_find_by_id(id);
 	sp_ref(sp);
 	odp_rwlock_write_unlock(&shm->lock);
@@ -191,7 +262,7 @@ ofp_ipsec_sp_handle ofp_ipsec_sp_first(void)
 {
 	ofp_ipsec_sp_handle sp;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	sp = shm->sp_list;
 	sp_ref(sp);
 	odp_rwlock_write_unlock(&shm->lock);
@@ -202,7 +273,7 @@ ofp_ipsec_sp_handle ofp_ipsec_sp_next(ofp_ipsec_sp_handle sp)
 {
 	ofp_ipsec_sp_handle next;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 	next = sp->next;
 	sp_ref(next);
 	sp_unref(sp);
@@ -212,7 +283,7 @@ ofp_ipsec_sp_handle ofp_ipsec_sp_next(ofp_ipsec_sp_handle sp)
 
 void ofp_ipsec_sp_get_info(ofp_ipsec_sp_handle sp, ofp_ipsec_sp_info_t *info)
 {
-	odp_rwlock_read_lock(&shm->lock);
+	ofp_rwlock_read_lock(&shm->lock);
 	if (sp->destroyed)
 		info->status = OFP_IPSEC_SP_DESTROYED;
 	else
@@ -253,7 +324,7 @@ struct ofp_ipsec_sp *ofp_ipsec_sp_add(const ofp_ipsec_sp_param_t *param)
 {
 	struct ofp_ipsec_sp *sp = NULL;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 
 	if (param->selectors.src_port_range.first_port != 0 ||
 	    param->selectors.src_port_range.last_port != 0 ||
@@ -287,6 +358,7 @@ struct ofp_ipsec_sp *ofp_ipsec_sp_add(const ofp_ipsec_sp_param_t *param)
 
 	sp->param = *param;
 	sp->destroyed = 0;
+	sp->in_lookup = 0;
 	sp->sa = OFP_IPSEC_SA_INVALID;
 
 	/*
@@ -315,7 +387,7 @@ int ofp_ipsec_sp_del(struct ofp_ipsec_sp *sp)
 	struct ofp_ipsec_sp **link;
 	int found = 0;
 
-	odp_rwlock_write_lock(&shm->lock);
+	ofp_rwlock_write_lock(&shm->lock);
 
 	link = &shm->sp_list;
 	while (*link) {
@@ -381,74 +453,184 @@ static int sel_match(const struct ofp_ipsec_selectors_t *pol_sel,
 	return 1;
 }
 
+static inline int sp_dir_index(ofp_ipsec_dir_t dir)
+{
+	return dir == OFP_IPSEC_DIR_INBOUND ? SP_DIR_IN : SP_DIR_OUT;
+}
+
+/*
+ * Return the prefix length of an address range or SP_PREFIX_NONE if
+ * the range is not a prefix.
+ */
+static uint8_t range_prefix_len(uint32_t first, uint32_t last)
+{
+	uint32_t size;
+
+	if (first > last)
+		return SP_PREFIX_NONE;
+	size = last - first;
+	if (size == 0xffffffff)
+		return 0;
+	size++;
+	if ((size & (size - 1)) || (first & (size - 1)))
+		return SP_PREFIX_NONE;
+	return 32 - __builtin_ctz(size);
+}
+
+static inline uint32_t prefix_mask(uint32_t len)
+{
+	return len ? ~0u << (32 - len) : 0;
+}
+
+static inline void sp_key(uint32_t key[3], uint32_t src, uint32_t dst,
+			  uint16_t vrf, int dir, uint16_t tuple)
+{
+	key[0] = src & prefix_mask(tuple / SP_NUM_LEN);
+	key[1] = dst & prefix_mask(tuple % SP_NUM_LEN);
+	key[2] = (uint32_t)vrf << 16 | (uint32_t)dir << 15 | tuple;
+}
+
+static inline uint32_t sp_hash(const uint32_t key[3])
+{
+	return ofp_hash_key(key, 3, 0) & shm->hash_mask;
+}
+
+/*
+ * Return true if SP a takes precedence over SP b. Of SPs with equal
+ * priority the one added last wins, like in sp_insert().
+ */
+static inline int sp_precedes(const struct ofp_ipsec_sp *a,
+			      const struct ofp_ipsec_sp *b)
+{
+	if (!b)
+		return 1;
+	if (a->param.priority != b->param.priority)
+		return a->param.priority < b->param.priority;
+	return a->seq > b->seq;
+}
+
 void ofp_ipsec_sp_lookup_add_sp(struct ofp_ipsec_sp *sp)
 {
-	if (sp->param.dir == OFP_IPSEC_DIR_INBOUND)
-		sp_insert(&shm->inbound_lookup_list, sp);
-	else
-		sp_insert(&shm->outbound_lookup_list, sp);
+	const ofp_ipsec_selectors_t *sel = &sp->param.selectors;
+	int dir = sp_dir_index(sp->param.dir);
+	struct sp_classifier *c = &shm->lookup[dir];
+	uint8_t src_len, dst_len;
+	uint32_t h;
+
+	sp->seq = shm->seq++;
+	src_len = range_prefix_len(sel->src_ipv4_range.first_addr.s_addr,
+				   sel->src_ipv4_range.last_addr.s_addr);
+	dst_len = range_prefix_len(sel->dst_ipv4_range.first_addr.s_addr,
+				   sel->dst_ipv4_range.last_addr.s_addr);
+
+	if (src_len == SP_PREFIX_NONE || dst_len == SP_PREFIX_NONE) {
+		sp->tuple = SP_TUPLE_NONE;
+		sp_insert(&c->range_list, sp);
+	} else {
+		sp->tuple = src_len * SP_NUM_LEN + dst_len;
+		sp_key(sp->key, sel->src_ipv4_range.first_addr.s_addr,
+		       sel->dst_ipv4_range.first_addr.s_addr,
+		       sp->param.vrf, dir, sp->tuple);
+		h = sp_hash(sp->key);
+		sp->next_in_lookup = shm_sp_hash[h];
+		shm_sp_hash[h] = sp;
+		if (c->tuple_refs[sp->tuple]++ == 0)
+			c->tuples[c->num_tuples++] = sp->tuple;
+	}
+	sp->in_lookup = 1;
+	c->num_sp++;
 }
 
 int ofp_ipsec_sp_lookup_del_sp(struct ofp_ipsec_sp *sp, int *empty)
 {
+	struct sp_classifier *c = &shm->lookup[sp_dir_index(sp->param.dir)];
 	struct ofp_ipsec_sp **link;
+	uint32_t n;
 
-	if (sp->param.dir == OFP_IPSEC_DIR_INBOUND)
-		link = &shm->inbound_lookup_list;
-	else
-		link = &shm->outbound_lookup_list;
-
-	while (*link && (*link) != sp)
-		link = &(*link)->next_in_lookup;
-	if (link == NULL)
+	if (!sp->in_lookup)
 		return -1;
 
+	if (sp->tuple == SP_TUPLE_NONE)
+		link = &c->range_list;
+	else
+		link = &shm_sp_hash[sp_hash(sp->key)];
+	while (*link != sp)
+		link = &(*link)->next_in_lookup;
 	*link = sp->next_in_lookup;
-	*empty = (shm->inbound_lookup_list == NULL &&
-		  shm->outbound_lookup_list == NULL);
+
+	if (sp->tuple != SP_TUPLE_NONE && --c->tuple_refs[sp->tuple] == 0) {
+		for (n = 0; c->tuples[n] != sp->tuple; n++)
+			;
+		c->tuples[n] = c->tuples[--c->num_tuples];
+	}
+	sp->in_lookup = 0;
+	c->num_sp--;
+
+	*empty = (shm->lookup[SP_DIR_IN].num_sp == 0 &&
+		  shm->lookup[SP_DIR_OUT].num_sp == 0);
 	return 0;
 }
 
-static inline ofp_ipsec_action_t sp_lookup(struct ofp_ipsec_sp *sp,
+static inline ofp_ipsec_action_t sp_lookup(int dir,
 					   uint16_t vrf,
 					   odp_packet_t pkt,
 					   ofp_ipsec_sa_handle *sa)
 {
-	ofp_ipsec_action_t action;
+	struct sp_classifier *c = &shm->lookup[dir];
 	struct ofp_ipsec_selector_values sel;
+	struct ofp_ipsec_sp *sp, *best = NULL;
+	uint32_t key[3];
+	uint32_t n;
+
+	if (c->num_sp == 0)
+		return OFP_IPSEC_ACTION_BYPASS;
 
 	get_selector_values(pkt, &sel);
 
-	while (sp) {
+	/* The range list is in priority order, the first match is best */
+	for (sp = c->range_list; sp; sp = sp->next_in_lookup) {
 		if (sp->param.vrf == vrf &&
-		    sel_match(&sp->param.selectors, &sel))
+		    sel_match(&sp->param.selectors, &sel)) {
+			best = sp;
 			break;
-		sp = sp->next_in_lookup;
+		}
 	}
-	if (sp)  {
-		if (sa) {
-			if (!ofp_ipsec_sa_disabled(sp->sa)) {
-				*sa = sp->sa;
-			} else {
-				*sa = OFP_IPSEC_SA_INVALID;
-			}
+
+	for (n = 0; n < c->num_tuples; n++) {
+		sp_key(key, sel.src_addr, sel.dst_addr, vrf, dir,
+		       c->tuples[n]);
+		for (sp = shm_sp_hash[sp_hash(key)]; sp;
+		     sp = sp->next_in_lookup) {
+			if (sp->key[0] == key[0] && sp->key[1] == key[1] &&
+			    sp->key[2] == key[2] &&
+			    (sp->param.selectors.ip_proto == 0 ||
+			     sp->param.selectors.ip_proto == sel.ip_proto) &&
+			    sp_precedes(sp, best))
+				best = sp;
 		}
-		action = sp->param.action;
-	} else {
-		action = OFP_IPSEC_ACTION_BYPASS;
 	}
-	return action;
+
+	if (!best)
+		return OFP_IPSEC_ACTION_BYPASS;
+
+	if (sa) {
+		if (!ofp_ipsec_sa_disabled(best->sa))
+			*sa = best->sa;
+		else
+			*sa = OFP_IPSEC_SA_INVALID;
+	}
+	return best->param.action;
 }
 
 ofp_ipsec_action_t ofp_ipsec_sp_out_lookup(uint16_t vrf, odp_packet_t pkt,
 					   ofp_ipsec_sa_handle *sa)
 {
-	return sp_lookup(shm->outbound_lookup_list, vrf, pkt, sa);
+	return sp_lookup(SP_DIR_OUT, vrf, pkt, sa);
 }
 
 ofp_ipsec_action_t ofp_ipsec_sp_in_lookup(uint16_t vrf, odp_packet_t pkt)
 {
-	return sp_lookup(shm->inbound_lookup_list, vrf, pkt, NULL);
+	return sp_lookup(SP_DIR_IN, vrf, pkt, NULL);
 }
 
 /*
@@ -0,0 +1,211 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_errno.h"
+#include "ofpi_ktls.h"
+#include "ofpi_socketvar.h"
+#include "ofpi_sockopt.h"
+#include "ofpi_log.h"
+
+/*
+ * Records are encrypted as the data enters the send buffer, so that
+ * TCP segments and retransmits ciphertext like any other data and a
+ * record is encrypted only once. The synchronous ODP crypto operation
+ * works in place on the packet that the data was copied into.
+ */
+
+#define KTLS_APP_DATA	23		/* content type */
+#define KTLS_AAD12_LEN	13		/* seq, type, version, length */
+
+static inline void ktls_put16(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 8;
+	p[1] = v;
+}
+
+static inline void ktls_put64(uint8_t *p, uint64_t v)
+{
+	int i;
+
+	for (i = 7; i >= 0; i--, v >>= 8)
+		p[i] = v;
+}
+
+int ofp_ktls_seal(struct ofp_ktls *tls, odp_packet_t pkt)
+{
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 22
+	odp_crypto_packet_op_param_t op;
+	odp_crypto_packet_result_t res;
+	odp_packet_t out = pkt;
+	uint32_t hlen = ofp_ktls_hdr_len(tls);
+	uint32_t len = odp_packet_len(pkt);
+	uint32_t plen = len - ofp_ktls_overhead(tls);
+	uint8_t hdr[OFP_KTLS_HDR_LEN + OFP_KTLS_NONCE_LEN];
+	uint8_t aad[KTLS_AAD12_LEN];
+	uint8_t nonce[12];
+	uint8_t type = KTLS_APP_DATA;
+	int i;
+
+	hdr[0] = KTLS_APP_DATA;
+	/* TLS 1.3 records carry the TLS 1.2 version too */
+	hdr[1] = OFP_TLS_VMAJOR;
+	hdr[2] = OFP_TLS_VMINOR_12;
+	ktls_put16(&hdr[3], len - OFP_KTLS_HDR_LEN);
+
+	memset(&op, 0, sizeof(op));
+	op.session = tls->session;
+	op.cipher_iv_ptr = nonce;
+	op.aad_ptr = aad;
+	op.cipher_range.offset = hlen;
+
+	if (tls->vminor == OFP_TLS_VMINOR_12) {
+		/* Salt and the record number, sent as the explicit nonce */
+		memcpy(nonce, tls->iv, 4);
+		ktls_put64(&nonce[4], tls->seq);
+		memcpy(&hdr[OFP_KTLS_HDR_LEN], &nonce[4], OFP_KTLS_NONCE_LEN);
+		ktls_put64(aad, tls->seq);
+		memcpy(&aad[8], hdr, 3);
+		ktls_put16(&aad[11], plen);
+		op.cipher_range.length = plen;
+	} else {
+		/* IV xor the record number, the header is the AAD */
+		memcpy(nonce, tls->iv, sizeof(nonce));
+		for (i = 0; i < 8; i++)
+			nonce[4 + i] ^= tls->seq >> (56 - 8 * i);
+		memcpy(aad, hdr, OFP_KTLS_HDR_LEN);
+		if (odp_packet_copy_from_mem(pkt, hlen + plen, 1, &type))
+			return OFP_EINVAL;
+		op.cipher_range.length = plen + 1;
+	}
+	op.auth_range = op.cipher_range;
+	op.hash_result_offset = op.cipher_range.offset +
+		op.cipher_range.length;
+
+	if (odp_packet_copy_from_mem(pkt, 0, hlen, hdr))
+		return OFP_EINVAL;
+
+	if (odp_crypto_op(&pkt, &out, &op, 1) != 1)
+		return OFP_ENOBUFS;
+	if (odp_crypto_result(&res, out) < 0 || !res.ok) {
+		OFP_ERR("TLS record encryption failed");
+		return OFP_EIO;
+	}
+
+	tls->seq++;
+	return 0;
+#else
+	(void)tls;
+	(void)pkt;
+	return OFP_EOPNOTSUPP;
+#endif
+}
+
+int ofp_ktls_frame(struct ofp_ktls *tls, odp_packet_t *pkt)
+{
+	uint32_t hlen = ofp_ktls_hdr_len(tls);
+	uint32_t plen = odp_packet_len(*pkt);
+
+	if (plen > OFP_TLS_MAX_PLAINTEXT)
+		return OFP_EMSGSIZE;
+	if (odp_packet_extend_head(pkt, hlen, NULL, NULL) < 0 ||
+	    odp_packet_extend_tail(pkt, ofp_ktls_overhead(tls) - hlen,
+				   NULL, NULL) < 0)
+		return OFP_ENOBUFS;
+
+	return ofp_ktls_seal(tls, *pkt);
+}
+
+static int ktls_session(struct ofp_tls_enable *en,
+			odp_crypto_session_t *session)
+{
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 22
+	odp_crypto_session_param_t param;
+	odp_crypto_ses_create_err_t ses_err;
+
+	odp_crypto_session_param_init(&param);
+	param.op = ODP_CRYPTO_OP_ENCODE;
+	param.op_mode = ODP_CRYPTO_SYNC;
+	param.auth_cipher_text = 1;
+	param.cipher_alg = ODP_CIPHER_ALG_AES_GCM;
+	param.cipher_key.data = en->cipher_key;
+	param.cipher_key.length = en->cipher_key_len;
+	param.cipher_iv_len = 12;
+	param.auth_alg = ODP_AUTH_ALG_AES_GCM;
+	param.auth_digest_len = OFP_KTLS_TAG_LEN;
+	param.auth_aad_len = en->tls_vminor == OFP_TLS_VMINOR_12 ?
+		KTLS_AAD12_LEN : OFP_KTLS_HDR_LEN;
+	param.compl_queue = ODP_QUEUE_INVALID;
+	param.output_pool = ODP_POOL_INVALID;
+
+	if (odp_crypto_session_create(&param, session, &ses_err)) {
+		OFP_ERR("TLS crypto session failed: %d", ses_err);
+		return OFP_EOPNOTSUPP;
+	}
+	return 0;
+#else
+	(void)en;
+	(void)session;
+	return OFP_EOPNOTSUPP;
+#endif
+}
+
+int ofp_ktls_setopt(struct socket *so, struct sockopt *sopt)
+{
+	struct ofp_ktls *tls = &so->so_tls;
+	struct ofp_tls_enable en;
+	odp_crypto_session_t session, old = ODP_CRYPTO_SESSION_INVALID;
+	uint64_t seq = 0;
+	int error, i;
+
+	error = ofp_sooptcopyin(sopt, &en, sizeof(en), sizeof(en));
+	if (error)
+		return error;
+
+	if (en.tls_vmajor != OFP_TLS_VMAJOR ||
+	    (en.tls_vminor != OFP_TLS_VMINOR_12 &&
+	     en.tls_vminor != OFP_TLS_VMINOR_13) ||
+	    (en.cipher_key_len != 16 && en.cipher_key_len != 32)) {
+		error = OFP_EINVAL;
+		goto out;
+	}
+
+	error = ktls_session(&en, &session);
+	if (error)
+		goto out;
+
+	for (i = 0; i < 8; i++)
+		seq = seq << 8 | en.rec_seq[i];
+
+	/* Not in the middle of a send */
+	ofp_sblock(&so->so_snd, SBL_WAIT | SBL_NOINTR);
+	if (tls->vminor)
+		old = tls->session;
+	tls->session = session;
+	tls->seq = seq;
+	memcpy(tls->iv, en.iv, sizeof(tls->iv));
+	tls->vminor = en.tls_vminor;
+	ofp_sbunlock(&so->so_snd);
+
+	if (old != ODP_CRYPTO_SESSION_INVALID)
+		odp_crypto_session_destroy(old);
+out:
+	memset(&en, 0, sizeof(en));
+	return error;
+}
+
+void ofp_ktls_free(struct socket *so)
+{
+	struct ofp_ktls *tls = &so->so_tls;
+
+	if (!tls->vminor)
+		return;
+	odp_crypto_session_destroy(tls->session);
+	memset(tls, 0, sizeof(*tls));
+}
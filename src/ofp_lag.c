@@ -0,0 +1,310 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_lag.h"
+#include "ofpi_ifnet.h"
+#include "ofpi_pkt_processing.h"
+#include "ofpi_hash.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_stat.h"
+
+/* Differs from the ECMP seed so that LAG and ECMP choices do not align */
+#define LAG_HASH_SEED 0x6c616767
+
+/* Hash of the L3 and L4 addresses of an outgoing packet */
+static uint32_t lag_flow_hash(odp_packet_t pkt)
+{
+	uint32_t key[4] = {0, 0, 0, 0};
+	uint32_t len;
+	uint8_t *l3 = odp_packet_l3_ptr(pkt, &len);
+	uint8_t *l4 = NULL;
+	uint8_t proto = 0;
+
+	if (l3 && len >= sizeof(struct ofp_ip) &&
+	    (l3[0] >> 4) == OFP_IPVERSION) {
+		struct ofp_ip *ip = (struct ofp_ip *)l3;
+
+		key[0] = ip->ip_src.s_addr;
+		key[1] = ip->ip_dst.s_addr;
+		proto = ip->ip_p;
+		if (!(odp_be_to_cpu_16(ip->ip_off) &
+		      (OFP_IP_MF | OFP_IP_OFFMASK)) &&
+		    len >= (uint32_t)(ip->ip_hl << 2) + 4)
+			l4 = l3 + (ip->ip_hl << 2);
+	} else if (l3 && len >= sizeof(struct ofp_ip6_hdr) &&
+		   (l3[0] & OFP_IPV6_VERSION_MASK) == OFP_IPV6_VERSION) {
+		struct ofp_ip6_hdr *ip6 = (struct ofp_ip6_hdr *)l3;
+		uint32_t a[8];
+		int i;
+
+		memcpy(a, &ip6->ip6_src, sizeof(a));
+		for (i = 0; i < 4; i++)
+			key[i & 1] ^= a[i] ^ a[i + 4];
+		proto = ip6->ofp_ip6_nxt;
+		if (len >= sizeof(*ip6) + 4)
+			l4 = l3 + sizeof(*ip6);
+	} else if (odp_packet_has_flow_hash(pkt)) {
+		return odp_packet_flow_hash(pkt);
+	}
+
+	if (l4 && (proto == OFP_IPPROTO_TCP || proto == OFP_IPPROTO_UDP))
+		memcpy(&key[2], l4, sizeof(key[2]));
+	key[3] = proto;
+
+	return ofp_hash_key(key, 4, LAG_HASH_SEED);
+}
+
+struct ofp_ifnet *ofp_lag_tx_member(struct ofp_ifnet *lag, odp_packet_t pkt)
+{
+	uint32_t b = lag_flow_hash(pkt) % OFP_LAG_BUCKETS;
+	uint8_t m = __atomic_load_n(&lag->lag_bucket[b], __ATOMIC_ACQUIRE);
+
+	if (odp_unlikely(m == OFP_LAG_NONE))
+		return NULL;
+
+	return ofp_get_ifnet(lag->lag_member[m], 0);
+}
+
+int ofp_lag_send_multi(struct ofp_ifnet *lag, odp_packet_t pkt[], int num,
+		       int queue_id)
+{
+	struct ofp_ifnet *member;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		member = ofp_lag_tx_member(lag, pkt[i]);
+		if (!member) {
+			OFP_DROP_STAT(LAG_DOWN);
+			odp_packet_free(pkt[i]);
+		} else if (ofp_send_pkt_multi(member, &pkt[i], 1,
+					      queue_id) != 1) {
+			OFP_DROP_STAT(TX_PKTOUT);
+			odp_packet_free(pkt[i]);
+		}
+	}
+	return num;
+}
+
+/*
+ * Give each member with the link up an equal share of the buckets.
+ * Buckets of members that stay up are kept up to the member's share,
+ * so only the flows of failed members and the share of recovered
+ * members move.
+ */
+static void lag_rebalance(struct ofp_ifnet *lag, uint32_t up)
+{
+	uint8_t quota[OFP_LAG_MEMBER_MAX];
+	uint8_t count[OFP_LAG_MEMBER_MAX];
+	uint8_t move[OFP_LAG_BUCKETS];
+	int idx[OFP_LAG_MEMBER_MAX];
+	int b, i, n = 0, next = 0;
+
+	for (i = 0; i < lag->lag_num; i++)
+		if (up & (1u << i))
+			idx[n++] = i;
+
+	memset(quota, 0, sizeof(quota));
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < n; i++)
+		quota[idx[i]] = OFP_LAG_BUCKETS / n + (i < OFP_LAG_BUCKETS % n);
+
+	for (b = 0; b < OFP_LAG_BUCKETS; b++) {
+		uint8_t m = lag->lag_bucket[b];
+
+		move[b] = (m == OFP_LAG_NONE || !(up & (1u << m)) ||
+			   count[m] >= quota[m]);
+		if (!move[b])
+			count[m]++;
+	}
+
+	for (b = 0; b < OFP_LAG_BUCKETS; b++) {
+		uint8_t m = OFP_LAG_NONE;
+
+		if (!move[b])
+			continue;
+		if (n) {
+			while (count[idx[next]] >= quota[idx[next]])
+				next++;
+			m = idx[next];
+			count[m]++;
+		}
+		__atomic_store_n(&lag->lag_bucket[b], m, __ATOMIC_RELEASE);
+	}
+}
+
+/* Members whose link is not reported down */
+static uint32_t lag_link_up(struct ofp_ifnet *lag)
+{
+	struct ofp_ifnet *member;
+	uint32_t up = 0;
+	int i;
+
+	for (i = 0; i < lag->lag_num; i++) {
+		member = ofp_get_ifnet(lag->lag_member[i], 0);
+		if (odp_pktio_link_status(member->pktio) !=
+		    ODP_PKTIO_LINK_STATUS_DOWN)
+			up |= 1u << i;
+	}
+	return up;
+}
+
+static void lag_link_poll(void *arg)
+{
+	struct ofp_ifnet *lag = ofp_get_ifnet(*(uint16_t *)arg, 0);
+	uint32_t up;
+
+	if (!lag || !lag->lag_num)
+		return;
+
+	up = lag_link_up(lag);
+	if (up != lag->lag_up) {
+		OFP_INFO("LAG %s: members up 0x%x, were 0x%x", lag->if_name,
+			 up, lag->lag_up);
+		lag_rebalance(lag, up);
+		lag->lag_up = up;
+	}
+
+	lag->lag_tmo = ofp_timer_start(OFP_LAG_LINK_POLL_US, lag_link_poll,
+				       &lag->port, sizeof(lag->port));
+}
+
+static int lag_member_check(const int member[], int i)
+{
+	struct ofp_ifnet *ifnet;
+	int j;
+
+	ifnet = PHYS_PORT(member[i]) ?
+		ofp_get_ifnet((uint16_t)member[i], 0) : NULL;
+	if (!ifnet || ifnet->if_state != OFP_IFT_STATE_USED ||
+	    ifnet->pktio == ODP_PKTIO_INVALID || ifnet->lag) {
+		OFP_ERR("Port %d cannot be a LAG member", member[i]);
+		return -1;
+	}
+	for (j = 0; j < i; j++)
+		if (member[j] == member[i]) {
+			OFP_ERR("Port %d is a LAG member twice", member[i]);
+			return -1;
+		}
+	return 0;
+}
+
+/* Members receive the frames to the MAC address of the LAG */
+static void lag_member_mac_set(struct ofp_ifnet *lag, struct ofp_ifnet *member)
+{
+	if (!memcmp(member->mac, lag->mac, OFP_ETHER_ADDR_LEN))
+		return;
+	if (!odp_pktio_mac_addr_set(member->pktio, lag->mac,
+				    OFP_ETHER_ADDR_LEN))
+		return;
+	if (odp_pktio_promisc_mode_set(member->pktio, 1))
+		OFP_WARN("LAG %s: %s receives only its own MAC address",
+			 lag->if_name, member->if_name);
+}
+
+int ofp_ifnet_lag_create(const char *if_name, const int member[], int num)
+{
+	struct ofp_ifnet *lag, *ifnet;
+	int port, i;
+
+	if (num < 1 || num > OFP_LAG_MEMBER_MAX) {
+		OFP_ERR("Invalid number of LAG members: %d", num);
+		return -1;
+	}
+	for (i = 0; i < num; i++)
+		if (lag_member_check(member, i))
+			return -1;
+
+	port = ofp_free_port_alloc();
+	lag = port < 0 ? NULL : ofp_get_ifnet((uint16_t)port, 0);
+	if (lag == NULL) {
+		OFP_ERR("Got ifnet NULL");
+		return -1;
+	}
+
+	OFP_DBG("LAG '%s' becomes '%s%d', port %d",
+		if_name, OFP_IFNAME_PREFIX, port, port);
+
+	lag->if_state = OFP_IFT_STATE_USED;
+	strncpy(lag->if_name, if_name, OFP_IFNAMSIZ);
+	lag->if_name[OFP_IFNAMSIZ-1] = 0;
+	lag->pkt_pool = ofp_packet_pool;
+	lag->cos_def = ODP_COS_INVALID;
+	lag->chksum_offload_flags = ~0;
+
+	for (i = 0; i < num; i++) {
+		ifnet = ofp_get_ifnet((uint16_t)member[i], 0);
+		lag->lag_member[i] = ifnet->port;
+		if (!i) {
+			memcpy(lag->mac, ifnet->mac, OFP_ETHER_ADDR_LEN);
+			lag->if_mtu = ifnet->if_mtu;
+		}
+		if (ifnet->if_mtu < lag->if_mtu)
+			lag->if_mtu = ifnet->if_mtu;
+		/* Offloads that every member does, without LSO profiles */
+		lag->chksum_offload_flags &= ifnet->chksum_offload_flags;
+	}
+	lag->chksum_offload_flags &= ~OFP_IF_TCP_TSO;
+	lag->lag_num = num;
+
+	memset(lag->lag_bucket, OFP_LAG_NONE, sizeof(lag->lag_bucket));
+	lag->lag_up = lag_link_up(lag);
+	lag_rebalance(lag, lag->lag_up);
+
+	HANDLE_ERROR(ofp_loopq_create(lag));
+	ofp_igmp_attach(lag);
+
+#ifdef SP
+	HANDLE_ERROR(ofp_sp_inq_create(lag));
+	HANDLE_ERROR(sp_setup_device(lag));
+	ofp_update_ifindex_lookup_tab(lag);
+#ifdef INET6
+	ofp_mac_to_link_local(lag->mac, lag->link_local);
+#endif /* INET6 */
+#endif /* SP */
+
+	ofp_if_stat_clear(lag->stat_idx);
+
+	/* The LAG is complete before the members receive for it */
+	odp_mb_release();
+	for (i = 0; i < num; i++) {
+		ifnet = ofp_get_ifnet((uint16_t)member[i], 0);
+		lag_member_mac_set(lag, ifnet);
+		ifnet->lag = lag;
+	}
+
+#ifdef SP
+	ofp_sp_threads_start(lag);
+#endif /* SP */
+
+	lag->lag_tmo = ofp_timer_start(OFP_LAG_LINK_POLL_US, lag_link_poll,
+				       &lag->port, sizeof(lag->port));
+	if (lag->lag_tmo == ODP_TIMER_INVALID)
+		OFP_WARN("LAG %s: member links are not monitored", if_name);
+
+	OFP_INFO("LAG %s of %d members, members up 0x%x", lag->if_name, num,
+		 lag->lag_up);
+	return port;
+}
+
+int ofp_lag_term(struct ofp_ifnet *lag)
+{
+	odp_timer_t tmo = lag->lag_tmo;
+	int rc = 0;
+
+	/* The poll does not rearm once the LAG has no members */
+	lag->lag_num = 0;
+	lag->lag_tmo = ODP_TIMER_INVALID;
+	if (tmo != ODP_TIMER_INVALID)
+		CHECK_ERROR(ofp_timer_cancel(tmo), rc);
+
+	return rc;
+}
@@ -0,0 +1,280 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_lockstat.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+
+#ifdef OFP_LOCK_STAT
+
+#define SHM_NAME_LOCKSTAT "OfpLockStatShMem"
+
+struct lockstat_site {
+	char name[48];
+	char file[32];
+	int line;
+};
+
+struct lockstat_cnt {
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t wait_cycles;
+};
+
+/*
+ * Shared data. Each thread has a row of counters, one per site, so that
+ * threads do not write to the same cache lines.
+ */
+struct ofp_lockstat_mem {
+	odp_spinlock_t lock;
+	uint32_t num_sites;
+	int num_threads;
+	struct lockstat_site site[OFP_LOCKSTAT_SITES];
+	struct lockstat_cnt cnt[];
+};
+
+#define SHM_SIZE_LOCKSTAT (sizeof(struct ofp_lockstat_mem) +		\
+			   odp_thread_count_max() * OFP_LOCKSTAT_SITES *	\
+			   sizeof(struct lockstat_cnt))
+
+/*
+ * Data per thread
+ */
+static __thread struct ofp_lockstat_mem *shm;
+static __thread struct lockstat_cnt *thr_cnt;
+
+static const char *basename_of(const char *file)
+{
+	const char *s = strrchr(file, '/');
+
+	return s ? s + 1 : file;
+}
+
+int ofp_lockstat_site(const char *name, const char *file, int line)
+{
+	uint32_t i;
+	int site = -1;
+
+	if (!shm)
+		return -1;
+
+	file = basename_of(file);
+
+	/* The locks of the site table are not counted */
+	odp_spinlock_lock(&shm->lock);
+	for (i = 0; i < shm->num_sites; i++)
+		if (shm->site[i].line == line &&
+		    !strncmp(shm->site[i].file, file,
+			     sizeof(shm->site[i].file) - 1)) {
+			site = i;
+			break;
+		}
+	if (site < 0 && shm->num_sites < OFP_LOCKSTAT_SITES) {
+		site = shm->num_sites;
+		strncpy(shm->site[site].name, name,
+			sizeof(shm->site[site].name) - 1);
+		strncpy(shm->site[site].file, file,
+			sizeof(shm->site[site].file) - 1);
+		shm->site[site].line = line;
+		shm->num_sites++;
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	return site;
+}
+
+void ofp_lockstat_count(int site, int contended, uint64_t cycles)
+{
+	struct lockstat_cnt *c;
+
+	if (odp_unlikely(site < 0 || !thr_cnt))
+		return;
+
+	c = &thr_cnt[site];
+	c->acquired++;
+	if (contended) {
+		c->contended++;
+		c->wait_cycles += cycles;
+	}
+}
+
+static int ofp_lockstat_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_LOCKSTAT, SHM_SIZE_LOCKSTAT);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_lockstat_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_LOCKSTAT) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	thr_cnt = NULL;
+	return rc;
+}
+
+static void lockstat_thread(void)
+{
+	int thr = odp_thread_id();
+
+	thr_cnt = thr >= 0 && thr < shm->num_threads ?
+		&shm->cnt[thr * OFP_LOCKSTAT_SITES] : NULL;
+}
+
+int ofp_lockstat_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_LOCKSTAT);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	lockstat_thread();
+	return 0;
+}
+
+void ofp_lockstat_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_LOCKSTAT, SHM_SIZE_LOCKSTAT);
+}
+
+int ofp_lockstat_init_global(void)
+{
+	HANDLE_ERROR(ofp_lockstat_alloc_shared_memory());
+
+	memset(shm, 0, SHM_SIZE_LOCKSTAT);
+	odp_spinlock_init(&shm->lock);
+	shm->num_threads = odp_thread_count_max();
+	lockstat_thread();
+
+	return 0;
+}
+
+int ofp_lockstat_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_lockstat_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_lockstat_free_shared_memory(), rc);
+
+	return rc;
+}
+
+static int cmp_wait(const void *a, const void *b)
+{
+	const struct lockstat_cnt *ca = a, *cb = b;
+
+	if (ca->wait_cycles != cb->wait_cycles)
+		return ca->wait_cycles < cb->wait_cycles ? 1 : -1;
+	return ca->contended < cb->contended ? 1 :
+		ca->contended > cb->contended ? -1 : 0;
+}
+
+struct site_total {
+	struct lockstat_cnt cnt;	/* first, for cmp_wait() */
+	uint32_t site;
+};
+
+void ofp_lockstat_print(int fd)
+{
+	struct site_total *total;
+	uint32_t i, num;
+	int thr;
+
+	if (!shm)
+		return;
+
+	num = shm->num_sites;
+	total = calloc(num ? num : 1, sizeof(*total));
+	if (!total)
+		return;
+
+	for (i = 0; i < num; i++) {
+		total[i].site = i;
+		for (thr = 0; thr < shm->num_threads; thr++) {
+			struct lockstat_cnt *c =
+				&shm->cnt[thr * OFP_LOCKSTAT_SITES + i];
+
+			total[i].cnt.acquired += c->acquired;
+			total[i].cnt.contended += c->contended;
+			total[i].cnt.wait_cycles += c->wait_cycles;
+		}
+	}
+	qsort(total, num, sizeof(*total), cmp_wait);
+
+	ofp_sendf(fd, "%-48s %24s %14s %12s %16s %10s\r\n", "Lock", "Site",
+		  "Acquired", "Contended", "Wait_cycles", "Avg_wait");
+	for (i = 0; i < num; i++) {
+		struct lockstat_site *s = &shm->site[total[i].site];
+		struct lockstat_cnt *t = &total[i].cnt;
+		char where[48];
+
+		if (!t->acquired)
+			continue;
+
+		snprintf(where, sizeof(where), "%s:%d", s->file, s->line);
+		ofp_sendf(fd, "%-48s %24s %14" PRIu64 " %12" PRIu64
+			  " %16" PRIu64 " %10" PRIu64 "\r\n",
+			  s->name, where, t->acquired, t->contended,
+			  t->wait_cycles,
+			  t->contended ? t->wait_cycles / t->contended : 0);
+
+		/* Threads that waited, the ones to move off the lock */
+		for (thr = 0; thr < shm->num_threads; thr++) {
+			struct lockstat_cnt *c =
+				&shm->cnt[thr * OFP_LOCKSTAT_SITES +
+					  total[i].site];
+
+			if (!c->contended)
+				continue;
+			ofp_sendf(fd, "%48s %17s %6d %14" PRIu64 " %12" PRIu64
+				  " %16" PRIu64 "\r\n", "", "thread", thr,
+				  c->acquired, c->contended, c->wait_cycles);
+		}
+	}
+
+	free(total);
+}
+
+void ofp_lockstat_clear(void)
+{
+	if (!shm)
+		return;
+
+	/* Counts of a concurrent acquisition may survive */
+	memset(shm->cnt, 0, shm->num_threads * OFP_LOCKSTAT_SITES *
+	       sizeof(shm->cnt[0]));
+}
+
+#else
+
+void ofp_lockstat_print(int fd)
+{
+	ofp_sendf(fd, "Lock statistics are not enabled, "
+		  "build with --enable-lock-stat\r\n");
+}
+
+void ofp_lockstat_clear(void)
+{
+}
+
+#endif /* OFP_LOCK_STAT */
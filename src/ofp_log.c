@@ -5,10 +5,330 @@
  * SPDX-License-Identifier:     BSD-3-Clause
  */
 
+#include <inttypes.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <odp/helper/odph_api.h>
+
+#include "ofpi.h"
 #include "ofpi_log.h"
+#include "ofpi_util.h"
 
 #ifdef OFP_DEBUG
 enum ofp_log_level_s ofp_loglevel = OFP_LOG_DEBUG;
 #else
 enum ofp_log_level_s ofp_loglevel = OFP_LOG_INFO;
 #endif
+
+#define SHM_NAME_LOG "OfpLogShMem"
+#define LOG_LOGGER_IDLE_US 1000
+
+ODP_STATIC_ASSERT((OFP_LOG_RING_SIZE & (OFP_LOG_RING_SIZE - 1)) == 0,
+		  "OFP_LOG_RING_SIZE not a power of two");
+
+struct log_slot {
+	char line[OFP_LOG_LINE_MAX];
+};
+
+struct log_ring {
+	/* Written by the logging thread */
+	uint32_t head ODP_ALIGNED_CACHE;
+	uint64_t drops;
+	/* Written by the logger thread */
+	uint32_t tail ODP_ALIGNED_CACHE;
+	uint64_t drops_reported;
+	struct log_slot slot[OFP_LOG_RING_SIZE] ODP_ALIGNED_CACHE;
+};
+
+struct ofp_log_mem {
+	odph_thread_t logger;
+	int logger_run;
+	int logger_started;
+	int num_ring;
+	struct log_ring ring[];
+};
+
+static __thread struct ofp_log_mem *shm;
+static __thread struct log_ring *log_ring;
+
+/* Messages per second per call site, usable before ofp_init_global() */
+static uint32_t log_rate = OFP_LOG_RATE;
+
+static uint64_t log_shm_size(int num_ring)
+{
+	return sizeof(struct ofp_log_mem) +
+		(uint64_t)num_ring * sizeof(struct log_ring);
+}
+
+/*
+ * Count the message in the one second window of the site. The first
+ * message of a window takes the number suppressed since the last
+ * message logged.
+ */
+static int log_site_allow(struct ofp_log_site *site, uint32_t *suppressed)
+{
+	struct timespec ts;
+	uint64_t w;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	w = __atomic_load_n(&site->window, __ATOMIC_RELAXED);
+	if (w != (uint64_t)ts.tv_sec &&
+	    __atomic_compare_exchange_n(&site->window, &w, ts.tv_sec, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&site->count, 1, __ATOMIC_RELAXED);
+		*suppressed = __atomic_exchange_n(&site->suppressed, 0,
+						  __ATOMIC_RELAXED);
+		return 1;
+	}
+
+	if (__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) <= log_rate)
+		return 1;
+
+	__atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+/*
+ * The ring slot of the next message, NULL if written directly. A full
+ * ring drops the message rather than block the thread on stderr.
+ */
+static struct log_slot *log_slot_get(int *full)
+{
+	struct log_ring *ring = log_ring;
+	uint32_t tail;
+
+	if (!ring || !__atomic_load_n(&shm->logger_run, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	if (ring->head - tail >= OFP_LOG_RING_SIZE) {
+		ring->drops++;
+		*full = 1;
+		return NULL;
+	}
+	return &ring->slot[ring->head & (OFP_LOG_RING_SIZE - 1)];
+}
+
+void ofp_log_printf(struct ofp_log_site *site, int level, const char *file,
+		    int line, const char *fmt, ...)
+{
+	struct log_slot *slot;
+	char buf[OFP_LOG_LINE_MAX];
+	uint32_t suppressed = 0;
+	int full = 0;
+	size_t n;
+	char *out;
+	va_list ap;
+
+	if (log_rate && !log_site_allow(site, &suppressed))
+		return;
+
+	slot = log_slot_get(&full);
+	if (full)
+		return;
+	out = slot ? slot->line : buf;
+
+	n = snprintf(out, OFP_LOG_LINE_MAX, "%s %d %d:%u %s:%d] ",
+		     (level == OFP_LOG_ERROR)   ? "E" :
+		     (level == OFP_LOG_WARNING) ? "W" :
+		     (level == OFP_LOG_INFO)    ? "I" :
+		     (level == OFP_LOG_DEBUG)   ? "D" : "?",
+		     ofp_timer_ticks(0), odp_cpu_id(),
+		     (unsigned int)pthread_self(), file, line);
+	if (n < OFP_LOG_LINE_MAX) {
+		va_start(ap, fmt);
+		n += vsnprintf(out + n, OFP_LOG_LINE_MAX - n, fmt, ap);
+		va_end(ap);
+	}
+	if (suppressed && n < OFP_LOG_LINE_MAX)
+		snprintf(out + n, OFP_LOG_LINE_MAX - n,
+			 " (%u similar messages suppressed)", suppressed);
+
+	if (!slot) {
+		fprintf(stderr, "%s\n", out);
+		return;
+	}
+	__atomic_store_n(&log_ring->head, log_ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/* Write the queued messages of all threads, returns their number */
+static int log_flush(void)
+{
+	struct log_ring *ring;
+	uint64_t drops;
+	uint32_t head;
+	int i, n = 0;
+
+	for (i = 0; i < shm->num_ring; i++) {
+		ring = &shm->ring[i];
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		while (ring->tail != head) {
+			fputs(ring->slot[ring->tail &
+					 (OFP_LOG_RING_SIZE - 1)].line, stderr);
+			fputc('\n', stderr);
+			__atomic_store_n(&ring->tail, ring->tail + 1,
+					 __ATOMIC_RELEASE);
+			n++;
+		}
+		drops = ring->drops - ring->drops_reported;
+		if (drops) {
+			fprintf(stderr, "W thread %d: %" PRIu64
+				" log messages dropped\n",
+				i, drops);
+			ring->drops_reported += drops;
+		}
+	}
+	if (n)
+		fflush(stderr);
+
+	return n;
+}
+
+static int log_logger(void *arg)
+{
+	shm = arg;
+
+	while (__atomic_load_n(&shm->logger_run, __ATOMIC_ACQUIRE)) {
+		if (!log_flush())
+			usleep(LOG_LOGGER_IDLE_US);
+	}
+	log_flush();
+
+	return 0;
+}
+
+int ofp_log_start_logger(const odp_cpumask_t *cpumask)
+{
+	odph_thread_common_param_t common_param;
+	odph_thread_param_t thr_params;
+
+	if (!shm)
+		return 0;
+
+	odph_thread_common_param_init(&common_param);
+	common_param.cpumask = cpumask;
+	odph_thread_param_init(&thr_params);
+	thr_params.start = log_logger;
+	thr_params.arg = shm;
+	thr_params.thr_type = ODP_THREAD_CONTROL;
+
+	shm->logger_run = 1;
+	if (odph_thread_create(&shm->logger, &common_param, &thr_params,
+			       1) != 1) {
+		shm->logger_run = 0;
+		OFP_ERR("Failed to start logger thread.");
+		return -1;
+	}
+	shm->logger_started = 1;
+
+	return 0;
+}
+
+void ofp_log_stop_logger(void)
+{
+	if (!shm || !shm->logger_started)
+		return;
+
+	__atomic_store_n(&shm->logger_run, 0, __ATOMIC_RELEASE);
+	odph_thread_join(&shm->logger, 1);
+	shm->logger_started = 0;
+	/* Messages queued while the logger exited */
+	log_flush();
+}
+
+int ofp_log_init_local(void)
+{
+	int thr = odp_thread_id();
+
+	log_ring = NULL;
+	if (shm && thr >= 0 && thr < shm->num_ring)
+		log_ring = &shm->ring[thr];
+
+	return 0;
+}
+
+void ofp_log_term_local(void)
+{
+	log_ring = NULL;
+}
+
+static int ofp_log_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_LOG,
+				      log_shm_size(odp_thread_count_max()));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_log_free_shared_memory(void)
+{
+	int rc = 0;
+
+	log_ring = NULL;
+	shm = NULL;
+	if (ofp_shared_memory_free(SHM_NAME_LOG) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	return rc;
+}
+
+int ofp_log_lookup_shared_memory(void)
+{
+	log_rate = global_param->logging.rate > 0 ?
+		global_param->logging.rate : 0;
+
+	if (!global_param->logging.async)
+		return 0;
+
+	shm = ofp_shared_memory_lookup(SHM_NAME_LOG);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_log_init_prepare(void)
+{
+	if (global_param->logging.async)
+		ofp_shared_memory_prealloc(SHM_NAME_LOG,
+					   log_shm_size(odp_thread_count_max()));
+}
+
+int ofp_log_init_global(void)
+{
+	log_rate = global_param->logging.rate > 0 ?
+		global_param->logging.rate : 0;
+
+	if (!global_param->logging.async)
+		return 0;
+
+	HANDLE_ERROR(ofp_log_alloc_shared_memory());
+
+	memset(shm, 0, log_shm_size(odp_thread_count_max()));
+	shm->num_ring = odp_thread_count_max();
+
+	return 0;
+}
+
+int ofp_log_term_global(void)
+{
+	int rc = 0;
+
+	if (!global_param->logging.async)
+		return 0;
+
+	if (!shm && ofp_log_lookup_shared_memory())
+		return -1;
+
+	ofp_log_stop_logger();
+	CHECK_ERROR(ofp_log_free_shared_memory(), rc);
+
+	return rc;
+}
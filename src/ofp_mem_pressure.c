@@ -0,0 +1,239 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_mem_pressure.h"
+#include "ofpi_config.h"
+#include "ofpi_init.h"
+#include "ofpi_log.h"
+#include "ofpi_shared_mem.h"
+#include "ofpi_timer.h"
+#include "ofpi_uma.h"
+#include "ofpi_util.h"
+
+#define SHM_NAME_MEM_PRESSURE "OfpMemPressureShMem"
+
+/* A level is left when the usage is this many percent below its mark */
+#define MEM_PRESSURE_HYST 5
+
+struct ofp_mem_pressure_mem {
+	odp_atomic_u32_t level;
+	int mark[OFP_MEM_PRESSURE_MAX];
+	uint64_t interval_us;
+	odp_timer_t tmr;
+	int running;
+	/* Last check: highest usage in percent and where */
+	int usage;
+	char where[ODP_POOL_NAME_LEN];
+	/* Times each level was entered from below */
+	uint64_t crossings[OFP_MEM_PRESSURE_MAX];
+};
+
+static __thread struct ofp_mem_pressure_mem *shm;
+
+__thread odp_atomic_u32_t *ofp_mem_pressure_lvl;
+
+int ofp_pkt_pool_in_use(odp_pool_t pool, uint32_t capacity,
+			uint64_t *in_use)
+{
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 30
+	odp_pool_capability_t capa;
+	odp_pool_stats_t st;
+	uint64_t avail;
+
+	/* ofp_pool_create() enabled the counters if there are any */
+	memset(&st, 0, sizeof(st));
+	if (pool == ODP_POOL_INVALID || odp_pool_capability(&capa) ||
+	    !capa.pkt.stats.bit.available || odp_pool_stats(pool, &st))
+		return -1;
+
+	avail = st.available + st.cache_available;
+	*in_use = capacity > avail ? capacity - avail : 0;
+	return 0;
+#else
+	(void)pool;
+	(void)capacity;
+	(void)in_use;
+	return -1;
+#endif
+}
+
+static void usage_max(const char *name, odp_pool_t pool, uint32_t capacity,
+		      int *max, const char **where)
+{
+	uint64_t in_use;
+	int usage;
+
+	if (!capacity || ofp_pkt_pool_in_use(pool, capacity, &in_use))
+		return;
+
+	usage = in_use * 100 / capacity;
+	if (usage > *max) {
+		*max = usage;
+		*where = name;
+	}
+}
+
+static void mem_pressure_check(void)
+{
+	const char *where = NULL;
+	int usage, level, cur;
+
+	usage = ofp_uma_usage_max(&where);
+	usage_max(SHM_PKT_POOL_NAME, ofp_packet_pool,
+		  global_param->pkt_pool.nb_pkts, &usage, &where);
+	usage_max(SHM_PKT_POOL_SMALL_NAME, ofp_packet_pool_small,
+		  global_param->pkt_pool.small_nb_pkts, &usage, &where);
+
+	cur = odp_atomic_load_u32(&shm->level);
+	level = usage >= shm->mark[OFP_MEM_PRESSURE_HIGH] ?
+		OFP_MEM_PRESSURE_HIGH :
+		usage >= shm->mark[OFP_MEM_PRESSURE_LOW] ?
+		OFP_MEM_PRESSURE_LOW : OFP_MEM_PRESSURE_NONE;
+	if (level < cur && usage + MEM_PRESSURE_HYST >= shm->mark[cur])
+		level = cur;
+
+	shm->usage = usage;
+	snprintf(shm->where, sizeof(shm->where), "%s", where ? where : "");
+
+	if (level == cur)
+		return;
+
+	if (level > cur) {
+		while (cur < level)
+			shm->crossings[++cur]++;
+		OFP_WARN("Memory pressure level %d, %s %d%% in use",
+			 level, shm->where, usage);
+	} else {
+		OFP_INFO("Memory pressure level %d, %s %d%% in use",
+			 level, shm->where, usage);
+	}
+	odp_atomic_store_u32(&shm->level, level);
+}
+
+static void mem_pressure_tmo(void *arg)
+{
+	(void)arg;
+
+	shm->tmr = ODP_TIMER_INVALID;
+	if (!shm->running)
+		return;
+
+	mem_pressure_check();
+
+	shm->tmr = ofp_timer_start(shm->interval_us, mem_pressure_tmo,
+				   NULL, 0);
+}
+
+void ofp_mem_pressure_print(int fd)
+{
+	if (!shm)
+		return;
+
+	if (!shm->running) {
+		ofp_sendf(fd, "memory pressure check disabled\r\n");
+		return;
+	}
+	ofp_sendf(fd, "memory pressure level=%u usage=%d%% (%s) "
+		  "low=%d%% high=%d%% crossings low=%" PRIu64
+		  " high=%" PRIu64 "\r\n",
+		  odp_atomic_load_u32(&shm->level), shm->usage, shm->where,
+		  shm->mark[OFP_MEM_PRESSURE_LOW],
+		  shm->mark[OFP_MEM_PRESSURE_HIGH],
+		  shm->crossings[OFP_MEM_PRESSURE_LOW],
+		  shm->crossings[OFP_MEM_PRESSURE_HIGH]);
+}
+
+static int ofp_mem_pressure_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_MEM_PRESSURE, sizeof(*shm));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_mem_pressure_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_MEM_PRESSURE) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	ofp_mem_pressure_lvl = NULL;
+	return rc;
+}
+
+int ofp_mem_pressure_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_MEM_PRESSURE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	ofp_mem_pressure_lvl = shm->running ? &shm->level : NULL;
+	return 0;
+}
+
+void ofp_mem_pressure_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_MEM_PRESSURE, sizeof(*shm));
+}
+
+int ofp_mem_pressure_init_global(struct mem_pressure_s *param)
+{
+	HANDLE_ERROR(ofp_mem_pressure_alloc_shared_memory());
+
+	memset(shm, 0, sizeof(*shm));
+	odp_atomic_init_u32(&shm->level, OFP_MEM_PRESSURE_NONE);
+	shm->tmr = ODP_TIMER_INVALID;
+
+	if (param->low <= 0 || param->low > 100 || param->interval_ms <= 0)
+		return 0;
+
+	shm->mark[OFP_MEM_PRESSURE_NONE] = 0;
+	shm->mark[OFP_MEM_PRESSURE_LOW] = param->low;
+	/* Without a high mark the high level is never reached */
+	shm->mark[OFP_MEM_PRESSURE_HIGH] = param->high > param->low ?
+		param->high : 101;
+	shm->interval_us = (uint64_t)param->interval_ms * 1000;
+	if (shm->interval_us > OFP_TIMER_MAX_US)
+		shm->interval_us = OFP_TIMER_MAX_US;
+
+	shm->running = 1;
+	ofp_mem_pressure_lvl = &shm->level;
+	shm->tmr = ofp_timer_start(shm->interval_us, mem_pressure_tmo,
+				   NULL, 0);
+	if (shm->tmr == ODP_TIMER_INVALID)
+		OFP_ERR("Memory pressure timer start failed");
+
+	return 0;
+}
+
+int ofp_mem_pressure_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_mem_pressure_lookup_shared_memory())
+		return -1;
+
+	shm->running = 0;
+	if (shm->tmr != ODP_TIMER_INVALID) {
+		ofp_timer_cancel(shm->tmr);
+		shm->tmr = ODP_TIMER_INVALID;
+	}
+
+	CHECK_ERROR(ofp_mem_pressure_free_shared_memory(), rc);
+
+	return rc;
+}
@@ -0,0 +1,194 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_module.h"
+#include "ofpi_in.h"
+#include "ofpi_igmp_var.h"
+#include "ofpi_vxlan.h"
+#include "ofpi_ipsec.h"
+#include "ofpi_log.h"
+
+/*
+ * The optional protocols. A module left out of the build has no entry,
+ * a disabled one costs a check of ofp_module_enabled() at the points
+ * where its packets or interfaces would appear, and nothing at init.
+ */
+
+#ifdef OFP_IGMP
+static int igmp_init_global(void)
+{
+	ofp_igmp_init();
+	return 0;
+}
+
+static int igmp_term_global(void)
+{
+	ofp_igmp_uninit(NULL);
+	return 0;
+}
+#endif /* OFP_IGMP */
+
+/*
+ * IPsec is set up without SAs and SPs when disabled, so that its API
+ * fails gracefully instead of using state that is not there.
+ */
+static void ipsec_param(struct ofp_ipsec_param *param)
+{
+	*param = global_param->ipsec;
+	if (!ofp_module_enabled(OFP_MODULE_IPSEC)) {
+		param->max_num_sa = 0;
+		param->max_num_sp = 0;
+	}
+}
+
+static void ipsec_init_prepare(void)
+{
+	struct ofp_ipsec_param param;
+
+	ipsec_param(&param);
+	ofp_ipsec_init_prepare(&param);
+}
+
+static int ipsec_init_global(void)
+{
+	struct ofp_ipsec_param param;
+
+	ipsec_param(&param);
+	return ofp_ipsec_init_global(&param);
+}
+
+static const struct ofp_module modules[] = {
+#ifdef OFP_IGMP
+	{
+		.name = "igmp",
+		.id = OFP_MODULE_IGMP,
+		.protocols = { OFP_IPPROTO_IGMP },
+		.init_global = igmp_init_global,
+		.term_global = igmp_term_global,
+	},
+#endif /* OFP_IGMP */
+	{
+		.name = "ipsec",
+		.id = OFP_MODULE_IPSEC,
+		/* Removed again by IPsec itself if it has no SAs */
+		.protocols = { OFP_IPPROTO_AH, OFP_IPPROTO_ESP },
+		.keep_api = 1,
+		.init_prepare = ipsec_init_prepare,
+		.init_global = ipsec_init_global,
+		.init_local = ofp_ipsec_init_local,
+		.term_local = ofp_ipsec_term_local,
+		.stop_global = ofp_ipsec_stop_global,
+		.term_drained = ofp_ipsec_term_global,
+	},
+#ifdef OFP_VXLAN
+	{
+		.name = "vxlan",
+		.id = OFP_MODULE_VXLAN,
+		.init_prepare = ofp_vxlan_init_prepare,
+		.init_global = ofp_vxlan_init_global,
+		.init_ifnet = ofp_set_vxlan_interface_queue,
+		.init_local = ofp_vxlan_lookup_shared_memory,
+		.term_ifnet = ofp_clean_vxlan_interface_queue,
+		.term_global = ofp_vxlan_term_global,
+	},
+#endif /* OFP_VXLAN */
+#ifdef OFP_GRE
+	{
+		.name = "gre",
+		.id = OFP_MODULE_GRE,
+		.protocols = { OFP_IPPROTO_GRE },
+	},
+#endif /* OFP_GRE */
+};
+
+#define NUM_MODULES (sizeof(modules) / sizeof(modules[0]))
+
+static int module_used(const struct ofp_module *m)
+{
+	return m->keep_api || ofp_module_enabled(m->id);
+}
+
+/* Init hooks stop at the first failure, term hooks are all called */
+#define MODULE_INIT(hook)						\
+int ofp_module_ ## hook(void)						\
+{									\
+	size_t i;							\
+									\
+	for (i = 0; i < NUM_MODULES; i++)				\
+		if (modules[i].hook && module_used(&modules[i]) &&	\
+		    modules[i].hook()) {				\
+			OFP_ERR("Module %s: " #hook " failed",		\
+				modules[i].name);			\
+			return -1;					\
+		}							\
+	return 0;							\
+}
+
+#define MODULE_TERM(hook)						\
+int ofp_module_ ## hook(void)						\
+{									\
+	size_t i;							\
+	int rc = 0;							\
+									\
+	for (i = 0; i < NUM_MODULES; i++)				\
+		if (modules[i].hook && module_used(&modules[i]) &&	\
+		    modules[i].hook()) {				\
+			OFP_ERR("Module %s: " #hook " failed",		\
+				modules[i].name);			\
+			rc = -1;					\
+		}							\
+	return rc;							\
+}
+
+int ofp_module_proto_disabled(uint8_t proto)
+{
+	size_t i, j;
+
+	for (i = 0; i < NUM_MODULES; i++)
+		for (j = 0; j < OFP_MODULE_PROTOS &&
+			     modules[i].protocols[j]; j++)
+			if (modules[i].protocols[j] == proto)
+				return !ofp_module_enabled(modules[i].id);
+	return 0;
+}
+
+void ofp_module_init_prepare(void)
+{
+	size_t i;
+
+	for (i = 0; i < NUM_MODULES; i++)
+		if (modules[i].init_prepare && module_used(&modules[i]))
+			modules[i].init_prepare();
+}
+
+int ofp_module_init_global(void)
+{
+	size_t i;
+
+	for (i = 0; i < NUM_MODULES; i++) {
+		if (!ofp_module_enabled(modules[i].id))
+			OFP_INFO("Module %s disabled", modules[i].name);
+		if (modules[i].init_global && module_used(&modules[i]) &&
+		    modules[i].init_global()) {
+			OFP_ERR("Module %s: init_global failed",
+				modules[i].name);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+MODULE_INIT(init_ifnet)
+MODULE_INIT(init_local)
+MODULE_TERM(term_local)
+MODULE_TERM(term_ifnet)
+MODULE_TERM(term_global)
+MODULE_TERM(stop_global)
+MODULE_TERM(term_drained)
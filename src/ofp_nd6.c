@@ -14,6 +14,7 @@
 #include "ofpi_protosw.h"
 #include "ofpi_route.h"
 #include "ofpi_pkt_processing.h" /* send_pkt_out */
+#include "ofpi_nd6_cache.h"
 
 
 void ofp_nd6_ns_input(odp_packet_t m, int off, int icmp6len)
@@ -32,17 +33,10 @@ void ofp_nd6_ns_input(odp_packet_t m, int off, int icmp6len)
 
 	if (icmp6->ofp_icmp6_data8[20] == OFP_ND_OPT_SOURCE_LINKADDR &&
 		!OFP_IN6_IS_ADDR_UNSPECIFIED(&ip6->ip6_src) &&
-		!OFP_IN6_IS_ADDR_LINKLOCAL(&ip6->ip6_src)) {
-		ofp_set_route6_params(OFP_ROUTE6_ADD, 0 /*vrf*/, ifp->vlan,
-				      ifp->port, ip6->ip6_src.ofp_s6_addr,
-				      128 /*masklen*/,
-				      ofp_in6addr_any.ofp_s6_addr,
-				      OFP_RTF_HOST);
-
-		ofp_add_mac6(ifp,
-			&ip6->ip6_src.ofp_s6_addr[0],
-			(uint8_t *)&eth->ether_shost);
-	}
+		!OFP_IN6_IS_ADDR_LINKLOCAL(&ip6->ip6_src))
+		ofp_nd6_cache_update(ifp, &ip6->ip6_src.ofp_s6_addr[0],
+				     (uint8_t *)&eth->ether_shost, FALSE,
+				     FALSE);
 }
 
 enum ofp_return_code ofp_nd6_ns_output(struct ofp_ifnet *dev,
@@ -160,17 +154,11 @@ void ofp_nd6_na_input(odp_packet_t m, int off, int icmp6len)
 	ip6 = (struct ofp_ip6_hdr *)odp_packet_l3_ptr(m, NULL);
 	icmp6 = (struct ofp_icmp6_hdr32 *)((uint8_t *)ip6 + off);
 
-	if (icmp6->ofp_icmp6_data8[20] == OFP_ND_OPT_TARGET_LINKADDR) {
-		ofp_set_route6_params(OFP_ROUTE6_ADD, 0 /*vrf*/, ifp->vlan,
-				      ifp->port, &icmp6->ofp_icmp6_data8[4],
-				      128 /*masklen*/,
-				      ofp_in6addr_any.ofp_s6_addr,
-				      OFP_RTF_HOST);
-
-		ofp_add_mac6(ifp,
-			&icmp6->ofp_icmp6_data8[4],
-			(uint8_t *)&eth->ether_shost);
-	}
+	if (icmp6->ofp_icmp6_data8[20] == OFP_ND_OPT_TARGET_LINKADDR)
+		ofp_nd6_cache_update(ifp, &icmp6->ofp_icmp6_data8[4],
+				     (uint8_t *)&eth->ether_shost,
+				     !!(icmp6->ofp_icmp6_data32[0] &
+					OFP_ND_NA_FLAG_SOLICITED), FALSE);
 }
 
 enum ofp_return_code ofp_nd6_na_output(struct ofp_ifnet *dev,
@@ -0,0 +1,681 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:	BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_util.h"
+#include "ofpi_log.h"
+#include "ofpi_hash.h"
+#include "ofpi_timer.h"
+#include "ofpi_icmp6.h"
+#include "ofpi_pkt_processing.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_nd6_cache.h"
+
+#define SHM_NAME_ND6 "OfpNd6ShMem"
+
+#define NUM_SETS (1 << global_param->nd6.hash_bits)
+/* Plus one because zeroth entry is used as the invalid entry. */
+#define NUM_ENTRIES (global_param->nd6.entries + 1)
+#define SIZEOF_ENTRIES (sizeof(struct nd6_entry) * NUM_ENTRIES)
+#define SIZEOF_SETS (sizeof(struct nd6_set) * NUM_SETS)
+#define SHM_SIZE_ND6 (sizeof(struct ofp_nd6_mem) + SIZEOF_ENTRIES + \
+		      SIZEOF_SETS)
+
+/* Packets waiting for resolution, in total and per neighbour */
+#define ND6_PENDING_PKTS 2048
+#define ND6_PENDING_MAX 16
+/* Time to wait for a Neighbor Advertisement (RFC 4861 RETRANS_TIMER) */
+#define ND6_RETRANS_NS (3 * NS_PER_SEC)
+#define ND6_AGE_INTERVAL_US US_PER_SEC
+
+enum nd6_state {
+	ND6_FREE = 0,
+	ND6_INCOMPLETE,		/* NS sent, no MAC yet */
+	ND6_REACHABLE,		/* Confirmed within reachable_time */
+	ND6_STALE,		/* MAC in use, not confirmed recently */
+	ND6_PROBE,		/* Stale, unicast NS sent */
+	ND6_PERMANENT		/* Added by ofp_add_mac6(), not aged */
+};
+
+static const char *const nd6_state_name[] = {
+	"free", "incomplete", "reachable", "stale", "probe", "permanent"
+};
+
+/*
+ * The size of this must be a multiple of 4 for the hash function.
+ */
+struct nd6_key {
+	uint32_t vrf;
+	uint8_t addr[16];
+};
+
+struct pkt6_entry {
+	odp_packet_t pkt;
+
+	OFP_SLIST_ENTRY(pkt6_entry) next;
+};
+
+struct pkt6_list {
+	struct pkt6_entry *slh_first;
+}; /* OFP_SLIST_HEAD */
+
+struct nd6_entry {
+	struct nd6_key key;
+	uint8_t state;
+	uint8_t num_pending;
+	uint8_t mac[OFP_ETHER_ADDR_LEN];
+	uint16_t port;
+	uint16_t vlan;
+	uint32_t next;		/* Next entry of the set, 0 terminates */
+	odp_time_t confirmed;	/* Last reachability confirmation */
+	odp_time_t probed;	/* Last NS */
+	struct pkt6_list pending;
+} ODP_ALIGNED_CACHE;
+
+/*
+ * Lookups do not take lock. Writers, holding lock, make seq odd for
+ * the duration of the update, and lookups retry if seq was odd or
+ * changed. Entries are never unmapped, so a lookup racing with an
+ * update reads stale but valid memory.
+ */
+struct nd6_set {
+	uint32_t head;
+	odp_atomic_u32_t seq;
+	odp_rwlock_t lock;
+} ODP_ALIGNED_CACHE;
+
+struct ofp_nd6_mem {
+	struct nd6_entry *entries;
+	struct nd6_set *set;
+	uint32_t free_head;
+	odp_rwlock_t free_lock;
+
+	struct pkt6_entry pkts[ND6_PENDING_PKTS];
+	struct pkt6_list free_pkts;
+	odp_spinlock_t pkt_lock;
+
+	odp_time_t reachable_time;
+	odp_time_t entry_timeout;
+	odp_timer_t age_timer;
+};
+
+static __thread struct ofp_nd6_mem *shm;
+
+static inline uint32_t nd6_set_key(uint16_t vrf, const uint8_t *addr,
+				   struct nd6_key *key)
+{
+	key->vrf = vrf;
+	memcpy(key->addr, addr, sizeof(key->addr));
+
+	return ofp_hash_key((const uint32_t *)key,
+			    sizeof(*key) / sizeof(uint32_t), 0) &
+		(NUM_SETS - 1);
+}
+
+static inline odp_bool_t nd6_key_equal(const struct nd6_key *a,
+				       const struct nd6_key *b)
+{
+	return a->vrf == b->vrf && !memcmp(a->addr, b->addr, sizeof(a->addr));
+}
+
+static inline void set_write_begin(struct nd6_set *set)
+{
+	odp_atomic_inc_u32(&set->seq);
+	odp_mb_release();
+}
+
+static inline void set_write_end(struct nd6_set *set)
+{
+	odp_mb_release();
+	odp_atomic_inc_u32(&set->seq);
+}
+
+/* Called with the lock of the set held, or in a seq protected read */
+static uint32_t nd6_find(struct nd6_set *set, const struct nd6_key *key)
+{
+	uint32_t idx = set->head;
+	int n = NUM_ENTRIES;
+
+	while (idx && idx < (uint32_t)NUM_ENTRIES && n--) {
+		if (nd6_key_equal(&shm->entries[idx].key, key))
+			return idx;
+		idx = shm->entries[idx].next;
+	}
+	return 0;
+}
+
+/*
+ * Lockless lookup. Returns the state of the entry and copies its MAC,
+ * or returns ND6_FREE if there is no entry or a writer was active.
+ */
+static inline int nd6_lookup(struct nd6_set *set, const struct nd6_key *key,
+			     uint32_t *hint, uint8_t *mac)
+{
+	struct nd6_entry *e;
+	uint32_t seq, idx;
+	int state;
+
+	seq = odp_atomic_load_acq_u32(&set->seq);
+	if (odp_unlikely(seq & 1))
+		return ND6_FREE;
+
+	idx = hint ? *hint : 0;
+	if (!idx || idx >= (uint32_t)NUM_ENTRIES ||
+	    !nd6_key_equal(&shm->entries[idx].key, key)) {
+		idx = nd6_find(set, key);
+		if (!idx)
+			return ND6_FREE;
+	}
+	e = &shm->entries[idx];
+	state = e->state;
+	memcpy(mac, e->mac, OFP_ETHER_ADDR_LEN);
+
+	odp_mb_acquire();
+	if (odp_atomic_load_u32(&set->seq) != seq)
+		return ND6_FREE;
+
+	if (hint && *hint != idx)
+		*hint = idx;
+	return state;
+}
+
+static uint32_t nd6_entry_alloc(void)
+{
+	uint32_t idx;
+
+	odp_rwlock_write_lock(&shm->free_lock);
+	idx = shm->free_head;
+	if (idx)
+		shm->free_head = shm->entries[idx].next;
+	odp_rwlock_write_unlock(&shm->free_lock);
+
+	return idx;
+}
+
+static void nd6_entry_free(uint32_t idx)
+{
+	odp_rwlock_write_lock(&shm->free_lock);
+	shm->entries[idx].next = shm->free_head;
+	shm->free_head = idx;
+	odp_rwlock_write_unlock(&shm->free_lock);
+}
+
+static struct pkt6_entry *pkt6_entry_alloc(void)
+{
+	struct pkt6_entry *p;
+
+	odp_spinlock_lock(&shm->pkt_lock);
+	p = OFP_SLIST_FIRST(&shm->free_pkts);
+	if (p)
+		OFP_SLIST_REMOVE_HEAD(&shm->free_pkts, next);
+	odp_spinlock_unlock(&shm->pkt_lock);
+
+	return p;
+}
+
+static void pkt6_entry_free(struct pkt6_entry *p)
+{
+	p->pkt = ODP_PACKET_INVALID;
+
+	odp_spinlock_lock(&shm->pkt_lock);
+	OFP_SLIST_INSERT_HEAD(&shm->free_pkts, p, next);
+	odp_spinlock_unlock(&shm->pkt_lock);
+}
+
+/*
+ * Unlink entry idx of the set, called with the set locked and between
+ * set_write_begin() and set_write_end(). The waiting packets are moved
+ * to list.
+ */
+static void nd6_unlink(struct nd6_set *set, uint32_t idx,
+		       struct pkt6_list *list)
+{
+	uint32_t *prev = &set->head;
+	struct nd6_entry *e = &shm->entries[idx];
+	struct pkt6_entry *p;
+
+	while (*prev && *prev != idx)
+		prev = &shm->entries[*prev].next;
+	if (*prev)
+		*prev = e->next;
+
+	while ((p = OFP_SLIST_FIRST(&e->pending))) {
+		OFP_SLIST_REMOVE_HEAD(&e->pending, next);
+		OFP_SLIST_INSERT_HEAD(list, p, next);
+	}
+	memset(&e->key, 0, sizeof(e->key));
+	e->state = ND6_FREE;
+	e->num_pending = 0;
+}
+
+static void pkt6_list_free(struct pkt6_list *list)
+{
+	struct pkt6_entry *p;
+
+	while ((p = OFP_SLIST_FIRST(list))) {
+		OFP_SLIST_REMOVE_HEAD(list, next);
+		odp_packet_free(p->pkt);
+		pkt6_entry_free(p);
+	}
+}
+
+/* Append pkt to the waiting packets of e, called with the set locked */
+static enum ofp_return_code nd6_hold(struct nd6_entry *e, odp_packet_t pkt)
+{
+	struct pkt6_entry *p, *last;
+
+	if (e->num_pending >= ND6_PENDING_MAX)
+		return OFP_PKT_DROP;
+	p = pkt6_entry_alloc();
+	if (!p)
+		return OFP_PKT_DROP;
+	p->pkt = pkt;
+	OFP_SLIST_NEXT(p, next) = NULL;
+
+	/* Kept in arrival order, the queue is short */
+	last = OFP_SLIST_FIRST(&e->pending);
+	if (!last) {
+		OFP_SLIST_INSERT_HEAD(&e->pending, p, next);
+	} else {
+		while (OFP_SLIST_NEXT(last, next))
+			last = OFP_SLIST_NEXT(last, next);
+		OFP_SLIST_INSERT_AFTER(last, p, next);
+	}
+	e->num_pending++;
+	return OFP_PKT_PROCESSED;
+}
+
+/*
+ * Slow part of ofp_nd6_resolve(): create or probe the entry and send a
+ * Neighbor Solicitation.
+ */
+static enum ofp_return_code nd6_resolve_slow(odp_packet_t pkt,
+					     struct ofp_ifnet *dev,
+					     uint8_t *addr, uint32_t *hint,
+					     uint8_t *mac)
+{
+	struct nd6_key key;
+	struct nd6_set *set;
+	struct nd6_entry *e;
+	enum ofp_return_code res = OFP_PKT_CONTINUE;
+	uint8_t daddr[16];
+	uint32_t idx, s;
+
+	s = nd6_set_key(dev->vrf, addr, &key);
+	set = &shm->set[s];
+
+	/* Unicast probes of stale entries, multicast otherwise */
+	memset(daddr, 0, sizeof(daddr));
+
+	odp_rwlock_write_lock(&set->lock);
+	idx = nd6_find(set, &key);
+	if (!idx) {
+		idx = nd6_entry_alloc();
+		if (!idx) {
+			odp_rwlock_write_unlock(&set->lock);
+			OFP_DBG("Neighbour cache full");
+			return OFP_PKT_DROP;
+		}
+		e = &shm->entries[idx];
+		set_write_begin(set);
+		e->key = key;
+		e->state = ND6_INCOMPLETE;
+		e->port = dev->port;
+		e->vlan = dev->vlan;
+		e->num_pending = 0;
+		OFP_SLIST_INIT(&e->pending);
+		memset(e->mac, 0, sizeof(e->mac));
+		e->probed = odp_time_global();
+		e->next = set->head;
+		set->head = idx;
+		set_write_end(set);
+		res = nd6_hold(e, pkt);
+	} else {
+		e = &shm->entries[idx];
+		switch (e->state) {
+		case ND6_INCOMPLETE:
+			/* NS already sent */
+			res = nd6_hold(e, pkt);
+			odp_rwlock_write_unlock(&set->lock);
+			return res;
+		case ND6_STALE:
+			set_write_begin(set);
+			e->state = ND6_PROBE;
+			e->probed = odp_time_global();
+			set_write_end(set);
+			memcpy(daddr, addr, sizeof(daddr));
+			memcpy(mac, e->mac, OFP_ETHER_ADDR_LEN);
+			break;
+		default:
+			/* Lost a race with a writer, nothing to send */
+			memcpy(mac, e->mac, OFP_ETHER_ADDR_LEN);
+			odp_rwlock_write_unlock(&set->lock);
+			if (hint)
+				*hint = idx;
+			return OFP_PKT_CONTINUE;
+		}
+	}
+	odp_rwlock_write_unlock(&set->lock);
+
+	if (hint)
+		*hint = idx;
+
+	if (ofp_nd6_ns_output(dev, daddr, addr) == OFP_PKT_DROP)
+		OFP_DBG("NS to %s failed", ofp_print_ip6_addr(addr));
+
+	return res;
+}
+
+enum ofp_return_code ofp_nd6_resolve(odp_packet_t pkt, struct ofp_ifnet *dev,
+				     uint8_t *addr, uint32_t *hint,
+				     uint8_t *mac)
+{
+	struct nd6_key key;
+	uint32_t s;
+	int state;
+
+	s = nd6_set_key(dev->vrf, addr, &key);
+	state = nd6_lookup(&shm->set[s], &key, hint, mac);
+
+	if (odp_likely(state == ND6_REACHABLE || state == ND6_PROBE ||
+		       state == ND6_PERMANENT))
+		return OFP_PKT_CONTINUE;
+
+	return nd6_resolve_slow(pkt, dev, addr, hint, mac);
+}
+
+void ofp_nd6_cache_update(struct ofp_ifnet *dev, uint8_t *addr,
+			  uint8_t *mac, odp_bool_t confirmed,
+			  odp_bool_t is_manual)
+{
+	struct pkt6_list send, list;
+	struct pkt6_entry *p;
+	struct nd6_key key;
+	struct nd6_set *set;
+	struct nd6_entry *e;
+	odp_bool_t changed;
+	uint32_t idx, s;
+
+	s = nd6_set_key(dev->vrf, addr, &key);
+	set = &shm->set[s];
+	OFP_SLIST_INIT(&list);
+
+	odp_rwlock_write_lock(&set->lock);
+	idx = nd6_find(set, &key);
+	if (!idx) {
+		idx = nd6_entry_alloc();
+		if (!idx) {
+			odp_rwlock_write_unlock(&set->lock);
+			OFP_DBG("Neighbour cache full");
+			return;
+		}
+		e = &shm->entries[idx];
+		set_write_begin(set);
+		e->key = key;
+		e->state = ND6_INCOMPLETE;
+		e->num_pending = 0;
+		OFP_SLIST_INIT(&e->pending);
+		e->next = set->head;
+		set->head = idx;
+	} else {
+		e = &shm->entries[idx];
+		if (e->state == ND6_PERMANENT && !is_manual) {
+			odp_rwlock_write_unlock(&set->lock);
+			return;
+		}
+		set_write_begin(set);
+	}
+
+	changed = memcmp(e->mac, mac, OFP_ETHER_ADDR_LEN) != 0 ||
+		e->port != dev->port || e->vlan != dev->vlan;
+	memcpy(e->mac, mac, OFP_ETHER_ADDR_LEN);
+	e->port = dev->port;
+	e->vlan = dev->vlan;
+	if (is_manual) {
+		e->state = ND6_PERMANENT;
+	} else if (confirmed) {
+		e->state = ND6_REACHABLE;
+		e->confirmed = odp_time_global();
+	} else if (e->state == ND6_INCOMPLETE || changed) {
+		/* RFC 4861 7.2.3: learned MACs are not confirmed */
+		e->state = ND6_STALE;
+		e->confirmed = odp_time_global();
+	}
+
+	/* Taken in arrival order */
+	while ((p = OFP_SLIST_FIRST(&e->pending))) {
+		OFP_SLIST_REMOVE_HEAD(&e->pending, next);
+		OFP_SLIST_INSERT_HEAD(&list, p, next);
+	}
+	e->num_pending = 0;
+	set_write_end(set);
+	odp_rwlock_write_unlock(&set->lock);
+
+	/* Forget cached Ethernet headers with the old MAC */
+	if (changed)
+		ofp_flow_cache_flush();
+
+	OFP_DBG("MAC %s for %s (%s)", ofp_print_mac(mac),
+		ofp_print_ip6_addr(addr),
+		ofp_port_vlan_to_ifnet_name(dev->port, dev->vlan));
+
+	/* Reverse back to arrival order */
+	OFP_SLIST_INIT(&send);
+	while ((p = OFP_SLIST_FIRST(&list))) {
+		OFP_SLIST_REMOVE_HEAD(&list, next);
+		OFP_SLIST_INSERT_HEAD(&send, p, next);
+	}
+	while ((p = OFP_SLIST_FIRST(&send))) {
+		OFP_SLIST_REMOVE_HEAD(&send, next);
+		if (ofp_ip6_output(p->pkt, NULL) == OFP_PKT_DROP)
+			odp_packet_free(p->pkt);
+		pkt6_entry_free(p);
+	}
+}
+
+void ofp_nd6_cache_age_cb(void *arg)
+{
+	struct pkt6_list drop;
+	odp_time_t now, retrans;
+	struct nd6_entry *e;
+	struct nd6_set *set;
+	uint32_t idx, next;
+	int flush = 0;
+	int i;
+
+	(void)arg;
+
+	now = odp_time_global();
+	retrans = odp_time_global_from_ns(ND6_RETRANS_NS);
+	OFP_SLIST_INIT(&drop);
+
+	for (i = 0; i < NUM_SETS; i++) {
+		set = &shm->set[i];
+		if (!set->head)
+			continue;
+
+		odp_rwlock_write_lock(&set->lock);
+		for (idx = set->head; idx; idx = next) {
+			e = &shm->entries[idx];
+			next = e->next;
+
+			switch (e->state) {
+			case ND6_REACHABLE:
+				if (odp_time_cmp(now, odp_time_sum(e->confirmed,
+						 shm->reachable_time)) > 0) {
+					set_write_begin(set);
+					e->state = ND6_STALE;
+					set_write_end(set);
+				}
+				continue;
+			case ND6_STALE:
+				if (odp_time_cmp(now, odp_time_sum(e->confirmed,
+						 shm->entry_timeout)) <= 0)
+					continue;
+				break;
+			case ND6_INCOMPLETE:
+			case ND6_PROBE:
+				/* No Neighbor Advertisement in time */
+				if (odp_time_cmp(now, odp_time_sum(e->probed,
+								   retrans)) <= 0)
+					continue;
+				break;
+			default:
+				continue;
+			}
+
+			flush |= (e->state != ND6_INCOMPLETE);
+			set_write_begin(set);
+			nd6_unlink(set, idx, &drop);
+			set_write_end(set);
+			nd6_entry_free(idx);
+		}
+		odp_rwlock_write_unlock(&set->lock);
+	}
+
+	pkt6_list_free(&drop);
+	if (flush)
+		ofp_flow_cache_flush();
+
+	shm->age_timer = ofp_timer_start(ND6_AGE_INTERVAL_US,
+					 ofp_nd6_cache_age_cb, NULL, 0);
+}
+
+void ofp_nd6_cache_show(int fd)
+{
+	struct nd6_entry *e;
+	int i;
+
+	ofp_sendf(fd, "VRF  ADDRESS                                  "
+		  "MAC                IFACE   STATE       PENDING\r\n");
+
+	for (i = 1; i < NUM_ENTRIES; i++) {
+		e = &shm->entries[i];
+		if (e->state == ND6_FREE)
+			continue;
+		ofp_sendf(fd, "%-3u  %-39s  %s  %-6s  %-10s  %u\r\n",
+			  e->key.vrf, ofp_print_ip6_addr(e->key.addr),
+			  ofp_print_mac(e->mac),
+			  ofp_port_vlan_to_ifnet_name(e->port, e->vlan),
+			  nd6_state_name[e->state], e->num_pending);
+	}
+}
+
+static int ofp_nd6_cache_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_ND6, SHM_SIZE_ND6);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_nd6_cache_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_ND6) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_nd6_cache_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_ND6);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_nd6_cache_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_ND6, SHM_SIZE_ND6);
+}
+
+int ofp_nd6_cache_init_global(void)
+{
+	int i;
+
+	if (global_param->nd6.entries < 1 || global_param->nd6.hash_bits < 0 ||
+	    global_param->nd6.hash_bits > 24) {
+		OFP_ERR("Invalid nd6 parameters");
+		return -1;
+	}
+
+	HANDLE_ERROR(ofp_nd6_cache_alloc_shared_memory());
+
+	memset(shm, 0, SHM_SIZE_ND6);
+	shm->entries = (struct nd6_entry *)((char *)shm + sizeof(*shm));
+	shm->set = (struct nd6_set *)((char *)shm->entries + SIZEOF_ENTRIES);
+	shm->age_timer = ODP_TIMER_INVALID;
+
+	for (i = 0; i < NUM_SETS; i++) {
+		odp_rwlock_init(&shm->set[i].lock);
+		odp_atomic_init_u32(&shm->set[i].seq, 0);
+	}
+
+	odp_rwlock_init(&shm->free_lock);
+	for (i = NUM_ENTRIES - 1; i > 0; i--) {
+		OFP_SLIST_INIT(&shm->entries[i].pending);
+		shm->entries[i].next = shm->free_head;
+		shm->free_head = i;
+	}
+
+	odp_spinlock_init(&shm->pkt_lock);
+	OFP_SLIST_INIT(&shm->free_pkts);
+	for (i = ND6_PENDING_PKTS - 1; i >= 0; i--) {
+		shm->pkts[i].pkt = ODP_PACKET_INVALID;
+		OFP_SLIST_INSERT_HEAD(&shm->free_pkts, &shm->pkts[i], next);
+	}
+
+	shm->reachable_time = odp_time_global_from_ns(
+		(uint64_t)global_param->nd6.reachable_time * NS_PER_SEC);
+	shm->entry_timeout = odp_time_global_from_ns(
+		(uint64_t)global_param->nd6.entry_timeout * NS_PER_SEC);
+
+	shm->age_timer = ofp_timer_start(ND6_AGE_INTERVAL_US,
+					 ofp_nd6_cache_age_cb, NULL, 0);
+	if (shm->age_timer == ODP_TIMER_INVALID) {
+		OFP_ERR("Failed to create neighbour cache age timer");
+		return -1;
+	}
+
+	return 0;
+}
+
+int ofp_nd6_cache_term_global(void)
+{
+	struct pkt6_list drop;
+	int i, rc = 0;
+
+	if (ofp_nd6_cache_lookup_shared_memory())
+		return -1;
+
+	if (shm->age_timer != ODP_TIMER_INVALID)
+		CHECK_ERROR(ofp_timer_cancel(shm->age_timer), rc);
+
+	OFP_SLIST_INIT(&drop);
+	for (i = 0; i < NUM_SETS; i++)
+		while (shm->set[i].head)
+			nd6_unlink(&shm->set[i], shm->set[i].head, &drop);
+	pkt6_list_free(&drop);
+
+	CHECK_ERROR(ofp_nd6_cache_free_shared_memory(), rc);
+
+	return rc;
+}
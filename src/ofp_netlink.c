@@ -37,10 +37,13 @@
 #include "ofpi_rt_lookup.h"
 #include "ofpi_pkt_processing.h"
 #include "ofpi_route.h"
+#include "ofpi_flow_cache.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
 #include "ofpi_netlink.h"
 #include "ofpi_init.h"
+#include "ofpi_hash.h"
+#include "ofpi_ip.h"
 
 #define ARPHRD_VXLAN 799
 #define NETNS_RUN_DIR "/var/run/netns"
@@ -53,9 +56,272 @@ static struct {
 static int sock_cnt = 0;
 #define ALLVRF ((int)0xffffffff)
 
-#define BUFFER_SIZE 4096
+#define BUFFER_SIZE 65536
 static char buffer[BUFFER_SIZE];
 
+/*
+ * Route messages are collected while the netlink socket has data and
+ * applied with ofp_set_route_msgs_each(), so that a route flood is
+ * programmed in sorted batches.
+ *
+ * Churn for the same prefix is coalesced on the way in. A pending
+ * addition is replaced by a later addition or deletion of the prefix,
+ * and repeated deletions collapse into one. A deletion followed by an
+ * addition keeps both, as the deletion releases the old next hop.
+ */
+#define ROUTE_BATCH_SIZE 16384
+#define ROUTE_HASH_SIZE (2 * ROUTE_BATCH_SIZE)
+#define ROUTE_NONE -1
+
+struct route_pending {
+	int add;
+	int del;
+};
+
+static struct ofp_route_msg route_batch[ROUTE_BATCH_SIZE];
+static int route_batch_num;
+static struct route_pending route_hash[ROUTE_HASH_SIZE];
+static int route_hash_used[ROUTE_BATCH_SIZE];
+static int route_hash_num;
+
+static int route_msg_is_v6(const struct ofp_route_msg *msg)
+{
+	return msg->type == OFP_ROUTE6_ADD || msg->type == OFP_ROUTE6_DEL;
+}
+
+static int route_msg_is_add(const struct ofp_route_msg *msg)
+{
+	return msg->type == OFP_ROUTE_ADD || msg->type == OFP_ROUTE6_ADD;
+}
+
+static int route_msg_same_prefix(const struct ofp_route_msg *a,
+				 const struct ofp_route_msg *b)
+{
+	if (a->vrf != b->vrf || a->masklen != b->masklen ||
+	    route_msg_is_v6(a) != route_msg_is_v6(b))
+		return 0;
+
+	if (route_msg_is_v6(a))
+		return !memcmp(a->dst6, b->dst6, sizeof(a->dst6));
+
+	return a->dst == b->dst;
+}
+
+static uint32_t route_msg_hash(const struct ofp_route_msg *msg)
+{
+	uint32_t key[5];
+
+	key[0] = (uint32_t)msg->vrf << 16 | msg->masklen << 1 |
+		route_msg_is_v6(msg);
+	if (route_msg_is_v6(msg)) {
+		memcpy(&key[1], msg->dst6, sizeof(msg->dst6));
+		return ofp_hash_key(key, 5, 0);
+	}
+	key[1] = msg->dst;
+	return ofp_hash_key(key, 2, 0);
+}
+
+/* Slot of the prefix of msg, free if the prefix has no pending message */
+static struct route_pending *route_hash_slot(const struct ofp_route_msg *msg)
+{
+	uint32_t i = route_msg_hash(msg) & (ROUTE_HASH_SIZE - 1);
+
+	for (;; i = (i + 1) & (ROUTE_HASH_SIZE - 1)) {
+		struct route_pending *slot = &route_hash[i];
+		int idx = slot->add != ROUTE_NONE ? slot->add : slot->del;
+
+		if (idx == ROUTE_NONE) {
+			route_hash_used[route_hash_num++] = i;
+			return slot;
+		}
+		if (route_msg_same_prefix(&route_batch[idx], msg))
+			return slot;
+	}
+}
+
+/* Returns the number of route messages that could not be applied */
+static int route_batch_flush(void)
+{
+	int i, num = 0, failed = 0;
+
+	for (i = 0; i < route_batch_num; i++)
+		if (route_batch[i].type)
+			route_batch[num++] = route_batch[i];
+
+	if (num)
+		failed = ofp_set_route_msgs_each(route_batch, num);
+	if (failed)
+		OFP_WARN("%d of %d route messages not applied", failed, num);
+
+	for (i = 0; i < route_hash_num; i++) {
+		route_hash[route_hash_used[i]].add = ROUTE_NONE;
+		route_hash[route_hash_used[i]].del = ROUTE_NONE;
+	}
+	route_hash_num = 0;
+	route_batch_num = 0;
+	return failed;
+}
+
+static void route_batch_init(void)
+{
+	memset(route_hash, 0xff, sizeof(route_hash));
+	route_hash_num = 0;
+	route_batch_num = 0;
+}
+
+static void route_batch_add(struct ofp_route_msg *msg)
+{
+	struct route_pending *slot = route_hash_slot(msg);
+
+	/* A later message overrides a pending addition */
+	if (slot->add != ROUTE_NONE) {
+		route_batch[slot->add].type = 0;
+		slot->add = ROUTE_NONE;
+	}
+
+	if (route_msg_is_add(msg)) {
+		slot->add = route_batch_num;
+	} else {
+		if (slot->del != ROUTE_NONE)
+			return;
+		slot->del = route_batch_num;
+	}
+
+	route_batch[route_batch_num++] = *msg;
+	if (route_batch_num == ROUTE_BATCH_SIZE)
+		route_batch_flush();
+}
+
+/*
+ * IPv4 multipath routes are installed with a next hop group each. A
+ * new route message for a known prefix replaces the members of its
+ * group, which keeps the flows of unchanged members on their next hop.
+ */
+struct mp_route {
+	uint32_t dst;
+	uint16_t vrf;
+	uint16_t masklen;
+	int32_t group;
+};
+
+static struct mp_route mp_routes[OFP_NUM_NH_GROUPS];
+static int mp_route_num;
+
+static struct mp_route *mp_route_find(int vrf, uint32_t dst, int masklen)
+{
+	int i;
+
+	for (i = 0; i < mp_route_num; i++)
+		if (mp_routes[i].vrf == vrf && mp_routes[i].dst == dst &&
+		    mp_routes[i].masklen == masklen)
+			return &mp_routes[i];
+	return NULL;
+}
+
+/* Members of RTA_MULTIPATH, a next hop of weight w taking w entries */
+static int mp_route_members(struct rtnexthop *rtnh, int len,
+			    struct ofp_nh_group_member *m)
+{
+	int num = 0;
+
+	for (; RTNH_OK(rtnh, len); len -= NLMSG_ALIGN(rtnh->rtnh_len),
+		     rtnh = RTNH_NEXT(rtnh)) {
+		struct ofp_ifnet *dev;
+		struct rtattr *rta = RTNH_DATA(rtnh);
+		int alen = rtnh->rtnh_len - sizeof(*rtnh);
+		uint32_t gw = 0;
+		int w;
+
+		dev = ofp_get_ifnet_by_linux_ifindex(rtnh->rtnh_ifindex);
+		if (!dev) {
+			OFP_DBG(" - Cannot find dev ix=%d", rtnh->rtnh_ifindex);
+			continue;
+		}
+		for (; RTA_OK(rta, alen); rta = RTA_NEXT(rta, alen))
+			if (rta->rta_type == RTA_GATEWAY &&
+			    RTA_PAYLOAD(rta) == 4)
+				gw = *((uint32_t *)RTA_DATA(rta));
+
+		for (w = 0; w <= rtnh->rtnh_hops && num < OFP_NH_GROUP_MAX;
+		     w++) {
+			m[num].gw = gw;
+			m[num].port = dev->port;
+			m[num].vlan = dev->vlan;
+			num++;
+		}
+	}
+	return num;
+}
+
+static void mp_route_add(int vrf, uint32_t dst, int masklen,
+			 struct rtnexthop *rtnh, int len)
+{
+	struct ofp_nh_group_member m[OFP_NH_GROUP_MAX];
+	struct mp_route *r = mp_route_find(vrf, dst, masklen);
+	struct ofp_route_msg msg;
+	int num;
+
+	num = mp_route_members(rtnh, len, m);
+	if (!num)
+		return;
+
+	if (r) {
+		ofp_nh_group_set(vrf, r->group, m, num);
+		return;
+	}
+
+	if (mp_route_num == OFP_NUM_NH_GROUPS) {
+		OFP_ERR("Too many multipath routes");
+		return;
+	}
+	r = &mp_routes[mp_route_num];
+	r->group = ofp_nh_group_alloc();
+	if (r->group < 0)
+		return;
+	if (ofp_nh_group_set(vrf, r->group, m, num)) {
+		ofp_nh_group_del(r->group);
+		return;
+	}
+	r->vrf = vrf;
+	r->dst = dst;
+	r->masklen = masklen;
+	mp_route_num++;
+
+	/* Pending messages of the prefix go first */
+	route_batch_flush();
+	memset(&msg, 0, sizeof(msg));
+	msg.type = OFP_ROUTE_ADD;
+	msg.vrf = vrf;
+	msg.dst = dst;
+	msg.masklen = masklen;
+	msg.gw = r->group;
+	msg.port = m[0].port;
+	msg.vlan = m[0].vlan;
+	msg.flags = OFP_RTF_GATEWAY | OFP_RTF_MULTIPATH;
+	ofp_set_route_msg(&msg);
+}
+
+static int mp_route_del(int vrf, uint32_t dst, int masklen)
+{
+	struct mp_route *r = mp_route_find(vrf, dst, masklen);
+	struct ofp_route_msg msg;
+
+	if (!r)
+		return -1;
+
+	route_batch_flush();
+	memset(&msg, 0, sizeof(msg));
+	msg.type = OFP_ROUTE_DEL;
+	msg.vrf = vrf;
+	msg.dst = dst;
+	msg.masklen = masklen;
+	ofp_set_route_msg(&msg);
+
+	ofp_nh_group_del(r->group);
+	*r = mp_routes[--mp_route_num];
+	return 0;
+}
+
 #ifdef NETLINK_DEBUG
 static const char *rtm_msgtype_to_string(unsigned short type)
 {
@@ -89,7 +355,8 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 	char *dst6 = NULL, *gw6 = NULL;
 	struct rtmsg *rtp;
 	struct rtattr *rtap;
-	int rtl;
+	struct rtnexthop *mp = NULL;
+	int rtl, mp_len = 0;
 
 
 	/* get route entry header */
@@ -159,6 +426,11 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 			ix = *((uint32_t *) RTA_DATA(rtap));
 			sprintf(ifs, "%d", *((int *) RTA_DATA(rtap)));
 			OFP_DBG(" - Interface: %d", ix);
+			break;
+		case RTA_MULTIPATH:
+			mp = RTA_DATA(rtap);
+			mp_len = RTA_PAYLOAD(rtap);
+			break;
 		default:
 			break;
 		}
@@ -172,6 +444,18 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 		   (nlp->nlmsg_type == RTM_NEWROUTE)?"NEW":"DEL",
 		   dsts, ms, gws, ix, dst_len);
 
+	if (dst_len != 16) {
+		if (nlp->nlmsg_type == RTM_NEWROUTE && mp) {
+			mp_route_add(vrf, destination, rtp->rtm_dst_len,
+				     mp, mp_len);
+			return 0;
+		}
+		/* A single path route replaces a multipath one */
+		if (!mp_route_del(vrf, destination, rtp->rtm_dst_len) &&
+		    nlp->nlmsg_type != RTM_NEWROUTE)
+			return 0;
+	}
+
 	if (nlp->nlmsg_type == RTM_NEWROUTE) {
 		struct ofp_ifnet *dev = ofp_get_ifnet_by_linux_ifindex(ix);
 
@@ -188,7 +472,7 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 					msg.masklen = rtp->rtm_dst_len;
 					msg.gw = gateway;
 					msg.flags = OFP_RTF_GATEWAY;
-					ofp_set_route_msg(&msg);
+					route_batch_add(&msg);
 				} else if (dst6) {
 					msg.type = OFP_ROUTE6_ADD;
 					memcpy(msg.dst6, dst6, dst_len);
@@ -198,7 +482,7 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 					else
 						memset(msg.gw6, 0, 16);
 					msg.flags = OFP_RTF_GATEWAY;
-					ofp_set_route_msg(&msg);
+					route_batch_add(&msg);
 				}
 			} else if (dst_len == 0) {
 				/* default route */
@@ -208,7 +492,7 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 				msg.gw = gateway;
 				msg.port = dev->port;
 				msg.vlan = dev->vlan;
-				ofp_set_route_msg(&msg);
+				route_batch_add(&msg);
 			}
 		} else
 			OFP_DBG(" - Cannot find dev ix=%d", ix);
@@ -233,7 +517,7 @@ static int handle_ipv4v6_route(struct nlmsghdr *nlp, int vrf)
 					msg.dst = destination;
 				msg.masklen = rtp->rtm_dst_len;
 			}
-			ofp_set_route_msg(&msg);
+			route_batch_add(&msg);
 		} else
 			OFP_DBG(" - Cannot find dev ix=%d", ix);
 	}
@@ -332,14 +616,16 @@ static int del_ipv4v6_addr(struct ifaddrmsg *if_entry, struct ofp_ifnet *dev,
 
 		OFP_DBG("DEL ADDR addr=%x laddr=%x", *((uint32_t *)addr),
 			*((uint32_t *)laddr));
-		int idx = ofp_ifnet_ip_find(dev, *((uint32_t *)addr));
-		if (-1 == idx)
+		struct ofp_ifnet_ipaddr *ia;
+
+		ia = ofp_ifnet_ip_get(dev, *((uint32_t *)addr));
+		if (!ia)
 			OFP_INFO("Ip addr %s not found.\n", ofp_print_ip_addr(*((uint32_t *)addr)));
 		else {
 			ofp_set_route_params(
 					OFP_ROUTE_DEL, dev->vrf, dev->vlan,dev->port,
 					*((uint32_t *)addr),
-					dev->ip_addr_info[idx].masklen, 0 /*gw*/, 0);
+					ia->masklen, 0 /*gw*/, 0);
 			ofp_set_route_params(
 					OFP_ROUTE_DEL, dev->vrf, dev->vlan,dev->port,
 					*((uint32_t *)addr),
@@ -570,6 +856,7 @@ static int add_link(struct ifinfomsg *ifinfo_entry, int vlan, int link,
 			dev->ip_p2p = tun_rem;
 			dev->pkt_pool = ofp_packet_pool;
 			dev->if_type = OFP_IFT_VXLAN;
+			ofp_ip4_feat_update(1);
 		} else {
 			if (tun_loc)
 				dev->ip_local = tun_loc;
@@ -580,10 +867,12 @@ static int add_link(struct ifinfomsg *ifinfo_entry, int vlan, int link,
 		dev = ofp_get_ifnet_by_linux_ifindex(ifinfo_entry->ifi_index);
 	}
 
-	if (mtu && dev != NULL) {
+	if (mtu && dev != NULL && dev->if_mtu != mtu) {
 		OFP_DBG(" - Interface updated OIF=%d MTU=%u",
 			ifinfo_entry->ifi_index, mtu);
 		dev->if_mtu = mtu;
+		/* Cached outputs were checked against the old MTU */
+		ofp_flow_cache_flush();
 	}
 
 	return 0;
@@ -832,6 +1121,21 @@ static int handle_ifinfo(struct nlmsghdr *nlh, int vrf)
 	return 0;
 }
 
+void ofp_netlink_route_init(void)
+{
+	route_batch_init();
+}
+
+void ofp_netlink_route_add(struct nlmsghdr *nlh, int vrf)
+{
+	handle_ipv4v6_route(nlh, vrf);
+}
+
+int ofp_netlink_route_flush(void)
+{
+	return route_batch_flush();
+}
+
 static void route_read(int nll, int vrf)
 {
 	struct  nlmsghdr *nlh = (struct nlmsghdr *) buffer;
@@ -852,11 +1156,13 @@ static void route_read(int nll, int vrf)
 
 		case RTM_NEWADDR:
 		case RTM_DELADDR:
+			route_batch_flush();
 			handle_ipv4v6_addr(nlh, vrf);
 			break;
 
 		case RTM_NEWLINK:
 		case RTM_DELLINK:
+			route_batch_flush();
 			handle_ifinfo(nlh, vrf);
 			break;
 
@@ -870,7 +1176,7 @@ static void route_read(int nll, int vrf)
 
 static int route_recv(int fd, int vrf)
 {
-	int rtn;
+	int rtn, len;
 	struct iovec iov;
 	struct sockaddr_nl sa;
 	struct msghdr msg;
@@ -885,8 +1191,15 @@ static int route_recv(int fd, int vrf)
 	msg.msg_iovlen = 1;
 
 	rtn = recvmsg(fd, &msg, 0);
-	if (rtn > 0)
-		route_read(rtn, vrf);
+	len = rtn;
+	while (len > 0) {
+		route_read(len, vrf);
+
+		/* Drain the socket before applying the collected routes */
+		bzero(buffer, sizeof(buffer));
+		len = recvmsg(fd, &msg, MSG_DONTWAIT);
+	}
+	route_batch_flush();
 
 	return rtn;
 }
@@ -914,6 +1227,7 @@ int start_netlink_nl_server(void *arg)
 	}
 
 	FD_ZERO(&read_fd);
+	route_batch_init();
 
 	ofp_create_ns_socket(ALLVRF);
 
@@ -0,0 +1,456 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_nh_group.h"
+#include "ofpi_arp.h"
+#include "ofpi_hash.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+#include "ofpi_rcu.h"
+
+#include "api/ofp_route_arp.h"
+
+#define SHM_NAME_NH_GROUP "OfpNhGroupShMem"
+
+/* Old and new members coexist while the buckets move */
+#define NH_GROUP_SLOTS (2 * OFP_NH_GROUP_MAX)
+#define NH_SLOT_INVALID 0xff
+
+/*
+ * Shared data
+ *
+ * Lookups hold a member without locks. A member slot left unused by a
+ * change, and a freed group, are reused only after the RCU readers
+ * have passed a quiescent state.
+ */
+struct nh_group {
+	uint8_t bucket[OFP_NH_GROUP_BUCKETS];
+	struct ofp_nh_entry member[NH_GROUP_SLOTS];
+	uint8_t used[NH_GROUP_SLOTS];
+	uint64_t retired[NH_GROUP_SLOTS];
+	uint64_t epoch;
+	uint32_t ref_count;
+	uint16_t vrf;
+	uint8_t num;
+	uint8_t allocated;
+	uint8_t deleted;
+} ODP_ALIGNED_CACHE;
+
+struct ofp_nh_group_mem {
+	struct nh_group group[OFP_NUM_NH_GROUPS];
+	odp_spinlock_t lock;
+};
+
+/*
+ * Data per thread
+ */
+static __thread struct ofp_nh_group_mem *shm;
+
+static int member_arp_get(uint16_t vrf, struct ofp_nh_entry *nh)
+{
+#ifndef OFP_USE_LIBCK
+	uint8_t eth_addr[OFP_ETHER_ADDR_LEN];
+
+	memset(eth_addr, 0, sizeof(eth_addr));
+	if (ofp_ipv4_lookup_arp_entry_idx(nh->gw, vrf, &nh->arp_ent_idx) < 0 &&
+	    ofp_arp_ipv4_insert_entry(nh->gw, eth_addr, vrf, FALSE, FALSE,
+				      &nh->arp_ent_idx, FALSE) < 0) {
+		OFP_DBG("ARP insert failure in next hop group.");
+		return -1;
+	}
+	ofp_arp_inc_ref_count(nh->arp_ent_idx);
+#else
+	(void)vrf;
+	(void)nh;
+#endif
+	return 0;
+}
+
+static void member_arp_put(struct ofp_nh_entry *nh)
+{
+#ifndef OFP_USE_LIBCK
+	ofp_arp_dec_ref_count(nh->arp_ent_idx);
+#else
+	(void)nh;
+#endif
+}
+
+/* Buckets and members stay intact for the readers still using them */
+static void group_free(struct nh_group *g)
+{
+	int s;
+
+	for (s = 0; s < NH_GROUP_SLOTS; s++)
+		if (g->used[s])
+			member_arp_put(&g->member[s]);
+	memset(g->used, 0, sizeof(g->used));
+	g->ref_count = 0;
+	g->num = 0;
+	g->allocated = 0;
+	g->deleted = 0;
+	g->epoch = ofp_rcu_epoch();
+	ofp_rcu_advance();
+}
+
+int32_t ofp_nh_group_alloc(void)
+{
+	int32_t i, ret = -1;
+
+	odp_spinlock_lock(&shm->lock);
+	for (i = 0; i < OFP_NUM_NH_GROUPS; i++) {
+		struct nh_group *g = &shm->group[i];
+
+		if (g->allocated || !ofp_rcu_is_safe(g->epoch))
+			continue;
+		memset(g, 0, sizeof(*g));
+		memset(g->bucket, NH_SLOT_INVALID, sizeof(g->bucket));
+		g->allocated = 1;
+		ret = i;
+		break;
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	if (ret < 0)
+		OFP_ERR("Out of next hop groups");
+	return ret;
+}
+
+static int find_slot(struct nh_group *g, const struct ofp_nh_group_member *m)
+{
+	int s;
+
+	for (s = 0; s < NH_GROUP_SLOTS; s++)
+		if (g->used[s] && g->member[s].gw == m->gw &&
+		    g->member[s].port == m->port &&
+		    g->member[s].vlan == m->vlan)
+			return s;
+	return -1;
+}
+
+static int free_slot(struct nh_group *g, const uint8_t *keep)
+{
+	int s;
+
+	for (s = 0; s < NH_GROUP_SLOTS; s++)
+		if (!g->used[s] && !keep[s] && ofp_rcu_is_safe(g->retired[s]))
+			return s;
+	return -1;
+}
+
+/*
+ * Give each new member an equal share of the buckets. Buckets of kept
+ * members stay where they are up to the member's share, so only the
+ * buckets of removed members and the surplus needed by added members
+ * change their next hop.
+ */
+static void rebalance(struct nh_group *g, const int *slot, int num,
+		      const uint8_t *keep)
+{
+	uint16_t quota[NH_GROUP_SLOTS];
+	uint16_t count[NH_GROUP_SLOTS];
+	uint8_t move[OFP_NH_GROUP_BUCKETS];
+	int b, i, next = 0;
+
+	memset(quota, 0, sizeof(quota));
+	memset(count, 0, sizeof(count));
+	for (i = 0; i < num; i++)
+		quota[slot[i]] = OFP_NH_GROUP_BUCKETS / num +
+			(i < OFP_NH_GROUP_BUCKETS % num);
+
+	for (b = 0; b < OFP_NH_GROUP_BUCKETS; b++) {
+		uint8_t s = g->bucket[b];
+
+		move[b] = (s == NH_SLOT_INVALID || !keep[s] ||
+			   count[s] >= quota[s]);
+		if (!move[b])
+			count[s]++;
+	}
+
+	for (b = 0; b < OFP_NH_GROUP_BUCKETS; b++) {
+		uint8_t s = NH_SLOT_INVALID;
+
+		if (!move[b])
+			continue;
+		if (num) {
+			while (count[slot[next]] >= quota[slot[next]])
+				next++;
+			s = slot[next];
+			count[s]++;
+		}
+		__atomic_store_n(&g->bucket[b], s, __ATOMIC_RELEASE);
+	}
+}
+
+int ofp_nh_group_set(uint16_t vrf, int32_t group,
+		     const struct ofp_nh_group_member *members, int num)
+{
+	uint8_t keep[NH_GROUP_SLOTS];
+	int slot[OFP_NH_GROUP_MAX];
+	struct nh_group *g;
+	int i, s, retired = 0, ret = 0;
+
+	if (group < 0 || group >= OFP_NUM_NH_GROUPS ||
+	    num < 0 || num > OFP_NH_GROUP_MAX) {
+		OFP_ERR("Invalid next hop group %d or member count %d",
+			group, num);
+		return -1;
+	}
+
+	odp_spinlock_lock(&shm->lock);
+
+	g = &shm->group[group];
+	if (!g->allocated || g->deleted) {
+		OFP_ERR("Next hop group %d not allocated", group);
+		ret = -1;
+		goto out;
+	}
+	if (g->num && g->vrf != vrf) {
+		OFP_ERR("Next hop group %d belongs to VRF %d", group, g->vrf);
+		ret = -1;
+		goto out;
+	}
+
+	memset(keep, 0, sizeof(keep));
+	for (i = 0; i < num; i++) {
+		s = find_slot(g, &members[i]);
+		if (s >= 0 && keep[s])
+			s = -1;	/* Duplicate member */
+		if (s < 0) {
+			struct ofp_nh_entry *nh;
+
+			s = free_slot(g, keep);
+			if (s < 0) {
+				OFP_ERR("Next hop group %d: no free member "
+					"slot", group);
+				ret = -1;
+				break;
+			}
+			nh = &g->member[s];
+			nh->flags = OFP_RTF_GATEWAY;
+			nh->gw = members[i].gw;
+			nh->port = members[i].port;
+			nh->vlan = members[i].vlan;
+			if (member_arp_get(vrf, nh)) {
+				ret = -1;
+				break;
+			}
+		}
+		keep[s] = 1;
+		slot[i] = s;
+	}
+
+	if (ret) {
+		/* Undo the new members, keep the group as it was */
+		for (s = 0; s < NH_GROUP_SLOTS; s++)
+			if (keep[s] && !g->used[s])
+				member_arp_put(&g->member[s]);
+		goto out;
+	}
+
+	/* New members are complete before any bucket refers to them */
+	odp_mb_release();
+	rebalance(g, slot, num, keep);
+
+	for (s = 0; s < NH_GROUP_SLOTS; s++) {
+		if (g->used[s] && !keep[s]) {
+			member_arp_put(&g->member[s]);
+			g->retired[s] = ofp_rcu_epoch();
+			retired = 1;
+		}
+		g->used[s] = keep[s];
+	}
+	if (retired)
+		ofp_rcu_advance();
+	g->vrf = vrf;
+	g->num = num;
+out:
+	odp_spinlock_unlock(&shm->lock);
+	return ret;
+}
+
+int ofp_nh_group_del(int32_t group)
+{
+	struct nh_group *g;
+	int ret = 0;
+
+	if (group < 0 || group >= OFP_NUM_NH_GROUPS)
+		return -1;
+
+	odp_spinlock_lock(&shm->lock);
+	g = &shm->group[group];
+	if (!g->allocated || g->deleted) {
+		ret = -1;
+	} else {
+		/* Routes still using the group free it on release */
+		g->deleted = 1;
+		if (!g->ref_count)
+			group_free(g);
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	return ret;
+}
+
+int ofp_nh_group_hold(uint32_t group, struct ofp_nh_entry *nh)
+{
+	struct nh_group *g;
+	int ret = 0;
+
+	if (group >= OFP_NUM_NH_GROUPS)
+		return -1;
+
+	odp_spinlock_lock(&shm->lock);
+	g = &shm->group[group];
+	if (!g->allocated || g->deleted) {
+		ret = -1;
+	} else {
+		g->ref_count++;
+		/* Port for source address selection of the route */
+		if (g->num) {
+			struct ofp_nh_entry *m = &g->member[g->bucket[0]];
+
+			nh->port = m->port;
+			nh->vlan = m->vlan;
+		}
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	return ret;
+}
+
+void ofp_nh_group_release(uint32_t group)
+{
+	struct nh_group *g;
+
+	if (group >= OFP_NUM_NH_GROUPS)
+		return;
+
+	odp_spinlock_lock(&shm->lock);
+	g = &shm->group[group];
+	if (g->ref_count && !--g->ref_count && g->deleted)
+		group_free(g);
+	odp_spinlock_unlock(&shm->lock);
+}
+
+int ofp_nh_group_get(uint32_t group, uint16_t *vrf,
+		     struct ofp_nh_group_member *members)
+{
+	struct nh_group *g;
+	int s, num = 0;
+
+	if (group >= OFP_NUM_NH_GROUPS)
+		return -1;
+
+	odp_spinlock_lock(&shm->lock);
+	g = &shm->group[group];
+	if (!g->allocated || g->deleted) {
+		num = -1;
+	} else {
+		for (s = 0; s < NH_GROUP_SLOTS && num < OFP_NH_GROUP_MAX; s++) {
+			if (!g->used[s])
+				continue;
+			members[num].gw = g->member[s].gw;
+			members[num].port = g->member[s].port;
+			members[num].vlan = g->member[s].vlan;
+			num++;
+		}
+		*vrf = g->vrf;
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	return num;
+}
+
+struct ofp_nh_entry *ofp_nh_group_select(struct ofp_nh_entry *nh,
+					 struct ofp_ip *ip)
+{
+	struct nh_group *g = &shm->group[nh->arp_ent_idx];
+	uint32_t key[4];
+	uint8_t s;
+
+	key[0] = ip->ip_src.s_addr;
+	key[1] = ip->ip_dst.s_addr;
+	key[2] = 0;
+	key[3] = ip->ip_p;
+
+	if ((ip->ip_p == OFP_IPPROTO_TCP || ip->ip_p == OFP_IPPROTO_UDP) &&
+	    !(odp_be_to_cpu_16(ip->ip_off) & (OFP_IP_MF | OFP_IP_OFFMASK)))
+		memcpy(&key[2], (uint8_t *)ip + (ip->ip_hl << 2),
+		       sizeof(key[2]));
+
+	s = __atomic_load_n(&g->bucket[ofp_hash_key(key, 4, 0) &
+				       (OFP_NH_GROUP_BUCKETS - 1)],
+			    __ATOMIC_ACQUIRE);
+	if (odp_unlikely(s == NH_SLOT_INVALID))
+		return NULL;
+
+	return &g->member[s];
+}
+
+static int ofp_nh_group_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_NH_GROUP, sizeof(*shm));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_nh_group_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_NH_GROUP) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_nh_group_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_NH_GROUP);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_nh_group_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_NH_GROUP, sizeof(*shm));
+}
+
+int ofp_nh_group_init_global(void)
+{
+	HANDLE_ERROR(ofp_nh_group_alloc_shared_memory());
+
+	memset(shm, 0, sizeof(*shm));
+	odp_spinlock_init(&shm->lock);
+
+	return 0;
+}
+
+int ofp_nh_group_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_nh_group_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_nh_group_free_shared_memory(), rc);
+
+	return rc;
+}
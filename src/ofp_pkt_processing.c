@@ -25,11 +25,13 @@
  */
 
 #include <assert.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "ofpi.h"
@@ -53,7 +55,25 @@
 #include "ofpi_gre.h"
 #include "ofpi_ip.h"
 #include "api/ofp_init.h"
+#include "api/ofp_ifnet.h"
 #include "ofpi_ipsec.h"
+#include "ofpi_rcu.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_conntrack.h"
+#include "ofpi_acl.h"
+#include "ofpi_sflow.h"
+#include "ofpi_steer.h"
+#include "ofpi_nh_group.h"
+#include "ofpi_gro.h"
+#include "ofpi_coroutine.h"
+#include "ofpi_nd6_cache.h"
+#include "ofpi_lag.h"
+#include "ofpi_mem_pressure.h"
+#include "ofpi_sysctl.h"
+#include "ofpi_in_pcb.h"
+#include "ofpi_socketvar.h"
+#include "ofpi_tcp_shm.h"
+#include "ofpi_tracepoint.h"
 
 static inline enum ofp_return_code ofp_ip_output_continue(odp_packet_t pkt,
 							  struct ip_out *odata);
@@ -66,6 +86,321 @@ extern odp_pool_t ofp_packet_pool;
 
 __thread struct ofp_global_ip_state *ofp_ip_shm;
 
+/* Queue context of the flow queues, packet input queues have an ifnet */
+static const char flow_queue_ctx[] = "flow";
+
+static void flow_resume(odp_packet_t pkt);
+
+/* Most buckets moved in one check */
+#define FLOW_REBALANCE_MOVES 8
+
+/*
+ * Move buckets of the busiest flow queue to the least loaded one while
+ * the move leaves the busiest queue above the other. A bucket of one
+ * elephant flow larger than the difference stays, moving it would only
+ * move the hot spot.
+ */
+static void flow_rebalance(void)
+{
+	struct ofp_global_ip_state *ip = ofp_ip_shm;
+	struct flow_rebalance_s *param = &global_param->flow_rebalance;
+	uint64_t load[OFP_FLOW_QUEUES_MAX], total = 0, mean;
+	uint32_t cnt[OFP_FLOW_BUCKETS];
+	uint32_t b, q, num = ip->flow_queue_num;
+	int best, hot, cold, moves;
+
+	memset(load, 0, sizeof(load));
+	for (b = 0; b < OFP_FLOW_BUCKETS; b++) {
+		cnt[b] = __atomic_exchange_n(&ip->flow_bucket_cnt[b], 0,
+					     __ATOMIC_RELAXED);
+		load[ip->flow_bucket_queue[b]] += cnt[b];
+		total += cnt[b];
+	}
+	mean = total / num;
+
+	for (moves = 0; moves < FLOW_REBALANCE_MOVES; moves++) {
+		hot = 0;
+		cold = 0;
+		for (q = 1; q < num; q++) {
+			if (load[q] > load[hot])
+				hot = q;
+			if (load[q] < load[cold])
+				cold = q;
+		}
+		if (!total ||
+		    load[hot] * 100 <= mean * (100 + param->threshold)) {
+			if (!moves)
+				ip->flow_rebalance_hot = 0;
+			return;
+		}
+		if (!moves && ++ip->flow_rebalance_hot < param->persist)
+			return;
+
+		best = -1;
+		for (b = 0; b < OFP_FLOW_BUCKETS; b++)
+			if (ip->flow_bucket_queue[b] == hot && cnt[b] &&
+			    cnt[b] < load[hot] - load[cold] &&
+			    (best < 0 || cnt[b] > cnt[best]))
+				best = b;
+		if (best < 0)
+			break;
+
+		__atomic_store_n(&ip->flow_bucket_queue[best], cold,
+				 __ATOMIC_RELAXED);
+		load[hot] -= cnt[best];
+		load[cold] += cnt[best];
+		ip->flow_bucket_moves++;
+	}
+	ip->flow_rebalance_hot = 0;
+}
+
+static void flow_rebalance_tmo(void *arg)
+{
+	uint64_t us = (uint64_t)global_param->flow_rebalance.interval_ms *
+		1000;
+
+	(void)arg;
+
+	ofp_ip_shm->flow_rebalance_tmr = ODP_TIMER_INVALID;
+	if (!ofp_ip_shm->flow_rebalance)
+		return;
+
+	flow_rebalance();
+
+	ofp_ip_shm->flow_rebalance_tmr =
+		ofp_timer_start(us > OFP_TIMER_MAX_US ? OFP_TIMER_MAX_US : us,
+				flow_rebalance_tmo, NULL, 0);
+}
+
+void ofp_flow_queue_print(int fd)
+{
+	uint32_t b, q, num = ofp_ip_shm->flow_queue_num;
+	uint32_t buckets[OFP_FLOW_QUEUES_MAX];
+
+	if (!num)
+		return;
+
+	memset(buckets, 0, sizeof(buckets));
+	for (b = 0; b < OFP_FLOW_BUCKETS; b++)
+		buckets[ofp_ip_shm->flow_bucket_queue[b]]++;
+
+	ofp_sendf(fd, "flow queues=%u rebalance %s moves=%" PRIu64
+		  "\r\n  buckets:", num,
+		  ofp_ip_shm->flow_rebalance ? "on" : "off",
+		  ofp_ip_shm->flow_bucket_moves);
+	for (q = 0; q < num; q++)
+		ofp_sendf(fd, " %u", buckets[q]);
+	ofp_sendf(fd, "\r\n");
+}
+
+int ofp_flow_queue_init_global(void)
+{
+	struct flow_rebalance_s *rebalance = &global_param->flow_rebalance;
+	odp_queue_param_t qparam;
+	char name[ODP_QUEUE_NAME_LEN];
+	int i, num;
+
+	if (global_param->pktin_mode != ODP_PKTIN_MODE_SCHED ||
+	    global_param->sched_sync != ODP_SCHED_SYNC_ORDERED)
+		return 0;
+
+	num = global_param->flow_queues;
+	if (num <= 0)
+		num = odp_cpumask_default_worker(NULL, 0);
+	if (num > OFP_FLOW_QUEUES_MAX)
+		num = OFP_FLOW_QUEUES_MAX;
+
+	odp_queue_param_init(&qparam);
+	qparam.type = ODP_QUEUE_TYPE_SCHED;
+	qparam.sched.prio = ODP_SCHED_PRIO_DEFAULT;
+	qparam.sched.sync = ODP_SCHED_SYNC_ATOMIC;
+	qparam.sched.group = global_param->sched_group;
+	qparam.context = (void *)(uintptr_t)flow_queue_ctx;
+
+	for (i = 0; i < num; i++) {
+		snprintf(name, sizeof(name), "flow_q%d", i);
+		ofp_ip_shm->flow_queue[i] = odp_queue_create(name, &qparam);
+		if (ofp_ip_shm->flow_queue[i] == ODP_QUEUE_INVALID) {
+			OFP_ERR("odp_queue_create failed");
+			ofp_flow_queue_term_global();
+			return -1;
+		}
+		ofp_ip_shm->flow_queue_num = i + 1;
+	}
+
+	for (i = 0; i < OFP_FLOW_BUCKETS; i++) {
+		ofp_ip_shm->flow_bucket_queue[i] = i % num;
+		ofp_ip_shm->flow_bucket_cnt[i] = 0;
+	}
+	ofp_ip_shm->flow_rebalance_hot = 0;
+	ofp_ip_shm->flow_bucket_moves = 0;
+
+	OFP_INFO("Local flows handed to %d atomic queues", num);
+	if (global_param->pktout_mode != ODP_PKTOUT_MODE_QUEUE)
+		OFP_INFO("Forwarded packets may be reordered without queue "
+			 "pktout_mode");
+
+	if (rebalance->threshold <= 0 || rebalance->interval_ms <= 0 ||
+	    num < 2)
+		return 0;
+	if (OFP_SHARE_NOTHING) {
+		OFP_INFO("Flow queue rebalancing is not done with "
+			 "share_nothing");
+		return 0;
+	}
+	ofp_ip_shm->flow_rebalance = 1;
+	flow_rebalance_tmo(NULL);
+	if (ofp_ip_shm->flow_rebalance_tmr == ODP_TIMER_INVALID)
+		OFP_ERR("Flow queue rebalancing timer start failed");
+	return 0;
+}
+
+int ofp_flow_queue_term_global(void)
+{
+	int rc = 0;
+	uint32_t i;
+
+	ofp_ip_shm->flow_rebalance = 0;
+	if (ofp_ip_shm->flow_rebalance_tmr != ODP_TIMER_INVALID) {
+		ofp_timer_cancel(ofp_ip_shm->flow_rebalance_tmr);
+		ofp_ip_shm->flow_rebalance_tmr = ODP_TIMER_INVALID;
+	}
+
+	for (i = 0; i < ofp_ip_shm->flow_queue_num; i++) {
+		if (odp_queue_destroy(ofp_ip_shm->flow_queue[i]) < 0) {
+			OFP_ERR("Failed to destroy flow queue %u", i);
+			rc = -1;
+		}
+	}
+	ofp_ip_shm->flow_queue_num = 0;
+	return rc;
+}
+
+/*
+ * Hand a locally delivered packet from the ordered context to the
+ * atomic queue of its flow. The enqueue keeps the order of the flow.
+ * Returns nonzero if the packet was handed off.
+ */
+static inline int flow_handoff(odp_packet_t pkt, struct ofp_ifnet *dev,
+			       uint32_t hash)
+{
+	struct ofp_packet_user_area *ua;
+	uint32_t num = ofp_ip_shm->flow_queue_num;
+	uint32_t b, q;
+
+	if (odp_likely(!num))
+		return 0;
+	ua = ofp_packet_user_area(pkt);
+	if (ua->flow_ctx)
+		return 0;
+
+	ua->flow_ctx = 1;
+	ua->flow_hash = hash;
+	ua->valid |= OFP_UA_HASH;
+	odp_packet_user_ptr_set(pkt, dev);
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+	b = hash % OFP_FLOW_BUCKETS;
+	if (ofp_ip_shm->flow_rebalance)
+		__atomic_fetch_add(&ofp_ip_shm->flow_bucket_cnt[b], 1,
+				   __ATOMIC_RELAXED);
+	q = __atomic_load_n(&ofp_ip_shm->flow_bucket_queue[b],
+			    __ATOMIC_RELAXED);
+	if (odp_queue_enq(ofp_ip_shm->flow_queue[q],
+			  odp_packet_to_event(pkt)) < 0) {
+		/* Processed here, in the ordered context */
+		return 0;
+	}
+	return 1;
+}
+
+static inline uint32_t ipv4_flow_hash(struct ofp_ip *ip)
+{
+	uint32_t hash = ip->ip_src.s_addr ^ ip->ip_dst.s_addr ^ ip->ip_p;
+
+	/* Fragments of a datagram go to the queue of its addresses */
+	if (!(odp_be_to_cpu_16(ip->ip_off) & 0x3fff) &&
+	    (ip->ip_p == OFP_IPPROTO_TCP || ip->ip_p == OFP_IPPROTO_UDP))
+		hash ^= *(uint32_t *)((uint8_t *)ip + (ip->ip_hl << 2));
+	return hash;
+}
+
+/* Back-off state of an idle polling thread */
+static __thread struct {
+	uint64_t last;		/* Cycles at the end of the previous round */
+	uint32_t empty;		/* Empty polls in a row */
+	uint32_t sleep_us;
+} poll_idle;
+
+/* Longest pause is 2^POLL_IDLE_PAUSE_SHIFT odp_cpu_pause() calls */
+#define POLL_IDLE_PAUSE_SHIFT 10
+
+void ofp_poll_idle(int num, uint64_t start)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+	uint32_t spin = global_param->idle.spin;
+	uint32_t pause = global_param->idle.pause;
+	uint32_t max_sleep = global_param->idle.max_sleep_us;
+	uint64_t now;
+	struct timespec ts;
+	uint32_t n, i;
+
+	if (odp_unlikely(!poll_idle.last))
+		poll_idle.last = start;
+
+	if (num > 0) {
+		poll_idle.empty = 0;
+		poll_idle.sleep_us = 0;
+	} else if (max_sleep) {
+		n = poll_idle.empty;
+		if (n < spin + pause)
+			poll_idle.empty++;
+		if (n >= spin + pause) {
+			poll_idle.sleep_us = poll_idle.sleep_us ?
+				poll_idle.sleep_us * 2 : 1;
+			if (poll_idle.sleep_us > max_sleep)
+				poll_idle.sleep_us = max_sleep;
+			ts.tv_sec = poll_idle.sleep_us / 1000000;
+			ts.tv_nsec = (poll_idle.sleep_us % 1000000) * 1000;
+			nanosleep(&ts, NULL);
+		} else if (n >= spin) {
+			n -= spin;
+			if (n > POLL_IDLE_PAUSE_SHIFT)
+				n = POLL_IDLE_PAUSE_SHIFT;
+			for (i = 0; i < (1u << n); i++)
+				odp_cpu_pause();
+		}
+	}
+
+	now = odp_cpu_cycles();
+	if (st) {
+		int thr = odp_thread_id();
+
+		st->per_thr[thr].busy_cycles +=
+			odp_cpu_cycles_diff(start, poll_idle.last);
+		st->per_thr[thr].idle_cycles += odp_cpu_cycles_diff(now, start);
+	}
+	poll_idle.last = now;
+}
+
+#ifdef OFP_PKTIN_VECTOR
+/* The packets of a vector are one burst of its input queue */
+static void pkt_vector_input(odp_event_t ev, odp_queue_t in_queue,
+			     ofp_pkt_processing_func pkt_func)
+{
+	odp_packet_vector_t pktv = odp_packet_vector_from_event(ev);
+	odp_packet_t *tbl;
+	uint32_t num;
+
+	num = odp_packet_vector_tbl(pktv, &tbl);
+	if (num)
+		ofp_packet_input_multi(tbl, num, in_queue, pkt_func);
+	odp_packet_vector_size_set(pktv, 0);
+	odp_packet_vector_free(pktv);
+}
+#endif /* OFP_PKTIN_VECTOR */
+
 int default_event_dispatcher(void *arg)
 {
 	odp_event_t ev;
@@ -73,6 +408,7 @@ int default_event_dispatcher(void *arg)
 	odp_queue_t in_queue;
 	int event_idx = 0;
 	int event_cnt = 0;
+	int flow_q;
 	ofp_pkt_processing_func pkt_func = (ofp_pkt_processing_func)arg;
 	odp_bool_t *is_running = NULL;
 
@@ -80,9 +416,27 @@ int default_event_dispatcher(void *arg)
 		OFP_ERR("ofp_init_local failed");
 		return -1;
 	}
+	/* Paced packets are released in the loop below */
+	ofp_send_pace_poll(1);
 
 	int rx_burst = global_param->evt_rx_burst_size;
 	odp_event_t events[rx_burst];
+	odp_packet_t pkts[rx_burst];
+	odp_event_t tmos[rx_burst];
+	odp_event_t ipsec_evs[rx_burst];
+	int pkt_cnt = 0;
+	int tmo_cnt;
+	int ipsec_cnt;
+	odp_bool_t vector_mode = global_param->pkt_vector_mode;
+	odp_queue_t timer_queue = ODP_QUEUE_INVALID;
+	uint64_t timer_wait = 0;
+	uint64_t coroutine_wait;
+	uint64_t wait;
+	uint64_t poll_start;
+	odp_bool_t backoff = global_param->idle.max_sleep_us > 0;
+	odp_bool_t idle;
+	int budget_cls, budget_over;
+	uint32_t budget_drop;
 
 	is_running = ofp_get_processing_state();
 	if (is_running == NULL) {
@@ -91,10 +445,69 @@ int default_event_dispatcher(void *arg)
 		return -1;
 	}
 
+#ifndef MTRIE
+	/* IPv4 route lookups of this thread are done without locks */
+	ofp_rcu_thread_register();
+#endif
+
+	/*
+	 * Per-core TCP timers of share-nothing mode, and of
+	 * tcp_timer_affinity, are polled here
+	 */
+	if (OFP_SHARE_NOTHING || global_param->tcp_timer_affinity) {
+		timer_queue = ofp_timer_queue_cpu(odp_cpu_id());
+		timer_wait = odp_schedule_wait_time(OFP_TIMER_RESOLUTION_US *
+						    ODP_TIME_USEC_IN_NS);
+		if (timer_queue != ODP_QUEUE_INVALID)
+			ofp_timer_queue_cpu_polled(odp_cpu_id(), 1);
+	}
+
+	coroutine_wait = odp_schedule_wait_time(OFP_TIMER_RESOLUTION_US *
+						ODP_TIME_USEC_IN_NS);
+
 	/* PER CORE DISPATCHER */
 	while (*is_running) {
-		event_cnt = odp_schedule_multi(&in_queue, ODP_SCHED_WAIT,
-					 events, rx_burst);
+		poll_start = odp_cpu_cycles();
+		wait = ofp_send_pending_wait();
+		/* Held transmissions are not delayed by backing off */
+		idle = wait == ODP_SCHED_WAIT;
+		/* Nor are coroutines ready to run */
+		if ((backoff && idle) || ofp_coroutine_runnable())
+			wait = ODP_SCHED_NO_WAIT;
+		/*
+		 * Blocked ones may be woken up by other threads without an
+		 * event to this one, they are checked once per timer tick
+		 */
+		else if (wait == ODP_SCHED_WAIT && ofp_coroutine_count())
+			wait = coroutine_wait;
+		if (timer_queue != ODP_QUEUE_INVALID) {
+			ev = odp_queue_deq(timer_queue);
+			if (ev != ODP_EVENT_INVALID)
+				ofp_timer_handle(ev);
+			if (wait == ODP_SCHED_WAIT)
+				wait = timer_wait;
+		}
+#ifndef MTRIE
+		/* No references to route data are held while waiting */
+		ofp_rcu_thread_offline();
+#endif
+		event_cnt = odp_schedule_multi(&in_queue, wait,
+					       events, rx_burst);
+		ofp_poll_idle(idle ? event_cnt : 1, poll_start);
+#ifndef MTRIE
+		ofp_rcu_thread_online();
+#endif
+		ofp_send_burst_rx(event_cnt > 0 ? event_cnt : 0);
+		ofp_gro_burst_begin();
+		/* A burst comes from one queue */
+		flow_q = event_cnt > 0 &&
+			odp_queue_context(in_queue) == flow_queue_ctx;
+		budget_cls = event_cnt > 0 ?
+			ofp_steer_budget_begin(in_queue, &budget_over) : -1;
+		budget_drop = 0;
+		pkt_cnt = 0;
+		tmo_cnt = 0;
+		ipsec_cnt = 0;
 		for (event_idx = 0; event_idx < event_cnt; event_idx++) {
 			odp_event_type_t ev_type;
 			odp_event_subtype_t ev_subtype;
@@ -115,14 +528,40 @@ int default_event_dispatcher(void *arg)
 				}
 #endif
 				if (ev_subtype == ODP_EVENT_PACKET_IPSEC) {
-					ofp_ipsec_packet_event(ev, in_queue);
+					ipsec_evs[ipsec_cnt++] = ev;
+					continue;
+				}
+				if (flow_q) {
+					flow_resume(pkt);
+					continue;
+				}
+				/* The priority has used its CPU budget */
+				if (odp_unlikely(budget_over)) {
+					odp_packet_free(pkt);
+					budget_drop++;
+					continue;
+				}
+				if (vector_mode) {
+					pkts[pkt_cnt++] = pkt;
 					continue;
 				}
 				ofp_packet_input(pkt, in_queue, pkt_func);
 				continue;
 			}
+#ifdef OFP_PKTIN_VECTOR
+			if (ev_type == ODP_EVENT_PACKET_VECTOR) {
+				/* Packets before the vector go first */
+				if (pkt_cnt)
+					ofp_packet_input_multi(pkts, pkt_cnt,
+							       in_queue,
+							       pkt_func);
+				pkt_cnt = 0;
+				pkt_vector_input(ev, in_queue, pkt_func);
+				continue;
+			}
+#endif /* OFP_PKTIN_VECTOR */
 			if (ev_type == ODP_EVENT_TIMEOUT) {
-				ofp_timer_handle(ev);
+				tmos[tmo_cnt++] = ev;
 				continue;
 			}
 			if (ev_type == ODP_EVENT_IPSEC_STATUS) {
@@ -133,9 +572,170 @@ int default_event_dispatcher(void *arg)
 			OFP_ERR("Unexpected event type: %u", ev_type);
 			odp_event_free(ev);
 		}
+		if (tmo_cnt)
+			ofp_timer_handle_multi(tmos, tmo_cnt);
+		if (ipsec_cnt)
+			ofp_ipsec_packet_event_multi(ipsec_evs, ipsec_cnt,
+						     in_queue);
+		if (pkt_cnt)
+			ofp_packet_input_multi(pkts, pkt_cnt, in_queue,
+					       pkt_func);
+		ofp_gro_burst_end();
+		if (budget_cls >= 0)
+			ofp_steer_budget_end(budget_cls, budget_drop);
+		/* Coroutines woken up by the burst send with its packets */
+		ofp_coroutine_run();
 		ofp_send_pending_pkt();
 	}
 
+	/*
+	 * The wheel ticks move to the shared queue, those already fired
+	 * are handled here
+	 */
+	if (timer_queue != ODP_QUEUE_INVALID &&
+	    global_param->tcp_timer_affinity && !OFP_SHARE_NOTHING) {
+		ofp_timer_queue_cpu_polled(odp_cpu_id(), 0);
+		do {
+			while ((ev = odp_queue_deq(timer_queue)) !=
+			       ODP_EVENT_INVALID)
+				ofp_timer_handle(ev);
+		} while (ofp_timer_queue_cpu_release(odp_cpu_id()));
+	}
+
+#ifndef MTRIE
+	ofp_rcu_thread_unregister();
+#endif
+
+	if (ofp_term_local())
+		OFP_ERR("ofp_term_local failed");
+
+	return 0;
+}
+
+int ofp_packet_input_burst(odp_pktin_queue_t pktin, odp_packet_t pkt[],
+			   int num)
+{
+	int cnt = odp_pktin_recv(pktin, pkt, num);
+
+	if (cnt <= 0)
+		return cnt;
+
+	ofp_send_burst_rx(cnt);
+	ofp_gro_burst_begin();
+	ofp_packet_input_multi(pkt, cnt, ODP_QUEUE_INVALID,
+			       ofp_eth_vlan_processing);
+	ofp_gro_burst_end();
+	ofp_send_pending_pkt();
+
+	return cnt;
+}
+
+/* Direct mode input queues of the worker on all interfaces */
+static int direct_pktin_queues(const struct ofp_direct_dispatcher_arg *arg,
+			       odp_pktin_queue_t pktin[], int max)
+{
+	struct ofp_ifnet *ifnet;
+	odp_pktio_info_t info;
+	int port, n, num = 0;
+
+	for (port = 0; PHYS_PORT(port) && num < max; port++) {
+		ifnet = ofp_get_ifnet((uint16_t)port, 0);
+		if (!ifnet || ifnet->if_state != OFP_IFT_STATE_USED ||
+		    ifnet->pktio == ODP_PKTIO_INVALID ||
+		    odp_pktio_info(ifnet->pktio, &info) ||
+		    info.param.in_mode != ODP_PKTIN_MODE_DIRECT)
+			continue;
+		n = ofp_ifnet_pktin_queues(port, arg->worker, arg->num_workers,
+					   &pktin[num], max - num);
+		if (n > 0)
+			num += n;
+	}
+	return num;
+}
+
+int direct_event_dispatcher(void *arg)
+{
+	const struct ofp_direct_dispatcher_arg *darg = arg;
+	odp_bool_t *is_running;
+	odp_queue_t in_queue;
+	odp_event_t ev;
+	uint64_t start;
+	int num_pktin, num, cnt, i;
+
+	if (ofp_init_local()) {
+		OFP_ERR("ofp_init_local failed");
+		return -1;
+	}
+
+	int rx_burst = global_param->evt_rx_burst_size;
+	odp_packet_t pkts[rx_burst];
+	odp_event_t events[rx_burst];
+	odp_pktin_queue_t pktin[FP_PORTS * OFP_PKTIN_QUEUE_MAX];
+
+	is_running = ofp_get_processing_state();
+	if (is_running == NULL) {
+		OFP_ERR("ofp_get_processing_state failed");
+		ofp_term_local();
+		return -1;
+	}
+
+	num_pktin = direct_pktin_queues(darg, pktin,
+					sizeof(pktin) / sizeof(pktin[0]));
+	OFP_INFO("Direct dispatcher %d polls %d input queues",
+		 darg->worker, num_pktin);
+
+#ifndef MTRIE
+	ofp_rcu_thread_register();
+#endif
+
+	while (*is_running) {
+		start = odp_cpu_cycles();
+		num = 0;
+
+		/* Timers, loop queues and other scheduled events */
+		if (darg->process_timers) {
+			cnt = odp_schedule_multi(&in_queue, ODP_SCHED_NO_WAIT,
+						 events, rx_burst);
+			for (i = 0; i < cnt; i++) {
+				ev = events[i];
+				if (odp_event_type(ev) == ODP_EVENT_TIMEOUT)
+					ofp_timer_handle(ev);
+				else if (odp_event_type(ev) == ODP_EVENT_PACKET)
+					ofp_packet_input(odp_packet_from_event(ev),
+							 in_queue,
+							 ofp_eth_vlan_processing);
+				else
+					odp_event_free(ev);
+			}
+			if (cnt > 0) {
+				ofp_send_pending_pkt();
+				num += cnt;
+			}
+		}
+
+		for (i = 0; i < num_pktin; i++) {
+			cnt = ofp_packet_input_burst(pktin[i], pkts, rx_burst);
+			if (cnt > 0)
+				num += cnt;
+		}
+		cnt = ofp_coroutine_run();
+		if (cnt) {
+			ofp_send_pending_pkt();
+			num += cnt;
+		}
+		/* Flushes packets held for a burst while input is idle */
+		if (!num)
+			ofp_send_pending_pkt();
+#ifndef MTRIE
+		ofp_rcu_quiescent();
+#endif
+		ofp_poll_idle(num, num ? odp_cpu_cycles() : start);
+	}
+
+#ifndef MTRIE
+	ofp_rcu_thread_unregister();
+#endif
+
 	if (ofp_term_local())
 		OFP_ERR("ofp_term_local failed");
 
@@ -147,35 +747,86 @@ uint32_t ofp_packet_min_user_area(void)
 	return sizeof(struct ofp_packet_user_area);
 }
 
-enum ofp_return_code ofp_eth_vlan_processing(odp_packet_t *pkt)
+/*
+ * Untagged packets parsed by the pktio are classified from the parse
+ * flags without touching the Ethernet header. Returns 0 if the header
+ * has to be read.
+ */
+static inline int eth_parse_flags(odp_packet_t pkt, uint16_t *ethtype)
+{
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(pkt);
+
+	if (!(ua->chksum_flags & OFP_PARSE_VALID))
+		return 0;
+	ua->chksum_flags &= ~OFP_PARSE_VALID;
+
+	if (odp_unlikely(odp_packet_has_vlan(pkt)))
+		return 0;
+	if (odp_likely(odp_packet_has_ipv4(pkt)))
+		*ethtype = OFP_ETHERTYPE_IP;
+	else if (odp_packet_has_ipv6(pkt))
+		*ethtype = OFP_ETHERTYPE_IPV6;
+	else if (odp_packet_has_arp(pkt))
+		*ethtype = OFP_ETHERTYPE_ARP;
+	else
+		return 0;
+	return 1;
+}
+
+/*
+ * Parse the Ethernet and VLAN headers and switch the packet to the VLAN
+ * interface if it is tagged. The ethertype is returned in *ethtype.
+ */
+static inline enum ofp_return_code eth_vlan_parse(odp_packet_t pkt,
+						  uint16_t *ethtype)
 {
-	uint16_t vlan = 0, ethtype;
+	uint16_t vlan = 0;
 	struct ofp_ether_header *eth;
-	struct ofp_ifnet *ifnet = odp_packet_user_ptr(*pkt);
+	struct ofp_ifnet *ifnet;
+
+	if (odp_likely(eth_parse_flags(pkt, ethtype)))
+		return OFP_PKT_CONTINUE;
 
-	eth = (struct ofp_ether_header *)odp_packet_l2_ptr(*pkt, NULL);
+	ifnet = odp_packet_user_ptr(pkt);
+	eth = (struct ofp_ether_header *)odp_packet_l2_ptr(pkt, NULL);
 
 	if (odp_unlikely(eth == NULL)) {
 		OFP_DBG("eth is NULL");
+		OFP_DROP_STAT(ETH_PARSE);
 		return OFP_PKT_DROP;
 	}
 
-	ethtype = odp_be_to_cpu_16(eth->ether_type);
+	*ethtype = odp_be_to_cpu_16(eth->ether_type);
 
-	if (ethtype == OFP_ETHERTYPE_VLAN) {
+	if (*ethtype == OFP_ETHERTYPE_VLAN) {
 		struct ofp_ether_vlan_header *vlan_hdr;
 
 		vlan_hdr = (struct ofp_ether_vlan_header *)eth;
 		vlan = OFP_EVL_VLANOFTAG(odp_be_to_cpu_16(vlan_hdr->evl_tag));
-		ethtype = odp_be_to_cpu_16(vlan_hdr->evl_proto);
+		*ethtype = odp_be_to_cpu_16(vlan_hdr->evl_proto);
 		ifnet = ofp_get_ifnet(ifnet->port, vlan);
-		if (!ifnet)
+		if (!ifnet) {
+			OFP_DROP_STAT(VLAN_NO_IF);
 			return OFP_PKT_DROP;
+		}
+		OFP_IF_STAT_RX(ifnet, 1, odp_packet_len(pkt));
 		if (odp_likely(ofp_if_type(ifnet) != OFP_IFT_VXLAN))
-			odp_packet_user_ptr_set(*pkt, ifnet);
+			odp_packet_user_ptr_set(pkt, ifnet);
 	}
 
-	OFP_DBG("ETH TYPE = %04x", ethtype);
+	OFP_DBG("ETH TYPE = %04x", *ethtype);
+
+	return OFP_PKT_CONTINUE;
+}
+
+enum ofp_return_code ofp_eth_vlan_processing(odp_packet_t *pkt)
+{
+	uint16_t ethtype;
+	OFP_PROF_START(prof);
+
+	if (odp_unlikely(eth_vlan_parse(*pkt, &ethtype) == OFP_PKT_DROP))
+		return OFP_PKT_DROP;
+	OFP_PROF_END(ETH_CLASSIFY, prof);
 
 	/* network layer classifier */
 	switch (ethtype) {
@@ -289,127 +940,212 @@ enum ofp_return_code ofp_tcp4_processing(odp_packet_t *pkt)
 static inline enum ofp_return_code ofp_ip_output_common_inline(odp_packet_t pkt,
 							       struct ofp_nh_entry *nh,
 							       int is_local_out,
-							       ofp_ipsec_sa_handle sa);
+							       ofp_ipsec_sa_handle sa,
+							       struct ofp_flow_cache_entry *fc);
 
 enum ofp_return_code ofp_ip_output_common(odp_packet_t pkt,
 					  struct ofp_nh_entry *nh,
 					  int is_local_out,
 					  ofp_ipsec_sa_handle sa)
 {
-	return ofp_ip_output_common_inline(pkt, nh, is_local_out, sa);
+	return ofp_ip_output_common_inline(pkt, nh, is_local_out, sa, NULL);
 }
 
-enum ofp_return_code ofp_ipv4_processing(odp_packet_t *pkt)
-{
-	int frag_res = 0, res;
-	int protocol = IS_IPV4;
-	uint32_t flags;
-	struct ofp_ip *ip;
-	struct ofp_nh_entry *nh;
-	struct ofp_ifnet *dev = odp_packet_user_ptr(*pkt);
-	uint32_t is_ours;
-	ofp_ipsec_sa_handle sa = OFP_IPSEC_SA_INVALID;
-
-	ip = (struct ofp_ip *)odp_packet_l3_ptr(*pkt, NULL);
-
-	if (odp_unlikely(ip == NULL)) {
-		OFP_DBG("ip is NULL");
-		return OFP_PKT_DROP;
-	}
+#ifdef INET6
+static inline enum ofp_return_code ofp_ip6_output_inline(odp_packet_t pkt,
+							 struct ofp_nh6_entry *nh_param,
+							 struct ofp_flow_cache6_entry *fc);
+#endif
 
-	if (odp_unlikely(ofp_if_type(dev) == OFP_IFT_VXLAN)) {
+/*
+ * Validate the IPv4 header of a received packet. On return *dev points
+ * to the interface the packet is handled on.
+ *
+ * The feat argument of this and the following functions is the
+ * OFP_IP4_FEAT_* set they are built for, a constant on the fast path.
+ */
+static inline enum ofp_return_code ipv4_input_check(odp_packet_t pkt,
+						    struct ofp_ip *ip,
+						    struct ofp_ifnet **dev,
+						    const uint32_t feat)
+{
+	if ((feat & OFP_IP4_FEAT_VXLAN) &&
+	    odp_unlikely(ofp_if_type(*dev) == OFP_IFT_VXLAN)) {
 		struct ofp_packet_user_area *ua;
 
 		/* Look for the correct device. */
-		ua = ofp_packet_user_area(*pkt);
-		dev = ofp_get_ifnet(VXLAN_PORTS, ua->vxlan.vni);
-		if (!dev)
+		ua = ofp_packet_user_area(pkt);
+		*dev = ofp_get_ifnet(VXLAN_PORTS, ua->vxlan.vni);
+		if (!*dev) {
+			OFP_DROP_STAT(VLAN_NO_IF);
 			return OFP_PKT_DROP;
+		}
 	}
 
 	if (odp_unlikely(ip->ip_v != OFP_IPVERSION))
-		return OFP_PKT_DROP;
+		goto bad_hdr;
 
-	if (ofp_packet_user_area(*pkt)->chksum_flags
+	if (ofp_packet_user_area(pkt)->chksum_flags
 		& OFP_L3_CHKSUM_STATUS_VALID) {
-		switch (odp_packet_l3_chksum_status(*pkt)) {
+		switch (odp_packet_l3_chksum_status(pkt)) {
 		case ODP_PACKET_CHKSUM_OK:
 			break;
 		case ODP_PACKET_CHKSUM_UNKNOWN:
 			/* Checksum was not validated by HW */
 			if (odp_unlikely(ofp_cksum_iph(ip, ip->ip_hl)))
-				return OFP_PKT_DROP;
+				goto bad_hdr;
 			break;
 		case ODP_PACKET_CHKSUM_BAD:
-			return OFP_PKT_DROP;
-			break;
+			goto bad_hdr;
 		}
-		ofp_packet_user_area(*pkt)->chksum_flags &=
+		ofp_packet_user_area(pkt)->chksum_flags &=
 			~OFP_L3_CHKSUM_STATUS_VALID;
 	} else if (odp_unlikely(ofp_cksum_iph(ip, ip->ip_hl)))
-		return OFP_PKT_DROP;
+		goto bad_hdr;
 
 	/* TODO: handle broadcast */
-	if (dev->ip_addr_info[0].bcast_addr == ip->ip_dst.s_addr)
-		return OFP_PKT_DROP;
+	if ((*dev)->ip_addr_info[0].bcast_addr == ip->ip_dst.s_addr)
+		goto bad_hdr;
 
 	OFP_DBG("Device IP: %s, Packet Dest IP: %s",
-		ofp_print_ip_addr(dev->ip_addr_info[0].ip_addr),
+		ofp_print_ip_addr((*dev)->ip_addr_info[0].ip_addr),
 		ofp_print_ip_addr(ip->ip_dst.s_addr));
 
-	/* Do not search through the ifnet IP list because it adds overhead.
-	 * Verify against first IP address in the list.
-	 * Anyways, ofp_get_next_hop should validate if this is local.
-	 */
-	is_ours = dev->ip_addr_info[0].ip_addr == ip->ip_dst.s_addr ||
-		OFP_IN_MULTICAST(odp_be_to_cpu_32(ip->ip_dst.s_addr));
+	return OFP_PKT_CONTINUE;
 
-	if (!is_ours) {
-		/* This may be for some other local interface. */
-		nh = ofp_get_next_hop(dev->vrf, ip->ip_dst.s_addr, &flags);
-		if (nh)
-			is_ours = nh->flags & OFP_RTF_LOCAL;
-	}
+bad_hdr:
+	OFP_DROP_STAT(IP_BAD_HDR);
+	return OFP_PKT_DROP;
+}
+
+/*
+ * The first address of the interface is checked inline. Other
+ * addresses of any interface of the VRF are found in the address hash,
+ * whose bloom filter lets forwarded packets through with one hash.
+ */
+static inline uint32_t ipv4_is_ours_fast(struct ofp_ifnet *dev,
+					 struct ofp_ip *ip)
+{
+	return dev->ip_addr_info[0].ip_addr == ip->ip_dst.s_addr ||
+		OFP_IN_MULTICAST(odp_be_to_cpu_32(ip->ip_dst.s_addr)) ||
+		ofp_ifaddr_is_local(ip->ip_dst.s_addr, dev->vrf);
+}
+
+/*
+ * First part of the delivery of a validated IPv4 packet, up to the
+ * hooks. Returns OFP_PKT_CONTINUE if the packet reached the hooks, ip
+ * is updated if the packet was reassembled.
+ */
+static inline enum ofp_return_code ipv4_input_pre_hook(odp_packet_t *pkt,
+						       struct ofp_ifnet *dev,
+						       struct ofp_ip **ip,
+						       uint32_t is_ours,
+						       const uint32_t feat)
+{
+	int frag_res;
 
 	if (is_ours) {
-		if (odp_be_to_cpu_16(ip->ip_off) & 0x3fff) {
+		if (flow_handoff(*pkt, dev, ipv4_flow_hash(*ip)))
+			return OFP_PKT_PROCESSED;
+
+		if (odp_be_to_cpu_16((*ip)->ip_off) & 0x3fff) {
 			frag_res = pkt_reassembly(pkt);
 			if (frag_res != OFP_PKT_CONTINUE)
 				return frag_res;
 
-			ip = (struct ofp_ip *)odp_packet_l3_ptr(*pkt, NULL);
+			*ip = (struct ofp_ip *)odp_packet_l3_ptr(*pkt, NULL);
 		}
+	}
 
-		if (ofp_ipsec_inbound_check(dev->vrf, *pkt, ip, 1) == OFP_PKT_DROP)
-			return OFP_PKT_DROP;
+	if ((feat & OFP_IP4_FEAT_IPSEC) &&
+	    ofp_ipsec_inbound_check(dev->vrf, *pkt, *ip, is_ours ? 1 : 0) ==
+	    OFP_PKT_DROP) {
+		OFP_DROP_STAT(IP_IPSEC);
+		return OFP_PKT_DROP;
+	}
+
+	if ((feat & OFP_IP4_FEAT_FILTER) && ofp_ct_table)
+		return ofp_ct_ipv4_input(*pkt, dev->vrf);
+	return OFP_PKT_CONTINUE;
+}
 
-		OFP_HOOK(OFP_HOOK_LOCAL, *pkt, &protocol, &res);
+static inline enum ofp_return_code ipv4_input_hook(odp_packet_t pkt,
+						   struct ofp_ifnet *dev,
+						   struct ofp_nh_entry *nh,
+						   uint32_t is_ours,
+						   const uint32_t feat)
+{
+	enum ofp_acl_point point = is_ours ? OFP_ACL_LOCAL : OFP_ACL_FWD;
+	int protocol = IS_IPV4;
+	int res;
+
+	if (!(feat & OFP_IP4_FEAT_FILTER))
+		return OFP_PKT_CONTINUE;
+
+	if (ofp_acl_enabled(point)) {
+		res = ofp_acl_apply(point, pkt, dev->vrf);
+		if (res != OFP_PKT_CONTINUE)
+			return res;
+	}
+
+	OFP_PROF_START(prof);
+
+	if (is_ours) {
+		OFP_HOOK(OFP_HOOK_LOCAL, pkt, &protocol, &res);
 		if (res != OFP_PKT_CONTINUE) {
 			OFP_DBG("OFP_HOOK_LOCAL returned %d", res);
 			return res;
 		}
 
-		OFP_HOOK(OFP_HOOK_LOCAL_IPv4, *pkt, NULL, &res);
+		OFP_HOOK(OFP_HOOK_LOCAL_IPv4, pkt, NULL, &res);
 		if (res != OFP_PKT_CONTINUE) {
 			OFP_DBG("OFP_HOOK_LOCAL_IPv4 returned %d", res);
 			return res;
 		}
+	} else {
+		OFP_HOOK(OFP_HOOK_FWD_IPv4, pkt, nh, &res);
+		if (res != OFP_PKT_CONTINUE) {
+			OFP_DBG("OFP_HOOK_FWD_IPv4 returned %d", res);
+			return res;
+		}
+	}
+	OFP_PROF_END(HOOK, prof);
 
-		return ipv4_transport_classifier(pkt, ip->ip_p);
+	return OFP_PKT_CONTINUE;
+}
 
-	}
+/*
+ * Last part of the delivery of a validated IPv4 packet, after the
+ * hooks: local delivery or forwarding using the next hop found by the
+ * route lookup. fc is the flow cache slot of the destination or NULL.
+ */
+static inline enum ofp_return_code ipv4_input_post_hook(odp_packet_t *pkt,
+							struct ofp_ifnet *dev,
+							struct ofp_ip *ip,
+							struct ofp_nh_entry *nh,
+							uint32_t is_ours,
+							struct ofp_flow_cache_entry *fc,
+							const uint32_t feat)
+{
+	int res;
+	ofp_ipsec_sa_handle sa = OFP_IPSEC_SA_INVALID;
 
-	if (ofp_ipsec_inbound_check(dev->vrf, *pkt, ip, 0) == OFP_PKT_DROP)
-		return OFP_PKT_DROP;
+	if (is_ours) {
+		if (ip->ip_p == OFP_IPPROTO_TCP &&
+		    ofp_gro_tcp4_input(*pkt, ip) == OFP_PKT_PROCESSED)
+			return OFP_PKT_PROCESSED;
 
-	OFP_HOOK(OFP_HOOK_FWD_IPv4, *pkt, nh, &res);
-	if (res != OFP_PKT_CONTINUE) {
-		OFP_DBG("OFP_HOOK_FWD_IPv4 returned %d", res);
+		OFP_PROF_START(prof_l4);
+		res = ipv4_transport_classifier(pkt, ip->ip_p);
+		OFP_PROF_END(L4_INPUT, prof_l4);
 		return res;
 	}
 
-	if (ofp_ipsec_out_lookup(dev->vrf, *pkt, &sa) == OFP_PKT_DROP)
+	if ((feat & OFP_IP4_FEAT_IPSEC) &&
+	    ofp_ipsec_out_lookup(dev->vrf, *pkt, &sa) == OFP_PKT_DROP) {
+		OFP_DROP_STAT(IP_IPSEC);
 		return OFP_PKT_DROP;
+	}
 
 	if (nh == NULL && sa == OFP_IPSEC_SA_INVALID) {
 		OFP_DBG("nh is NULL, vrf=%d dest=%x", dev->vrf, ip->ip_dst.s_addr);
@@ -421,18 +1157,18 @@ enum ofp_return_code ofp_ipv4_processing(odp_packet_t *pkt)
 		OFP_DBG("OFP_ICMP_TIMXCEED");
 		ofp_icmp_error(*pkt, OFP_ICMP_TIMXCEED,
 				OFP_ICMP_TIMXCEED_INTRANS, 0, 0);
+		OFP_DROP_STAT(IP_TTL);
 		return OFP_PKT_DROP;
 	}
 
 	/*
 	 * Decrement TTL and incrementally change the IP header checksum.
 	 */
+	uint16_t ttl_p = odp_cpu_to_be_16(ip->ip_ttl << 8 | ip->ip_p);
+
 	ip->ip_ttl--;
-	uint16_t a = ~odp_cpu_to_be_16(1 << 8);
-	if (ip->ip_sum >= a)
-		ip->ip_sum -= a;
-	else
-		ip->ip_sum += odp_cpu_to_be_16(1 << 8);
+	ip->ip_sum = ofp_cksum_adjust16(ip->ip_sum, ttl_p,
+					ttl_p - odp_cpu_to_be_16(1 << 8));
 
 #ifdef OFP_SEND_ICMP_REDIRECT
 	/* 1. The interface on which the packet comes into the router is the
@@ -456,18 +1192,159 @@ enum ofp_return_code ofp_ipv4_processing(odp_packet_t *pkt)
 	}
 #endif
 
-	return ofp_ip_output_common_inline(*pkt, nh, 0, sa);
+	return ofp_ip_output_common_inline(*pkt, nh, 0, sa, fc);
 }
 
-#ifdef INET6
-enum ofp_return_code ofp_ipv6_processing(odp_packet_t *pkt)
+/*
+ * Deliver a validated IPv4 packet locally or forward it. fc is the
+ * flow cache slot of the destination or NULL.
+ */
+static inline enum ofp_return_code ipv4_input_finish(odp_packet_t *pkt,
+						     struct ofp_ifnet *dev,
+						     struct ofp_ip *ip,
+						     struct ofp_nh_entry *nh,
+						     uint32_t is_ours,
+						     struct ofp_flow_cache_entry *fc,
+						     const uint32_t feat)
+{
+	enum ofp_return_code res;
+
+	res = ipv4_input_pre_hook(pkt, dev, &ip, is_ours, feat);
+	if (res != OFP_PKT_CONTINUE)
+		return res;
+
+	res = ipv4_input_hook(*pkt, dev, nh, is_ours, feat);
+	if (res != OFP_PKT_CONTINUE)
+		return res;
+
+	return ipv4_input_post_hook(pkt, dev, ip, nh, is_ours, fc, feat);
+}
+
+int ofp_packet_pullup(odp_packet_t *pkt, uint32_t off, uint32_t len)
+{
+	uint32_t seg_len;
+
+	if (odp_likely(!odp_packet_is_segmented(*pkt)))
+		return 0;
+
+	if (off + len > odp_packet_len(*pkt))
+		len = odp_packet_len(*pkt) - off;
+	if (odp_packet_offset(*pkt, off, &seg_len, NULL) && seg_len >= len)
+		return 0;
+
+	return odp_packet_align(pkt, off, len, 0) < 0 ? -1 : 0;
+}
+
+static inline __attribute__((always_inline))
+enum ofp_return_code ipv4_processing(odp_packet_t *pkt, const uint32_t feat)
+{
+	uint32_t flags;
+	struct ofp_ip *ip;
+	struct ofp_nh_entry *nh = NULL;
+	struct ofp_ifnet *dev = odp_packet_user_ptr(*pkt);
+	struct ofp_flow_cache_entry *fc = NULL;
+	uint32_t is_ours;
+
+	ip = (struct ofp_ip *)odp_packet_l3_ptr(*pkt, NULL);
+
+	if (odp_unlikely(ip == NULL)) {
+		OFP_DBG("ip is NULL");
+		return OFP_PKT_DROP;
+	}
+
+	if (odp_unlikely(ofp_packet_pullup(pkt, odp_packet_l3_offset(*pkt),
+					   OFP_PKT_PULLUP_LEN)))
+		return OFP_PKT_DROP;
+	ip = (struct ofp_ip *)odp_packet_l3_ptr(*pkt, NULL);
+
+	OFP_PROF_START(prof);
+
+	if (ipv4_input_check(*pkt, ip, &dev, feat) == OFP_PKT_DROP)
+		return OFP_PKT_DROP;
+	OFP_PROF_END(IP_INPUT, prof);
+
+	is_ours = ipv4_is_ours_fast(dev, ip);
+
+	if (!is_ours) {
+		OFP_PROF_START(prof_rt);
+
+		fc = ofp_flow_cache_lookup(dev->vrf, ip->ip_dst.s_addr);
+		if (fc && ofp_flow_cache_hit(fc)) {
+			OFP_PROF_END(ROUTE_LOOKUP, prof_rt);
+			return ipv4_input_finish(pkt, dev, ip, fc->nh, 0, fc,
+						 feat);
+		}
+
+		/* This may be for some other local interface. */
+		nh = ofp_get_next_hop(dev->vrf, ip->ip_dst.s_addr, &flags);
+		if (nh)
+			is_ours = nh->flags & OFP_RTF_LOCAL;
+		OFP_PROF_END(ROUTE_LOOKUP, prof_rt);
+	}
+
+	return ipv4_input_finish(pkt, dev, ip, nh, is_ours, fc, feat);
+}
+
+/*
+ * The common feature sets have their own copy of the path, the rest
+ * take the one that looks for everything.
+ */
+enum ofp_return_code ofp_ipv4_processing(odp_packet_t *pkt)
+{
+	switch (ofp_ip4_feat()) {
+	case 0:
+		return ipv4_processing(pkt, 0);
+	case OFP_IP4_FEAT_IPSEC:
+		return ipv4_processing(pkt, OFP_IP4_FEAT_IPSEC);
+	case OFP_IP4_FEAT_FILTER:
+		return ipv4_processing(pkt, OFP_IP4_FEAT_FILTER);
+	default:
+		return ipv4_processing(pkt, OFP_IP4_FEAT_ALL);
+	}
+}
+
+#ifdef INET6
+static inline uint32_t ipv6_flow_hash(struct ofp_ip6_hdr *ipv6)
+{
+	uint32_t hash = ipv6->ofp_ip6_nxt;
+	int i;
+
+	/* Source and destination, ports are not looked for */
+	for (i = 0; i < 4; i++)
+		hash ^= ipv6->ip6_src.ofp_s6_addr32[i] ^
+			ipv6->ip6_dst.ofp_s6_addr32[i];
+	return hash;
+}
+
+static inline enum ofp_return_code ipv6_input_local(odp_packet_t *pkt,
+						    struct ofp_ip6_hdr *ipv6)
 {
 	int res;
 	int protocol = IS_IPV6;
+
+	OFP_HOOK(OFP_HOOK_LOCAL, *pkt, &protocol, &res);
+	if (res != OFP_PKT_CONTINUE) {
+		OFP_DBG("OFP_HOOK_LOCAL returned %d", res);
+		return res;
+	}
+
+	OFP_HOOK(OFP_HOOK_LOCAL_IPv6, *pkt, NULL, &res);
+	if (res != OFP_PKT_CONTINUE) {
+		OFP_DBG("OFP_HOOK_LOCAL_IPv6 returned %d", res);
+		return res;
+	}
+
+	return ipv6_transport_classifier(pkt, ipv6->ofp_ip6_nxt);
+}
+
+enum ofp_return_code ofp_ipv6_processing(odp_packet_t *pkt)
+{
+	int res;
 	uint32_t flags;
 	struct ofp_ip6_hdr *ipv6;
-	struct ofp_nh6_entry *nh;
+	struct ofp_nh6_entry *nh = NULL;
 	struct ofp_ifnet *dev = odp_packet_user_ptr(*pkt);
+	struct ofp_flow_cache6_entry *fc = NULL;
 	int is_ours = 0;
 
 	ipv6 = (struct ofp_ip6_hdr *)odp_packet_l3_ptr(*pkt, NULL);
@@ -475,6 +1352,11 @@ enum ofp_return_code ofp_ipv6_processing(odp_packet_t *pkt)
 	if (odp_unlikely(ipv6 == NULL))
 		return OFP_PKT_DROP;
 
+	if (odp_unlikely(ofp_packet_pullup(pkt, odp_packet_l3_offset(*pkt),
+					   OFP_PKT_PULLUP_LEN)))
+		return OFP_PKT_DROP;
+	ipv6 = (struct ofp_ip6_hdr *)odp_packet_l3_ptr(*pkt, NULL);
+
 	/* is ipv6->dst_addr one of my IPv6 addresses from this interface*/
 	if (ofp_ip6_equal(dev->ip6_addr, ipv6->ip6_dst.ofp_s6_addr) ||
 		OFP_IN6_IS_SOLICITED_NODE_MC(ipv6->ip6_dst, dev->ip6_addr) ||
@@ -484,41 +1366,47 @@ enum ofp_return_code ofp_ipv6_processing(odp_packet_t *pkt)
 
 			is_ours = 1;
 	}
-	/* check if it's ours for another ipv6 address */
+	/*
+	 * One route lookup decides between local delivery for another
+	 * address of ours and forwarding. Cached destinations are
+	 * forwarded ones.
+	 */
 	if (!is_ours) {
-		nh = ofp_get_next_hop6(dev->vrf, ipv6->ip6_dst.ofp_s6_addr, &flags);
-		if (nh && (nh->flags & OFP_RTF_LOCAL))
-			is_ours = 1;
+		fc = ofp_flow_cache6_lookup(dev->vrf,
+					    ipv6->ip6_dst.ofp_s6_addr);
+		if (fc && ofp_flow_cache6_hit(fc)) {
+			nh = fc->nh;
+		} else {
+			nh = ofp_get_next_hop6(dev->vrf,
+					       ipv6->ip6_dst.ofp_s6_addr,
+					       &flags);
+			if (nh && (nh->flags & OFP_RTF_LOCAL))
+				is_ours = 1;
+		}
 	}
 
 	if (is_ours) {
-		OFP_HOOK(OFP_HOOK_LOCAL, *pkt, &protocol, &res);
-		if (res != OFP_PKT_CONTINUE) {
-			OFP_DBG("OFP_HOOK_LOCAL returned %d", res);
-			return res;
-		}
-
-		OFP_HOOK(OFP_HOOK_LOCAL_IPv6, *pkt, NULL, &res);
-		if (res != OFP_PKT_CONTINUE) {
-			OFP_DBG("OFP_HOOK_LOCAL_IPv6 returned %d", res);
-			return res;
-		}
-
-		return ipv6_transport_classifier(pkt, ipv6->ofp_ip6_nxt);
-
+		if (flow_handoff(*pkt, dev, ipv6_flow_hash(ipv6)))
+			return OFP_PKT_PROCESSED;
+		if (ofp_ct_table &&
+		    ofp_ct_ipv6_input(*pkt, dev->vrf) == OFP_PKT_DROP)
+			return OFP_PKT_DROP;
+		return ipv6_input_local(pkt, ipv6);
 	}
 
+	if (ofp_ct_table && ofp_ct_ipv6_input(*pkt, dev->vrf) == OFP_PKT_DROP)
+		return OFP_PKT_DROP;
+
 	OFP_HOOK(OFP_HOOK_FWD_IPv6, *pkt, NULL, &res);
 	if (res != OFP_PKT_CONTINUE) {
 		OFP_DBG("OFP_HOOK_FWD_IPv6 returned %d", res);
 		return res;
 	}
 
-	nh = ofp_get_next_hop6(dev->vrf, ipv6->ip6_dst.ofp_s6_addr, &flags);
 	if (nh == NULL)
 		return OFP_PKT_CONTINUE;
 
-	return ofp_ip6_output(*pkt, nh);
+	return ofp_ip6_output_inline(*pkt, nh, fc);
 }
 #endif /* INET6 */
 
@@ -563,6 +1451,7 @@ enum ofp_return_code ofp_arp_processing(odp_packet_t *pkt)
 
 	if (odp_unlikely(arp == NULL)) {
 		OFP_DBG("arp is NULL");
+		OFP_DROP_STAT(ARP_BAD);
 		return OFP_PKT_DROP;
 	}
 
@@ -713,10 +1602,49 @@ static void send_arp_request(struct ofp_ifnet *dev, uint32_t gw)
 		odp_packet_free(pkt);
 }
 
+/*
+ * ODP has no packet metadata for VLAN tags, so tags are inserted and
+ * removed in the frame. The ethertype of the frame is already at the
+ * right offset in both cases: only the two MAC addresses are moved.
+ */
+#define ETHER_ADDRS_LEN (2 * OFP_ETHER_ADDR_LEN)
+
+static inline int vlan_tag_insert(odp_packet_t pkt, uint16_t vlan)
+{
+	uint8_t *old = odp_packet_data(pkt);
+	struct ofp_ether_vlan_header *eth_vlan;
+
+	eth_vlan = odp_packet_push_head(pkt, OFP_ETHER_VLAN_ENCAP_LEN);
+	if (odp_unlikely(!eth_vlan))
+		return -1;
+
+	memmove(eth_vlan, old, ETHER_ADDRS_LEN);
+	eth_vlan->evl_encap_proto = odp_cpu_to_be_16(OFP_ETHERTYPE_VLAN);
+	eth_vlan->evl_tag = odp_cpu_to_be_16(vlan);
+	odp_packet_l3_offset_set(pkt, odp_packet_l3_offset(pkt) +
+				 OFP_ETHER_VLAN_ENCAP_LEN);
+	return 0;
+}
+
+static inline int vlan_tag_remove(odp_packet_t pkt)
+{
+	uint8_t *old = odp_packet_data(pkt);
+	uint8_t *eth;
+
+	eth = odp_packet_pull_head(pkt, OFP_ETHER_VLAN_ENCAP_LEN);
+	if (odp_unlikely(!eth))
+		return -1;
+
+	memmove(eth, old, ETHER_ADDRS_LEN);
+	odp_packet_l3_offset_set(pkt, odp_packet_l3_offset(pkt) -
+				 OFP_ETHER_VLAN_ENCAP_LEN);
+	return 0;
+}
+
 enum ofp_return_code ofp_send_frame(struct ofp_ifnet *dev, odp_packet_t pkt)
 {
-	struct ofp_ether_header *eth, eth_tmp;
-	struct ofp_ether_vlan_header *eth_vlan, eth_vlan_tmp;
+	struct ofp_ether_header *eth;
+	struct ofp_ether_vlan_header *eth_vlan;
 	uint32_t pkt_len, eth_hdr_len;
 	enum ofp_return_code rc;
 
@@ -735,40 +1663,13 @@ enum ofp_return_code ofp_send_frame(struct ofp_ifnet *dev, odp_packet_t pkt)
 		if (dev->vlan) {
 			/* change vlan */
 			eth_vlan->evl_tag = odp_cpu_to_be_16(dev->vlan);
-		} else {
-			/* remove existing vlan */
-			eth_vlan_tmp = *eth_vlan;
-			eth = odp_packet_pull_head(pkt, 4);
-			if (!eth) {
-				OFP_ERR("odp_packet_pull_head failed");
-				return OFP_PKT_DROP;
-			}
-
-			odp_packet_l3_offset_set(pkt,
-						 odp_packet_l3_offset(pkt) - 4);
-			ofp_copy_mac(eth->ether_dhost, eth_vlan_tmp.evl_dhost);
-			ofp_copy_mac(eth->ether_shost, eth_vlan_tmp.evl_shost);
-			eth->ether_type = eth_vlan_tmp.evl_proto;
-		}
-	} else {
-		if (dev->vlan) {
-			/* insert vlan */
-			eth_tmp = *eth;
-			eth_vlan = odp_packet_push_head(pkt, 4);
-			if (!eth_vlan) {
-				OFP_ERR("odp_packet_push_head failed");
-				return OFP_PKT_DROP;
-			}
-
-			odp_packet_l3_offset_set(pkt,
-						 odp_packet_l3_offset(pkt) + 4);
-			ofp_copy_mac(eth_vlan->evl_dhost, eth_tmp.ether_dhost);
-			ofp_copy_mac(eth_vlan->evl_shost, eth_tmp.ether_shost);
-			eth_vlan->evl_encap_proto =
-				odp_cpu_to_be_16(OFP_ETHERTYPE_VLAN);
-			eth_vlan->evl_tag = odp_cpu_to_be_16(dev->vlan);
-			eth_vlan->evl_proto = eth_tmp.ether_type;
+		} else if (vlan_tag_remove(pkt)) {
+			OFP_ERR("odp_packet_pull_head failed");
+			return OFP_PKT_DROP;
 		}
+	} else if (dev->vlan && vlan_tag_insert(pkt, dev->vlan)) {
+		OFP_ERR("odp_packet_push_head failed");
+		return OFP_PKT_DROP;
 	}
 
 	if (dev->vlan)
@@ -781,6 +1682,7 @@ enum ofp_return_code ofp_send_frame(struct ofp_ifnet *dev, odp_packet_t pkt)
 	if (pkt_len > dev->if_mtu) {
 		OFP_ERR("Packet size bigger than MTU: %d %d", pkt_len,
 			dev->if_mtu);
+		OFP_DROP_STAT(IP_MTU);
 		return OFP_PKT_DROP;
 	}
 
@@ -791,18 +1693,66 @@ enum ofp_return_code ofp_send_frame(struct ofp_ifnet *dev, odp_packet_t pkt)
 	return ofp_send_pending_pkt();
 }
 
+/*
+ * A packet of hlen bytes of writable header followed by len bytes of
+ * pkt from off. With share, a slice that runs to the end of pkt shares
+ * the data with pkt by reference. A reference always runs to the end
+ * and the shared data must not be trimmed, so other slices, and those
+ * the reference cannot be made for, are copies of the len bytes only.
+ * Shared data must not be written, nor the packet extended at the
+ * tail. The header is left uninitialized and pkt is not modified.
+ */
+static odp_packet_t ofp_packet_slice(odp_packet_t pkt, uint32_t off,
+				     uint32_t len, uint32_t hlen, int share)
+{
+	odp_packet_t hdr, slice;
+
+	if (!share || off + len != odp_packet_len(pkt))
+		goto copy;
+
+	hdr = ofp_packet_alloc(hlen);
+	if (hdr == ODP_PACKET_INVALID)
+		return ODP_PACKET_INVALID;
+
+	slice = odp_packet_ref_pkt(pkt, off, hdr);
+	if (odp_likely(slice != ODP_PACKET_INVALID))
+		return slice;
+	odp_packet_free(hdr);
+
+copy:
+	slice = ofp_packet_alloc(hlen + len);
+	if (slice == ODP_PACKET_INVALID)
+		return ODP_PACKET_INVALID;
+
+	if (odp_packet_copy_from_pkt(slice, hlen, pkt, off, len)) {
+		odp_packet_free(slice);
+		return ODP_PACKET_INVALID;
+	}
+	return slice;
+}
+
+/*
+ * The fragments get new IP headers in front of a copy of their part of
+ * the payload, the last one shares the tail of pkt instead. Tunnel
+ * output may encrypt or pad a fragment in place, and a packet looped
+ * back goes through input processing, so those fragments are all
+ * copies.
+ */
 static enum ofp_return_code ofp_fragment_pkt(odp_packet_t pkt,
 					     struct ip_out *odata)
 {
 	struct ofp_ip *ip, *ip_new;
-	int pl_len, seg_len, pl_pos, flen, hwlen;
+	int pl_len, seg_len, pl_pos, flen;
 	uint16_t frag, frag_new;
-	uint8_t *payload_new;
 	uint32_t payload_offset;
 	odp_packet_t pkt_new;
 	int ret = OFP_PKT_PROCESSED;
+	int share;
 
 	ip = (struct ofp_ip *)odp_packet_l3_ptr(pkt, NULL);
+	share = !odata->is_local_address &&
+		ofp_if_type(odata->dev_out) != OFP_IFT_GRE &&
+		ofp_if_type(odata->dev_out) != OFP_IFT_VXLAN;
 
 	/*
 	 * Copy fragment IP options into a separate buffer, which is
@@ -854,11 +1804,11 @@ static enum ofp_return_code ofp_fragment_pkt(odp_packet_t pkt,
 		seg_len = (odata->dev_out->if_mtu - f_ip_hlen) & 0xfff8;
 		flen = (pl_len - pl_pos) > seg_len ?
 			seg_len : (pl_len - pl_pos);
-		hwlen = flen + f_ip_hlen;
 
-		pkt_new = ofp_packet_alloc(hwlen);
+		pkt_new = ofp_packet_slice(pkt, payload_offset + pl_pos, flen,
+					   f_ip_hlen, share);
 		if (pkt_new == ODP_PACKET_INVALID) {
-			OFP_ERR("ofp_packet_alloc failed");
+			OFP_ERR("ofp_packet_slice failed");
 			return OFP_PKT_DROP;
 		}
 		odp_packet_user_ptr_set(pkt_new, odp_packet_user_ptr(pkt));
@@ -876,16 +1826,6 @@ static enum ofp_return_code ofp_fragment_pkt(odp_packet_t pkt,
 			memcpy(ip_new + 1, fopts, fopts_len);
 
 		ip_new->ip_hl = f_ip_hl;
-
-		payload_new = (uint8_t *)ip_new + f_ip_hlen;
-
-		if (odp_packet_copy_to_mem(pkt, payload_offset + pl_pos,
-					    flen, payload_new) < 0) {
-			OFP_ERR("odp_packet_copy_to_mem failed");
-			odp_packet_free(pkt_new);
-			return OFP_PKT_DROP;
-		};
-
 		ip_new->ip_len = odp_cpu_to_be_16(flen + f_ip_hlen);
 
 		frag_new = frag + pl_pos/8;
@@ -999,12 +1939,17 @@ static enum ofp_return_code ofp_ip_output_add_eth(odp_packet_t pkt,
 		ofp_if_type(odata->dev_out) == OFP_IFT_LOOP) {
 		odata->is_local_address = 1;
 		ofp_copy_mac(eth->ether_dhost, odata->dev_out->mac);
-	} else if (ofp_get_mac(odata->dev_out, odata->nh,
-			       gw, is_link_local,
-			       eth->ether_dhost) < 0) {
-		send_arp_request(odata->dev_out, gw);
-		return ofp_arp_save_ipv4_pkt(pkt, odata->nh,
-					     gw, is_link_local, odata->dev_out);
+	} else {
+		OFP_PROF_START(prof);
+
+		if (ofp_get_mac(odata->dev_out, odata->nh, gw, is_link_local,
+				eth->ether_dhost) < 0) {
+			send_arp_request(odata->dev_out, gw);
+			return ofp_arp_save_ipv4_pkt(pkt, odata->nh, gw,
+						     is_link_local,
+						     odata->dev_out);
+		}
+		OFP_PROF_END(ARP_RESOLVE, prof);
 	}
 	ofp_copy_mac(eth->ether_shost, odata->dev_out->mac);
 
@@ -1019,9 +1964,39 @@ static enum ofp_return_code ofp_ip_output_add_eth(odp_packet_t pkt,
 		eth_vlan->evl_proto = odp_cpu_to_be_16(OFP_ETHERTYPE_IP);
 	}
 
+	/* Unicast to a neighbor over Ethernet: remember the header */
+	if (odata->fc && !odata->is_local_address &&
+	    !OFP_IN_MULTICAST(addr) &&
+	    ofp_if_type(odata->dev_out) == OFP_IFT_ETHER)
+		ofp_flow_cache_fill(odata->fc, odata->vrf,
+				    odata->ip->ip_dst.s_addr, odata->dev_out,
+				    odata->nh, l2_addr, l2_size);
+
 	return OFP_PKT_CONTINUE;
 }
 
+/*
+ * Output a forwarded packet with the interface and the Ethernet header
+ * of a valid flow cache entry.
+ */
+static inline enum ofp_return_code ofp_ip_output_cached(odp_packet_t pkt,
+							struct ofp_ip *ip,
+							struct ofp_flow_cache_entry *fc)
+{
+	void *l2_addr;
+
+	trim_tail(pkt, odp_be_to_cpu_16(ip->ip_len));
+
+	l2_addr = trim_for_output(pkt, fc->l2_len, ip->ip_hl * 4);
+	if (odp_unlikely(l2_addr == NULL)) {
+		OFP_DBG("l2_addr == NULL");
+		return OFP_PKT_DROP;
+	}
+	memcpy(l2_addr, fc->l2, fc->l2_len);
+
+	return send_pkt_out(fc->dev_out, pkt);
+}
+
 
 static inline enum ofp_return_code ofp_ip_output_send(odp_packet_t pkt,
 						      struct ip_out *odata)
@@ -1040,9 +2015,24 @@ static enum ofp_return_code ofp_ip_output_find_route(struct ip_out *odata)
 	uint32_t flags;
 
 	if (!odata->nh) {
+		OFP_PROF_START(prof);
+
 		odata->nh = ofp_get_next_hop(odata->vrf, odata->ip->ip_dst.s_addr, &flags);
-		if (!odata->nh)
+		if (!odata->nh) {
+			OFP_DROP_STAT(IP_NO_ROUTE);
+			return OFP_PKT_DROP;
+		}
+		OFP_PROF_END(ROUTE_LOOKUP, prof);
+	}
+
+	if (odata->nh->flags & OFP_RTF_MULTIPATH) {
+		odata->nh = ofp_nh_group_select(odata->nh, odata->ip);
+		if (!odata->nh) {
+			OFP_DROP_STAT(IP_NO_ROUTE);
 			return OFP_PKT_DROP;
+		}
+		/* The flow cache is per destination, not per flow */
+		odata->fc = NULL;
 	}
 
 	OFP_DBG("Found Route IP: %s NH: %s ARP Idx: %u",
@@ -1055,6 +2045,7 @@ static enum ofp_return_code ofp_ip_output_find_route(struct ip_out *odata)
 
 	if (!odata->dev_out) {
 		OFP_DBG("!dev_out");
+		OFP_DROP_STAT(IP_NO_ROUTE);
 		return OFP_PKT_DROP;
 	}
 
@@ -1065,6 +2056,53 @@ static enum ofp_return_code ofp_ip_output_find_route(struct ip_out *odata)
 	return OFP_PKT_CONTINUE;
 }
 
+enum ofp_return_code ofp_ip_output_ipsec(odp_packet_t pkt)
+{
+	struct ofp_ifnet *send_ctx = odp_packet_user_ptr(pkt);
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, NULL);
+	struct ofp_flow_cache_entry *fc = NULL;
+
+	if (odp_likely(ip != NULL))
+		fc = ofp_flow_cache_lookup(send_ctx ? send_ctx->vrf : 0,
+					   ip->ip_dst.s_addr);
+
+	return ofp_ip_output_common_inline(pkt, NULL, 0, OFP_IPSEC_SA_INVALID,
+					   fc);
+}
+
+odp_packet_t ofp_packet_clone(odp_packet_t pkt, uint32_t hdr_len)
+{
+	odp_packet_t hdr, ref;
+
+	if (hdr_len >= odp_packet_len(pkt))
+		return odp_packet_copy(pkt, ofp_packet_pool);
+
+	hdr = ofp_packet_alloc(hdr_len);
+	if (hdr == ODP_PACKET_INVALID)
+		return ODP_PACKET_INVALID;
+
+	if (odp_packet_copy_from_pkt(hdr, 0, pkt, 0, hdr_len)) {
+		odp_packet_free(hdr);
+		return ODP_PACKET_INVALID;
+	}
+
+	ref = odp_packet_ref_pkt(pkt, hdr_len, hdr);
+	if (ref == ODP_PACKET_INVALID) {
+		odp_packet_free(hdr);
+		return odp_packet_copy(pkt, ofp_packet_pool);
+	}
+
+	/* The reference has the metadata of hdr */
+	if (odp_packet_has_l2(pkt))
+		odp_packet_l2_offset_set(ref, odp_packet_l2_offset(pkt));
+	odp_packet_l3_offset_set(ref, odp_packet_l3_offset(pkt));
+	odp_packet_l4_offset_set(ref, odp_packet_l4_offset(pkt));
+	odp_packet_user_ptr_set(ref, odp_packet_user_ptr(pkt));
+	*ofp_packet_user_area(ref) = *ofp_packet_user_area(pkt);
+
+	return ref;
+}
+
 enum ofp_return_code ofp_ip_send(odp_packet_t pkt,
 				 struct ofp_nh_entry *nh_param)
 {
@@ -1140,6 +2178,163 @@ static inline void ofp_chksum_insert(odp_packet_t pkt,
 	}
 }
 
+/*
+ * Cut a TCP burst into segments of tso_segsz payload. The IP and TCP
+ * headers of the burst are the template of each segment, only the
+ * lengths, sequence numbers and flags differ. A UDP send of
+ * OFP_UDP_SEGMENT is cut the same way into datagrams, each with its
+ * own IP ID and checksum. With odata the route is already known and
+ * the segments go straight to the interface, without it each takes
+ * the whole output path.
+ */
+static enum ofp_return_code ofp_tso_segment(odp_packet_t pkt,
+					    struct ofp_nh_entry *nh,
+					    struct ip_out *odata)
+{
+	struct ofp_ip *ip, *ip_new;
+	struct ofp_tcphdr *th, *th_new;
+	struct ofp_udphdr *uh_new;
+	int ip_hlen, hlen, pl_len, pl_pos, seg_len, flen, is_udp;
+	uint32_t seq, payload_offset;
+	uint8_t th_flags;
+	odp_packet_t pkt_new;
+	enum ofp_return_code ret;
+
+	ip = (struct ofp_ip *)odp_packet_l3_ptr(pkt, NULL);
+	ip_hlen = ip->ip_hl << 2;
+	th = (struct ofp_tcphdr *)((uint8_t *)ip + ip_hlen);
+	is_udp = ip->ip_p == OFP_IPPROTO_UDP;
+	if (is_udp) {
+		hlen = ip_hlen + sizeof(struct ofp_udphdr);
+		seq = 0;
+		th_flags = 0;
+	} else {
+		hlen = ip_hlen + (th->th_off << 2);
+		seq = odp_be_to_cpu_32(th->th_seq);
+		th_flags = th->th_flags;
+	}
+	pl_len = odp_be_to_cpu_16(ip->ip_len) - hlen;
+	payload_offset = odp_packet_l3_offset(pkt) + hlen;
+	seg_len = ofp_packet_user_area(pkt)->tso_segsz;
+
+	for (pl_pos = 0; pl_pos < pl_len; pl_pos += flen) {
+		flen = (pl_len - pl_pos) > seg_len ?
+			seg_len : (pl_len - pl_pos);
+
+		pkt_new = ofp_packet_alloc(hlen + flen);
+		if (pkt_new == ODP_PACKET_INVALID) {
+			OFP_ERR("ofp_packet_alloc failed");
+			return OFP_PKT_DROP;
+		}
+		odp_packet_user_ptr_set(pkt_new, odp_packet_user_ptr(pkt));
+		*ofp_packet_user_area(pkt_new) = *ofp_packet_user_area(pkt);
+		ofp_packet_user_area(pkt_new)->tso_segsz = 0;
+		/* Paced segments depart one after the other */
+		if (ofp_packet_user_area(pkt_new)->valid & OFP_UA_PACE)
+			ofp_packet_user_area(pkt_new)->tx_time +=
+				(uint64_t)(pl_pos / seg_len) *
+				ofp_packet_user_area(pkt)->tx_gap;
+
+		odp_packet_l2_offset_set(pkt_new, 0);
+		odp_packet_l3_offset_set(pkt_new, 0);
+		odp_packet_l4_offset_set(pkt_new, ip_hlen);
+		ip_new = odp_packet_l3_ptr(pkt_new, NULL);
+		memcpy(ip_new, ip, hlen);
+
+		/* The payload may span several segments of pkt_new */
+		if (odp_packet_copy_from_pkt(pkt_new, hlen, pkt,
+					     payload_offset + pl_pos,
+					     flen) < 0) {
+			OFP_ERR("odp_packet_copy_from_pkt failed");
+			odp_packet_free(pkt_new);
+			return OFP_PKT_DROP;
+		}
+
+		ip_new->ip_len = odp_cpu_to_be_16(hlen + flen);
+		if (is_udp) {
+			uh_new = (struct ofp_udphdr *)((uint8_t *)ip_new +
+						       ip_hlen);
+			uh_new->uh_ulen = odp_cpu_to_be_16(
+				sizeof(struct ofp_udphdr) + flen);
+		} else {
+			th_new = (struct ofp_tcphdr *)((uint8_t *)ip_new +
+						       ip_hlen);
+			th_new->th_seq = odp_cpu_to_be_32(seq + pl_pos);
+			th_new->th_flags = th_flags;
+			if (pl_pos)
+				th_new->th_flags &= ~OFP_TH_CWR;
+			if (pl_pos + flen < pl_len)
+				th_new->th_flags &= ~(OFP_TH_FIN |
+						      OFP_TH_PUSH);
+		}
+
+		if (odata) {
+			if (pl_pos)
+				ofp_ip_id_assign(ip_new);
+			odata->ip = ip_new;
+			odata->insert_checksum = 1;
+			ret = ofp_ip_output_continue(pkt_new, odata);
+		} else {
+			ret = ofp_ip_output(pkt_new, nh);
+		}
+		if (ret == OFP_PKT_DROP) {
+			odp_packet_free(pkt_new);
+			return OFP_PKT_DROP;
+		}
+	}
+
+	if (is_udp)
+		OFP_UPDATE_PACKET_STAT(tx_udp_gso, 1);
+	else
+		OFP_UPDATE_PACKET_STAT(tx_tcp_gso, 1);
+
+	odp_packet_free(pkt);
+	return OFP_PKT_PROCESSED;
+}
+
+/*
+ * Send a TCP burst as one packet to an interface that segments it in
+ * hardware, or segment it here. UDP sends are segmented here.
+ */
+static enum ofp_return_code ofp_tso_output(odp_packet_t pkt,
+					   struct ip_out *odata)
+{
+#ifdef ODP_LSO_PROFILE_INVALID
+	struct ofp_ifnet *dev = odata->dev_out;
+	struct ofp_ifnet *phys = ofp_get_ifnet(dev->port, 0);
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(pkt);
+	struct ofp_tcphdr *th;
+	odp_packet_lso_opt_t lso_opt;
+	enum ofp_return_code ret;
+
+	/* ODP has no LSO protocol for UDP, it is always cut here */
+	if (odata->ip->ip_p == OFP_IPPROTO_TCP &&
+	    (dev->chksum_offload_flags & OFP_IF_TCP_TSO) &&
+	    ofp_if_type(dev) == OFP_IFT_ETHER &&
+	    ua->tso_segsz <= phys->lso_max_payload) {
+		th = (struct ofp_tcphdr *)((uint8_t *)odata->ip +
+					   (odata->ip->ip_hl << 2));
+
+		ofp_chksum_insert(pkt, odata->ip, dev->chksum_offload_flags);
+		ret = ofp_ip_output_add_eth(pkt, odata);
+		if (ret != OFP_PKT_CONTINUE)
+			return ret;
+
+		lso_opt.lso_profile = phys->lso_profile;
+		lso_opt.payload_offset = odp_packet_l3_offset(pkt) +
+			(odata->ip->ip_hl << 2) + (th->th_off << 2);
+		lso_opt.max_payload_len = ua->tso_segsz;
+		if (!odata->is_local_address &&
+		    odp_packet_lso_request(pkt, &lso_opt)) {
+			OFP_DBG("odp_packet_lso_request failed");
+			return OFP_PKT_DROP;
+		}
+		return ofp_ip_output_send(pkt, odata);
+	}
+#endif
+	return ofp_tso_segment(pkt, NULL, odata);
+}
+
 enum ofp_return_code ofp_ip_output(odp_packet_t pkt, struct ofp_nh_entry *nh)
 {
 	ofp_ipsec_sa_handle sa = OFP_IPSEC_SA_INVALID;
@@ -1152,16 +2347,133 @@ enum ofp_return_code ofp_ip_output(odp_packet_t pkt, struct ofp_nh_entry *nh)
 	return ofp_ip_output_common(pkt, nh, 1, sa);
 }
 
-static inline enum ofp_return_code ofp_ip_output_common_inline(odp_packet_t pkt,
-							       struct ofp_nh_entry *nh_param,
-							       int is_local_out,
-							       ofp_ipsec_sa_handle sa)
+enum ofp_return_code ofp_ip_output_flow(odp_packet_t pkt,
+					struct ofp_flow_cache_entry *fc)
 {
-	struct ofp_ifnet *send_ctx = odp_packet_user_ptr(pkt);
-	struct ip_out odata;
-	enum ofp_return_code ret;
-	struct ofp_ip *ip;
-
+	ofp_ipsec_sa_handle sa = OFP_IPSEC_SA_INVALID;
+	struct ofp_ifnet *ifnet = odp_packet_user_ptr(pkt);
+	uint16_t vrf = ifnet ? ifnet->vrf : 0;
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, NULL);
+
+	if (ofp_ipsec_out_lookup(vrf, pkt, &sa) == OFP_PKT_DROP)
+		return OFP_PKT_DROP;
+
+	if (odp_likely(ip != NULL && ofp_flow_cache_in_use()))
+		ofp_flow_cache_entry_lookup(fc, vrf, ip->ip_dst.s_addr);
+	else
+		fc = NULL;
+
+	return ofp_ip_output_common_inline(pkt, NULL, 1, sa, fc);
+}
+
+/*
+ * 0: replies take the whole output path, 1: sources on the subnet of
+ * the ingress interface get replies with ofp_ip_output_reflect(), 2:
+ * all sources do, assuming the routes are symmetric.
+ */
+int ofp_ip_reflect = 1;
+
+SYSCTL_DECL(_net_inet_ip);
+OFP_SYSCTL_INT(_net_inet_ip, OFP_OID_AUTO, reflect, OFP_CTLFLAG_RW,
+	       &ofp_ip_reflect, 0,
+	       "Send replies back through the ingress Ethernet header");
+
+static inline int ip_out_hooks(void)
+{
+	ofp_pkt_hook *hook = ofp_get_packet_hooks();
+	ofp_pkt_hook_burst *burst = ofp_get_packet_burst_hooks();
+
+	return (hook && hook[OFP_HOOK_OUT_IPv4]) ||
+		(burst && burst[OFP_HOOK_OUT_IPv4]);
+}
+
+static inline int ip_reflect_onlink(struct ofp_ifnet *dev, uint32_t addr)
+{
+	int i;
+
+	for (i = 0; i < OFP_NUM_IFNET_IP_ADDRS; i++) {
+		struct ofp_ifnet_ipaddr *ia = &dev->ip_addr_info[i];
+		uint32_t mask;
+
+		if (!ia->ip_addr || !ia->masklen)
+			continue;
+		mask = odp_cpu_to_be_32(~0U << (32 - ia->masklen));
+		if (!((addr ^ ia->ip_addr) & mask))
+			return 1;
+	}
+	return 0;
+}
+
+enum ofp_return_code ofp_ip_output_reflect(odp_packet_t pkt,
+					   struct ofp_ifnet *dev)
+{
+	struct ofp_ip *ip = odp_packet_l3_ptr(pkt, NULL);
+	struct ofp_ether_header *eth;
+	uint32_t l3_off, l2_len;
+
+	if (odp_unlikely(ip == NULL)) {
+		odp_packet_l3_offset_set(pkt, 0);
+		ip = odp_packet_l3_ptr(pkt, NULL);
+	}
+	l3_off = odp_packet_l3_offset(pkt);
+	l2_len = dev && dev->vlan ? sizeof(struct ofp_ether_vlan_header) :
+		sizeof(struct ofp_ether_header);
+
+	/* IPsec policies and output hooks need the whole path */
+	if (!ofp_ip_reflect || !dev || ofp_if_type(dev) != OFP_IFT_ETHER ||
+	    (ofp_ip4_feat() & OFP_IP4_FEAT_IPSEC) ||
+	    ip_out_hooks() ||
+	    ofp_packet_user_area(pkt)->tso_segsz ||
+	    l3_off + odp_packet_headroom(pkt) < l2_len ||
+	    odp_be_to_cpu_16(ip->ip_len) > dev->if_mtu ||
+	    OFP_IN_MULTICAST(odp_be_to_cpu_32(ip->ip_dst.s_addr)) ||
+	    (ofp_ip_reflect == 1 && !ip_reflect_onlink(dev, ip->ip_dst.s_addr)))
+		goto slow;
+
+	/* The ingress header is still there, in the data or the headroom */
+	trim_tail(pkt, odp_be_to_cpu_16(ip->ip_len));
+	eth = trim_for_output(pkt, l2_len, ip->ip_hl * 4);
+	if (odp_unlikely(eth == NULL))
+		goto slow;
+
+	if (memcmp(eth->ether_dhost, dev->mac, OFP_ETHER_ADDR_LEN))
+		goto slow;
+	if (dev->vlan) {
+		struct ofp_ether_vlan_header *eth_vlan = (void *)eth;
+
+		if (eth_vlan->evl_encap_proto !=
+		    odp_cpu_to_be_16(OFP_ETHERTYPE_VLAN) ||
+		    OFP_EVL_VLANOFTAG(odp_be_to_cpu_16(eth_vlan->evl_tag)) !=
+		    dev->vlan ||
+		    eth_vlan->evl_proto != odp_cpu_to_be_16(OFP_ETHERTYPE_IP))
+			goto slow;
+	} else if (eth->ether_type != odp_cpu_to_be_16(OFP_ETHERTYPE_IP)) {
+		goto slow;
+	}
+
+	ofp_copy_mac(eth->ether_dhost, eth->ether_shost);
+	ofp_copy_mac(eth->ether_shost, dev->mac);
+
+	ofp_ip_id_assign(ip);
+	ofp_chksum_insert(pkt, ip, dev->chksum_offload_flags);
+
+	return send_pkt_out(dev, pkt);
+
+slow:
+	return ofp_ip_output(pkt, NULL);
+}
+
+static inline enum ofp_return_code ofp_ip_output_common_inline(odp_packet_t pkt,
+							       struct ofp_nh_entry *nh_param,
+							       int is_local_out,
+							       ofp_ipsec_sa_handle sa,
+							       struct ofp_flow_cache_entry *fc)
+{
+	struct ofp_ifnet *send_ctx = odp_packet_user_ptr(pkt);
+	struct ip_out odata;
+	enum ofp_return_code ret;
+	struct ofp_ip *ip;
+
 	OFP_HOOK(OFP_HOOK_OUT_IPv4, pkt, NULL, &ret);
 	if (ret != OFP_PKT_CONTINUE) {
 		ofp_ipsec_output_cancel(sa);
@@ -1175,6 +2487,11 @@ static inline enum ofp_return_code ofp_ip_output_common_inline(odp_packet_t pkt,
 		ip = odp_packet_l3_ptr(pkt, NULL);
 	}
 	if (sa != OFP_IPSEC_SA_INVALID) {
+		/* Each segment of a TCP burst is protected on its own */
+		if (odp_unlikely(ofp_packet_user_area(pkt)->tso_segsz)) {
+			ofp_ipsec_output_cancel(sa);
+			return ofp_tso_segment(pkt, nh_param, NULL);
+		}
 		if (is_local_out) {
 			ofp_chksum_insert(pkt, ip, 0);
 		}
@@ -1188,6 +2505,21 @@ static inline enum ofp_return_code ofp_ip_output_common_inline(odp_packet_t pkt,
 	odata.is_local_address = 0;
 	odata.nh = nh_param;
 	odata.insert_checksum = is_local_out;
+	odata.fc = NULL;
+
+	if (fc && sa == OFP_IPSEC_SA_INVALID) {
+		if (ofp_flow_cache_match(fc, odata.vrf, ip->ip_dst.s_addr) &&
+		    odp_be_to_cpu_16(ip->ip_len) <= fc->dev_out->if_mtu &&
+		    !ofp_packet_user_area(pkt)->tso_segsz) {
+			if (is_local_out) {
+				ofp_ip_id_assign(ip);
+				ofp_chksum_insert(pkt, ip,
+						  fc->dev_out->chksum_offload_flags);
+			}
+			return ofp_ip_output_cached(pkt, ip, fc);
+		}
+		odata.fc = fc;
+	}
 
 	if ((ret = ofp_ip_output_find_route(&odata)) != OFP_PKT_CONTINUE)
 		return ret;
@@ -1195,6 +2527,9 @@ static inline enum ofp_return_code ofp_ip_output_common_inline(odp_packet_t pkt,
 	if (is_local_out)
 		ofp_ip_id_assign(odata.ip);
 
+	if (odp_unlikely(ofp_packet_user_area(pkt)->tso_segsz))
+		return ofp_tso_output(pkt, &odata);
+
 	/* Fragmentation */
 	if (odp_be_to_cpu_16(odata.ip->ip_len) > odata.dev_out->if_mtu) {
 		OFP_DBG("Fragmentation required");
@@ -1309,6 +2644,17 @@ enum ofp_return_code ofp_ip6_send(odp_packet_t pkt,
 
 enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 	struct ofp_nh6_entry *nh_param)
+{
+	return ofp_ip6_output_inline(pkt, nh_param, NULL);
+}
+
+/*
+ * Output an IPv6 packet. fc is the flow cache slot of a forwarded
+ * packet or NULL.
+ */
+static inline enum ofp_return_code ofp_ip6_output_inline(odp_packet_t pkt,
+							 struct ofp_nh6_entry *nh_param,
+							 struct ofp_flow_cache6_entry *fc)
 {
 	struct ofp_ip6_hdr *ip6;
 	uint32_t l2_size;
@@ -1322,6 +2668,7 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 	int vrf = send_ctx ? send_ctx->vrf : 0;
 	uint8_t is_local_address = 0;
 	uint8_t *mac = NULL;
+	uint8_t nd6_mac[OFP_ETHER_ADDR_LEN];
 	enum ofp_return_code ret;
 
 	if (odp_packet_l3_offset(pkt) == ODP_PACKET_OFFSET_INVALID)
@@ -1337,6 +2684,18 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 	if (odp_unlikely(ip6 == NULL))
 		return OFP_PKT_DROP;
 
+	hlen = 0;
+	if (odp_packet_l4_offset(pkt) != ODP_PACKET_OFFSET_INVALID)
+		hlen = odp_packet_l4_offset(pkt) - odp_packet_l3_offset(pkt);
+
+	if (fc && ofp_flow_cache6_match(fc, vrf, ip6->ip6_dst.ofp_s6_addr)) {
+		l2_addr = trim_for_output(pkt, fc->l2_len, hlen);
+		if (odp_unlikely(l2_addr == NULL))
+			return OFP_PKT_DROP;
+		memcpy(l2_addr, fc->l2, fc->l2_len);
+		return send_pkt_out(fc->dev_out, pkt);
+	}
+
 	if (nh_param) {
 		nh = nh_param;
 		vlan = nh->vlan;
@@ -1363,9 +2722,6 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 	else
 		l2_size = sizeof(struct ofp_ether_vlan_header);
 
-	hlen = 0;
-	if (odp_packet_l4_offset(pkt) != ODP_PACKET_OFFSET_INVALID)
-		hlen = odp_packet_l4_offset(pkt) - odp_packet_l3_offset(pkt);
 	l2_addr = trim_for_output(pkt, l2_size, hlen);
 	if (odp_unlikely(l2_addr == NULL))
 		return OFP_PKT_DROP;
@@ -1375,27 +2731,19 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 	    ofp_if_type(dev_out) == OFP_IFT_LOOP) {
 		is_local_address = 1;
 		mac = dev_out->mac;
+	} else if (ofp_ip6_is_set(nh->gw)) {
+		ret = ofp_nd6_resolve(pkt, dev_out, nh->gw, &nh->nd6_idx,
+				      nd6_mac);
+		if (ret != OFP_PKT_CONTINUE)
+			return ret;
+		mac = nd6_mac;
 	} else {
-		mac = nh->mac;
-
-		if (!(((uint32_t *)mac)[0] || mac[4] || mac[5])) {
-			ofp_set_route6_params(OFP_ROUTE6_ADD, 0 /*vrf*/,
-					      dev_out->vlan, dev_out->port,
-					      ip6->ip6_dst.ofp_s6_addr,
-					      128 /*masklen*/,
-					      ofp_in6addr_any.ofp_s6_addr,
-					      OFP_RTF_HOST);
-
-			if (ofp_nd6_ns_output(dev_out, nh->gw,
-				ip6->ip6_dst.ofp_s6_addr) == OFP_PKT_DROP) {
-				OFP_ERR("MAC not set: gw = %x %x", nh->gw[0],
-					nh->gw[15]);
-				return OFP_PKT_DROP;
-			}
-			return ofp_route_save_ipv6_pkt(pkt,
-				&ip6->ip6_dst.ofp_s6_addr[0],
-				dev_out);
-		}
+		/* On link, the neighbour is the destination */
+		ret = ofp_nd6_resolve(pkt, dev_out, ip6->ip6_dst.ofp_s6_addr,
+				      NULL, nd6_mac);
+		if (ret != OFP_PKT_CONTINUE)
+			return ret;
+		mac = nd6_mac;
 	}
 
 	if (!vlan) {
@@ -1417,6 +2765,11 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 		eth_vlan->evl_proto = odp_cpu_to_be_16(OFP_ETHERTYPE_IPV6);
 	}
 
+	/* Forwarded to a neighbour over Ethernet: remember the header */
+	if (fc && !is_local_address && ofp_if_type(dev_out) == OFP_IFT_ETHER)
+		ofp_flow_cache6_fill(fc, vrf, ip6->ip6_dst.ofp_s6_addr,
+				     dev_out, nh, l2_addr, l2_size);
+
 	if (is_local_address) {
 		return send_pkt_loop(dev_out, pkt);
 	} else {
@@ -1425,12 +2778,89 @@ enum ofp_return_code ofp_ip6_output(odp_packet_t pkt,
 }
 #endif /* INET6 */
 
-enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
-	odp_queue_t in_queue, ofp_pkt_processing_func pkt_func)
+/* Input queue of the last packet received from a pktio, and its index */
+static __thread struct {
+	odp_queue_t queue;
+	struct ofp_ifnet *ifnet;
+	int idx;
+} rxq_cache;
+
+/*
+ * Count a packet received from input queue in_queue of a fast path port.
+ * The index of the queue is looked up when the queue changes.
+ */
+static inline void rx_queue_stat(struct ofp_ifnet *ifnet, odp_queue_t in_queue,
+				 uint32_t len)
+{
+	unsigned i;
+
+	if (odp_unlikely(rxq_cache.queue != in_queue ||
+			 rxq_cache.ifnet != ifnet)) {
+		for (i = 0; i < ifnet->in_queue_num; i++)
+			if (ifnet->in_queue_queue[i] == in_queue)
+				break;
+		if (i == ifnet->in_queue_num)
+			return;
+		rxq_cache.queue = in_queue;
+		rxq_cache.ifnet = ifnet;
+		rxq_cache.idx = i;
+	}
+
+	OFP_IFQ_STAT_RX(ifnet->port, rxq_cache.idx, 1, len);
+}
+
+/*
+ * Attach the input interface and the per packet input state to a
+ * received packet. Returns NULL if the packet was dropped.
+ */
+/*
+ * Received packets dropped under high memory pressure: all but ARP, TCP
+ * and ICMP, which keep connections and neighbors alive. TCP is slowed
+ * down by its window instead.
+ */
+static inline int mem_pressure_low_prio(odp_packet_t pkt)
+{
+	const uint8_t *l2 = odp_packet_data(pkt);
+	uint32_t len = odp_packet_seg_len(pkt);
+	uint32_t off = OFP_ETHER_HDR_LEN;
+	uint16_t type;
+
+	if (len < OFP_ETHER_HDR_LEN)
+		return 1;
+	type = odp_be_to_cpu_16(((const struct ofp_ether_header *)
+				 l2)->ether_type);
+	if (type == OFP_ETHERTYPE_VLAN) {
+		if (len < OFP_ETHER_HDR_LEN + OFP_ETHER_VLAN_ENCAP_LEN)
+			return 1;
+		type = odp_be_to_cpu_16(((const struct ofp_ether_vlan_header *)
+					 l2)->evl_proto);
+		off += OFP_ETHER_VLAN_ENCAP_LEN;
+	}
+
+	if (type == OFP_ETHERTYPE_ARP)
+		return 0;
+	if (type == OFP_ETHERTYPE_IP && off + sizeof(struct ofp_ip) <= len) {
+		uint8_t p = ((const struct ofp_ip *)(l2 + off))->ip_p;
+
+		return p != OFP_IPPROTO_TCP && p != OFP_IPPROTO_ICMP;
+	}
+#ifdef INET6
+	if (type == OFP_ETHERTYPE_IPV6 &&
+	    off + sizeof(struct ofp_ip6_hdr) <= len) {
+		uint8_t p = ((const struct ofp_ip6_hdr *)
+			     (l2 + off))->ofp_ip6_nxt;
+
+		return p != OFP_IPPROTO_TCP && p != OFP_IPPROTO_ICMPV6;
+	}
+#endif /* INET6 */
+	return 1;
+}
+
+static inline struct ofp_ifnet *packet_input_prepare(odp_packet_t pkt,
+						     odp_queue_t in_queue)
 {
 	struct ofp_ifnet *ifnet = NULL;
 	odp_pktio_t pktio;
-	int res;
 
 	/* Packets from VXLAN interfaces do not have an outq even
 	 * they have a valid pktio. Use loopback context instead. */
@@ -1442,10 +2872,20 @@ enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
 		if (odp_likely(pktio != ODP_PKTIO_INVALID)) {
 			/* pkt received from eth interface */
 			ifnet = ofp_get_ifnet_pktio(pktio);
+			if (in_queue != ODP_QUEUE_INVALID)
+				rx_queue_stat(ifnet, in_queue,
+					      odp_packet_len(pkt));
+			/* Both the member and its LAG count the packet */
+			if (odp_unlikely(ifnet->lag) &&
+			    ofp_lag_rx(ifnet, pkt) != ifnet) {
+				OFP_IF_STAT_RX(ifnet, 1, odp_packet_len(pkt));
+				ifnet = ifnet->lag;
+			}
+			ofp_sflow_packet(pkt, ifnet->port, OFP_SFLOW_RX);
 		} else {
 			/* loopback and cunit error */
 			odp_packet_free(pkt);
-			return OFP_PKT_DROP;
+			return NULL;
 		}
 	}
 
@@ -1457,6 +2897,15 @@ enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
 	 */
 	if (ofp_if_type(ifnet) != OFP_IFT_VXLAN) {
 		ofp_packet_user_area_reset(pkt);
+		/* VXLAN packets were counted on decapsulation */
+		OFP_IF_STAT_RX(ifnet, 1, odp_packet_len(pkt));
+	}
+
+	if (odp_unlikely(ofp_mem_pressure() == OFP_MEM_PRESSURE_HIGH) &&
+	    in_queue != ifnet->loopq_def && mem_pressure_low_prio(pkt)) {
+		OFP_DROP_STAT(MEM_PRESSURE);
+		odp_packet_free(pkt);
+		return NULL;
 	}
 
 	/*
@@ -1473,19 +2922,38 @@ enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
 		    (OFP_IF_UDP_RX_CHKSUM | OFP_IF_TCP_RX_CHKSUM))
 			ofp_packet_user_area(pkt)->chksum_flags |=
 				OFP_L4_CHKSUM_STATUS_VALID;
+
+		if (ifnet->chksum_offload_flags & OFP_IF_RX_PARSED)
+			ofp_packet_user_area(pkt)->chksum_flags |=
+				OFP_PARSE_VALID;
 	}
 
 	OFP_DEBUG_PACKET(OFP_DEBUG_PKT_RECV_NIC, pkt, ifnet->port);
+	ofp_trace(pkt, ifnet->port, OFP_TRACE_RX, 0);
+	OFP_TRACEPOINT(pkt_input, odp_packet_to_u64(pkt), ifnet->port);
 
 	OFP_UPDATE_PACKET_STAT(rx_fp, 1);
 
 	OFP_UPDATE_PACKET_LATENCY_STAT(1);
 
-	/* data link layer processing */
-	res = pkt_func(&pkt);
+	return ifnet;
+}
 
-	if (res == OFP_PKT_DROP)
+/*
+ * Apply the default action for the result of the packet processing.
+ */
+static inline enum ofp_return_code packet_input_finish(odp_packet_t pkt,
+						       struct ofp_ifnet *ifnet,
+						       enum ofp_return_code res)
+{
+	ofp_trace(pkt, ifnet->port, OFP_TRACE_DONE, res);
+
+	if (res == OFP_PKT_DROP) {
+		OFP_TRACEPOINT(pkt_drop, odp_packet_to_u64(pkt), ifnet->port,
+			       ofp_drop_last);
+		OFP_DROP_STAT(INPUT);
 		odp_packet_free(pkt);
+	}
 
 	if (res != OFP_PKT_CONTINUE)
 		return res;
@@ -1494,24 +2962,636 @@ enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
 	return ofp_sp_input(pkt, ifnet);
 }
 
+/*
+ * Continue local delivery of a packet from a flow queue, in the atomic
+ * context of the queue.
+ */
+static void flow_resume(odp_packet_t pkt)
+{
+	struct ofp_ifnet *dev = odp_packet_user_ptr(pkt);
+	uint8_t *l3 = odp_packet_l3_ptr(pkt, NULL);
+	enum ofp_return_code res = OFP_PKT_DROP;
+
+	if (odp_likely(l3 && (*l3 >> 4) == OFP_IPVERSION))
+		res = ipv4_input_finish(&pkt, dev, (struct ofp_ip *)l3, NULL,
+					1, NULL, OFP_IP4_FEAT_ALL);
+#ifdef INET6
+	else if (l3 && (*l3 & 0xf0) == OFP_IPV6_VERSION)
+		res = ipv6_input_local(&pkt, (struct ofp_ip6_hdr *)l3);
+#endif /* INET6 */
+
+	packet_input_finish(pkt, dev, res);
+}
+
+enum ofp_return_code ofp_packet_input(odp_packet_t pkt,
+	odp_queue_t in_queue, ofp_pkt_processing_func pkt_func)
+{
+	struct ofp_ifnet *ifnet;
+	int res;
+
+	ifnet = packet_input_prepare(pkt, in_queue);
+	if (odp_unlikely(ifnet == NULL))
+		return OFP_PKT_DROP;
+
+	/* data link layer processing */
+	res = pkt_func(&pkt);
+
+	return packet_input_finish(pkt, ifnet, res);
+}
+
+static inline void packet_prefetch_l2(odp_packet_t pkt)
+{
+	odp_prefetch(odp_packet_l2_ptr(pkt, NULL));
+}
+
+static inline void packet_prefetch_l3(odp_packet_t pkt)
+{
+	odp_prefetch(odp_packet_l3_ptr(pkt, NULL));
+}
+
+#ifdef INET
+static inline int ipv4_burst_hooks(void)
+{
+	ofp_pkt_hook_burst *burst = ofp_get_packet_burst_hooks();
+
+	return burst && (burst[OFP_HOOK_LOCAL] || burst[OFP_HOOK_LOCAL_IPv4] ||
+			 burst[OFP_HOOK_FWD_IPv4]);
+}
+
+static inline int ipv4_acls(void)
+{
+	return ofp_acl_enabled(OFP_ACL_LOCAL) || ofp_acl_enabled(OFP_ACL_FWD);
+}
+
+static int ipv4_hooks(void)
+{
+	ofp_pkt_hook *hook = ofp_get_packet_hooks();
+
+	return ipv4_burst_hooks() ||
+		(hook && (hook[OFP_HOOK_LOCAL] || hook[OFP_HOOK_LOCAL_IPv4] ||
+			  hook[OFP_HOOK_FWD_IPv4]));
+}
+
+void ofp_ip4_feat_update(int vxlan)
+{
+	uint32_t feat = 0;
+
+	odp_spinlock_lock(&ofp_ip_shm->feat_lock);
+	if (vxlan)
+		ofp_ip_shm->vxlan_used = 1;
+	if (ofp_ip_shm->vxlan_used)
+		feat |= OFP_IP4_FEAT_VXLAN;
+	if (ofp_ipsec_active())
+		feat |= OFP_IP4_FEAT_IPSEC;
+	if (ipv4_hooks() || ipv4_acls() || global_param->conntrack.entries > 0)
+		feat |= OFP_IP4_FEAT_FILTER;
+	odp_atomic_store_u32(&ofp_ip_shm->ip4_feat, feat);
+	odp_spinlock_unlock(&ofp_ip_shm->feat_lock);
+}
+
+/*
+ * Run hook hook_id for the IPv4 packets sel[0..num-1] of a burst, with
+ * one call of the burst callback if one is registered. idx maps the
+ * IPv4 packets to pkt and ifnet, nh is NULL for local delivery. The
+ * packets that do not continue are finished and removed from sel.
+ * Returns the number of packets left.
+ */
+static int ipv4_hook_burst(enum ofp_hook_id hook_id, void *arg,
+			   odp_packet_t pkt[], struct ofp_ifnet *ifnet[],
+			   int idx[], struct ofp_nh_entry *nh[],
+			   int sel[], int num)
+{
+	ofp_pkt_hook_burst *burst = ofp_get_packet_burst_hooks();
+	ofp_pkt_hook *hook = ofp_get_packet_hooks();
+	int i, k = 0;
+
+	if (num == 0)
+		return 0;
+
+	odp_packet_t hp[num];
+	struct ofp_nh_entry *hnh[num];
+	enum ofp_return_code res[num];
+	uint64_t prof;
+
+	for (i = 0; i < num; i++) {
+		hp[i] = pkt[idx[sel[i]]];
+		hnh[i] = nh ? nh[sel[i]] : NULL;
+	}
+
+	prof = OFP_PROF_NOW();
+	if (burst && burst[hook_id])
+		burst[hook_id](hp, num, res, nh ? (void *)hnh : arg);
+	else if (hook && hook[hook_id])
+		for (i = 0; i < num; i++)
+			res[i] = hook[hook_id](hp[i], nh ? hnh[i] : arg);
+	else
+		return num;
+	OFP_PROF_END_N(HOOK, prof, num);
+
+	for (i = 0; i < num; i++) {
+		if (odp_likely(res[i] == OFP_PKT_CONTINUE)) {
+			sel[k++] = sel[i];
+			continue;
+		}
+		OFP_DBG("Hook %d returned %d", hook_id, res[i]);
+		packet_input_finish(hp[i], ifnet[idx[sel[i]]], res[i]);
+	}
+	return k;
+}
+
+/*
+ * Apply the ACL of point to the IPv4 packets sel[0..num-1] of a burst
+ * like ipv4_hook_burst().
+ */
+static int ipv4_acl_burst(enum ofp_acl_point point, odp_packet_t pkt[],
+			  struct ofp_ifnet *ifnet[], int idx[],
+			  struct ofp_ifnet *dev[], int sel[], int num)
+{
+	int i, k = 0;
+
+	if (num == 0 || !ofp_acl_enabled(point))
+		return num;
+
+	odp_packet_t ap[num];
+	uint16_t vrf[num];
+	enum ofp_return_code res[num];
+
+	for (i = 0; i < num; i++) {
+		ap[i] = pkt[idx[sel[i]]];
+		vrf[i] = dev[sel[i]]->vrf;
+	}
+
+	ofp_acl_apply_burst(point, ap, vrf, num, res);
+
+	for (i = 0; i < num; i++) {
+		if (odp_likely(res[i] == OFP_PKT_CONTINUE))
+			sel[k++] = sel[i];
+		else
+			packet_input_finish(ap[i], ifnet[idx[sel[i]]], res[i]);
+	}
+	return k;
+}
+
+/*
+ * Stage 4b of ofp_packet_input_multi(): the inpcbs of the local TCP and
+ * UDP packets are prefetched in passes over the burst, index buckets
+ * first, then the inpcbs, then their tcpcbs and sockets, so that the
+ * cache misses of the packets overlap before the protocol input runs.
+ * Not done when the packets are handed to flow queues, the lookup then
+ * runs on another core.
+ */
+static void ipv4_pcb_prefetch(struct ofp_ip *ip[], uint32_t is_ours[],
+			      int num)
+{
+	struct inpcbinfo *pcbinfo[num];
+	struct inpcb *inp[num];
+	uint32_t sig[num];
+	uint16_t *ports;
+	int i, nl4 = 0;
+
+	if (num < 2 || ofp_ip_shm->flow_queue_num)
+		return;
+
+	for (i = 0; i < num; i++) {
+		sig[i] = 0;
+		if (!is_ours[i] || (odp_be_to_cpu_16(ip[i]->ip_off) & 0x3fff))
+			continue;
+		if (ip[i]->ip_p == OFP_IPPROTO_TCP)
+			pcbinfo[i] = &V_tcbinfo;
+		else if (ip[i]->ip_p == OFP_IPPROTO_UDP)
+			pcbinfo[i] = &V_udbinfo;
+		else
+			continue;
+		ports = (uint16_t *)((uint8_t *)ip[i] + (ip[i]->ip_hl << 2));
+		sig[i] = ofp_in_pcbidx_prefetch(pcbinfo[i], 0, &ip[i]->ip_src,
+						ports[0], &ip[i]->ip_dst,
+						ports[1]);
+		nl4 += sig[i] != 0;
+	}
+	if (nl4 < 2)
+		return;
+
+	for (i = 0; i < num; i++) {
+		inp[i] = sig[i] ? ofp_in_pcbidx_peek(pcbinfo[i], sig[i]) : NULL;
+		if (inp[i])
+			odp_prefetch(inp[i]);
+	}
+
+	for (i = 0; i < num; i++) {
+		struct inpcb *p = inp[i];
+		struct socket *so;
+
+		if (!p)
+			continue;
+		if (p->inp_ppcb)
+			odp_prefetch(p->inp_ppcb);
+		so = p->inp_socket;
+		if (so)
+			odp_prefetch(&so->so_rcv);
+	}
+}
+
+/* Stage 5 of ofp_packet_input_multi() without burst hooks and ACLs */
+static inline __attribute__((always_inline))
+void ipv4_input_finish_each(odp_packet_t pkt[], struct ofp_ifnet *ifnet[],
+			    int idx[], struct ofp_ifnet *dev[],
+			    struct ofp_ip *ip[], struct ofp_nh_entry *nh[],
+			    uint32_t is_ours[],
+			    struct ofp_flow_cache_entry *fc[], int num,
+			    const uint32_t feat)
+{
+	enum ofp_return_code res;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		odp_packet_t *p = &pkt[idx[i]];
+
+		res = ipv4_input_finish(p, dev[i], ip[i], nh[i], is_ours[i],
+					fc[i], feat);
+		packet_input_finish(*p, ifnet[idx[i]], res);
+	}
+}
+
+/*
+ * Stage 5 of ofp_packet_input_multi() with burst hooks or ACLs: the packets
+ * are taken to the hook points, each hook is called once for the burst
+ * and the packets left are delivered or forwarded in their order.
+ */
+static void ipv4_input_finish_burst(odp_packet_t pkt[],
+				    struct ofp_ifnet *ifnet[], int idx[],
+				    struct ofp_ifnet *dev[], struct ofp_ip *ip[],
+				    struct ofp_nh_entry *nh[], uint32_t is_ours[],
+				    struct ofp_flow_cache_entry *fc[], int num)
+{
+	int loc[num], fwd[num];
+	uint8_t go[num];
+	int protocol = IS_IPV4;
+	int i, nloc = 0, nfwd = 0;
+	int res;
+
+	for (i = 0; i < num; i++) {
+		odp_packet_t *p = &pkt[idx[i]];
+
+		go[i] = 0;
+		res = ipv4_input_pre_hook(p, dev[i], &ip[i], is_ours[i],
+					  OFP_IP4_FEAT_ALL);
+		if (res != OFP_PKT_CONTINUE) {
+			packet_input_finish(*p, ifnet[idx[i]], res);
+			continue;
+		}
+		if (is_ours[i])
+			loc[nloc++] = i;
+		else
+			fwd[nfwd++] = i;
+	}
+
+	nloc = ipv4_acl_burst(OFP_ACL_LOCAL, pkt, ifnet, idx, dev, loc, nloc);
+	nfwd = ipv4_acl_burst(OFP_ACL_FWD, pkt, ifnet, idx, dev, fwd, nfwd);
+
+	nloc = ipv4_hook_burst(OFP_HOOK_LOCAL, &protocol, pkt, ifnet, idx,
+			       NULL, loc, nloc);
+	nloc = ipv4_hook_burst(OFP_HOOK_LOCAL_IPv4, NULL, pkt, ifnet, idx,
+			       NULL, loc, nloc);
+	nfwd = ipv4_hook_burst(OFP_HOOK_FWD_IPv4, NULL, pkt, ifnet, idx,
+			       nh, fwd, nfwd);
+
+	for (i = 0; i < nloc; i++)
+		go[loc[i]] = 1;
+	for (i = 0; i < nfwd; i++)
+		go[fwd[i]] = 1;
+
+	for (i = 0; i < num; i++) {
+		odp_packet_t *p = &pkt[idx[i]];
+
+		if (!go[i])
+			continue;
+		res = ipv4_input_post_hook(p, dev[i], ip[i], nh[i],
+					   is_ours[i], fc[i], OFP_IP4_FEAT_ALL);
+		packet_input_finish(*p, ifnet[idx[i]], res);
+	}
+}
+#endif /* INET */
+
+void ofp_packet_input_multi(odp_packet_t pkt[], int num,
+	odp_queue_t in_queue, ofp_pkt_processing_func pkt_func)
+{
+	struct ofp_ifnet *ifnet[num];
+	int i, n = 0;
+#ifdef INET
+	struct ofp_ifnet *dev4[num];
+	struct ofp_ip *ip4[num];
+	struct ofp_nh_entry *nh4[num];
+	struct ofp_flow_cache_entry *fc4[num];
+	uint32_t is_ours4[num];
+	int idx4[num];
+	int lk[num];
+	uint32_t dst4[num];
+	struct ofp_nh_entry *lknh[num];
+	int n4 = 0, nlk = 0, k = 0, nrt = 0;
+	uint32_t feat4 = ofp_ip4_feat();
+	uint64_t prof;
+#endif /* INET */
+#ifdef INET6
+	int idx6[num];
+	int n6 = 0;
+#endif /* INET6 */
+	uint16_t ethtype;
+	int res;
+
+	/* Stage 1: input interface and per packet state */
+	for (i = 0; i < num; i++) {
+		if (i + 1 < num)
+			packet_prefetch_l2(pkt[i + 1]);
+
+		ifnet[n] = packet_input_prepare(pkt[i], in_queue);
+		if (odp_likely(ifnet[n] != NULL))
+			pkt[n++] = pkt[i];
+	}
+
+	ofp_gro_burst_begin();
+
+	/* Only the default L2 processing function can be split in stages */
+	if (pkt_func != ofp_eth_vlan_processing) {
+		for (i = 0; i < n; i++) {
+			res = pkt_func(&pkt[i]);
+			packet_input_finish(pkt[i], ifnet[i], res);
+		}
+		ofp_gro_burst_end();
+		return;
+	}
+
+	/*
+	 * Stage 2: Ethernet and VLAN parsing, network layer classifier.
+	 * The IP packets are set aside, each family keeps its order.
+	 */
+	for (i = 0; i < n; i++) {
+		OFP_PROF_START(prof_eth);
+
+		if (i + 1 < n)
+			packet_prefetch_l3(pkt[i + 1]);
+
+		if (odp_unlikely(eth_vlan_parse(pkt[i], &ethtype) ==
+				 OFP_PKT_DROP)) {
+			packet_input_finish(pkt[i], ifnet[i], OFP_PKT_DROP);
+			continue;
+		}
+
+		OFP_PROF_END(ETH_CLASSIFY, prof_eth);
+
+		switch (ethtype) {
+#ifdef INET
+		case OFP_ETHERTYPE_IP:
+			idx4[n4++] = i;
+			continue;
+#endif /* INET */
+#ifdef INET6
+		case OFP_ETHERTYPE_IPV6:
+			idx6[n6++] = i;
+			continue;
+#endif /* INET6 */
+		case OFP_ETHERTYPE_ARP:
+			res = ofp_arp_processing(&pkt[i]);
+			break;
+		default:
+			res = OFP_PKT_CONTINUE;
+			break;
+		}
+		packet_input_finish(pkt[i], ifnet[i], res);
+	}
+
+#ifdef INET
+	/* Stage 3: IPv4 header validation */
+	prof = OFP_PROF_NOW();
+	for (i = 0; i < n4; i++) {
+		odp_packet_t p = pkt[idx4[i]];
+
+		ip4[k] = (struct ofp_ip *)odp_packet_l3_ptr(p, NULL);
+		dev4[k] = odp_packet_user_ptr(p);
+
+		if (odp_unlikely(ip4[k] == NULL) ||
+		    ipv4_input_check(p, ip4[k], &dev4[k], feat4) ==
+		    OFP_PKT_DROP) {
+			packet_input_finish(p, ifnet[idx4[i]], OFP_PKT_DROP);
+			continue;
+		}
+		is_ours4[k] = ipv4_is_ours_fast(dev4[k], ip4[k]);
+		idx4[k++] = idx4[i];
+	}
+	OFP_PROF_END_N(IP_INPUT, prof, n4);
+	n4 = k;
+
+	/*
+	 * Stage 4: flow cache and route lookup. Consecutive packets of the
+	 * same VRF that miss the cache are looked up with one bulk lookup.
+	 */
+	prof = OFP_PROF_NOW();
+	for (i = 0; i < n4; i++) {
+		nh4[i] = NULL;
+		fc4[i] = NULL;
+		if (is_ours4[i])
+			continue;
+		nrt++;
+		fc4[i] = ofp_flow_cache_lookup(dev4[i]->vrf,
+					       ip4[i]->ip_dst.s_addr);
+		if (fc4[i] && ofp_flow_cache_hit(fc4[i])) {
+			nh4[i] = fc4[i]->nh;
+			continue;
+		}
+		lk[nlk] = i;
+		dst4[nlk++] = ip4[i]->ip_dst.s_addr;
+	}
+	for (i = 0; i < nlk; i += k) {
+		uint16_t vrf = dev4[lk[i]]->vrf;
+
+		for (k = 1; i + k < nlk && dev4[lk[i + k]]->vrf == vrf; k++)
+			;
+		ofp_get_next_hop_bulk(vrf, &dst4[i], &lknh[i], k);
+	}
+	for (i = 0; i < nlk; i++) {
+		/* This may be for some other local interface. */
+		nh4[lk[i]] = lknh[i];
+		if (lknh[i])
+			is_ours4[lk[i]] = lknh[i]->flags & OFP_RTF_LOCAL;
+	}
+	OFP_PROF_END_N(ROUTE_LOOKUP, prof, nrt);
+
+	ipv4_pcb_prefetch(ip4, is_ours4, n4);
+
+	/* Stage 5: local delivery or forwarding */
+	if ((feat4 & OFP_IP4_FEAT_FILTER) &&
+	    (ipv4_burst_hooks() || ipv4_acls()))
+		ipv4_input_finish_burst(pkt, ifnet, idx4, dev4, ip4, nh4,
+					is_ours4, fc4, n4);
+	else if (feat4 == 0)
+		ipv4_input_finish_each(pkt, ifnet, idx4, dev4, ip4, nh4,
+				       is_ours4, fc4, n4, 0);
+	else if (feat4 == OFP_IP4_FEAT_IPSEC)
+		ipv4_input_finish_each(pkt, ifnet, idx4, dev4, ip4, nh4,
+				       is_ours4, fc4, n4, OFP_IP4_FEAT_IPSEC);
+	else if (feat4 == OFP_IP4_FEAT_FILTER)
+		ipv4_input_finish_each(pkt, ifnet, idx4, dev4, ip4, nh4,
+				       is_ours4, fc4, n4, OFP_IP4_FEAT_FILTER);
+	else
+		ipv4_input_finish_each(pkt, ifnet, idx4, dev4, ip4, nh4,
+				       is_ours4, fc4, n4, OFP_IP4_FEAT_ALL);
+#endif /* INET */
+
+#ifdef INET6
+	for (i = 0; i < n6; i++) {
+		odp_packet_t *p = &pkt[idx6[i]];
+
+		if (i + 1 < n6)
+			packet_prefetch_l3(pkt[idx6[i + 1]]);
+
+		res = ofp_ipv6_processing(p);
+		packet_input_finish(*p, ifnet[idx6[i]], res);
+	}
+#endif /* INET6 */
+
+	ofp_gro_burst_end();
+}
+
+#ifdef SP
+static inline int sp_port_is_routing(uint16_t port)
+{
+	switch (port) {
+	case 179:	/* BGP */
+	case 520:	/* RIP */
+	case 521:	/* RIPng */
+	case 646:	/* LDP */
+	case 3784:	/* BFD */
+	case 4784:	/* BFD multihop */
+		return 1;
+	}
+	return 0;
+}
+
+static inline int sp_l4_class(uint8_t proto, const uint8_t *l4,
+			      const uint8_t *end)
+{
+	const struct ofp_udphdr *uh = (const struct ofp_udphdr *)l4;
+
+	switch (proto) {
+	case OFP_IPPROTO_OSPFIGP:
+	case OFP_IPPROTO_PIM:
+	case OFP_IPPROTO_CARP:
+		return OFP_SP_ROUTING;
+	case OFP_IPPROTO_ICMP:
+		return OFP_SP_ICMP;
+	case OFP_IPPROTO_ICMPV6:
+		if (l4 + 1 <= end && *l4 >= OFP_ND_ROUTER_SOLICIT &&
+		    *l4 <= OFP_ND_REDIRECT)
+			return OFP_SP_ARP;
+		return OFP_SP_ICMP;
+	case OFP_IPPROTO_TCP:
+	case OFP_IPPROTO_UDP:
+		/* The ports are at the same place in both */
+		if (l4 + 4 <= end &&
+		    (sp_port_is_routing(odp_be_to_cpu_16(uh->uh_sport)) ||
+		     sp_port_is_routing(odp_be_to_cpu_16(uh->uh_dport))))
+			return OFP_SP_ROUTING;
+	}
+	return OFP_SP_OTHER;
+}
+
+/* Fails safe: what cannot be parsed is OFP_SP_OTHER */
+static int sp_class(odp_packet_t pkt)
+{
+	uint32_t len;
+	uint8_t *l2 = odp_packet_l2_ptr(pkt, &len);
+	uint8_t *end = l2 + len;
+	struct ofp_ether_header *eth = (struct ofp_ether_header *)l2;
+	uint16_t type;
+	uint8_t *l3;
+
+	if (!l2 || len < OFP_ETHER_HDR_LEN)
+		return OFP_SP_OTHER;
+	type = odp_be_to_cpu_16(eth->ether_type);
+	l3 = l2 + OFP_ETHER_HDR_LEN;
+	if (type == OFP_ETHERTYPE_VLAN) {
+		if (len < OFP_ETHER_HDR_LEN + OFP_ETHER_VLAN_ENCAP_LEN)
+			return OFP_SP_OTHER;
+		type = odp_be_to_cpu_16(((struct ofp_ether_vlan_header *)
+					 eth)->evl_proto);
+		l3 += OFP_ETHER_VLAN_ENCAP_LEN;
+	}
+
+	if (type == OFP_ETHERTYPE_ARP)
+		return OFP_SP_ARP;
+	if (type == OFP_ETHERTYPE_IP && l3 + sizeof(struct ofp_ip) <= end) {
+		struct ofp_ip *ip = (struct ofp_ip *)l3;
+
+		return sp_l4_class(ip->ip_p, l3 + (ip->ip_hl << 2), end);
+	}
+#ifdef INET6
+	if (type == OFP_ETHERTYPE_IPV6 &&
+	    l3 + sizeof(struct ofp_ip6_hdr) <= end) {
+		struct ofp_ip6_hdr *ip6 = (struct ofp_ip6_hdr *)l3;
+
+		/* Extension headers are not followed */
+		return sp_l4_class(ip6->ofp_ip6_nxt,
+				   l3 + sizeof(struct ofp_ip6_hdr), end);
+	}
+#endif /* INET6 */
+	return OFP_SP_OTHER;
+}
+
+/*
+ * GCRA: a packet conforms if it does not arrive more than the burst
+ * before its theoretical arrival time. One CAS, no lock.
+ */
+static int sp_police(struct ofp_sp_police *p)
+{
+	uint64_t now, tat, next;
+
+	if (!p->interval_ns)
+		return 0;
+
+	now = odp_time_to_ns(odp_time_global());
+	tat = odp_atomic_load_u64(&p->tat);
+	do {
+		if (tat > now + p->burst_ns)
+			return -1;
+		next = (tat > now ? tat : now) + p->interval_ns;
+	} while (!odp_atomic_cas_u64(&p->tat, &tat, next));
+
+	return 0;
+}
+#endif /*SP*/
+
 enum ofp_return_code ofp_sp_input(odp_packet_t pkt,
 	struct ofp_ifnet *ifnet)
 {
 #ifdef SP
+	int class;
+
 	/* Virtual iface may not have spq. */
 	if (!ifnet->spq_def) {
+		OFP_DROP_STAT(SP_ENQ);
 		odp_packet_free(pkt);
 		return OFP_PKT_DROP;
 	}
 
-	if (odp_queue_enq(ifnet->spq_def, odp_packet_to_event(pkt)) < 0) {
+	class = sp_class(pkt);
+	/* The lowest classes are not copied under memory pressure */
+	if (odp_unlikely(class >= OFP_SP_CLASS_MAX - ofp_mem_pressure())) {
+		OFP_DROP_STAT(MEM_PRESSURE);
+		odp_packet_free(pkt);
+		return OFP_PKT_DROP;
+	}
+	if (sp_police(&ifnet->sp_police[class]) ||
+	    odp_queue_enq(ifnet->spq[class], odp_packet_to_event(pkt)) < 0) {
+		odp_atomic_inc_u64(&ifnet->sp_police[class].drops);
+		OFP_DROP_STAT(SP_ENQ);
 		odp_packet_free(pkt);
 		return OFP_PKT_DROP;
 	}
+	sp_rx_wakeup(ifnet);
 	return OFP_PKT_PROCESSED;
 #else
 	(void)ifnet;
 
+	OFP_DROP_STAT(SP_ENQ);
 	odp_packet_free(pkt);
 	return OFP_PKT_DROP;
 #endif
@@ -11,113 +11,636 @@
 #include "ofpi_log.h"
 #include "ofpi_debug.h"
 #include "ofpi_stat.h"
+#include "ofpi_ipsec.h"
+#include "ofpi_lag.h"
+#include "ofpi_sflow.h"
+#include "ofpi_socketvar.h"
+
+/*
+ * Packets are collected in a table per (port, output queue) and sent
+ * when the table is full or on ofp_send_pending_pkt().
+ *
+ * In the adaptive mode a table is full at tx_target packets, which
+ * follows the occupancy of the received bursts. ofp_send_pending_pkt()
+ * then keeps the tables that are not older than pkt_tx_hold_ns, so
+ * that they may fill up on the next rounds. As with pacing, only
+ * threads that poll continuously, see ofp_send_pace_poll(), hold
+ * tables, others send them all on every ofp_send_pending_pkt().
+ *
+ * Packets with a departure time later than now (paced TCP output) are
+ * held on a per thread timing wheel of PACE_SLOTS slots of PACE_SLOT_NS
+ * and go to the tables when ofp_send_pending_pkt() finds them due.
+ * Departures beyond the wheel are held in its last slot. Only threads
+ * that poll ofp_send_pending_pkt() continuously hold packets, see
+ * ofp_send_pace_poll(), others send them at once.
+ *
+ * Packets the output queue does not take are kept in a retry backlog
+ * of the table, of at most pkt_tx_retry_max packets, and sent before
+ * the next packets of the table, the latest on the next
+ * ofp_send_pending_pkt(). Packets older than pkt_tx_retry_ns are
+ * dropped instead.
+ */
+#define NUM_TABLES (NUM_PORTS * OFP_PKTOUT_QUEUE_MAX)
 
+#define PACE_SLOT_SHIFT 14
+#define PACE_SLOT_NS (1ULL << PACE_SLOT_SHIFT)
+/* 2048 slots of 16.4 us cover two TCP timer ticks */
+#define PACE_SLOTS 2048
+#define PACE_NONE UINT32_MAX
 
-static __thread struct burst_send {
+struct burst_send {
 	odp_packet_t *pkt_tbl;
 	uint32_t pkt_tbl_cnt;
-} send_pkt_tbl[NUM_PORTS] __attribute__((__aligned__(ODP_CACHE_LINE_SIZE)));
+	odp_bool_t pending;
+	/* Time of the first packet of the table */
+	odp_time_t first;
+	/* Retry backlog, oldest first, and the time each was queued */
+	odp_packet_t *retry;
+	uint64_t *retry_ns;
+	uint32_t retry_cnt;
+	odp_bool_t retrying;
+};
+
+static __thread struct burst_send *send_pkt_tbl;
+/* Tables that got packets since the last ofp_send_pending_pkt() */
+static __thread uint16_t *pending_tbl;
+static __thread uint32_t pending_cnt;
+/* Tables with a retry backlog */
+static __thread uint16_t *retry_tbl;
+static __thread uint32_t retry_num;
+static __thread uint32_t retry_max;
+static __thread uint64_t retry_age_ns;
 
 static __thread uint32_t tx_burst;
+static __thread uint32_t tx_target;
+static __thread odp_bool_t tx_adaptive;
+static __thread uint64_t tx_hold_ns;
+/* The thread polls ofp_send_pending_pkt() and may hold tables */
+static __thread odp_bool_t tx_hold;
+/* Mean size of the received bursts, scaled by RX_AVG_SCALE */
+static __thread uint32_t rx_avg;
+static __thread uint32_t rx_max;
+/* Earliest time a held table must be sent */
+static __thread odp_time_t hold_deadline;
+
+#define RX_AVG_SCALE 16
+static __thread ofp_tx_queue_map_t tx_queue_map;
+/* Queue index of the thread, -1 for the CPU of the thread */
+static __thread int tx_queue;
+
+struct pace_entry {
+	odp_packet_t pkt;
+	struct ofp_ifnet *dev;
+	uint32_t next;
+};
+
+struct pace_slot {
+	uint32_t head;
+	uint32_t tail;
+};
+
+static __thread struct pace_entry *pace_ent;
+static __thread struct pace_slot *pace_slot;
+static __thread uint32_t pace_free;
+static __thread uint32_t pace_cnt;
+/* Last slot released, in PACE_SLOT_NS since the time origin */
+static __thread uint64_t pace_cursor;
+static __thread odp_bool_t pace_poll;
+
+__thread uint32_t ofp_tx_ts_num;
+
+/*
+ * Stamp the sockets of the datagrams about to be queued. A datagram
+ * that waits for a retry keeps the time of the first attempt.
+ */
+static void tx_timestamp(odp_packet_t *pkt, int num)
+{
+	struct ofp_packet_user_area *ua;
+	uint64_t now = 0;
+	int i;
 
-static inline void
-send_table(struct ofp_ifnet *ifnet, odp_packet_t *pkt_tbl,
-		uint32_t *pkt_tbl_cnt)
+	for (i = 0; i < num && ofp_tx_ts_num; i++) {
+		ua = ofp_packet_user_area(pkt[i]);
+		if (!(ua->valid & OFP_UA_TS) || !ua->ts.tx.fd)
+			continue;
+		if (!now)
+			now = odp_time_to_ns(odp_time_global());
+		ofp_sock_tx_timestamp(ua->ts.tx.fd - 1, ua->ts.tx.id, now);
+		ua->ts.tx.fd = 0;
+		ofp_tx_ts_num--;
+	}
+}
+
+/* Send num packets, return the number sent */
+static inline int send_multi(struct ofp_ifnet *ifnet, int queue,
+			     odp_packet_t *pkt, int num)
 {
-	int pkts_sent;
+	int sent, i;
+	uint64_t bytes = 0;
+
+	if (odp_unlikely(ofp_tx_ts_num))
+		tx_timestamp(pkt, num);
+
+	/* Sent packets are not ours to look at afterwards */
+	for (i = 0; i < num; i++)
+		bytes += odp_packet_len(pkt[i]);
+
+	sent = ofp_send_pkt_multi(ifnet, pkt, num, queue);
+	if (sent < 0)
+		sent = 0;
+
+	if (sent) {
+		for (i = sent; i < num; i++)
+			bytes -= odp_packet_len(pkt[i]);
+		OFP_UPDATE_PACKET_STAT(tx_fp, sent);
+		OFP_IF_STAT_TX(ifnet, sent, bytes);
+		OFP_IFQ_STAT_TX(ifnet->port, queue, sent, bytes);
+	}
+	return sent;
+}
 
-	pkts_sent = ofp_send_pkt_multi(ifnet, pkt_tbl, *pkt_tbl_cnt,
-			odp_cpu_id());
+/* Keep packets not sent for a retry, and drop those that do not fit */
+static void retry_add(struct burst_send *bs, uint32_t tbl,
+		      odp_packet_t *pkt, int num)
+{
+	int i, room = retry_max - bs->retry_cnt;
+	uint64_t now;
 
-	if (pkts_sent < 0)
-		pkts_sent = 0;
-	else
-		OFP_UPDATE_PACKET_STAT(tx_fp, pkts_sent);
+	if (room > num)
+		room = num;
 
-	if (pkts_sent < (int)(*pkt_tbl_cnt)) {
-		int pkt_cnt = (int)(*pkt_tbl_cnt);
+	if (room > 0) {
+		now = odp_time_to_ns(odp_time_local());
+		for (i = 0; i < room; i++) {
+			bs->retry[bs->retry_cnt] = pkt[i];
+			bs->retry_ns[bs->retry_cnt++] = now;
+		}
+		OFP_UPDATE_PACKET_STAT(tx_retry, room);
+		if (!bs->retrying) {
+			bs->retrying = 1;
+			retry_tbl[retry_num++] = tbl;
+		}
+	} else {
+		room = 0;
+	}
 
+	if (room < num) {
 		OFP_DBG("odp_pktio_send failed: %d/%d packets dropped",
-			pkt_cnt - pkts_sent, pkt_cnt);
+			num - room, num);
+		if (retry_max)
+			OFP_DROP_STAT_N(TX_RETRY_FULL, num - room);
+		else
+			OFP_DROP_STAT_N(TX_PKTOUT, num - room);
+		odp_packet_free_multi(&pkt[room], num - room);
+	}
+}
 
-		for (; pkts_sent < pkt_cnt; pkts_sent++)
-			odp_packet_free(pkt_tbl[pkts_sent]);
+/* Send the retry backlog of a table, return the number left */
+static uint32_t retry_send(struct ofp_ifnet *ifnet, int queue,
+			   struct burst_send *bs)
+{
+	uint64_t old = odp_time_to_ns(odp_time_local()) - retry_age_ns;
+	uint32_t n = 0, sent;
+
+	while (n < bs->retry_cnt && bs->retry_ns[n] < old)
+		n++;
+	if (n) {
+		OFP_DROP_STAT_N(TX_RETRY_AGE, n);
+		odp_packet_free_multi(bs->retry, n);
 	}
 
-	*pkt_tbl_cnt = 0;
+	sent = n;
+	if (n < bs->retry_cnt)
+		sent += send_multi(ifnet, queue, &bs->retry[n],
+				   bs->retry_cnt - n);
+	if (sent) {
+		bs->retry_cnt -= sent;
+		memmove(bs->retry, &bs->retry[sent],
+			bs->retry_cnt * sizeof(bs->retry[0]));
+		memmove(bs->retry_ns, &bs->retry_ns[sent],
+			bs->retry_cnt * sizeof(bs->retry_ns[0]));
+	}
+	return bs->retry_cnt;
 }
 
-enum ofp_return_code send_pkt_out(struct ofp_ifnet *dev,
-	odp_packet_t pkt)
+static inline void
+send_table(struct ofp_ifnet *ifnet, int queue, struct burst_send *bs)
+{
+	uint32_t tbl = ifnet->port * OFP_PKTOUT_QUEUE_MAX + queue;
+	int num = bs->pkt_tbl_cnt;
+	int sent = 0;
+
+	bs->pkt_tbl_cnt = 0;
+
+	/* Packets do not overtake the ones waiting for a retry */
+	if (odp_likely(!bs->retry_cnt) || !retry_send(ifnet, queue, bs))
+		sent = send_multi(ifnet, queue, bs->pkt_tbl, num);
+
+	if (odp_unlikely(sent < num))
+		retry_add(bs, tbl, &bs->pkt_tbl[sent], num - sent);
+}
+
+/* Retry the backlogs once per ofp_send_pending_pkt() */
+static void retry_run(void)
 {
-	uint32_t *pkt_tbl_cnt = &send_pkt_tbl[dev->port].pkt_tbl_cnt;
-	odp_packet_t *pkt_tbl = (odp_packet_t *)send_pkt_tbl[dev->port].pkt_tbl;
+	uint32_t i, tbl, left = 0;
+	struct burst_send *bs;
 
-	pkt_tbl[(*pkt_tbl_cnt)++] = pkt;
+	for (i = 0; i < retry_num; i++) {
+		tbl = retry_tbl[i];
+		bs = &send_pkt_tbl[tbl];
+
+		if (bs->retry_cnt &&
+		    retry_send(ofp_get_ifnet(tbl / OFP_PKTOUT_QUEUE_MAX, 0),
+			       tbl % OFP_PKTOUT_QUEUE_MAX, bs)) {
+			retry_tbl[left++] = tbl;
+			continue;
+		}
+		bs->retrying = 0;
+	}
+	retry_num = left;
+}
+
+static inline int tx_queue_select(struct ofp_ifnet *ifnet, odp_packet_t pkt)
+{
+	uint32_t queue;
+
+	if (ifnet->out_queue_num <= 1)
+		return 0;
+
+	if (tx_queue_map == OFP_TX_QUEUE_MAP_FLOW &&
+	    odp_packet_has_flow_hash(pkt))
+		queue = odp_packet_flow_hash(pkt);
+	else if (tx_queue_map == OFP_TX_QUEUE_MAP_FLOW &&
+		 (ofp_packet_user_area(pkt)->valid & OFP_UA_HASH))
+		queue = ofp_packet_user_area(pkt)->flow_hash;
+	else if (tx_queue >= 0)
+		queue = tx_queue;
+	else
+		queue = odp_cpu_id();
+
+	return queue % ifnet->out_queue_num;
+}
+
+static inline enum ofp_return_code send_pkt_burst(struct ofp_ifnet *dev,
+						 odp_packet_t pkt)
+{
+	struct ofp_ifnet *ifnet = dev;
+	struct burst_send *bs;
+	uint32_t tbl;
+	int queue;
+
+	/* A VLAN sends on the queues of its port */
+	if (odp_unlikely(dev->vlan))
+		ifnet = ofp_get_ifnet(dev->port, 0);
+
+	/* A LAG port sends on the member of the flow */
+	if (odp_unlikely(ifnet->lag_num)) {
+		ifnet = ofp_lag_tx_member(ifnet, pkt);
+		if (odp_unlikely(!ifnet)) {
+			OFP_DROP_STAT(LAG_DOWN);
+			return OFP_PKT_DROP;
+		}
+	}
+
+	queue = tx_queue_select(ifnet, pkt);
+	tbl = ifnet->port * OFP_PKTOUT_QUEUE_MAX + queue;
+	bs = &send_pkt_tbl[tbl];
+	bs->pkt_tbl[bs->pkt_tbl_cnt++] = pkt;
+
+	/* The port counts the packet when it is sent */
+	if (dev != ifnet)
+		OFP_IF_STAT_TX(dev, 1, odp_packet_len(pkt));
 
 	OFP_DEBUG_PACKET(OFP_DEBUG_PKT_SEND_NIC, pkt, dev->port);
+	ofp_sflow_packet(pkt, dev->port, OFP_SFLOW_TX);
+	ofp_trace(pkt, dev->port, OFP_TRACE_TX, 0);
 
-	if ((*pkt_tbl_cnt) == tx_burst)
-		send_table(ofp_get_ifnet(dev->port, 0),
-			   pkt_tbl,
-			   pkt_tbl_cnt);
+	if (bs->pkt_tbl_cnt >= tx_target) {
+		send_table(ifnet, queue, bs);
+		return OFP_PKT_PROCESSED;
+	}
+
+	if (tx_adaptive && bs->pkt_tbl_cnt == 1)
+		bs->first = odp_time_local();
+
+	if (!bs->pending) {
+		bs->pending = 1;
+		pending_tbl[pending_cnt++] = tbl;
+	}
 
 	return OFP_PKT_PROCESSED;
 }
 
+/*
+ * Hold a packet until tx_time. Return 0 if it is to be sent now.
+ *
+ * A packet is held if its slot is not released yet, even if it is due,
+ * so that it does not overtake earlier packets of its connection.
+ */
+static int pace_hold(struct ofp_ifnet *dev, odp_packet_t pkt,
+		     uint64_t tx_time)
+{
+	uint64_t slot;
+	struct pace_entry *ent;
+	struct pace_slot *ps;
+	uint32_t idx;
+
+	if (!pace_poll || pace_free == PACE_NONE)
+		return 0;
+
+	if (!pace_cnt)
+		pace_cursor = odp_time_to_ns(odp_time_global()) >>
+			PACE_SLOT_SHIFT;
+
+	slot = tx_time >> PACE_SLOT_SHIFT;
+	if (slot <= pace_cursor)
+		return 0;
+	if (slot - pace_cursor >= PACE_SLOTS)
+		slot = pace_cursor + PACE_SLOTS - 1;
+
+	idx = pace_free;
+	ent = &pace_ent[idx];
+	pace_free = ent->next;
+	ent->pkt = pkt;
+	ent->dev = dev;
+	ent->next = PACE_NONE;
+
+	ps = &pace_slot[slot % PACE_SLOTS];
+	if (ps->head == PACE_NONE)
+		ps->head = idx;
+	else
+		pace_ent[ps->tail].next = idx;
+	ps->tail = idx;
+	pace_cnt++;
+
+	OFP_UPDATE_PACKET_STAT(tx_paced, 1);
+	return 1;
+}
+
+/* Move the packets that are due from the wheel to the tables */
+static void pace_run(void)
+{
+	uint64_t now_slot, end;
+	struct pace_slot *ps;
+	struct pace_entry *ent;
+	uint32_t idx, next;
+
+	if (!pace_cnt)
+		return;
+
+	now_slot = odp_time_to_ns(odp_time_global()) >> PACE_SLOT_SHIFT;
+	end = now_slot;
+	if (end - pace_cursor > PACE_SLOTS)
+		end = pace_cursor + PACE_SLOTS;
+
+	while (pace_cursor < end && pace_cnt) {
+		pace_cursor++;
+		ps = &pace_slot[pace_cursor % PACE_SLOTS];
+		for (idx = ps->head; idx != PACE_NONE; idx = next) {
+			ent = &pace_ent[idx];
+			next = ent->next;
+			send_pkt_burst(ent->dev, ent->pkt);
+			ent->next = pace_free;
+			pace_free = idx;
+			pace_cnt--;
+		}
+		ps->head = PACE_NONE;
+	}
+	pace_cursor = now_slot;
+}
+
+enum ofp_return_code send_pkt_out(struct ofp_ifnet *dev,
+	odp_packet_t pkt)
+{
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(pkt);
+
+	if (odp_unlikely(ua->valid & OFP_UA_PACE) &&
+	    pace_hold(dev, pkt, ua->tx_time))
+		return OFP_PKT_PROCESSED;
+
+	return send_pkt_burst(dev, pkt);
+}
+
 static void ofp_send_pending_pkt_nocheck(void)
 {
-	uint32_t i;
-	uint32_t *pkt_tbl_cnt;
-	odp_packet_t *pkt_tbl;
+	uint32_t i, tbl;
+	struct burst_send *bs;
 
-	for (i = 0; i < NUM_PORTS; i++) {
-		pkt_tbl_cnt = &send_pkt_tbl[i].pkt_tbl_cnt;
+	for (i = 0; i < pending_cnt; i++) {
+		tbl = pending_tbl[i];
+		bs = &send_pkt_tbl[tbl];
+		bs->pending = 0;
 
-		if  (!(*pkt_tbl_cnt))
+		if (!bs->pkt_tbl_cnt)
 			continue;
 
-		pkt_tbl = (odp_packet_t *)send_pkt_tbl[i].pkt_tbl;
+		send_table(ofp_get_ifnet(tbl / OFP_PKTOUT_QUEUE_MAX, 0),
+			   tbl % OFP_PKTOUT_QUEUE_MAX, bs);
+	}
+	pending_cnt = 0;
+}
+
+/* Send the tables that are full or older than tx_hold_ns */
+static void ofp_send_pending_pkt_hold(void)
+{
+	odp_time_t now = odp_time_local();
+	odp_time_t deadline;
+	uint32_t i, tbl, held = 0;
+	struct burst_send *bs;
+
+	for (i = 0; i < pending_cnt; i++) {
+		tbl = pending_tbl[i];
+		bs = &send_pkt_tbl[tbl];
 
-		send_table(ofp_get_ifnet(i, 0), pkt_tbl, pkt_tbl_cnt);
+		if (!bs->pkt_tbl_cnt) {
+			bs->pending = 0;
+			continue;
+		}
+
+		if (bs->pkt_tbl_cnt < tx_target &&
+		    odp_time_to_ns(odp_time_diff(now, bs->first)) < tx_hold_ns) {
+			deadline = odp_time_sum(bs->first,
+						odp_time_local_from_ns(tx_hold_ns));
+			if (!held || odp_time_cmp(deadline, hold_deadline) < 0)
+				hold_deadline = deadline;
+			pending_tbl[held++] = tbl;
+			continue;
+		}
+
+		bs->pending = 0;
+		send_table(ofp_get_ifnet(tbl / OFP_PKTOUT_QUEUE_MAX, 0),
+			   tbl % OFP_PKTOUT_QUEUE_MAX, bs);
 	}
+	pending_cnt = held;
 }
 
 enum ofp_return_code ofp_send_pending_pkt(void)
 {
-	if (tx_burst > 1)
-		ofp_send_pending_pkt_nocheck();
+	/* Profile only the calls that have packets to send */
+	uint32_t busy = pending_cnt | pace_cnt | retry_num;
+	OFP_PROF_START(prof);
+
+	/* Packets collected for asynchronous IPsec go to ODP first */
+	ofp_ipsec_send_pending();
+
+	pace_run();
+
+	if (odp_unlikely(retry_num))
+		retry_run();
+
+	if (tx_burst > 1) {
+		if (tx_adaptive && tx_hold)
+			ofp_send_pending_pkt_hold();
+		else
+			ofp_send_pending_pkt_nocheck();
+	}
+
+	if (busy)
+		OFP_PROF_END(TX_FLUSH, prof);
 	return OFP_PKT_PROCESSED;
 }
 
+void ofp_send_burst_rx(uint32_t rx_cnt)
+{
+	uint32_t target;
+
+	if (!tx_adaptive)
+		return;
+
+	/* Moving average with weight 1/8 for the latest burst */
+	rx_avg = rx_avg - rx_avg / 8 + rx_cnt * RX_AVG_SCALE / 8;
+
+	target = (tx_burst * rx_avg + rx_max * RX_AVG_SCALE - 1) /
+		(rx_max * RX_AVG_SCALE);
+	if (target < 1)
+		target = 1;
+	else if (target > tx_burst)
+		target = tx_burst;
+	tx_target = target;
+}
+
+uint64_t ofp_send_pending_wait(void)
+{
+	odp_time_t now;
+	uint64_t ns = UINT64_MAX, hold;
+
+	/* Paced and retried packets are not left waiting for input */
+	if (pace_cnt || retry_num)
+		ns = PACE_SLOT_NS;
+
+	if (pending_cnt) {
+		now = odp_time_local();
+		if (odp_time_cmp(hold_deadline, now) <= 0)
+			return ODP_SCHED_NO_WAIT;
+		hold = odp_time_to_ns(odp_time_diff(hold_deadline, now));
+		if (hold < ns)
+			ns = hold;
+	}
+
+	return ns == UINT64_MAX ? ODP_SCHED_WAIT : odp_schedule_wait_time(ns);
+}
+
+void ofp_send_pace_poll(odp_bool_t poll)
+{
+	pace_poll = poll && pace_ent != NULL;
+	tx_hold = poll;
+}
+
+static int tx_queue_default(void)
+{
+	if (tx_queue_map == OFP_TX_QUEUE_MAP_THREAD)
+		return odp_thread_id();
+	return -1;
+}
+
+void ofp_send_queue_set(int queue)
+{
+	tx_queue = queue < 0 ? tx_queue_default() : queue;
+}
+
 static __thread void *pkt_tbl = NULL;
+static __thread void *retry_mem = NULL;
 
 int ofp_send_pkt_out_init_local(void)
 {
-	uint32_t i, j;
+	const uint64_t mask = ODP_CACHE_LINE_SIZE - 1;
+	const uint32_t num_tables = NUM_TABLES;
+	odp_packet_t *tbl;
+	uint32_t i;
 
 	tx_burst = global_param->pkt_tx_burst_size;
-
-	pkt_tbl = malloc(global_param->pkt_tx_burst_size
-			 * sizeof(odp_packet_t) * NUM_PORTS + ODP_CACHE_LINE_SIZE);
-	if (!pkt_tbl) {
+	tx_adaptive = global_param->pkt_tx_burst_adaptive && tx_burst > 1;
+	tx_hold_ns = global_param->pkt_tx_hold_ns;
+	rx_max = global_param->evt_rx_burst_size > 0 ?
+		global_param->evt_rx_burst_size : 1;
+	/* Start from full bursts */
+	rx_avg = rx_max * RX_AVG_SCALE;
+	tx_target = tx_burst;
+	tx_queue_map = global_param->pkt_tx_queue_map;
+	tx_queue = tx_queue_default();
+	pending_cnt = 0;
+	pace_cnt = 0;
+	pace_poll = 0;
+	tx_hold = 0;
+	retry_num = 0;
+	retry_max = global_param->pkt_tx_retry_max > 0 ?
+		global_param->pkt_tx_retry_max : 0;
+	retry_age_ns = global_param->pkt_tx_retry_ns;
+
+	/*
+	 * Pages of the tables of unused (port, queue) pairs are never
+	 * touched.
+	 */
+	pkt_tbl = malloc(tx_burst * sizeof(odp_packet_t) * NUM_TABLES +
+			 ODP_CACHE_LINE_SIZE);
+	send_pkt_tbl = calloc(NUM_TABLES, sizeof(*send_pkt_tbl));
+	pending_tbl = malloc(NUM_TABLES * sizeof(*pending_tbl));
+	if (!pkt_tbl || !send_pkt_tbl || !pending_tbl) {
 		OFP_ERR("Packet table allocation failed\n");
 		ofp_send_pkt_out_term_local();
 		return -1;
 	}
 
-	for (i = 0; i < NUM_PORTS; i++) {
-		send_pkt_tbl[i].pkt_tbl_cnt = 0;
-		if (!i) {
-			const uint64_t mask = ODP_CACHE_LINE_SIZE - 1;
-			send_pkt_tbl[i].pkt_tbl =
-				(odp_packet_t *)(((uint64_t)pkt_tbl + mask) & ~mask);
-		} else {
-			send_pkt_tbl[i].pkt_tbl =
-				send_pkt_tbl[0].pkt_tbl + global_param->pkt_tx_burst_size * i;
+	tbl = (odp_packet_t *)(((uint64_t)pkt_tbl + mask) & ~mask);
+	for (i = 0; i < num_tables; i++)
+		send_pkt_tbl[i].pkt_tbl = tbl + tx_burst * i;
+
+	if (retry_max) {
+		/* Untouched like the tables until a queue gets full */
+		retry_mem = malloc(NUM_TABLES * retry_max *
+				   (sizeof(odp_packet_t) + sizeof(uint64_t)));
+		retry_tbl = malloc(NUM_TABLES * sizeof(*retry_tbl));
+		if (!retry_mem || !retry_tbl) {
+			OFP_ERR("Retry backlog allocation failed\n");
+			ofp_send_pkt_out_term_local();
+			return -1;
+		}
+		for (i = 0; i < num_tables; i++) {
+			send_pkt_tbl[i].retry_ns = (uint64_t *)retry_mem +
+				retry_max * i;
+			send_pkt_tbl[i].retry = (odp_packet_t *)
+				((uint64_t *)retry_mem +
+				 NUM_TABLES * retry_max) + retry_max * i;
 		}
-		for (j = 0; j < global_param->pkt_tx_burst_size; j++)
-			send_pkt_tbl[i].pkt_tbl[j] = ODP_PACKET_INVALID;
+	}
+
+	pace_free = PACE_NONE;
+	if (global_param->pkt_tx_pace_max > 0) {
+		pace_ent = malloc(global_param->pkt_tx_pace_max *
+				  sizeof(*pace_ent));
+		pace_slot = malloc(PACE_SLOTS * sizeof(*pace_slot));
+		if (!pace_ent || !pace_slot) {
+			OFP_ERR("Pacing wheel allocation failed\n");
+			ofp_send_pkt_out_term_local();
+			return -1;
+		}
+		for (i = 0; i < (uint32_t)global_param->pkt_tx_pace_max; i++)
+			pace_ent[i].next = i + 1;
+		pace_ent[i - 1].next = PACE_NONE;
+		pace_free = 0;
+		for (i = 0; i < PACE_SLOTS; i++)
+			pace_slot[i].head = PACE_NONE;
 	}
 
 	return 0;
@@ -125,17 +648,49 @@ int ofp_send_pkt_out_init_local(void)
 
 int ofp_send_pkt_out_term_local(void)
 {
+	const uint32_t num_tables = NUM_TABLES;
 	uint32_t i, j;
 
-	for (i = 0; i < NUM_PORTS; i++) {
+	for (i = 0; pace_cnt && i < PACE_SLOTS; i++) {
+		for (j = pace_slot[i].head; j != PACE_NONE;
+		     j = pace_ent[j].next) {
+			odp_packet_free(pace_ent[j].pkt);
+			pace_cnt--;
+		}
+	}
+	free(pace_slot);
+	free(pace_ent);
+	pace_slot = NULL;
+	pace_ent = NULL;
+	pace_poll = 0;
+	tx_hold = 0;
+
+	for (i = 0; send_pkt_tbl && i < num_tables; i++) {
 
 		for (j = 0; j < send_pkt_tbl[i].pkt_tbl_cnt; j++)
 			odp_packet_free(send_pkt_tbl[i].pkt_tbl[j]);
 
 		send_pkt_tbl[i].pkt_tbl_cnt = 0;
+
+		for (j = 0; j < send_pkt_tbl[i].retry_cnt; j++)
+			odp_packet_free(send_pkt_tbl[i].retry[j]);
+
+		send_pkt_tbl[i].retry_cnt = 0;
 	}
 
+	free(retry_tbl);
+	free(retry_mem);
+	retry_tbl = NULL;
+	retry_mem = NULL;
+	retry_num = 0;
+
+	free(pending_tbl);
+	free(send_pkt_tbl);
 	free(pkt_tbl);
+	pending_tbl = NULL;
+	send_pkt_tbl = NULL;
+	pkt_tbl = NULL;
+	pending_cnt = 0;
 
 	return 0;
 }
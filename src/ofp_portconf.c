@@ -4,6 +4,7 @@
  *
  * SPDX-License-Identifier:	BSD-3-Clause
  */
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +17,7 @@
 #include "ofpi_route.h"
 #include "ofpi_util.h"
 #include "ofpi_avl.h"
+#include "ofpi_btree.h"
 
 #include "ofpi_queue.h"
 #include "ofpi_ioctl.h"
@@ -25,8 +27,13 @@
 #include "ofpi_sysctl.h"
 #include "ofpi_in_var.h"
 #include "ofpi_log.h"
+#include "ofpi_flow_cache.h"
 #include "ofpi_netlink.h"
 #include "ofpi_igmp_var.h"
+#include "ofpi_hash.h"
+#include "ofpi_stat.h"
+#include "ofpi_ip.h"
+#include "ofpi_module.h"
 
 #define SHM_NAME_PORTS "OfpPortconfShMem"
 #define SHM_NAME_PORT_LOCKS "OfpPortconfLocksShMem"
@@ -38,12 +45,18 @@
 #endif /*SP*/
 
 #define PORT_UNDEF 0xFFFF
+
+/* What the packet paths read of an ifnet fits in a cache line */
+ODP_STATIC_ASSERT(offsetof(struct ofp_ifnet, out_queue_pktout) <=
+		  ODP_CACHE_LINE_SIZE, "ofp_ifnet hot part");
+
 void ofp_ifnet_print_ip_addrs(struct ofp_ifnet *dev);
 /*
  * Shared data
  */
 struct ofp_portconf_mem {
-	struct ofp_ifnet ofp_ifnet_data[NUM_PORTS];
+	/* NUM_PORTS entries, after the struct */
+	struct ofp_ifnet *ofp_ifnet_data;
 	odp_atomic_u32_t free_port;
 	int ofp_num_ports;
 
@@ -51,6 +64,10 @@ struct ofp_portconf_mem {
 #ifdef INET6
 	struct ofp_in_ifaddrhead in_ifaddr6head;
 #endif /* INET6 */
+	struct ofp_ifaddr_node *ifaddr_hash[OFP_IFADDR_HASH_SIZE];
+	uint16_t ifaddr_bloom[OFP_IFADDR_BLOOM_SIZE];
+	/* Free NUM_IFADDR_EXTRA entries, after ofp_ifnet_data */
+	struct ofp_ifaddr_extra *ifaddr_extra_free;
 
 #ifdef SP
 	struct {
@@ -60,9 +77,30 @@ struct ofp_portconf_mem {
 #endif /* SP */
 };
 
+/*
+ * Two-level direct table of VLAN interfaces, indexed by the high and
+ * low byte of the VLAN ID. Blocks are allocated on first use and kept,
+ * so that lockless readers never see a block reused. A port that could
+ * not get a block falls back to the AVL tree.
+ */
+#define VLAN_BLOCK_SHIFT 8
+#define VLAN_BLOCK_SIZE (1 << VLAN_BLOCK_SHIFT)
+#define VLAN_BLOCK_MASK (VLAN_BLOCK_SIZE - 1)
+#define VLAN_DIR_SIZE (65536 >> VLAN_BLOCK_SHIFT)
+
+struct vlan_block {
+	struct ofp_ifnet *ifnet[VLAN_BLOCK_SIZE];
+};
+
 struct ofp_vlan_mem {
 	struct ofp_ifnet *free_ifnet_list;
 	odp_rwlock_t vlan_mtx;
+	/* NUM_PORTS entries each, after the blocks */
+	struct vlan_block *(*vlan_dir)[VLAN_DIR_SIZE];
+	odp_bool_t *vlan_dir_overflow;
+	struct vlan_block *blocks;
+	int num_blocks;
+	int used_blocks;
 	struct ofp_ifnet vlan_ifnet[0];
 };
 
@@ -74,34 +112,111 @@ struct ofp_ifnet_locks_str  *ofp_ifnet_locks_shm;
 
 static __thread struct ofp_vlan_mem *vlan_shm;
 
-/*Wrapper functions over AVL tree*/
+/*Wrapper functions over AVL tree or B+tree*/
 static void *new_vlan(
 		int (*compare_fun)(void *compare_arg, void *a, void *b),
 		void *compare_arg)
 {
+	if (global_param->use_btree)
+		return ofp_btree_new(compare_fun, compare_arg);
 	return avl_tree_new(compare_fun, compare_arg);
 }
 
 static void free_vlan(void *root, int (*free_key_fun)(void *arg))
 {
-	avl_tree_free((avl_tree *)root, free_key_fun);
+	if (global_param->use_btree)
+		ofp_btree_free(root, free_key_fun);
+	else
+		avl_tree_free((avl_tree *)root, free_key_fun);
 }
 
 static int vlan_iterate_inorder(void *root,
 			int (*iterate_fun)(void *key, void *iter_arg),
 			void *iter_arg)
 {
+	if (global_param->use_btree)
+		return ofp_btree_iterate_inorder(root, iterate_fun, iter_arg);
 	return avl_iterate_inorder(root, iterate_fun, iter_arg);
 }
 
+static int vlan_is_empty(void *root)
+{
+	if (global_param->use_btree)
+		return ofp_btree_get_first(root) == NULL;
+	return avl_get_first(root) == NULL;
+}
+
+static void ifaddr_hash_remove(struct ofp_ifnet *dev);
+
+/* Called with the vlan lock held */
+static void vlan_table_set(struct ofp_ifnet *ifnet, struct ofp_ifnet *value)
+{
+	struct vlan_block **dir =
+		&vlan_shm->vlan_dir[ifnet->port][ifnet->vlan >> VLAN_BLOCK_SHIFT];
+	struct vlan_block *block = *dir;
+
+	if (!block) {
+		if (!value)
+			return;
+		if (vlan_shm->used_blocks == vlan_shm->num_blocks) {
+			vlan_shm->vlan_dir_overflow[ifnet->port] = 1;
+			return;
+		}
+		block = &vlan_shm->blocks[vlan_shm->used_blocks++];
+		memset(block, 0, sizeof(*block));
+		__atomic_store_n(dir, block, __ATOMIC_RELEASE);
+	}
+
+	__atomic_store_n(&block->ifnet[ifnet->vlan & VLAN_BLOCK_MASK], value,
+			 __ATOMIC_RELEASE);
+}
+
+/* Returns 1 and sets *ifnet if the table covers the port */
+static inline int vlan_table_get(int port, uint16_t vlan,
+				 struct ofp_ifnet **ifnet)
+{
+	struct vlan_block *block;
+
+	if (odp_unlikely(vlan_shm->vlan_dir_overflow[port]))
+		return 0;
+
+	block = __atomic_load_n(&vlan_shm->vlan_dir[port][vlan >> VLAN_BLOCK_SHIFT],
+				__ATOMIC_ACQUIRE);
+	*ifnet = block ? __atomic_load_n(&block->ifnet[vlan & VLAN_BLOCK_MASK],
+					 __ATOMIC_ACQUIRE) : NULL;
+	return 1;
+}
+
 int vlan_ifnet_insert(void *root, void *elem)
 {
-	return avl_insert((avl_tree *)root, elem);
+	struct ofp_ifnet *ifnet = elem;
+
+	if (global_param->use_btree ? ofp_btree_insert(root, elem) :
+	    avl_insert((avl_tree *)root, elem))
+		return -1;
+
+	odp_rwlock_write_lock(&vlan_shm->vlan_mtx);
+	vlan_table_set(ifnet, ifnet);
+	odp_rwlock_write_unlock(&vlan_shm->vlan_mtx);
+
+	return 0;
 }
 
 int vlan_ifnet_delete(void *root, void *elem,
 					int (*free_key_fun)(void *arg))
 {
+	struct ofp_ifnet *ifnet;
+
+	if (ofp_vlan_get_by_key(root, elem, (void **)&ifnet))
+		return -1;
+
+	odp_rwlock_write_lock(&vlan_shm->vlan_mtx);
+	vlan_table_set(ifnet, NULL);
+	odp_rwlock_write_unlock(&vlan_shm->vlan_mtx);
+	ifaddr_hash_remove(ifnet);
+
+	if (global_param->use_btree)
+		return ofp_btree_delete(root, elem, free_key_fun);
 	return avl_delete(root, elem, free_key_fun);
 }
 
@@ -111,6 +226,8 @@ int ofp_vlan_get_by_key(
 	void **value_address
 	)
 {
+	if (global_param->use_btree)
+		return ofp_btree_get_by_key(root, key, value_address);
 	return avl_get_by_key(root, key, value_address);
 }
 
@@ -129,21 +246,270 @@ static int vlan_ifnet_compare(void *compare_arg, void *a, void *b)
 	return (a1->vlan - b1->vlan);
 }
 
-static int vlan_match_ip(void *key, void *iter_arg)
+/*
+ * Interface address hash. Lookups are lockless. Nodes live in the
+ * interfaces, which stay in shared memory until ofp_term_global():
+ * a deleted VLAN goes back to the free list and may be reused. A lookup
+ * racing with a change may miss the changed address or see a reused
+ * interface, but never follows a pointer out of the interface memory.
+ * Changes are serialized by the ifaddr_hash lock.
+ */
+#define IFADDR_KEY_WORDS_V4 2
+#define IFADDR_KEY_WORDS_V6 5
+#define IFADDR_AF_TUNNEL 0xffff	/* Not an OFP_AF_* value */
+
+static inline void ifaddr_key_v4(struct ofp_ifaddr_key *key, uint16_t vrf,
+				 uint32_t addr)
 {
-	struct ofp_ifnet *iface = key;
-	uint32_t ip = *((uint32_t *)iter_arg);
+	key->vrf_af = (uint32_t)vrf << 16 | OFP_AF_INET;
+	key->addr[0] = addr;
+	key->addr[1] = key->addr[2] = key->addr[3] = 0;
+}
+
+static inline void ifaddr_key_v6(struct ofp_ifaddr_key *key,
+				 const uint8_t *addr)
+{
+	key->vrf_af = OFP_AF_INET6;
+	memcpy(key->addr, addr, sizeof(key->addr));
+}
 
-	if (-1 != ofp_ifnet_ip_find(iface, ip))
-		return iface->vlan;
+static inline void ifaddr_key_tun(struct ofp_ifaddr_key *key, uint16_t vrf,
+				  uint32_t tun_loc, uint32_t tun_rem)
+{
+	key->vrf_af = (uint32_t)vrf << 16 | IFADDR_AF_TUNNEL;
+	key->addr[0] = tun_loc;
+	key->addr[1] = tun_rem;
+	key->addr[2] = key->addr[3] = 0;
+}
+
+static inline int ifaddr_key_words(const struct ofp_ifaddr_key *key)
+{
+	return (key->vrf_af & 0xffff) == OFP_AF_INET ?
+		IFADDR_KEY_WORDS_V4 : IFADDR_KEY_WORDS_V6;
+}
+
+static inline int ifaddr_key_equal(const struct ofp_ifaddr_key *a,
+				   const struct ofp_ifaddr_key *b)
+{
+	return !memcmp(a, b, ifaddr_key_words(a) * sizeof(uint32_t));
+}
+
+static inline struct ofp_ifaddr_node **
+ifaddr_bucket(const struct ofp_ifaddr_key *key)
+{
+	uint32_t h = ofp_hash_key((const uint32_t *)key,
+				  ifaddr_key_words(key), 0);
+
+	return &shm->ifaddr_hash[h & (OFP_IFADDR_HASH_SIZE - 1)];
+}
+
+static inline uint32_t ifaddr_bloom_hash(const struct ofp_ifaddr_key *key)
+{
+	return ofp_hash_key((const uint32_t *)key, IFADDR_KEY_WORDS_V4,
+			    OFP_IFADDR_BLOOM_SEED);
+}
+
+#define IFADDR_BLOOM_IDX1(h) ((h) & (OFP_IFADDR_BLOOM_SIZE - 1))
+#define IFADDR_BLOOM_IDX2(h) (((h) >> 16) & (OFP_IFADDR_BLOOM_SIZE - 1))
+
+/* Called with the ifaddr_hash lock held, for IPv4 keys only */
+static void ifaddr_bloom_update(const struct ofp_ifaddr_key *key, int add)
+{
+	uint32_t h = ifaddr_bloom_hash(key);
+	uint16_t *c1 = &shm->ifaddr_bloom[IFADDR_BLOOM_IDX1(h)];
+	uint16_t *c2 = &shm->ifaddr_bloom[IFADDR_BLOOM_IDX2(h)];
+
+	/* Both counters are raised before and lowered after the link */
+	__atomic_store_n(c1, *c1 + (add ? 1 : -1), __ATOMIC_RELAXED);
+	__atomic_store_n(c2, *c2 + (add ? 1 : -1), __ATOMIC_RELEASE);
+}
+
+static inline int ifaddr_key_is_v4(const struct ofp_ifaddr_key *key)
+{
+	return (key->vrf_af & 0xffff) == OFP_AF_INET;
+}
+
+/* Next node after node, or the first one if NULL, matching key */
+static struct ofp_ifaddr_node *
+ifaddr_hash_next(struct ofp_ifaddr_node *node, const struct ofp_ifaddr_key *key)
+{
+	if (node)
+		node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
 	else
-		return 0;
+		node = __atomic_load_n(ifaddr_bucket(key), __ATOMIC_ACQUIRE);
+
+	for (; node; node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))
+		if (ifaddr_key_equal(&node->key, key))
+			return node;
+
+	return NULL;
+}
+
+/* Called with the ifaddr_hash lock held */
+static void ifaddr_node_unlink(struct ofp_ifaddr_node *node)
+{
+	struct ofp_ifaddr_node **pp = ifaddr_bucket(&node->key);
+
+	if (!node->linked)
+		return;
+
+	while (*pp != node)
+		pp = &(*pp)->next;
+
+	__atomic_store_n(pp, node->next, __ATOMIC_RELEASE);
+	node->linked = 0;
+
+	if (ifaddr_key_is_v4(&node->key))
+		ifaddr_bloom_update(&node->key, 0);
+}
+
+/* Called with the ifaddr_hash lock held */
+static void ifaddr_node_set(struct ofp_ifnet *dev, struct ofp_ifaddr_node *node,
+			    const struct ofp_ifaddr_key *key)
+{
+	struct ofp_ifaddr_node **bucket;
+
+	if (node->linked) {
+		if (key && ifaddr_key_equal(&node->key, key))
+			return;
+		ifaddr_node_unlink(node);
+	}
+
+	if (!key)
+		return;
+
+	if (ifaddr_key_is_v4(key))
+		ifaddr_bloom_update(key, 1);
+
+	bucket = ifaddr_bucket(key);
+	node->ifnet = dev;
+	node->key = *key;
+	node->next = *bucket;
+	node->linked = 1;
+	__atomic_store_n(bucket, node, __ATOMIC_RELEASE);
+}
+
+/* Rehash the addresses of dev, after any of them or its vrf changed */
+static void ifaddr_hash_update(struct ofp_ifnet *dev)
+{
+	struct ofp_ifaddr_extra *extra;
+	struct ofp_ifaddr_key key;
+	int i;
+
+	OFP_IFNET_LOCK_WRITE(ifaddr_hash);
+
+	for (i = 0; i < OFP_NUM_IFNET_IP_ADDRS; i++) {
+		uint32_t addr = dev->ip_addr_info[i].ip_addr;
+
+		ifaddr_key_v4(&key, dev->vrf, addr);
+		ifaddr_node_set(dev, &dev->ifaddr_node[i], addr ? &key : NULL);
+	}
+
+	for (extra = dev->ip_addr_extra; extra; extra = extra->next) {
+		ifaddr_key_v4(&key, dev->vrf, extra->info.ip_addr);
+		ifaddr_node_set(dev, &extra->node, &key);
+	}
+
+#ifdef INET6
+	ifaddr_key_v6(&key, dev->ip6_addr);
+	ifaddr_node_set(dev, &dev->ifaddr_node[OFP_IFADDR_NODE_IP6],
+			ofp_ip6_is_set(dev->ip6_addr) ? &key : NULL);
+#endif /* INET6 */
+
+	ifaddr_key_tun(&key, dev->vrf, dev->ip_local, dev->ip_remote);
+	ifaddr_node_set(dev, &dev->ifaddr_node[OFP_IFADDR_NODE_TUN],
+			ofp_if_type(dev) == OFP_IFT_GRE && dev->ip_remote ?
+			&key : NULL);
+
+	OFP_IFNET_UNLOCK_WRITE(ifaddr_hash);
+}
+
+/*
+ * Additional addresses. Entries go back to the pool when removed and
+ * may be reused at once: like a freed VLAN interface, a lookup racing
+ * with it only misses or skips to another chain.
+ */
+static inline int ifaddr_node_is_extra(struct ofp_ifnet *dev,
+				       struct ofp_ifaddr_node *node)
+{
+	return node < dev->ifaddr_node ||
+		node >= &dev->ifaddr_node[OFP_IFADDR_NODES];
+}
+
+static struct ofp_ifaddr_extra *ifaddr_extra_get(struct ofp_ifnet *dev,
+						 uint32_t addr)
+{
+	struct ofp_ifaddr_node *node = NULL;
+	struct ofp_ifaddr_key key;
+
+	if (!__atomic_load_n(&dev->ip_addr_extra, __ATOMIC_RELAXED))
+		return NULL;
+
+	ifaddr_key_v4(&key, dev->vrf, addr);
+	while ((node = ifaddr_hash_next(node, &key)))
+		if (node->ifnet == dev && ifaddr_node_is_extra(dev, node))
+			return (struct ofp_ifaddr_extra *)node;
+
+	return NULL;
+}
+
+/* Called with the ip_addr list lock of dev held */
+static int ifaddr_extra_add(struct ofp_ifnet *dev, uint32_t addr)
+{
+	struct ofp_ifaddr_extra *extra;
+	struct ofp_ifaddr_key key;
+
+	OFP_IFNET_LOCK_WRITE(ifaddr_hash);
+	extra = shm->ifaddr_extra_free;
+	if (extra) {
+		shm->ifaddr_extra_free = extra->next;
+		memset(&extra->info, 0, sizeof(extra->info));
+		extra->info.ip_addr = addr;
+		extra->next = dev->ip_addr_extra;
+		dev->ip_addr_extra = extra;
+
+		ifaddr_key_v4(&key, dev->vrf, addr);
+		ifaddr_node_set(dev, &extra->node, &key);
+	}
+	OFP_IFNET_UNLOCK_WRITE(ifaddr_hash);
+
+	return extra ? 0 : -1;
+}
+
+/* Called with the ip_addr list lock of dev and the ifaddr_hash lock held */
+static void ifaddr_extra_free(struct ofp_ifnet *dev,
+			      struct ofp_ifaddr_extra *extra)
+{
+	struct ofp_ifaddr_extra **pp = &dev->ip_addr_extra;
+
+	while (*pp != extra)
+		pp = &(*pp)->next;
+	*pp = extra->next;
+
+	ifaddr_node_unlink(&extra->node);
+	extra->next = shm->ifaddr_extra_free;
+	shm->ifaddr_extra_free = extra;
+}
+
+/* Remove dev from the address hash before it is freed */
+static void ifaddr_hash_remove(struct ofp_ifnet *dev)
+{
+	int i;
+
+	IP_ADDR_LIST_WLOCK(dev);
+	OFP_IFNET_LOCK_WRITE(ifaddr_hash);
+	for (i = 0; i < OFP_IFADDR_NODES; i++)
+		ifaddr_node_unlink(&dev->ifaddr_node[i]);
+	while (dev->ip_addr_extra)
+		ifaddr_extra_free(dev, dev->ip_addr_extra);
+	OFP_IFNET_UNLOCK_WRITE(ifaddr_hash);
+	IP_ADDR_LIST_WUNLOCK(dev);
 }
 
 int ofp_free_port_alloc(void)
 {
 	int port = (int)odp_atomic_fetch_inc_u32(&shm->free_port);
-	if (port >= OFP_FP_INTERFACE_MAX) {
+	if (port >= FP_PORTS) {
 		OFP_ERR("Interfaces are depleted");
 		return -1;
 	}
@@ -194,6 +560,45 @@ static void print_eth_stats (odp_pktio_stats_t stats, int fd)
 		stats.out_errors);
 }
 
+/* Fast path counters of the interface, and of its queues if many */
+static void print_fp_stats(struct ofp_ifnet *iface, int fd)
+{
+	struct ofp_if_stat st, q[OFP_IFQ_STAT_MAX];
+	int i, num;
+
+	if (ofp_get_if_statistics(iface->port, iface->vlan, &st))
+		return;
+
+	ofp_sendf(fd,
+		"\tFP RX: bytes:%lu packets:%lu  TX: bytes:%lu packets:%lu\r\n",
+		st.rx_bytes, st.rx_pkts, st.tx_bytes, st.tx_pkts);
+
+	if (iface->vlan || iface->port >= FP_PORTS)
+		return;
+
+	num = ofp_get_if_queue_statistics(iface->port, q, OFP_IFQ_STAT_MAX);
+	if (num <= 1)
+		return;
+
+	for (i = 0; i < num; i++)
+		ofp_sendf(fd,
+			"\t  queue %d RX: bytes:%lu packets:%lu"
+			"  TX: bytes:%lu packets:%lu\r\n",
+			i, q[i].rx_bytes, q[i].rx_pkts,
+			q[i].tx_bytes, q[i].tx_pkts);
+}
+
+static void print_if_stats(struct ofp_ifnet *iface, odp_pktio_stats_t *stats,
+			   int fd)
+{
+	print_fp_stats(iface, fd);
+
+	if (stats)
+		print_eth_stats(*stats, fd);
+	else
+		ofp_sendf(fd, "\r\n");
+}
+
 static int iter_vlan(void *key, void *iter_arg)
 {
 	struct ofp_ifnet *iface = key;
@@ -240,10 +645,7 @@ static int iter_vlan(void *key, void *iter_arg)
 			"	Local: %s	Remote: %s\r\n",
 			ofp_print_ip_addr(iface->ip_local),
 			ofp_print_ip_addr(iface->ip_remote));
-		if (res == 0)
-			print_eth_stats(stats, fd);
-		else
-			ofp_sendf(fd, "\r\n");
+		print_if_stats(iface, res == 0 ? &stats : NULL, fd);
 		return 0;
 	} else if (ofp_if_type(iface) == OFP_IFT_GRE && !iface->vlan) {
 		ofp_sendf(fd, "gre%d\r\n"
@@ -283,10 +685,7 @@ static int iter_vlan(void *key, void *iter_arg)
 			  ofp_port_vlan_to_ifnet_name(iface->physport,
 						      iface->physvlan),
 			  iface->if_mtu);
-		if (res == 0)
-			print_eth_stats(stats, fd);
-		else
-			ofp_sendf(fd, "\r\n");
+		print_if_stats(iface, res == 0 ? &stats : NULL, fd);
 		return 0;
 	}
 
@@ -317,10 +716,7 @@ static int iter_vlan(void *key, void *iter_arg)
 			  iface->ip6_prefix,
 #endif /* INET6 */
 			  iface->if_mtu);
-		if (res == 0)
-			print_eth_stats(stats, fd);
-		else
-			ofp_sendf(fd, "\r\n");
+		print_if_stats(iface, res == 0 ? &stats : NULL, fd);
 		return 0;
 	}
 
@@ -374,10 +770,7 @@ static int iter_vlan(void *key, void *iter_arg)
 		ofp_sendf(fd,
 			"	MTU: %d\r\n",
 			iface->if_mtu);
-		if (res == 0)
-			print_eth_stats(stats, fd);
-		else
-			ofp_sendf(fd, "\r\n");
+		print_if_stats(iface, res == 0 ? &stats : NULL, fd);
 	} else {
 		ofp_sendf(fd, "%s%d%s\r\n"
 			"	Link not configured\r\n\r\n",
@@ -393,14 +786,14 @@ void ofp_show_interfaces(int fd)
 	int i;
 
 	/* fp interfaces */
-	for (i = 0; i < OFP_FP_INTERFACE_MAX; i++) {
+	for (i = 0; i < FP_PORTS; i++) {
 		iter_vlan(&shm->ofp_ifnet_data[i], &fd);
 		vlan_iterate_inorder(shm->ofp_ifnet_data[i].vlan_structs,
 					iter_vlan, &fd);
 	}
 
 	/* gre interfaces */
-	if (avl_get_first(shm->ofp_ifnet_data[GRE_PORTS].vlan_structs))
+	if (!vlan_is_empty(shm->ofp_ifnet_data[GRE_PORTS].vlan_structs))
 		vlan_iterate_inorder(
 			shm->ofp_ifnet_data[GRE_PORTS].vlan_structs,
 			iter_vlan, &fd);
@@ -409,7 +802,7 @@ void ofp_show_interfaces(int fd)
 				"	Link not configured\r\n\r\n");
 
 	/* vxlan interfaces */
-	if (avl_get_first(shm->ofp_ifnet_data[VXLAN_PORTS].vlan_structs))
+	if (!vlan_is_empty(shm->ofp_ifnet_data[VXLAN_PORTS].vlan_structs))
 		vlan_iterate_inorder(
 			shm->ofp_ifnet_data[VXLAN_PORTS].vlan_structs,
 			iter_vlan, &fd);
@@ -417,7 +810,7 @@ void ofp_show_interfaces(int fd)
 		ofp_sendf(fd, "vxlan\r\n"
 				"	Link not configured\r\n\r\n");
 	/* local interfaces */
-	if (avl_get_first(shm->ofp_ifnet_data[LOCAL_PORTS].vlan_structs))
+	if (!vlan_is_empty(shm->ofp_ifnet_data[LOCAL_PORTS].vlan_structs))
 		vlan_iterate_inorder(
 			shm->ofp_ifnet_data[LOCAL_PORTS].vlan_structs,
 			iter_vlan, &fd);
@@ -439,7 +832,7 @@ static int iter_vlan_2(void *key, void *iter_arg)
 void ofp_show_ifnet_ip_addrs(int fd)
 {
 	int i;
-	for (i = 0; i < OFP_FP_INTERFACE_MAX; i++) {
+	for (i = 0; i < FP_PORTS; i++) {
 		iter_vlan_2(&shm->ofp_ifnet_data[i], &fd);
 		vlan_iterate_inorder(shm->ofp_ifnet_data[i].vlan_structs,
 				iter_vlan_2, &fd);
@@ -503,7 +896,7 @@ const char *ofp_config_interface_up_v4(int port, uint16_t vlan, uint16_t vrf,
 #ifdef SP
 	(void)ret;
 #endif /*SP*/
-	if (port < 0 || port >= OFP_FP_INTERFACE_MAX)
+	if (port < 0 || port >= FP_PORTS)
 		return "Wrong port number";
 
 	if (vrf >= global_param->num_vrf)
@@ -624,6 +1017,8 @@ const char *ofp_config_interface_up_v4(int port, uint16_t vlan, uint16_t vrf,
 #endif /* SP */
 	}
 
+	ifaddr_hash_update(data);
+
 	return NULL;
 }
 
@@ -637,7 +1032,7 @@ const char *ofp_config_interface_add_ip_v4(int port, uint16_t vlan, uint16_t vrf
 	uint32_t mask;
 	struct ofp_ifnet *data;
 	int idx;
-	if (port < 0 || port >= OFP_FP_INTERFACE_MAX)
+	if (port < 0 || port >= FP_PORTS)
 		return "Wrong port number";
 
 	data = ofp_get_ifnet(port, vlan);
@@ -684,26 +1079,27 @@ const char *ofp_config_interface_del_ip_v4(int port, uint16_t vlan, int vrf,
 	int ret = 0;
 #endif /* SP */
 	struct ofp_ifnet *data;
+	struct ofp_ifnet_ipaddr *ia;
 	int idx;
 	static char msg[64];
 
 	(void)vrf; /* Suppress unused parameter warning when SP is not enabled. */
 
-	if (port < 0 || port >= OFP_FP_INTERFACE_MAX)
+	if (port < 0 || port >= FP_PORTS)
 		return "Wrong port number";
 
 	data = ofp_get_ifnet(port, vlan);
 	if (NULL == data)
 		return "Invalid interface";
 
-	idx = ofp_ifnet_ip_find(data, addr);
-	if (-1 != idx) {
+	ia = ofp_ifnet_ip_get(data, addr);
+	if (ia) {
 		uint32_t mask = ~0;
-		mask = odp_cpu_to_be_32(mask << (32 - data->ip_addr_info[idx].masklen));
+		mask = odp_cpu_to_be_32(mask << (32 - ia->masklen));
 
-		if (masklen != data->ip_addr_info[idx].masklen) {
+		if (masklen != ia->masklen) {
 			memset(msg, 0, sizeof(msg));
-			snprintf(msg, sizeof(msg) , "Provided %d differs from the %d saved\n", masklen, data->ip_addr_info[idx].masklen);
+			snprintf(msg, sizeof(msg) , "Provided %d differs from the %d saved\n", masklen, ia->masklen);
 			return msg;
 		}
 		ofp_set_route_params(OFP_ROUTE_DEL, data->vrf, data->vlan, port,
@@ -753,6 +1149,9 @@ const char *ofp_config_interface_up_tun(int port, uint16_t greid,
 	(void)new;
 #endif /*SP*/
 
+	if (!ofp_module_enabled(OFP_MODULE_GRE))
+		return "GRE module not enabled.";
+
 	if (port != GRE_PORTS || greid == 0)
 		return "Wrong port number or tunnel ID.";
 
@@ -825,6 +1224,9 @@ const char *ofp_config_interface_up_tun(int port, uint16_t greid,
 		 ofp_print_ip_addr(addr), ofp_print_ip_addr(p2p));
 	ret = exec_sys_call_depending_on_vrf(cmd, vrf);
 #endif /* SP */
+
+	ifaddr_hash_update(data);
+
 	return NULL;
 }
 
@@ -871,6 +1273,9 @@ const char *ofp_config_interface_up_vxlan(uint16_t vrf, uint32_t addr, int mlen,
 #endif /*SP*/
 	(void)vrf; /* vrf is copied from the root device */
 
+	if (!ofp_module_enabled(OFP_MODULE_VXLAN))
+		return "VXLAN module not enabled.";
+
 	mask = ~0;
 	mask = odp_cpu_to_be_32(mask << (32 - mlen));
 	dev_root = ofp_get_ifnet(physport, physvlan);
@@ -888,6 +1293,7 @@ const char *ofp_config_interface_up_vxlan(uint16_t vrf, uint32_t addr, int mlen,
 
 	data = ofp_get_create_ifnet(VXLAN_PORTS, vni);
 	data->if_type = OFP_IFT_VXLAN;
+	ofp_ip4_feat_update(1);
 
 	data->vrf = dev_root->vrf;
 	data->ip_p2p = group;
@@ -928,6 +1334,8 @@ const char *ofp_config_interface_up_vxlan(uint16_t vrf, uint32_t addr, int mlen,
 	ret = exec_sys_call_depending_on_vrf(cmd, vrf);
 #endif /* SP */
 
+	ifaddr_hash_update(data);
+
 	return NULL;
 }
 
@@ -983,6 +1391,8 @@ const char *ofp_config_interface_up_local(uint16_t id, uint16_t vrf,
 	ret = exec_sys_call_depending_on_vrf(cmd, vrf);
 #endif /* SP */
 
+	ifaddr_hash_update(data);
+
 	return NULL;
 }
 
@@ -1003,7 +1413,7 @@ const char *ofp_config_interface_up_v6(int port, uint16_t vlan,
 #endif /*SP*/
 	memset(gw6, 0, 16);
 
-	if (port < 0 || port >= OFP_FP_INTERFACE_MAX)
+	if (port < 0 || port >= FP_PORTS)
 		return "Wrong port number";
 
 	data = ofp_get_ifnet(port, vlan);
@@ -1088,6 +1498,8 @@ const char *ofp_config_interface_up_v6(int port, uint16_t vlan,
 #endif /* SP */
 	}
 
+	ifaddr_hash_update(data);
+
 	return NULL;
 }
 #endif /* INET6 */
@@ -1146,6 +1558,8 @@ const char *ofp_config_interface_up_local_v6(uint16_t id,
 		ret = exec_sys_call_depending_on_vrf(cmd, data->vrf);
 #endif /*SP*/
 
+	ifaddr_hash_update(data);
+
 	return NULL;
 }
 #endif /* INET6 */
@@ -1340,6 +1754,7 @@ const char *ofp_config_interface_down(int port, uint16_t vlan)
 			memset(data->ip6_addr, 0, 16);
 		}
 #endif /* INET6 */
+		ifaddr_hash_update(data);
 	}
 
 	return NULL;
@@ -1355,6 +1770,9 @@ struct ofp_ifnet *ofp_get_ifnet(int port, uint16_t vlan)
 	if (vlan || port == LOCAL_PORTS) {
 		struct ofp_ifnet key, *data;
 
+		if (odp_likely(vlan_table_get(port, vlan, &data)))
+			return data;
+
 		key.vlan = vlan;
 		if (ofp_vlan_get_by_key(
 				shm->ofp_ifnet_data[port].vlan_structs,
@@ -1385,6 +1803,8 @@ struct ofp_ifnet *ofp_get_create_ifnet(int port, uint16_t vlan)
 			memset(data, 0, sizeof(*data));
 			data->port = port;
 			data->vlan = vlan;
+			data->stat_idx = NUM_PORTS + (data - vlan_shm->vlan_ifnet);
+			ofp_if_stat_clear(data->stat_idx);
 			memcpy(data->mac, shm->ofp_ifnet_data[port].mac, 6);
 			data->chksum_offload_flags =
 				shm->ofp_ifnet_data[port].chksum_offload_flags;
@@ -1432,6 +1852,7 @@ int ofp_delete_ifnet(int port, uint16_t vlan)
 			shm->ofp_ifnet_data[port].vlan_structs,
 			&key,
 			free_key);
+		ofp_flow_cache_flush();
 		return 0;
 	}
 	return -1;
@@ -1504,26 +1925,21 @@ struct ofp_ifnet *ofp_get_ifnet_match(uint32_t ip,
 		uint16_t vrf,
 		uint16_t vlan)
 {
-	uint16_t port;
+	struct ofp_ifaddr_key key;
+	struct ofp_ifaddr_node *node = NULL;
 
-	if (vlan == 0) {
-		for (port = 0; port < OFP_FP_INTERFACE_MAX; port++) {
-			struct ofp_ifnet *ifnet =
-				&shm->ofp_ifnet_data[port];
+	ifaddr_key_v4(&key, vrf, ip);
 
-			if (ifnet->vrf == vrf)
-				if (-1 != ofp_ifnet_ip_find(ifnet, ip))
-					return ifnet;
-		}
-	} else {
-		for (port = 0; port < OFP_FP_INTERFACE_MAX; port++) {
-			uint16_t vlan_id = vlan_iterate_inorder(
-				shm->ofp_ifnet_data[port].vlan_structs,
-				vlan_match_ip, &ip);
+	while ((node = ifaddr_hash_next(node, &key))) {
+		struct ofp_ifnet *ifnet = node->ifnet;
 
-			if (vlan_id)
-				return ofp_get_ifnet(port, vlan);
-		}
+		if (!PHYS_PORT(ifnet->port))
+			continue;
+
+		if (vlan == 0 && ifnet->vlan == 0)
+			return ifnet;
+		if (vlan && ifnet->vlan)
+			return ofp_get_ifnet(ifnet->port, vlan);
 	}
 	return NULL;
 }
@@ -1567,20 +1983,20 @@ void ofp_get_interfaces(struct ofp_ifconf *ifc)
 	ifc->ifc_current_len = 0;
 
 	/* fp interfaces */
-	for (i = 0; i < OFP_FP_INTERFACE_MAX; i++) {
+	for (i = 0; i < FP_PORTS; i++) {
 		iter_interface(&shm->ofp_ifnet_data[i], ifc);
 		vlan_iterate_inorder(shm->ofp_ifnet_data[i].vlan_structs,
 					iter_interface, ifc);
 	}
 
 	/* gre interfaces */
-	if (avl_get_first(shm->ofp_ifnet_data[GRE_PORTS].vlan_structs))
+	if (!vlan_is_empty(shm->ofp_ifnet_data[GRE_PORTS].vlan_structs))
 		vlan_iterate_inorder(
 			shm->ofp_ifnet_data[GRE_PORTS].vlan_structs,
 			iter_interface, ifc);
 
 	/* vxlan interfaces */
-	if (avl_get_first(shm->ofp_ifnet_data[VXLAN_PORTS].vlan_structs))
+	if (!vlan_is_empty(shm->ofp_ifnet_data[VXLAN_PORTS].vlan_structs))
 		vlan_iterate_inorder(
 			shm->ofp_ifnet_data[VXLAN_PORTS].vlan_structs,
 			iter_interface, ifc);
@@ -1588,88 +2004,62 @@ void ofp_get_interfaces(struct ofp_ifconf *ifc)
 	ifc->ifc_len = ifc->ifc_current_len;
 }
 
-struct iter_ip {
-	uint32_t addr;
-	uint16_t vrf;
-};
-
-static int vlan_match_ip_vrf(void *key, void *iter_arg)
+void ofp_ifnet_iterate(int (*func)(void *key, void *iter_arg), void *arg)
 {
-	struct ofp_ifnet *iface = key;
-	struct iter_ip *iterdata = (struct iter_ip *)iter_arg;
+	int i;
 
-	if (iface->ip_addr_info[0].ip_addr == iterdata->addr &&
-	    iface->vrf == iterdata->vrf)
-		return iface->vlan;
-	else
-		return 0;
+	for (i = 0; i < NUM_PORTS; i++) {
+		if (i < FP_PORTS)
+			func(&shm->ofp_ifnet_data[i], arg);
+		if (!vlan_is_empty(shm->ofp_ifnet_data[i].vlan_structs))
+			vlan_iterate_inorder(shm->ofp_ifnet_data[i].vlan_structs,
+					     func, arg);
+	}
 }
 
 struct ofp_ifnet *ofp_get_ifnet_by_ip(uint32_t ip, uint16_t vrf)
 {
-	uint16_t port;
-	struct ofp_ifnet *ifnet;
-	uint16_t vlan;
-	struct iter_ip iterdata;
-
-	for (port = 0; port < OFP_FP_INTERFACE_MAX; ++port) {
-		ifnet = &shm->ofp_ifnet_data[port];
-		if (ifnet->ip_addr_info[0].ip_addr == ip && ifnet->vrf == vrf)
-			return ifnet;
-	}
+	struct ofp_ifaddr_key key;
+	struct ofp_ifaddr_node *node = NULL;
 
-	iterdata.addr = ip;
-	iterdata.vrf = vrf;
+	ifaddr_key_v4(&key, vrf, ip);
 
-	for (port = 0; port < OFP_FP_INTERFACE_MAX; ++port) {
-		vlan = vlan_iterate_inorder(
-			shm->ofp_ifnet_data[port].vlan_structs,
-			vlan_match_ip_vrf, &iterdata);
-		if (vlan)
-			return ofp_get_ifnet(port, vlan);
-	}
+	/* Only the first address of an interface counts */
+	while ((node = ifaddr_hash_next(node, &key)))
+		if (PHYS_PORT(node->ifnet->port) &&
+		    node == &node->ifnet->ifaddr_node[0])
+			return node->ifnet;
 
 	return NULL;
 }
 
-struct iter_tun {
-	uint32_t tun_loc;
-	uint32_t tun_rem;
-	uint16_t vrf;
-};
-
-static int vlan_match_tun(void *key, void *iter_arg)
+int ofp_ifaddr_is_local(uint32_t ip, uint16_t vrf)
 {
-	struct ofp_ifnet *iface = key;
-	struct iter_tun *tundata = iter_arg;
+	struct ofp_ifaddr_key key;
+	uint32_t h;
 
-	if (iface->ip_local == tundata->tun_loc &&
-	    iface->ip_remote == tundata->tun_rem &&
-	    iface->vrf == tundata->vrf)
-		return iface->vlan;
-	else
+	ifaddr_key_v4(&key, vrf, ip);
+
+	h = ifaddr_bloom_hash(&key);
+	if (!__atomic_load_n(&shm->ifaddr_bloom[IFADDR_BLOOM_IDX1(h)],
+			     __ATOMIC_RELAXED) ||
+	    !__atomic_load_n(&shm->ifaddr_bloom[IFADDR_BLOOM_IDX2(h)],
+			     __ATOMIC_RELAXED))
 		return 0;
+
+	return ifaddr_hash_next(NULL, &key) != NULL;
 }
 
 struct ofp_ifnet *ofp_get_ifnet_by_tunnel(uint32_t tun_loc,
 					  uint32_t tun_rem, uint16_t vrf)
 {
-	uint16_t port = GRE_PORTS;
-	uint16_t greid;
-	struct iter_tun tundata;
-
-	tundata.tun_loc = tun_loc;
-	tundata.tun_rem = tun_rem;
-	tundata.vrf = vrf;
+	struct ofp_ifaddr_key key;
+	struct ofp_ifaddr_node *node;
 
-	greid = vlan_iterate_inorder(
-		shm->ofp_ifnet_data[port].vlan_structs,
-		vlan_match_tun, &tundata);
+	ifaddr_key_tun(&key, vrf, tun_loc, tun_rem);
+	node = ifaddr_hash_next(NULL, &key);
 
-	if (greid)
-		return ofp_get_ifnet(port, greid);
-
-	return NULL;
+	return node ? node->ifnet : NULL;
 }
 
 struct ofp_ifnet *ofp_get_ifnet_pktio(odp_pktio_t pktio)
@@ -1698,6 +2088,25 @@ odp_queue_t ofp_pktio_spq_get(odp_pktio_t pktio)
 #endif /*SP*/
 }
 
+int ofp_ifnet_sp_drops(uint16_t port, uint16_t vlan,
+		       uint64_t drops[OFP_SP_CLASS_MAX])
+{
+	struct ofp_ifnet *ifnet = ofp_get_ifnet(port, vlan);
+	int i;
+
+	if (!ifnet)
+		return -1;
+
+	for (i = 0; i < OFP_SP_CLASS_MAX; i++) {
+#ifdef SP
+		drops[i] = odp_atomic_load_u64(&ifnet->sp_police[i].drops);
+#else
+		drops[i] = 0;
+#endif /*SP*/
+	}
+	return 0;
+}
+
 odp_queue_t ofp_pktio_loopq_get(odp_pktio_t pktio)
 {
 	struct ofp_ifnet *ifnet = ofp_get_ifnet_pktio(pktio);
@@ -1712,16 +2121,22 @@ odp_pktio_t ofp_port_pktio_get(int port)
 	return ifnet->pktio;
 }
 
+#define NUM_IFADDR_EXTRA \
+	(global_param->num_ifaddr > 0 ? global_param->num_ifaddr : 0)
+#define SHM_SIZE_PORTS (ROUNDUP_CACHE(sizeof(struct ofp_portconf_mem)) + \
+			NUM_PORTS * sizeof(struct ofp_ifnet) + \
+			NUM_IFADDR_EXTRA * sizeof(struct ofp_ifaddr_extra))
+
 void ofp_portconf_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_PORTS, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_PORTS, SHM_SIZE_PORTS);
 	ofp_shared_memory_prealloc(SHM_NAME_PORT_LOCKS,
 				   sizeof(*ofp_ifnet_locks_shm));
 }
 
 static int ofp_portconf_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_PORTS, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_PORTS, SHM_SIZE_PORTS);
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -1737,8 +2152,14 @@ static int ofp_portconf_alloc_shared_memory(void)
 	return 0;
 }
 
+/* Each VLAN interface needs at most one block */
+#define NUM_VLAN_BLOCKS (global_param->vlan_table ? \
+			 global_param->num_vlan : 0)
 #define SHM_SIZE_VLAN (sizeof(struct ofp_vlan_mem) + \
-		       sizeof(struct ofp_ifnet) * global_param->num_vlan)
+		       sizeof(struct ofp_ifnet) * global_param->num_vlan + \
+		       sizeof(struct vlan_block) * NUM_VLAN_BLOCKS + \
+		       (sizeof(*vlan_shm->vlan_dir) + sizeof(odp_bool_t)) * \
+		       NUM_PORTS)
 
 static int ofp_vlan_alloc_shared_memory(void)
 {
@@ -1817,11 +2238,14 @@ int ofp_vlan_lookup_shared_memory(void)
 
 int ofp_portconf_init_global(void)
 {
+	struct ofp_ifaddr_extra *extra;
 	int i, j;
 
 	HANDLE_ERROR(ofp_portconf_alloc_shared_memory());
 
-	memset(shm, 0, sizeof(*shm));
+	memset(shm, 0, SHM_SIZE_PORTS);
+	shm->ofp_ifnet_data = (struct ofp_ifnet *)
+		((uint8_t *)shm + ROUNDUP_CACHE(sizeof(*shm)));
 	for (i = 0; i < NUM_PORTS; i++) {
 		shm->ofp_ifnet_data[i].if_state = OFP_IFT_STATE_FREE;
 		shm->ofp_ifnet_data[i].pktio = ODP_PKTIO_INVALID;
@@ -1832,9 +2256,19 @@ int ofp_portconf_init_global(void)
 
 		shm->ofp_ifnet_data[i].loopq_def = ODP_QUEUE_INVALID;
 #ifdef SP
-		shm->ofp_ifnet_data[i].spq_def = ODP_QUEUE_INVALID;
+		for (j = 0; j < OFP_SP_CLASS_MAX; j++)
+			shm->ofp_ifnet_data[i].spq[j] = ODP_QUEUE_INVALID;
+		shm->ofp_ifnet_data[i].sp_evfd = -1;
+		shm->ofp_ifnet_data[i].sp_pktio = ODP_PKTIO_INVALID;
 #endif /*SP*/
 		shm->ofp_ifnet_data[i].pkt_pool = ODP_POOL_INVALID;
+		shm->ofp_ifnet_data[i].lag_tmo = ODP_TIMER_INVALID;
+	}
+
+	extra = (struct ofp_ifaddr_extra *)&shm->ofp_ifnet_data[NUM_PORTS];
+	for (i = 0; i < NUM_IFADDR_EXTRA; i++) {
+		extra[i].next = shm->ifaddr_extra_free;
+		shm->ifaddr_extra_free = &extra[i];
 	}
 
 	memset(ofp_ifnet_locks_shm, 0, sizeof(*ofp_ifnet_locks_shm));
@@ -1851,6 +2285,7 @@ int ofp_portconf_init_global(void)
 			return -1;
 		}
 		shm->ofp_ifnet_data[i].port = i;
+		shm->ofp_ifnet_data[i].stat_idx = i;
 		shm->ofp_ifnet_data[i].if_type = OFP_IFT_ETHER;
 		/*TODO get if_mtu from Linux/SDK*/
 		shm->ofp_ifnet_data[i].if_mtu = 1500;
@@ -1890,6 +2325,7 @@ int ofp_portconf_init_global(void)
 
 	OFP_TAILQ_INIT(&shm->in_ifaddrhead);
 	odp_rwlock_init(&ofp_ifnet_locks_shm->lock_ifaddr_list_rw);
+	odp_rwlock_init(&ofp_ifnet_locks_shm->lock_ifaddr_hash_rw);
 #ifdef INET6
 	OFP_TAILQ_INIT(&shm->in_ifaddr6head);
 	odp_rwlock_init(&ofp_ifnet_locks_shm->lock_ifaddr6_list_rw);
@@ -1912,6 +2348,17 @@ int ofp_vlan_init_global(void)
 	vlan_shm->free_ifnet_list = &(vlan_shm->vlan_ifnet[0]);
 	odp_rwlock_init(&vlan_shm->vlan_mtx);
 
+	vlan_shm->blocks = (struct vlan_block *)
+		&vlan_shm->vlan_ifnet[global_param->num_vlan];
+	vlan_shm->num_blocks = NUM_VLAN_BLOCKS;
+	vlan_shm->vlan_dir = (struct vlan_block *(*)[VLAN_DIR_SIZE])
+		&vlan_shm->blocks[vlan_shm->num_blocks];
+	vlan_shm->vlan_dir_overflow =
+		(odp_bool_t *)&vlan_shm->vlan_dir[NUM_PORTS];
+	memset(vlan_shm->vlan_dir, 0, sizeof(*vlan_shm->vlan_dir) * NUM_PORTS);
+	for (i = 0; i < NUM_PORTS; i++)
+		vlan_shm->vlan_dir_overflow[i] = !vlan_shm->num_blocks;
+
 	return 0;
 }
 
@@ -1992,18 +2439,18 @@ void ofp_ifaddr_elem_del(struct ofp_ifnet *ifnet)
 
 struct ofp_ifnet *ofp_ifaddr_elem_get(int vrf, uint8_t *addr)
 {
-	struct ofp_ifnet *ifa;
+	struct ofp_ifaddr_key key;
+	struct ofp_ifaddr_node *node = NULL;
+	uint32_t addr4;
 
-	OFP_IFNET_LOCK_WRITE(ifaddr_list);
+	memcpy(&addr4, addr, sizeof(addr4));
+	ifaddr_key_v4(&key, vrf, addr4);
 
-	OFP_TAILQ_FOREACH(ifa, ofp_get_ifaddrhead(), ia_link) {
-		if (ifa->ip_addr_info[0].ip_addr == *(uint32_t *)addr &&
-		    ifa->vrf == vrf)
-			break;
-	}
+	while ((node = ifaddr_hash_next(node, &key)))
+		if (node == &node->ifnet->ifaddr_node[0])
+			return node->ifnet;
 
-	OFP_IFNET_UNLOCK_WRITE(ifaddr_list);
-	return ifa;
+	return NULL;
 }
 
 uint32_t ofp_port_get_ipv4_addr(int port, uint16_t vlan,
@@ -2035,6 +2482,7 @@ uint32_t ofp_port_get_ipv4_addr(int port, uint16_t vlan,
 /* The dev->ip_addr_info array holds IP entries.
 	When an element is inserted it is inserted in the first entry != 0
 	When an element is deleted the last element != 0 replaces the removed element.
+	When the array is full, elements go to the dev->ip_addr_extra list.
  */
 static inline int get_first_free_ifnet_pos(struct ofp_ifnet *dev)
 {
@@ -2053,10 +2501,15 @@ inline int ofp_ifnet_ip_add(struct ofp_ifnet *dev, uint32_t addr)
 	if (odp_likely(free_idx < OFP_NUM_IFNET_IP_ADDRS))
 		dev->ip_addr_info[free_idx].ip_addr = addr;
 	else {
+		int ret = ifaddr_extra_add(dev, addr);
+
 		IP_ADDR_LIST_WUNLOCK(dev);
-		return -1;
+		if (ret)
+			OFP_ERR("Out of interface addresses, see num_ifaddr");
+		return ret;
 	}
 	IP_ADDR_LIST_WUNLOCK(dev);
+	ifaddr_hash_update(dev);
 	return 0;
 }
 
@@ -2067,7 +2520,13 @@ inline void ofp_ifnet_ip_remove(struct ofp_ifnet *dev, uint32_t addr)
 
 	IP_ADDR_LIST_WLOCK(dev);
 	i = ofp_ifnet_ip_find(dev, addr);
-	if (-1 != i) {
+	if (OFP_NUM_IFNET_IP_ADDRS == i) {
+		OFP_IFNET_LOCK_WRITE(ifaddr_hash);
+		ifaddr_extra_free(dev, ifaddr_extra_get(dev, addr));
+		OFP_IFNET_UNLOCK_WRITE(ifaddr_hash);
+		IP_ADDR_LIST_WUNLOCK(dev);
+		return;
+	} else if (-1 != i) {
 		free_idx = get_first_free_ifnet_pos(dev);
 		if (OFP_NUM_IFNET_IP_ADDRS != free_idx) {
 			free_idx--;
@@ -2082,6 +2541,7 @@ inline void ofp_ifnet_ip_remove(struct ofp_ifnet *dev, uint32_t addr)
 		}
 	}
 	IP_ADDR_LIST_WUNLOCK(dev);
+	ifaddr_hash_update(dev);
 }
 
 inline int ofp_ifnet_ip_find(struct ofp_ifnet *dev, uint32_t addr)
@@ -2091,8 +2551,25 @@ inline int ofp_ifnet_ip_find(struct ofp_ifnet *dev, uint32_t addr)
 		if (addr == dev->ip_addr_info[i].ip_addr)
 			return i;
 	}
+	if (ifaddr_extra_get(dev, addr))
+		return OFP_NUM_IFNET_IP_ADDRS;
 	return -1;
 }
+
+struct ofp_ifnet_ipaddr *ofp_ifnet_ip_get(struct ofp_ifnet *dev,
+					    uint32_t addr)
+{
+	struct ofp_ifaddr_extra *extra;
+	int i = ofp_ifnet_ip_find(dev, addr);
+
+	if (i < 0)
+		return NULL;
+	if (i < OFP_NUM_IFNET_IP_ADDRS)
+		return &dev->ip_addr_info[i];
+
+	extra = ifaddr_extra_get(dev, addr);
+	return extra ? &extra->info : NULL;
+}
 /*
  * The address is already added in the list. Move it in the first element of the list
  * and update its fields.
@@ -2111,6 +2588,21 @@ inline int ofp_set_first_ifnet_addr(struct ofp_ifnet *dev, uint32_t addr, uint32
 		dev->ip_addr_info[0].bcast_addr = bcast_addr;
 		dev->ip_addr_info[0].masklen = masklen;
 	}
+	else if (OFP_NUM_IFNET_IP_ADDRS == idx) {
+		struct ofp_ifaddr_extra *extra = ifaddr_extra_get(dev, addr);
+
+		/* The extra entry takes the first address, if any */
+		OFP_IFNET_LOCK_WRITE(ifaddr_hash);
+		if (dev->ip_addr_info[0].ip_addr)
+			extra->info = dev->ip_addr_info[0];
+		else
+			ifaddr_extra_free(dev, extra);
+		OFP_IFNET_UNLOCK_WRITE(ifaddr_hash);
+
+		dev->ip_addr_info[0].ip_addr = addr;
+		dev->ip_addr_info[0].bcast_addr = bcast_addr;
+		dev->ip_addr_info[0].masklen = masklen;
+	}
 	else {
 		dev->ip_addr_info[idx].ip_addr = dev->ip_addr_info[0].ip_addr;
 		dev->ip_addr_info[idx].bcast_addr = dev->ip_addr_info[0].bcast_addr;
@@ -2121,21 +2613,45 @@ inline int ofp_set_first_ifnet_addr(struct ofp_ifnet *dev, uint32_t addr, uint32
 		dev->ip_addr_info[0].masklen = masklen;
 	}
 	IP_ADDR_LIST_WUNLOCK(dev);
+	ifaddr_hash_update(dev);
 	return 0;
 }
 
-inline void ofp_ifnet_print_ip_addrs(struct ofp_ifnet *dev)
+/* Next address of dev after ia, or the first one if NULL */
+static struct ofp_ifnet_ipaddr *ifnet_ip_next(struct ofp_ifnet *dev,
+					      struct ofp_ifnet_ipaddr *ia)
 {
+	struct ofp_ifaddr_extra *extra;
 	int i;
 
+	if (!ia)
+		i = 0;
+	else if (ia >= dev->ip_addr_info &&
+		 ia < &dev->ip_addr_info[OFP_NUM_IFNET_IP_ADDRS])
+		i = ia - dev->ip_addr_info + 1;
+	else {
+		extra = (struct ofp_ifaddr_extra *)
+			((uint8_t *)ia - offsetof(struct ofp_ifaddr_extra, info));
+		return extra->next ? &extra->next->info : NULL;
+	}
+
+	if (i < OFP_NUM_IFNET_IP_ADDRS && dev->ip_addr_info[i].ip_addr)
+		return &dev->ip_addr_info[i];
+	return dev->ip_addr_extra ? &dev->ip_addr_extra->info : NULL;
+}
+
+inline void ofp_ifnet_print_ip_addrs(struct ofp_ifnet *dev)
+{
+	struct ofp_ifnet_ipaddr *ia = NULL;
+
 	IP_ADDR_LIST_RLOCK(dev);
-	for(i=0; i < OFP_NUM_IFNET_IP_ADDRS && dev->ip_addr_info[i].ip_addr; i++)
+	while ((ia = ifnet_ip_next(dev, ia)))
 	{
 		uint32_t mask = ~0;
-		mask = odp_cpu_to_be_32(mask << (32 - dev->ip_addr_info[i].masklen));
+		mask = odp_cpu_to_be_32(mask << (32 - ia->masklen));
 		OFP_INFO("       inet addr:%s    Bcast:%s        Mask:%s\r\n",
-				ofp_print_ip_addr(dev->ip_addr_info[i].ip_addr),
-				ofp_print_ip_addr(dev->ip_addr_info[i].bcast_addr),
+				ofp_print_ip_addr(ia->ip_addr),
+				ofp_print_ip_addr(ia->bcast_addr),
 				ofp_print_ip_addr(mask));
 	}
 	IP_ADDR_LIST_RUNLOCK(dev);
@@ -2143,12 +2659,12 @@ inline void ofp_ifnet_print_ip_addrs(struct ofp_ifnet *dev)
 
 inline int ofp_ifnet_ip_find_update_fields(struct ofp_ifnet *dev, uint32_t addr, int masklen, uint32_t bcast_addr)
 {
-	int i;
+	struct ofp_ifnet_ipaddr *ia;
 	IP_ADDR_LIST_WLOCK(dev);
-	i = ofp_ifnet_ip_find(dev, addr);
-	if (-1 != i) {
-		dev->ip_addr_info[i].masklen = masklen;
-		dev->ip_addr_info[i].bcast_addr = bcast_addr;
+	ia = ofp_ifnet_ip_get(dev, addr);
+	if (ia) {
+		ia->masklen = masklen;
+		ia->bcast_addr = bcast_addr;
 		IP_ADDR_LIST_WUNLOCK(dev);
 		return 0;
 	}
@@ -2160,30 +2676,32 @@ inline void ofp_free_ifnet_ip_list(struct ofp_ifnet *dev)
 {
 	int i;
 	uint32_t mask;
-	struct ofp_ifnet_ipaddr *ip_addr_info;
-	int size;
+	struct ofp_ifnet_ipaddr *ip_addr_info, *ia = NULL;
+	int size = 0;
 
 	IP_ADDR_LIST_RLOCK(dev);
-	size = get_first_free_ifnet_pos(dev);
+	while ((ia = ifnet_ip_next(dev, ia)))
+		size++;
 
 	ip_addr_info = malloc(size*sizeof(struct ofp_ifnet_ipaddr));
 	if (NULL == ip_addr_info) {
+		IP_ADDR_LIST_RUNLOCK(dev);
 		OFP_INFO("ofp_free_ifnet_ip_list failed");
 		return;
 	}
 	memset(ip_addr_info, 0, size*sizeof(struct ofp_ifnet_ipaddr));
 
-	for(i=0; i < OFP_NUM_IFNET_IP_ADDRS && dev->ip_addr_info[i].ip_addr; i++)
+	for (i = 0; (ia = ifnet_ip_next(dev, ia)); i++)
 	{
-		ip_addr_info[i].ip_addr = dev->ip_addr_info[i].ip_addr;
-		ip_addr_info[i].masklen = dev->ip_addr_info[i].masklen;
+		ip_addr_info[i].ip_addr = ia->ip_addr;
+		ip_addr_info[i].masklen = ia->masklen;
 	}
 	IP_ADDR_LIST_RUNLOCK(dev);
 
 	for(i=0; i < size && ip_addr_info[i].ip_addr; i++)
 	{
 		mask = ~0;
-		mask = odp_cpu_to_be_32(mask << (32 - dev->ip_addr_info[i].masklen));
+		mask = odp_cpu_to_be_32(mask << (32 - ip_addr_info[i].masklen));
 		ofp_set_route_params(OFP_ROUTE_DEL, dev->vrf, dev->vlan, dev->port,
 				ip_addr_info[i].ip_addr & mask, ip_addr_info[i].masklen, 0, 0);
 		ofp_set_route_params(OFP_ROUTE_DEL, dev->vrf, dev->vlan, dev->port,
@@ -2193,7 +2711,7 @@ inline void ofp_free_ifnet_ip_list(struct ofp_ifnet *dev)
 	free(ip_addr_info);
 
 	IP_ADDR_LIST_RLOCK(dev);
-	size = get_first_free_ifnet_pos(dev);
+	size = get_first_free_ifnet_pos(dev) || dev->ip_addr_extra;
 	IP_ADDR_LIST_RUNLOCK(dev);
 
 	if (0 != size)
@@ -2204,7 +2722,7 @@ inline void ofp_free_ifnet_ip_list(struct ofp_ifnet *dev)
 inline void ofp_ifnet_print_ip_info(int fd, struct ofp_ifnet *dev)
 {
 	char buf[16];
-	int i;
+	struct ofp_ifnet_ipaddr *ia = NULL;
 
 	if (dev->vlan)
 		snprintf(buf, sizeof(buf), ".%d", dev->vlan);
@@ -2215,14 +2733,14 @@ inline void ofp_ifnet_print_ip_info(int fd, struct ofp_ifnet *dev)
 			(dev->vlan) ? buf:"",
 			dev->if_name);
 	IP_ADDR_LIST_RLOCK(dev);
-	for(i=0; i < OFP_NUM_IFNET_IP_ADDRS && dev->ip_addr_info[i].ip_addr; i++)
+	while ((ia = ifnet_ip_next(dev, ia)))
 	{
 		uint32_t mask = ~0;
-		mask = odp_cpu_to_be_32(mask << (32 - dev->ip_addr_info[i].masklen));
+		mask = odp_cpu_to_be_32(mask << (32 - ia->masklen));
 		ofp_sendf(fd,
 				"       inet addr:%s    Bcast:%s        Mask:%s\r\n",
-				ofp_print_ip_addr(dev->ip_addr_info[i].ip_addr),
-				ofp_print_ip_addr(dev->ip_addr_info[i].bcast_addr),
+				ofp_print_ip_addr(ia->ip_addr),
+				ofp_print_ip_addr(ia->bcast_addr),
 				ofp_print_ip_addr(mask));
 	}
 	IP_ADDR_LIST_RUNLOCK(dev);
@@ -2271,16 +2789,12 @@ void ofp_ifaddr6_elem_del(struct ofp_ifnet *ifnet)
 
 struct ofp_ifnet *ofp_ifaddr6_elem_get(uint8_t *addr6)
 {
-	struct ofp_ifnet *ifa6 = NULL;
-
-	OFP_IFNET_LOCK_WRITE(ifaddr6_list);
+	struct ofp_ifaddr_key key;
+	struct ofp_ifaddr_node *node;
 
-	OFP_TAILQ_FOREACH(ifa6, ofp_get_ifaddr6head(), ia6_link) {
-		if (!memcmp(ifa6->ip6_addr, addr6, 16))
-			break;
-	}
+	ifaddr_key_v6(&key, addr6);
+	node = ifaddr_hash_next(NULL, &key);
 
-	OFP_IFNET_UNLOCK_WRITE(ifaddr6_list);
-	return ifa6;
+	return node ? node->ifnet : NULL;
 }
 #endif /* INET6 */
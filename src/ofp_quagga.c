@@ -21,7 +21,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <stdlib.h>
-#include <assert.h>
+#include <unistd.h>
 
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
@@ -32,6 +32,9 @@
 
 #include "fpm/fpm.h"
 
+#include "ofpi_init.h"
+#include "ofpi_netlink.h"
+
 typedef struct glob_t_
 {
 	int server_sock;
@@ -141,67 +144,6 @@ static int accept_conn (int listen_sock)
 
 }
 
-/*
- * read_fpm_msg
- */
-static fpm_msg_hdr_t * read_fpm_msg (char *buf, size_t buf_len)
-{
-	char *cur, *end;
-	int need_len, bytes_read, have_len;
-	fpm_msg_hdr_t *hdr;
-	int reading_full_msg;
-
-	end = buf + buf_len;
-	cur = buf;
-	hdr = (fpm_msg_hdr_t *) buf;
-
-	while (1) {
-		reading_full_msg = 0;
-
-		have_len = cur - buf;
-
-		if (have_len < FPM_MSG_HDR_LEN) {
-			need_len = FPM_MSG_HDR_LEN - have_len;
-		} else {
-			need_len = fpm_msg_len(hdr) - have_len;
-			assert(need_len >= 0 && need_len < (end - cur));
-
-			if (!need_len)
-				return hdr;
-
-			reading_full_msg = 1;
-		}
-
-		trace(3, "Looking to read %d bytes", need_len);
-		bytes_read = read(glob->sock, cur, need_len);
-
-		if (bytes_read <= 0) {
-			err_msg("Error reading from socket: %s", strerror(errno));
-			return NULL;
-		}
-
-		trace(3, "Read %d bytes", bytes_read);
-		cur += bytes_read;
-
-		if (bytes_read < need_len) {
-			continue;
-		}
-
-		assert(bytes_read == need_len);
-
-		if (reading_full_msg)
-			return hdr;
-
-		if (!fpm_msg_ok(hdr, buf_len))
-		{
-			assert(0);
-			err_msg("Malformed fpm message");
-			return NULL;
-		}
-	}
-
-}
-
 /*
  * netlink_msg_type_to_s
  */
@@ -527,7 +469,7 @@ static void print_netlink_msg_ctx (netlink_msg_ctx_t *ctx)
 	char buf[1024];
 
 	netlink_msg_ctx_snprint(ctx, buf, sizeof(buf));
-	log(0, "%s\n", buf);
+	log(2, "%s\n", buf);
 }
 
 /*
@@ -546,27 +488,31 @@ static void parse_netlink_msg (char *buf, size_t buf_len)
 	len = buf_len;
 	for (; NLMSG_OK (hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
 
-		netlink_msg_ctx_init(ctx);
-		ctx->hdr = (struct nlmsghdr *) buf;
-
 		switch (hdr->nlmsg_type) {
 
 		case RTM_DELROUTE:
 		case RTM_NEWROUTE:
 
-			parse_route_msg(ctx);
-			if (ctx->err_msg) {
-				err_msg("Error parsing route message: %s", ctx->err_msg);
+			/* Formatting is costly on a full table push */
+			if (log_level >= 2) {
+				netlink_msg_ctx_init(ctx);
+				ctx->hdr = hdr;
+				parse_route_msg(ctx);
+				if (ctx->err_msg) {
+					err_msg("Error parsing route message: %s",
+						ctx->err_msg);
+				} else {
+					print_netlink_msg_ctx(ctx);
+				}
+				netlink_msg_ctx_cleanup(ctx);
 			}
 
-			print_netlink_msg_ctx(ctx);
+			ofp_netlink_route_add(hdr, 0);
 			break;
 
 		default:
 			trace(1, "Ignoring unknown netlink message - Type: %d", hdr->nlmsg_type);
 		}
-
-		netlink_msg_ctx_cleanup(ctx);
 	}
 }
 
@@ -575,7 +521,7 @@ static void parse_netlink_msg (char *buf, size_t buf_len)
  */
 static void process_fpm_msg (fpm_msg_hdr_t *hdr)
 {
-	trace(1, "FPM message - Type: %d, Length %d", hdr->msg_type,
+	trace(3, "FPM message - Type: %d, Length %d", hdr->msg_type,
 	      odp_be_to_cpu_16(hdr->msg_len));
 
 	if (hdr->msg_type != FPM_MSG_TYPE_NETLINK) {
@@ -586,31 +532,85 @@ static void process_fpm_msg (fpm_msg_hdr_t *hdr)
 	parse_netlink_msg (fpm_msg_data (hdr), fpm_msg_data_len (hdr));
 }
 
+#define FPM_BUF_LEN (256 * FPM_MAX_MSG_LEN)
+
+static char fpm_buf[FPM_BUF_LEN];
+
 /*
  * fpm_serve
+ *
+ * Read as much as the socket has into a large buffer and process the
+ * complete messages in place. A partial message is moved to the start
+ * of the buffer for the next read. The routes are applied in bulk when
+ * the socket has been drained.
  */
-static void fpm_serve ()
+static void fpm_serve (void)
 {
-	char buf[FPM_MAX_MSG_LEN];
 	fpm_msg_hdr_t *hdr;
+	size_t have = 0, off;
+	int pending = 0;
+	ssize_t bytes_read;
 
 	while (1) {
+		bytes_read = recv(glob->sock, fpm_buf + have,
+				  sizeof(fpm_buf) - have,
+				  pending ? MSG_DONTWAIT : 0);
+		if (bytes_read < 0 && pending &&
+		    (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (ofp_netlink_route_flush())
+				err_msg("Some fpm routes were not applied");
+			pending = 0;
+			continue;
+		}
+		if (bytes_read <= 0) {
+			if (bytes_read < 0) {
+				err_msg("Error reading from socket: %s",
+					strerror(errno));
+			}
+			break;
+		}
+
+		trace(3, "Read %zd bytes", bytes_read);
+		have += bytes_read;
+
+		for (off = 0; have - off >= FPM_MSG_HDR_LEN;
+		     off += fpm_msg_len(hdr)) {
+			hdr = (fpm_msg_hdr_t *) (fpm_buf + off);
+			if (!fpm_msg_hdr_ok(hdr)) {
+				err_msg("Malformed fpm message");
+				goto out;
+			}
+			if (fpm_msg_len(hdr) > have - off)
+				break;
 
-		hdr = read_fpm_msg(buf, sizeof(buf));
-		if (!hdr) {
-			return;
+			process_fpm_msg(hdr);
+			pending = 1;
 		}
 
-		process_fpm_msg(hdr);
+		have -= off;
+		memmove(fpm_buf, fpm_buf + off, have);
 	}
+
+out:
+	if (ofp_netlink_route_flush())
+		err_msg("Some fpm routes were not applied");
 }
 
 int start_quagga_nl_server(void *arg)
 {
 	int sock;
 
+	(void)arg;
+
 	memset(glob, 0, sizeof(*glob));
 
+	/* Lookup shared memories */
+	if (ofp_init_local()) {
+		err_msg("OFP local init failed.");
+		return -1;
+	}
+	ofp_netlink_route_init();
+
 	if (!create_listen_sock(FPM_DEFAULT_PORT, &glob->server_sock)) {
 		err_msg("Failed to create quagga listening socket.");
 		return -1;
@@ -622,6 +622,7 @@ int start_quagga_nl_server(void *arg)
 	while (1) {
 		glob->sock = accept_conn(glob->server_sock);
 		fpm_serve();
+		close(glob->sock);
 		trace(1, "Done serving client");
 	}
 
@@ -0,0 +1,181 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_rcu.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+
+#define SHM_NAME_RCU "OfpRcuShMem"
+
+/*
+ * Value of a quiescent state slot of a thread that is not registered
+ * or is offline, i.e. does not hold references to protected data.
+ */
+#define RCU_OFFLINE 0
+
+struct ofp_rcu_thread {
+	odp_atomic_u64_t qs;
+} ODP_ALIGNED_CACHE;
+
+/*
+ * Shared data
+ */
+struct ofp_rcu_mem {
+	odp_atomic_u64_t epoch ODP_ALIGNED_CACHE;
+	struct ofp_rcu_thread thr[ODP_THREAD_COUNT_MAX];
+};
+
+/*
+ * Data per thread
+ */
+static __thread struct ofp_rcu_mem *shm;
+static __thread struct ofp_rcu_thread *self;
+__thread odp_bool_t ofp_rcu_thread_registered;
+
+void ofp_rcu_thread_register(void)
+{
+	self = &shm->thr[odp_thread_id()];
+	ofp_rcu_thread_registered = 1;
+	ofp_rcu_thread_online();
+}
+
+void ofp_rcu_thread_unregister(void)
+{
+	if (!ofp_rcu_thread_registered)
+		return;
+
+	ofp_rcu_thread_offline();
+	ofp_rcu_thread_registered = 0;
+	self = NULL;
+}
+
+void ofp_rcu_quiescent(void)
+{
+	if (odp_unlikely(!self))
+		return;
+
+	/* Reads of protected data done so far are complete */
+	odp_atomic_store_rel_u64(&self->qs, odp_atomic_load_u64(&shm->epoch));
+}
+
+void ofp_rcu_thread_offline(void)
+{
+	if (odp_unlikely(!self))
+		return;
+
+	odp_atomic_store_rel_u64(&self->qs, RCU_OFFLINE);
+}
+
+void ofp_rcu_thread_online(void)
+{
+	if (odp_unlikely(!self))
+		return;
+
+	odp_atomic_store_u64(&self->qs, odp_atomic_load_u64(&shm->epoch));
+	/* Publish the slot before reading any protected data */
+	odp_mb_full();
+}
+
+uint64_t ofp_rcu_epoch(void)
+{
+	return odp_atomic_load_u64(&shm->epoch);
+}
+
+void ofp_rcu_advance(void)
+{
+	/* Unlinking is visible before the epoch changes */
+	odp_mb_full();
+	odp_atomic_inc_u64(&shm->epoch);
+}
+
+odp_bool_t ofp_rcu_is_safe(uint64_t epoch)
+{
+	uint64_t qs;
+	int i;
+
+	/*
+	 * Memory tagged with an epoch is no longer referenced when
+	 * every online thread has passed a quiescent state after the
+	 * epoch was advanced.
+	 */
+	odp_mb_full();
+	for (i = 0; i < ODP_THREAD_COUNT_MAX; i++) {
+		qs = odp_atomic_load_acq_u64(&shm->thr[i].qs);
+		if (qs != RCU_OFFLINE && qs <= epoch)
+			return 0;
+	}
+
+	return 1;
+}
+
+static int ofp_rcu_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_RCU, sizeof(*shm));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_rcu_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_RCU) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_rcu_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_RCU);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_rcu_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_RCU, sizeof(*shm));
+}
+
+int ofp_rcu_init_global(void)
+{
+	int i;
+
+	HANDLE_ERROR(ofp_rcu_alloc_shared_memory());
+
+	memset(shm, 0, sizeof(*shm));
+	/* Epoch values start from 1, 0 marks an offline thread */
+	odp_atomic_init_u64(&shm->epoch, RCU_OFFLINE + 1);
+	for (i = 0; i < ODP_THREAD_COUNT_MAX; i++)
+		odp_atomic_init_u64(&shm->thr[i].qs, RCU_OFFLINE);
+
+	return 0;
+}
+
+int ofp_rcu_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_rcu_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_rcu_free_shared_memory(), rc);
+
+	return rc;
+}
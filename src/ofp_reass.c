@@ -46,6 +46,7 @@
 #include "ofpi_arp.h"
 #include "ofpi_hook.h"
 #include "ofpi_log.h"
+#include "ofpi_lockstat.h"
 #include "ofpi_socketvar.h"
 #include "ofpi_queue.h"
 #include "ofpi_reass.h"
@@ -58,6 +59,11 @@
 #define	IPREASS_HASH(x,y) \
 	(((((x) & 0xF) | ((((x) >> 8) & 0xF) << 4)) ^ (y)) & IPREASS_HMASK)
 
+#define NUM_TABLES (global_param->reass.per_thread ? ODP_THREAD_COUNT_MAX : 1)
+#define NUM_BUCKETS (NUM_TABLES * IPREASS_NHASH)
+#define SHM_SIZE_REASSEMBLY (sizeof(*shm) + \
+			     sizeof(struct reass_bucket) * NUM_BUCKETS)
+
 /*
  * Chain is an IP fragment queue. Chains are linked together via the first
  * packet. Packet headroom is used to save pointer information.
@@ -80,12 +86,24 @@ struct frag {
 	uint8_t         ipq_ttl;
 };
 
+/*
+ * Fragment queues of a hash bucket. There is one table of
+ * IPREASS_NHASH buckets, or one per thread with reass.per_thread.
+ */
+struct reass_bucket {
+	struct frag *ipq;
+	odp_spinlock_t lock;
+} ODP_ALIGNED_CACHE;
+
 struct ofp_reassembly_mem {
-	int maxnipq, nipq;
+	odp_atomic_u32_t nipq;
+	int maxnipq;
 	int maxfragsperpacket;
-	struct frag *ipq[IPREASS_NHASH];
-	odp_spinlock_t ipqlock;
+	odp_bool_t per_thread;
+	int num_buckets;
+	odp_atomic_u32_t timer_started;
 	odp_timer_t timer;
+	struct reass_bucket bucket[];
 };
 
 static struct ofp_reassembly_mem *shm;
@@ -104,7 +122,7 @@ static inline struct ofp_ip *FRAG_IP(struct frag *f)
 
 static int ofp_reassembly_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_REASSEMBLY, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_REASSEMBLY, SHM_SIZE_REASSEMBLY);
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -137,18 +155,25 @@ int ofp_reassembly_lookup_shared_memory(void)
 
 void ofp_reassembly_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_REASSEMBLY, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_REASSEMBLY, SHM_SIZE_REASSEMBLY);
 }
 
 int ofp_reassembly_init_global(void)
 {
+	int i;
+
 	HANDLE_ERROR(ofp_reassembly_alloc_shared_memory());
 
-	memset(shm, 0, sizeof(*shm));
-	shm->maxnipq = 1024;
-	shm->maxfragsperpacket = 16;
+	memset(shm, 0, SHM_SIZE_REASSEMBLY);
+	odp_atomic_init_u32(&shm->nipq, 0);
+	shm->maxnipq = global_param->reass.max_queues;
+	shm->maxfragsperpacket = global_param->reass.max_frags;
+	shm->per_thread = global_param->reass.per_thread;
+	shm->num_buckets = NUM_BUCKETS;
+	odp_atomic_init_u32(&shm->timer_started, 0);
 	shm->timer = ODP_TIMER_INVALID;
-	odp_spinlock_init(&shm->ipqlock);
+	for (i = 0; i < shm->num_buckets; i++)
+		odp_spinlock_init(&shm->bucket[i].lock);
 
 	return 0;
 }
@@ -168,8 +193,8 @@ int ofp_reassembly_term_global(void)
 		shm->timer = ODP_TIMER_INVALID;
 	}
 
-	for (i = 0; i < IPREASS_NHASH; i++) {
-		chain = shm->ipq[i];
+	for (i = 0; i < shm->num_buckets; i++) {
+		chain = shm->bucket[i].ipq;
 		while (chain) {
 			next = NEXT_CHAIN(chain);
 
@@ -181,7 +206,7 @@ int ofp_reassembly_term_global(void)
 
 			chain = next;
 		}
-		shm->ipq[i] = NULL;
+		shm->bucket[i].ipq = NULL;
 	}
 
 	CHECK_ERROR(ofp_reassembly_free_shared_memory(), rc);
@@ -198,21 +223,24 @@ odp_packet_t ofp_ip_reass(odp_packet_t pkt)
         uint8_t ttl = pkt_ip->ip_ttl;
 	uint16_t hash;
 	odp_packet_t ret;
+	struct reass_bucket *bucket;
 	struct frag **head, *chain = NULL, *frag, *pkt_p, *last,
 		*c1 = NULL, *c2 = NULL;
+	uint32_t started = 0;
 
-	if (shm->timer == ODP_TIMER_INVALID)
+	if (odp_unlikely(odp_atomic_load_u32(&shm->timer_started) == 0) &&
+	    odp_atomic_cas_u32(&shm->timer_started, &started, 1))
 		shm->timer = ofp_timer_start(1000000, slow_tmo, NULL, 0);
 
-	if (shm->nipq > shm->maxnipq)
-		goto dropfrag;
-
 	/* To host byte order */
 	pkt_ip->ip_len = odp_be_to_cpu_16(pkt_ip->ip_len);
 	pkt_ip->ip_off = odp_be_to_cpu_16(pkt_ip->ip_off);
 	hash = IPREASS_HASH(pkt_ip->ip_src.s_addr, pkt_ip->ip_id);
-	head = &shm->ipq[hash];
-	odp_spinlock_lock(&shm->ipqlock);
+	bucket = &shm->bucket[hash];
+	if (shm->per_thread)
+		bucket += odp_thread_id() * IPREASS_NHASH;
+	head = &bucket->ipq;
+	ofp_spinlock_lock(&bucket->lock);
 
 	/*
 	 * Make space for frag header.
@@ -250,11 +278,11 @@ odp_packet_t ofp_ip_reass(odp_packet_t pkt)
 	chain = NULL;
 
 	/*
-	 * Attempt to trim the number of allocated fragment queues if it
-	 * exceeds the administrative limit.
+	 * New datagrams are not accepted when the number of fragment
+	 * queues is at the administrative limit.
 	 */
-	if ((shm->nipq > shm->maxnipq) && (shm->maxnipq > 0)) {
-	}
+	if ((int)odp_atomic_load_u32(&shm->nipq) >= shm->maxnipq)
+		goto dropfrag;
 
 found:
 	/*
@@ -277,7 +305,7 @@ found:
 	 * If first fragment to arrive, create a reassembly queue.
 	 */
 	if (chain == NULL) {
-		shm->nipq++;
+		odp_atomic_inc_u32(&shm->nipq);
 		pkt_p->ipq_ttl = ttl < 15 ? 15 : ttl;
 		SET_NEXT_CHAIN(pkt_p, *head);
 		*head = pkt_p;
@@ -421,7 +449,7 @@ found:
 	else
 		*head = c2;
 
-	shm->nipq--;
+	odp_atomic_dec_u32(&shm->nipq);
 	frag = NEXT_FRAG(chain);
 	chain_ip = FRAG_IP(chain);
 	ret = chain->pkt;
@@ -429,18 +457,37 @@ found:
 	int len = (chain_ip->ip_hl << 2) + chain_ip->ip_len;
 	int nextoff = odp_packet_l3_offset(ret) + len;
 
+	/* Link padding past the first fragment would end up in the middle */
+	if (odp_packet_len(ret) > (uint32_t)nextoff)
+		odp_packet_trunc_tail(&ret, odp_packet_len(ret) - nextoff,
+				      NULL, NULL);
+
 	while (frag) {
 		frag_ip = FRAG_IP(frag);
 		int fraghlen = frag_ip->ip_hl<<2;
 		int fraglen = frag_ip->ip_len;
-		odp_packet_add_data(&ret, nextoff, fraglen);
-		odp_packet_copy_from_mem(ret, nextoff, fraglen,
-				       (char *)(frag_ip) + fraghlen);
-		nextoff += fraglen;
-		len += fraglen;
+		/* Only the headers of a fragment are contiguous */
+		uint32_t dataoff = (uint8_t *)frag_ip + fraghlen -
+			(uint8_t *)odp_packet_data(frag->pkt);
 		odp_packet_t tmp = frag->pkt;
+
 		frag = NEXT_FRAG(frag);
-		odp_packet_free(tmp);
+
+		/*
+		 * The payload is linked as the next segments of the
+		 * datagram without a copy, or copied if ODP cannot link it
+		 */
+		odp_packet_pull_head(tmp, dataoff);
+		if (odp_packet_len(tmp) > (uint32_t)fraglen)
+			odp_packet_trunc_tail(&tmp, odp_packet_len(tmp) - fraglen,
+					      NULL, NULL);
+		if (odp_packet_concat(&ret, tmp) < 0) {
+			odp_packet_add_data(&ret, nextoff, fraglen);
+			odp_packet_copy_from_pkt(ret, nextoff, tmp, 0, fraglen);
+			odp_packet_free(tmp);
+		}
+		nextoff += fraglen;
+		len += fraglen;
 	}
 
 	chain_ip = odp_packet_l3_ptr(ret, NULL);
@@ -448,7 +495,7 @@ found:
 	chain_ip->ip_off = 0;
 	chain_ip->ip_len = odp_cpu_to_be_16(len);
 	chain_ip->ip_sum = ofp_cksum_iph(chain_ip, chain_ip->ip_hl);
-	odp_spinlock_unlock(&shm->ipqlock);
+	odp_spinlock_unlock(&bucket->lock);
 	return ret;
 
 dropfrag:
@@ -456,7 +503,7 @@ dropfrag:
 		chain->nfrags--;
 	odp_packet_free(pkt);
 done:
-	odp_spinlock_unlock(&shm->ipqlock);
+	odp_spinlock_unlock(&bucket->lock);
 	return ODP_PACKET_INVALID;
 }
 
@@ -485,6 +532,8 @@ ip_freef(struct frag **head, struct frag *chain)
 		}
 	}
 
+	odp_atomic_dec_u32(&shm->nipq);
+
 	while (chain) {
 		odp_packet_t tmp = chain->pkt;
 		chain = NEXT_FRAG(chain);
@@ -495,21 +544,26 @@ ip_freef(struct frag **head, struct frag *chain)
 static void slow_tmo(void *arg)
 {
 	int i;
+	struct reass_bucket *bucket;
 	struct frag *chain, *frag, *prev, *next;
 	(void)arg;
 
-	odp_spinlock_lock(&shm->ipqlock);
+	for (i = 0; i < shm->num_buckets; i++) {
+		bucket = &shm->bucket[i];
+		if (!bucket->ipq)
+			continue;
 
-	for (i = 0; i < IPREASS_NHASH; i++) {
+		ofp_spinlock_lock(&bucket->lock);
 		prev = NULL;
-		chain = shm->ipq[i];
+		chain = bucket->ipq;
 		while (chain) {
 			next = NEXT_CHAIN(chain);
 			if (! --chain->ipq_ttl) {
 				if (!prev)
-					shm->ipq[i] = next;
+					bucket->ipq = next;
 				else
 					SET_NEXT_CHAIN(prev, next);
+				odp_atomic_dec_u32(&shm->nipq);
 				frag = chain;
 
 				odp_packet_pull_head(frag->pkt, sizeof(struct frag));
@@ -525,9 +579,9 @@ static void slow_tmo(void *arg)
 				prev = chain;
 			chain = next;
 		}
+		odp_spinlock_unlock(&bucket->lock);
 	}
 
-	odp_spinlock_unlock(&shm->ipqlock);
 	shm->timer = ofp_timer_start(1000000, slow_tmo, NULL, 0);
 }
 
@@ -540,8 +594,8 @@ void ofp_print_reass_queue(void)
 	struct ofp_ip *frag_ip, *chain_ip;
 
 	OFP_LOG_NO_CTX_NO_LEVEL("\nREASS QUEUES:\n");
-	for (i = 0; i < IPREASS_NHASH; i++) {
-		chain = shm->ipq[i];
+	for (i = 0; i < shm->num_buckets; i++) {
+		chain = shm->bucket[i].ipq;
 		while (chain) {
 			chain_ip = FRAG_IP(chain);
 			OFP_LOG_NO_CTX_NO_LEVEL(
@@ -0,0 +1,525 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * IPv6 fragment reassembly.
+ *
+ * Fragment queues are kept in hash buckets with a lock each, as in
+ * ofp_reass.c, and in a table per thread with reass.per_thread. The
+ * fragment data is kept in the packet headroom. Overlapping fragments
+ * discard the whole datagram (RFC 5722).
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_pkt_processing.h"
+#include "ofpi_in.h"
+#include "ofpi_ip6.h"
+#include "ofpi_icmp6.h"
+#include "ofpi_stat.h"
+#include "ofpi_lockstat.h"
+#include "ofpi_timer.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+#include "ofpi_reass.h"
+
+#define SHM_NAME_REASSEMBLY6 "OfpIp6ReassShMem"
+
+#define IP6REASS_NHASH_LOG2	6
+#define IP6REASS_NHASH		(1 << IP6REASS_NHASH_LOG2)
+#define IP6REASS_HASH(src, dst, id) \
+	((((src) ^ (dst) ^ (id)) * 0x9e3779b1) >> (32 - IP6REASS_NHASH_LOG2))
+
+#define NUM_TABLES (global_param->reass.per_thread ? ODP_THREAD_COUNT_MAX : 1)
+#define NUM_BUCKETS (NUM_TABLES * IP6REASS_NHASH)
+#define SHM_SIZE_REASSEMBLY6 (sizeof(*shm) + \
+			      sizeof(struct reass6_bucket) * NUM_BUCKETS)
+
+/*
+ * A fragment queue is a list of fragments in offset order, linked to
+ * the other queues of the bucket via the first fragment.
+ */
+struct frag6 {
+	struct frag6	*next_chain;
+	struct frag6	*next_frag;
+	odp_packet_t	pkt;
+	uint32_t	ident;
+	uint16_t	off;		/* Offset of the fragment data */
+	uint16_t	len;		/* Length of the fragment data */
+	uint16_t	unfrag_len;	/* Offset of the fragment header */
+	uint16_t	nfrags;
+	uint8_t		nxt;
+	uint8_t		more;
+	uint8_t		ttl;
+};
+
+struct reass6_bucket {
+	struct frag6 *ipq;
+	odp_spinlock_t lock;
+} ODP_ALIGNED_CACHE;
+
+struct ofp_reassembly6_mem {
+	odp_atomic_u32_t nipq;
+	int maxnipq;
+	int maxfragsperpacket;
+	odp_bool_t per_thread;
+	int num_buckets;
+	odp_atomic_u32_t timer_started;
+	odp_timer_t timer;
+	struct reass6_bucket bucket[];
+};
+
+static struct ofp_reassembly6_mem *shm;
+
+static void slow_tmo6(void *arg);
+
+static inline struct ofp_ip6_hdr *FRAG6_IP(struct frag6 *f)
+{
+	/* Packet is pulled for frag6 struct */
+	char *l3 = odp_packet_l3_ptr(f->pkt, NULL);
+
+	return (struct ofp_ip6_hdr *)(l3 + sizeof(struct frag6));
+}
+
+/* Free all fragments of a queue that is not in a bucket anymore */
+static void frag6_free_chain(struct frag6 *chain)
+{
+	odp_packet_t pkt;
+
+	while (chain) {
+		pkt = chain->pkt;
+		chain = chain->next_frag;
+		odp_packet_free(pkt);
+	}
+}
+
+static void frag6_unlink(struct reass6_bucket *bucket, struct frag6 *prev,
+			 struct frag6 *chain)
+{
+	if (prev)
+		prev->next_chain = chain->next_chain;
+	else
+		bucket->ipq = chain->next_chain;
+	odp_atomic_dec_u32(&shm->nipq);
+}
+
+/* Next header field that refers to the header at offset off */
+static uint8_t *frag6_prev_nxt(struct ofp_ip6_hdr *ip6, int off)
+{
+	uint8_t *nxt = &ip6->ofp_ip6_nxt;
+	uint8_t *ext;
+	int cur = sizeof(*ip6);
+
+	while (cur < off) {
+		ext = (uint8_t *)ip6 + cur;
+		nxt = &ext[0];
+		cur += (ext[1] + 1) << 3;
+	}
+
+	return nxt;
+}
+
+/*
+ * Remove the fragment header at offset off of the L3 header. The
+ * headers before it are moved over it.
+ */
+static int frag6_strip(odp_packet_t pkt, int off, uint8_t nxt,
+		       uint16_t plen)
+{
+	struct ofp_ip6_hdr *ip6 = odp_packet_l3_ptr(pkt, NULL);
+	uint32_t hlen = odp_packet_l3_offset(pkt) + off;
+	uint8_t *start = odp_packet_data(pkt);
+
+	if (odp_packet_seg_len(pkt) < hlen + sizeof(struct ofp_ip6_frag))
+		return -1;
+
+	*frag6_prev_nxt(ip6, off) = nxt;
+	ip6->ofp_ip6_plen = odp_cpu_to_be_16(plen);
+
+	memmove(start + sizeof(struct ofp_ip6_frag), start, hlen);
+	if (!odp_packet_pull_head(pkt, sizeof(struct ofp_ip6_frag)))
+		return -1;
+
+	return 0;
+}
+
+/* Build the datagram of a complete fragment queue */
+static odp_packet_t frag6_join(struct frag6 *chain)
+{
+	struct frag6 *frag = chain->next_frag;
+	odp_packet_t ret = chain->pkt;
+	uint16_t unfrag_len = chain->unfrag_len;
+	uint8_t nxt = chain->nxt;
+	uint32_t len = chain->len;
+	uint32_t nextoff;
+	odp_packet_t tmp;
+	char *data;
+
+	odp_packet_pull_head(ret, sizeof(struct frag6));
+
+	/* Drop link layer padding */
+	nextoff = odp_packet_l3_offset(ret) + unfrag_len +
+		sizeof(struct ofp_ip6_frag) + len;
+	if (odp_packet_len(ret) > nextoff)
+		odp_packet_pull_tail(ret, odp_packet_len(ret) - nextoff);
+
+	while (frag) {
+		struct frag6 *next = frag->next_frag;
+		uint32_t fraglen = frag->len;
+
+		data = (char *)FRAG6_IP(frag) + frag->unfrag_len +
+			sizeof(struct ofp_ip6_frag);
+		/* Only the headers of a fragment are contiguous */
+		tmp = frag->pkt;
+		odp_packet_pull_head(tmp, data - (char *)odp_packet_data(tmp));
+
+		/* Linked as the next segments, copied if it cannot be */
+		if (odp_packet_len(tmp) > fraglen)
+			odp_packet_trunc_tail(&tmp, odp_packet_len(tmp) - fraglen,
+					      NULL, NULL);
+		frag->pkt = tmp;
+		if (odp_packet_concat(&ret, tmp) < 0) {
+			if (odp_packet_add_data(&ret, nextoff, fraglen) < 0 ||
+			    odp_packet_copy_from_pkt(ret, nextoff, tmp, 0,
+						     fraglen)) {
+				frag6_free_chain(frag);
+				odp_packet_free(ret);
+				return ODP_PACKET_INVALID;
+			}
+			odp_packet_free(tmp);
+		}
+		nextoff += fraglen;
+		len += fraglen;
+		/* frag was in the headroom of the linked packet */
+		frag = next;
+	}
+
+	if (frag6_strip(ret, unfrag_len, nxt,
+			unfrag_len - sizeof(struct ofp_ip6_hdr) + len)) {
+		odp_packet_free(ret);
+		return ODP_PACKET_INVALID;
+	}
+
+	return ret;
+}
+
+enum ofp_return_code ofp_frag6_input(odp_packet_t *pkt, int *offp, int *nxt)
+{
+	struct ofp_ip6_hdr *ip6 = odp_packet_l3_ptr(*pkt, NULL);
+	struct ofp_ip6_frag *fh;
+	struct ofp_ip6_hdr *chain_ip6;
+	struct reass6_bucket *bucket;
+	struct frag6 *chain, *c1 = NULL, *frag, *prev, *next, *pkt_p;
+	uint32_t started = 0;
+	uint32_t hash, expect;
+	int off = *offp;
+	int plen, frag_len, frag_off;
+	uint16_t unfrag_len;
+	uint8_t frag_nxt;
+	odp_packet_t ret;
+
+	OFP_UPDATE_PACKET_STAT(rx_ip_frag, 1);
+
+	plen = odp_be_to_cpu_16(ip6->ofp_ip6_plen);
+	if ((int)sizeof(*ip6) + plen < off + (int)sizeof(*fh) ||
+	    odp_packet_l3_offset(*pkt) + sizeof(*ip6) + plen >
+	    odp_packet_len(*pkt)) {
+		*nxt = OFP_IPPROTO_DONE;
+		return OFP_PKT_DROP;
+	}
+
+	fh = (struct ofp_ip6_frag *)((uint8_t *)ip6 + off);
+	frag_len = sizeof(*ip6) + plen - off - sizeof(*fh);
+	frag_off = odp_be_to_cpu_16(fh->ip6f_offlg & OFP_IP6F_OFF_MASK);
+
+	/* Fragments but the last have a length that is a multiple of 8 */
+	if ((fh->ip6f_offlg & OFP_IP6F_MORE_FRAG) &&
+	    (frag_len == 0 || (frag_len & 0x7))) {
+		ofp_icmp6_error(*pkt, OFP_ICMP6_PARAM_PROB,
+				OFP_ICMP6_PARAMPROB_HEADER,
+				offsetof(struct ofp_ip6_hdr, ofp_ip6_plen));
+		*nxt = OFP_IPPROTO_DONE;
+		return OFP_PKT_PROCESSED;
+	}
+
+	if (frag_off + frag_len > OFP_IPV6_MAXPACKET) {
+		ofp_icmp6_error(*pkt, OFP_ICMP6_PARAM_PROB,
+				OFP_ICMP6_PARAMPROB_HEADER,
+				off + offsetof(struct ofp_ip6_frag,
+					       ip6f_offlg));
+		*nxt = OFP_IPPROTO_DONE;
+		return OFP_PKT_PROCESSED;
+	}
+
+	/* Atomic fragment (RFC 6946) */
+	if (frag_off == 0 && !(fh->ip6f_offlg & OFP_IP6F_MORE_FRAG)) {
+		*nxt = fh->ip6f_nxt;
+		if (frag6_strip(*pkt, off, fh->ip6f_nxt, plen - sizeof(*fh))) {
+			*nxt = OFP_IPPROTO_DONE;
+			return OFP_PKT_DROP;
+		}
+		OFP_UPDATE_PACKET_STAT(rx_ip_reass, 1);
+		return OFP_PKT_CONTINUE;
+	}
+
+	if (odp_unlikely(odp_atomic_load_u32(&shm->timer_started) == 0) &&
+	    odp_atomic_cas_u32(&shm->timer_started, &started, 1))
+		shm->timer = ofp_timer_start(1000000, slow_tmo6, NULL, 0);
+
+	/* The IPv6 header stays in place, frag6 goes to the headroom */
+	pkt_p = odp_packet_push_head(*pkt, sizeof(struct frag6));
+	if (!pkt_p) {
+		*nxt = OFP_IPPROTO_DONE;
+		return OFP_PKT_DROP;
+	}
+
+	pkt_p->next_chain = NULL;
+	pkt_p->next_frag = NULL;
+	pkt_p->pkt = *pkt;
+	pkt_p->ident = fh->ip6f_ident;
+	pkt_p->off = frag_off;
+	pkt_p->len = frag_len;
+	pkt_p->unfrag_len = off;
+	pkt_p->nxt = fh->ip6f_nxt;
+	pkt_p->more = !!(fh->ip6f_offlg & OFP_IP6F_MORE_FRAG);
+	pkt_p->nfrags = 1;
+	pkt_p->ttl = IP6REASS_TTL;
+
+	*nxt = OFP_IPPROTO_DONE;
+
+	hash = IP6REASS_HASH(ip6->ip6_src.ofp_s6_addr32[3],
+			     ip6->ip6_dst.ofp_s6_addr32[3], fh->ip6f_ident);
+	bucket = &shm->bucket[hash];
+	if (shm->per_thread)
+		bucket += odp_thread_id() * IP6REASS_NHASH;
+
+	ofp_spinlock_lock(&bucket->lock);
+
+	for (chain = bucket->ipq; chain; c1 = chain, chain = chain->next_chain) {
+		chain_ip6 = FRAG6_IP(chain);
+		if (chain->ident == pkt_p->ident &&
+		    !memcmp(&chain_ip6->ip6_src, &ip6->ip6_src,
+			    2 * sizeof(struct ofp_in6_addr)))
+			break;
+	}
+
+	/* First fragment to arrive creates a reassembly queue */
+	if (!chain) {
+		if ((int)odp_atomic_load_u32(&shm->nipq) >= shm->maxnipq)
+			goto dropfrag;
+		odp_atomic_inc_u32(&shm->nipq);
+		pkt_p->next_chain = bucket->ipq;
+		bucket->ipq = pkt_p;
+		goto done;
+	}
+
+	/* Find the place of the fragment, overlaps drop the datagram */
+	prev = NULL;
+	for (next = chain; next && next->off < pkt_p->off;
+	     next = next->next_frag)
+		prev = next;
+
+	if ((prev && prev->off + prev->len > pkt_p->off) ||
+	    (next && pkt_p->off + pkt_p->len > next->off) ||
+	    (next && next->off == pkt_p->off)) {
+		frag6_unlink(bucket, c1, chain);
+		frag6_free_chain(chain);
+		goto dropfrag;
+	}
+
+	pkt_p->next_frag = next;
+	if (prev) {
+		prev->next_frag = pkt_p;
+		chain->nfrags++;
+	} else {
+		/* New first fragment holds the queue */
+		pkt_p->next_chain = chain->next_chain;
+		pkt_p->nfrags = chain->nfrags + 1;
+		pkt_p->ttl = chain->ttl;
+		if (c1)
+			c1->next_chain = pkt_p;
+		else
+			bucket->ipq = pkt_p;
+		chain = pkt_p;
+	}
+
+	/* Check for complete reassembly */
+	expect = 0;
+	for (frag = chain; frag; frag = frag->next_frag) {
+		if (frag->off != expect)
+			break;
+		expect += frag->len;
+		prev = frag;
+	}
+
+	if (frag || prev->more) {
+		if (chain->nfrags > shm->maxfragsperpacket) {
+			frag6_unlink(bucket, c1, chain);
+			frag6_free_chain(chain);
+		}
+		goto done;
+	}
+
+	frag6_unlink(bucket, c1, chain);
+	odp_spinlock_unlock(&bucket->lock);
+
+	unfrag_len = chain->unfrag_len;
+	frag_nxt = chain->nxt;
+	ret = frag6_join(chain);
+	if (ret == ODP_PACKET_INVALID)
+		return OFP_PKT_PROCESSED;
+
+	OFP_UPDATE_PACKET_STAT(rx_ip_reass, 1);
+
+	*pkt = ret;
+	*offp = unfrag_len;
+	*nxt = frag_nxt;
+	return OFP_PKT_CONTINUE;
+
+dropfrag:
+	odp_packet_free(*pkt);
+done:
+	odp_spinlock_unlock(&bucket->lock);
+	return OFP_PKT_PROCESSED;
+}
+
+void ofp_reassembly6_age(int ticks)
+{
+	struct reass6_bucket *bucket;
+	struct frag6 *chain, *prev, *next;
+	odp_packet_t first;
+	int i;
+
+	for (i = 0; i < shm->num_buckets; i++) {
+		bucket = &shm->bucket[i];
+		if (!bucket->ipq)
+			continue;
+
+		ofp_spinlock_lock(&bucket->lock);
+		prev = NULL;
+		for (chain = bucket->ipq; chain; chain = next) {
+			next = chain->next_chain;
+			if (chain->ttl > ticks) {
+				chain->ttl -= ticks;
+				prev = chain;
+				continue;
+			}
+
+			frag6_unlink(bucket, prev, chain);
+
+			/* The error consumes the first fragment */
+			if (chain->off == 0) {
+				first = chain->pkt;
+				chain = chain->next_frag;
+				odp_packet_pull_head(first, sizeof(struct frag6));
+				ofp_icmp6_error(first, OFP_ICMP6_TIME_EXCEEDED,
+						OFP_ICMP6_TIME_EXCEED_REASSEMBLY,
+						0);
+			}
+			frag6_free_chain(chain);
+		}
+		odp_spinlock_unlock(&bucket->lock);
+	}
+}
+
+static void slow_tmo6(void *arg)
+{
+	(void)arg;
+
+	ofp_reassembly6_age(1);
+	shm->timer = ofp_timer_start(1000000, slow_tmo6, NULL, 0);
+}
+
+static int ofp_reassembly6_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_REASSEMBLY6,
+				      SHM_SIZE_REASSEMBLY6);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int ofp_reassembly6_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_REASSEMBLY6)) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_reassembly6_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_REASSEMBLY6);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_reassembly6_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_REASSEMBLY6, SHM_SIZE_REASSEMBLY6);
+}
+
+int ofp_reassembly6_init_global(void)
+{
+	int i;
+
+	HANDLE_ERROR(ofp_reassembly6_alloc_shared_memory());
+
+	memset(shm, 0, SHM_SIZE_REASSEMBLY6);
+	odp_atomic_init_u32(&shm->nipq, 0);
+	shm->maxnipq = global_param->reass.max_queues;
+	shm->maxfragsperpacket = global_param->reass.max_frags;
+	shm->per_thread = global_param->reass.per_thread;
+	shm->num_buckets = NUM_BUCKETS;
+	odp_atomic_init_u32(&shm->timer_started, 0);
+	shm->timer = ODP_TIMER_INVALID;
+	for (i = 0; i < shm->num_buckets; i++)
+		odp_spinlock_init(&shm->bucket[i].lock);
+
+	return 0;
+}
+
+int ofp_reassembly6_term_global(void)
+{
+	struct frag6 *chain, *next;
+	int i;
+	int rc = 0;
+
+	if (ofp_reassembly6_lookup_shared_memory())
+		return -1;
+
+	if (shm->timer != ODP_TIMER_INVALID) {
+		CHECK_ERROR(ofp_timer_cancel(shm->timer), rc);
+		shm->timer = ODP_TIMER_INVALID;
+	}
+
+	for (i = 0; i < shm->num_buckets; i++) {
+		for (chain = shm->bucket[i].ipq; chain; chain = next) {
+			next = chain->next_chain;
+			frag6_free_chain(chain);
+		}
+		shm->bucket[i].ipq = NULL;
+	}
+
+	CHECK_ERROR(ofp_reassembly6_free_shared_memory(), rc);
+
+	return rc;
+}
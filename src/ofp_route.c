@@ -6,11 +6,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "ofpi.h"
 #include <odp_api.h>
 #include "ofpi_rt_lookup.h"
+#include "ofpi_rcu.h"
 #include "ofpi_route.h"
 
 #include "ofpi_util.h"
@@ -19,14 +21,16 @@
 #include "ofpi_avl.h"
 #include "ofpi_portconf.h"
 #include "ofpi_log.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_nh_group.h"
+#include "ofpi_nd6_cache.h"
+#include "ofpi_tracepoint.h"
+#include "ofpi_timer.h"
 
 #define SHM_NAME_ROUTE "OfpRouteShMem"
 #define SHM_NAME_ROUTE_LK "OfpLocksShMem"
 #define SHM_NAME_VRF_ROUTE "OfpVrfRouteShMem"
 
-/* number of saved packets waiting for Neighbor Advertisement */
-#define NUM_PKTS 2048
-
 /*
  * Structure definitions
  */
@@ -34,25 +38,15 @@ struct routes_by_vrf {
 	struct ofp_rtl_tree routes;
 };
 
-struct pkt6_entry {
-	odp_packet_t pkt;
-
-	OFP_SLIST_ENTRY(pkt6_entry) next;
-};
-
-struct _pkt6 {
-	struct pkt6_entry entries[NUM_PKTS] ODP_ALIGNED_CACHE;
-	struct pkt6_list free_entries;
-	odp_rwlock_t fr_ent_rwlock;
-};
-
 
 /*
  * Shared data
  */
 struct ofp_route_mem {
 	struct ofp_rtl6_tree default_routes_6;
-	struct _pkt6 pkt6;
+#ifndef MTRIE
+	odp_timer_t reclaim_timer;
+#endif
 };
 
 struct vrf_route_mem {
@@ -68,36 +62,6 @@ static __thread struct vrf_route_mem *vrf_shm;
 
 struct ofp_locks_str *ofp_locks_shm;
 
-#ifdef INET6
-static void route6_cleanup(int fd, uint8_t *key, int level,
-		struct ofp_nh6_entry *data);
-#endif /* INET6 */
-
-static inline void *pkt6_entry_alloc(void)
-{
-	struct pkt6_entry *pktentry;
-
-	odp_rwlock_write_lock(&shm->pkt6.fr_ent_rwlock);
-
-	pktentry = OFP_SLIST_FIRST(&shm->pkt6.free_entries);
-
-	if (pktentry)
-		OFP_SLIST_REMOVE_HEAD(&shm->pkt6.free_entries, next);
-
-	odp_rwlock_write_unlock(&shm->pkt6.fr_ent_rwlock);
-
-	return pktentry;
-}
-
-static inline void pkt6_entry_free(struct pkt6_entry *pktentry)
-{
-	memset(pktentry, 0, sizeof(*pktentry));
-
-	odp_rwlock_write_lock(&shm->pkt6.fr_ent_rwlock);
-	OFP_SLIST_INSERT_HEAD(&shm->pkt6.free_entries, pktentry, next);
-	odp_rwlock_write_unlock(&shm->pkt6.fr_ent_rwlock);
-}
-
 /* ARP related functions */
 int ofp_add_mac(struct ofp_ifnet *dev, uint32_t addr, uint8_t *mac)
 {
@@ -130,7 +94,7 @@ struct ofp_nh6_entry *ofp_get_next_hop6(uint16_t vrf,
 	(void) flags;
 
 	OFP_LOCK_READ(route);
-	nh6 = ofp_rtl_search6(&shm->default_routes_6, addr);
+	nh6 = ofp_rtl_lookup6(&shm->default_routes_6, addr);
 	OFP_UNLOCK_READ(route);
 
 	return nh6;
@@ -139,105 +103,195 @@ struct ofp_nh6_entry *ofp_get_next_hop6(uint16_t vrf,
 #ifdef INET6
 void ofp_add_mac6(struct ofp_ifnet *dev, uint8_t *addr, uint8_t *mac)
 {
-	struct ofp_nh6_entry *nh;
-	struct pkt6_entry *pktentry;
-	struct pkt6_list pkt6_send;
-
-	OFP_LOCK_READ(route);
-	nh = ofp_rtl_search6(&shm->default_routes_6, addr);
-	if (!nh) {
-		OFP_DBG("Cannot add mac for %s", ofp_print_ip6_addr(addr));
-		OFP_UNLOCK_READ(route);
-		return;
-	}
-
-	(void) dev;
-	OFP_DBG("MAC added for %s (%s)", ofp_print_ip6_addr(addr),
-		ofp_port_vlan_to_ifnet_name(dev->port, dev->vlan));
-
-	memcpy(nh->mac, mac, 6);
-
-	/* We need to
-		- copy pkt list to release lock while sending packets
-		- reverse pkt list to send data in proper order*/
-	OFP_SLIST_INIT(&pkt6_send);
-	while ((pktentry = OFP_SLIST_FIRST(&nh->pkt6_hold))) {
-		OFP_SLIST_REMOVE_HEAD(&nh->pkt6_hold, next);
-		OFP_SLIST_INSERT_HEAD(&pkt6_send, pktentry, next);
-	}
-	OFP_SLIST_INIT(&nh->pkt6_hold);
-	OFP_UNLOCK_READ(route);
-
-	while ((pktentry = OFP_SLIST_FIRST(&pkt6_send))) {
-		OFP_SLIST_REMOVE_HEAD(&pkt6_send, next);
-		if (ofp_ip6_output(pktentry->pkt, nh) == OFP_PKT_DROP)
-			odp_packet_free(pktentry->pkt);
-		pkt6_entry_free(pktentry);
-	}
+	ofp_nd6_cache_update(dev, addr, mac, TRUE, TRUE);
 }
 #endif
 
-static int add_route(struct ofp_route_msg *msg)
+/* Resolve the ARP entry of the gateway, called without the route lock */
+static int add_route_prepare(struct ofp_route_msg *msg,
+			     struct ofp_nh_entry *tmp)
 {
-	struct ofp_nh_entry tmp;
+#ifndef OFP_USE_LIBCK
 	uint8_t  eth_addr[OFP_ETHER_ADDR_LEN];
-	odp_bool_t route_add_success = TRUE;
-	struct routes_by_vrf *fib;
-	int ret = 0;
+#endif
+
+	if (msg->flags & OFP_RTF_MULTIPATH) {
+		tmp->arp_ent_idx = msg->gw;
+		tmp->port = msg->port;
+		tmp->vlan = msg->vlan;
+		if (ofp_nh_group_hold(msg->gw, tmp)) {
+			OFP_ERR("Next hop group %u does not exist", msg->gw);
+			return -1;
+		}
+		return 0;
+	}
 
-	memset(&eth_addr, 0, sizeof(eth_addr));
 #ifndef OFP_USE_LIBCK
+
+	memset(&eth_addr, 0, sizeof(eth_addr));
 	if (ofp_ipv4_lookup_arp_entry_idx(msg->gw, msg->vrf,
-					  &tmp.arp_ent_idx) < 0) {
+					  &tmp->arp_ent_idx) < 0) {
 		if (ofp_arp_ipv4_insert_entry(msg->gw, eth_addr,
 					      msg->vrf, FALSE, FALSE,
-					      &tmp.arp_ent_idx, NULL) < 0) {
+					      &tmp->arp_ent_idx, FALSE) < 0) {
 			OFP_DBG("ARP insert failure in add route.");
 			return -1;
 		}
 	}
+#else
+	(void)msg;
+	(void)tmp;
 #endif
+	return 0;
+}
 
-	OFP_LOCK_WRITE(route);
+/* Release what a route held on its next hop */
+static void route_nh_put(const struct ofp_nh_entry *nh)
+{
+	if (nh->flags & OFP_RTF_MULTIPATH)
+		ofp_nh_group_release(nh->arp_ent_idx);
+#ifndef OFP_USE_LIBCK
+	else
+		ofp_arp_dec_ref_count(nh->arp_ent_idx);
+#endif
+}
+
+/* Release what add_route_prepare() took for a route not added */
+static void add_route_unprepare(struct ofp_route_msg *msg,
+				struct ofp_nh_entry *tmp)
+{
+	if (msg->flags & OFP_RTF_MULTIPATH)
+		ofp_nh_group_release(tmp->arp_ent_idx);
+}
+
+/*
+ * Called with the route lock held. Returns 0 when the route was added.
+ * A route replacing one with the same prefix, e.g. one restored for a
+ * warm restart, releases the next hop of the old one, or returns it in
+ * old with *replaced set if replaced is not NULL.
+ */
+static int add_route_locked(struct ofp_route_msg *msg,
+			    struct ofp_nh_entry *tmp,
+			    struct ofp_nh_entry *old, int *replaced)
+{
+	odp_bool_t route_add_success = TRUE;
+	struct routes_by_vrf *fib;
+	struct ofp_nh_entry prev, *nh;
+	int ret = 0;
+
+	if (replaced)
+		*replaced = 0;
 
+	if (msg->flags & OFP_RTF_MULTIPATH) {
+		/* Port and VLAN of the group were set by add_route_prepare() */
+		tmp->gw = msg->gw;
+		tmp->flags = msg->flags;
+	} else {
 #ifndef OFP_USE_LIBCK
-	ofp_arp_inc_ref_count(tmp.arp_ent_idx);
+		ofp_arp_inc_ref_count(tmp->arp_ent_idx);
 #endif
-	tmp.gw = msg->gw;
-	tmp.port = msg->port;
-	tmp.vlan = msg->vlan;
-	tmp.flags = msg->flags;
+		tmp->gw = msg->gw;
+		tmp->port = msg->port;
+		tmp->vlan = msg->vlan;
+		tmp->flags = msg->flags;
+	}
 
 	OFP_DBG("Adding route vrf=%d dst=%s/%d gw=%s arp idx=%u", msg->vrf,
 		ofp_print_ip_addr(msg->dst), msg->masklen,
-		ofp_print_ip_addr(msg->gw), tmp.arp_ent_idx);
+		ofp_print_ip_addr(msg->gw), tmp->arp_ent_idx);
 
 	fib = &vrf_shm->fib[msg->vrf];
-	if (ofp_rtl_insert(&fib->routes, msg->dst, msg->masklen, &tmp)) {
+	nh = ofp_rtl_search_exact(&fib->routes, msg->dst, msg->masklen);
+	if (nh)
+		prev = *nh;
+	if (ofp_rtl_insert(&fib->routes, msg->dst, msg->masklen, tmp)) {
 		OFP_DBG("ofp_rtl_insert failed");
 		route_add_success = FALSE;
 	}
+	if (!route_add_success && (msg->flags & OFP_RTF_MULTIPATH))
+		ofp_nh_group_release(tmp->arp_ent_idx);
 #ifndef OFP_USE_LIBCK
-	if (!route_add_success) {
-		ofp_arp_dec_ref_count(tmp.arp_ent_idx);
-		ofp_arp_ipv4_remove_entry_idx(tmp.arp_ent_idx);
+	else if (!route_add_success) {
+		ofp_arp_dec_ref_count(tmp->arp_ent_idx);
+		ofp_arp_ipv4_remove_entry_idx(tmp->arp_ent_idx);
 	}
 #endif
 
 #ifdef MTRIE
-	ret = ofp_rt_rule_add(msg->vrf, msg->dst, msg->masklen, &tmp);
+	ret = ofp_rt_rule_add(msg->vrf, msg->dst, msg->masklen, tmp);
 #endif
-	OFP_UNLOCK_WRITE(route);
-	OFP_DBG("route_add_success = %d ret = %d tmp.port=%d tmp.vlan = %d \n",route_add_success,ret, tmp.port,tmp.vlan);
-	if (route_add_success && !ret) {
-		if ((tmp.flags & OFP_RTF_LOCAL) && (msg->masklen == 32)) {
-			OFP_DBG("Adding static route for %s\n", ofp_print_ip_addr(msg->dst));
-			struct ofp_ifnet *ifnet = ofp_get_create_ifnet(tmp.port, tmp.vlan);
-			if (NULL != ifnet) {
-				ofp_ifnet_ip_add(ifnet, msg->dst);
-			}
+	if (route_add_success && !ret && nh) {
+		if (replaced) {
+			*old = prev;
+			*replaced = 1;
+		} else {
+			route_nh_put(&prev);
 		}
 	}
+	OFP_DBG("route_add_success = %d ret = %d tmp.port=%d tmp.vlan = %d \n",route_add_success,ret, tmp->port,tmp->vlan);
+
+	return (route_add_success && !ret) ? 0 : -1;
+}
+
+/*
+ * Called with the route lock held. Takes back a route added by
+ * add_route_locked(), with the route it replaced if any.
+ */
+static void add_route_undo(struct ofp_route_msg *msg,
+			   struct ofp_nh_entry *tmp,
+			   struct ofp_nh_entry *old, int replaced)
+{
+	struct routes_by_vrf *fib = &vrf_shm->fib[msg->vrf];
+
+	if (!replaced) {
+		(void)ofp_rtl_remove(&fib->routes, msg->dst, msg->masklen);
+#ifdef MTRIE
+		ofp_rt_rule_remove(msg->vrf, msg->dst, msg->masklen);
+#endif
+	} else {
+		if (ofp_rtl_insert(&fib->routes, msg->dst, msg->masklen,
+				   old)) {
+			OFP_ERR("Route vrf=%d dst=%s/%d not restored",
+				msg->vrf, ofp_print_ip_addr(msg->dst),
+				msg->masklen);
+			/* The new route stays */
+			route_nh_put(old);
+			return;
+		}
+#ifdef MTRIE
+		(void)ofp_rt_rule_add(msg->vrf, msg->dst, msg->masklen, old);
+#endif
+	}
+	route_nh_put(tmp);
+}
+
+static void add_route_finish(struct ofp_route_msg *msg,
+			     struct ofp_nh_entry *tmp)
+{
+	if ((tmp->flags & OFP_RTF_LOCAL) && (msg->masklen == 32)) {
+		OFP_DBG("Adding static route for %s\n", ofp_print_ip_addr(msg->dst));
+		struct ofp_ifnet *ifnet = ofp_get_create_ifnet(tmp->port, tmp->vlan);
+		if (NULL != ifnet) {
+			ofp_ifnet_ip_add(ifnet, msg->dst);
+		}
+	}
+}
+
+static int add_route(struct ofp_route_msg *msg)
+{
+	struct ofp_nh_entry tmp;
+	int ret;
+
+	if (add_route_prepare(msg, &tmp))
+		return -1;
+
+	OFP_LOCK_WRITE(route);
+	ret = add_route_locked(msg, &tmp, NULL, NULL);
+	OFP_UNLOCK_WRITE(route);
+
+	if (!ret)
+		add_route_finish(msg, &tmp);
+	ofp_flow_cache_flush();
 	return 0;
 }
 
@@ -256,10 +310,8 @@ static int del_route(struct ofp_route_msg *msg)
 
 	if (!nh_data)
 		OFP_DBG("ofp_rtl_remove failed");
-#ifndef OFP_USE_LIBCK
 	else
-		ofp_arp_dec_ref_count(nh_data->arp_ent_idx);
-#endif
+		route_nh_put(nh_data);
 
 #ifdef MTRIE
 	ofp_rt_rule_remove(msg->vrf, msg->dst, msg->masklen);
@@ -278,6 +330,7 @@ static int del_route(struct ofp_route_msg *msg)
 			}
 		}
 	}
+	ofp_flow_cache_flush();
 
 	return 0;
 }
@@ -294,7 +347,6 @@ static int add_route6(struct ofp_route_msg *msg)
 	tmp.port = msg->port;
 	tmp.vlan = msg->vlan;
 	tmp.flags = msg->flags;
-	OFP_SLIST_INIT(&tmp.pkt6_hold);
 
 	OFP_DBG("Adding ipv6 route vrf=%d addr=%s/%d gw=%s", msg->vrf,
 		   ofp_print_ip6_addr(msg->dst6), msg->masklen,
@@ -305,6 +357,7 @@ static int add_route6(struct ofp_route_msg *msg)
 		OFP_DBG("ofp_rtl_insert6 failed");
 
 	OFP_UNLOCK_WRITE(route);
+	ofp_flow_cache_flush();
 
 	return 0;
 }
@@ -312,7 +365,6 @@ static int add_route6(struct ofp_route_msg *msg)
 static int del_route6(struct ofp_route_msg *msg)
 {
 	struct ofp_nh6_entry *nh6;
-	struct pkt6_entry *pktentry;
 
 	OFP_DBG("Deleting route vrf=%d addr=%s/%d", msg->vrf,
 		   ofp_print_ip6_addr(msg->dst6), msg->masklen);
@@ -321,126 +373,279 @@ static int del_route6(struct ofp_route_msg *msg)
 
 	nh6 = ofp_rtl_remove6(&shm->default_routes_6, msg->dst6, msg->masklen);
 
-	if (nh6) {
-		while ((pktentry = OFP_SLIST_FIRST(&nh6->pkt6_hold))) {
-			OFP_SLIST_REMOVE_HEAD(&nh6->pkt6_hold, next);
-			odp_packet_free(pktentry->pkt);
-			pkt6_entry_free(pktentry);
-		}
-	} else
+	if (!nh6)
 		OFP_DBG("ofp_rtl_remove6 failed");
 
 	OFP_UNLOCK_WRITE(route);
+	ofp_flow_cache_flush();
 
 	return 0;
 }
-
-enum ofp_return_code ofp_route_save_ipv6_pkt(odp_packet_t pkt,
-	uint8_t *addr, struct ofp_ifnet *dev)
-{
-	struct ofp_nh6_entry *nh6 = NULL;
-	struct pkt6_entry *pktentry;
-
-	(void)dev;
-
-	OFP_LOCK_READ(route);
-	nh6 = ofp_rtl_search6(&shm->default_routes_6, addr);
-	if (!nh6) {
-		OFP_UNLOCK_READ(route);
-		return OFP_PKT_DROP;
-	}
-
-	pktentry = pkt6_entry_alloc();
-	if (!pktentry) {
-		OFP_UNLOCK_READ(route);
-		return OFP_PKT_DROP;
-	}
-	pktentry->pkt = pkt;
-
-	OFP_SLIST_INSERT_HEAD(&nh6->pkt6_hold, pktentry, next);
-
-	OFP_UNLOCK_READ(route);
-	return OFP_PKT_PROCESSED;
-}
 #endif /* INET6 */
 
-static void send_flags(int fd, uint32_t flags)
+static void send_flags(struct ofp_sendbuf *sb, uint32_t flags)
 {
 	if (flags & OFP_RTF_NET)
-		ofp_sendf(fd, " net");
+		ofp_sendbuf_printf(sb, " net");
 	if (flags & OFP_RTF_GATEWAY)
-		ofp_sendf(fd, " gateway");
+		ofp_sendbuf_printf(sb, " gateway");
 	if (flags & OFP_RTF_HOST)
-		ofp_sendf(fd, " host");
+		ofp_sendbuf_printf(sb, " host");
 	if (flags & OFP_RTF_REJECT)
-		ofp_sendf(fd, " reject");
+		ofp_sendbuf_printf(sb, " reject");
 	if (flags & OFP_RTF_BLACKHOLE)
-		ofp_sendf(fd, " blackhole");
+		ofp_sendbuf_printf(sb, " blackhole");
 	if (flags & OFP_RTF_LOCAL)
-		ofp_sendf(fd, " local");
+		ofp_sendbuf_printf(sb, " local");
 	if (flags & OFP_RTF_BROADCAST)
-		ofp_sendf(fd, " bcast");
+		ofp_sendbuf_printf(sb, " bcast");
 	if (flags & OFP_RTF_MULTICAST)
-		ofp_sendf(fd, " mcast");
+		ofp_sendbuf_printf(sb, " mcast");
+	if (flags & OFP_RTF_MULTIPATH)
+		ofp_sendbuf_printf(sb, " multipath");
 }
 
-static void show_routes(int fd, uint32_t key, int level, struct ofp_nh_entry *data)
+static void show_route(struct ofp_sendbuf *sb, const struct ofp_route_msg *msg)
 {
 	char buf[24];
-	snprintf(buf, sizeof(buf), "%s/%d", ofp_print_ip_addr(odp_cpu_to_be_32(key)), level);
-	ofp_sendf(fd, "%-18s %-15s %s   ",
-		  buf,
-		  ofp_print_ip_addr(data->gw),
-		  ofp_port_vlan_to_ifnet_name(data->port, data->vlan));
-	send_flags(fd, data->flags);
-	ofp_sendf(fd, "\r\n");
+	char gw[24];
+
+	snprintf(buf, sizeof(buf), "%s/%d", ofp_print_ip_addr(msg->dst),
+		 msg->masklen);
+	if (msg->flags & OFP_RTF_MULTIPATH)
+		snprintf(gw, sizeof(gw), "group %u", msg->gw);
+	else
+		snprintf(gw, sizeof(gw), "%s", ofp_print_ip_addr(msg->gw));
+	ofp_sendbuf_printf(sb, "%-18s %-15s %s   ",
+			   buf, gw,
+			   ofp_port_vlan_to_ifnet_name(msg->port, msg->vlan));
+	send_flags(sb, msg->flags);
+	ofp_sendbuf_printf(sb, "\r\n");
 }
 
 #ifdef INET6
-static void show_routes6(int fd, uint8_t *key, int level, struct ofp_nh6_entry *data)
+static void show_route6(struct ofp_sendbuf *sb,
+			const struct ofp_route_msg *msg)
 {
 	char buf[128];
-	snprintf(buf, sizeof(buf), "%s/%d", ofp_print_ip6_addr(key), level);
-	ofp_sendf(fd, "%-30s %-28s  %s ",
-		  buf,
-		  ofp_print_ip6_addr(data->gw),
-		  ofp_port_vlan_to_ifnet_name(data->port, data->vlan));
-	send_flags(fd, data->flags);
-	ofp_sendf(fd, "\r\n");
-}
-#endif /* INET6 */
 
-static void iter_routes(int fd, int vrf, struct ofp_rtl_tree *tree)
-{
-	ofp_sendf(fd, "VRF: %d\r\n", vrf);
-#ifdef MTRIE
-	(void) tree;
-	ofp_rt_rule_print(fd, vrf, show_routes);
-#else
-	ofp_rtl_traverse(fd, tree, show_routes);
-#endif
+	snprintf(buf, sizeof(buf), "%s/%d",
+		 ofp_print_ip6_addr((uint8_t *)(uintptr_t)msg->dst6),
+		 msg->masklen);
+	ofp_sendbuf_printf(sb, "%-30s %-28s  %s ",
+			   buf,
+			   ofp_print_ip6_addr((uint8_t *)(uintptr_t)msg->gw6),
+			   ofp_port_vlan_to_ifnet_name(msg->port, msg->vlan));
+	send_flags(sb, msg->flags);
+	ofp_sendbuf_printf(sb, "\r\n");
 }
+#endif /* INET6 */
 
 void ofp_show_routes(int fd, int what)
 {
-	int i;
+	struct ofp_route_snapshot *snap;
+	struct ofp_route_msg msgs[64];
+	struct ofp_sendbuf sb;
+	int i, n, vrf = -1, v6 = 0;
 
 	switch (what) {
 	case OFP_SHOW_ARP:
 		ofp_arp_show_table(fd);
 		break;
 	case OFP_SHOW_ROUTES:
-		ofp_sendf(fd, "Destination        Gateway         Iface  Flags\r\n");
-		for (i = 0; i < global_param->num_vrf; i++)
-			iter_routes(fd, i, &vrf_shm->fib[i].routes);
+		snap = ofp_route_snapshot_create();
+		if (!snap) {
+			ofp_sendf(fd, "Out of memory\r\n");
+			break;
+		}
+		ofp_sendbuf_init(&sb, fd);
+		ofp_sendbuf_printf(&sb, "Destination        Gateway         "
+				   "Iface  Flags\r\n");
+		/* IPv4 routes come first, by VRF */
+		while ((n = ofp_route_snapshot_read(snap, msgs, 64)) > 0)
+			for (i = 0; i < n; i++) {
 #ifdef INET6
-		ofp_sendf(fd, "\r\nIPv6 routes\r\n");
-		ofp_rtl_traverse6(fd, &shm->default_routes_6, show_routes6);
+				if (msgs[i].type == OFP_ROUTE6_ADD) {
+					if (!v6)
+						ofp_sendbuf_printf(&sb, "\r\nIPv6 "
+								   "routes\r\n");
+					v6 = 1;
+					show_route6(&sb, &msgs[i]);
+					continue;
+				}
 #endif /* INET6 */
+				while (vrf < msgs[i].vrf)
+					ofp_sendbuf_printf(&sb, "VRF: %d\r\n",
+							   ++vrf);
+				show_route(&sb, &msgs[i]);
+			}
+		while (vrf < global_param->num_vrf - 1)
+			ofp_sendbuf_printf(&sb, "VRF: %d\r\n", ++vrf);
+#ifdef INET6
+		if (!v6)
+			ofp_sendbuf_printf(&sb, "\r\nIPv6 routes\r\n");
+#endif /* INET6 */
+		(void)v6;
+		ofp_sendbuf_flush(&sb);
+		ofp_route_snapshot_free(snap);
 		break;
 	}
 }
 
+/* The traversals pass an fd, the walk state is kept here */
+static __thread struct {
+	void (*func)(void *arg, const struct ofp_route_msg *msg);
+	void *arg;
+	uint16_t vrf;
+} walk;
+
+static void walk_route(int fd, uint32_t key, int level,
+		       struct ofp_nh_entry *data)
+{
+	struct ofp_route_msg msg;
+
+	(void)fd;
+	memset(&msg, 0, sizeof(msg));
+	msg.type = OFP_ROUTE_ADD;
+	msg.flags = data->flags;
+	msg.dst = odp_cpu_to_be_32(key);
+	msg.masklen = level;
+	msg.gw = (data->flags & OFP_RTF_MULTIPATH) ? data->arp_ent_idx :
+		data->gw;
+	msg.port = data->port;
+	msg.vlan = data->vlan;
+	msg.vrf = walk.vrf;
+	walk.func(walk.arg, &msg);
+}
+
+static void walk_routes_locked(void)
+{
+	int i;
+
+	for (i = 0; i < global_param->num_vrf; i++) {
+		walk.vrf = i;
+#ifdef MTRIE
+		ofp_rt_rule_print(0, i, walk_route);
+#else
+		ofp_rtl_traverse(0, &vrf_shm->fib[i].routes, walk_route);
+#endif
+	}
+}
+
+void ofp_route_walk(void (*func)(void *arg, const struct ofp_route_msg *msg),
+		    void *arg)
+{
+	walk.func = func;
+	walk.arg = arg;
+
+	OFP_LOCK_READ(route);
+	walk_routes_locked();
+	OFP_UNLOCK_READ(route);
+}
+
+#ifdef INET6
+static void walk_route6(int fd, uint8_t *key, int level,
+			struct ofp_nh6_entry *data)
+{
+	struct ofp_route_msg msg;
+
+	(void)fd;
+	memset(&msg, 0, sizeof(msg));
+	msg.type = OFP_ROUTE6_ADD;
+	msg.flags = data->flags;
+	memcpy(msg.dst6, key, sizeof(msg.dst6));
+	msg.masklen = level;
+	memcpy(msg.gw6, data->gw, sizeof(msg.gw6));
+	msg.port = data->port;
+	msg.vlan = data->vlan;
+	walk.func(walk.arg, &msg);
+}
+#endif /* INET6 */
+
+struct ofp_route_snapshot {
+	struct ofp_route_msg *msgs;
+	int num;
+	int size;
+	int pos;
+	int failed;
+};
+
+#define ROUTE_SNAPSHOT_MIN 256
+
+static void snapshot_add(void *arg, const struct ofp_route_msg *msg)
+{
+	struct ofp_route_snapshot *snap = arg;
+	struct ofp_route_msg *msgs;
+
+	if (snap->failed)
+		return;
+	if (snap->num == snap->size) {
+		msgs = realloc(snap->msgs, 2 * snap->size * sizeof(*msgs));
+		if (!msgs) {
+			snap->failed = 1;
+			return;
+		}
+		snap->msgs = msgs;
+		snap->size *= 2;
+	}
+	snap->msgs[snap->num++] = *msg;
+}
+
+struct ofp_route_snapshot *ofp_route_snapshot_create(void)
+{
+	struct ofp_route_snapshot *snap;
+
+	snap = calloc(1, sizeof(*snap));
+	if (!snap)
+		return NULL;
+	snap->size = ROUTE_SNAPSHOT_MIN;
+	snap->msgs = malloc(snap->size * sizeof(*snap->msgs));
+	if (!snap->msgs) {
+		free(snap);
+		return NULL;
+	}
+
+	walk.func = snapshot_add;
+	walk.arg = snap;
+
+	/* The copy is all that is done under the lock */
+	OFP_LOCK_READ(route);
+	walk_routes_locked();
+#ifdef INET6
+	ofp_rtl_traverse6(0, &shm->default_routes_6, walk_route6);
+#endif /* INET6 */
+	OFP_UNLOCK_READ(route);
+
+	if (snap->failed) {
+		OFP_ERR("Route snapshot of more than %d routes failed",
+			snap->num);
+		ofp_route_snapshot_free(snap);
+		return NULL;
+	}
+	return snap;
+}
+
+int ofp_route_snapshot_read(struct ofp_route_snapshot *snap,
+			    struct ofp_route_msg *msgs, int num)
+{
+	if (num > snap->num - snap->pos)
+		num = snap->num - snap->pos;
+	if (num <= 0)
+		return 0;
+
+	memcpy(msgs, &snap->msgs[snap->pos], num * sizeof(*msgs));
+	snap->pos += num;
+	return num;
+}
+
+void ofp_route_snapshot_free(struct ofp_route_snapshot *snap)
+{
+	if (!snap)
+		return;
+	free(snap->msgs);
+	free(snap);
+}
+
 struct ofp_nh_entry *ofp_get_next_hop(uint16_t vrf, uint32_t addr, uint32_t *flags)
 {
 	(void) flags;
@@ -449,16 +654,43 @@ struct ofp_nh_entry *ofp_get_next_hop(uint16_t vrf, uint32_t addr, uint32_t *fla
 
 	fib = &vrf_shm->fib[vrf];
 #ifndef MTRIE
+	if (odp_likely(ofp_rcu_thread_is_registered())) {
+		node = ofp_rtl_search(&fib->routes, addr);
+		OFP_TRACEPOINT(route_lookup, vrf, addr, node);
+		return node;
+	}
+
 	OFP_LOCK_READ(route);
 #endif
 	node = ofp_rtl_search(&fib->routes, addr);
 #ifndef MTRIE
 	OFP_UNLOCK_READ(route);
 #endif
+	OFP_TRACEPOINT(route_lookup, vrf, addr, node);
 
 	return node;
 }
 
+void ofp_get_next_hop_bulk(uint16_t vrf, const uint32_t addr[],
+			   struct ofp_nh_entry *nh[], int num)
+{
+	struct routes_by_vrf *fib;
+
+	fib = &vrf_shm->fib[vrf];
+#ifndef MTRIE
+	if (odp_likely(ofp_rcu_thread_is_registered())) {
+		ofp_rtl_search_bulk(&fib->routes, addr, nh, num);
+		return;
+	}
+
+	OFP_LOCK_READ(route);
+#endif
+	ofp_rtl_search_bulk(&fib->routes, addr, nh, num);
+#ifndef MTRIE
+	OFP_UNLOCK_READ(route);
+#endif
+}
+
 static int add_local_interface(struct ofp_route_msg *msg)
 {
 	msg->masklen = 32;
@@ -483,6 +715,12 @@ int32_t ofp_set_route_msg(struct ofp_route_msg *msg)
 			return -1;
 		}
 
+		if ((msg->type == OFP_ROUTE_ADD ||
+		     msg->type == OFP_ROUTE_DEL) && msg->masklen > 32) {
+			OFP_ERR("Invalid masklen %d\n", msg->masklen);
+			return -1;
+		}
+
 		if (msg->type == OFP_ROUTE_ADD)
 				return add_route(msg);
 
@@ -507,6 +745,180 @@ TODO hash implementation for OFP_MOBILE_ROUTE_ADD,OFP_MOBILE_ROUTE_DEL
 		return -1;
 }
 
+/* Routes added per route lock hold by ofp_set_route_msgs() */
+#define ROUTE_BATCH 256
+
+/* Order by vrf and prefix, as the rule tree does, then by array position */
+static int route_msg_cmp(const void *a, const void *b)
+{
+	const struct ofp_route_msg *m1 = *(struct ofp_route_msg * const *)a;
+	const struct ofp_route_msg *m2 = *(struct ofp_route_msg * const *)b;
+	uint32_t p1, p2;
+
+	if (m1->vrf != m2->vrf)
+		return m1->vrf < m2->vrf ? -1 : 1;
+
+	p1 = m1->masklen ? odp_be_to_cpu_32(m1->dst) >> (32 - m1->masklen) <<
+		(32 - m1->masklen) : 0;
+	p2 = m2->masklen ? odp_be_to_cpu_32(m2->dst) >> (32 - m2->masklen) <<
+		(32 - m2->masklen) : 0;
+	if (p1 != p2)
+		return p1 < p2 ? -1 : 1;
+	if (m1->masklen != m2->masklen)
+		return m1->masklen < m2->masklen ? -1 : 1;
+
+	return m1 < m2 ? -1 : (m1 > m2);
+}
+
+/* A route of a batch, see add_routes() */
+struct route_batch_ent {
+	struct ofp_route_msg *msg;
+	struct ofp_nh_entry nh;
+	struct ofp_nh_entry old;
+	int replaced;
+};
+
+static int route_batch_cmp(const void *a, const void *b)
+{
+	const struct route_batch_ent *e1 = a;
+	const struct route_batch_ent *e2 = b;
+
+	return route_msg_cmp(&e1->msg, &e2->msg);
+}
+
+/*
+ * Add all routes or none. Every entry is prepared before the first one
+ * is added, and a route that cannot be added takes back those added
+ * before it. The next hops of the replaced routes are released once
+ * the batch stays.
+ */
+static int add_routes(struct ofp_route_msg *msgs, int num)
+{
+	struct route_batch_ent *ent;
+	int i, j, cnt, done, ret = 0;
+
+	for (i = 0; i < num; i++) {
+		if (msgs[i].vrf >= global_param->num_vrf ||
+		    msgs[i].masklen > 32) {
+			OFP_ERR("Invalid route vrf=%d masklen=%d",
+				msgs[i].vrf, msgs[i].masklen);
+			return -1;
+		}
+	}
+
+	ent = malloc(num * sizeof(*ent));
+	if (!ent) {
+		OFP_ERR("Out of memory for a batch of %d routes", num);
+		return -1;
+	}
+	for (i = 0; i < num; i++)
+		ent[i].msg = &msgs[i];
+	qsort(ent, num, sizeof(*ent), route_batch_cmp);
+
+	for (i = 0; i < num; i++)
+		if (add_route_prepare(ent[i].msg, &ent[i].nh))
+			break;
+	if (i < num) {
+		while (i--)
+			add_route_unprepare(ent[i].msg, &ent[i].nh);
+		free(ent);
+		return -1;
+	}
+
+	/* The lock is released between batches, and held at the end */
+	for (done = 0; ; ) {
+		cnt = num - done < ROUTE_BATCH ? num - done : ROUTE_BATCH;
+
+		OFP_LOCK_WRITE(route);
+		if (done == 0)
+			ofp_rtl_batch_begin();
+		for (j = 0; j < cnt; j++, done++)
+			if (add_route_locked(ent[done].msg, &ent[done].nh,
+					     &ent[done].old,
+					     &ent[done].replaced))
+				break;
+		if (j < cnt || done == num)
+			break;
+		OFP_UNLOCK_WRITE(route);
+	}
+
+	if (done < num) {
+		OFP_ERR("Route batch of %d failed, taking back %d routes",
+			num, done);
+		/* The failed one released its next hop */
+		for (i = done + 1; i < num; i++)
+			add_route_unprepare(ent[i].msg, &ent[i].nh);
+		while (done--)
+			add_route_undo(ent[done].msg, &ent[done].nh,
+				       &ent[done].old, ent[done].replaced);
+		ret = -1;
+	} else {
+		for (i = 0; i < num; i++)
+			if (ent[i].replaced)
+				route_nh_put(&ent[i].old);
+	}
+	ofp_rtl_batch_end();
+	OFP_UNLOCK_WRITE(route);
+
+	if (!ret)
+		for (i = 0; i < num; i++)
+			add_route_finish(ent[i].msg, &ent[i].nh);
+
+	free(ent);
+	ofp_flow_cache_flush();
+
+	return ret;
+}
+
+/*
+ * Returns the number of messages not applied. With each, a rejected
+ * batch is added again route by route.
+ */
+static int set_route_msgs(struct ofp_route_msg *msgs, int num, int each)
+{
+	int i, j, k, failed = 0;
+
+	for (i = 0; i < num; i = j) {
+		/* Consecutive additions are batched, others keep their order */
+		for (j = i; j < num && msgs[j].type == OFP_ROUTE_ADD; j++)
+			;
+
+		if (j - i > 1) {
+			if (!add_routes(&msgs[i], j - i))
+				continue;
+			if (!each) {
+				failed += j - i;
+				continue;
+			}
+			for (k = i; k < j; k++) {
+				if (!ofp_set_route_msg(&msgs[k]))
+					continue;
+				OFP_WARN("Route %s/%u vrf %u not added",
+					 ofp_print_ip_addr(msgs[k].dst),
+					 msgs[k].masklen, msgs[k].vrf);
+				failed++;
+			}
+			continue;
+		}
+
+		if (ofp_set_route_msg(&msgs[i]))
+			failed++;
+		j = i + 1;
+	}
+
+	return failed;
+}
+
+int32_t ofp_set_route_msgs(struct ofp_route_msg *msgs, int num)
+{
+	return set_route_msgs(msgs, num, 0) ? -1 : 0;
+}
+
+int ofp_set_route_msgs_each(struct ofp_route_msg *msgs, int num)
+{
+	return set_route_msgs(msgs, num, 1);
+}
+
 static int ofp_route_alloc_shared_memory(void)
 {
 	shm = ofp_shared_memory_alloc(SHM_NAME_ROUTE, sizeof(*shm));
@@ -547,6 +959,11 @@ static int ofp_route_free_shared_memory(void)
 int ofp_route_lookup_shared_memory(void)
 {
 	HANDLE_ERROR(ofp_rt_lookup_lookup_shared_memory());
+	HANDLE_ERROR(ofp_rt6_mtrie_lookup_shared_memory());
+	HANDLE_ERROR(ofp_nh_group_lookup_shared_memory());
+#ifdef INET6
+	HANDLE_ERROR(ofp_nd6_cache_lookup_shared_memory());
+#endif /* INET6 */
 
 	shm = ofp_shared_memory_lookup(SHM_NAME_ROUTE);
 	if (shm == NULL) {
@@ -606,24 +1023,51 @@ int ofp_vrf_route_lookup_shared_memory(void)
 void ofp_route_init_prepare(void)
 {
 	ofp_rt_lookup_init_prepare();
+	ofp_rt6_mtrie_init_prepare();
+	ofp_nh_group_init_prepare();
+#ifdef INET6
+	ofp_nd6_cache_init_prepare();
+#endif /* INET6 */
 	ofp_shared_memory_prealloc(SHM_NAME_ROUTE, sizeof(*shm));
 	ofp_shared_memory_prealloc(SHM_NAME_ROUTE_LK, sizeof(*ofp_locks_shm));
 	ofp_shared_memory_prealloc(SHM_NAME_VRF_ROUTE, SHM_SIZE_VRF_ROUTE);
 }
 
+#ifndef MTRIE
+/*
+ * Nodes retired by route changes are otherwise reclaimed only by the
+ * next change. Free them once the readers are done, also when the
+ * routes stay as they are.
+ */
+static void route_reclaim_tmo(void *arg)
+{
+	(void)arg;
+
+	OFP_LOCK_WRITE(route);
+	(void)ofp_rtl_reclaim();
+	OFP_UNLOCK_WRITE(route);
+
+	shm->reclaim_timer = ofp_timer_start(1000000, route_reclaim_tmo,
+					     NULL, 0);
+}
+#endif /* !MTRIE */
+
 int ofp_route_init_global(void)
 {
 	int i;
 
 	HANDLE_ERROR(ofp_rt_lookup_init_global());
+	HANDLE_ERROR(ofp_rt6_mtrie_init_global());
+	HANDLE_ERROR(ofp_nh_group_init_global());
+#ifdef INET6
+	HANDLE_ERROR(ofp_nd6_cache_init_global());
+#endif /* INET6 */
 
 	HANDLE_ERROR(ofp_route_alloc_shared_memory());
 
 	HANDLE_ERROR(ofp_vrf_route_alloc_shared_memory());
 
 	memset(shm, 0, sizeof(*shm));
-	for (i = 0; i < NUM_PKTS; i++)
-		shm->pkt6.entries[i].pkt = ODP_PACKET_INVALID;
 
 	memset(ofp_locks_shm, 0, sizeof(*ofp_locks_shm));
 	odp_rwlock_init(&ofp_locks_shm->lock_config_rw);
@@ -631,17 +1075,18 @@ int ofp_route_init_global(void)
 
 	HANDLE_ERROR(ofp_rtl6_init(&shm->default_routes_6));
 
-	odp_rwlock_init(&shm->pkt6.fr_ent_rwlock);
-	memset(shm->pkt6.entries, 0, sizeof(shm->pkt6.entries));
-	OFP_SLIST_INIT(&shm->pkt6.free_entries);
-	for (i = NUM_PKTS - 1; i >= 0; --i)
-		OFP_SLIST_INSERT_HEAD(&shm->pkt6.free_entries,
-			&shm->pkt6.entries[i], next);
-
 	memset(vrf_shm, 0, sizeof(*vrf_shm));
 	for (i = 0; i < global_param->num_vrf; i++)
 		(void) ofp_rtl_root_init(&vrf_shm->fib[i].routes, i);
 
+#ifndef MTRIE
+	shm->reclaim_timer = ofp_timer_start(1000000, route_reclaim_tmo,
+					     NULL, 0);
+	if (shm->reclaim_timer == ODP_TIMER_INVALID) {
+		OFP_ERR("Failed to create route reclaim timer");
+		return -1;
+	}
+#endif
 	return 0;
 }
 
@@ -653,15 +1098,20 @@ int ofp_route_term_global(void)
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_lookup failed");
 		rc = -1;
-	} else {
-#ifdef INET6
-		ofp_rtl_traverse6(0, &shm->default_routes_6, route6_cleanup);
-#endif /*INET6*/
 	}
+#ifndef MTRIE
+	else if (shm->reclaim_timer != ODP_TIMER_INVALID)
+		CHECK_ERROR(ofp_timer_cancel(shm->reclaim_timer), rc);
+#endif
 
 	CHECK_ERROR(ofp_route_free_shared_memory(), rc);
 
 	CHECK_ERROR(ofp_rt_lookup_term_global(), rc);
+	CHECK_ERROR(ofp_rt6_mtrie_term_global(), rc);
+	CHECK_ERROR(ofp_nh_group_term_global(), rc);
+#ifdef INET6
+	CHECK_ERROR(ofp_nd6_cache_term_global(), rc);
+#endif /* INET6 */
 
 	vrf_shm = ofp_shared_memory_lookup(SHM_NAME_VRF_ROUTE);
 	if (vrf_shm == NULL) {
@@ -672,21 +1122,3 @@ int ofp_route_term_global(void)
 
 	return rc;
 }
-
-#ifdef INET6
-static void route6_cleanup(int fd, uint8_t *key, int level,
-		struct ofp_nh6_entry *data)
-{
-	struct pkt6_entry *pktentry;
-
-	(void)fd;
-	(void)key;
-	(void)level;
-
-	while ((pktentry = OFP_SLIST_FIRST(&data->pkt6_hold))) {
-		OFP_SLIST_REMOVE_HEAD(&data->pkt6_hold, next);
-		odp_packet_free(pktentry->pkt);
-		pkt6_entry_free(pktentry);
-	}
-}
-#endif /* INET6 */
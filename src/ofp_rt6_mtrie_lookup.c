@@ -0,0 +1,358 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * IPv6 MTRIE (16/8/.../8) used for next hop lookups.
+ *
+ * The binary trie of ofp_rtl6_tree is the authoritative route table
+ * and is updated first. The MTRIE is derived from it: each entry
+ * holds the longest prefix ending in its level and a link to the
+ * table of the next level. A lookup reads at most one entry per level
+ * instead of one trie node per address bit.
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_util.h"
+#include "ofpi.h"
+#include "ofpi_rt_lookup.h"
+#include "ofpi_log.h"
+#include "ofpi_shared_mem.h"
+
+#define SHM_NAME_RT6_MTRIE	"OfpRt6MtrieShMem"
+
+#define NUM_TABLES		global_param->mtrie6.table8_nodes
+
+#define IPV6_LENGTH		128
+#define IPV6_NUM_LEVELS	(1 + (IPV6_LENGTH - IPV6_FIRST_LEVEL) / IPV6_LEVEL)
+
+#define SHM_SIZE_RT6_MTRIE						\
+	(sizeof(*shm) + sizeof(struct ofp_rtl6_mtrie_table) * NUM_TABLES)
+
+/*
+ * Shared data
+ */
+struct ofp_rt6_mtrie_mem {
+	struct ofp_rtl6_mtrie_entry root[1 << IPV6_FIRST_LEVEL];
+	odp_bool_t root_used;
+
+	struct ofp_rtl6_mtrie_table *free_tables;
+	int tables_allocated, max_tables_allocated;
+
+	struct ofp_rtl6_mtrie_table tables[];
+};
+
+/*
+ * Data per core
+ */
+static __thread struct ofp_rt6_mtrie_mem *shm;
+
+static void tables_init(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_TABLES; i++)
+		shm->tables[i].next_free = (i == NUM_TABLES - 1) ?
+			NULL : &shm->tables[i + 1];
+	shm->free_tables = NUM_TABLES ? &shm->tables[0] : NULL;
+	shm->tables_allocated = 0;
+}
+
+static struct ofp_rtl6_mtrie_table *table_alloc(void)
+{
+	struct ofp_rtl6_mtrie_table *table = shm->free_tables;
+
+	if (!table)
+		return NULL;
+
+	shm->free_tables = table->next_free;
+	memset(table, 0, sizeof(*table));
+
+	shm->tables_allocated++;
+	if (shm->tables_allocated > shm->max_tables_allocated)
+		shm->max_tables_allocated = shm->tables_allocated;
+
+	return table;
+}
+
+static void table_free(struct ofp_rtl6_mtrie_table *table)
+{
+	table->next_free = shm->free_tables;
+	shm->free_tables = table;
+	shm->tables_allocated--;
+}
+
+/*
+ * Out of tables: lookups of the tree fall back to the binary trie.
+ */
+static void mtrie6_disable(struct ofp_rtl6_tree *tree)
+{
+	OFP_ERR("IPv6 mtrie out of tables, using trie lookups");
+
+	tree->mtrie = NULL;
+	shm->root_used = 0;
+	tables_init();
+}
+
+static inline uint32_t level_index(const uint8_t *addr, uint32_t high)
+{
+	if (high == IPV6_FIRST_LEVEL)
+		return (addr[0] << 8) | addr[1];
+	return addr[high / 8 - 1];
+}
+
+static inline void level_index_set(uint8_t *addr, uint32_t high, uint32_t idx)
+{
+	if (high == IPV6_FIRST_LEVEL) {
+		addr[0] = idx >> 8;
+		addr[1] = idx & 0xff;
+	} else {
+		addr[high / 8 - 1] = idx;
+	}
+}
+
+static void prefix_copy(uint8_t *dst, const uint8_t *addr, uint32_t masklen)
+{
+	memset(dst, 0, 16);
+	memcpy(dst, addr, masklen / 8);
+	if (masklen % 8)
+		dst[masklen / 8] = addr[masklen / 8] & (0xff << (8 - masklen % 8));
+}
+
+/* Trie node of the route addr/masklen */
+static struct ofp_rtl6_node *trie_exact(struct ofp_rtl6_tree *tree,
+					uint8_t *addr, uint32_t masklen)
+{
+	struct ofp_rtl6_node *node = tree->root;
+	uint32_t bit;
+
+	for (bit = 0; bit < masklen && node; bit++)
+		node = ofp_rt_traverse_tree(node, addr, bit);
+
+	if (node && (node->flags & OFP_RTL_FLAGS_VALID_DATA))
+		return node;
+	return NULL;
+}
+
+/* Longest route matching addr with a prefix length in (low, high] */
+static struct ofp_rtl6_node *trie_best(struct ofp_rtl6_tree *tree,
+				       uint8_t *addr, uint32_t low,
+				       uint32_t high, uint32_t *masklen)
+{
+	struct ofp_rtl6_node *node = tree->root;
+	struct ofp_rtl6_node *best = NULL;
+	uint32_t bit;
+
+	for (bit = 0; node; bit++) {
+		if (bit > low && (node->flags & OFP_RTL_FLAGS_VALID_DATA)) {
+			best = node;
+			*masklen = bit;
+		}
+		if (bit == high)
+			break;
+		node = ofp_rt_traverse_tree(node, addr, bit);
+	}
+
+	return best;
+}
+
+int ofp_rtl6_mtrie_init(struct ofp_rtl6_tree *tree)
+{
+	tree->mtrie = NULL;
+
+	if (!shm || shm->root_used)
+		return -1;
+
+	memset(shm->root, 0, sizeof(shm->root));
+	shm->root_used = 1;
+	tree->mtrie = shm->root;
+
+	return 0;
+}
+
+int ofp_rtl6_mtrie_insert(struct ofp_rtl6_tree *tree, uint8_t *addr,
+			  uint32_t masklen)
+{
+	struct ofp_rtl6_mtrie_entry *table = tree->mtrie;
+	struct ofp_rtl6_mtrie_entry *elem;
+	struct ofp_rtl6_mtrie_table *parent = NULL;
+	struct ofp_rtl6_node *node;
+	uint8_t prefix[16];
+	uint32_t high = IPV6_FIRST_LEVEL;
+	uint32_t i, idx, num;
+
+	/* The default route is found in the root of the trie */
+	if (!table || masklen == 0)
+		return 0;
+
+	node = trie_exact(tree, addr, masklen);
+	if (!node)
+		return -1;
+
+	prefix_copy(prefix, addr, masklen);
+
+	while (masklen > high) {
+		elem = &table[level_index(prefix, high)];
+		if (!elem->next) {
+			elem->next = table_alloc();
+			if (!elem->next) {
+				mtrie6_disable(tree);
+				return -1;
+			}
+			if (!elem->masklen && parent)
+				parent->ref++;
+		}
+		parent = elem->next;
+		table = parent->entry;
+		high += IPV6_LEVEL;
+	}
+
+	idx = level_index(prefix, high);
+	num = 1 << (high - masklen);
+	for (i = idx; i < idx + num; i++) {
+		elem = &table[i];
+		if (elem->masklen > masklen)
+			continue;
+		if (!elem->masklen && !elem->next && parent)
+			parent->ref++;
+		elem->nh = &node->data;
+		elem->masklen = masklen;
+	}
+
+	return 0;
+}
+
+int ofp_rtl6_mtrie_remove(struct ofp_rtl6_tree *tree, uint8_t *addr,
+			  uint32_t masklen)
+{
+	struct ofp_rtl6_mtrie_entry *table = tree->mtrie;
+	struct ofp_rtl6_mtrie_entry *path[IPV6_NUM_LEVELS];
+	struct ofp_rtl6_mtrie_entry *elem;
+	struct ofp_rtl6_mtrie_table *next;
+	struct ofp_rtl6_node *best;
+	uint8_t prefix[16];
+	uint32_t low = 0, high = IPV6_FIRST_LEVEL;
+	uint32_t i, idx, num, len;
+	int depth = 0;
+
+	if (!table || masklen == 0)
+		return 0;
+
+	prefix_copy(prefix, addr, masklen);
+
+	while (masklen > high) {
+		elem = &table[level_index(prefix, high)];
+		if (!elem->next)
+			return -1;
+		path[depth++] = elem;
+		table = elem->next->entry;
+		low = high;
+		high += IPV6_LEVEL;
+	}
+
+	/* Entries of the route get the next longest route of the level */
+	idx = level_index(prefix, high);
+	num = 1 << (high - masklen);
+	for (i = idx; i < idx + num; i++) {
+		elem = &table[i];
+		if (elem->masklen != masklen)
+			continue;
+
+		level_index_set(prefix, high, i);
+		best = trie_best(tree, prefix, low, high, &len);
+		if (best) {
+			elem->nh = &best->data;
+			elem->masklen = len;
+			continue;
+		}
+
+		elem->masklen = 0;
+		elem->nh = NULL;
+		if (!elem->next && depth)
+			path[depth - 1]->next->ref--;
+	}
+
+	/* Release the tables that became empty */
+	while (depth > 0) {
+		elem = path[--depth];
+		next = elem->next;
+		if (next->ref)
+			break;
+		elem->next = NULL;
+		table_free(next);
+		if (!elem->masklen && depth)
+			path[depth - 1]->next->ref--;
+	}
+
+	return 0;
+}
+
+void ofp_print_rt6_mtrie_stat(int fd)
+{
+	ofp_sendf(fd, "rt6 mtrie table alloc now=%d max=%d total=%d\r\n",
+		  shm->tables_allocated, shm->max_tables_allocated, NUM_TABLES);
+}
+
+static int ofp_rt6_mtrie_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_RT6_MTRIE, SHM_SIZE_RT6_MTRIE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_rt6_mtrie_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_RT6_MTRIE) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_rt6_mtrie_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_RT6_MTRIE);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_rt6_mtrie_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_RT6_MTRIE, SHM_SIZE_RT6_MTRIE);
+}
+
+int ofp_rt6_mtrie_init_global(void)
+{
+	HANDLE_ERROR(ofp_rt6_mtrie_alloc_shared_memory());
+
+	memset(shm, 0, SHM_SIZE_RT6_MTRIE);
+	tables_init();
+
+	return 0;
+}
+
+int ofp_rt6_mtrie_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_rt6_mtrie_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_rt6_mtrie_free_shared_memory(), rc);
+
+	return rc;
+}
@@ -25,6 +25,7 @@
 #include "ofpi.h"
 #include <odp_api.h>
 #include "ofpi_rt_lookup.h"
+#include "ofpi_rcu.h"
 #include "ofpi_log.h"
 
 #define SHM_NAME_RT_LOOKUP	"OfpRtlookupShMem"
@@ -32,6 +33,15 @@
 #define NUM_NODES		ROUTE4_NODES
 #define NUM_NODES_6		ROUTE6_NODES
 
+/*
+ * Node unlinked from a tree, waiting for readers to pass a quiescent
+ * state before it can be reused.
+ */
+struct ofp_rtl_retired {
+	struct ofp_rtl_node *node;
+	uint64_t epoch;
+};
+
 /*
  * Shared data
  */
@@ -41,6 +51,10 @@ struct ofp_rt_lookup_mem {
 	struct ofp_rtl_tailq free_nodes;
 	int nodes_allocated, max_nodes_allocated;
 
+	struct ofp_rtl_retired retired[NUM_NODES];
+	uint32_t retired_head, retired_num;
+	int batch;		/* see ofp_rtl_batch_begin() */
+
 	struct ofp_rtl6_node *global_stack6[129];
 	struct ofp_rtl6_node node_list6[NUM_NODES_6];
 	struct ofp_rtl6_node *free_nodes6;
@@ -64,9 +78,77 @@ static void NODEFREE(struct ofp_rtl_node *node)
 	shm->nodes_allocated--;
 }
 
+/*
+ * IPv4 lookups are done without locks by the threads registered to
+ * RCU. Nodes removed from a tree are retired and reused only after
+ * the registered threads have passed a quiescent state.
+ */
+static void NODERETIRE(struct ofp_rtl_node *node)
+{
+	struct ofp_rtl_retired *r;
+
+	r = &shm->retired[(shm->retired_head + shm->retired_num) % NUM_NODES];
+	r->node = node;
+	r->epoch = ofp_rcu_epoch();
+	shm->retired_num++;
+}
+
+static void NODERECLAIM(void)
+{
+	struct ofp_rtl_retired *r;
+	uint64_t safe_epoch = 0;
+
+	if (!shm->retired_num)
+		return;
+
+	/* Start a new epoch if nodes were retired in the current one */
+	r = &shm->retired[(shm->retired_head + shm->retired_num - 1) % NUM_NODES];
+	if (r->epoch == ofp_rcu_epoch())
+		ofp_rcu_advance();
+
+	while (shm->retired_num) {
+		r = &shm->retired[shm->retired_head];
+		if (r->epoch > safe_epoch) {
+			if (!ofp_rcu_is_safe(r->epoch))
+				break;
+			safe_epoch = r->epoch;
+		}
+		NODEFREE(r->node);
+		shm->retired_head = (shm->retired_head + 1) % NUM_NODES;
+		shm->retired_num--;
+	}
+}
+
+int ofp_rtl_reclaim(void)
+{
+	NODERECLAIM();
+	return shm->retired_num;
+}
+
+/*
+ * Changes of a batch retire nodes without reclaiming them, so that the
+ * epoch is advanced once at the end of the batch rather than once per
+ * change. Nodes are still reclaimed when the free list runs out.
+ */
+void ofp_rtl_batch_begin(void)
+{
+	shm->batch++;
+}
+
+void ofp_rtl_batch_end(void)
+{
+	if (--shm->batch == 0)
+		NODERECLAIM();
+}
+
 static struct ofp_rtl_node *NODEALLOC(void)
 {
-	struct ofp_rtl_node *p = shm->free_nodes.first;
+	struct ofp_rtl_node *p;
+
+	if (!shm->free_nodes.first)
+		NODERECLAIM();
+
+	p = shm->free_nodes.first;
 	if (shm->free_nodes.first) {
 		shm->free_nodes.first = shm->free_nodes.first->right;
 		if (shm->free_nodes.first)
@@ -119,6 +201,8 @@ int ofp_rtl6_init(struct ofp_rtl6_tree *tree)
 	tree->root->left = NULL;
 	tree->root->right = NULL;
 
+	(void)ofp_rtl6_mtrie_init(tree);
+
 	return 0;
 }
 
@@ -164,8 +248,29 @@ ofp_rtl_insert(struct ofp_rtl_tree *tree, uint32_t addr_be,
 	}
 
 	if (node) {
-		node->data[0] = *data;
-		node->flags = OFP_RTL_FLAGS_VALID_DATA;
+		struct ofp_rtl_node *copy = NODEALLOC();
+
+		if (!copy) {
+			OFP_ERR("NODEALLOC failed");
+			return data;
+		}
+
+		/* Replace the node so that readers never see partial data */
+		*copy = *node;
+		copy->data[0] = *data;
+		copy->flags = OFP_RTL_FLAGS_VALID_DATA;
+		odp_mb_release();
+
+		if (!last)
+			tree->root = copy;
+		else if (last->right == node)
+			last->right = copy;
+		else
+			last->left = copy;
+
+		NODERETIRE(node);
+		if (!shm->batch)
+			NODERECLAIM();
 		return NULL;
 	}
 
@@ -208,6 +313,9 @@ ofp_rtl_insert(struct ofp_rtl_tree *tree, uint32_t addr_be,
 		return data;
 	}
 
+	/* New nodes are initialized before readers can reach them */
+	odp_mb_release();
+
 	if (addr & mask) {
 		last->right = node;
 	} else {
@@ -298,7 +406,7 @@ ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 	if (!depth)
 		return data;
 
-	NODEFREE(node);
+	NODERETIRE(node);
 
 	mask = 1 << (32 - depth);
 	depth--;
@@ -318,11 +426,14 @@ ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 		if (depth == 0)
 			break;
 
-		NODEFREE(stack[depth]);
+		NODERETIRE(stack[depth]);
 		depth--;
 		mask <<= 1;
 	} while (1);
 
+	if (!shm->batch)
+		NODERECLAIM();
+
 	return data;
 }
 
@@ -387,9 +498,9 @@ void ofp_rtl_traverse(int fd, struct ofp_rtl_tree *tree,
 	traverse(fd, tree->root, func, 0, 0);
 }
 
-struct ofp_nh6_entry *
-ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
-				uint32_t masklen, struct ofp_nh6_entry *data)
+static struct ofp_nh6_entry *
+rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
+	    uint32_t masklen, struct ofp_nh6_entry *data)
 {
 	struct ofp_rtl6_node  *node;
 	struct ofp_rtl6_node  *last = NULL;
@@ -482,8 +593,8 @@ ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
 	return data;
 }
 
-struct ofp_nh6_entry *
-ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
+static struct ofp_nh6_entry *
+rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
 {
 	struct ofp_rtl6_node  *node;
 	struct ofp_rtl6_node **stack = shm->global_stack6;
@@ -545,6 +656,27 @@ ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
 	return data;
 }
 
+struct ofp_nh6_entry *
+ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
+		uint32_t masklen, struct ofp_nh6_entry *data)
+{
+	struct ofp_nh6_entry *ret = rtl_insert6(tree, addr, masklen, data);
+
+	if (!ret)
+		(void)ofp_rtl6_mtrie_insert(tree, addr, masklen);
+	return ret;
+}
+
+struct ofp_nh6_entry *
+ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
+{
+	struct ofp_nh6_entry *ret = rtl_remove6(tree, addr, masklen);
+
+	if (ret)
+		(void)ofp_rtl6_mtrie_remove(tree, addr, masklen);
+	return ret;
+}
+
 #if 0
 static void tr(int fd, struct ofp_rtl6_node *n, int level)
 {
@@ -605,6 +737,7 @@ void ofp_print_rt_stat(int fd)
 			  shm->nodes_allocated, shm->max_nodes_allocated, NUM_NODES);
 	ofp_sendf(fd, "rt6 tree alloc now=%d max=%d total=%d\r\n",
 			  shm->nodes_allocated6, shm->max_nodes_allocated6, NUM_NODES_6);
+	ofp_print_rt6_mtrie_stat(fd);
 }
 
 static int ofp_rt_lookup_alloc_shared_memory(void)
@@ -14,28 +14,41 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include "ofpi_util.h"
 #include "ofpi.h"
 #include <odp_api.h>
 #include "ofpi_rt_lookup.h"
 #include "ofpi_log.h"
 #include "ofpi_avl.h"
+#include "ofpi_btree.h"
 
 #define SHM_NAME_RT_LOOKUP_MTRIE	"OfpRtlookupMtrieShMem"
+#define SHM_NAME_RT_LOOKUP_SEGMENT	"OfpRtlookupMtrieSeg%d"
 
 #define NUM_RT_RULES			global_param->mtrie.routes
 #define NUM_NODES			global_param->mtrie.table8_nodes
-#define NUM_NODES_LARGE			global_param->num_vrf
+#define NUM_NODES_LARGE			num_vrf_tables()
+#define NUM_VRF				global_param->num_vrf
+#define VRF_ROUTES			global_param->mtrie.vrf_routes
+#define VRF_NODES			global_param->mtrie.vrf_table8_nodes
+#define NUM_NODES_GROW			global_param->mtrie.table8_grow
 
 #define NUM_NODES_6			ROUTE6_NODES
 
+/* Shared memory segments added when the small nodes run out */
+#define MAX_SEGMENTS			32
+
 #define SMALL_NODE (1<<IPV4_LEVEL)
-#define LARGE_NODE (1<<IPV4_FIRST_LEVEL)
+#define LARGE_NODE (1<<first_level_param())
 #define SIZEOF_SMALL_LIST (sizeof(struct ofp_rtl_node)*NUM_NODES*SMALL_NODE)
-#define SIZEOF_LARGE_LIST (sizeof(struct ofp_rtl_node)*NUM_NODES_LARGE*LARGE_NODE)
+/* One more large node is the empty table of the VRFs without routes */
+#define SIZEOF_LARGE_LIST						\
+	(sizeof(struct ofp_rtl_node)*(NUM_NODES_LARGE + 1)*LARGE_NODE)
+#define SIZEOF_VRF_USAGE (sizeof(struct rt_vrf_usage)*NUM_VRF)
 #define SHM_SIZE_RT_LOOKUP_MTRIE					\
 	(sizeof(*shm) +	SIZEOF_SMALL_LIST + SIZEOF_LARGE_LIST +		\
-	 sizeof(struct ofp_rt_rule)*NUM_RT_RULES)
+	 sizeof(struct ofp_rt_rule)*NUM_RT_RULES + SIZEOF_VRF_USAGE)
 
 /*
  * Shared data
@@ -46,7 +59,15 @@ struct ofp_rt_rule_table {
 	struct ofp_rt_rule *free_rule;
 	uint32_t rule_allocated;
 	uint32_t max_rule_allocated;
-	avl_tree *rule_tree;
+	/* avl_tree or ofp_btree */
+	void *rule_tree;
+};
+
+/* Shares of the common pools taken by one VRF */
+struct rt_vrf_usage {
+	uint32_t routes;
+	uint32_t nodes;
+	uint32_t max_nodes;
 };
 
 struct ofp_rt_lookup_mem {
@@ -54,9 +75,16 @@ struct ofp_rt_lookup_mem {
 	struct ofp_rtl_node *large_list;
 	struct ofp_rtl_tailq free_small;
 	struct ofp_rtl_node *free_large;
+	struct ofp_rtl_node *empty_root;
+	int large_allocated;
+	struct rt_vrf_usage *vrf_usage;
 
 	struct ofp_rt_rule_table rt_rule_table;
 	int nodes_allocated, max_nodes_allocated;
+	int nodes_total;
+	uint32_t first_level;
+	int num_segments;
+	int segment_nodes;
 
 	struct ofp_rtl6_node *global_stack6[129];
 	struct ofp_rtl6_node node_list6[NUM_NODES_6];
@@ -69,7 +97,75 @@ struct ofp_rt_lookup_mem {
  */
 static __thread struct ofp_rt_lookup_mem *shm;
 
-static void NODEFREE(struct ofp_rtl_node *node)
+/* Copy of shm->first_level, read by every lookup */
+static uint32_t first_level = IPV4_FIRST_LEVEL;
+
+/* The first level has to leave a multiple of IPV4_LEVEL bits */
+static uint32_t first_level_param(void)
+{
+	int bits = global_param->mtrie.first_level;
+
+	if (bits < IPV4_LEVEL || bits > IPV4_LENGTH - IPV4_LEVEL ||
+	    bits % IPV4_LEVEL)
+		return IPV4_FIRST_LEVEL;
+	return bits;
+}
+
+static int num_vrf_tables(void)
+{
+	int num = global_param->mtrie.vrf_tables;
+
+	return (num <= 0 || num > global_param->num_vrf) ?
+		global_param->num_vrf : num;
+}
+
+static void small_list_init(struct ofp_rtl_node *list, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		list[i * SMALL_NODE].next = (i == num - 1) ?
+			NULL : &list[(i + 1) * SMALL_NODE];
+	shm->free_small.first = &list[0];
+	shm->free_small.last = &list[(num - 1) * SMALL_NODE];
+	shm->nodes_total += num;
+}
+
+/*
+ * Add a segment of small nodes. Called when the free list is empty, so
+ * the new nodes become the whole free list. The segment is mapped at
+ * the same address in all processes, like the preallocated memory.
+ */
+static int small_list_grow(void)
+{
+	struct ofp_rtl_node *list;
+	char name[32];
+	uint64_t size;
+
+	if (shm->segment_nodes <= 0)
+		return -1;
+	if (shm->num_segments == MAX_SEGMENTS) {
+		OFP_ERR("All %d mtrie segments in use", MAX_SEGMENTS);
+		return -1;
+	}
+
+	size = sizeof(struct ofp_rtl_node) * SMALL_NODE * shm->segment_nodes;
+	snprintf(name, sizeof(name), SHM_NAME_RT_LOOKUP_SEGMENT,
+		 shm->num_segments);
+	list = ofp_shared_memory_alloc(name, size);
+	if (list == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	memset(list, 0, size);
+	shm->num_segments++;
+	small_list_init(list, shm->segment_nodes);
+
+	OFP_INFO("mtrie grown to %d nodes", shm->nodes_total);
+	return 0;
+}
+
+static void NODEFREE(struct ofp_rtl_node *node, uint16_t vrf)
 {
 	if (node->root == 0) {
 		node->next = NULL;
@@ -79,16 +175,29 @@ static void NODEFREE(struct ofp_rtl_node *node)
 			shm->free_small.first = node;
 		shm->free_small.last = node;
 		shm->nodes_allocated--;
+		shm->vrf_usage[vrf].nodes--;
 	}
 }
 
 static inline uint32_t to_network_prefix(uint32_t addr_be, uint32_t masklen);
 
-static struct ofp_rtl_node *NODEALLOC(void)
+static struct ofp_rtl_node *NODEALLOC(uint16_t vrf)
 {
+	struct rt_vrf_usage *usage;
+
 	if (!shm)
 		return NULL;
 
+	usage = &shm->vrf_usage[vrf];
+	if (VRF_NODES > 0 && usage->nodes >= (uint32_t)VRF_NODES) {
+		OFP_ERR("VRF %u has all its %d mtrie nodes in use",
+			vrf, VRF_NODES);
+		return NULL;
+	}
+
+	if (!shm->free_small.first && small_list_grow())
+		return NULL;
+
 	struct ofp_rtl_node *rtl_node = shm->free_small.first;
 
 	if (rtl_node) {
@@ -99,10 +208,11 @@ static struct ofp_rtl_node *NODEALLOC(void)
 
 		if (shm->nodes_allocated > shm->max_nodes_allocated)
 			shm->max_nodes_allocated = shm->nodes_allocated;
+		if (++usage->nodes > usage->max_nodes)
+			usage->max_nodes = usage->nodes;
 
-		rtl_node->root = 0;
-		rtl_node->ref = 0;
-		rtl_node->next = NULL;
+		/* A recycled table must not carry entries of its last use */
+		memset(rtl_node, 0, sizeof(*rtl_node) * SMALL_NODE);
 	}
 
 	return rtl_node;
@@ -113,26 +223,61 @@ int ofp_rtl_init(struct ofp_rtl_tree *tree)
 	return ofp_rtl_root_init(tree, 0);
 }
 
+/* Tables are changed under the route lock, nothing is deferred */
+void ofp_rtl_batch_begin(void)
+{
+}
+
+void ofp_rtl_batch_end(void)
+{
+}
+
+/*
+ * A VRF starts with the shared empty table, in which every lookup
+ * misses. Its own first level table is taken at the first insert.
+ */
 int ofp_rtl_root_init(struct ofp_rtl_tree *tree, uint16_t vrf)
 {
-	tree->root = shm->free_large;
-	if (shm->free_large)
-		shm->free_large = shm->free_large->next;
+	tree->root = shm->empty_root;
+	tree->vrf = vrf;
 
-	if (!tree->root) {
-		OFP_ERR("Allocation failed");
+	return 0;
+}
+
+static int root_alloc(struct ofp_rtl_tree *tree)
+{
+	struct ofp_rtl_node *root = shm->free_large;
+
+	if (!root) {
+		OFP_ERR("All %d first level tables in use, VRF %u",
+			NUM_NODES_LARGE, tree->vrf);
 		return -1;
 	}
+	shm->free_large = root->next;
+	shm->large_allocated++;
 
-	tree->root->flags = 0;
-	tree->root->next = NULL;
-	tree->root->root = 1;
-	tree->root->ref = 0;
-	tree->vrf = vrf;
+	memset(root, 0, sizeof(*root) * LARGE_NODE);
+	root->root = 1;
+	/* Lookups may see the table as soon as the pointer is set */
+	odp_mb_release();
+	tree->root = root;
 
 	return 0;
 }
 
+/* Called with the last route of the VRF removed */
+static void root_free(struct ofp_rtl_tree *tree)
+{
+	struct ofp_rtl_node *root = tree->root;
+
+	tree->root = shm->empty_root;
+	odp_mb_release();
+
+	root->next = shm->free_large;
+	shm->free_large = root;
+	shm->large_allocated--;
+}
+
 static void NODEFREE6(struct ofp_rtl6_node *node)
 {
 	node->left = NULL;
@@ -167,6 +312,8 @@ int ofp_rtl6_init(struct ofp_rtl6_tree *tree)
 	tree->root->left = NULL;
 	tree->root->right = NULL;
 
+	(void)ofp_rtl6_mtrie_init(tree);
+
 	return 0;
 }
 
@@ -197,6 +344,30 @@ static int rt_rules_avl_compare(void *compare_arg, void *a, void *b)
 		return 0;
 }
 
+/* Wrappers over the rule tree, an AVL tree or a B+tree */
+static int rt_rule_tree_get(void *key, void **value_address)
+{
+	if (global_param->use_btree)
+		return ofp_btree_get_by_key(shm->rt_rule_table.rule_tree, key,
+					    value_address);
+	return avl_get_by_key(shm->rt_rule_table.rule_tree, key, value_address);
+}
+
+static int rt_rule_tree_insert(struct ofp_rt_rule *rule)
+{
+	if (global_param->use_btree)
+		return ofp_btree_insert(shm->rt_rule_table.rule_tree, rule);
+	return avl_insert(shm->rt_rule_table.rule_tree, rule);
+}
+
+static int rt_rule_tree_delete(struct ofp_rt_rule *rule)
+{
+	if (global_param->use_btree)
+		return ofp_btree_delete(shm->rt_rule_table.rule_tree, rule,
+					NULL);
+	return avl_delete(shm->rt_rule_table.rule_tree, rule, NULL);
+}
+
 static struct ofp_rt_rule*
 ofp_rt_rule_search(uint16_t vrf, uint32_t addr_be, uint32_t masklen)
 {
@@ -205,11 +376,21 @@ ofp_rt_rule_search(uint16_t vrf, uint32_t addr_be, uint32_t masklen)
 	key.u1.s1.vrf = vrf;
 	key.u1.s1.addr = to_network_prefix(addr_be, masklen);
 	key.u1.s1.masklen = masklen;
-	avl_get_by_key(shm->rt_rule_table.rule_tree, &key, (void **)&rule);
+	rt_rule_tree_get(&key, (void **)&rule);
 
 	return rule;
 }
 
+struct ofp_nh_entry *
+ofp_rtl_search_exact(struct ofp_rtl_tree *tree, uint32_t addr_be,
+		     uint32_t masklen)
+{
+	struct ofp_rt_rule *rule = ofp_rt_rule_search(tree->vrf, addr_be,
+						      masklen);
+
+	return rule ? &rule->u1.s1.data[0] : NULL;
+}
+
 static void rt_rule_free(struct ofp_rt_rule *rule)
 {
 	rule->used = 0;
@@ -250,6 +431,13 @@ int ofp_rt_rule_add(uint16_t vrf, uint32_t addr_be, uint32_t masklen, struct ofp
 			rule->u1.s1.vrf,
 			ofp_print_ip_addr(odp_cpu_to_be_32(rule->u1.s1.addr)),
 			rule->u1.s1.masklen);
+		return 0;
+	}
+
+	if (VRF_ROUTES > 0 &&
+	    shm->vrf_usage[vrf].routes >= (uint32_t)VRF_ROUTES) {
+		OFP_ERR("ofp_rt_rule_add VRF %u has its %d routes", vrf,
+			VRF_ROUTES);
 		return -1;
 	}
 
@@ -268,11 +456,12 @@ int ofp_rt_rule_add(uint16_t vrf, uint32_t addr_be, uint32_t masklen, struct ofp
 	rule->u1.s1.vrf = vrf;
 	rule->u1.s1.data[0] = *data;
 
-	if (avl_insert(shm->rt_rule_table.rule_tree, rule) != 0) {
+	if (rt_rule_tree_insert(rule) != 0) {
 		rt_rule_free(rule);
-		OFP_ERR("ofp_rt_rule_add avl insertion failed");
+		OFP_ERR("ofp_rt_rule_add rule tree insertion failed");
 		return -1;
 	}
+	shm->vrf_usage[vrf].routes++;
 
 	OFP_INFO("ofp_rt_rule_add inserted new rule vrf %u prefix %s/%u",
 		 rule->u1.s1.vrf,
@@ -292,7 +481,8 @@ int ofp_rt_rule_remove(uint16_t vrf, uint32_t addr_be, uint32_t masklen)
 		return -1;
 	}
 
-	avl_delete(shm->rt_rule_table.rule_tree, rule, NULL);
+	rt_rule_tree_delete(rule);
+	shm->vrf_usage[vrf].routes--;
 
 	OFP_INFO("ofp_rt_rule_remove removed rule vrf %u %s/%u", rule->u1.s1.vrf,
 		 ofp_print_ip_addr(odp_cpu_to_be_32(rule->u1.s1.addr)),
@@ -317,6 +507,24 @@ static int ofp_rt_rule_iter_helper(unsigned long index, void *key, void *iter_ar
 	return vrf_iter->func(key, vrf_iter->iter_arg);
 }
 
+struct ofp_rt_rule_btree_iter_arg_st {
+	uint16_t vrf;
+	int (*func)(void *key, void *iter_arg);
+	void *iter_arg;
+};
+
+static int ofp_rt_rule_btree_iter_helper(void *key, void *iter_arg)
+{
+	struct ofp_rt_rule_btree_iter_arg_st *vrf_iter = iter_arg;
+	struct ofp_rt_rule *rule = key;
+
+	/* Rules of the vrf are contiguous, stop at the next vrf */
+	if (rule->u1.s1.vrf != vrf_iter->vrf)
+		return 1;
+
+	return vrf_iter->func(key, vrf_iter->iter_arg);
+}
+
 static void ofp_rt_rule_vrf_iter(uint16_t vrf,
 				 int (*func)(void *key, void *iter_arg),
 				 void *iter_arg)
@@ -325,6 +533,19 @@ static void ofp_rt_rule_vrf_iter(uint16_t vrf,
 	struct ofp_rt_rule key, *rule;
 	unsigned long low_index, high_index, tmp_index;
 
+	if (global_param->use_btree) {
+		struct ofp_rt_rule_btree_iter_arg_st btree_iter = {
+			vrf, func, iter_arg};
+
+		key.u1.s1.vrf = vrf;
+		key.u1.s1.addr = 0;
+		key.u1.s1.masklen = 0;
+		ofp_btree_iterate_from(shm->rt_rule_table.rule_tree, &key,
+				       ofp_rt_rule_btree_iter_helper,
+				       &btree_iter);
+		return;
+	}
+
 	/*
 	 * we iterate the section corresponding to the given vrf
 	 * instead of whole tree
@@ -437,10 +658,10 @@ static inline void inc_use_reference(struct ofp_rtl_node *node)
 	node->ref++;
 }
 
-static inline void dec_use_reference(struct ofp_rtl_node *node)
+static inline void dec_use_reference(struct ofp_rtl_node *node, uint16_t vrf)
 {
 	if (--node->ref == 0)
-		NODEFREE(node);
+		NODEFREE(node, vrf);
 }
 
 static inline uint32_t to_network_prefix(uint32_t addr_be, uint32_t masklen)
@@ -483,7 +704,21 @@ ofp_rtl_insert(struct ofp_rtl_tree *tree, uint32_t addr_be,
 {
 	struct ofp_rtl_node *node = tree->root;
 	uint32_t addr = to_network_prefix(addr_be, masklen);
-	uint32_t low = 0, high = IPV4_FIRST_LEVEL;
+	uint32_t low = 0, high = first_level;
+
+	/* The rule table counts the routes, a shadowed route is there */
+	if (VRF_ROUTES > 0 &&
+	    shm->vrf_usage[tree->vrf].routes >= (uint32_t)VRF_ROUTES &&
+	    !ofp_rt_rule_search(tree->vrf, addr_be, masklen)) {
+		OFP_ERR("VRF %u has its %d routes", tree->vrf, VRF_ROUTES);
+		return data;
+	}
+
+	if (node == shm->empty_root) {
+		if (root_alloc(tree))
+			return data;
+		node = tree->root;
+	}
 
 	for (; high <= IPV4_LENGTH; low = high, high += IPV4_LEVEL) {
 		inc_use_reference(node);
@@ -503,7 +738,7 @@ ofp_rtl_insert(struct ofp_rtl_tree *tree, uint32_t addr_be,
 
 		node = find_node(node, addr, low, high);
 
-		if (node->next == NULL && !(node->next = NODEALLOC())) {
+		if (node->next == NULL && !(node->next = NODEALLOC(tree->vrf))) {
 			OFP_ERR("NODEALLOC failed!");
 			return data;
 		}
@@ -520,12 +755,12 @@ ofp_rtl_insert(struct ofp_rtl_tree *tree, uint32_t addr_be,
 struct ofp_nh_entry *
 ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 {
-	struct ofp_rtl_node *elem, *node = tree->root;
+	struct ofp_rtl_node *elem, *table, *node = tree->root;
 	const uint32_t addr = to_network_prefix(addr_be, masklen);
 	struct ofp_nh_entry *data;
 	struct ofp_rt_rule *removing_rule;
 	struct ofp_rt_rule *insert_rule = NULL;
-	uint32_t low = 0, high = IPV4_FIRST_LEVEL;
+	uint32_t low = 0, high = first_level;
 
 	removing_rule = ofp_rt_rule_search(tree->vrf, addr_be, masklen);
 	if (removing_rule == NULL) {
@@ -534,9 +769,15 @@ ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 		return NULL;
 	}
 	data = &removing_rule->u1.s1.data[0];
+	if (node == shm->empty_root)
+		return NULL;
 
+	/*
+	 * A table is released only after its entries have been read, as
+	 * the free list link overwrites the next pointer of its first entry.
+	 */
 	for (; high <= IPV4_LENGTH ; low = high, high += IPV4_LEVEL) {
-		dec_use_reference(node);
+		table = node;
 
 		if (masklen <= high) {
 			uint32_t index = ip_range_begin(addr, masklen, low, high);
@@ -546,13 +787,13 @@ ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 				if (node[index].masklen == masklen &&
 				    !memcmp(&node[index].data, data,
 					    sizeof(struct ofp_nh_entry))) {
-					if (node[index].next == NULL &&
-						&node[index] != shm->free_small.last)
+					if (node[index].next == NULL)
 						node[index].masklen = 0;
 					else
 						node[index].masklen = high + 1;
 				}
 			}
+			dec_use_reference(table, tree->vrf);
 			/* if exists, re-insert previous route that was overwritten, after cleanup*/
 			insert_rule = ofp_rt_rule_find_prefix_match(tree->vrf, addr,
 														masklen, low);
@@ -561,17 +802,21 @@ ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 
 		elem = find_node(node, addr, low, high);
 
-		if (elem->masklen == 0)
+		if (elem->masklen == 0) {
+			dec_use_reference(table, tree->vrf);
 			return NULL;
+		}
 
 		node = elem->next;
 
-		if (get_use_reference(node) == 1 && elem->masklen > high) {
+		if (get_use_reference(node) == 1) {
 			/* next level will be freed so we update prefix_len to 0,
 			 * if there is no leaf stored on the current elem */
-			elem->masklen = 0;
+			if (elem->masklen > high)
+				elem->masklen = 0;
 			elem->next = NULL;
 		}
+		dec_use_reference(table, tree->vrf);
 	}
 	odp_mb_release();
 
@@ -580,6 +825,8 @@ ofp_rtl_remove(struct ofp_rtl_tree *tree, uint32_t addr_be, uint32_t masklen)
 			       odp_cpu_to_be_32(insert_rule->u1.s1.addr),
 			       insert_rule->u1.s1.masklen,
 			       &insert_rule->u1.s1.data[0]);
+	else if (get_use_reference(tree->root) == 0)
+		root_free(tree);
 
 	return data;
 }
@@ -590,7 +837,7 @@ struct ofp_nh_entry *ofp_rtl_search(struct ofp_rtl_tree *tree, uint32_t addr_be)
 	struct ofp_nh_entry *nh = NULL;
 	struct ofp_rtl_node *elem, *node = tree->root;
 	uint32_t addr = odp_be_to_cpu_32(addr_be);
-	uint32_t low = 0, high = IPV4_FIRST_LEVEL;
+	uint32_t low = 0, high = first_level;
 
 	for (; high <= IPV4_LENGTH ; low = high, high += IPV4_LEVEL) {
 		elem = find_node(node, addr, low, high);
@@ -607,9 +854,55 @@ struct ofp_nh_entry *ofp_rtl_search(struct ofp_rtl_tree *tree, uint32_t addr_be)
 	return nh;
 }
 
-struct ofp_nh6_entry *
-ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
-				uint32_t masklen, struct ofp_nh6_entry *data)
+/*
+ * Look up num addresses at once. The tables of one level are walked
+ * for all addresses before moving to the next level, and the entries
+ * are prefetched one pass ahead of their use so that the cache misses
+ * of different lookups overlap.
+ */
+void ofp_rtl_search_bulk(struct ofp_rtl_tree *tree, const uint32_t addr_be[],
+			 struct ofp_nh_entry *nh[], int num)
+{
+	struct ofp_rtl_node *node[num];
+	struct ofp_rtl_node *elem[num];
+	uint32_t addr[num];
+	uint32_t low = 0, high = first_level;
+	int i, active = num;
+
+	for (i = 0; i < num; i++) {
+		nh[i] = NULL;
+		node[i] = tree->root;
+		addr[i] = odp_be_to_cpu_32(addr_be[i]);
+	}
+
+	for (; high <= IPV4_LENGTH && active; low = high, high += IPV4_LEVEL) {
+		for (i = 0; i < num; i++) {
+			if (!node[i])
+				continue;
+			elem[i] = find_node(node[i], addr[i], low, high);
+			odp_prefetch(elem[i]);
+		}
+
+		for (i = 0; i < num; i++) {
+			if (!node[i])
+				continue;
+
+			if (elem[i]->masklen == 0) {
+				node[i] = NULL;
+				active--;
+				continue;
+			} else if (elem[i]->masklen <= high)
+				nh[i] = &elem[i]->data[0];
+
+			if ((node[i] = elem[i]->next) == NULL)
+				active--;
+		}
+	}
+}
+
+static struct ofp_nh6_entry *
+rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
+	    uint32_t masklen, struct ofp_nh6_entry *data)
 {
 	struct ofp_rtl6_node  *node;
 	struct ofp_rtl6_node  *last = NULL;
@@ -704,8 +997,8 @@ ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
 	return data;
 }
 
-struct ofp_nh6_entry *
-ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
+static struct ofp_nh6_entry *
+rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
 {
 	struct ofp_rtl6_node  *node;
 	struct ofp_rtl6_node **stack = shm->global_stack6;
@@ -767,6 +1060,27 @@ ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
 	return data;
 }
 
+struct ofp_nh6_entry *
+ofp_rtl_insert6(struct ofp_rtl6_tree *tree, uint8_t *addr,
+		uint32_t masklen, struct ofp_nh6_entry *data)
+{
+	struct ofp_nh6_entry *ret = rtl_insert6(tree, addr, masklen, data);
+
+	if (!ret)
+		(void)ofp_rtl6_mtrie_insert(tree, addr, masklen);
+	return ret;
+}
+
+struct ofp_nh6_entry *
+ofp_rtl_remove6(struct ofp_rtl6_tree *tree, uint8_t *addr, uint32_t masklen)
+{
+	struct ofp_nh6_entry *ret = rtl_remove6(tree, addr, masklen);
+
+	if (ret)
+		(void)ofp_rtl6_mtrie_remove(tree, addr, masklen);
+	return ret;
+}
+
 void ofp_rtl_traverse6(int fd, struct ofp_rtl6_tree *tree,
 					   void (*func)(int fd, uint8_t *key, int level, struct ofp_nh6_entry *data))
 {
@@ -809,10 +1123,37 @@ void ofp_rtl_traverse6(int fd, struct ofp_rtl6_tree *tree,
 
 void ofp_print_rt_stat(int fd)
 {
+	int i;
+	uint64_t small = sizeof(struct ofp_rtl_node) * SMALL_NODE;
+	uint64_t large = sizeof(struct ofp_rtl_node) *
+		((uint64_t)1 << first_level);
+
 	ofp_sendf(fd, "rt tree alloc now=%d max=%d total=%d\r\n",
-			  shm->nodes_allocated, shm->max_nodes_allocated, NUM_NODES);
+			  shm->nodes_allocated, shm->max_nodes_allocated,
+			  shm->nodes_total);
+	ofp_sendf(fd, "rt tree memory first level=%d vrfs=%d/%d large used=%"
+		  PRIu64 " KB total=%" PRIu64 " KB small used=%" PRIu64
+		  " KB total=%" PRIu64 " KB segments=%d/%d\r\n",
+		  first_level, shm->large_allocated, NUM_NODES_LARGE,
+		  large * shm->large_allocated / 1024,
+		  large * NUM_NODES_LARGE / 1024,
+		  small * shm->nodes_allocated / 1024,
+		  small * shm->nodes_total / 1024,
+		  shm->num_segments, MAX_SEGMENTS);
+	for (i = 0; i < NUM_VRF; i++) {
+		struct rt_vrf_usage *usage = &shm->vrf_usage[i];
+
+		if (!usage->routes && !usage->max_nodes)
+			continue;
+		ofp_sendf(fd, "rt vrf %d routes=%u/%d nodes now=%u max=%u"
+			  "/%d memory=%" PRIu64 " KB\r\n", i, usage->routes,
+			  VRF_ROUTES, usage->nodes, usage->max_nodes, VRF_NODES,
+			  ((usage->routes ? large : 0) +
+			   small * usage->nodes) / 1024);
+	}
 	ofp_sendf(fd, "rt6 tree alloc now=%d max=%d total=%d\r\n",
 			  shm->nodes_allocated6, shm->max_nodes_allocated6, NUM_NODES_6);
+	ofp_print_rt6_mtrie_stat(fd);
 	ofp_sendf(fd, "rt rule alloc now=%d max=%d total=%d\r\n",
 			  shm->rt_rule_table.rule_allocated,
 			  shm->rt_rule_table.max_rule_allocated, NUM_RT_RULES);
@@ -847,6 +1188,7 @@ int ofp_rt_lookup_lookup_shared_memory(void)
 		OFP_ERR("ofp_shared_memory_lookup failed");
 		return -1;
 	}
+	first_level = shm->first_level;
 
 	return 0;
 }
@@ -867,17 +1209,24 @@ int ofp_rt_lookup_init_global(void)
 	shm->small_list = (struct ofp_rtl_node *)((char *)shm+sizeof(*shm));
 	shm->large_list = (struct ofp_rtl_node *)((char *)shm->small_list+SIZEOF_SMALL_LIST);
 	shm->rt_rule_table.rules = (struct ofp_rt_rule *)((char *)shm->large_list+SIZEOF_LARGE_LIST);
+	shm->vrf_usage = (struct rt_vrf_usage *)(shm->rt_rule_table.rules + NUM_RT_RULES);
 
-	for (i = 0; i < NUM_NODES; i++)
-		shm->small_list[i * SMALL_NODE].next = (i == NUM_NODES - 1) ?
-			NULL : &(shm->small_list[(i + 1) * SMALL_NODE]);
-	shm->free_small.first = &shm->small_list[0];
-	shm->free_small.last = &shm->small_list[(NUM_NODES - 1) * SMALL_NODE];
+	if (first_level_param() != (uint32_t)global_param->mtrie.first_level)
+		OFP_WARN("Invalid mtrie first level %d, using %d",
+			 global_param->mtrie.first_level, IPV4_FIRST_LEVEL);
+	shm->first_level = first_level_param();
+	first_level = shm->first_level;
+	shm->segment_nodes = NUM_NODES_GROW;
+	if (NUM_NODES > 0)
+		small_list_init(shm->small_list, NUM_NODES);
 
 	for (i = 0; i < NUM_NODES_LARGE; i++)
 		shm->large_list[i * LARGE_NODE].next = (i == NUM_NODES_LARGE - 1) ?
 			NULL : &(shm->large_list[(i + 1) * LARGE_NODE]);
 	shm->free_large = shm->large_list;
+	/* Only read, the memset above leaves all its entries empty */
+	shm->empty_root = &shm->large_list[NUM_NODES_LARGE * LARGE_NODE];
+	shm->empty_root->root = 1;
 
 	for (i = 0; i < NUM_NODES_6; i++) {
 		shm->node_list6[i].left = (i == 0) ?
@@ -891,19 +1240,37 @@ int ofp_rt_lookup_init_global(void)
 		shm->rt_rule_table.rules[i].u1.next = (i == NUM_RT_RULES - 1) ?
 			NULL : &(shm->rt_rule_table.rules[i+1]);
 	shm->rt_rule_table.free_rule = &(shm->rt_rule_table.rules[0]);
-	shm->rt_rule_table.rule_tree = avl_tree_new(rt_rules_avl_compare, NULL);
+	if (global_param->use_btree)
+		shm->rt_rule_table.rule_tree =
+			ofp_btree_new(rt_rules_avl_compare, NULL);
+	else
+		shm->rt_rule_table.rule_tree =
+			avl_tree_new(rt_rules_avl_compare, NULL);
 
 	return 0;
 }
 
 int ofp_rt_lookup_term_global(void)
 {
-	int rc = 0;
+	int i, rc = 0;
 
 	if (ofp_rt_lookup_lookup_shared_memory())
 		return -1;
 
-	avl_tree_free(shm->rt_rule_table.rule_tree, NULL);
+	for (i = 0; i < shm->num_segments; i++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), SHM_NAME_RT_LOOKUP_SEGMENT, i);
+		if (ofp_shared_memory_free(name) == -1) {
+			OFP_ERR("ofp_shared_memory_free failed");
+			rc = -1;
+		}
+	}
+
+	if (global_param->use_btree)
+		ofp_btree_free(shm->rt_rule_table.rule_tree, NULL);
+	else
+		avl_tree_free(shm->rt_rule_table.rule_tree, NULL);
 	CHECK_ERROR(ofp_rt_lookup_free_shared_memory(), rc);
 
 	return rc;
@@ -0,0 +1,556 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * sFlow v5 flow samples of raw packet headers. Sampling costs a thread
+ * local countdown per packet. The exporter sends the datagrams with a
+ * Linux UDP socket, the collector is reached through the host stack.
+ * A sample that finds its ring full is counted in the drops of the
+ * following samples.
+ *
+ * The exporter also counts the samples of received IPv4 packets per
+ * source address in a small space-saving table, and publishes the
+ * largest sources once per window for 'stat top'.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <odp/helper/odph_api.h>
+
+#include "ofpi.h"
+#include "ofpi_sflow.h"
+#include "ofpi_portconf.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+
+#define SHM_NAME_SFLOW "OfpSflowShMem"
+#define SFLOW_RING_MASK (OFP_SFLOW_RING_SIZE - 1)
+
+ODP_STATIC_ASSERT((OFP_SFLOW_RING_SIZE & SFLOW_RING_MASK) == 0,
+		  "OFP_SFLOW_RING_SIZE not a power of two");
+
+/* Datagrams stay below a 1500 byte MTU */
+#define SFLOW_DATAGRAM_MAX 1400
+/* A datagram not yet full is sent after this time */
+#define SFLOW_FLUSH_NS (250 * 1000000ULL)
+/* Idle sleep of the exporter thread */
+#define SFLOW_EXPORTER_IDLE_US 1000
+/* Window of the published top talkers */
+#define SFLOW_TALKER_WINDOW_NS 1000000000ULL
+
+#define SFLOW_VERSION 5
+#define SFLOW_ADDR_IPV4 1
+#define SFLOW_FLOW_SAMPLE 1
+#define SFLOW_RAW_HEADER 1
+#define SFLOW_PROTO_ETHERNET 1
+
+struct sflow_slot {
+	uint32_t len;
+	uint16_t caplen;
+	uint8_t port;
+	uint8_t dir;
+	uint8_t data[OFP_SFLOW_HEADER_MAX];
+};
+
+struct sflow_ring {
+	/* Written by the sampling thread */
+	uint32_t head ODP_ALIGNED_CACHE;
+	uint64_t drops;
+	/* Written by the exporter thread */
+	uint32_t tail ODP_ALIGNED_CACHE;
+	struct sflow_slot slot[OFP_SFLOW_RING_SIZE] ODP_ALIGNED_CACHE;
+};
+
+struct ofp_sflow_mem {
+	uint32_t rate;
+	uint32_t header_len;
+
+	/* Exporter state */
+	odph_thread_t exporter;
+	int exporter_run;
+	int exporter_started;
+	int sock;
+	struct sockaddr_in collector;
+	uint32_t agent;
+	uint64_t start_ns;
+	uint64_t first_ns;
+	uint32_t datagram_seq;
+	/* NUM_PORTS entries each, after the rings */
+	uint32_t *sample_seq;
+	uint32_t *sample_pool;
+	uint8_t buf[SFLOW_DATAGRAM_MAX];
+	uint32_t buf_len;
+	uint32_t buf_samples;
+
+	/* Sources of the current window, exporter only */
+	struct ofp_sflow_talker talker[OFP_SFLOW_TALKERS];
+	int num_talker;
+	uint64_t talker_start_ns;
+	/* Last completed window, written under top_seq */
+	uint32_t top_seq;
+	int num_top;
+	uint64_t top_window_ns;
+	struct ofp_sflow_talker top[OFP_SFLOW_TALKERS];
+
+	int num_ring;
+	struct sflow_ring ring[];
+};
+
+static __thread struct ofp_sflow_mem *shm;
+static __thread struct sflow_ring *sflow_ring;
+static __thread uint32_t sflow_rand;
+
+__thread uint32_t ofp_sflow_skip[2];
+
+static uint64_t sflow_shm_size(int num_ring)
+{
+	return sizeof(struct ofp_sflow_mem) +
+		(uint64_t)num_ring * sizeof(struct sflow_ring) +
+		2 * NUM_PORTS * sizeof(uint32_t);
+}
+
+/* Uniform in 1..2*rate-1, mean rate */
+static inline uint32_t sflow_next_skip(void)
+{
+	sflow_rand ^= sflow_rand << 13;
+	sflow_rand ^= sflow_rand >> 17;
+	sflow_rand ^= sflow_rand << 5;
+
+	return 1 + sflow_rand % (2 * shm->rate - 1);
+}
+
+/*
+ * Sample, called on the packet path
+ */
+void ofp_sflow_sample(odp_packet_t pkt, int port, int dir)
+{
+	struct sflow_ring *ring = sflow_ring;
+	struct sflow_slot *slot;
+	uint32_t head, len;
+
+	ofp_sflow_skip[dir] = sflow_next_skip();
+
+	head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+	    OFP_SFLOW_RING_SIZE) {
+		__atomic_store_n(&ring->drops, ring->drops + 1,
+				 __ATOMIC_RELAXED);
+		return;
+	}
+
+	slot = &ring->slot[head & SFLOW_RING_MASK];
+	len = odp_packet_len(pkt);
+	slot->len = len;
+	slot->caplen = len < shm->header_len ? len : shm->header_len;
+	slot->port = port;
+	slot->dir = dir;
+	odp_packet_copy_to_mem(pkt, 0, slot->caplen, slot->data);
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * sFlow v5 output, done by the exporter thread
+ */
+static void put32(uint32_t v)
+{
+	uint32_t be = odp_cpu_to_be_32(v);
+
+	memcpy(&shm->buf[shm->buf_len], &be, sizeof(be));
+	shm->buf_len += sizeof(be);
+}
+
+static void sflow_datagram_start(void)
+{
+	shm->buf_len = 0;
+	shm->buf_samples = 0;
+	put32(SFLOW_VERSION);
+	put32(SFLOW_ADDR_IPV4);
+	memcpy(&shm->buf[shm->buf_len], &shm->agent, sizeof(shm->agent));
+	shm->buf_len += sizeof(shm->agent);
+	put32(0);		/* Sub agent id */
+	put32(0);		/* Sequence number, set when sent */
+	put32(0);		/* Uptime, set when sent */
+	put32(0);		/* Number of samples, set when sent */
+}
+
+static void sflow_datagram_send(void)
+{
+	uint32_t *hdr = (uint32_t *)shm->buf;
+	uint64_t now = odp_time_local_ns();
+
+	if (!shm->buf_samples)
+		return;
+
+	hdr[4] = odp_cpu_to_be_32(shm->datagram_seq++);
+	hdr[5] = odp_cpu_to_be_32((now - shm->start_ns) / 1000000);
+	hdr[6] = odp_cpu_to_be_32(shm->buf_samples);
+
+	if (sendto(shm->sock, shm->buf, shm->buf_len, 0,
+		   (struct sockaddr *)&shm->collector,
+		   sizeof(shm->collector)) < 0)
+		OFP_DBG("sFlow datagram not sent");
+
+	sflow_datagram_start();
+}
+
+#define SFLOW_SAMPLE_LEN(caplen) (8 * 4 + 2 * 4 + 4 * 4 + \
+				  (((caplen) + 3) & ~3u))
+
+static void sflow_put_sample(const struct sflow_slot *slot, uint32_t drops)
+{
+	uint32_t ifindex = slot->port + 1;
+	uint32_t pad = ((slot->caplen + 3) & ~3u) - slot->caplen;
+
+	if (shm->buf_len + 8 + SFLOW_SAMPLE_LEN(slot->caplen) >
+	    SFLOW_DATAGRAM_MAX)
+		sflow_datagram_send();
+	if (!shm->buf_samples)
+		shm->first_ns = odp_time_local_ns();
+
+	shm->sample_pool[slot->port] += shm->rate;
+
+	put32(SFLOW_FLOW_SAMPLE);
+	put32(SFLOW_SAMPLE_LEN(slot->caplen));
+	put32(++shm->sample_seq[slot->port]);
+	put32(ifindex);		/* Source id: ifIndex type 0 */
+	put32(shm->rate);
+	put32(shm->sample_pool[slot->port]);
+	put32(drops);
+	put32(slot->dir == OFP_SFLOW_RX ? ifindex : 0);
+	put32(slot->dir == OFP_SFLOW_TX ? ifindex : 0);
+	put32(1);		/* Records */
+
+	put32(SFLOW_RAW_HEADER);
+	put32(4 * 4 + slot->caplen + pad);
+	put32(SFLOW_PROTO_ETHERNET);
+	put32(slot->len);
+	put32(0);		/* Stripped */
+	put32(slot->caplen);
+	memcpy(&shm->buf[shm->buf_len], slot->data, slot->caplen);
+	memset(&shm->buf[shm->buf_len + slot->caplen], 0, pad);
+	shm->buf_len += slot->caplen + pad;
+
+	shm->buf_samples++;
+}
+
+/*
+ * Top talkers. A source not in a full table replaces the smallest one
+ * and inherits its counts, so that the counts are upper bounds and the
+ * largest sources stay in the table.
+ */
+static void sflow_talker_count(const struct sflow_slot *slot)
+{
+	struct ofp_sflow_talker *t, *min = NULL;
+	uint32_t off = OFP_ETHER_HDR_LEN;
+	uint16_t type;
+	uint32_t addr;
+	int i;
+
+	if (slot->dir != OFP_SFLOW_RX || slot->caplen < OFP_ETHER_HDR_LEN)
+		return;
+
+	type = slot->data[12] << 8 | slot->data[13];
+	if (type == OFP_ETHERTYPE_VLAN && slot->caplen >= off + 4) {
+		type = slot->data[16] << 8 | slot->data[17];
+		off += 4;
+	}
+	if (type != OFP_ETHERTYPE_IP || slot->caplen < off + 16)
+		return;
+	memcpy(&addr, &slot->data[off + 12], sizeof(addr));
+
+	for (i = 0; i < shm->num_talker; i++) {
+		t = &shm->talker[i];
+		if (t->addr == addr)
+			goto found;
+		if (!min || t->pkts < min->pkts)
+			min = t;
+	}
+	if (shm->num_talker < OFP_SFLOW_TALKERS) {
+		t = &shm->talker[shm->num_talker++];
+		t->pkts = 0;
+		t->bytes = 0;
+	} else {
+		t = min;
+	}
+	t->addr = addr;
+found:
+	t->pkts += shm->rate;
+	t->bytes += (uint64_t)slot->len * shm->rate;
+}
+
+static void sflow_talkers_publish(uint64_t now)
+{
+	struct ofp_sflow_talker tmp;
+	int i, j;
+
+	/* Largest first */
+	for (i = 1; i < shm->num_talker; i++) {
+		tmp = shm->talker[i];
+		for (j = i; j > 0 && shm->talker[j - 1].pkts < tmp.pkts; j--)
+			shm->talker[j] = shm->talker[j - 1];
+		shm->talker[j] = tmp;
+	}
+
+	__atomic_store_n(&shm->top_seq, shm->top_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(shm->top, shm->talker, shm->num_talker * sizeof(shm->top[0]));
+	shm->num_top = shm->num_talker;
+	shm->top_window_ns = now - shm->talker_start_ns;
+	__atomic_store_n(&shm->top_seq, shm->top_seq + 1, __ATOMIC_RELEASE);
+
+	shm->num_talker = 0;
+	shm->talker_start_ns = now;
+}
+
+int ofp_sflow_top_talkers(struct ofp_sflow_talker *t, int num,
+			  uint64_t *window_ns)
+{
+	uint32_t seq;
+	int n;
+
+	if (!shm)
+		return -1;
+
+	do {
+		while ((seq = __atomic_load_n(&shm->top_seq,
+					      __ATOMIC_ACQUIRE)) & 1)
+			;
+		n = shm->num_top < num ? shm->num_top : num;
+		memcpy(t, shm->top, n * sizeof(*t));
+		*window_ns = shm->top_window_ns;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&shm->top_seq, __ATOMIC_RELAXED) != seq);
+
+	return n;
+}
+
+/* Export the queued samples of all threads, return their number */
+static int sflow_flush(void)
+{
+	struct sflow_ring *ring;
+	struct sflow_slot *slot;
+	uint32_t head, tail;
+	uint64_t drops = 0;
+	uint64_t now;
+	int i, n = 0;
+
+	for (i = 0; i < shm->num_ring; i++)
+		drops += __atomic_load_n(&shm->ring[i].drops,
+					 __ATOMIC_RELAXED);
+
+	for (i = 0; i < shm->num_ring; i++) {
+		ring = &shm->ring[i];
+		head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+		tail = ring->tail;
+
+		for (; tail != head; tail++, n++) {
+			slot = &ring->slot[tail & SFLOW_RING_MASK];
+			sflow_put_sample(slot, (uint32_t)drops);
+			sflow_talker_count(slot);
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+	}
+
+	now = odp_time_local_ns();
+	if (now - shm->talker_start_ns >= SFLOW_TALKER_WINDOW_NS)
+		sflow_talkers_publish(now);
+
+	if (shm->buf_samples && now - shm->first_ns >= SFLOW_FLUSH_NS)
+		sflow_datagram_send();
+
+	return n;
+}
+
+static int sflow_exporter(void *arg)
+{
+	shm = arg;
+
+	sflow_datagram_start();
+	while (__atomic_load_n(&shm->exporter_run, __ATOMIC_ACQUIRE)) {
+		if (!sflow_flush())
+			usleep(SFLOW_EXPORTER_IDLE_US);
+	}
+	sflow_flush();
+	sflow_datagram_send();
+
+	return 0;
+}
+
+int ofp_sflow_start_exporter(const odp_cpumask_t *cpumask)
+{
+	odph_thread_common_param_t common_param;
+	odph_thread_param_t thr_params;
+
+	if (!shm)
+		return 0;
+
+	odph_thread_common_param_init(&common_param);
+	common_param.cpumask = cpumask;
+	odph_thread_param_init(&thr_params);
+	thr_params.start = sflow_exporter;
+	thr_params.arg = shm;
+	thr_params.thr_type = ODP_THREAD_CONTROL;
+
+	shm->exporter_run = 1;
+	if (odph_thread_create(&shm->exporter, &common_param, &thr_params,
+			       1) != 1) {
+		OFP_ERR("Failed to start sFlow exporter thread.");
+		shm->exporter_run = 0;
+		return -1;
+	}
+	shm->exporter_started = 1;
+
+	return 0;
+}
+
+void ofp_sflow_stop_exporter(void)
+{
+	if (!shm || !shm->exporter_started)
+		return;
+
+	__atomic_store_n(&shm->exporter_run, 0, __ATOMIC_RELEASE);
+	odph_thread_join(&shm->exporter, 1);
+	shm->exporter_started = 0;
+}
+
+int ofp_sflow_init_local(void)
+{
+	int thr = odp_thread_id();
+
+	ofp_sflow_skip[OFP_SFLOW_RX] = 0;
+	ofp_sflow_skip[OFP_SFLOW_TX] = 0;
+	sflow_ring = NULL;
+
+	if (!shm || thr < 0 || thr >= shm->num_ring)
+		return 0;
+
+	sflow_ring = &shm->ring[thr];
+	sflow_rand = 0x9e3779b9 * (uint32_t)(thr + 1) ^
+		(uint32_t)odp_time_local_ns();
+	if (!sflow_rand)
+		sflow_rand = 1;
+	ofp_sflow_skip[OFP_SFLOW_RX] = sflow_next_skip();
+	ofp_sflow_skip[OFP_SFLOW_TX] = sflow_next_skip();
+
+	return 0;
+}
+
+static int sflow_enabled(void)
+{
+	return global_param->sflow.rate > 0 && global_param->sflow.collector;
+}
+
+static int ofp_sflow_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_SFLOW,
+				      sflow_shm_size(odp_thread_count_max()));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_sflow_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_SFLOW) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_sflow_lookup_shared_memory(void)
+{
+	if (!sflow_enabled())
+		return 0;
+
+	shm = ofp_shared_memory_lookup(SHM_NAME_SFLOW);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_sflow_init_prepare(void)
+{
+	if (sflow_enabled())
+		ofp_shared_memory_prealloc(SHM_NAME_SFLOW,
+					   sflow_shm_size(odp_thread_count_max()));
+}
+
+int ofp_sflow_init_global(void)
+{
+	int header_len = global_param->sflow.header_len;
+
+	if (!sflow_enabled())
+		return 0;
+
+	HANDLE_ERROR(ofp_sflow_alloc_shared_memory());
+
+	memset(shm, 0, sflow_shm_size(odp_thread_count_max()));
+	shm->num_ring = odp_thread_count_max();
+	shm->sample_seq = (uint32_t *)&shm->ring[shm->num_ring];
+	shm->sample_pool = shm->sample_seq + NUM_PORTS;
+	shm->rate = global_param->sflow.rate;
+	if (header_len <= 0 || header_len > OFP_SFLOW_HEADER_MAX)
+		header_len = OFP_SFLOW_HEADER_MAX;
+	shm->header_len = header_len;
+	shm->start_ns = odp_time_local_ns();
+	shm->talker_start_ns = shm->start_ns;
+
+	shm->collector.sin_family = AF_INET;
+	shm->collector.sin_port = htons(global_param->sflow.port);
+	if (inet_pton(AF_INET, global_param->sflow.collector,
+		      &shm->collector.sin_addr) != 1) {
+		OFP_ERR("Invalid sFlow collector %s",
+			global_param->sflow.collector);
+		return -1;
+	}
+	if (global_param->sflow.agent &&
+	    inet_pton(AF_INET, global_param->sflow.agent, &shm->agent) != 1) {
+		OFP_ERR("Invalid sFlow agent %s", global_param->sflow.agent);
+		return -1;
+	}
+
+	shm->sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if (shm->sock < 0) {
+		OFP_ERR("sFlow socket failed");
+		return -1;
+	}
+
+	OFP_INFO("sFlow: 1 in %u packets to %s:%d", shm->rate,
+		 global_param->sflow.collector, global_param->sflow.port);
+	return 0;
+}
+
+int ofp_sflow_term_global(void)
+{
+	int rc = 0;
+
+	if (!sflow_enabled())
+		return 0;
+
+	if (ofp_sflow_lookup_shared_memory())
+		return -1;
+
+	if (shm->sock >= 0)
+		close(shm->sock);
+
+	CHECK_ERROR(ofp_sflow_free_shared_memory(), rc);
+
+	return rc;
+}
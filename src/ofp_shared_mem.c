@@ -10,6 +10,7 @@
 #include "ofpi_shared_mem.h"
 #include "ofpi_odp_compat.h"
 #include "ofp_log.h"
+#include "ofpi_util.h"
 
 #define SHM_NAME_COMMON "OfpCommon"
 #define SHM_NAME_INTERNAL "OfpShmInternal"
@@ -31,6 +32,7 @@
 struct ofp_shm_block {
 	int valid : 1;      /* This entry represents a valid (pre)allocation */
 	int allocated : 1;  /* The block has been allocated */
+	int raw : 1;        /* Separate block from the raw allocator */
 	uint64_t size;      /* Actual size of the block */
 	uint64_t offset;    /* Offset of the block from the start of the SHM */
 	char name[OFP_SHM_NAME_LEN];
@@ -48,8 +50,15 @@ static void *allocate_shared_memory(const char *name, uint64_t size)
 	odp_shm_t shm_h;
 	void *shm;
 
+	/*
+	 * Huge pages keep the TLB misses of the socket, PCB and route
+	 * tables down. Without enough of them, take normal pages.
+	 */
 	shm_h = odp_shm_reserve(name, size, ODP_CACHE_LINE_SIZE,
-				OFP_SHM_SINGLE_VA);
+				OFP_SHM_SINGLE_VA | OFP_SHM_HP);
+	if (shm_h == ODP_SHM_INVALID && OFP_SHM_HP)
+		shm_h = odp_shm_reserve(name, size, ODP_CACHE_LINE_SIZE,
+					OFP_SHM_SINGLE_VA);
 	if (shm_h == ODP_SHM_INVALID)
 		return NULL;
 
@@ -135,7 +144,8 @@ int ofp_shared_memory_term_global(void)
 	int ret = 0;
 
 	for (n = 0; n < OFP_SHM_BLOCKS_MAX; n++) {
-		if (shm && shm->block[n].valid && shm->block[n].allocated) {
+		if (shm && shm->block[n].valid && shm->block[n].allocated &&
+		    !shm->block[n].raw) {
 			OFP_ERR("Shared memory block \"%s\" not freed,"
 				"cannot free common shared memory",
 				shm->block[n].name);
@@ -163,11 +173,58 @@ static struct ofp_shm_block *ofp_shm_block_find(const char *name)
 	int n;
 
 	for (n = 0; n < OFP_SHM_BLOCKS_MAX; n++)
-		if (shm->block[n].valid && !strcmp(shm->block[n].name, name))
+		if (shm->block[n].valid && !shm->block[n].raw &&
+		    !strcmp(shm->block[n].name, name))
 			return &shm->block[n];
 	return NULL;
 }
 
+/*
+ * Remember a block of the raw allocator for ofp_shared_memory_print().
+ * Entries of freed blocks are reused.
+ */
+static void raw_block_add(const char *name, uint64_t size)
+{
+	struct ofp_shm_block *block = NULL;
+	int n;
+
+	if (!shm)
+		return;
+
+	for (n = 0; n < shm->next_free; n++)
+		if (!shm->block[n].valid) {
+			block = &shm->block[n];
+			break;
+		}
+	if (!block) {
+		if (shm->next_free >= OFP_SHM_BLOCKS_MAX)
+			return;
+		block = &shm->block[shm->next_free++];
+	}
+	block->valid = 1;
+	block->allocated = 1;
+	block->raw = 1;
+	block->size = size;
+	block->offset = 0;
+	strncpy(block->name, name, sizeof(block->name));
+	block->name[sizeof(block->name) - 1] = 0;
+}
+
+static void raw_block_del(const char *name)
+{
+	int n;
+
+	if (!shm)
+		return;
+
+	for (n = 0; n < shm->next_free; n++)
+		if (shm->block[n].valid && shm->block[n].raw &&
+		    !strcmp(shm->block[n].name, name)) {
+			shm->block[n].valid = 0;
+			return;
+		}
+}
+
 void ofp_shared_memory_prealloc(const char *name, uint64_t size)
 {
 	struct ofp_shm_block *block;
@@ -195,6 +252,7 @@ void ofp_shared_memory_prealloc(const char *name, uint64_t size)
 	block = &shm->block[shm->next_free++];
 	block->valid = 1;
 	block->allocated = 0;
+	block->raw = 0;
 	strncpy(block->name, name, sizeof(block->name));
 	block->name[sizeof(block->name) - 1] = 0;
 
@@ -309,6 +367,8 @@ void *ofp_shared_memory_alloc(const char *name, uint64_t size)
 	if (!ret) {
 		OFP_DBG_SHM("Falling back to raw allocator");
 		ret = ofp_shared_memory_alloc_raw(name, size);
+		if (ret)
+			raw_block_add(name, size);
 	}
 
 	if (!ret)
@@ -345,9 +405,44 @@ int ofp_shared_memory_free(const char *name)
 	if (ret) {
 		OFP_DBG_SHM("Falling back to raw allocator");
 		ret = ofp_shared_memory_free_raw(name);
+		if (!ret)
+			raw_block_del(name);
 	}
 
 	if (ret)
 		OFP_ERR("Freeing shared memory failed: name: %s", name);
 	return ret;
 }
+
+void ofp_shared_memory_print(int fd)
+{
+	uint64_t used = 0, raw = 0;
+	int n;
+
+	if (!shm)
+		return;
+
+	ofp_sendf(fd, "%-40s %12s %12s %s\r\n", "Shared memory block",
+		  "Size", "Offset", "State");
+	for (n = 0; n < shm->next_free; n++) {
+		struct ofp_shm_block *block = &shm->block[n];
+
+		if (!block->valid)
+			continue;
+		if (block->raw) {
+			raw += block->size;
+			ofp_sendf(fd, "%-40s %12" PRIu64 " %12s %s\r\n",
+				  block->name, block->size, "-", "separate");
+			continue;
+		}
+		if (block->allocated)
+			used += block->size;
+		ofp_sendf(fd, "%-40s %12" PRIu64 " %12" PRIu64 " %s\r\n",
+			  block->name, block->size, block->offset,
+			  block->allocated ? "allocated" : "reserved");
+	}
+	ofp_sendf(fd, "shm common total=%" PRIu64 " KB allocated=%" PRIu64
+		  " KB separate=%" PRIu64 " KB blocks=%d/%d\r\n",
+		  shm->total_size / 1024, used / 1024, raw / 1024,
+		  shm->next_free, OFP_SHM_BLOCKS_MAX);
+}
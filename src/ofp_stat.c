@@ -7,6 +7,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include <odp_api.h>
 
@@ -14,18 +15,146 @@
 #include "ofpi_log.h"
 #include "ofpi_stat.h"
 #include "ofpi_util.h"
+#include "ofpi_init.h"
+#include "ofpi_portconf.h"
+#include "ofpi_shared_mem.h"
+#include "ofpi_uma.h"
+#include "ofpi_avl.h"
+#include "ofpi_btree.h"
+#include "ofpi_rt_lookup.h"
+#include "ofpi_mem_pressure.h"
+#include "ofpi_pkt_processing.h"
 
 #define SHM_NAME_STAT "OfpStatShMem"
+#define SHM_NAME_IF_STAT "OfpIfStatShMem"
 
 
 typedef struct {
-	struct ofp_packet_stat ofp_packet_statistics;
 	struct ofp_perf_stat ofp_perf_stat;
 	odp_time_t prev_poll;
+	/* Last, per_thr[] follows */
+	struct ofp_packet_stat ofp_packet_statistics;
 } stat_shm_t;
 
+#define STAT_SHM_SIZE (sizeof(stat_shm_t) + odp_thread_count_max() * \
+		       sizeof(shm_stat->ofp_packet_statistics.per_thr[0]))
+
 static __thread stat_shm_t *shm_stat;
 
+/*
+ * Interface counters: a block per thread of num_ifnet ifnet counters
+ * followed by the queue counters of the fast path ports.
+ */
+typedef struct {
+	uint32_t num_thread;
+	uint32_t num_ifnet;
+	uint64_t thread_size;
+	uint8_t data[] ODP_ALIGNED_CACHE;
+} if_stat_shm_t;
+
+static __thread if_stat_shm_t *shm_if_stat;
+
+__thread struct ofp_if_stat *ofp_if_stat_thr;
+__thread struct ofp_if_stat *ofp_ifq_stat_thr;
+__thread uint8_t ofp_drop_last;
+
+#define IF_STAT_NUM_IFNET \
+	(NUM_PORTS + (global_param ? global_param->num_vlan : 0))
+#define IF_STAT_NUM_QUEUE (FP_PORTS * OFP_IFQ_STAT_MAX)
+#define IF_STAT_THREAD_SIZE \
+	ROUNDUP_CACHE((IF_STAT_NUM_IFNET + IF_STAT_NUM_QUEUE) * \
+		      sizeof(struct ofp_if_stat))
+#define IF_STAT_SHM_SIZE (sizeof(if_stat_shm_t) + \
+			  odp_thread_count_max() * IF_STAT_THREAD_SIZE)
+
+static struct ofp_if_stat *if_stat_block(uint32_t thr)
+{
+	return (struct ofp_if_stat *)(shm_if_stat->data +
+				      thr * shm_if_stat->thread_size);
+}
+
+static void if_stat_init_local(void)
+{
+	int thr = odp_thread_id();
+
+	ofp_if_stat_thr = NULL;
+	ofp_ifq_stat_thr = NULL;
+	if (!shm_if_stat || thr < 0 || (uint32_t)thr >= shm_if_stat->num_thread)
+		return;
+
+	ofp_if_stat_thr = if_stat_block(thr);
+	ofp_ifq_stat_thr = ofp_if_stat_thr + shm_if_stat->num_ifnet;
+}
+
+static void if_stat_add(struct ofp_if_stat *sum, const struct ofp_if_stat *s)
+{
+	sum->rx_pkts += __atomic_load_n(&s->rx_pkts, __ATOMIC_RELAXED);
+	sum->rx_bytes += __atomic_load_n(&s->rx_bytes, __ATOMIC_RELAXED);
+	sum->tx_pkts += __atomic_load_n(&s->tx_pkts, __ATOMIC_RELAXED);
+	sum->tx_bytes += __atomic_load_n(&s->tx_bytes, __ATOMIC_RELAXED);
+}
+
+int ofp_get_if_statistics(int port, uint16_t vlan, struct ofp_if_stat *st)
+{
+	struct ofp_ifnet *ifnet;
+	uint32_t thr;
+
+	memset(st, 0, sizeof(*st));
+
+	ifnet = ofp_get_ifnet(port, vlan);
+	if (!ifnet || !shm_if_stat || ifnet->stat_idx >= shm_if_stat->num_ifnet)
+		return -1;
+
+	for (thr = 0; thr < shm_if_stat->num_thread; thr++)
+		if_stat_add(st, &if_stat_block(thr)[ifnet->stat_idx]);
+
+	return 0;
+}
+
+int ofp_get_if_queue_statistics(int port, struct ofp_if_stat queue[],
+				int num)
+{
+	struct ofp_ifnet *ifnet;
+	struct ofp_if_stat *q;
+	uint32_t thr;
+	int i;
+
+	if (!shm_if_stat || port < 0 || port >= FP_PORTS)
+		return -1;
+
+	ifnet = ofp_get_ifnet(port, 0);
+	if (!ifnet)
+		return -1;
+
+	if (num > (int)ifnet->in_queue_num && num > (int)ifnet->out_queue_num)
+		num = ifnet->in_queue_num > ifnet->out_queue_num ?
+			ifnet->in_queue_num : ifnet->out_queue_num;
+	if (num > OFP_IFQ_STAT_MAX)
+		num = OFP_IFQ_STAT_MAX;
+
+	memset(queue, 0, num * sizeof(queue[0]));
+	for (thr = 0; thr < shm_if_stat->num_thread; thr++) {
+		q = if_stat_block(thr) + shm_if_stat->num_ifnet +
+			port * OFP_IFQ_STAT_MAX;
+		for (i = 0; i < num; i++)
+			if_stat_add(&queue[i], &q[i]);
+	}
+
+	return num;
+}
+
+void ofp_if_stat_clear(uint16_t stat_idx)
+{
+	uint32_t thr;
+
+	if (!shm_if_stat || stat_idx >= shm_if_stat->num_ifnet)
+		return;
+
+	for (thr = 0; thr < shm_if_stat->num_thread; thr++)
+		memset(&if_stat_block(thr)[stat_idx], 0,
+		       sizeof(struct ofp_if_stat));
+}
+
 unsigned long int ofp_stat_flags = 0;
 
 struct ofp_packet_stat *ofp_get_packet_statistics(void)
@@ -44,6 +173,50 @@ struct ofp_perf_stat *ofp_get_perf_statistics(void)
 	return &shm_stat->ofp_perf_stat;
 }
 
+#define DROP_REASON_STR(_name, _descr) _descr,
+
+static const char *const drop_reason_str[OFP_DROP_REASON_MAX] = {
+	OFP_DROP_REASONS(DROP_REASON_STR)
+};
+
+const char *ofp_drop_reason_str(int reason)
+{
+	if (reason < 0 || reason >= OFP_DROP_REASON_MAX)
+		return NULL;
+
+	return drop_reason_str[reason];
+}
+
+#define PROF_STAGE_STR(_name, _descr) _descr,
+
+static const char *const prof_stage_str[OFP_PROF_STAGE_MAX] = {
+	OFP_PROF_STAGES(PROF_STAGE_STR)
+};
+
+const char *ofp_prof_stage_str(int stage)
+{
+	if (stage < 0 || stage >= OFP_PROF_STAGE_MAX)
+		return NULL;
+
+	return prof_stage_str[stage];
+}
+
+void ofp_get_drop_statistics(uint64_t drop[OFP_DROP_REASON_MAX])
+{
+	int thr, r;
+
+	memset(drop, 0, OFP_DROP_REASON_MAX * sizeof(drop[0]));
+
+	if (!shm_stat)
+		return;
+
+	for (thr = 0; thr < (int)shm_stat->ofp_packet_statistics.num_thr; thr++)
+		for (r = 0; r < OFP_DROP_REASON_MAX; r++)
+			drop[r] += __atomic_load_n(&shm_stat->
+				ofp_packet_statistics.per_thr[thr].drop[r],
+				__ATOMIC_RELAXED);
+}
+
 #define PROBES 3UL
 static void ofp_perf_tmo(void *arg)
 {
@@ -60,8 +233,8 @@ static void ofp_perf_tmo(void *arg)
 
 	/* No overflow in 580 years with packet rate < 1 Gpps */
 	for (thr = 0; thr < odp_thread_count(); thr++)
-		/* FIXME: Should be an atomic read */
-		value += shm_stat->ofp_packet_statistics.per_thr[thr].rx_fp;
+		value += __atomic_load_n(&shm_stat->ofp_packet_statistics
+					 .per_thr[thr].rx_fp, __ATOMIC_RELAXED);
 
 	pps = value - shm_stat->ofp_perf_stat.rx_prev_sum;
 	shm_stat->ofp_perf_stat.rx_prev_sum = value;
@@ -77,9 +250,9 @@ static void ofp_perf_tmo(void *arg)
 	/* No overflow with packet rate < 18 Gpps */
 	pps = pps * NS_PER_SEC / diff;
 
-	/* FIXME: Should be an atomic write */
-	shm_stat->ofp_perf_stat.rx_fp_pps =
-		(shm_stat->ofp_perf_stat.rx_fp_pps + pps) / 2;
+	__atomic_store_n(&shm_stat->ofp_perf_stat.rx_fp_pps,
+			 (shm_stat->ofp_perf_stat.rx_fp_pps + pps) / 2,
+			 __ATOMIC_RELAXED);
 }
 
 static void ofp_start_perf_stat(void)
@@ -89,11 +262,18 @@ static void ofp_start_perf_stat(void)
 
 static int ofp_stat_alloc_shared_memory(void)
 {
-	shm_stat = ofp_shared_memory_alloc(SHM_NAME_STAT, sizeof(*shm_stat));
+	shm_stat = ofp_shared_memory_alloc(SHM_NAME_STAT, STAT_SHM_SIZE);
 	if (shm_stat == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
 	}
+
+	shm_if_stat = ofp_shared_memory_alloc(SHM_NAME_IF_STAT,
+					      IF_STAT_SHM_SIZE);
+	if (shm_if_stat == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
 	return 0;
 }
 
@@ -107,6 +287,14 @@ static int ofp_stat_free_shared_memory(void)
 	}
 	shm_stat = NULL;
 
+	if (ofp_shared_memory_free(SHM_NAME_IF_STAT)) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm_if_stat = NULL;
+	ofp_if_stat_thr = NULL;
+	ofp_ifq_stat_thr = NULL;
+
 	return rc;
 }
 
@@ -117,19 +305,34 @@ int ofp_stat_lookup_shared_memory(void)
 		OFP_ERR("ofp_shared_memory_lookup failed");
 		return -1;
 	}
+
+	shm_if_stat = ofp_shared_memory_lookup(SHM_NAME_IF_STAT);
+	if (shm_if_stat == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	if_stat_init_local();
 	return 0;
 }
 
 void ofp_stat_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_STAT, sizeof(*shm_stat));
+	ofp_shared_memory_prealloc(SHM_NAME_STAT, STAT_SHM_SIZE);
+	ofp_shared_memory_prealloc(SHM_NAME_IF_STAT, IF_STAT_SHM_SIZE);
 }
 
 int ofp_stat_init_global(void)
 {
 	HANDLE_ERROR(ofp_stat_alloc_shared_memory());
 
-	memset(shm_stat, 0, sizeof(*shm_stat));
+	memset(shm_stat, 0, STAT_SHM_SIZE);
+	shm_stat->ofp_packet_statistics.num_thr = odp_thread_count_max();
+
+	memset(shm_if_stat, 0, IF_STAT_SHM_SIZE);
+	shm_if_stat->num_thread = odp_thread_count_max();
+	shm_if_stat->num_ifnet = IF_STAT_NUM_IFNET;
+	shm_if_stat->thread_size = IF_STAT_THREAD_SIZE;
+	if_stat_init_local();
 
 	return 0;
 }
@@ -160,3 +363,49 @@ unsigned long int ofp_get_stat_flags(void)
 {
 	return ofp_stat_flags;
 }
+
+static void print_pkt_pool(int fd, const char *name, odp_pool_t pool,
+			   uint32_t capacity)
+{
+	uint64_t in_use;
+
+	if (!ofp_pkt_pool_in_use(pool, capacity, &in_use))
+		ofp_sendf(fd, "packet pool %s capacity=%u in use=%" PRIu64
+			  "\r\n", name, capacity, in_use);
+	else
+		ofp_sendf(fd, "packet pool %s capacity=%u in use=n/a\r\n",
+			  name, capacity);
+}
+
+void ofp_show_memory(int fd)
+{
+	struct ofp_ifnet *ifnet;
+	int port;
+
+	ofp_shared_memory_print(fd);
+	ofp_sendf(fd, "\r\n");
+
+	ofp_print_uma_stat(fd);
+	ofp_print_avl_stat(fd);
+	ofp_print_btree_stat(fd);
+	ofp_sendf(fd, "\r\n");
+
+	print_pkt_pool(fd, "default", ofp_packet_pool,
+		       global_param->pkt_pool.nb_pkts);
+	if (ofp_packet_pool_small != ODP_POOL_INVALID)
+		print_pkt_pool(fd, "small", ofp_packet_pool_small,
+			       global_param->pkt_pool.small_nb_pkts);
+	for (port = 0; port < FP_PORTS; port++) {
+		ifnet = ofp_get_ifnet(port, 0);
+		if (ifnet && ifnet->if_state != OFP_IFT_STATE_FREE &&
+		    ifnet->pkt_pool != ODP_POOL_INVALID &&
+		    ifnet->pkt_pool != ofp_packet_pool)
+			print_pkt_pool(fd, ifnet->if_name, ifnet->pkt_pool,
+				       global_param->pkt_pool.nb_pkts);
+	}
+	ofp_mem_pressure_print(fd);
+	ofp_flow_queue_print(fd);
+	ofp_sendf(fd, "\r\n");
+
+	ofp_print_rt_stat(fd);
+}
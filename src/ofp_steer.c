@@ -0,0 +1,602 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_steer.h"
+#include "ofpi_portconf.h"
+#include "ofpi_init.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+
+#include "api/ofp_ifnet.h"
+
+#define SHM_NAME_STEER "OfpSteerShMem"
+
+/*
+ * Shared data
+ */
+struct steer_entry {
+	struct ofp_steer_rule rule;
+	odp_cos_t cos;
+	odp_pmr_t pmr;
+	/* Created by OFP for a class of one queue */
+	odp_queue_t queue;
+	uint16_t port;
+	uint8_t used;
+};
+
+struct ofp_steer_mem {
+	struct steer_entry entry[OFP_STEER_RULES_MAX];
+	odp_spinlock_t lock;
+	/* CPU budget of each priority in percent, 0: none */
+	uint32_t budget[OFP_STEER_BUDGET_PRIOS];
+	int budget_num;
+	odp_atomic_u64_t budget_drops[OFP_STEER_BUDGET_PRIOS];
+};
+
+/*
+ * Data per thread
+ */
+static __thread struct ofp_steer_mem *shm;
+
+/* Cycles used by each priority in the current millisecond */
+static __thread struct {
+	uint64_t start;
+	uint64_t window;
+	uint64_t burst;
+	uint64_t used[OFP_STEER_BUDGET_PRIOS];
+} budget;
+
+static void steer_queue_drain(odp_queue_t queue)
+{
+	odp_event_t ev;
+
+	while ((ev = odp_queue_deq(queue)) != ODP_EVENT_INVALID)
+		odp_event_free(ev);
+}
+
+/*
+ * Create a class of service with num queues of qparam. A single queue
+ * is created here, more are created by ODP and hashed to with hash.
+ */
+static odp_cos_t steer_cos_create(const char *name, struct ofp_ifnet *ifnet,
+				  const odp_queue_param_t *qparam,
+				  uint32_t num, odp_pktin_hash_proto_t hash,
+				  odp_queue_t *queue)
+{
+	odp_cls_cos_param_t cos_param;
+	odp_cls_capability_t capa;
+	odp_cos_t cos;
+
+	if (num > 1 && odp_cls_capability(&capa) == 0 &&
+	    num > capa.max_hash_queues)
+		num = capa.max_hash_queues ? capa.max_hash_queues : 1;
+
+	odp_cls_cos_param_init(&cos_param);
+	cos_param.pool = ifnet->pkt_pool;
+	*queue = ODP_QUEUE_INVALID;
+	if (num > 1) {
+		cos_param.num_queue = num;
+		cos_param.queue_param = *qparam;
+		cos_param.hash_proto = hash;
+	} else {
+		*queue = odp_queue_create(name, qparam);
+		if (*queue == ODP_QUEUE_INVALID) {
+			OFP_ERR("odp_queue_create failed");
+			return ODP_COS_INVALID;
+		}
+		cos_param.queue = *queue;
+	}
+
+	cos = odp_cls_cos_create(name, &cos_param);
+	if (cos == ODP_COS_INVALID) {
+		OFP_ERR("odp_cls_cos_create failed");
+		if (*queue != ODP_QUEUE_INVALID)
+			odp_queue_destroy(*queue);
+		*queue = ODP_QUEUE_INVALID;
+	}
+	return cos;
+}
+
+/*
+ * Remove the rule of an entry. A queue still holding packets is kept
+ * and destroyed on a later call, unless drain is set.
+ */
+static int steer_entry_destroy(struct steer_entry *e, int drain)
+{
+	int rc = 0;
+
+	if (e->pmr != ODP_PMR_INVALID && odp_cls_pmr_destroy(e->pmr)) {
+		OFP_ERR("odp_cls_pmr_destroy failed");
+		rc = -1;
+	}
+	e->pmr = ODP_PMR_INVALID;
+	if (e->cos != ODP_COS_INVALID && odp_cos_destroy(e->cos)) {
+		OFP_ERR("odp_cos_destroy failed");
+		rc = -1;
+	}
+	e->cos = ODP_COS_INVALID;
+	e->used = 0;
+
+	if (e->queue == ODP_QUEUE_INVALID)
+		return rc;
+	if (drain)
+		steer_queue_drain(e->queue);
+	if (odp_queue_destroy(e->queue) == 0)
+		e->queue = ODP_QUEUE_INVALID;
+	else if (drain)
+		rc = -1;
+	return rc;
+}
+
+/* Retry destroying the queues of removed rules */
+static void steer_retire(void)
+{
+	int i;
+
+	for (i = 0; i < OFP_STEER_RULES_MAX; i++)
+		if (!shm->entry[i].used && shm->entry[i].queue !=
+		    ODP_QUEUE_INVALID)
+			steer_entry_destroy(&shm->entry[i], 0);
+}
+
+static odp_pktin_hash_proto_t steer_hash_proto(enum ofp_steer_match match)
+{
+	odp_pktin_hash_proto_t hash;
+
+	memset(&hash, 0, sizeof(hash));
+	if (match == OFP_STEER_IPSEC_SPI || match == OFP_STEER_IP_DSCP ||
+	    match == OFP_STEER_IP_PROTO || match == OFP_STEER_ETHTYPE) {
+		hash.proto.ipv4 = 1;
+		hash.proto.ipv6 = 1;
+	} else {
+		hash.proto.ipv4_tcp = 1;
+		hash.proto.ipv4_udp = 1;
+		hash.proto.ipv6_tcp = 1;
+		hash.proto.ipv6_udp = 1;
+	}
+	return hash;
+}
+
+static uint32_t steer_value_max(enum ofp_steer_match match)
+{
+	switch (match) {
+	case OFP_STEER_IPSEC_SPI:
+		return 0xffffffff;
+	case OFP_STEER_IP_DSCP:
+		return 63;
+	case OFP_STEER_IP_PROTO:
+		return 0xff;
+	default:
+		return 0xffff;
+	}
+}
+
+static void steer_pmr_param(const struct ofp_steer_rule *rule,
+			    odp_pmr_param_t *pmr_param, void *val, void *mask)
+{
+	odp_cls_pmr_param_init(pmr_param);
+	pmr_param->match.value = val;
+	pmr_param->match.mask = mask;
+
+	switch (rule->match) {
+	case OFP_STEER_IPSEC_SPI:
+		pmr_param->term = ODP_PMR_IPSEC_SPI;
+		*(uint32_t *)val = odp_cpu_to_be_32(rule->value);
+		*(uint32_t *)mask = 0xffffffff;
+		pmr_param->val_sz = sizeof(uint32_t);
+		return;
+	case OFP_STEER_IP_DSCP:
+	case OFP_STEER_IP_PROTO:
+		pmr_param->term = rule->match == OFP_STEER_IP_DSCP ?
+			ODP_PMR_IP_DSCP : ODP_PMR_IPPROTO;
+		*(uint8_t *)val = rule->value;
+		*(uint8_t *)mask = rule->match == OFP_STEER_IP_DSCP ? 0x3f : 0xff;
+		pmr_param->val_sz = sizeof(uint8_t);
+		return;
+	case OFP_STEER_TCP_DPORT:
+		pmr_param->term = ODP_PMR_TCP_DPORT;
+		break;
+	case OFP_STEER_UDP_DPORT:
+		pmr_param->term = ODP_PMR_UDP_DPORT;
+		break;
+	case OFP_STEER_TCP_SPORT:
+		pmr_param->term = ODP_PMR_TCP_SPORT;
+		break;
+	case OFP_STEER_UDP_SPORT:
+		pmr_param->term = ODP_PMR_UDP_SPORT;
+		break;
+	case OFP_STEER_ETHTYPE:
+		pmr_param->term = ODP_PMR_ETHTYPE_0;
+		break;
+	}
+	*(uint16_t *)val = odp_cpu_to_be_16(rule->value);
+	*(uint16_t *)mask = 0xffff;
+	pmr_param->val_sz = sizeof(uint16_t);
+}
+
+void ofp_steer_rule_init(struct ofp_steer_rule *rule)
+{
+	memset(rule, 0, sizeof(*rule));
+	rule->group = ODP_SCHED_GROUP_INVALID;
+	rule->prio = ODP_SCHED_PRIO_DEFAULT;
+	rule->sync = ODP_SCHED_SYNC_ATOMIC;
+	rule->num_queues = 1;
+}
+
+int ofp_steer_rule_add(int port, const struct ofp_steer_rule *rule)
+{
+	struct ofp_ifnet *ifnet = ofp_get_ifnet((uint16_t)port, 0);
+	struct steer_entry *e = NULL;
+	odp_queue_param_t qparam;
+	odp_pmr_param_t pmr_param;
+	char name[ODP_QUEUE_NAME_LEN];
+	uint32_t val, mask;
+	int i;
+
+	if (!PHYS_PORT(port) || !ifnet ||
+	    ifnet->if_state != OFP_IFT_STATE_USED ||
+	    ifnet->cos_def == ODP_COS_INVALID) {
+		OFP_ERR("Steering not enabled on port %d", port);
+		return -1;
+	}
+	if (rule->match > OFP_STEER_ETHTYPE || rule->num_queues < 1 ||
+	    rule->value > steer_value_max(rule->match)) {
+		OFP_ERR("Invalid steering rule");
+		return -1;
+	}
+
+	steer_pmr_param(rule, &pmr_param, &val, &mask);
+
+	odp_queue_param_init(&qparam);
+	qparam.type = ODP_QUEUE_TYPE_SCHED;
+	qparam.sched.prio = rule->prio;
+	qparam.sched.sync = rule->sync;
+	qparam.sched.group = rule->group == ODP_SCHED_GROUP_INVALID ?
+		global_param->sched_group : rule->group;
+
+	odp_spinlock_lock(&shm->lock);
+	steer_retire();
+	for (i = 0; i < OFP_STEER_RULES_MAX; i++) {
+		if (!shm->entry[i].used &&
+		    shm->entry[i].queue == ODP_QUEUE_INVALID) {
+			e = &shm->entry[i];
+			break;
+		}
+	}
+	if (!e) {
+		odp_spinlock_unlock(&shm->lock);
+		OFP_ERR("Steering rule table full");
+		return -1;
+	}
+
+	snprintf(name, sizeof(name), "%.16s_steer%d", ifnet->if_name, i);
+	e->cos = steer_cos_create(name, ifnet, &qparam, rule->num_queues,
+				  steer_hash_proto(rule->match), &e->queue);
+	if (e->cos == ODP_COS_INVALID) {
+		odp_spinlock_unlock(&shm->lock);
+		return -1;
+	}
+
+	e->pmr = odp_cls_pmr_create(&pmr_param, 1, ifnet->cos_def, e->cos);
+	if (e->pmr == ODP_PMR_INVALID) {
+		OFP_ERR("odp_cls_pmr_create failed");
+		steer_entry_destroy(e, 1);
+		odp_spinlock_unlock(&shm->lock);
+		return -1;
+	}
+
+	e->rule = *rule;
+	e->rule.num_queues = odp_cls_cos_num_queue(e->cos);
+	e->port = port;
+	e->used = 1;
+	odp_spinlock_unlock(&shm->lock);
+
+	return i;
+}
+
+int ofp_steer_rule_del(int id)
+{
+	int rc;
+
+	if (id < 0 || id >= OFP_STEER_RULES_MAX)
+		return -1;
+
+	odp_spinlock_lock(&shm->lock);
+	if (!shm->entry[id].used) {
+		odp_spinlock_unlock(&shm->lock);
+		return -1;
+	}
+	/* Packets not yet scheduled keep the queue until a later call */
+	rc = steer_entry_destroy(&shm->entry[id], 0);
+	odp_spinlock_unlock(&shm->lock);
+
+	return rc;
+}
+
+int ofp_steer_budget_set(odp_schedule_prio_t prio, uint32_t percent)
+{
+	int i, num = 0;
+
+	if ((int)prio < 0 || (int)prio > odp_schedule_max_prio() ||
+	    (int)prio >= OFP_STEER_BUDGET_PRIOS || percent > 100) {
+		OFP_ERR("Invalid CPU budget");
+		return -1;
+	}
+
+	odp_spinlock_lock(&shm->lock);
+	shm->budget[prio] = percent;
+	for (i = 0; i < OFP_STEER_BUDGET_PRIOS; i++)
+		if (shm->budget[i])
+			num++;
+	shm->budget_num = num;
+	odp_spinlock_unlock(&shm->lock);
+
+	return 0;
+}
+
+int ofp_steer_budget_begin(odp_queue_t queue, int *over)
+{
+	uint64_t now;
+	int prio;
+
+	*over = 0;
+	if (odp_likely(!shm->budget_num) || queue == ODP_QUEUE_INVALID)
+		return -1;
+	prio = odp_queue_sched_prio(queue);
+	if (prio < 0 || prio >= OFP_STEER_BUDGET_PRIOS || !shm->budget[prio])
+		return -1;
+
+	if (odp_unlikely(!budget.window)) {
+		budget.window = odp_cpu_hz() / 1000;
+		if (!budget.window)
+			budget.window = odp_cpu_hz_max() / 1000;
+		if (!budget.window)
+			return -1;
+	}
+
+	now = odp_cpu_cycles();
+	if (odp_cpu_cycles_diff(now, budget.start) >= budget.window) {
+		budget.start = now;
+		memset(budget.used, 0, sizeof(budget.used));
+	}
+	budget.burst = now;
+	*over = budget.used[prio] * 100 >= budget.window * shm->budget[prio];
+	return prio;
+}
+
+void ofp_steer_budget_end(int cls, uint32_t dropped)
+{
+	budget.used[cls] += odp_cpu_cycles_diff(odp_cpu_cycles(), budget.burst);
+	if (odp_unlikely(dropped))
+		odp_atomic_add_u64(&shm->budget_drops[cls], dropped);
+}
+
+int ofp_steer_pktin_config(struct ofp_ifnet *ifnet,
+			   const odp_pktin_queue_param_t *pktin_param)
+{
+	odp_pktin_queue_param_t param = *pktin_param;
+	char name[ODP_QUEUE_NAME_LEN];
+	odp_queue_t queue;
+	uint32_t num = pktin_param->hash_enable ? pktin_param->num_queues : 1;
+	int n;
+
+	param.classifier_enable = 1;
+	if (odp_pktin_queue_config(ifnet->pktio, &param) < 0) {
+		OFP_ERR("Failed to create input queues.");
+		return -1;
+	}
+
+	/* Packets not steered go to the queues OFP would have created */
+	snprintf(name, sizeof(name), "%.16s_cos_def", ifnet->if_name);
+	ifnet->cos_def = steer_cos_create(name, ifnet, &pktin_param->queue_param,
+					  num, pktin_param->hash_proto,
+					  &queue);
+	if (ifnet->cos_def == ODP_COS_INVALID)
+		return -1;
+
+	if (odp_pktio_default_cos_set(ifnet->pktio, ifnet->cos_def) < 0 ||
+	    odp_pktio_error_cos_set(ifnet->pktio, ifnet->cos_def) < 0) {
+		OFP_ERR("Failed to set default class on %s", ifnet->if_name);
+		return -1;
+	}
+
+	n = odp_cls_cos_queues(ifnet->cos_def, ifnet->in_queue_queue,
+			       OFP_PKTIN_QUEUE_MAX);
+	if (n > OFP_PKTIN_QUEUE_MAX)
+		n = OFP_PKTIN_QUEUE_MAX;
+	ifnet->in_queue_num = n > 0 ? n : 0;
+
+	OFP_INFO("Interface '%s' steering enabled, %u default queues",
+		 ifnet->if_name, ifnet->in_queue_num);
+	return 0;
+}
+
+int ofp_steer_ifnet_term(struct ofp_ifnet *ifnet)
+{
+	int rc = 0, own_queue;
+	unsigned i;
+
+	if (ifnet->cos_def == ODP_COS_INVALID)
+		return 0;
+
+	odp_spinlock_lock(&shm->lock);
+	for (i = 0; i < OFP_STEER_RULES_MAX; i++) {
+		struct steer_entry *e = &shm->entry[i];
+
+		if (e->port == ifnet->port &&
+		    (e->used || e->queue != ODP_QUEUE_INVALID))
+			CHECK_ERROR(steer_entry_destroy(e, 1), rc);
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	for (i = 0; i < ifnet->in_queue_num; i++)
+		steer_queue_drain(ifnet->in_queue_queue[i]);
+
+	/* A single default queue was created by OFP */
+	own_queue = odp_cls_cos_num_queue(ifnet->cos_def) == 1;
+	CHECK_ERROR(odp_cos_destroy(ifnet->cos_def), rc);
+	if (own_queue && ifnet->in_queue_num)
+		CHECK_ERROR(odp_queue_destroy(ifnet->in_queue_queue[0]), rc);
+
+	ifnet->cos_def = ODP_COS_INVALID;
+	ifnet->in_queue_num = 0;
+	return rc;
+}
+
+static const char *steer_match_str(enum ofp_steer_match match)
+{
+	switch (match) {
+	case OFP_STEER_TCP_DPORT:
+		return "tcp_dport";
+	case OFP_STEER_UDP_DPORT:
+		return "udp_dport";
+	case OFP_STEER_IPSEC_SPI:
+		return "esp_spi";
+	case OFP_STEER_TCP_SPORT:
+		return "tcp_sport";
+	case OFP_STEER_UDP_SPORT:
+		return "udp_sport";
+	case OFP_STEER_IP_DSCP:
+		return "dscp";
+	case OFP_STEER_IP_PROTO:
+		return "ip_proto";
+	case OFP_STEER_ETHTYPE:
+		return "ethtype";
+	}
+	return "?";
+}
+
+static const char *steer_sync_str(odp_schedule_sync_t sync)
+{
+	if (sync == ODP_SCHED_SYNC_ATOMIC)
+		return "atomic";
+	if (sync == ODP_SCHED_SYNC_ORDERED)
+		return "ordered";
+	return "parallel";
+}
+
+void ofp_steer_print(int fd)
+{
+	struct steer_entry entry[OFP_STEER_RULES_MAX];
+	struct ofp_ifnet *ifnet;
+	int i;
+
+	for (i = 0; PHYS_PORT(i); i++) {
+		ifnet = ofp_get_ifnet((uint16_t)i, 0);
+		if (!ifnet || ifnet->if_state != OFP_IFT_STATE_USED ||
+		    ifnet->cos_def == ODP_COS_INVALID)
+			continue;
+		ofp_sendf(fd, "%s%d (%s): %u default queues\r\n",
+			  OFP_IFNAME_PREFIX, i, ifnet->if_name,
+			  ifnet->in_queue_num);
+	}
+
+	/* Printed from a copy, the writes may block */
+	odp_spinlock_lock(&shm->lock);
+	memcpy(entry, shm->entry, sizeof(entry));
+	odp_spinlock_unlock(&shm->lock);
+
+	ofp_sendf(fd, "\r\n  Id Interface  Match          Value  Group  Prio"
+		  " Sync      Queues\r\n");
+	for (i = 0; i < OFP_STEER_RULES_MAX; i++) {
+		struct ofp_steer_rule *r = &entry[i].rule;
+
+		if (!entry[i].used)
+			continue;
+		ofp_sendf(fd, "%4d %s%-7d %-9s %10u %6d %5d %-8s %7u\r\n",
+			  i, OFP_IFNAME_PREFIX, entry[i].port,
+			  steer_match_str(r->match), r->value,
+			  r->group == ODP_SCHED_GROUP_INVALID ? -1 :
+			  (int)r->group, (int)r->prio,
+			  steer_sync_str(r->sync), r->num_queues);
+	}
+
+	for (i = 0; i < OFP_STEER_BUDGET_PRIOS; i++) {
+		if (!shm->budget[i])
+			continue;
+		ofp_sendf(fd, "  prio %d: cpu budget %u%%, %" PRIu64
+			  " packets dropped\r\n",
+			  i, shm->budget[i],
+			  odp_atomic_load_u64(&shm->budget_drops[i]));
+	}
+	ofp_sendf(fd, "\r\n");
+}
+
+static int ofp_steer_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_STEER, sizeof(*shm));
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_steer_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_STEER) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_steer_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_STEER);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_steer_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_STEER, sizeof(*shm));
+}
+
+int ofp_steer_init_global(void)
+{
+	int i;
+
+	HANDLE_ERROR(ofp_steer_alloc_shared_memory());
+
+	memset(shm, 0, sizeof(*shm));
+	for (i = 0; i < OFP_STEER_RULES_MAX; i++) {
+		shm->entry[i].cos = ODP_COS_INVALID;
+		shm->entry[i].pmr = ODP_PMR_INVALID;
+		shm->entry[i].queue = ODP_QUEUE_INVALID;
+	}
+	odp_spinlock_init(&shm->lock);
+	for (i = 0; i < OFP_STEER_BUDGET_PRIOS; i++)
+		odp_atomic_init_u64(&shm->budget_drops[i], 0);
+
+	return 0;
+}
+
+int ofp_steer_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_steer_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_steer_free_shared_memory(), rc);
+
+	return rc;
+}
@@ -86,7 +86,7 @@ ofp_soo_ioctl(struct socket *so, uint32_t cmd, void *data, struct ofp_ucred *act
 
 	case OFP_FIONREAD:
 		/* Unlocked read. */
-		*(int *)data = so->so_rcv.sb_cc;
+		*(int *)data = so->so_rcv.sb_cc + ofp_sbrx_cc(&so->so_rcv);
 		break;
 
 	case OFP_FIONWRITE:
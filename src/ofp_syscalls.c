@@ -6,9 +6,14 @@
  * SPDX-License-Identifier:     BSD-3-Clause
  */
 
+#include <stdlib.h>
 #include <strings.h>
 #include <string.h>
 #include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <odp_api.h>
 
@@ -25,11 +30,13 @@
 #include "ofpi_sockbuf.h"
 #include "ofpi_socket.h"
 #include "ofpi_sockstate.h"
+#include "ofpi_coroutine.h"
 #include "ofpi_in_pcb.h"
 #include "ofpi_udp_var.h"
 #include "ofpi_protosw.h"
 #include "ofpi_ioctl.h"
 #include "ofpi_route.h"
+#include "ofpi_ipc.h"
 #include "api/ofp_types.h"
 #include "ofpi_syscalls.h"
 #include "ofpi_pkt_processing.h"
@@ -47,6 +54,9 @@ ofp_socket_vrf(int domain, int type, int protocol, int vrf)
 	int		error;
 	struct thread   td;
 
+	if (ofp_ipc_attached())
+		return ofp_ipc_socket(domain, type, protocol, vrf);
+
 	td.td_proc.p_fibnum = vrf;
 	td.td_ucred = NULL;
 	error = ofp_socreate(domain, &so, type, protocol, &td);
@@ -60,7 +70,12 @@ ofp_socket_vrf(int domain, int type, int protocol, int vrf)
 int
 ofp_close(int sockfd)
 {
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_close(sockfd);
+
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -72,7 +87,12 @@ ofp_close(int sockfd)
 int
 ofp_shutdown(int sockfd, int how)
 {
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_shutdown(sockfd, how);
+
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -86,8 +106,12 @@ ofp_bind(int sockfd, const struct ofp_sockaddr *addr, ofp_socklen_t addrlen)
 {
 	struct thread   td;
 	union ofp_sockaddr_store nonconstaddr;
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_bind(sockfd, addr, addrlen);
 
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -107,8 +131,12 @@ ofp_connect(int sockfd, const struct ofp_sockaddr *addr, ofp_socklen_t addrlen)
 {
 	struct thread   td;
 	union ofp_sockaddr_store nonconstaddr;
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_connect(sockfd, addr, addrlen);
 
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -124,6 +152,20 @@ ofp_connect(int sockfd, const struct ofp_sockaddr *addr, ofp_socklen_t addrlen)
 	td.td_proc.p_fibnum = so->so_fibnum;
 	td.td_ucred = NULL;
 	ofp_errno = ofp_soconnect(so, (struct ofp_sockaddr *)&nonconstaddr, &td);
+	if (ofp_errno)
+		return -1;
+
+	/* Coroutines wait for the connection as kern_connect() does */
+	if (ofp_in_coroutine() && !(so->so_state & SS_NBIO)) {
+		OFP_SOCK_LOCK(so);
+		while ((so->so_state & SS_ISCONNECTING) && so->so_error == 0)
+			if (ofp_msleep(&so->so_timeo, SOCKBUF_MTX(&so->so_rcv),
+				       0, "connec", 0))
+				break;
+		ofp_errno = so->so_error;
+		so->so_error = 0;
+		OFP_SOCK_UNLOCK(so);
+	}
 	return ofp_errno ? -1 : 0;
 }
 
@@ -135,8 +177,13 @@ ofp_sendto(int sockfd, const void *buf, size_t len, int flags,
 	struct uio uio;
 	struct thread   td;
 	union ofp_sockaddr_store nonconstaddr;
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_sendto(sockfd, buf, len, flags, dest_addr,
+				      addrlen);
 
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -176,7 +223,13 @@ ofp_recvfrom(int sockfd, void *buf, size_t len, int flags,
 {
 	struct ofp_iovec iovec;
 	struct uio uio;
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_recvfrom(sockfd, buf, len, flags, src_addr,
+					addrlen);
+
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -184,6 +237,7 @@ ofp_recvfrom(int sockfd, void *buf, size_t len, int flags,
 
 	uio.uio_iov = &iovec;
 	uio.uio_iovcnt = 1;
+	uio.uio_offset = 0;
 	uio.uio_resid = len;
 	iovec.iov_base = buf;
 	iovec.iov_len = len;
@@ -202,12 +256,455 @@ ofp_recv(int sockfd, void *buf, size_t len, int flags)
 	return ofp_recvfrom(sockfd, buf, len, flags, NULL, 0);
 }
 
+/* The iovecs of a message, read but not modified by the socket layer */
+static int
+msg_uio(const struct ofp_msghdr *msg, struct uio *uio)
+{
+	ofp_ssize_t resid = 0;
+	int i;
+
+	uio->uio_resid = 0;
+	if (msg->msg_iovlen < 0)
+		return OFP_EMSGSIZE;
+
+	for (i = 0; i < msg->msg_iovlen; i++) {
+		resid += msg->msg_iov[i].iov_len;
+		if (resid < 0)
+			return OFP_EINVAL;
+	}
+
+	uio->uio_iov = msg->msg_iov;
+	uio->uio_iovcnt = msg->msg_iovlen;
+	uio->uio_offset = 0;
+	uio->uio_resid = resid;
+	uio->uio_segsz = 0;
+	uio->uio_ts.sw_ns = 0;
+	uio->uio_ts.hw_ns = 0;
+
+	return 0;
+}
+
+ofp_ssize_t
+ofp_recvmsg(int sockfd, struct ofp_msghdr *msg, int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(sockfd);
+	struct ofp_sockaddr *from = msg->msg_name;
+	ofp_ssize_t len;
+	struct uio uio;
+
+	if (!so) {
+		ofp_errno = OFP_EBADF;
+		return -1;
+	}
+
+	ofp_errno = msg_uio(msg, &uio);
+	if (ofp_errno)
+		return -1;
+	len = uio.uio_resid;
+
+	ofp_errno = ofp_soreceive(so, &from, &uio, NULL, NULL, &flags);
+	if (ofp_errno)
+		return -1;
+
+	if (from && msg->msg_namelen && (so->so_proto->pr_flags & PR_ADDR))
+		msg->msg_namelen = from->sa_len;
+	else
+		msg->msg_namelen = 0;
+	msg->msg_flags = flags & OFP_MSG_TRUNC;
+	ofp_sorecv_control(so, msg, uio.uio_segsz, &uio.uio_ts);
+
+	return len - uio.uio_resid;
+}
+
+ofp_ssize_t
+ofp_sendmsg(int sockfd, const struct ofp_msghdr *msg, int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(sockfd);
+	union ofp_sockaddr_store nonconstaddr;
+	struct thread td;
+	ofp_ssize_t len;
+	struct uio uio;
+
+	if (!so) {
+		ofp_errno = OFP_EBADF;
+		return -1;
+	}
+
+	ofp_errno = msg_uio(msg, &uio);
+	if (ofp_errno)
+		return -1;
+	len = uio.uio_resid;
+
+	if (msg->msg_name && msg->msg_namelen) {
+		if (msg->msg_namelen > sizeof(nonconstaddr)) {
+			ofp_errno = OFP_EINVAL;
+			return -1;
+		}
+		memcpy(&nonconstaddr, msg->msg_name, msg->msg_namelen);
+	}
+
+	td.td_proc.p_fibnum = so->so_fibnum;
+	td.td_ucred = NULL;
+
+	ofp_errno = ofp_sosend(so, (msg->msg_name && msg->msg_namelen) ?
+			       (struct ofp_sockaddr *)&nonconstaddr : NULL,
+			       &uio, ODP_PACKET_INVALID, ODP_PACKET_INVALID,
+			       flags, &td);
+
+	if (len != uio.uio_resid)
+		ofp_errno = 0;
+
+	return ofp_errno ? -1 : len - uio.uio_resid;
+}
+
+int
+ofp_recvmmsg(int sockfd, struct ofp_mmsghdr *msgvec, unsigned int vlen,
+	     int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(sockfd);
+	unsigned int n;
+
+	if (!so) {
+		ofp_errno = OFP_EBADF;
+		return -1;
+	}
+
+	if (vlen == 0)
+		return 0;
+
+	if (so->so_proto->pr_usrreqs->pru_soreceive == ofp_soreceive_dgram) {
+		ofp_errno = ofp_soreceive_dgram_mmsg(so, msgvec, vlen, flags,
+						     &n);
+		return ofp_errno ? -1 : (int)n;
+	}
+
+	for (n = 0; n < vlen; n++) {
+		struct ofp_msghdr *msg = &msgvec[n].msg_hdr;
+		/* Only the first call may block */
+		int rflags = n ? (flags | OFP_MSG_DONTWAIT) : flags;
+		ofp_ssize_t len;
+		struct uio uio;
+
+		ofp_errno = msg_uio(msg, &uio);
+		len = uio.uio_resid;
+		msg->msg_namelen = 0;
+		msg->msg_controllen = 0;
+
+		if (!ofp_errno)
+			ofp_errno = ofp_soreceive(so, NULL, &uio, NULL, NULL,
+						  &rflags);
+		if (ofp_errno) {
+			if (n == 0)
+				return -1;
+			ofp_errno = 0;
+			break;
+		}
+		msg->msg_flags = rflags & OFP_MSG_TRUNC;
+		msgvec[n].msg_len = len - uio.uio_resid;
+		if (msgvec[n].msg_len == 0) {
+			/* End of stream */
+			n++;
+			break;
+		}
+	}
+
+	return n;
+}
+
+int
+ofp_sendmmsg(int sockfd, struct ofp_mmsghdr *msgvec, unsigned int vlen,
+	     int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(sockfd);
+	struct thread td;
+	unsigned int n;
+
+	if (!so) {
+		ofp_errno = OFP_EBADF;
+		return -1;
+	}
+
+	if (vlen == 0)
+		return 0;
+
+	td.td_proc.p_fibnum = so->so_fibnum;
+	td.td_ucred = NULL;
+
+	if (so->so_proto->pr_usrreqs->pru_sosend == ofp_sosend_dgram) {
+		ofp_errno = ofp_sosend_dgram_mmsg(so, msgvec, vlen, flags, &td,
+						  &n);
+		return ofp_errno ? -1 : (int)n;
+	}
+
+	for (n = 0; n < vlen; n++) {
+		struct ofp_msghdr *msg = &msgvec[n].msg_hdr;
+		ofp_ssize_t len;
+		struct uio uio;
+
+		ofp_errno = msg_uio(msg, &uio);
+		len = uio.uio_resid;
+
+		if (!ofp_errno)
+			ofp_errno = ofp_sosend(so, msg->msg_name, &uio,
+					       ODP_PACKET_INVALID,
+					       ODP_PACKET_INVALID, flags, &td);
+		msgvec[n].msg_len = len - uio.uio_resid;
+		if (ofp_errno) {
+			if (n == 0 && msgvec[0].msg_len == 0)
+				return -1;
+			ofp_errno = 0;
+			if (msgvec[n].msg_len)
+				n++;
+			break;
+		}
+	}
+
+	return n;
+}
+
+int
+ofp_recv_pkt(int sockfd, odp_packet_t *pkt, uint32_t *off, uint32_t *len,
+	     int num, int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(sockfd);
+	int n;
+
+	if (!so) {
+		ofp_errno = OFP_EBADF;
+		return -1;
+	}
+
+	if (so->so_type != OFP_SOCK_STREAM && so->so_type != OFP_SOCK_DGRAM) {
+		ofp_errno = OFP_EOPNOTSUPP;
+		return -1;
+	}
+
+	if (num <= 0)
+		return 0;
+
+	ofp_errno = ofp_soreceive_pkt(so, pkt, off, len, num, flags, &n);
+
+	return ofp_errno ? -1 : n;
+}
+
+int
+ofp_send_pkt(int sockfd, odp_packet_t *pkt, int num, int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(sockfd);
+	struct thread td;
+	int i, n;
+
+	if (!so || (so->so_type != OFP_SOCK_STREAM &&
+		    so->so_type != OFP_SOCK_DGRAM)) {
+		ofp_errno = so ? OFP_EOPNOTSUPP : OFP_EBADF;
+		for (i = 0; i < num; i++)
+			odp_packet_free(pkt[i]);
+		return -1;
+	}
+
+	if (num <= 0)
+		return 0;
+
+	for (i = 0; i < num; i++)
+		ofp_packet_user_area_reset(pkt[i]);
+
+	td.td_proc.p_fibnum = so->so_fibnum;
+	td.td_ucred = NULL;
+
+	ofp_errno = ofp_sosend_pkt(so, pkt, num, flags, &td, &n);
+
+	return ofp_errno ? -1 : n;
+}
+
+/* Send len bytes at buf, returns the number of bytes queued */
+static size_t
+sendfile_mem(struct socket *so, const void *buf, size_t len, int flags,
+	     struct thread *td)
+{
+	struct ofp_iovec iovec;
+	struct uio uio;
+
+	iovec.iov_base = (void *)(uintptr_t)buf;
+	iovec.iov_len = len;
+	uio.uio_iov = &iovec;
+	uio.uio_iovcnt = 1;
+	uio.uio_offset = 0;
+	uio.uio_resid = len;
+
+	ofp_errno = ofp_sosend(so, NULL, &uio, ODP_PACKET_INVALID,
+			       ODP_PACKET_INVALID, flags, td);
+	return len - uio.uio_resid;
+}
+
+static size_t
+sendfile_iov(struct socket *so, struct ofp_iovec *iov, int cnt,
+	     struct thread *td)
+{
+	size_t sent = 0, n;
+	int i;
+
+	for (i = 0; i < cnt && !ofp_errno; i++) {
+		n = sendfile_mem(so, iov[i].iov_base, iov[i].iov_len, 0, td);
+		sent += n;
+		if (n < iov[i].iov_len)
+			break;
+	}
+	return sent;
+}
+
+/* Bytes read at a time from a file that may be truncated */
+#define SENDFILE_CHUNK (64 * 1024)
+
+/*
+ * A file may be mapped only if it cannot shrink, otherwise a truncation
+ * by another process would raise SIGBUS on access to the mapping.
+ */
+static int sendfile_can_map(int fd)
+{
+#ifdef F_GET_SEALS
+	int seals = fcntl(fd, F_GET_SEALS);
+
+	return seals >= 0 && (seals & F_SEAL_SHRINK);
+#else
+	(void)fd;
+	return 0;
+#endif
+}
+
+/* Send len bytes of fd from offset through a read-only mapping */
+static size_t
+sendfile_map(int fd, struct socket *so, ofp_off_t offset, size_t len,
+	     struct thread *td)
+{
+	ofp_off_t moff;
+	size_t n;
+	void *map;
+
+	moff = offset & ~((ofp_off_t)sysconf(_SC_PAGESIZE) - 1);
+	map = mmap(NULL, len + (offset - moff), PROT_READ, MAP_SHARED,
+		   fd, moff);
+	if (map == MAP_FAILED) {
+		ofp_errno = OFP_EINVAL;
+		return 0;
+	}
+	(void)madvise(map, len + (offset - moff), MADV_SEQUENTIAL);
+
+	n = sendfile_mem(so, (uint8_t *)map + (offset - moff), len, 0, td);
+	munmap(map, len + (offset - moff));
+	return n;
+}
+
+/*
+ * Send len bytes of fd from offset read in chunks. A file truncated
+ * meanwhile ends the send at its new end.
+ */
+static size_t
+sendfile_read(int fd, struct socket *so, ofp_off_t offset, size_t len,
+	      struct thread *td)
+{
+	size_t sent = 0, n;
+	ssize_t r;
+	void *buf;
+
+	buf = malloc(len < SENDFILE_CHUNK ? len : SENDFILE_CHUNK);
+	if (!buf) {
+		ofp_errno = OFP_ENOMEM;
+		return 0;
+	}
+
+	while (sent < len) {
+		r = pread(fd, buf, len - sent < SENDFILE_CHUNK ?
+			  len - sent : SENDFILE_CHUNK, offset + sent);
+		if (r <= 0) {
+			if (r < 0)
+				ofp_errno = OFP_EIO;
+			break;
+		}
+		n = sendfile_mem(so, buf, r, 0, td);
+		sent += n;
+		if (ofp_errno || n < (size_t)r)
+			break;
+	}
+
+	free(buf);
+	return sent;
+}
+
+int
+ofp_sendfile(int fd, int s, ofp_off_t offset, size_t nbytes,
+	     struct ofp_sf_hdtr *hdtr, ofp_off_t *sbytes, int flags)
+{
+	struct socket *so = ofp_get_sock_by_fd(s);
+	struct thread td;
+	struct stat st;
+	size_t sent = 0, len = 0, n;
+
+	(void)flags;
+
+	if (sbytes)
+		*sbytes = 0;
+
+	if (!so) {
+		ofp_errno = OFP_EBADF;
+		return -1;
+	}
+	if (so->so_type != OFP_SOCK_STREAM) {
+		ofp_errno = OFP_EOPNOTSUPP;
+		return -1;
+	}
+	if (offset < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+		ofp_errno = OFP_EINVAL;
+		return -1;
+	}
+
+	if (offset < st.st_size) {
+		len = st.st_size - offset;
+		if (nbytes && nbytes < len)
+			len = nbytes;
+	}
+
+	td.td_proc.p_fibnum = so->so_fibnum;
+	td.td_ucred = NULL;
+	ofp_errno = 0;
+
+	if (hdtr && hdtr->headers)
+		sent = sendfile_iov(so, hdtr->headers, hdtr->hdr_cnt, &td);
+	if (ofp_errno)
+		goto out;
+
+	/*
+	 * A file sealed against shrinking is sent from the page cache
+	 * through a read-only mapping, others are read in large chunks.
+	 */
+	if (len) {
+		if (sendfile_can_map(fd))
+			n = sendfile_map(fd, so, offset, len, &td);
+		else
+			n = sendfile_read(fd, so, offset, len, &td);
+		sent += n;
+		if (ofp_errno || n < len)
+			goto out;
+	}
+
+	if (hdtr && hdtr->trailers)
+		sent += sendfile_iov(so, hdtr->trailers, hdtr->trl_cnt, &td);
+
+out:
+	if (sbytes)
+		*sbytes = sent;
+	return ofp_errno ? -1 : 0;
+}
+
 int
 ofp_listen(int sockfd, int backlog)
 {
 	struct thread   td;
-	struct socket  *so = ofp_get_sock_by_fd(sockfd);
+	struct socket  *so;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_listen(sockfd, backlog);
 
+	so = ofp_get_sock_by_fd(sockfd);
 	if (!so) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -226,7 +723,12 @@ int
 ofp_accept(int sockfd, struct ofp_sockaddr *addr, ofp_socklen_t *addrlen)
 {
 	struct ofp_sockaddr *sa = NULL;
-	struct socket *so, *head = ofp_get_sock_by_fd(sockfd);
+	struct socket *so, *head;
+
+	if (ofp_ipc_attached())
+		return ofp_ipc_accept(sockfd, addr, addrlen);
+
+	head = ofp_get_sock_by_fd(sockfd);
 	if (!head) {
 		ofp_errno = OFP_EBADF;
 		return -1;
@@ -249,8 +751,10 @@ ofp_accept(int sockfd, struct ofp_sockaddr *addr, ofp_socklen_t *addrlen)
 			head->so_error = OFP_ECONNABORTED;
 			break;
 		}
-		if (ofp_msleep(&head->so_timeo, ofp_accept_mtx(), 0,
-				 "accept", 0)) {
+		if (head->so_busy_poll.enable ?
+		    ofp_busy_poll(&head->so_busy_poll, ofp_accept_mtx(), 0) :
+		    ofp_msleep(&head->so_timeo, ofp_accept_mtx(), 0,
+			       "accept", 0)) {
 			ACCEPT_UNLOCK();
 			return -1;
 		}
@@ -328,38 +832,108 @@ to_usec(struct ofp_timeval *timeout)
 	return timeout ? timeout->tv_sec * US_PER_SEC + timeout->tv_usec : 0;
 }
 
+/*
+ * Check a socket marked in the readiness map. The bit is cleared
+ * before the check, and set again if the socket is ready, so that a
+ * wakeup during the check is not lost.
+ */
 static int
-set_ready_fd(int fd, ofp_fd_set *fd_set, int(*is_ready)(int fd))
+fd_ready(int fd, int which)
 {
-	if (OFP_FD_ISSET(fd, fd_set) && is_ready(fd))
-		return 1;
+	uint8_t *map = ofp_so_ready_map(which);
+	const int i = fd - OFP_SOCK_NUM_OFFSET;
+	const uint8_t bit = 1 << (i % 8);
+	struct socket *so;
+	int ready;
 
-	OFP_FD_CLR(fd, fd_set);
-	return 0;
+	if (!(__atomic_load_n(&map[i / 8], __ATOMIC_RELAXED) & bit))
+		return 0;
+
+	__atomic_fetch_and(&map[i / 8], (uint8_t)~bit, __ATOMIC_SEQ_CST);
+
+	so = ofp_get_sock_by_fd(fd);
+	if (!so || !so->so_proto)
+		return 0;
+
+	if (which == OFP_SO_RCV)
+		ready = is_readable(fd) || so->so_error ||
+			(so->so_rcv.sb_state & SBS_CANTRCVMORE);
+	else
+		ready = sowriteable(so);
+
+	if (ready)
+		__atomic_fetch_or(&map[i / 8], bit, __ATOMIC_RELAXED);
+	return ready;
 }
 
 static int
-set_ready_fds(int nfds, ofp_fd_set *fd_set, int (*is_ready)(int fd))
+scan_byte(int nfds, ofp_fd_set *fd_set, int i, int which, int update)
 {
-	int fd;
-	int ready = 0;
+	uint8_t in = fd_set->fd_set_buf[i];
+	uint8_t out = 0;
+	int b, fd, ready = 0;
 
-	for (fd = OFP_SOCK_NUM_OFFSET; fd < nfds && fd_set; ++fd)
-		ready += set_ready_fd(fd, fd_set, is_ready);
+	for (b = 0; b < 8 && in >> b; b++) {
+		fd = OFP_SOCK_NUM_OFFSET + i * 8 + b;
+		if (fd >= nfds)
+			break;
+		if (!(in & (1 << b)) || !fd_ready(fd, which))
+			continue;
+		out |= 1 << b;
+		ready++;
+		if (!update)
+			return ready;
+	}
 
+	if (update)
+		fd_set->fd_set_buf[i] = out;
 	return ready;
 }
 
+/*
+ * Return the number of fds in the set that are ready. The set is
+ * compared with the readiness map 64 fds at a time, and only the fds
+ * marked in both are checked. With update, the fds not ready are
+ * cleared from the set, otherwise the scan stops at the first ready.
+ */
 static int
-none_of_ready(int nfds, ofp_fd_set *fd_set, int (*is_ready)(int fd))
+scan_fds(int nfds, ofp_fd_set *fd_set, int which, int update)
 {
-	int fd;
+	const uint8_t *map;
+	int bytes, i, j, len;
+	int ready = 0;
+	uint64_t w, m;
 
-	for (fd = OFP_SOCK_NUM_OFFSET; fd < nfds && fd_set; ++fd)
-		if (OFP_FD_ISSET(fd, fd_set) && is_ready(fd))
-			return 0;
+	if (!fd_set || nfds <= OFP_SOCK_NUM_OFFSET)
+		return 0;
+	if (nfds - OFP_SOCK_NUM_OFFSET > ofp_socket_max())
+		nfds = OFP_SOCK_NUM_OFFSET + ofp_socket_max();
+
+	map = ofp_so_ready_map(which);
+	bytes = (nfds - OFP_SOCK_NUM_OFFSET + 7) / 8;
+	if (bytes > (int)sizeof(fd_set->fd_set_buf))
+		bytes = sizeof(fd_set->fd_set_buf);
+
+	for (i = 0; i < bytes; i += 8) {
+		len = bytes - i < 8 ? bytes - i : 8;
+		w = m = 0;
+		memcpy(&w, &fd_set->fd_set_buf[i], len);
+		memcpy(&m, &map[i], len);
+		if (!w)
+			continue;
+		if (!(w & m)) {
+			if (update)
+				memset(&fd_set->fd_set_buf[i], 0, len);
+			continue;
+		}
+		for (j = i; j < i + len; j++) {
+			ready += scan_byte(nfds, fd_set, j, which, update);
+			if (ready && !update)
+				return ready;
+		}
+	}
 
-	return 1;
+	return ready;
 }
 
 static inline int
@@ -374,13 +948,110 @@ _ofp_select(int nfds, ofp_fd_set *readfds, ofp_fd_set *writefds,
 	    int (*sleeper)(void *channel, odp_rwlock_t *mtx, int priority,
 			   const char *wmesg, uint32_t timeout))
 {
-	(void)writefds;
+	const int wait = is_blocking(timeout);
+	const int fds = nfds > OFP_SOCK_NUM_OFFSET && (readfds || writefds);
+
 	(void)exceptfds;
 
-	if (is_blocking(timeout) && none_of_ready(nfds, readfds, is_readable))
+	/* Counted before the check, a wakeup after it is not missed */
+	if (wait && fds)
+		ofp_so_select_wait(1);
+
+	if (wait && !scan_fds(nfds, readfds, OFP_SO_RCV, 0) &&
+	    !scan_fds(nfds, writefds, OFP_SO_SND, 0))
 		sleeper(NULL, NULL, 0, "select", to_usec(timeout));
 
-	return set_ready_fds(nfds, readfds, is_readable);
+	if (wait && fds)
+		ofp_so_select_wait(0);
+
+	return scan_fds(nfds, readfds, OFP_SO_RCV, 1) +
+		scan_fds(nfds, writefds, OFP_SO_SND, 1);
+}
+
+int
+ofp_poll(struct ofp_pollfd *fds, ofp_nfds_t nfds, int timeout)
+{
+	return _ofp_poll(fds, nfds, timeout, ofp_msleep);
+}
+
+static short
+poll_revents(struct ofp_pollfd *pfd)
+{
+	struct socket *so;
+	short revents = 0;
+	int rd, wr;
+
+	if (pfd->fd < 0)
+		return 0;
+
+	so = ofp_get_sock_by_fd(pfd->fd);
+	if (!so || !so->so_proto)
+		return OFP_POLLNVAL;
+
+	/* Errors and hangups make the socket readable */
+	rd = fd_ready(pfd->fd, OFP_SO_RCV);
+	wr = (pfd->events & OFP_POLLOUT) && fd_ready(pfd->fd, OFP_SO_SND);
+	if (!rd && !wr)
+		return 0;
+
+	if (rd && (pfd->events & OFP_POLLIN))
+		revents |= OFP_POLLIN;
+	if (wr)
+		revents |= OFP_POLLOUT;
+	if (so->so_error)
+		revents |= OFP_POLLERR;
+	if ((so->so_rcv.sb_state & SBS_CANTRCVMORE) &&
+	    (so->so_snd.sb_state & SBS_CANTSENDMORE))
+		revents |= OFP_POLLHUP;
+
+	return revents;
+}
+
+static int
+poll_fds(struct ofp_pollfd *fds, ofp_nfds_t nfds)
+{
+	ofp_nfds_t i;
+	int ready = 0;
+
+	for (i = 0; i < nfds; i++) {
+		fds[i].revents = poll_revents(&fds[i]);
+		if (fds[i].revents)
+			ready++;
+	}
+	return ready;
+}
+
+int
+_ofp_poll(struct ofp_pollfd *fds, ofp_nfds_t nfds, int timeout,
+	  int (*sleeper)(void *channel, odp_rwlock_t *mtx, int priority,
+			 const char *wmesg, uint32_t timeout))
+{
+	int ready;
+
+	if (nfds && !fds) {
+		ofp_errno = OFP_EFAULT;
+		return -1;
+	}
+	if (nfds > (ofp_nfds_t)ofp_socket_max()) {
+		ofp_errno = OFP_EINVAL;
+		return -1;
+	}
+
+	if (timeout && nfds)
+		ofp_so_select_wait(1);
+
+	ready = poll_fds(fds, nfds);
+	if (!ready && timeout) {
+		/* Negative timeout waits forever */
+		sleeper(NULL, NULL, 0, "poll",
+			timeout > 0 ? (uint32_t)timeout * 1000 : 0);
+		ready = poll_fds(fds, nfds);
+	}
+
+	if (timeout && nfds)
+		ofp_so_select_wait(0);
+
+	return ready;
 }
 
 static inline int
@@ -502,6 +1173,14 @@ int ofp_socket_sigevent(struct ofp_sigevent *ev)
 	case OFP_SIGEV_NONE:
 		return 0;
 	case OFP_SIGEV_HOOK:
+	case OFP_SIGEV_BATCH:
+		break;
+	case OFP_SIGEV_QUEUE:
+		if (ofp_sock_event_pool == ODP_POOL_INVALID ||
+		    ev->ofp_sigev_queue == ODP_QUEUE_INVALID) {
+			ofp_errno = OFP_EINVAL;
+			return -1;
+		}
 		break;
 	default:
 		ofp_errno = OFP_EINVAL;
@@ -0,0 +1,104 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * Client side cookie cache of TCP Fast Open. A server address maps to
+ * one slot; a new cookie for another address colliding on the slot
+ * replaces the old one, whose next connection then asks for a cookie
+ * again.
+ */
+
+#include <string.h>
+
+#include "ofpi_in_pcb.h"
+#include "ofpi_tcp_shm.h"
+#include "ofpi_tcp_fastopen.h"
+
+#define V_tfo_ccache	(shm_tcp->tfo_ccache)
+
+static struct tcp_fastopen_centry *
+ccache_entry(struct in_conninfo *inc, uint32_t *faddr)
+{
+	uint32_t h;
+
+	memset(faddr, 0, 4 * sizeof(uint32_t));
+#ifdef INET6
+	if (inc->inc_flags & INC_ISIPV6)
+		memcpy(faddr, &inc->inc6_faddr, 4 * sizeof(uint32_t));
+	else
+#endif
+		faddr[0] = inc->inc_faddr.s_addr;
+
+	h = faddr[0] ^ faddr[1] ^ faddr[2] ^ faddr[3];
+	h ^= h >> 16;
+	h ^= h >> 8;
+
+	return &V_tfo_ccache.entry[h & (TCP_FASTOPEN_CCACHE_SIZE - 1)];
+}
+
+static int
+ccache_match(struct tcp_fastopen_centry *e, struct in_conninfo *inc,
+	     uint32_t *faddr)
+{
+	return e->len &&
+		e->isipv6 == ((inc->inc_flags & INC_ISIPV6) != 0) &&
+		!memcmp(e->faddr, faddr, sizeof(e->faddr));
+}
+
+void
+ofp_tcp_fastopen_init(void)
+{
+	odp_spinlock_init(&V_tfo_ccache.lock);
+	memset(V_tfo_ccache.entry, 0, sizeof(V_tfo_ccache.entry));
+}
+
+/*
+ * Copy the cookie cached for the foreign address of inc. Returns its
+ * length, 0 if none is known.
+ */
+int
+ofp_tcp_fastopen_ccache_get(struct in_conninfo *inc, uint8_t *cookie)
+{
+	struct tcp_fastopen_centry *e;
+	uint32_t faddr[4];
+	int len = 0;
+
+	e = ccache_entry(inc, faddr);
+	odp_spinlock_lock(&V_tfo_ccache.lock);
+	if (ccache_match(e, inc, faddr)) {
+		len = e->len;
+		memcpy(cookie, e->cookie, len);
+	}
+	odp_spinlock_unlock(&V_tfo_ccache.lock);
+
+	return len;
+}
+
+/*
+ * Remember the cookie of a server. A length of 0 forgets it.
+ */
+void
+ofp_tcp_fastopen_ccache_set(struct in_conninfo *inc, const uint8_t *cookie,
+			    int len)
+{
+	struct tcp_fastopen_centry *e;
+	uint32_t faddr[4];
+
+	if (len < 0 || len > TCP_FASTOPEN_MAX_COOKIE_LEN)
+		return;
+
+	e = ccache_entry(inc, faddr);
+	odp_spinlock_lock(&V_tfo_ccache.lock);
+	if (len) {
+		memcpy(e->faddr, faddr, sizeof(e->faddr));
+		e->isipv6 = (inc->inc_flags & INC_ISIPV6) != 0;
+		memcpy(e->cookie, cookie, len);
+		e->len = len;
+	} else if (ccache_match(e, inc, faddr)) {
+		e->len = 0;
+	}
+	odp_spinlock_unlock(&V_tfo_ccache.lock);
+}
@@ -77,9 +77,11 @@
 #include "ofpi_tcp6_var.h"
 #include "ofpi_tcp.h"
 #include "ofpi_tcp_syncache.h"
+#include "ofpi_cc.h"
 #include "ofpi_icmp.h"
 #include "ofpi_sockstate.h"
 #include "ofpi_pkt_processing.h"
+#include "ofpi_gro.h"
 
 #define log(a, f...) OFP_INFO(f)
 
@@ -105,6 +107,11 @@ OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, delayed_ack, OFP_CTLFLAG_RW,
 	   &ofp_tcp_delack_enabled, 0,
 	   "Delay ACK to try and piggyback it onto a data packet");
 
+VNET_DEFINE(int, ofp_tcp_ack_coalesce) = 1;
+OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, ack_coalesce, OFP_CTLFLAG_RW,
+	   &ofp_tcp_ack_coalesce, 0,
+	   "Send one ACK per connection at the end of a receive burst");
+
 VNET_DEFINE(int, ofp_drop_synfin) = 0;
 #define	V_drop_synfin		VNET(ofp_drop_synfin)
 OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, drop_synfin, OFP_CTLFLAG_RW,
@@ -235,18 +242,47 @@ hhook_run_tcp_est_in(struct tcpcb *tp, struct ofp_tcphdr *th, struct tcpopt *to)
 #endif
 }
 
+/*
+ * Bytes acked, sampled to a delivery rate once per smoothed RTT, at
+ * least every millisecond.
+ */
+static inline void
+tcp_delivered(struct tcpcb *tp, uint32_t acked)
+{
+	uint64_t now, win;
+
+	if (!acked)
+		return;
+	tp->t_delivered += acked;
+
+	now = odp_time_to_ns(odp_time_global());
+	if (!tp->t_dlv_start) {
+		tp->t_dlv_start = now;
+		tp->t_dlv_mark = tp->t_delivered;
+		return;
+	}
+	win = ((uint64_t)tp->t_srtt * OFP_TIMER_RESOLUTION_US * 1000) >>
+		TCP_RTT_SHIFT;
+	if (win < 1000000)
+		win = 1000000;
+	if (now - tp->t_dlv_start < win)
+		return;
+	tp->t_delivery_rate = (tp->t_delivered - tp->t_dlv_mark) *
+		1000000000 / (now - tp->t_dlv_start);
+	tp->t_dlv_start = now;
+	tp->t_dlv_mark = tp->t_delivered;
+}
+
 /*
  * CC wrapper hook functions
  */
 static inline void
 cc_ack_received(struct tcpcb *tp, struct ofp_tcphdr *th, uint16_t type)
 {
-	(void)tp; (void)th; (void)type;
-#if 0 /* HJo */
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
 	tp->ccv->bytes_this_ack = BYTES_THIS_ACK(tp, th);
-	if (tp->snd_cwnd == min(tp->snd_cwnd, tp->snd_wnd))
+	if (tp->snd_cwnd <= tp->snd_wnd)
 		tp->ccv->flags |= CCF_CWND_LIMITED;
 	else
 		tp->ccv->flags &= ~CCF_CWND_LIMITED;
@@ -255,7 +291,7 @@ cc_ack_received(struct tcpcb *tp, struct ofp_tcphdr *th, uint16_t type)
 		if (tp->snd_cwnd > tp->snd_ssthresh) {
 			tp->t_bytes_acked += min(tp->ccv->bytes_this_ack,
 			     V_tcp_abc_l_var * tp->t_maxseg);
-			if (tp->t_bytes_acked >= tp->snd_cwnd) {
+			if ((uint64_t)tp->t_bytes_acked >= tp->snd_cwnd) {
 				tp->t_bytes_acked -= tp->snd_cwnd;
 				tp->ccv->flags |= CCF_ABC_SENTAWND;
 			}
@@ -270,107 +306,33 @@ cc_ack_received(struct tcpcb *tp, struct ofp_tcphdr *th, uint16_t type)
 		tp->ccv->curack = th->th_ack;
 		CC_ALGO(tp)->ack_received(tp->ccv, type);
 	}
-#endif
 }
 
 static inline void
 cc_conn_init(struct tcpcb *tp)
 {
-	(void)tp;
-#if 0 /* HJo */
-	struct hc_metrics_lite metrics;
-	struct inpcb *inp = tp->t_inpcb;
-	int rtt;
-#ifdef INET6
-	int isipv6 = ((inp->inp_vflag & INP_IPV6) != 0) ? 1 : 0;
-#endif
-
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
-	tcp_hc_get(&inp->inp_inc, &metrics);
-
-	if (tp->t_srtt == 0 && (rtt = metrics.rmx_rtt)) {
-		tp->t_srtt = rtt;
-		tp->t_rttbest = tp->t_srtt + TCP_RTT_SCALE;
-		TCPSTAT_INC(tcps_usedrtt);
-		if (metrics.rmx_rttvar) {
-			tp->t_rttvar = metrics.rmx_rttvar;
-			TCPSTAT_INC(tcps_usedrttvar);
-		} else {
-			/* default variation is +- 1 rtt */
-			tp->t_rttvar =
-			    tp->t_srtt * TCP_RTTVAR_SCALE / TCP_RTT_SCALE;
-		}
-		TCPT_RANGESET(tp->t_rxtcur,
-		    ((tp->t_srtt >> 2) + tp->t_rttvar) >> 1,
-		    tp->t_rttmin, TCPTV_REXMTMAX);
-	}
-	if (metrics.rmx_ssthresh) {
-		/*
-		 * There's some sort of gateway or interface
-		 * buffer limit on the path.  Use this to set
-		 * the slow start threshhold, but set the
-		 * threshold to no less than 2*mss.
-		 */
-		tp->snd_ssthresh = max(2 * tp->t_maxseg, metrics.rmx_ssthresh);
-		TCPSTAT_INC(tcps_usedssthresh);
-	}
-
 	/*
-	 * Set the slow-start flight size depending on whether this
-	 * is a local network or not.
-	 *
-	 * Extend this so we cache the cwnd too and retrieve it here.
-	 * Make cwnd even bigger than RFC3390 suggests but only if we
-	 * have previous experience with the remote host. Be careful
-	 * not make cwnd bigger than remote receive window or our own
-	 * send socket buffer. Maybe put some additional upper bound
-	 * on the retrieved cwnd. Should do incremental updates to
-	 * hostcache when cwnd collapses so next connection doesn't
-	 * overloads the path again.
-	 *
-	 * XXXAO: Initializing the CWND from the hostcache is broken
-	 * and in its current form not RFC conformant.  It is disabled
-	 * until fixed or removed entirely.
+	 * Set the slow-start flight size. There is no host cache to take
+	 * the RTT, ssthresh or cwnd of earlier connections from.
 	 *
 	 * RFC3390 says only do this if SYN or SYN/ACK didn't got lost.
 	 * We currently check only in syncache_socket for that.
 	 */
-/* #define TCP_METRICS_CWND */
-#ifdef TCP_METRICS_CWND
-	if (metrics.rmx_cwnd)
-		tp->snd_cwnd = max(tp->t_maxseg, min(metrics.rmx_cwnd / 2,
-		    min(tp->snd_wnd, so->so_snd.sb_hiwat)));
-	else
-#endif
 	if (V_tcp_do_rfc3390)
 		tp->snd_cwnd = min(4 * tp->t_maxseg,
 		    max(2 * tp->t_maxseg, 4380));
-#ifdef INET6
-	else if (isipv6 /*&& in6_localaddr(&inp->in6p_faddr)*/)
-		tp->snd_cwnd = tp->t_maxseg * V_ss_fltsz_local;
-#endif
-#if defined(INET) && defined(INET6)
-	else if (!isipv6 /*&& in_localaddr(inp->inp_faddr)*/)
-		tp->snd_cwnd = tp->t_maxseg * V_ss_fltsz_local;
-#endif
-#ifdef INET
-	else if (in_localaddr(inp->inp_faddr))
-		tp->snd_cwnd = tp->t_maxseg * V_ss_fltsz_local;
-#endif
 	else
 		tp->snd_cwnd = tp->t_maxseg * V_ss_fltsz;
 
 	if (CC_ALGO(tp)->conn_init != NULL)
 		CC_ALGO(tp)->conn_init(tp->ccv);
-#endif
 }
 
 inline void
 ofp_cc_cong_signal(struct tcpcb *tp, struct ofp_tcphdr *th, uint32_t type)
 {
-	(void)tp; (void)th; (void)type;
-#if 0 /* HJo */
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
 	switch(type) {
@@ -393,7 +355,7 @@ ofp_cc_cong_signal(struct tcpcb *tp, struct ofp_tcphdr *th, uint32_t type)
 		tp->t_dupacks = 0;
 		tp->t_bytes_acked = 0;
 		EXIT_RECOVERY(tp->t_flags);
-		tp->snd_ssthresh = max(2, min(tp->snd_wnd, tp->snd_cwnd) / 2 /
+		tp->snd_ssthresh = ulmax(2, ulmin(tp->snd_wnd, tp->snd_cwnd) / 2 /
 		    tp->t_maxseg) * tp->t_maxseg;
 		tp->snd_cwnd = tp->t_maxseg;
 		break;
@@ -418,14 +380,11 @@ ofp_cc_cong_signal(struct tcpcb *tp, struct ofp_tcphdr *th, uint32_t type)
 			tp->ccv->curack = th->th_ack;
 		CC_ALGO(tp)->cong_signal(tp->ccv, type);
 	}
-#endif
 }
 
 static inline void
 cc_post_recovery(struct tcpcb *tp, struct ofp_tcphdr *th)
 {
-	(void)tp; (void)th;
-#if 0 /* HJo */
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
 	/* XXXLAS: KASSERT that we're in recovery? */
@@ -436,7 +395,6 @@ cc_post_recovery(struct tcpcb *tp, struct ofp_tcphdr *th)
 	}
 	/* XXXLAS: EXIT_RECOVERY ? */
 	tp->t_bytes_acked = 0;
-#endif
 }
 
 static inline void
@@ -498,6 +456,52 @@ do { \
 	    (tp->t_flags & TF_RXWIN0SENT) == 0) &&			\
 	    (V_tcp_delack_enabled || (tp->t_flags & TF_NEEDSYN)))
 
+/*
+ * Defer an immediate ACK to the end of the receive burst, so that the
+ * segments of a connection in one burst are acknowledged once. The
+ * connection is referenced until ofp_tcp_ack_flush(). Returns 0 if the
+ * caller has to send now.
+ */
+static inline int
+tcp_ack_defer(struct tcpcb *tp)
+{
+	if (!ofp_gro.depth || !V_tcp_ack_coalesce)
+		return 0;
+	if (tp->t_flags & TF_ACKQUEUED)
+		return 1;
+	if (ofp_gro.num_ack == OFP_GRO_ACK_MAX)
+		return 0;
+
+	ofp_in_pcbref(tp->t_inpcb);
+	ofp_gro.ack[ofp_gro.num_ack++] = tp->t_inpcb;
+	t_flags_or(tp->t_flags, TF_ACKQUEUED);
+	return 1;
+}
+
+void
+ofp_tcp_ack_flush(void)
+{
+	struct inpcb *inp;
+	struct tcpcb *tp;
+	int i, num = ofp_gro.num_ack;
+
+	ofp_gro.num_ack = 0;
+	for (i = 0; i < num; i++) {
+		inp = ofp_gro.ack[i];
+		INP_WLOCK(inp);
+		if (ofp_in_pcbrele_wlocked(inp))
+			continue;
+		tp = intotcpcb(inp);
+		if (!(inp->inp_flags & (INP_TIMEWAIT | INP_DROPPED)) &&
+		    tp != NULL && (tp->t_flags & TF_ACKQUEUED)) {
+			t_flags_and(tp->t_flags, ~TF_ACKQUEUED);
+			if (tp->t_flags & TF_ACKNOW)
+				(void) ofp_tcp_output(tp);
+		}
+		INP_WUNLOCK(inp);
+	}
+}
+
 /*
  * TCP input handling is split into multiple parts:
  *   tcp6_input is a thin wrapper around ofp_tcp_input for the extended
@@ -570,6 +574,7 @@ ofp_tcp_input(odp_packet_t *m, int off0)
 	struct tcpopt to;		/* options in this segment */
 	char *s = NULL;			/* address and port logging */
 	int ti_locked;
+	int synflood;
 #ifdef TCPDEBUG
 	/*
 	 * The size of tcp_saveipgen must be the size of the max ip header,
@@ -664,7 +669,13 @@ ofp_tcp_input(odp_packet_t *m, int off0)
 		th = (struct ofp_tcphdr *)((char *)ip + off0);
 
 #ifdef OFP_IPv4_TCP_CSUM_VALIDATE
-		if (ofp_packet_user_area(*m)->chksum_flags
+		if (ofp_packet_user_area(*m)->chksum_flags &
+		    OFP_L4_CHKSUM_VERIFIED) {
+			/* Coalesced segments no longer match th_sum */
+			ofp_packet_user_area(*m)->chksum_flags &=
+				~(OFP_L4_CHKSUM_VERIFIED |
+				  OFP_L4_CHKSUM_STATUS_VALID);
+		} else if (ofp_packet_user_area(*m)->chksum_flags
                         & OFP_L4_CHKSUM_STATUS_VALID) {
                         switch (odp_packet_l4_chksum_status(*m)) {
 			case ODP_PACKET_CHKSUM_OK:
@@ -764,8 +775,18 @@ ofp_tcp_input(odp_packet_t *m, int off0)
 	 * where we might discover later we need a write lock despite the
 	 * flags: ACKs moving a connection out of the syncache, and ACKs for
 	 * a connection in TIMEWAIT.
+	 *
+	 * A SYN flood is answered with stateless SYN cookies and does not
+	 * take the lock; a SYN that ends up elsewhere takes it below.
 	 */
-	if ((thflags & (OFP_TH_SYN | OFP_TH_FIN | OFP_TH_RST)) != 0) {/* OK */
+	synflood =
+#ifdef INET6
+		!isipv6 &&
+#endif
+		(thflags & (OFP_TH_SYN | OFP_TH_ACK | OFP_TH_RST | OFP_TH_FIN)) ==
+		OFP_TH_SYN && ofp_syncache_flood();
+	if (!synflood &&
+	    (thflags & (OFP_TH_SYN | OFP_TH_FIN | OFP_TH_RST)) != 0) {/* OK */
 		INP_INFO_WLOCK(&V_tcbinfo);
 		ti_locked = TI_WLOCKED;
 	} else
@@ -786,6 +807,28 @@ findpcb:
 					INPLOOKUP_WILDCARD | INPLOOKUP_WLOCKPCB,
 					ofp_packet_interface(*m), *m);
 
+	/*
+	 * IPv4 connections in TIME_WAIT have no inpcb but an entry in the
+	 * TIME_WAIT table, which takes precedence over a listening socket.
+	 */
+	if (
+#ifdef INET6
+	    !isipv6 &&
+#endif
+	    V_twtbl.count &&
+	    (inp == NULL || (inp->inp_socket &&
+			     (inp->inp_socket->so_options & OFP_SO_ACCEPTCONN)))) {
+		if (thflags & OFP_TH_SYN)
+			tcp_dooptions(&to, optp, optlen, TO_SYN);
+		if (ofp_tcp_twinput(ip, th, &to, *m, tlen) == 0) {
+			if (inp != NULL)
+				INP_WUNLOCK(inp);
+			if (ti_locked == TI_WLOCKED)
+				INP_INFO_WUNLOCK(&V_tcbinfo);
+			return OFP_PKT_PROCESSED;
+		}
+	}
+
 	/*
 	 * If the INPCB does not exist then all data in the incoming
 	 * segment is discarded and an appropriate RST is sent back.
@@ -846,6 +889,15 @@ findpcb:
 			goto dropunlock;
 	}
 
+	if (synflood && inp->inp_socket &&
+	    (inp->inp_socket->so_options & OFP_SO_ACCEPTCONN)) {
+		tcp_dooptions(&to, optp, optlen, TO_SYN);
+		if (ofp_syncookie_respond(ip, th, &to, inp, *m) == 0) {
+			INP_WUNLOCK(inp);
+			return OFP_PKT_PROCESSED;
+		}
+	}
+
 	/*
 	 * A previous connection in TIMEWAIT state is supposed to catch stray
 	 * or duplicate segments arriving late.  If this segment was a
@@ -910,7 +962,7 @@ relocked:
 	 * relock, we have to jump back to 'relocked' as the connection might
 	 * now be in TIMEWAIT.
 	 */
-	if (tp->t_state != TCPS_ESTABLISHED) {/* OK */
+	if (tp->t_state != TCPS_ESTABLISHED || (thflags & OFP_TH_SYN)) {/* OK */
 		if (ti_locked == TI_UNLOCKED) {
 			if (INP_INFO_TRY_WLOCK(&V_tcbinfo) == 0) {
 				ofp_in_pcbref(inp);
@@ -1249,7 +1301,22 @@ relocked:
 			    (void *)tcp_saveipgen, &tcp_savetcp, 0);
 #endif
 		tcp_dooptions(&to, optp, optlen, TO_SYN);
-		ofp_syncache_add(&inc, &to, th, inp, &so, *m, -1);
+		if (ofp_syncache_add(&inc, &to, th, inp, &so, *m, -1)) {
+			/*
+			 * TCP Fast Open: the connection was created in
+			 * SYN_RECEIVED state. Unlock the listen socket
+			 * and pass the SYN and its data to the new one.
+			 */
+			INP_WUNLOCK(inp);	/* listen socket */
+			inp = sotoinpcb(so);
+			INP_WLOCK(inp);		/* new connection */
+			tp = intotcpcb(inp);
+			cc_conn_init(tp);
+			ofp_tcp_do_segment(*m, th, so, tp, drop_hdrlen, tlen,
+			    iptos, ti_locked, 0);
+			INP_INFO_UNLOCK_ASSERT(&V_tcbinfo);
+			return OFP_PKT_PROCESSED;
+		}
 		/*
 		 * Entry added to syncache and mbuf consumed.
 		 * Everything already unlocked by ofp_syncache_add().
@@ -1330,6 +1397,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 	int rstreason, todrop, win;
 	uint64_t tiwin;
 	struct tcpopt to;
+	int tfo_syn;
 
 #ifdef TCPDEBUG
 	/*
@@ -1342,6 +1410,9 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 #endif
 	thflags = th->th_flags;
 	tp->sackhint.last_sack_ack = 0;
+	/* Data of a TFO connection is delivered before the handshake ends. */
+	tfo_syn = tp->t_state == TCPS_SYN_RECEIVED &&
+		(tp->t_flags & TF_FASTOPEN);
 
 	/*
 	 * If this is either a state-changing packet or current state isn't
@@ -1384,16 +1455,11 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 	 * XXX: This should be done after segment
 	 * validation to ignore broken/spoofed segs.
 	 */
-	int cur_ticks = ticks;
 	/*
-	 * Restart keepalive timer at most once per second, or ten
-	 * times per keepalive interval, whichever is more frequent.
+	 * The keepalive timer is not restarted, ofp_tcp_timer_keep()
+	 * pushes it back by the time passed since t_rcvtime.
 	 */
-	if (cur_ticks > (int)(tp->t_rcvtime + min(HZ, TP_KEEPIDLE(tp)/10))) {
-		tp->t_rcvtime = cur_ticks;
-		if (TCPS_HAVEESTABLISHED(tp->t_state))
-			ofp_tcp_timer_activate(tp, TT_KEEP, TP_KEEPIDLE(tp));
-	}
+	tp->t_rcvtime = ticks;
 
 	/*
 	 * Unscale the window into a 32-bit value.
@@ -1421,9 +1487,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 		}
 		/* Congestion experienced. */
 		if (thflags & OFP_TH_ECE) {
-			/* HJo: FIX:
 			ofp_cc_cong_signal(tp, th, CC_ECN);
-			*/
 		}
 	}
 
@@ -1474,6 +1538,11 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 		if ((tp->t_flags & TF_SACK_PERMIT) &&
 		    (to.to_flags & TOF_SACKPERM) == 0)
 			t_flags_and(tp->t_flags, ~TF_SACK_PERMIT);
+		if ((tp->t_flags & TF_FASTOPEN) &&
+		    (to.to_flags & TOF_FASTOPEN) && to.to_tfo_len)
+			ofp_tcp_fastopen_ccache_set(&tp->t_inpcb->inp_inc,
+						    to.to_tfo_cookie,
+						    to.to_tfo_len);
 	}
 
 	/*
@@ -1537,9 +1606,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 				if (tp->t_rxtshift == 1 &&
 				    (tp->t_flags & TF_PREVVALID) &&
 				    (int)(ticks - tp->t_badrxtwin) < 0) {
-					/* HJo: FIX:
 					ofp_cc_cong_signal(tp, th, CC_RTO_ERR);
-					*/
 				}
 
 				/*
@@ -1568,6 +1635,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 							ticks - tp->t_rtttime);
 				}
 				acked = BYTES_THIS_ACK(tp, th);
+				tcp_delivered(tp, acked);
 
 				/* Run HHOOK_TCP_ESTABLISHED_IN helper hooks. */
 				hhook_run_tcp_est_in(tp, th, &to);
@@ -1585,9 +1653,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 				 * typically means increasing the congestion
 				 * window.
 				 */
-				/* HJo: FIX:
 				cc_ack_received(tp, th, CC_ACK);
-				*/
 
 				tp->snd_una = th->th_ack;
 				/*
@@ -1727,8 +1793,8 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 				 * Give up when limit is reached.
 				 */
 				if (newsize)
-					if (!ofp_sbreserve_locked(&so->so_rcv,
-					    newsize, so, NULL))
+					if (!ofp_sbautosize_locked(&so->so_rcv,
+					    newsize, tp->t_maxseg))
 						so->so_rcv.sb_flags &= ~SB_AUTOSIZE;
 				odp_packet_pull_head(m, drop_hdrlen);	/* delayed header drop */
 				ofp_sbappendstream_locked(&so->so_rcv, m);
@@ -1739,7 +1805,8 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 				t_flags_or(tp->t_flags, TF_DELACK);
 			} else {
 				t_flags_or(tp->t_flags, TF_ACKNOW);
-				ofp_tcp_output(tp);
+				if (!tcp_ack_defer(tp))
+					ofp_tcp_output(tp);
 			}
 
 			goto check_delack;
@@ -1821,6 +1888,13 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 			tp->rcv_adv += imin(tp->rcv_wnd,
 			    OFP_TCP_MAXWIN << tp->rcv_scale);
 			tp->snd_una++;		/* SYN is acked */
+			/*
+			 * Data of a TFO SYN that the server did not
+			 * accept is sent again right away.
+			 */
+			if ((tp->t_flags & TF_FASTOPEN) &&
+			    SEQ_LT(th->th_ack, tp->snd_max))
+				tp->snd_nxt = th->th_ack;
 			/*
 			 * If there's data, delay ACK; if there's also a FIN
 			 * ACKNOW will be turned on later.
@@ -1850,11 +1924,11 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 			 */
 			tp->t_starttime = ticks;
 			if (tp->t_flags & TF_NEEDFIN) {
-				tp->t_state = TCPS_FIN_WAIT_1;
+				tcp_state_change(tp, TCPS_FIN_WAIT_1);
 				t_flags_and(tp->t_flags, ~TF_NEEDFIN);
 				thflags &= ~OFP_TH_SYN;
 			} else {
-				tp->t_state = TCPS_ESTABLISHED;
+				tcp_state_change(tp, TCPS_ESTABLISHED);
 				cc_conn_init(tp);
 				ofp_tcp_timer_activate(tp, TT_KEEP,
 				    TP_KEEPIDLE(tp));
@@ -1873,7 +1947,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 
 			t_flags_or(tp->t_flags, (TF_ACKNOW | TF_NEEDSYN));
 			ofp_tcp_timer_activate(tp, TT_REXMT, 0);
-			tp->t_state = TCPS_SYN_RECEIVED;
+			tcp_state_change(tp, TCPS_SYN_RECEIVED);
 		}
 
 		KASSERT(ti_locked == TI_WLOCKED, ("%s: trimthenstep6: "
@@ -2012,7 +2086,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 				    ti_locked));
 				INP_INFO_WLOCK_ASSERT(&V_tcbinfo);
 
-				tp->t_state = TCPS_CLOSED;
+				tcp_state_change(tp, TCPS_CLOSED);
 				TCPSTAT_INC(tcps_drops);
 				tp = ofp_tcp_close(tp);
 				break;
@@ -2264,10 +2338,10 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 		 */
 		tp->t_starttime = ticks;
 		if (tp->t_flags & TF_NEEDFIN) {
-			tp->t_state = TCPS_FIN_WAIT_1;
+			tcp_state_change(tp, TCPS_FIN_WAIT_1);
 			t_flags_and(tp->t_flags, ~TF_NEEDFIN);
 		} else {
-			tp->t_state = TCPS_ESTABLISHED;
+			tcp_state_change(tp, TCPS_ESTABLISHED);
 			cc_conn_init(tp);
 			ofp_tcp_timer_activate(tp, TT_KEEP, TP_KEEPIDLE(tp));
 		}
@@ -2351,9 +2425,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 					tp->t_dupacks = 0;
 				else if (++tp->t_dupacks > ofp_tcprexmtthresh ||
 				     IN_FASTRECOVERY(tp->t_flags)) {
-					/* HJo: FIX:
 					cc_ack_received(tp, th, CC_DUPACK);
-					*/
 					if ((tp->t_flags & TF_SACK_PERMIT) &&
 					    IN_FASTRECOVERY(tp->t_flags)) {
 						int awnd;
@@ -2398,10 +2470,8 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 						}
 					}
 					/* Congestion signal before ack. */
-					/* HJo: FIX:
 					ofp_cc_cong_signal(tp, th, CC_NDUPACK);
 					cc_ack_received(tp, th, CC_DUPACK);
-					*/
 					ofp_tcp_timer_activate(tp, TT_REXMT, 0);
 					tp->t_rtttime = 0;
 					if (0 && tp->t_flags & TF_SACK_PERMIT) {
@@ -2414,8 +2484,6 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 					}
 					tp->snd_nxt = th->th_ack;
 					tp->snd_cwnd = tp->t_maxseg;
-					tp->snd_recover = tp->snd_max;
-					t_flags_or(tp->t_flags, TF_FASTRECOVERY);
 					(void) ofp_tcp_output(tp);
 					KASSERT(tp->snd_limited <= 2,
 					    ("%s: tp->snd_limited too big",
@@ -2427,9 +2495,7 @@ ofp_tcp_do_segment(odp_packet_t m, struct ofp_tcphdr *th, struct socket *so,
 						tp->snd_nxt = onxt;
 					goto drop;
 				} else if (V_tcp_do_rfc3042) {
-					/* HJo: FIX:
 					cc_ack_received(tp, th, CC_DUPACK);
-					*/
 					uint64_t oldcwnd = tp->snd_cwnd;
 					tcp_seq oldsndmax = tp->snd_max;
 					uint32_t sent;
@@ -2507,6 +2573,7 @@ process_ACK:
 		INP_WLOCK_ASSERT(tp->t_inpcb);
 
 		acked = BYTES_THIS_ACK(tp, th);
+		tcp_delivered(tp, acked);
 		TCPSTAT_INC(tcps_rcvackpack);
 		TCPSTAT_ADD(tcps_rcvackbyte, acked);
 
@@ -2517,11 +2584,9 @@ process_ACK:
 		 * original cwnd and ssthresh, and proceed to transmit where
 		 * we left off.
 		 */
-		/* HJo: FIX:
 		if (tp->t_rxtshift == 1 && tp->t_flags & TF_PREVVALID &&
 		    (int)(ticks - tp->t_badrxtwin) < 0)
 			ofp_cc_cong_signal(tp, th, CC_RTO_ERR);
-		*/
 		/*
 		 * If we have a timestamp reply, update smoothed
 		 * round trip time.  If no timestamp is present but
@@ -2573,10 +2638,7 @@ process_ACK:
 		 * control related information. This typically means increasing
 		 * the congestion window.
 		 */
-		/* HJo: FIX
 		cc_ack_received(tp, th, CC_ACK);
-		*/
-		if (tp->snd_cwnd < tp->snd_wnd) tp->snd_cwnd = tp->snd_wnd;
 		SOCKBUF_LOCK(&so->so_snd);
 		if (acked > (int)so->so_snd.sb_cc) {
 			tp->snd_wnd -= so->so_snd.sb_cc;
@@ -2634,7 +2696,7 @@ process_ACK:
 					    ofp_tcp_finwait2_timeout :
 					    TP_MAXIDLE(tp)));
 				}
-				tp->t_state = TCPS_FIN_WAIT_2;
+				tcp_state_change(tp, TCPS_FIN_WAIT_2);
 			}
 			break;
 
@@ -2800,8 +2862,8 @@ dodata:							/* XXX */
 		if (tlen <= sbspace(&so->so_rcv)) {
 			if (th->th_seq == tp->rcv_nxt &&
 			    OFP_LIST_EMPTY(&tp->t_segq) &&
-			    TCPS_HAVEESTABLISHED(tp->t_state)) {
-				if (DELAY_ACK(tp))
+			    (TCPS_HAVEESTABLISHED(tp->t_state) || tfo_syn)) {
+				if (DELAY_ACK(tp) && !tfo_syn)
 					t_flags_or(tp->t_flags, TF_DELACK);
 				else
 					t_flags_or(tp->t_flags, TF_ACKNOW);
@@ -2886,7 +2948,7 @@ dodata:							/* XXX */
 			/* FALLTHROUGH */
 		case TCPS_ESTABLISHED:
 
-			tp->t_state = TCPS_CLOSE_WAIT;
+			tcp_state_change(tp, TCPS_CLOSE_WAIT);
 			break;
 
 		/*
@@ -2895,7 +2957,7 @@ dodata:							/* XXX */
 		 */
 		case TCPS_FIN_WAIT_1:
 
-			tp->t_state = TCPS_CLOSING;
+			tcp_state_change(tp, TCPS_CLOSING);
 			break;
 
 		/*
@@ -2928,7 +2990,8 @@ dodata:							/* XXX */
 	/*
 	 * Return any desired output.
 	 */
-	if (needoutput || (tp->t_flags & TF_ACKNOW)) {
+	if (needoutput ||
+	    ((tp->t_flags & TF_ACKNOW) && !tcp_ack_defer(tp))) {
 		if (no_unlock) {
 			//OFP_INFO("no_unlock set; but calling ofp_tcp_output?");
 		}
@@ -3211,6 +3274,19 @@ tcp_dooptions(struct tcpopt *to, uint8_t *cp, int cnt, int flags)
 			to->to_sacks = cp + 2;
 			TCPSTAT_INC(tcps_sack_rcv_blocks);
 			break;
+		case OFP_TCPOPT_FAST_OPEN:
+			/* Empty (cookie request) or 4 to 16 bytes, even. */
+			if (optlen != OFP_TCPOLEN_FAST_OPEN_EMPTY &&
+			    (optlen < OFP_TCPOLEN_FAST_OPEN_MIN ||
+			     optlen > OFP_TCPOLEN_FAST_OPEN_MAX ||
+			     optlen % 2))
+				continue;
+			if (!(flags & TO_SYN))
+				continue;
+			to->to_flags |= TOF_FASTOPEN;
+			to->to_tfo_len = optlen - 2;
+			to->to_tfo_cookie = to->to_tfo_len ? cp + 2 : NULL;
+			break;
 		default:
 			continue;
 		}
@@ -3648,9 +3724,41 @@ tcp_newreno_partial_ack(struct tcpcb *tp, struct ofp_tcphdr *th)
 	tp->snd_cwnd += tp->t_maxseg;
 }
 
+/*
+ * Place the tables of each core after the syncache hash. Returns the
+ * size of the TCP shared memory. The table pointers are set if mem is
+ * not NULL.
+ */
+#define TCP_VAR_PLACE(field, num) do {					\
+		off = ROUNDUP_CACHE(off);				\
+		if (mem)						\
+			mem->field = (void *)((uint8_t *)mem + off);	\
+		off += (num) * sizeof(*mem->field);			\
+	} while (0)
+
+static uint64_t tcp_var_layout(struct ofp_tcp_var_mem *mem)
+{
+	uint64_t off = TCP_SYNCACHE_OFFSET +
+		TCP_NUM_CPU * ofp_syncache_hashsize() *
+		sizeof(struct syncache_head);
+	uint64_t num = TCP_NUM_CPU;
+
+	TCP_VAR_PLACE(ofp_tcb, num);
+	TCP_VAR_PLACE(ofp_tcbinfo, num);
+	TCP_VAR_PLACE(twq_2msl, num);
+	TCP_VAR_PLACE(ofp_tcp_slow_timer, num);
+	TCP_VAR_PLACE(ofp_hashtbl, num * TCP_HASH_SIZE);
+	TCP_VAR_PLACE(ofp_porthashtbl, num * TCP_HASH_SIZE);
+	TCP_VAR_PLACE(twtbl, num);
+
+	return off;
+}
+
+#define SHM_SIZE_TCP_VAR tcp_var_layout(NULL)
+
 static int ofp_tcp_var_alloc_shared_memory(void)
 {
-	shm_tcp = ofp_shared_memory_alloc(SHM_NAME_TCP_VAR, sizeof(*shm_tcp));
+	shm_tcp = ofp_shared_memory_alloc(SHM_NAME_TCP_VAR, SHM_SIZE_TCP_VAR);
 	if (shm_tcp == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -3685,12 +3793,19 @@ int ofp_tcp_var_lookup_shared_memory(void)
 
 void ofp_tcp_var_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_TCP_VAR, sizeof(*shm_tcp));
+	ofp_shared_memory_prealloc(SHM_NAME_TCP_VAR, SHM_SIZE_TCP_VAR);
 }
 
 int ofp_tcp_var_init_global(void)
 {
+	if (global_param->tcp_syncache_max <= 0) {
+		OFP_ERR("Invalid tcp_syncache_max %d",
+			global_param->tcp_syncache_max);
+		return -1;
+	}
+
 	HANDLE_ERROR(ofp_tcp_var_alloc_shared_memory());
+	tcp_var_layout(shm_tcp);
 
 	return 0;
 }
@@ -38,6 +38,7 @@
 #include "ofpi_protosw.h"
 #include "ofpi_sysctl.h"
 #include "ofpi_socketvar.h"
+#include "ofpi_mem_pressure.h"
 
 #include "ofpi_in.h"
 #include "ofpi_ip.h"
@@ -48,6 +49,7 @@
 #define	OFP_TCPOUTFLAGS
 
 #include "ofpi_util.h"
+#include "ofpi_init.h"
 #include "ofpi_pkt_processing.h"
 #include "ofpi_systm.h"
 #include "ofpi_timer.h"
@@ -56,6 +58,7 @@
 #include "ofpi_tcp_seq.h"
 #include "ofpi_tcp_timer.h"
 #include "ofpi_tcp_var.h"
+#include "ofpi_cc.h"
 //#include "ofp_tcpip.h"
 
 
@@ -112,6 +115,10 @@ static inline void	hhook_run_tcp_est_out(struct tcpcb *tp,
 			    long len, int tso);
 */
 static inline void	cc_after_idle(struct tcpcb *tp);
+static inline void	cc_data_sent(struct tcpcb *tp);
+static int		tcp_pace_wait(struct tcpcb *tp);
+static void		tcp_pace_stamp(struct tcpcb *tp, struct socket *so,
+			    odp_packet_t m, long len);
 
 /*
  * Wrapper for the TCP established ouput helper hook.
@@ -141,13 +148,78 @@ hhook_run_tcp_est_out(struct tcpcb *tp, struct ofp_tcphdr *th,
 static inline void
 cc_after_idle(struct tcpcb *tp)
 {
-	(void)tp;
-#if 0
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
 	if (CC_ALGO(tp)->after_idle != NULL)
 		CC_ALGO(tp)->after_idle(tp->ccv);
-#endif
+}
+
+static inline void
+cc_data_sent(struct tcpcb *tp)
+{
+	if (CC_ALGO(tp)->data_sent != NULL)
+		CC_ALGO(tp)->data_sent(tp->ccv);
+}
+
+/*
+ * Pacing rate of the connection: the rate of the CC algorithm, limited
+ * by OFP_SO_MAX_PACING_RATE of the socket. 0 if not paced.
+ */
+static inline uint64_t
+tcp_pacing_rate(struct tcpcb *tp, struct socket *so)
+{
+	uint64_t rate = tp->t_pacing_rate;
+
+	if (so->so_max_pacing_rate &&
+	    (rate == 0 || rate > so->so_max_pacing_rate))
+		rate = so->so_max_pacing_rate;
+	return rate;
+}
+
+/*
+ * New data of a paced connection is sent while its schedule is less than
+ * a timer tick ahead, otherwise the pace timer resumes output when it is
+ * due. The packets sent carry their departure time, on which the
+ * transmit layer releases them (see send_pkt_out()).
+ */
+#define TCP_PACE_SLACK_NS	(OFP_TIMER_RESOLUTION_US * 1000)
+
+static int
+tcp_pace_wait(struct tcpcb *tp)
+{
+	uint64_t now = odp_time_to_ns(odp_time_global());
+	uint64_t ahead;
+
+	if (tp->t_pace_next <= now + TCP_PACE_SLACK_NS)
+		return 0;
+
+	if (!ofp_tcp_timer_active(tp, TT_PACE)) {
+		ahead = tp->t_pace_next - now - TCP_PACE_SLACK_NS;
+		ofp_tcp_timer_activate(tp, TT_PACE,
+				       ahead / TCP_PACE_SLACK_NS + 1);
+	}
+	return 1;
+}
+
+static void
+tcp_pace_stamp(struct tcpcb *tp, struct socket *so, odp_packet_t m, long len)
+{
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(m);
+	uint64_t rate = tcp_pacing_rate(tp, so);
+	uint64_t now;
+
+	if (rate == 0)
+		return;
+
+	now = odp_time_to_ns(odp_time_global());
+
+	if (tp->t_pace_next < now)
+		tp->t_pace_next = now;
+	ua->valid |= OFP_UA_PACE;
+	ua->tx_time = tp->t_pace_next;
+	ua->tx_gap = ua->tso_segsz ?
+		(uint64_t)ua->tso_segsz * ODP_TIME_SEC_IN_NS / rate : 0;
+	tp->t_pace_next += (uint64_t)len * ODP_TIME_SEC_IN_NS / rate;
 }
 
 /*
@@ -192,8 +264,10 @@ ofp_tcp_output(struct tcpcb *tp)
 	 * to send, then transmit; otherwise, investigate further.
 	 */
 	idle = (tp->t_flags & TF_LASTIDLE) || (tp->snd_max == tp->snd_una);
-	if (idle && (int)(ofp_timer_ticks(0) - tp->t_rcvtime) >= tp->t_rxtcur)
+	if (idle && (int)(ofp_timer_ticks(0) - tp->t_rcvtime) >= tp->t_rxtcur) {
 		cc_after_idle(tp);
+		ofp_tcp_sbautoshrink(tp);
+	}
 	t_flags_and(tp->t_flags, ~TF_LASTIDLE);
 	if (idle) {/* OK */
 		if (tp->t_flags & TF_MORETOCOME) {
@@ -218,6 +292,16 @@ again:
 #endif
 	sendwin = min(tp->snd_wnd, tp->snd_cwnd);
 
+	if (TCPS_HAVEESTABLISHED(tp->t_state)) {
+		int lim = so->so_snd.sb_cc <= (uint64_t)sendwin ?
+			TCP_LIM_APP : tp->snd_wnd <= tp->snd_cwnd ?
+			TCP_LIM_RWND : TCP_LIM_CWND;
+
+		if (odp_unlikely(lim != tp->t_lim || !tp->t_lim_start))
+			tcp_limit_account(tp, lim,
+					  odp_time_to_ns(odp_time_global()));
+	}
+
 	flags = tcp_outflags[tp->t_state];
 	/*
 	 * Send any SACK-generated retransmissions.  If we're explicitly trying
@@ -375,6 +459,13 @@ after_sack_rexmit:
 	if ((flags & OFP_TH_SYN) && SEQ_GT(tp->snd_nxt, tp->snd_una)) {
 		if (tp->t_state != TCPS_SYN_RECEIVED)
 			flags &= ~OFP_TH_SYN;
+		/*
+		 * Segments that follow the SYN|ACK of a TFO connection
+		 * carry data only.
+		 */
+		if ((tp->t_flags & TF_FASTOPEN) &&
+		    tp->t_state == TCPS_SYN_RECEIVED)
+			flags &= ~OFP_TH_SYN;
 		off--, len++;
 	}
 
@@ -388,6 +479,16 @@ after_sack_rexmit:
 		flags &= ~OFP_TH_FIN;
 	}
 
+	/*
+	 * A TFO SYN carries data only with a cookie, and not when
+	 * retransmitted: the peer or a middlebox may have dropped it
+	 * because of the data.
+	 */
+	if ((tp->t_flags & TF_FASTOPEN) && (flags & OFP_TH_SYN) &&
+	    (tp->t_rxtshift > 0 ||
+	     (tp->t_state == TCPS_SYN_SENT && tp->t_tfo_len == 0)))
+		len = 0;
+
 	if (len < 0) {
 		/*
 		 * If FIN has been sent but not acked,
@@ -443,23 +544,29 @@ after_sack_rexmit:
 	 * of available bandwith (the non-use of it) for wasting some
 	 * socket buffer memory.
 	 *
-	 * TODO: Shrink send buffer during idle periods together
-	 * with congestion window.  Requires another timer.  Has to
-	 * wait for upcoming tcp timer rewrite.
+	 * Both buffers shrink back, together with the congestion window,
+	 * when the connection has been idle for a retransmission timeout.
 	 */
-#if 0 /* HJo: FIX */
 	if (V_tcp_do_autosndbuf && so->so_snd.sb_flags & SB_AUTOSIZE) {
 		if ((tp->snd_wnd / 4 * 5) >= so->so_snd.sb_hiwat &&
 		    so->so_snd.sb_cc >= (so->so_snd.sb_hiwat / 8 * 7) &&
-		    so->so_snd.sb_cc < V_tcp_autosndbuf_max &&
-		    sendwin >= (so->so_snd.sb_cc - (tp->snd_nxt - tp->snd_una))) {
-			if (!ofp_sbreserve_locked(&so->so_snd,
+		    so->so_snd.sb_cc < (uint32_t)V_tcp_autosndbuf_max &&
+		    sendwin >= (long)(so->so_snd.sb_cc -
+				      (tp->snd_nxt - tp->snd_una))) {
+			if (!ofp_sbautosize_locked(&so->so_snd,
 			    min(so->so_snd.sb_hiwat + V_tcp_autosndbuf_inc,
-			     V_tcp_autosndbuf_max), so, curthread))
+			     V_tcp_autosndbuf_max), tp->t_maxseg))
 				so->so_snd.sb_flags &= ~SB_AUTOSIZE;
 		}
 	}
-#endif
+	/*
+	 * Hold new data back until the pacing rate allows it.
+	 */
+	if (len && tcp_pacing_rate(tp, so) && !sack_rxmit &&
+	    (tp->t_flags & TF_FORCEDATA) == 0 &&
+	    SEQ_GEQ(tp->snd_nxt, tp->snd_max) && tcp_pace_wait(tp))
+		len = 0;
+
 	/*
 	 * Decide if we can use TCP Segmentation Offloading (if supported by
 	 * hardware).
@@ -487,6 +594,8 @@ after_sack_rexmit:
 	}
 
 	recwin = sbspace(&so->so_rcv);
+	/* Advertise less under memory pressure, never less than before */
+	recwin >>= ofp_mem_pressure();
 
 	/*
 	 * Sender silly window avoidance.   We transmit under the following
@@ -656,7 +765,8 @@ dontupdate:
 	 * otherwise force out a byte.
 	 */
 	if (so->so_snd.sb_cc && !ofp_tcp_timer_active(tp, TT_REXMT) &&
-	    !ofp_tcp_timer_active(tp, TT_PERSIST)) {
+	    !ofp_tcp_timer_active(tp, TT_PERSIST) &&
+	    !ofp_tcp_timer_active(tp, TT_PACE)) {
 		tp->t_rxtshift = 0;
 		ofp_tcp_setpersist(tp);
 	}
@@ -733,6 +843,13 @@ send:
 		if (tp->t_flags & TF_SIGNATURE)
 			to.to_flags |= TOF_SIGNATURE;
 #endif /* TCP_SIGNATURE */
+		/* TCP Fast Open cookie or cookie request (RFC 7413). */
+		if ((flags & OFP_TH_SYN) && (tp->t_flags & TF_FASTOPEN) &&
+		    tp->t_state == TCPS_SYN_SENT) {
+			to.to_tfo_len = tp->t_tfo_len;
+			to.to_tfo_cookie = tp->t_tfo_cookie;
+			to.to_flags |= TOF_FASTOPEN;
+		}
 
 		/* Processing the options. */
 		hdrlen += optlen = ofp_tcp_addoptions(&to, opt);
@@ -775,6 +892,17 @@ send:
 				sendalot = 1;
 			}
 
+			/*
+			 * The burst is copied into one packet, see
+			 * ofp_sockbuf_copy_out() below.
+			 */
+			if (len > (long)global_param->pkt_pool.buffer_size -
+			    hdrlen) {
+				len = global_param->pkt_pool.buffer_size -
+					hdrlen;
+				sendalot = 1;
+			}
+
 			/*
 			 * Prevent the last segment from being
 			 * fractional unless the send sockbuf can
@@ -795,6 +923,10 @@ send:
 			if (tp->t_flags & TF_NEEDFIN)
 				sendalot = 1;
 
+			/* A burst of one segment is sent as such */
+			if (len <= (long)tp->t_maxopd - optlen)
+				tso = 0;
+
 		} else {/* OK */
 			len = tp->t_maxopd - optlen - ipoptlen;
 			sendalot = 1;
@@ -833,12 +965,16 @@ send:
 			TCPSTAT_INC(tcps_sndprobe);
 		else if (SEQ_LT(tp->snd_nxt, tp->snd_max) || sack_rxmit) {
 			tp->t_sndrexmitpack++;
+			tp->t_sndrexmitbyte += len;
+			OFP_TRACEPOINT(tcp_retransmit, tp, tp->snd_una + off,
+				       len);
 			TCPSTAT_INC(tcps_sndrexmitpack);
 			TCPSTAT_ADD(tcps_sndrexmitbyte, len);
 		} else {/* OK */
 			TCPSTAT_INC(tcps_sndpack);
 			TCPSTAT_ADD(tcps_sndbyte, len);
 		}
+		tp->t_sndbyte += len;
 
 		m = ofp_socket_packet_alloc(hdrlen + len);
 
@@ -867,8 +1003,7 @@ send:
 #endif /*INET6*/
 			sizeof(struct ofp_ip));
 
-		ofp_sockbuf_copy_out(&so->so_snd, off, len,
-				       (char *)odp_packet_data(m) + hdrlen);
+		ofp_sockbuf_copy_out(&so->so_snd, off, len, m, hdrlen);
 		/*
 		odp_packet_t src = so->so_snd.sb_mb[so->so_snd.sb_get];
 		memcpy((uint8_t *)odp_packet_data(m) + hdrlen,
@@ -921,14 +1056,14 @@ send:
 	if (isipv6) {
 		ip6 = (struct ofp_ip6_hdr *)odp_packet_data(m);
 		th = (struct ofp_tcphdr *)odp_packet_l4_ptr(m, NULL);
-		ofp_tcpip_fillheaders(tp->t_inpcb, ip6, th);
+		ofp_tcpip_copyheaders(tp, ip6, th);
 	} else
 #endif /* INET6 */
 	{/* OK */
 		ip = (struct ofp_ip *)(odp_packet_data(m));
 		ipov = (struct ipovly *)ip;
 		th = (struct ofp_tcphdr *)(ip + 1);
-		ofp_tcpip_fillheaders(tp->t_inpcb, ip, th);
+		ofp_tcpip_copyheaders(tp, ip, th);
 	}
 
 	/*
@@ -953,6 +1088,10 @@ send:
 		} else
 			flags |= OFP_TH_ECE|OFP_TH_CWR;
 	}
+	/* SYN|ACK of a TFO connection, see syncache_respond(). */
+	if (tp->t_state == TCPS_SYN_RECEIVED && (flags & OFP_TH_SYN) &&
+	    (tp->t_flags & TF_ECN_PERMIT))
+		flags |= OFP_TH_ECE;
 
 	if (tp->t_state == TCPS_ESTABLISHED &&
 	    (tp->t_flags & TF_ECN_PERMIT)) {
@@ -1006,6 +1145,7 @@ send:
 	} else {
 		th->th_seq = odp_cpu_to_be_32(p->rxmit);
 		p->rxmit += len;
+		p->rxmit_ts = tcp_ts_getticks();
 		tp->sackhint.sack_bytes_rexmit += len;
 	}
 	th->th_ack = odp_cpu_to_be_32(tp->rcv_nxt);
@@ -1113,11 +1253,12 @@ send:
 		    ("%s: len <= tso_segsz", __func__));
 		odp_packet_set_csum_flags(m, odp_packet_csum_flags(m) |
 					  CSUM_TSO);
-		/* HJo: FIX:
-		m->m_pkthdr.tso_segsz = tp->t_maxopd - optlen;
-		*/
+		ofp_packet_user_area(m)->tso_segsz = tp->t_maxopd - optlen;
 	}
 
+	if (len)
+		tcp_pace_stamp(tp, so, m, len);
+
 	KASSERT(len + hdrlen + ipoptlen == (int)odp_packet_len(m),
 	    ("%s: mbuf chain shorter than expected: %ld + %u + %d != %d",
 	    __func__, len, hdrlen, ipoptlen, odp_packet_len(m)));
@@ -1147,6 +1288,7 @@ send:
 		tp->snd_nxt += len;
 		if (SEQ_GT(tp->snd_nxt, tp->snd_max)) {/* OK */
 			tp->snd_max = tp->snd_nxt;
+			cc_data_sent(tp);
 			/*
 			 * Time this transmission if not a retransmission and
 			 * not currently timing anything.
@@ -1276,7 +1418,7 @@ timer:
 	
 	ofp_packet_user_area(m)->chksum_flags |= OFP_TCP_CHKSUM_INSERT;
 
-	error = ofp_ip_output(m, NULL);
+	error = ofp_in_pcb_ip_output(tp->t_inpcb, m);
     }
 
 	if (error != OFP_PKT_PROCESSED) {
@@ -1384,6 +1526,24 @@ out:
 	return (0);
 }
 
+/*
+ * Shrink the autosized buffers of an idle connection, they regrow from
+ * the initial size. The receive buffer keeps the window already
+ * advertised. Called with the so_snd lock held.
+ */
+void
+ofp_tcp_sbautoshrink(struct tcpcb *tp)
+{
+	struct socket *so = tp->t_inpcb->inp_socket;
+
+	ofp_sbautoshrink_locked(&so->so_snd, 0);
+	SOCKBUF_LOCK(&so->so_rcv);
+	ofp_sbautoshrink_locked(&so->so_rcv,
+				SEQ_GT(tp->rcv_adv, tp->rcv_nxt) ?
+				tp->rcv_adv - tp->rcv_nxt : 0);
+	SOCKBUF_UNLOCK(&so->so_rcv);
+}
+
 void
 ofp_tcp_setpersist(struct tcpcb *tp)
 {
@@ -1533,6 +1693,24 @@ ofp_tcp_addoptions(struct tcpopt *to, uint8_t *optp)
 			TCPSTAT_INC(tcps_sack_send_blocks);
 			break;
 			}
+		case TOF_FASTOPEN:
+			{
+			int total_len = OFP_TCPOLEN_FAST_OPEN_EMPTY +
+				to->to_tfo_len;
+
+			if (OFP_TCP_MAXOLEN - optlen < (uint32_t)total_len) {
+				to->to_flags &= ~TOF_FASTOPEN;
+				continue;
+			}
+			*optp++ = OFP_TCPOPT_FAST_OPEN;
+			*optp++ = total_len;
+			if (to->to_tfo_len) {
+				bcopy(to->to_tfo_cookie, optp, to->to_tfo_len);
+				optp += to->to_tfo_len;
+			}
+			optlen += total_len;
+			break;
+			}
 		default:
 			panic("unknown TCP option type");
 			break;
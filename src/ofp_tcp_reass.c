@@ -131,6 +131,44 @@ ofp_tcp_reass_init(void)
 	uma_zone_set_max(V_tcp_reass_zone, V_tcp_reass_maxseg);
 }
 
+/*
+ * Queued segments are kept in t_segq in sequence order and indexed by
+ * sequence number in t_segqtree. Entries never overlap and contiguous
+ * segments are concatenated into one packet, so an entry is a run of
+ * data.
+ */
+static inline int
+tcp_reass_cmp(struct tseg_qent *a, struct tseg_qent *b)
+{
+	if (SEQ_LT(a->tqe_seq, b->tqe_seq))
+		return -1;
+	return SEQ_GT(a->tqe_seq, b->tqe_seq);
+}
+
+RB_GENERATE(tsegq_tree, tseg_qent, tqe_rb, tcp_reass_cmp);
+
+static void
+tcp_reass_remove(struct tcpcb *tp, struct tseg_qent *q)
+{
+	OFP_LIST_REMOVE(q, tqe_q);
+	RB_REMOVE(tsegq_tree, &tp->t_segqtree, q);
+	tp->t_segqlen--;
+	tp->t_segqbytes -= q->tqe_len;
+}
+
+/* Append the run of n to q, n is removed on success */
+static int
+tcp_reass_concat(struct tcpcb *tp, struct tseg_qent *q, struct tseg_qent *n)
+{
+	if (odp_packet_concat(&q->tqe_m, n->tqe_m) < 0)
+		return -1;
+	tcp_reass_remove(tp, n);
+	q->tqe_len += n->tqe_len;
+	q->tqe_flags |= n->tqe_flags;
+	tp->t_segqbytes += n->tqe_len;
+	return 0;
+}
+
 void
 ofp_tcp_reass_flush(struct tcpcb *tp)
 {
@@ -139,9 +177,9 @@ ofp_tcp_reass_flush(struct tcpcb *tp)
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
 	while ((qe = OFP_LIST_FIRST(&tp->t_segq)) != NULL) {
-		OFP_LIST_REMOVE(qe, tqe_q);
+		tcp_reass_remove(tp, qe);
+		odp_packet_free(qe->tqe_m);
 		uma_zfree(V_tcp_reass_zone, qe);
-		tp->t_segqlen--;
 	}
 
 	KASSERT((tp->t_segqlen == 0),
@@ -170,18 +208,15 @@ ofp_tcp_reass(struct tcpcb *tp, struct ofp_tcphdr *th, int *tlenp, odp_packet_t
 	struct tseg_qent *p = NULL;
 	struct tseg_qent *nq;
 	struct tseg_qent *te = NULL;
+	struct tseg_qent key;
 	struct socket *so = tp->t_inpcb->inp_socket;
 	char *s = NULL;
 	int flags;
+	int i;
 	struct tseg_qent tqs;
 
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
-	/*
-	 * XXX: ofp_tcp_reass() is rather inefficient with its data structures
-	 * and should be rewritten (see NetBSD for optimizations).
-	 */
-
 	/*
 	 * Call with th==NULL after become established to
 	 * force pre-ESTABLISHED data up to user socket.
@@ -190,25 +225,21 @@ ofp_tcp_reass(struct tcpcb *tp, struct ofp_tcphdr *th, int *tlenp, odp_packet_t
 		goto present;
 
 	/*
-	 * Limit the number of segments that can be queued to reduce the
-	 * potential for mbuf exhaustion. For best performance, we want to be
-	 * able to queue a full window's worth of segments. The size of the
-	 * socket receive buffer determines our advertised window and grows
-	 * automatically when socket buffer autotuning is enabled. Use it as the
-	 * basis for our queue limit.
+	 * Limit the number of runs and the bytes that can be queued to
+	 * reduce the potential for packet exhaustion. For best performance,
+	 * we want to be able to queue a full window's worth of segments.
+	 * The size of the socket receive buffer determines our advertised
+	 * window and grows automatically when socket buffer autotuning is
+	 * enabled. Use it as the basis for our queue limits.
 	 * Always let the missing segment through which caused this queue.
 	 * NB: Access to the socket buffer is left intentionally unlocked as we
 	 * can tolerate stale information here.
-	 *
-	 * XXXLAS: Using sbspace(so->so_rcv) instead of so->so_rcv.sb_hiwat
-	 * should work but causes packets to be dropped when they shouldn't.
-	 * Investigate why and re-evaluate the below limit after the behaviour
-	 * is understood.
 	 */
-
 	if ((th->th_seq != tp->rcv_nxt || !TCPS_HAVEESTABLISHED(tp->t_state)) &&
-	    tp->t_segqlen >= (int)(so->so_rcv.sb_hiwat / tp->t_maxseg) + 1) {
+	    (tp->t_segqlen >= (int)(so->so_rcv.sb_hiwat / tp->t_maxseg) + 1 ||
+	     tp->t_segqbytes + *tlenp > (int)so->so_rcv.sb_hiwat)) {
 		V_tcp_reass_overflows++;
+		tp->t_rcvoodrop++;
 		TCPSTAT_INC(tcps_rcvmemdrop);
 		odp_packet_free(m);
 		*tlenp = 0;
@@ -220,65 +251,29 @@ ofp_tcp_reass(struct tcpcb *tp, struct ofp_tcphdr *th, int *tlenp, odp_packet_t
 	}
 
 	/*
-	 * Allocate a new queue entry. If we can't, or hit the zone limit
-	 * just drop the pkt.
-	 *
-	 * Use a temporary structure on the stack for the missing segment
-	 * when the zone is exhausted. Otherwise we may get stuck.
-	 */
-	te = uma_zalloc(V_tcp_reass_zone, OFP_M_NOWAIT);
-	if (te == NULL) {
-		if (th->th_seq != tp->rcv_nxt || !TCPS_HAVEESTABLISHED(tp->t_state)) {
-			TCPSTAT_INC(tcps_rcvmemdrop);
-			odp_packet_free(m);
-			*tlenp = 0;
-			if ((s = ofp_tcp_log_addrs(&tp->t_inpcb->inp_inc, th, NULL,
-					       NULL))) {
-				OFP_INFO("%s; global zone limit "
-					  "reached, segment dropped", s);
-				free(s);
-			}
-			return (0);
-		}
-
-		bzero(&tqs, sizeof(struct tseg_qent));
-		te = &tqs;
-		if ((s = ofp_tcp_log_addrs(&tp->t_inpcb->inp_inc, th, NULL,
-				       NULL))) {
-			OFP_INFO(
-			    "%s; global zone limit reached, using "
-			    "stack for missing segment", s);
-			free(s);
-		}
-	}
-	tp->t_segqlen++;
-
-	/*
-	 * Find a segment which begins after this one does.
+	 * Find the first run which begins after this segment does, and
+	 * the one before it.
 	 */
-	OFP_LIST_FOREACH(q, &tp->t_segq, tqe_q) {
-		if (SEQ_GT(q->tqe_th->th_seq, th->th_seq))
-			break;
-		p = q;
-	}
+	key.tqe_seq = th->th_seq + 1;
+	q = RB_NFIND(tsegq_tree, &tp->t_segqtree, &key);
+	if (q != NULL)
+		p = RB_PREV(tsegq_tree, &tp->t_segqtree, q);
+	else
+		p = RB_MAX(tsegq_tree, &tp->t_segqtree);
 
 	/*
-	 * If there is a preceding segment, it may provide some of
+	 * If there is a preceding run, it may provide some of
 	 * our data already.  If so, drop the data from the incoming
 	 * segment.  If it provides all of our data, drop us.
 	 */
 	if (p != NULL) {
-		int i;
 		/* conversion to int (in i) handles seq wraparound */
-		i = p->tqe_th->th_seq + p->tqe_len - th->th_seq;
+		i = p->tqe_seq + p->tqe_len - th->th_seq;
 		if (i > 0) {
 			if (i >= *tlenp) {
 				TCPSTAT_INC(tcps_rcvduppack);
 				TCPSTAT_ADD(tcps_rcvdupbyte, *tlenp);
 				odp_packet_free(m);
-				if (te != &tqs)
-					uma_zfree(V_tcp_reass_zone, te);
-				tp->t_segqlen--;
 				/*
 				 * Try to present any queued data
 				 * at the left window edge to the user.
@@ -287,42 +282,79 @@ ofp_tcp_reass(struct tcpcb *tp, struct ofp_tcphdr *th, int *tlenp, odp_packet_t
 				 */
 				goto present;	/* ??? */
 			}
-			odp_packet_pull_head(m, i);
+			odp_packet_trunc_head(&m, i, NULL, NULL);
 			*tlenp -= i;
 			th->th_seq += i;
 		}
 	}
-	tp->t_rcvoopack++;
-	TCPSTAT_INC(tcps_rcvoopack);
-	TCPSTAT_ADD(tcps_rcvoobyte, *tlenp);
 
 	/*
-	 * While we overlap succeeding segments trim them or,
-	 * if they are completely covered, dequeue them.
+	 * While we overlap succeeding runs drop the overlapping data from
+	 * the end of this segment, or, if they are completely covered,
+	 * dequeue them.
 	 */
+	flags = th->th_flags & OFP_TH_FIN;
 	while (q) {
-		int i = (th->th_seq + *tlenp) - q->tqe_th->th_seq;
+		i = (th->th_seq + *tlenp) - q->tqe_seq;
 		if (i <= 0)
 			break;
 		if (i < q->tqe_len) {
-			q->tqe_th->th_seq += i;
-			q->tqe_len -= i;
-			odp_packet_pull_head(q->tqe_m, i);
+			odp_packet_trunc_tail(&m, i, NULL, NULL);
+			*tlenp -= i;
+			flags = 0;
 			break;
 		}
 
 		nq = OFP_LIST_NEXT(q, tqe_q);
-		OFP_LIST_REMOVE(q, tqe_q);
+		tcp_reass_remove(tp, q);
 		odp_packet_free(q->tqe_m);
 		uma_zfree(V_tcp_reass_zone, q);
-		tp->t_segqlen--;
 		q = nq;
 	}
 
+	tp->t_rcvoopack++;
+	TCPSTAT_INC(tcps_rcvoopack);
+	TCPSTAT_ADD(tcps_rcvoobyte, *tlenp);
+
+	/*
+	 * Allocate a new queue entry. If we can't, or hit the zone limit
+	 * just drop the pkt.
+	 *
+	 * Use a temporary structure on the stack for the missing segment
+	 * when the zone is exhausted. Otherwise we may get stuck.
+	 */
+	te = uma_zalloc(V_tcp_reass_zone, OFP_M_NOWAIT);
+	if (te == NULL) {
+		if (th->th_seq != tp->rcv_nxt || !TCPS_HAVEESTABLISHED(tp->t_state)) {
+			tp->t_rcvoodrop++;
+			TCPSTAT_INC(tcps_rcvmemdrop);
+			odp_packet_free(m);
+			*tlenp = 0;
+			if ((s = ofp_tcp_log_addrs(&tp->t_inpcb->inp_inc, th, NULL,
+					       NULL))) {
+				OFP_INFO("%s; global zone limit "
+					  "reached, segment dropped", s);
+				free(s);
+			}
+			return (0);
+		}
+
+		bzero(&tqs, sizeof(struct tseg_qent));
+		te = &tqs;
+		if ((s = ofp_tcp_log_addrs(&tp->t_inpcb->inp_inc, th, NULL,
+				       NULL))) {
+			OFP_INFO(
+			    "%s; global zone limit reached, using "
+			    "stack for missing segment", s);
+			free(s);
+		}
+	}
+
 	/* Insert the new segment queue entry into place. */
 	te->tqe_m = m;
-	te->tqe_th = th;
+	te->tqe_seq = th->th_seq;
 	te->tqe_len = *tlenp;
+	te->tqe_flags = flags;
 
 	if (p == NULL) {
 		OFP_LIST_INSERT_HEAD(&tp->t_segq, te, tqe_q);
@@ -331,6 +363,22 @@ ofp_tcp_reass(struct tcpcb *tp, struct ofp_tcphdr *th, int *tlenp, odp_packet_t
 				     "first element in queue", __func__));
 		OFP_LIST_INSERT_AFTER(p, te, tqe_q);
 	}
+	RB_INSERT(tsegq_tree, &tp->t_segqtree, te);
+	tp->t_segqlen++;
+	tp->t_segqbytes += te->tqe_len;
+
+	/*
+	 * Chain the segment to the adjacent runs, without copying the data
+	 * where the packet pool allows it.
+	 */
+	if (q != NULL && te->tqe_seq + te->tqe_len == q->tqe_seq &&
+	    !(te->tqe_flags & OFP_TH_FIN) &&
+	    tcp_reass_concat(tp, te, q) == 0)
+		uma_zfree(V_tcp_reass_zone, q);
+	if (p != NULL && p->tqe_seq + p->tqe_len == te->tqe_seq &&
+	    !(p->tqe_flags & OFP_TH_FIN) &&
+	    tcp_reass_concat(tp, p, te) == 0)
+		uma_zfree(V_tcp_reass_zone, te);
 
 present:
 	/*
@@ -340,16 +388,16 @@ present:
 	if (!TCPS_HAVEESTABLISHED(tp->t_state))
 		return (0);
 	q = OFP_LIST_FIRST(&tp->t_segq);
-	if (!q || q->tqe_th->th_seq != tp->rcv_nxt)
+	if (!q || q->tqe_seq != tp->rcv_nxt)
 		return (0);
 
 	SOCKBUF_LOCK(&so->so_rcv);
 
 	do {
 		tp->rcv_nxt += q->tqe_len;
-		flags = q->tqe_th->th_flags & OFP_TH_FIN;
+		flags = q->tqe_flags & OFP_TH_FIN;
 		nq = OFP_LIST_NEXT(q, tqe_q);
-		OFP_LIST_REMOVE(q, tqe_q);
+		tcp_reass_remove(tp, q);
 		if (so->so_rcv.sb_state & SBS_CANTRCVMORE)
 			odp_packet_free(q->tqe_m);
 		else
@@ -357,9 +405,8 @@ present:
 		if (q != &tqs) {
 			uma_zfree(V_tcp_reass_zone, q);
 		}
-		tp->t_segqlen--;
 		q = nq;
-	} while (q && q->tqe_th->th_seq == tp->rcv_nxt);
+	} while (q && q->tqe_seq == tp->rcv_nxt);
 
 	ND6_HINT(tp);
 	sorwakeup_locked(so);
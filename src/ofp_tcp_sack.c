@@ -138,6 +138,37 @@ SYSCTL_VNET_INT(_net_inet_tcp_sack, OFP_OID_AUTO, globalholes, OFP_CTLFLAG_RD,
     &VNET_NAME(ofp_tcp_sack_globalholes), 0,
     "Global number of TCP SACK holes currently allocated");
 
+VNET_DEFINE(int, ofp_tcp_sack_rack) = 1;
+SYSCTL_VNET_INT(_net_inet_tcp_sack, OFP_OID_AUTO, rack, OFP_CTLFLAG_RW,
+    &VNET_NAME(ofp_tcp_sack_rack), 0,
+    "Detect lost retransmissions from the time SACKed data was sent");
+
+/*
+ * Holes are kept both in the ordered snd_holes list and in a tree
+ * sorted by end, so that the hole a SACK block falls into is found
+ * without walking the list. Holes never overlap, so trimming a hole in
+ * place does not change its position in the tree.
+ */
+static inline int
+tcp_sackhole_cmp(struct sackhole *a, struct sackhole *b)
+{
+	if (SEQ_LT(a->end, b->end))
+		return -1;
+	return SEQ_GT(a->end, b->end);
+}
+
+RB_GENERATE(sackhole_tree, sackhole, scbtree, tcp_sackhole_cmp);
+
+/* First hole ending after seq */
+static inline struct sackhole *
+tcp_sackhole_find(struct tcpcb *tp, tcp_seq seq)
+{
+	struct sackhole key;
+
+	key.end = seq + 1;
+	return RB_NFIND(sackhole_tree, &tp->snd_holes_tree, &key);
+}
+
 /*
  * This function is called upon receipt of new valid data (while not in
  * header prediction mode), and it updates the ordered list of sacks.
@@ -261,6 +292,7 @@ tcp_sackhole_alloc(struct tcpcb *tp, tcp_seq start, tcp_seq end)
 	hole->start = start;
 	hole->end = end;
 	hole->rxmit = start;
+	hole->rxmit_ts = 0;
 
 	tp->snd_numholes++;
 	odp_atomic_inc_u32((odp_atomic_u32_t *)&V_tcp_sack_globalholes);
@@ -303,6 +335,7 @@ tcp_sackhole_insert(struct tcpcb *tp, tcp_seq start, tcp_seq end,
 		OFP_TAILQ_INSERT_AFTER(&tp->snd_holes, after, hole, scblink);
 	else
 		OFP_TAILQ_INSERT_TAIL(&tp->snd_holes, hole, scblink);
+	RB_INSERT(sackhole_tree, &tp->snd_holes_tree, hole);
 
 	/* Update SACK hint. */
 	if (tp->sackhint.nexthole == NULL)
@@ -324,11 +357,42 @@ tcp_sackhole_remove(struct tcpcb *tp, struct sackhole *hole)
 
 	/* Remove this SACK hole. */
 	OFP_TAILQ_REMOVE(&tp->snd_holes, hole, scblink);
+	RB_REMOVE(sackhole_tree, &tp->snd_holes_tree, hole);
 
 	/* Free this SACK hole. */
 	tcp_sackhole_free(tp, hole);
 }
 
+/*
+ * RACK style lost retransmission detection (RFC 8985). Retransmitted
+ * data sent at xmit_ts was delivered, so retransmissions sent more
+ * than a reordering window (srtt / 4) before it are lost. Their holes
+ * are rewound to be retransmitted again instead of waiting for the
+ * retransmit timer. Retransmissions go out in sequence order, so only
+ * the holes at the front of the scoreboard are checked.
+ */
+static void
+tcp_sack_lost_rexmit(struct tcpcb *tp, uint32_t xmit_ts)
+{
+	struct sackhole *hole;
+	uint32_t reo_wnd;
+
+	reo_wnd = ((tp->t_srtt >> TCP_RTT_SHIFT) * (1000 / hz)) >> 2;
+	if (reo_wnd == 0)
+		reo_wnd = 1;
+
+	OFP_TAILQ_FOREACH(hole, &tp->snd_holes, scblink) {
+		if (hole->rxmit == hole->start ||
+		    !TSTMP_GT(xmit_ts, hole->rxmit_ts + reo_wnd))
+			break;
+		tp->sackhint.sack_bytes_rexmit -= (hole->rxmit - hole->start);
+		hole->rxmit = hole->start;
+		if (tp->sackhint.nexthole == NULL ||
+		    SEQ_LT(hole->start, tp->sackhint.nexthole->start))
+			tp->sackhint.nexthole = hole;
+	}
+}
+
 /*
  * Process cumulative ACK and the TCP SACK option to update the scoreboard.
  * tp->snd_holes is an ordered list of holes (oldest to newest, in terms of
@@ -337,9 +401,12 @@ tcp_sackhole_remove(struct tcpcb *tp, struct sackhole *hole)
 void
 ofp_tcp_sack_doack(struct tcpcb *tp, struct tcpopt *to, tcp_seq th_ack)
 {
-	struct sackhole *cur, *temp;
-	struct sackblk sack, sack_blocks[OFP_TCP_MAX_SACK + 1], *sblkp;
+	struct sackhole *cur, *next, *temp;
+	struct sackblk sack, sack_blocks[OFP_TCP_MAX_SACK + 1], *sblkp, *blk;
 	int i, j, num_sack_blks;
+	uint32_t rack_ts = 0;
+	int rack_ts_valid = 0;
+	tcp_seq end;
 
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
@@ -449,86 +516,80 @@ ofp_tcp_sack_doack(struct tcpcb *tp, struct tcpopt *to, tcp_seq th_ack)
 	/* We must have at least one SACK hole in scoreboard. */
 	KASSERT(!OFP_TAILQ_EMPTY(&tp->snd_holes),
 	    ("SACK scoreboard must not be empty"));
-	cur = OFP_TAILQ_LAST(&tp->snd_holes, sackhole_head); /* Last SACK hole. */
 	/*
-	 * Since the incoming sack blocks are sorted, we can process them
-	 * making one sweep of the scoreboard.
+	 * Apply the remaining sack blocks in ascending order. The first
+	 * hole a block overlaps is looked up in the tree, so the cost is
+	 * in the number of holes changed, not in the size of the
+	 * scoreboard.
 	 */
-	while (sblkp >= sack_blocks  && cur != NULL) {
-		if (SEQ_GEQ(sblkp->start, cur->end)) {
+	for (blk = sack_blocks; blk <= sblkp; blk++) {
+		cur = tcp_sackhole_find(tp, blk->start);
+		while (cur != NULL && SEQ_LT(cur->start, blk->end)) {
+			next = OFP_TAILQ_NEXT(cur, scblink);
 			/*
-			 * SACKs data beyond the current hole.  Go to the
-			 * previous sack block.
+			 * Retransmitted data of this hole was delivered,
+			 * remember when it was sent.
 			 */
-			sblkp--;
-			continue;
-		}
-		if (SEQ_LEQ(sblkp->end, cur->start)) {
-			/*
-			 * SACKs data before the current hole.  Go to the
-			 * previous hole.
-			 */
-			cur = OFP_TAILQ_PREV(cur, sackhole_head, scblink);
-			continue;
-		}
-		tp->sackhint.sack_bytes_rexmit -= (cur->rxmit - cur->start);
-		KASSERT(tp->sackhint.sack_bytes_rexmit >= 0,
-		    ("sackhint bytes rtx >= 0"));
-		if (SEQ_LEQ(sblkp->start, cur->start)) {
-			/* Data acks at least the beginning of hole. */
-			if (SEQ_GEQ(sblkp->end, cur->end)) {
-				/* Acks entire hole, so delete hole. */
-				temp = cur;
-				cur = OFP_TAILQ_PREV(cur, sackhole_head, scblink);
-				tcp_sackhole_remove(tp, temp);
-				/*
-				 * The sack block may ack all or part of the
-				 * next hole too, so continue onto the next
-				 * hole.
-				 */
-				continue;
-			} else {
+			if (SEQ_LT(SEQ_MAX(blk->start, cur->start),
+				   cur->rxmit) &&
+			    (!rack_ts_valid ||
+			     TSTMP_GT(cur->rxmit_ts, rack_ts))) {
+				rack_ts = cur->rxmit_ts;
+				rack_ts_valid = 1;
+			}
+			tp->sackhint.sack_bytes_rexmit -=
+				(cur->rxmit - cur->start);
+			KASSERT(tp->sackhint.sack_bytes_rexmit >= 0,
+			    ("sackhint bytes rtx >= 0"));
+			if (SEQ_LEQ(blk->start, cur->start)) {
+				/* Data acks at least the beginning of hole. */
+				if (SEQ_GEQ(blk->end, cur->end)) {
+					/* Acks entire hole, so delete hole. */
+					tcp_sackhole_remove(tp, cur);
+					cur = next;
+					continue;
+				}
 				/* Move start of hole forward. */
-				cur->start = sblkp->end;
+				cur->start = blk->end;
 				cur->rxmit = SEQ_MAX(cur->rxmit, cur->start);
-			}
-		} else {
-			/* Data acks at least the end of hole. */
-			if (SEQ_GEQ(sblkp->end, cur->end)) {
+			} else if (SEQ_GEQ(blk->end, cur->end)) {
 				/* Move end of hole backward. */
-				cur->end = sblkp->start;
+				cur->end = blk->start;
 				cur->rxmit = SEQ_MIN(cur->rxmit, cur->end);
 			} else {
 				/*
 				 * ACKs some data in middle of a hole; need
-				 * to split current hole
+				 * to split current hole. The end is trimmed
+				 * first to keep the tree keys unique.
 				 */
-				temp = tcp_sackhole_insert(tp, sblkp->end,
-				    cur->end, cur);
+				end = cur->end;
+				cur->end = blk->start;
+				temp = tcp_sackhole_insert(tp, blk->end, end,
+				    cur);
 				if (temp != NULL) {
 					if (SEQ_GT(cur->rxmit, temp->rxmit)) {
 						temp->rxmit = cur->rxmit;
+						temp->rxmit_ts = cur->rxmit_ts;
 						tp->sackhint.sack_bytes_rexmit
 						    += (temp->rxmit
 						    - temp->start);
 					}
-					cur->end = sblkp->start;
 					cur->rxmit = SEQ_MIN(cur->rxmit,
 					    cur->end);
-				}
+				} else
+					cur->end = end;
 			}
+			tp->sackhint.sack_bytes_rexmit +=
+				(cur->rxmit - cur->start);
+			/* Done with this block if the hole extends past it. */
+			if (SEQ_GEQ(cur->end, blk->end))
+				break;
+			cur = next;
 		}
-		tp->sackhint.sack_bytes_rexmit += (cur->rxmit - cur->start);
-		/*
-		 * Testing sblkp->start against cur->start tells us whether
-		 * we're done with the sack block or the sack hole.
-		 * Accordingly, we advance one or the other.
-		 */
-		if (SEQ_LEQ(sblkp->start, cur->start))
-			cur = OFP_TAILQ_PREV(cur, sackhole_head, scblink);
-		else
-			sblkp--;
 	}
+
+	if (rack_ts_valid && V_tcp_sack_rack)
+		tcp_sack_lost_rexmit(tp, rack_ts);
 }
 
 /*
@@ -647,10 +708,10 @@ out:
 void
 ofp_tcp_sack_adjust(struct tcpcb *tp)
 {
-	struct sackhole *p, *cur = OFP_TAILQ_FIRST(&tp->snd_holes);
+	struct sackhole *p;
 
 	INP_WLOCK_ASSERT(tp->t_inpcb);
-	if (cur == NULL)
+	if (OFP_TAILQ_EMPTY(&tp->snd_holes))
 		return; /* No holes */
 	if (SEQ_GEQ(tp->snd_nxt, tp->snd_fack))
 		return; /* We're already beyond any SACKed blocks */
@@ -659,17 +720,12 @@ ofp_tcp_sack_adjust(struct tcpcb *tp)
 	 * i) snd_nxt lies between end of one hole and beginning of another
 	 * ii) snd_nxt lies between end of last hole and snd_fack
 	 */
-	while ((p = OFP_TAILQ_NEXT(cur, scblink)) != NULL) {
-		if (SEQ_LT(tp->snd_nxt, cur->end))
-			return;
-		if (SEQ_GEQ(tp->snd_nxt, p->start))
-			cur = p;
-		else {
-			tp->snd_nxt = p->start;
-			return;
-		}
-	}
-	if (SEQ_LT(tp->snd_nxt, cur->end))
+	p = tcp_sackhole_find(tp, tp->snd_nxt);
+	if (p == NULL) {
+		tp->snd_nxt = tp->snd_fack;
 		return;
-	tp->snd_nxt = tp->snd_fack;
+	}
+	if (p != OFP_TAILQ_FIRST(&tp->snd_holes) &&
+	    SEQ_LT(tp->snd_nxt, p->start))
+		tp->snd_nxt = p->start;
 }
@@ -34,6 +34,7 @@
 
 #include <string.h>
 #include <stddef.h>
+#include <inttypes.h>
 
 #include "ofpi_pkt_processing.h"
 #include "ofpi_errno.h"
@@ -58,6 +59,7 @@
 #include "ofpi_in6_pcb.h"
 #endif
 
+#define TCPSTATES		/* for netstat */
 #include "ofpi_tcp_fsm.h"
 #include "ofpi_tcp_seq.h"
 #include "ofpi_tcp_timer.h"
@@ -67,6 +69,7 @@
 #include "ofpi_tcp6_var.h"
 #endif
 #include "ofpi_tcp_syncache.h"
+#include "ofpi_cc.h"
 #include "ofpi_md5.h"
 #include "ofpi_route.h"
 
@@ -176,23 +179,6 @@ static struct inpcb *tcp_mtudisc_notify(struct inpcb *, int);
 static char *	tcp_log_addr(struct in_conninfo *inc, struct ofp_tcphdr *th,
 		    void *ip4hdr, const void *ip6hdr);
 
-/*
- * Wrapper around transport structs that contain same-named congestion
- * control variables. Allows algos to be shared amongst multiple CC aware
- * transprots.
- */
-struct cc_var {
-	void		*cc_data; /* Per-connection private CC algorithm data. */
-	int		bytes_this_ack; /* # bytes acked by the current ACK. */
-	tcp_seq		curack; /* Most recent ACK. */
-	uint32_t	flags; /* Flags for cc_var (see below) */
-	int		type; /* Indicates which ptr is valid in ccvc. */
-	union ccv_container {
-		struct tcpcb		*tcp;
-		struct sctp_nets	*sctp;
-	} ccvc;
-};
-
 /*
  * Lock key:
  *   (c) container lock (e.g. jail's pr_mtx) and/or osd_object_lock
@@ -251,9 +237,10 @@ tcp_inpcb_init(void *mem, int size, int flags)
 }
 
 void
-ofp_tcp_tcbinfo_hashstats(unsigned int *min, unsigned int *avg, unsigned int *max)
+ofp_tcp_tcbinfo_hashstats(unsigned int *min, unsigned int *avg, unsigned int *max,
+			  unsigned int *hist, int nhist)
 {
-	ofp_in_pcbinfo_hashstats(&V_tcbinfo, min, avg, max);
+	ofp_in_pcbinfo_hashstats(&V_tcbinfo, min, avg, max, hist, nhist);
 }
 
 void
@@ -269,7 +256,7 @@ ofp_tcp_init(void)
 	    &V_tcp_hhh[HHOOK_TCP_EST_OUT], HHOOK_NOWAIT|HHOOK_HEADISINVNET) != 0)
 		OFP_WARN("unable to register helper hook");
 #endif
-	hashsize = TCBHASHSIZE;
+	hashsize = TCP_HASH_SIZE;
 #if 0 /* We trust size is power of 2. */
 	TUNABLE_INT_FETCH("net.inet.tcp.tcbhashsize", &hashsize);
 	if (!powerof2(hashsize)) {
@@ -278,12 +265,13 @@ ofp_tcp_init(void)
 	}
 #endif
 
-#ifdef OFP_RSS
-	ofp_tcp_rss_in_pcbinfo_init(hashsize, hashsize, tcp_inpcb_init, NULL, 0);
-#else
-	ofp_in_pcbinfo_init(&V_tcbinfo, "tcp", &V_tcb, hashsize, hashsize,
-	    "tcp_inpcb", tcp_inpcb_init, NULL, 0);
-#endif
+	if (OFP_SHARE_NOTHING)
+		ofp_tcp_rss_in_pcbinfo_init(hashsize, hashsize, tcp_inpcb_init,
+					    NULL, 0);
+	else
+		ofp_in_pcbinfo_init(&V_tcbinfo, "tcp", &V_tcb, hashsize,
+				    hashsize, "tcp_inpcb", tcp_inpcb_init,
+				    NULL, 0);
 
 	/*
 	 * These have to be type stable for the benefit of the timers.
@@ -295,6 +283,7 @@ ofp_tcp_init(void)
 
 	ofp_tcp_tw_init();
 	ofp_syncache_init();
+	ofp_tcp_fastopen_init();
 	/* tcp_hc_init(); */
 	ofp_tcp_reass_init();
 
@@ -339,41 +328,37 @@ ofp_tcp_init(void)
 	EVENTHANDLER_REGISTER(maxsockets_change, tcp_zone_change, NULL,
 		EVENTHANDLER_PRI_ANY);
 #endif
-#ifndef OFP_RSS
-	shm_tcp->ofp_tcp_slow_timer = ofp_timer_start(500000, ofp_tcp_slowtimo, NULL, 0);
-#else
-	int32_t cpu_id = 0;
-	for (; cpu_id < odp_cpu_count(); cpu_id++)
-		shm_tcp->ofp_tcp_slow_timer[cpu_id] = ofp_timer_start_cpu_id(
-				500000,	ofp_tcp_slowtimo, NULL, 0, cpu_id);
-#endif
+	if (!OFP_SHARE_NOTHING) {
+		shm_tcp->ofp_tcp_slow_timer[0] = ofp_timer_start(500000,
+						ofp_tcp_slowtimo, NULL, 0);
+	} else {
+		int32_t cpu_id = 0;
+		for (; cpu_id < TCP_NUM_CPU; cpu_id++)
+			shm_tcp->ofp_tcp_slow_timer[cpu_id] =
+				ofp_timer_start_cpu_id(500000, ofp_tcp_slowtimo,
+						       NULL, 0, cpu_id);
+	}
 }
 
 static void ofp_tcp_slow_timer_cancel(void)
 {
-#ifndef OFP_RSS
-	ofp_timer_cancel(shm_tcp->ofp_tcp_slow_timer);
-	shm_tcp->ofp_tcp_slow_timer = ODP_TIMER_INVALID;
-#else
 	int32_t cpu_id = 0;
-	for (; cpu_id < odp_cpu_count(); cpu_id++) {
+
+	for (; cpu_id < TCP_NUM_CPU; cpu_id++) {
 		ofp_timer_cancel(shm_tcp->ofp_tcp_slow_timer[cpu_id]);
 		shm_tcp->ofp_tcp_slow_timer[cpu_id] = ODP_TIMER_INVALID;
 	}
-#endif
 }
 
 
-void
-ofp_tcp_destroy(void)
+static void
+tcp_destroy_pcbinfo(struct inpcbinfo *pcbinfo)
 {
 	struct inpcb *inp, *inp_temp;
 	struct tcptw *tw;
 	struct tcpcb *tp;
 
-	ofp_tcp_slow_timer_cancel();
-
-	OFP_LIST_FOREACH_SAFE(inp, V_tcbinfo.ipi_listhead, inp_list, inp_temp) {
+	OFP_LIST_FOREACH_SAFE(inp, pcbinfo->ipi_listhead, inp_list, inp_temp) {
 
 		if (inp->inp_flags & INP_TIMEWAIT) {
 			tw = intotw(inp);
@@ -391,14 +376,26 @@ ofp_tcp_destroy(void)
 					inp->inp_socket);
 		}
 
-		uma_zfree(V_tcbinfo.ipi_zone, inp);
+		uma_zfree(pcbinfo->ipi_zone, inp);
 	}
+	uma_zdestroy(pcbinfo->ipi_zone);
+}
+
+void
+ofp_tcp_destroy(void)
+{
+	int cpu_id;
+
+	ofp_tcp_slow_timer_cancel();
+
+	for (cpu_id = 0; cpu_id < TCP_NUM_CPU; cpu_id++)
+		tcp_destroy_pcbinfo(&shm_tcp->ofp_tcbinfo[cpu_id]);
+
 	uma_zdestroy(V_sack_hole_zone);
 	uma_zdestroy(V_tcp_reass_zone);
 	uma_zdestroy(V_tcp_syncache_zone);
 	uma_zdestroy(V_tcptw_zone);
 	uma_zdestroy(V_tcpcb_zone);
-	uma_zdestroy(V_tcbinfo.ipi_zone);
 }
 
 void
@@ -406,22 +403,133 @@ ofp_tcp_netstat(int fd)
 {
 	struct inpcb *inp, *inp_temp;
 	struct inpcbhead *ipi_listhead;
+	int cpu_id;
 
-	ipi_listhead = shm_tcp->ofp_tcbinfo.ipi_listhead;
+	for (cpu_id = 0; cpu_id < TCP_NUM_CPU; cpu_id++) {
+		ipi_listhead = shm_tcp->ofp_tcbinfo[cpu_id].ipi_listhead;
 
-	OFP_LIST_FOREACH_SAFE(inp, ipi_listhead, inp_list, inp_temp) {
+		OFP_LIST_FOREACH_SAFE(inp, ipi_listhead, inp_list, inp_temp) {
 #ifdef INET6
-		if (inp->inp_inc.inc_flags & INC_ISIPV6)
-			ofp_sendf(fd, "tcp6\t%s:%d\r\n",
-				ofp_print_ip6_addr(inp->inp_inc.
-					inc6_laddr.__u6_addr.__u6_addr8),
-				odp_be_to_cpu_16(inp->inp_inc.inc_lport));
-		else
+			if (inp->inp_inc.inc_flags & INC_ISIPV6)
+				ofp_sendf(fd, "tcp6\t%s:%d\r\n",
+					ofp_print_ip6_addr(inp->inp_inc.
+						inc6_laddr.__u6_addr.__u6_addr8),
+					odp_be_to_cpu_16(inp->inp_inc.inc_lport));
+			else
+#endif
+				ofp_sendf(fd, "tcp\t%s:%d\r\n",
+					ofp_print_ip_addr(inp->inp_inc.
+						inc_laddr.s_addr),
+					odp_be_to_cpu_16(inp->inp_inc.inc_lport));
+		}
+	}
+}
+
+/*
+ * The num connections that retransmitted the largest share of the
+ * bytes they sent, at most TCP_NETSTAT_REXMIT_MAX.
+ */
+#define TCP_NETSTAT_REXMIT_MAX 64
+
+struct tcp_rexmit_row {
+	struct in_conninfo inc;
+	int state;
+	uint32_t permille;
+	uint32_t srtt_us;
+	uint64_t cwnd;
+	uint64_t sent;
+	uint64_t rexmit;
+};
+
+void
+ofp_tcp_netstat_rexmit(int fd, int num)
+{
+	struct tcp_rexmit_row top[TCP_NETSTAT_REXMIT_MAX], row;
+	struct inpcbinfo *pcbinfo;
+	struct inpcb *inp;
+	struct tcpcb *tp;
+	int cpu_id, i, n = 0;
+
+	if (num <= 0 || num > TCP_NETSTAT_REXMIT_MAX)
+		num = TCP_NETSTAT_REXMIT_MAX;
+
+	for (cpu_id = 0; cpu_id < TCP_NUM_CPU; cpu_id++) {
+		pcbinfo = &shm_tcp->ofp_tcbinfo[cpu_id];
+		INP_INFO_RLOCK(pcbinfo);
+		OFP_LIST_FOREACH(inp, pcbinfo->ipi_listhead, inp_list) {
+			if (inp->inp_flags & (INP_TIMEWAIT | INP_DROPPED))
+				continue;
+			tp = intotcpcb(inp);
+			if (tp == NULL || !tp->t_sndbyte)
+				continue;
+
+			row.inc = inp->inp_inc;
+			row.state = tp->t_state;
+			row.sent = tp->t_sndbyte;
+			row.rexmit = tp->t_sndrexmitbyte;
+			row.permille = row.rexmit * 1000 / row.sent;
+			row.srtt_us = ((uint64_t)tp->t_srtt *
+				       OFP_TIMER_RESOLUTION_US) >> TCP_RTT_SHIFT;
+			row.cwnd = tp->snd_cwnd;
+
+			for (i = n; i > 0 && (top[i - 1].permille < row.permille ||
+					      (top[i - 1].permille == row.permille &&
+					       top[i - 1].rexmit < row.rexmit)); i--)
+				if (i < num)
+					top[i] = top[i - 1];
+			if (i < num) {
+				top[i] = row;
+				if (n < num)
+					n++;
+			}
+		}
+		INP_INFO_RUNLOCK(pcbinfo);
+	}
+
+	ofp_sendf(fd, "%-22s %-22s %-11s %9s %10s %12s %12s %7s\r\n",
+		  "Local", "Foreign", "State", "srtt_us", "cwnd", "sent",
+		  "rexmit", "rexmit%");
+	for (i = 0; i < n; i++) {
+		char laddr[48], faddr[48];
+
+#ifdef INET6
+		if (top[i].inc.inc_flags & INC_ISIPV6) {
+			snprintf(laddr, sizeof(laddr), "[%s]:%d",
+				 ofp_print_ip6_addr(top[i].inc.inc6_laddr.
+						    __u6_addr.__u6_addr8),
+				 odp_be_to_cpu_16(top[i].inc.inc_lport));
+			snprintf(faddr, sizeof(faddr), "[%s]:%d",
+				 ofp_print_ip6_addr(top[i].inc.inc6_faddr.
+						    __u6_addr.__u6_addr8),
+				 odp_be_to_cpu_16(top[i].inc.inc_fport));
+		} else
 #endif
-			ofp_sendf(fd, "tcp\t%s:%d\r\n",
-				ofp_print_ip_addr(inp->inp_inc.
-					inc_laddr.s_addr),
-				odp_be_to_cpu_16(inp->inp_inc.inc_lport));
+		{
+			snprintf(laddr, sizeof(laddr), "%s:%d",
+				 ofp_print_ip_addr(top[i].inc.inc_laddr.s_addr),
+				 odp_be_to_cpu_16(top[i].inc.inc_lport));
+			snprintf(faddr, sizeof(faddr), "%s:%d",
+				 ofp_print_ip_addr(top[i].inc.inc_faddr.s_addr),
+				 odp_be_to_cpu_16(top[i].inc.inc_fport));
+		}
+		ofp_sendf(fd, "%-22s %-22s %-11s %9u %10" PRIu64 " %12" PRIu64
+			  " %12" PRIu64 " %5u.%u\r\n", laddr, faddr,
+			  tcpstates[top[i].state], top[i].srtt_us, top[i].cwnd,
+			  top[i].sent, top[i].rexmit, top[i].permille / 10,
+			  top[i].permille % 10);
+	}
+}
+
+void
+ofp_tcp_hashprint(int fd)
+{
+	char name[16];
+	int cpu_id;
+
+	for (cpu_id = 0; cpu_id < TCP_NUM_CPU; cpu_id++) {
+		sprintf(name, "tcp_%d", cpu_id);
+		ofp_in_pcbinfo_hashprint(fd, name,
+					 &shm_tcp->ofp_tcbinfo[cpu_id]);
 	}
 }
 
@@ -487,6 +595,52 @@ ofp_tcpip_fillheaders(struct inpcb *inp, void *ip_ptr, void *tcp_ptr)
 	th->th_sum = 0;		/* in_pseudo() is called later for ipv4 */
 }
 
+/*
+ * As ofp_tcpip_fillheaders(), from a template of the connection once
+ * its addresses and ports do not change any more.
+ */
+void
+ofp_tcpip_copyheaders(struct tcpcb *tp, void *ip_ptr, void *tcp_ptr)
+{
+	struct inpcb *inp = tp->t_inpcb;
+
+	INP_WLOCK_ASSERT(inp);
+
+	if (odp_unlikely(tp->t_hdrlen == 0)) {
+		if (!TCPS_HAVEESTABLISHED(tp->t_state)) {
+			ofp_tcpip_fillheaders(inp, ip_ptr, tcp_ptr);
+			return;
+		}
+		memset(&tp->t_hdr, 0, sizeof(tp->t_hdr));
+		ofp_tcpip_fillheaders(inp, tp->t_hdr.tt_ipgen, &tp->t_hdr.tt_t);
+#ifdef INET6
+		if ((inp->inp_vflag & INP_IPV6) != 0)
+			tp->t_hdrlen = sizeof(struct ofp_ip6_hdr);
+		else
+#endif
+			tp->t_hdrlen = sizeof(struct ofp_ip);
+	}
+
+	memcpy(ip_ptr, tp->t_hdr.tt_ipgen, tp->t_hdrlen);
+	memcpy(tcp_ptr, &tp->t_hdr.tt_t, sizeof(struct ofp_tcphdr));
+
+	/* These may be changed with socket options at any time */
+#ifdef INET6
+	if ((inp->inp_vflag & INP_IPV6) != 0) {
+		struct ofp_ip6_hdr *ip6 = ip_ptr;
+
+		ip6->ofp_ip6_flow = (ip6->ofp_ip6_flow & ~OFP_IPV6_FLOWINFO_MASK) |
+			(inp->inp_flow & OFP_IPV6_FLOWINFO_MASK);
+	} else
+#endif
+	{
+		struct ofp_ip *ip = ip_ptr;
+
+		ip->ip_tos = inp->inp_ip_tos;
+		ip->ip_ttl = inp->inp_ip_ttl;
+	}
+}
+
 /*
  * Create template to be used to send tcp packets on a connection.
  * Allocates an mbuf and fills in a skeletal tcp/ip header.  The only
@@ -532,6 +686,7 @@ ofp_tcp_respond(struct tcpcb *tp, void *ipgen, struct ofp_tcphdr *th, odp_packet
 #endif /* INET6 */
 	int ipflags = 0;
 	struct inpcb *inp;
+	struct ofp_ifnet *ifp = NULL;
 	(void)ipflags;
 
 	KASSERT(tp != NULL || m != ODP_PACKET_INVALID, ("ofp_tcp_respond: tp and m both NULL"));
@@ -584,8 +739,11 @@ ofp_tcp_respond(struct tcpcb *tp, void *ipgen, struct ofp_tcphdr *th, odp_packet
 			odp_packet_l4_offset_set(m, sizeof(struct ofp_ip));
 		}
 		flags = OFP_TH_ACK;
-	} else
+	} else {
+		/* Ingress interface, for the reply in place */
+		ifp = odp_packet_user_ptr(m);
 		odp_packet_user_ptr_set(m, NULL);
+	}
 
 	tlen = 0;
 
@@ -702,6 +860,9 @@ ofp_tcp_respond(struct tcpcb *tp, void *ipgen, struct ofp_tcphdr *th, odp_packet
 		(void) ofp_ip6_output(m, NULL);
 	else
 #endif
+	if (ifp)
+		(void) ofp_ip_output_reflect(m, ifp);
+	else
 		(void) ofp_ip_output(m, NULL);/* HJo, NULL, ipflags, NULL, inp*/
 }
 
@@ -730,14 +891,10 @@ ofp_tcp_newtcpcb(struct inpcb *inp)
 	tp->ccv->type = OFP_IPPROTO_TCP;
 	tp->ccv->ccvc.tcp = tp;
 
-#if 0 /* HJo FIX */
 	/*
 	 * Use the current system default CC algorithm.
 	 */
-	CC_LIST_RLOCK();
-	KASSERT(!OFP_STAILQ_EMPTY(&cc_list), ("cc_list is empty!"));
 	CC_ALGO(tp) = CC_DEFAULT();
-	CC_LIST_RUNLOCK();
 
 	if (CC_ALGO(tp)->cb_init != NULL)
 		if (CC_ALGO(tp)->cb_init(tp->ccv) > 0) {
@@ -745,13 +902,6 @@ ofp_tcp_newtcpcb(struct inpcb *inp)
 			return (NULL);
 		}
 
-	tp->osd = &tm->osd;
-	if (khelp_init_osd(HELPER_CLASS_TCP, tp->osd)) {
-		uma_zfree(V_tcpcb_zone, tm);
-		return (NULL);
-	}
-#endif
-
 	tp->t_timers = &tm->tt;
 	/*	OFP_LIST_INIT(&tp->t_segq); */	/* XXX covered by M_ZERO */
 	tp->t_maxseg = tp->t_maxopd =
@@ -766,12 +916,14 @@ ofp_tcp_newtcpcb(struct inpcb *inp)
 	callout_init(&tp->t_timers->tt_keep, CALLOUT_MPSAFE);
 	callout_init(&tp->t_timers->tt_2msl, CALLOUT_MPSAFE);
 	callout_init(&tp->t_timers->tt_delack, CALLOUT_MPSAFE);
+	callout_init(&tp->t_timers->tt_pace, CALLOUT_MPSAFE);
 
 	if (V_tcp_do_rfc1323)
 		tp->t_flags = (TF_REQ_SCALE|TF_REQ_TSTMP);
 	if (V_tcp_do_sack)
 		t_flags_or(tp->t_flags, TF_SACK_PERMIT);
 	OFP_TAILQ_INIT(&tp->snd_holes);
+	RB_INIT(&tp->snd_holes_tree);
 	tp->t_inpcb = inp;	/* XXX */
 	/*
 	 * Init srtt to TCPTV_SRTTBASE (0), so we can tell that we have no
@@ -874,7 +1026,7 @@ ofp_tcp_drop(struct tcpcb *tp, int err)
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 
 	if (TCPS_HAVERCVDSYN(tp->t_state)) {
-		tp->t_state = TCPS_CLOSED;
+		tcp_state_change(tp, TCPS_CLOSED);
 		(void) ofp_tcp_output(tp);
 		TCPSTAT_INC(tcps_drops);
 	} else
@@ -916,6 +1068,7 @@ ofp_tcp_discardcb(struct tcpcb *tp)
 	callout_stop(&tp->t_timers->tt_keep);
 	callout_stop(&tp->t_timers->tt_2msl);
 	callout_stop(&tp->t_timers->tt_delack);
+	callout_stop(&tp->t_timers->tt_pace);
 #ifdef PASSIVE_INET
 	callout_stop(&tp->t_timers->tt_reassdl);
 #endif
@@ -983,14 +1136,11 @@ ofp_tcp_discardcb(struct tcpcb *tp)
 #endif
 	ofp_tcp_free_sackholes(tp);
 
-#if 0 /* HJo */
 	/* Allow the CC algorithm to clean up after itself. */
 	if (CC_ALGO(tp)->cb_destroy != NULL)
 		CC_ALGO(tp)->cb_destroy(tp->ccv);
-	khelp_destroy_osd(tp->osd);
 
 	CC_ALGO(tp) = NULL;
-#endif
 	inp->inp_ppcb = NULL;
 	tp->t_inpcb = NULL;
 
@@ -1785,7 +1935,6 @@ ofp_tcp_mtudisc(struct inpcb *inp, int mtuoffer)
 u_long
 ofp_tcp_maxmtu(struct in_conninfo *inc, int *flags)
 {
-	(void)flags;
 	uint64_t maxmtu = 0;
 
 	KASSERT(inc != NULL, ("ofp_tcp_maxmtu with NULL in_conninfo pointer"));
@@ -1804,14 +1953,13 @@ ofp_tcp_maxmtu(struct in_conninfo *inc, int *flags)
 			if (ifp) maxmtu = ifp->if_mtu;
 		}
 	}
-#if 0
-	/* Report additional interface capabilities. */
-	if (ifp && (flags != NULL)) {
-		if (ifp->if_capenable & IFCAP_TSO4 &&
-		    ifp->if_hwassist & CSUM_TSO)
-			*flags |= CSUM_TSO;
-	}
-#endif
+	/*
+	 * IP output segments the bursts in hardware if the interface
+	 * can, in software otherwise.
+	 */
+	if (maxmtu && flags != NULL &&
+	    global_param->chksum_offload.tcp_tso_ena)
+		*flags |= CSUM_TSO;
 	return (maxmtu);
 }
 #endif /* INET */
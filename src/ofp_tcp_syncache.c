@@ -32,6 +32,7 @@
  * SUCH DAMAGE.
  */
 
+#include <string.h>
 #include <strings.h>
 #include <limits.h>
 
@@ -44,6 +45,7 @@
 #include "ofpi_sysctl.h"
 #include "ofpi_in_pcb.h"
 #include "ofpi_socketvar.h"
+#include "ofpi_sockstate.h"
 #ifdef INET6
 #include "ofpi_ip6.h"
 #include "ofpi_icmp6.h"
@@ -61,6 +63,7 @@
 #include "ofpi_tcp_var.h"
 #include "ofpi_tcp_shm.h"
 #include "ofpi_tcp_syncache.h"
+#include "ofpi_tcp_fastopen.h"
 #ifdef INET6
 #include "ofpi_tcp6_var.h"
 #endif
@@ -86,6 +89,13 @@ SYSCTL_VNET_INT(_net_inet_tcp, OFP_OID_AUTO, syncookies_only, OFP_CTLFLAG_RW,
     &VNET_NAME(tcp_syncookiesonly), 0,
     "Use only TCP SYN cookies");
 
+static VNET_DEFINE(int, tcp_syncookiesrate) = 100000;
+#define	V_tcp_syncookiesrate		VNET(tcp_syncookiesrate)
+SYSCTL_VNET_INT(_net_inet_tcp, OFP_OID_AUTO, syncookies_rate, OFP_CTLFLAG_RW,
+    &VNET_NAME(tcp_syncookiesrate), 0,
+    "SYNs per second and thread above which SYN cookies are sent "
+    "statelessly (0 = never)");
+
 #ifdef TCP_OFFLOAD_DISABLE
 #define TOEPCB_ISSET(sc) (0)
 #else
@@ -101,13 +111,20 @@ static struct	 socket *syncache_socket(struct syncache *, struct socket *,
 		    odp_packet_t m, struct tcpopt *to);
 static void	 syncache_timeout(struct syncache *sc, struct syncache_head *sch,
 		    int docallout, int timeout_ticks);
-/* static void	 syncache_timer(void *); */
+static void	 syncache_timer(struct syncache_head *);
+static void	 syncache_tfo_cookie(struct in_conninfo *, uint8_t *);
+static int	 syncache_tfo_valid(struct in_conninfo *, struct tcpopt *);
+static int	 syncache_tfo_expand(struct syncache *, struct ofp_tcphdr *,
+		    struct socket **, odp_packet_t, struct tcpopt *);
 static void	 syncookie_generate(struct syncache_head *, struct syncache *,
 		    uint32_t *);
 static struct syncache
 		*syncookie_lookup(struct in_conninfo *, struct syncache_head *,
 		    struct syncache *, struct tcpopt *, struct ofp_tcphdr *,
 		    struct socket *);
+static struct syncache
+		*syncookie_fast_lookup(struct in_conninfo *, struct syncache *,
+		    struct tcpopt *, struct ofp_tcphdr *, struct socket *);
 
 /*
  * Transmit the SYN,ACK fewer times than TCP_MAXRXTSHIFT specifies.
@@ -172,8 +189,22 @@ SYSCTL_VNET_INT(_net_inet_tcp_syncache, OFP_OID_AUTO, rst_on_sock_fail,
 
 #define ENDPTS6_EQ(a, b) (memcmp(a, b, sizeof(*a)) == 0)
 
-#define	SCH_LOCK(sch)		odp_spinlock_lock(&(sch)->sch_mtx)
-#define	SCH_UNLOCK(sch)		odp_spinlock_unlock(&(sch)->sch_mtx)
+/*
+ * In share-nothing mode the SYN and the ACK of a flow arrive on the same
+ * core, and each core has a syncache hash of its own. Its rows are not
+ * locked and are expired by the TCP slow timer of the core.
+ */
+#define	SCH_BASE	(&V_tcp_syncache.hashbase[TCP_CPU *		\
+						  V_tcp_syncache.hashsize])
+
+#define	SCH_LOCK(sch) do {						\
+		if (!OFP_SHARE_NOTHING)					\
+			odp_spinlock_lock(&(sch)->sch_mtx);		\
+	} while (0)
+#define	SCH_UNLOCK(sch) do {						\
+		if (!OFP_SHARE_NOTHING)					\
+			odp_spinlock_unlock(&(sch)->sch_mtx);		\
+	} while (0)
 #define	SCH_LOCK_ASSERT(sch)	//mtx_assert(&(sch)->sch_mtx, MA_OWNED)
 
 /*
@@ -192,27 +223,48 @@ syncache_free(struct syncache *sc)
 	uma_zfree(V_tcp_syncache_zone, sc);
 }
 
+/*
+ * Number of hash buckets of a core for global_param->tcp_syncache_max
+ * entries, a power of two. There are TCP_NUM_CPU such hashes.
+ */
+uint32_t
+ofp_syncache_hashsize(void)
+{
+	uint32_t max = (uint32_t)global_param->tcp_syncache_max / TCP_NUM_CPU;
+	uint32_t n = (max + TCP_SYNCACHE_BUCKETLIMIT - 1) /
+		TCP_SYNCACHE_BUCKETLIMIT;
+	uint32_t size = 1;
+
+	while (size < n)
+		size <<= 1;
+	return size;
+}
+
 void
 ofp_syncache_init(void)
 {
-	int i;
+	int i, num;
 
 	V_tcp_syncache.cache_count = 0;
-	V_tcp_syncache.hashsize = TCP_SYNCACHE_HASHSIZE;
+	V_tcp_syncache.hashsize = ofp_syncache_hashsize();
 	V_tcp_syncache.bucket_limit = TCP_SYNCACHE_BUCKETLIMIT;
 	V_tcp_syncache.rexmt_limit = SYNCACHE_MAXREXMTS;
 	V_tcp_syncache.hash_secret = 11235 /*arc4random()*/;
 	V_tcp_syncache.hashmask = V_tcp_syncache.hashsize - 1;
+	odp_random_data((uint8_t *)V_tcp_syncache.cookie_key,
+			sizeof(V_tcp_syncache.cookie_key), 0);
+	odp_random_data((uint8_t *)V_tcp_syncache.tfo_key,
+			sizeof(V_tcp_syncache.tfo_key), 0);
 
 	/* Set limits. */
-	V_tcp_syncache.cache_limit =
-	    V_tcp_syncache.hashsize * V_tcp_syncache.bucket_limit;
+	V_tcp_syncache.cache_limit = global_param->tcp_syncache_max;
 
 	/* Allocate the hash table. */
-	V_tcp_syncache.hashbase = shm_tcp->syncache;
+	V_tcp_syncache.hashbase = TCP_SYNCACHE_HASHBASE;
 
-	/* Initialize the hash buckets. */
-	for (i = 0; i < (int)V_tcp_syncache.hashsize; i++) {
+	/* Initialize the hash buckets of all cores. */
+	num = V_tcp_syncache.hashsize * TCP_NUM_CPU;
+	for (i = 0; i < num; i++) {
 		OFP_TAILQ_INIT(&V_tcp_syncache.hashbase[i].sch_bucket);
 		odp_spinlock_init(&V_tcp_syncache.hashbase[i].sch_mtx);
 		/*
@@ -314,21 +366,18 @@ syncache_timeout(struct syncache *sc, struct syncache_head *sch, int docallout,
 	}
 }
 
-#if 0
 /*
  * Walk the timer queues, looking for SYN,ACKs that need to be retransmitted.
  * If we have retransmitted an entry the maximum number of times, expire it.
- * One separate timer for each bucket row.
+ * Called for each bucket row that is due from ofp_syncache_timer().
  */
 static void
-syncache_timer(void *xsch)
+syncache_timer(struct syncache_head *sch)
 {
-	struct syncache_head *sch = (struct syncache_head *)xsch;
 	struct syncache *sc, *nsc;
 	int tick = ticks;
-	//char *s;
 
-	/* NB: syncache_head has already been locked by the callout. */
+	/* NB: syncache_head has already been locked by the caller. */
 	SCH_LOCK_ASSERT(sch);
 
 	/*
@@ -365,11 +414,29 @@ syncache_timer(void *xsch)
 		TCPSTAT_INC(tcps_sc_retransmitted);
 		syncache_timeout(sc, sch, 0, -1);
 	}
-	if (!OFP_TAILQ_EMPTY(&(sch)->sch_bucket))
-		callout_reset(&(sch)->sch_timer, (sch)->sch_nextc - tick,
-			syncache_timer, (void *)(sch));
 }
-#endif
+
+/*
+ * Expire the bucket rows of this core, or of the only hash outside
+ * share-nothing mode. Called from the TCP slow timer.
+ */
+void
+ofp_syncache_timer(void)
+{
+	struct syncache_head *sch = SCH_BASE;
+	uint32_t i;
+	int tick = ticks;
+
+	for (i = 0; i < V_tcp_syncache.hashsize; i++, sch++) {
+		/* Unlocked peek, the row is checked again under its lock */
+		if (!sch->sch_length || TSTMP_GT(sch->sch_nextc, tick))
+			continue;
+		SCH_LOCK(sch);
+		if (sch->sch_length)
+			syncache_timer(sch);
+		SCH_UNLOCK(sch);
+	}
+}
 
 /*
  * Find an entry in the syncache.
@@ -385,7 +452,7 @@ ofp_syncache_lookup(struct in_conninfo *inc, struct syncache_head **schp)
 #ifdef INET6
 	if (inc->inc_flags & INC_ISIPV6) {
 		hashkey = SYNCACHE_HASH6(inc, V_tcp_syncache.hashmask);
-		sch = &V_tcp_syncache.hashbase[hashkey];
+		sch = &SCH_BASE[hashkey];
 		*schp = sch;
 
 		SCH_LOCK(sch);
@@ -399,7 +466,7 @@ ofp_syncache_lookup(struct in_conninfo *inc, struct syncache_head **schp)
 #endif
 	{
 		hashkey = SYNCACHE_HASH(inc, V_tcp_syncache.hashmask);
-		sch = &V_tcp_syncache.hashbase[hashkey];
+		sch = &SCH_BASE[hashkey];
 		*schp = sch;
 
 		SCH_LOCK(sch);
@@ -581,7 +648,7 @@ syncache_socket(struct syncache *sc, struct socket *lso, odp_packet_t m, struct
 	inp = sotoinpcb(so);
 	inp->inp_inc.inc_fibnum = so->so_fibnum;
 	INP_WLOCK(inp);
-	INP_HASH_WLOCK(&V_tcbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 
 	/* Insert new socket into PCB hash list. */
 	inp->inp_inc.inc_flags = sc->sc_inc.inc_flags;
@@ -617,7 +684,7 @@ syncache_socket(struct syncache *sc, struct socket *lso, odp_packet_t m, struct
 		inp->inp_lport = 0;
 		OFP_DBG("ofp_in_pcbinshash failed "
 			  "with error %i", error);
-		INP_HASH_WUNLOCK(&V_tcbinfo);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 		goto abort;
 	}
 #ifdef INET6
@@ -653,7 +720,7 @@ syncache_socket(struct syncache *sc, struct socket *lso, odp_packet_t m, struct
 		    NULL, m)) != 0) {
 			inp->in6p_laddr = laddr6;
 			OFP_DBG("in6_pcbconnect failed with error %d", error);
-			INP_HASH_WUNLOCK(&V_tcbinfo);
+			INP_HASH_WUNLOCK(inp->inp_hashinfo);
 			goto abort;
 		}
 		/* Override flowlabel from in6_pcbconnect. */
@@ -689,14 +756,14 @@ syncache_socket(struct syncache *sc, struct socket *lso, odp_packet_t m, struct
 			inp->inp_laddr = laddr;
 			OFP_DBG("ofp_in_pcbconnect failed "
 				  "with error %i", error);
-			INP_HASH_WUNLOCK(&V_tcbinfo);
+			INP_HASH_WUNLOCK(inp->inp_hashinfo);
 			goto abort;
 		}
 	}
 
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	tp = intotcpcb(inp);
-	tp->t_state = TCPS_SYN_RECEIVED;
+	tcp_state_change(tp, TCPS_SYN_RECEIVED);
 	tp->iss = sc->sc_iss;
 	tp->irs = sc->sc_irs;
 	tcp_rcvseqinit(tp);
@@ -808,7 +875,9 @@ ofp_syncache_expand(struct in_conninfo *inc, struct tcpopt *to, struct ofp_tcphd
 			goto failed;
 		}
 		bzero(&scs, sizeof(scs));
-		sc = syncookie_lookup(inc, sch, &scs, to, th, *lsop);
+		sc = syncookie_fast_lookup(inc, &scs, to, th, *lsop);
+		if (sc == NULL)
+			sc = syncookie_lookup(inc, sch, &scs, to, th, *lsop);
 		SCH_UNLOCK(sch);
 		if (sc == NULL) {
 			OFP_DBG("Segment failed "
@@ -881,6 +950,126 @@ failed:
 	return (0);
 }
 
+/*
+ * Set up a syncache entry from a SYN and the listen socket values.
+ */
+static void
+syncache_fill(struct syncache *sc, struct in_conninfo *inc, struct tcpopt *to,
+	      struct ofp_tcphdr *th, int win, int ip_ttl, int ip_tos,
+	      uint32_t ltflags)
+{
+	bcopy(inc, &sc->sc_inc, sizeof(struct in_conninfo));
+#ifdef INET6
+	if (!(inc->inc_flags & INC_ISIPV6))
+#endif
+	{
+		sc->sc_ip_tos = ip_tos;
+		sc->sc_ip_ttl = ip_ttl;
+	}
+	sc->sc_irs = th->th_seq;
+	sc->sc_iss = 31415 /* HJo: arc4random()*/;
+	sc->sc_flags = 0;
+	sc->sc_flowlabel = 0;
+
+	/*
+	 * Initial receive window: clip sbspace of the listen socket
+	 * to [0 .. OFP_TCP_MAXWIN].
+	 */
+	win = imax(win, 0);
+	win = imin(win, OFP_TCP_MAXWIN);
+	sc->sc_wnd = win;
+
+	if (V_tcp_do_rfc1323) {
+		/*
+		 * A timestamp received in a SYN makes
+		 * it ok to send timestamp requests and replies.
+		 */
+		if (to->to_flags & TOF_TS) {
+			sc->sc_tsreflect = to->to_tsval;
+			sc->sc_ts = tcp_ts_getticks();
+			sc->sc_flags |= SCF_TIMESTAMP;
+		}
+		if (to->to_flags & TOF_SCALE) {
+			int wscale = 0;
+
+			/*
+			 * Pick the smallest possible scaling factor that
+			 * will still allow us to scale up to ofp_sb_max, aka
+			 * kern.ipc.maxsockbuf.
+			 *
+			 * We do this because there are broken firewalls that
+			 * will corrupt the window scale option, leading to
+			 * the other endpoint believing that our advertised
+			 * window is unscaled.  At scale factors larger than
+			 * 5 the unscaled window will drop below 1500 bytes,
+			 * leading to serious problems when traversing these
+			 * broken firewalls.
+			 *
+			 * With the default maxsockbuf of 256K, a scale factor
+			 * of 3 will be chosen by this algorithm.  Those who
+			 * choose a larger maxsockbuf should watch out
+			 * for the compatiblity problems mentioned above.
+			 *
+			 * RFC1323: The Window field in a SYN (i.e., a <SYN>
+			 * or <SYN,ACK>) segment itself is never scaled.
+			 */
+			while (wscale < OFP_TCP_MAX_WINSHIFT &&
+			       (OFP_TCP_MAXWIN << wscale) < (int)ofp_sb_max)
+				wscale++;
+			sc->sc_requested_r_scale = wscale;
+			sc->sc_requested_s_scale = to->to_wscale;
+			sc->sc_flags |= SCF_WINSCALE;
+		}
+	}
+	if (to->to_flags & TOF_SACKPERM)
+		sc->sc_flags |= SCF_SACK;
+	if (to->to_flags & TOF_MSS)
+		sc->sc_peer_mss = to->to_mss;	/* peer mss may be zero */
+	if (ltflags & TF_NOOPT)
+		sc->sc_flags |= SCF_NOOPT;
+	if ((th->th_flags & (OFP_TH_ECE|OFP_TH_CWR)) && V_tcp_do_ecn)
+		sc->sc_flags |= SCF_ECN;
+}
+
+/*
+ * Create the connection of a TCP Fast Open SYN. The socket is put on
+ * the accept queue at once; the SYN|ACK is sent by tcp_output() when
+ * the caller has processed the SYN and its data.
+ */
+static int
+syncache_tfo_expand(struct syncache *sc, struct ofp_tcphdr *th,
+		    struct socket **lsop, odp_packet_t m, struct tcpopt *to)
+{
+	struct socket *so;
+	struct inpcb *inp;
+	struct tcpcb *tp;
+
+	odp_random_data((uint8_t *)&sc->sc_iss, sizeof(sc->sc_iss), 0);
+
+	so = syncache_socket(sc, *lsop, m, to);
+	if (so == NULL) {
+		TCPSTAT_INC(tcps_sc_aborted);
+		return -1;
+	}
+
+	inp = sotoinpcb(so);
+	INP_WLOCK(inp);
+	tp = intotcpcb(inp);
+	tp->t_flags |= TF_FASTOPEN | TF_ACKNOW;
+	tp->snd_max = tp->iss;
+	tp->snd_nxt = tp->iss;
+	/* The window of a SYN is never scaled. */
+	tp->snd_wnd = th->th_win;
+	tp->max_sndwnd = tp->snd_wnd;
+	INP_WUNLOCK(inp);
+
+	TCPSTAT_INC(tcps_sc_completed);
+	ofp_soisconnected(so);
+	*lsop = so;
+
+	return 0;
+}
+
 /*
  * Given a LISTEN socket and an inbound SYN request, add
  * this to the syn cache, and send back a segment:
@@ -893,8 +1082,15 @@ failed:
  * DoS attack, an attacker could send data which would eventually
  * consume all available buffer space if it were ACKed.  By not ACKing
  * the data, we avoid this DoS scenario.
+ *
+ * The exception is a SYN with a valid TCP Fast Open cookie, which
+ * proves that the source address is not spoofed. The connection is
+ * created in SYN_RECEIVED state right away and 1 is returned with
+ * *lsop set to the new socket. The listen socket stays locked and the
+ * caller passes the segment and its data to the new connection.
+ * Otherwise 0 is returned and everything is unlocked.
  */
-static void
+static int
 _syncache_add(struct in_conninfo *inc, struct tcpopt *to, struct ofp_tcphdr *th,
     struct inpcb *inp, struct socket **lsop, odp_packet_t m,
     struct toe_usrreqs *tu, void *toepcb, int initial_timeout)
@@ -907,6 +1103,7 @@ _syncache_add(struct in_conninfo *inc, struct tcpopt *to, struct ofp_tcphdr *th,
 	uint32_t flowtmp = 0;
 	uint32_t ltflags;
 	int win, ip_ttl, ip_tos;
+	int tfo = 0;
 #ifdef INET6
 	int autoflowlabel = 0;
 #endif
@@ -936,6 +1133,24 @@ _syncache_add(struct in_conninfo *inc, struct tcpopt *to, struct ofp_tcphdr *th,
 	win = sbspace(&so->so_rcv);
 	ltflags = (tp->t_flags & (TF_NOOPT | TF_SIGNATURE));
 
+	/*
+	 * TCP Fast Open. A cookie that fails (or a full listen queue)
+	 * falls back to the 3-way handshake, whose SYN|ACK hands out a
+	 * current cookie.
+	 */
+	if ((tp->t_flags & TF_FASTOPEN) && (to->to_flags & TOF_FASTOPEN) &&
+	    !(ltflags & TF_NOOPT)) {
+		if (syncache_tfo_valid(inc, to)) {
+			bzero(&scs, sizeof(scs));
+			scs.sc_ipopts = ODP_PACKET_INVALID;
+			syncache_fill(&scs, inc, to, th, win, ip_ttl, ip_tos,
+				      ltflags);
+			if (syncache_tfo_expand(&scs, th, lsop, m, to) == 0)
+				return 1;
+		}
+		tfo = 1;
+	}
+
 	/* By the time we drop the lock these should no longer be used. */
 	so = NULL;
 	tp = NULL;
@@ -1030,81 +1245,13 @@ _syncache_add(struct in_conninfo *inc, struct tcpopt *to, struct ofp_tcphdr *th,
 	 * Fill in the syncache values.
 	 */
 	sc->sc_ipopts = ipopts;
-	bcopy(inc, &sc->sc_inc, sizeof(struct in_conninfo));
-#ifdef INET6
-	if (!(inc->inc_flags & INC_ISIPV6))
-#endif
-	{
-		sc->sc_ip_tos = ip_tos;
-		sc->sc_ip_ttl = ip_ttl;
-	}
 #ifndef TCP_OFFLOAD_DISABLE
 	sc->sc_tu = tu;
 	sc->sc_toepcb = toepcb;
 #endif
-	sc->sc_irs = th->th_seq;
-	sc->sc_iss = 31415 /* HJo: arc4random()*/;
-	sc->sc_flags = 0;
-	sc->sc_flowlabel = 0;
-
-	/*
-	 * Initial receive window: clip sbspace to [0 .. OFP_TCP_MAXWIN].
-	 * win was derived from socket earlier in the function.
-	 */
-	win = imax(win, 0);
-	win = imin(win, OFP_TCP_MAXWIN);
-	sc->sc_wnd = win;
-
-	if (V_tcp_do_rfc1323) {
-		/*
-		 * A timestamp received in a SYN makes
-		 * it ok to send timestamp requests and replies.
-		 */
-		if (to->to_flags & TOF_TS) {
-			sc->sc_tsreflect = to->to_tsval;
-			sc->sc_ts = tcp_ts_getticks();
-			sc->sc_flags |= SCF_TIMESTAMP;
-		}
-		if (to->to_flags & TOF_SCALE) {
-			int wscale = 0;
-
-			/*
-			 * Pick the smallest possible scaling factor that
-			 * will still allow us to scale up to ofp_sb_max, aka
-			 * kern.ipc.maxsockbuf.
-			 *
-			 * We do this because there are broken firewalls that
-			 * will corrupt the window scale option, leading to
-			 * the other endpoint believing that our advertised
-			 * window is unscaled.  At scale factors larger than
-			 * 5 the unscaled window will drop below 1500 bytes,
-			 * leading to serious problems when traversing these
-			 * broken firewalls.
-			 *
-			 * With the default maxsockbuf of 256K, a scale factor
-			 * of 3 will be chosen by this algorithm.  Those who
-			 * choose a larger maxsockbuf should watch out
-			 * for the compatiblity problems mentioned above.
-			 *
-			 * RFC1323: The Window field in a SYN (i.e., a <SYN>
-			 * or <SYN,ACK>) segment itself is never scaled.
-			 */
-			while (wscale < OFP_TCP_MAX_WINSHIFT &&
-			       (OFP_TCP_MAXWIN << wscale) < (int)ofp_sb_max)
-				wscale++;
-			sc->sc_requested_r_scale = wscale;
-			sc->sc_requested_s_scale = to->to_wscale;
-			sc->sc_flags |= SCF_WINSCALE;
-		}
-	}
-	if (to->to_flags & TOF_SACKPERM)
-		sc->sc_flags |= SCF_SACK;
-	if (to->to_flags & TOF_MSS)
-		sc->sc_peer_mss = to->to_mss;	/* peer mss may be zero */
-	if (ltflags & TF_NOOPT)
-		sc->sc_flags |= SCF_NOOPT;
-	if ((th->th_flags & (OFP_TH_ECE|OFP_TH_CWR)) && V_tcp_do_ecn)
-		sc->sc_flags |= SCF_ECN;
+	syncache_fill(sc, inc, to, th, win, ip_ttl, ip_tos, ltflags);
+	if (tfo)
+		sc->sc_flags |= SCF_TFO;
 
 	if (V_tcp_syncookies) {
 		syncookie_generate(sch, sc, &flowtmp);
@@ -1144,6 +1291,7 @@ done:
 		*lsop = NULL;
 		odp_packet_free(m);
 	}
+	return 0;
 }
 
 static int
@@ -1156,6 +1304,7 @@ syncache_respond(struct syncache *sc)
 	enum ofp_return_code rc;
 	uint16_t hlen, tlen, mssopt;
 	struct tcpopt to;
+	uint8_t tfo_cookie[TCP_FASTOPEN_COOKIE_LEN];
 #ifdef INET6
 	struct ofp_ip6_hdr *ip6 = NULL;
 #endif
@@ -1258,6 +1407,12 @@ syncache_respond(struct syncache *sc)
 		}
 		if (sc->sc_flags & SCF_SACK)
 			to.to_flags |= TOF_SACKPERM;
+		if (sc->sc_flags & SCF_TFO) {
+			syncache_tfo_cookie(&sc->sc_inc, tfo_cookie);
+			to.to_tfo_cookie = tfo_cookie;
+			to.to_tfo_len = TCP_FASTOPEN_COOKIE_LEN;
+			to.to_flags |= TOF_FASTOPEN;
+		}
 		optlen = ofp_tcp_addoptions(&to, (uint8_t *)(th + 1));
 		/* This is done in wrong order. */
 		odp_packet_push_tail(m, optlen);
@@ -1307,11 +1462,12 @@ syncache_respond(struct syncache *sc)
 	return (error);
 }
 
-void
+int
 ofp_syncache_add(struct in_conninfo *inc, struct tcpopt *to, struct ofp_tcphdr *th,
      struct inpcb *inp, struct socket **lsop, odp_packet_t m, int initial_timeout)
 {
-	_syncache_add(inc, to, th, inp, lsop, m, NULL, NULL, initial_timeout);
+	return _syncache_add(inc, to, th, inp, lsop, m, NULL, NULL,
+			     initial_timeout);
 }
 
 
@@ -1579,6 +1735,332 @@ syncookie_lookup(struct in_conninfo *inc, struct syncache_head *sch,
 	return (sc);
 }
 
+/*
+ * Stateless SYN cookies.
+ *
+ * A thread receiving more than net.inet.tcp.syncookies_rate SYNs per
+ * second answers them with SYN-ACKs rewritten from the received SYNs in
+ * place. No syncache entry, syncache bucket lock or tcbinfo lock is
+ * taken; the only state is a key set at init.
+ *
+ * Initial sequence number we send:
+ * 31|................................|0
+ *    HHHHHHHHHHHHHHHHHHHHHHHHHHHHHMMM
+ *    H = SipHash-2-4 of the key, the addresses and ports, the received
+ *        initial sequence number, the MSS index and a counter advancing
+ *        every 64 seconds. A cookie is valid for two counter values.
+ *    M = MSS index
+ *
+ * Timestamp we send, if the SYN had one:
+ * 31|................................|0
+ *    TTTTTTTTTTTTTTTTTTTTTTTTTTASWWWW
+ *    T = our timestamp clock
+ *    A = SACK allowed
+ *    S = window scale requested, W = its value
+ */
+#define SYNCOOKIE_FAST_SHIFT	6	/* counter period, log2 seconds */
+#define SYNCOOKIE_RATE_WINDOW	(hz / 10)
+
+#define SIPROUND(v0, v1, v2, v3) do {					\
+		v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0;		\
+		v0 = ROTL64(v0, 32);					\
+		v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;		\
+		v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;		\
+		v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2;		\
+		v2 = ROTL64(v2, 32);					\
+	} while (0)
+#define ROTL64(x, b)	(((x) << (b)) | ((x) >> (64 - (b))))
+
+/* SipHash-2-4 of n 64-bit words */
+static uint64_t
+syncache_siphash(const uint64_t *key, const uint64_t *m, int n)
+{
+	uint64_t b;
+	uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+	uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL;
+	uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+	uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		v3 ^= m[i];
+		SIPROUND(v0, v1, v2, v3);
+		SIPROUND(v0, v1, v2, v3);
+		v0 ^= m[i];
+	}
+	b = (uint64_t)(n * sizeof(*m)) << 56;
+	v3 ^= b;
+	SIPROUND(v0, v1, v2, v3);
+	SIPROUND(v0, v1, v2, v3);
+	v0 ^= b;
+	v2 ^= 0xff;
+	for (i = 0; i < 4; i++)
+		SIPROUND(v0, v1, v2, v3);
+
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+static uint32_t
+syncookie_fast_hash(struct in_conninfo *inc, tcp_seq irs, uint32_t count,
+		    uint32_t mss)
+{
+	uint64_t m[3];
+
+	m[0] = (uint64_t)inc->inc_laddr.s_addr << 32 | inc->inc_faddr.s_addr;
+	m[1] = (uint64_t)inc->inc_lport << 48 |
+		(uint64_t)inc->inc_fport << 32 | irs;
+	m[2] = (uint64_t)count << 32 | mss;
+
+	return (uint32_t)syncache_siphash(V_tcp_syncache.cookie_key, m, 3);
+}
+
+/*
+ * TCP Fast Open cookie (RFC 7413) of the client address of inc: a
+ * keyed hash the client echoes in the SYNs that carry data.
+ */
+static void
+syncache_tfo_cookie(struct in_conninfo *inc, uint8_t *cookie)
+{
+	uint64_t m[2] = { 0, 0 };
+	uint64_t h;
+
+#ifdef INET6
+	if (inc->inc_flags & INC_ISIPV6)
+		memcpy(m, &inc->inc6_faddr, sizeof(m));
+	else
+#endif
+		m[0] = inc->inc_faddr.s_addr;
+
+	h = syncache_siphash(V_tcp_syncache.tfo_key, m, 2);
+	memcpy(cookie, &h, TCP_FASTOPEN_COOKIE_LEN);
+}
+
+static int
+syncache_tfo_valid(struct in_conninfo *inc, struct tcpopt *to)
+{
+	uint8_t cookie[TCP_FASTOPEN_COOKIE_LEN];
+
+	if (to->to_tfo_len != TCP_FASTOPEN_COOKIE_LEN)
+		return 0;
+	syncache_tfo_cookie(inc, cookie);
+
+	return !memcmp(cookie, to->to_tfo_cookie, TCP_FASTOPEN_COOKIE_LEN);
+}
+
+/*
+ * Count a SYN of this thread. Returns 1 if SYN cookies are to be sent
+ * statelessly: the rate was exceeded in this or the previous window.
+ */
+int
+ofp_syncache_flood(void)
+{
+	static __thread int win_start;
+	static __thread uint32_t win_syns;
+	static __thread int flooding;
+	uint32_t limit;
+	int now;
+
+	if (!V_tcp_syncookies || V_tcp_syncookiesrate <= 0)
+		return 0;
+
+	limit = V_tcp_syncookiesrate / 10;
+	now = ticks;
+	if (now - win_start >= (int)SYNCOOKIE_RATE_WINDOW) {
+		flooding = win_syns > limit &&
+			now - win_start < 2 * (int)SYNCOOKIE_RATE_WINDOW;
+		win_start = now;
+		win_syns = 0;
+	}
+	win_syns++;
+
+	return flooding || win_syns > limit;
+}
+
+/*
+ * Turn a SYN to a listening IPv4 socket into a SYN-ACK carrying a
+ * stateless cookie and send it. The listen inpcb is locked. Returns 0 if
+ * the packet was consumed, -1 if the SYN needs the syncache.
+ */
+int
+ofp_syncookie_respond(struct ofp_ip *ip, struct ofp_tcphdr *th,
+		      struct tcpopt *to, struct inpcb *inp, odp_packet_t m)
+{
+	struct in_conninfo inc;
+	struct ofp_tcphdr *nth;
+	struct tcpopt nto;
+	uint8_t opt[OFP_TCP_MAXOLEN];
+	tcp_seq iss, ack;
+	uint32_t pmss, mss, len;
+	int win, wscale, optlen;
+
+	INP_WLOCK_ASSERT(inp);
+
+	if (ip->ip_hl != sizeof(struct ofp_ip) >> 2 ||
+	    (th->th_flags & OFP_TH_FIN) ||
+	    (intotcpcb(inp)->t_flags & (TF_NOOPT | TF_SIGNATURE)) ||
+	    odp_packet_is_bcast(m) || odp_packet_is_mcast(m) ||
+	    OFP_IN_MULTICAST(odp_be_to_cpu_32(ip->ip_dst.s_addr)) ||
+	    OFP_IN_MULTICAST(odp_be_to_cpu_32(ip->ip_src.s_addr)) ||
+	    ip->ip_src.s_addr == ip->ip_dst.s_addr ||
+	    ip->ip_src.s_addr == odp_cpu_to_be_32(OFP_INADDR_BROADCAST) ||
+	    ip->ip_dst.s_addr == odp_cpu_to_be_32(OFP_INADDR_BROADCAST) ||
+	    ip->ip_dst.s_addr == OFP_INADDR_ANY)
+		return -1;
+
+	bzero(&inc, sizeof(inc));
+	inc.inc_faddr = ip->ip_src;
+	inc.inc_laddr = ip->ip_dst;
+	inc.inc_fport = th->th_sport;
+	inc.inc_lport = th->th_dport;
+	inc.inc_fibnum = inp->inp_socket->so_fibnum;
+
+	pmss = ofp_tcp_mssopt(&inc);
+	if (to->to_flags & TOF_MSS)
+		pmss = max(min(to->to_mss, pmss), V_tcp_minmss);
+	for (mss = sizeof(tcp_sc_msstab) / sizeof(int) - 1; mss > 0; mss--)
+		if (tcp_sc_msstab[mss] <= (int)pmss)
+			break;
+
+	iss = (syncookie_fast_hash(&inc, th->th_seq,
+				   time_uptime >> SYNCOOKIE_FAST_SHIFT, mss) &
+	       ~0x7) | mss;
+	ack = th->th_seq + 1;
+
+	win = sbspace(&inp->inp_socket->so_rcv);
+	win = imin(imax(win, 0), OFP_TCP_MAXWIN);
+
+	nto.to_flags = TOF_MSS;
+	nto.to_mss = tcp_sc_msstab[mss];
+	if (V_tcp_do_rfc1323 && (to->to_flags & TOF_TS)) {
+		nto.to_flags |= TOF_TS;
+		nto.to_tsecr = to->to_tsval;
+		nto.to_tsval = tcp_ts_getticks() & ~0x3f;
+		if (to->to_flags & TOF_SACKPERM) {
+			nto.to_flags |= TOF_SACKPERM;
+			nto.to_tsval |= 0x20;
+		}
+		if (to->to_flags & TOF_SCALE) {
+			wscale = 0;
+			while (wscale < OFP_TCP_MAX_WINSHIFT &&
+			       (OFP_TCP_MAXWIN << wscale) < (int)ofp_sb_max)
+				wscale++;
+			nto.to_flags |= TOF_SCALE;
+			nto.to_wscale = wscale;
+			nto.to_tsval |= 0x10 |
+				min(to->to_wscale, OFP_TCP_MAX_WINSHIFT);
+		}
+	}
+	optlen = ofp_tcp_addoptions(&nto, opt);
+
+	/* Rewrite the SYN, dropping its options and data. */
+	len = sizeof(struct tcpiphdr) + optlen;
+	if (odp_packet_len(m) > len)
+		odp_packet_pull_tail(m, odp_packet_len(m) - len);
+	else if (odp_packet_len(m) < len &&
+		 odp_packet_push_tail(m, len - odp_packet_len(m)) == NULL)
+		return -1;
+	ip = (struct ofp_ip *)odp_packet_data(m);
+	nth = (struct ofp_tcphdr *)(ip + 1);
+
+	ip->ip_tos = inp->inp_ip_tos;
+	ip->ip_len = odp_cpu_to_be_16(len);
+	ip->ip_id = 0;
+	ip->ip_off = V_path_mtu_discovery ? odp_cpu_to_be_16(OFP_IP_DF) : 0;
+	ip->ip_ttl = inp->inp_ip_ttl;
+	ip->ip_sum = 0;
+	ip->ip_src = inc.inc_laddr;
+	ip->ip_dst = inc.inc_faddr;
+
+	nth->th_sport = inc.inc_lport;
+	nth->th_dport = inc.inc_fport;
+	nth->th_seq = odp_cpu_to_be_32(iss);
+	nth->th_ack = odp_cpu_to_be_32(ack);
+	nth->th_x2 = 0;
+	nth->th_off = (sizeof(struct ofp_tcphdr) + optlen) >> 2;
+	nth->th_flags = OFP_TH_SYN | OFP_TH_ACK;
+	nth->th_win = odp_cpu_to_be_16(win);
+	nth->th_sum = 0;
+	nth->th_urp = 0;
+	memcpy(nth + 1, opt, optlen);
+
+	odp_packet_l3_offset_set(m, 0);
+	odp_packet_l4_offset_set(m, sizeof(struct ofp_ip));
+	ofp_packet_user_area_reset(m);
+	ofp_packet_user_area(m)->chksum_flags |= OFP_TCP_CHKSUM_INSERT;
+
+	TCPSTAT_INC(tcps_sc_sendcookie);
+	if (ofp_ip_output(m, NULL) == OFP_PKT_DROP)
+		odp_packet_free(m);
+	else {
+		TCPSTAT_INC(tcps_sndacks);
+		TCPSTAT_INC(tcps_sndtotal);
+	}
+	return 0;
+}
+
+/*
+ * Check an ACK against the stateless cookies and recreate the syncache
+ * entry, as syncookie_lookup() does.
+ */
+static struct syncache *
+syncookie_fast_lookup(struct in_conninfo *inc, struct syncache *sc,
+    struct tcpopt *to, struct ofp_tcphdr *th, struct socket *so)
+{
+	uint32_t count = time_uptime >> SYNCOOKIE_FAST_SHIFT;
+	tcp_seq ack = th->th_ack - 1;
+	tcp_seq seq = th->th_seq - 1;
+	uint32_t mss = ack & 0x7;
+	uint32_t data;
+	int wnd;
+
+#ifdef INET6
+	if (inc->inc_flags & INC_ISIPV6)
+		return (NULL);
+#endif
+	if ((syncookie_fast_hash(inc, seq, count, mss) & ~0x7) !=
+	    (ack & ~0x7) &&
+	    (syncookie_fast_hash(inc, seq, count - 1, mss) & ~0x7) !=
+	    (ack & ~0x7))
+		return (NULL);
+
+	bcopy(inc, &sc->sc_inc, sizeof(struct in_conninfo));
+	sc->sc_ipopts = ODP_PACKET_INVALID;
+	sc->sc_irs = seq;
+	sc->sc_iss = ack;
+	sc->sc_ip_ttl = sotoinpcb(so)->inp_ip_ttl;
+	sc->sc_ip_tos = sotoinpcb(so)->inp_ip_tos;
+
+	if (to->to_flags & TOF_TS) {
+		data = to->to_tsecr;
+		sc->sc_flags |= SCF_TIMESTAMP;
+		sc->sc_tsreflect = to->to_tsval;
+		sc->sc_ts = to->to_tsecr;
+		sc->sc_tsoff = to->to_tsecr - tcp_ts_getticks();
+		if (data & 0x20)
+			sc->sc_flags |= SCF_SACK;
+		if (data & 0x10) {
+			sc->sc_requested_s_scale = data & 0xf;
+			while (sc->sc_requested_r_scale < OFP_TCP_MAX_WINSHIFT &&
+			       (OFP_TCP_MAXWIN << sc->sc_requested_r_scale) <
+			       (int)ofp_sb_max)
+				sc->sc_requested_r_scale++;
+			sc->sc_flags |= SCF_WINSCALE;
+		}
+	} else
+		sc->sc_flags |= SCF_NOOPT;
+
+	wnd = sbspace(&so->so_rcv);
+	wnd = imax(wnd, 0);
+	wnd = imin(wnd, OFP_TCP_MAXWIN);
+	sc->sc_wnd = wnd;
+
+	sc->sc_rxmits = 0;
+	sc->sc_peer_mss = tcp_sc_msstab[mss];
+
+	TCPSTAT_INC(tcps_sc_recvcookie);
+	return (sc);
+}
+
 /*
  * Returns the current number of syncache entries.  This number
  * will probably change before you get around to calling
@@ -1589,9 +2071,10 @@ int
 ofp_syncache_pcbcount(void)
 {
 	struct syncache_head *sch;
-	int count, i;
+	int count, i, num;
 
-	for (count = 0, i = 0; i < (int)V_tcp_syncache.hashsize; i++) {
+	num = V_tcp_syncache.hashsize * TCP_NUM_CPU;
+	for (count = 0, i = 0; i < num; i++) {
 		/* No need to lock for a read. */
 		sch = &V_tcp_syncache.hashbase[i];
 		count += sch->sch_length;
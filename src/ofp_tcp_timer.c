@@ -51,6 +51,7 @@
 #include "ofpi_tcp_var.h"
 #include "ofpi_tcp_shm.h"
 #include "ofpi_tcp.h"
+#include "ofpi_cc.h"
 #ifdef TCPDEBUG
 #include <netinet/tcp_debug.h>
 #endif
@@ -107,10 +108,10 @@ OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, keepcnt, OFP_CTLFLAG_RW, &ofp_tcp_ke
 int	ofp_tcp_maxpersistidle;
 
 
-#if (defined OFP_RSS) || (defined OFP_TCP_MULTICORE_TIMERS)
+#if (defined OFP_TCP_MULTICORE_TIMERS)
 #define	INP_CPU(inp) odp_cpu_id()
 #else
-#define	INP_CPU(inp) -1
+#define	INP_CPU(inp) (OFP_SHARE_NOTHING ? odp_cpu_id() : -1)
 #endif
 
 /*
@@ -125,15 +126,17 @@ ofp_tcp_slowtimo(void *notused)
 	INP_INFO_WLOCK(&V_tcbinfo);
 	(void) ofp_tcp_tw_2msl_scan(0);
 	INP_INFO_WUNLOCK(&V_tcbinfo);
+	ofp_tcp_twexpire();
+	ofp_syncache_timer();
 
-#ifndef OFP_RSS
-	shm_tcp->ofp_tcp_slow_timer =
+	if (!OFP_SHARE_NOTHING) {
+		shm_tcp->ofp_tcp_slow_timer[0] =
 			ofp_timer_start(500000, ofp_tcp_slowtimo, NULL, 0);
-#else
-	uint32_t cpu_id = odp_cpu_id();
-	shm_tcp->ofp_tcp_slow_timer[cpu_id] = ofp_timer_start_cpu_id(500000,
-					ofp_tcp_slowtimo, NULL, 0, cpu_id);
-#endif
+	} else {
+		uint32_t cpu_id = odp_cpu_id();
+		shm_tcp->ofp_tcp_slow_timer[cpu_id] = ofp_timer_start_cpu_id(
+				500000, ofp_tcp_slowtimo, NULL, 0, cpu_id);
+	}
 }
 
 int	ofp_tcp_syn_backoff[TCP_MAXRXTSHIFT + 1] =
@@ -156,9 +159,6 @@ ofp_tcp_timer_delack(void *xtp)
 	struct tcpcb *tp = *(struct tcpcb **)xtp;
 	struct inpcb *inp;
 
-	if (tp->t_timers)
-		tp->t_timers->tt_delack.odptmo = ODP_TIMER_INVALID;
-
 	inp = tp->t_inpcb;
 	/*
 	 * XXXRW: While this assert is in fact correct, bugs in the tcpcb
@@ -185,6 +185,32 @@ ofp_tcp_timer_delack(void *xtp)
 	INP_WUNLOCK(inp);
 }
 
+/*
+ * The pacing rate allows the next segment to be sent.
+ */
+void
+ofp_tcp_timer_pace(void *xtp)
+{
+	struct tcpcb *tp = *(struct tcpcb **)xtp;
+	struct inpcb *inp;
+
+	inp = tp->t_inpcb;
+	if (inp == NULL) {
+		tcp_timer_race++;
+		return;
+	}
+	INP_WLOCK(inp);
+	if ((inp->inp_flags & INP_DROPPED) || callout_pending(&tp->t_timers->tt_pace)
+	    || !callout_active(&tp->t_timers->tt_pace)) {
+		INP_WUNLOCK(inp);
+		return;
+	}
+	callout_deactivate(&tp->t_timers->tt_pace);
+
+	(void) ofp_tcp_output(tp);
+	INP_WUNLOCK(inp);
+}
+
 void
 ofp_tcp_timer_2msl(void *xtp)
 {
@@ -239,7 +265,7 @@ ofp_tcp_timer_2msl(void *xtp)
 	} else {
 		if (tp->t_state != TCPS_TIME_WAIT &&
 		    (int)(ofp_timer_ticks(0) - tp->t_rcvtime) <= TP_MAXIDLE(tp))
-		       callout_reset_on(&tp->t_timers->tt_2msl,
+		       ofp_callout_reset_coarse(&tp->t_timers->tt_2msl,
 			   TP_KEEPINTVL(tp), ofp_tcp_timer_2msl, tp, INP_CPU(inp));
 	       else
 		       tp = ofp_tcp_close(tp);
@@ -261,6 +287,7 @@ ofp_tcp_timer_keep(void *xtp)
 	struct tcpcb *tp = *(struct tcpcb **)xtp;
 	struct tcptemp *t_template;
 	struct inpcb *inp;
+	int idle;
 #ifdef TCPDEBUG
 	int ostate;
 
@@ -295,11 +322,25 @@ ofp_tcp_timer_keep(void *xtp)
 	TCPSTAT_INC(tcps_keeptimeo);
 	if (tp->t_state < TCPS_ESTABLISHED)
 		goto dropit;
+	/* Connections that only receive are seen idle here */
+	SOCKBUF_LOCK(&inp->inp_socket->so_snd);
+	ofp_tcp_sbautoshrink(tp);
+	SOCKBUF_UNLOCK(&inp->inp_socket->so_snd);
 	if ((always_keepalive || (inp->inp_socket->so_options & OFP_SO_KEEPALIVE)) &&
 	    tp->t_state <= TCPS_CLOSING) {
-		if ((int)(ofp_timer_ticks(0) - tp->t_rcvtime) >=
-		    TP_KEEPIDLE(tp) + TP_MAXIDLE(tp))
+		idle = (int)(ofp_timer_ticks(0) - tp->t_rcvtime);
+		if (idle >= TP_KEEPIDLE(tp) + TP_MAXIDLE(tp))
 			goto dropit;
+		/*
+		 * Received segments only update t_rcvtime, the timer
+		 * is pushed back here when it goes off.
+		 */
+		if (idle < TP_KEEPIDLE(tp)) {
+			ofp_callout_reset_coarse(&tp->t_timers->tt_keep,
+			    TP_KEEPIDLE(tp) - idle, ofp_tcp_timer_keep, tp,
+			    INP_CPU(inp));
+			goto out;
+		}
 		/*
 		 * Send a packet designed to force a response
 		 * if the peer is up and reachable:
@@ -321,12 +362,13 @@ ofp_tcp_timer_keep(void *xtp)
 				    tp->rcv_nxt, tp->snd_una - 1, 0);
 			free(t_template);
 		}
-		callout_reset_on(&tp->t_timers->tt_keep, TP_KEEPINTVL(tp),
-		    ofp_tcp_timer_keep, tp, INP_CPU(inp));
+		ofp_callout_reset_coarse(&tp->t_timers->tt_keep,
+		    TP_KEEPINTVL(tp), ofp_tcp_timer_keep, tp, INP_CPU(inp));
 	} else
-		callout_reset_on(&tp->t_timers->tt_keep, TP_KEEPIDLE(tp),
-		    ofp_tcp_timer_keep, tp, INP_CPU(inp));
+		ofp_callout_reset_coarse(&tp->t_timers->tt_keep,
+		    TP_KEEPIDLE(tp), ofp_tcp_timer_keep, tp, INP_CPU(inp));
 
+out:
 #ifdef TCPDEBUG
 	if (inp->inp_socket->so_options & OFP_SO_DEBUG)
 		tcp_trace(TA_USER, ostate, tp, (void *)0, (struct ofp_tcphdr *)0,
@@ -507,6 +549,7 @@ ofp_tcp_timer_rexmt(void * xtp)
 	} else
 		t_flags_and(tp->t_flags, ~TF_PREVVALID);
 	TCPSTAT_INC(tcps_rexmttimeo);
+	OFP_TRACEPOINT(tcp_rexmt_timeout, tp, tp->t_rxtshift);
 	if (tp->t_state == TCPS_SYN_SENT)
 		rexmt = TCP_REXMTVAL(tp) * ofp_tcp_syn_backoff[tp->t_rxtshift];
 	else
@@ -542,9 +585,7 @@ ofp_tcp_timer_rexmt(void * xtp)
 	 * If timing a segment in this window, stop the timer.
 	 */
 	tp->t_rtttime = 0;
-	/* HJo: FIX
 	ofp_cc_cong_signal(tp, NULL, CC_RTO);
-	*/
 	(void) ofp_tcp_output(tp);
 
 out:
@@ -615,7 +656,6 @@ ofp_tcp_timer_activate(struct tcpcb *tp, int timer_type, uint32_t delta)
 			f_callout = ofp_tcp_timer_persist;
 			break;
 		case TT_KEEP:
-			if (delta > 6000) delta = 6000;
 			t_callout = &tp->t_timers->tt_keep;
 			f_callout = ofp_tcp_timer_keep;
 			break;
@@ -623,11 +663,18 @@ ofp_tcp_timer_activate(struct tcpcb *tp, int timer_type, uint32_t delta)
 			t_callout = &tp->t_timers->tt_2msl;
 			f_callout = ofp_tcp_timer_2msl;
 			break;
+		case TT_PACE:
+			t_callout = &tp->t_timers->tt_pace;
+			f_callout = ofp_tcp_timer_pace;
+			break;
 		default:
 			panic("bad timer_type");
 		}
 	if (delta == 0) {
 		callout_stop(t_callout);
+	} else if (timer_type & (TT_KEEP | TT_2MSL)) {
+		/* Idle timeouts, seconds are precise enough */
+		ofp_callout_reset_coarse(t_callout, delta, f_callout, tp, cpu);
 	} else {
 		callout_reset_on(t_callout, delta, f_callout, tp, cpu);
 	}
@@ -654,6 +701,9 @@ ofp_tcp_timer_active(struct tcpcb *tp, int timer_type)
 		case TT_2MSL:
 			t_callout = &tp->t_timers->tt_2msl;
 			break;
+		case TT_PACE:
+			t_callout = &tp->t_timers->tt_pace;
+			break;
 #ifdef PASSIVE_INET
 		case TT_REASSDL:
 			t_callout = &tp->t_timers->tt_reassdl;
@@ -32,6 +32,7 @@
  *	@(#)tcp_subr.c	8.2 (Berkeley) 5/24/95
  */
 
+#include <string.h>
 #include <odp_api.h>
 
 #include "ofpi_init.h"
@@ -71,6 +72,8 @@ static int	maxtcptw;
 
 static void	tcp_tw_2msl_reset(struct tcptw *, int);
 static void	tcp_tw_2msl_stop(struct tcptw *);
+static int	tcp_ctw_start(struct tcpcb *);
+static int	tcp_ctw_respond(struct tcp_ctw *, int);
 
 static int
 tcptw_auto_size(void)
@@ -123,6 +126,133 @@ OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, nolocaltimewait, OFP_CTLFLAG_RW,
 	   &ofp_nolocaltimewait, 0,
 	   "Do not create compressed TCP TIME_WAIT entries for local connections");
 
+VNET_DEFINE(int, ofp_tcp_tw_reuse) = 1;
+#define	V_tcp_tw_reuse	VNET(ofp_tcp_tw_reuse)
+OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, tw_reuse, OFP_CTLFLAG_RW,
+	   &ofp_tcp_tw_reuse, 0,
+	   "Reuse TIME_WAIT state of connections with timestamps on connect");
+
+/*
+ * IPv4 connections in TIME_WAIT are kept in the compact TIME_WAIT table
+ * of the core, see struct tcp_twtable. The tables are protected by their
+ * own lock, which is the innermost one, and taken only when cores share
+ * the tables.
+ */
+#define	TW_LOCK(tbl) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_spinlock_lock(&(tbl)->lock); \
+	} while (0)
+#define	TW_UNLOCK(tbl) do { \
+		if (!OFP_SHARE_NOTHING) \
+			odp_spinlock_unlock(&(tbl)->lock); \
+	} while (0)
+
+#define	CTW(tbl, idx)	(&shm_tcp->ctw[(tbl)->base + (idx)])
+
+static inline uint32_t *
+ctw_bucket(struct tcp_twtable *tbl, ofp_in_addr_t faddr, uint16_t lport,
+	   uint16_t fport)
+{
+	return &tbl->hash[INP_PCBHASH(faddr, lport, fport,
+				      TCP_TW_HASHSIZE - 1)];
+}
+
+/*
+ * Returns the hash link of the entry of a 4-tuple, or NULL.
+ */
+static uint32_t *
+ctw_lookup(struct tcp_twtable *tbl, ofp_in_addr_t laddr, uint16_t lport,
+	   ofp_in_addr_t faddr, uint16_t fport)
+{
+	uint32_t *idxp = ctw_bucket(tbl, faddr, lport, fport);
+	struct tcp_ctw *ctw;
+
+	while (*idxp != TCP_TW_NONE) {
+		ctw = CTW(tbl, *idxp);
+		if (ctw->ctw_faddr == faddr && ctw->ctw_laddr == laddr &&
+		    ctw->ctw_fport == fport && ctw->ctw_lport == lport)
+			return idxp;
+		idxp = &ctw->ctw_hnext;
+	}
+	return NULL;
+}
+
+/*
+ * Remove an entry from the hash. It is freed when its wheel slot expires.
+ */
+static void
+ctw_unhash(struct tcp_twtable *tbl, uint32_t *idxp)
+{
+	struct tcp_ctw *ctw = CTW(tbl, *idxp);
+
+	*idxp = ctw->ctw_hnext;
+	ctw->ctw_lport = 0;
+}
+
+static void
+ctw_wheel_insert(struct tcp_twtable *tbl, uint32_t idx)
+{
+	struct tcp_ctw *ctw = CTW(tbl, idx);
+	uint32_t slot = (uint32_t)ctw->ctw_time / TCP_TW_SLOT;
+
+	/* Entries beyond the wheel are put back when their slot comes */
+	if ((int32_t)(slot - tbl->slot) <= 0)
+		slot = tbl->slot + 1;
+	else if (slot - tbl->slot >= TCP_TW_WHEEL)
+		slot = tbl->slot + TCP_TW_WHEEL - 1;
+	slot %= TCP_TW_WHEEL;
+
+	ctw->ctw_wnext = tbl->wheel[slot];
+	tbl->wheel[slot] = idx;
+}
+
+/*
+ * Take an entry from the free list, or the first one of the oldest wheel
+ * slot when the table is full.
+ */
+static uint32_t
+ctw_alloc(struct tcp_twtable *tbl)
+{
+	struct tcp_ctw *ctw;
+	uint32_t idx, *head, *idxp;
+	int i;
+
+	if (tbl->count == 0)
+		tbl->slot = (uint32_t)ticks / TCP_TW_SLOT;
+
+	idx = tbl->free;
+	if (idx != TCP_TW_NONE) {
+		tbl->free = CTW(tbl, idx)->ctw_hnext;
+		tbl->count++;
+		return idx;
+	}
+
+	for (i = 0; i < TCP_TW_WHEEL; i++) {
+		head = &tbl->wheel[(tbl->slot + i) % TCP_TW_WHEEL];
+		if (*head == TCP_TW_NONE)
+			continue;
+		idx = *head;
+		ctw = CTW(tbl, idx);
+		*head = ctw->ctw_wnext;
+		if (ctw->ctw_lport) {
+			idxp = ctw_lookup(tbl, ctw->ctw_laddr, ctw->ctw_lport,
+					  ctw->ctw_faddr, ctw->ctw_fport);
+			if (idxp)
+				ctw_unhash(tbl, idxp);
+		}
+		return idx;
+	}
+	return TCP_TW_NONE;
+}
+
+static void
+ctw_free(struct tcp_twtable *tbl, uint32_t idx)
+{
+	CTW(tbl, idx)->ctw_hnext = tbl->free;
+	tbl->free = idx;
+	tbl->count--;
+}
+
 void
 ofp_tcp_tw_zone_change(void)
 {
@@ -145,13 +275,25 @@ ofp_tcp_tw_init(void)
 		uma_zone_set_max(V_tcptw_zone, maxtcptw);
 	}
 
-#ifdef OFP_RSS
 	int32_t cpu_id = 0;
-	for (; cpu_id < odp_cpu_count() ; cpu_id++)
+	for (; cpu_id < TCP_NUM_CPU; cpu_id++)
 		OFP_TAILQ_INIT(&shm_tcp->twq_2msl[cpu_id]);
-#else
-	OFP_TAILQ_INIT(&V_twq_2msl);
-#endif
+
+	for (cpu_id = 0; cpu_id < TCP_NUM_CPU; cpu_id++) {
+		struct tcp_twtable *tbl = &shm_tcp->twtbl[cpu_id];
+		uint32_t i;
+
+		odp_spinlock_init(&tbl->lock);
+		memset(tbl->hash, 0xff, sizeof(tbl->hash));
+		memset(tbl->wheel, 0xff, sizeof(tbl->wheel));
+		tbl->base = cpu_id * TCP_TW_MAX;
+		tbl->count = 0;
+		tbl->slot = 0;
+		tbl->free = TCP_TW_MAX ? 0 : TCP_TW_NONE;
+		for (i = 0; i < TCP_TW_MAX; i++)
+			CTW(tbl, i)->ctw_hnext =
+				i + 1 < TCP_TW_MAX ? i + 1 : TCP_TW_NONE;
+	}
 }
 
 
@@ -191,6 +333,12 @@ ofp_tcp_twstart(struct tcpcb *tp)
 		}
 	}
 
+#ifdef INET6
+	if (!isipv6)
+#endif
+		if (tcp_ctw_start(tp) == 0)
+			return;
+
 	tw = uma_zalloc(V_tcptw_zone, OFP_M_NOWAIT);
 	if (tw == NULL) {
 		tw = ofp_tcp_tw_2msl_scan(1);
@@ -564,3 +712,274 @@ ofp_tcp_tw_2msl_scan(int reuse)
 	}
 	return (NULL);
 }
+
+/*
+ * Move an IPv4 connection into the TIME_WAIT table and close it, the
+ * table entry standing in for the inpcb and tcptw of ofp_tcp_twstart().
+ * Returns -1 if the table has no room.
+ */
+static int
+tcp_ctw_start(struct tcpcb *tp)
+{
+	struct tcp_twtable *tbl = &V_twtbl;
+	struct inpcb *inp = tp->t_inpcb;
+	struct tcp_ctw *ctw, ack;
+	uint32_t idx, *idxp;
+	int acknow;
+
+	TW_LOCK(tbl);
+	idx = ctw_alloc(tbl);
+	if (idx == TCP_TW_NONE) {
+		TW_UNLOCK(tbl);
+		return -1;
+	}
+	ctw = CTW(tbl, idx);
+
+	ctw->ctw_laddr = inp->inp_laddr.s_addr;
+	ctw->ctw_faddr = inp->inp_faddr.s_addr;
+	ctw->ctw_lport = inp->inp_lport;
+	ctw->ctw_fport = inp->inp_fport;
+	if (SEQ_GT(tp->rcv_adv, tp->rcv_nxt))
+		ctw->last_win = (tp->rcv_adv - tp->rcv_nxt) >> tp->rcv_scale;
+	else
+		ctw->last_win = 0;
+	if ((tp->t_flags & (TF_REQ_TSTMP|TF_RCVD_TSTMP|TF_NOOPT)) ==
+	    (TF_REQ_TSTMP|TF_RCVD_TSTMP)) {
+		ctw->t_recent = tp->ts_recent;
+		ctw->ts_offset = tp->ts_offset;
+	} else {
+		ctw->t_recent = 0;
+		ctw->ts_offset = 0;
+	}
+	ctw->snd_nxt = tp->snd_nxt;
+	ctw->rcv_nxt = tp->rcv_nxt;
+	ctw->ctw_time = ticks + 2 * ofp_tcp_msl;
+
+	idxp = ctw_lookup(tbl, ctw->ctw_laddr, ctw->ctw_lport,
+			  ctw->ctw_faddr, ctw->ctw_fport);
+	if (idxp)
+		ctw_unhash(tbl, idxp);
+	idxp = ctw_bucket(tbl, ctw->ctw_faddr, ctw->ctw_lport, ctw->ctw_fport);
+	ctw->ctw_hnext = *idxp;
+	*idxp = idx;
+	ctw_wheel_insert(tbl, idx);
+	ack = *ctw;
+	TW_UNLOCK(tbl);
+
+	acknow = tp->t_flags & TF_ACKNOW;
+	tp = ofp_tcp_close(tp);
+	if (tp != NULL)
+		INP_WUNLOCK(inp);
+	if (acknow)
+		tcp_ctw_respond(&ack, OFP_TH_ACK);
+	return 0;
+}
+
+/*
+ * Handle a segment of an IPv4 connection in the TIME_WAIT table, as
+ * ofp_tcp_twcheck() does for an inpcb in TIME_WAIT. Returns 1 if the
+ * 4-tuple is not in TIME_WAIT or a new connection request ended it, and
+ * the segment should go to a listening socket. Otherwise the segment is
+ * freed and 0 returned.
+ */
+int
+ofp_tcp_twinput(struct ofp_ip *ip, struct ofp_tcphdr *th, struct tcpopt *to,
+    odp_packet_t m, int tlen)
+{
+	struct tcp_twtable *tbl = &V_twtbl;
+	struct tcp_ctw *ctw, ack;
+	uint32_t *idxp;
+	int thflags = th->th_flags;
+	int respond = 0;
+	tcp_seq seq;
+
+	TW_LOCK(tbl);
+	idxp = ctw_lookup(tbl, ip->ip_dst.s_addr, th->th_dport,
+			  ip->ip_src.s_addr, th->th_sport);
+	if (idxp == NULL) {
+		TW_UNLOCK(tbl);
+		return 1;
+	}
+	ctw = CTW(tbl, *idxp);
+
+	/* Drop RSTs, see RFC 1337. */
+	if (thflags & OFP_TH_RST)
+		goto drop;
+
+	/*
+	 * A new connection request ends TIME_WAIT if its sequence number
+	 * or timestamp is above the previous ones (RFC 6191).
+	 */
+	if ((thflags & OFP_TH_SYN) &&
+	    (SEQ_GT(th->th_seq, ctw->rcv_nxt) ||
+	     (ctw->t_recent && (to->to_flags & TOF_TS) &&
+	      TSTMP_GT(to->to_tsval, ctw->t_recent)))) {
+		ctw_unhash(tbl, idxp);
+		TW_UNLOCK(tbl);
+		return 1;
+	}
+
+	if ((thflags & OFP_TH_ACK) == 0)
+		goto drop;
+
+	/* Restart 2MSL on a retransmitted FIN, the wheel catches up. */
+	if (thflags & OFP_TH_FIN) {
+		seq = th->th_seq + tlen + (thflags & OFP_TH_SYN ? 1 : 0);
+		if (seq + 1 == ctw->rcv_nxt)
+			ctw->ctw_time = ticks + 2 * ofp_tcp_msl;
+	}
+
+	if (thflags != OFP_TH_ACK || tlen == 0 ||
+	    th->th_seq != ctw->rcv_nxt || th->th_ack != ctw->snd_nxt) {
+		ack = *ctw;
+		respond = 1;
+	}
+drop:
+	TW_UNLOCK(tbl);
+	if (respond)
+		tcp_ctw_respond(&ack, OFP_TH_ACK);
+	odp_packet_free(m);
+	return 0;
+}
+
+/*
+ * Called by connect() once the 4-tuple of an IPv4 connection is set and
+ * its initial sequence number chosen. An earlier connection of the tuple
+ * in TIME_WAIT is ended if it used timestamps and has been in TIME_WAIT
+ * for a second: PAWS then rejects its old duplicates, and the new
+ * initial sequence number is moved above the old ones. Returns
+ * OFP_EADDRINUSE if the tuple stays in TIME_WAIT.
+ */
+int
+ofp_tcp_twreuse(struct tcpcb *tp)
+{
+	struct tcp_twtable *tbl = &V_twtbl;
+	struct inpcb *inp = tp->t_inpcb;
+	struct tcp_ctw *ctw;
+	uint32_t *idxp;
+	int error = 0;
+
+	INP_WLOCK_ASSERT(inp);
+
+	TW_LOCK(tbl);
+	if (tbl->count == 0) {
+		TW_UNLOCK(tbl);
+		return 0;
+	}
+	idxp = ctw_lookup(tbl, inp->inp_laddr.s_addr, inp->inp_lport,
+			  inp->inp_faddr.s_addr, inp->inp_fport);
+	if (idxp != NULL) {
+		ctw = CTW(tbl, *idxp);
+		if (V_tcp_tw_reuse && ctw->t_recent &&
+		    ticks - (ctw->ctw_time - 2 * ofp_tcp_msl) >= (int)hz) {
+			if (SEQ_LEQ(tp->iss, ctw->snd_nxt))
+				tp->iss = ctw->snd_nxt + OFP_TCP_MAXWIN;
+			tp->ts_offset = ctw->ts_offset;
+			ctw_unhash(tbl, idxp);
+		} else
+			error = OFP_EADDRINUSE;
+	}
+	TW_UNLOCK(tbl);
+	return error;
+}
+
+/*
+ * Free the entries of the TIME_WAIT table of this core whose 2MSL has
+ * expired. Called from ofp_tcp_slowtimo().
+ */
+void
+ofp_tcp_twexpire(void)
+{
+	struct tcp_twtable *tbl = &V_twtbl;
+	struct tcp_ctw *ctw;
+	uint32_t now = (uint32_t)ticks / TCP_TW_SLOT;
+	uint32_t idx, next, *idxp;
+
+	TW_LOCK(tbl);
+	if (now - tbl->slot > TCP_TW_WHEEL)
+		tbl->slot = now - TCP_TW_WHEEL;
+
+	while (tbl->count && (int32_t)(now - tbl->slot) >= 0) {
+		idx = tbl->wheel[tbl->slot % TCP_TW_WHEEL];
+		tbl->wheel[tbl->slot % TCP_TW_WHEEL] = TCP_TW_NONE;
+
+		for (; idx != TCP_TW_NONE; idx = next) {
+			ctw = CTW(tbl, idx);
+			next = ctw->ctw_wnext;
+			if (ctw->ctw_lport && ctw->ctw_time - ticks > 0) {
+				ctw_wheel_insert(tbl, idx);
+				continue;
+			}
+			if (ctw->ctw_lport) {
+				idxp = ctw_lookup(tbl, ctw->ctw_laddr,
+						  ctw->ctw_lport,
+						  ctw->ctw_faddr,
+						  ctw->ctw_fport);
+				if (idxp)
+					ctw_unhash(tbl, idxp);
+			}
+			ctw_free(tbl, idx);
+		}
+		tbl->slot++;
+	}
+	TW_UNLOCK(tbl);
+}
+
+static int
+tcp_ctw_respond(struct tcp_ctw *ctw, int flags)
+{
+	struct ofp_tcphdr *th;
+	struct ofp_ip *ip;
+	struct tcpopt to;
+	odp_packet_t m;
+	uint32_t optlen;
+	int error;
+
+	m = ofp_socket_packet_alloc(sizeof(struct tcpiphdr));
+	if (m == ODP_PACKET_INVALID)
+		return (OFP_ENOBUFS);
+
+	odp_packet_l3_offset_set(m, 0);
+	odp_packet_l4_offset_set(m, sizeof(struct ofp_ip));
+
+	ip = (struct ofp_ip *)odp_packet_data(m);
+	th = (struct ofp_tcphdr *)(ip + 1);
+	memset(ip, 0, sizeof(struct tcpiphdr));
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = 5;
+	ip->ip_ttl = V_ip_defttl;
+	ip->ip_p = OFP_IPPROTO_TCP;
+	ip->ip_src.s_addr = ctw->ctw_laddr;
+	ip->ip_dst.s_addr = ctw->ctw_faddr;
+	th->th_sport = ctw->ctw_lport;
+	th->th_dport = ctw->ctw_fport;
+
+	to.to_flags = 0;
+	if (ctw->t_recent && flags == OFP_TH_ACK) {
+		to.to_flags |= TOF_TS;
+		to.to_tsval = tcp_ts_getticks() + ctw->ts_offset;
+		to.to_tsecr = ctw->t_recent;
+	}
+	optlen = ofp_tcp_addoptions(&to, (uint8_t *)(th + 1));
+	odp_packet_push_tail(m, optlen);
+
+	th->th_seq = odp_cpu_to_be_32(ctw->snd_nxt);
+	th->th_ack = odp_cpu_to_be_32(ctw->rcv_nxt);
+	th->th_off = (sizeof(struct ofp_tcphdr) + optlen) >> 2;
+	th->th_flags = flags;
+	th->th_win = odp_cpu_to_be_16(ctw->last_win);
+
+	ip->ip_len = odp_cpu_to_be_16(odp_packet_len(m));
+	if (V_path_mtu_discovery)
+		ip->ip_off = odp_cpu_to_be_16(OFP_IP_DF);
+	ofp_packet_user_area(m)->chksum_flags |= OFP_TCP_CHKSUM_INSERT;
+
+	error = ofp_ip_output(m, NULL);
+
+	if (flags & OFP_TH_ACK)
+		TCPSTAT_INC(tcps_sndacks);
+	else
+		TCPSTAT_INC(tcps_sndctrl);
+	TCPSTAT_INC(tcps_sndtotal);
+	return (error);
+}
@@ -36,6 +36,7 @@
  *
  *	From: @(#)tcp_usrreq.c	8.2 (Berkeley) 1/3/94
  */
+#include <stdio.h>
 #include <strings.h>
 #include <string.h>
 
@@ -65,6 +66,7 @@
 #include "ofpi_tcp_timer.h"
 #include "ofpi_tcp_fsm.h"
 #include "ofpi_tcp_offload.h"
+#include "ofpi_cc.h"
 #include "ofpi_ioctl.h"
 
 #ifdef INET6
@@ -102,7 +104,7 @@ static int	tcp6_connect(struct tcpcb *, struct ofp_sockaddr *,
 #endif /* INET6 */
 static void	tcp_disconnect(struct tcpcb *);
 static void	tcp_usrclosed(struct tcpcb *);
-/*static void	tcp_fill_info(struct tcpcb *, struct tcp_info *);*/
+static void	tcp_fill_info(struct tcpcb *, struct ofp_tcp_info *);
 
 #ifdef TCPDEBUG
 #define	TCPDEBUG0	int ostate = 0
@@ -271,9 +273,9 @@ tcp_usr_bind(struct socket *so, struct ofp_sockaddr *nam, struct thread *td)
 	}
 	tp = intotcpcb(inp);
 	TCPDEBUG1();
-	INP_HASH_WLOCK(&V_tcbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	error = ofp_in_pcbbind(inp, nam, td->td_ucred);
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 out:
 	TCPDEBUG2(OFP_PRU_BIND);
 	INP_WUNLOCK(inp);
@@ -314,7 +316,7 @@ tcp6_usr_bind(struct socket *so, struct ofp_sockaddr *nam, struct thread *td)
 	tp = intotcpcb(inp);
 	(void)tp;
 	TCPDEBUG1();
-	INP_HASH_WLOCK(&V_tcbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	inp->inp_vflag &= ~INP_IPV4;
 	inp->inp_vflag |= INP_IPV6;
 
@@ -329,12 +331,12 @@ tcp6_usr_bind(struct socket *so, struct ofp_sockaddr *nam, struct thread *td)
 			inp->inp_vflag &= ~INP_IPV6;
 			error = ofp_in_pcbbind(inp, (struct ofp_sockaddr *)&sin,
 			    td->td_ucred);
-			INP_HASH_WUNLOCK(&V_tcbinfo);
+			INP_HASH_WUNLOCK(inp->inp_hashinfo);
 			goto out;
 		}
 	}
 	error = ofp_in6_pcbbind(inp, nam, td->td_ucred);
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 out:
 	TCPDEBUG2(OFP_PRU_BIND);
 	INP_WUNLOCK(inp);
@@ -365,12 +367,13 @@ tcp_usr_listen(struct socket *so, int backlog, struct thread *td)
 	TCPDEBUG1();
 	OFP_SOCK_LOCK(so);
 	error = ofp_solisten_proto_check(so);
-	INP_HASH_WLOCK(&V_tcbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	if (error == 0 && inp->inp_lport == 0)
 		error = ofp_in_pcbbind(inp, (struct ofp_sockaddr *)0, td->td_ucred);
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	if (error == 0) {
-		tp->t_state = TCPS_LISTEN;
+		tcp_state_change(tp, TCPS_LISTEN);
+		inp->inp_cpu = odp_cpu_id();
 		ofp_solisten_proto(so, backlog);
 		tcp_offload_listen_open(tp);
 	}
@@ -407,7 +410,7 @@ tcp6_usr_listen(struct socket *so, int backlog, struct thread *td)
 
 	error = ofp_solisten_proto_check(so);
 
-	INP_HASH_WLOCK(&V_tcbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	if (error == 0 && inp->inp_lport == 0) {
 		inp->inp_vflag &= ~INP_IPV4;
 
@@ -415,10 +418,11 @@ tcp6_usr_listen(struct socket *so, int backlog, struct thread *td)
 			inp->inp_vflag |= INP_IPV4;
 		error = ofp_in6_pcbbind(inp, (struct ofp_sockaddr *)0, td->td_ucred);
 	}
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 
 	if (error == 0) {
-		tp->t_state = TCPS_LISTEN;
+		tcp_state_change(tp, TCPS_LISTEN);
+		inp->inp_cpu = odp_cpu_id();
 		ofp_solisten_proto(so, backlog);
 	}
 	OFP_SOCK_UNLOCK(so);
@@ -849,6 +853,16 @@ tcp_usr_send(struct socket *so, int flags, odp_packet_t m,
 				goto out;
 			tp->snd_wnd = OFP_TTCP_CLIENT_SND_WND;
 			ofp_tcp_mss(tp, -1);
+			/*
+			 * TCP Fast Open: the SYN carries the data with the
+			 * cookie of the server, or asks for a cookie.
+			 */
+			if ((flags & PRUS_FASTOPEN) &&
+			    !(tp->t_flags & TF_NOOPT)) {
+				t_flags_or(tp->t_flags, TF_FASTOPEN);
+				tp->t_tfo_len = ofp_tcp_fastopen_ccache_get(
+					&inp->inp_inc, tp->t_tfo_cookie);
+			}
 		}
 		if (flags & PRUS_EOF) {
 			/*
@@ -1111,24 +1125,22 @@ tcp_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 {
 	struct inpcb *inp = tp->t_inpcb, *oinp;
 	struct socket *so = inp->inp_socket;
-	struct ofp_in_addr laddr;
-	uint16_t lport;
-	int error;
+	struct ofp_in_addr laddr, oladdr = inp->inp_laddr;
+	uint16_t lport, olport = inp->inp_lport;
+	int anonport, error, tries;
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK(&V_tcbinfo);
-
-	if (inp->inp_lport == 0) {
-		error = ofp_in_pcbbind(inp, (struct ofp_sockaddr *)0, td->td_ucred);
-		if (error)
-			goto out;
-	}
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 
 	/*
 	 * Cannot simply call ofp_in_pcbconnect, because there might be an
 	 * earlier incarnation of this same connection still in
 	 * TIME_WAIT state, creating an ADDRINUSE error.
+	 *
+	 * An unbound socket gets its port once the destination is known,
+	 * so that connections to different destinations can share ports.
 	 */
+	anonport = inp->inp_lport == 0;
 	laddr = inp->inp_laddr;
 	lport = inp->inp_lport;
 	error = ofp_in_pcbconnect_setup(inp, nam, &laddr.s_addr, &lport,
@@ -1140,8 +1152,38 @@ tcp_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 		goto out;
 	}
 	inp->inp_laddr = laddr;
-	ofp_in_pcbrehash(inp);
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	inp->inp_lport = lport;
+
+	/*
+	 * The 4-tuple may still be in the TIME_WAIT table. Unless its
+	 * state can be reused, move on to another port if ours was chosen
+	 * by the stack.
+	 */
+	tp->iss = ofp_tcp_new_isn(tp);
+	for (tries = 0; (error = ofp_tcp_twreuse(tp)) != 0; tries++) {
+		if (!anonport || tries == TCP_TW_CONNECT_TRIES)
+			goto fail;
+		lport = 0;
+		error = ofp_in_pcb_lport_dest(inp, &laddr, &lport,
+		    &inp->inp_faddr, inp->inp_fport, td->td_ucred,
+		    INPLOOKUP_WILDCARD);
+		if (error)
+			goto fail;
+		inp->inp_lport = lport;
+		tp->iss = ofp_tcp_new_isn(tp);
+	}
+
+	if (anonport) {
+		if (ofp_in_pcbinshash(inp) != 0) {
+			error = OFP_EAGAIN;
+			goto fail;
+		}
+		inp->inp_flags |= INP_ANONPORT;
+		if (so->so_options & OFP_SO_REUSEPORT)
+			inp->inp_flags2 |= INP_REUSEPORT;
+	} else
+		ofp_in_pcbrehash(inp);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 
 	/*
 	 * Compute window scaling to request:
@@ -1154,15 +1196,19 @@ tcp_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 
 	ofp_soisconnecting(so);
 	TCPSTAT_INC(tcps_connattempt);
-	tp->t_state = TCPS_SYN_SENT;
+	tcp_state_change(tp, TCPS_SYN_SENT);
 	ofp_tcp_timer_activate(tp, TT_KEEP, TP_KEEPINIT(tp));
-	tp->iss = ofp_tcp_new_isn(tp);
 	tcp_sendseqinit(tp);
 
 	return 0;
 
+fail:
+	inp->inp_laddr = oladdr;
+	inp->inp_lport = olport;
+	inp->inp_faddr.s_addr = OFP_INADDR_ANY;
+	inp->inp_fport = 0;
 out:
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	return (error);
 }
 #endif /* INET */
@@ -1178,7 +1224,7 @@ tcp6_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 	int error;
 
 	INP_WLOCK_ASSERT(inp);
-	INP_HASH_WLOCK(&V_tcbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 
 	if (inp->inp_lport == 0) {
 		error = ofp_in6_pcbbind(inp, (struct ofp_sockaddr *)0, td->td_ucred);
@@ -1198,7 +1244,7 @@ tcp6_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 	error = ofp_in6_pcbladdr(inp, nam, &addr6);
 	if (error)
 		goto out;
-	oinp = ofp_in6_pcblookup_hash_locked(inp->inp_pcbinfo,
+	oinp = ofp_in6_pcblookup_hash_locked(inp->inp_hashinfo,
 				  &sin6->sin6_addr, sin6->sin6_port,
 				  OFP_IN6_IS_ADDR_UNSPECIFIED(&inp->in6p_laddr)
 				  ? &addr6
@@ -1222,7 +1268,7 @@ tcp6_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 		    (odp_cpu_to_be_32(ofp_ip6_randomflowlabel())
 		    	& OFP_IPV6_FLOWLABEL_MASK);
 	ofp_in_pcbrehash(inp);
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 
 	/* Compute window scaling to request.  */
 	while (tp->request_r_scale < OFP_TCP_MAX_WINSHIFT &&
@@ -1231,7 +1277,7 @@ tcp6_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 
 	ofp_soisconnecting(so);
 	TCPSTAT_INC(tcps_connattempt);
-	tp->t_state = TCPS_SYN_SENT;
+	tcp_state_change(tp, TCPS_SYN_SENT);
 	ofp_tcp_timer_activate(tp, TT_KEEP, TP_KEEPINIT(tp));
 	tp->iss = ofp_tcp_new_isn(tp);
 	tcp_sendseqinit(tp);
@@ -1239,12 +1285,11 @@ tcp6_connect(struct tcpcb *tp, struct ofp_sockaddr *nam, struct thread *td)
 	return 0;
 
 out:
-	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	return error;
 }
 #endif /* INET6 */
 
-#if 0
 /*
  * Export TCP internal state information via a struct tcp_info, based on the
  * Linux 2.6 API.  Not ABI compatible as our constants are mapped differently
@@ -1253,27 +1298,32 @@ out:
  * from Linux.
  */
 static void
-tcp_fill_info(struct tcpcb *tp, struct tcp_info *ti)
+tcp_fill_info(struct tcpcb *tp, struct ofp_tcp_info *ti)
 {
+	uint64_t now = odp_time_to_ns(odp_time_global());
+	struct socket *so;
 
 	INP_WLOCK_ASSERT(tp->t_inpcb);
 	bzero(ti, sizeof(*ti));
 
 	ti->tcpi_state = tp->t_state;
 	if ((tp->t_flags & TF_REQ_TSTMP) && (tp->t_flags & TF_RCVD_TSTMP))
-		ti->tcpi_options |= TCPI_OPT_TIMESTAMPS;
+		ti->tcpi_options |= OFP_TCPI_OPT_TIMESTAMPS;
 	if (tp->t_flags & TF_SACK_PERMIT)
-		ti->tcpi_options |= TCPI_OPT_SACK;
+		ti->tcpi_options |= OFP_TCPI_OPT_SACK;
 	if ((tp->t_flags & TF_REQ_SCALE) && (tp->t_flags & TF_RCVD_SCALE)) {
-		ti->tcpi_options |= TCPI_OPT_WSCALE;
+		ti->tcpi_options |= OFP_TCPI_OPT_WSCALE;
 		ti->tcpi_snd_wscale = tp->snd_scale;
 		ti->tcpi_rcv_wscale = tp->rcv_scale;
 	}
 
-	ti->tcpi_rto = tp->t_rxtcur * tick;
-	ti->tcpi_last_data_recv = (long)(ticks - (int)tp->t_rcvtime) * tick;
-	ti->tcpi_rtt = ((uint64_t)tp->t_srtt * tick) >> TCP_RTT_SHIFT;
-	ti->tcpi_rttvar = ((uint64_t)tp->t_rttvar * tick) >> TCP_RTTVAR_SHIFT;
+	ti->tcpi_rto = tp->t_rxtcur * OFP_TIMER_RESOLUTION_US;
+	ti->tcpi_last_data_recv = (long)(ticks - (int)tp->t_rcvtime) *
+		OFP_TIMER_RESOLUTION_US;
+	ti->tcpi_rtt = ((uint64_t)tp->t_srtt * OFP_TIMER_RESOLUTION_US) >>
+		TCP_RTT_SHIFT;
+	ti->tcpi_rttvar = ((uint64_t)tp->t_rttvar * OFP_TIMER_RESOLUTION_US) >>
+		TCP_RTTVAR_SHIFT;
 
 	ti->tcpi_snd_ssthresh = tp->snd_ssthresh;
 	ti->tcpi_snd_cwnd = tp->snd_cwnd;
@@ -1288,13 +1338,30 @@ tcp_fill_info(struct tcpcb *tp, struct tcp_info *ti)
 	ti->tcpi_snd_nxt = tp->snd_nxt;
 	ti->tcpi_snd_mss = tp->t_maxseg;
 	ti->tcpi_rcv_mss = tp->t_maxseg;
-	if (tp->t_flags & TF_TOE)
-		ti->tcpi_options |= TCPI_OPT_TOE;
 	ti->tcpi_snd_rexmitpack = tp->t_sndrexmitpack;
 	ti->tcpi_rcv_ooopack = tp->t_rcvoopack;
 	ti->tcpi_snd_zerowin = tp->t_sndzerowin;
+
+	/*
+	 * OFP extensions. The time of the current limit is added up to
+	 * now.
+	 */
+	ti->tcpi_rcv_ooodrop = tp->t_rcvoodrop;
+	so = tp->t_inpcb->inp_socket;
+	ti->tcpi_pacing_rate = tp->t_pacing_rate;
+	if (so && so->so_max_pacing_rate &&
+	    (!ti->tcpi_pacing_rate ||
+	     ti->tcpi_pacing_rate > so->so_max_pacing_rate))
+		ti->tcpi_pacing_rate = so->so_max_pacing_rate;
+	ti->tcpi_delivery_rate = tp->t_delivery_rate;
+	ti->tcpi_bytes_sent = tp->t_sndbyte;
+	ti->tcpi_bytes_retrans = tp->t_sndrexmitbyte;
+	if (tp->t_lim_start)
+		tcp_limit_account(tp, tp->t_lim, now);
+	ti->tcpi_app_limited = tp->t_lim_ns[TCP_LIM_APP] / 1000;
+	ti->tcpi_rwnd_limited = tp->t_lim_ns[TCP_LIM_RWND] / 1000;
+	ti->tcpi_cwnd_limited = tp->t_lim_ns[TCP_LIM_CWND] / 1000;
 }
-#endif
 
 /*
  * ofp_tcp_ctloutput() must drop the inpcb lock before performing copyin on
@@ -1623,9 +1690,11 @@ ofp_tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 	}
 	return (error);
 #else
-	int error, optval;
+	int error = 0, optval;
 	struct inpcb *inp = sotoinpcb(so);
 	struct tcpcb *tp;
+	struct cc_algo *algo;
+	char buf[OFP_TCP_CA_NAME_MAX];
 
 	if (sopt->sopt_level != OFP_IPPROTO_TCP)
 		return 0;
@@ -1663,6 +1732,91 @@ ofp_tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 				}
 				INP_WUNLOCK(inp);
 			}
+			break;
+		case OFP_TCP_FASTOPEN:
+			error = ofp_sooptcopyin(sopt, &optval, sizeof(optval), sizeof(optval));
+			if (error) return error;
+
+			INP_WLOCK(inp);
+			tp = intotcpcb(inp);
+			if (optval)
+				t_flags_or(tp->t_flags, TF_FASTOPEN);
+			else
+				t_flags_and(tp->t_flags, ~TF_FASTOPEN);
+			INP_WUNLOCK(inp);
+			break;
+		case OFP_TCP_DEFER_ACCEPT:
+			/* The "dataready" accept filter, without a timeout */
+			error = ofp_sooptcopyin(sopt, &optval, sizeof(optval), sizeof(optval));
+			if (error) return error;
+
+			return ofp_accept_filt_set(so, optval ? "dataready" :
+						   NULL, NULL);
+		case OFP_TCP_TXTLS_ENABLE:
+			return ofp_ktls_setopt(so, sopt);
+		case OFP_TCP_CONGESTION:
+			memset(buf, 0, sizeof(buf));
+			error = ofp_sooptcopyin(sopt, buf, sizeof(buf) - 1, 1);
+			if (error)
+				return error;
+
+			algo = ofp_cc_algo_find(buf);
+			if (algo == NULL)
+				return OFP_EINVAL;
+
+			INP_WLOCK(inp);
+			tp = intotcpcb(inp);
+			if (CC_ALGO(tp)->cb_destroy != NULL)
+				CC_ALGO(tp)->cb_destroy(tp->ccv);
+			CC_ALGO(tp) = algo;
+			/*
+			 * If something goes pear shaped initialising the new
+			 * algo, fall back to newreno (which does not require
+			 * initialisation).
+			 */
+			if (algo->cb_init != NULL && algo->cb_init(tp->ccv) > 0) {
+				CC_ALGO(tp) = &ofp_newreno_cc_algo;
+				error = OFP_ENOMEM;
+			}
+			INP_WUNLOCK(inp);
+			return error;
+		}
+		break;
+	case SOPT_GET:
+		switch (sopt->sopt_name) {
+		case OFP_TCP_INFO: {
+			struct ofp_tcp_info ti;
+
+			INP_WLOCK(inp);
+			if (inp->inp_flags & (INP_TIMEWAIT | INP_DROPPED)) {
+				INP_WUNLOCK(inp);
+				return OFP_ECONNRESET;
+			}
+			tp = intotcpcb(inp);
+			tcp_fill_info(tp, &ti);
+			INP_WUNLOCK(inp);
+			return ofp_sooptcopyout(sopt, &ti, sizeof(ti));
+		}
+		case OFP_TCP_FASTOPEN:
+			INP_WLOCK(inp);
+			tp = intotcpcb(inp);
+			optval = (tp->t_flags & TF_FASTOPEN) ? 1 : 0;
+			INP_WUNLOCK(inp);
+			return ofp_sooptcopyout(sopt, &optval, sizeof(optval));
+		case OFP_TCP_DEFER_ACCEPT:
+			optval = so->so_accf.so_accept_filter ==
+				accept_filt_get("dataready");
+			return ofp_sooptcopyout(sopt, &optval, sizeof(optval));
+		case OFP_TCP_TXTLS_ENABLE:
+			optval = so->so_tls.vminor != 0;
+			return ofp_sooptcopyout(sopt, &optval, sizeof(optval));
+		case OFP_TCP_CONGESTION:
+			memset(buf, 0, sizeof(buf));
+			INP_WLOCK(inp);
+			tp = intotcpcb(inp);
+			snprintf(buf, sizeof(buf), "%s", CC_ALGO(tp)->name);
+			INP_WUNLOCK(inp);
+			return ofp_sooptcopyout(sopt, buf, sizeof(buf));
 		}
 		break;
 	default:
@@ -1727,7 +1881,7 @@ tcp_attach(struct socket *so)
 		INP_INFO_WUNLOCK(&V_tcbinfo);
 		return (OFP_ENOBUFS);
 	}
-	tp->t_state = TCPS_CLOSED;
+	tcp_state_change(tp, TCPS_CLOSED);
 	INP_WUNLOCK(inp);
 	INP_INFO_WUNLOCK(&V_tcbinfo);
 	return (0);
@@ -1795,7 +1949,7 @@ again:
 		tcp_offload_listen_close(tp);
 		/* FALLTHROUGH */
 	case TCPS_CLOSED:
-		tp->t_state = TCPS_CLOSED;
+		tcp_state_change(tp, TCPS_CLOSED);
 		tp = ofp_tcp_close(tp);
 		/*
 		 * ofp_tcp_close() should never return NULL here as the socket is
@@ -1811,18 +1965,18 @@ again:
 		break;
 
 	case TCPS_ESTABLISHED:
-		tp->t_state = TCPS_FIN_WAIT_1;
+		tcp_state_change(tp, TCPS_FIN_WAIT_1);
 		break;
 
 	case TCPS_CLOSE_WAIT:
 #ifdef PASSIVE_INET
 		/* Passive sockets don't wait for an ack. */
 		if (tp->t_inpcb->inp_flags2 & INP_PASSIVE) {
-			tp->t_state = TCPS_CLOSED;
+			tcp_state_change(tp, TCPS_CLOSED);
 			goto again;
 		}
 #endif
-		tp->t_state = TCPS_LAST_ACK;
+		tcp_state_change(tp, TCPS_LAST_ACK);
 		break;
 	}
 	if (tp->t_state >= TCPS_FIN_WAIT_2) {
@@ -0,0 +1,421 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <odp_api.h>
+
+#include "ofpi_config.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_stat.h"
+#include "ofpi_timer.h"
+#include "ofpi_portconf.h"
+#include "ofpi_telemetry.h"
+#include "ofpi_init.h"
+
+#define TELEMETRY_IF_MAX FP_PORTS
+#define TELEMETRY_IFNET_MAX (NUM_PORTS + global_param->num_vlan)
+
+ODP_STATIC_ASSERT(OFP_DROP_REASON_MAX <= OFP_TELEMETRY_DROP_MAX,
+		  "OFP_TELEMETRY_DROP_MAX too small");
+ODP_STATIC_ASSERT(OFP_LATENCY_SLICES == OFP_TELEMETRY_LATENCY_SLICES,
+		  "latency histogram size mismatch");
+
+/*
+ * The segment is mapped in the process that initialized OFP. The
+ * update timer is the only writer.
+ */
+static struct {
+	struct ofp_telemetry_hdr *hdr;
+	size_t size;
+	char name[64];
+	uint64_t interval_us;
+	odp_timer_t tmr;
+	int running;
+} telemetry = { .tmr = ODP_TIMER_INVALID };
+
+static inline void write_begin(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_end(uint32_t *seq)
+{
+	__atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Counters are written by their own thread only */
+#define READ_CNT(_v) __atomic_load_n(&(_v), __ATOMIC_RELAXED)
+
+/* Writable records, as ofp_telemetry_thread() etc. of the readers */
+static void *rec(uint64_t offset, uint64_t size, uint32_t i)
+{
+	return (char *)telemetry.hdr + offset + (uint64_t)i * size;
+}
+
+static struct ofp_telemetry_thread *thread_rec(uint32_t i)
+{
+	return rec(telemetry.hdr->thread_offset, telemetry.hdr->thread_size, i);
+}
+
+static struct ofp_telemetry_if *if_rec(uint32_t i)
+{
+	return rec(telemetry.hdr->if_offset, telemetry.hdr->if_size, i);
+}
+
+static struct ofp_telemetry_ifnet *ifnet_rec(uint32_t i)
+{
+	return rec(telemetry.hdr->ifnet_offset, telemetry.hdr->ifnet_size, i);
+}
+
+static void fp_copy(struct ofp_telemetry_fp *r, const struct ofp_if_stat *st)
+{
+	r->rx_pkts = st->rx_pkts;
+	r->rx_bytes = st->rx_bytes;
+	r->tx_pkts = st->tx_pkts;
+	r->tx_bytes = st->tx_bytes;
+}
+
+static void update_threads(struct ofp_packet_stat *st)
+{
+	struct ofp_telemetry_thread *t;
+	uint32_t thr;
+	int i;
+
+	for (thr = 0; thr < telemetry.hdr->num_thread; thr++) {
+		__typeof__(st->per_thr[0]) *s = &st->per_thr[thr];
+
+		t = thread_rec(thr);
+		write_begin(&t->seq);
+		t->rx_fp = READ_CNT(s->rx_fp);
+		t->tx_fp = READ_CNT(s->tx_fp);
+		t->rx_sp = READ_CNT(s->rx_sp);
+		t->tx_sp = READ_CNT(s->tx_sp);
+		t->tx_eth_frag = READ_CNT(s->tx_eth_frag);
+		t->tx_tcp_gso = READ_CNT(s->tx_tcp_gso);
+		t->rx_ip_frag = READ_CNT(s->rx_ip_frag);
+		t->rx_ip_reass = READ_CNT(s->rx_ip_reass);
+		t->rx_tcp_gro = READ_CNT(s->rx_tcp_gro);
+		t->tx_paced = READ_CNT(s->tx_paced);
+		for (i = 0; i < OFP_DROP_REASON_MAX; i++)
+			t->drop[i] = READ_CNT(s->drop[i]);
+		for (i = 0; i < OFP_LATENCY_SLICES; i++)
+			t->input_latency[i] = READ_CNT(s->input_latency[i]);
+		write_end(&t->seq);
+	}
+}
+
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 30
+static void update_queues(struct ofp_ifnet *ifnet, struct ofp_telemetry_if *r)
+{
+	odp_pktin_queue_t in[OFP_TELEMETRY_QUEUE_MAX];
+	odp_queue_t in_ev[OFP_TELEMETRY_QUEUE_MAX];
+	odp_pktin_queue_stats_t in_st;
+	odp_pktout_queue_stats_t out_st;
+	int num, i, ev = 0;
+
+	num = odp_pktin_queue(ifnet->pktio, in, OFP_TELEMETRY_QUEUE_MAX);
+	if (num < 0) {
+		num = odp_pktin_event_queue(ifnet->pktio, in_ev,
+					    OFP_TELEMETRY_QUEUE_MAX);
+		ev = 1;
+	}
+	if (num < 0)
+		num = 0;
+	if (num > OFP_TELEMETRY_QUEUE_MAX)
+		num = OFP_TELEMETRY_QUEUE_MAX;
+
+	r->num_in_queue = num;
+	for (i = 0; i < num; i++) {
+		if ((ev ? odp_pktin_event_queue_stats(ifnet->pktio, in_ev[i],
+						      &in_st) :
+		     odp_pktin_queue_stats(in[i], &in_st)) < 0)
+			memset(&in_st, 0, sizeof(in_st));
+		r->in_queue[i].octets = in_st.octets;
+		r->in_queue[i].packets = in_st.packets;
+		r->in_queue[i].discards = in_st.discards;
+		r->in_queue[i].errors = in_st.errors;
+	}
+
+	num = 0;
+	if (ifnet->out_queue_type == OFP_OUT_QUEUE_TYPE_PKTOUT)
+		num = ifnet->out_queue_num;
+	if (num > OFP_TELEMETRY_QUEUE_MAX)
+		num = OFP_TELEMETRY_QUEUE_MAX;
+
+	r->num_out_queue = num;
+	for (i = 0; i < num; i++) {
+		if (odp_pktout_queue_stats(ifnet->out_queue_pktout[i],
+					   &out_st) < 0)
+			memset(&out_st, 0, sizeof(out_st));
+		r->out_queue[i].octets = out_st.octets;
+		r->out_queue[i].packets = out_st.packets;
+		r->out_queue[i].discards = out_st.discards;
+		r->out_queue[i].errors = out_st.errors;
+	}
+}
+#else
+static void update_queues(struct ofp_ifnet *ifnet, struct ofp_telemetry_if *r)
+{
+	(void)ifnet;
+
+	/* Queue statistics are not available in this ODP version */
+	r->num_in_queue = 0;
+	r->num_out_queue = 0;
+}
+#endif
+
+static void update_fp(uint32_t port, struct ofp_telemetry_if *r)
+{
+	struct ofp_if_stat st, q[OFP_TELEMETRY_QUEUE_MAX];
+	int num, i;
+
+	if (ofp_get_if_statistics(port, 0, &st) == 0)
+		fp_copy(&r->fp, &st);
+
+	num = ofp_get_if_queue_statistics(port, q, OFP_TELEMETRY_QUEUE_MAX);
+	if (num < 0)
+		num = 0;
+	r->num_fp_queue = num;
+	for (i = 0; i < num; i++)
+		fp_copy(&r->fp_queue[i], &q[i]);
+}
+
+static void update_ifs(void)
+{
+	struct ofp_telemetry_if *r;
+	struct ofp_ifnet *ifnet;
+	odp_pktio_stats_t stats;
+	uint32_t port;
+
+	for (port = 0; port < telemetry.hdr->num_if; port++) {
+		r = if_rec(port);
+		ifnet = ofp_get_ifnet(port, 0);
+
+		write_begin(&r->seq);
+		if (!ifnet || ifnet->if_state != OFP_IFT_STATE_USED ||
+		    ifnet->pktio == ODP_PKTIO_INVALID) {
+			r->valid = 0;
+			write_end(&r->seq);
+			continue;
+		}
+
+		r->valid = 1;
+		r->port = port;
+		snprintf(r->name, sizeof(r->name), "%s", ifnet->if_name);
+
+		if (odp_pktio_stats(ifnet->pktio, &stats) < 0)
+			memset(&stats, 0, sizeof(stats));
+		r->in_octets = stats.in_octets;
+		r->in_ucast_pkts = stats.in_ucast_pkts;
+		r->in_discards = stats.in_discards;
+		r->in_errors = stats.in_errors;
+		r->out_octets = stats.out_octets;
+		r->out_ucast_pkts = stats.out_ucast_pkts;
+		r->out_discards = stats.out_discards;
+		r->out_errors = stats.out_errors;
+
+		update_queues(ifnet, r);
+		update_fp(port, r);
+		write_end(&r->seq);
+	}
+}
+
+static int update_ifnet(void *key, void *arg)
+{
+	struct ofp_ifnet *ifnet = key;
+	uint32_t *idx = arg;
+	struct ofp_telemetry_ifnet *r;
+	struct ofp_if_stat st;
+
+	if (*idx >= telemetry.hdr->num_ifnet)
+		return 0;
+	if (!ifnet->vlan && PHYS_PORT(ifnet->port) &&
+	    ifnet->if_state != OFP_IFT_STATE_USED)
+		return 0;
+	if (ofp_get_if_statistics(ifnet->port, ifnet->vlan, &st))
+		return 0;
+
+	r = ifnet_rec((*idx)++);
+	write_begin(&r->seq);
+	r->valid = 1;
+	r->port = ifnet->port;
+	r->vlan = ifnet->vlan;
+	snprintf(r->name, sizeof(r->name), "%s",
+		 ofp_port_vlan_to_ifnet_name(ifnet->port, ifnet->vlan));
+	fp_copy(&r->fp, &st);
+	write_end(&r->seq);
+
+	return 0;
+}
+
+static void update_ifnets(void)
+{
+	struct ofp_telemetry_ifnet *r;
+	uint32_t idx = 0;
+
+	ofp_ifnet_iterate(update_ifnet, &idx);
+
+	/* Interfaces that went away */
+	for (; idx < telemetry.hdr->num_ifnet; idx++) {
+		r = ifnet_rec(idx);
+		if (!r->valid)
+			break;
+		write_begin(&r->seq);
+		r->valid = 0;
+		write_end(&r->seq);
+	}
+}
+
+void ofp_telemetry_update(void)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+	struct ofp_telemetry_hdr *hdr = telemetry.hdr;
+
+	if (!hdr || !st)
+		return;
+
+	update_threads(st);
+	update_ifs();
+	update_ifnets();
+
+	__atomic_store_n(&hdr->update_ns, odp_time_to_ns(odp_time_global()),
+			 __ATOMIC_RELAXED);
+	__atomic_store_n(&hdr->updates, hdr->updates + 1, __ATOMIC_RELEASE);
+}
+
+static void telemetry_tmo(void *arg)
+{
+	(void)arg;
+
+	telemetry.tmr = ODP_TIMER_INVALID;
+	if (!telemetry.running)
+		return;
+
+	ofp_telemetry_update();
+
+	telemetry.tmr = ofp_timer_start(telemetry.interval_us, telemetry_tmo,
+					NULL, 0);
+}
+
+int ofp_telemetry_init_global(struct telemetry_s *param)
+{
+	struct ofp_telemetry_hdr *hdr;
+	uint32_t num_thread = odp_thread_count_max();
+	size_t thread_off, if_off, ifnet_off, size;
+	uint32_t i;
+	int fd;
+
+	if (param->interval_ms <= 0)
+		return 0;
+
+	thread_off = (sizeof(*hdr) + ODP_CACHE_LINE_SIZE - 1) &
+		~(size_t)(ODP_CACHE_LINE_SIZE - 1);
+	if_off = thread_off +
+		num_thread * sizeof(struct ofp_telemetry_thread);
+	ifnet_off = if_off + TELEMETRY_IF_MAX * sizeof(struct ofp_telemetry_if);
+	size = ifnet_off +
+		TELEMETRY_IFNET_MAX * sizeof(struct ofp_telemetry_ifnet);
+
+	snprintf(telemetry.name, sizeof(telemetry.name), "%s",
+		 param->name ? param->name : OFP_TELEMETRY_NAME);
+
+	fd = shm_open(telemetry.name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if (fd < 0) {
+		OFP_ERR("shm_open(%s) failed: %s", telemetry.name,
+			strerror(errno));
+		return -1;
+	}
+
+	if (ftruncate(fd, size) < 0) {
+		OFP_ERR("ftruncate(%s) failed: %s", telemetry.name,
+			strerror(errno));
+		close(fd);
+		shm_unlink(telemetry.name);
+		return -1;
+	}
+
+	hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (hdr == MAP_FAILED) {
+		OFP_ERR("mmap(%s) failed: %s", telemetry.name,
+			strerror(errno));
+		shm_unlink(telemetry.name);
+		return -1;
+	}
+
+	/* ftruncate() zeroed the segment */
+	hdr->version = OFP_TELEMETRY_VERSION;
+	hdr->size = size;
+	hdr->pid = getpid();
+	hdr->num_thread = num_thread;
+	hdr->thread_size = sizeof(struct ofp_telemetry_thread);
+	hdr->thread_offset = thread_off;
+	hdr->num_if = TELEMETRY_IF_MAX;
+	hdr->if_size = sizeof(struct ofp_telemetry_if);
+	hdr->if_offset = if_off;
+	hdr->num_drop_reason = OFP_DROP_REASON_MAX;
+	hdr->num_latency_slice = OFP_LATENCY_SLICES;
+	hdr->num_ifnet = TELEMETRY_IFNET_MAX;
+	hdr->ifnet_size = sizeof(struct ofp_telemetry_ifnet);
+	hdr->ifnet_offset = ifnet_off;
+
+	telemetry.hdr = hdr;
+	telemetry.size = size;
+	telemetry.interval_us = (uint64_t)param->interval_ms * 1000;
+	if (telemetry.interval_us > OFP_TIMER_MAX_US)
+		telemetry.interval_us = OFP_TIMER_MAX_US;
+	hdr->interval_ns = telemetry.interval_us * 1000;
+
+	for (i = 0; i < num_thread; i++)
+		thread_rec(i)->thread_id = i;
+
+	/* Readers check the magic last */
+	__atomic_store_n(&hdr->magic, OFP_TELEMETRY_MAGIC, __ATOMIC_RELEASE);
+
+	telemetry.running = 1;
+	telemetry.tmr = ofp_timer_start(telemetry.interval_us, telemetry_tmo,
+					NULL, 0);
+	if (telemetry.tmr == ODP_TIMER_INVALID)
+		OFP_ERR("Telemetry timer start failed");
+
+	return 0;
+}
+
+int ofp_telemetry_term_global(void)
+{
+	int rc = 0;
+
+	if (!telemetry.hdr)
+		return 0;
+
+	telemetry.running = 0;
+	if (telemetry.tmr != ODP_TIMER_INVALID) {
+		ofp_timer_cancel(telemetry.tmr);
+		telemetry.tmr = ODP_TIMER_INVALID;
+	}
+
+	if (munmap(telemetry.hdr, telemetry.size) < 0) {
+		OFP_ERR("munmap(%s) failed", telemetry.name);
+		rc = -1;
+	}
+	telemetry.hdr = NULL;
+
+	if (shm_unlink(telemetry.name) < 0) {
+		OFP_ERR("shm_unlink(%s) failed", telemetry.name);
+		rc = -1;
+	}
+
+	return rc;
+}
@@ -13,9 +13,12 @@
 #include "ofpi_util.h"
 #include "ofpi_log.h"
 #include "ofpi_config.h"
+#include "ofpi_init.h"
 
 
 #include "ofpi_timer.h"
+#include "ofpi_callout.h"
+#include "ofpi_tracepoint.h"
 
 #define SHM_NAME_TIMER "OfpTimerShMem"
 
@@ -38,6 +41,39 @@ struct ofp_timer_long_internal {
 #define TIMER_NUM_LONG_SLOTS    (1<<TIMER_LONG_SHIFT)
 #define TIMER_LONG_MASK	 (TIMER_NUM_LONG_SLOTS-1)
 
+/* Callout wheel: WHEEL_LEVELS levels of WHEEL_SLOTS slots */
+#define WHEEL_BITS		6
+#define WHEEL_SLOTS		(1 << WHEEL_BITS)
+#define WHEEL_MASK		(WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS		4
+#define WHEEL_MAX_TICKS		((1U << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+/* Coarse wheel: COARSE_SLOTS slots of one second */
+#define COARSE_BITS		8
+#define COARSE_SLOTS		(1 << COARSE_BITS)
+#define COARSE_MASK		(COARSE_SLOTS - 1)
+
+struct callout_wheel {
+	odp_spinlock_t lock;
+	uint32_t now;		/* last tick processed */
+	uint32_t count;		/* pending callouts */
+	int running;		/* tick timer is armed */
+	uint8_t tick_local;	/* on the queue of the CPU */
+	uint8_t coarse_local;
+	odp_timer_t tick_timer;
+	struct callout_list expired;	/* due, not yet run */
+	struct callout_list slot[WHEEL_LEVELS][WHEEL_SLOTS];
+	uint32_t coarse_now;	/* last second processed */
+	uint32_t coarse_count;	/* pending coarse callouts */
+	int coarse_running;	/* coarse timer is armed */
+	odp_timer_t coarse_timer;
+	struct callout_list coarse_expired;
+	struct callout_list coarse[COARSE_SLOTS];
+} ODP_ALIGNED_CACHE;
+
+#define TIMER_BUDGET (global_param->timer_budget > 0 ?	\
+		      global_param->timer_budget : OFP_TIMER_BUDGET)
+
 /* MASK applied over odp_timer_t value when OFP handles the timer internally */
 #define OFP_TIMER_MASK (1UL << (sizeof(odp_timer_t) * 8 - 1))
 
@@ -46,15 +82,28 @@ struct ofp_timer_mem {
 	odp_pool_t pool;
 	odp_pool_t buf_pool;
 	odp_queue_t queue;
-	odp_queue_t queue_per_cpu[OFP_MAX_NUM_CPU];
+	odp_queue_t *queue_per_cpu;	/* after the wheels */
+	/* The default dispatcher of the CPU polls its queue */
+	uint8_t *cpu_polled;		/* after queue_per_cpu */
 	odp_timer_pool_t socket_timer_pool;
 	struct ofp_timer_internal *long_table[TIMER_NUM_LONG_SLOTS];
+	/* Expired long timers not yet run, see one_sec() */
+	struct ofp_timer_internal *long_expired;
+	struct ofp_timer_internal **long_expired_tail;
+	odp_timer_t timer_drain;
 	int sec_counter;
 	size_t id;
 	odp_spinlock_t lock;
 	odp_timer_t timer_1s;
+	int wheel_stop;
+	struct callout_wheel wheel[];	/* OFP_MAX_NUM_CPU */
 };
 
+#define SHM_SIZE_TIMER (sizeof(struct ofp_timer_mem) +			\
+			OFP_MAX_NUM_CPU * (sizeof(struct callout_wheel) + \
+					   sizeof(odp_queue_t) +		\
+					   sizeof(uint8_t)))
+
 /*
  * Data per core
  */
@@ -63,8 +112,10 @@ static __thread struct ofp_timer_mem *shm;
 
 static void ofp_timer_shm_init(void)
 {
-	uint32_t cpu_id;
-	memset(shm, 0, sizeof(*shm));
+	int cpu_id;
+	memset(shm, 0, SHM_SIZE_TIMER);
+	shm->queue_per_cpu = (odp_queue_t *)&shm->wheel[OFP_MAX_NUM_CPU];
+	shm->cpu_polled = (uint8_t *)&shm->queue_per_cpu[OFP_MAX_NUM_CPU];
 	shm->pool = ODP_POOL_INVALID;
 	shm->buf_pool = ODP_POOL_INVALID;
 	shm->queue = ODP_QUEUE_INVALID;
@@ -72,6 +123,54 @@ static void ofp_timer_shm_init(void)
 		shm->queue_per_cpu[cpu_id] = ODP_QUEUE_INVALID;
 	shm->socket_timer_pool = ODP_TIMER_POOL_INVALID;
 	shm->timer_1s = ODP_TIMER_INVALID;
+	shm->timer_drain = ODP_TIMER_INVALID;
+	shm->long_expired_tail = &shm->long_expired;
+	for (cpu_id = 0; cpu_id < OFP_MAX_NUM_CPU; cpu_id++) {
+		odp_spinlock_init(&shm->wheel[cpu_id].lock);
+		shm->wheel[cpu_id].tick_timer = ODP_TIMER_INVALID;
+		shm->wheel[cpu_id].coarse_timer = ODP_TIMER_INVALID;
+	}
+}
+
+/*
+ * Run at most TIMER_BUDGET expired long timers. Returns 1 if some were
+ * left for later.
+ */
+static int long_expired_run(void)
+{
+	struct ofp_timer_internal *bufdata;
+	int budget = TIMER_BUDGET;
+
+	odp_spinlock_lock(&shm->lock);
+	while (budget-- && (bufdata = shm->long_expired)) {
+		shm->long_expired = bufdata->next;
+		if (!shm->long_expired)
+			shm->long_expired_tail = &shm->long_expired;
+		if (shm->long_expired)
+			odp_prefetch(shm->long_expired);
+		odp_spinlock_unlock(&shm->lock);
+
+		OFP_TRACEPOINT(timer_fire, bufdata->callback, bufdata->arg);
+		bufdata->callback(&bufdata->arg);
+		odp_buffer_free(bufdata->buf);
+
+		odp_spinlock_lock(&shm->lock);
+	}
+	bufdata = shm->long_expired;
+	odp_spinlock_unlock(&shm->lock);
+
+	return bufdata != NULL;
+}
+
+static void long_drain(void *arg)
+{
+	(void)arg;
+
+	if (long_expired_run() && shm->timer_1s != ODP_TIMER_INVALID)
+		shm->timer_drain = ofp_timer_start(OFP_TIMER_RESOLUTION_US,
+						   long_drain, NULL, 0);
+	else
+		shm->timer_drain = ODP_TIMER_INVALID;
 }
 
 static void one_sec(void *arg)
@@ -83,14 +182,18 @@ static void one_sec(void *arg)
 	shm->sec_counter = (shm->sec_counter + 1) & TIMER_LONG_MASK;
 	bufdata = shm->long_table[shm->sec_counter];
 	shm->long_table[shm->sec_counter] = NULL;
+	if (bufdata) {
+		*shm->long_expired_tail = bufdata;
+		while (bufdata->next)
+			bufdata = bufdata->next;
+		shm->long_expired_tail = &bufdata->next;
+	}
 	odp_spinlock_unlock(&shm->lock);
 
-	while (bufdata) {
-		struct ofp_timer_internal *next = bufdata->next;
-		bufdata->callback(&bufdata->arg);
-		odp_buffer_free(bufdata->buf);
-		bufdata = next;
-	}
+	/* Timers beyond the budget are run on the following ticks */
+	if (long_expired_run() && shm->timer_drain == ODP_TIMER_INVALID)
+		shm->timer_drain = ofp_timer_start(OFP_TIMER_RESOLUTION_US,
+						   long_drain, NULL, 0);
 
 	/* Start one second timeout */
 	shm->timer_1s = ofp_timer_start(1000000UL, one_sec, NULL, 0);
@@ -98,7 +201,7 @@ static void one_sec(void *arg)
 
 static int ofp_timer_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_TIMER, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_TIMER, SHM_SIZE_TIMER);
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -121,13 +224,13 @@ static int ofp_timer_free_shared_memory(void)
 
 void ofp_timer_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_TIMER, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_TIMER, SHM_SIZE_TIMER);
 }
 
 static int ofp_timer_create_queues(odp_schedule_group_t sched_group)
 {
 	odp_queue_param_t param;
-	uint32_t cpu_id = 0;
+	int cpu_id = 0;
 
 	odp_queue_param_init(&param);
 	param.type = ODP_QUEUE_TYPE_SCHED;
@@ -149,7 +252,7 @@ static int ofp_timer_create_queues(odp_schedule_group_t sched_group)
 		param.enq_mode = ODP_QUEUE_OP_MT_UNSAFE;
 		param.deq_mode = ODP_QUEUE_OP_MT_UNSAFE;
 
-		sprintf(queue_name_cpu,"TimerQueue_cpu_%u", cpu_id);
+		sprintf(queue_name_cpu,"TimerQueue_cpu_%d", cpu_id);
 
 		shm->queue_per_cpu[cpu_id] = odp_queue_create(queue_name_cpu,
 				&param);
@@ -236,12 +339,36 @@ int ofp_timer_init_global(int resolution_us,
 int ofp_timer_stop_global(void)
 {
 	int rc = 0;
+	int i;
 
 	if (shm->timer_1s != ODP_TIMER_INVALID) {
 		CHECK_ERROR(ofp_timer_cancel(shm->timer_1s), rc);
 		shm->timer_1s = ODP_TIMER_INVALID;
 	}
 
+	if (shm->timer_drain != ODP_TIMER_INVALID) {
+		CHECK_ERROR(ofp_timer_cancel(shm->timer_drain), rc);
+		shm->timer_drain = ODP_TIMER_INVALID;
+	}
+
+	shm->wheel_stop = 1;
+	for (i = 0; i < OFP_MAX_NUM_CPU; i++) {
+		struct callout_wheel *w = &shm->wheel[i];
+
+		odp_spinlock_lock(&w->lock);
+		if (w->tick_timer != ODP_TIMER_INVALID) {
+			CHECK_ERROR(ofp_timer_cancel(w->tick_timer), rc);
+			w->tick_timer = ODP_TIMER_INVALID;
+		}
+		w->running = 0;
+		if (w->coarse_timer != ODP_TIMER_INVALID) {
+			CHECK_ERROR(ofp_timer_cancel(w->coarse_timer), rc);
+			w->coarse_timer = ODP_TIMER_INVALID;
+		}
+		w->coarse_running = 0;
+		odp_spinlock_unlock(&w->lock);
+	}
+
 	return rc;
 }
 
@@ -295,6 +422,13 @@ int ofp_timer_term_global(void)
 		}
 	}
 
+	for (bufdata = shm->long_expired; bufdata; bufdata = next) {
+		next = bufdata->next;
+		odp_buffer_free(bufdata->buf);
+	}
+	shm->long_expired = NULL;
+	shm->long_expired_tail = &shm->long_expired;
+
 /* Cleanup timer related ODP objects*/
 	CHECK_ERROR(ofp_timer_term_queues(), rc);
 
@@ -338,6 +472,22 @@ static odp_timer_t ofp_timer_alloc(int cpu_id, struct ofp_timer_internal *buf)
 			shm->queue_per_cpu[cpu_id], buf);
 }
 
+/* Timeouts of the CPU can go to its queue, see tcp_timer_affinity */
+static inline int timer_cpu_polled(int cpu_id)
+{
+	return cpu_id >= 0 && cpu_id < OFP_MAX_NUM_CPU &&
+		global_param->tcp_timer_affinity &&
+		__atomic_load_n(&shm->cpu_polled[cpu_id], __ATOMIC_ACQUIRE);
+}
+
+void ofp_timer_queue_cpu_polled(int cpu_id, int polled)
+{
+	if (!shm || cpu_id < 0 || cpu_id >= OFP_MAX_NUM_CPU)
+		return;
+	__atomic_store_n(&shm->cpu_polled[cpu_id], polled ? 1 : 0,
+			 __ATOMIC_RELEASE);
+}
+
 odp_timer_t ofp_timer_start(uint64_t tmo_us, ofp_timer_callback callback,
 			void *arg, int arglen)
 {
@@ -368,8 +518,9 @@ odp_timer_t ofp_timer_start_cpu_id(uint64_t tmo_us, ofp_timer_callback callback,
 		return ODP_TIMER_INVALID;
 	}
 
-#if !((defined OFP_RSS) || (defined OFP_TCP_MULTICORE_TIMERS))
-	cpu_id = -1;
+#if !(defined OFP_TCP_MULTICORE_TIMERS)
+	if (!OFP_SHARE_NOTHING && !timer_cpu_polled(cpu_id))
+		cpu_id = -1;
 #endif
 
 	bufdata = (struct ofp_timer_internal *)odp_buffer_addr(buf);
@@ -468,6 +619,24 @@ int ofp_timer_cancel(odp_timer_t tim)
 			prev = bufdata;
 			bufdata = next;
 		}
+
+		/* Expired but not yet run */
+		prev = NULL;
+		for (bufdata = shm->long_expired; bufdata;
+		     prev = bufdata, bufdata = bufdata->next) {
+			if (bufdata->id != t)
+				continue;
+			if (prev == NULL)
+				shm->long_expired = bufdata->next;
+			else
+				prev->next = bufdata->next;
+			if (shm->long_expired_tail == &bufdata->next)
+				shm->long_expired_tail = prev ? &prev->next :
+					&shm->long_expired;
+			odp_buffer_free(bufdata->buf);
+			odp_spinlock_unlock(&shm->lock);
+			return 0;
+		}
 		odp_spinlock_unlock(&shm->lock);
 		return -1;
 	}
@@ -499,17 +668,36 @@ int ofp_timer_cancel(odp_timer_t tim)
 
 void ofp_timer_handle(odp_event_t ev)
 {
-	struct ofp_timer_internal *bufdata;
-	odp_timeout_t tmo = odp_timeout_from_event(ev);
-	odp_timer_t tim = odp_timeout_timer(tmo);
+	ofp_timer_handle_multi(&ev, 1);
+}
 
-	bufdata = (struct ofp_timer_internal *)odp_timeout_user_ptr(tmo);
-	fflush(NULL);
-	bufdata->callback(&bufdata->arg);
+void ofp_timer_handle_multi(odp_event_t ev[], int num)
+{
+	struct ofp_timer_internal *bufdata[num];
+	odp_timeout_t tmo[num];
+	int i;
 
-	odp_buffer_free(bufdata->buf);
-	odp_timeout_free(tmo);
-	odp_timer_free(tim);
+	for (i = 0; i < num; i++) {
+		tmo[i] = odp_timeout_from_event(ev[i]);
+		bufdata[i] = odp_timeout_user_ptr(tmo[i]);
+		odp_prefetch(bufdata[i]);
+	}
+
+	/*
+	 * The argument is not prefetched, it is a copy of arglen bytes that
+	 * need not hold a pointer.
+	 */
+	for (i = 0; i < num; i++) {
+		odp_timer_t tim = odp_timeout_timer(tmo[i]);
+
+		OFP_TRACEPOINT(timer_fire, bufdata[i]->callback,
+			       bufdata[i]->arg);
+		bufdata[i]->callback(&bufdata[i]->arg);
+
+		odp_buffer_free(bufdata[i]->buf);
+		odp_timeout_free(tmo[i]);
+		odp_timer_free(tim);
+	}
 }
 
 /*
@@ -560,14 +748,403 @@ odp_timer_pool_t ofp_timer(int timer_num)
 
 odp_queue_t ofp_timer_queue_cpu(int cpu_id)
 {
-#if !((defined OFP_RSS) || (defined OFP_TCP_MULTICORE_TIMERS))
-	cpu_id = -1;
+#if !(defined OFP_TCP_MULTICORE_TIMERS)
+	if (!OFP_SHARE_NOTHING && !global_param->tcp_timer_affinity)
+		cpu_id = -1;
 #endif
 
-	if (!shm || cpu_id > OFP_MAX_NUM_CPU)
+	if (!shm || cpu_id >= OFP_MAX_NUM_CPU)
 		return ODP_QUEUE_INVALID;
 	else if (cpu_id == -1)
 		return shm->queue;
 	else
 		return shm->queue_per_cpu[cpu_id];
 }
+
+/*
+ * Callout wheels
+ *
+ * A callout expiring in less than WHEEL_SLOTS ticks is on level 0 in
+ * the slot of its tick. Later callouts are on the level that covers
+ * their distance, in the slot of the corresponding tick bits, and are
+ * cascaded one level down when the lower level wraps around.
+ */
+
+static void wheel_insert(struct callout_wheel *w, struct callout *c)
+{
+	uint32_t delta = c->c_time - w->now;
+	int level = 0;
+
+	if (delta > WHEEL_MAX_TICKS) {
+		c->c_time = w->now + WHEEL_MAX_TICKS;
+		delta = WHEEL_MAX_TICKS;
+	}
+
+	while (delta >= (1U << (WHEEL_BITS * (level + 1))))
+		level++;
+
+	OFP_LIST_INSERT_HEAD(&w->slot[level][(c->c_time >>
+					      (WHEEL_BITS * level)) &
+					     WHEEL_MASK], c, c_link);
+}
+
+static void wheel_cascade(struct callout_wheel *w, int level)
+{
+	struct callout_list *head;
+	struct callout *c;
+
+	head = &w->slot[level][(w->now >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	while ((c = OFP_LIST_FIRST(head))) {
+		OFP_LIST_REMOVE(c, c_link);
+		wheel_insert(w, c);
+	}
+}
+
+/* Advance the wheel by one tick. Called with the lock held. */
+static void wheel_advance(struct callout_wheel *w)
+{
+	struct callout_list *head;
+	struct callout *c;
+	int level;
+
+	w->now++;
+
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		if ((w->now >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK)
+			break;
+		wheel_cascade(w, level);
+	}
+
+	head = &w->slot[0][w->now & WHEEL_MASK];
+	while ((c = OFP_LIST_FIRST(head))) {
+		OFP_LIST_REMOVE(c, c_link);
+		OFP_LIST_INSERT_HEAD(&w->expired, c, c_link);
+	}
+}
+
+/*
+ * Run at most budget callouts of the expired list, count is the pending
+ * counter of their wheel. Callbacks run unlocked and may re-arm or stop
+ * any callout. Called and returns with the lock held.
+ */
+static int wheel_run(struct callout_wheel *w, struct callout_list *expired,
+		     uint32_t *count, int budget)
+{
+	struct callout *c;
+	int n = 0;
+
+	while (n < budget && (c = OFP_LIST_FIRST(expired))) {
+		ofp_timer_callback func = c->c_func;
+		void *arg = c->c_arg;
+		struct callout *next = OFP_LIST_NEXT(c, c_link);
+
+		OFP_LIST_REMOVE(c, c_link);
+		c->c_flags &= ~CALLOUT_PENDING;
+		(*count)--;
+		if (next)
+			odp_prefetch(next->c_arg);
+
+		odp_spinlock_unlock(&w->lock);
+		OFP_TRACEPOINT(timer_fire, func, arg);
+		func(&arg);
+		odp_spinlock_lock(&w->lock);
+		n++;
+	}
+
+	return n;
+}
+
+static void wheel_tick(void *arg)
+{
+	int cpu = *(int *)arg;
+	struct callout_wheel *w = &shm->wheel[cpu];
+	uint32_t now = ofp_timer_ticks(0);
+	int budget = TIMER_BUDGET;
+
+	odp_spinlock_lock(&w->lock);
+	w->tick_timer = ODP_TIMER_INVALID;
+
+	/* Callouts left over by the previous tick run first */
+	budget -= wheel_run(w, &w->expired, &w->count, budget);
+	while (budget > 0 && w->count && (int32_t)(now - w->now) > 0) {
+		wheel_advance(w);
+		budget -= wheel_run(w, &w->expired, &w->count, budget);
+	}
+
+	/* An empty wheel stops ticking until the next callout is armed */
+	if (w->count && !shm->wheel_stop) {
+		w->tick_local = timer_cpu_polled(cpu);
+		w->tick_timer = ofp_timer_start_cpu_id(OFP_TIMER_RESOLUTION_US,
+						       wheel_tick, &cpu,
+						       sizeof(cpu), cpu);
+	}
+	w->running = (w->tick_timer != ODP_TIMER_INVALID);
+	odp_spinlock_unlock(&w->lock);
+}
+
+/*
+ * Coarse wheel
+ *
+ * A coarse callout is in the slot of its second. The slot is scanned
+ * once per COARSE_SLOTS seconds and only the callouts that are due are
+ * taken, the others wait for a later round.
+ */
+
+static inline uint32_t coarse_secs(void)
+{
+	return (uint32_t)ofp_timer_ticks(0) / HZ;
+}
+
+/* Advance the coarse wheel by one second. Called with the lock held. */
+static void coarse_advance(struct callout_wheel *w)
+{
+	struct callout *c, *next;
+
+	w->coarse_now++;
+
+	for (c = OFP_LIST_FIRST(&w->coarse[w->coarse_now & COARSE_MASK]);
+	     c; c = next) {
+		next = OFP_LIST_NEXT(c, c_link);
+		if ((int32_t)(c->c_time - w->coarse_now) > 0)
+			continue;
+		OFP_LIST_REMOVE(c, c_link);
+		OFP_LIST_INSERT_HEAD(&w->coarse_expired, c, c_link);
+	}
+}
+
+static void coarse_tick(void *arg)
+{
+	int cpu = *(int *)arg;
+	struct callout_wheel *w = &shm->wheel[cpu];
+	uint32_t now = coarse_secs();
+	uint64_t tmo_us = US_PER_SEC;
+	int budget = TIMER_BUDGET;
+
+	odp_spinlock_lock(&w->lock);
+	w->coarse_timer = ODP_TIMER_INVALID;
+
+	budget -= wheel_run(w, &w->coarse_expired, &w->coarse_count, budget);
+	while (budget > 0 && w->coarse_count &&
+	       (int32_t)(now - w->coarse_now) > 0) {
+		coarse_advance(w);
+		budget -= wheel_run(w, &w->coarse_expired, &w->coarse_count,
+				    budget);
+	}
+
+	/* Callouts beyond the budget are run on the following fine ticks */
+	if (OFP_LIST_FIRST(&w->coarse_expired) ||
+	    (int32_t)(now - w->coarse_now) > 0)
+		tmo_us = OFP_TIMER_RESOLUTION_US;
+
+	if (w->coarse_count && !shm->wheel_stop) {
+		w->coarse_local = timer_cpu_polled(cpu);
+		w->coarse_timer = ofp_timer_start_cpu_id(tmo_us, coarse_tick,
+							 &cpu, sizeof(cpu),
+							 cpu);
+	}
+	w->coarse_running = (w->coarse_timer != ODP_TIMER_INVALID);
+	odp_spinlock_unlock(&w->lock);
+}
+
+/*
+ * Re-arm a tick timer of a CPU that is no longer polled, so that it
+ * fires on the shared queue. Returns 1 if the timer has already fired
+ * and its timeout is still on the way to the queue of the CPU.
+ */
+static int wheel_rehome(odp_timer_t *tim, uint8_t *local, uint64_t tmo_us,
+			ofp_timer_callback callback, int cpu)
+{
+	odp_event_t ev = ODP_EVENT_INVALID;
+	odp_timeout_t tmo;
+	struct ofp_timer_internal *bufdata;
+
+	if (*tim == ODP_TIMER_INVALID || !*local)
+		return 0;
+	if (odp_timer_cancel(*tim, &ev) < 0)
+		return 1;
+
+	if (ev != ODP_EVENT_INVALID) {
+		tmo = odp_timeout_from_event(ev);
+		bufdata = odp_timeout_user_ptr(tmo);
+		odp_buffer_free(bufdata->buf);
+		odp_timeout_free(tmo);
+	}
+	if (odp_timer_free(*tim) != ODP_EVENT_INVALID)
+		OFP_ERR("odp_timer_free failed");
+
+	*local = 0;
+	*tim = shm->wheel_stop ? ODP_TIMER_INVALID :
+		ofp_timer_start_cpu_id(tmo_us, callback, &cpu, sizeof(cpu),
+				       cpu);
+	return 0;
+}
+
+int ofp_timer_queue_cpu_release(int cpu_id)
+{
+	struct callout_wheel *w;
+	int busy;
+
+	if (!shm || cpu_id < 0 || cpu_id >= OFP_MAX_NUM_CPU)
+		return 0;
+
+	w = &shm->wheel[cpu_id];
+	odp_spinlock_lock(&w->lock);
+	busy = wheel_rehome(&w->tick_timer, &w->tick_local,
+			    OFP_TIMER_RESOLUTION_US, wheel_tick, cpu_id);
+	busy |= wheel_rehome(&w->coarse_timer, &w->coarse_local,
+			     OFP_TIMER_RESOLUTION_US, coarse_tick, cpu_id);
+	w->running = (w->tick_timer != ODP_TIMER_INVALID);
+	w->coarse_running = (w->coarse_timer != ODP_TIMER_INVALID);
+	odp_spinlock_unlock(&w->lock);
+
+	return busy;
+}
+
+void ofp_callout_init(struct callout *c)
+{
+	c->c_flags = 0;
+	c->c_cpu = 0;
+	c->c_func = NULL;
+	c->c_arg = NULL;
+}
+
+/* Unlink a pending callout. Returns 1 if it was pending. */
+static int callout_unlink(struct callout *c)
+{
+	struct callout_wheel *w;
+	int ret = 0;
+
+	if (!(c->c_flags & CALLOUT_PENDING))
+		return 0;
+
+	w = &shm->wheel[c->c_cpu];
+	odp_spinlock_lock(&w->lock);
+	if (c->c_flags & CALLOUT_PENDING) {
+		OFP_LIST_REMOVE(c, c_link);
+		c->c_flags &= ~CALLOUT_PENDING;
+		if (c->c_flags & CALLOUT_COARSE)
+			w->coarse_count--;
+		else
+			w->count--;
+		ret = 1;
+	}
+	odp_spinlock_unlock(&w->lock);
+
+	return ret;
+}
+
+void ofp_callout_reset(struct callout *c, int to_ticks,
+		       ofp_timer_callback func, void *arg, int cpu)
+{
+	struct callout_wheel *w;
+
+	callout_unlink(c);
+
+	if (cpu < 0)
+		cpu = odp_cpu_id();
+	cpu %= OFP_MAX_NUM_CPU;
+	if (to_ticks <= 0)
+		to_ticks = 1;
+
+	w = &shm->wheel[cpu];
+	odp_spinlock_lock(&w->lock);
+	if (!w->running && !shm->wheel_stop) {
+		if (!w->count)
+			w->now = ofp_timer_ticks(0);
+		w->tick_local = timer_cpu_polled(cpu);
+		w->tick_timer = ofp_timer_start_cpu_id(OFP_TIMER_RESOLUTION_US,
+						       wheel_tick, &cpu,
+						       sizeof(cpu), cpu);
+		w->running = (w->tick_timer != ODP_TIMER_INVALID);
+	}
+	c->c_func = func;
+	c->c_arg = arg;
+	c->c_cpu = cpu;
+	c->c_time = w->now + to_ticks;
+	c->c_flags &= ~CALLOUT_COARSE;
+	c->c_flags |= CALLOUT_PENDING | CALLOUT_ACTIVE;
+	w->count++;
+	wheel_insert(w, c);
+	odp_spinlock_unlock(&w->lock);
+}
+
+void ofp_callout_reset_coarse(struct callout *c, int to_ticks,
+			      ofp_timer_callback func, void *arg, int cpu)
+{
+	struct callout_wheel *w;
+	uint32_t secs;
+
+	callout_unlink(c);
+
+	if (cpu < 0)
+		cpu = odp_cpu_id();
+	cpu %= OFP_MAX_NUM_CPU;
+	secs = to_ticks > 0 ? ((uint32_t)to_ticks + HZ - 1) / HZ : 1;
+
+	w = &shm->wheel[cpu];
+	odp_spinlock_lock(&w->lock);
+	if (!w->coarse_running && !shm->wheel_stop) {
+		if (!w->coarse_count)
+			w->coarse_now = coarse_secs();
+		w->coarse_local = timer_cpu_polled(cpu);
+		w->coarse_timer = ofp_timer_start_cpu_id(US_PER_SEC,
+							 coarse_tick, &cpu,
+							 sizeof(cpu), cpu);
+		w->coarse_running = (w->coarse_timer != ODP_TIMER_INVALID);
+	}
+	c->c_func = func;
+	c->c_arg = arg;
+	c->c_cpu = cpu;
+	c->c_time = w->coarse_now + secs;
+	c->c_flags |= CALLOUT_PENDING | CALLOUT_ACTIVE | CALLOUT_COARSE;
+	w->coarse_count++;
+	OFP_LIST_INSERT_HEAD(&w->coarse[c->c_time & COARSE_MASK], c, c_link);
+	odp_spinlock_unlock(&w->lock);
+}
+
+int ofp_callout_stop(struct callout *c)
+{
+	int ret = callout_unlink(c);
+
+	c->c_flags &= ~CALLOUT_ACTIVE;
+
+	return ret;
+}
+
+/*
+ * Timers embedded in objects are callouts
+ */
+
+ODP_STATIC_ASSERT(sizeof(struct callout) <= sizeof(struct ofp_timer_entry),
+		  "struct ofp_timer_entry too small");
+
+void ofp_timer_entry_init(struct ofp_timer_entry *t)
+{
+	ofp_callout_init((struct callout *)t);
+}
+
+void ofp_timer_entry_start(struct ofp_timer_entry *t, uint64_t tmo_us,
+			   ofp_timer_callback callback, void *arg, int cpu_id)
+{
+	uint64_t to_ticks = (tmo_us + OFP_TIMER_RESOLUTION_US - 1) /
+		OFP_TIMER_RESOLUTION_US;
+
+	if (to_ticks > INT32_MAX)
+		to_ticks = INT32_MAX;
+	if (tmo_us >= OFP_TIMER_MAX_US)
+		ofp_callout_reset_coarse((struct callout *)t, to_ticks,
+					 callback, arg, cpu_id);
+	else
+		ofp_callout_reset((struct callout *)t, to_ticks, callback,
+				  arg, cpu_id);
+}
+
+int ofp_timer_entry_stop(struct ofp_timer_entry *t)
+{
+	return ofp_callout_stop((struct callout *)t);
+}
+
+int ofp_timer_entry_pending(const struct ofp_timer_entry *t)
+{
+	return callout_pending((const struct callout *)t) != 0;
+}
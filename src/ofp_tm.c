@@ -0,0 +1,519 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi.h"
+#include "ofpi_tm.h"
+#include "ofpi_portconf.h"
+#include "ofpi_init.h"
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_shared_mem.h"
+
+#include "api/ofp_ifnet.h"
+#include "api/ofp_if_vlan.h"
+
+#define SHM_NAME_TM "OfpTmShMem"
+
+/* Bytes on the wire beyond a frame: preamble, FCS and interframe gap */
+#define TM_WIRE_OVERHEAD 24
+
+#define TM_DSCP_NUM 64
+
+/*
+ * Shared data
+ */
+struct tm_tenant {
+	odp_tm_node_t node;
+	odp_tm_shaper_t shaper;
+	odp_tm_queue_t queue[OFP_TM_CLASSES];
+};
+
+struct tm_port {
+	odp_tm_t tm;
+	odp_tm_node_t root;
+	odp_tm_shaper_t shaper;
+	odp_tm_sched_t sched[OFP_TM_CLASSES];
+	struct tm_tenant tenant[OFP_TM_TENANTS];
+	/* Read by the senders without the lock */
+	uint8_t vlan_tenant[OFP_EVL_VLID_MASK + 1];
+	uint8_t dscp_class[TM_DSCP_NUM];
+};
+
+struct ofp_tm_mem {
+	odp_spinlock_t lock;
+	struct tm_port port[];	/* FP_PORTS */
+};
+
+#define SHM_SIZE_TM (sizeof(struct ofp_tm_mem) + \
+		     FP_PORTS * sizeof(struct tm_port))
+
+/*
+ * Data per thread
+ */
+static __thread struct ofp_tm_mem *shm;
+
+/* The queue of the tenant of the VLAN and the class of the DSCP */
+static inline odp_tm_queue_t tm_queue(struct tm_port *tp, odp_packet_t pkt)
+{
+	uint8_t *p = odp_packet_data(pkt);
+	uint32_t len = odp_packet_seg_len(pkt);
+	uint32_t off = sizeof(struct ofp_ether_header);
+	uint16_t type, vlan = 0;
+	uint8_t tos = 0, tenant;
+
+	if (odp_unlikely(len < off))
+		return tp->tenant[0].queue[0];
+
+	type = odp_be_to_cpu_16(((struct ofp_ether_header *)p)->ether_type);
+	if (type == OFP_ETHERTYPE_VLAN &&
+	    len >= sizeof(struct ofp_ether_vlan_header)) {
+		struct ofp_ether_vlan_header *evl =
+			(struct ofp_ether_vlan_header *)p;
+
+		vlan = OFP_EVL_VLANOFTAG(odp_be_to_cpu_16(evl->evl_tag));
+		type = odp_be_to_cpu_16(evl->evl_proto);
+		off = sizeof(*evl);
+	}
+
+	if (len >= off + 2) {
+		if (type == OFP_ETHERTYPE_IP)
+			tos = p[off + 1];
+		else if (type == OFP_ETHERTYPE_IPV6)
+			tos = (p[off] << 4) | (p[off + 1] >> 4);
+	}
+
+	tenant = __atomic_load_n(&tp->vlan_tenant[vlan], __ATOMIC_RELAXED);
+	return tp->tenant[tenant].queue[tp->dscp_class[tos >> 2]];
+}
+
+int ofp_tm_send_multi(struct ofp_ifnet *ifnet, odp_packet_t pkt[], int num)
+{
+	struct tm_port *tp = &shm->port[ifnet->port];
+	int i;
+
+	for (i = 0; i < num; i++)
+		if (odp_tm_enq(tm_queue(tp, pkt[i]), pkt[i]))
+			break;
+	return i;
+}
+
+/* Create or update a shaper. Rate 0 leaves the shaper as it is. */
+static int tm_shaper_set(const char *name, odp_tm_shaper_t *shaper,
+			 uint64_t rate_kbps, uint32_t burst)
+{
+	odp_tm_shaper_params_t param;
+
+	if (!rate_kbps)
+		return 0;
+
+	odp_tm_shaper_params_init(&param);
+	param.commit_rate = rate_kbps * 1000;
+	param.commit_burst = burst * 8;
+	param.shaper_len_adjust = TM_WIRE_OVERHEAD;
+
+	if (*shaper != ODP_TM_INVALID)
+		return odp_tm_shaper_params_update(*shaper, &param);
+
+	*shaper = odp_tm_shaper_create(name, &param);
+	return *shaper == ODP_TM_INVALID ? -1 : 0;
+}
+
+static int tm_tenant_create(struct tm_port *tp, int port, int id)
+{
+	struct tm_tenant *t = &tp->tenant[id];
+	odp_tm_node_params_t node_param;
+	odp_tm_queue_params_t queue_param;
+	char name[32];
+	int c;
+
+	snprintf(name, sizeof(name), "ofp_tm%d_%d", port, id);
+	odp_tm_node_params_init(&node_param);
+	node_param.max_fanin = OFP_TM_CLASSES;
+	node_param.level = 1;
+	t->node = odp_tm_node_create(tp->tm, name, &node_param);
+	if (t->node == ODP_TM_INVALID || odp_tm_node_connect(t->node, tp->root))
+		return -1;
+
+	for (c = 0; c < OFP_TM_CLASSES; c++) {
+		odp_tm_queue_params_init(&queue_param);
+		/* Priority 0 is served first */
+		if (global_param->tm.wfq)
+			queue_param.sched_profile = tp->sched[c];
+		else
+			queue_param.priority = OFP_TM_CLASSES - 1 - c;
+		t->queue[c] = odp_tm_queue_create(tp->tm, &queue_param);
+		if (t->queue[c] == ODP_TM_INVALID ||
+		    odp_tm_queue_connect(t->queue[c], t->node))
+			return -1;
+	}
+	return 0;
+}
+
+static int tm_sched_create(struct tm_port *tp, int port)
+{
+	odp_tm_sched_params_t param;
+	char name[32];
+	int c, i;
+
+	for (c = 0; c < OFP_TM_CLASSES; c++) {
+		odp_tm_sched_params_init(&param);
+		for (i = 0; i < ODP_TM_MAX_PRIORITIES; i++) {
+			param.sched_modes[i] = ODP_TM_BYTE_BASED_WEIGHTS;
+			param.sched_weights[i] = 1u << c;
+		}
+		snprintf(name, sizeof(name), "ofp_tm%d_c%d", port, c);
+		tp->sched[c] = odp_tm_sched_create(name, &param);
+		if (tp->sched[c] == ODP_TM_INVALID)
+			return -1;
+	}
+	return 0;
+}
+
+int ofp_tm_ifnet_create(struct ofp_ifnet *ifnet)
+{
+	struct tm_port *tp = &shm->port[ifnet->port];
+	odp_tm_requirements_t req;
+	odp_tm_egress_t egress;
+	odp_tm_node_params_t node_param;
+	char name[32];
+	int i;
+
+	if (!PHYS_PORT(ifnet->port)) {
+		OFP_ERR("No traffic manager on %s", ifnet->if_name);
+		return -1;
+	}
+
+	odp_tm_requirements_init(&req);
+	req.max_tm_queues = OFP_TM_TENANTS * OFP_TM_CLASSES;
+	req.num_levels = 2;
+	req.tm_queue_shaper_needed = 0;
+	req.per_level[0].max_num_tm_nodes = 1;
+	req.per_level[0].max_fanin_per_node = OFP_TM_TENANTS;
+	req.per_level[0].tm_node_shaper_needed = 1;
+	req.per_level[1].max_num_tm_nodes = OFP_TM_TENANTS;
+	req.per_level[1].max_fanin_per_node = OFP_TM_CLASSES;
+	req.per_level[1].max_priority = OFP_TM_CLASSES - 1;
+	req.per_level[1].tm_node_shaper_needed = 1;
+	req.per_level[1].fair_queuing_needed = global_param->tm.wfq;
+	req.per_level[1].weights_needed = global_param->tm.wfq;
+
+	odp_tm_egress_init(&egress);
+	egress.egress_kind = ODP_TM_EGRESS_PKT_IO;
+	egress.pktio = ifnet->pktio;
+
+	snprintf(name, sizeof(name), "ofp_tm%d", ifnet->port);
+	tp->tm = odp_tm_create(name, &req, &egress);
+	if (tp->tm == ODP_TM_INVALID) {
+		OFP_ERR("Failed to create traffic manager for %s",
+			ifnet->if_name);
+		return -1;
+	}
+
+	if (tm_shaper_set(name, &tp->shaper, global_param->tm.rate_kbps,
+			  global_param->tm.burst))
+		goto err;
+
+	odp_tm_node_params_init(&node_param);
+	node_param.max_fanin = OFP_TM_TENANTS;
+	node_param.shaper_profile = tp->shaper;
+	node_param.level = 0;
+	tp->root = odp_tm_node_create(tp->tm, name, &node_param);
+	if (tp->root == ODP_TM_INVALID ||
+	    odp_tm_node_connect(tp->root, ODP_TM_ROOT))
+		goto err;
+
+	if (global_param->tm.wfq && tm_sched_create(tp, ifnet->port))
+		goto err;
+
+	/* All tenants up front, the topology does not change once started */
+	for (i = 0; i < OFP_TM_TENANTS; i++)
+		if (tm_tenant_create(tp, ifnet->port, i))
+			goto err;
+
+	memset(tp->vlan_tenant, 0, sizeof(tp->vlan_tenant));
+	for (i = 0; i < TM_DSCP_NUM; i++)
+		tp->dscp_class[i] = (i >> 3) * OFP_TM_CLASSES / 8;
+
+	return 0;
+
+err:
+	OFP_ERR("Failed to configure traffic manager for %s", ifnet->if_name);
+	ofp_tm_ifnet_term(ifnet);
+	return -1;
+}
+
+int ofp_tm_ifnet_start(struct ofp_ifnet *ifnet)
+{
+	if (odp_tm_start(shm->port[ifnet->port].tm)) {
+		OFP_ERR("Failed to start traffic manager for %s",
+			ifnet->if_name);
+		return -1;
+	}
+	return 0;
+}
+
+static void tm_port_init(struct tm_port *tp)
+{
+	int i, c;
+
+	tp->tm = ODP_TM_INVALID;
+	tp->root = ODP_TM_INVALID;
+	tp->shaper = ODP_TM_INVALID;
+	for (c = 0; c < OFP_TM_CLASSES; c++)
+		tp->sched[c] = ODP_TM_INVALID;
+	for (i = 0; i < OFP_TM_TENANTS; i++) {
+		tp->tenant[i].node = ODP_TM_INVALID;
+		tp->tenant[i].shaper = ODP_TM_INVALID;
+		for (c = 0; c < OFP_TM_CLASSES; c++)
+			tp->tenant[i].queue[c] = ODP_TM_INVALID;
+	}
+}
+
+int ofp_tm_ifnet_term(struct ofp_ifnet *ifnet)
+{
+	struct tm_port *tp;
+	int rc = 0, i, c;
+
+	if (!PHYS_PORT(ifnet->port))
+		return 0;
+	tp = &shm->port[ifnet->port];
+	if (tp->tm == ODP_TM_INVALID)
+		return 0;
+
+	CHECK_ERROR(odp_tm_stop(tp->tm), rc);
+
+	for (i = 0; i < OFP_TM_TENANTS; i++) {
+		struct tm_tenant *t = &tp->tenant[i];
+
+		for (c = 0; c < OFP_TM_CLASSES; c++) {
+			if (t->queue[c] == ODP_TM_INVALID)
+				continue;
+			odp_tm_queue_disconnect(t->queue[c]);
+			CHECK_ERROR(odp_tm_queue_destroy(t->queue[c]), rc);
+		}
+		if (t->node != ODP_TM_INVALID) {
+			odp_tm_node_disconnect(t->node);
+			CHECK_ERROR(odp_tm_node_destroy(t->node), rc);
+		}
+		if (t->shaper != ODP_TM_INVALID)
+			CHECK_ERROR(odp_tm_shaper_destroy(t->shaper), rc);
+	}
+	if (tp->root != ODP_TM_INVALID) {
+		odp_tm_node_disconnect(tp->root);
+		CHECK_ERROR(odp_tm_node_destroy(tp->root), rc);
+	}
+	if (tp->shaper != ODP_TM_INVALID)
+		CHECK_ERROR(odp_tm_shaper_destroy(tp->shaper), rc);
+	for (c = 0; c < OFP_TM_CLASSES; c++)
+		if (tp->sched[c] != ODP_TM_INVALID)
+			CHECK_ERROR(odp_tm_sched_destroy(tp->sched[c]), rc);
+	CHECK_ERROR(odp_tm_destroy(tp->tm), rc);
+
+	tm_port_init(tp);
+	return rc;
+}
+
+/* TM state of a port, or NULL. Called with the lock held. */
+static struct tm_port *tm_port_get(int port)
+{
+	if (port < 0 || !PHYS_PORT(port) ||
+	    shm->port[port].tm == ODP_TM_INVALID) {
+		OFP_ERR("No traffic manager on port %d", port);
+		return NULL;
+	}
+	return &shm->port[port];
+}
+
+static int tm_tenant_check(int tenant)
+{
+	if (tenant < 0 || tenant >= OFP_TM_TENANTS) {
+		OFP_ERR("Invalid tenant: %d", tenant);
+		return -1;
+	}
+	return 0;
+}
+
+int ofp_tm_tenant_shaper_set(int port, int tenant, uint64_t rate_kbps,
+			     uint32_t burst)
+{
+	struct tm_port *tp;
+	struct tm_tenant *t;
+	char name[32];
+	int ret = -1;
+
+	if (tm_tenant_check(tenant))
+		return -1;
+
+	odp_spinlock_lock(&shm->lock);
+	tp = tm_port_get(port);
+	if (!tp)
+		goto out;
+	t = &tp->tenant[tenant];
+
+	snprintf(name, sizeof(name), "ofp_tm%d_%d", port, tenant);
+	if (!rate_kbps)
+		ret = odp_tm_node_shaper_config(t->node, ODP_TM_INVALID);
+	else
+		ret = tm_shaper_set(name, &t->shaper, rate_kbps, burst) ||
+			odp_tm_node_shaper_config(t->node, t->shaper);
+	if (ret)
+		OFP_ERR("Failed to set the shaper of tenant %d on port %d",
+			tenant, port);
+out:
+	odp_spinlock_unlock(&shm->lock);
+	return ret ? -1 : 0;
+}
+
+int ofp_tm_vlan_tenant_set(int port, uint16_t vlan, int tenant)
+{
+	struct tm_port *tp;
+
+	if (tm_tenant_check(tenant))
+		return -1;
+	if (vlan > OFP_EVL_VLID_MASK) {
+		OFP_ERR("Invalid VLAN: %u", vlan);
+		return -1;
+	}
+
+	odp_spinlock_lock(&shm->lock);
+	tp = tm_port_get(port);
+	if (tp)
+		__atomic_store_n(&tp->vlan_tenant[vlan], tenant,
+				 __ATOMIC_RELAXED);
+	odp_spinlock_unlock(&shm->lock);
+
+	return tp ? 0 : -1;
+}
+
+struct tm_vrf_arg {
+	struct tm_port *tp;
+	uint16_t port;
+	uint16_t vrf;
+	uint8_t tenant;
+	int num;
+};
+
+static int tm_vrf_ifnet(void *key, void *iter_arg)
+{
+	struct ofp_ifnet *ifnet = key;
+	struct tm_vrf_arg *arg = iter_arg;
+
+	if (ifnet->port != arg->port || ifnet->vrf != arg->vrf ||
+	    ifnet->if_state != OFP_IFT_STATE_USED)
+		return 0;
+
+	__atomic_store_n(&arg->tp->vlan_tenant[ifnet->vlan & OFP_EVL_VLID_MASK],
+			 arg->tenant, __ATOMIC_RELAXED);
+	arg->num++;
+	return 0;
+}
+
+int ofp_tm_vrf_tenant_set(int port, uint16_t vrf, int tenant)
+{
+	struct tm_vrf_arg arg;
+
+	if (tm_tenant_check(tenant))
+		return -1;
+
+	odp_spinlock_lock(&shm->lock);
+	arg.tp = tm_port_get(port);
+	if (arg.tp) {
+		arg.port = port;
+		arg.vrf = vrf;
+		arg.tenant = tenant;
+		arg.num = 0;
+		ofp_ifnet_iterate(tm_vrf_ifnet, &arg);
+	}
+	odp_spinlock_unlock(&shm->lock);
+
+	return arg.tp ? arg.num : -1;
+}
+
+int ofp_tm_dscp_class_set(int port, uint8_t dscp, int cls)
+{
+	struct tm_port *tp;
+
+	if (dscp >= TM_DSCP_NUM || cls < 0 || cls >= OFP_TM_CLASSES) {
+		OFP_ERR("Invalid DSCP %u or class %d", dscp, cls);
+		return -1;
+	}
+
+	odp_spinlock_lock(&shm->lock);
+	tp = tm_port_get(port);
+	if (tp)
+		__atomic_store_n(&tp->dscp_class[dscp], cls, __ATOMIC_RELAXED);
+	odp_spinlock_unlock(&shm->lock);
+
+	return tp ? 0 : -1;
+}
+
+static int ofp_tm_alloc_shared_memory(void)
+{
+	shm = ofp_shared_memory_alloc(SHM_NAME_TM, SHM_SIZE_TM);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_alloc failed");
+		return -1;
+	}
+	return 0;
+}
+
+static int ofp_tm_free_shared_memory(void)
+{
+	int rc = 0;
+
+	if (ofp_shared_memory_free(SHM_NAME_TM) == -1) {
+		OFP_ERR("ofp_shared_memory_free failed");
+		rc = -1;
+	}
+	shm = NULL;
+	return rc;
+}
+
+int ofp_tm_lookup_shared_memory(void)
+{
+	shm = ofp_shared_memory_lookup(SHM_NAME_TM);
+	if (shm == NULL) {
+		OFP_ERR("ofp_shared_memory_lookup failed");
+		return -1;
+	}
+	return 0;
+}
+
+void ofp_tm_init_prepare(void)
+{
+	ofp_shared_memory_prealloc(SHM_NAME_TM, SHM_SIZE_TM);
+}
+
+int ofp_tm_init_global(void)
+{
+	int i;
+
+	HANDLE_ERROR(ofp_tm_alloc_shared_memory());
+
+	memset(shm, 0, SHM_SIZE_TM);
+	for (i = 0; i < FP_PORTS; i++)
+		tm_port_init(&shm->port[i]);
+	odp_spinlock_init(&shm->lock);
+
+	return 0;
+}
+
+int ofp_tm_term_global(void)
+{
+	int rc = 0;
+
+	if (ofp_tm_lookup_shared_memory())
+		return -1;
+
+	CHECK_ERROR(ofp_tm_free_shared_memory(), rc);
+
+	return rc;
+}
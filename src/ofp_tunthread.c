@@ -10,6 +10,9 @@
 #include <sys/ioctl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <net/if.h>
 #include <linux/if_tun.h>
 #include <errno.h>
@@ -19,11 +22,17 @@
 #include "ofpi_if_vlan.h"
 #include "ofpi_debug.h"
 #include "ofpi_pkt_processing.h"
+#include "ofpi_lag.h"
 #include "ofpi_init.h"
 #include "ofpi_stat.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
 
+/* Packets moved between the queues or the tap and OFP at a time */
+#define SP_BURST 32
+/* ms between is_running checks of a waiting thread */
+#define SP_POLL_TMO 100
+
 static int tap_alloc(char *dev, int flags) {
 
 	struct ifreq ifr;
@@ -80,10 +89,57 @@ static int tap_alloc(char *dev, int flags) {
 	return fd;
 }
 
-/* Return the fd of the tap */
+/*
+ * Open the ODP packet I/O device of the slow path. The Linux end is
+ * configured like a tap.
+ */
+static int sp_pktio_open(struct ofp_ifnet *ifnet)
+{
+	odp_pktio_param_t param;
+	odp_pktin_queue_param_t in_param;
+	odp_pktout_queue_param_t out_param;
+	char name[64];
+
+	snprintf(name, sizeof(name), "%s%d", global_param->slow_path.pktio,
+		 ifnet->port);
+
+	odp_pktio_param_init(&param);
+	param.in_mode = ODP_PKTIN_MODE_DIRECT;
+	param.out_mode = ODP_PKTOUT_MODE_DIRECT;
+
+	ifnet->sp_pktio = odp_pktio_open(name, ifnet->pkt_pool, &param);
+	if (ifnet->sp_pktio == ODP_PKTIO_INVALID) {
+		OFP_ERR("Failed to open slow path pktio %s", name);
+		return -1;
+	}
+
+	/* Each direction is served by one thread */
+	odp_pktin_queue_param_init(&in_param);
+	in_param.op_mode = ODP_PKTIO_OP_MT_UNSAFE;
+	in_param.num_queues = 1;
+	odp_pktout_queue_param_init(&out_param);
+	out_param.op_mode = ODP_PKTIO_OP_MT_UNSAFE;
+	out_param.num_queues = 1;
+
+	if (odp_pktin_queue_config(ifnet->sp_pktio, &in_param) ||
+	    odp_pktout_queue_config(ifnet->sp_pktio, &out_param) ||
+	    odp_pktin_queue(ifnet->sp_pktio, &ifnet->sp_pktin, 1) != 1 ||
+	    odp_pktout_queue(ifnet->sp_pktio, &ifnet->sp_pktout, 1) != 1 ||
+	    odp_pktio_start(ifnet->sp_pktio)) {
+		OFP_ERR("Failed to configure slow path pktio %s", name);
+		odp_pktio_close(ifnet->sp_pktio);
+		ifnet->sp_pktio = ODP_PKTIO_INVALID;
+		return -1;
+	}
+
+	OFP_DBG("Slow path pktio %s", name);
+	return 0;
+}
+
+/* Create the tap or open the pktio, and configure the Linux interface */
 int sp_setup_device(struct ofp_ifnet *ifnet)
 {
-	int fd;
+	int fd = -1;
 	struct ifreq ifr;
 	int gen_fd;
 	char fp_name[IFNAMSIZ];
@@ -92,14 +148,34 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 	memset(&hwaddr, 0x0, sizeof(hwaddr));
 
 	/* Prepare FP device name*/
-	snprintf(fp_name, IFNAMSIZ, "fp%d", ifnet->port);
+	snprintf(fp_name, IFNAMSIZ, "%s%d", global_param->slow_path.linux_if,
+		 ifnet->port);
 	fp_name[IFNAMSIZ - 1] = 0;
 
-	/* Create device */
-	fd = tap_alloc(fp_name, IFF_TAP  | IFF_NO_PI);
-	if (fd < 0) {
-		OFP_ERR("tap_alloc failed");
-		return -1;
+	if (global_param->slow_path.pktio) {
+		if (sp_pktio_open(ifnet))
+			return -1;
+	} else {
+		/* Create device */
+		fd = tap_alloc(fp_name, IFF_TAP  | IFF_NO_PI);
+		if (fd < 0) {
+			OFP_ERR("tap_alloc failed");
+			return -1;
+		}
+
+		/* The TX thread reads until the tap is empty */
+		if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+			OFP_ERR("Failed to set O_NONBLOCK: %s",
+				strerror(errno));
+			close(fd);
+			return -1;
+		}
+	}
+
+	gen_fd = socket(PF_INET, SOCK_DGRAM, 0);
+	if (gen_fd < 0) {
+		OFP_ERR("socket failed: %s", strerror(errno));
+		goto err_dev;
 	}
 
 	hwaddr.sa_family = AF_UNIX;
@@ -115,14 +191,11 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 		  fp_name, ofp_print_mac((uint8_t *)ifr.ifr_hwaddr.sa_data));
 
 	/* Setting HW address of FP kernel representation */
-	if (ioctl(fd, SIOCSIFHWADDR, &ifr) < 0) {
+	if (ioctl(gen_fd, SIOCSIFHWADDR, &ifr) < 0) {
 		OFP_ERR("Failed to set MAC address: %s", strerror(errno));
-		close(fd);
-		return -1;
+		goto err;
 	}
 
-	gen_fd = socket(PF_INET, SOCK_DGRAM, 0);
-
 	/* Setting MTU of FP kernel representation */
 	memset(&ifr, 0x0, sizeof(ifr));
 	strncpy(ifr.ifr_name, fp_name, IFNAMSIZ);
@@ -132,9 +205,7 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 
 	if (ioctl(gen_fd, SIOCSIFMTU, &ifr) < 0) {
 		OFP_ERR("Failed to set MTU: %s", strerror(errno));
-		close(gen_fd);
-		close(fd);
-		return -1;
+		goto err;
 	}
 
 	/* Get flags */
@@ -143,9 +214,7 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 	ifr.ifr_name[IFNAMSIZ - 1] = 0;
 	if (ioctl(gen_fd, SIOCGIFFLAGS, &ifr) < 0) {
 		OFP_ERR("Failed to get interface flags: %s", strerror(errno));
-		close(gen_fd);
-		close(fd);
-		return -1;
+		goto err;
 	}
 
 	/* Set flags - ifconfig up*/
@@ -155,9 +224,7 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 		if (ioctl(gen_fd, SIOCSIFFLAGS, &ifr) < 0) {
 			OFP_ERR("Failed to set interface flags: %s",
 					strerror(errno));
-			close(gen_fd);
-			close(fd);
-			return -1;
+			goto err;
 		}
 	}
 
@@ -167,10 +234,15 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 	ifr.ifr_name[IFNAMSIZ - 1] = 0;
 	if (ioctl(gen_fd, SIOCGIFINDEX, &ifr) < 0) {
 		OFP_ERR("Failed to get interface index: %s", strerror(errno));
-		close(gen_fd);
-		close(fd);
-		return -1;
+		goto err;
+	}
+
+	ifnet->sp_evfd = eventfd(0, EFD_NONBLOCK);
+	if (ifnet->sp_evfd < 0) {
+		OFP_ERR("eventfd failed: %s", strerror(errno));
+		goto err;
 	}
+	odp_atomic_init_u32(&ifnet->sp_rx_wait, 0);
 
 	/* Store ifindex in viu and create table */
 	ifnet->linux_index = ifr.ifr_ifindex;
@@ -179,6 +251,106 @@ int sp_setup_device(struct ofp_ifnet *ifnet)
 
 	close(gen_fd);
 	return 0;
+
+err:
+	close(gen_fd);
+err_dev:
+	if (fd >= 0)
+		close(fd);
+	if (ifnet->sp_pktio != ODP_PKTIO_INVALID) {
+		odp_pktio_stop(ifnet->sp_pktio);
+		odp_pktio_close(ifnet->sp_pktio);
+		ifnet->sp_pktio = ODP_PKTIO_INVALID;
+	}
+	return -1;
+}
+
+/*
+ * Called after a packet is put to a slow path queue. The RX thread sets
+ * sp_rx_wait before it checks the queue a last time, so either it
+ * sees the packet or we see the flag.
+ */
+void sp_rx_wakeup(struct ofp_ifnet *ifnet)
+{
+	uint64_t one = 1;
+
+	odp_mb_full();
+	if (odp_atomic_load_u32(&ifnet->sp_rx_wait) &&
+	    write(ifnet->sp_evfd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		OFP_DBG("eventfd write failed: %s", strerror(errno));
+}
+
+/* Fill the burst from the queues in priority order */
+static int sp_rx_deq_prio(struct ofp_ifnet *ifnet, odp_event_t ev[])
+{
+	int i, r, num = 0;
+
+	for (i = 0; i < OFP_SP_CLASS_MAX && num < SP_BURST; i++) {
+		r = odp_queue_deq_multi(ifnet->spq[i], &ev[num],
+					SP_BURST - num);
+		if (r > 0)
+			num += r;
+	}
+	return num;
+}
+
+static int sp_rx_deq(struct ofp_ifnet *ifnet, odp_event_t ev[])
+{
+	struct pollfd pfd;
+	uint64_t cnt;
+	int num;
+
+	num = sp_rx_deq_prio(ifnet, ev);
+	if (num > 0)
+		return num;
+
+	odp_atomic_store_u32(&ifnet->sp_rx_wait, 1);
+	odp_mb_full();
+	num = sp_rx_deq_prio(ifnet, ev);
+	if (num <= 0) {
+		pfd.fd = ifnet->sp_evfd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, SP_POLL_TMO) > 0 &&
+		    read(ifnet->sp_evfd, &cnt, sizeof(cnt)) < 0)
+			OFP_DBG("eventfd read failed: %s", strerror(errno));
+	}
+	odp_atomic_store_u32(&ifnet->sp_rx_wait, 0);
+
+	return num;
+}
+
+/* A frame per write, segments gathered with writev */
+static int sp_tap_write(struct ofp_ifnet *ifnet, odp_packet_t pkt)
+{
+	int num = odp_packet_num_segs(pkt);
+	struct iovec iov[num];
+	odp_packet_seg_t seg;
+	int n;
+
+	if (num == 1)
+		return write(ifnet->fd, odp_packet_data(pkt),
+			     odp_packet_len(pkt));
+
+	seg = odp_packet_first_seg(pkt);
+	for (n = 0; n < num; n++) {
+		iov[n].iov_base = odp_packet_seg_data(pkt, seg);
+		iov[n].iov_len = odp_packet_seg_data_len(pkt, seg);
+		seg = odp_packet_next_seg(pkt, seg);
+	}
+	return writev(ifnet->fd, iov, num);
+}
+
+static void sp_pktio_send(struct ofp_ifnet *ifnet, odp_packet_t pkt[],
+			  int num)
+{
+	int sent = odp_pktout_send(ifnet->sp_pktout, pkt, num);
+
+	if (sent < 0)
+		sent = 0;
+	if (sent < num) {
+		OFP_UPDATE_PACKET_STAT(drop[OFP_DROP_SP_SEND], num - sent);
+		odp_packet_free_multi(&pkt[sent], num - sent);
+	}
 }
 
 int sp_rx_thread(void *ifnet_void)
@@ -189,12 +361,11 @@ int sp_rx_thread(void *ifnet_void)
 	struct ofp_ether_vlan_header *vlan_hdr;
 	uint16_t vlan = 0;
 	odp_packet_t pkt;
-	odp_event_t ev;
-	int len;
+	odp_event_t ev[SP_BURST];
+	odp_packet_t out[SP_BURST];
+	int i, num, num_out;
 	struct ofp_global_config_mem *ofp_global_cfg;
 
-	(void) len;
-
 	if (ofp_init_local()) {
 		OFP_ERR("Error: OFP local init failed.");
 		return -1;
@@ -208,45 +379,56 @@ int sp_rx_thread(void *ifnet_void)
 	}
 
 	while (ofp_global_cfg->is_running) {
-		ev = odp_queue_deq(ifnet->spq_def);
+		num = sp_rx_deq(ifnet, ev);
+		num_out = 0;
 
-		if (ev == ODP_EVENT_INVALID ||
-		    odp_event_type(ev) != ODP_EVENT_PACKET) {
-			/* FIXME: Blocking queue popping in ODP ? */
-			usleep(2000);
-			continue;
-		}
-		pkt = odp_packet_from_event(ev);
+		for (i = 0; i < num; i++) {
+			if (odp_event_type(ev[i]) != ODP_EVENT_PACKET) {
+				odp_event_free(ev[i]);
+				continue;
+			}
+			pkt = odp_packet_from_event(ev[i]);
 
-		if (ifnet->sp_status != OFP_SP_UP) {
-			odp_packet_free(pkt);
-			continue;
-		}
+			if (ifnet->sp_status != OFP_SP_UP) {
+				odp_packet_free(pkt);
+				continue;
+			}
 
-		eth = odp_packet_l2_ptr(pkt, NULL);
-		if (odp_be_to_cpu_16(eth->ether_type) == OFP_ETHERTYPE_VLAN) {
-			vlan_hdr = (struct ofp_ether_vlan_header *)eth;
-			vlan = OFP_EVL_VLANOFTAG(vlan_hdr->evl_tag);
-		} else {
-			vlan = 0;
-		}
+			eth = odp_packet_l2_ptr(pkt, NULL);
+			if (odp_be_to_cpu_16(eth->ether_type) ==
+			    OFP_ETHERTYPE_VLAN) {
+				vlan_hdr = (struct ofp_ether_vlan_header *)eth;
+				vlan = OFP_EVL_VLANOFTAG(vlan_hdr->evl_tag);
+			} else {
+				vlan = 0;
+			}
 
-		pkt_ifnet = ofp_get_ifnet(ifnet->port, vlan);
-		if (pkt_ifnet == NULL ||
-		    pkt_ifnet->sp_status != OFP_SP_UP){
-			odp_packet_free(pkt);
-			continue;
-		}
+			pkt_ifnet = ofp_get_ifnet(ifnet->port, vlan);
+			if (pkt_ifnet == NULL ||
+			    pkt_ifnet->sp_status != OFP_SP_UP){
+				odp_packet_free(pkt);
+				continue;
+			}
 
-		OFP_DEBUG_PACKET(OFP_DEBUG_PKT_RECV_KNI, pkt, ifnet->port);
+			OFP_DEBUG_PACKET(OFP_DEBUG_PKT_RECV_KNI, pkt,
+					 ifnet->port);
 
-		OFP_UPDATE_PACKET_STAT(rx_sp, 1);
+			OFP_UPDATE_PACKET_STAT(rx_sp, 1);
 
-		len = write(ifnet->fd,
-			    (void *)odp_packet_l2_ptr(pkt, NULL),
-			    (size_t)odp_packet_len(pkt));
+			if (ifnet->sp_pktio != ODP_PKTIO_INVALID) {
+				out[num_out++] = pkt;
+				continue;
+			}
+
+			/* A full tap queue drops rather than stalls */
+			if (sp_tap_write(ifnet, pkt) < 0)
+				OFP_DROP_STAT(SP_SEND);
+
+			odp_packet_free(pkt);
+		}
 
-		odp_packet_free(pkt);
+		if (num_out)
+			sp_pktio_send(ifnet, out, num_out);
 	}
 
 	OFP_DBG("SP RX thread of %s exiting", ifnet->if_name);
@@ -254,15 +436,90 @@ int sp_rx_thread(void *ifnet_void)
 	return 0;
 }
 
+/* Read a frame into pkt, which may be segmented */
+static int sp_tap_readv(struct ofp_ifnet *ifnet, odp_packet_t pkt)
+{
+	int num = odp_packet_num_segs(pkt);
+	struct iovec iov[num];
+	odp_packet_seg_t seg;
+	int n;
+
+	if (num == 1)
+		return read(ifnet->fd, odp_packet_data(pkt),
+			    odp_packet_len(pkt));
+
+	seg = odp_packet_first_seg(pkt);
+	for (n = 0; n < num; n++) {
+		iov[n].iov_base = odp_packet_seg_data(pkt, seg);
+		iov[n].iov_len = odp_packet_seg_data_len(pkt, seg);
+		seg = odp_packet_next_seg(pkt, seg);
+	}
+	return readv(ifnet->fd, iov, num);
+}
+
+/*
+ * Read frames from the tap until it is empty or the burst is full.
+ * Returns the number of packets read, pkt[num] is left allocated for
+ * the next call.
+ */
+static int sp_tap_read(struct ofp_ifnet *ifnet, odp_packet_t pkt[])
+{
+	uint32_t pkt_len = ifnet->if_mtu + OFP_ETHER_HDR_LEN +
+		OFP_ETHER_VLAN_ENCAP_LEN;
+	int num = 0, len;
+
+	while (num < SP_BURST) {
+		if (pkt[num] == ODP_PACKET_INVALID) {
+			pkt[num] = ofp_packet_alloc_from_pool(ifnet->pkt_pool,
+							     pkt_len);
+			if (pkt[num] == ODP_PACKET_INVALID) {
+				OFP_ERR("ofp_packet_alloc failed");
+				break;
+			}
+		}
+
+		len = sp_tap_readv(ifnet, pkt[num]);
+		if (len <= 0) {
+			if (len < 0 && errno != EAGAIN && errno != EINTR)
+				OFP_ERR("read failed");
+			break;
+		}
+
+		odp_packet_reset(pkt[num], (size_t)len);
+		odp_packet_l2_offset_set(pkt[num], 0);
+
+		OFP_DEBUG_PACKET(OFP_DEBUG_PKT_SEND_KNI, pkt[num],
+				 ifnet->port);
+		num++;
+	}
+
+	return num;
+}
+
+/* Wait for a burst from the pktio, with a timeout */
+static int sp_pktio_recv(struct ofp_ifnet *ifnet, odp_packet_t pkt[])
+{
+	uint64_t wait = odp_pktin_wait_time(SP_POLL_TMO * ODP_TIME_MSEC_IN_NS);
+	int i, num;
+
+	num = odp_pktin_recv_tmo(ifnet->sp_pktin, pkt, SP_BURST, wait);
+	if (num <= 0)
+		return 0;
+
+	for (i = 0; i < num; i++) {
+		odp_packet_l2_offset_set(pkt[i], 0);
+		OFP_DEBUG_PACKET(OFP_DEBUG_PKT_SEND_KNI, pkt[i], ifnet->port);
+	}
+	return num;
+}
+
 int sp_tx_thread(void *ifnet_void)
 {
-	int len, r;
-	odp_packet_t pkt;
-	uint8_t *buf_pnt;
+	int i, num, sent;
+	odp_packet_t pkt[SP_BURST + 1];
 	struct ofp_ifnet *ifnet = (struct ofp_ifnet *)ifnet_void;
 	struct ofp_global_config_mem *ofp_global_cfg;
-	struct timeval timeout;
-	fd_set read_fd;
+	struct pollfd pfd;
 
 	if (ofp_init_local()) {
 		OFP_ERR("Error: OFP local init failed.\n");
@@ -276,63 +533,52 @@ int sp_tx_thread(void *ifnet_void)
 		return -1;
 	}
 
-	while (ofp_global_cfg->is_running) {
-		/* FIXME: coalese syscalls and speed this up */
-
-		uint32_t pkt_len = ifnet->if_mtu + OFP_ETHER_HDR_LEN +
-			       OFP_ETHER_VLAN_ENCAP_LEN;
-		pkt = ofp_packet_alloc_from_pool(ifnet->pkt_pool, pkt_len);
+	for (i = 0; i <= SP_BURST; i++)
+		pkt[i] = ODP_PACKET_INVALID;
 
-		if (pkt == ODP_PACKET_INVALID) {
-			OFP_ERR("ofp_packet_alloc failed");
-			usleep(1000);
+	while (ofp_global_cfg->is_running) {
+		if (ifnet->sp_pktio != ODP_PKTIO_INVALID)
+			num = sp_pktio_recv(ifnet, pkt);
+		else
+			num = sp_tap_read(ifnet, pkt);
+		if (num == 0 && ifnet->sp_pktio != ODP_PKTIO_INVALID)
+			continue;
+		if (num == 0) {
+			/* Empty tap, or no packets: wait a while */
+			pfd.fd = ifnet->fd;
+			pfd.events = POLLIN;
+			if (pkt[0] == ODP_PACKET_INVALID)
+				pfd.fd = -1;
+			poll(&pfd, 1, pfd.fd < 0 ? 1 : SP_POLL_TMO);
 			continue;
 		}
 
-		buf_pnt = odp_packet_data(pkt);
-
-		/* Blocking read */
-drop_pkg:
-		FD_ZERO(&read_fd);
-		FD_SET(ifnet->fd, &read_fd);
-		timeout.tv_sec = 1;
-		timeout.tv_usec = 0;
-		r = select(ifnet->fd + 1, &read_fd, NULL, NULL, &timeout);
-		if (!ofp_global_cfg->is_running) {
-			odp_packet_free(pkt);
-			break;
-		}
-		if (r <= 0)
-			goto drop_pkg;
-		len = read(ifnet->fd, buf_pnt, odp_packet_len(pkt));
-		if (len <= 0) {
-			OFP_ERR("read failed");
-			if (!ofp_global_cfg->is_running) {
-				odp_packet_free(pkt);
-				break;
-			}
-			goto drop_pkg;
+		OFP_UPDATE_PACKET_STAT(tx_sp, num);
+
+		/* Enqueue the packets to fastpath device */
+		if (ifnet->lag_num)
+			sent = ofp_lag_send_multi(ifnet, pkt, num,
+						  odp_cpu_id());
+		else
+			sent = ofp_send_pkt_multi(ifnet, pkt, num,
+						  odp_cpu_id());
+		if (sent < 0)
+			sent = 0;
+		if (sent < num) {
+			odp_packet_free_multi(&pkt[sent], num - sent);
+			OFP_ERR("odp_queue_enq failed");
 		}
 
-		if (len > 0) {
-			odp_packet_reset(pkt, (size_t)len);
-			odp_packet_l2_offset_set(pkt, 0);
-
-			OFP_DEBUG_PACKET(OFP_DEBUG_PKT_SEND_KNI, pkt,
-				ifnet->port);
-
-			OFP_UPDATE_PACKET_STAT(tx_sp, 1);
-
-			/* Enqueue the packet to fastpath device */
-			if (ofp_send_pkt_multi(ifnet, &pkt, 1,
-					odp_cpu_id()) != 1) {
-				odp_packet_free(pkt);
-				OFP_ERR("odp_queue_enq failed");
-				continue;
-			}
-		}
+		/* The allocated but unused packet goes first */
+		pkt[0] = pkt[num];
+		for (i = 1; i <= num; i++)
+			pkt[i] = ODP_PACKET_INVALID;
 	}
 
+	for (i = 0; i <= SP_BURST; i++)
+		if (pkt[i] != ODP_PACKET_INVALID)
+			odp_packet_free(pkt[i]);
+
 	OFP_DBG("SP TX thread of %s exiting", ifnet->if_name);
 	ofp_term_local();
 	return 0;
@@ -73,13 +73,15 @@
 #include "ofpi_debug.h"
 #include "ofpi_hook.h"
 #include "ofpi_util.h"
+#include "ofpi_gro.h"
+#include "ofpi_stat.h"
 
 extern odp_pool_t ofp_packet_pool;
 
 #define UDPSTAT_INC(x)
 
 #ifndef UDBHASHSIZE
-#define	UDBHASHSIZE	128
+#define	UDBHASHSIZE	ofp_in_pcbhash_size(global_param->socket_max)
 #endif
 
 #define	CSUM_DATA_VALID		0x0400		/* csum_data field is valid */
@@ -97,8 +99,9 @@ uint64_t	ofp_udp_recvspace = 40 * (1024 + sizeof(struct ofp_sockaddr_in6));
 extern int		ofp_max_linkhdr;
 VNET_DEFINE(int, ofp_ip_defttl) = 255;
 
-struct inpcbhead ofp_udb;		/* from udp_var.h */
-struct inpcbinfo ofp_udbinfo;
+/* In share-nothing mode each core has its own PCB table */
+struct inpcbhead *ofp_udb;	/* from udp_var.h */
+struct inpcbinfo *ofp_udbinfo;
 struct ofp_udpstat ofp_udpstat;		/* from udp_var.h */
 
 static void	udp_detach(struct socket *so);
@@ -138,31 +141,63 @@ udp_inpcb_init(void *mem, int size, int flags)
 void
 ofp_udp_init(void)
 {
-	INP_INFO_LOCK_INIT(&ofp_udbinfo, 0);
+	char name[16];
+	int cpu_id;
 
-	ofp_in_pcbinfo_init(&ofp_udbinfo, "udp", &ofp_udb, UDBHASHSIZE, UDBHASHSIZE,
-			"udp_inpcb", udp_inpcb_init, NULL, 0);
+	ofp_udb = calloc(UDP_NUM_CPU, sizeof(*ofp_udb));
+	ofp_udbinfo = calloc(UDP_NUM_CPU, sizeof(*ofp_udbinfo));
+	if (!ofp_udb || !ofp_udbinfo)
+		panic("UDP PCB table allocation failed");
+
+	INP_INFO_LOCK_INIT(&ofp_udbinfo[0], 0);
+	ofp_in_pcbinfo_init(&ofp_udbinfo[0], OFP_SHARE_NOTHING ? "udp_0" : "udp",
+			    &ofp_udb[0], UDBHASHSIZE, UDBHASHSIZE, "udp_inpcb",
+			    udp_inpcb_init, NULL, 0);
+
+	/*
+	 * The tables of the other cores take their inpcbs from the same
+	 * zone, as the sockets are common to all cores.
+	 */
+	for (cpu_id = 1; cpu_id < UDP_NUM_CPU; cpu_id++) {
+		sprintf(name, "udp_%d", cpu_id);
+		INP_INFO_LOCK_INIT(&ofp_udbinfo[cpu_id], 0);
+		ofp_in_pcbinfo_init(&ofp_udbinfo[cpu_id], name, &ofp_udb[cpu_id],
+				    UDBHASHSIZE, UDBHASHSIZE, NULL,
+				    udp_inpcb_init, NULL, 0);
+		ofp_udbinfo[cpu_id].ipi_zone = ofp_udbinfo[0].ipi_zone;
+	}
 }
 
 void
 ofp_udp_destroy(void)
 {
+	struct inpcbinfo *pcbinfo;
 	struct inpcb *inp, *inp_temp;
+	int cpu_id;
+
+	for (cpu_id = 0; cpu_id < UDP_NUM_CPU; cpu_id++) {
+		pcbinfo = &ofp_udbinfo[cpu_id];
+
+		OFP_LIST_FOREACH_SAFE(inp, pcbinfo->ipi_listhead, inp_list,
+				      inp_temp) {
+			if (inp->inp_socket) {
+				ofp_sbdestroy(&inp->inp_socket->so_snd,
+					      inp->inp_socket);
+				ofp_sbdestroy(&inp->inp_socket->so_rcv,
+					      inp->inp_socket);
+			}
 
-	OFP_LIST_FOREACH_SAFE(inp, ofp_udbinfo.ipi_listhead, inp_list,
-			inp_temp) {
-		if (inp->inp_socket) {
-			ofp_sbdestroy(&inp->inp_socket->so_snd,
-					inp->inp_socket);
-			ofp_sbdestroy(&inp->inp_socket->so_rcv,
-					inp->inp_socket);
+			uma_zfree(pcbinfo->ipi_zone, inp);
 		}
 
-		uma_zfree(ofp_udbinfo.ipi_zone, inp);
+		ofp_in_pcbinfo_destroy(pcbinfo);
 	}
+	uma_zdestroy(ofp_udbinfo[0].ipi_zone);
 
-	ofp_in_pcbinfo_destroy(&ofp_udbinfo);
-	uma_zdestroy(ofp_udbinfo.ipi_zone);
+	free(ofp_udbinfo);
+	free(ofp_udb);
+	ofp_udbinfo = NULL;
+	ofp_udb = NULL;
 }
 
 void
@@ -170,22 +205,176 @@ ofp_udp_netstat(int fd)
 {
 	struct inpcb *inp, *inp_temp;
 	struct inpcbhead *ipi_listhead;
+	int cpu_id;
 
-	ipi_listhead = ofp_udbinfo.ipi_listhead;
+	for (cpu_id = 0; cpu_id < UDP_NUM_CPU; cpu_id++) {
+		ipi_listhead = ofp_udbinfo[cpu_id].ipi_listhead;
 
-	OFP_LIST_FOREACH_SAFE(inp, ipi_listhead, inp_list, inp_temp) {
+		OFP_LIST_FOREACH_SAFE(inp, ipi_listhead, inp_list, inp_temp) {
 #ifdef INET6
-		if (inp->inp_inc.inc_flags & INC_ISIPV6)
-			ofp_sendf(fd, "udp6\t%s:%d\r\n",
-				ofp_print_ip6_addr(inp->inp_inc.
-					inc6_laddr.__u6_addr.__u6_addr8),
-				odp_be_to_cpu_16(inp->inp_inc.inc_lport));
-		else
+			if (inp->inp_inc.inc_flags & INC_ISIPV6)
+				ofp_sendf(fd, "udp6\t%s:%d\r\n",
+					ofp_print_ip6_addr(inp->inp_inc.
+						inc6_laddr.__u6_addr.__u6_addr8),
+					odp_be_to_cpu_16(inp->inp_inc.inc_lport));
+			else
 #endif
-			ofp_sendf(fd, "udp\t%s:%d\r\n",
-				ofp_print_ip_addr(inp->inp_inc.
-					inc_laddr.s_addr),
-				odp_be_to_cpu_16(inp->inp_inc.inc_lport));
+				ofp_sendf(fd, "udp\t%s:%d\r\n",
+					ofp_print_ip_addr(inp->inp_inc.
+						inc_laddr.s_addr),
+					odp_be_to_cpu_16(inp->inp_inc.inc_lport));
+		}
+	}
+}
+
+void
+ofp_udp_hashprint(int fd)
+{
+	char name[16];
+	int cpu_id;
+
+	for (cpu_id = 0; cpu_id < UDP_NUM_CPU; cpu_id++) {
+		sprintf(name, "udp_%d", cpu_id);
+		ofp_in_pcbinfo_hashprint(fd, name, &ofp_udbinfo[cpu_id]);
+	}
+}
+
+/* Queue a datagram, or a record of coalesced ones, to the socket */
+static void
+udp_sbappend(struct inpcb *inp, odp_packet_t n, odp_packet_t opts)
+{
+	struct socket *so = inp->inp_socket;
+
+	/* Offer to event function */
+	if (packet_accepted_as_event(so, n))
+		return;
+
+	SOCKBUF_LOCK(&so->so_rcv);
+	if (ofp_sbappendaddr_locked(&so->so_rcv, n, opts) == 0) {
+		SOCKBUF_UNLOCK(&so->so_rcv);
+		odp_packet_free(n);
+		if (opts != ODP_PACKET_INVALID)
+			odp_packet_free(opts);
+		UDPSTAT_INC(udps_fullsock);
+	} else {
+		sorwakeup_locked(so);
+	}
+}
+
+#define UDP_GRO_MAX_LEN 0xffff
+
+/* Chain the payload of n to the held record */
+static int
+udp_gro_append(struct ofp_gro_udp *g, odp_packet_t n, uint32_t plen)
+{
+	odp_packet_t held = g->pkt;
+	struct ofp_udphdr *uh;
+	uint32_t off = odp_packet_l4_offset(n) + sizeof(struct ofp_udphdr);
+
+	if (odp_packet_pull_head(n, off) == NULL)
+		return -1;
+	if (odp_packet_concat(&held, n) < 0) {
+		odp_packet_push_head(n, off);
+		return -1;
+	}
+	g->pkt = held;
+
+	uh = (struct ofp_udphdr *)odp_packet_l4_ptr(held, NULL);
+	uh->uh_ulen = odp_cpu_to_be_16(odp_be_to_cpu_16(uh->uh_ulen) + plen);
+	ofp_packet_user_area(held)->gro_segsz = g->segsz;
+	if (plen < g->segsz)
+		g->closed = 1;
+
+	OFP_UPDATE_PACKET_STAT(rx_udp_gro, 1);
+	return 0;
+}
+
+/*
+ * Hold a datagram for a socket with OFP_UDP_GRO until the end of the
+ * receive burst, chained to the held one if it is of the same source
+ * and no longer than the first one. The socket is referenced until
+ * ofp_udp_gro_flush(). Returns 0 if the datagram is to be queued now.
+ */
+static int
+udp_gro_hold(struct inpcb *inp, struct ofp_ip *ip, odp_packet_t n)
+{
+	struct ofp_gro_udp *g = NULL;
+	struct ofp_sockaddr *sa, *hsa;
+	struct ofp_udphdr *uh, *huh;
+	uint32_t plen, len;
+	int i;
+
+	/* Clones for multicast receivers share their payload */
+	if (odp_packet_has_ref(n))
+		return 0;
+
+	uh = (struct ofp_udphdr *)odp_packet_l4_ptr(n, NULL);
+	plen = odp_be_to_cpu_16(uh->uh_ulen) - sizeof(*uh);
+	if (plen == 0)
+		return 0;
+
+	/* Padding of short frames must not end up in the middle */
+	len = odp_packet_l4_offset(n) + sizeof(*uh) + plen;
+	if (odp_packet_len(n) > len &&
+	    odp_packet_pull_tail(n, odp_packet_len(n) - len) == NULL)
+		return 0;
+
+	for (i = 0; i < ofp_gro.num_udp; i++)
+		if (ofp_gro.udp[i].inp == inp) {
+			g = &ofp_gro.udp[i];
+			break;
+		}
+
+	if (g) {
+		sa = (struct ofp_sockaddr *)odp_packet_l2_ptr(n, NULL);
+		hsa = (struct ofp_sockaddr *)odp_packet_l2_ptr(g->pkt, NULL);
+		huh = (struct ofp_udphdr *)odp_packet_l4_ptr(g->pkt, NULL);
+
+		if (!g->closed && plen <= g->segsz &&
+		    g->dst == ip->ip_dst.s_addr &&
+		    sa->sa_len == hsa->sa_len && !memcmp(sa, hsa, sa->sa_len) &&
+		    odp_be_to_cpu_16(huh->uh_ulen) + plen <= UDP_GRO_MAX_LEN &&
+		    !udp_gro_append(g, n, plen))
+			return 1;
+
+		/* Keep the order, n starts the next record */
+		udp_sbappend(inp, g->pkt, ODP_PACKET_INVALID);
+	} else {
+		if (ofp_gro.num_udp == OFP_GRO_UDP_MAX)
+			return 0;
+		g = &ofp_gro.udp[ofp_gro.num_udp++];
+		ofp_in_pcbref(inp);
+		g->inp = inp;
+	}
+
+	g->pkt = n;
+	g->dst = ip->ip_dst.s_addr;
+	g->segsz = plen;
+	g->closed = 0;
+	return 1;
+}
+
+void
+ofp_udp_gro_flush(void)
+{
+	struct ofp_gro_udp *g;
+	struct inpcb *inp;
+	int i, num = ofp_gro.num_udp;
+
+	ofp_gro.num_udp = 0;
+	for (i = 0; i < num; i++) {
+		g = &ofp_gro.udp[i];
+		inp = g->inp;
+		INP_RLOCK(inp);
+		if (ofp_in_pcbrele_rlocked(inp)) {
+			odp_packet_free(g->pkt);
+			continue;
+		}
+		if (inp->inp_socket && !(inp->inp_flags & INP_DROPPED))
+			udp_sbappend(inp, g->pkt, ODP_PACKET_INVALID);
+		else
+			odp_packet_free(g->pkt);
+		INP_RUNLOCK(inp);
 	}
 }
 
@@ -201,12 +390,10 @@ udp_append(struct inpcb *inp, struct ofp_ip *ip, odp_packet_t n, int off,
 	   struct ofp_sockaddr_in *udp_in)
 {
 	struct ofp_sockaddr *append_sa;
-	struct socket *so;
 	odp_packet_t opts = ODP_PACKET_INVALID;
 	struct ofp_sockaddr_in6 udp_in6;
 	struct udpcb *up;
 
-	(void)ip;
 	(void)udp_in6;
 
 	INP_LOCK_ASSERT(inp);
@@ -249,25 +436,47 @@ udp_append(struct inpcb *inp, struct ofp_ip *ip, odp_packet_t n, int off,
 	//odp_packet_seg_pull_head(n, odp_packet_seg(n, 0), off);
 	//odp_packet_adj(n, off);
 
-	so = inp->inp_socket;
-
 	/* save sender data where L2 & L3 headers used to be */
 	memcpy(odp_packet_l2_ptr(n, NULL), append_sa, append_sa->sa_len);
 
-	/* Offer to event function */
-	if (packet_accepted_as_event(so, n))
+	if (odp_unlikely(inp->inp_socket->so_timestamping &
+			 OFP_SOF_TIMESTAMPING_RX_SOFTWARE)) {
+		struct ofp_packet_user_area *ua = ofp_packet_user_area(n);
+
+		ua->ts.rx_ns = ofp_gro.rx_ns ?
+			ofp_gro.rx_ns : odp_time_to_ns(odp_time_global());
+		ua->valid |= OFP_UA_TS;
+	}
+
+	if ((up->u_flags & UF_GRO) && ofp_gro.depth &&
+	    opts == ODP_PACKET_INVALID && udp_gro_hold(inp, ip, n))
 		return;
 
-	SOCKBUF_LOCK(&so->so_rcv);
-	if (ofp_sbappendaddr_locked(&so->so_rcv, n, opts) == 0) {
-		SOCKBUF_UNLOCK(&so->so_rcv);
-		odp_packet_free(n);
-		if (opts != ODP_PACKET_INVALID)
-			odp_packet_free(opts);
-		UDPSTAT_INC(udps_fullsock);
-	} else {
-		sorwakeup_locked(so);
+	udp_sbappend(inp, n, opts);
+}
+
+/*
+ * PCBs of the VRF bound to a local port, or NULL if there are none.
+ */
+static struct inpcbport *
+udp_port_group(int vrf, uint16_t lport)
+{
+	struct inpcbporthead *porthash;
+	struct inpcbinfo *hashinfo;
+	struct inpcbport *phd;
+
+	INP_INFO_LOCK_ASSERT(&V_udbinfo);
+
+	hashinfo = ofp_in_pcbinfo_vrf(&V_udbinfo, vrf);
+	if (hashinfo == NULL)
+		return (NULL);
+	porthash = &hashinfo->ipi_porthashbase[INP_PCBPORTHASH(lport,
+	    hashinfo->ipi_porthashmask)];
+	OFP_LIST_FOREACH(phd, porthash, phd_hash) {
+		if (phd->phd_port == lport)
+			return (phd);
 	}
+	return (NULL);
 }
 
 /*
@@ -312,10 +521,12 @@ ofp_udp_input(odp_packet_t *m, int off)
 	if (res != OFP_PKT_CONTINUE)
 		return res;
 
-	/* Offer to VXLAN handler. */
-	res = ofp_vxlan_input(*m);
-	if (res != OFP_PKT_CONTINUE)
-		return res;
+	/* Offer to VXLAN handler, if a VXLAN interface has been up. */
+	if (ofp_ip4_feat() & OFP_IP4_FEAT_VXLAN) {
+		res = ofp_vxlan_input(*m);
+		if (res != OFP_PKT_CONTINUE)
+			return res;
+	}
 
 	ifp = odp_packet_user_ptr(*m);
 	UDPSTAT_INC(udps_ipackets);
@@ -426,12 +637,23 @@ ofp_udp_input(odp_packet_t *m, int off)
 	    ofp_in_broadcast(ip->ip_dst, ifp)) {
 		struct inpcb *last;
 		struct ofp_ip_moptions *imo;
+		struct inpcbport *phd;
 
-		INP_INFO_RLOCK(&ofp_udbinfo);
+		INP_INFO_RLOCK(&V_udbinfo);
 		last = NULL;
-		OFP_LIST_FOREACH(inp, &ofp_udb, inp_list) {
-			if (inp->inp_lport != uh->uh_dport)
-				continue;
+		inp = NULL;
+		/* No socket is a member if the interface is not */
+		if (OFP_IN_MULTICAST(odp_be_to_cpu_32(ip->ip_dst.s_addr)) &&
+		    !ofp_in_mcast_member(ifp, ip->ip_dst))
+			goto mcast_done;
+		/*
+		 * Only the PCBs bound to the port are candidates, walk
+		 * their port hash group instead of all UDP PCBs.
+		 */
+		phd = udp_port_group(ifp->vrf, uh->uh_dport);
+		if (phd == NULL)
+			goto mcast_done;
+		OFP_LIST_FOREACH(inp, &phd->phd_pcblist, inp_portlist) {
 #ifdef _INET6
 			if ((inp->inp_vflag & INP_IPV4) == 0)
 				continue;
@@ -490,7 +712,10 @@ ofp_udp_input(odp_packet_t *m, int off)
 			if (last != NULL) {
 				odp_packet_t n;
 
-				n = odp_packet_copy(*m, ofp_packet_pool);
+				/* Only the headers are rewritten per receiver */
+				n = ofp_packet_clone(*m, odp_packet_l3_offset(*m) +
+						     iphlen +
+						     sizeof(struct ofp_udphdr));
 				udp_append(last, ip, n, iphlen, &udp_in);
 				INP_RUNLOCK(last);
 			}
@@ -507,7 +732,7 @@ ofp_udp_input(odp_packet_t *m, int off)
 			    (OFP_SO_REUSEPORT|OFP_SO_REUSEADDR)) == 0)
 				break;
 		}
-
+mcast_done:
 		if (last == NULL) {
 			/*
 			 * No matching pcb found; discard datagram.  (No need
@@ -517,7 +742,7 @@ ofp_udp_input(odp_packet_t *m, int off)
 			UDPSTAT_INC(udps_noportbcast);
 			if (inp)
 				INP_RUNLOCK(inp);
-			INP_INFO_RUNLOCK(&ofp_udbinfo);
+			INP_INFO_RUNLOCK(&V_udbinfo);
 #ifndef SP
 			goto badunlocked;
 #else
@@ -526,14 +751,14 @@ ofp_udp_input(odp_packet_t *m, int off)
 		}
 		udp_append(last, ip, *m, iphlen, &udp_in);
 		INP_RUNLOCK(last);
-		INP_INFO_RUNLOCK(&ofp_udbinfo);
+		INP_INFO_RUNLOCK(&V_udbinfo);
 		return OFP_PKT_PROCESSED;
 	} /* Multicast */
 
 	/*
 	 * Locate pcb for datagram.
 	 */
-	inp = ofp_in_pcblookup(&ofp_udbinfo, ip->ip_src, uh->uh_sport,
+	inp = ofp_in_pcblookup(&V_udbinfo, ip->ip_src, uh->uh_sport,
 			   ip->ip_dst, uh->uh_dport, INPLOOKUP_WILDCARD |
 			   INPLOOKUP_RLOCKPCB, ifp);
 
@@ -640,7 +865,7 @@ ofp_udp_ctlinput(int cmd, struct ofp_sockaddr *sa, void *vip)
 		return;
 	if (ip != NULL) {
 		uh = (struct ofp_udphdr *)((char *)ip + (ip->ip_hl << 2));
-		inp = ofp_in_pcblookup(&ofp_udbinfo, faddr, uh->uh_dport,
+		inp = ofp_in_pcblookup(&V_udbinfo, faddr, uh->uh_dport,
 		    ip->ip_src, uh->uh_sport, INPLOOKUP_RLOCKPCB, NULL);
 		if (inp != NULL) {
 			INP_RLOCK_ASSERT(inp);
@@ -649,7 +874,7 @@ ofp_udp_ctlinput(int cmd, struct ofp_sockaddr *sa, void *vip)
 			INP_RUNLOCK(inp);
 		}
 	} else
-		ofp_in_pcbnotifyall(&ofp_udbinfo, faddr, ofp_inetctlerrmap[cmd],
+		ofp_in_pcbnotifyall(&V_udbinfo, faddr, ofp_inetctlerrmap[cmd],
 		    ofp_udp_notify);
 }
 
@@ -667,7 +892,7 @@ udp_pcblist(OFP_SYSCTL_HANDLER_ARGS)
 	 * resource-intensive to repeat twice on every request.
 	 */
 	if (req->oldptr == 0) {
-		n = ofp_udbinfo.ipi_count;
+		n = V_udbinfo.ipi_count;
 		n += imax(n / 8, 10);
 		req->oldidx = 2 * (sizeof xig) + n * sizeof(struct xinpcb);
 		return (0);
@@ -679,10 +904,10 @@ udp_pcblist(OFP_SYSCTL_HANDLER_ARGS)
 	/*
 	 * OK, now we're committed to doing something.
 	 */
-	INP_INFO_RLOCK(&ofp_udbinfo);
+	INP_INFO_RLOCK(&V_udbinfo);
 	gencnt = V_udbinfo.ipi_gencnt;
 	n = V_udbinfo.ipi_count;
-	INP_INFO_RUNLOCK(&ofp_udbinfo);
+	INP_INFO_RUNLOCK(&V_udbinfo);
 
 	error = sysctl_wire_old_buffer(req, 2 * (sizeof xig)
 		+ n * sizeof(struct xinpcb));
@@ -701,7 +926,7 @@ udp_pcblist(OFP_SYSCTL_HANDLER_ARGS)
 	if (inp_list == 0)
 		return (OFP_ENOMEM);
 
-	INP_INFO_RLOCK(&ofp_udbinfo);
+	INP_INFO_RLOCK(&V_udbinfo);
 	for (inp = OFP_LIST_FIRST(V_udbinfo.ipi_listhead), i = 0; inp && i < n;
 	     inp = OFP_LIST_NEXT(inp, inp_list)) {
 		INP_WLOCK(inp);
@@ -712,7 +937,7 @@ udp_pcblist(OFP_SYSCTL_HANDLER_ARGS)
 		}
 		INP_WUNLOCK(inp);
 	}
-	INP_INFO_RUNLOCK(&ofp_udbinfo);
+	INP_INFO_RUNLOCK(&V_udbinfo);
 	n = i;
 
 	error = 0;
@@ -734,14 +959,14 @@ udp_pcblist(OFP_SYSCTL_HANDLER_ARGS)
 		} else
 			INP_RUNLOCK(inp);
 	}
-	INP_INFO_WLOCK(&ofp_udbinfo);
+	INP_INFO_WLOCK(&V_udbinfo);
 	for (i = 0; i < n; i++) {
 		inp = inp_list[i];
 		INP_RLOCK(inp);
 		if (!ofp_in_pcbrele_rlocked(inp))
 			INP_RUNLOCK(inp);
 	}
-	INP_INFO_WUNLOCK(&ofp_udbinfo);
+	INP_INFO_WUNLOCK(&V_udbinfo);
 
 	if (!error) {
 		/*
@@ -750,11 +975,11 @@ udp_pcblist(OFP_SYSCTL_HANDLER_ARGS)
 		 * that something happened while we were processing this
 		 * request, and it might be necessary to retry.
 		 */
-		INP_INFO_RLOCK(&ofp_udbinfo);
+		INP_INFO_RLOCK(&V_udbinfo);
 		xig.xig_gen = V_udbinfo.ipi_gencnt;
 		xig.xig_sogen = so_gencnt;
 		xig.xig_count = V_udbinfo.ipi_count;
-		INP_INFO_RUNLOCK(&ofp_udbinfo);
+		INP_INFO_RUNLOCK(&V_udbinfo);
 		error = SYSCTL_OUT(req, &xig, sizeof xig);
 	}
 	free(inp_list, M_TEMP);
@@ -781,7 +1006,7 @@ udp_getcred(OFP_SYSCTL_HANDLER_ARGS)
 	error = SYSCTL_IN(req, addrs, sizeof(addrs));
 	if (error)
 		return (error);
-	inp = ofp_in_pcblookup(&ofp_udbinfo, addrs[1].sin_addr, addrs[1].sin_port,
+	inp = ofp_in_pcblookup(&V_udbinfo, addrs[1].sin_addr, addrs[1].sin_port,
 	    addrs[0].sin_addr, addrs[0].sin_port,
 	    INPLOOKUP_WILDCARD | INPLOOKUP_RLOCKPCB, NULL);
 	if (inp != NULL) {
@@ -809,9 +1034,7 @@ int
 ofp_udp_ctloutput(struct socket *so, struct sockopt *sopt)
 {
 	int error = 0;
-	(void)so;
-	(void)sopt;
-	//int optval;
+	int optval;
 	struct inpcb *inp;
 
 	inp = sotoinpcb(so);
@@ -832,27 +1055,40 @@ ofp_udp_ctloutput(struct socket *so, struct sockopt *sopt)
 		return (error);
 	}
 
-#if 0
 	switch (sopt->sopt_dir) {
 	case SOPT_SET:
 		switch (sopt->sopt_name) {
-		case OFP_UDP_ENCAP:
+		case OFP_UDP_SEGMENT:
 			INP_WUNLOCK(inp);
-			error = sooptcopyin(sopt, &optval, sizeof optval,
-					    sizeof optval);
+			error = ofp_sooptcopyin(sopt, &optval, sizeof optval,
+						sizeof optval);
 			if (error)
 				break;
+			if (optval < 0 ||
+			    optval > (int)(OFP_IP_MAXPACKET -
+					   sizeof(struct udpiphdr))) {
+				error = OFP_EINVAL;
+				break;
+			}
 			inp = sotoinpcb(so);
 			KASSERT(inp != NULL, ("%s: inp == NULL", __func__));
 			INP_WLOCK(inp);
-			switch (optval) {
-			case 0:
-				/* Clear all UDP encap. */
-				break;
-			default:
-				error = OFP_EINVAL;
+			intoudpcb(inp)->u_gso_size = optval;
+			INP_WUNLOCK(inp);
+			break;
+		case OFP_UDP_GRO:
+			INP_WUNLOCK(inp);
+			error = ofp_sooptcopyin(sopt, &optval, sizeof optval,
+						sizeof optval);
+			if (error)
 				break;
-			}
+			inp = sotoinpcb(so);
+			KASSERT(inp != NULL, ("%s: inp == NULL", __func__));
+			INP_WLOCK(inp);
+			if (optval)
+				intoudpcb(inp)->u_flags |= UF_GRO;
+			else
+				intoudpcb(inp)->u_flags &= ~UF_GRO;
 			INP_WUNLOCK(inp);
 			break;
 		default:
@@ -863,6 +1099,16 @@ ofp_udp_ctloutput(struct socket *so, struct sockopt *sopt)
 		break;
 	case SOPT_GET:
 		switch (sopt->sopt_name) {
+		case OFP_UDP_SEGMENT:
+			optval = intoudpcb(inp)->u_gso_size;
+			INP_WUNLOCK(inp);
+			error = ofp_sooptcopyout(sopt, &optval, sizeof optval);
+			break;
+		case OFP_UDP_GRO:
+			optval = !!(intoudpcb(inp)->u_flags & UF_GRO);
+			INP_WUNLOCK(inp);
+			error = ofp_sooptcopyout(sopt, &optval, sizeof optval);
+			break;
 		default:
 			INP_WUNLOCK(inp);
 			error = OFP_ENOPROTOOPT;
@@ -870,7 +1116,6 @@ ofp_udp_ctloutput(struct socket *so, struct sockopt *sopt)
 		}
 		break;
 	}
-#endif
 	return (error);
 }
 
@@ -892,6 +1137,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 	uint16_t fport, lport;
 	int unlock_udbinfo;
 	uint8_t tos;
+	uint16_t gso_size;
 
 	/*
 	 * udp_output() may need to temporarily bind or connect the current
@@ -909,6 +1155,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 	src.sin_family = 0;
 	INP_RLOCK(inp);
 	tos = inp->inp_ip_tos;
+	gso_size = intoudpcb(inp)->u_gso_size;
 	if (control != ODP_PACKET_INVALID) {
 		/*
 		 * XXX: Currently, we assume all the optional information is
@@ -927,6 +1174,16 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 				error = OFP_EINVAL;
 				break;
 			}
+			if (cm->cmsg_level == OFP_IPPROTO_UDP &&
+			    cm->cmsg_type == OFP_UDP_SEGMENT) {
+				if (cm->cmsg_len !=
+				    OFP_CMSG_LEN(sizeof(uint16_t))) {
+					error = OFP_EINVAL;
+					break;
+				}
+				gso_size = *(uint16_t *)OFP_CMSG_DATA(cm);
+				continue;
+			}
 			if (cm->cmsg_level != OFP_IPPROTO_IP)
 				continue;
 
@@ -990,7 +1247,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 	    (inp->inp_laddr.s_addr == OFP_INADDR_ANY && inp->inp_lport == 0)) {
 		INP_RUNLOCK(inp);
 		INP_WLOCK(inp);
-		INP_HASH_WLOCK(&ofp_udbinfo);
+		INP_HASH_WLOCK(inp->inp_hashinfo);
 		unlock_udbinfo = UH_WLOCKED;
 	} else if ((sin != NULL && (
 	    (sin->sin_addr.s_addr == OFP_INADDR_ANY) ||
@@ -998,7 +1255,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 	    (inp->inp_laddr.s_addr == OFP_INADDR_ANY) ||
 	    (inp->inp_lport == 0))) ||
 	    (src.sin_family == OFP_AF_INET)) {
-		INP_HASH_RLOCK(&ofp_udbinfo);
+		INP_HASH_RLOCK(inp->inp_hashinfo);
 		unlock_udbinfo = UH_RLOCKED;
 	} else
 		unlock_udbinfo = UH_UNLOCKED;
@@ -1011,7 +1268,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 	laddr = inp->inp_laddr;
 	lport = inp->inp_lport;
 	if (src.sin_family == OFP_AF_INET) {
-		INP_HASH_LOCK_ASSERT(&ofp_udbinfo);
+		INP_HASH_LOCK_ASSERT(inp->inp_hashinfo);
 		if ((lport == 0) ||
 		    (laddr.s_addr == OFP_INADDR_ANY &&
 		     src.sin_addr.s_addr == OFP_INADDR_ANY)) {
@@ -1054,7 +1311,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 		    inp->inp_lport == 0 ||
 		    sin->sin_addr.s_addr == OFP_INADDR_ANY ||
 		    sin->sin_addr.s_addr == OFP_INADDR_BROADCAST) {
-			INP_HASH_LOCK_ASSERT(&ofp_udbinfo);
+			INP_HASH_LOCK_ASSERT(inp->inp_hashinfo);
 			error = ofp_in_pcbconnect_setup(inp, addr, &laddr.s_addr,
 			    &lport, &faddr.s_addr, &fport, NULL,
 			    td->td_ucred);
@@ -1069,7 +1326,7 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 			if (inp->inp_laddr.s_addr == OFP_INADDR_ANY &&
 			    inp->inp_lport == 0) {
 				INP_WLOCK_ASSERT(inp);
-				INP_HASH_WLOCK_ASSERT(&ofp_udbinfo);
+				INP_HASH_WLOCK_ASSERT(inp->inp_hashinfo);
 #if 0
 				/*
 				 * Remember addr if jailed, to prevent
@@ -1162,17 +1419,36 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 		UDPSTAT_INC(udps_opackets);
 	}
 
+	/*
+	 * A send larger than the segment size leaves as datagrams of it,
+	 * cut with the headers above as the template after routing.
+	 */
+	if (gso_size && len > gso_size)
+		ofp_packet_user_area(m)->tso_segsz = gso_size;
+
+	if (odp_unlikely(inp->inp_socket->so_timestamping &
+			 OFP_SOF_TIMESTAMPING_TX_SOFTWARE)) {
+		struct ofp_packet_user_area *ua = ofp_packet_user_area(m);
+
+		ua->valid |= OFP_UA_TS;
+		ua->ts.tx.fd = inp->inp_socket->so_number + 1;
+		ua->ts.tx.id =
+			odp_atomic_fetch_inc_u32(&inp->inp_socket->so_ts_txid) +
+			1;
+		ofp_tx_ts_num++;
+	}
+
 	if (unlock_udbinfo == UH_WLOCKED)
-		INP_HASH_WUNLOCK(&ofp_udbinfo);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	else if (unlock_udbinfo == UH_RLOCKED) {
-		INP_HASH_RUNLOCK(&ofp_udbinfo);
+		INP_HASH_RUNLOCK(inp->inp_hashinfo);
 	}
 
 #if 0
 	error = ofp_ip_output(m, inp->inp_options, NULL, ipflags,
 				inp->inp_moptions, inp);
 #else
-	if (ofp_ip_output(m, NULL) == OFP_PKT_DROP) {
+	if (ofp_in_pcb_ip_output(inp, m) == OFP_PKT_DROP) {
 		OFP_WARN("packet dropped, returning OFP_EIO");
 		odp_packet_free(m);
 		error = OFP_EIO;
@@ -1187,10 +1463,10 @@ udp_output(struct inpcb *inp, odp_packet_t m, struct ofp_sockaddr *addr,
 
 release:
 	if (unlock_udbinfo == UH_WLOCKED) {
-		INP_HASH_WUNLOCK(&ofp_udbinfo);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 		INP_WUNLOCK(inp);
 	} else if (unlock_udbinfo == UH_RLOCKED) {
-		INP_HASH_RUNLOCK(&ofp_udbinfo);
+		INP_HASH_RUNLOCK(inp->inp_hashinfo);
 		INP_RUNLOCK(inp);
 	} else
 		INP_RUNLOCK(inp);
@@ -1208,10 +1484,10 @@ udp_abort(struct socket *so)
 	KASSERT(inp != NULL, ("udp_abort: inp == NULL"));
 	INP_WLOCK(inp);
 	if (inp->inp_faddr.s_addr != OFP_INADDR_ANY) {
-		INP_HASH_WLOCK(&ofp_udbinfo);
-		ofp_in_pcbdisconnect(inp);
+		INP_HASH_WLOCK(inp->inp_hashinfo);
 		inp->inp_laddr.s_addr = OFP_INADDR_ANY;
-		INP_HASH_WUNLOCK(&ofp_udbinfo);
+		ofp_in_pcbdisconnect(inp);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 		ofp_soisdisconnected(so);
 	}
 	INP_WUNLOCK(inp);
@@ -1235,11 +1511,11 @@ udp_attach(struct socket *so, int proto, struct thread *td)
 		return (error);
 	*/
 
-	INP_INFO_WLOCK(&ofp_udbinfo);
+	INP_INFO_WLOCK(&V_udbinfo);
 
-	error = ofp_in_pcballoc(so, &ofp_udbinfo);
+	error = ofp_in_pcballoc(so, &V_udbinfo);
 	if (error) {
-		INP_INFO_WUNLOCK(&ofp_udbinfo);
+		INP_INFO_WUNLOCK(&V_udbinfo);
 		return (error);
 	}
 
@@ -1252,14 +1528,14 @@ udp_attach(struct socket *so, int proto, struct thread *td)
 	if (error) {
 		ofp_in_pcbdetach(inp);
 		ofp_in_pcbfree(inp);
-		INP_INFO_WUNLOCK(&ofp_udbinfo);
+		INP_INFO_WUNLOCK(&V_udbinfo);
 		return (error);
 	}
 	*/
 	inp->inp_ppcb = &inp->ppcb_space.udp_ppcb;
 
 	INP_WUNLOCK(inp);
-	INP_INFO_WUNLOCK(&ofp_udbinfo);
+	INP_INFO_WUNLOCK(&V_udbinfo);
 	return (0);
 }
 
@@ -1294,9 +1570,9 @@ udp_bind(struct socket *so, struct ofp_sockaddr *nam, struct thread *td)
 	inp = sotoinpcb(so);
 	KASSERT(inp != NULL, ("udp_bind: inp == NULL"));
 	INP_WLOCK(inp);
-	INP_HASH_WLOCK(&ofp_udbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	error = ofp_in_pcbbind(inp, nam, td->td_ucred);
-	INP_HASH_WUNLOCK(&ofp_udbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	INP_WUNLOCK(inp);
 	return (error);
 }
@@ -1310,10 +1586,10 @@ udp_close(struct socket *so)
 	KASSERT(inp != NULL, ("udp_close: inp == NULL"));
 	INP_WLOCK(inp);
 	if (inp->inp_faddr.s_addr != OFP_INADDR_ANY) {
-		INP_HASH_WLOCK(&ofp_udbinfo);
-		ofp_in_pcbdisconnect(inp);
+		INP_HASH_WLOCK(inp->inp_hashinfo);
 		inp->inp_laddr.s_addr = OFP_INADDR_ANY;
-		INP_HASH_WUNLOCK(&ofp_udbinfo);
+		ofp_in_pcbdisconnect(inp);
+		INP_HASH_WUNLOCK(inp->inp_hashinfo);
 		ofp_soisdisconnected(so);
 	}
 	INP_WUNLOCK(inp);
@@ -1340,9 +1616,9 @@ udp_connect(struct socket *so, struct ofp_sockaddr *nam, struct thread *td)
 		return (error);
 	}
 	*/
-	INP_HASH_WLOCK(&ofp_udbinfo);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	error = ofp_in_pcbconnect(inp, nam, td->td_ucred);
-	INP_HASH_WUNLOCK(&ofp_udbinfo);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	if (error == 0)
 		ofp_soisconnected(so);
 	INP_WUNLOCK(inp);
@@ -1352,6 +1628,7 @@ udp_connect(struct socket *so, struct ofp_sockaddr *nam, struct thread *td)
 static void
 udp_detach(struct socket *so)
 {
+	struct inpcbinfo *pcbinfo;
 	struct inpcb *inp;
 	struct udpcb *up;
 
@@ -1359,14 +1636,15 @@ udp_detach(struct socket *so)
 	KASSERT(inp != NULL, ("udp_detach: inp == NULL"));
 	KASSERT(inp->inp_faddr.s_addr == OFP_INADDR_ANY,
 	    ("udp_detach: not disconnected"));
-	INP_INFO_WLOCK(&ofp_udbinfo);
+	pcbinfo = inp->inp_pcbinfo;
+	INP_INFO_WLOCK(pcbinfo);
 	INP_WLOCK(inp);
 	up = intoudpcb(inp);
 	KASSERT(up != NULL, ("%s: up == NULL", __func__));
 	inp->inp_ppcb = NULL;
 	ofp_in_pcbdetach(inp);
 	ofp_in_pcbfree(inp);
-	INP_INFO_WUNLOCK(&ofp_udbinfo);
+	INP_INFO_WUNLOCK(pcbinfo);
 }
 
 static int
@@ -1381,10 +1659,10 @@ udp_disconnect(struct socket *so)
 		INP_WUNLOCK(inp);
 		return (OFP_ENOTCONN);
 	}
-	INP_HASH_WLOCK(&ofp_udbinfo);
-	ofp_in_pcbdisconnect(inp);
+	INP_HASH_WLOCK(inp->inp_hashinfo);
 	inp->inp_laddr.s_addr = OFP_INADDR_ANY;
-	INP_HASH_WUNLOCK(&ofp_udbinfo);
+	ofp_in_pcbdisconnect(inp);
+	INP_HASH_WUNLOCK(inp->inp_hashinfo);
 	OFP_SOCK_LOCK(so);
 #if 1 /* HJo: FIX */
 	so->so_state &= ~SS_ISCONNECTED;		/* XXX */
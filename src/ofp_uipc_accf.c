@@ -0,0 +1,166 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include <odp_api.h>
+
+#include "ofpi_errno.h"
+#include "ofpi_socketvar.h"
+#include "ofpi_sockopt.h"
+#include "ofpi_sockstate.h"
+#include "ofpi_log.h"
+
+/*
+ * Accept filters keep a new connection on the incomplete queue of the
+ * listening socket until its first data has arrived, so that accept()
+ * and the wakeups of the listener see only connections with data.
+ * Waiting connections count against the queue limit, and
+ * ofp_sonewconn() drops the oldest of them when it is exceeded.
+ */
+
+/* Bytes of the request line looked at before passing it anyway */
+#define ACCF_HTTP_MAXLINE 1024
+
+/* "dataready": any data, or the end of the connection */
+static int accf_data_callback(struct socket *so, void *arg, int waitflag)
+{
+	(void)arg;
+	(void)waitflag;
+
+	return soreadable(so) ? SU_ISCONNECTED : SU_OK;
+}
+
+/* "httpready": the first line of the request has arrived */
+static int accf_http_callback(struct socket *so, void *arg, int waitflag)
+{
+	struct sockbuf *sb = &so->so_rcv;
+	char buf[ACCF_HTTP_MAXLINE];
+	uint32_t len = 0, n;
+	int i;
+
+	(void)arg;
+	(void)waitflag;
+
+	if (so->so_error || (sb->sb_state & SBS_CANTRCVMORE))
+		return SU_ISCONNECTED;
+
+	for (i = sb->sb_get; i != sb->sb_put && len < sizeof(buf);) {
+		odp_packet_t m = sb->sb_mb[i];
+
+		n = odp_packet_len(m);
+		if (n > sizeof(buf) - len)
+			n = sizeof(buf) - len;
+		if (odp_packet_copy_to_mem(m, 0, n, buf + len))
+			return SU_ISCONNECTED;
+		if (memchr(buf + len, '\n', n))
+			return SU_ISCONNECTED;
+		len += n;
+		if (++i >= sb->sb_size)
+			i = 0;
+	}
+
+	/* Longer lines and a full buffer go to the application as is */
+	if (len >= sizeof(buf) || sbspace(sb) <= 0)
+		return SU_ISCONNECTED;
+	return SU_OK;
+}
+
+static struct accept_filter accf_builtin[] = {
+	{
+		.accf_name = "dataready",
+		.accf_callback = accf_data_callback,
+	},
+	{
+		.accf_name = "httpready",
+		.accf_callback = accf_http_callback,
+	},
+};
+
+struct accept_filter *accept_filt_get(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(accf_builtin) / sizeof(accf_builtin[0]); i++)
+		if (!strncmp(accf_builtin[i].accf_name, name,
+			     sizeof(accf_builtin[i].accf_name)))
+			return &accf_builtin[i];
+	return NULL;
+}
+
+int ofp_accept_filt_set(struct socket *so, const char *name, char *arg)
+{
+	struct accept_filter *afp = NULL;
+	struct so_accf *accf = &so->so_accf;
+	void *afarg = NULL;
+
+	if (name) {
+		afp = accept_filt_get(name);
+		if (afp == NULL)
+			return OFP_ENOENT;
+	}
+
+	ACCEPT_LOCK();
+	OFP_SOCK_LOCK(so);
+	if ((so->so_options & OFP_SO_ACCEPTCONN) == 0) {
+		OFP_SOCK_UNLOCK(so);
+		ACCEPT_UNLOCK();
+		return OFP_EINVAL;
+	}
+	if (accf->so_accept_filter) {
+		if (accf->so_accept_filter->accf_destroy)
+			accf->so_accept_filter->accf_destroy(so);
+		accf->so_accept_filter = NULL;
+		accf->so_accept_filter_arg = NULL;
+		so->so_options &= ~OFP_SO_ACCEPTFILTER;
+	}
+	if (afp) {
+		if (afp->accf_create)
+			afarg = afp->accf_create(so, arg);
+		accf->so_accept_filter = afp;
+		accf->so_accept_filter_arg = afarg;
+		so->so_options |= OFP_SO_ACCEPTFILTER;
+	}
+	OFP_SOCK_UNLOCK(so);
+	ACCEPT_UNLOCK();
+	return 0;
+}
+
+int ofp_accept_filt_setopt(struct socket *so, struct sockopt *sopt)
+{
+	struct accept_filter_arg afa;
+	int error;
+
+	if (sopt->sopt_val == NULL)
+		return ofp_accept_filt_set(so, NULL, NULL);
+
+	memset(&afa, 0, sizeof(afa));
+	error = ofp_sooptcopyin(sopt, &afa, sizeof(afa), sizeof(afa));
+	if (error)
+		return error;
+	afa.af_name[sizeof(afa.af_name) - 1] = '\0';
+	afa.af_arg[sizeof(afa.af_arg) - 1] = '\0';
+
+	return ofp_accept_filt_set(so, afa.af_name, afa.af_arg);
+}
+
+int ofp_accept_filt_getopt(struct socket *so, struct sockopt *sopt)
+{
+	struct accept_filter_arg afa;
+
+	memset(&afa, 0, sizeof(afa));
+	OFP_SOCK_LOCK(so);
+	if ((so->so_options & OFP_SO_ACCEPTCONN) == 0 ||
+	    so->so_accf.so_accept_filter == NULL) {
+		OFP_SOCK_UNLOCK(so);
+		return OFP_EINVAL;
+	}
+	strncpy(afa.af_name, so->so_accf.so_accept_filter->accf_name,
+		sizeof(afa.af_name) - 1);
+	OFP_SOCK_UNLOCK(so);
+
+	return ofp_sooptcopyout(sopt, &afa, sizeof(afa));
+}
@@ -40,6 +40,12 @@
 #include "ofpi_in_pcb.h"
 #include "ofpi_in.h"
 #include "ofpi_log.h"
+#include "ofpi_epoll.h"
+#include "ofpi_gro.h"
+#include "ofpi_init.h"
+#include "ofpi_pkt_processing.h"
+#include "ofpi_sysctl.h"
+#include "ofpi_tcp_var.h"
 
 
 /*
@@ -66,6 +72,98 @@ uint64_t ofp_sb_max = SB_MAX;
 
 static uint64_t sb_efficiency = 8;	/* parameter for ofp_sbreserve() */
 
+static int sb_coalesce = 256;
+OFP_SYSCTL_INT(_net_inet_tcp, OFP_OID_AUTO, sb_coalesce, OFP_CTLFLAG_RW,
+    &sb_coalesce, 0,
+    "Copy received segments of up to this many bytes into the receive "
+    "buffer, 0: never");
+
+/*
+ * Packets of OFP_SIGEV_BATCH sockets received in the current burst.
+ * Sockets are kept by descriptor, as a callback may close any socket.
+ */
+struct sock_event {
+	int fd;
+	int num;
+	odp_packet_t pkt[OFP_SOCK_EVENT_BATCH];
+};
+
+static __thread struct sock_event sock_event[OFP_SOCK_EVENT_SOCKETS];
+static __thread int sock_event_raising;
+__thread int ofp_sock_event_num;
+
+static void sock_event_raise(int fd, odp_packet_t *pkt, int num)
+{
+	struct socket *so = ofp_get_sock_by_fd(fd);
+	struct ofp_sock_sigval ss;
+	union ofp_sigval sv;
+
+	if (!so || so->so_sigevent.ofp_sigev_notify != OFP_SIGEV_BATCH) {
+		odp_packet_free_multi(pkt, num);
+		return;
+	}
+
+	sv.sival_ptr = (void *)&ss;
+	ss.event = OFP_EVENT_RECV;
+	ss.sockfd = fd;
+	ss.pkt = ODP_PACKET_INVALID;
+	ss.pkts = pkt;
+	ss.num = num;
+
+	sock_event_raising++;
+	so->so_state |= SS_EVENT;
+	so->so_sigevent.ofp_sigev_notify_function(sv);
+	so->so_state &= ~SS_EVENT;
+	sock_event_raising--;
+}
+
+void ofp_sock_event_flush(void)
+{
+	struct sock_event *se;
+	int i;
+
+	/* Bursts of packets sent from a callback end inside the flush */
+	if (sock_event_raising)
+		return;
+
+	for (i = 0; i < ofp_sock_event_num; i++) {
+		se = &sock_event[i];
+		sock_event_raise(se->fd, se->pkt, se->num);
+	}
+	ofp_sock_event_num = 0;
+}
+
+static void sock_event_queue(struct socket *so, odp_packet_t pkt)
+{
+	struct sock_event *se = NULL;
+	int i;
+
+	/* Packets sent to the socket from a callback are not batched */
+	if (!ofp_gro.depth || sock_event_raising) {
+		sock_event_raise(so->so_number, &pkt, 1);
+		return;
+	}
+
+	for (i = 0; i < ofp_sock_event_num; i++)
+		if (sock_event[i].fd == so->so_number) {
+			se = &sock_event[i];
+			break;
+		}
+
+	if (!se) {
+		if (ofp_sock_event_num == OFP_SOCK_EVENT_SOCKETS)
+			ofp_sock_event_flush();
+		se = &sock_event[ofp_sock_event_num++];
+		se->fd = so->so_number;
+		se->num = 0;
+	} else if (se->num == OFP_SOCK_EVENT_BATCH) {
+		sock_event_raise(se->fd, se->pkt, se->num);
+		se->num = 0;
+	}
+
+	se->pkt[se->num++] = pkt;
+}
+
 int packet_accepted_as_event(struct socket *so, odp_packet_t pkt)
 {
 	struct ofp_sigevent *ev;
@@ -75,6 +173,14 @@ int packet_accepted_as_event(struct socket *so, odp_packet_t pkt)
 
 	ev = &so->so_sigevent;
 
+	if (ev->ofp_sigev_notify == OFP_SIGEV_BATCH) {
+		sock_event_queue(so, pkt);
+		return 1;
+	}
+
+	if (ev->ofp_sigev_notify == OFP_SIGEV_QUEUE)
+		return !ofp_sock_event_enqueue(so, so, OFP_EVENT_RECV, pkt);
+
 	if (ev->ofp_sigev_notify) {
 		union ofp_sigval sv;
 		struct ofp_sock_sigval ss;
@@ -84,6 +190,8 @@ int packet_accepted_as_event(struct socket *so, odp_packet_t pkt)
 		ss.pkt = pkt;
 		ss.event = OFP_EVENT_RECV;
 		ss.sockfd = so->so_number;
+		ss.pkts = &ss.pkt;
+		ss.num = 1;
 
 		so->so_state |= SS_EVENT;
 		ev->ofp_sigev_notify_function(sv);
@@ -102,20 +210,111 @@ static int packet_accepted_as_event_locked(struct sockbuf *sb, odp_packet_t pkt)
 	return packet_accepted_as_event(so, pkt);
 }
 
+/*
+ * Take a ring for the first packet of an empty socket buffer: a small
+ * one of SOCKBUF_LEN packets, or a large one if the small rings are
+ * exhausted. Returns 0 if there is no ring.
+ */
+static int sbring_get(struct sockbuf *sb)
+{
+	int len = SOCKBUF_LEN;
+
+	sb->sb_mb = ofp_socket_ring_alloc(len);
+	if (sb->sb_mb == NULL) {
+		len = ofp_socket_ring_len();
+		if (len <= SOCKBUF_LEN)
+			return 0;
+		sb->sb_mb = ofp_socket_ring_alloc(len);
+		if (sb->sb_mb == NULL)
+			return 0;
+	}
+	sb->sb_size = len;
+	sb->sb_put = 0;
+	sb->sb_get = 0;
+	return 1;
+}
+
+/*
+ * Return the ring of a drained socket buffer to its pool. An idle
+ * socket holds no ring.
+ */
+static void sbring_put(struct sockbuf *sb)
+{
+	if (sb->sb_mb == NULL || sb->sb_get != sb->sb_put)
+		return;
+
+	ofp_socket_ring_free(sb->sb_mb, sb->sb_size);
+	ofp_sbinit(sb);
+	sb->sb_sndptr = -1;
+	sb->sb_sndptroff = 0;
+}
+
+/*
+ * Move the queued packets from a small ring to a large ring from the
+ * socket memory. Returns 0 if the ring cannot grow.
+ */
+static int sbgrow(struct sockbuf *sb)
+{
+	odp_packet_t *ring, *old = sb->sb_mb;
+	int n = 0;
+
+	if (sb->sb_size != SOCKBUF_LEN || ofp_socket_ring_len() <= SOCKBUF_LEN)
+		return 0;
+
+	ring = ofp_socket_ring_alloc(ofp_socket_ring_len());
+	if (ring == NULL)
+		return 0;
+
+	if (sb->sb_sndptr >= 0)
+		sb->sb_sndptr = (sb->sb_sndptr - sb->sb_get + sb->sb_size) %
+			sb->sb_size;
+
+	while (sb->sb_get != sb->sb_put) {
+		ring[n++] = sb->sb_mb[sb->sb_get];
+		if (++sb->sb_get >= sb->sb_size)
+			sb->sb_get = 0;
+	}
+
+	ofp_socket_ring_free(old, SOCKBUF_LEN);
+	sb->sb_mb = ring;
+	sb->sb_size = ofp_socket_ring_len();
+	sb->sb_get = 0;
+	sb->sb_put = n;
+	return 1;
+}
+
+/* The ring is taken with the first packet, sbspace() counts a small one */
+void ofp_sbinit(struct sockbuf *sb)
+{
+	sb->sb_mb = NULL;
+	sb->sb_size = SOCKBUF_LEN;
+	sb->sb_put = 0;
+	sb->sb_get = 0;
+}
+
 int ofp_sockbuf_put_last(struct sockbuf *sb, odp_packet_t pkt)
 {
 	/* Offer to event function */
 	if (packet_accepted_as_event_locked(sb, pkt))
 		return 0;
 
+	if (odp_unlikely(sb->sb_mb == NULL) && !sbring_get(sb)) {
+		ofp_sockbuf_packet_free(pkt);
+		OFP_ERR("No socket buffer ring");
+		return -1;
+	}
+
 	int next = sb->sb_put + 1;
-	if (next >= SOCKBUF_LEN)
+	if (next >= sb->sb_size)
 		next = 0;
 
 	if (next == sb->sb_get) {
-		ofp_sockbuf_packet_free(pkt);
-		OFP_ERR("No more room, next=%d", next);
-		return -1;
+		if (sb->sb_cc >= sb->sb_hiwat || !sbgrow(sb)) {
+			ofp_sockbuf_packet_free(pkt);
+			OFP_ERR("No more room, next=%d", next);
+			return -1;
+		}
+		next = sb->sb_put + 1;
 	}
 
 	sb->sb_mb[sb->sb_put] = pkt;
@@ -138,8 +337,9 @@ odp_packet_t ofp_sockbuf_remove_first(struct sockbuf *sb)
 
 	if (sb->sb_get != sb->sb_put) {
 		pkt = sb->sb_mb[sb->sb_get];
-		if (++sb->sb_get >= SOCKBUF_LEN)
+		if (++sb->sb_get >= sb->sb_size)
 			sb->sb_get = 0;
+		sbring_put(sb);
 	}
 	return pkt;
 }
@@ -149,15 +349,139 @@ void ofp_sockbuf_packet_free(odp_packet_t pkt)
 	odp_packet_free(pkt);
 }
 
-void ofp_sockbuf_copy_out(struct sockbuf *sb, int off, int len, char *dst)
+/*
+ * OFP_SO_RXRING. The producer is the protocol input with the sockbuf
+ * locked, the consumer the one reader holding sblock. Under the sockbuf
+ * lock the consumer also refills the ring from sb_mb; the producer does
+ * not touch the ring then, since sb_mb is not empty.
+ */
+static int sbrx_push(struct sockbuf *sb, odp_packet_t m)
+{
+	uint32_t put = odp_atomic_load_u32(&sb->sb_rxput);
+	uint32_t next = put + 1;
+
+	if (next == (uint32_t)sb->sb_rxsize)
+		next = 0;
+	if (next == odp_atomic_load_acq_u32(&sb->sb_rxget))
+		return 0;
+
+	sb->sb_rx[put] = m;
+	odp_atomic_add_u32(&sb->sb_rxcc, odp_packet_len(m));
+	odp_atomic_store_rel_u32(&sb->sb_rxput, next);
+	return 1;
+}
+
+int ofp_sbrx_enable(struct sockbuf *sb, int on)
+{
+	int len = ofp_socket_ring_len();
+
+	SOCKBUF_LOCK_ASSERT(sb);
+
+	if (!on) {
+		if (sb->sb_rx == NULL)
+			return 0;
+		if (ofp_sbrx_used(sb))
+			return OFP_EBUSY;
+		ofp_socket_ring_free(sb->sb_rx, sb->sb_rxsize);
+		sb->sb_rx = NULL;
+		return 0;
+	}
+	if (sb->sb_rx)
+		return 0;
+
+	sb->sb_rx = len > SOCKBUF_LEN ? ofp_socket_ring_alloc(len) : NULL;
+	if (sb->sb_rx == NULL) {
+		len = SOCKBUF_LEN;
+		sb->sb_rx = ofp_socket_ring_alloc(len);
+		if (sb->sb_rx == NULL)
+			return OFP_ENOBUFS;
+	}
+	sb->sb_rxsize = len;
+	odp_atomic_init_u32(&sb->sb_rxput, 0);
+	odp_atomic_init_u32(&sb->sb_rxget, 0);
+	odp_atomic_init_u32(&sb->sb_rxcc, 0);
+	sb->sb_rxrcvd = 0;
+	return 0;
+}
+
+int ofp_sbrx_refill_locked(struct sockbuf *sb)
+{
+	odp_packet_t m;
+
+	SOCKBUF_LOCK_ASSERT(sb);
+
+	while ((m = ofp_sockbuf_get_first(sb)) != ODP_PACKET_INVALID &&
+	       sbrx_push(sb, m)) {
+		sbfree(sb, m);
+		ofp_sockbuf_remove_first(sb);
+	}
+	return ofp_sbrx_used(sb);
+}
+
+odp_packet_t ofp_sbrx_first(struct sockbuf *sb)
+{
+	uint32_t get = odp_atomic_load_u32(&sb->sb_rxget);
+
+	if (get == odp_atomic_load_acq_u32(&sb->sb_rxput)) {
+		/* Unlocked peek, the caller waits under the lock anyway */
+		if (sb->sb_get == sb->sb_put)
+			return ODP_PACKET_INVALID;
+		SOCKBUF_LOCK(sb);
+		ofp_sbrx_refill_locked(sb);
+		SOCKBUF_UNLOCK(sb);
+		if (get == odp_atomic_load_acq_u32(&sb->sb_rxput))
+			return ODP_PACKET_INVALID;
+	}
+	return sb->sb_rx[get];
+}
+
+void ofp_sbrx_take(struct sockbuf *sb, uint32_t len)
+{
+	uint32_t get = odp_atomic_load_u32(&sb->sb_rxget);
+	odp_packet_t m = sb->sb_rx[get];
+
+	odp_atomic_sub_u32(&sb->sb_rxcc, len);
+	sb->sb_rxrcvd += len;
+	OFP_TRACEPOINT(sock_dequeue, sb, len,
+		       odp_atomic_load_u32(&sb->sb_rxcc));
+	if (len < odp_packet_len(m)) {
+		if (ofp_packet_drop_head(&m, len))
+			OFP_ERR("Dropping %u bytes of a packet failed", len);
+		sb->sb_rx[get] = m;
+		return;
+	}
+	if (++get == (uint32_t)sb->sb_rxsize)
+		get = 0;
+	odp_atomic_store_rel_u32(&sb->sb_rxget, get);
+}
+
+static void sbrx_flush(struct sockbuf *sb)
+{
+	uint32_t get;
+
+	if (sb->sb_rx == NULL)
+		return;
+
+	get = odp_atomic_load_u32(&sb->sb_rxget);
+	while (get != odp_atomic_load_u32(&sb->sb_rxput)) {
+		odp_packet_free(sb->sb_rx[get]);
+		if (++get == (uint32_t)sb->sb_rxsize)
+			get = 0;
+	}
+	ofp_socket_ring_free(sb->sb_rx, sb->sb_rxsize);
+	sb->sb_rx = NULL;
+}
+
+void ofp_sockbuf_copy_out(struct sockbuf *sb, int off, int len,
+			  odp_packet_t dst, uint32_t dstoff)
 {
-	int i = sb->sb_get, dstoff = 0;
+	int i = sb->sb_get;
 
 	while (i != sb->sb_put) {
 		int plen = odp_packet_len(sb->sb_mb[i]);
 		if (off >= plen) {
 			off -= plen;
-			if (++i >= SOCKBUF_LEN)
+			if (++i >= sb->sb_size)
 				i = 0;
 		} else
 			break;
@@ -167,12 +491,12 @@ void ofp_sockbuf_copy_out(struct sockbuf *sb, int off, int len, char *dst)
 		int plen = odp_packet_len(sb->sb_mb[i]) - off;
 		if (plen > len)
 			plen = len;
-		odp_packet_copy_to_mem(sb->sb_mb[i], off, plen, dst + dstoff);
+		odp_packet_copy_from_pkt(dst, dstoff, sb->sb_mb[i], off, plen);
 		off = 0;
 		len -= plen;
 		dstoff += plen;
 
-		if (++i >= SOCKBUF_LEN)
+		if (++i >= sb->sb_size)
 			i = 0;
 	}
 }
@@ -194,13 +518,21 @@ ofp_sbappendaddr_locked(struct sockbuf *sb,
 	if (control != ODP_PACKET_INVALID)
 		odp_packet_free(control);
 
-	if (next >= SOCKBUF_LEN)
+	if (odp_unlikely(sb->sb_mb == NULL) && !sbring_get(sb)) {
+		OFP_ERR("No socket buffer ring");
+		return 0;
+	}
+
+	if (next >= sb->sb_size)
 		next = 0;
 
 	if (next == sb->sb_get) {
-		OFP_ERR("Buffers full, sb_get=%d max_num=%d",
-			  sb->sb_get, SOCKBUF_LEN);
-		return 0;
+		if (sb->sb_cc >= sb->sb_hiwat || !sbgrow(sb)) {
+			OFP_ERR("Buffers full, sb_get=%d max_num=%d",
+				  sb->sb_get, sb->sb_size);
+			return 0;
+		}
+		next = sb->sb_put + 1;
 	}
 
 	sb->sb_mb[sb->sb_put] = pkt;
@@ -217,9 +549,10 @@ sbflush_internal(struct sockbuf *sb)
 {
 	while (sb->sb_get != sb->sb_put) {
 		odp_packet_free(sb->sb_mb[sb->sb_get]);
-		if (++sb->sb_get >= SOCKBUF_LEN)
+		if (++sb->sb_get >= sb->sb_size)
 			sb->sb_get = 0;
 	}
+	sbring_put(sb);
 }
 
 void
@@ -249,6 +582,12 @@ ofp_sbappendstream_locked(struct sockbuf *sb, odp_packet_t m)
 
 	SBLASTMBUFCHK(sb);
 
+	if (sb->sb_rx && sb->sb_get == sb->sb_put && sbrx_push(sb, m)) {
+		OFP_TRACEPOINT(sock_enqueue, sb, odp_packet_len(m),
+			       odp_atomic_load_u32(&sb->sb_rxcc));
+		return;
+	}
+
 	sb->sb_lastrecord = sb->sb_put;
 	ofp_sbcompress(sb, m, sb->sb_mbtail);
 
@@ -268,6 +607,56 @@ ofp_sbappendstream(struct sockbuf *sb, odp_packet_t m)
 	SOCKBUF_UNLOCK(sb);
  }
 
+/*
+ * Coalesce a short segment of a receive buffer. The data is copied to
+ * the tailroom of the last packet of the buffer, or else to a packet of
+ * the pool of short packets if it came in a larger one, whose tailroom
+ * takes the next short segments. Returns ODP_PACKET_INVALID if the data
+ * was added to the last packet, otherwise the packet to queue.
+ */
+static odp_packet_t
+sbcoalesce(struct sockbuf *sb, odp_packet_t pkt)
+{
+	struct socket *so = sb->sb_socket;
+	uint32_t len = odp_packet_len(pkt);
+	uint32_t tlen;
+	odp_packet_t tail, copy;
+
+	/* Event sockets and timestamps see each packet */
+	if (!so || sb != &so->so_rcv || (sb->sb_flags & SB_NOCOALESCE) ||
+	    so->so_sigevent.ofp_sigev_notify || so->so_timestamping || !len)
+		return pkt;
+
+	if (sb->sb_get != sb->sb_put) {
+		tail = sb->sb_mb[(sb->sb_put ? sb->sb_put : sb->sb_size) - 1];
+		tlen = odp_packet_len(tail);
+		if (odp_packet_tailroom(tail) >= len && !odp_packet_has_ref(tail) &&
+		    odp_packet_push_tail(tail, len) != NULL) {
+			if (odp_packet_copy_from_pkt(tail, tlen, pkt, 0, len)) {
+				odp_packet_pull_tail(tail, len);
+				return pkt;
+			}
+			sb->sb_cc += len;
+			odp_packet_free(pkt);
+			return ODP_PACKET_INVALID;
+		}
+	}
+
+	if (len > ofp_packet_small_len ||
+	    odp_packet_pool(pkt) == ofp_packet_pool_small)
+		return pkt;
+
+	copy = ofp_packet_alloc_from_pool(ofp_packet_pool_small, len);
+	if (copy == ODP_PACKET_INVALID)
+		return pkt;
+	if (odp_packet_copy_from_pkt(copy, 0, pkt, 0, len)) {
+		odp_packet_free(copy);
+		return pkt;
+	}
+	odp_packet_free(pkt);
+	return copy;
+}
+
 /*
  * Append the data in mbuf chain (m) into the socket buffer sb following mbuf
  * (n).  If (n) is NULL, the buffer is presumed empty.
@@ -293,6 +682,12 @@ ofp_sbcompress(struct sockbuf *sb, odp_packet_t pkt, int n)
 {
 	(void)n;
 	SOCKBUF_LOCK_ASSERT(sb);
+
+	if (odp_packet_len(pkt) <= (uint32_t)sb_coalesce) {
+		pkt = sbcoalesce(sb, pkt);
+		if (pkt == ODP_PACKET_INVALID)
+			return;
+	}
 	ofp_sockbuf_put_last(sb, pkt);
 }
 
@@ -311,7 +706,12 @@ sbdrop_internal(struct sockbuf *sb, int len)
 
 		int buflen = odp_packet_len(pkt);
 		if (buflen > len) {
-			odp_packet_pull_head(pkt, len);
+			if (ofp_packet_drop_head(&pkt, len)) {
+				OFP_ERR("Dropping %d bytes of a packet failed",
+					len);
+				break;
+			}
+			sb->sb_mb[sb->sb_get] = pkt;
 			sb->sb_cc -= len;
 			if (sb->sb_sndptroff != 0)
 				sb->sb_sndptroff -= len;
@@ -403,8 +803,12 @@ ofp_sbwait(struct sockbuf *sb)
 {
 	SOCKBUF_LOCK_ASSERT(sb);
 
+	if (sb->sb_busy_poll)
+		return (ofp_busy_poll(sb->sb_busy_poll, SOCKBUF_MTX(sb),
+				      1000000UL/HZ*sb->sb_timeo));
+
 	sb->sb_flags |= SB_WAIT;
-	return (ofp_msleep(&sb->sb_cc, &sb->sb_mtx,
+	return (ofp_msleep(&sb->sb_cc, SOCKBUF_MTX(sb),
 			     0 /*HJo (sb->sb_flags & SB_NOINTR) ? PSOCK : PSOCK | PCATCH*/,
 			     "sbwait",
 			     1000000UL/HZ*sb->sb_timeo));
@@ -442,10 +846,14 @@ ofp_sbunlock(struct sockbuf *sb)
 void
 ofp_sowakeup(struct socket *so, struct sockbuf *sb)
 {
-	(void)so;
+	int ret = SU_OK;
 
 	SOCKBUF_LOCK_ASSERT(sb);
 
+	if (so->so_epoll_count)
+		ofp_epoll_notify(so, sb == &so->so_rcv ?
+				 OFP_EPOLLIN : OFP_EPOLLOUT);
+
 	/*HJo selwakeuppri(&sb->sb_sel, PSOCK);*/
 	ofp_wakeup(NULL);
 #if 0
@@ -456,25 +864,25 @@ ofp_sowakeup(struct socket *so, struct sockbuf *sb)
 	if (sb->sb_flags & SB_WAIT) {
 		ofp_wakeup(&sb->sb_cc);
 	}
-#if 0
-	KNOTE_LOCKED(&sb->sb_sel.si_note, 0);
+	/* Accept filter of a connection not yet accepted */
 	if (sb->sb_upcall != NULL) {
-		ret = sb->sb_upcall(so, sb->sb_upcallarg, M_DONTWAIT);
+		ret = sb->sb_upcall(so, sb->sb_upcallarg, 0);
 		if (ret == SU_ISCONNECTED) {
 			KASSERT(sb == &so->so_rcv,
 			    ("OFP_SO_SND upcall returned SU_ISCONNECTED"));
 			ofp_soupcall_clear(so, OFP_SO_RCV);
 		}
-	} else
-		ret = SU_OK;
+	}
+#if 0
+	KNOTE_LOCKED(&sb->sb_sel.si_note, 0);
 	if (sb->sb_flags & SB_AIO)
 		aio_swake(so, sb);
 #endif
 
 	SOCKBUF_UNLOCK(sb);
-#if 0
 	if (ret == SU_ISCONNECTED)
 		ofp_soisconnected(so);
+#if 0
 	if ((so->so_state & SS_ASYNC) && so->so_sigio != NULL)
 		pgsigio(&so->so_sigio, SIGIO, 0);
 	mtx_assert(SOCKBUF_MTX(sb), MA_NOTOWNED);
@@ -505,13 +913,78 @@ ofp_sbreserve_locked(struct sockbuf *sb, uint64_t cc, struct socket *so,
 		(int64_t)SB_MAX * global_param->pkt_pool.buffer_size / (MSIZE + mclbytes); /* adjusted ofp_sb_max */
 	if (cc > ofp_sb_max_adj)
 		return (0);
+	/* An explicit size ends autosizing */
+	if (sb->sb_autobase) {
+		ofp_socket_auto_mem_put(sb->sb_hiwat - sb->sb_autobase);
+		sb->sb_autobase = 0;
+	}
 	sb->sb_hiwat = cc;
 	sb->sb_mbmax = min(cc * sb_efficiency, ofp_sb_max);
+	if (cc > (SOCKBUF_LEN - 1) * (uint64_t)mclbytes)
+		(void)sbgrow(sb);
 	if (sb->sb_lowat > (int)sb->sb_hiwat)
 		sb->sb_lowat = sb->sb_hiwat;
 	return (1);
 }
 
+/*
+ * Grow an autosized buffer to cc bytes. The size is bounded by the
+ * packets of a large ring, of seg bytes each, and the growth beyond the
+ * initial size is counted against global_param->sockbuf.auto_mem_kb.
+ * Returns 0 when the buffer cannot grow any further; a buffer held back
+ * by the global limit may grow when memory is released.
+ */
+int
+ofp_sbautosize_locked(struct sockbuf *sb, uint32_t cc, uint32_t seg)
+{
+	int len = ofp_socket_ring_len();
+	uint32_t max;
+
+	SOCKBUF_LOCK_ASSERT(sb);
+
+	if (len < SOCKBUF_LEN)
+		len = SOCKBUF_LEN;
+	max = (len - 1) * seg;
+	if (cc > max)
+		cc = max;
+	if (cc <= sb->sb_hiwat)
+		return (0);
+	if (!ofp_socket_auto_mem_get(cc - sb->sb_hiwat))
+		return (1);
+
+	if (!sb->sb_autobase)
+		sb->sb_autobase = sb->sb_hiwat;
+	sb->sb_hiwat = cc;
+	sb->sb_mbmax = min(cc * sb_efficiency, ofp_sb_max);
+	return (1);
+}
+
+/*
+ * Shrink an empty autosized buffer towards its initial size, but not
+ * below floor bytes. Called when the connection goes idle.
+ */
+void
+ofp_sbautoshrink_locked(struct sockbuf *sb, uint32_t floor)
+{
+	uint32_t cc;
+
+	SOCKBUF_LOCK_ASSERT(sb);
+
+	if (sb->sb_cc || sb->sb_get != sb->sb_put)
+		return;
+
+	if (sb->sb_autobase) {
+		cc = floor > sb->sb_autobase ? floor : sb->sb_autobase;
+		if (cc < sb->sb_hiwat) {
+			ofp_socket_auto_mem_put(sb->sb_hiwat - cc);
+			sb->sb_hiwat = cc;
+			sb->sb_mbmax = min(cc * sb_efficiency, ofp_sb_max);
+		}
+		if (sb->sb_hiwat == sb->sb_autobase)
+			sb->sb_autobase = 0;
+	}
+}
+
 int
 ofp_sbreserve(struct sockbuf *sb, uint64_t cc, struct socket *so,
     struct thread *td)
@@ -592,6 +1065,11 @@ ofp_sbrelease_internal(struct sockbuf *sb, struct socket *so)
 	(void)so;
 
 	sbflush_internal(sb);
+	sbrx_flush(sb);
+	if (sb->sb_autobase) {
+		ofp_socket_auto_mem_put(sb->sb_hiwat - sb->sb_autobase);
+		sb->sb_autobase = 0;
+	}
 #if 0 /* HJo */
 	(void)chgsbsize(so->so_cred->cr_uidinfo, &sb->sb_hiwat, 0,
 	    RLIM_INFINITY);
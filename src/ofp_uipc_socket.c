@@ -106,6 +106,8 @@
 #include <unistd.h>
 #include <stddef.h>
 #include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include <odp_api.h>
 
@@ -133,16 +135,82 @@
 #include "ofpi_callout.h"
 #include "ofpi_log.h"
 #include "ofpi_pkt_processing.h"
+#include "ofpi_epoll.h"
+#include "ofpi_lockstat.h"
+#include "ofpi_coroutine.h"
+#include "ofpi_ktls.h"
 
 #define SHM_NAME_SOCKET "OfpSocketShMem"
 
+/*
+ * Placed after struct ofp_socket_mem: the two readiness maps, the
+ * sockets, the sleepers and the small and large socket buffer rings.
+ */
+#define SOCKET_MAX ((uint64_t)global_param->socket_max)
+#define SO_READY_SIZE ROUNDUP_CACHE(SOCKET_MAX / 8 + 1)
+#define SOCKET_LIST_SIZE ROUNDUP_CACHE(SOCKET_MAX * sizeof(struct socket))
+#define SLEEPER_LIST_SIZE ROUNDUP_CACHE(SOCKET_MAX * sizeof(struct sleeper))
+#define SB_RING_SIZE(len) (sizeof(struct sb_ring) + (len) * sizeof(odp_packet_t))
+#define SB_SMALL_RINGS (global_param->sockbuf.small_rings > 0 ? \
+			(uint64_t)global_param->sockbuf.small_rings : \
+			2 * SOCKET_MAX)
+#define SB_SMALL_RING_MEM (SB_SMALL_RINGS * SB_RING_SIZE(SOCKBUF_LEN))
+#define SB_LARGE_RING_MEM ((uint64_t)global_param->sockbuf.rings * \
+			   SB_RING_SIZE(global_param->sockbuf.ring_len))
+#define SHM_SIZE_SOCKET (sizeof(*shm) + 2 * SO_READY_SIZE + \
+			 SOCKET_LIST_SIZE + SLEEPER_LIST_SIZE + \
+			 SB_SMALL_RING_MEM + SB_LARGE_RING_MEM)
+
+#define SLEEP_HASH_BITS 8
+#define SLEEP_HASH_SIZE (1 << SLEEP_HASH_BITS)
+#define SLEEP_HASH(ch) \
+	((uint32_t)(((uintptr_t)(ch) >> 3) * 0x9e3779b1) >> (32 - SLEEP_HASH_BITS))
+
+/* Sockets moved at a time between a thread cache and the free list */
+#define SO_CACHE_BULK 16
+
+struct sb_ring {
+	struct sb_ring *next;
+	odp_packet_t pkt[];
+};
+
+/*
+ * Free sockets cached by a thread. The lock is taken by others only
+ * to steal a socket when the free list is empty.
+ */
+struct so_cache {
+	odp_spinlock_t lock;
+	struct socket *list;
+	int num;
+} ODP_ALIGNED_CACHE;
+
 /*
  * Shared data
  */
+struct sleeper {
+	struct sleeper *next;
+	void *channel;
+	const char *wmesg;
+	/* Futex word, set when woken up */
+	int   go;
+	int   parked;
+	uint32_t gen;
+	odp_timer_t tmo;
+	int woke_by_timer;
+};
+
+/*
+ * The free lists are built lazily: an element is fetched from its
+ * list or, if the list is empty, the first never used element below
+ * the high water mark is taken. Only struct ofp_socket_mem and the
+ * readiness maps are cleared at init, the big arrays after them are
+ * touched when they are needed.
+ */
 struct ofp_socket_mem {
-	struct socket socket_list[OFP_NUM_SOCKETS_MAX];
 	struct socket *free_sockets;
-	int sockets_allocated, max_sockets_allocated;
+	odp_atomic_u32_t sockets_allocated, max_sockets_allocated;
+	/* Read without a lock to resolve descriptors */
+	odp_atomic_u32_t socket_high;
 	int socket_zone;
 
 	odp_rwlock_t so_global_mtx;
@@ -150,17 +218,46 @@ struct ofp_socket_mem {
 	int somaxconn;
 	odp_pool_t pool;
 
-	struct sleeper {
-		struct sleeper *next;
-		void *channel;
-		const char *wmesg;
-		int   go;
-		odp_timer_t tmo;
-		int woke_by_timer;
-	} *sleep_list;
-	struct sleeper sleeper_list[OFP_NUM_SOCKETS_MAX];
 	struct sleeper *free_sleepers;
+	int sleeper_high;
 	odp_spinlock_t sleep_lock;
+	int sleep_park;
+
+	/* Sleepers hashed by channel */
+	struct sleep_bucket {
+		struct sleeper *list;
+		odp_spinlock_t lock;
+	} sleep_hash[SLEEP_HASH_SIZE] ODP_ALIGNED_CACHE;
+
+	/* Socket buffer rings, small ones first, then large ones */
+	struct sb_ring_pool {
+		odp_spinlock_t lock;
+		struct sb_ring *free;
+		uint8_t *mem;
+		uint64_t high;
+		uint64_t num;
+		int len;
+	} sb_ring[2] ODP_ALIGNED_CACHE;
+
+	/* Growth of autosized buffers beyond their initial size */
+	odp_atomic_u64_t sb_auto_mem;
+	uint64_t sb_auto_max;
+
+	struct so_cache so_cache[ODP_THREAD_COUNT_MAX];
+
+	/*
+	 * Sockets that may be ready for receive and send, a bit per
+	 * descriptor as in ofp_fd_set. Wakeups set the bits, select and
+	 * poll clear the bits of the sockets found not ready.
+	 */
+	uint8_t *so_ready[2];
+	/* Threads in select or poll, woken up by all wakeups */
+	odp_atomic_u32_t select_waiters;
+
+	int socket_max;
+	struct socket *socket_list;
+	struct sleeper *sleeper_list;
+	uint8_t mem[] ODP_ALIGNED_CACHE;
 };
 
 /*
@@ -176,7 +273,7 @@ void ofp_print_long_counters(void);
 void ofp_print_sockets(void)
 {
 	int i;
-	for (i = 0; i < OFP_NUM_SOCKETS_MAX; i++) {
+	for (i = 0; i < (int)odp_atomic_load_u32(&shm->socket_high); i++) {
 		struct socket *so = &shm->socket_list[i];
 		if (!so->so_proto)
 			continue;
@@ -185,11 +282,13 @@ void ofp_print_sockets(void)
 			  so->so_snd.sb_put, so->so_snd.sb_get);
 	}
 
-	struct sleeper *s = shm->sleep_list;
-	while (s) {
-		OFP_INFO("Sleeper %s, tmo=%x go=%d timer=%d",
-			  s->wmesg, s->tmo, s->go, s->woke_by_timer);
-		s = s->next;
+	for (i = 0; i < SLEEP_HASH_SIZE; i++) {
+		struct sleeper *s = shm->sleep_hash[i].list;
+		while (s) {
+			OFP_INFO("Sleeper %s, tmo=%x go=%d timer=%d",
+				  s->wmesg, s->tmo, s->go, s->woke_by_timer);
+			s = s->next;
+		}
 	}
 	print_open_conns();
 }
@@ -204,9 +303,81 @@ void f_sockets(struct cli_conn *conn, const char *s)
 
 odp_packet_t ofp_socket_packet_alloc(uint32_t len)
 {
+	odp_packet_t pkt;
+
+	if (len <= ofp_packet_small_len) {
+		pkt = ofp_packet_alloc_from_pool(ofp_packet_pool_small, len);
+		if (odp_likely(pkt != ODP_PACKET_INVALID))
+			return pkt;
+	}
 	return ofp_packet_alloc_from_pool(shm->pool, len);
 }
 
+/*
+ * Socket buffer rings of two size classes: small rings of SOCKBUF_LEN
+ * packets, taken by a socket buffer with its first packet and returned
+ * when it drains, and large rings for buffers that outgrow them.
+ */
+static inline struct sb_ring_pool *sb_ring_pool(int len)
+{
+	return &shm->sb_ring[len != SOCKBUF_LEN];
+}
+
+odp_packet_t *ofp_socket_ring_alloc(int len)
+{
+	struct sb_ring_pool *rp = sb_ring_pool(len);
+	struct sb_ring *ring;
+
+	odp_spinlock_lock(&rp->lock);
+	ring = rp->free;
+	if (ring)
+		rp->free = ring->next;
+	else if (rp->high < rp->num)
+		ring = (struct sb_ring *)
+			&rp->mem[rp->high++ * SB_RING_SIZE(rp->len)];
+	odp_spinlock_unlock(&rp->lock);
+
+	return ring ? ring->pkt : NULL;
+}
+
+void ofp_socket_ring_free(odp_packet_t *pkt, int len)
+{
+	struct sb_ring_pool *rp = sb_ring_pool(len);
+	struct sb_ring *ring = (struct sb_ring *)
+		((uint8_t *)pkt - offsetof(struct sb_ring, pkt));
+
+	odp_spinlock_lock(&rp->lock);
+	ring->next = rp->free;
+	rp->free = ring;
+	odp_spinlock_unlock(&rp->lock);
+}
+
+int ofp_socket_ring_len(void)
+{
+	return shm->sb_ring[1].len;
+}
+
+/*
+ * Account bytes of autosized socket buffer growth. Returns 0 if the
+ * growth would exceed the global limit.
+ */
+int ofp_socket_auto_mem_get(uint32_t bytes)
+{
+	uint64_t old = odp_atomic_load_u64(&shm->sb_auto_mem);
+
+	do {
+		if (old + bytes > shm->sb_auto_max)
+			return 0;
+	} while (!odp_atomic_cas_u64(&shm->sb_auto_mem, &old, old + bytes));
+
+	return 1;
+}
+
+void ofp_socket_auto_mem_put(uint32_t bytes)
+{
+	odp_atomic_sub_u64(&shm->sb_auto_mem, bytes);
+}
+
 odp_rwlock_t *ofp_accept_mtx(void)
 {
 	return &shm->ofp_accept_mtx;
@@ -224,7 +395,7 @@ void ofp_accept_unlock(void)
 
 static int ofp_socket_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_SOCKET, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_SOCKET, SHM_SIZE_SOCKET);
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -257,30 +428,53 @@ int ofp_socket_lookup_shared_memory(void)
 
 void ofp_socket_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_SOCKET, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_SOCKET, SHM_SIZE_SOCKET);
 }
 
 int ofp_socket_init_global(odp_pool_t pool)
 {
 	uint32_t i;
 
+	if (global_param->socket_max <= 0) {
+		OFP_ERR("Invalid socket_max %d", global_param->socket_max);
+		return -1;
+	}
+
 	HANDLE_ERROR(ofp_socket_alloc_shared_memory());
 
-	memset(shm, 0, sizeof(*shm));
+	memset(shm, 0, sizeof(*shm) + 2 * SO_READY_SIZE);
 	shm->pool = ODP_POOL_INVALID;
 
-	for (i = 0; i < OFP_NUM_SOCKETS_MAX; i++) {
-		shm->socket_list[i].next = (i == OFP_NUM_SOCKETS_MAX - 1) ?
-			NULL : &(shm->socket_list[i+1]);
-		shm->socket_list[i].so_number = i + OFP_SOCK_NUM_OFFSET;
-	}
-	shm->free_sockets = &(shm->socket_list[0]);
-
-	for (i = 0; i < OFP_NUM_SOCKETS_MAX; i++) {
-		shm->sleeper_list[i].next = (i == OFP_NUM_SOCKETS_MAX - 1) ?
-			NULL : &(shm->sleeper_list[i+1]);
-	}
-	shm->free_sleepers = &(shm->sleeper_list[0]);
+	shm->socket_max = global_param->socket_max;
+	shm->so_ready[0] = shm->mem;
+	shm->so_ready[1] = shm->so_ready[0] + SO_READY_SIZE;
+	shm->socket_list = (struct socket *)(shm->so_ready[1] + SO_READY_SIZE);
+	shm->sleeper_list = (struct sleeper *)
+		((uint8_t *)shm->socket_list + SOCKET_LIST_SIZE);
+	shm->sb_ring[0].mem = (uint8_t *)shm->sleeper_list + SLEEPER_LIST_SIZE;
+	shm->sb_ring[1].mem = shm->sb_ring[0].mem + SB_SMALL_RING_MEM;
+
+	odp_atomic_init_u32(&shm->sockets_allocated, 0);
+	odp_atomic_init_u32(&shm->max_sockets_allocated, 0);
+	odp_atomic_init_u32(&shm->socket_high, 0);
+	odp_atomic_init_u32(&shm->select_waiters, 0);
+	for (i = 0; i < ODP_THREAD_COUNT_MAX; i++)
+		odp_spinlock_init(&shm->so_cache[i].lock);
+
+	odp_spinlock_init(&shm->sb_ring[0].lock);
+	shm->sb_ring[0].len = SOCKBUF_LEN;
+	shm->sb_ring[0].num = SB_SMALL_RINGS;
+	odp_spinlock_init(&shm->sb_ring[1].lock);
+	shm->sb_ring[1].len = global_param->sockbuf.ring_len;
+	shm->sb_ring[1].num = shm->sb_ring[1].len > SOCKBUF_LEN ?
+		(uint64_t)global_param->sockbuf.rings : 0;
+	odp_atomic_init_u64(&shm->sb_auto_mem, 0);
+	shm->sb_auto_max = global_param->sockbuf.auto_mem_kb > 0 ?
+		(uint64_t)global_param->sockbuf.auto_mem_kb * 1024 : 0;
+
+	for (i = 0; i < SLEEP_HASH_SIZE; i++)
+		odp_spinlock_init(&shm->sleep_hash[i].lock);
+	shm->sleep_park = global_param->sleep_park;
 
 	shm->somaxconn = SOMAXCONN;
 	shm->pool = pool;
@@ -291,21 +485,26 @@ int ofp_socket_init_global(odp_pool_t pool)
 	return 0;
 }
 
+static void sleeper_go(struct sleeper *p);
+
 int ofp_socket_term_global(void)
 {
 	struct sleeper *p, *next;
 	int rc = 0;
+	int i;
 
-	p = shm->sleep_list;
-	while (p) {
-		next = p->next;
-		if (p->tmo != ODP_TIMER_INVALID) {
-			CHECK_ERROR(ofp_timer_cancel(p->tmo), rc);
-			p->tmo = ODP_TIMER_INVALID;
+	for (i = 0; i < SLEEP_HASH_SIZE; i++) {
+		p = shm->sleep_hash[i].list;
+		shm->sleep_hash[i].list = NULL;
+		while (p) {
+			next = p->next;
+			if (p->tmo != ODP_TIMER_INVALID) {
+				CHECK_ERROR(ofp_timer_cancel(p->tmo), rc);
+				p->tmo = ODP_TIMER_INVALID;
+			}
+			sleeper_go(p);
+			p = next;
 		}
-		p->go = 1;
-		p = next;
-
 	}
 
 	ofp_inet_term();
@@ -317,9 +516,187 @@ int ofp_socket_term_global(void)
 
 struct socket *ofp_get_sock_by_fd(int fd)
 {
+	/* Sockets above the high water mark have never been used */
+	if (fd < OFP_SOCK_NUM_OFFSET ||
+	    fd - OFP_SOCK_NUM_OFFSET >=
+	    (int)odp_atomic_load_acq_u32(&shm->socket_high))
+		return NULL;
 	return &shm->socket_list[fd - OFP_SOCK_NUM_OFFSET];
 }
 
+int ofp_socket_max(void)
+{
+	return shm->socket_max;
+}
+
+uint8_t *ofp_so_ready_map(int which)
+{
+	return shm->so_ready[which == OFP_SO_SND];
+}
+
+int ofp_so_ready_set(struct socket *so, int which)
+{
+	int i = so->so_number - OFP_SOCK_NUM_OFFSET;
+
+	__atomic_fetch_or(&shm->so_ready[which == OFP_SO_SND][i / 8],
+			  1 << (i % 8), __ATOMIC_SEQ_CST);
+	return odp_atomic_load_u32(&shm->select_waiters) != 0;
+}
+
+void ofp_so_select_wait(int enter)
+{
+	if (enter)
+		odp_atomic_inc_u32(&shm->select_waiters);
+	else
+		odp_atomic_dec_u32(&shm->select_waiters);
+}
+
+static struct so_cache *so_cache_get(void)
+{
+	int thr = odp_thread_id();
+
+	if (odp_unlikely(thr < 0 || thr >= ODP_THREAD_COUNT_MAX))
+		return NULL;
+	return &shm->so_cache[thr];
+}
+
+/*
+ * Move up to SO_CACHE_BULK sockets from the free list, or above the
+ * high water mark, to the cache. Called with the cache locked.
+ */
+static void so_cache_refill(struct so_cache *c)
+{
+	uint32_t high;
+	struct socket *so;
+
+	odp_rwlock_write_lock(&shm->so_global_mtx);
+	high = odp_atomic_load_u32(&shm->socket_high);
+	while (c->num < SO_CACHE_BULK) {
+		so = shm->free_sockets;
+		if (so) {
+			shm->free_sockets = so->next;
+		} else if (high < (uint32_t)shm->socket_max) {
+			so = &shm->socket_list[high];
+			so->so_number = high++ + OFP_SOCK_NUM_OFFSET;
+		} else {
+			break;
+		}
+		so->next = c->list;
+		c->list = so;
+		c->num++;
+	}
+	/* Publish the descriptor numbers before the new high water mark */
+	odp_atomic_store_rel_u32(&shm->socket_high, high);
+	odp_rwlock_write_unlock(&shm->so_global_mtx);
+}
+
+/* The free list and the thread's own cache are empty */
+static struct socket *so_cache_steal(struct so_cache *self)
+{
+	struct socket *so = NULL;
+	int i;
+
+	for (i = 0; i < ODP_THREAD_COUNT_MAX && !so; i++) {
+		struct so_cache *c = &shm->so_cache[i];
+
+		if (c == self || !c->num)
+			continue;
+		odp_spinlock_lock(&c->lock);
+		so = c->list;
+		if (so) {
+			c->list = so->next;
+			c->num--;
+		}
+		odp_spinlock_unlock(&c->lock);
+	}
+	return so;
+}
+
+static struct socket *so_getfree(void)
+{
+	struct so_cache *c = so_cache_get();
+	struct so_cache tmp;
+	struct socket *so;
+
+	if (odp_unlikely(!c)) {
+		/* Not an ODP thread: a cache of one that is used up */
+		tmp.list = NULL;
+		tmp.num = SO_CACHE_BULK - 1;
+		so_cache_refill(&tmp);
+		return tmp.list ? tmp.list : so_cache_steal(NULL);
+	}
+
+	odp_spinlock_lock(&c->lock);
+	if (!c->list)
+		so_cache_refill(c);
+	so = c->list;
+	if (so) {
+		c->list = so->next;
+		c->num--;
+	}
+	odp_spinlock_unlock(&c->lock);
+
+	if (odp_unlikely(!so))
+		so = so_cache_steal(c);
+	return so;
+}
+
+static void so_putfree_list(struct socket *first, struct socket *last)
+{
+	odp_rwlock_write_lock(&shm->so_global_mtx);
+	last->next = shm->free_sockets;
+	shm->free_sockets = first;
+	odp_rwlock_write_unlock(&shm->so_global_mtx);
+}
+
+static void so_putfree(struct socket *so)
+{
+	struct so_cache *c = so_cache_get();
+	struct socket *first = NULL, *last;
+	int i;
+
+	if (odp_unlikely(!c)) {
+		so_putfree_list(so, so);
+		return;
+	}
+
+	odp_spinlock_lock(&c->lock);
+	so->next = c->list;
+	c->list = so;
+	/* Keep one bulk for the next allocations and return another */
+	if (++c->num >= 2 * SO_CACHE_BULK) {
+		first = last = c->list;
+		for (i = 1; i < SO_CACHE_BULK; i++)
+			last = last->next;
+		c->list = last->next;
+		c->num -= SO_CACHE_BULK;
+	}
+	odp_spinlock_unlock(&c->lock);
+
+	if (first)
+		so_putfree_list(first, last);
+}
+
+void ofp_socket_term_local(void)
+{
+	struct so_cache *c = so_cache_get();
+	struct socket *first, *last;
+
+	if (!c)
+		return;
+
+	odp_spinlock_lock(&c->lock);
+	first = last = c->list;
+	while (last && last->next)
+		last = last->next;
+	c->list = NULL;
+	c->num = 0;
+	odp_spinlock_unlock(&c->lock);
+
+	if (first)
+		so_putfree_list(first, last);
+}
+
 /*
  * Get a socket structure from our zone, and initialize it.
  * Allocate socket and PCB at the same time.
@@ -328,25 +705,16 @@ struct socket *ofp_get_sock_by_fd(int fd)
  */
 static struct socket *soalloc(void)
 {
-#if 1
-	odp_rwlock_write_lock(&shm->so_global_mtx);
-	struct socket *so = shm->free_sockets;
-	if (shm->free_sockets) {
-		shm->free_sockets = shm->free_sockets->next;
-		shm->sockets_allocated++;
-		if (shm->sockets_allocated > shm->max_sockets_allocated)
-			shm->max_sockets_allocated = shm->sockets_allocated;
-	}
-	odp_rwlock_write_unlock(&shm->so_global_mtx);
-#else
-	struct socket *so = ofp_socket_pool_alloc(shm->socket_zone);
-#endif
+	struct socket *so = so_getfree();
 
 	if (so == NULL) {
 		OFP_ERR("Cannot allocate socket!");
 		return (NULL);
 	}
 
+	odp_atomic_max_u32(&shm->max_sockets_allocated,
+			   odp_atomic_fetch_inc_u32(&shm->sockets_allocated) + 1);
+
 	/* clean socket memory */
 	int	number = so->so_number;
 	memset(so, 0, sizeof(*so));
@@ -354,9 +722,15 @@ static struct socket *soalloc(void)
 
 	SOCKBUF_LOCK_INIT(&so->so_snd, "so_snd");
 	SOCKBUF_LOCK_INIT(&so->so_rcv, "so_rcv");
+	ofp_sbinit(&so->so_snd);
+	ofp_sbinit(&so->so_rcv);
 	odp_spinlock_init(&so->so_snd.sb_sx);
 	odp_spinlock_init(&so->so_rcv.sb_sx);
 
+	/* Checked once by the next select or poll */
+	ofp_so_ready_set(so, OFP_SO_RCV);
+	ofp_so_ready_set(so, OFP_SO_SND);
+
 	return (so);
 }
 
@@ -372,12 +746,10 @@ sodealloc(struct socket *so)
 	KASSERT(so->so_count == 0, ("sodealloc(): so_count %d", so->so_count));
 	KASSERT(so->so_pcb == NULL, ("sodealloc(): so_pcb != NULL"));
 
+	ofp_ktls_free(so);
 	so->so_proto = 0;
-	odp_rwlock_write_lock(&shm->so_global_mtx);
-	so->next = shm->free_sockets;
-	shm->free_sockets = so;
-	shm->sockets_allocated--;
-	odp_rwlock_write_unlock(&shm->so_global_mtx);
+	odp_atomic_dec_u32(&shm->sockets_allocated);
+	so_putfree(so);
 }
 
 /*
@@ -466,6 +838,13 @@ ofp_sonewconn(struct socket *head, int connstatus)
 	so->so_linger = head->so_linger;
 	so->so_state = head->so_state | SS_NOFDREF;
 	so->so_fibnum = head->so_fibnum;
+	so->so_max_pacing_rate = head->so_max_pacing_rate;
+	so->so_timestamping = head->so_timestamping;
+	so->so_busy_poll = head->so_busy_poll;
+	if (so->so_busy_poll.enable) {
+		so->so_rcv.sb_busy_poll = &so->so_busy_poll;
+		so->so_snd.sb_busy_poll = &so->so_busy_poll;
+	}
 	so->so_proto = head->so_proto;
 	//HJo so->so_cred = crhold(head->so_cred);
 	//knlist_init_mtx(&so->so_rcv.sb_sel.si_note, SOCKBUF_MTX(&so->so_rcv));
@@ -704,6 +1083,8 @@ ofp_soclose(struct socket *so)
 
 	KASSERT(!(so->so_state & SS_NOFDREF), ("ofp_soclose: SS_NOFDREF on enter"));
 
+	ofp_epoll_socket_close(so);
+
 	//funsetown(&so->so_sigio);
 	if (so->so_state & SS_ISCONNECTED) {
 		if ((so->so_state & SS_ISDISCONNECTING) == 0) {
@@ -796,6 +1177,7 @@ sorflush(struct socket *so)
 			sizeof(*sb) - offsetof(struct sockbuf, sb_startzero));
 	bzero(&sb->sb_startzero,
 			sizeof(*sb) - offsetof(struct sockbuf, sb_startzero));
+	ofp_sbinit(sb);
 	SOCKBUF_UNLOCK(sb);
 	ofp_sbunlock(sb);
 
@@ -923,6 +1305,78 @@ ofp_sodisconnect(struct socket *so)
 
 #define	SBLOCKWAIT(f)	(((f) & OFP_MSG_DONTWAIT) ? 0 : SBL_WAIT)
 
+#define SOMMSG_BURST 32
+
+/*
+ * Copy len bytes of pkt from off on to the iovecs of msg, return bytes
+ * copied
+ */
+static size_t
+msg_copyout(struct ofp_msghdr *msg, odp_packet_t pkt, uint32_t off,
+	    size_t len)
+{
+	size_t done = 0;
+	int i;
+
+	for (i = 0; i < msg->msg_iovlen && done < len; i++) {
+		size_t n = msg->msg_iov[i].iov_len;
+
+		if (n > len - done)
+			n = len - done;
+		odp_packet_copy_to_mem(pkt, off + done, n,
+				       msg->msg_iov[i].iov_base);
+		done += n;
+	}
+
+	return done;
+}
+
+/*
+ * Copy len bytes from the iovecs of uio to pkt at off, or from pkt to
+ * the iovecs if out is set, and advance uio past them. Returns bytes
+ * copied. uio_resid is left to the caller.
+ */
+static size_t
+uio_copy(struct uio *uio, odp_packet_t pkt, uint32_t off, size_t len,
+	 int out)
+{
+	size_t done = 0;
+
+	while (done < len && uio->uio_iovcnt > 0) {
+		struct ofp_iovec *iov = uio->uio_iov;
+		uint8_t *base = (uint8_t *)iov->iov_base + uio->uio_offset;
+		size_t n = iov->iov_len - uio->uio_offset;
+
+		if (n > len - done)
+			n = len - done;
+		if (out)
+			odp_packet_copy_to_mem(pkt, off + done, n, base);
+		else
+			odp_packet_copy_from_mem(pkt, off + done, n, base);
+		done += n;
+		uio->uio_offset += n;
+		if ((size_t)uio->uio_offset == iov->iov_len) {
+			uio->uio_iov++;
+			uio->uio_iovcnt--;
+			uio->uio_offset = 0;
+		}
+	}
+
+	return done;
+}
+
+static size_t
+msg_iov_len(const struct ofp_msghdr *msg)
+{
+	size_t len = 0;
+	int i;
+
+	for (i = 0; i < msg->msg_iovlen; i++)
+		len += msg->msg_iov[i].iov_len;
+
+	return len;
+}
+
 int
 ofp_sosend_dgram(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio,
 	     odp_packet_t top, odp_packet_t control, int flags, struct thread *td)
@@ -930,21 +1384,16 @@ ofp_sosend_dgram(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio,
 	long space = 0;
 	ofp_ssize_t resid;
 	int clen = 0, error, dontroute;
-	const uint8_t *data;
-	//size_t len;
 
 	KASSERT(so->so_type == OFP_SOCK_DGRAM, ("sodgram_send: !OFP_SOCK_DGRAM"));
 	KASSERT(so->so_proto->pr_flags & PR_ATOMIC,
 		("sodgram_send: !PR_ATOMIC"));
 
 
-	if (uio != NULL) {
-		data = uio->uio_iov->iov_base;
-		resid = uio->uio_iov->iov_len;
-	} else {
-		data = odp_packet_data(top);
+	if (uio != NULL)
+		resid = uio->uio_resid;
+	else
 		resid = odp_packet_len(top);
-	}
 
 	dontroute =
 	    (flags & OFP_MSG_DONTROUTE) && (so->so_options & OFP_SO_DONTROUTE) == 0;
@@ -994,7 +1443,6 @@ ofp_sosend_dgram(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio,
 	SOCKBUF_UNLOCK(&so->so_snd);
 
 	if (uio != NULL) {
-		uint8_t *p;
 		error = OFP_ENOBUFS;
 
 		top = ofp_socket_packet_alloc(resid);
@@ -1004,10 +1452,7 @@ ofp_sosend_dgram(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio,
 
 		error = 0;
 
-		p = odp_packet_data(top);
-
-		memcpy(p, data, resid);
-/*Bogdan: ToDo chain of buffers for multiple uio_iov*/
+		uio_copy(uio, top, 0, resid, 0);
 	}
 
 	resid = 0;
@@ -1061,6 +1506,112 @@ out:
 	return (error);
 }
 
+/*
+ * Send up to vlen datagrams. The socket state is checked once under
+ * the sockbuf lock. The packets are sent one after another and the
+ * collected output burst is sent at the end. The number of messages
+ * sent is returned in count. An error is returned only if no datagram
+ * was sent.
+ */
+int
+ofp_sosend_dgram_mmsg(struct socket *so, struct ofp_mmsghdr *msgvec,
+		      unsigned int vlen, int flags, struct thread *td,
+		      unsigned int *count)
+{
+	unsigned int n;
+	int error = 0;
+
+	(void)flags;
+
+	KASSERT(so->so_type == OFP_SOCK_DGRAM, ("sodgram_send: !OFP_SOCK_DGRAM"));
+
+	*count = 0;
+
+	SOCKBUF_LOCK(&so->so_snd);
+	if (so->so_snd.sb_state & SBS_CANTSENDMORE) {
+		SOCKBUF_UNLOCK(&so->so_snd);
+		return (OFP_EPIPE);
+	}
+	if (so->so_error) {
+		error = so->so_error;
+		so->so_error = 0;
+		SOCKBUF_UNLOCK(&so->so_snd);
+		return (error);
+	}
+	SOCKBUF_UNLOCK(&so->so_snd);
+
+	for (n = 0; n < vlen; n++) {
+		struct ofp_msghdr *msg = &msgvec[n].msg_hdr;
+		struct ofp_sockaddr *addr = msg->msg_name;
+		size_t len = msg_iov_len(msg);
+		odp_packet_t top;
+		size_t off;
+		int i;
+
+		if (addr == NULL && (so->so_state & SS_ISCONNECTED) == 0) {
+			error = OFP_EDESTADDRREQ;
+			break;
+		}
+
+		top = ofp_socket_packet_alloc(len);
+		if (top == ODP_PACKET_INVALID) {
+			error = OFP_ENOBUFS;
+			break;
+		}
+
+		for (i = 0, off = 0; i < msg->msg_iovlen; i++) {
+			odp_packet_copy_from_mem(top, off,
+						 msg->msg_iov[i].iov_len,
+						 msg->msg_iov[i].iov_base);
+			off += msg->msg_iov[i].iov_len;
+		}
+
+		error = (*so->so_proto->pr_usrreqs->pru_send)(so, 0, top,
+							      addr,
+							      ODP_PACKET_INVALID,
+							      td);
+		if (error)
+			break;
+
+		msgvec[n].msg_len = len;
+	}
+
+	ofp_send_pending_pkt();
+
+	*count = n;
+	return (n ? 0 : error);
+}
+
+/*
+ * Zero-copy send. The data of each packet is sent as is and the packets
+ * are consumed, including the ones that could not be sent. The number
+ * of packets sent is stored in count and an error is returned only if
+ * none was.
+ */
+int
+ofp_sosend_pkt(struct socket *so, odp_packet_t pkts[], int num, int flags,
+	       struct thread *td, int *count)
+{
+	int n, error = 0;
+
+	for (n = 0; n < num; n++) {
+		error = ofp_sosend(so, NULL, NULL, pkts[n], ODP_PACKET_INVALID,
+				   flags, td);
+		if (error)
+			break;
+	}
+	*count = n;
+
+	if (so->so_type == OFP_SOCK_DGRAM)
+		ofp_send_pending_pkt();
+
+	if (error)
+		for (n++; n < num; n++)
+			odp_packet_free(pkts[n]);
+
+	return (*count ? 0 : error);
+}
+
 /*
  * Send on a socket.  If send must go all at once and message is larger than
  * send buffering, then hard error.  Lock against other senders.  If must go
@@ -1082,6 +1633,7 @@ ofp_sosend_generic(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio
 	ofp_ssize_t resid;
 	int clen = 0, error, dontroute;
 	int atomic = sosendallatonce(so) || top;
+	long reserve;
 
 	if (uio != NULL)
 		resid = uio->uio_resid;
@@ -1115,6 +1667,8 @@ ofp_sosend_generic(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio
 	error = ofp_sblock(&so->so_snd, SBLOCKWAIT(flags));
 	if (error)
 		goto out;
+	/* Room for the header and trailer of a TLS record */
+	reserve = ofp_ktls_overhead(&so->so_tls);
 restart:
 
 	do {
@@ -1169,8 +1723,9 @@ restart:
 			goto release;
 		}
 
-		if (space < resid + clen &&
-		    (atomic || space < so->so_snd.sb_lowat || space < clen)) {
+		if (space < resid + clen + reserve &&
+		    (atomic || space < so->so_snd.sb_lowat ||
+		     space < clen + reserve)) {
 
 			if ((so->so_state & SS_NBIO) || (flags & OFP_MSG_NBIO)) {
 				if (so->so_upcallprep.soup_send) {
@@ -1202,25 +1757,37 @@ restart:
 				if (flags & OFP_MSG_EOR)
 					odp_packet_flags(top) |= M_EOR;
 				*/
+				if (reserve) {
+					error = ofp_ktls_frame(&so->so_tls, &top);
+					if (error)
+						goto release;
+				}
 			} else {
 
-				top = ofp_socket_packet_alloc(1);
+				cancopy = resid;
+				if (cancopy > (long) global_param->pkt_pool.buffer_size - reserve)
+					cancopy = global_param->pkt_pool.buffer_size - reserve;
+				if (cancopy > space - reserve)
+					cancopy = space - reserve;
+				if (reserve && cancopy > OFP_TLS_MAX_PLAINTEXT)
+					cancopy = OFP_TLS_MAX_PLAINTEXT;
+
+				top = ofp_socket_packet_alloc(cancopy + reserve);
 				error = OFP_ENOBUFS;
 
 				if (top == ODP_PACKET_INVALID)
 					goto release;
 
-				cancopy = resid;
-				if (cancopy > (long) global_param->pkt_pool.buffer_size)
-					cancopy = global_param->pkt_pool.buffer_size;
-				if (cancopy > space)
-					cancopy = space;
-				odp_packet_reset(top, cancopy);
-				uint8_t *p = odp_packet_data(top);
-				memcpy(p, uio->uio_iov->iov_base, cancopy);
-				uio->uio_iov->iov_base = cancopy +
-					(uint8_t *)uio->uio_iov->iov_base;
-				space -= cancopy;
+				/* Gather the iovecs, TCP segments the packet */
+				uio_copy(uio, top,
+					 reserve ? ofp_ktls_hdr_len(&so->so_tls) : 0,
+					 cancopy, 0);
+				if (reserve) {
+					error = ofp_ktls_seal(&so->so_tls, top);
+					if (error)
+						goto release;
+				}
+				space -= cancopy + reserve;
 				resid -= cancopy;
 			}
 			if (dontroute) {
@@ -1239,7 +1806,7 @@ restart:
 			 * this.
 			 */
 			error = (*so->so_proto->pr_usrreqs->pru_send)(so,
-			    (flags & OFP_MSG_OOB) ? PRUS_OOB :
+			    ((flags & OFP_MSG_OOB) ? PRUS_OOB :
 			/*
 			 * If the user set OFP_MSG_EOF, the protocol understands
 			 * this flag and nothing left to send then use
@@ -1250,7 +1817,9 @@ restart:
 			     (resid <= 0)) ?
 				PRUS_EOF :
 			/* If there is more to send set PRUS_MORETOCOME. */
-			    (resid > 0 && space > 0) ? PRUS_MORETOCOME : 0,
+			    (resid > 0 && space > 0) ? PRUS_MORETOCOME : 0) |
+			/* Implied connect with TCP Fast Open. */
+			    ((flags & OFP_MSG_FASTOPEN) ? PRUS_FASTOPEN : 0),
 			    top, addr, control, td);
 			if (dontroute) {
 				OFP_SOCK_LOCK(so);
@@ -1264,8 +1833,9 @@ restart:
 			if (error)
 				goto release;
 
-			uio->uio_resid -= cancopy;
-		} while (resid && space > 0);
+			if (uio != NULL)
+				uio->uio_resid -= cancopy;
+		} while (resid && space > reserve);
 	} while (resid);
 
 release:
@@ -1299,36 +1869,146 @@ ofp_sosend(struct socket *so, struct ofp_sockaddr *addr, struct uio *uio,
 }
 
 /*
- * Implement receive operations on a socket.  We depend on the way that
- * records are added to the sockbuf by sbappend.  In particular, each record
- * (mbufs linked through m_next) must begin with an address if the protocol
- * so specifies, followed by an optional mbuf or mbufs containing ancillary
- * data, and then zero or more mbufs of data.  In order to allow parallelism
- * between network receive and copying to user space, as well as avoid
- * sleeping with a mutex held, we release the socket buffer mutex during the
- * user space copy.  Although the sockbuf is locked, new data may still be
- * appended, and thus we must maintain consistency of the sockbuf during that
- * time.
- *
- * The caller may receive the data as a single mbuf chain by supplying an
- * mbuf **mp0 for use in returning the chain.  The uio is then used only for
- * the count in uio_resid.
+ * Wait until the OFP_SO_RXRING ring of so has data. Returns 0 also at
+ * end of stream, when the ring stays empty.
  */
-int
-ofp_soreceive_generic(struct socket *so, struct ofp_sockaddr **psa, struct uio *uio,
-		  odp_packet_t *mp0, odp_packet_t *controlp, int *flagsp)
+static int
+sbrx_wait(struct socket *so, int flags)
 {
-	odp_packet_t m, *mp;
-	int flags, error, offset;
-	ofp_ssize_t len;
-	struct protosw *pr = so->so_proto;
-	int moff/*, type = 0, last_m_flags, hole_break = 0*/;
-	ofp_ssize_t orig_resid = uio->uio_resid;
-	uint32_t uio_off;
+	struct sockbuf *sb = &so->so_rcv;
+	int error = 0;
 
-	mp = mp0;
-	if (psa != NULL)
-		*psa = NULL;
+	SOCKBUF_LOCK(sb);
+	while (!ofp_sbrx_refill_locked(sb)) {
+		if (so->so_error) {
+			error = so->so_error;
+			so->so_error = 0;
+			break;
+		}
+		if (sb->sb_state & SBS_CANTRCVMORE)
+			break;
+		if ((so->so_state & (SS_ISCONNECTED|SS_ISCONNECTING)) == 0) {
+			error = OFP_ENOTCONN;
+			break;
+		}
+		if ((so->so_state & SS_NBIO) ||
+		    (flags & (OFP_MSG_DONTWAIT|OFP_MSG_NBIO))) {
+			error = OFP_EWOULDBLOCK;
+			break;
+		}
+		error = ofp_sbwait(sb);
+		if (error)
+			break;
+	}
+	SOCKBUF_UNLOCK(sb);
+	return (error);
+}
+
+/*
+ * Tell the protocol about the data read from the ring once a quarter
+ * of the buffer is drained. Until then the window goes out with the
+ * ACKs of the input, which keeps the reader out of the PCB lock.
+ */
+static void
+sbrx_rcvd(struct socket *so, int flags)
+{
+	struct sockbuf *sb = &so->so_rcv;
+
+	if (sb->sb_rxrcvd < (uint32_t)sb->sb_size *
+	    global_param->pkt_pool.buffer_size / 4)
+		return;
+	sb->sb_rxrcvd = 0;
+	if (!(flags & OFP_MSG_SOCALLBCK))
+		(*so->so_proto->pr_usrreqs->pru_rcvd)(so, flags);
+}
+
+/*
+ * Receive from the OFP_SO_RXRING ring of a stream socket: the data is
+ * copied out, or with pkts handed over, by the reading thread without
+ * the sockbuf lock, which is taken only to wait or to pick up data that
+ * spilled over to the socket buffer.
+ */
+static int
+soreceive_rx(struct socket *so, struct uio *uio, odp_packet_t pkts[],
+	     uint32_t lens[], int num, int flags, int *count)
+{
+	struct sockbuf *sb = &so->so_rcv;
+	ofp_ssize_t orig_resid = uio ? uio->uio_resid : 0;
+	odp_packet_t m;
+	uint32_t len;
+	int n = 0, whole, error;
+
+	error = ofp_sblock(sb, SBLOCKWAIT(flags));
+	if (error)
+		return (error);
+
+	while (uio ? uio->uio_resid > 0 : n < num) {
+		m = ofp_sbrx_first(sb);
+		if (m == ODP_PACKET_INVALID) {
+			if ((uio ? uio->uio_resid != orig_resid : n > 0) &&
+			    !(flags & OFP_MSG_WAITALL))
+				break;
+			error = sbrx_wait(so, flags);
+			m = ofp_sbrx_first(sb);
+			if (error || m == ODP_PACKET_INVALID)
+				break;
+		}
+		len = odp_packet_len(m);
+		if (!uio) {
+			ofp_sbrx_take(sb, len);
+			pkts[n] = m;
+			lens[n++] = len;
+			continue;
+		}
+		if (len > uio->uio_resid)
+			len = uio->uio_resid;
+		uio->uio_resid -= uio_copy(uio, m, 0, len, 1);
+		whole = (len == odp_packet_len(m));
+		ofp_sbrx_take(sb, len);
+		if (whole)
+			odp_packet_free(m);
+	}
+
+	sbrx_rcvd(so, flags);
+	ofp_sbunlock(sb);
+
+	if (count)
+		*count = n;
+	if (uio ? uio->uio_resid != orig_resid : n > 0)
+		return (0);
+	return (error);
+}
+
+/*
+ * Implement receive operations on a socket.  We depend on the way that
+ * records are added to the sockbuf by sbappend.  In particular, each record
+ * (mbufs linked through m_next) must begin with an address if the protocol
+ * so specifies, followed by an optional mbuf or mbufs containing ancillary
+ * data, and then zero or more mbufs of data.  In order to allow parallelism
+ * between network receive and copying to user space, as well as avoid
+ * sleeping with a mutex held, we release the socket buffer mutex during the
+ * user space copy.  Although the sockbuf is locked, new data may still be
+ * appended, and thus we must maintain consistency of the sockbuf during that
+ * time.
+ *
+ * The caller may receive the data as a single mbuf chain by supplying an
+ * mbuf **mp0 for use in returning the chain.  The uio is then used only for
+ * the count in uio_resid.
+ */
+int
+ofp_soreceive_generic(struct socket *so, struct ofp_sockaddr **psa, struct uio *uio,
+		  odp_packet_t *mp0, odp_packet_t *controlp, int *flagsp)
+{
+	odp_packet_t m, *mp;
+	int flags, error, offset;
+	ofp_ssize_t len;
+	struct protosw *pr = so->so_proto;
+	int moff/*, type = 0, last_m_flags, hole_break = 0*/;
+	ofp_ssize_t orig_resid = uio->uio_resid;
+
+	mp = mp0;
+	if (psa != NULL)
+		*psa = NULL;
 	if (controlp != NULL)
 		*controlp = ODP_PACKET_INVALID;
 	if (flagsp != NULL) {
@@ -1344,6 +2024,11 @@ ofp_soreceive_generic(struct socket *so, struct ofp_sockaddr **psa, struct uio *
 	*/
 	if (mp != NULL)
 		*mp = ODP_PACKET_INVALID;
+	if (so->so_rcv.sb_rx) {
+		if (mp != NULL || (flags & (OFP_MSG_PEEK|OFP_MSG_OOB)))
+			return (OFP_EOPNOTSUPP);
+		return (soreceive_rx(so, uio, NULL, NULL, 0, flags, NULL));
+	}
 	if ((pr->pr_flags & PR_WANTRCVD) && (so->so_state & SS_ISCONFIRMING)
 	    && uio->uio_resid) {
 		(*pr->pr_usrreqs->pru_rcvd)(so, 0);
@@ -1583,7 +2268,6 @@ dontblock:
 	 */
 	moff = 0;
 	offset = 0;
-	uio_off = 0;
 	while (m != ODP_PACKET_INVALID && uio->uio_resid > 0 && error == 0) {
 		/*
 		 * If the type of mbuf has changed since the last mbuf
@@ -1624,12 +2308,7 @@ dontblock:
 			SBLASTMBUFCHK(&so->so_rcv);
 			SOCKBUF_UNLOCK(&so->so_rcv);
 
-			if (!odp_packet_copy_to_mem(m, moff, len, (void*)
-					((uintptr_t)uio->uio_iov->iov_base +
-						 uio_off))) {
-				uio_off += len;
-				uio->uio_resid -= len;
-			}
+			uio->uio_resid -= uio_copy(uio, m, moff, len, 1);
 
 			SOCKBUF_LOCK(&so->so_rcv);
 			if (error) {
@@ -1717,7 +2396,12 @@ dontblock:
 					m->m_data += len;
 				odp_packet_get_len(m) -= len;
 				*/
-				odp_packet_pull_head(m, len);
+				if (ofp_packet_drop_head(&m, len)) {
+					OFP_ERR("Dropping %ld bytes of a packet failed",
+						(long)len);
+					break;
+				}
+				so->so_rcv.sb_mb[so->so_rcv.sb_get] = m;
 				so->so_rcv.sb_cc -= len;
 			}
 		}
@@ -1827,6 +2511,91 @@ release:
 	return (error);
 }
 
+/* Datagram size of OFP_UDP_GRO and the timestamps of a record */
+static void
+sorecv_info(struct socket *so, odp_packet_t pkt, uint16_t *segsz,
+	    struct ofp_scm_timestamping *ts)
+{
+	struct ofp_packet_user_area *ua = ofp_packet_user_area(pkt);
+
+	*segsz = ua->gro_segsz;
+	ts->sw_ns = 0;
+	ts->hw_ns = 0;
+	if (odp_likely(!so->so_timestamping))
+		return;
+	if ((so->so_timestamping & OFP_SOF_TIMESTAMPING_RX_SOFTWARE) &&
+	    (ua->valid & OFP_UA_TS))
+		ts->sw_ns = ua->ts.rx_ns;
+	if ((so->so_timestamping & OFP_SOF_TIMESTAMPING_RX_HARDWARE) &&
+	    odp_packet_has_ts(pkt))
+		ts->hw_ns = odp_time_to_ns(odp_packet_ts(pkt));
+}
+
+/* Append a control message, return 0 if it does not fit */
+static int
+sorecv_cmsg(struct ofp_msghdr *msg, ofp_socklen_t *used, int level,
+	    int type, const void *data, ofp_socklen_t len)
+{
+	struct ofp_cmsghdr *cm;
+
+	if (msg->msg_controllen < *used + OFP_CMSG_SPACE(len))
+		return 0;
+
+	cm = (struct ofp_cmsghdr *)((uint8_t *)msg->msg_control + *used);
+	cm->cmsg_len = OFP_CMSG_LEN(len);
+	cm->cmsg_level = level;
+	cm->cmsg_type = type;
+	memcpy(OFP_CMSG_DATA(cm), data, len);
+	*used += OFP_CMSG_SPACE(len);
+	return 1;
+}
+
+/*
+ * Control messages of a received datagram: the datagram size of a
+ * record coalesced by OFP_UDP_GRO and the OFP_SO_TIMESTAMPING times.
+ * Messages that do not fit set OFP_MSG_CTRUNC.
+ */
+void
+ofp_sorecv_control(struct socket *so, struct ofp_msghdr *msg,
+		   uint16_t segsz, const struct ofp_scm_timestamping *ts)
+{
+	ofp_socklen_t used = 0;
+
+	if (msg->msg_control == NULL)
+		msg->msg_controllen = 0;
+
+	if (segsz && !sorecv_cmsg(msg, &used, OFP_IPPROTO_UDP, OFP_UDP_GRO,
+				  &segsz, sizeof(segsz)))
+		msg->msg_flags |= OFP_MSG_CTRUNC;
+	if ((so->so_timestamping & (OFP_SOF_TIMESTAMPING_RX_SOFTWARE |
+				    OFP_SOF_TIMESTAMPING_RX_HARDWARE)) &&
+	    !sorecv_cmsg(msg, &used, OFP_SOL_SOCKET, OFP_SCM_TIMESTAMPING,
+			 ts, sizeof(*ts)))
+		msg->msg_flags |= OFP_MSG_CTRUNC;
+
+	msg->msg_controllen = used;
+}
+
+/*
+ * Record the transmit time of datagram id of socket fd, see
+ * OFP_SOF_TIMESTAMPING_TX_SOFTWARE.
+ */
+void
+ofp_sock_tx_timestamp(int fd, uint32_t id, uint64_t ns)
+{
+	struct socket *so = ofp_get_sock_by_fd(fd);
+
+	/* The socket may be closed by now */
+	if (so == NULL ||
+	    !(so->so_timestamping & OFP_SOF_TIMESTAMPING_TX_SOFTWARE))
+		return;
+
+	SOCKBUF_LOCK(&so->so_snd);
+	so->so_ts_tx.id = id;
+	so->so_ts_tx.ns = ns;
+	SOCKBUF_UNLOCK(&so->so_snd);
+}
+
 /*
  * Optimized version of ofp_soreceive() for simple datagram cases from userspace.
  * Unlike in the stream case, we're able to drop a datagram if copyout()
@@ -1908,10 +2677,8 @@ ofp_soreceive_dgram(struct socket *so, struct ofp_sockaddr **psa, struct uio *ui
 	}
 	SOCKBUF_LOCK_ASSERT(&so->so_rcv);
 
-	odp_packet_t pkt = so->so_rcv.sb_mb[so->so_rcv.sb_get];
+	odp_packet_t pkt = ofp_sockbuf_remove_first(&so->so_rcv);
 	sbfree(&so->so_rcv, pkt);
-	if (++so->so_rcv.sb_get >= SOCKBUF_LEN)
-		so->so_rcv.sb_get = 0;
 
 	SOCKBUF_UNLOCK(&so->so_rcv);
 
@@ -1921,14 +2688,14 @@ ofp_soreceive_dgram(struct socket *so, struct ofp_sockaddr **psa, struct uio *ui
 		odp_packet_free(pkt);
 		return 0;
 	}
-	uint8_t *data = (uint8_t *)(uh + 1);
 	len = odp_be_to_cpu_16(uh->uh_ulen) - sizeof(*uh);
-	if (len > uio->uio_iov->iov_len) {
-		len = uio->uio_iov->iov_len;
+	if (len > (size_t)uio->uio_resid) {
+		len = uio->uio_resid;
 		flags |= OFP_MSG_TRUNC;
 	}
+	sorecv_info(so, pkt, &uio->uio_segsz, &uio->uio_ts);
 
-	memcpy(uio->uio_iov->iov_base, data, len);
+	uio_copy(uio, pkt, odp_packet_l4_offset(pkt) + sizeof(*uh), len, 1);
 
 	if (psa && *psa) {
 		 if (pr->pr_flags & PR_ADDR) {
@@ -1949,6 +2716,210 @@ ofp_soreceive_dgram(struct socket *so, struct ofp_sockaddr **psa, struct uio *ui
 	return (0);
 }
 
+/*
+ * Receive up to vlen datagrams. Waits for the first datagram like
+ * ofp_soreceive_dgram(), then takes the queued datagrams, up to
+ * SOMMSG_BURST at a time under one sockbuf lock. The number of
+ * messages received is returned in count. An error is returned only if
+ * no datagram was received.
+ */
+int
+ofp_soreceive_dgram_mmsg(struct socket *so, struct ofp_mmsghdr *msgvec,
+			 unsigned int vlen, int flags, unsigned int *count)
+{
+	odp_packet_t pkts[SOMMSG_BURST];
+	struct protosw *pr = so->so_proto;
+	unsigned int n = 0;
+	int error;
+
+	*count = 0;
+
+	SOCKBUF_LOCK(&so->so_rcv);
+	while (so->so_rcv.sb_put == so->so_rcv.sb_get) {
+		if (so->so_error) {
+			error = so->so_error;
+			so->so_error = 0;
+			SOCKBUF_UNLOCK(&so->so_rcv);
+			return (error);
+		}
+		if (so->so_rcv.sb_state & SBS_CANTRCVMORE) {
+			SOCKBUF_UNLOCK(&so->so_rcv);
+			return (0);
+		}
+		if ((so->so_state & SS_NBIO) ||
+		    (flags & (OFP_MSG_DONTWAIT|OFP_MSG_NBIO))) {
+			SOCKBUF_UNLOCK(&so->so_rcv);
+			return (OFP_EWOULDBLOCK);
+		}
+		error = ofp_sbwait(&so->so_rcv);
+		if (error) {
+			SOCKBUF_UNLOCK(&so->so_rcv);
+			return (error);
+		}
+	}
+
+	for (;;) {
+		unsigned int num = 0, i;
+
+		SOCKBUF_LOCK_ASSERT(&so->so_rcv);
+		while (num < SOMMSG_BURST && n + num < vlen &&
+		       so->so_rcv.sb_put != so->so_rcv.sb_get) {
+			pkts[num] = ofp_sockbuf_remove_first(&so->so_rcv);
+			sbfree(&so->so_rcv, pkts[num]);
+			num++;
+		}
+		SOCKBUF_UNLOCK(&so->so_rcv);
+
+		if (num == 0)
+			break;
+
+		for (i = 0; i < num; i++) {
+			struct ofp_msghdr *msg = &msgvec[n].msg_hdr;
+			struct ofp_scm_timestamping ts;
+			struct ofp_udphdr *uh;
+			uint16_t segsz;
+			size_t len;
+
+			uh = (struct ofp_udphdr *)odp_packet_l4_ptr(pkts[i], NULL);
+			if (!uh) {
+				OFP_ERR("UDP HDR == NULL!");
+				odp_packet_free(pkts[i]);
+				continue;
+			}
+			len = odp_be_to_cpu_16(uh->uh_ulen) - sizeof(*uh);
+
+			msg->msg_flags = 0;
+			if (len > msg_iov_len(msg))
+				msg->msg_flags |= OFP_MSG_TRUNC;
+			msgvec[n].msg_len = msg_copyout(msg, pkts[i],
+							odp_packet_l4_offset(pkts[i]) +
+							sizeof(*uh), len);
+
+			if (msg->msg_name) {
+				ofp_socklen_t salen = 0;
+
+				if (pr->pr_flags & PR_ADDR) {
+					/* address is save on L2 & L3 */
+					struct ofp_sockaddr *sa =
+						(struct ofp_sockaddr *)
+						odp_packet_l2_ptr(pkts[i], NULL);
+					salen = sa->sa_len;
+					memcpy(msg->msg_name, sa,
+					       salen < msg->msg_namelen ?
+					       salen : msg->msg_namelen);
+				}
+				msg->msg_namelen = salen;
+			}
+			sorecv_info(so, pkts[i], &segsz, &ts);
+			ofp_sorecv_control(so, msg, segsz, &ts);
+
+			odp_packet_free(pkts[i]);
+			n++;
+		}
+
+		if (n >= vlen)
+			break;
+		SOCKBUF_LOCK(&so->so_rcv);
+	}
+
+	*count = n;
+	return (0);
+}
+
+/*
+ * Zero-copy receive. Waits for data like ofp_soreceive_dgram() and then
+ * hands up to num queued packets over to the caller. Stream packets hold
+ * only payload; the payload of a datagram follows its UDP header. The
+ * number of packets returned is stored in count, zero at end of stream.
+ */
+int
+ofp_soreceive_pkt(struct socket *so, odp_packet_t pkts[], uint32_t offs[],
+		  uint32_t lens[], int num, int flags, int *count)
+{
+	struct protosw *pr = so->so_proto;
+	int stream = (so->so_type == OFP_SOCK_STREAM);
+	int n = 0, i, j;
+	int error = 0;
+
+	*count = 0;
+
+	if (stream && so->so_rcv.sb_rx) {
+		error = soreceive_rx(so, NULL, pkts, lens, num, flags, &n);
+		for (i = 0; i < n; i++)
+			offs[i] = 0;
+		*count = n;
+		return (error);
+	}
+
+	if (stream) {
+		error = ofp_sblock(&so->so_rcv, SBLOCKWAIT(flags));
+		if (error)
+			return (error);
+	}
+
+	SOCKBUF_LOCK(&so->so_rcv);
+	while (so->so_rcv.sb_put == so->so_rcv.sb_get) {
+		if (so->so_error) {
+			error = so->so_error;
+			so->so_error = 0;
+			goto unlock;
+		}
+		if (so->so_rcv.sb_state & SBS_CANTRCVMORE)
+			goto unlock;
+		if ((so->so_state & (SS_ISCONNECTED|SS_ISCONNECTING)) == 0 &&
+		    (pr->pr_flags & PR_CONNREQUIRED)) {
+			error = OFP_ENOTCONN;
+			goto unlock;
+		}
+		if ((so->so_state & SS_NBIO) ||
+		    (flags & (OFP_MSG_DONTWAIT|OFP_MSG_NBIO))) {
+			error = OFP_EWOULDBLOCK;
+			goto unlock;
+		}
+		error = ofp_sbwait(&so->so_rcv);
+		if (error)
+			goto unlock;
+	}
+
+	while (n < num && so->so_rcv.sb_put != so->so_rcv.sb_get) {
+		pkts[n] = ofp_sockbuf_remove_first(&so->so_rcv);
+		sbfree(&so->so_rcv, pkts[n]);
+		n++;
+	}
+unlock:
+	SOCKBUF_UNLOCK(&so->so_rcv);
+
+	if (stream) {
+		if (n && (pr->pr_flags & PR_WANTRCVD))
+			(*pr->pr_usrreqs->pru_rcvd)(so, flags);
+		ofp_sbunlock(&so->so_rcv);
+	}
+
+	for (i = 0, j = 0; i < n; i++) {
+		odp_packet_t pkt = pkts[i];
+
+		if (stream) {
+			offs[j] = 0;
+			lens[j] = odp_packet_len(pkt);
+		} else {
+			struct ofp_udphdr *uh = (struct ofp_udphdr *)
+				odp_packet_l4_ptr(pkt, NULL);
+
+			if (!uh) {
+				OFP_ERR("UDP HDR == NULL!");
+				odp_packet_free(pkt);
+				continue;
+			}
+			offs[j] = odp_packet_l4_offset(pkt) + sizeof(*uh);
+			lens[j] = odp_be_to_cpu_16(uh->uh_ulen) - sizeof(*uh);
+		}
+		pkts[j++] = pkt;
+	}
+
+	*count = j;
+	return (n ? 0 : error);
+}
+
 int
 ofp_soreceive(struct socket *so, struct ofp_sockaddr **psa, struct uio *uio,
 	  odp_packet_t *mp0, odp_packet_t *controlp, int *flagsp)
@@ -2005,7 +2976,9 @@ ofp_sosetopt(struct socket *so, struct sockopt *sopt)
 	} else {
 		switch (sopt->sopt_name) {
 		case OFP_SO_ACCEPTFILTER:
-			error = OFP_EOPNOTSUPP;
+			error = ofp_accept_filt_setopt(so, sopt);
+			if (error)
+				goto bad;
 			break;
 		case OFP_SO_LINGER:
 			error = ofp_sooptcopyin(sopt, &l, sizeof l, sizeof l);
@@ -2076,6 +3049,64 @@ ofp_sosetopt(struct socket *so, struct sockopt *sopt)
 			so->so_user_cookie = val32;
 			break;
 
+		case OFP_SO_MAX_PACING_RATE:
+			error = ofp_sooptcopyin(sopt, &val, sizeof val,
+					    sizeof val);
+			if (error)
+				goto bad;
+			so->so_max_pacing_rate = val;
+			break;
+
+		case OFP_SO_TIMESTAMPING:
+			error = ofp_sooptcopyin(sopt, &optval, sizeof optval,
+					    sizeof optval);
+			if (error)
+				goto bad;
+			if (optval & ~(OFP_SOF_TIMESTAMPING_RX_SOFTWARE |
+				       OFP_SOF_TIMESTAMPING_RX_HARDWARE |
+				       OFP_SOF_TIMESTAMPING_TX_SOFTWARE)) {
+				error = OFP_EINVAL;
+				goto bad;
+			}
+			so->so_timestamping = optval;
+			break;
+
+		case OFP_SO_RXRING:
+			error = ofp_sooptcopyin(sopt, &optval, sizeof optval,
+					    sizeof optval);
+			if (error)
+				goto bad;
+			if (so->so_type != OFP_SOCK_STREAM) {
+				error = OFP_EOPNOTSUPP;
+				goto bad;
+			}
+			/* The reader must not be in the socket buffer */
+			(void)ofp_sblock(&so->so_rcv, SBL_WAIT);
+			SOCKBUF_LOCK(&so->so_rcv);
+			error = ofp_sbrx_enable(&so->so_rcv, optval);
+			SOCKBUF_UNLOCK(&so->so_rcv);
+			ofp_sbunlock(&so->so_rcv);
+			break;
+
+		case OFP_SO_BUSY_POLL: {
+			struct ofp_sock_busy_poll bp;
+			const struct ofp_sock_busy_poll *sbp;
+
+			error = ofp_sooptcopyin(sopt, &bp, sizeof bp,
+					    sizeof bp);
+			if (error)
+				goto bad;
+			so->so_busy_poll = bp;
+			sbp = bp.enable ? &so->so_busy_poll : NULL;
+			SOCKBUF_LOCK(&so->so_rcv);
+			so->so_rcv.sb_busy_poll = sbp;
+			SOCKBUF_UNLOCK(&so->so_rcv);
+			SOCKBUF_LOCK(&so->so_snd);
+			so->so_snd.sb_busy_poll = sbp;
+			SOCKBUF_UNLOCK(&so->so_snd);
+			break;
+		}
+
 		case OFP_SO_L2INFO:
 			error = OFP_EOPNOTSUPP;
 			break;
@@ -2227,7 +3258,7 @@ ofp_sogetopt(struct socket *so, struct sockopt *sopt)
 	} else {
 		switch (sopt->sopt_name) {
 		case OFP_SO_ACCEPTFILTER:
-			error = OFP_EOPNOTSUPP;
+			error = ofp_accept_filt_getopt(so, sopt);
 			break;
 		case OFP_SO_LINGER:
 			OFP_SOCK_LOCK(so);
@@ -2319,6 +3350,34 @@ integer:
 			optval = so->so_incqlen;
 			goto integer;
 
+		case OFP_SO_MAX_PACING_RATE:
+			error = ofp_sooptcopyout(sopt, &so->so_max_pacing_rate,
+					     sizeof(so->so_max_pacing_rate));
+			break;
+
+		case OFP_SO_TIMESTAMPING:
+			optval = so->so_timestamping;
+			goto integer;
+
+		case OFP_SO_TIMESTAMPING_TX: {
+			struct ofp_sock_txtime tx;
+
+			SOCKBUF_LOCK(&so->so_snd);
+			tx = so->so_ts_tx;
+			SOCKBUF_UNLOCK(&so->so_snd);
+			error = ofp_sooptcopyout(sopt, &tx, sizeof(tx));
+			break;
+		}
+
+		case OFP_SO_BUSY_POLL:
+			error = ofp_sooptcopyout(sopt, &so->so_busy_poll,
+					     sizeof(so->so_busy_poll));
+			break;
+
+		case OFP_SO_RXRING:
+			optval = so->so_rcv.sb_rx != NULL;
+			goto integer;
+
 		default:
 			error = OFP_ENOPROTOOPT;
 			break;
@@ -2374,14 +3433,19 @@ void
 ofp_soisconnected(struct socket *so)
 {
 	struct socket *head;
+	struct accept_filter *afp;
+	int ret;
 
+restart:
 	ACCEPT_LOCK();
 	OFP_SOCK_LOCK(so);
 	so->so_state &= ~(SS_ISCONNECTING|SS_ISDISCONNECTING|SS_ISCONFIRMING);
 	so->so_state |= SS_ISCONNECTED;
 	head = so->so_head;
 	if (head != NULL && (so->so_qstate & SQ_INCOMP)) {
-		if ((so->so_options & OFP_SO_ACCEPTFILTER) == 0) {
+		afp = head->so_accf.so_accept_filter;
+		if ((so->so_options & OFP_SO_ACCEPTFILTER) == 0 ||
+		    afp == NULL) {
 			OFP_SOCK_UNLOCK(so);
 			OFP_TAILQ_REMOVE(&head->so_incomp, so, so_list);
 			head->so_incqlen--;
@@ -2395,21 +3459,17 @@ ofp_soisconnected(struct socket *so)
 			ofp_wakeup_one(&head->so_timeo);
 		} else {
 			ACCEPT_UNLOCK();
-			ofp_soupcall_set(so, OFP_SO_RCV,
-			    head->so_accf->so_accept_filter->accf_callback,
-			    head->so_accf->so_accept_filter_arg);
+			/* Stays incomplete until the filter passes it */
+			ofp_soupcall_set(so, OFP_SO_RCV, afp->accf_callback,
+			    head->so_accf.so_accept_filter_arg);
 			so->so_options &= ~OFP_SO_ACCEPTFILTER;
-			/* HJo: FIX
-			ret = head->so_accf->so_accept_filter->accf_callback(so,
-			    head->so_accf->so_accept_filter_arg, M_DONTWAIT);
+			ret = afp->accf_callback(so,
+			    head->so_accf.so_accept_filter_arg, 0);
 			if (ret == SU_ISCONNECTED)
 				ofp_soupcall_clear(so, OFP_SO_RCV);
-			*/
 			OFP_SOCK_UNLOCK(so);
-			/* HJo
 			if (ret == SU_ISCONNECTED)
 				goto restart;
-			*/
 		}
 		return;
 	}
@@ -2532,17 +3592,124 @@ ofp_sohasoutofband(struct socket *so)
 
 /* Emulation for BSD ofp_wakeup */
 
-static int _ofp_wakeup(void *channel, int one, int tmo);
+/*
+ * Sleepers are kept in lists hashed by channel. A wakeup walks only
+ * the list of its channel, and the list of the NULL channel used by
+ * select and epoll.
+ *
+ * When sleep_park is set, threads other than worker threads sleep in
+ * the kernel on the go futex. Worker threads keep yielding the CPU.
+ */
 
-struct voidarg {
-	void *p;
+struct sleeper_arg {
+	struct sleeper *sleepy;
+	uint32_t gen;
 };
 
+static void
+sleeper_go(struct sleeper *p)
+{
+	__atomic_store_n(&p->go, 1, __ATOMIC_RELEASE);
+	if (p->parked)
+		syscall(SYS_futex, &p->go, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static void
+sleeper_wait(struct sleeper *p, odp_rwlock_t *mtx)
+{
+	if (mtx)
+		odp_rwlock_write_unlock(mtx);
+
+	/* A coroutine lets the dispatcher run meanwhile */
+	if (ofp_in_coroutine() && !__atomic_load_n(&p->go, __ATOMIC_ACQUIRE))
+		ofp_coroutine_wait(&p->go);
+
+	while (__atomic_load_n(&p->go, __ATOMIC_ACQUIRE) == 0) {
+		if (p->parked)
+			syscall(SYS_futex, &p->go, FUTEX_WAIT, 0, NULL, NULL, 0);
+		else
+			sched_yield();
+	}
+
+	if (mtx)
+		odp_rwlock_write_lock(mtx);
+}
+
 static void
 sleep_timeout(void *arg)
 {
-	struct voidarg *arg1 = arg;
-	_ofp_wakeup(arg1->p, 1, 1);
+	struct sleeper_arg *sa = arg;
+	struct sleeper *sleepy = sa->sleepy;
+	struct sleep_bucket *b;
+	struct sleeper **pp;
+
+	b = &shm->sleep_hash[SLEEP_HASH(sleepy->channel)];
+	odp_spinlock_lock(&b->lock);
+
+	/* Woken up or reused meanwhile */
+	if (sleepy->gen != sa->gen || sleepy->go) {
+		odp_spinlock_unlock(&b->lock);
+		return;
+	}
+
+	for (pp = &b->list; *pp; pp = &(*pp)->next) {
+		if (*pp == sleepy) {
+			*pp = sleepy->next;
+			sleepy->tmo = ODP_TIMER_INVALID;
+			sleepy->woke_by_timer = 1;
+			sleeper_go(sleepy);
+			break;
+		}
+	}
+
+	odp_spinlock_unlock(&b->lock);
+}
+
+/*
+ * Counterpart of ofp_msleep() for OFP_SO_BUSY_POLL. Instead of sleeping,
+ * processes bursts of bp->pktin with mtx released until some packets
+ * are processed, then returns 0 for the caller to check its condition
+ * again. Returns OFP_EWOULDBLOCK if none arrive in timeout microseconds,
+ * 0 meaning no limit.
+ */
+int
+ofp_busy_poll(const struct ofp_sock_busy_poll *bp, odp_rwlock_t *mtx,
+	      uint32_t timeout)
+{
+	odp_packet_t pkt[OFP_EVT_RX_BURST_SIZE];
+	uint64_t end = 0;
+	int ret = 0;
+	int num;
+
+	if (timeout)
+		end = odp_time_to_ns(odp_time_global()) +
+			(uint64_t)timeout * ODP_TIME_USEC_IN_NS;
+
+	if (mtx)
+		odp_rwlock_write_unlock(mtx);
+
+	for (;;) {
+		num = ofp_packet_input_burst(bp->pktin, pkt,
+					     OFP_EVT_RX_BURST_SIZE);
+		if (num > 0)
+			break;
+		if (num < 0) {
+			ret = OFP_EIO;
+			break;
+		}
+		/* Packets held for a burst would wait for the next one */
+		ofp_send_pending_pkt();
+		ofp_coroutine_yield();
+		if (end && odp_time_to_ns(odp_time_global()) >= end) {
+			ret = OFP_EWOULDBLOCK;
+			break;
+		}
+	}
+
+	if (mtx)
+		odp_rwlock_write_lock(mtx);
+
+	return ret;
 }
 
 int
@@ -2550,86 +3717,88 @@ ofp_msleep(void *channel, odp_rwlock_t *mtx, int priority, const char *wmesg,
 	     uint32_t timeout)
 {
 	struct sleeper *sleepy;
-	struct voidarg arg;
+	struct sleep_bucket *b;
+	struct sleeper_arg arg;
+	odp_timer_t tmo;
 	int ret;
-	(void)mtx;
 	(void)priority;
 
-	odp_spinlock_lock(&shm->sleep_lock);
-	if (!shm->free_sleepers) {
+	ofp_spinlock_lock(&shm->sleep_lock);
+	sleepy = shm->free_sleepers;
+	if (sleepy) {
+		shm->free_sleepers = sleepy->next;
+	} else if (shm->sleeper_high < shm->socket_max) {
+		sleepy = &shm->sleeper_list[shm->sleeper_high++];
+		sleepy->gen = 0;
+	} else {
 		odp_spinlock_unlock(&shm->sleep_lock);
 		OFP_ERR("Out of sleepers");
 		return OFP_ENOMEM;
 	}
-	sleepy = shm->free_sleepers;
-	shm->free_sleepers = sleepy->next;
+	odp_spinlock_unlock(&shm->sleep_lock);
+
+	b = &shm->sleep_hash[SLEEP_HASH(channel)];
+	odp_spinlock_lock(&b->lock);
 
-	sleepy->next = shm->sleep_list;
 	sleepy->channel = channel;
 	sleepy->wmesg = wmesg;
 	sleepy->go = 0;
+	sleepy->parked = shm->sleep_park &&
+		odp_thread_type() != ODP_THREAD_WORKER && !ofp_in_coroutine();
 	sleepy->woke_by_timer = 0;
 	sleepy->tmo = ODP_TIMER_INVALID;
-	shm->sleep_list = sleepy;
+	sleepy->gen++;
+	sleepy->next = b->list;
+	b->list = sleepy;
 	if (timeout) {
-		arg.p = channel;
-		sleepy->tmo = ofp_timer_start(timeout, sleep_timeout, &arg, sizeof(arg));
+		arg.sleepy = sleepy;
+		arg.gen = sleepy->gen;
+		sleepy->tmo = ofp_timer_start(timeout, sleep_timeout, &arg,
+					      sizeof(arg));
 	}
-	odp_spinlock_unlock(&shm->sleep_lock);
-
-	while (sleepy->go == 0) {
-		if (mtx) {
-			odp_rwlock_write_unlock(mtx);
-		}
-		sched_yield();
-		if (mtx) {
-			odp_rwlock_write_lock(mtx);
-		}
-	}
-
-	odp_spinlock_lock(&shm->sleep_lock);
+	odp_spinlock_unlock(&b->lock);
 
-	if (sleepy->tmo != ODP_TIMER_INVALID)
-		ofp_timer_cancel(sleepy->tmo);
+	sleeper_wait(sleepy, mtx);
 
+	odp_spinlock_lock(&b->lock);
+	tmo = sleepy->tmo;
+	sleepy->tmo = ODP_TIMER_INVALID;
+	/* A timeout that is not cancelled in time finds a new generation */
+	sleepy->gen++;
 	ret = sleepy->woke_by_timer ? OFP_EWOULDBLOCK : 0;
+	odp_spinlock_unlock(&b->lock);
+
+	if (tmo != ODP_TIMER_INVALID)
+		ofp_timer_cancel(tmo);
 
+	ofp_spinlock_lock(&shm->sleep_lock);
 	sleepy->next = shm->free_sleepers;
 	shm->free_sleepers = sleepy;
-
 	odp_spinlock_unlock(&shm->sleep_lock);
 
 	return ret;
 }
 
 static int
-_ofp_wakeup(void *channel, int one, int tmo)
+_ofp_wakeup(void *channel, int one)
 {
-	struct sleeper *p, *prev = NULL, *next;
+	struct sleep_bucket *b = &shm->sleep_hash[SLEEP_HASH(channel)];
+	struct sleeper *p, **pp;
 
-	odp_spinlock_lock(&shm->sleep_lock);
+	odp_spinlock_lock(&b->lock);
 
-	p = shm->sleep_list;
-	while (p) {
-		next = p->next;
+	pp = &b->list;
+	while ((p = *pp)) {
 		if (channel == p->channel) {
-			if (prev)
-				prev->next = p->next;
-			else
-				shm->sleep_list = p->next;
-			if (tmo) {
-				p->tmo = ODP_TIMER_INVALID;
-				p->woke_by_timer = 1;
-			}
-			p->go = 1;
+			*pp = p->next;
+			sleeper_go(p);
 			if (one)
 				break;
 		} else
-			prev = p;
-		p = next;
+			pp = &p->next;
 	}
 
-	odp_spinlock_unlock(&shm->sleep_lock);
+	odp_spinlock_unlock(&b->lock);
 	return -1;
 }
 
@@ -2638,8 +3807,8 @@ ofp_wakeup_one(void *channel)
 {
 	/* wake up selects */
 	if (channel)
-		_ofp_wakeup(NULL, 0, 0);
-	return _ofp_wakeup(channel, 1, 0);
+		_ofp_wakeup(NULL, 0);
+	return _ofp_wakeup(channel, 1);
 }
 
 int
@@ -2647,8 +3816,8 @@ ofp_wakeup(void *channel)
 {
 	/* wake up selects */
 	if (channel)
-		_ofp_wakeup(NULL, 0, 0);
-	return _ofp_wakeup(channel, 0, 0);
+		_ofp_wakeup(NULL, 0);
+	return _ofp_wakeup(channel, 0);
 }
 
 
@@ -2829,11 +3998,64 @@ ofp_pru_sopoll_notsupp(struct socket *so, int events, struct ofp_ucred *cred,
 	return OFP_EOPNOTSUPP;
 }
 
+int
+ofp_sock_event_enqueue(struct socket *head, struct socket *so, int event,
+		       odp_packet_t pkt)
+{
+	struct ofp_sock_sigval *ss;
+	odp_buffer_t buf;
+
+	if (ofp_sock_event_pool == ODP_POOL_INVALID)
+		return -1;
+	buf = odp_buffer_alloc(ofp_sock_event_pool);
+	if (buf == ODP_BUFFER_INVALID)
+		return -1;
+
+	ss = odp_buffer_addr(buf);
+	ss->event = event;
+	ss->sockfd = head->so_number;
+	ss->sockfd2 = so->so_number;
+	ss->pkt = pkt;
+	ss->pkts = &ss->pkt;
+	ss->num = pkt != ODP_PACKET_INVALID;
+
+	if (odp_queue_enq(head->so_sigevent.ofp_sigev_queue,
+			  odp_buffer_to_event(buf)) < 0) {
+		odp_buffer_free(buf);
+		return -1;
+	}
+	return 0;
+}
+
+struct ofp_sock_sigval *ofp_socket_event(odp_event_t ev)
+{
+	odp_buffer_t buf;
+
+	if (ofp_sock_event_pool == ODP_POOL_INVALID ||
+	    odp_event_type(ev) != ODP_EVENT_BUFFER)
+		return NULL;
+	buf = odp_buffer_from_event(ev);
+	if (odp_buffer_pool(buf) != ofp_sock_event_pool)
+		return NULL;
+	return odp_buffer_addr(buf);
+}
+
+void ofp_socket_event_free(odp_event_t ev)
+{
+	odp_buffer_free(odp_buffer_from_event(ev));
+}
+
 int
 ofp_send_sock_event(struct socket *head, struct socket *so, int event)
 {
 	struct ofp_sigevent *ev = &head->so_sigevent;
 
+	if (ev->ofp_sigev_notify == OFP_SIGEV_QUEUE) {
+		/* A lost readiness event leaves the socket to be polled */
+		ofp_sock_event_enqueue(head, so, event, ODP_PACKET_INVALID);
+		return 0;
+	}
+
 	if (ev->ofp_sigev_notify) {
 		union ofp_sigval sv;
 		struct ofp_sock_sigval ss;
@@ -2843,6 +4065,9 @@ ofp_send_sock_event(struct socket *head, struct socket *so, int event)
 		ss.event = event;
 		ss.sockfd = head->so_number;
 		ss.sockfd2 = so->so_number;
+		ss.pkt = ODP_PACKET_INVALID;
+		ss.pkts = NULL;
+		ss.num = 0;
 
 		so->so_state |= SS_EVENT;
 		head->so_state |= SS_EVENT;
@@ -2868,7 +4093,7 @@ is_accepting_socket_readable(struct socket *so)
 static inline int
 is_listening_socket_readable(struct socket *so)
 {
-	return (so->so_rcv.sb_cc > 0);
+	return (so->so_rcv.sb_cc + ofp_sbrx_cc(&so->so_rcv) > 0);
 }
 
 int
@@ -4,29 +4,129 @@
  *
  * SPDX-License-Identifier:     BSD-3-Clause
  */
+#include <inttypes.h>
+#include <string.h>
 #include <odp_api.h>
 #include "ofpi_uma.h"
 #include "ofpi_log.h"
 #include "ofpi_util.h"
+#include "ofpi_init.h"
 
 #define SHM_NAME_UMA "OfpUmaShMem"
 
+/*
+ * Each thread has a cache (magazine) of free buffers per zone, refilled
+ * from and drained to the ODP pool half a cache at a time. The counters
+ * are only updated by the owning thread.
+ */
+struct uma_cache {
+	int count;
+	uint64_t allocs;
+	uint64_t frees;
+	uint64_t refills;
+	uint64_t drains;
+	uint64_t fails;
+} ODP_ALIGNED_CACHE;
+
 struct ofp_uma_mem {
 	odp_pool_t pools[OFP_NUM_UMA_POOLS];
 	int num_pools;
+	int size[OFP_NUM_UMA_POOLS];
+	int capacity[OFP_NUM_UMA_POOLS];
+	/* Buffers out of the ODP pool, cached ones included, and the peak */
+	odp_atomic_u32_t taken[OFP_NUM_UMA_POOLS];
+	odp_atomic_u32_t max_taken[OFP_NUM_UMA_POOLS];
+	char name[OFP_NUM_UMA_POOLS][ODP_POOL_NAME_LEN];
+	int cache_depth;
+	int num_threads;
+	/* num_threads * OFP_NUM_UMA_POOLS caches, then their buffers */
+	struct uma_cache cache[] ODP_ALIGNED_CACHE;
 };
 
 static __thread struct ofp_uma_mem *shm;
 
+#define UMA_CACHE_DEPTH ((global_param->uma_cache_size > 0) ?		\
+			 global_param->uma_cache_size : 0)
+#define UMA_NUM_CACHES (odp_thread_count_max() * OFP_NUM_UMA_POOLS)
+#define SHM_SIZE_UMA (sizeof(struct ofp_uma_mem) +			\
+		      UMA_NUM_CACHES * (sizeof(struct uma_cache) +	\
+					UMA_CACHE_DEPTH * sizeof(odp_buffer_t)))
+
 struct uma_pool_metadata {
 	union {
 		odp_buffer_t buffer_handle;
 		uint64_t u64;
 	};
+	uint32_t zone;
+	uint32_t pad;
 	uint8_t data[0];
 };
 
-BUILD_ASSERT(sizeof(struct uma_pool_metadata) == 8);
+BUILD_ASSERT(sizeof(struct uma_pool_metadata) == 16);
+
+static inline struct uma_cache *uma_cache(int thr, uma_zone_t zone)
+{
+	return &shm->cache[thr * OFP_NUM_UMA_POOLS + zone];
+}
+
+static inline odp_buffer_t *uma_cache_bufs(int thr, uma_zone_t zone)
+{
+	odp_buffer_t *bufs = (odp_buffer_t *)
+		&shm->cache[shm->num_threads * OFP_NUM_UMA_POOLS];
+
+	return &bufs[(thr * OFP_NUM_UMA_POOLS + zone) * shm->cache_depth];
+}
+
+/* Cache of the calling thread, or NULL if caching is not used */
+static inline struct uma_cache *uma_thread_cache(uma_zone_t zone, int *thr)
+{
+	*thr = odp_thread_id();
+
+	if (!shm->cache_depth || *thr < 0 || *thr >= shm->num_threads)
+		return NULL;
+
+	return uma_cache(*thr, zone);
+}
+
+/* Called when buffers move out of the pool, in batches when cached */
+static inline void uma_taken(uma_zone_t zone, uint32_t num)
+{
+	uint32_t taken = odp_atomic_fetch_add_u32(&shm->taken[zone], num);
+
+	odp_atomic_max_u32(&shm->max_taken[zone], taken + num);
+}
+
+static void uma_cache_drain(int thr, uma_zone_t zone, int num)
+{
+	struct uma_cache *c = uma_cache(thr, zone);
+	odp_buffer_t *bufs = uma_cache_bufs(thr, zone);
+
+	if (num > c->count)
+		num = c->count;
+	if (num <= 0)
+		return;
+
+	c->count -= num;
+	odp_buffer_free_multi(&bufs[c->count], num);
+	odp_atomic_sub_u32(&shm->taken[zone], num);
+	c->drains++;
+}
+
+static int uma_cache_refill(int thr, uma_zone_t zone)
+{
+	struct uma_cache *c = uma_cache(thr, zone);
+	odp_buffer_t *bufs = uma_cache_bufs(thr, zone);
+	int num = (shm->cache_depth + 1) / 2;
+
+	num = odp_buffer_alloc_multi(shm->pools[zone], bufs, num);
+	if (num <= 0)
+		return 0;
+
+	uma_taken(zone, num);
+	c->count = num;
+	c->refills++;
+	return num;
+}
 
 uma_zone_t ofp_uma_pool_create(const char *name, int nitems, int size)
 {
@@ -37,7 +137,12 @@ uma_zone_t ofp_uma_pool_create(const char *name, int nitems, int size)
 	odp_pool_param_init(&pool_params);
 	pool_params.buf.size  = size + sizeof(struct uma_pool_metadata);
 	pool_params.buf.align = 0;
-	pool_params.buf.num   = nitems;
+	/*
+	 * Room for the buffers held in the caches, one per thread up to
+	 * the thread count ODP was initialized for, which may exceed the
+	 * CPU count
+	 */
+	pool_params.buf.num   = nitems + shm->num_threads * shm->cache_depth;
 	pool_params.type      = ODP_POOL_BUFFER;
 
 	OFP_INFO("Creating pool '%s', nitems=%d size=%d total=%d",
@@ -57,6 +162,11 @@ uma_zone_t ofp_uma_pool_create(const char *name, int nitems, int size)
 
 	zone = shm->num_pools++;
 	shm->pools[zone] = pool;
+	shm->size[zone] = size;
+	shm->capacity[zone] = pool_params.buf.num;
+	odp_atomic_init_u32(&shm->taken[zone], 0);
+	odp_atomic_init_u32(&shm->max_taken[zone], 0);
+	strncpy(shm->name[zone], name, ODP_POOL_NAME_LEN - 1);
 
 	return zone;
 }
@@ -64,12 +174,16 @@ uma_zone_t ofp_uma_pool_create(const char *name, int nitems, int size)
 int ofp_uma_pool_destroy(uma_zone_t zone)
 {
 	int ret = 0;
+	int thr;
 
-	if (zone > OFP_NUM_UMA_POOLS || zone < 0)
+	if (zone >= OFP_NUM_UMA_POOLS || zone < 0)
 		return -1;
 	if (shm->pools[zone] == ODP_POOL_INVALID)
 		return -1;
 
+	for (thr = 0; thr < shm->num_threads && shm->cache_depth; thr++)
+		uma_cache_drain(thr, zone, shm->cache_depth);
+
 	ret = odp_pool_destroy(shm->pools[zone]);
 
 	shm->pools[zone] = ODP_POOL_INVALID;
@@ -81,24 +195,38 @@ void *ofp_uma_pool_alloc(uma_zone_t zone, int flags)
 {
 	odp_buffer_t buffer;
 	struct uma_pool_metadata *meta;
+	struct uma_cache *c;
+	int thr;
 
-	if (zone < 0 || zone >= shm->num_pools) {
+	if (odp_unlikely((unsigned int)zone >= (unsigned int)shm->num_pools)) {
 		OFP_ERR("Wrong zone %d!", zone);
 		return NULL;
 	}
 
-	buffer = odp_buffer_alloc(shm->pools[zone]);
-	if (buffer == ODP_BUFFER_INVALID) {
-		OFP_ERR("odp_buffer_alloc failed");
-		return NULL;
+	c = uma_thread_cache(zone, &thr);
+	if (odp_likely(c != NULL)) {
+		if (odp_unlikely(!c->count) && !uma_cache_refill(thr, zone)) {
+			c->fails++;
+			OFP_ERR("odp_buffer_alloc failed");
+			return NULL;
+		}
+		buffer = uma_cache_bufs(thr, zone)[--c->count];
+		c->allocs++;
+	} else {
+		buffer = odp_buffer_alloc(shm->pools[zone]);
+		if (buffer == ODP_BUFFER_INVALID) {
+			OFP_ERR("odp_buffer_alloc failed");
+			return NULL;
+		}
+		uma_taken(zone, 1);
 	}
 
 	meta = (struct uma_pool_metadata *) odp_buffer_addr(buffer);
 	meta->buffer_handle = buffer;
+	meta->zone = zone;
 
 	if (flags & OFP_M_ZERO)
-		odp_memset((void *)&meta->data, 0, odp_buffer_size(buffer) -
-			sizeof(struct uma_pool_metadata));
+		odp_memset((void *)&meta->data, 0, shm->size[zone]);
 	return (void *) &meta->data;
 }
 
@@ -106,13 +234,90 @@ void ofp_uma_pool_free(void *data)
 {
 	struct uma_pool_metadata *meta = (struct uma_pool_metadata *)
 		((uint8_t *) data - sizeof(struct uma_pool_metadata));
+	struct uma_cache *c;
+	int thr;
+
+	c = uma_thread_cache(meta->zone, &thr);
+	if (odp_unlikely(c == NULL)) {
+		odp_atomic_dec_u32(&shm->taken[meta->zone]);
+		odp_buffer_free(meta->buffer_handle);
+		return;
+	}
 
-	odp_buffer_free(meta->buffer_handle);
+	if (odp_unlikely(c->count == shm->cache_depth))
+		uma_cache_drain(thr, meta->zone, (shm->cache_depth + 1) / 2);
+	uma_cache_bufs(thr, meta->zone)[c->count++] = meta->buffer_handle;
+	c->frees++;
+}
+
+void ofp_print_uma_stat(int fd)
+{
+	uma_zone_t zone;
+	int thr;
+
+	for (zone = 0; zone < shm->num_pools; zone++) {
+		uint64_t allocs = 0, frees = 0, refills = 0, drains = 0;
+		uint64_t fails = 0, cached = 0;
+		uint32_t taken;
+
+		if (shm->pools[zone] == ODP_POOL_INVALID)
+			continue;
+
+		for (thr = 0; thr < shm->num_threads; thr++) {
+			struct uma_cache *c = uma_cache(thr, zone);
+
+			allocs += c->allocs;
+			frees += c->frees;
+			refills += c->refills;
+			drains += c->drains;
+			fails += c->fails;
+			cached += c->count;
+		}
+
+		taken = odp_atomic_load_u32(&shm->taken[zone]);
+		ofp_sendf(fd, "uma zone %s size=%d alloc=%" PRIu64
+			  " free=%" PRIu64 " refill=%" PRIu64
+			  " drain=%" PRIu64 " fail=%" PRIu64
+			  " cached=%" PRIu64 "\r\n",
+			  shm->name[zone], shm->size[zone], allocs, frees,
+			  refills, drains, fails, cached);
+		ofp_sendf(fd, "uma zone %s capacity=%d in use=%" PRIu64
+			  " max=%u memory=%" PRIu64 " KB\r\n",
+			  shm->name[zone], shm->capacity[zone],
+			  taken > cached ? taken - cached : 0,
+			  odp_atomic_load_u32(&shm->max_taken[zone]),
+			  ((uint64_t)shm->capacity[zone] *
+			   (shm->size[zone] +
+			    sizeof(struct uma_pool_metadata))) / 1024);
+	}
+}
+
+int ofp_uma_usage_max(const char **name)
+{
+	uma_zone_t zone;
+	int usage, max = 0;
+
+	if (name)
+		*name = NULL;
+
+	for (zone = 0; zone < shm->num_pools; zone++) {
+		if (shm->pools[zone] == ODP_POOL_INVALID ||
+		    shm->capacity[zone] <= 0)
+			continue;
+		usage = (uint64_t)odp_atomic_load_u32(&shm->taken[zone]) *
+			100 / shm->capacity[zone];
+		if (usage > max || (name && !*name)) {
+			max = usage;
+			if (name)
+				*name = shm->name[zone];
+		}
+	}
+	return max;
 }
 
 static int ofp_uma_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_UMA, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_UMA, SHM_SIZE_UMA);
 	if (shm == NULL) {
 		OFP_ERR("ofp_shared_memory_alloc failed");
 		return -1;
@@ -145,7 +350,7 @@ int ofp_uma_lookup_shared_memory(void)
 
 void ofp_uma_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_UMA, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_UMA, SHM_SIZE_UMA);
 }
 
 int ofp_uma_init_global(void)
@@ -154,12 +359,14 @@ int ofp_uma_init_global(void)
 
 	HANDLE_ERROR(ofp_uma_alloc_shared_memory());
 
-	memset(shm, 0, sizeof(*shm));
+	memset(shm, 0, SHM_SIZE_UMA);
 
 	for (i = 0; i < OFP_NUM_UMA_POOLS; i++)
 		shm->pools[i] = ODP_POOL_INVALID;
 
 	shm->num_pools = 0;
+	shm->cache_depth = UMA_CACHE_DEPTH;
+	shm->num_threads = odp_thread_count_max();
 
 	return 0;
 }
@@ -171,7 +378,7 @@ int ofp_uma_term_global(void)
 
 	for (i = 0; i < OFP_NUM_UMA_POOLS; i++)
 		if (shm->pools[i] != ODP_POOL_INVALID)
-			CHECK_ERROR(odp_pool_destroy(shm->pools[i]), rc);
+			CHECK_ERROR(ofp_uma_pool_destroy(i), rc);
 
 	CHECK_ERROR(ofp_uma_free_shared_memory(), rc);
 
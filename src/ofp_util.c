@@ -236,46 +236,85 @@ char *ofp_port_vlan_to_ifnet_name(int port, int vlan)
 
 	sel = sel ^ 1;
 
-	switch (port) {
-	case LOCAL_PORTS:
+	if (port == LOCAL_PORTS)
 		sprintf(buf[sel], "%s%d",
 			OFP_LOCAL_IFNAME_PREFIX, vlan);
-		break;
-	case GRE_PORTS:
+	else if (port == GRE_PORTS)
 		sprintf(buf[sel], "%s%d",
 			OFP_GRE_IFNAME_PREFIX, vlan);
-		break;
-	case VXLAN_PORTS:
+	else if (port == VXLAN_PORTS)
 		sprintf(buf[sel], "%s%d",
 			OFP_VXLAN_IFNAME_PREFIX, vlan);
-		break;
-	default:
-		if (vlan)
-			sprintf(buf[sel], "%s%d.%d",
-				OFP_IFNAME_PREFIX, port, vlan);
-		else
-			sprintf(buf[sel], "%s%d", OFP_IFNAME_PREFIX, port);
-	}
+	else if (vlan)
+		sprintf(buf[sel], "%s%d.%d",
+			OFP_IFNAME_PREFIX, port, vlan);
+	else
+		sprintf(buf[sel], "%s%d", OFP_IFNAME_PREFIX, port);
 
 	return buf[sel];
 }
 
+static int send_out(int fd, const char *buf, int n)
+{
+	struct stat statbuf;
+
+	fstat(fd, &statbuf);
+	if (S_ISSOCK(fd))
+		return send(fd, buf, n, 0);
+	return write(fd, buf, n);
+}
+
 int ofp_sendf(int fd, const char *fmt, ...)
 {
 	char buf[1024];
-	int ret, n;
+	int n;
 	va_list ap;
-	struct stat statbuf;
 
 	va_start(ap, fmt);
 	n = vsnprintf(buf, sizeof(buf), fmt, ap);
 	va_end(ap);
 
-	fstat(fd, &statbuf);
-	if (S_ISSOCK(fd))
-		ret = send(fd, buf, n, 0);
-	else
-		ret = write(fd, buf, n);
+	return send_out(fd, buf, n);
+}
 
+void ofp_sendbuf_init(struct ofp_sendbuf *sb, int fd)
+{
+	sb->fd = fd;
+	sb->len = 0;
+}
+
+int ofp_sendbuf_flush(struct ofp_sendbuf *sb)
+{
+	int ret = 0;
+
+	if (sb->len)
+		ret = send_out(sb->fd, sb->buf, sb->len);
+	sb->len = 0;
 	return ret;
 }
+
+int ofp_sendbuf_printf(struct ofp_sendbuf *sb, const char *fmt, ...)
+{
+	int n, room;
+	va_list ap;
+
+	for (;;) {
+		room = sizeof(sb->buf) - sb->len;
+		va_start(ap, fmt);
+		n = vsnprintf(sb->buf + sb->len, room, fmt, ap);
+		va_end(ap);
+		if (n < 0)
+			return n;
+		if (n < room)
+			break;
+		/* Did not fit, send what is there and retry once empty */
+		if (!sb->len) {
+			n = room - 1;
+			break;
+		}
+		ofp_sendbuf_flush(sb);
+	}
+	sb->len += n;
+
+	return n;
+}
@@ -22,145 +22,241 @@
 #include "ofpi_if_arp.h"
 #include "ofpi_pkt_processing.h"
 #include "ofpi_ipsec.h"
+#include "ofpi_stat.h"
+#include "ofpi_hash.h"
+#include "ofpi_init.h"
 
 #define SHM_NAME_VXLAN "OfpVxlanShMem"
 
-/* MAC address to IP address hash table is an array of key/value pairs,
- * where the key is a MAC address and value is an IP address.
- * Hash value is the two least significant bytes of a MAC address. No extra hash
- * function is needed.
+/*
+ * MAC address to VTEP address table. The table is an array of buckets of
+ * MAC_BUCKET_WAYS entries, one bucket per cache line. A MAC address may
+ * be stored in either of two buckets selected by its hash, so a lookup
+ * reads at most two cache lines regardless of the load. When both
+ * buckets are full, learning replaces the entry of the two that was
+ * seen longest ago.
  *
- * There are no linked lists to resolve hash collisions outside the table;
- * there is only the array itself. A zero or one key in the array designates a free
- * entry, and the array is initially all zeros. Items in the table are inserted
- * and located by performing a linear search. Search begins each linear search
- * at an index determined by the hash. Search stops when a key value zero is seen.
+ * Entries are claimed by swapping the key from KEY_FREE or the evicted
+ * key to KEY_BUSY. The key is published only after the address has been
+ * written, so that lookups never see a key with the address of the
+ * previous user of the entry.
  *
- * After entry deletion the new key value will be 'recycled' to indicate a free
- * place that is not the end of the search.
+ * Learning writes to an entry only when the address changes or the entry
+ * was last refreshed on an earlier tick. Threads learning the same MAC
+ * addresses over and over do not bounce the cache lines of the table.
  *
- * Table is 8k long, which is an overkill. Most probably there will be at most
- * a few hundred entries in the table and since the used hash distributes well
- * a shorter table should be adequate.
+ * Aging is done once per VXLAN_TICK, in batches of buckets sized so that
+ * the whole table is checked every sweep_ticks ticks.
  */
 
-#define NUM_MAC_DST_ENTRIES 0x2000
-#define KEY_FREE            0
-#define KEY_RECYCLED        0x0100000000000001
+#define MAC_BUCKET_WAYS 4
+#define KEY_FREE        0
+#define KEY_BUSY        (1ULL << 63)
 
-#define VXLAN_TICK             20000UL /* Timer resolution */
-#define VXLAN_MAC_IP_AGE       (3600UL*1000000UL) /* 1 hour */
-#define VXLAN_MAC_IP_AGE_TICKS (VXLAN_MAC_IP_AGE/VXLAN_TICK)
+#define VXLAN_TICK        1000000UL /* Timer resolution, one second */
+#define VXLAN_SWEEP_TICKS 64 /* Ticks to check the whole table */
 
 struct mac_dst {
-	odp_atomic_u64_t mac;	/* MAC + 2 bytes padding */
+	odp_atomic_u64_t mac;	/* MAC in the low 6 bytes, or KEY_* */
 	odp_atomic_u32_t addr;	/* IPv4 address of the destination */
-	odp_atomic_u32_t tmo;	/* Last update time */
+	odp_atomic_u32_t seen;	/* Tick of the last update */
 };
 
+struct mac_bucket {
+	struct mac_dst entry[MAC_BUCKET_WAYS];
+} ODP_ALIGNED_CACHE;
+
 struct ofp_vxlan_mem {
-	struct mac_dst mac_to_dst[NUM_MAC_DST_ENTRIES];
-	uint32_t       next_check;	/* Index of entry to check */
-	uint32_t       tick;		/* Time now */
+	uint32_t bucket_mask;
+	uint32_t timeout;	/* Entry timeout in ticks */
+	uint32_t sweep;		/* Buckets to check per tick */
+	uint32_t next_check;	/* Index of bucket to check */
+	uint32_t tick;		/* Time now */
+	/*
+	 * Outer headers of all packets. Only the VNI, the destination,
+	 * the lengths and the UDP source port differ. The IP checksum
+	 * and source address are set by IP output, the UDP checksum is
+	 * not used.
+	 */
+	struct ofp_vxlan_udp_ip hdr;
+	struct mac_bucket bucket[] ODP_ALIGNED_CACHE;
 };
 
+#define SHM_SIZE_VXLAN (sizeof(struct ofp_vxlan_mem) + \
+			sizeof(struct mac_bucket) * mac_num_buckets())
+
 odp_timer_t ofp_vxlan_timer = ODP_TIMER_INVALID;
 
 static __thread struct ofp_vxlan_mem *shm;
 
-void ofp_vxlan_set_mac_dst(uint8_t *mac, uint32_t dst)
+/* Power of two number of buckets for vxlan.mac_entries */
+static uint32_t mac_num_buckets(void)
+{
+	uint32_t need = (global_param->vxlan.mac_entries +
+			 MAC_BUCKET_WAYS - 1) / MAC_BUCKET_WAYS;
+	uint32_t n = 2;
+
+	while (n < need)
+		n <<= 1;
+	return n;
+}
+
+static inline uint64_t mac_key(const uint8_t *mac)
 {
-	int i;
-	/* "hash" is the two least significant bytes of the mac */
-	uint16_t hash = (*((uint16_t *)(&mac[4]))) & (NUM_MAC_DST_ENTRIES - 1);
-	uint64_t key = 0, old_key = KEY_FREE;
+	uint64_t key = 0;
 
 	memcpy((uint8_t *)&key, mac, OFP_ETHER_ADDR_LEN);
+	return key;
+}
 
-	for (i = hash; ; ) {
-		/* Change this to an odp function. */
-		__atomic_compare_exchange_n(&shm->mac_to_dst[i].mac.v,
-					    &old_key, key,
-					    0/*strong*/,
-					    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
-		if (old_key == KEY_FREE || old_key == key) {
-			odp_atomic_store_u32(&shm->mac_to_dst[i].addr, dst);
-			odp_atomic_store_u32(&shm->mac_to_dst[i].tmo,
-					     shm->tick + VXLAN_MAC_IP_AGE_TICKS);
-			OFP_DBG("VXLAN: set mac-dst %s->%s to pos 0x%x",
-				ofp_print_mac(mac),
-				ofp_print_ip_addr(dst), i);
-			return;
-		}
+static inline void mac_buckets(uint64_t key, struct mac_bucket *b[2])
+{
+	uint32_t k[2] = { (uint32_t)key, (uint32_t)(key >> 32) };
+	uint32_t hash = ofp_hash_key(k, 2, 0);
+	uint32_t i = hash & shm->bucket_mask;
+	uint32_t j = ((hash >> 16) | (hash << 16)) & shm->bucket_mask;
+
+	if (j == i)
+		j = i ^ (shm->bucket_mask & 1);
+	b[0] = &shm->bucket[i];
+	b[1] = &shm->bucket[j];
+}
 
-		/* Check for recycled place */
-		old_key = KEY_RECYCLED;
-		__atomic_compare_exchange_n(&shm->mac_to_dst[i].mac.v,
-					    &old_key, key,
-					    0/*strong*/,
-					    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
-		if (old_key == KEY_RECYCLED || old_key == key) {
-			odp_atomic_store_u32(&shm->mac_to_dst[i].addr, dst);
-			odp_atomic_store_u32(&shm->mac_to_dst[i].tmo,
-					     shm->tick + VXLAN_MAC_IP_AGE_TICKS);
-			OFP_DBG("VXLAN: recyc set mac-dst %s->%s to pos 0x%x",
-				ofp_print_mac(mac),
-				ofp_print_ip_addr(dst), i);
-			return;
-		}
+static struct mac_dst *mac_find(struct mac_bucket *b[2], uint64_t key)
+{
+	int i, w;
+
+	for (i = 0; i < 2; i++)
+		for (w = 0; w < MAC_BUCKET_WAYS; w++)
+			if (odp_atomic_load_acq_u64(&b[i]->entry[w].mac) ==
+			    key)
+				return &b[i]->entry[w];
+	return NULL;
+}
 
-		i = (i + 1) & (NUM_MAC_DST_ENTRIES - 1);
-		if (i == hash) {
-			OFP_ERR("VXLAN: No more space in the table");
-			return;
+/*
+ * Claim a free entry, or the least recently seen entry if there are no
+ * free ones. Returns NULL if another thread claimed the entry first.
+ */
+static struct mac_dst *mac_claim(struct mac_bucket *b[2])
+{
+	struct mac_dst *e, *oldest = NULL;
+	uint64_t old;
+	uint32_t age, oldest_age = 0;
+	int i, w;
+
+	for (i = 0; i < 2; i++) {
+		for (w = 0; w < MAC_BUCKET_WAYS; w++) {
+			e = &b[i]->entry[w];
+			old = odp_atomic_load_u64(&e->mac);
+			if (old == KEY_FREE) {
+				if (odp_atomic_cas_u64(&e->mac, &old,
+						       KEY_BUSY))
+					return e;
+				continue;
+			}
+			if (old == KEY_BUSY)
+				continue;
+			age = shm->tick - odp_atomic_load_u32(&e->seen);
+			if (!oldest || age > oldest_age) {
+				oldest = e;
+				oldest_age = age;
+			}
 		}
-        }
+	}
+
+	if (!oldest)
+		return NULL;
+
+	old = odp_atomic_load_u64(&oldest->mac);
+	if (old == KEY_FREE || old == KEY_BUSY ||
+	    !odp_atomic_cas_u64(&oldest->mac, &old, KEY_BUSY))
+		return NULL;
+
+	OFP_DBG("VXLAN: evict mac-dst %s",
+		ofp_print_mac((uint8_t *)&old));
+	return oldest;
+}
+
+void ofp_vxlan_set_mac_dst(uint8_t *mac, uint32_t dst)
+{
+	struct mac_bucket *b[2];
+	struct mac_dst *e;
+	uint64_t key = mac_key(mac);
+	uint32_t tick = shm->tick;
+
+	if (key == KEY_FREE)
+		return;
+
+	mac_buckets(key, b);
+
+	e = mac_find(b, key);
+	if (e) {
+		if (odp_atomic_load_u32(&e->addr) != dst)
+			odp_atomic_store_u32(&e->addr, dst);
+		if (odp_atomic_load_u32(&e->seen) != tick)
+			odp_atomic_store_u32(&e->seen, tick);
+		return;
+	}
+
+	e = mac_claim(b);
+	if (!e) {
+		OFP_DBG("VXLAN: mac-dst %s not learned, buckets busy",
+			ofp_print_mac(mac));
+		return;
+	}
+
+	odp_atomic_store_u32(&e->addr, dst);
+	odp_atomic_store_u32(&e->seen, tick);
+	odp_atomic_store_rel_u64(&e->mac, key);
+
+	OFP_DBG("VXLAN: set mac-dst %s->%s", ofp_print_mac(mac),
+		ofp_print_ip_addr(dst));
 }
 
 uint32_t ofp_vxlan_get_mac_dst(uint8_t *mac)
 {
-	int i;
-	/* "hash" is the two least significant bytes of the mac */
-	uint16_t hash = (*((uint16_t *)(&mac[4]))) & (NUM_MAC_DST_ENTRIES - 1);
-	uint64_t key = 0, probed_key;
+	struct mac_bucket *b[2];
+	struct mac_dst *e;
+	uint64_t key = mac_key(mac);
 
-	memcpy((uint8_t *)&key, mac, OFP_ETHER_ADDR_LEN);
+	mac_buckets(key, b);
 
-	for (i = hash; ; ) {
-		probed_key = odp_atomic_load_u64(&shm->mac_to_dst[i].mac);
-		if (probed_key == key) {
-			OFP_DBG("VXLAN: get mac-dst %s->%s from pos 0x%x",
-				ofp_print_mac(mac),
-				ofp_print_ip_addr(shm->mac_to_dst[i].addr.v), i);
-			return odp_atomic_load_u32(&shm->mac_to_dst[i].addr);
-		}
-		if (probed_key == KEY_FREE)
-			return 0;
-		i = (i + 1) & (NUM_MAC_DST_ENTRIES - 1);
-		if (i == hash)
-			return 0;
-        }
+	e = mac_find(b, key);
+	if (!e)
+		return 0;
+
+	return odp_atomic_load_u32(&e->addr);
 }
 
 static void ofp_vxlan_tmo(void *arg)
 {
-	int i = shm->next_check;
-	uint32_t tmo = odp_atomic_load_u32(&shm->mac_to_dst[i].tmo);
-	uint64_t mac = odp_atomic_load_u64(&shm->mac_to_dst[i].mac);
+	struct mac_dst *e;
+	uint64_t mac;
+	uint32_t i, n;
+	int w;
 	(void)arg;
 
-	if (mac != KEY_FREE &&
-	    mac != KEY_RECYCLED &&
-	    tmo + VXLAN_MAC_IP_AGE_TICKS < shm->tick) {
-		OFP_DBG("VXLAN: tick=%d delete mac-dst %s->%s from pos 0x%x",
-			shm->tick,
-			ofp_print_mac((uint8_t *)(uintptr_t)mac),
-			ofp_print_ip_addr(shm->mac_to_dst[i].addr.v), i);
-		odp_atomic_store_u64(&shm->mac_to_dst[i].mac, KEY_RECYCLED);
+	shm->tick++;
+
+	for (n = 0; n < shm->sweep; n++) {
+		i = shm->next_check;
+		for (w = 0; w < MAC_BUCKET_WAYS; w++) {
+			e = &shm->bucket[i].entry[w];
+			mac = odp_atomic_load_u64(&e->mac);
+			if (mac == KEY_FREE || mac == KEY_BUSY ||
+			    shm->tick - odp_atomic_load_u32(&e->seen) <=
+			    shm->timeout)
+				continue;
+			/* Fails if the entry was just reclaimed */
+			if (odp_atomic_cas_u64(&e->mac, &mac, KEY_FREE))
+				OFP_DBG("VXLAN: tick=%u delete mac-dst %s",
+					shm->tick,
+					ofp_print_mac((uint8_t *)&mac));
+		}
+		shm->next_check = (i + 1) & shm->bucket_mask;
 	}
 
-	shm->tick++;
-	shm->next_check = (shm->next_check + 1) & (NUM_MAC_DST_ENTRIES - 1);
 	ofp_vxlan_timer = ofp_timer_start(VXLAN_TICK, ofp_vxlan_tmo, NULL, 0);
 	if (ODP_TIMER_INVALID == ofp_vxlan_timer)
 		OFP_ERR("Failed to restart VXLAN timer.");
@@ -188,6 +284,7 @@ enum ofp_return_code ofp_vxlan_input(odp_packet_t pkt)
 	dev = ofp_get_ifnet(VXLAN_PORTS, vni);
 	if (!dev)
 		return OFP_PKT_CONTINUE;
+	OFP_IF_STAT_RX(dev, 1, odp_packet_len(pkt));
 
 	/* outer header from address */
 	uint32_t from = ip->ip_src.s_addr;
@@ -210,6 +307,7 @@ enum ofp_return_code ofp_vxlan_input(odp_packet_t pkt)
 	struct vxlan_user_data *saved = &ofp_packet_user_area(pkt)->vxlan;
 	saved->hdrlen = vxlen;
 	saved->vni = vni;
+	ofp_packet_user_area(pkt)->valid |= OFP_UA_VXLAN;
 
 	/* learn mac to dst addr association */
 	ofp_vxlan_set_mac_dst(eth->ether_shost, from);
@@ -225,18 +323,52 @@ enum ofp_return_code ofp_vxlan_input(odp_packet_t pkt)
 	return OFP_PKT_PROCESSED;
 }
 
+/*
+ * UDP source port from the flow of the inner packet, in the range
+ * suggested by RFC 7348, to spread tunneled flows over ECMP paths and
+ * receive queues of the remote VTEP.
+ */
+static inline uint16_t vxlan_src_port(odp_packet_t pkt,
+				      struct ofp_ether_header *eth)
+{
+	struct ofp_ip *ip;
+	uint32_t k[5];
+	uint32_t hash;
+	int len = 3;
+
+	if (odp_packet_has_flow_hash(pkt)) {
+		hash = odp_packet_flow_hash(pkt);
+	} else {
+		memcpy(k, eth, 2 * OFP_ETHER_ADDR_LEN);
+		if (eth->ether_type == odp_cpu_to_be_16(OFP_ETHERTYPE_IP)) {
+			ip = (struct ofp_ip *)(eth + 1);
+			k[3] = ip->ip_src.s_addr;
+			k[4] = ip->ip_dst.s_addr;
+			len = 5;
+		}
+		hash = ofp_hash_key(k, len, 0);
+	}
+
+	return 49152 + (hash & 0x3fff);
+}
+
 enum ofp_return_code ofp_vxlan_prepend_hdr(odp_packet_t pkt, struct ofp_ifnet *vxdev,
 			  struct ofp_nh_entry *nh)
 {
 	struct ofp_vxlan_udp_ip *ip_udp_vxlan;
-	size_t size;
+	struct ofp_ether_header *eth;
+	uint32_t size, gw;
+	uint16_t sport;
 
 	if (nh)
 		nh->gw = 0;
 
+	size = odp_packet_len(pkt);
+	OFP_IF_STAT_TX(vxdev, 1, size);
+
 	/* Find next hop based on inner packet's dest mac */
-	struct ofp_ether_header *eth = odp_packet_data(pkt);
-	uint32_t gw = ofp_vxlan_get_mac_dst(eth->ether_dhost);
+	eth = odp_packet_data(pkt);
+	gw = ofp_vxlan_get_mac_dst(eth->ether_dhost);
 	if (gw == 0) {
 		/* No entry found, use multicast group */
 		struct ofp_ifnet *outdev = ofp_get_ifnet(vxdev->physport,
@@ -248,35 +380,22 @@ enum ofp_return_code ofp_vxlan_prepend_hdr(odp_packet_t pkt, struct ofp_ifnet *v
 			nh->vlan = outdev->vlan;
 		}
 	}
+	sport = vxlan_src_port(pkt, eth);
 
-	size = odp_packet_len(pkt);
 	ip_udp_vxlan = odp_packet_push_head(pkt, sizeof(*ip_udp_vxlan));
 	if (!ip_udp_vxlan) {
 		OFP_ERR("odp_packet_push_head failed");
 		return OFP_PKT_DROP;
 	}
 
-	ip_udp_vxlan->vxlan.flags = odp_cpu_to_be_32(0x08000000);
+	memcpy(ip_udp_vxlan, &shm->hdr, sizeof(*ip_udp_vxlan));
 	ip_udp_vxlan->vxlan.vni = odp_cpu_to_be_32(vxdev->vlan << 8);
-
-	ip_udp_vxlan->udp.uh_sport = odp_cpu_to_be_16(17777);
-	ip_udp_vxlan->udp.uh_dport = odp_cpu_to_be_16(VXLAN_PORT);
+	ip_udp_vxlan->udp.uh_sport = odp_cpu_to_be_16(sport);
 	ip_udp_vxlan->udp.uh_ulen = odp_cpu_to_be_16(
 		size + sizeof(struct ofp_vxlan_h) + sizeof(struct ofp_udphdr));
-	ip_udp_vxlan->udp.uh_sum = 0;
-
-	ip_udp_vxlan->ip.ip_hl = 5;
-	ip_udp_vxlan->ip.ip_v = OFP_IPVERSION;
-	ip_udp_vxlan->ip.ip_tos = 0;
 	ip_udp_vxlan->ip.ip_len = odp_cpu_to_be_16(
 		size + sizeof(struct ofp_vxlan_udp_ip));
-	ip_udp_vxlan->ip.ip_off = 0;
-	ip_udp_vxlan->ip.ip_ttl = 2;
-	ip_udp_vxlan->ip.ip_p = OFP_IPPROTO_UDP;
-
-	ip_udp_vxlan->ip.ip_src.s_addr = 0;
 	ip_udp_vxlan->ip.ip_dst.s_addr = gw;
-	ip_udp_vxlan->ip.ip_sum = 0;
 
 	odp_packet_l2_offset_set(pkt, 0);
 	odp_packet_l3_offset_set(pkt, 0);
@@ -286,7 +405,7 @@ enum ofp_return_code ofp_vxlan_prepend_hdr(odp_packet_t pkt, struct ofp_ifnet *v
 
 static int ofp_vxlan_alloc_shared_memory(void)
 {
-	shm = ofp_shared_memory_alloc(SHM_NAME_VXLAN, sizeof(*shm));
+	shm = ofp_shared_memory_alloc(SHM_NAME_VXLAN, SHM_SIZE_VXLAN);
 	if (shm == NULL) {
 		OFP_ERR("Error: %s shared mem alloc failed on core: %u.\n",
 			SHM_NAME_VXLAN, odp_cpu_id());
@@ -310,14 +429,35 @@ static int ofp_vxlan_free_shared_memory(void)
 
 void ofp_vxlan_init_prepare(void)
 {
-	ofp_shared_memory_prealloc(SHM_NAME_VXLAN, sizeof(*shm));
+	ofp_shared_memory_prealloc(SHM_NAME_VXLAN, SHM_SIZE_VXLAN);
 }
 
 int ofp_vxlan_init_global(void)
 {
+	uint32_t sweep_ticks;
+
+	if (global_param->vxlan.mac_entries < 1 ||
+	    global_param->vxlan.mac_timeout < 1) {
+		OFP_ERR("Invalid VXLAN MAC table parameters");
+		return -1;
+	}
+
 	HANDLE_ERROR(ofp_vxlan_alloc_shared_memory());
 
-	memset(shm, 0, sizeof(*shm));
+	memset(shm, 0, SHM_SIZE_VXLAN);
+	shm->bucket_mask = mac_num_buckets() - 1;
+	shm->timeout = global_param->vxlan.mac_timeout;
+	sweep_ticks = VXLAN_SWEEP_TICKS;
+	if (sweep_ticks > shm->timeout)
+		sweep_ticks = shm->timeout;
+	shm->sweep = (mac_num_buckets() + sweep_ticks - 1) / sweep_ticks;
+
+	shm->hdr.ip.ip_hl = 5;
+	shm->hdr.ip.ip_v = OFP_IPVERSION;
+	shm->hdr.ip.ip_ttl = 2;
+	shm->hdr.ip.ip_p = OFP_IPPROTO_UDP;
+	shm->hdr.udp.uh_dport = odp_cpu_to_be_16(VXLAN_PORT);
+	shm->hdr.vxlan.flags = odp_cpu_to_be_32(0x08000000);
 
 	ofp_vxlan_timer = ofp_timer_start(VXLAN_TICK, ofp_vxlan_tmo, NULL, 0);
 	if (ODP_TIMER_INVALID == ofp_vxlan_timer) {
@@ -0,0 +1,412 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <odp_api.h>
+
+#include "ofpi_log.h"
+#include "ofpi_util.h"
+#include "ofpi_init.h"
+#include "ofpi_route.h"
+#include "ofpi_arp.h"
+#include "ofpi_nh_group.h"
+
+/*
+ * Warm restart state: the IPv4 routes via gateways, the ECMP next hop
+ * groups they use and the complete ARP entries. Routes of interface
+ * addresses are added again when the interfaces are configured and are
+ * not saved. Restoring the ARP entries before the routes lets the
+ * routes find resolved next hops, so forwarding resumes without
+ * waiting for ARP.
+ *
+ * The file is the header followed by arrays of fixed size records:
+ * ARP entries, groups and routes. It is mapped and the routes are
+ * installed in place in one ofp_set_route_msgs_each() call. The records are
+ * in host byte order and the file is valid only on the same kind of
+ * host and with the same record sizes. Version 1 files have no groups
+ * and a shorter header. The ARP table of libck builds is not saved.
+ */
+#define WARM_MAGIC 0x4f465057	/* "OFPW" */
+#define WARM_VERSION 2
+
+struct warm_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t route_size;	/* sizeof(struct ofp_route_msg) */
+	uint32_t arp_size;	/* sizeof(struct warm_arp) */
+	uint32_t num_vrf;
+	uint32_t num_routes;
+	uint32_t num_arps;
+	uint32_t num_groups;	/* 0 in version 1 */
+	/* Version 2 */
+	uint32_t group_size;	/* sizeof(struct warm_group) */
+	uint32_t reserved;
+};
+
+#define WARM_HDR_SIZE_V1 offsetof(struct warm_hdr, group_size)
+
+struct warm_arp {
+	uint32_t addr;
+	uint16_t vrf;
+	uint8_t mac[OFP_ETHER_ADDR_LEN];
+	uint32_t is_manual;
+};
+
+struct warm_group {
+	uint32_t group;		/* index when saved */
+	uint16_t vrf;
+	uint16_t num;
+	struct ofp_nh_group_member member[OFP_NH_GROUP_MAX];
+};
+
+struct warm_save {
+	FILE *f;
+	struct warm_hdr hdr;
+	uint8_t group_saved[OFP_NUM_NH_GROUPS];
+	int error;
+};
+
+/* Groups allocated by ofp_warm_restore(), freed by ofp_warm_reconcile() */
+static struct {
+	int32_t group[OFP_NUM_NH_GROUPS];
+	int num_groups;
+} warm;
+
+static int route_saved(const struct ofp_route_msg *msg)
+{
+	if (msg->flags & OFP_RTF_LOCAL)
+		return 0;
+	if (msg->flags & OFP_RTF_MULTIPATH)
+		return msg->gw < OFP_NUM_NH_GROUPS;
+	return msg->gw != 0;
+}
+
+static void save_group(void *arg, const struct ofp_route_msg *msg)
+{
+	struct warm_save *s = arg;
+	struct warm_group rec;
+	int num;
+
+	if (!(msg->flags & OFP_RTF_MULTIPATH) || !route_saved(msg) ||
+	    s->group_saved[msg->gw])
+		return;
+
+	memset(&rec, 0, sizeof(rec));
+	num = ofp_nh_group_get(msg->gw, &rec.vrf, rec.member);
+	if (num < 0)
+		return;
+	rec.group = msg->gw;
+	rec.num = num;
+
+	if (fwrite(&rec, sizeof(rec), 1, s->f) != 1)
+		s->error = 1;
+	s->group_saved[msg->gw] = 1;
+	s->hdr.num_groups++;
+}
+
+static void save_route(void *arg, const struct ofp_route_msg *msg)
+{
+	struct warm_save *s = arg;
+	struct ofp_route_msg rec;
+
+	if (!route_saved(msg) ||
+	    ((msg->flags & OFP_RTF_MULTIPATH) && !s->group_saved[msg->gw]))
+		return;
+
+	rec = *msg;
+	rec.flags &= ~OFP_RTF_WARM;
+	if (fwrite(&rec, sizeof(rec), 1, s->f) != 1)
+		s->error = 1;
+	s->hdr.num_routes++;
+}
+
+#ifndef OFP_USE_LIBCK
+static void save_arp(void *arg, uint16_t vrf, uint32_t addr,
+		     const uint8_t *mac, odp_bool_t is_manual)
+{
+	struct warm_save *s = arg;
+	struct warm_arp rec;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.addr = addr;
+	rec.vrf = vrf;
+	memcpy(rec.mac, mac, OFP_ETHER_ADDR_LEN);
+	rec.is_manual = is_manual;
+
+	if (fwrite(&rec, sizeof(rec), 1, s->f) != 1)
+		s->error = 1;
+	s->hdr.num_arps++;
+}
+#endif
+
+int ofp_warm_save(const char *file)
+{
+	char tmp[strlen(file) + sizeof(".tmp")];
+	struct warm_save s;
+
+	/* Written aside and renamed, a crash leaves the old state intact */
+	snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+	s.f = fopen(tmp, "w");
+	if (!s.f) {
+		OFP_ERR("Cannot create %s: %s", tmp, strerror(errno));
+		return -1;
+	}
+
+	memset(&s.hdr, 0, sizeof(s.hdr));
+	s.hdr.magic = WARM_MAGIC;
+	s.hdr.version = WARM_VERSION;
+	s.hdr.route_size = sizeof(struct ofp_route_msg);
+	s.hdr.arp_size = sizeof(struct warm_arp);
+	s.hdr.group_size = sizeof(struct warm_group);
+	s.hdr.num_vrf = global_param->num_vrf;
+	memset(s.group_saved, 0, sizeof(s.group_saved));
+	s.error = 0;
+
+	/* Header first as a placeholder, rewritten with the counts */
+	if (fwrite(&s.hdr, sizeof(s.hdr), 1, s.f) != 1)
+		s.error = 1;
+#ifndef OFP_USE_LIBCK
+	ofp_arp_walk(save_arp, &s);
+#endif
+	/* Routes of groups created between the walks are not saved */
+	ofp_route_walk(save_group, &s);
+	ofp_route_walk(save_route, &s);
+
+	if (fseek(s.f, 0, SEEK_SET) ||
+	    fwrite(&s.hdr, sizeof(s.hdr), 1, s.f) != 1)
+		s.error = 1;
+	if (fclose(s.f))
+		s.error = 1;
+
+	if (s.error || rename(tmp, file)) {
+		OFP_ERR("Failed to write %s", file);
+		remove(tmp);
+		return -1;
+	}
+
+	OFP_INFO("Saved %u routes, %u next hop groups and %u ARP entries "
+		 "to %s", s.hdr.num_routes, s.hdr.num_groups, s.hdr.num_arps,
+		 file);
+	return 0;
+}
+
+static uint64_t hdr_size(const struct warm_hdr *hdr)
+{
+	return hdr->version == 1 ? WARM_HDR_SIZE_V1 : sizeof(*hdr);
+}
+
+static int check_hdr(const struct warm_hdr *hdr, uint64_t size,
+		     const char *file)
+{
+	if (size < WARM_HDR_SIZE_V1 || hdr->magic != WARM_MAGIC ||
+	    hdr->version < 1 || hdr->version > WARM_VERSION ||
+	    size < hdr_size(hdr) ||
+	    hdr->route_size != sizeof(struct ofp_route_msg) ||
+	    hdr->arp_size != sizeof(struct warm_arp) ||
+	    (hdr->version > 1 &&
+	     hdr->group_size != sizeof(struct warm_group))) {
+		OFP_ERR("%s: unknown warm restart file layout", file);
+		return -1;
+	}
+	if (hdr->num_vrf > (uint32_t)global_param->num_vrf) {
+		OFP_ERR("%s: saved with %u VRFs, %d configured", file,
+			hdr->num_vrf, global_param->num_vrf);
+		return -1;
+	}
+	if (hdr->version == 1 && hdr->num_groups)
+		goto truncated;
+	if (size < hdr_size(hdr) +
+	    (uint64_t)hdr->num_arps * sizeof(struct warm_arp) +
+	    (uint64_t)hdr->num_groups * sizeof(struct warm_group) +
+	    (uint64_t)hdr->num_routes * sizeof(struct ofp_route_msg))
+		goto truncated;
+	return 0;
+
+truncated:
+	OFP_ERR("%s: truncated warm restart file", file);
+	return -1;
+}
+
+/* Allocate the saved groups, map[] gets their new indexes */
+static void restore_groups(const struct warm_group *rec, uint32_t num,
+			   int32_t *map)
+{
+	uint32_t i;
+	int32_t g;
+
+	for (i = 0; i < num; i++) {
+		if (rec[i].group >= OFP_NUM_NH_GROUPS ||
+		    rec[i].num > OFP_NH_GROUP_MAX)
+			continue;
+		g = ofp_nh_group_alloc();
+		if (g < 0)
+			break;
+		if (ofp_nh_group_set(rec[i].vrf, g, rec[i].member,
+				     rec[i].num)) {
+			ofp_nh_group_del(g);
+			continue;
+		}
+		map[rec[i].group] = g;
+		warm.group[warm.num_groups++] = g;
+	}
+}
+
+int ofp_warm_restore(const char *file)
+{
+	int32_t map[OFP_NUM_NH_GROUPS];
+	const struct warm_hdr *hdr;
+	const struct warm_arp *rec;
+	const struct warm_group *groups;
+	struct ofp_route_msg *routes;
+	struct stat st;
+#ifndef OFP_USE_LIBCK
+	uint8_t mac[OFP_ETHER_ADDR_LEN];
+	uint32_t idx;
+#endif
+	uint32_t i, n, lost, arps = 0;
+	uint8_t *base;
+	int ret = -1;
+	int fd;
+
+	fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		/* Nothing saved yet: a cold start */
+		if (errno == ENOENT)
+			return 0;
+		OFP_ERR("Cannot open %s: %s", file, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(fd, &st) || st.st_size < (off_t)WARM_HDR_SIZE_V1) {
+		OFP_ERR("%s: truncated warm restart file", file);
+		close(fd);
+		return -1;
+	}
+
+	/* Private, so that the route records can be installed in place */
+	base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		    fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		OFP_ERR("Cannot map %s: %s", file, strerror(errno));
+		return -1;
+	}
+
+	hdr = (const struct warm_hdr *)base;
+	if (check_hdr(hdr, st.st_size, file))
+		goto out;
+
+	rec = (const struct warm_arp *)(base + hdr_size(hdr));
+	groups = (const struct warm_group *)(rec + hdr->num_arps);
+	routes = (struct ofp_route_msg *)(base + hdr_size(hdr) +
+		hdr->num_arps * sizeof(*rec) +
+		hdr->num_groups * sizeof(*groups));
+
+	for (i = 0; i < hdr->num_arps; i++) {
+#ifndef OFP_USE_LIBCK
+		/* Sending pending makes the entry age from now on */
+		memcpy(mac, rec[i].mac, sizeof(mac));
+		if (!ofp_arp_ipv4_insert_entry(rec[i].addr, mac,
+					       rec[i].vrf, TRUE,
+					       rec[i].is_manual, &idx, TRUE))
+			arps++;
+#endif
+	}
+
+	for (i = 0; i < OFP_NUM_NH_GROUPS; i++)
+		map[i] = -1;
+	restore_groups(groups, hdr->num_groups, map);
+
+	/* Routes of groups that could not be restored are dropped */
+	for (i = 0, n = 0; i < hdr->num_routes; i++) {
+		struct ofp_route_msg *msg = &routes[i];
+
+		if (msg->flags & OFP_RTF_MULTIPATH) {
+			if (msg->gw >= OFP_NUM_NH_GROUPS || map[msg->gw] < 0)
+				continue;
+			msg->gw = map[msg->gw];
+		}
+		msg->type = OFP_ROUTE_ADD;
+		msg->flags |= OFP_RTF_WARM;
+		routes[n++] = *msg;
+	}
+	/* One invalid route must not drop the rest of its batch */
+	lost = hdr->num_routes - n + ofp_set_route_msgs_each(routes, n);
+	if (lost)
+		OFP_WARN("%s: %u routes were not restored", file, lost);
+
+	OFP_INFO("Restored %u routes, %d next hop groups and %u ARP entries "
+		 "from %s", hdr->num_routes - lost, warm.num_groups, arps,
+		 file);
+	ret = lost;
+out:
+	munmap(base, st.st_size);
+	return ret;
+}
+
+struct warm_stale {
+	struct ofp_route_msg *msgs;
+	int num;
+	int max;
+	int error;
+};
+
+static void stale_route(void *arg, const struct ofp_route_msg *msg)
+{
+	struct warm_stale *s = arg;
+	struct ofp_route_msg *msgs;
+
+	if (!(msg->flags & OFP_RTF_WARM) || s->error)
+		return;
+
+	if (s->num == s->max) {
+		s->max = s->max ? 2 * s->max : 256;
+		msgs = realloc(s->msgs, s->max * sizeof(*msgs));
+		if (!msgs) {
+			s->error = 1;
+			return;
+		}
+		s->msgs = msgs;
+	}
+	s->msgs[s->num] = *msg;
+	s->msgs[s->num].type = OFP_ROUTE_DEL;
+	s->num++;
+}
+
+int ofp_warm_reconcile(void)
+{
+	struct warm_stale s;
+	int i;
+
+	memset(&s, 0, sizeof(s));
+	/* Deleted after the walk, which holds the route lock */
+	ofp_route_walk(stale_route, &s);
+	if (s.error) {
+		OFP_ERR("Out of memory for the stale routes");
+		free(s.msgs);
+		return -1;
+	}
+
+	if (s.num && ofp_set_route_msgs_each(s.msgs, s.num))
+		OFP_WARN("Some stale routes were not removed");
+	free(s.msgs);
+
+	/* Routes still using the groups free them on release */
+	for (i = 0; i < warm.num_groups; i++)
+		ofp_nh_group_del(warm.group[i]);
+	warm.num_groups = 0;
+
+	OFP_INFO("Removed %d restored routes not added again", s.num);
+	return s.num;
+}
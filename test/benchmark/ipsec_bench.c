@@ -0,0 +1,740 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * IPsec throughput through the fast path.
+ *
+ * The setup follows example/ipsec: a tunnel between VRF 0 and VRF 1 of
+ * one OFP instance, with the algorithms and keys of aesgcm.cli or
+ * aescbc_sha1.cli. Ports have no packet IO, their output queues are
+ * polled by the workers instead:
+ *
+ *   fp0 (VRF 0) -> SPD, encrypt -> fp2 out -> fp3 (VRF 1) -> decrypt
+ *   -> fp1 out -> back to fp0
+ *
+ * Each worker keeps a fixed number of packets going around, so every
+ * packet counted has been forwarded, encrypted, decrypted and forwarded
+ * again. The outbound SPD has --sps policies, each protecting one /24
+ * with SA (policy % --sas). Traffic is spread evenly over the policies.
+ * The result is one JSON object on a line:
+ *
+ *   {"bench":"ipsec","alg":"aes-gcm","mode":"sync","sas":16,
+ *    "sps":256,"size":512,"workers":2,"burst":1,"mpps":1.234,
+ *    "gbps":4.854,"cycles_per_pkt":3210}
+ *
+ * Gbps counts the IP bytes of the cleartext packets. Cycles per packet
+ * are the worker cycles of iterations that had packets, per round trip.
+ *
+ * Inline mode needs packet IO towards the tunnel endpoint and cannot be
+ * looped back like this, so only sync and async modes are measured.
+ * Anti-replay is disabled since async completions of several workers
+ * arrive out of order.
+ */
+
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <odp_api.h>
+#include <ofp.h>
+#include <ofpi.h>
+#include <ofpi_pkt_processing.h>
+
+#define STR(x) #x
+#define ASSERT(x)						\
+	do {							\
+		if (!(x)) {					\
+			fprintf(stderr, __FILE__ "(%d): assert failed: " \
+				STR(x) "\n", __LINE__);		\
+			exit(1);				\
+		}						\
+	} while (0)
+
+odp_instance_t instance;
+
+/* Clear side in VRF 0, tunnel on fp2/fp3, clear side in VRF 1 */
+#define P_IN 0
+#define P_OUT 1
+#define P_TUN_OUT 2
+#define P_TUN_IN 3
+#define C_VRF_OUT 0
+#define C_VRF_IN 1
+#define C_IN_ADDR 0x0a000001
+#define C_SRC_ADDR 0x0a000002
+#define C_TUN_SRC 0x0a020001
+#define C_TUN_DST 0x0a020002
+#define C_OUT_ADDR 0x0a030001
+#define C_OUT_GW 0x0a030002
+/* Policy i protects C_DST_ADDR + (i << 8), within 10.128.0.0/9 */
+#define C_DST_ADDR 0x0a800000
+#define C_DST_MASKLEN 9
+#define C_MAX_SP (1 << (32 - C_DST_MASKLEN - 8))
+#define C_TTL 64
+#define C_UDP_SPORT 10000
+#define C_UDP_DPORT 10001
+#define C_SA_ID_OUT 1
+#define C_SA_ID_IN 0x100000
+#define C_SP_ID_OUT 1
+#define C_SP_ID_IN 0x100000
+
+/* Events dequeued at once */
+#define BURST 32
+/* Wait for the last async completions before teardown */
+#define DRAIN_MS 100
+
+struct arg_s {
+	uint32_t burst, duration, inflight, loglevel, sas, size, sps, warmup,
+		workers;
+	const char *alg, *mode;
+} arg, default_arg = {
+	.burst = 1,
+	.duration = 2000,
+	.inflight = 64,
+	.loglevel = OFP_LOG_ERROR,
+	.sas = 1,
+	.size = 512,
+	.sps = 1,
+	.warmup = 500,
+	.workers = 1,
+	.alg = "aes-gcm",
+	.mode = "sync",
+};
+
+struct ODP_ALIGNED_CACHE wstate_s {
+	uint64_t pkts;
+	uint64_t bytes;
+	uint64_t cycles;
+	unsigned int seed;
+} wstate[ODP_THREAD_COUNT_MAX];
+
+static volatile int stop;
+static odp_barrier_t barrier;
+static odp_pool_t pool;
+static odp_queue_t in_queue[2];
+static odp_queue_t compl_queue = ODP_QUEUE_INVALID;
+static int async;
+
+static uint32_t rnd(int tid)
+{
+	return (uint32_t)rand_r(&wstate[tid].seed);
+}
+
+/* Set the destination and the header fields OFP has changed */
+static void plain_init(odp_packet_t pkt, int tid)
+{
+	uint8_t *buf = odp_packet_data(pkt);
+	struct ofp_ip *ip = (struct ofp_ip *)(buf + OFP_ETHER_HDR_LEN);
+
+	ip->ip_ttl = C_TTL;
+	ip->ip_dst.s_addr = odp_cpu_to_be_32(C_DST_ADDR +
+					     ((rnd(tid) % arg.sps) << 8) + 1);
+	ip->ip_sum = 0;
+	ip->ip_sum = ofp_cksum_buffer(ip, sizeof(*ip));
+
+	ofp_packet_user_area_reset(pkt);
+	odp_packet_has_eth_set(pkt, 1);
+	odp_packet_has_ipv4_set(pkt, 1);
+	odp_packet_l2_offset_set(pkt, 0);
+	odp_packet_l3_offset_set(pkt, OFP_ETHER_HDR_LEN);
+	odp_packet_l4_offset_set(pkt, OFP_ETHER_HDR_LEN + sizeof(*ip));
+}
+
+static odp_packet_t plain_alloc(void)
+{
+	odp_packet_t pkt = odp_packet_alloc(pool, arg.size);
+	struct ofp_ether_header *eth;
+	struct ofp_udphdr *udp;
+	struct ofp_ip *ip;
+	uint8_t *buf;
+
+	ASSERT(pkt != ODP_PACKET_INVALID);
+	buf = odp_packet_data(pkt);
+	memset(buf, 0, arg.size);
+
+	eth = (struct ofp_ether_header *)buf;
+	eth->ether_dhost[0] = 0xa;
+	eth->ether_shost[0] = 0xb;
+	eth->ether_type = odp_cpu_to_be_16(OFP_ETHERTYPE_IP);
+
+	ip = (struct ofp_ip *)(eth + 1);
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(*ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(arg.size - OFP_ETHER_HDR_LEN);
+	ip->ip_off = odp_cpu_to_be_16(OFP_IP_DF);
+	ip->ip_p = OFP_IPPROTO_UDP;
+	ip->ip_src.s_addr = odp_cpu_to_be_32(C_SRC_ADDR);
+
+	udp = (struct ofp_udphdr *)(ip + 1);
+	udp->uh_sport = odp_cpu_to_be_16(C_UDP_SPORT);
+	udp->uh_dport = odp_cpu_to_be_16(C_UDP_DPORT);
+	udp->uh_ulen = odp_cpu_to_be_16(arg.size - OFP_ETHER_HDR_LEN -
+					sizeof(*ip));
+
+	return pkt;
+}
+
+static int worker(void *p)
+{
+	int tid = (uintptr_t)p;
+	struct wstate_s *ws = &wstate[tid];
+	struct ofp_ifnet *plain = ofp_get_ifnet(P_OUT, 0);
+	struct ofp_ifnet *tun = ofp_get_ifnet(P_TUN_OUT, 0);
+	odp_queue_t plain_q = plain->out_queue_queue[tid];
+	odp_queue_t tun_q = tun->out_queue_queue[tid];
+	odp_event_t ev[BURST];
+	odp_packet_t pkt;
+	uint64_t c0;
+	int num, n, i;
+
+	ASSERT(!ofp_init_local());
+	/* Output of this thread goes to queues tid, see tx_queue_select() */
+	ofp_send_queue_set(tid);
+
+	for (i = 0; i < (int)arg.inflight; i++) {
+		pkt = plain_alloc();
+		plain_init(pkt, tid);
+		ofp_packet_input(pkt, in_queue[0], ofp_eth_vlan_processing);
+	}
+	ofp_send_pending_pkt();
+
+	odp_barrier_wait(&barrier);
+
+	while (!stop) {
+		c0 = odp_cpu_cycles();
+		n = 0;
+
+		/* Decrypted: count and send around again */
+		num = odp_queue_deq_multi(plain_q, ev, BURST);
+		for (i = 0; i < num; i++) {
+			pkt = odp_packet_from_event(ev[i]);
+			ws->bytes += odp_packet_len(pkt) - OFP_ETHER_HDR_LEN;
+			plain_init(pkt, tid);
+			ofp_packet_input(pkt, in_queue[0],
+					 ofp_eth_vlan_processing);
+		}
+		if (num > 0) {
+			ws->pkts += num;
+			n += num;
+		}
+
+		/* Encrypted: to the tunnel endpoint in VRF 1 */
+		num = odp_queue_deq_multi(tun_q, ev, BURST);
+		for (i = 0; i < num; i++) {
+			pkt = odp_packet_from_event(ev[i]);
+			ofp_packet_user_area_reset(pkt);
+			odp_packet_l2_offset_set(pkt, 0);
+			odp_packet_l3_offset_set(pkt, OFP_ETHER_HDR_LEN);
+			ofp_packet_input(pkt, in_queue[1],
+					 ofp_eth_vlan_processing);
+		}
+		if (num > 0)
+			n += num;
+
+		if (async) {
+			num = odp_queue_deq_multi(compl_queue, ev, BURST);
+			if (num > 0) {
+				ofp_ipsec_packet_event_multi(ev, num,
+							     compl_queue);
+				n += num;
+			}
+		}
+
+		/* Also submits the collected IPsec bursts */
+		ofp_send_pending_pkt();
+
+		if (n > 0)
+			ws->cycles += odp_cpu_cycles_diff(odp_cpu_cycles(), c0);
+	}
+
+	odp_barrier_wait(&barrier);
+	ASSERT(!ofp_term_local());
+	return 0;
+}
+
+static int drain_queue(odp_queue_t q)
+{
+	odp_event_t ev[BURST];
+	int num, n = 0;
+
+	while ((num = odp_queue_deq_multi(q, ev, BURST)) > 0) {
+		odp_event_free_multi(ev, num);
+		n += num;
+	}
+	return n;
+}
+
+/* Free the packets left in the queues once the workers have stopped */
+static void drain(void)
+{
+	static const int ports[] = {P_IN, P_OUT, P_TUN_OUT, P_TUN_IN};
+	struct ofp_ifnet *ifnet;
+	odp_time_t end;
+	uint32_t i, p;
+	int n;
+
+	end = odp_time_sum(odp_time_global(),
+			   odp_time_global_from_ns(DRAIN_MS *
+						   ODP_TIME_MSEC_IN_NS));
+	do {
+		n = 0;
+		for (p = 0; p < sizeof(ports) / sizeof(ports[0]); p++) {
+			ifnet = ofp_get_ifnet(ports[p], 0);
+			for (i = 0; i < arg.workers; i++)
+				n += drain_queue(ifnet->out_queue_queue[i]);
+		}
+		if (async)
+			n += drain_queue(compl_queue);
+	} while (n || odp_time_cmp(end, odp_time_global()) > 0);
+}
+
+static void sa_param(ofp_ipsec_sa_param_t *sa, ofp_ipsec_dir_t dir,
+		     uint32_t i)
+{
+	static const uint8_t gcm_key[] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+		0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+		0x00, 0x11, 0x22, 0x33,
+	};
+	static const uint8_t cbc_key[] = {
+		0x29, 0x9f, 0x31, 0xd0, 0x08, 0x2e, 0xfa, 0x98,
+		0xec, 0x4e, 0x6c, 0x89, 0x45, 0x28, 0x21, 0xe6,
+	};
+	static const uint8_t sha1_key[] = {
+		0x38, 0xd0, 0x13, 0x77, 0xbe, 0x54, 0x66, 0xcf,
+		0x34, 0xe9, 0x0c, 0x6c, 0xc0, 0xac, 0x29, 0xb7,
+	};
+	ofp_ipsec_crypto_param_t *c = &sa->crypto;
+
+	ofp_ipsec_sa_param_init(sa);
+	sa->dir = dir;
+	sa->proto = OFP_IPSEC_PROTO_ESP;
+	sa->mode = OFP_IPSEC_MODE_TUNNEL;
+	sa->spi = i + 1;
+	if (dir == OFP_IPSEC_DIR_OUTBOUND) {
+		sa->vrf = C_VRF_OUT;
+		sa->id = C_SA_ID_OUT + i;
+	} else {
+		sa->vrf = C_VRF_IN;
+		sa->id = C_SA_ID_IN + i;
+	}
+	sa->tunnel.type = OFP_IPSEC_TUNNEL_IPV4;
+	sa->tunnel.ipv4.src_addr.s_addr = odp_cpu_to_be_32(C_TUN_SRC);
+	sa->tunnel.ipv4.dst_addr.s_addr = odp_cpu_to_be_32(C_TUN_DST);
+	sa->tunnel.ipv4.ttl = C_TTL;
+
+	if (!strcmp(arg.alg, "aes-gcm")) {
+		c->cipher_alg = OFP_IPSEC_CIPHER_ALG_AES_GCM;
+		c->cipher_key.key_len = sizeof(gcm_key);
+		memcpy(c->cipher_key.key_data, gcm_key, sizeof(gcm_key));
+		c->auth_alg = OFP_IPSEC_AUTH_ALG_AES_GCM;
+		c->auth_key = c->cipher_key;
+	} else {
+		c->cipher_alg = OFP_IPSEC_CIPHER_ALG_AES_CBC;
+		c->cipher_key.key_len = sizeof(cbc_key);
+		memcpy(c->cipher_key.key_data, cbc_key, sizeof(cbc_key));
+		c->auth_alg = OFP_IPSEC_AUTH_ALG_SHA1_HMAC;
+		c->auth_key.key_len = sizeof(sha1_key);
+		memcpy(c->auth_key.key_data, sha1_key, sizeof(sha1_key));
+	}
+}
+
+static void sp_param(ofp_ipsec_sp_param_t *sp, ofp_ipsec_dir_t dir,
+		     uint32_t first, uint32_t last)
+{
+	ofp_ipsec_selectors_t *s = &sp->selectors;
+
+	ofp_ipsec_sp_param_init(sp);
+	sp->dir = dir;
+	s->type = OFP_IPSEC_SELECTOR_IPV4;
+	s->src_ipv4_range.first_addr.s_addr = odp_cpu_to_be_32(C_SRC_ADDR);
+	s->src_ipv4_range.last_addr.s_addr = odp_cpu_to_be_32(C_SRC_ADDR);
+	s->dst_ipv4_range.first_addr.s_addr = odp_cpu_to_be_32(first);
+	s->dst_ipv4_range.last_addr.s_addr = odp_cpu_to_be_32(last);
+	s->ip_proto = OFP_IPPROTO_UDP;
+}
+
+static void ipsec_setup(void)
+{
+	ofp_ipsec_sa_handle out_sa[arg.sas], in_sa;
+	ofp_ipsec_sp_param_t sp;
+	ofp_ipsec_sa_param_t sa;
+	ofp_ipsec_sp_handle h;
+	uint32_t i, dst, sa_idx;
+
+	/*
+	 * An SA pair per SPI. The inbound policy only gives the inbound
+	 * SA its selectors, decrypted packets skip the inbound check.
+	 */
+	for (i = 0; i < arg.sas; i++) {
+		sa_param(&sa, OFP_IPSEC_DIR_OUTBOUND, i);
+		out_sa[i] = ofp_ipsec_sa_create(&sa);
+		ASSERT(out_sa[i] != OFP_IPSEC_SA_INVALID);
+
+		sa_param(&sa, OFP_IPSEC_DIR_INBOUND, i);
+		in_sa = ofp_ipsec_sa_create(&sa);
+		ASSERT(in_sa != OFP_IPSEC_SA_INVALID);
+
+		sp_param(&sp, OFP_IPSEC_DIR_INBOUND, C_DST_ADDR,
+			 C_DST_ADDR + (C_MAX_SP << 8) - 1);
+		sp.action = OFP_IPSEC_ACTION_DISCARD;
+		sp.priority = i;
+		sp.vrf = C_VRF_IN;
+		sp.id = C_SP_ID_IN + i;
+		h = ofp_ipsec_sp_create(&sp);
+		ASSERT(h != OFP_IPSEC_SP_INVALID);
+		ASSERT(!ofp_ipsec_sp_bind(h, in_sa));
+		ofp_ipsec_sp_unref(h);
+		ofp_ipsec_sa_unref(in_sa);
+	}
+
+	/* Outbound: a policy per /24 */
+	for (i = 0; i < arg.sps; i++) {
+		dst = C_DST_ADDR + (i << 8);
+		sp_param(&sp, OFP_IPSEC_DIR_OUTBOUND, dst, dst + 255);
+		sp.action = OFP_IPSEC_ACTION_PROTECT;
+		sp.priority = i;
+		sp.vrf = C_VRF_OUT;
+		sp.id = C_SP_ID_OUT + i;
+		h = ofp_ipsec_sp_create(&sp);
+		ASSERT(h != OFP_IPSEC_SP_INVALID);
+		sa_idx = i % arg.sas;
+		ASSERT(!ofp_ipsec_sp_bind(h, out_sa[sa_idx]));
+		ofp_ipsec_sp_unref(h);
+	}
+
+	for (i = 0; i < arg.sas; i++)
+		ofp_ipsec_sa_unref(out_sa[i]);
+}
+
+static struct ofp_ifnet *port_setup(int port, uint16_t vrf, uint32_t addr)
+{
+	odp_queue_param_t qpar;
+	struct ofp_ifnet *ifnet;
+	char str[64];
+	uint32_t i;
+
+	ASSERT(!ofp_config_interface_up_v4(port, 0, vrf,
+					   odp_cpu_to_be_32(addr), 24));
+	ifnet = ofp_get_ifnet(port, 0);
+	ifnet->pkt_pool = pool;
+
+	odp_queue_param_init(&qpar);
+	qpar.enq_mode = ODP_QUEUE_OP_MT;
+	qpar.deq_mode = ODP_QUEUE_OP_MT_UNSAFE;
+	for (i = 0; i < arg.workers; i++) {
+		snprintf(str, sizeof(str), "out_queue:%d:%u", port, i);
+		ifnet->out_queue_queue[i] = odp_queue_create(str, &qpar);
+		ASSERT(ifnet->out_queue_queue[i] != ODP_QUEUE_INVALID);
+	}
+	ifnet->out_queue_num = arg.workers;
+	ifnet->out_queue_type = OFP_OUT_QUEUE_TYPE_QUEUE;
+
+	return ifnet;
+}
+
+static void port_teardown(int port)
+{
+	struct ofp_ifnet *ifnet = ofp_get_ifnet(port, 0);
+	uint32_t i;
+
+	for (i = 0; i < arg.workers; i++)
+		ASSERT(!odp_queue_destroy(ifnet->out_queue_queue[i]));
+	ifnet->out_queue_num = 0;
+}
+
+static void net_setup(void)
+{
+	uint8_t mac[OFP_ETHER_ADDR_LEN] = {0xa, 0xb, 0, 0, 0, 0};
+	struct ofp_ifnet *ifnet;
+	uint32_t addr;
+	char str[64];
+	int i;
+
+	port_setup(P_IN, C_VRF_OUT, C_IN_ADDR);
+	ifnet = port_setup(P_TUN_OUT, C_VRF_OUT, C_TUN_SRC);
+	addr = odp_cpu_to_be_32(C_TUN_DST);
+	memcpy(mac + 2, &addr, 4);
+	ASSERT(!ofp_add_mac(ifnet, addr, mac));
+	ASSERT(!ofp_set_route_params(OFP_ROUTE_ADD, C_VRF_OUT, 0, P_TUN_OUT,
+				     odp_cpu_to_be_32(C_DST_ADDR),
+				     C_DST_MASKLEN, addr, OFP_RTF_GATEWAY));
+
+	port_setup(P_TUN_IN, C_VRF_IN, C_TUN_DST);
+	ifnet = port_setup(P_OUT, C_VRF_IN, C_OUT_ADDR);
+	addr = odp_cpu_to_be_32(C_OUT_GW);
+	memcpy(mac + 2, &addr, 4);
+	ASSERT(!ofp_add_mac(ifnet, addr, mac));
+	ASSERT(!ofp_set_route_params(OFP_ROUTE_ADD, C_VRF_IN, 0, P_OUT,
+				     odp_cpu_to_be_32(C_DST_ADDR),
+				     C_DST_MASKLEN, addr, OFP_RTF_GATEWAY));
+
+	/* Only the context of the input queues is used */
+	for (i = 0; i < 2; i++) {
+		ifnet = ofp_get_ifnet(i ? P_TUN_IN : P_IN, 0);
+		snprintf(str, sizeof(str), "in_queue:%d", ifnet->port);
+		in_queue[i] = odp_queue_create(str, NULL);
+		ASSERT(in_queue[i] != ODP_QUEUE_INVALID);
+		ASSERT(!odp_queue_context_set(in_queue[i], ifnet,
+					      sizeof(ifnet)));
+	}
+}
+
+static void run(const odp_cpumask_t *cpus)
+{
+	odph_thread_t thread_tbl[ODP_THREAD_COUNT_MAX];
+	odph_thread_common_param_t thr_common;
+	odph_thread_param_t thr_param;
+	uint64_t start, end, pkts = 0, bytes = 0, cycles = 0;
+	odp_cpumask_t cpumask;
+	double sec;
+	uint32_t i;
+	int cpu;
+
+	memset(wstate, 0, sizeof(wstate));
+	odp_barrier_init(&barrier, arg.workers + 1);
+
+	cpu = odp_cpumask_first(cpus);
+	for (i = 0; i < arg.workers; i++) {
+		wstate[i].seed = i + 1;
+
+		odp_cpumask_zero(&cpumask);
+		odp_cpumask_set(&cpumask, cpu);
+		cpu = odp_cpumask_next(cpus, cpu);
+
+		memset(&thr_param, 0, sizeof(thr_param));
+		thr_param.start = worker;
+		thr_param.arg = (void *)(uintptr_t)i;
+		thr_param.thr_type = ODP_THREAD_WORKER;
+		odph_thread_common_param_init(&thr_common);
+		thr_common.instance = instance;
+		thr_common.cpumask = &cpumask;
+		ASSERT(odph_thread_create(&thread_tbl[i], &thr_common,
+					  &thr_param, 1) == 1);
+	}
+
+	odp_barrier_wait(&barrier);
+	poll(0, 0, arg.warmup);
+
+	for (i = 0; i < arg.workers; i++) {
+		pkts -= __atomic_load_n(&wstate[i].pkts, __ATOMIC_RELAXED);
+		bytes -= __atomic_load_n(&wstate[i].bytes, __ATOMIC_RELAXED);
+		cycles -= __atomic_load_n(&wstate[i].cycles,
+					  __ATOMIC_RELAXED);
+	}
+	start = odp_time_to_ns(odp_time_global());
+	poll(0, 0, arg.duration);
+	end = odp_time_to_ns(odp_time_global());
+	for (i = 0; i < arg.workers; i++) {
+		pkts += __atomic_load_n(&wstate[i].pkts, __ATOMIC_RELAXED);
+		bytes += __atomic_load_n(&wstate[i].bytes, __ATOMIC_RELAXED);
+		cycles += __atomic_load_n(&wstate[i].cycles,
+					  __ATOMIC_RELAXED);
+	}
+
+	stop = 1;
+	odp_barrier_wait(&barrier);
+	odph_thread_join(thread_tbl, arg.workers);
+	drain();
+
+	if (!pkts)
+		fprintf(stderr, "No packets made it through the tunnel\n");
+
+	sec = (double)(end - start) / ODP_TIME_SEC_IN_NS;
+	printf("{\"bench\":\"ipsec\",\"alg\":\"%s\",\"mode\":\"%s\","
+	       "\"sas\":%u,\"sps\":%u,\"size\":%u,\"workers\":%u,"
+	       "\"burst\":%u,\"mpps\":%.3f,\"gbps\":%.3f,"
+	       "\"cycles_per_pkt\":%.0f}\n",
+	       arg.alg, arg.mode, arg.sas, arg.sps, arg.size, arg.workers,
+	       arg.burst, pkts / sec / 1e6, bytes * 8 / sec / 1e9,
+	       pkts ? (double)cycles / pkts : 0);
+	fflush(stdout);
+}
+
+
+
+static void usage(const char *prog)
+{
+	printf("\nUsage: %s [options]\n\n", prog);
+
+	printf("Options:\n");
+	printf("-a, --alg           aes-gcm or aes-cbc-sha1. (%s)\n", default_arg.alg);
+	printf("-b, --burst         IPsec burst size of async mode. (%u)\n", default_arg.burst);
+	printf("-d, --duration      Measurement in milliseconds. (%u)\n", default_arg.duration);
+	printf("-i, --inflight      Packets going around per worker. (%u)\n", default_arg.inflight);
+	printf("-l, --loglevel      OFP log level. (%u)\n", default_arg.loglevel);
+	printf("-m, --mode          sync or async. (%s)\n", default_arg.mode);
+	printf("-p, --sps           Outbound security policies, at most %u. (%u)\n",
+	       C_MAX_SP, default_arg.sps);
+	printf("-s, --sas           Security associations per direction. (%u)\n", default_arg.sas);
+	printf("-u, --warmup        Warm up in milliseconds. (%u)\n", default_arg.warmup);
+	printf("-w, --workers       Number of worker threads. (%u)\n", default_arg.workers);
+	printf("-z, --size          Frame size in bytes, 64..1400. (%u)\n", default_arg.size);
+
+	printf("\n");
+
+	exit(1);
+}
+
+
+
+static void parse_args(int argc, char *argv[])
+{
+	arg = default_arg;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"alg",           required_argument, 0, 'a'},
+			{"burst",         required_argument, 0, 'b'},
+			{"duration",      required_argument, 0, 'd'},
+			{"inflight",      required_argument, 0, 'i'},
+			{"loglevel",      required_argument, 0, 'l'},
+			{"mode",          required_argument, 0, 'm'},
+			{"sps",           required_argument, 0, 'p'},
+			{"sas",           required_argument, 0, 's'},
+			{"warmup",        required_argument, 0, 'u'},
+			{"workers",       required_argument, 0, 'w'},
+			{"size",          required_argument, 0, 'z'},
+			{0,               0,                 0,  0 }
+		};
+
+		int c = getopt_long(argc, argv, "a:b:d:i:l:m:p:s:u:w:z:",
+				    long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'a': arg.alg = optarg; break;
+		case 'b': arg.burst = atoi(optarg); break;
+		case 'd': arg.duration = atoi(optarg); break;
+		case 'i': arg.inflight = atoi(optarg); break;
+		case 'l': arg.loglevel = atoi(optarg); break;
+		case 'm': arg.mode = optarg; break;
+		case 'p': arg.sps = atoi(optarg); break;
+		case 's': arg.sas = atoi(optarg); break;
+		case 'u': arg.warmup = atoi(optarg); break;
+		case 'w': arg.workers = atoi(optarg); break;
+		case 'z': arg.size = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind < argc) {
+		printf("Invalid argument: %s\n", argv[optind]);
+		usage(argv[0]);
+	}
+
+	if (strcmp(arg.alg, "aes-gcm") && strcmp(arg.alg, "aes-cbc-sha1"))
+		usage(argv[0]);
+	if (strcmp(arg.mode, "sync") && strcmp(arg.mode, "async"))
+		usage(argv[0]);
+	async = !strcmp(arg.mode, "async");
+
+	if (arg.burst < 1 || arg.burst > OFP_IPSEC_BURST_MAX)
+		arg.burst = 1;
+	if (!arg.sas)
+		arg.sas = 1;
+	if (arg.sps < arg.sas)
+		arg.sps = arg.sas;
+	if (arg.sps > C_MAX_SP)
+		arg.sps = C_MAX_SP;
+	if (arg.size < 64)
+		arg.size = 64;
+	if (arg.size > 1400)
+		arg.size = 1400;
+	if (!arg.inflight)
+		arg.inflight = 1;
+	if (!arg.duration)
+		arg.duration = 1;
+}
+
+
+
+static void print_info(void)
+{
+	fprintf(stderr, "\n"
+		"ODP system info\n"
+		"---------------\n"
+		"ODP API version: %s\n"
+		"CPU model:       %s\n"
+		"CPU freq (hz):   %lu\n"
+		"Cache line size: %i\n"
+		"Core count:      %i\n"
+		"\n",
+		odp_version_api_str(), odp_cpu_model_str(), odp_cpu_hz(),
+		odp_sys_cache_line_size(), odp_cpu_count());
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	odp_cpumask_t cpus;
+	odp_queue_param_t qpar;
+	ofp_global_param_t params;
+	int num_cpus;
+
+	parse_args(argc, argv);
+	ofp_loglevel = arg.loglevel;
+
+	ASSERT(!odp_init_global(&instance, NULL, NULL));
+	ASSERT(!odp_init_local(instance, ODP_THREAD_CONTROL));
+
+	print_info();
+
+	num_cpus = odp_cpumask_default_worker(&cpus, arg.workers);
+	ASSERT(num_cpus > 0);
+	if (num_cpus > ODP_THREAD_COUNT_MAX - 2)
+		num_cpus = ODP_THREAD_COUNT_MAX - 2;
+	if (num_cpus > OFP_PKTOUT_QUEUE_MAX)
+		num_cpus = OFP_PKTOUT_QUEUE_MAX;
+	arg.workers = num_cpus;
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.num_vrf = 2;
+	params.ipsec.max_num_sa = 2 * arg.sas;
+	params.ipsec.max_num_sp = arg.sps + arg.sas;
+	params.ipsec.max_inbound_spi = arg.sas + 1;
+	params.ipsec.burst_size = arg.burst;
+	if (async) {
+		/* Polled by the workers, ownership goes to OFP */
+		odp_queue_param_init(&qpar);
+		compl_queue = odp_queue_create("ipsec_compl", &qpar);
+		ASSERT(compl_queue != ODP_QUEUE_INVALID);
+		params.ipsec.inbound_op_mode = ODP_IPSEC_OP_MODE_ASYNC;
+		params.ipsec.outbound_op_mode = ODP_IPSEC_OP_MODE_ASYNC;
+		params.ipsec.inbound_queue = compl_queue;
+		params.ipsec.outbound_queue = compl_queue;
+	}
+	ASSERT(!ofp_init_global(instance, &params));
+	ASSERT(!ofp_init_local());
+
+	ASSERT((pool = odp_pool_lookup(SHM_PKT_POOL_NAME)) !=
+	       ODP_POOL_INVALID);
+
+	net_setup();
+	ipsec_setup();
+
+	run(&cpus);
+
+	port_teardown(P_IN);
+	port_teardown(P_OUT);
+	port_teardown(P_TUN_OUT);
+	port_teardown(P_TUN_IN);
+	ASSERT(!odp_queue_destroy(in_queue[0]));
+	ASSERT(!odp_queue_destroy(in_queue[1]));
+
+	ofp_term_local();
+	ofp_term_global();
+	odp_term_local();
+	odp_term_global(instance);
+
+	return 0;
+}
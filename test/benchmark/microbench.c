@@ -0,0 +1,616 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * Microbenchmarks of the data structures on the packet path.
+ *
+ * Each benchmark runs a number of rounds of a fixed number of operations
+ * and reports the fastest round as one JSON object per line:
+ *
+ *   {"bench":"route4_lookup","size":1024,"ops":1000000,
+ *    "ns_per_op":12.345,"mpps":81.004}
+ *
+ * Size is the number of routes, neighbors, sockets or bytes the
+ * benchmark operates on. Other output goes to stderr.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include <odp_api.h>
+#include <ofp.h>
+#include <ofpi.h>
+#include <ofpi_arp.h>
+#include <ofpi_in_pcb.h>
+#include <ofpi_portconf.h>
+#include <ofpi_socketvar.h>
+#include <ofpi_sockbuf.h>
+#include <ofpi_udp_var.h>
+#include <ofpi_uma.h>
+
+#include "../cunit/test_raw_frames.h"
+
+#define STR(x) #x
+#define ASSERT(x)						\
+	do {							\
+		if (!(x)) {					\
+			fprintf(stderr, __FILE__ "(%d): assert failed: " \
+				STR(x) "\n", __LINE__);		\
+			exit(1);				\
+		}						\
+	} while (0)
+
+odp_instance_t instance;
+struct ofp_ifnet *ifnet;
+odp_queue_t dummyq;
+odp_pool_t pool;
+
+#define C_PORT 0
+#define C_VLAN 0
+#define C_VRF 0
+/* Local address of the canned frames in test_raw_frames.h, 192.168.56.102 */
+#define C_L_ADDR 0xc0a83866
+#define C_GW_ADDR 0x7e000000
+#define C_NB_ADDR 0xc0a80000
+#define C_DST_ADDR 0x1000000
+#define C_UDP_PORT 10000
+
+/* Number of precomputed lookup keys, a power of two */
+#define KEYS 4096
+#define BATCH 32
+#define CKSUM_BUF 2048
+
+struct arg_s {
+	uint32_t iterations, loglevel, max_bits, rounds;
+	const char *filter;
+} arg, default_arg = {
+	.iterations = 1000000,
+	.loglevel = OFP_LOG_ERROR,
+	.max_bits = 16,
+	.rounds = 5,
+	.filter = NULL,
+};
+
+static unsigned int seedp = 1;
+static uint32_t keys[KEYS];
+static volatile uintptr_t sink;
+
+typedef uint64_t (*bench_func_t)(uint32_t size, uint32_t ops);
+
+static uint64_t time_ns(void)
+{
+	return odp_time_to_ns(odp_time_local());
+}
+
+static uint32_t rnd(void)
+{
+	return (uint32_t)rand_r(&seedp);
+}
+
+/*
+ * Run a benchmark arg.rounds times and report the fastest round. The
+ * benchmark returns the time in ns it spent in the measured operations.
+ */
+static void run(const char *name, bench_func_t func, uint32_t size)
+{
+	uint64_t best = UINT64_MAX, ns;
+	uint32_t r;
+
+	if (arg.filter && !strstr(name, arg.filter))
+		return;
+
+	/* Warm up caches and per thread state */
+	func(size, arg.iterations / 10 + 1);
+
+	for (r = 0; r < arg.rounds; r++) {
+		ns = func(size, arg.iterations);
+		if (ns < best)
+			best = ns;
+	}
+
+	if (!best)
+		best = 1;
+
+	printf("{\"bench\":\"%s\",\"size\":%u,\"ops\":%u,"
+	       "\"ns_per_op\":%.3f,\"mpps\":%.3f}\n",
+	       name, size, arg.iterations,
+	       (double)best / arg.iterations,
+	       (double)arg.iterations * 1000.0 / best);
+	fflush(stdout);
+}
+
+/*
+ * IPv4 route lookup. Routes are /24 prefixes from C_DST_ADDR on, the
+ * lookup keys hit random routes.
+ */
+static uint32_t routes4;
+
+static void add_routes4(uint32_t num)
+{
+	for (; routes4 < num; routes4++) {
+		uint32_t dst = odp_cpu_to_be_32(C_DST_ADDR + (routes4 << 8));
+		uint32_t gw = odp_cpu_to_be_32(C_GW_ADDR + 1);
+
+		ASSERT(!ofp_set_route_params(OFP_ROUTE_ADD, C_VRF, C_VLAN,
+					     C_PORT, dst, 24, gw,
+					     OFP_RTF_GATEWAY));
+	}
+}
+
+static uint64_t bench_route4(uint32_t size, uint32_t ops)
+{
+	uint32_t i, flags;
+	uint64_t t;
+
+	add_routes4(size);
+	for (i = 0; i < KEYS; i++)
+		keys[i] = odp_cpu_to_be_32(C_DST_ADDR +
+					   ((rnd() % size) << 8) + 1);
+
+	t = time_ns();
+	for (i = 0; i < ops; i++)
+		sink += (uintptr_t)ofp_get_next_hop(C_VRF,
+						    keys[i & (KEYS - 1)],
+						    &flags);
+	return time_ns() - t;
+}
+
+static uint64_t bench_route4_bulk(uint32_t size, uint32_t ops)
+{
+	struct ofp_nh_entry *nh[BATCH];
+	uint32_t i;
+	uint64_t t;
+
+	add_routes4(size);
+	for (i = 0; i < KEYS; i++)
+		keys[i] = odp_cpu_to_be_32(C_DST_ADDR +
+					   ((rnd() % size) << 8) + 1);
+
+	t = time_ns();
+	for (i = 0; i < ops; i += BATCH) {
+		ofp_get_next_hop_bulk(C_VRF, &keys[i & (KEYS - 1)], nh, BATCH);
+		sink += (uintptr_t)nh[0];
+	}
+	return time_ns() - t;
+}
+
+#ifdef INET6
+/*
+ * IPv6 route lookup. Routes are /48 prefixes 2001:db8:<n>::/48.
+ */
+static uint32_t routes6;
+
+static void addr6(uint8_t *a, uint32_t n, uint32_t host)
+{
+	memset(a, 0, 16);
+	a[0] = 0x20;
+	a[1] = 0x01;
+	a[2] = 0x0d;
+	a[3] = 0xb8;
+	a[4] = n >> 8;
+	a[5] = n;
+	memcpy(&a[12], &host, 4);
+}
+
+static void add_routes6(uint32_t num)
+{
+	uint8_t dst[16], gw[16];
+
+	addr6(gw, 0xffff, 1);
+	for (; routes6 < num; routes6++) {
+		addr6(dst, routes6, 0);
+		ASSERT(!ofp_set_route6_params(OFP_ROUTE6_ADD, C_VRF, C_VLAN,
+					      C_PORT, dst, 48, gw,
+					      OFP_RTF_GATEWAY));
+	}
+}
+
+static uint64_t bench_route6(uint32_t size, uint32_t ops)
+{
+	static uint8_t keys6[KEYS][16];
+	uint32_t i, flags;
+	uint64_t t;
+
+	add_routes6(size);
+	for (i = 0; i < KEYS; i++)
+		addr6(keys6[i], rnd() % size, rnd());
+
+	t = time_ns();
+	for (i = 0; i < ops; i++)
+		sink += (uintptr_t)ofp_get_next_hop6(C_VRF,
+						     keys6[i & (KEYS - 1)],
+						     &flags);
+	return time_ns() - t;
+}
+#endif /* INET6 */
+
+/*
+ * ARP table lookup of random neighbors.
+ */
+static uint32_t neighbors;
+
+static uint64_t bench_arp(uint32_t size, uint32_t ops)
+{
+	uint8_t mac[OFP_ETHER_ADDR_LEN] = {0xa, 0xb, 0, 0, 0, 0};
+	uint32_t i;
+	uint64_t t;
+
+	for (; neighbors < size; neighbors++) {
+		uint32_t addr = odp_cpu_to_be_32(C_NB_ADDR + neighbors + 1);
+
+		memcpy(mac + 2, &addr, 4);
+		ASSERT(!ofp_add_mac(ifnet, addr, mac));
+	}
+	for (i = 0; i < KEYS; i++)
+		keys[i] = odp_cpu_to_be_32(C_NB_ADDR + rnd() % size + 1);
+
+	t = time_ns();
+	for (i = 0; i < ops; i++)
+		sink += ofp_ipv4_lookup_mac(keys[i & (KEYS - 1)], mac, ifnet);
+	return time_ns() - t;
+}
+
+/*
+ * Internet checksum of size bytes.
+ */
+static uint64_t bench_cksum(uint32_t size, uint32_t ops)
+{
+	static uint8_t buf[CKSUM_BUF];
+	uint32_t i;
+	uint64_t t;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = rnd();
+
+	t = time_ns();
+	for (i = 0; i < ops; i++)
+		sink += ofp_cksum_buffer(buf + (i & 1), size);
+	return time_ns() - t;
+}
+
+/*
+ * UMA zone allocation and free of size objects at a time.
+ */
+static uma_zone_t zone = OFP_UMA_ZONE_INVALID;
+
+static uint64_t bench_uma(uint32_t size, uint32_t ops)
+{
+	void *item[BATCH];
+	uint32_t i, j;
+	uint64_t t;
+
+	ASSERT(size <= BATCH);
+
+	t = time_ns();
+	for (i = 0; i < ops; i += size) {
+		for (j = 0; j < size; j++)
+			item[j] = uma_zalloc(zone, OFP_M_NOWAIT);
+		for (j = 0; j < size; j++)
+			uma_zfree(zone, item[j]);
+	}
+	t = time_ns() - t;
+
+	ASSERT(item[0]);
+	return t;
+}
+
+/*
+ * UDP PCB hash lookup of random bound sockets.
+ */
+static int sockets[OFP_NUM_SOCKETS_MAX];
+static uint32_t num_sockets;
+
+static uint64_t bench_pcb(uint32_t size, uint32_t ops)
+{
+	struct ofp_in_addr laddr, faddr;
+	struct inpcb *inp;
+	uint32_t i;
+	uint64_t t;
+
+	for (; num_sockets < size; num_sockets++) {
+		struct ofp_sockaddr_in sin;
+		int fd;
+
+		fd = ofp_socket(OFP_AF_INET, OFP_SOCK_DGRAM, OFP_IPPROTO_UDP);
+		ASSERT(fd >= 0);
+		memset(&sin, 0, sizeof(sin));
+		sin.sin_len = sizeof(sin);
+		sin.sin_family = OFP_AF_INET;
+		sin.sin_port = odp_cpu_to_be_16(C_UDP_PORT + num_sockets);
+		sin.sin_addr.s_addr = odp_cpu_to_be_32(C_L_ADDR);
+		ASSERT(!ofp_bind(fd, (struct ofp_sockaddr *)&sin, sizeof(sin)));
+		sockets[num_sockets] = fd;
+	}
+	for (i = 0; i < KEYS; i++)
+		keys[i] = odp_cpu_to_be_16(C_UDP_PORT + rnd() % size);
+
+	laddr.s_addr = odp_cpu_to_be_32(C_L_ADDR);
+	faddr.s_addr = odp_cpu_to_be_32(C_NB_ADDR + 1);
+
+	t = time_ns();
+	for (i = 0; i < ops; i++) {
+		inp = ofp_in_pcblookup(&V_udbinfo, faddr,
+				       odp_cpu_to_be_16(1024), laddr,
+				       keys[i & (KEYS - 1)],
+				       INPLOOKUP_WILDCARD | INPLOOKUP_RLOCKPCB,
+				       ifnet);
+		ASSERT(inp);
+		INP_RUNLOCK(inp);
+	}
+	return time_ns() - t;
+}
+
+/*
+ * Append BATCH packets of size bytes to a socket buffer and drain it.
+ * The drain frees the packets, allocation is not measured.
+ */
+static uint64_t bench_sockbuf(uint32_t size, uint32_t ops)
+{
+	odp_packet_t pkt[BATCH];
+	struct socket *so;
+	uint32_t i, j;
+	uint64_t t = 0, start;
+	int fd;
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	ASSERT(fd >= 0);
+	ASSERT((so = ofp_get_sock_by_fd(fd)) != NULL);
+
+	for (i = 0; i < ops; i += BATCH) {
+		for (j = 0; j < BATCH; j++)
+			ASSERT((pkt[j] = odp_packet_alloc(pool, size)) !=
+			       ODP_PACKET_INVALID);
+
+		start = time_ns();
+		for (j = 0; j < BATCH; j++)
+			ofp_sbappendstream(&so->so_snd, pkt[j]);
+		ofp_sbdrop(&so->so_snd, so->so_snd.sb_cc);
+		t += time_ns() - start;
+	}
+
+	ASSERT(!ofp_close(fd));
+	return t;
+}
+
+/*
+ * ofp_packet_input() of a canned frame. Output packets, e.g. ICMP echo
+ * replies and TCP resets, are sent to a queue and freed outside of the
+ * measured time.
+ */
+static const uint8_t *input_frame;
+static uint32_t input_len;
+
+static void drain_output(void)
+{
+	odp_event_t ev[BATCH];
+	uint32_t i;
+	int num;
+
+	for (i = 0; i < ifnet->out_queue_num; i++)
+		while ((num = odp_queue_deq_multi(ifnet->out_queue_queue[i],
+						  ev, BATCH)) > 0)
+			odp_event_free_multi(ev, num);
+}
+
+static uint64_t bench_input(uint32_t size, uint32_t ops)
+{
+	odp_packet_t pkt[BATCH];
+	uint32_t i, j;
+	uint64_t t = 0, start;
+
+	(void)size;
+
+	for (i = 0; i < ops; i += BATCH) {
+		for (j = 0; j < BATCH; j++) {
+			pkt[j] = odp_packet_alloc(pool, input_len);
+			ASSERT(pkt[j] != ODP_PACKET_INVALID);
+			memcpy(odp_packet_data(pkt[j]), input_frame, input_len);
+			odp_packet_has_eth_set(pkt[j], 1);
+			odp_packet_l2_offset_set(pkt[j], 0);
+		}
+
+		start = time_ns();
+		for (j = 0; j < BATCH; j++)
+			ofp_packet_input(pkt[j], dummyq,
+					 ofp_eth_vlan_processing);
+		ofp_send_pending_pkt();
+		t += time_ns() - start;
+
+		drain_output();
+	}
+	return t;
+}
+
+static void run_input(const char *name, const uint8_t *frame, uint32_t len)
+{
+	input_frame = frame;
+	input_len = len;
+	run(name, bench_input, len);
+}
+
+
+
+static void usage(const char *prog)
+{
+	printf("\nUsage: %s [options]\n\n", prog);
+
+	printf("Options:\n");
+	printf("-f, --filter        Run only benchmarks whose name contains\n"
+	       "                    the argument. (all)\n");
+	printf("-i, --iterations    Operations per round. (%u)\n", default_arg.iterations);
+	printf("-l, --loglevel      OFP log level. (%u)\n", default_arg.loglevel);
+	printf("-m, --max-bits      Largest route, neighbor and socket table\n"
+	       "                    is 2**<max-bits> entries. (%u)\n", default_arg.max_bits);
+	printf("-r, --rounds        Number of rounds, the fastest is reported. (%u)\n",
+	       default_arg.rounds);
+
+	printf("\n");
+
+	exit(1);
+}
+
+
+
+static void parse_args(int argc, char *argv[])
+{
+	arg = default_arg;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"filter",        required_argument, 0, 'f'},
+			{"iterations",    required_argument, 0, 'i'},
+			{"loglevel",      required_argument, 0, 'l'},
+			{"max-bits",      required_argument, 0, 'm'},
+			{"rounds",        required_argument, 0, 'r'},
+			{0,               0,                 0,  0 }
+		};
+
+		int c = getopt_long(argc, argv, "f:i:l:m:r:",
+				    long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'f': arg.filter = optarg; break;
+		case 'i': arg.iterations = atoi(optarg); break;
+		case 'l': arg.loglevel = atoi(optarg); break;
+		case 'm': arg.max_bits = atoi(optarg); break;
+		case 'r': arg.rounds = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind < argc) {
+		printf("Invalid argument: %s\n", argv[optind]);
+		usage(argv[0]);
+	}
+
+	if (arg.max_bits > 20)
+		arg.max_bits = 20;
+	if (arg.iterations < BATCH)
+		arg.iterations = BATCH;
+	arg.iterations -= arg.iterations % BATCH;
+	if (!arg.rounds)
+		arg.rounds = 1;
+}
+
+
+
+static void print_info(void)
+{
+	fprintf(stderr, "\n"
+		"ODP system info\n"
+		"---------------\n"
+		"ODP API version: %s\n"
+		"CPU model:       %s\n"
+		"CPU freq (hz):   %lu\n"
+		"Cache line size: %i\n"
+		"Core count:      %i\n"
+		"\n",
+		odp_version_api_str(), odp_cpu_model_str(), odp_cpu_hz(),
+		odp_sys_cache_line_size(), odp_cpu_count());
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t cksum_sizes[] = {20, 64, 576, 1500};
+	static const uint32_t uma_sizes[] = {1, BATCH};
+	static const uint32_t sockbuf_sizes[] = {64, 1460};
+	uint32_t max, sockets_max, bits, i;
+
+	parse_args(argc, argv);
+
+	max = 1 << arg.max_bits;
+	sockets_max = max < OFP_NUM_SOCKETS_MAX / 2 ?
+		max : OFP_NUM_SOCKETS_MAX / 2;
+	ofp_loglevel = arg.loglevel;
+
+	ASSERT(!odp_init_global(&instance, NULL, NULL));
+	ASSERT(!odp_init_local(instance, ODP_THREAD_WORKER));
+
+	print_info();
+
+	ofp_global_param_t params;
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.arp.entries = max + 16;
+	params.mtrie.routes = max + 16;
+	params.mtrie.table8_nodes = max / 2 + (max >> 8) + 16;
+	if (params.mtrie6.table8_nodes < (int)(max >> 8) + 64)
+		params.mtrie6.table8_nodes = (max >> 8) + 64;
+	params.num_vlan = 0;
+	ASSERT(!ofp_init_global(instance, &params));
+	ASSERT(!ofp_init_local());
+
+	ASSERT(!ofp_config_interface_up_v4(C_PORT, C_VLAN, C_VRF,
+					   odp_cpu_to_be_32(C_L_ADDR), 16));
+
+	ifnet = ofp_get_ifnet(C_PORT, C_VLAN);
+	ASSERT((pool = odp_pool_lookup("packet_pool")) != ODP_POOL_INVALID);
+	ifnet->pkt_pool = pool;
+
+	ASSERT((ifnet->out_queue_queue[0] = odp_queue_create("out_queue:0",
+							     NULL)) !=
+	       ODP_QUEUE_INVALID);
+	ifnet->out_queue_num = 1;
+	ifnet->out_queue_type = OFP_OUT_QUEUE_TYPE_QUEUE;
+
+	ASSERT((dummyq = odp_queue_create("in_queue:0", NULL)) !=
+	       ODP_QUEUE_INVALID);
+	ASSERT(!odp_queue_context_set(dummyq, ifnet, sizeof(ifnet)));
+
+	zone = uma_zcreate("microbench", 4 * BATCH, 256, NULL, NULL, NULL,
+			   NULL, UMA_ALIGN_PTR, 0);
+	ASSERT(zone != OFP_UMA_ZONE_INVALID);
+
+	for (bits = 4; bits <= arg.max_bits; bits += 6)
+		run("route4_lookup", bench_route4, 1 << bits);
+	for (bits = 4; bits <= arg.max_bits; bits += 6)
+		run("route4_lookup_bulk", bench_route4_bulk, 1 << bits);
+#ifdef INET6
+	for (bits = 4; bits <= arg.max_bits; bits += 6)
+		run("route6_lookup", bench_route6, 1 << bits);
+#endif /* INET6 */
+	for (bits = 4; bits <= arg.max_bits; bits += 6)
+		run("arp_lookup", bench_arp, 1 << bits);
+	for (i = 0; i < sizeof(cksum_sizes) / sizeof(cksum_sizes[0]); i++)
+		run("cksum", bench_cksum, cksum_sizes[i]);
+	for (i = 0; i < sizeof(uma_sizes) / sizeof(uma_sizes[0]); i++)
+		run("uma_alloc_free", bench_uma, uma_sizes[i]);
+	for (bits = 4; (1U << bits) <= sockets_max; bits += 3)
+		run("pcb_lookup", bench_pcb, 1 << bits);
+	for (i = 0; i < sizeof(sockbuf_sizes) / sizeof(sockbuf_sizes[0]); i++)
+		run("sockbuf_append_drain", bench_sockbuf, sockbuf_sizes[i]);
+
+	run_input("input_icmp", icmp_frame, sizeof(icmp_frame));
+	run_input("input_tcp", tcp_frame, sizeof(tcp_frame));
+	run_input("input_arp", arp_frame, sizeof(arp_frame));
+#ifdef INET6
+	run_input("input_udp6", ip6udp_frame, sizeof(ip6udp_frame));
+	run_input("input_icmp6", icmp6_frame, sizeof(icmp6_frame));
+#endif /* INET6 */
+
+	for (i = 0; i < num_sockets; i++)
+		ofp_close(sockets[i]);
+	uma_zdestroy(zone);
+	drain_output();
+	ASSERT(!odp_queue_destroy(ifnet->out_queue_queue[0]));
+	ASSERT(!odp_queue_destroy(dummyq));
+
+	ofp_term_local();
+	ofp_term_global();
+	odp_term_local();
+	odp_term_global(instance);
+
+	return 0;
+}
@@ -0,0 +1,751 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * Replay of a pcap or pcapng capture through ofp_packet_input().
+ *
+ * The Ethernet frames of the capture are loaded into the packet pool
+ * once. Each worker replays its share of the frames, every Nth frame
+ * for N workers, over and over. On each pass through the capture the
+ * IPv4 source addresses are offset by the pass number, modulo
+ * 2**<addr-bits>, so that a short capture gives many flows.
+ *
+ * In direct mode the workers hand the frames to ofp_packet_input()
+ * themselves. In scheduled mode they enqueue the frames to a scheduled
+ * input queue and process what the scheduler gives them. Only the
+ * stack and scheduler work is timed, not copying the frames from the
+ * loaded capture. Output packets are freed.
+ *
+ * Routes and ARP entries needed to forward the traffic of the capture
+ * are configured with a CLI file.
+ */
+
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include <odp_api.h>
+#include <ofp.h>
+#include <ofpi.h>
+
+#define STR(x) #x
+#define ASSERT(x)						\
+	do {							\
+		if (!(x)) {					\
+			printf(__FILE__ "(%d): assert failed: "	\
+			       STR(x) "\n", __LINE__);		\
+			exit(1);				\
+		}						\
+	} while (0)
+
+#define MAX_BATCH 256
+
+#define PCAP_MAGIC		0xa1b2c3d4
+#define PCAP_MAGIC_NS		0xa1b23c4d
+#define PCAPNG_SHB		0x0a0d0d0a
+#define PCAPNG_BYTE_ORDER	0x1a2b3c4d
+#define PCAPNG_IDB		1
+#define PCAPNG_SPB		3
+#define PCAPNG_EPB		6
+#define PCAPNG_MAX_IF		64
+#define LINKTYPE_ETHERNET	1
+
+struct pcap_file_hdr {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t linktype;
+};
+
+struct pcap_rec_hdr {
+	uint32_t ts_sec;
+	uint32_t ts_frac;
+	uint32_t incl_len;
+	uint32_t orig_len;
+};
+
+/* A loaded frame and where the source address rewrite applies */
+struct replay_pkt {
+	odp_packet_t pkt;
+	uint16_t l3;		/* IPv4 header offset, 0 if none */
+	uint16_t l4_sum;	/* TCP or UDP checksum offset, 0 if none */
+	uint32_t src;		/* original source address */
+};
+
+struct ODP_ALIGNED_CACHE tstate_s {
+	volatile uint64_t packets;
+	volatile uint64_t tx_packets;
+	volatile uint64_t cycles;
+	volatile int stop;
+} tstate[ODP_THREAD_COUNT_MAX];
+
+odp_instance_t instance;
+struct ofp_ifnet *ifnet;
+odp_queue_t dummyq, schedq;
+odp_pool_t pool;
+
+struct replay_pkt *pkts;
+uint32_t num_pkts, num_frames;
+odp_atomic_u32_t next_tid;
+
+#define C_PORT 0
+#define C_VLAN 0
+#define C_VRF 0
+
+struct arg_s {
+	volatile uint32_t addr_bits, batch, dispw, interval, ivals, loglevel,
+		rate, sched, tx_burst, warmup, workers;
+} arg, default_arg = {
+	.addr_bits = 0,
+	.batch = 32,
+	.dispw = 0,
+	.interval = 5000,
+	.ivals = 1,
+	.loglevel = OFP_LOG_ERROR,
+	.rate = 0,
+	.sched = 0,
+	.tx_burst = 8,
+	.warmup = 1,
+	.workers = 1,
+};
+
+const char *pcap_file;
+char *cli_file;
+
+
+
+static uint32_t swap32(uint32_t v, int swap)
+{
+	return swap ? __builtin_bswap32(v) : v;
+}
+
+static uint16_t swap16(uint16_t v, int swap)
+{
+	return swap ? __builtin_bswap16(v) : v;
+}
+
+/* Locate the IPv4 source address and the L4 checksum of a frame */
+static void classify(struct replay_pkt *p, const uint8_t *buf, uint32_t len)
+{
+	const struct ofp_ether_header *eth = (const void *)buf;
+	const struct ofp_ip *ip;
+	uint16_t type, off = sizeof(*eth);
+
+	p->l3 = 0;
+	p->l4_sum = 0;
+
+	if (len < sizeof(*eth))
+		return;
+	type = ntohs(eth->ether_type);
+	if (type == OFP_ETHERTYPE_VLAN) {
+		if (len < sizeof(struct ofp_ether_vlan_header))
+			return;
+		type = ntohs(((const struct ofp_ether_vlan_header *)buf)->
+			     evl_proto);
+		off = sizeof(struct ofp_ether_vlan_header);
+	}
+	if (type != OFP_ETHERTYPE_IP || len < off + sizeof(*ip))
+		return;
+
+	ip = (const struct ofp_ip *)(buf + off);
+	p->l3 = off;
+	p->src = ip->ip_src.s_addr;
+
+	/* Only the first fragment has the L4 header */
+	if (ntohs(ip->ip_off) & OFP_IP_OFFMASK)
+		return;
+	off += ip->ip_hl << 2;
+	if (ip->ip_p == OFP_IPPROTO_TCP &&
+	    len >= off + sizeof(struct ofp_tcphdr))
+		p->l4_sum = off + offsetof(struct ofp_tcphdr, th_sum);
+	else if (ip->ip_p == OFP_IPPROTO_UDP &&
+		 len >= off + sizeof(struct ofp_udphdr) &&
+		 ((const struct ofp_udphdr *)(buf + off))->uh_sum)
+		p->l4_sum = off + offsetof(struct ofp_udphdr, uh_sum);
+}
+
+/* Count the frames, to size the packet pool before they are added */
+static void count_frame(const uint8_t *buf, uint32_t len)
+{
+	(void)buf;
+
+	if (len)
+		num_frames++;
+}
+
+static void add_frame(const uint8_t *buf, uint32_t len)
+{
+	struct replay_pkt *p;
+	odp_packet_t pkt;
+
+	if (!len)
+		return;
+
+	ASSERT(num_pkts < num_frames);
+	ASSERT((pkt = odp_packet_alloc(pool, len)) != ODP_PACKET_INVALID);
+	ASSERT(!odp_packet_copy_from_mem(pkt, 0, len, buf));
+	odp_packet_has_eth_set(pkt, 1);
+	odp_packet_l2_offset_set(pkt, 0);
+
+	p = &pkts[num_pkts++];
+	p->pkt = pkt;
+	classify(p, buf, len);
+	/* Rewrite only what is in the first segment */
+	if (p->l4_sum + 2u > odp_packet_seg_len(pkt) ||
+	    p->l3 + sizeof(struct ofp_ip) > odp_packet_seg_len(pkt))
+		p->l3 = p->l4_sum = 0;
+}
+
+typedef void (*frame_func_t)(const uint8_t *buf, uint32_t len);
+
+static void parse_pcap(const uint8_t *buf, size_t size, frame_func_t func)
+{
+	const struct pcap_file_hdr *fh = (const void *)buf;
+	uint32_t len;
+	size_t off = sizeof(*fh);
+	int swap = fh->magic != PCAP_MAGIC && fh->magic != PCAP_MAGIC_NS;
+
+	if (swap32(fh->linktype, swap) != LINKTYPE_ETHERNET) {
+		printf("Not an Ethernet capture\n");
+		exit(1);
+	}
+
+	while (off + sizeof(struct pcap_rec_hdr) <= size) {
+		const struct pcap_rec_hdr *rh = (const void *)(buf + off);
+
+		off += sizeof(*rh);
+		len = swap32(rh->incl_len, swap);
+		if (len > size - off)
+			break;
+		func(buf + off, len);
+		off += len;
+	}
+}
+
+static void parse_pcapng(const uint8_t *buf, size_t size, frame_func_t func)
+{
+	uint16_t linktype[PCAPNG_MAX_IF];
+	uint32_t type, blen, num_if = 0, len, ifi;
+	size_t off = 0;
+	int swap = 0;
+
+	while (off + 12 <= size) {
+		const uint8_t *b = buf + off;
+
+		type = *(const uint32_t *)b;
+		if (type == PCAPNG_SHB) {
+			swap = *(const uint32_t *)(b + 8) != PCAPNG_BYTE_ORDER;
+			num_if = 0;
+		}
+		type = swap32(type, swap);
+		blen = swap32(*(const uint32_t *)(b + 4), swap);
+		if (blen < 12 || blen > size - off)
+			break;
+
+		switch (type) {
+		case PCAPNG_IDB:
+			if (num_if < PCAPNG_MAX_IF && blen >= 16)
+				linktype[num_if++] =
+					swap16(*(const uint16_t *)(b + 8),
+					       swap);
+			break;
+		case PCAPNG_EPB:
+			if (blen < 32)
+				break;
+			ifi = swap32(*(const uint32_t *)(b + 8), swap);
+			len = swap32(*(const uint32_t *)(b + 20), swap);
+			if (ifi < num_if && linktype[ifi] == LINKTYPE_ETHERNET &&
+			    len <= blen - 32)
+				func(b + 28, len);
+			break;
+		case PCAPNG_SPB:
+			if (blen < 16 || !num_if ||
+			    linktype[0] != LINKTYPE_ETHERNET)
+				break;
+			len = swap32(*(const uint32_t *)(b + 8), swap);
+			if (len > blen - 16)
+				len = blen - 16;
+			func(b + 12, len);
+			break;
+		default:
+			break;
+		}
+		off += blen;
+	}
+}
+
+static uint8_t *file_buf;
+static size_t file_size;
+
+static void parse(frame_func_t func)
+{
+	uint32_t magic = *(uint32_t *)file_buf;
+
+	if (file_size >= sizeof(struct pcap_file_hdr) &&
+	    (magic == PCAP_MAGIC || magic == PCAP_MAGIC_NS ||
+	     magic == __builtin_bswap32(PCAP_MAGIC) ||
+	     magic == __builtin_bswap32(PCAP_MAGIC_NS)))
+		parse_pcap(file_buf, file_size, func);
+	else if (file_size >= 12 && magic == PCAPNG_SHB)
+		parse_pcapng(file_buf, file_size, func);
+	else {
+		printf("%s: not a pcap or pcapng file\n", pcap_file);
+		exit(1);
+	}
+}
+
+static void read_file(const char *file)
+{
+	long fsize;
+	FILE *f;
+
+	f = fopen(file, "rb");
+	if (!f) {
+		printf("Cannot open %s\n", file);
+		exit(1);
+	}
+	ASSERT(!fseek(f, 0, SEEK_END));
+	ASSERT((fsize = ftell(f)) >= 0);
+	rewind(f);
+	file_size = fsize;
+	ASSERT((file_buf = malloc(file_size + 4)));
+	memset(file_buf, 0, 4);
+	ASSERT(fread(file_buf, 1, file_size, f) == file_size);
+	fclose(f);
+
+	parse(count_frame);
+	if (!num_frames) {
+		printf("%s: no Ethernet frames\n", file);
+		exit(1);
+	}
+}
+
+/* Copy the frames to the packet pool, where they stay during the run */
+static void load(void)
+{
+	ASSERT((pkts = calloc(num_frames, sizeof(*pkts))));
+	parse(add_frame);
+	free(file_buf);
+}
+
+
+
+/* RFC 1624 incremental update of a checksum for a changed 32-bit word */
+static inline void cksum_update32(uint16_t *sum, uint32_t from, uint32_t to)
+{
+	uint32_t s = (uint16_t)~*sum;
+
+	s += (uint16_t)~from + (uint16_t)~(from >> 16);
+	s += (to & 0xffff) + (to >> 16);
+	s = (s & 0xffff) + (s >> 16);
+	s = (s & 0xffff) + (s >> 16);
+	*sum = ~s;
+}
+
+static inline odp_packet_t replay_copy(const struct replay_pkt *p,
+				       uint32_t offset)
+{
+	odp_packet_t pkt = odp_packet_copy(p->pkt, pool);
+	struct ofp_ip *ip;
+	uint8_t *buf;
+	uint32_t src;
+	uint16_t sum;
+
+	if (pkt == ODP_PACKET_INVALID || !offset || !p->l3)
+		return pkt;
+
+	buf = odp_packet_data(pkt);
+	ip = (struct ofp_ip *)(buf + p->l3);
+	src = htonl(ntohl(p->src) + offset);
+	ip->ip_src.s_addr = src;
+	sum = ip->ip_sum;
+	cksum_update32(&sum, p->src, src);
+	ip->ip_sum = sum;
+	if (p->l4_sum) {
+		uint16_t *l4_sum = (uint16_t *)(buf + p->l4_sum);
+
+		cksum_update32(l4_sum, p->src, src);
+		if (ip->ip_p == OFP_IPPROTO_UDP && !*l4_sum)
+			*l4_sum = 0xffff;
+	}
+	return pkt;
+}
+
+static uint64_t time_ns(void)
+{
+	return odp_time_to_ns(odp_time_global());
+}
+
+static int worker(void *p)
+{
+	odp_packet_t burst[MAX_BATCH];
+	odp_event_t ev[MAX_BATCH];
+	odp_queue_t outq, from;
+	uint64_t start_ns = 0, sent = 0, start;
+	uint32_t idx, pass = 0, addr_mask, c;
+	int tid, num, i;
+
+	(void)p;
+
+	ASSERT(!ofp_init_local());
+
+	tid = odp_atomic_fetch_inc_u32(&next_tid);
+	idx = tid % num_pkts;
+	addr_mask = (1ULL << arg.addr_bits) - 1;
+	/*
+	 * The queue of ofp_send_pkt_multi() for this CPU, see
+	 * test/benchmark/ipv4_fwd.c.
+	 */
+	outq = ifnet->out_queue_queue[odp_cpu_id() % ifnet->out_queue_num];
+
+	while (!tstate[tid].stop) {
+		/* Pace a configured rate, shared evenly by the workers */
+		if (arg.rate) {
+			uint64_t now = time_ns();
+
+			if (!start_ns)
+				start_ns = now;
+			if (sent * ODP_TIME_SEC_IN_NS * arg.workers >
+			    (now - start_ns) * arg.rate)
+				continue;
+		}
+
+		for (num = 0; num < (int)arg.batch; num++) {
+			burst[num] = replay_copy(&pkts[idx], pass & addr_mask);
+			if (burst[num] == ODP_PACKET_INVALID)
+				break;
+			idx += arg.workers;
+			if (idx >= num_pkts) {
+				idx %= num_pkts;
+				pass++;
+			}
+		}
+		sent += num;
+
+		if (arg.sched) {
+			for (i = 0; i < num; i++)
+				ev[i] = odp_packet_to_event(burst[i]);
+			i = num ? odp_queue_enq_multi(schedq, ev, num) : 0;
+			if (i < 0)
+				i = 0;
+			if (i < num)
+				odp_event_free_multi(&ev[i], num - i);
+
+			start = odp_cpu_cycles();
+			num = odp_schedule_multi(&from, ODP_SCHED_NO_WAIT, ev,
+						 arg.batch);
+			for (i = 0; i < num; i++)
+				ofp_packet_input(odp_packet_from_event(ev[i]),
+						 from, ofp_eth_vlan_processing);
+		} else {
+			start = odp_cpu_cycles();
+			for (i = 0; i < num; i++)
+				ofp_packet_input(burst[i], dummyq,
+						 ofp_eth_vlan_processing);
+		}
+		ofp_send_pending_pkt();
+		tstate[tid].cycles += odp_cpu_cycles_diff(odp_cpu_cycles(),
+							  start);
+		tstate[tid].packets += num;
+
+		while ((num = odp_queue_deq_multi(outq, ev, MAX_BATCH)) > 0) {
+			odp_event_free_multi(ev, num);
+			tstate[tid].tx_packets += num;
+		}
+	}
+
+	/* Leave nothing in the scheduler for the other workers to wait on */
+	if (arg.sched) {
+		odp_schedule_pause();
+		while ((num = odp_schedule_multi(&from, ODP_SCHED_NO_WAIT, ev,
+						 MAX_BATCH)) > 0)
+			odp_event_free_multi(ev, num);
+	}
+	for (c = 0; c < 2; c++)
+		while ((num = odp_queue_deq_multi(outq, ev, MAX_BATCH)) > 0)
+			odp_event_free_multi(ev, num);
+
+	return 0;
+}
+
+
+
+static void usage(const char *prog)
+{
+	printf("\nUsage: %s [options] -f <capture>\n\n"
+	       "Options other than -f and -c take an unsigned integer "
+	       "argument.\n\n", prog);
+
+	printf("Options:\n");
+	printf("-f, --file          pcap or pcapng file to replay.\n");
+	printf("-c, --cli-file      CLI file setting up interfaces, routes\n"
+	       "                    and ARP entries.\n");
+	printf("-a, --addr-bits     IPv4 source addresses are offset by the\n"
+	       "                    replay pass modulo 2**<addr-bits>. (%u)\n",
+	       default_arg.addr_bits);
+	printf("-b, --batch         Number of packets in each batch, at most\n"
+	       "                    %u. (%u)\n", MAX_BATCH, default_arg.batch);
+	printf("-d, --dispw         Display packet rates and cycles for\n"
+	       "                    workers individually. (%u)\n",
+	       default_arg.dispw);
+	printf("-t, --interval      Reporting interval in milliseconds. (%u)\n",
+	       default_arg.interval);
+	printf("-i, --ivals         Number of intervals. (%u)\n",
+	       default_arg.ivals);
+	printf("-l, --loglevel      OFP log level. (%u)\n",
+	       default_arg.loglevel);
+	printf("-r, --rate          Total packets per second, 0 for as fast\n"
+	       "                    as possible. (%u)\n", default_arg.rate);
+	printf("-s, --sched         Inject through a scheduled queue instead\n"
+	       "                    of directly. (%u)\n", default_arg.sched);
+	printf("-u, --warmup        Warm up period in seconds. (%u)\n",
+	       default_arg.warmup);
+	printf("-w, --workers       Number of worker threads. (%u)\n",
+	       default_arg.workers);
+	printf("-x, --tx-burst      TX burst size. (%u)\n",
+	       default_arg.tx_burst);
+
+	printf("\n");
+
+	exit(1);
+}
+
+
+
+static void parse_args(int argc, char *argv[])
+{
+	arg = default_arg;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"addr-bits",     required_argument, 0, 'a'},
+			{"batch",         required_argument, 0, 'b'},
+			{"cli-file",      required_argument, 0, 'c'},
+			{"dispw",         required_argument, 0, 'd'},
+			{"file",          required_argument, 0, 'f'},
+			{"ivals",         required_argument, 0, 'i'},
+			{"loglevel",      required_argument, 0, 'l'},
+			{"rate",          required_argument, 0, 'r'},
+			{"sched",         required_argument, 0, 's'},
+			{"interval",      required_argument, 0, 't'},
+			{"warmup",        required_argument, 0, 'u'},
+			{"workers",       required_argument, 0, 'w'},
+			{"tx-burst",      required_argument, 0, 'x'},
+			{0,               0,                 0,  0 }
+		};
+
+		int c = getopt_long(argc, argv, "a:b:c:d:f:i:l:r:s:t:u:w:x:",
+				    long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'a': arg.addr_bits = atoi(optarg); break;
+		case 'b': arg.batch = atoi(optarg); break;
+		case 'c': cli_file = optarg; break;
+		case 'd': arg.dispw = atoi(optarg); break;
+		case 'f': pcap_file = optarg; break;
+		case 'i': arg.ivals = atoi(optarg); break;
+		case 'l': arg.loglevel = atoi(optarg); break;
+		case 'r': arg.rate = atoi(optarg); break;
+		case 's': arg.sched = atoi(optarg); break;
+		case 't': arg.interval = atoi(optarg); break;
+		case 'u': arg.warmup = atoi(optarg); break;
+		case 'w': arg.workers = atoi(optarg); break;
+		case 'x': arg.tx_burst = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind < argc) {
+		printf("Invalid argument: %s\n", argv[optind]);
+		usage(argv[0]);
+	}
+	if (!pcap_file || !arg.batch || arg.batch > MAX_BATCH ||
+	    !arg.workers || arg.addr_bits > 32)
+		usage(argv[0]);
+}
+
+
+
+static void print_info(void)
+{
+	printf("\n"
+	       "ODP system info\n"
+	       "---------------\n"
+	       "ODP API version: %s\n"
+	       "CPU model:       %s\n"
+	       "CPU freq (hz):   %lu\n"
+	       "Cache line size: %i\n"
+	       "Core count:      %i\n"
+	       "\n",
+	       odp_version_api_str(), odp_cpu_model_str(), odp_cpu_hz(),
+	       odp_sys_cache_line_size(), odp_cpu_count());
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	odph_thread_t thread_tbl[ODP_THREAD_COUNT_MAX];
+	odph_thread_param_t thr_params[ODP_THREAD_COUNT_MAX];
+	odph_thread_common_param_t thr_common_param;
+	struct tstate_s ltstate[ODP_THREAD_COUNT_MAX];
+	struct tstate_s ntstate[ODP_THREAD_COUNT_MAX];
+	ofp_global_param_t params;
+	odp_queue_param_t qpar;
+	odp_cpumask_t cpumask;
+	odp_time_t ltime;
+	char str[128];
+	uint32_t i, n;
+
+	parse_args(argc, argv);
+
+	if (arg.workers > ODP_THREAD_COUNT_MAX - 2)
+		arg.workers = ODP_THREAD_COUNT_MAX - 2;
+
+	ofp_loglevel = arg.loglevel;
+	read_file(pcap_file);
+	if (num_frames < arg.workers)
+		arg.workers = num_frames;
+
+	ASSERT(!odp_init_global(&instance, NULL, NULL));
+	ASSERT(!odp_init_local(instance, ODP_THREAD_CONTROL));
+
+	print_info();
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.pkt_tx_burst_size = arg.tx_burst;
+	/* Room for the loaded frames and the copies in flight */
+	n = num_frames + 4 * arg.workers * MAX_BATCH + 1024;
+	if (params.pkt_pool.nb_pkts < (int)n)
+		params.pkt_pool.nb_pkts = n;
+	ASSERT(!ofp_init_global(instance, &params));
+	ASSERT(!ofp_init_local());
+
+	ifnet = ofp_get_ifnet(C_PORT, C_VLAN);
+	ASSERT((pool = odp_pool_lookup("packet_pool")) != ODP_POOL_INVALID);
+	ifnet->pkt_pool = pool;
+
+	load();
+	printf("Loaded %u frames from %s\n", num_pkts, pcap_file);
+
+	if (cli_file)
+		ASSERT(ofp_start_cli_thread(instance, params.linux_core_id,
+					    cli_file) >= 0);
+
+	odp_queue_param_init(&qpar);
+	for (i = 0; i < arg.workers; ++i) {
+		sprintf(str, "out_queue:%d", i);
+		ASSERT((ifnet->out_queue_queue[i] =
+			odp_queue_create(str, &qpar)) != ODP_QUEUE_INVALID);
+	}
+	ifnet->out_queue_num = arg.workers;
+	ifnet->out_queue_type = OFP_OUT_QUEUE_TYPE_QUEUE;
+
+	sprintf(str, "in_queue:%d", C_PORT);
+	ASSERT((dummyq = odp_queue_create(str, NULL)) != ODP_QUEUE_INVALID);
+	ASSERT(!odp_queue_context_set(dummyq, ifnet, sizeof(ifnet)));
+
+	odp_queue_param_init(&qpar);
+	qpar.type = ODP_QUEUE_TYPE_SCHED;
+	qpar.sched.prio = odp_schedule_default_prio();
+	qpar.sched.sync = ODP_SCHED_SYNC_PARALLEL;
+	qpar.sched.group = ODP_SCHED_GROUP_WORKER;
+	qpar.context = ifnet;
+	qpar.context_len = sizeof(ifnet);
+	sprintf(str, "sched_in_queue:%d", C_PORT);
+	ASSERT((schedq = odp_queue_create(str, &qpar)) != ODP_QUEUE_INVALID);
+
+	/* Let the CLI file set up routes before the traffic starts */
+	if (cli_file)
+		sleep(1);
+
+	memset(tstate, 0, sizeof(tstate));
+	odp_atomic_init_u32(&next_tid, 0);
+	memset(thread_tbl, 0, sizeof(thread_tbl));
+
+	ASSERT(odp_cpumask_default_worker(&cpumask, arg.workers) ==
+	       (int)arg.workers);
+	for (i = 0; i < arg.workers; ++i) {
+		odph_thread_param_init(&thr_params[i]);
+		thr_params[i].start = worker;
+		thr_params[i].thr_type = ODP_THREAD_WORKER;
+	}
+	odph_thread_common_param_init(&thr_common_param);
+	thr_common_param.instance = instance;
+	thr_common_param.cpumask = &cpumask;
+	ASSERT(odph_thread_create(thread_tbl, &thr_common_param, thr_params,
+				  arg.workers) == (int)arg.workers);
+
+	sleep(arg.warmup);
+
+	ltime = odp_time_global();
+	memcpy(ntstate, tstate, sizeof(tstate));
+
+	for (n = 0; n < arg.ivals; n++) {
+		uint64_t packets = 0, tx_packets = 0, cycles = 0;
+		odp_time_t ntime;
+		double dtime;
+
+		poll(0, 0, arg.interval);
+		memcpy(ltstate, ntstate, sizeof(ntstate));
+		ntime = odp_time_global();
+		memcpy(ntstate, tstate, sizeof(tstate));
+		dtime = (double)odp_time_to_ns(odp_time_diff(ntime, ltime)) /
+			ODP_TIME_SEC_IN_NS;
+		ltime = ntime;
+
+		for (i = 0; i < arg.workers; i++) {
+			packets += ntstate[i].packets - ltstate[i].packets;
+			tx_packets += ntstate[i].tx_packets -
+				ltstate[i].tx_packets;
+			cycles += ntstate[i].cycles - ltstate[i].cycles;
+		}
+		printf("pps=%g tx_pps=%g cycles/pkt=%.1f", packets / dtime,
+		       tx_packets / dtime,
+		       packets ? (double)cycles / packets : 0.0);
+
+		for (i = 0; arg.dispw && i < arg.workers; i++) {
+			packets = ntstate[i].packets - ltstate[i].packets;
+			cycles = ntstate[i].cycles - ltstate[i].cycles;
+			printf(" [%u] pps=%g cycles/pkt=%.1f", i,
+			       packets / dtime,
+			       packets ? (double)cycles / packets : 0.0);
+		}
+		printf("\n");
+	}
+
+	for (i = 0; i < arg.workers; ++i)
+		tstate[i].stop = 1;
+
+	odph_thread_join(thread_tbl, arg.workers);
+
+	for (i = 0; i < num_pkts; i++)
+		odp_packet_free(pkts[i].pkt);
+	free(pkts);
+
+	for (i = 0; i < arg.workers; ++i)
+		ASSERT(!odp_queue_destroy(ifnet->out_queue_queue[i]));
+	ASSERT(!odp_queue_destroy(dummyq));
+	ASSERT(!odp_queue_destroy(schedq));
+
+	ofp_term_local();
+	ofp_term_global();
+	odp_term_local();
+	odp_term_global(instance);
+
+	return 0;
+}
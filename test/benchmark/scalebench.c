@@ -0,0 +1,546 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+/*
+ * Scaling of the shared data structures from one to many cores.
+ *
+ * Each benchmark runs on 1..N worker threads, one per worker CPU, for a
+ * fixed time per point. Lookups run while the control thread updates
+ * the same table, so that readers and writers meet as they do under
+ * traffic. Each point is reported as one JSON object per line:
+ *
+ *   {"bench":"route4_lookup","cores":4,"mops":80.123,
+ *    "mops_per_core":20.031,"efficiency":0.950}
+ *
+ * Efficiency is the throughput per core relative to one core. The lock
+ * contention of the largest point of each benchmark goes to stderr when
+ * OFP is built with --enable-lock-stat.
+ */
+
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <odp_api.h>
+#include <ofp.h>
+#include <ofpi.h>
+#include <ofpi_arp.h>
+#include <ofpi_in_pcb.h>
+#include <ofpi_lockstat.h>
+#include <ofpi_socketvar.h>
+#include <ofpi_uma.h>
+
+#define STR(x) #x
+#define ASSERT(x)						\
+	do {							\
+		if (!(x)) {					\
+			fprintf(stderr, __FILE__ "(%d): assert failed: " \
+				STR(x) "\n", __LINE__);		\
+			exit(1);				\
+		}						\
+	} while (0)
+
+odp_instance_t instance;
+struct ofp_ifnet *ifnet;
+
+#define C_PORT 0
+#define C_VLAN 0
+#define C_VRF 0
+#define C_L_ADDR 0xc0a83866
+#define C_GW_ADDR 0xc0a80001
+#define C_NB_ADDR 0xc0a80000
+#define C_DST_ADDR 0x1000000
+#define C_UDP_PORT 10000
+
+/* Operations between checks of the stop flag */
+#define BATCH 64
+/* Sockets of each worker in the PCB churn */
+#define PCB_SOCKETS 16
+/* Timeout of the timers cancelled before they expire */
+#define TIMER_TMO_US 100000
+
+struct arg_s {
+	uint32_t duration, loglevel, size, workers;
+	const char *filter;
+} arg, default_arg = {
+	.duration = 1000,
+	.loglevel = OFP_LOG_ERROR,
+	.size = 4096,
+	.workers = 0,
+	.filter = NULL,
+};
+
+struct ODP_ALIGNED_CACHE wstate_s {
+	uint64_t ops;
+	unsigned int seed;
+	/* Token of the sleep and wakeup ring */
+	odp_rwlock_t mtx;
+	int token;
+} wstate[ODP_THREAD_COUNT_MAX];
+
+static volatile int stop;
+static int num_workers;
+static odp_barrier_t barrier;
+static volatile uintptr_t sink;
+
+struct bench_s {
+	const char *name;
+	/* Runs BATCH operations on worker tid */
+	void (*work)(int tid);
+	/* Runs on the control thread during the measurement, or NULL */
+	void (*update)(void);
+};
+
+static uint32_t rnd(int tid)
+{
+	return (uint32_t)rand_r(&wstate[tid].seed);
+}
+
+/*
+ * Route lookup while a route is added and removed.
+ */
+static void work_route4(int tid)
+{
+	uint32_t i, flags;
+
+	for (i = 0; i < BATCH; i++)
+		sink += (uintptr_t)ofp_get_next_hop(C_VRF,
+			odp_cpu_to_be_32(C_DST_ADDR +
+					 ((rnd(tid) % arg.size) << 8) + 1),
+			&flags);
+}
+
+static void update_route4(void)
+{
+	uint32_t dst = odp_cpu_to_be_32(C_DST_ADDR + (arg.size << 8));
+	uint32_t gw = odp_cpu_to_be_32(C_GW_ADDR);
+
+	ofp_set_route_params(OFP_ROUTE_ADD, C_VRF, C_VLAN, C_PORT, dst, 24,
+			     gw, OFP_RTF_GATEWAY);
+	ofp_set_route_params(OFP_ROUTE_DEL, C_VRF, C_VLAN, C_PORT, dst, 24,
+			     gw, OFP_RTF_GATEWAY);
+}
+
+/*
+ * ARP lookup during full aging passes of the table.
+ */
+static void work_arp(int tid)
+{
+	uint8_t mac[OFP_ETHER_ADDR_LEN];
+	uint32_t i;
+
+	for (i = 0; i < BATCH; i++)
+		sink += ofp_ipv4_lookup_mac(
+			odp_cpu_to_be_32(C_NB_ADDR + rnd(tid) % arg.size + 1),
+			mac, ifnet);
+}
+
+static void update_arp(void)
+{
+	int cli = 1;
+
+	ofp_arp_age_cb(&cli);
+}
+
+/*
+ * UDP PCB lookup of all bound sockets while each worker closes and
+ * binds sockets of its own port range.
+ */
+static int pcb_fd[ODP_THREAD_COUNT_MAX][PCB_SOCKETS];
+
+static int pcb_bind(int tid, int i)
+{
+	struct ofp_sockaddr_in sin;
+	int fd;
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_DGRAM, OFP_IPPROTO_UDP);
+	ASSERT(fd >= 0);
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_len = sizeof(sin);
+	sin.sin_family = OFP_AF_INET;
+	sin.sin_port = odp_cpu_to_be_16(C_UDP_PORT + tid * PCB_SOCKETS + i);
+	sin.sin_addr.s_addr = odp_cpu_to_be_32(C_L_ADDR);
+	ASSERT(!ofp_bind(fd, (struct ofp_sockaddr *)&sin, sizeof(sin)));
+	return fd;
+}
+
+static void work_pcb(int tid)
+{
+	struct ofp_in_addr laddr, faddr;
+	struct inpcb *inp;
+	uint32_t i, num = num_workers * PCB_SOCKETS;
+	int k;
+
+	laddr.s_addr = odp_cpu_to_be_32(C_L_ADDR);
+	faddr.s_addr = odp_cpu_to_be_32(C_NB_ADDR + 1);
+
+	for (i = 0; i < BATCH; i++) {
+		inp = ofp_in_pcblookup(&V_udbinfo, faddr,
+				       odp_cpu_to_be_16(1024), laddr,
+				       odp_cpu_to_be_16(C_UDP_PORT +
+							rnd(tid) % num),
+				       INPLOOKUP_WILDCARD | INPLOOKUP_RLOCKPCB,
+				       ifnet);
+		if (inp)
+			INP_RUNLOCK(inp);
+	}
+
+	k = rnd(tid) % PCB_SOCKETS;
+	ofp_close(pcb_fd[tid][k]);
+	pcb_fd[tid][k] = pcb_bind(tid, k);
+}
+
+/*
+ * UMA allocation and free from a zone of all workers.
+ */
+static uma_zone_t zone = OFP_UMA_ZONE_INVALID;
+
+static void work_uma(int tid)
+{
+	void *item[BATCH];
+	uint32_t i;
+
+	(void)tid;
+
+	for (i = 0; i < BATCH; i++)
+		item[i] = uma_zalloc(zone, OFP_M_NOWAIT);
+	for (i = 0; i < BATCH; i++)
+		if (item[i])
+			uma_zfree(zone, item[i]);
+}
+
+/*
+ * Timer arm and cancel.
+ */
+static void timer_cb(void *arg)
+{
+	(void)arg;
+}
+
+static void work_timer(int tid)
+{
+	odp_timer_t tmr;
+	uint32_t i;
+
+	(void)tid;
+
+	for (i = 0; i < BATCH; i++) {
+		tmr = ofp_timer_start(TIMER_TMO_US, timer_cb,
+				      NULL, 0);
+		if (tmr != ODP_TIMER_INVALID)
+			ofp_timer_cancel(tmr);
+	}
+}
+
+/*
+ * ofp_msleep() and ofp_wakeup() in a ring: each worker waits for a
+ * token, then hands it to the next worker. There are as many tokens as
+ * workers, so with one worker the wakeup finds no sleeper.
+ */
+static void token_pass(int tid)
+{
+	struct wstate_s *next = &wstate[(tid + 1) % num_workers];
+
+	odp_rwlock_write_lock(&next->mtx);
+	next->token++;
+	ofp_wakeup(next);
+	odp_rwlock_write_unlock(&next->mtx);
+}
+
+static void work_sleep(int tid)
+{
+	struct wstate_s *w = &wstate[tid];
+	uint32_t i;
+
+	for (i = 0; i < BATCH; i++) {
+		odp_rwlock_write_lock(&w->mtx);
+		/* The timeout lets a worker see the stop flag */
+		while (!w->token && !stop)
+			ofp_msleep(w, &w->mtx, 0, "scale", 1000);
+		if (!w->token) {
+			odp_rwlock_write_unlock(&w->mtx);
+			return;
+		}
+		w->token--;
+		odp_rwlock_write_unlock(&w->mtx);
+		token_pass(tid);
+	}
+}
+
+static const struct bench_s *cur;
+
+static int worker(void *p)
+{
+	int tid = (int)(uintptr_t)p;
+	int i;
+
+	ASSERT(!ofp_init_local());
+
+	if (cur->work == work_pcb)
+		for (i = 0; i < PCB_SOCKETS; i++)
+			pcb_fd[tid][i] = pcb_bind(tid, i);
+	if (cur->work == work_sleep)
+		token_pass(tid);
+
+	odp_barrier_wait(&barrier);
+
+	while (!stop) {
+		cur->work(tid);
+		wstate[tid].ops += BATCH;
+	}
+
+	odp_barrier_wait(&barrier);
+
+	if (cur->work == work_pcb)
+		for (i = 0; i < PCB_SOCKETS; i++)
+			ofp_close(pcb_fd[tid][i]);
+
+	ASSERT(!ofp_term_local());
+	return 0;
+}
+
+/*
+ * Run bench on n workers for arg.duration ms. Returns the operations
+ * per microsecond of all workers.
+ */
+static double run_point(const struct bench_s *bench, int n,
+			const odp_cpumask_t *cpus)
+{
+	odph_thread_t thread_tbl[ODP_THREAD_COUNT_MAX];
+	odph_thread_common_param_t thr_common;
+	odph_thread_param_t thr_param;
+	odp_cpumask_t cpumask;
+	uint64_t start, end, ops = 0;
+	int i, cpu;
+
+	cur = bench;
+	num_workers = n;
+	stop = 0;
+	memset(wstate, 0, sizeof(wstate));
+	ofp_lockstat_clear();
+	odp_barrier_init(&barrier, n + 1);
+
+	cpu = odp_cpumask_first(cpus);
+	for (i = 0; i < n; i++) {
+		wstate[i].seed = i + 1;
+		odp_rwlock_init(&wstate[i].mtx);
+
+		odp_cpumask_zero(&cpumask);
+		odp_cpumask_set(&cpumask, cpu);
+		cpu = odp_cpumask_next(cpus, cpu);
+
+		memset(&thr_param, 0, sizeof(thr_param));
+		thr_param.start = worker;
+		thr_param.arg = (void *)(uintptr_t)i;
+		thr_param.thr_type = ODP_THREAD_WORKER;
+		odph_thread_common_param_init(&thr_common);
+		thr_common.instance = instance;
+		thr_common.cpumask = &cpumask;
+		ASSERT(odph_thread_create(&thread_tbl[i], &thr_common,
+					  &thr_param, 1) == 1);
+	}
+
+	odp_barrier_wait(&barrier);
+	start = odp_time_to_ns(odp_time_global());
+	end = start + (uint64_t)arg.duration * ODP_TIME_MSEC_IN_NS;
+
+	if (bench->update)
+		while (odp_time_to_ns(odp_time_global()) < end)
+			bench->update();
+	else
+		poll(0, 0, arg.duration);
+
+	stop = 1;
+	end = odp_time_to_ns(odp_time_global());
+	odp_barrier_wait(&barrier);
+	odph_thread_join(thread_tbl, n);
+
+	for (i = 0; i < n; i++)
+		ops += wstate[i].ops;
+	return (double)ops * 1000.0 / (end - start);
+}
+
+static void run(const struct bench_s *bench, const odp_cpumask_t *cpus)
+{
+	double mops, one = 0;
+	uint32_t n;
+
+	if (arg.filter && !strstr(bench->name, arg.filter))
+		return;
+
+	for (n = 1; n <= arg.workers; n++) {
+		mops = run_point(bench, n, cpus);
+		if (n == 1)
+			one = mops;
+		printf("{\"bench\":\"%s\",\"cores\":%u,\"mops\":%.3f,"
+		       "\"mops_per_core\":%.3f,\"efficiency\":%.3f}\n",
+		       bench->name, n, mops, mops / n,
+		       one > 0 ? mops / n / one : 0);
+		fflush(stdout);
+	}
+
+	fprintf(stderr, "\n%s, %u cores:\n", bench->name, arg.workers);
+	ofp_lockstat_print(2);
+}
+
+
+
+static void usage(const char *prog)
+{
+	printf("\nUsage: %s [options]\n\n", prog);
+
+	printf("Options:\n");
+	printf("-d, --duration      Milliseconds per point. (%u)\n", default_arg.duration);
+	printf("-f, --filter        Run only benchmarks whose name contains\n"
+	       "                    the argument. (all)\n");
+	printf("-l, --loglevel      OFP log level. (%u)\n", default_arg.loglevel);
+	printf("-s, --size          Routes and neighbors looked up. (%u)\n", default_arg.size);
+	printf("-w, --workers       Largest number of workers, 0: all worker\n"
+	       "                    CPUs. (%u)\n", default_arg.workers);
+
+	printf("\n");
+
+	exit(1);
+}
+
+
+
+static void parse_args(int argc, char *argv[])
+{
+	arg = default_arg;
+
+	while (1) {
+		static struct option long_options[] = {
+			{"duration",      required_argument, 0, 'd'},
+			{"filter",        required_argument, 0, 'f'},
+			{"loglevel",      required_argument, 0, 'l'},
+			{"size",          required_argument, 0, 's'},
+			{"workers",       required_argument, 0, 'w'},
+			{0,               0,                 0,  0 }
+		};
+
+		int c = getopt_long(argc, argv, "d:f:l:s:w:",
+				    long_options, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'd': arg.duration = atoi(optarg); break;
+		case 'f': arg.filter = optarg; break;
+		case 'l': arg.loglevel = atoi(optarg); break;
+		case 's': arg.size = atoi(optarg); break;
+		case 'w': arg.workers = atoi(optarg); break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (optind < argc) {
+		printf("Invalid argument: %s\n", argv[optind]);
+		usage(argv[0]);
+	}
+
+	if (!arg.size)
+		arg.size = 1;
+	if (arg.size > 1 << 16)
+		arg.size = 1 << 16;
+	if (!arg.duration)
+		arg.duration = 1;
+}
+
+
+
+static void print_info(void)
+{
+	fprintf(stderr, "\n"
+		"ODP system info\n"
+		"---------------\n"
+		"ODP API version: %s\n"
+		"CPU model:       %s\n"
+		"CPU freq (hz):   %lu\n"
+		"Cache line size: %i\n"
+		"Core count:      %i\n"
+		"\n",
+		odp_version_api_str(), odp_cpu_model_str(), odp_cpu_hz(),
+		odp_sys_cache_line_size(), odp_cpu_count());
+}
+
+
+
+int main(int argc, char *argv[])
+{
+	static const struct bench_s benches[] = {
+		{"route4_lookup", work_route4, update_route4},
+		{"arp_lookup", work_arp, update_arp},
+		{"pcb_lookup_churn", work_pcb, NULL},
+		{"uma_alloc_free", work_uma, NULL},
+		{"timer_start_cancel", work_timer, NULL},
+		{"msleep_wakeup", work_sleep, NULL},
+	};
+	uint8_t mac[OFP_ETHER_ADDR_LEN] = {0xa, 0xb, 0, 0, 0, 0};
+	odp_cpumask_t cpus;
+	uint32_t i;
+	int num_cpus;
+
+	parse_args(argc, argv);
+	ofp_loglevel = arg.loglevel;
+
+	ASSERT(!odp_init_global(&instance, NULL, NULL));
+	ASSERT(!odp_init_local(instance, ODP_THREAD_CONTROL));
+
+	print_info();
+
+	num_cpus = odp_cpumask_default_worker(&cpus, arg.workers);
+	ASSERT(num_cpus > 0);
+	if (num_cpus > ODP_THREAD_COUNT_MAX - 2)
+		num_cpus = ODP_THREAD_COUNT_MAX - 2;
+	arg.workers = num_cpus;
+
+	ofp_global_param_t params;
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.arp.entries = arg.size + 16;
+	params.mtrie.routes = arg.size + 16;
+	params.mtrie.table8_nodes = arg.size / 2 + (arg.size >> 8) + 16;
+	params.num_vlan = 0;
+	ASSERT(!ofp_init_global(instance, &params));
+	ASSERT(!ofp_init_local());
+
+	ASSERT(!ofp_config_interface_up_v4(C_PORT, C_VLAN, C_VRF,
+					   odp_cpu_to_be_32(C_L_ADDR), 16));
+	ifnet = ofp_get_ifnet(C_PORT, C_VLAN);
+
+	for (i = 0; i < arg.size; i++) {
+		uint32_t dst = odp_cpu_to_be_32(C_DST_ADDR + (i << 8));
+		uint32_t addr = odp_cpu_to_be_32(C_NB_ADDR + i + 1);
+
+		ASSERT(!ofp_set_route_params(OFP_ROUTE_ADD, C_VRF, C_VLAN,
+					     C_PORT, dst, 24,
+					     odp_cpu_to_be_32(C_GW_ADDR),
+					     OFP_RTF_GATEWAY));
+		memcpy(mac + 2, &addr, 4);
+		ASSERT(!ofp_add_mac(ifnet, addr, mac));
+	}
+
+	zone = uma_zcreate("scalebench", 2 * BATCH * num_cpus, 256, NULL,
+			   NULL, NULL, NULL, UMA_ALIGN_PTR, 0);
+	ASSERT(zone != OFP_UMA_ZONE_INVALID);
+
+	for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++)
+		run(&benches[i], &cpus);
+
+	uma_zdestroy(zone);
+
+	ofp_term_local();
+	ofp_term_global();
+	odp_term_local();
+	odp_term_global(instance);
+
+	return 0;
+}
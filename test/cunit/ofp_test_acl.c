@@ -0,0 +1,315 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_init.h>
+#include <ofpi_acl.h>
+
+#define RULES 16
+#define PKT_LEN (OFP_ETHER_HDR_LEN + sizeof(struct ofp_ip) + \
+		 sizeof(struct ofp_udphdr))
+
+/* 10.0.0.<n> to 10.1.0.<n> */
+#define SRC(n) odp_cpu_to_be_32(0x0a000000 | (n))
+#define DST(n) odp_cpu_to_be_32(0x0a010000 | (n))
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.acl.rules = RULES;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* An IPv4 packet, ports in host byte order, l3 after Ethernet */
+static odp_packet_t make_pkt(uint8_t proto, uint32_t src, uint32_t dst,
+			     uint16_t sport, uint16_t dport, uint16_t off)
+{
+	struct ofp_udphdr *uh;
+	struct ofp_ip *ip;
+	odp_packet_t pkt;
+
+	pkt = odp_packet_alloc(ofp_packet_pool, PKT_LEN);
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	memset(odp_packet_data(pkt), 0, PKT_LEN);
+	odp_packet_l3_offset_set(pkt, OFP_ETHER_HDR_LEN);
+
+	ip = odp_packet_l3_ptr(pkt, NULL);
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(*ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(PKT_LEN - OFP_ETHER_HDR_LEN);
+	ip->ip_off = odp_cpu_to_be_16(off);
+	ip->ip_ttl = 64;
+	ip->ip_p = proto;
+	ip->ip_src.s_addr = src;
+	ip->ip_dst.s_addr = dst;
+
+	uh = (struct ofp_udphdr *)(ip + 1);
+	uh->uh_sport = odp_cpu_to_be_16(sport);
+	uh->uh_dport = odp_cpu_to_be_16(dport);
+	return pkt;
+}
+
+static enum ofp_return_code apply(enum ofp_acl_point point, uint16_t vrf,
+				  uint8_t proto, uint32_t src, uint32_t dst,
+				  uint16_t dport, uint16_t off)
+{
+	odp_packet_t pkt = make_pkt(proto, src, dst, 1024, dport, off);
+	enum ofp_return_code res = ofp_acl_apply(point, pkt, vrf);
+
+	odp_packet_free(pkt);
+	return res;
+}
+
+/* Deny UDP to 10.1.0.0/16 ports 50-60, permit from 10.0.0.1 before it */
+static void add_rules(enum ofp_acl_point point, int *deny, int *permit)
+{
+	struct ofp_acl_rule rule;
+
+	ofp_acl_rule_init(&rule);
+	rule.dst = DST(0);
+	rule.dst_len = 16;
+	rule.proto = OFP_IPPROTO_UDP;
+	rule.dport_lo = 50;
+	rule.dport_hi = 60;
+	rule.priority = 10;
+	rule.action = OFP_ACL_DENY;
+	*deny = ofp_acl_rule_add(point, &rule);
+	CU_ASSERT(*deny >= 0);
+
+	ofp_acl_rule_init(&rule);
+	rule.src = SRC(1);
+	rule.src_len = 32;
+	rule.priority = 5;
+	*permit = ofp_acl_rule_add(point, &rule);
+	CU_ASSERT(*permit >= 0);
+}
+
+static void test_acl_match(void)
+{
+	uint64_t packets, bytes;
+	int deny, permit;
+
+	add_rules(OFP_ACL_FWD, &deny, &permit);
+
+	/* Rules apply from the commit on */
+	CU_ASSERT_FALSE(ofp_acl_enabled(OFP_ACL_FWD));
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_FWD), 0);
+	CU_ASSERT_TRUE(ofp_acl_enabled(OFP_ACL_FWD));
+	CU_ASSERT_FALSE(ofp_acl_enabled(OFP_ACL_LOCAL));
+
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      53, 0), OFP_PKT_DROP);
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      50, 0), OFP_PKT_DROP);
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      60, 0), OFP_PKT_DROP);
+
+	/* Outside the ports, protocol or prefix of the rule */
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      61, 0), OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_TCP, SRC(2), DST(3),
+			      53, 0), OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2),
+			      odp_cpu_to_be_32(0x0a020003), 53, 0),
+			OFP_PKT_CONTINUE);
+
+	/* The rule of the lower priority wins */
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(1), DST(3),
+			      53, 0), OFP_PKT_CONTINUE);
+
+	/* Later fragments have no ports */
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      53, 100), OFP_PKT_CONTINUE);
+
+	/* The other point has no rules */
+	CU_ASSERT_EQUAL(apply(OFP_ACL_LOCAL, 0, OFP_IPPROTO_UDP, SRC(2),
+			      DST(3), 53, 0), OFP_PKT_CONTINUE);
+
+	CU_ASSERT_EQUAL(ofp_acl_rule_stats(OFP_ACL_FWD, deny, &packets,
+					   &bytes), 0);
+	CU_ASSERT_EQUAL(packets, 3);
+	CU_ASSERT_EQUAL(bytes, 3 * PKT_LEN);
+	CU_ASSERT_EQUAL(ofp_acl_rule_stats(OFP_ACL_FWD, permit, &packets,
+					   NULL), 0);
+	CU_ASSERT_EQUAL(packets, 1);
+
+	/* A deleted rule applies until the next commit */
+	CU_ASSERT_EQUAL(ofp_acl_rule_del(OFP_ACL_FWD, deny), 0);
+	CU_ASSERT_EQUAL(ofp_acl_rule_del(OFP_ACL_FWD, deny), -1);
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      53, 0), OFP_PKT_DROP);
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_FWD), 0);
+	CU_ASSERT_EQUAL(apply(OFP_ACL_FWD, 0, OFP_IPPROTO_UDP, SRC(2), DST(3),
+			      53, 0), OFP_PKT_CONTINUE);
+
+	/* Without rules the ACL is off */
+	CU_ASSERT_EQUAL(ofp_acl_rule_del(OFP_ACL_FWD, permit), 0);
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_FWD), 0);
+	CU_ASSERT_FALSE(ofp_acl_enabled(OFP_ACL_FWD));
+}
+
+static void test_acl_vrf(void)
+{
+	struct ofp_acl_rule rule;
+	int id;
+
+	ofp_acl_rule_init(&rule);
+	rule.vrf = global_param->num_vrf;
+	CU_ASSERT_EQUAL(ofp_acl_rule_add(OFP_ACL_LOCAL, &rule), -1);
+	rule.vrf = 0;
+	rule.dport_lo = 2;
+	rule.dport_hi = 1;
+	CU_ASSERT_EQUAL(ofp_acl_rule_add(OFP_ACL_LOCAL, &rule), -1);
+
+	ofp_acl_rule_init(&rule);
+	rule.vrf = 0;
+	rule.action = OFP_ACL_DENY;
+	id = ofp_acl_rule_add(OFP_ACL_LOCAL, &rule);
+	CU_ASSERT(id >= 0);
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_LOCAL), 0);
+
+	CU_ASSERT_EQUAL(apply(OFP_ACL_LOCAL, 0, OFP_IPPROTO_TCP, SRC(2),
+			      DST(3), 80, 0), OFP_PKT_DROP);
+	if (global_param->num_vrf > 1)
+		CU_ASSERT_EQUAL(apply(OFP_ACL_LOCAL, 1, OFP_IPPROTO_TCP,
+				      SRC(2), DST(3), 80, 0),
+				OFP_PKT_CONTINUE);
+
+	CU_ASSERT_EQUAL(ofp_acl_rule_del(OFP_ACL_LOCAL, id), 0);
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_LOCAL), 0);
+}
+
+static void test_acl_burst(void)
+{
+	odp_packet_t pkt[6];
+	uint16_t vrf[6] = { 0 };
+	enum ofp_return_code res[6];
+	int deny, permit, i;
+
+	add_rules(OFP_ACL_FWD, &deny, &permit);
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_FWD), 0);
+
+	/* Runs of the same and of different rules give the single results */
+	pkt[0] = make_pkt(OFP_IPPROTO_UDP, SRC(2), DST(3), 1024, 53, 0);
+	pkt[1] = make_pkt(OFP_IPPROTO_UDP, SRC(2), DST(4), 1024, 55, 0);
+	pkt[2] = make_pkt(OFP_IPPROTO_UDP, SRC(1), DST(3), 1024, 53, 0);
+	pkt[3] = make_pkt(OFP_IPPROTO_TCP, SRC(2), DST(3), 1024, 53, 0);
+	pkt[4] = make_pkt(OFP_IPPROTO_UDP, SRC(2), DST(3), 1024, 53, 0);
+	pkt[5] = make_pkt(OFP_IPPROTO_UDP, SRC(2), DST(3), 1024, 61, 0);
+
+	ofp_acl_apply_burst(OFP_ACL_FWD, pkt, vrf, 6, res);
+	for (i = 0; i < 6; i++) {
+		CU_ASSERT_EQUAL(res[i], ofp_acl_apply(OFP_ACL_FWD, pkt[i], 0));
+		odp_packet_free(pkt[i]);
+	}
+	CU_ASSERT_EQUAL(res[0], OFP_PKT_DROP);
+	CU_ASSERT_EQUAL(res[1], OFP_PKT_DROP);
+	CU_ASSERT_EQUAL(res[2], OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(res[3], OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(res[4], OFP_PKT_DROP);
+	CU_ASSERT_EQUAL(res[5], OFP_PKT_CONTINUE);
+
+	CU_ASSERT_EQUAL(ofp_acl_rule_del(OFP_ACL_FWD, deny), 0);
+	CU_ASSERT_EQUAL(ofp_acl_rule_del(OFP_ACL_FWD, permit), 0);
+	CU_ASSERT_EQUAL(ofp_acl_commit(OFP_ACL_FWD), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp acl", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_acl_match)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_acl_vrf)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_acl_burst)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-acl");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
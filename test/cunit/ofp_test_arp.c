@@ -15,6 +15,9 @@
 
 #include "ofpi.h"
 #include "ofpi_arp.h"
+#include "ofpi_flow_cache.h"
+#include "ofpi_init.h"
+#include "ofpi_stat.h"
 
 #include "ofp_log.h"
 #include "ofp_route_arp.h"
@@ -26,7 +29,13 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
-#define ENTRY_TIMEOUT 2
+/* The shortest timeout, entries are aged once a second */
+#define ENTRY_TIMEOUT 1
+/*
+ * Use is collected on the next age pass, and the entry goes on the
+ * first pass past its timeout from there, with some slack for timers.
+ */
+#define AGED_US ((ENTRY_TIMEOUT + 2) * 1000000 + 200000)
 
 #define ALLOW_UNUSED_LOCAL(x) false ? (void)x : (void)0
 
@@ -56,6 +65,8 @@ static int init_suite(void)
 	ofp_init_global_param(&params);
 	params.enable_nl_thread = 0;
 	params.arp.entry_timeout = ENTRY_TIMEOUT;
+	params.arp.saved_pkt_timeout = ENTRY_TIMEOUT;
+	params.flow_cache_size = 64;
 	(void) ofp_init_global(instance, &params);
 
 	if (ofp_init_local()) {
@@ -156,19 +167,142 @@ static void test_arp(void)
 	/* Test entry is aged out. */
 	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip.s_addr, mac));
 	OFP_INFO("Inserted ARP entry");
-	sleep(ENTRY_TIMEOUT*2);
+	usleep(AGED_US);
 	CU_ASSERT(-1 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result, &mock_ifnet));
 
 	/* New entry. */
 	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip.s_addr, mac));
 	OFP_INFO("Inserted ARP entry");
 	/* Less than entry timeout passed, entry has not aged. */
-	sleep(ENTRY_TIMEOUT/2);
+	usleep(ENTRY_TIMEOUT * 1000000 / 2);
 	CU_ASSERT(0 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result, &mock_ifnet));
 	/* More than entry timeout passed, entry has aged. */
-	sleep(ENTRY_TIMEOUT*2);
+	usleep(AGED_US);
+	CU_ASSERT(-1 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result, &mock_ifnet));
+#endif
+}
+
+#ifndef OFP_USE_LIBCK
+static void test_arp_in_use(void)
+{
+	struct ofp_ifnet mock_ifnet;
+	struct in_addr ip;
+	uint8_t mac[OFP_ETHER_ADDR_LEN] = { 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x01, };
+	uint8_t mac_result[OFP_ETHER_ADDR_LEN + 2];
+	int i;
+
+	memset(&mock_ifnet, 0, sizeof(mock_ifnet));
+	CU_ASSERT(0 != inet_aton("1.1.1.2", &ip));
+
+	/* Use of the entry is collected on aging, entry in use stays. */
+	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip.s_addr, mac));
+	for (i = 0; i < ENTRY_TIMEOUT * 4; i++) {
+		usleep(ENTRY_TIMEOUT * 1000000 / 2);
+		CU_ASSERT(0 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result,
+						   &mock_ifnet));
+	}
+	CU_ASSERT(0 == memcmp(mac, mac_result, OFP_ETHER_ADDR_LEN));
+
+	/* Not used anymore, entry has aged. */
+	usleep(AGED_US);
 	CU_ASSERT(-1 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result, &mock_ifnet));
+}
+#endif
+
+#ifndef OFP_USE_LIBCK
+static uint64_t drops(enum ofp_drop_reason reason)
+{
+	uint64_t drop[OFP_DROP_REASON_MAX];
+
+	ofp_get_drop_statistics(drop);
+	return drop[reason];
+}
+
+static void test_arp_pending(void)
+{
+	struct ofp_ifnet mock_ifnet;
+	struct in_addr ip;
+	uint8_t mac_result[OFP_ETHER_ADDR_LEN + 2];
+	uint64_t full, unresolved;
+	odp_packet_t pkt;
+	int i;
+
+	memset(&mock_ifnet, 0, sizeof(mock_ifnet));
+	CU_ASSERT(0 != inet_aton("1.1.1.5", &ip));
+	full = drops(OFP_DROP_ARP_PENDING_FULL);
+	unresolved = drops(OFP_DROP_ARP_UNRESOLVED);
+
+	/* A full queue takes new packets in place of the oldest */
+	for (i = 0; i < ARP_ENTRY_PENDING + 3; i++) {
+		pkt = odp_packet_alloc(ofp_packet_pool, 64);
+		CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+		CU_ASSERT_EQUAL(ofp_arp_save_ipv4_pkt(pkt, NULL, ip.s_addr, 1,
+						      &mock_ifnet),
+				OFP_PKT_PROCESSED);
+	}
+	CU_ASSERT_EQUAL(drops(OFP_DROP_ARP_PENDING_FULL) - full, 3);
+	CU_ASSERT_EQUAL(drops(OFP_DROP_ARP_UNRESOLVED), unresolved);
+
+	/* The entry waiting for the reply is not usable */
+	CU_ASSERT(-1 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result,
+					    &mock_ifnet));
+
+	/* Without a reply the queued packets and the entry go */
+	usleep(AGED_US);
+	CU_ASSERT_EQUAL(drops(OFP_DROP_ARP_UNRESOLVED) - unresolved,
+			ARP_ENTRY_PENDING);
+	CU_ASSERT(-1 == ofp_ipv4_lookup_mac(ip.s_addr, mac_result,
+					    &mock_ifnet));
+}
 #endif
+
+/* Whether the flow cache has an output for ip */
+static odp_bool_t flow_cached(struct in_addr ip)
+{
+	struct ofp_flow_cache_entry *e = ofp_flow_cache_lookup(0, ip.s_addr);
+
+	return e && ofp_flow_cache_hit(e);
+}
+
+static void flow_cache_fill(struct in_addr ip, struct ofp_ifnet *dev,
+			    const uint8_t *mac)
+{
+	struct ofp_flow_cache_entry *e = ofp_flow_cache_lookup(0, ip.s_addr);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(e);
+	ofp_flow_cache_fill(e, 0, ip.s_addr, dev, NULL, mac,
+			    OFP_ETHER_ADDR_LEN);
+}
+
+static void test_arp_flow_cache(void)
+{
+	struct ofp_ifnet mock_ifnet;
+	struct in_addr ip, ip2;
+	uint8_t mac[OFP_ETHER_ADDR_LEN] = { 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x02, };
+
+	memset(&mock_ifnet, 0, sizeof(mock_ifnet));
+	CU_ASSERT(0 != inet_aton("1.1.1.3", &ip));
+	CU_ASSERT(0 != inet_aton("1.1.1.4", &ip2));
+
+	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip.s_addr, mac));
+	CU_ASSERT_FALSE(flow_cached(ip));
+	flow_cache_fill(ip, &mock_ifnet, mac);
+	CU_ASSERT_TRUE(flow_cached(ip));
+
+	/* A refresh with the same address keeps the cached outputs */
+	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip.s_addr, mac));
+	CU_ASSERT_TRUE(flow_cached(ip));
+
+	/* A changed address invalidates them */
+	mac[5]++;
+	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip.s_addr, mac));
+	CU_ASSERT_FALSE(flow_cached(ip));
+	flow_cache_fill(ip, &mock_ifnet, mac);
+	CU_ASSERT_TRUE(flow_cached(ip));
+
+	/* And so does a new entry */
+	CU_ASSERT(0 == ofp_add_mac(&mock_ifnet, ip2.s_addr, mac));
+	CU_ASSERT_FALSE(flow_cached(ip));
 }
 
 int main(void)
@@ -191,6 +325,20 @@ int main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_arp_flow_cache)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+#ifndef OFP_USE_LIBCK
+	if (NULL == CU_ADD_TEST(ptr_suite, test_arp_in_use)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_arp_pending)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+#endif
 
 #if defined(OFP_TESTMODE_AUTO)
 	CU_set_output_filename("CUnit-Util");
@@ -0,0 +1,326 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_btree.h>
+
+/* Enough keys for a tree of three levels */
+#define NUM_KEYS 1000
+/* Coprime with NUM_KEYS, to insert in a scrambled order */
+#define STRIDE 377
+
+static uint32_t keys[NUM_KEYS];
+static int freed;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+	int i;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.use_btree = 1;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	/* Even values, so that the odd ones fall between the keys */
+	for (i = 0; i < NUM_KEYS; i++)
+		keys[i] = 2 * i;
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+static int compare(void *arg, void *a, void *b)
+{
+	uint32_t x = *(uint32_t *)a, y = *(uint32_t *)b;
+
+	(void)arg;
+	return x < y ? -1 : x > y;
+}
+
+static int count_free(void *key)
+{
+	(void)key;
+	freed++;
+	return 0;
+}
+
+struct walk {
+	uint32_t last;
+	int num;
+	int sorted;
+	int stop;
+};
+
+static int walk_key(void *key, void *arg)
+{
+	struct walk *w = arg;
+	uint32_t k = *(uint32_t *)key;
+
+	if (w->num && k <= w->last)
+		w->sorted = 0;
+	w->last = k;
+	w->num++;
+	return w->stop && w->num == w->stop;
+}
+
+/* Keys in order, return their number or -1 if out of order */
+static int walk_all(ofp_btree *tree)
+{
+	struct walk w;
+
+	memset(&w, 0, sizeof(w));
+	w.sorted = 1;
+	ofp_btree_iterate_inorder(tree, walk_key, &w);
+	return w.sorted ? w.num : -1;
+}
+
+static ofp_btree *fill_tree(void)
+{
+	ofp_btree *tree = ofp_btree_new(compare, NULL);
+	int i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tree);
+	for (i = 0; i < NUM_KEYS; i++)
+		CU_ASSERT_EQUAL(ofp_btree_insert(tree,
+				&keys[(i * STRIDE) % NUM_KEYS]), 0);
+	return tree;
+}
+
+static void test_btree_insert_split(void)
+{
+	ofp_btree *tree = ofp_btree_new(compare, NULL);
+	void *found;
+	uint32_t k;
+	int i;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tree);
+	CU_ASSERT_PTR_NULL(ofp_btree_get_first(tree));
+	CU_ASSERT_EQUAL(walk_all(tree), 0);
+
+	/* A full leaf splits into two under a new root */
+	for (i = 0; i <= OFP_BTREE_KEYS; i++)
+		CU_ASSERT_EQUAL(ofp_btree_insert(tree, &keys[i]), 0);
+	CU_ASSERT_EQUAL(tree->height, 2);
+	CU_ASSERT_FALSE(tree->root->leaf);
+	CU_ASSERT_EQUAL(tree->root->num, 1);
+	ofp_btree_free(tree, NULL);
+
+	tree = fill_tree();
+	CU_ASSERT_EQUAL(tree->length, NUM_KEYS);
+	CU_ASSERT_EQUAL(tree->height, 3);
+	CU_ASSERT_EQUAL(walk_all(tree), NUM_KEYS);
+	CU_ASSERT_PTR_EQUAL(ofp_btree_get_first(tree), &keys[0]);
+
+	/* Duplicates are refused */
+	k = keys[NUM_KEYS / 2];
+	CU_ASSERT_EQUAL(ofp_btree_insert(tree, &k), -1);
+	CU_ASSERT_EQUAL(tree->length, NUM_KEYS);
+
+	for (i = 0; i < NUM_KEYS; i++) {
+		k = 2 * i;
+		found = NULL;
+		CU_ASSERT_EQUAL(ofp_btree_get_by_key(tree, &k, &found), 0);
+		CU_ASSERT_PTR_EQUAL(found, &keys[i]);
+		k++;
+		CU_ASSERT_EQUAL(ofp_btree_get_by_key(tree, &k, &found), -1);
+	}
+
+	ofp_btree_free(tree, NULL);
+}
+
+static void test_btree_range(void)
+{
+	ofp_btree *tree = fill_tree();
+	struct walk w;
+	void *found;
+	uint32_t k;
+	int i;
+
+	/* The least key not less than k, across the leaf boundaries */
+	for (i = 0; i < NUM_KEYS; i++) {
+		k = 2 * i - 1;
+		if (!i)
+			k = 0;
+		found = NULL;
+		CU_ASSERT_EQUAL(ofp_btree_get_item_by_key_least(tree, &k,
+								&found), 0);
+		CU_ASSERT_PTR_EQUAL(found, &keys[i]);
+	}
+	k = 2 * NUM_KEYS;
+	CU_ASSERT_EQUAL(ofp_btree_get_item_by_key_least(tree, &k, &found), -1);
+
+	/* Iteration from a key between keys, stopped by the callback */
+	memset(&w, 0, sizeof(w));
+	w.sorted = 1;
+	w.stop = 100;
+	k = 2 * 500 + 1;
+	CU_ASSERT_EQUAL(ofp_btree_iterate_from(tree, &k, walk_key, &w), 1);
+	CU_ASSERT_EQUAL(w.num, 100);
+	CU_ASSERT(w.sorted);
+	CU_ASSERT_EQUAL(w.last, keys[600]);
+
+	/* And to the end */
+	memset(&w, 0, sizeof(w));
+	w.sorted = 1;
+	k = 2 * (NUM_KEYS - 10);
+	CU_ASSERT_EQUAL(ofp_btree_iterate_from(tree, &k, walk_key, &w), 0);
+	CU_ASSERT_EQUAL(w.num, 10);
+	CU_ASSERT(w.sorted);
+
+	k = 2 * NUM_KEYS;
+	memset(&w, 0, sizeof(w));
+	CU_ASSERT_EQUAL(ofp_btree_iterate_from(tree, &k, walk_key, &w), 0);
+	CU_ASSERT_EQUAL(w.num, 0);
+
+	ofp_btree_free(tree, NULL);
+}
+
+static void test_btree_delete_merge(void)
+{
+	ofp_btree *tree = fill_tree();
+	uint32_t height = tree->height;
+	void *found;
+	uint32_t k;
+	int i;
+
+	freed = 0;
+	k = 1;
+	CU_ASSERT_EQUAL(ofp_btree_delete(tree, &k, count_free), -1);
+	CU_ASSERT_EQUAL(freed, 0);
+
+	/* Every other key, leaves borrow from and merge with siblings */
+	for (i = 0; i < NUM_KEYS; i += 2)
+		CU_ASSERT_EQUAL(ofp_btree_delete(tree, &keys[i], count_free),
+				0);
+	CU_ASSERT_EQUAL(freed, NUM_KEYS / 2);
+	CU_ASSERT_EQUAL(tree->length, NUM_KEYS / 2);
+	CU_ASSERT_EQUAL(walk_all(tree), NUM_KEYS / 2);
+	for (i = 0; i < NUM_KEYS; i++) {
+		k = 2 * i;
+		CU_ASSERT_EQUAL(ofp_btree_get_by_key(tree, &k, &found),
+				i % 2 ? 0 : -1);
+	}
+
+	/* The separators of deleted keys are not left behind */
+	k = keys[0];
+	CU_ASSERT_EQUAL(ofp_btree_get_item_by_key_least(tree, &k, &found), 0);
+	CU_ASSERT_PTR_EQUAL(found, &keys[1]);
+
+	/* The rest in the scrambled order, the tree shrinks to a leaf */
+	for (i = 0; i < NUM_KEYS; i++) {
+		k = (i * STRIDE) % NUM_KEYS;
+		if (k % 2)
+			CU_ASSERT_EQUAL(ofp_btree_delete(tree, &keys[k],
+							 count_free), 0);
+		if (i == NUM_KEYS / 2)
+			CU_ASSERT_EQUAL(walk_all(tree), (int)tree->length);
+	}
+	CU_ASSERT_EQUAL(height, 3);
+	CU_ASSERT_EQUAL(tree->height, 1);
+	CU_ASSERT_EQUAL(tree->length, 0);
+	CU_ASSERT_EQUAL(freed, NUM_KEYS);
+	CU_ASSERT_PTR_NULL(ofp_btree_get_first(tree));
+
+	/* Empty trees take keys again */
+	CU_ASSERT_EQUAL(ofp_btree_insert(tree, &keys[3]), 0);
+	CU_ASSERT_PTR_EQUAL(ofp_btree_get_first(tree), &keys[3]);
+
+	freed = 0;
+	ofp_btree_free(tree, count_free);
+	CU_ASSERT_EQUAL(freed, 1);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp btree", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_btree_insert_split)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_btree_range)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_btree_delete_merge)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-btree");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -0,0 +1,315 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_init.h>
+#include <ofpi_conntrack.h>
+#include <ofpi_pkt_processing.h>
+
+/* Flows of the table, the fifth takes over one of them */
+#define ENTRIES 4
+/* Flows not established expire after two ticks of about a second */
+#define TIMEOUT 2
+#define EXPIRED_US ((TIMEOUT + 2) * 1000000 + 500000)
+
+#define CLIENT odp_cpu_to_be_32(0x0a000001)
+#define SERVER odp_cpu_to_be_32(0x0a000002)
+#define CPORT(n) odp_cpu_to_be_16(40000 + (n))
+#define SPORT odp_cpu_to_be_16(80)
+
+static int expired;
+
+static void expire_cb(struct ofp_ct_flow *flow)
+{
+	(void)flow;
+	expired++;
+}
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.conntrack.entries = ENTRIES;
+	params.conntrack.timeout = TIMEOUT;
+	params.conntrack.expire = expire_cb;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* A TCP or UDP packet of src:sport to dst:dport, l3 after Ethernet */
+static odp_packet_t make_pkt(uint8_t proto, uint32_t src, uint16_t sport,
+			     uint32_t dst, uint16_t dport, uint8_t flags)
+{
+	uint32_t len = OFP_ETHER_HDR_LEN + sizeof(struct ofp_ip) +
+		sizeof(struct ofp_tcphdr);
+	struct ofp_tcphdr *th;
+	struct ofp_ip *ip;
+	odp_packet_t pkt;
+
+	pkt = odp_packet_alloc(ofp_packet_pool, len);
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	ofp_packet_user_area_reset(pkt);
+	memset(odp_packet_data(pkt), 0, len);
+	odp_packet_l3_offset_set(pkt, OFP_ETHER_HDR_LEN);
+
+	ip = odp_packet_l3_ptr(pkt, NULL);
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(*ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(len - OFP_ETHER_HDR_LEN);
+	ip->ip_ttl = 64;
+	ip->ip_p = proto;
+	ip->ip_src.s_addr = src;
+	ip->ip_dst.s_addr = dst;
+
+	th = (struct ofp_tcphdr *)(ip + 1);
+	th->th_sport = sport;
+	th->th_dport = dport;
+	th->th_off = sizeof(*th) >> 2;
+	th->th_flags = flags;
+	return pkt;
+}
+
+/*
+ * Input a packet, return its flow and whether it is a reply. A NULL flow
+ * fails the test, the packets of these tests are all tracked.
+ */
+static struct ofp_ct_flow *input(odp_packet_t pkt, int *reply,
+				 enum ofp_return_code *rc)
+{
+	struct ofp_ct_flow *flow;
+
+	*rc = ofp_ct_ipv4_input(pkt, 0);
+	flow = ofp_ct_packet_flow(pkt, reply);
+	odp_packet_free(pkt);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(flow);
+	return flow;
+}
+
+static struct ofp_ct_flow *tcp_from_client(uint8_t flags, int *reply)
+{
+	enum ofp_return_code rc;
+
+	return input(make_pkt(OFP_IPPROTO_TCP, CLIENT, CPORT(0), SERVER, SPORT,
+			      flags), reply, &rc);
+}
+
+static struct ofp_ct_flow *tcp_from_server(uint8_t flags, int *reply)
+{
+	enum ofp_return_code rc;
+
+	return input(make_pkt(OFP_IPPROTO_TCP, SERVER, SPORT, CLIENT, CPORT(0),
+			      flags), reply, &rc);
+}
+
+static void test_ct_tcp_states(void)
+{
+	struct ofp_ct_flow *flow;
+	uint32_t *data;
+	int reply;
+
+	/* Handshake, both directions are the same flow */
+	flow = tcp_from_client(OFP_TH_SYN, &reply);
+	CU_ASSERT_EQUAL(reply, 0);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_NEW);
+	data = ofp_ct_flow_data(flow);
+	CU_ASSERT_EQUAL(data[0], 0);
+	data[0] = 0x5a5a;
+
+	CU_ASSERT_PTR_EQUAL(tcp_from_server(OFP_TH_SYN | OFP_TH_ACK, &reply),
+			    flow);
+	CU_ASSERT_EQUAL(reply, 1);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_NEW);
+
+	CU_ASSERT_PTR_EQUAL(tcp_from_client(OFP_TH_ACK, &reply), flow);
+	CU_ASSERT_EQUAL(reply, 0);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_ESTABLISHED);
+
+	/* The user data stays with the flow */
+	CU_ASSERT_EQUAL(data[0], 0x5a5a);
+
+	/* Closing after the first FIN, closed after the second */
+	CU_ASSERT_PTR_EQUAL(tcp_from_client(OFP_TH_FIN | OFP_TH_ACK, &reply),
+			    flow);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_CLOSING);
+	CU_ASSERT_PTR_EQUAL(tcp_from_server(OFP_TH_FIN | OFP_TH_ACK, &reply),
+			    flow);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_CLOSING);
+
+	/* A new connection of the same ports reuses the closed flow */
+	expired = 0;
+	CU_ASSERT_PTR_EQUAL(tcp_from_server(OFP_TH_SYN, &reply), flow);
+	CU_ASSERT_EQUAL(expired, 1);
+	CU_ASSERT_EQUAL(reply, 0);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_NEW);
+	CU_ASSERT_EQUAL(data[0], 0);
+
+	/* A RST closes it */
+	CU_ASSERT_PTR_EQUAL(tcp_from_client(OFP_TH_RST, &reply), flow);
+	CU_ASSERT_EQUAL(reply, 1);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_CLOSING);
+}
+
+static void test_ct_action(void)
+{
+	struct ofp_ct_flow *flow;
+	enum ofp_return_code rc;
+	int reply;
+
+	flow = input(make_pkt(OFP_IPPROTO_UDP, CLIENT, CPORT(1), SERVER,
+			      SPORT, 0), &reply, &rc);
+	CU_ASSERT_EQUAL(rc, OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_NEW);
+
+	/* A reply establishes a UDP flow */
+	CU_ASSERT_PTR_EQUAL(input(make_pkt(OFP_IPPROTO_UDP, SERVER, SPORT,
+					   CLIENT, CPORT(1), 0),
+				  &reply, &rc), flow);
+	CU_ASSERT_EQUAL(rc, OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(reply, 1);
+	CU_ASSERT_EQUAL(ofp_ct_flow_state(flow), OFP_CT_ESTABLISHED);
+
+	/* Later packets of both directions are dropped */
+	ofp_ct_flow_action_set(flow, OFP_CT_ACTION_DROP);
+	CU_ASSERT_PTR_EQUAL(input(make_pkt(OFP_IPPROTO_UDP, CLIENT, CPORT(1),
+					   SERVER, SPORT, 0),
+				  &reply, &rc), flow);
+	CU_ASSERT_EQUAL(rc, OFP_PKT_DROP);
+	CU_ASSERT_PTR_EQUAL(input(make_pkt(OFP_IPPROTO_UDP, SERVER, SPORT,
+					   CLIENT, CPORT(1), 0),
+				  &reply, &rc), flow);
+	CU_ASSERT_EQUAL(rc, OFP_PKT_DROP);
+
+	ofp_ct_flow_action_set(flow, OFP_CT_ACTION_CONTINUE);
+	(void)input(make_pkt(OFP_IPPROTO_UDP, CLIENT, CPORT(1), SERVER,
+			     SPORT, 0), &reply, &rc);
+	CU_ASSERT_EQUAL(rc, OFP_PKT_CONTINUE);
+}
+
+static void test_ct_expire_evict(void)
+{
+	struct ofp_ct_flow *flow[ENTRIES + 1];
+	enum ofp_return_code rc;
+	int i, j, reply;
+
+	for (i = 0; i < ENTRIES; i++)
+		flow[i] = input(make_pkt(OFP_IPPROTO_UDP, CLIENT, CPORT(10 + i),
+					 SERVER, SPORT, 0), &reply, &rc);
+	for (i = 0; i < ENTRIES; i++)
+		for (j = i + 1; j < ENTRIES; j++)
+			CU_ASSERT_PTR_NOT_EQUAL(flow[i], flow[j]);
+
+	/* A full table gives a new flow the one expiring next */
+	expired = 0;
+	flow[ENTRIES] = input(make_pkt(OFP_IPPROTO_UDP, CLIENT,
+				       CPORT(10 + ENTRIES), SERVER, SPORT, 0),
+			      &reply, &rc);
+	CU_ASSERT_EQUAL(expired, 1);
+	CU_ASSERT_EQUAL(reply, 0);
+
+	/* Idle flows expire */
+	expired = 0;
+	usleep(EXPIRED_US);
+	CU_ASSERT_EQUAL(ofp_ct_age(), ENTRIES);
+	CU_ASSERT_EQUAL(expired, ENTRIES);
+	CU_ASSERT_EQUAL(ofp_ct_age(), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp conntrack", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	/* First, with the table empty */
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ct_expire_evict)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ct_tcp_states)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ct_action)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-conntrack");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -0,0 +1,196 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include "../../src/ofp_coroutine.c"
+
+/*
+ * Test data
+ */
+static char trace[64];
+static int trace_len;
+static int go;
+
+static void step(void *arg)
+{
+	char id = *(char *)arg;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		trace[trace_len++] = id;
+		ofp_coroutine_yield();
+	}
+}
+
+static void waiter(void *arg)
+{
+	(void)arg;
+
+	trace[trace_len++] = 'w';
+	ofp_coroutine_wait(&go);
+	trace[trace_len++] = 'r';
+}
+
+/*
+ * INIT
+ */
+static int
+init_suite(void)
+{
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	return 0;
+}
+
+static void
+reset(void)
+{
+	memset(trace, 0, sizeof(trace));
+	trace_len = 0;
+	go = 0;
+}
+
+/*
+ * Testcases
+ */
+
+static void
+test_coroutine_none(void)
+{
+	CU_ASSERT_EQUAL(ofp_coroutine_count(), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_run(), 0);
+	/* Outside coroutines yield returns at once */
+	ofp_coroutine_yield();
+	CU_ASSERT_EQUAL(ofp_coroutine_create(NULL, NULL, 0), -1);
+}
+
+static void
+test_coroutine_yield(void)
+{
+	char a = 'a', b = 'b';
+	int rounds = 0;
+
+	reset();
+	CU_ASSERT_EQUAL(ofp_coroutine_create(step, &a, 0), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_create(step, &b, 16 * 1024), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_count(), 2);
+	CU_ASSERT_EQUAL(trace_len, 0);
+
+	while (ofp_coroutine_count() && rounds < 10) {
+		CU_ASSERT_EQUAL(ofp_coroutine_run(), 2);
+		rounds++;
+	}
+	CU_ASSERT_EQUAL(rounds, 4);
+	CU_ASSERT_STRING_EQUAL(trace, "ababab");
+}
+
+static void
+test_coroutine_wait(void)
+{
+	reset();
+	CU_ASSERT_EQUAL(ofp_coroutine_create(waiter, NULL, 0), 0);
+	CU_ASSERT(ofp_coroutine_runnable());
+
+	CU_ASSERT_EQUAL(ofp_coroutine_run(), 1);
+	CU_ASSERT_STRING_EQUAL(trace, "w");
+	/* Not resumed before the flag is set, the dispatcher may sleep */
+	CU_ASSERT_FALSE(ofp_coroutine_runnable());
+	CU_ASSERT_EQUAL(ofp_coroutine_run(), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_count(), 1);
+
+	go = 1;
+	CU_ASSERT(ofp_coroutine_runnable());
+	CU_ASSERT_EQUAL(ofp_coroutine_run(), 1);
+	CU_ASSERT_STRING_EQUAL(trace, "wr");
+	CU_ASSERT_EQUAL(ofp_coroutine_count(), 0);
+	CU_ASSERT_FALSE(ofp_coroutine_runnable());
+}
+
+static void
+test_coroutine_term(void)
+{
+	reset();
+	CU_ASSERT_EQUAL(ofp_coroutine_create(waiter, NULL, 0), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_run(), 1);
+	CU_ASSERT_EQUAL(ofp_coroutine_create(waiter, NULL, 0), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_count(), 2);
+
+	ofp_coroutine_term_local();
+	CU_ASSERT_EQUAL(ofp_coroutine_count(), 0);
+	CU_ASSERT_EQUAL(ofp_coroutine_run(), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp coroutine", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_coroutine_none)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_coroutine_yield)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_coroutine_wait)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_coroutine_term)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-Coroutine");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -40,10 +40,12 @@ uint8_t ip6addr[16] = {
 0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef
 };
 uint8_t macaddr[6] = { 0xFF, 0xEE, 0xDD, 0xCC, 0xBB, 0xAA };
-uint8_t pcap_header[24] = {
-0xd4, 0xc3, 0xb2, 0xa1, 0x02, 0x00, 0x04, 0x00,
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0xff, 0xff, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00
+/* pcapng section header block, little endian */
+uint8_t pcapng_shb[28] = {
+0x0a, 0x0d, 0x0d, 0x0a, 0x1c, 0x00, 0x00, 0x00,
+0x4d, 0x3c, 0x2b, 0x1a, 0x01, 0x00, 0x00, 0x00,
+0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+0x1c, 0x00, 0x00, 0x00
 };
 
 /*
@@ -136,48 +138,78 @@ create_odp_packet_ip4(odp_packet_t *opkt, uint8_t *pkt_data, int plen)
 	return 0;
 }
 
-#define PCAP_TIMESTAMP_LEN 8
-#define PCAP_PKT_SIZE_LEN 8
+#define PCAPNG_IDB 1
+#define PCAPNG_EPB 6
+
+static uint32_t get32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, 4);
+	return v;
+}
+
+/* Skip an interface description block if there is one */
+static void skip_idb(uint8_t *buf, unsigned buf_size, unsigned *offset)
+{
+	if (*offset + 8 <= buf_size && get32(&buf[*offset]) == PCAPNG_IDB)
+		*offset += get32(&buf[*offset + 4]);
+}
 
 static int
 assert_pcap_pkt(uint8_t *buf, unsigned buf_size, unsigned *offset,
-		const uint8_t *ref_buf, unsigned ref_len)
+		const uint8_t *ref_buf, unsigned ref_len, unsigned caplen)
 {
-	union{
-		uint32_t ul[2];
-		uint8_t b[8];
-	} pkt_size;
+	skip_idb(buf, buf_size, offset);
 
-	if (*offset + PCAP_TIMESTAMP_LEN + PCAP_PKT_SIZE_LEN + ref_len >
-	    buf_size) {
+	if (*offset + 28 + caplen > buf_size) {
 		CU_FAIL("PCAP dump failed - buf_size to small");
 		return -1;
 	}
 
-	/* don't check timestamp */
-	*offset += PCAP_TIMESTAMP_LEN;
+	if (get32(&buf[*offset]) != PCAPNG_EPB) {
+		CU_FAIL("PCAP dump failed - block type");
+		return -1;
+	}
 
-	pkt_size.ul[0] = ref_len;
-	pkt_size.ul[1] = ref_len;
-	if (memcmp(&buf[*offset], pkt_size.b, PCAP_PKT_SIZE_LEN)) {
+	/* don't check interface id and timestamp */
+	if (get32(&buf[*offset + 20]) != caplen ||
+	    get32(&buf[*offset + 24]) != ref_len) {
 		CU_FAIL("PCAP dump failed - pkt_size");
 		return -1;
 	}
 	CU_PASS("PCAP dump");
 
-	*offset += PCAP_PKT_SIZE_LEN;
-
-	if (memcmp(&buf[*offset], ref_buf, ref_len)) {
+	if (memcmp(&buf[*offset + 28], ref_buf, caplen)) {
 		CU_FAIL("PCAP dump failed - ref_buf");
 		return -1;
 	}
 	CU_PASS("PCAP dump");
 
-	*offset += ref_len;
+	*offset += get32(&buf[*offset + 4]);
 
 	return 0;
 }
 
+static uint8_t *read_pcap_file(unsigned *size)
+{
+	uint8_t *buf;
+	FILE *f = fopen(pcap_file_name, "rb");
+
+	if (!f)
+		return NULL;
+
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	buf = (uint8_t *)malloc(*size);
+	*size = fread(buf, 1, *size, f);
+
+	fclose(f);
+	return buf;
+}
+
 /*
  * Testcases
  */
@@ -187,8 +219,8 @@ test_pcap(void)
 {
 	odp_packet_t pkt;
 	int port = 22;
-	unsigned fsize, l, offset = 0;
-	uint8_t *buf;
+	unsigned fsize, offset = 0;
+	uint8_t *buf = NULL;
 
 	/* INIT */
 	ofp_debug_capture_ports = 1 << port;
@@ -214,42 +246,147 @@ test_pcap(void)
 	(void)ip6udp_frame;
 	(void)icmp6_frame;
 
-	/* ASSERT */
-	FILE *f = fopen(pcap_file_name, "rb");
-
-	fseek(f, 0, SEEK_END);
-	fsize = ftell(f);
-	fseek(f, 0, SEEK_SET);
+	/* Packets are written by the writer thread */
+	CU_ASSERT_EQUAL(ofp_pcap_flush(), 3);
 
-	buf = (uint8_t *)malloc(fsize);
-	l = fread(buf, 1, fsize, f);
-
-	fclose(f);
-
-	if (l < sizeof(pcap_header) ||
-	    memcmp(&buf[offset], pcap_header, sizeof(pcap_header))) {
+	/* ASSERT */
+	buf = read_pcap_file(&fsize);
+	if (!buf || fsize < sizeof(pcapng_shb) ||
+	    memcmp(&buf[offset], pcapng_shb, sizeof(pcapng_shb))) {
 		CU_FAIL("PCAP header failed")
 		goto err;
 	} else {
 		CU_PASS("PCAP header passed")
 	}
-	offset += sizeof(pcap_header);
+	offset += sizeof(pcapng_shb);
 
-	if (assert_pcap_pkt(buf, fsize, &offset, tcp_frame, sizeof(tcp_frame)))
+	if (assert_pcap_pkt(buf, fsize, &offset, tcp_frame, sizeof(tcp_frame),
+			    sizeof(tcp_frame)))
 		goto err;
 
-	if (assert_pcap_pkt(buf, fsize, &offset, arp_frame, sizeof(arp_frame)))
+	if (assert_pcap_pkt(buf, fsize, &offset, arp_frame, sizeof(arp_frame),
+			    sizeof(arp_frame)))
 		goto err;
 
 	if (assert_pcap_pkt(buf, fsize, &offset, icmp_frame,
-			    sizeof(icmp_frame)))
+			    sizeof(icmp_frame), sizeof(icmp_frame)))
 		goto err;
 
 err:
+	free(buf);
 	ofp_debug_capture_ports = 0;
 	ofp_debug_flags = ofp_debug_flags ^ OFP_DEBUG_CAPTURE;
 }
 
+static void
+test_pcap_snaplen(void)
+{
+	odp_packet_t pkt;
+	int port = 1;
+	unsigned fsize, offset = sizeof(pcapng_shb);
+	uint8_t *buf = NULL;
+
+	ofp_debug_capture_ports = 1 << port;
+	ofp_debug_flags = OFP_DEBUG_CAPTURE;
+	ofp_set_capture_file(pcap_file_name);
+	ofp_set_capture_snaplen(60);
+	CU_ASSERT_EQUAL(ofp_get_capture_snaplen(), 60);
+
+	if (create_odp_packet_ip4(&pkt, tcp_frame, sizeof(tcp_frame)))
+		goto err;
+	ofp_save_packet_to_pcap_file(OFP_DEBUG_PRINT_SEND_NIC, pkt, port);
+	odp_packet_free(pkt);
+	CU_ASSERT_EQUAL(ofp_pcap_flush(), 1);
+
+	buf = read_pcap_file(&fsize);
+	if (!buf) {
+		CU_FAIL("PCAP file missing");
+		goto err;
+	}
+	assert_pcap_pkt(buf, fsize, &offset, tcp_frame, sizeof(tcp_frame), 60);
+
+err:
+	free(buf);
+	ofp_set_capture_snaplen(0);
+	CU_ASSERT_EQUAL(ofp_get_capture_snaplen(), OFP_PCAP_SNAPLEN_MAX);
+	ofp_debug_capture_ports = 0;
+	ofp_debug_flags = 0;
+}
+
+static void
+test_pcap_ring_full(void)
+{
+	odp_packet_t pkt;
+	uint64_t drops;
+	int i, port = 0;
+
+	ofp_debug_capture_ports = 1 << port;
+	ofp_debug_flags = OFP_DEBUG_CAPTURE;
+	ofp_set_capture_file(pcap_file_name);
+
+	if (create_odp_packet_ip4(&pkt, arp_frame, sizeof(arp_frame)))
+		goto err;
+
+	drops = ofp_get_capture_drops();
+	for (i = 0; i < OFP_PCAP_RING_SIZE + 5; i++)
+		ofp_save_packet_to_pcap_file(OFP_DEBUG_PRINT_RECV_NIC, pkt,
+					     port);
+	odp_packet_free(pkt);
+
+	CU_ASSERT_EQUAL(ofp_get_capture_drops() - drops, 5);
+	CU_ASSERT_EQUAL(ofp_pcap_flush(), OFP_PCAP_RING_SIZE);
+	CU_ASSERT_EQUAL(ofp_pcap_flush(), 0);
+
+err:
+	ofp_debug_capture_ports = 0;
+	ofp_debug_flags = 0;
+}
+
+static void
+test_pcap_filter(void)
+{
+	odp_packet_t tcp, arp, icmp;
+	char expr[128];
+
+	if (create_odp_packet_ip4(&tcp, tcp_frame, sizeof(tcp_frame)) ||
+	    create_odp_packet_ip4(&arp, arp_frame, sizeof(arp_frame)) ||
+	    create_odp_packet_ip4(&icmp, icmp_frame, sizeof(icmp_frame)))
+		return;
+
+	/* No filter */
+	CU_ASSERT_TRUE(ofp_debug_filter_match(tcp));
+	CU_ASSERT_TRUE(ofp_debug_filter_match(arp));
+
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("arp"), 0);
+	CU_ASSERT_FALSE(ofp_debug_filter_match(tcp));
+	CU_ASSERT_TRUE(ofp_debug_filter_match(arp));
+
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("ip,icmp"), 0);
+	CU_ASSERT_FALSE(ofp_debug_filter_match(tcp));
+	CU_ASSERT_FALSE(ofp_debug_filter_match(arp));
+	CU_ASSERT_TRUE(ofp_debug_filter_match(icmp));
+
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("tcp port=0"), 0);
+	CU_ASSERT_FALSE(ofp_debug_filter_match(tcp));
+
+	ofp_get_capture_filter(expr, sizeof(expr));
+	CU_ASSERT_STRING_EQUAL(expr, "tcp port=0");
+
+	/* A bad expression keeps the previous filter */
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("port"), -1);
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("host 1.2.3"), -1);
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("foo"), -1);
+	ofp_get_capture_filter(expr, sizeof(expr));
+	CU_ASSERT_STRING_EQUAL(expr, "tcp port=0");
+
+	CU_ASSERT_EQUAL(ofp_set_capture_filter("none"), 0);
+	CU_ASSERT_TRUE(ofp_debug_filter_match(tcp));
+
+	odp_packet_free(tcp);
+	odp_packet_free(arp);
+	odp_packet_free(icmp);
+}
+
 /*
  * Main
  */
@@ -274,6 +411,18 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_pcap_snaplen)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_pcap_ring_full)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_pcap_filter)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 
 #if OFP_TESTMODE_AUTO
 	CU_set_output_filename("CUnit-PCAP");
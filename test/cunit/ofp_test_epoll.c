@@ -12,6 +12,8 @@
 #include "ofp_epoll.h"
 #include "ofpi_epoll.h"
 #include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include "ofp_errno.h"
 #include "ofpi_socketvar.h"
 #include "ofp_cunit_version.h"
@@ -30,13 +32,6 @@
 #define SETUP_BLOCKING
 #endif
 
-#define LENGTH(array) \
-	sizeof(array)/sizeof(*array)
-#define FOREACH(item, array) \
-	int i, l, breaked; \
-	for (i = 0, l = LENGTH(array), breaked = 0; i < l && !breaked; ++i, breaked = !breaked) \
-		for (item = &array[i]; !breaked; breaked = !breaked)
-
 
 static const int epfd = OFP_SOCK_NUM_OFFSET;
 static const int fd = OFP_SOCK_NUM_OFFSET + 1;
@@ -45,6 +40,7 @@ static struct socket non_epoll = { 0 };
 static struct ofp_epoll_event event = { 0 };
 static struct ofp_epoll_event events[2];
 static int sleeper_called = 0;
+static int wakeup_called = 0;
 
 static void test_create_with_invalid_size(void)
 {
@@ -266,6 +262,45 @@ static void test_wait_with_unset_events(void)
 	CU_ASSERT_EQUAL(epoll_wait(2), 0);
 }
 
+static int wakeup_spy(void *channel);
+static void test_wait_with_edge_triggered_fd(void)
+{
+	SETUP_NON_BLOCKING;
+
+	ofp_set_is_readable_checker(fd_is_readable);
+	ofp_set_epoll_wakeup(wakeup_spy);
+
+	CU_ASSERT_EQUAL(modify_fd(fd, OFP_EPOLLIN | OFP_EPOLLET), 0);
+	CU_ASSERT_EQUAL(epoll_wait(2), 2);
+
+	/* Reported again only after a new event */
+	CU_ASSERT_EQUAL(epoll_wait(2), 1);
+	CU_ASSERT_EQUAL(events[0].data.fd, fd + 1);
+
+	ofp_epoll_notify(&non_epoll, OFP_EPOLLIN);
+	CU_ASSERT_TRUE(wakeup_called);
+	CU_ASSERT_EQUAL(epoll_wait(2), 2);
+}
+
+static void test_wait_with_oneshot_fd(void)
+{
+	SETUP_NON_BLOCKING;
+
+	ofp_set_is_readable_checker(fd_is_readable);
+	ofp_set_epoll_wakeup(wakeup_spy);
+
+	CU_ASSERT_EQUAL(modify_fd(fd, OFP_EPOLLIN | OFP_EPOLLONESHOT), 0);
+	CU_ASSERT_EQUAL(epoll_wait(2), 2);
+
+	/* Disabled until modified */
+	ofp_epoll_notify(&non_epoll, OFP_EPOLLIN);
+	CU_ASSERT_EQUAL(epoll_wait(2), 1);
+	CU_ASSERT_EQUAL(events[0].data.fd, fd + 1);
+
+	CU_ASSERT_EQUAL(modify_fd(fd, OFP_EPOLLIN), 0);
+	CU_ASSERT_EQUAL(epoll_wait(2), 2);
+}
+
 static void setup_blocking(void)
 {
 	setup_non_blocking();
@@ -302,6 +337,34 @@ static void test_wait_with_already_readable_fd(void)
 	CU_ASSERT_FALSE(sleeper_called);
 }
 
+static struct socket *epoll_socket_getter(int fd);
+static void test_wait_with_armed_eventfd(void)
+{
+	eventfd_t value;
+	int evfd;
+
+	SETUP_BLOCKING;
+
+	ofp_set_is_readable_checker(fd_not_readable);
+	ofp_set_epoll_wakeup(wakeup_spy);
+	CU_ASSERT_EQUAL(epoll_wait(2), 0);
+
+	ofp_set_socket_getter(epoll_socket_getter);
+	evfd = ofp_epoll_eventfd(epfd);
+	CU_ASSERT_NOT_EQUAL_FATAL(evfd, -1);
+	CU_ASSERT_EQUAL(ofp_epoll_arm(epfd), 0);
+	CU_ASSERT_EQUAL(eventfd_read(evfd, &value), -1);
+
+	ofp_epoll_notify(&non_epoll, OFP_EPOLLIN);
+	CU_ASSERT_EQUAL(eventfd_read(evfd, &value), 0);
+
+	/* Not armed with a ready fd */
+	CU_ASSERT_EQUAL(ofp_epoll_arm(epfd), 1);
+
+	ofp_epoll_socket_close(&epoll);
+	CU_ASSERT_EQUAL(epoll.so_epoll.evfd, -1);
+}
+
 static char *const_cast(const char *str)
 {
 	return (char *)(uintptr_t)str;
@@ -373,6 +436,10 @@ int main(void)
 		  test_modify_registered_fd },
 		{ const_cast("Wait will return zero when events bit mask is unset"),
 		  test_wait_with_unset_events },
+		{ const_cast("Wait will report edge triggered fd once per event"),
+		  test_wait_with_edge_triggered_fd },
+		{ const_cast("Wait will report oneshot fd once until modified"),
+		  test_wait_with_oneshot_fd },
 		CU_TEST_INFO_NULL
 	};
 
@@ -383,6 +450,8 @@ int main(void)
 		  test_wait_with_zero_timeout },
 		{ const_cast("Wait will not block if any fd is ready"),
 		  test_wait_with_already_readable_fd },
+		{ const_cast("Armed eventfd will be signalled by a ready fd"),
+		  test_wait_with_armed_eventfd },
 		CU_TEST_INFO_NULL
 	};
 
@@ -434,13 +503,13 @@ int failing_socket_creator(void)
 
 static int epoll_socket_creator(void)
 {
-	struct epoll_set *epoll_set;
-
 	epoll.so_number = epfd;
 	epoll.so_type = OFP_SOCK_EPOLL;
+	ofp_epoll_set_init(&epoll);
 
-	FOREACH(epoll_set, epoll.epoll_set)
-		epoll_set->fd = -1;
+	/* All test fds share the same socket */
+	memset(non_epoll.so_epoll_item, 0, sizeof(non_epoll.so_epoll_item));
+	non_epoll.so_epoll_count = 0;
 
 	return epoll.so_number;
 }
@@ -457,13 +526,8 @@ int is_epoll_socket(struct socket *socket)
 
 int is_epoll_set_initialized(struct socket *epoll)
 {
-	struct epoll_set *epoll_set;
-
-	FOREACH(epoll_set, epoll->epoll_set)
-		if (epoll_set->fd != -1)
-			return 0;
-
-	return 1;
+	return OFP_TAILQ_EMPTY(&epoll->so_epoll.items) &&
+		OFP_TAILQ_EMPTY(&epoll->so_epoll.ready);
 }
 
 struct socket *dummy_socket_getter(int fd)
@@ -472,6 +536,12 @@ struct socket *dummy_socket_getter(int fd)
 	return &non_epoll;
 }
 
+struct socket *epoll_socket_getter(int fd)
+{
+	(void)fd;
+	return &epoll;
+}
+
 struct socket *null_socket_getter(int fd)
 {
 	(void)fd;
@@ -510,10 +580,11 @@ int modify_fd(int fd, int events)
 
 void fill_epoll_set(void)
 {
-	struct epoll_set *epoll_set;
+	int i;
 
-	FOREACH(epoll_set, epoll.epoll_set)
-		epoll_set->fd = 1;
+	/* Registered in some other epoll instance */
+	for (i = 0; i < EPOLL_SOCKET_ITEMS; i++)
+		non_epoll.so_epoll_item[i].epoll = &non_epoll;
 }
 
 int fd_not_readable(int fd)
@@ -528,8 +599,9 @@ int fd_is_readable(int fd)
 	return 1;
 }
 
-static int sleeper_spy(int timeout)
+static int sleeper_spy(struct socket *epoll, int timeout)
 {
+	(void)epoll;
 	(void)timeout;
 	sleeper_called = 1;
 	return 0;
@@ -539,3 +611,10 @@ int epoll_wait_with_timeout(int maxevents, int timeout)
 {
 	return _ofp_epoll_wait(&epoll, events, maxevents, timeout, sleeper_spy);
 }
+
+int wakeup_spy(void *channel)
+{
+	(void)channel;
+	wakeup_called = 1;
+	return 0;
+}
@@ -35,6 +35,7 @@
 #include <ofpi_debug.h>
 
 #include "ofp_route_arp.h"
+#include "ofp_tcp.h"
 
 #include "fragmented_packet.h"
 
@@ -600,6 +601,78 @@ static void test_fragment_fragmented_to_two(void)
 	dev->if_mtu = def_mtu;
 }
 
+static void test_tcp_burst_to_segments(void)
+{
+	odp_packet_t pkt_orig, pkt_sent;
+	odp_event_t ev;
+	struct ofp_ip *ip, *ip_orig;
+	struct ofp_tcphdr *th, *th_orig;
+	uint16_t pl_pos, pl_len, orig_pl_len, hlen;
+	const uint16_t segsz = 1000;
+
+	if (create_odp_packet_ip4(&pkt_orig, pkt1_full, sizeof(pkt1_full), 0)) {
+		CU_FAIL("Fail to create packet");
+		return;
+	}
+
+	/* Turn the payload into a TCP burst */
+	ip = odp_packet_l3_ptr(pkt_orig, NULL);
+	ip->ip_p = OFP_IPPROTO_TCP;
+	th = (struct ofp_tcphdr *)((uint8_t *)ip + (ip->ip_hl << 2));
+	th->th_off = sizeof(struct ofp_tcphdr) >> 2;
+	th->th_seq = odp_cpu_to_be_32(1000);
+	th->th_flags = OFP_TH_ACK | OFP_TH_PUSH | OFP_TH_FIN;
+	memcpy(&orig_pkt_data[OFP_ETHER_HDR_LEN], ip,
+	       odp_be_to_cpu_16(ip->ip_len));
+
+	ofp_packet_user_area_reset(pkt_orig);
+	ofp_packet_user_area(pkt_orig)->tso_segsz = segsz;
+
+	send_packet_and_check(pkt_orig);
+
+	ip_orig = (struct ofp_ip *)(&orig_pkt_data[OFP_ETHER_HDR_LEN]);
+	th_orig = (struct ofp_tcphdr *)((uint8_t *)ip_orig +
+					(ip_orig->ip_hl << 2));
+	hlen = (ip_orig->ip_hl << 2) + sizeof(struct ofp_tcphdr);
+	orig_pl_len = odp_be_to_cpu_16(ip_orig->ip_len) - hlen;
+
+	for (pl_pos = 0; pl_pos < orig_pl_len; pl_pos += pl_len) {
+		pl_len = orig_pl_len - pl_pos > segsz ?
+			segsz : orig_pl_len - pl_pos;
+
+		ev = odp_queue_deq(dev->outq_def);
+		CU_ASSERT_NOT_EQUAL_FATAL(ev, ODP_EVENT_INVALID);
+
+		pkt_sent = odp_packet_from_event(ev);
+		CU_ASSERT_EQUAL_FATAL(odp_packet_len(pkt_sent),
+				      OFP_ETHER_HDR_LEN + hlen + pl_len);
+
+		ip = odp_packet_l3_ptr(pkt_sent, NULL);
+		CU_ASSERT_EQUAL(ip->ip_len, odp_cpu_to_be_16(hlen + pl_len));
+		CU_ASSERT_EQUAL(ip->ip_src.s_addr, ip_orig->ip_src.s_addr);
+		CU_ASSERT_EQUAL(ip->ip_dst.s_addr, ip_orig->ip_dst.s_addr);
+
+		th = (struct ofp_tcphdr *)((uint8_t *)ip + (ip->ip_hl << 2));
+		CU_ASSERT_EQUAL(odp_be_to_cpu_32(th->th_seq), 1000 + pl_pos);
+		CU_ASSERT_EQUAL(th->th_sport, th_orig->th_sport);
+		CU_ASSERT_EQUAL(th->th_dport, th_orig->th_dport);
+		if (pl_pos + pl_len < orig_pl_len)
+			CU_ASSERT_EQUAL(th->th_flags, OFP_TH_ACK)
+		else
+			CU_ASSERT_EQUAL(th->th_flags, th_orig->th_flags)
+
+		if (memcmp((uint8_t *)ip + hlen,
+			   (uint8_t *)ip_orig + hlen + pl_pos, pl_len))
+			CU_FAIL("corrupt segment payload");
+
+		odp_packet_free(pkt_sent);
+	}
+
+	/* no more segments */
+	ev = odp_queue_deq(dev->outq_def);
+	CU_ASSERT_EQUAL(ev, ODP_EVENT_INVALID);
+}
+
 /*
  * Main
  */
@@ -651,6 +724,12 @@ main(void)
 		return CU_get_error();
 	}
 
+	if (NULL == CU_ADD_TEST(ptr_suite,
+				test_tcp_burst_to_segments)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
 
 #if OFP_TESTMODE_AUTO
 	CU_set_output_filename("CUnit-fragmentation");
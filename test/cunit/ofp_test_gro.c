@@ -0,0 +1,327 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_init.h>
+#include <ofpi_portconf.h>
+#include <ofpi_pkt_processing.h>
+#include <ofpi_gro.h>
+#include <ofpi_ip.h>
+#include <ofpi_tcp.h>
+#include <ofpi_in.h>
+
+#define PAYLOAD	100
+#define OPTLEN	12
+#define HDRLEN	(sizeof(struct ofp_ip) + sizeof(struct ofp_tcphdr) + OPTLEN)
+#define SEQ	1000
+#define TSECR	77
+#define WIN	1024
+
+/* Options order */
+enum { TS_LAST, TS_FIRST };
+
+static uint32_t port = 0, vlan = 0, vrf = 0;
+static uint32_t dev_ip = 0x650AA8C0;   /* C0.A8.0A.65 = 192.168.10.101 */
+/* Off link, replies to the delivered segments are dropped */
+static uint32_t peer_ip = 0x0100000A;  /* 0A.00.00.01 = 10.0.0.1 */
+static struct ofp_ifnet *dev;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.tcp_gro_flows = 4;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	ofp_config_interface_up_v4(port, vlan, vrf, dev_ip, 24);
+	dev = ofp_get_ifnet(port, vlan);
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* A data segment of the flow, with NOP NOP TS options or TS NOP NOP */
+static odp_packet_t make_seg(uint32_t seq, uint8_t flags, uint16_t win,
+			     uint32_t tsval, int order, int bad_sum)
+{
+	odp_packet_t pkt = ofp_packet_alloc_from_pool(ofp_packet_pool,
+						       HDRLEN + PAYLOAD);
+	struct ofp_ip *ip;
+	struct ofp_tcphdr *th;
+	uint8_t *opt, *data;
+	uint32_t v;
+	int i;
+
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	odp_packet_l3_offset_set(pkt, 0);
+	odp_packet_l4_offset_set(pkt, sizeof(struct ofp_ip));
+	odp_packet_user_ptr_set(pkt, dev);
+
+	ip = odp_packet_data(pkt);
+	memset(ip, 0, HDRLEN);
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(struct ofp_ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(HDRLEN + PAYLOAD);
+	ip->ip_ttl = 64;
+	ip->ip_p = OFP_IPPROTO_TCP;
+	ip->ip_src.s_addr = peer_ip;
+	ip->ip_dst.s_addr = dev_ip;
+
+	th = (struct ofp_tcphdr *)(ip + 1);
+	th->th_sport = odp_cpu_to_be_16(40000);
+	th->th_dport = odp_cpu_to_be_16(80);
+	th->th_seq = odp_cpu_to_be_32(seq);
+	th->th_ack = odp_cpu_to_be_32(1);
+	th->th_off = (sizeof(*th) + OPTLEN) >> 2;
+	th->th_flags = flags;
+	th->th_win = odp_cpu_to_be_16(win);
+
+	opt = (uint8_t *)(th + 1);
+	if (order == TS_LAST)
+		opt += 2;
+	opt[0] = OFP_TCPOPT_TIMESTAMP;
+	opt[1] = OFP_TCPOLEN_TIMESTAMP;
+	v = odp_cpu_to_be_32(tsval);
+	memcpy(opt + 2, &v, sizeof(v));
+	v = odp_cpu_to_be_32(TSECR);
+	memcpy(opt + 6, &v, sizeof(v));
+	opt = (uint8_t *)(th + 1) + (order == TS_LAST ? 0 : 10);
+	opt[0] = opt[1] = OFP_TCPOPT_NOP;
+
+	data = (uint8_t *)ip + HDRLEN;
+	for (i = 0; i < PAYLOAD; i++)
+		data[i] = (uint8_t)(seq + i);
+
+	th->th_sum = ofp_in4_cksum(pkt);
+	if (bad_sum)
+		th->th_sum ^= 1;
+	return pkt;
+}
+
+static enum ofp_return_code input(odp_packet_t pkt)
+{
+	return ofp_gro_tcp4_input(pkt, odp_packet_l3_ptr(pkt, NULL));
+}
+
+static struct ofp_gro_flow *held(void)
+{
+	int i;
+
+	for (i = 0; i < ofp_gro.num_flows; i++)
+		if (ofp_gro.flow[i].pkt != ODP_PACKET_INVALID)
+			return &ofp_gro.flow[i];
+	return NULL;
+}
+
+static uint32_t held_seq(void)
+{
+	struct ofp_ip *ip = odp_packet_l3_ptr(held()->pkt, NULL);
+
+	return odp_be_to_cpu_32(((struct ofp_tcphdr *)(ip + 1))->th_seq);
+}
+
+static uint32_t held_len(void)
+{
+	struct ofp_ip *ip = odp_packet_l3_ptr(held()->pkt, NULL);
+
+	return odp_be_to_cpu_16(ip->ip_len);
+}
+
+/* Free the held packets instead of passing them to TCP input */
+static void drop_held(void)
+{
+	ofp_gro_term_local();
+	CU_ASSERT_EQUAL(ofp_gro_init_local(), 0);
+}
+
+static void test_gro_merge(void)
+{
+	struct ofp_ip *ip;
+	struct ofp_tcphdr *th;
+	uint8_t *data;
+	uint32_t v;
+	int i;
+
+	ofp_gro_burst_begin();
+
+	CU_ASSERT_EQUAL(input(make_seg(SEQ, OFP_TH_ACK, WIN, 10, TS_LAST, 0)),
+			OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(ofp_gro.num, 1);
+
+	/* Newer and equal timestamps are appended */
+	CU_ASSERT_EQUAL(input(make_seg(SEQ + PAYLOAD, OFP_TH_ACK, WIN, 11,
+				       TS_LAST, 0)), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(make_seg(SEQ + 2 * PAYLOAD, OFP_TH_ACK, WIN, 11,
+				       TS_LAST, 0)), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(ofp_gro.num, 1);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(held());
+	CU_ASSERT_EQUAL(held()->next_seq, SEQ + 3 * PAYLOAD);
+	CU_ASSERT_EQUAL(held_seq(), SEQ);
+	CU_ASSERT_EQUAL(held_len(), HDRLEN + 3 * PAYLOAD);
+	CU_ASSERT_EQUAL(odp_packet_len(held()->pkt), HDRLEN + 3 * PAYLOAD);
+	CU_ASSERT(ofp_packet_user_area(held()->pkt)->chksum_flags &
+		  OFP_L4_CHKSUM_VERIFIED);
+
+	/* The payload in order, the timestamps of the last segment */
+	ip = odp_packet_l3_ptr(held()->pkt, NULL);
+	data = (uint8_t *)ip + HDRLEN;
+	for (i = 0; i < 3 * PAYLOAD; i++)
+		if (data[i] != (uint8_t)(SEQ + i))
+			break;
+	CU_ASSERT_EQUAL(i, 3 * PAYLOAD);
+	th = (struct ofp_tcphdr *)(ip + 1);
+	memcpy(&v, (uint8_t *)(th + 1) + 4, sizeof(v));
+	CU_ASSERT_EQUAL(odp_be_to_cpu_32(v), 11);
+	memcpy(&v, (uint8_t *)(th + 1) + 8, sizeof(v));
+	CU_ASSERT_EQUAL(odp_be_to_cpu_32(v), TSECR);
+
+	drop_held();
+}
+
+static void test_gro_no_merge(void)
+{
+	odp_packet_t pkt;
+
+	ofp_gro_burst_begin();
+
+	CU_ASSERT_EQUAL(input(make_seg(SEQ, OFP_TH_ACK, WIN, 10, TS_LAST, 0)),
+			OFP_PKT_PROCESSED);
+
+	/*
+	 * Each segment that cannot be appended sends the held one to TCP
+	 * input and is held in its place.
+	 */
+
+	/* TSval going back */
+	CU_ASSERT_EQUAL(input(make_seg(SEQ + PAYLOAD, OFP_TH_ACK, WIN, 9,
+				       TS_LAST, 0)), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(ofp_gro.num, 1);
+	CU_ASSERT_EQUAL(held_seq(), SEQ + PAYLOAD);
+	CU_ASSERT_EQUAL(held_len(), HDRLEN + PAYLOAD);
+
+	/* Other options than the timestamps differ */
+	CU_ASSERT_EQUAL(input(make_seg(SEQ + 2 * PAYLOAD, OFP_TH_ACK, WIN, 12,
+				       TS_FIRST, 0)), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(held_seq(), SEQ + 2 * PAYLOAD);
+	CU_ASSERT_EQUAL(held_len(), HDRLEN + PAYLOAD);
+
+	/* Another window */
+	CU_ASSERT_EQUAL(input(make_seg(SEQ + 3 * PAYLOAD, OFP_TH_ACK, WIN + 1,
+				       12, TS_FIRST, 0)), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(held_seq(), SEQ + 3 * PAYLOAD);
+	CU_ASSERT_EQUAL(held_len(), HDRLEN + PAYLOAD);
+
+	/* A sequence gap */
+	CU_ASSERT_EQUAL(input(make_seg(SEQ + 5 * PAYLOAD, OFP_TH_ACK, WIN + 1,
+				       12, TS_FIRST, 0)), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(held_seq(), SEQ + 5 * PAYLOAD);
+	CU_ASSERT_EQUAL(held_len(), HDRLEN + PAYLOAD);
+	CU_ASSERT_EQUAL(ofp_gro.num, 1);
+
+	/* A bad checksum, or other flags, go to TCP input right away */
+	pkt = make_seg(SEQ + 6 * PAYLOAD, OFP_TH_ACK, WIN + 1, 12, TS_FIRST, 1);
+	CU_ASSERT_EQUAL(input(pkt), OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(ofp_gro.num, 0);
+	CU_ASSERT_FALSE(ofp_packet_user_area(pkt)->chksum_flags &
+			OFP_L4_CHKSUM_VERIFIED);
+	odp_packet_free(pkt);
+
+	pkt = make_seg(SEQ + 6 * PAYLOAD, OFP_TH_ACK | OFP_TH_URG, WIN + 1, 12,
+		       TS_FIRST, 0);
+	CU_ASSERT_EQUAL(input(pkt), OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(ofp_gro.num, 0);
+	odp_packet_free(pkt);
+
+	drop_held();
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp tcp gro", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_gro_merge)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_gro_no_merge)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-gro");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -151,6 +151,86 @@ test_ofp_cksum_buffer__ip4_addr(void)
 	CU_ASSERT_EQUAL(res, 0xF234);
 }
 
+static void
+test_ofp_cksum_buffer_kernels(void)
+{
+#define KBUFSIZE 2048
+	uint8_t *buf = malloc(KBUFSIZE + 4);
+	int i, off, len;
+
+	for (i = 0; i < KBUFSIZE + 4; i++)
+		buf[i] = i * 7 + (i >> 8);
+
+	/* Vector kernel, when present, agrees with the scalar loop */
+	ofp_cksum_init_global();
+	for (off = 0; off < 4; off++)
+		for (len = 0; len <= KBUFSIZE; len++)
+			CU_ASSERT_EQUAL(ofp_cksum_buffer(buf + off, len),
+					(uint16_t)~ofp_cksum_fold(
+					cksum_sum_scalar(buf + off, len)));
+
+	free(buf);
+}
+
+struct ip_tcp {
+	struct ofp_ip ip;
+	struct ofp_tcphdr th;
+};
+
+/* Checksum over the pseudo header and the TCP header */
+static uint16_t tcp_cksum(struct ip_tcp *p)
+{
+	uint8_t buf[sizeof(struct ofp_ippseudo) + sizeof(p->th)];
+	struct ofp_ippseudo ph;
+
+	ph.ippseudo_src = p->ip.ip_src;
+	ph.ippseudo_dst = p->ip.ip_dst;
+	ph.ippseudo_pad = 0;
+	ph.ippseudo_p = p->ip.ip_p;
+	ph.ippseudo_len = odp_cpu_to_be_16(sizeof(p->th));
+	memcpy(buf, &ph, sizeof(ph));
+	memcpy(buf + sizeof(ph), &p->th, sizeof(p->th));
+
+	return ofp_cksum_buffer(buf, sizeof(buf));
+}
+
+static void
+test_ofp_cksum_adjust(void)
+{
+	struct ip_tcp p;
+
+	memset(&p, 0, sizeof(p));
+	p.ip.ip_v = OFP_IPVERSION;
+	p.ip.ip_hl = 5;
+	p.ip.ip_len = odp_cpu_to_be_16(sizeof(p));
+	p.ip.ip_ttl = 255;
+	p.ip.ip_p = OFP_IPPROTO_TCP;
+	p.ip.ip_src.s_addr = odp_cpu_to_be_32(0x0a000001);
+	p.ip.ip_dst.s_addr = odp_cpu_to_be_32(0x0a000002);
+	p.ip.ip_sum = ofp_cksum_iph(&p.ip, 5);
+	p.th.th_sport = odp_cpu_to_be_16(1234);
+	p.th.th_dport = odp_cpu_to_be_16(80);
+	p.th.th_seq = odp_cpu_to_be_32(0x12345678);
+	p.th.th_sum = tcp_cksum(&p);
+
+	ofp_ip_rewrite_src(&p.ip, odp_cpu_to_be_32(0xc0a80001));
+	ofp_ip_rewrite_dst(&p.ip, odp_cpu_to_be_32(0xfffefdfc));
+	ofp_ip_rewrite_port(&p.ip, &p.th.th_dport, odp_cpu_to_be_16(8080));
+
+	CU_ASSERT_EQUAL(ofp_cksum_iph(&p.ip, 5), 0);
+	CU_ASSERT_EQUAL(tcp_cksum(&p), 0);
+
+	/* TTL decrement as done when forwarding */
+	while (p.ip.ip_ttl > 1) {
+		uint16_t ttl_p = odp_cpu_to_be_16(p.ip.ip_ttl << 8 | p.ip.ip_p);
+
+		p.ip.ip_ttl--;
+		p.ip.ip_sum = ofp_cksum_adjust16(p.ip.ip_sum, ttl_p,
+						 ttl_p - odp_cpu_to_be_16(1 << 8));
+		CU_ASSERT_EQUAL(ofp_cksum_iph(&p.ip, 5), 0);
+	}
+}
+
 static void
 test_ofp_cksum_buffer_odd_len_icmp(void)
 {
@@ -276,11 +356,20 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite,
+				test_ofp_cksum_buffer_kernels)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 	if (NULL == CU_ADD_TEST(ptr_suite,
 				test_ofp_cksum_buffer_odd_len_icmp)) {
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ofp_cksum_adjust)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 	if (NULL == CU_ADD_TEST(ptr_suite, test_ofp_cksum)) {
 		CU_cleanup_registry();
 		return CU_get_error();
@@ -0,0 +1,483 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include "../../src/ofp_in_pcb.c"
+#include <ofpi.h>
+#include <ofpi_tcp_fsm.h>
+#include <api/ofp_socket.h>
+
+#define NUM_INP		48
+#define NUM_BUCKETS	8
+#define LPORT		80
+#define FPORT		40000
+
+/* Host byte order */
+#define V4(a, b, c, d) \
+	odp_cpu_to_be_32((a) << 24 | (b) << 16 | (c) << 8 | (d))
+
+static uint32_t laddr;
+
+/* An index of its own, the inpcbs are only keys */
+static struct inpcbinfo info;
+static struct inpcb_idx_bucket buckets[NUM_BUCKETS];
+static struct inpcb inps[NUM_INP];
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	laddr = V4(192, 168, 10, 101);
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* An empty index of num buckets */
+static void idx_setup(uint32_t num)
+{
+	memset(&info, 0, sizeof(info));
+	memset(buckets, 0, sizeof(buckets));
+	memset(inps, 0, sizeof(inps));
+	info.ipi_idx = buckets;
+	info.ipi_idxmask = num - 1;
+}
+
+/* Connection n from a peer of its own */
+static struct inpcb *v4_conn(int n)
+{
+	struct inpcb *inp = &inps[n];
+
+	inp->inp_hashinfo = &info;
+	inp->inp_vflag = INP_IPV4;
+	inp->inp_faddr.s_addr = V4(10, 0, n >> 8, n & 0xff);
+	inp->inp_fport = odp_cpu_to_be_16(FPORT);
+	inp->inp_laddr.s_addr = laddr;
+	inp->inp_lport = odp_cpu_to_be_16(LPORT);
+	return inp;
+}
+
+static struct inpcb *v4_listen(int n, uint32_t addr, uint16_t port)
+{
+	struct inpcb *inp = &inps[n];
+
+	inp->inp_hashinfo = &info;
+	inp->inp_vflag = INP_IPV4;
+	inp->inp_laddr.s_addr = addr;
+	inp->inp_lport = odp_cpu_to_be_16(port);
+	return inp;
+}
+
+static struct inpcb *demux(int v6, const void *faddr, const void *dst,
+			   uint16_t port, int flags, int *decided)
+{
+	const uint16_t fport = odp_cpu_to_be_16(FPORT);
+	struct inpcb *inp = NULL;
+
+	*decided = ofp_in_pcbidx_demux(&info, v6, faddr, fport, dst,
+				       odp_cpu_to_be_16(port), flags, &inp);
+	return inp;
+}
+
+/* Index of inpcb n, NULL if the hash lists decide */
+static struct inpcb *find_conn(int n)
+{
+	struct ofp_in_addr faddr;
+	struct inpcb *inp;
+	int decided;
+
+	faddr.s_addr = V4(10, 0, n >> 8, n & 0xff);
+	inp = demux(0, &faddr, &laddr, LPORT, 0, &decided);
+	return decided ? inp : NULL;
+}
+
+/*
+ * Every inpcb of the first num either has a slot holding it, with its
+ * signature, or is counted as a miss. Returns the number in slots.
+ */
+static int check_idx(int num)
+{
+	struct inpcb *inp;
+	uint32_t slot, sig;
+	int n, in_slot = 0, missed = 0;
+
+	for (n = 0; n < num; n++) {
+		inp = &inps[n];
+		slot = inp->inp_idx_slot;
+		if (slot == 0) {
+			CU_ASSERT_EQUAL(inp->inp_idx_miss, 1);
+			missed++;
+			continue;
+		}
+		slot--;
+		sig = in_pcbidx_sig(0, &inp->inp_faddr, &inp->inp_laddr,
+				    inp->inp_fport, inp->inp_lport);
+		CU_ASSERT_PTR_EQUAL(buckets[slot / INP_IDX_WAYS].inp[slot %
+					INP_IDX_WAYS], inp);
+		CU_ASSERT_EQUAL(buckets[slot / INP_IDX_WAYS].sig[slot %
+					INP_IDX_WAYS], sig);
+		CU_ASSERT_PTR_EQUAL(in_pcbidx_lookup(&info, 0,
+						     &inp->inp_faddr,
+						     inp->inp_fport,
+						     &inp->inp_laddr,
+						     inp->inp_lport), inp);
+		in_slot++;
+	}
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, (uint32_t)missed);
+	CU_ASSERT_EQUAL(info.ipi_idx_wild_miss, 0);
+	return in_slot;
+}
+
+static void test_idx_full(void)
+{
+	const int ways = 2 * INP_IDX_WAYS;
+	int n, missed = -1;
+
+	/* Two buckets, each inpcb can use either one */
+	idx_setup(2);
+	for (n = 0; n < ways; n++) {
+		in_pcbidx_add(v4_conn(n));
+		CU_ASSERT_NOT_EQUAL(inps[n].inp_idx_slot, 0);
+	}
+	CU_ASSERT_EQUAL(check_idx(ways), ways);
+	CU_ASSERT_PTR_EQUAL(find_conn(3), &inps[3]);
+
+	/* One more runs out of kicks, one inpcb is left to the lists */
+	in_pcbidx_add(v4_conn(ways));
+	CU_ASSERT_EQUAL(check_idx(ways + 1), ways);
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, 1);
+	CU_ASSERT_PTR_NULL(find_conn(3));
+	for (n = 0; n <= ways; n++)
+		if (inps[n].inp_idx_slot == 0)
+			missed = n;
+	CU_ASSERT_FATAL(missed >= 0);
+
+	/* Deleting the miss gives the lookups back to the index */
+	in_pcbidx_del(&inps[missed]);
+	CU_ASSERT_EQUAL(inps[missed].inp_idx_miss, 0);
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, 0);
+	n = missed ? 0 : 1;
+	CU_ASSERT_PTR_EQUAL(find_conn(n), &inps[n]);
+	CU_ASSERT_PTR_NULL(find_conn(missed));
+
+	/* Deleting one in a slot makes room */
+	in_pcbidx_del(&inps[n]);
+	CU_ASSERT_EQUAL(inps[n].inp_idx_slot, 0);
+	CU_ASSERT_PTR_NULL(find_conn(n));
+	in_pcbidx_add(&inps[missed]);
+	CU_ASSERT_NOT_EQUAL(inps[missed].inp_idx_slot, 0);
+	CU_ASSERT_PTR_EQUAL(find_conn(missed), &inps[missed]);
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, 0);
+
+	/* A key already in the index is a miss too */
+	inps[ways + 1] = inps[missed];
+	inps[ways + 1].inp_idx_slot = 0;
+	in_pcbidx_add(&inps[ways + 1]);
+	CU_ASSERT_EQUAL(inps[ways + 1].inp_idx_slot, 0);
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, 1);
+	CU_ASSERT_PTR_NULL(find_conn(missed));
+	in_pcbidx_del(&inps[ways + 1]);
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, 0);
+	CU_ASSERT_PTR_EQUAL(find_conn(missed), &inps[missed]);
+}
+
+static void test_idx_displace(void)
+{
+	uint32_t slot[NUM_INP];
+	int n, i, moved = 0, in_slot;
+
+	/* Fill past the capacity, residents move to their other bucket */
+	idx_setup(NUM_BUCKETS);
+	for (n = 0; n < NUM_INP; n++) {
+		for (i = 0; i < n; i++)
+			slot[i] = inps[i].inp_idx_slot;
+		in_pcbidx_add(v4_conn(n));
+		for (i = 0; i < n; i++)
+			if (slot[i] && inps[i].inp_idx_slot != slot[i])
+				moved++;
+	}
+	CU_ASSERT(moved > 0);
+	in_slot = check_idx(NUM_INP);
+	CU_ASSERT(in_slot <= NUM_BUCKETS * INP_IDX_WAYS);
+	CU_ASSERT(in_slot >= NUM_BUCKETS * INP_IDX_WAYS / 2);
+
+	/* Emptied again, all slots are free */
+	for (n = 0; n < NUM_INP; n++)
+		in_pcbidx_del(&inps[n]);
+	CU_ASSERT_EQUAL(info.ipi_idx_exact_miss, 0);
+	for (n = 0; n < NUM_BUCKETS; n++)
+		for (i = 0; i < INP_IDX_WAYS; i++) {
+			CU_ASSERT_PTR_NULL(buckets[n].inp[i]);
+			CU_ASSERT_EQUAL(buckets[n].sig[i], 0);
+		}
+}
+
+static void test_idx_wildcard(void)
+{
+	const uint32_t other = V4(192, 168, 10, 102);
+	struct inpcb *conn, *any, *bound, *dup;
+	struct ofp_in_addr peer, peer2;
+	int decided;
+
+	idx_setup(NUM_BUCKETS);
+	conn = v4_conn(0);
+	any = v4_listen(1, 0, LPORT);
+	bound = v4_listen(2, laddr, LPORT);
+	in_pcbidx_add(conn);
+	in_pcbidx_add(any);
+	in_pcbidx_add(bound);
+	peer = conn->inp_faddr;
+	peer2.s_addr = V4(10, 1, 0, 1);
+
+	/* Exact before local address before wildcard */
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer, &laddr, LPORT, INPLOOKUP_WILDCARD,
+				  &decided), conn);
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer2, &laddr, LPORT, INPLOOKUP_WILDCARD,
+				  &decided), bound);
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer2, &other, LPORT, INPLOOKUP_WILDCARD,
+				  &decided), any);
+	CU_ASSERT(decided);
+	CU_ASSERT_PTR_NULL(demux(0, &peer2, &laddr, LPORT, 0, &decided));
+	CU_ASSERT(decided);
+	CU_ASSERT_PTR_NULL(demux(0, &peer2, &laddr, LPORT + 1,
+				 INPLOOKUP_WILDCARD, &decided));
+	CU_ASSERT(decided);
+
+	/* A second listener of a key leaves wildcard lookups to the lists */
+	dup = v4_listen(3, 0, LPORT);
+	in_pcbidx_add(dup);
+	CU_ASSERT_EQUAL(dup->inp_idx_miss, 2);
+	CU_ASSERT_EQUAL(info.ipi_idx_wild_miss, 1);
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer, &laddr, LPORT, INPLOOKUP_WILDCARD,
+				  &decided), conn);
+	CU_ASSERT(decided);
+	(void)demux(0, &peer2, &other, LPORT, INPLOOKUP_WILDCARD, &decided);
+	CU_ASSERT(!decided);
+	in_pcbidx_del(dup);
+	CU_ASSERT_EQUAL(info.ipi_idx_wild_miss, 0);
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer2, &other, LPORT, INPLOOKUP_WILDCARD,
+				  &decided), any);
+	CU_ASSERT(decided);
+}
+
+#ifdef INET6
+static void test_idx_v4_v6(void)
+{
+	static const uint8_t a6[16] = { 0x20, 0x01, 0x0d, 0xb8, [15] = 1 };
+	static const uint8_t b6[16] = { 0x20, 0x01, 0x0d, 0xb8, [15] = 2 };
+	struct inpcb *v4, *dual, *v6only;
+	struct ofp_in_addr peer;
+	int decided;
+
+	idx_setup(NUM_BUCKETS);
+	peer.s_addr = V4(10, 1, 0, 1);
+
+	/* IPv4 only, IPv6 taking IPv4 and IPv6 only, all unbound */
+	v4 = v4_listen(0, 0, LPORT);
+	dual = v4_listen(1, 0, LPORT + 1);
+	dual->inp_vflag = INP_IPV4 | INP_IPV6;
+	v6only = v4_listen(2, 0, LPORT + 2);
+	v6only->inp_vflag = INP_IPV6;
+	in_pcbidx_add(v4);
+	in_pcbidx_add(dual);
+	in_pcbidx_add(v6only);
+	CU_ASSERT_EQUAL(info.ipi_idx_wild_miss, 0);
+
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer, &laddr, LPORT, INPLOOKUP_WILDCARD,
+				  &decided), v4);
+	CU_ASSERT_PTR_NULL(demux(1, a6, b6, LPORT, INPLOOKUP_WILDCARD,
+				 &decided));
+	CU_ASSERT(decided);
+
+	CU_ASSERT_PTR_EQUAL(demux(0, &peer, &laddr, LPORT + 1,
+				  INPLOOKUP_WILDCARD, &decided), dual);
+	CU_ASSERT_PTR_EQUAL(demux(1, a6, b6, LPORT + 1, INPLOOKUP_WILDCARD,
+				  &decided), dual);
+
+	CU_ASSERT_PTR_NULL(demux(0, &peer, &laddr, LPORT + 2,
+				 INPLOOKUP_WILDCARD, &decided));
+	CU_ASSERT(decided);
+	CU_ASSERT_PTR_EQUAL(demux(1, a6, b6, LPORT + 2, INPLOOKUP_WILDCARD,
+				  &decided), v6only);
+
+	/* The same addresses and ports of the two families do not match */
+	memcpy(&v6only->in6p_faddr, a6, 16);
+	memcpy(&v6only->in6p_laddr, b6, 16);
+	v6only->inp_fport = odp_cpu_to_be_16(FPORT);
+	in_pcbidx_del(v6only);
+	in_pcbidx_add(v6only);
+	CU_ASSERT_PTR_EQUAL(demux(1, a6, b6, LPORT + 2, 0, &decided), v6only);
+	CU_ASSERT_PTR_NULL(demux(0, a6, b6, LPORT + 2, 0, &decided));
+	CU_ASSERT(decided);
+}
+#endif /* INET6 */
+
+static void test_idx_rehash(void)
+{
+	struct ofp_sockaddr_in sin;
+	struct inpcbinfo *pcbinfo;
+	struct ofp_in_addr peer;
+	struct inpcb *inp, *found;
+	int fd;
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(fd >= 0);
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_len = sizeof(sin);
+	sin.sin_family = OFP_AF_INET;
+	sin.sin_port = odp_cpu_to_be_16(LPORT);
+	CU_ASSERT_EQUAL_FATAL(ofp_bind(fd, (struct ofp_sockaddr *)&sin,
+				       sizeof(sin)), 0);
+	inp = sotoinpcb(ofp_get_sock_by_fd(fd));
+	pcbinfo = inp->inp_hashinfo;
+	peer.s_addr = V4(10, 1, 0, 1);
+
+	/* Listening, the index has the wildcard key */
+	CU_ASSERT_NOT_EQUAL(inp->inp_idx_slot, 0);
+	INP_HASH_RLOCK(pcbinfo);
+	CU_ASSERT_EQUAL(ofp_in_pcbidx_demux(pcbinfo, 0, &peer,
+					    odp_cpu_to_be_16(FPORT), &laddr,
+					    odp_cpu_to_be_16(LPORT),
+					    INPLOOKUP_WILDCARD, &found), 1);
+	INP_HASH_RUNLOCK(pcbinfo);
+	CU_ASSERT_PTR_EQUAL(found, inp);
+
+	/* Connected, the key moves to the 4-tuple */
+	INP_INFO_WLOCK(&V_tcbinfo);
+	INP_WLOCK(inp);
+	INP_HASH_WLOCK(pcbinfo);
+	inp->inp_laddr.s_addr = laddr;
+	inp->inp_faddr = peer;
+	inp->inp_fport = odp_cpu_to_be_16(FPORT);
+	ofp_in_pcbrehash(inp);
+	INP_HASH_WUNLOCK(pcbinfo);
+	INP_WUNLOCK(inp);
+	INP_INFO_WUNLOCK(&V_tcbinfo);
+	CU_ASSERT_NOT_EQUAL(inp->inp_idx_slot, 0);
+	CU_ASSERT_EQUAL(inp->inp_idx_miss, 0);
+
+	INP_HASH_RLOCK(pcbinfo);
+	CU_ASSERT_EQUAL(ofp_in_pcbidx_demux(pcbinfo, 0, &peer,
+					    odp_cpu_to_be_16(FPORT), &laddr,
+					    odp_cpu_to_be_16(LPORT), 0,
+					    &found), 1);
+	CU_ASSERT_PTR_EQUAL(found, inp);
+	peer.s_addr = V4(10, 1, 0, 2);
+	CU_ASSERT_EQUAL(ofp_in_pcbidx_demux(pcbinfo, 0, &peer,
+					    odp_cpu_to_be_16(FPORT), &laddr,
+					    odp_cpu_to_be_16(LPORT),
+					    INPLOOKUP_WILDCARD, &found), 1);
+	CU_ASSERT_PTR_NULL(found);
+	INP_HASH_RUNLOCK(pcbinfo);
+
+	/* Nothing to send on close, the peer is not reachable */
+	sototcpcb(inp->inp_socket)->t_state = TCPS_CLOSED;
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp inpcb index", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_idx_full)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_idx_displace)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_idx_wildcard)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#ifdef INET6
+	if (NULL == CU_ADD_TEST(ptr_suite, test_idx_v4_v6)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+#endif
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_idx_rehash)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-in-pcbidx");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
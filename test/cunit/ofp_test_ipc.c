@@ -0,0 +1,211 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include "../../src/ofp_ipc.c"
+
+/*
+ * Operations are run with ipc_exec() on the slot of a client that is
+ * not attached, so that the server thread leaves them alone.
+ */
+static struct ipc_op *op;
+
+/*
+ * INIT
+ */
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.ipc.clients = 1;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	op = &shm->client[0].op[0];
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+static void
+op_init(uint32_t code, int fd)
+{
+	memset(op, 0, sizeof(*op));
+	op->code = code;
+	op->fd = fd;
+}
+
+static int
+ipc_udp_socket(void)
+{
+	op_init(IPC_SOCKET, -1);
+	op->arg[0] = OFP_AF_INET;
+	op->arg[1] = OFP_SOCK_DGRAM;
+	op->arg[2] = OFP_IPPROTO_UDP;
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_FATAL(op->ret >= 0);
+	return op->ret;
+}
+
+/*
+ * Testcases
+ */
+static void
+test_ipc_socket_owner(void)
+{
+	int fd = ipc_udp_socket();
+
+	/* Sockets of the stack and of other clients are not reachable */
+	op_init(IPC_SHUTDOWN, fd);
+	CU_ASSERT_EQUAL(ipc_exec(1, op), 1);
+	CU_ASSERT_EQUAL(op->ret, -1);
+	CU_ASSERT_EQUAL(op->err, OFP_EBADF);
+
+	op_init(IPC_CLOSE, OFP_SOCK_NUM_OFFSET + shm->socket_max + 1);
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->err, OFP_EBADF);
+
+	op_init(IPC_CLOSE, OFP_SOCK_NUM_OFFSET - 1);
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->err, OFP_EBADF);
+
+	op_init(IPC_CLOSE, fd);
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->ret, 0);
+	CU_ASSERT_FALSE(ipc_owned(0, fd));
+}
+
+static void
+test_ipc_lengths(void)
+{
+	int fd = ipc_udp_socket();
+
+	op_init(IPC_SENDTO, fd);
+	op->len = OFP_IPC_DATA_MAX + 1;
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->ret, -1);
+	CU_ASSERT_EQUAL(op->err, OFP_EINVAL);
+
+	op_init(IPC_RECVFROM, fd);
+	op->len = UINT32_MAX;
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->err, OFP_EINVAL);
+
+	op_init(IPC_BIND, fd);
+	op->addrlen = sizeof(op->addr) + 1;
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->err, OFP_EINVAL);
+
+	/* In range, nothing to receive */
+	op_init(IPC_RECVFROM, fd);
+	op->len = OFP_IPC_DATA_MAX;
+	op->arg[0] = OFP_MSG_DONTWAIT;
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->ret, -1);
+	CU_ASSERT_EQUAL(op->err, OFP_EWOULDBLOCK);
+	CU_ASSERT_EQUAL(op->addrlen, 0);
+
+	op_init(IPC_CLOSE, fd);
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->ret, 0);
+}
+
+static void
+test_ipc_detach(void)
+{
+	int fd = ipc_udp_socket();
+
+	op_init(IPC_DETACH, -1);
+	CU_ASSERT_EQUAL(ipc_exec(0, op), 1);
+	CU_ASSERT_EQUAL(op->ret, 0);
+	CU_ASSERT_FALSE(ipc_owned(0, fd));
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp ipc", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ipc_socket_owner)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ipc_lengths)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ipc_detach)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-IPC");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
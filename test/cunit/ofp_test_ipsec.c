@@ -0,0 +1,414 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_util.h>
+#include <ofpi_in.h>
+#include <ofpi_ip.h>
+#include <ofpi_pkt_processing.h>
+#include <ofpi_ipsec_spd.h>
+#include <ofpi_ipsec_sad.h>
+#include <api/ofp_ipsec.h>
+
+/* Host byte order */
+#define ADDR(a, b, c, d) ((a) << 24 | (b) << 16 | (c) << 8 | (d))
+#define ANY_FIRST	0
+#define ANY_LAST	0xffffffff
+
+#define SPI		0x100
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.ipsec.inbound_op_mode = ODP_IPSEC_OP_MODE_SYNC;
+	params.ipsec.outbound_op_mode = ODP_IPSEC_OP_MODE_SYNC;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* Addresses in host byte order */
+static void sp_param(ofp_ipsec_sp_param_t *param, uint32_t id,
+		     ofp_ipsec_dir_t dir, uint32_t priority,
+		     ofp_ipsec_action_t action,
+		     uint32_t src_first, uint32_t src_last,
+		     uint32_t dst_first, uint32_t dst_last)
+{
+	ofp_ipsec_sp_param_init(param);
+	param->id = id;
+	param->dir = dir;
+	param->priority = priority;
+	param->action = action;
+	param->selectors.type = OFP_IPSEC_SELECTOR_IPV4;
+	param->selectors.src_ipv4_range.first_addr.s_addr =
+		odp_cpu_to_be_32(src_first);
+	param->selectors.src_ipv4_range.last_addr.s_addr =
+		odp_cpu_to_be_32(src_last);
+	param->selectors.dst_ipv4_range.first_addr.s_addr =
+		odp_cpu_to_be_32(dst_first);
+	param->selectors.dst_ipv4_range.last_addr.s_addr =
+		odp_cpu_to_be_32(dst_last);
+}
+
+static ofp_ipsec_sp_handle sp_add(const ofp_ipsec_sp_param_t *param)
+{
+	ofp_ipsec_sp_handle sp = ofp_ipsec_sp_create(param);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(sp);
+	return sp;
+}
+
+static ofp_ipsec_sp_handle sp_create(uint32_t id, ofp_ipsec_dir_t dir,
+				     uint32_t priority,
+				     ofp_ipsec_action_t action,
+				     uint32_t src_first, uint32_t src_last,
+				     uint32_t dst_first, uint32_t dst_last)
+{
+	ofp_ipsec_sp_param_t param;
+
+	sp_param(&param, id, dir, priority, action,
+		 src_first, src_last, dst_first, dst_last);
+	return sp_add(&param);
+}
+
+static void sp_destroy(ofp_ipsec_sp_handle sp)
+{
+	CU_ASSERT_EQUAL(ofp_ipsec_sp_destroy(sp), 0);
+	ofp_ipsec_sp_unref(sp);
+}
+
+/* Action of the outbound SPD for a packet from src to dst */
+static ofp_ipsec_action_t lookup(uint16_t vrf, uint32_t src, uint32_t dst,
+				 uint8_t proto, ofp_ipsec_sa_handle *sa)
+{
+	odp_packet_t pkt = ofp_packet_alloc(sizeof(struct ofp_ip));
+	ofp_ipsec_sa_handle sa_dummy;
+	ofp_ipsec_action_t action;
+	struct ofp_ip *ip;
+
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	odp_packet_l3_offset_set(pkt, 0);
+	ip = odp_packet_data(pkt);
+	memset(ip, 0, sizeof(*ip));
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(*ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(sizeof(*ip));
+	ip->ip_p = proto;
+	ip->ip_src.s_addr = odp_cpu_to_be_32(src);
+	ip->ip_dst.s_addr = odp_cpu_to_be_32(dst);
+
+	action = ofp_ipsec_sp_out_lookup(vrf, pkt, sa ? sa : &sa_dummy);
+	/* The inbound SPD is separate */
+	CU_ASSERT_EQUAL(ofp_ipsec_sp_in_lookup(vrf, pkt),
+			OFP_IPSEC_ACTION_BYPASS);
+	odp_packet_free(pkt);
+	return action;
+}
+
+#define OUT(src, dst) lookup(0, src, dst, OFP_IPPROTO_UDP, NULL)
+
+static void test_sp_precedence(void)
+{
+	const uint32_t peer = ADDR(192, 168, 1, 1);
+	ofp_ipsec_sp_param_t param;
+	ofp_ipsec_sp_handle a, b, c, d, e;
+
+	a = sp_create(1, OFP_IPSEC_DIR_OUTBOUND, 10, OFP_IPSEC_ACTION_PROTECT,
+		      ADDR(10, 0, 0, 0), ADDR(10, 255, 255, 255),
+		      ANY_FIRST, ANY_LAST);
+	b = sp_create(2, OFP_IPSEC_DIR_OUTBOUND, 5, OFP_IPSEC_ACTION_DISCARD,
+		      ADDR(10, 1, 0, 0), ADDR(10, 1, 255, 255),
+		      ADDR(192, 168, 0, 0), ADDR(192, 168, 255, 255));
+
+	/* The lowest priority value wins, not the longest prefix */
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_DISCARD);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 2, 0, 1), peer), OFP_IPSEC_ACTION_PROTECT);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), ADDR(172, 16, 0, 1)),
+			OFP_IPSEC_ACTION_PROTECT);
+	CU_ASSERT_EQUAL(OUT(ADDR(11, 0, 0, 1), peer), OFP_IPSEC_ACTION_BYPASS);
+	CU_ASSERT_EQUAL(lookup(1, ADDR(10, 1, 2, 3), peer, OFP_IPPROTO_UDP,
+			       NULL), OFP_IPSEC_ACTION_BYPASS);
+
+	/* Of equal priorities the SP added last wins, in a tuple */
+	c = sp_create(3, OFP_IPSEC_DIR_OUTBOUND, 5, OFP_IPSEC_ACTION_PROTECT,
+		      ADDR(10, 1, 0, 0), ADDR(10, 1, 255, 255),
+		      ADDR(192, 168, 0, 0), ADDR(192, 168, 255, 255));
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_PROTECT);
+
+	/* And between the range list and the tuples */
+	d = sp_create(4, OFP_IPSEC_DIR_OUTBOUND, 5, OFP_IPSEC_ACTION_DISCARD,
+		      ADDR(10, 1, 2, 1), ADDR(10, 1, 2, 5),
+		      ANY_FIRST, ANY_LAST);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_DISCARD);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 7), peer), OFP_IPSEC_ACTION_PROTECT);
+
+	/* A protocol selector only matches its protocol */
+	sp_param(&param, 5, OFP_IPSEC_DIR_OUTBOUND, 1, OFP_IPSEC_ACTION_PROTECT,
+		 ADDR(10, 1, 2, 3), ADDR(10, 1, 2, 3), ANY_FIRST, ANY_LAST);
+	param.selectors.ip_proto = OFP_IPPROTO_TCP;
+	e = sp_add(&param);
+	CU_ASSERT_EQUAL(lookup(0, ADDR(10, 1, 2, 3), peer, OFP_IPPROTO_TCP,
+			       NULL), OFP_IPSEC_ACTION_PROTECT);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_DISCARD);
+
+	/* Removal uncovers the SPs below */
+	sp_destroy(e);
+	sp_destroy(d);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_PROTECT);
+	sp_destroy(c);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_DISCARD);
+	sp_destroy(b);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_PROTECT);
+	sp_destroy(a);
+	CU_ASSERT_EQUAL(OUT(ADDR(10, 1, 2, 3), peer), OFP_IPSEC_ACTION_BYPASS);
+}
+
+static void test_sp_release(void)
+{
+	ofp_ipsec_sp_handle a, b, c, ref;
+	ofp_ipsec_sp_info_t info;
+
+	/* A destroyed SP stays allocated while referenced */
+	a = sp_create(1, OFP_IPSEC_DIR_INBOUND, 1, OFP_IPSEC_ACTION_DISCARD,
+		      ANY_FIRST, ANY_LAST, ANY_FIRST, ANY_LAST);
+	ref = ofp_ipsec_sp_find_by_id(1);
+	CU_ASSERT_PTR_EQUAL(ref, a);
+	sp_destroy(a);
+	CU_ASSERT_PTR_NULL(ofp_ipsec_sp_find_by_id(1));
+	ofp_ipsec_sp_get_info(ref, &info);
+	CU_ASSERT_EQUAL(info.status, OFP_IPSEC_SP_DESTROYED);
+
+	b = sp_create(1, OFP_IPSEC_DIR_INBOUND, 1, OFP_IPSEC_ACTION_DISCARD,
+		      ANY_FIRST, ANY_LAST, ANY_FIRST, ANY_LAST);
+	CU_ASSERT_PTR_NOT_EQUAL(b, a);
+
+	/* And is reused once the last reference is gone */
+	ofp_ipsec_sp_unref(ref);
+	c = sp_create(2, OFP_IPSEC_DIR_INBOUND, 1, OFP_IPSEC_ACTION_DISCARD,
+		      ANY_FIRST, ANY_LAST, ANY_FIRST, ANY_LAST);
+	CU_ASSERT_PTR_EQUAL(c, a);
+
+	sp_destroy(c);
+	sp_destroy(b);
+}
+
+/* ODP can create the NULL cipher SAs of the test */
+static int sa_supported(void)
+{
+#ifdef SP
+	return 0;
+#else
+	odp_ipsec_capability_t capa;
+
+	if (odp_ipsec_capability(&capa) || !capa.op_mode_sync ||
+	    capa.max_num_sa < 4 ||
+	    !capa.ciphers.bit.null || !capa.auths.bit.null) {
+		OFP_INFO("ODP IPsec SAs not supported, test skipped");
+		return 0;
+	}
+	return 1;
+#endif
+}
+
+static ofp_ipsec_sa_handle sa_create(uint32_t id, ofp_ipsec_dir_t dir,
+				     uint32_t spi)
+{
+	ofp_ipsec_sa_param_t param;
+
+	ofp_ipsec_sa_param_init(&param);
+	param.id = id;
+	param.dir = dir;
+	param.spi = spi;
+	param.proto = OFP_IPSEC_PROTO_ESP;
+	param.mode = OFP_IPSEC_MODE_TRANSPORT;
+	param.crypto.cipher_alg = OFP_IPSEC_CIPHER_ALG_NULL;
+	param.crypto.auth_alg = OFP_IPSEC_AUTH_ALG_NULL;
+	return ofp_ipsec_sa_create(&param);
+}
+
+static void test_sa_lookup(void)
+{
+	ofp_ipsec_sa_handle in, out;
+
+	if (!sa_supported())
+		return;
+
+	in = sa_create(1, OFP_IPSEC_DIR_INBOUND, SPI);
+	out = sa_create(2, OFP_IPSEC_DIR_OUTBOUND, SPI);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(in);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(out);
+
+	/* IDs are unique and so are inbound SPIs */
+	CU_ASSERT_PTR_NULL(sa_create(2, OFP_IPSEC_DIR_INBOUND, SPI + 1));
+	CU_ASSERT_PTR_NULL(sa_create(3, OFP_IPSEC_DIR_INBOUND, SPI));
+
+	CU_ASSERT_PTR_EQUAL(ofp_ipsec_sa_find_by_id(1), in);
+	ofp_ipsec_sa_unref(in);
+	CU_ASSERT_PTR_EQUAL(ofp_ipsec_sa_find_by_id(2), out);
+	ofp_ipsec_sa_unref(out);
+	CU_ASSERT_PTR_NULL(ofp_ipsec_sa_find_by_id(3));
+
+	/* Both hashes forget a destroyed SA */
+	CU_ASSERT_EQUAL(ofp_ipsec_sa_destroy(in), 0);
+	ofp_ipsec_sa_unref(in);
+	CU_ASSERT_PTR_NULL(ofp_ipsec_sa_find_by_id(1));
+	in = sa_create(3, OFP_IPSEC_DIR_INBOUND, SPI);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(in);
+	CU_ASSERT_PTR_EQUAL(ofp_ipsec_sa_find_by_id(3), in);
+	ofp_ipsec_sa_unref(in);
+
+	CU_ASSERT_EQUAL(ofp_ipsec_sa_destroy(in), 0);
+	ofp_ipsec_sa_unref(in);
+	CU_ASSERT_EQUAL(ofp_ipsec_sa_destroy(out), 0);
+	ofp_ipsec_sa_unref(out);
+}
+
+static void test_sa_release(void)
+{
+	ofp_ipsec_sa_handle sa, found, other, again;
+	ofp_ipsec_sp_handle sp;
+	ofp_ipsec_sa_info_t info;
+
+	if (!sa_supported())
+		return;
+
+	sa = sa_create(1, OFP_IPSEC_DIR_OUTBOUND, SPI);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(sa);
+	sp = sp_create(1, OFP_IPSEC_DIR_OUTBOUND, 1, OFP_IPSEC_ACTION_PROTECT,
+		       ANY_FIRST, ANY_LAST, ANY_FIRST, ANY_LAST);
+	CU_ASSERT_EQUAL(ofp_ipsec_sp_bind(sp, sa), 0);
+	CU_ASSERT_EQUAL(lookup(0, ADDR(10, 0, 0, 1), ADDR(10, 0, 0, 2),
+			       OFP_IPPROTO_UDP, &found),
+			OFP_IPSEC_ACTION_PROTECT);
+	CU_ASSERT_PTR_EQUAL(found, sa);
+
+	/* The SP keeps a destroyed SA allocated but does not use it */
+	CU_ASSERT_EQUAL(ofp_ipsec_sa_destroy(sa), 0);
+	ofp_ipsec_sa_get_info(sa, &info);
+	CU_ASSERT_EQUAL(info.status, OFP_IPSEC_SA_DESTROYED);
+	ofp_ipsec_sa_unref(sa);
+	CU_ASSERT_EQUAL(lookup(0, ADDR(10, 0, 0, 1), ADDR(10, 0, 0, 2),
+			       OFP_IPPROTO_UDP, &found),
+			OFP_IPSEC_ACTION_PROTECT);
+	CU_ASSERT_PTR_NULL(found);
+
+	other = sa_create(2, OFP_IPSEC_DIR_OUTBOUND, SPI);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(other);
+	CU_ASSERT_PTR_NOT_EQUAL(other, sa);
+
+	/* Its last reference went with the SP */
+	sp_destroy(sp);
+	again = sa_create(3, OFP_IPSEC_DIR_OUTBOUND, SPI);
+	CU_ASSERT_PTR_EQUAL(again, sa);
+
+	CU_ASSERT_EQUAL(ofp_ipsec_sa_destroy(again), 0);
+	ofp_ipsec_sa_unref(again);
+	CU_ASSERT_EQUAL(ofp_ipsec_sa_destroy(other), 0);
+	ofp_ipsec_sa_unref(other);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp ipsec spd and sad", init_suite,
+				 clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#ifndef SP
+	if (NULL == CU_ADD_TEST(ptr_suite, test_sp_precedence)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_sp_release)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+#endif
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_sa_lookup)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_sa_release)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-ipsec");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -0,0 +1,424 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_init.h>
+#include <ofpi_ktls.h>
+#include <api/ofp_socket.h>
+#include <api/ofp_errno.h>
+
+#define DATA_LEN 100
+#define SEQ 0x0102030405060708ULL
+
+#if ODP_VERSION_API_GENERATION >= 1 && ODP_VERSION_API_MAJOR >= 22
+#define KTLS_CRYPTO 1
+#endif
+
+static uint8_t key[16] = {
+	0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+	0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+static uint8_t iv[12] = {
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+	0xa8, 0xa9, 0xaa, 0xab };
+
+/* For a packet longer than a record */
+static odp_pool_t big_pool;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_pool_param_t pool_params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	odp_pool_param_init(&pool_params);
+	pool_params.pkt.len = OFP_TLS_MAX_PLAINTEXT + 1;
+	pool_params.pkt.max_len = OFP_TLS_MAX_PLAINTEXT + 1;
+	pool_params.pkt.num = 1;
+	pool_params.type = ODP_POOL_PACKET;
+
+	big_pool = odp_pool_create("ktls_big_pool", &pool_params);
+	if (big_pool == ODP_POOL_INVALID) {
+		OFP_ERR("Error: packet pool create failed.\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	odp_pool_destroy(big_pool);
+	ofp_term_local();
+	return 0;
+}
+
+static odp_packet_t
+make_pkt(odp_pool_t pool, uint32_t len)
+{
+	odp_packet_t pkt;
+	uint32_t i;
+	uint8_t *p;
+
+	pkt = odp_packet_alloc(pool, len);
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	p = odp_packet_data(pkt);
+	for (i = 0; i < len && i < odp_packet_seg_len(pkt); i++)
+		p[i] = i;
+	return pkt;
+}
+
+static void
+test_ktls_overhead(void)
+{
+	struct ofp_ktls tls;
+	odp_packet_t pkt;
+
+	memset(&tls, 0, sizeof(tls));
+	CU_ASSERT_EQUAL(ofp_ktls_overhead(&tls), 0);
+
+	/* Header, explicit nonce, tag */
+	tls.vminor = OFP_TLS_VMINOR_12;
+	CU_ASSERT_EQUAL(ofp_ktls_hdr_len(&tls), 5 + 8);
+	CU_ASSERT_EQUAL(ofp_ktls_overhead(&tls), 5 + 8 + 16);
+
+	/* Header, content type, tag */
+	tls.vminor = OFP_TLS_VMINOR_13;
+	CU_ASSERT_EQUAL(ofp_ktls_hdr_len(&tls), 5);
+	CU_ASSERT_EQUAL(ofp_ktls_overhead(&tls), 5 + 1 + 16);
+
+	/* More than a record holds is not framed */
+	pkt = make_pkt(big_pool, OFP_TLS_MAX_PLAINTEXT + 1);
+	CU_ASSERT_EQUAL(ofp_ktls_frame(&tls, &pkt), OFP_EMSGSIZE);
+	CU_ASSERT_EQUAL(odp_packet_len(pkt), OFP_TLS_MAX_PLAINTEXT + 1);
+	odp_packet_free(pkt);
+}
+
+static void
+test_ktls_setopt(void)
+{
+	struct ofp_tls_enable en;
+	ofp_socklen_t len;
+	int fd, optval;
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(fd >= 0);
+
+	len = sizeof(optval);
+	CU_ASSERT_EQUAL(ofp_getsockopt(fd, OFP_IPPROTO_TCP,
+				       OFP_TCP_TXTLS_ENABLE, &optval, &len), 0);
+	CU_ASSERT_EQUAL(optval, 0);
+
+	memset(&en, 0, sizeof(en));
+	memcpy(en.cipher_key, key, sizeof(key));
+	memcpy(en.iv, iv, sizeof(iv));
+	en.cipher_key_len = sizeof(key);
+	en.tls_vmajor = OFP_TLS_VMAJOR;
+
+	/* TLS 1.1 */
+	en.tls_vminor = 2;
+	CU_ASSERT_EQUAL(ofp_setsockopt(fd, OFP_IPPROTO_TCP,
+				       OFP_TCP_TXTLS_ENABLE, &en,
+				       sizeof(en)), -1);
+	CU_ASSERT_EQUAL(ofp_errno, OFP_EINVAL);
+
+	en.tls_vminor = OFP_TLS_VMINOR_13;
+	en.cipher_key_len = 24;
+	CU_ASSERT_EQUAL(ofp_setsockopt(fd, OFP_IPPROTO_TCP,
+				       OFP_TCP_TXTLS_ENABLE, &en,
+				       sizeof(en)), -1);
+	CU_ASSERT_EQUAL(ofp_errno, OFP_EINVAL);
+
+	en.cipher_key_len = sizeof(key);
+	CU_ASSERT_EQUAL(ofp_setsockopt(fd, OFP_IPPROTO_TCP,
+				       OFP_TCP_TXTLS_ENABLE, &en,
+				       sizeof(en) - 1), -1);
+	CU_ASSERT_EQUAL(ofp_errno, OFP_EINVAL);
+
+	len = sizeof(optval);
+	CU_ASSERT_EQUAL(ofp_getsockopt(fd, OFP_IPPROTO_TCP,
+				       OFP_TCP_TXTLS_ENABLE, &optval, &len), 0);
+	CU_ASSERT_EQUAL(optval, 0);
+
+	/* Without AES-GCM in ODP a valid option is refused */
+	if (ofp_setsockopt(fd, OFP_IPPROTO_TCP, OFP_TCP_TXTLS_ENABLE,
+			   &en, sizeof(en)) == 0) {
+		len = sizeof(optval);
+		CU_ASSERT_EQUAL(ofp_getsockopt(fd, OFP_IPPROTO_TCP,
+					       OFP_TCP_TXTLS_ENABLE, &optval,
+					       &len), 0);
+		CU_ASSERT_EQUAL(optval, 1);
+	} else {
+		CU_ASSERT_EQUAL(ofp_errno, OFP_EOPNOTSUPP);
+	}
+
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+}
+
+#ifdef KTLS_CRYPTO
+static odp_crypto_session_t
+session(odp_crypto_op_t op, uint8_t vminor)
+{
+	odp_crypto_session_param_t param;
+	odp_crypto_ses_create_err_t ses_err;
+	odp_crypto_session_t ses;
+
+	odp_crypto_session_param_init(&param);
+	param.op = op;
+	param.op_mode = ODP_CRYPTO_SYNC;
+	param.auth_cipher_text = 1;
+	param.cipher_alg = ODP_CIPHER_ALG_AES_GCM;
+	param.cipher_key.data = key;
+	param.cipher_key.length = sizeof(key);
+	param.cipher_iv_len = 12;
+	param.auth_alg = ODP_AUTH_ALG_AES_GCM;
+	param.auth_digest_len = OFP_KTLS_TAG_LEN;
+	param.auth_aad_len = vminor == OFP_TLS_VMINOR_12 ? 13 :
+		OFP_KTLS_HDR_LEN;
+	param.compl_queue = ODP_QUEUE_INVALID;
+	param.output_pool = ODP_POOL_INVALID;
+
+	if (odp_crypto_session_create(&param, &ses, &ses_err))
+		return ODP_CRYPTO_SESSION_INVALID;
+	return ses;
+}
+
+/* Decrypt a sealed record in place, the way the peer would */
+static int
+open_record(odp_crypto_session_t ses, uint8_t vminor, uint64_t seq,
+	    odp_packet_t pkt)
+{
+	odp_crypto_packet_op_param_t op;
+	odp_crypto_packet_result_t res;
+	odp_packet_t out = pkt;
+	uint32_t len = odp_packet_len(pkt);
+	uint8_t hdr[OFP_KTLS_HDR_LEN + OFP_KTLS_NONCE_LEN];
+	uint8_t aad[13];
+	uint8_t nonce[12];
+	uint32_t clen;
+	int i;
+
+	CU_ASSERT_FATAL(odp_packet_copy_to_mem(pkt, 0, sizeof(hdr), hdr) == 0);
+
+	memset(&op, 0, sizeof(op));
+	op.session = ses;
+	op.cipher_iv_ptr = nonce;
+	op.aad_ptr = aad;
+
+	if (vminor == OFP_TLS_VMINOR_12) {
+		memcpy(nonce, iv, 4);
+		memcpy(&nonce[4], &hdr[OFP_KTLS_HDR_LEN], OFP_KTLS_NONCE_LEN);
+		clen = len - OFP_KTLS_HDR_LEN - OFP_KTLS_NONCE_LEN -
+			OFP_KTLS_TAG_LEN;
+		for (i = 0; i < 8; i++)
+			aad[i] = seq >> (56 - 8 * i);
+		memcpy(&aad[8], hdr, 3);
+		aad[11] = clen >> 8;
+		aad[12] = clen;
+		op.cipher_range.offset = OFP_KTLS_HDR_LEN + OFP_KTLS_NONCE_LEN;
+	} else {
+		memcpy(nonce, iv, sizeof(nonce));
+		for (i = 0; i < 8; i++)
+			nonce[4 + i] ^= seq >> (56 - 8 * i);
+		memcpy(aad, hdr, OFP_KTLS_HDR_LEN);
+		clen = len - OFP_KTLS_HDR_LEN - OFP_KTLS_TAG_LEN;
+		op.cipher_range.offset = OFP_KTLS_HDR_LEN;
+	}
+	op.cipher_range.length = clen;
+	op.auth_range = op.cipher_range;
+	op.hash_result_offset = op.cipher_range.offset + clen;
+
+	if (odp_crypto_op(&pkt, &out, &op, 1) != 1)
+		return -1;
+	if (odp_crypto_result(&res, out) < 0 || !res.ok)
+		return -1;
+	return 0;
+}
+
+static void
+seal_one(uint8_t vminor)
+{
+	struct ofp_ktls tls;
+	odp_crypto_session_t dec;
+	odp_packet_t pkt;
+	uint8_t hdr[OFP_KTLS_HDR_LEN + OFP_KTLS_NONCE_LEN];
+	uint8_t data[DATA_LEN];
+	uint32_t hlen, i;
+	uint8_t type;
+
+	memset(&tls, 0, sizeof(tls));
+	tls.vminor = vminor;
+	tls.seq = SEQ;
+	memcpy(tls.iv, iv, sizeof(iv));
+	tls.session = session(ODP_CRYPTO_OP_ENCODE, vminor);
+	dec = session(ODP_CRYPTO_OP_DECODE, vminor);
+	if (tls.session == ODP_CRYPTO_SESSION_INVALID ||
+	    dec == ODP_CRYPTO_SESSION_INVALID) {
+		OFP_INFO("No AES-GCM in ODP, record sealing not tested");
+		goto out;
+	}
+	hlen = ofp_ktls_hdr_len(&tls);
+
+	pkt = make_pkt(ofp_packet_pool, DATA_LEN);
+	CU_ASSERT_EQUAL_FATAL(ofp_ktls_frame(&tls, &pkt), 0);
+	CU_ASSERT_EQUAL(tls.seq, SEQ + 1);
+	CU_ASSERT_EQUAL(odp_packet_len(pkt),
+			DATA_LEN + ofp_ktls_overhead(&tls));
+
+	/* Application data with the TLS 1.2 version and the record length */
+	CU_ASSERT_FATAL(odp_packet_copy_to_mem(pkt, 0, hlen, hdr) == 0);
+	CU_ASSERT_EQUAL(hdr[0], 23);
+	CU_ASSERT_EQUAL(hdr[1], OFP_TLS_VMAJOR);
+	CU_ASSERT_EQUAL(hdr[2], OFP_TLS_VMINOR_12);
+	CU_ASSERT_EQUAL((hdr[3] << 8 | hdr[4]),
+			odp_packet_len(pkt) - OFP_KTLS_HDR_LEN);
+	/* The explicit nonce is the record number */
+	if (vminor == OFP_TLS_VMINOR_12)
+		for (i = 0; i < OFP_KTLS_NONCE_LEN; i++)
+			CU_ASSERT_EQUAL(hdr[OFP_KTLS_HDR_LEN + i],
+					(uint8_t)(SEQ >> (56 - 8 * i)));
+
+	CU_ASSERT_FATAL(odp_packet_copy_to_mem(pkt, hlen, DATA_LEN,
+					       data) == 0);
+	for (i = 0; i < DATA_LEN; i++)
+		if (data[i] != i)
+			break;
+	CU_ASSERT_NOT_EQUAL(i, DATA_LEN);
+
+	CU_ASSERT_EQUAL(open_record(dec, vminor, SEQ, pkt), 0);
+	CU_ASSERT_FATAL(odp_packet_copy_to_mem(pkt, hlen, DATA_LEN,
+					       data) == 0);
+	for (i = 0; i < DATA_LEN; i++)
+		if (data[i] != i)
+			break;
+	CU_ASSERT_EQUAL(i, DATA_LEN);
+	if (vminor == OFP_TLS_VMINOR_13) {
+		CU_ASSERT_FATAL(odp_packet_copy_to_mem(pkt, hlen + DATA_LEN,
+						       1, &type) == 0);
+		CU_ASSERT_EQUAL(type, 23);
+	}
+	odp_packet_free(pkt);
+
+	/* A record does not open with the number of another */
+	pkt = make_pkt(ofp_packet_pool, DATA_LEN);
+	CU_ASSERT_EQUAL_FATAL(ofp_ktls_frame(&tls, &pkt), 0);
+	CU_ASSERT_EQUAL(tls.seq, SEQ + 2);
+	CU_ASSERT_NOT_EQUAL(open_record(dec, vminor, SEQ, pkt), 0);
+	odp_packet_free(pkt);
+
+out:
+	if (tls.session != ODP_CRYPTO_SESSION_INVALID)
+		odp_crypto_session_destroy(tls.session);
+	if (dec != ODP_CRYPTO_SESSION_INVALID)
+		odp_crypto_session_destroy(dec);
+}
+#endif
+
+static void
+test_ktls_seal(void)
+{
+#ifdef KTLS_CRYPTO
+	seal_one(OFP_TLS_VMINOR_12);
+	seal_one(OFP_TLS_VMINOR_13);
+#else
+	struct ofp_ktls tls;
+	odp_packet_t pkt;
+
+	memset(&tls, 0, sizeof(tls));
+	tls.vminor = OFP_TLS_VMINOR_13;
+	pkt = make_pkt(ofp_packet_pool, DATA_LEN);
+	CU_ASSERT_EQUAL(ofp_ktls_frame(&tls, &pkt), OFP_EOPNOTSUPP);
+	odp_packet_free(pkt);
+#endif
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp ktls", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ktls_overhead)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ktls_setopt)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ktls_seal)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-ktls");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -0,0 +1,260 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_rcu.h>
+#include <ofpi_nh_group.h>
+#include <api/ofp_route_arp.h>
+#include <ofpi_ip.h>
+
+#define NUM_FLOWS 256
+#define GW(i) odp_cpu_to_be_32(0x0a000001 + (i))
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+static void set_members(struct ofp_nh_group_member *m, int first, int num)
+{
+	int i;
+
+	memset(m, 0, num * sizeof(*m));
+	for (i = 0; i < num; i++)
+		m[i].gw = GW(first + i);
+}
+
+/* Gateway of flow in group, or 0 if the group has no members */
+static uint32_t select_gw(int32_t group, int flow)
+{
+	struct ofp_nh_entry nh, *m;
+	struct ofp_ip ip;
+
+	memset(&nh, 0, sizeof(nh));
+	nh.arp_ent_idx = group;
+
+	memset(&ip, 0, sizeof(ip));
+	ip.ip_hl = sizeof(ip) >> 2;
+	ip.ip_p = OFP_IPPROTO_ICMP;
+	ip.ip_src.s_addr = odp_cpu_to_be_32(0xc0a80000 + flow);
+	ip.ip_dst.s_addr = odp_cpu_to_be_32(0xc0a90001);
+
+	m = ofp_nh_group_select(&nh, &ip);
+	return m ? m->gw : 0;
+}
+
+static void test_nh_group_set_select(void)
+{
+	struct ofp_nh_group_member m[OFP_NH_GROUP_MAX];
+	uint32_t gw[NUM_FLOWS];
+	int seen[3] = { 0 };
+	int32_t group;
+	uint16_t vrf;
+	int i, j;
+
+	group = ofp_nh_group_alloc();
+	CU_ASSERT_FATAL(group >= 0);
+	CU_ASSERT_EQUAL(select_gw(group, 0), 0);
+
+	set_members(m, 0, 3);
+	CU_ASSERT_EQUAL(ofp_nh_group_set(0, group, m, 3), 0);
+	CU_ASSERT_EQUAL(ofp_nh_group_get(group, &vrf, m), 3);
+	CU_ASSERT_EQUAL(vrf, 0);
+
+	/* Flows are spread over all members */
+	for (i = 0; i < NUM_FLOWS; i++) {
+		gw[i] = select_gw(group, i);
+		for (j = 0; j < 3; j++)
+			if (gw[i] == GW(j))
+				seen[j]++;
+	}
+	CU_ASSERT_EQUAL(seen[0] + seen[1] + seen[2], NUM_FLOWS);
+	CU_ASSERT(seen[0] && seen[1] && seen[2]);
+
+	/* Removing a member moves only its own flows */
+	set_members(m, 0, 2);
+	CU_ASSERT_EQUAL(ofp_nh_group_set(0, group, m, 2), 0);
+	for (i = 0; i < NUM_FLOWS; i++) {
+		if (gw[i] != GW(2))
+			CU_ASSERT_EQUAL(select_gw(group, i), gw[i]);
+		CU_ASSERT_NOT_EQUAL(select_gw(group, i), GW(2));
+	}
+
+	/* Another VRF cannot take over the group */
+	CU_ASSERT_EQUAL(ofp_nh_group_set(1, group, m, 2), -1);
+
+	CU_ASSERT_EQUAL(ofp_nh_group_del(group), 0);
+}
+
+static void test_nh_group_ref_count(void)
+{
+	struct ofp_nh_group_member m[OFP_NH_GROUP_MAX];
+	struct ofp_nh_entry nh;
+	int32_t group;
+	uint16_t vrf;
+
+	group = ofp_nh_group_alloc();
+	CU_ASSERT_FATAL(group >= 0);
+	set_members(m, 0, 2);
+	CU_ASSERT_EQUAL(ofp_nh_group_set(0, group, m, 2), 0);
+
+	memset(&nh, 0, sizeof(nh));
+	CU_ASSERT_EQUAL(ofp_nh_group_hold(group, &nh), 0);
+	CU_ASSERT_EQUAL(ofp_nh_group_hold(group, &nh), 0);
+
+	/* Deleted, but kept for the routes still using it */
+	CU_ASSERT_EQUAL(ofp_nh_group_del(group), 0);
+	CU_ASSERT_EQUAL(ofp_nh_group_del(group), -1);
+	CU_ASSERT_EQUAL(ofp_nh_group_hold(group, &nh), -1);
+	CU_ASSERT_EQUAL(ofp_nh_group_get(group, &vrf, m), -1);
+	CU_ASSERT_EQUAL(ofp_nh_group_set(0, group, m, 2), -1);
+	CU_ASSERT_NOT_EQUAL(select_gw(group, 0), 0);
+
+	ofp_nh_group_release(group);
+	CU_ASSERT_NOT_EQUAL(select_gw(group, 0), 0);
+
+	/* Freed with the last release, and allocated again */
+	ofp_nh_group_release(group);
+	CU_ASSERT_EQUAL(ofp_nh_group_alloc(), group);
+	CU_ASSERT_EQUAL(ofp_nh_group_get(group, &vrf, m), 0);
+	CU_ASSERT_EQUAL(ofp_nh_group_del(group), 0);
+}
+
+static void test_nh_group_slot_reuse(void)
+{
+	struct ofp_nh_group_member m[OFP_NH_GROUP_MAX];
+	struct ofp_nh_entry nh, *held;
+	struct ofp_ip ip;
+	int32_t group;
+	int i, ret = 0;
+
+	group = ofp_nh_group_alloc();
+	CU_ASSERT_FATAL(group >= 0);
+	set_members(m, 0, 1);
+	CU_ASSERT_EQUAL(ofp_nh_group_set(0, group, m, 1), 0);
+
+	/* A reader holds the member across changes of the group */
+	ofp_rcu_thread_register();
+	memset(&nh, 0, sizeof(nh));
+	nh.arp_ent_idx = group;
+	memset(&ip, 0, sizeof(ip));
+	ip.ip_hl = sizeof(ip) >> 2;
+	held = ofp_nh_group_select(&nh, &ip);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(held);
+
+	/* Retired slots run out, the held one is not reused */
+	for (i = 1; i <= 2 * OFP_NH_GROUP_MAX && !ret; i++) {
+		set_members(m, i, 1);
+		ret = ofp_nh_group_set(0, group, m, 1);
+		CU_ASSERT_EQUAL(held->gw, GW(0));
+	}
+	CU_ASSERT_EQUAL(ret, -1);
+
+	ofp_rcu_quiescent();
+	CU_ASSERT_EQUAL(ofp_nh_group_set(0, group, m, 1), 0);
+	ofp_rcu_thread_unregister();
+
+	CU_ASSERT_EQUAL(ofp_nh_group_del(group), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp next hop groups", init_suite,
+				 clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_nh_group_set_select)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_nh_group_ref_count)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_nh_group_slot_reuse)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-nh-group");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
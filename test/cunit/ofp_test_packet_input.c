@@ -616,6 +616,7 @@ test_ofp_packet_input_forwarding_to_output(void)
 	CU_PASS("ofp_packet_input_forwarding_to_output");
 }
 
+#ifdef OFP_GRE
 static void
 test_ofp_packet_input_gre_processed_inner_pkt_forwarded(void)
 {
@@ -728,6 +729,7 @@ static void test_ofp_packet_input_gre_orig_pkt_to_sp(void)
 	CU_ASSERT_EQUAL(odp_queue_deq(ifnet->outq_def), ODP_EVENT_INVALID);
 #endif
 }
+#endif /* OFP_GRE */
 
 static void test_init_packet_input_basic(void)
 {
@@ -818,6 +820,7 @@ main(void)
 		return CU_get_error();
 	}
 
+#ifdef OFP_GRE
 	if (NULL == CU_ADD_TEST(ptr_suite,
 				test_ofp_packet_input_gre_processed_inner_pkt_forwarded)) {
 		CU_cleanup_registry();
@@ -829,6 +832,7 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+#endif /* OFP_GRE */
 
 	ptr_suite = CU_add_suite("test VRF", NULL , NULL);
 	if (NULL == ptr_suite) {
@@ -866,6 +870,7 @@ main(void)
 		return CU_get_error();
 	}
 
+#ifdef OFP_GRE
 	if (NULL == CU_ADD_TEST(ptr_suite,
 				test_ofp_packet_input_gre_processed_inner_pkt_forwarded)) {
 		CU_cleanup_registry();
@@ -877,6 +882,7 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+#endif /* OFP_GRE */
 
 #if OFP_TESTMODE_AUTO
 	CU_set_output_filename("CUnit-PKT-IN");
@@ -33,6 +33,9 @@
 #include <ofpi_hook.h>
 #include <ofpi_util.h>
 #include <ofpi_debug.h>
+#ifdef INET6
+#include <ofpi_nd6_cache.h>
+#endif
 
 #include "ofp_route_arp.h"
 
@@ -43,6 +46,9 @@
 static int my_test_val;
 #define TEST_HOOK_OUT_IPv4		0x8006
 #define TEST_HOOK_OUT_IPv6		0x8007
+/* Pad the packet in place as ESP output does */
+#define TEST_HOOK_OUT_PAD		0x8008
+#define TEST_PAD_LEN			16
 
 #define TEST_HOOK_OUT_IPv4_VALUE	0xFF01
 #define TEST_HOOK_OUT_IPv6_VALUE	0xFF02
@@ -167,11 +173,20 @@ static void init_ifnet(void)
 static enum ofp_return_code fastpath_hook_out_IPv4(odp_packet_t pkt,
 		void *arg)
 {
-	(void)pkt;
+	void *tail;
+
 	(void)arg;
 
 	if (my_test_val == TEST_HOOK_OUT_IPv4)
 		return TEST_HOOK_OUT_IPv4_VALUE;
+	if (my_test_val == TEST_HOOK_OUT_PAD) {
+		CU_ASSERT(!odp_packet_has_ref(pkt));
+		tail = odp_packet_push_tail(pkt, TEST_PAD_LEN);
+		if (tail) {
+			memset(tail, 0xff, TEST_PAD_LEN);
+			odp_packet_pull_tail(pkt, TEST_PAD_LEN);
+		}
+	}
 	return OFP_PKT_CONTINUE;
 }
 #ifdef INET6
@@ -337,6 +352,7 @@ create_odp_packet_ip6(odp_packet_t *opkt, uint8_t *pkt_data, int plen)
 /*
  * Tests
  */
+#ifdef OFP_GRE
 static void
 test_packet_output_gre(void)
 {
@@ -422,6 +438,77 @@ test_packet_output_gre_no_nexthop(void)
 	CU_ASSERT_EQUAL_FATAL(ev, ODP_EVENT_INVALID);
 }
 
+#define FRAG_PL_LEN	600
+#define FRAG_MTU	276
+
+static void
+test_packet_output_gre_fragments(void)
+{
+	odp_packet_t pkt = ODP_PACKET_INVALID;
+	struct ofp_ifnet *dev_gre = ofp_get_ifnet(GRE_PORTS, 100);
+	struct ofp_ip *ip;
+	struct ofp_greip *greip;
+	uint8_t *pl;
+	uint32_t old_mtu;
+	odp_event_t ev;
+	int i, res, off, len, num = 0, sum = 0;
+
+	pkt = ofp_packet_alloc(sizeof(*ip) + FRAG_PL_LEN);
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	odp_packet_l3_offset_set(pkt, 0);
+	ip = odp_packet_l3_ptr(pkt, NULL);
+	memset(ip, 0, sizeof(*ip));
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(*ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(sizeof(*ip) + FRAG_PL_LEN);
+	ip->ip_ttl = 64;
+	ip->ip_p = OFP_IPPROTO_UDP;
+	ip->ip_src.s_addr = dev_ip;
+	ip->ip_dst.s_addr = tun_p2p;
+	pl = (uint8_t *)(ip + 1);
+	for (i = 0; i < FRAG_PL_LEN; i++)
+		pl[i] = i;
+
+	/*
+	 * The fragments go through the tunnel, and the output after
+	 * encapsulation pads each one at the tail. The padding of one must
+	 * not scribble over the data of the next.
+	 */
+	old_mtu = dev_gre->if_mtu;
+	dev_gre->if_mtu = FRAG_MTU;
+	my_test_val = TEST_HOOK_OUT_PAD;
+	res = ofp_ip_send(pkt, NULL);
+	my_test_val = 0;
+	dev_gre->if_mtu = old_mtu;
+	CU_ASSERT_EQUAL(res, OFP_PKT_PROCESSED);
+
+	res = ofp_send_pending_pkt();
+	CU_ASSERT_EQUAL(res, OFP_PKT_PROCESSED);
+
+	while ((ev = odp_queue_deq(dev->outq_def)) != ODP_EVENT_INVALID) {
+		pkt = odp_packet_from_event(ev);
+		greip = odp_packet_l3_ptr(pkt, NULL);
+		CU_ASSERT_EQUAL(greip->gi_i.ip_p, OFP_IPPROTO_GRE);
+
+		ip = (struct ofp_ip *)(greip + 1);
+		off = (odp_be_to_cpu_16(ip->ip_off) & OFP_IP_OFFMASK) * 8;
+		len = odp_be_to_cpu_16(ip->ip_len) - sizeof(*ip);
+		CU_ASSERT(len <= FRAG_MTU - (int)sizeof(*ip));
+		CU_ASSERT_FATAL(off + len <= FRAG_PL_LEN);
+		pl = (uint8_t *)(ip + 1);
+		for (i = 0; i < len; i++)
+			if (pl[i] != (uint8_t)(off + i))
+				break;
+		CU_ASSERT_EQUAL(i, len);
+
+		sum += len;
+		num++;
+		odp_packet_free(pkt);
+	}
+	CU_ASSERT_EQUAL(num, 3);
+	CU_ASSERT_EQUAL(sum, FRAG_PL_LEN);
+}
+
 #ifdef INET6
 static void
 test_packet_output_ipv6_to_gre(void)
@@ -488,6 +575,7 @@ test_packet_output_ipv6_to_gre(void)
 		CU_FAIL("Inner IP packet error.");
 }
 #endif
+#endif /* OFP_GRE */
 
 static void
 test_send_frame_packet_len_bigger_than_mtu(void)
@@ -675,6 +763,72 @@ test_hook_out_ipv6(void)
 	CU_ASSERT_EQUAL(res, TEST_HOOK_OUT_IPv6_VALUE);
 	CU_PASS("test_hook_out_ipv6");
 }
+
+static void drain_out_queue(void)
+{
+	odp_event_t ev;
+
+	ofp_send_pending_pkt();
+	while ((ev = odp_queue_deq(dev->outq_def)) != ODP_EVENT_INVALID)
+		odp_event_free(ev);
+}
+
+static void
+test_nd6_cache(void)
+{
+	uint8_t addr[16] = {0xfe, 0x80, 0, 0, 0, 0, 0, 0,
+			    0, 0, 0, 0, 0, 0, 0x12, 0x34};
+	uint8_t nd6_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x12, 0x34};
+	uint8_t man_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x56, 0x78};
+	uint8_t mac[6];
+	uint32_t hint = 0;
+	odp_packet_t pkt;
+	int res;
+
+	/* Unknown neighbour: the packet waits for the advertisement */
+	if (create_odp_packet_ip6(&pkt, ip6udp_frame, sizeof(ip6udp_frame))) {
+		CU_FAIL("Fail to create packet");
+		return;
+	}
+	res = ofp_nd6_resolve(pkt, dev, addr, &hint, mac);
+	CU_ASSERT_EQUAL(res, OFP_PKT_PROCESSED);
+	CU_ASSERT_NOT_EQUAL(hint, 0);
+	if (res == OFP_PKT_DROP)
+		odp_packet_free(pkt);
+
+	/* Still incomplete, queued behind the first one */
+	if (create_odp_packet_ip6(&pkt, ip6udp_frame, sizeof(ip6udp_frame))) {
+		CU_FAIL("Fail to create packet");
+		return;
+	}
+	res = ofp_nd6_resolve(pkt, dev, addr, &hint, mac);
+	CU_ASSERT_EQUAL(res, OFP_PKT_PROCESSED);
+	if (res == OFP_PKT_DROP)
+		odp_packet_free(pkt);
+	drain_out_queue();
+
+	/* The advertisement releases the waiting packets */
+	ofp_nd6_cache_update(dev, addr, nd6_mac, 1, 0);
+	drain_out_queue();
+
+	memset(mac, 0, sizeof(mac));
+	res = ofp_nd6_resolve(ODP_PACKET_INVALID, dev, addr, &hint, mac);
+	CU_ASSERT_EQUAL(res, OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(memcmp(mac, nd6_mac, sizeof(mac)), 0);
+
+	/* A stale hint is corrected by the lookup */
+	hint = 0;
+	res = ofp_nd6_resolve(ODP_PACKET_INVALID, dev, addr, &hint, mac);
+	CU_ASSERT_EQUAL(res, OFP_PKT_CONTINUE);
+	CU_ASSERT_NOT_EQUAL(hint, 0);
+
+	/* Manual entries are not changed by ND */
+	ofp_nd6_cache_update(dev, addr, man_mac, 0, 1);
+	ofp_nd6_cache_update(dev, addr, nd6_mac, 1, 0);
+	res = ofp_nd6_resolve(ODP_PACKET_INVALID, dev, addr, &hint, mac);
+	CU_ASSERT_EQUAL(res, OFP_PKT_CONTINUE);
+	CU_ASSERT_EQUAL(memcmp(mac, man_mac, sizeof(mac)), 0);
+}
 #endif /*INET6*/
 
 /*
@@ -698,6 +852,7 @@ main(void)
 		return CU_get_error();
 	}
 
+#ifdef OFP_GRE
 	if (NULL == CU_ADD_TEST(ptr_suite,
 				test_packet_output_gre)) {
 		CU_cleanup_registry();
@@ -709,6 +864,12 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite,
+				test_packet_output_gre_fragments)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 #ifdef INET6
 	if (NULL == CU_ADD_TEST(ptr_suite,
 				test_packet_output_ipv6_to_gre)) {
@@ -716,6 +877,7 @@ main(void)
 		return CU_get_error();
 	}
 #endif
+#endif /* OFP_GRE */
 
 	if (NULL == CU_ADD_TEST(ptr_suite,
 				test_send_frame_packet_len_bigger_than_mtu)) {
@@ -755,6 +917,11 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite,
+				test_nd6_cache)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 #endif /*INET6*/
 
 #if OFP_TESTMODE_AUTO
@@ -260,6 +260,79 @@ test_gre_port(void)
 	CU_ASSERT_PTR_NULL_FATAL(dev);
 }
 
+static void
+test_ifnet_by_ip(void)
+{
+	int port = 0;
+	uint16_t vlan = 200;
+	uint16_t vrf = 1, vrf1 = 2;
+	uint32_t ifaddr = 0x660AA8C0; /* C0.A8.0A.66 = 192.168.10.102 */
+	int masklen = 24;
+	struct ofp_ifnet *dev;
+	const char *res;
+
+	res = ofp_config_interface_up_v4(port, vlan, vrf, ifaddr, masklen);
+	CU_ASSERT_PTR_NULL_FATAL(res);
+	dev = ofp_get_ifnet(port, vlan);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dev);
+
+	CU_ASSERT_PTR_EQUAL(ofp_get_ifnet_by_ip(ifaddr, vrf), dev);
+	CU_ASSERT_PTR_EQUAL(ofp_get_ifnet_match(ifaddr, vrf, vlan), dev);
+	CU_ASSERT_PTR_NULL(ofp_get_ifnet_match(ifaddr, vrf, 0));
+	CU_ASSERT_PTR_NULL(ofp_get_ifnet_by_ip(ifaddr, vrf1));
+
+	/* Moving to another vrf rehashes the address */
+	res = ofp_config_interface_up_v4(port, vlan, vrf1, ifaddr, masklen);
+	CU_ASSERT_PTR_NULL_FATAL(res);
+	dev = ofp_get_ifnet(port, vlan);
+	CU_ASSERT_PTR_NULL(ofp_get_ifnet_by_ip(ifaddr, vrf));
+	CU_ASSERT_PTR_EQUAL(ofp_get_ifnet_by_ip(ifaddr, vrf1), dev);
+
+	res = ofp_config_interface_down(port, vlan);
+	CU_ASSERT_PTR_NULL_FATAL(res);
+	CU_ASSERT_PTR_NULL(ofp_get_ifnet_by_ip(ifaddr, vrf1));
+}
+
+static void
+test_ifnet_extra_ip(void)
+{
+	int port = 0;
+	uint16_t vlan = 300;
+	uint16_t vrf = 1;
+	uint32_t ifaddr = 0x670AA8C0; /* C0.A8.0A.67 = 192.168.10.103 */
+	uint32_t vip = 0x00000A0A; /* 10.10.0.0 */
+	int num = 2 * OFP_NUM_IFNET_IP_ADDRS;
+	struct ofp_ifnet *dev;
+	const char *res;
+	int i;
+
+	res = ofp_config_interface_up_v4(port, vlan, vrf, ifaddr, 24);
+	CU_ASSERT_PTR_NULL_FATAL(res);
+	dev = ofp_get_ifnet(port, vlan);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(dev);
+
+	/* Addresses beyond ip_addr_info go to the extra list */
+	for (i = 1; i <= num; i++)
+		CU_ASSERT_EQUAL(ofp_ifnet_ip_add(dev, vip | i << 24), 0);
+	CU_ASSERT_PTR_NOT_NULL(dev->ip_addr_extra);
+	for (i = 1; i <= num; i++) {
+		CU_ASSERT_NOT_EQUAL(ofp_ifnet_ip_find(dev, vip | i << 24), -1);
+		CU_ASSERT_PTR_NOT_NULL(ofp_ifnet_ip_get(dev, vip | i << 24));
+		CU_ASSERT(ofp_ifaddr_is_local(vip | i << 24, vrf));
+	}
+
+	ofp_ifnet_ip_remove(dev, vip | num << 24);
+	CU_ASSERT_EQUAL(ofp_ifnet_ip_find(dev, vip | num << 24), -1);
+	CU_ASSERT(!ofp_ifaddr_is_local(vip | num << 24, vrf));
+	ofp_ifnet_ip_remove(dev, vip | 1 << 24);
+	CU_ASSERT_EQUAL(ofp_ifnet_ip_find(dev, vip | 1 << 24), -1);
+	CU_ASSERT_NOT_EQUAL(ofp_ifnet_ip_find(dev, vip | (num - 1) << 24), -1);
+
+	res = ofp_config_interface_down(port, vlan);
+	CU_ASSERT_PTR_NULL_FATAL(res);
+	CU_ASSERT(!ofp_ifaddr_is_local(vip | (num - 1) << 24, vrf));
+}
+
 #define mtx_lock(mtx)
 #define mtx_unlock(mtx)
 
@@ -311,6 +384,10 @@ main(void)
 		{ const_cast("Test single port"), test_single_port_basic },
 		{ const_cast("Test two vlan ports"), test_two_ports_vlan },
 		{ const_cast("Test gre port"), test_gre_port },
+		{ const_cast("Test interface lookup by address"),
+		  test_ifnet_by_ip },
+		{ const_cast("Test interface addresses beyond ip_addr_info"),
+		  test_ifnet_extra_ip },
 		{ const_cast("Test queue"), test_queue },
 		CU_TEST_INFO_NULL,
 	};
@@ -0,0 +1,190 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_rcu.h>
+#include <ofpi_route.h>
+#include <ofpi_rt_lookup.h>
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_rcu_thread_unregister();
+	ofp_term_local();
+	return 0;
+}
+
+static void test_rcu_grace_period(void)
+{
+	uint64_t epoch;
+
+	ofp_rcu_thread_register();
+	epoch = ofp_rcu_epoch();
+	ofp_rcu_advance();
+	CU_ASSERT_EQUAL(ofp_rcu_epoch(), epoch + 1);
+
+	/* This thread may still read data retired in epoch */
+	CU_ASSERT_FALSE(ofp_rcu_is_safe(epoch));
+
+	ofp_rcu_quiescent();
+	CU_ASSERT_TRUE(ofp_rcu_is_safe(epoch));
+
+	/* Retired in the current epoch, not safe before it is advanced */
+	epoch = ofp_rcu_epoch();
+	CU_ASSERT_FALSE(ofp_rcu_is_safe(epoch));
+	ofp_rcu_thread_unregister();
+}
+
+static void test_rcu_offline_not_waited(void)
+{
+	uint64_t epoch;
+
+	ofp_rcu_thread_register();
+	epoch = ofp_rcu_epoch();
+	ofp_rcu_advance();
+	ofp_rcu_thread_offline();
+	CU_ASSERT_TRUE(ofp_rcu_is_safe(epoch));
+
+	/* Back online, the thread is waited for again */
+	ofp_rcu_thread_online();
+	epoch = ofp_rcu_epoch();
+	ofp_rcu_advance();
+	CU_ASSERT_FALSE(ofp_rcu_is_safe(epoch));
+	ofp_rcu_quiescent();
+	CU_ASSERT_TRUE(ofp_rcu_is_safe(epoch));
+	ofp_rcu_thread_unregister();
+}
+
+static void test_rcu_route_replace(void)
+{
+	struct ofp_rtl_tree tree;
+	struct ofp_nh_entry nh, *old;
+	uint32_t dst = odp_cpu_to_be_32(0x0a000000);
+
+	OFP_LOCK_WRITE(route);
+	CU_ASSERT_EQUAL_FATAL(ofp_rtl_root_init(&tree, 0), 0);
+
+	memset(&nh, 0, sizeof(nh));
+	nh.gw = 1;
+	CU_ASSERT_PTR_NULL(ofp_rtl_insert(&tree, dst, 8, &nh));
+
+	/* A reader holds the next hop across the replace */
+	ofp_rcu_thread_register();
+	old = ofp_rtl_search(&tree, dst);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(old);
+
+	nh.gw = 2;
+	CU_ASSERT_PTR_NULL(ofp_rtl_insert(&tree, dst, 8, &nh));
+	CU_ASSERT_EQUAL(ofp_rtl_search(&tree, dst)->gw, 2);
+
+	/* The replaced node waits for the reader */
+	CU_ASSERT_EQUAL(ofp_rtl_reclaim(), 1);
+	CU_ASSERT_EQUAL(old->gw, 1);
+
+	ofp_rcu_quiescent();
+	CU_ASSERT_EQUAL(ofp_rtl_reclaim(), 0);
+	ofp_rcu_thread_unregister();
+
+	CU_ASSERT_PTR_NOT_NULL(ofp_rtl_remove(&tree, dst, 8));
+	ofp_rtl_destroy(&tree, NULL);
+	OFP_UNLOCK_WRITE(route);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp rcu", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_rcu_grace_period)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_rcu_offline_not_waited)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_rcu_route_replace)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-rcu");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -0,0 +1,341 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_in.h>
+#include <ofpi_ip6.h>
+#include <ofpi_pkt_processing.h>
+#include <ofpi_reass.h>
+
+#define fail_with_odp(msg) do { OFP_ERR(msg); CU_FAIL(msg); } while (0)
+
+/*
+ * Test data
+ */
+
+#define PAYLOAD_LEN 1200
+#define FRAG_LEN 512
+
+static uint8_t payload[PAYLOAD_LEN];
+static uint32_t ident;
+
+#define MAX_POOL_PKTS (64 * 1024)
+static odp_packet_t pool_pkts[MAX_POOL_PKTS];
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+	int i;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	for (i = 0; i < PAYLOAD_LEN; i++)
+		payload[i] = i;
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* Fragment of payload at off of length len */
+static odp_packet_t create_fragment(uint32_t id, int off, int len, int more)
+{
+	odp_pool_t pool;
+	odp_packet_t pkt;
+	struct ofp_ip6_hdr *ip6;
+	struct ofp_ip6_frag *fh;
+	uint8_t *buf;
+	int plen = sizeof(*fh) + len;
+
+	pool = odp_pool_lookup("packet_pool");
+	if (pool == ODP_POOL_INVALID) {
+		fail_with_odp("ODP packet_pool not found\n");
+		return ODP_PACKET_INVALID;
+	}
+
+	pkt = odp_packet_alloc(pool, OFP_ETHER_HDR_LEN + sizeof(*ip6) + plen);
+	if (pkt == ODP_PACKET_INVALID) {
+		fail_with_odp("ODP packet alloc failed");
+		return ODP_PACKET_INVALID;
+	}
+
+	buf = odp_packet_data(pkt);
+	memset(buf, 0, OFP_ETHER_HDR_LEN);
+
+	ip6 = (struct ofp_ip6_hdr *)&buf[OFP_ETHER_HDR_LEN];
+	memset(ip6, 0, sizeof(*ip6));
+	ip6->ofp_ip6_vfc = OFP_IPV6_VERSION;
+	ip6->ofp_ip6_plen = odp_cpu_to_be_16(plen);
+	ip6->ofp_ip6_nxt = OFP_IPPROTO_FRAGMENT;
+	ip6->ofp_ip6_hlim = 64;
+	ip6->ip6_src.ofp_s6_addr[0] = 0xfd;
+	ip6->ip6_src.ofp_s6_addr[15] = 1;
+	ip6->ip6_dst.ofp_s6_addr[0] = 0xfd;
+	ip6->ip6_dst.ofp_s6_addr[15] = 2;
+
+	fh = (struct ofp_ip6_frag *)(ip6 + 1);
+	fh->ip6f_nxt = OFP_IPPROTO_UDP;
+	fh->ip6f_reserved = 0;
+	fh->ip6f_offlg = odp_cpu_to_be_16(off) |
+		(more ? OFP_IP6F_MORE_FRAG : 0);
+	fh->ip6f_ident = id;
+	memcpy(fh + 1, &payload[off], len);
+
+	odp_packet_has_eth_set(pkt, 1);
+	odp_packet_has_ipv6_set(pkt, 1);
+	odp_packet_l2_offset_set(pkt, 0);
+	odp_packet_l3_offset_set(pkt, OFP_ETHER_HDR_LEN);
+
+	return pkt;
+}
+
+static enum ofp_return_code input(uint32_t id, int off, int len, int more,
+				  odp_packet_t *pkt)
+{
+	int offp = sizeof(struct ofp_ip6_hdr);
+	int nxt = OFP_IPPROTO_FRAGMENT;
+	enum ofp_return_code ret;
+
+	*pkt = create_fragment(id, off, len, more);
+	if (*pkt == ODP_PACKET_INVALID)
+		return OFP_PKT_DROP;
+
+	ret = ofp_frag6_input(pkt, &offp, &nxt);
+	if (ret == OFP_PKT_CONTINUE) {
+		CU_ASSERT_EQUAL(offp, sizeof(struct ofp_ip6_hdr));
+		CU_ASSERT_EQUAL(nxt, OFP_IPPROTO_UDP);
+	}
+	return ret;
+}
+
+/* Packets left in the pool, a double free shows up as one too many */
+static int pool_free_count(void)
+{
+	odp_pool_t pool = odp_pool_lookup("packet_pool");
+	int i, num = 0;
+
+	while (num < MAX_POOL_PKTS) {
+		pool_pkts[num] = odp_packet_alloc(pool, 1);
+		if (pool_pkts[num] == ODP_PACKET_INVALID)
+			break;
+		num++;
+	}
+	for (i = 0; i < num; i++)
+		odp_packet_free(pool_pkts[i]);
+	return num;
+}
+
+static void assert_datagram(odp_packet_t pkt, int len)
+{
+	struct ofp_ip6_hdr *ip6 = odp_packet_l3_ptr(pkt, NULL);
+
+	CU_ASSERT_EQUAL(odp_packet_l3_offset(pkt), OFP_ETHER_HDR_LEN);
+	CU_ASSERT_EQUAL(ip6->ofp_ip6_nxt, OFP_IPPROTO_UDP);
+	CU_ASSERT_EQUAL(odp_be_to_cpu_16(ip6->ofp_ip6_plen), len);
+	CU_ASSERT_EQUAL(odp_packet_len(pkt),
+			OFP_ETHER_HDR_LEN + sizeof(*ip6) + len);
+	CU_ASSERT_EQUAL(memcmp(ip6 + 1, payload, len), 0);
+}
+
+static void test_reass6_in_order(void)
+{
+	odp_packet_t pkt;
+	uint32_t id = ++ident;
+
+	CU_ASSERT_EQUAL(input(id, 0, FRAG_LEN, 1, &pkt), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(id, FRAG_LEN, FRAG_LEN, 1, &pkt),
+			OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(id, 2 * FRAG_LEN, PAYLOAD_LEN - 2 * FRAG_LEN, 0,
+			      &pkt), OFP_PKT_CONTINUE);
+
+	assert_datagram(pkt, PAYLOAD_LEN);
+	odp_packet_free(pkt);
+}
+
+static void test_reass6_reverse_order(void)
+{
+	odp_packet_t pkt;
+	uint32_t id = ++ident;
+
+	CU_ASSERT_EQUAL(input(id, 2 * FRAG_LEN, PAYLOAD_LEN - 2 * FRAG_LEN, 0,
+			      &pkt), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(id, FRAG_LEN, FRAG_LEN, 1, &pkt),
+			OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(id, 0, FRAG_LEN, 1, &pkt), OFP_PKT_CONTINUE);
+
+	assert_datagram(pkt, PAYLOAD_LEN);
+	odp_packet_free(pkt);
+}
+
+static void test_reass6_overlap_dropped(void)
+{
+	odp_packet_t pkt;
+	uint32_t id = ++ident;
+
+	CU_ASSERT_EQUAL(input(id, 0, FRAG_LEN, 1, &pkt), OFP_PKT_PROCESSED);
+	/* Overlapping fragment discards the datagram */
+	CU_ASSERT_EQUAL(input(id, FRAG_LEN / 2, FRAG_LEN, 1, &pkt),
+			OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(id, FRAG_LEN, PAYLOAD_LEN - FRAG_LEN, 0, &pkt),
+			OFP_PKT_PROCESSED);
+}
+
+static void test_reass6_atomic_fragment(void)
+{
+	odp_packet_t pkt;
+
+	CU_ASSERT_EQUAL(input(++ident, 0, PAYLOAD_LEN, 0, &pkt),
+			OFP_PKT_CONTINUE);
+
+	assert_datagram(pkt, PAYLOAD_LEN);
+	odp_packet_free(pkt);
+}
+
+static void test_reass6_bad_length(void)
+{
+	odp_packet_t pkt;
+	int avail;
+
+	ofp_reassembly6_age(IP6REASS_TTL);
+	avail = pool_free_count();
+
+	/* Consumed by the parameter problem error */
+	CU_ASSERT_EQUAL(input(++ident, 0, FRAG_LEN - 1, 1, &pkt),
+			OFP_PKT_PROCESSED);
+
+	CU_ASSERT_EQUAL(pool_free_count(), avail);
+}
+
+static void test_reass6_timeout(void)
+{
+	odp_packet_t pkt;
+	uint32_t id = ++ident;
+	int avail;
+
+	ofp_reassembly6_age(IP6REASS_TTL);
+	avail = pool_free_count();
+
+	CU_ASSERT_EQUAL(input(id, 0, FRAG_LEN, 1, &pkt), OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(input(id, 2 * FRAG_LEN, PAYLOAD_LEN - 2 * FRAG_LEN, 0,
+			      &pkt), OFP_PKT_PROCESSED);
+
+	/* Time exceeded error from the first fragment, the rest freed */
+	ofp_reassembly6_age(IP6REASS_TTL);
+
+	CU_ASSERT_EQUAL(pool_free_count(), avail);
+
+	/* The datagram is gone, the missing fragment starts a new one */
+	CU_ASSERT_EQUAL(input(id, FRAG_LEN, FRAG_LEN, 1, &pkt),
+			OFP_PKT_PROCESSED);
+	ofp_reassembly6_age(IP6REASS_TTL);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp ipv6 reassembly", init_suite,
+				 clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass6_in_order)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass6_reverse_order)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass6_overlap_dropped)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass6_atomic_fragment)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass6_bad_length)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass6_timeout)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-reass6");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
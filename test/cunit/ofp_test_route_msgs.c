@@ -0,0 +1,241 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_init.h>
+#include <ofpi_route.h>
+#include <ofpi_arp.h>
+#include <ofpi_flow_cache.h>
+#include <ofpi_rcu.h>
+#include <ofpi_util.h>
+
+#define NUM	8
+#define GW	odp_cpu_to_be_32(0xc0a80101)
+/* 10.<net>.0.0/16 */
+#define DST(net) odp_cpu_to_be_32(0x0a000000 | (net) << 16)
+/* A host in it */
+#define HOST(net) odp_cpu_to_be_32(0x0a000001 | (net) << 16)
+/* Not configured */
+#define NO_GROUP 1000
+
+static struct ofp_route_msg msgs[NUM];
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* Additions of 10.<net>.0.0/16 for nets first.., last first */
+static void fill_msgs(uint32_t first)
+{
+	int i;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < NUM; i++) {
+		msgs[i].type = OFP_ROUTE_ADD;
+		msgs[i].flags = OFP_RTF_GATEWAY;
+		msgs[i].dst = DST(first + NUM - 1 - i);
+		msgs[i].masklen = 16;
+		msgs[i].gw = GW;
+	}
+}
+
+/* Number of the nets first.. with a route through GW */
+static int routes_found(uint32_t first)
+{
+	struct ofp_nh_entry *nh;
+	uint32_t flags;
+	int i, num = 0;
+
+	for (i = 0; i < NUM; i++) {
+		nh = ofp_get_next_hop(0, HOST(first + i), &flags);
+		if (nh && nh->gw == GW)
+			num++;
+	}
+	return num;
+}
+
+static uint32_t flow_gen(void)
+{
+	return odp_atomic_load_u32(ofp_flow_cache.gen);
+}
+
+static void test_batch_publish_once(void)
+{
+	uint32_t gen;
+	uint64_t epoch;
+	int i;
+
+	/* All routes of a batch, one flow cache flush */
+	fill_msgs(1);
+	gen = flow_gen();
+	CU_ASSERT_EQUAL(ofp_set_route_msgs(msgs, NUM), 0);
+	CU_ASSERT_EQUAL(flow_gen() - gen, 1);
+	CU_ASSERT_EQUAL(routes_found(1), NUM);
+
+	/* Replacing them retires nodes, the epoch is advanced once */
+	epoch = ofp_rcu_epoch();
+	gen = flow_gen();
+	CU_ASSERT_EQUAL(ofp_set_route_msgs(msgs, NUM), 0);
+#ifndef MTRIE
+	CU_ASSERT_EQUAL(ofp_rcu_epoch() - epoch, 1);
+#endif
+	CU_ASSERT_EQUAL(flow_gen() - gen, 1);
+	CU_ASSERT_EQUAL(routes_found(1), NUM);
+
+	/* And once per route when they come one by one */
+	epoch = ofp_rcu_epoch();
+	for (i = 0; i < NUM; i++)
+		CU_ASSERT_EQUAL(ofp_set_route_msg(&msgs[i]), 0);
+#ifndef MTRIE
+	CU_ASSERT_EQUAL(ofp_rcu_epoch() - epoch, NUM);
+#else
+	(void)epoch;
+#endif
+	CU_ASSERT_EQUAL(routes_found(1), NUM);
+}
+
+static void test_batch_all_or_none(void)
+{
+	uint32_t gen;
+
+	/* An invalid message rejects the whole run */
+	fill_msgs(100);
+	msgs[NUM / 2].masklen = 33;
+	gen = flow_gen();
+	CU_ASSERT_EQUAL(ofp_set_route_msgs(msgs, NUM), -1);
+	CU_ASSERT_EQUAL(routes_found(100), 0);
+	CU_ASSERT_EQUAL(flow_gen(), gen);
+
+	/* As does a route that cannot be prepared, after the others were */
+	fill_msgs(100);
+	msgs[0].flags = OFP_RTF_MULTIPATH;
+	msgs[0].gw = NO_GROUP;
+	CU_ASSERT_EQUAL(ofp_set_route_msgs(msgs, NUM), -1);
+	CU_ASSERT_EQUAL(routes_found(100), 0);
+
+	/* Routes already there are kept as they were */
+	fill_msgs(1);
+	msgs[NUM - 1].masklen = 33;
+	CU_ASSERT_EQUAL(ofp_set_route_msgs(msgs, NUM), -1);
+	CU_ASSERT_EQUAL(routes_found(1), NUM);
+
+	/* The same run without the bad message goes in */
+	fill_msgs(100);
+	CU_ASSERT_EQUAL(ofp_set_route_msgs(msgs, NUM), 0);
+	CU_ASSERT_EQUAL(routes_found(100), NUM);
+}
+
+static void test_batch_each(void)
+{
+	/* Only the invalid message of a rejected run is lost */
+	fill_msgs(200);
+	msgs[NUM / 2].masklen = 33;
+	CU_ASSERT_EQUAL(ofp_set_route_msgs_each(msgs, NUM), 1);
+	CU_ASSERT_EQUAL(routes_found(200), NUM - 1);
+
+	fill_msgs(200);
+	CU_ASSERT_EQUAL(ofp_set_route_msgs_each(msgs, NUM), 0);
+	CU_ASSERT_EQUAL(routes_found(200), NUM);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp route msgs", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_batch_publish_once)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_batch_all_or_none)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_batch_each)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-route-msgs");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
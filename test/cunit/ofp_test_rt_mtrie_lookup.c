@@ -16,6 +16,7 @@
 #include "ofpi_log.h"
 #include "ofp_cunit_version.h"
 #include "ofpi_avl.h"
+#include "ofpi_btree.h"
 
 #if OFP_TESTMODE_AUTO
 #include <CUnit/Automated.h>
@@ -34,7 +35,7 @@
 #endif
 
 enum ofp_log_level_s log_level;
-void *shm, *shm_avl, *shm_rt_lookup;
+void *shm, *shm_avl, *shm_btree, *shm_rt_lookup;
 struct ofp_rtl_node root[] = { { 0 }, { 0 } };
 struct ofp_rtl_tree tree = { 0, root };
 struct ofp_nh_entry data = { 0 };
@@ -78,6 +79,8 @@ static void setup_with_shm(void)
 	ofp_set_custom_allocator(allocator);
 	ofp_avl_init_global();
 	shm_avl = shm;
+	ofp_btree_init_global();
+	shm_btree = shm;
 	ofp_rt_lookup_init_global();
 	shm_rt_lookup = shm;
 }
@@ -85,6 +88,7 @@ static void setup_with_shm(void)
 static void teardown_with_shm(void)
 {
 	free(shm_avl);
+	free(shm_btree);
 	free(shm_rt_lookup);
 	ofp_set_custom_allocator(NULL);
 }
@@ -289,6 +293,32 @@ static void test_rules_add_search_remove(void)
 	TEARDOWN_WITH_SHM;
 }
 
+static void test_rules_of_vrf_among_many(void)
+{
+	uint32_t masklen;
+
+	SETUP_WITH_SHM;
+
+	/* Enough rules around vrf 1 to split the rule tree nodes */
+	for (masklen = 1; masklen <= 32; masklen++) {
+		add_rule(0, masklen, 0);
+		add_rule(2, masklen, 2);
+	}
+	add_rule(1, 24, 1);
+	add_rule(1, 8, 1);
+
+	CU_ASSERT_STRING_EQUAL("[1,8,1][1,24,1]", print_rule(1));
+
+	for (masklen = 1; masklen <= 32; masklen++)
+		remove_rule(2, masklen);
+	remove_rule(1, 8);
+
+	CU_ASSERT_STRING_EQUAL("[1,24,1]", print_rule(1));
+	CU_ASSERT_STRING_EQUAL("", print_rule(2));
+
+	TEARDOWN_WITH_SHM;
+}
+
 static void test_adding_rule_when_rule_table_full(void)
 {
 	uint32_t i;
@@ -481,6 +511,162 @@ static void test_remove_route_with_second_level_mask_reinserted_when_covering_ru
 	TEARDOWN_WITH_SHM;
 }
 
+static void test_bulk_search_matches_single_search(void)
+{
+	struct ofp_rtl_tree t;
+	struct ofp_nh_entry nh_data[4];
+	struct ofp_nh_entry *nh[8];
+	const uint32_t addrs[8] = {
+		odp_cpu_to_be_32(0x0a000001), odp_cpu_to_be_32(0x0a010001),
+		odp_cpu_to_be_32(0x0a010101), odp_cpu_to_be_32(0x0a010180),
+		odp_cpu_to_be_32(0x0b000001), odp_cpu_to_be_32(0xc0a80001),
+		odp_cpu_to_be_32(0x0a0101ff), odp_cpu_to_be_32(0x00000000),
+	};
+	int i;
+
+	SETUP_WITH_SHM;
+
+	CU_ASSERT_EQUAL_FATAL(ofp_rtl_root_init(&t, 0), 0);
+
+	for (i = 0; i < 4; i++) {
+		memset(&nh_data[i], 0, sizeof(nh_data[i]));
+		nh_data[i].port = i + 1;
+	}
+	ofp_rtl_insert(&t, odp_cpu_to_be_32(0x0a000000), 8, &nh_data[0]);
+	ofp_rtl_insert(&t, odp_cpu_to_be_32(0x0a010000), 16, &nh_data[1]);
+	ofp_rtl_insert(&t, odp_cpu_to_be_32(0x0a010100), 24, &nh_data[2]);
+	ofp_rtl_insert(&t, odp_cpu_to_be_32(0x0a010180), 32, &nh_data[3]);
+
+	ofp_rtl_search_bulk(&t, addrs, nh, 8);
+
+	for (i = 0; i < 8; i++)
+		CU_ASSERT_PTR_EQUAL(nh[i], ofp_rtl_search(&t, addrs[i]));
+
+	CU_ASSERT_EQUAL(nh[0]->port, 1);
+	CU_ASSERT_EQUAL(nh[1]->port, 2);
+	CU_ASSERT_EQUAL(nh[2]->port, 3);
+	CU_ASSERT_EQUAL(nh[3]->port, 4);
+	CU_ASSERT_PTR_NULL(nh[4]);
+	CU_ASSERT_PTR_NULL(nh[5]);
+	CU_ASSERT_EQUAL(nh[6]->port, 3);
+	CU_ASSERT_PTR_NULL(nh[7]);
+
+	TEARDOWN_WITH_SHM;
+}
+
+static void test_insert_grows_node_pool(void)
+{
+	struct ofp_rtl_tree t;
+	struct ofp_nh_entry nh_data[8];
+	uint32_t addr;
+	int i;
+
+	SETUP_WITH_SHM;
+
+	/* Start over with room for one table and one more per segment */
+	free(shm_rt_lookup);
+	global_param->mtrie.table8_nodes = 1;
+	global_param->mtrie.table8_grow = 1;
+	ofp_rt_lookup_init_global();
+	shm_rt_lookup = shm;
+
+	CU_ASSERT_EQUAL_FATAL(ofp_rtl_root_init(&t, 0), 0);
+
+	for (i = 0; i < 8; i++) {
+		memset(&nh_data[i], 0, sizeof(nh_data[i]));
+		nh_data[i].port = i + 1;
+		addr = odp_cpu_to_be_32(0x0a000000 | (i << 16) | 0x100);
+		CU_ASSERT_PTR_NULL(ofp_rtl_insert(&t, addr, 24, &nh_data[i]));
+	}
+
+	for (i = 0; i < 8; i++) {
+		addr = odp_cpu_to_be_32(0x0a000000 | (i << 16) | 0x101);
+		CU_ASSERT_PTR_EQUAL(ofp_rtl_search(&t, addr), &nh_data[i]);
+	}
+
+	TEARDOWN_WITH_SHM;
+}
+
+static void check_lookup6(struct ofp_rtl6_tree *t, uint8_t addrs[][16],
+			  int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++)
+		CU_ASSERT_PTR_EQUAL(ofp_rtl_lookup6(t, addrs[i]),
+				    ofp_rtl_search6(t, addrs[i]));
+}
+
+static void test_lookup6_matches_search6(void)
+{
+	struct ofp_rtl6_tree t;
+	struct ofp_nh6_entry nh_data[5];
+	uint8_t prefix[5][16] = {
+		{ 0x20, 0x01, 0x0d, 0xb8 },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01 },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x02 },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x02,
+		  0, 0, 0, 0, 0, 0, 0, 0x01 },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x30 },
+	};
+	const uint32_t masklen[5] = { 32, 48, 64, 128, 60 };
+	uint8_t addrs[8][16] = {
+		{ 0x20, 0x01, 0x0d, 0xb8, 0xff },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0xff },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x02,
+		  0, 0, 0, 0, 0, 0, 0, 0x02 },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x02,
+		  0, 0, 0, 0, 0, 0, 0, 0x01 },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x3f },
+		{ 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01, 0x00, 0x40 },
+		{ 0x20, 0x02 },
+		{ 0 },
+	};
+	void *shm_rt6_mtrie;
+	int i;
+
+	SETUP_WITH_SHM;
+
+	CU_ASSERT_EQUAL_FATAL(ofp_rt6_mtrie_init_global(), 0);
+	shm_rt6_mtrie = shm;
+	CU_ASSERT_EQUAL_FATAL(ofp_rtl6_init(&t), 0);
+	CU_ASSERT_PTR_NOT_NULL(t.mtrie);
+
+	for (i = 0; i < 5; i++) {
+		memset(&nh_data[i], 0, sizeof(nh_data[i]));
+		nh_data[i].port = i + 1;
+		CU_ASSERT_PTR_NULL(ofp_rtl_insert6(&t, prefix[i], masklen[i],
+						   &nh_data[i]));
+	}
+	check_lookup6(&t, addrs, 8);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[0])->port, 1);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[1])->port, 2);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[2])->port, 3);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[3])->port, 4);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[4])->port, 5);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[5])->port, 2);
+	CU_ASSERT_PTR_NULL(ofp_rtl_lookup6(&t, addrs[6]));
+
+	/* Default route */
+	memset(&nh_data[0], 0, sizeof(nh_data[0]));
+	CU_ASSERT_PTR_NULL(ofp_rtl_insert6(&t, addrs[7], 0, &nh_data[0]));
+	check_lookup6(&t, addrs, 8);
+
+	CU_ASSERT_PTR_NOT_NULL(ofp_rtl_remove6(&t, prefix[2], masklen[2]));
+	CU_ASSERT_PTR_NOT_NULL(ofp_rtl_remove6(&t, prefix[1], masklen[1]));
+	check_lookup6(&t, addrs, 8);
+	CU_ASSERT_EQUAL(ofp_rtl_lookup6(&t, addrs[2])->port, 1);
+
+	for (i = 0; i < 5; i++)
+		(void)ofp_rtl_remove6(&t, prefix[i], masklen[i]);
+	(void)ofp_rtl_remove6(&t, addrs[7], 0);
+	check_lookup6(&t, addrs, 8);
+	CU_ASSERT_PTR_NULL(ofp_rtl_lookup6(&t, addrs[3]));
+
+	free(shm_rt6_mtrie);
+	TEARDOWN_WITH_SHM;
+}
+
 static char *const_cast(const char *str)
 {
 	return (char *)(uintptr_t)str;
@@ -515,6 +701,8 @@ int main(void)
 		  test_adding_rule_updates_existing },
 		{ const_cast("Add remove and search rules"),
 		  test_rules_add_search_remove },
+		{ const_cast("Rules of a vrf among many other rules"),
+		  test_rules_of_vrf_among_many },
 		{ const_cast("Add rule when rule table is full"),
 		  test_adding_rule_when_rule_table_full },
 		{ const_cast("Removing unset rule does nothing"),
@@ -531,6 +719,12 @@ int main(void)
 		  test_remove_route_reinserted_when_covering_rule_exist},
 		{ const_cast("Remove route with second level mask reinserted when there exists a different rule covering the rule being deleted"),
 		  test_remove_route_with_second_level_mask_reinserted_when_covering_rule_exist},
+		{ const_cast("Bulk search returns the same next hops as single search"),
+		  test_bulk_search_matches_single_search },
+		{ const_cast("Insert grows the node pool when it runs out"),
+		  test_insert_grows_node_pool },
+		{ const_cast("IPv6 mtrie lookup returns the same next hops as trie search"),
+		  test_lookup6_matches_search6 },
 		CU_TEST_INFO_NULL,
 	};
 
@@ -0,0 +1,270 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_portconf.h>
+#include <ofpi_pkt_processing.h>
+#include <ofpi_stat.h>
+
+#define PACE_MAX	4
+#define QUEUE_SIZE	64
+#define PKT_LEN		64
+/* Wider than a wheel slot */
+#define GAP_NS		100000
+
+static uint32_t port = 0, vlan = 0, vrf = 0;
+static uint32_t dev_ip = 0x650AA8C0;   /* C0.A8.0A.65 = 192.168.10.101 */
+static struct ofp_ifnet *dev;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+	odp_queue_param_t qparam;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.pkt_tx_burst_size = 1;
+	params.pkt_tx_pace_max = PACE_MAX;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+	/* The test polls ofp_send_pending_pkt() as a dispatcher does */
+	ofp_send_pace_poll(1);
+
+	ofp_config_interface_up_v4(port, vlan, vrf, dev_ip, 24);
+	dev = ofp_get_ifnet(port, vlan);
+
+	odp_queue_param_init(&qparam);
+	qparam.size = QUEUE_SIZE;
+	dev->outq_def = odp_queue_create("out default queue:0", &qparam);
+	if (dev->outq_def == ODP_QUEUE_INVALID) {
+		OFP_ERR("Out default queue create failed.\n");
+		return -1;
+	}
+	dev->out_queue_num = 1;
+	dev->out_queue_type = OFP_OUT_QUEUE_TYPE_QUEUE;
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	odp_event_t ev;
+
+	while ((ev = odp_queue_deq(dev->outq_def)) != ODP_EVENT_INVALID)
+		odp_event_free(ev);
+	odp_queue_destroy(dev->outq_def);
+	ofp_term_local();
+	return 0;
+}
+
+static uint64_t now_ns(void)
+{
+	return odp_time_to_ns(odp_time_global());
+}
+
+static void wait_until(uint64_t ns)
+{
+	while (now_ns() < ns)
+		ofp_send_pending_pkt();
+}
+
+/* A packet to depart at tx_time, not paced if 0 */
+static odp_packet_t make_pkt(uint8_t mark, uint64_t tx_time)
+{
+	odp_packet_t pkt = ofp_packet_alloc(PKT_LEN);
+	struct ofp_packet_user_area *ua;
+
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	*(uint8_t *)odp_packet_data(pkt) = mark;
+	if (tx_time) {
+		ua = ofp_packet_user_area(pkt);
+		ua->valid |= OFP_UA_PACE;
+		ua->tx_time = tx_time;
+	}
+	return pkt;
+}
+
+/* Dequeue the packets sent, return their marks */
+static int drain_queue(uint8_t *mark)
+{
+	odp_event_t ev;
+	odp_packet_t pkt;
+	int n = 0;
+
+	while ((ev = odp_queue_deq(dev->outq_def)) != ODP_EVENT_INVALID) {
+		pkt = odp_packet_from_event(ev);
+		if (n < QUEUE_SIZE)
+			mark[n++] = *(uint8_t *)odp_packet_data(pkt);
+		odp_packet_free(pkt);
+	}
+	return n;
+}
+
+static uint64_t paced(void)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+
+	return st ? st->per_thr[odp_thread_id()].tx_paced : 0;
+}
+
+static void test_pace_release_order(void)
+{
+	uint8_t mark[QUEUE_SIZE];
+	uint64_t held = paced();
+	uint64_t t0;
+
+	/* Due and unpaced packets go at once */
+	t0 = now_ns();
+	send_pkt_out(dev, make_pkt(1, t0));
+	send_pkt_out(dev, make_pkt(2, 0));
+	CU_ASSERT_EQUAL_FATAL(drain_queue(mark), 2);
+	CU_ASSERT_EQUAL(mark[0], 1);
+	CU_ASSERT_EQUAL(mark[1], 2);
+	CU_ASSERT_EQUAL(paced(), held);
+	CU_ASSERT_EQUAL(ofp_send_pending_wait(), ODP_SCHED_WAIT);
+
+	/* Later departures are held, released by time, not by arrival */
+	t0 = now_ns();
+	send_pkt_out(dev, make_pkt(3, t0 + 2 * GAP_NS));
+	send_pkt_out(dev, make_pkt(4, t0 + GAP_NS));
+	send_pkt_out(dev, make_pkt(5, t0 + 2 * GAP_NS));
+	CU_ASSERT_EQUAL(paced() - held, 3);
+	ofp_send_pending_pkt();
+	if (now_ns() < t0 + GAP_NS / 2)
+		CU_ASSERT_EQUAL(drain_queue(mark), 0);
+
+	/* The scheduler does not sleep past a wheel slot */
+	CU_ASSERT(ofp_send_pending_wait() != ODP_SCHED_WAIT);
+	CU_ASSERT(ofp_send_pending_wait() <=
+		  odp_schedule_wait_time(GAP_NS));
+
+	wait_until(t0 + GAP_NS + GAP_NS / 2);
+	CU_ASSERT_EQUAL_FATAL(drain_queue(mark), 1);
+	CU_ASSERT_EQUAL(mark[0], 4);
+
+	/* Those of a slot keep their order */
+	wait_until(t0 + 3 * GAP_NS);
+	CU_ASSERT_EQUAL_FATAL(drain_queue(mark), 2);
+	CU_ASSERT_EQUAL(mark[0], 3);
+	CU_ASSERT_EQUAL(mark[1], 5);
+	CU_ASSERT_EQUAL(ofp_send_pending_wait(), ODP_SCHED_WAIT);
+}
+
+static void test_pace_full(void)
+{
+	uint8_t mark[QUEUE_SIZE];
+	uint64_t held = paced();
+	uint64_t t0;
+	int i;
+
+	/* A full wheel sends at once rather than drop */
+	t0 = now_ns();
+	for (i = 0; i < PACE_MAX + 2; i++)
+		send_pkt_out(dev, make_pkt(i, t0 + GAP_NS));
+	CU_ASSERT_EQUAL(paced() - held, PACE_MAX);
+	CU_ASSERT_EQUAL_FATAL(drain_queue(mark), 2);
+	CU_ASSERT_EQUAL(mark[0], PACE_MAX);
+	CU_ASSERT_EQUAL(mark[1], PACE_MAX + 1);
+
+	/* And takes packets again once released */
+	wait_until(t0 + 2 * GAP_NS);
+	CU_ASSERT_EQUAL_FATAL(drain_queue(mark), PACE_MAX);
+	for (i = 0; i < PACE_MAX; i++)
+		CU_ASSERT_EQUAL(mark[i], i);
+
+	t0 = now_ns();
+	send_pkt_out(dev, make_pkt(0, t0 + GAP_NS));
+	CU_ASSERT_EQUAL(paced() - held, PACE_MAX + 1);
+	wait_until(t0 + 2 * GAP_NS);
+	CU_ASSERT_EQUAL(drain_queue(mark), 1);
+
+	/* Threads that do not poll send paced packets at once */
+	ofp_send_pace_poll(0);
+	send_pkt_out(dev, make_pkt(0, now_ns() + GAP_NS));
+	CU_ASSERT_EQUAL(drain_queue(mark), 1);
+	CU_ASSERT_EQUAL(paced() - held, PACE_MAX + 1);
+	ofp_send_pace_poll(1);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp send pace", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_pace_release_order)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_pace_full)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-send-pace");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
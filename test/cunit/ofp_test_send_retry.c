@@ -0,0 +1,237 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_portconf.h>
+#include <ofpi_pkt_processing.h>
+#include <ofpi_stat.h>
+
+#define RETRY_MAX	4
+#define QUEUE_SIZE	8
+#define QUEUE_PROBE	1024
+#define PKT_LEN		64
+#define FILLER		0xff
+
+static uint32_t port = 0, vlan = 0, vrf = 0;
+static uint32_t dev_ip = 0x650AA8C0;   /* C0.A8.0A.65 = 192.168.10.101 */
+static struct ofp_ifnet *dev;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+	odp_queue_param_t qparam;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.pkt_tx_burst_size = 1;
+	params.pkt_tx_retry_max = RETRY_MAX;
+	/* Nothing ages out while the test runs */
+	params.pkt_tx_retry_ns = 1000000000;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	ofp_config_interface_up_v4(port, vlan, vrf, dev_ip, 24);
+	dev = ofp_get_ifnet(port, vlan);
+
+	odp_queue_param_init(&qparam);
+	qparam.size = QUEUE_SIZE;
+	dev->outq_def = odp_queue_create("out default queue:0", &qparam);
+	if (dev->outq_def == ODP_QUEUE_INVALID) {
+		OFP_ERR("Out default queue create failed.\n");
+		return -1;
+	}
+	dev->out_queue_num = 1;
+	dev->out_queue_type = OFP_OUT_QUEUE_TYPE_QUEUE;
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	odp_event_t ev;
+
+	while ((ev = odp_queue_deq(dev->outq_def)) != ODP_EVENT_INVALID)
+		odp_event_free(ev);
+	odp_queue_destroy(dev->outq_def);
+	ofp_term_local();
+	return 0;
+}
+
+static odp_packet_t make_pkt(uint8_t mark)
+{
+	odp_packet_t pkt = ofp_packet_alloc(PKT_LEN);
+
+	if (pkt != ODP_PACKET_INVALID)
+		*(uint8_t *)odp_packet_data(pkt) = mark;
+	return pkt;
+}
+
+/* Fill the output queue directly, return the number of packets taken */
+static int fill_queue(void)
+{
+	odp_packet_t pkt;
+	int num;
+
+	for (num = 0; num < QUEUE_PROBE; num++) {
+		pkt = make_pkt(FILLER);
+		if (pkt == ODP_PACKET_INVALID)
+			break;
+		if (odp_queue_enq(dev->outq_def, odp_packet_to_event(pkt))) {
+			odp_packet_free(pkt);
+			break;
+		}
+	}
+	return num;
+}
+
+/* Dequeue num packets, return the marks of those that are not fillers */
+static int drain_queue(int num, uint8_t *mark)
+{
+	odp_event_t ev;
+	odp_packet_t pkt;
+	int i, n = 0;
+
+	for (i = 0; i < num; i++) {
+		ev = odp_queue_deq(dev->outq_def);
+		if (ev == ODP_EVENT_INVALID)
+			break;
+		pkt = odp_packet_from_event(ev);
+		if (*(uint8_t *)odp_packet_data(pkt) != FILLER)
+			mark[n++] = *(uint8_t *)odp_packet_data(pkt);
+		odp_packet_free(pkt);
+	}
+	return n;
+}
+
+static uint64_t retry_full_drops(void)
+{
+	uint64_t drop[OFP_DROP_REASON_MAX];
+
+	ofp_get_drop_statistics(drop);
+	return drop[OFP_DROP_TX_RETRY_FULL];
+}
+
+static uint64_t retry_kept(void)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+
+	return st ? st->per_thr[odp_thread_id()].tx_retry : 0;
+}
+
+static void test_retry_fill_drain_overflow(void)
+{
+	uint8_t mark[QUEUE_PROBE];
+	uint64_t drops, kept;
+	int cap, i;
+
+	drops = retry_full_drops();
+	kept = retry_kept();
+
+	cap = fill_queue();
+	CU_ASSERT_FATAL(cap > 0 && cap < QUEUE_PROBE);
+
+	/* The queue is full: the backlog fills up, the rest is dropped */
+	for (i = 0; i < RETRY_MAX + 2; i++)
+		CU_ASSERT_EQUAL(send_pkt_out(dev, make_pkt(i)),
+				OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL(retry_kept() - kept, RETRY_MAX);
+	CU_ASSERT_EQUAL(retry_full_drops() - drops, 2);
+
+	/* Still full, nothing is lost on the retry */
+	ofp_send_pending_pkt();
+	CU_ASSERT_EQUAL(retry_full_drops() - drops, 2);
+
+	/* Room again: the backlog goes out first, in order */
+	CU_ASSERT_EQUAL(drain_queue(cap, mark), 0);
+	ofp_send_pending_pkt();
+	CU_ASSERT_EQUAL(send_pkt_out(dev, make_pkt(RETRY_MAX + 2)),
+			OFP_PKT_PROCESSED);
+	CU_ASSERT_EQUAL_FATAL(drain_queue(cap, mark), RETRY_MAX + 1);
+	for (i = 0; i < RETRY_MAX; i++)
+		CU_ASSERT_EQUAL(mark[i], i);
+	CU_ASSERT_EQUAL(mark[RETRY_MAX], RETRY_MAX + 2);
+
+	/* The backlog is empty, nothing more to send */
+	ofp_send_pending_pkt();
+	CU_ASSERT_EQUAL(drain_queue(cap, mark), 0);
+	CU_ASSERT_EQUAL(retry_kept() - kept, RETRY_MAX);
+	CU_ASSERT_EQUAL(retry_full_drops() - drops, 2);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp send retry", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_retry_fill_drain_overflow)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-send-retry");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -21,6 +21,9 @@
 #include <odp_api.h>
 #include "../../src/ofp_stat.c"
 
+/* The interface counters are sized by if_max */
+static ofp_global_param_t params = { .if_max = OFP_FP_INTERFACE_MAX };
+
 /*
  * INIT
  */
@@ -41,6 +44,7 @@ init_suite(void)
 		return -1;
 	}
 
+	global_param = &params;
 	if (ofp_stat_init_global()) {
 		OFP_ERR("Error: Fail to initialize statistics.\n");
 		return -1;
@@ -81,6 +85,86 @@ test_packet_statistics(void)
 	CU_ASSERT_EQUAL(st->per_thr[odp_thread_id()].rx_fp, 4);
 }
 
+static void
+test_drop_statistics(void)
+{
+	uint64_t drop[OFP_DROP_REASON_MAX];
+
+	ofp_get_drop_statistics(drop);
+	CU_ASSERT_EQUAL(drop[OFP_DROP_IP_NO_ROUTE], 0);
+
+	OFP_DROP_STAT(IP_NO_ROUTE);
+	OFP_DROP_STAT(IP_NO_ROUTE);
+	OFP_DROP_STAT(TX_PKTOUT);
+
+	ofp_get_drop_statistics(drop);
+	CU_ASSERT_EQUAL(drop[OFP_DROP_IP_NO_ROUTE], 2);
+	CU_ASSERT_EQUAL(drop[OFP_DROP_TX_PKTOUT], 1);
+	CU_ASSERT_EQUAL(drop[OFP_DROP_INPUT], 0);
+
+	CU_ASSERT_STRING_EQUAL(ofp_drop_reason_str(OFP_DROP_IP_NO_ROUTE),
+			       "no route");
+	CU_ASSERT_PTR_NULL(ofp_drop_reason_str(OFP_DROP_REASON_MAX));
+}
+
+static void
+test_prof_statistics(void)
+{
+	struct ofp_packet_stat *st = ofp_get_packet_statistics();
+	int thr = odp_thread_id();
+	uint64_t sum = 0;
+	int i;
+
+	{
+		OFP_PROF_START(prof);
+
+		OFP_PROF_END(L4_INPUT, prof);
+	}
+	CU_ASSERT_EQUAL(st->per_thr[thr].prof_count[OFP_PROF_L4_INPUT], 0);
+
+	ofp_set_stat_flags(OFP_STAT_COMPUTE_PROFILE);
+	{
+		OFP_PROF_START(prof);
+
+		OFP_PROF_END_N(L4_INPUT, prof, 4);
+	}
+	ofp_set_stat_flags(0);
+
+	CU_ASSERT_EQUAL(st->per_thr[thr].prof_count[OFP_PROF_L4_INPUT], 4);
+	for (i = 0; i < OFP_PROF_SLICES; i++)
+		sum += st->per_thr[thr].prof_hist[OFP_PROF_L4_INPUT][i];
+	CU_ASSERT_EQUAL(sum, 4);
+	CU_ASSERT_STRING_EQUAL(ofp_prof_stage_str(OFP_PROF_TX_FLUSH),
+			       "tx flush");
+}
+
+static void
+test_if_statistics(void)
+{
+	struct ofp_ifnet ifnet;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(ofp_if_stat_thr);
+
+	memset(&ifnet, 0, sizeof(ifnet));
+	ifnet.stat_idx = 2;
+
+	OFP_IF_STAT_RX(&ifnet, 3, 300);
+	OFP_IF_STAT_TX(&ifnet, 1, 60);
+	OFP_IFQ_STAT_RX(1, 5, 2, 128);
+
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[2].rx_pkts, 3);
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[2].rx_bytes, 300);
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[2].tx_pkts, 1);
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[2].tx_bytes, 60);
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[1].rx_pkts, 0);
+	CU_ASSERT_EQUAL(ofp_ifq_stat_thr[OFP_IFQ_STAT_MAX + 5].rx_pkts, 2);
+	CU_ASSERT_EQUAL(ofp_ifq_stat_thr[OFP_IFQ_STAT_MAX + 5].rx_bytes, 128);
+
+	ofp_if_stat_clear(2);
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[2].rx_pkts, 0);
+	CU_ASSERT_EQUAL(ofp_if_stat_thr[2].tx_bytes, 0);
+}
+
 /*
  * Main
  */
@@ -111,6 +195,18 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_if_statistics)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_drop_statistics)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_prof_statistics)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 
 
 #if OFP_TESTMODE_AUTO
@@ -0,0 +1,442 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include "../../src/ofp_tcp_syncache.c"
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <api/ofp_socket.h>
+
+#define IRS	0x10203040
+#define NUM_MSS	((int)(sizeof(tcp_sc_msstab) / sizeof(int)))
+
+static struct socket *so;
+static struct in_conninfo inc;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+	int fd;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	/* The listening socket the cookies come back to */
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	so = ofp_get_sock_by_fd(fd);
+	if (!so) {
+		OFP_ERR("Socket create failed.\n");
+		return -1;
+	}
+
+	bzero(&inc, sizeof(inc));
+	inc.inc_laddr.s_addr = odp_cpu_to_be_32(0xc0a80a65);
+	inc.inc_faddr.s_addr = odp_cpu_to_be_32(0xc0a80a01);
+	inc.inc_lport = odp_cpu_to_be_16(80);
+	inc.inc_fport = odp_cpu_to_be_16(40000);
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* The ISS ofp_syncookie_respond() sends for the given counter value */
+static tcp_seq fast_cookie(struct in_conninfo *c, tcp_seq irs, uint32_t count,
+			   uint32_t mss)
+{
+	return (syncookie_fast_hash(c, irs, count, mss) & ~0x7) | mss;
+}
+
+/* The third packet of the handshake, acking iss */
+static void ack_of(struct ofp_tcphdr *th, tcp_seq irs, tcp_seq iss)
+{
+	bzero(th, sizeof(*th));
+	th->th_seq = irs + 1;
+	th->th_ack = iss + 1;
+	th->th_flags = OFP_TH_ACK;
+}
+
+static struct syncache *fast_lookup(struct in_conninfo *c, tcp_seq irs,
+				    tcp_seq iss, struct tcpopt *to,
+				    struct syncache *sc)
+{
+	struct ofp_tcphdr th;
+
+	ack_of(&th, irs, iss);
+	bzero(sc, sizeof(*sc));
+	return syncookie_fast_lookup(c, sc, to, &th, so);
+}
+
+static void test_syncookie_fast_valid(void)
+{
+	uint32_t count = time_uptime >> SYNCOOKIE_FAST_SHIFT;
+	struct syncache scs, *sc;
+	struct tcpopt to;
+	tcp_seq iss;
+	int mss;
+
+	bzero(&to, sizeof(to));
+
+	/* Every MSS index comes back as sent */
+	for (mss = 0; mss < NUM_MSS; mss++) {
+		iss = fast_cookie(&inc, IRS, count, mss);
+		sc = fast_lookup(&inc, IRS, iss, &to, &scs);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(sc);
+		CU_ASSERT_EQUAL(sc->sc_peer_mss, tcp_sc_msstab[mss]);
+		CU_ASSERT_EQUAL(sc->sc_irs, IRS);
+		CU_ASSERT_EQUAL(sc->sc_iss, iss);
+		CU_ASSERT(sc->sc_flags & SCF_NOOPT);
+	}
+
+	/* A cookie of the previous period is still good */
+	iss = fast_cookie(&inc, IRS, count - 1, 5);
+	CU_ASSERT_PTR_NOT_NULL(fast_lookup(&inc, IRS, iss, &to, &scs));
+
+	/* The options folded into the echoed timestamp */
+	to.to_flags = TOF_TS;
+	to.to_tsval = 1;
+	to.to_tsecr = 0x1000 | 0x20 | 0x10 | 7;
+	iss = fast_cookie(&inc, IRS, count, 6);
+	sc = fast_lookup(&inc, IRS, iss, &to, &scs);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(sc);
+	CU_ASSERT(sc->sc_flags & SCF_TIMESTAMP);
+	CU_ASSERT(sc->sc_flags & SCF_SACK);
+	CU_ASSERT(sc->sc_flags & SCF_WINSCALE);
+	CU_ASSERT_EQUAL(sc->sc_requested_s_scale, 7);
+	CU_ASSERT_EQUAL(sc->sc_tsreflect, 1);
+	CU_ASSERT_EQUAL(sc->sc_peer_mss, tcp_sc_msstab[6]);
+}
+
+static void test_syncookie_fast_reject(void)
+{
+	uint32_t count = time_uptime >> SYNCOOKIE_FAST_SHIFT;
+	struct in_conninfo other;
+	struct syncache scs;
+	struct tcpopt to;
+	tcp_seq iss;
+
+	bzero(&to, sizeof(to));
+	iss = fast_cookie(&inc, IRS, count, 4);
+	CU_ASSERT_PTR_NOT_NULL(fast_lookup(&inc, IRS, iss, &to, &scs));
+
+	/* Too old, or not yet valid */
+	CU_ASSERT_PTR_NULL(fast_lookup(&inc, IRS,
+				       fast_cookie(&inc, IRS, count - 2, 4),
+				       &to, &scs));
+	CU_ASSERT_PTR_NULL(fast_lookup(&inc, IRS,
+				       fast_cookie(&inc, IRS, count + 1, 4),
+				       &to, &scs));
+
+	/* Forged hash bits, or an MSS index other than the hashed one */
+	CU_ASSERT_PTR_NULL(fast_lookup(&inc, IRS, iss ^ 0x8, &to, &scs));
+	CU_ASSERT_PTR_NULL(fast_lookup(&inc, IRS, iss ^ 0x80000000, &to,
+				       &scs));
+	CU_ASSERT_PTR_NULL(fast_lookup(&inc, IRS, iss ^ 0x1, &to, &scs));
+
+	/* Another connection or initial sequence number */
+	CU_ASSERT_PTR_NULL(fast_lookup(&inc, IRS + 1, iss, &to, &scs));
+	other = inc;
+	other.inc_fport = odp_cpu_to_be_16(40001);
+	CU_ASSERT_PTR_NULL(fast_lookup(&other, IRS, iss, &to, &scs));
+	other = inc;
+	other.inc_faddr.s_addr ^= odp_cpu_to_be_32(1);
+	CU_ASSERT_PTR_NULL(fast_lookup(&other, IRS, iss, &to, &scs));
+}
+
+/* A cookie for a SYN of a peer advertising peer_mss, with options */
+static void make_cookie(struct syncache *sc, uint16_t peer_mss)
+{
+	struct syncache_head *sch = SCH_BASE;
+	uint32_t flowlabel = 0;
+
+	bzero(sc, sizeof(*sc));
+	sc->sc_inc = inc;
+	sc->sc_irs = IRS;
+	sc->sc_iss = 0x5a5a5a5d;
+	sc->sc_peer_mss = peer_mss;
+	sc->sc_flags = SCF_TIMESTAMP | SCF_SACK;
+	sc->sc_requested_s_scale = 7;
+	sc->sc_requested_r_scale = 3;
+
+	SCH_LOCK(sch);
+	syncookie_generate(sch, sc, &flowlabel);
+	SCH_UNLOCK(sch);
+}
+
+static struct syncache *lookup(struct in_conninfo *c, tcp_seq irs,
+			       tcp_seq iss, struct tcpopt *to,
+			       struct syncache *sc)
+{
+	struct syncache_head *sch = SCH_BASE;
+	struct ofp_tcphdr th;
+	struct syncache *ret;
+
+	ack_of(&th, irs, iss);
+	bzero(sc, sizeof(*sc));
+	SCH_LOCK(sch);
+	ret = syncookie_lookup(c, sch, sc, to, &th, so);
+	SCH_UNLOCK(sch);
+	return ret;
+}
+
+static void ts_echo(struct tcpopt *to, struct syncache *sent)
+{
+	bzero(to, sizeof(*to));
+	to->to_flags = TOF_TS;
+	to->to_tsval = 1;
+	to->to_tsecr = sent->sc_ts;
+}
+
+static void test_syncookie_generate_lookup(void)
+{
+	int clamp = max(ofp_tcp_mssopt(&inc), V_tcp_minmss);
+	struct syncache sent, scs, *sc;
+	struct tcpopt to;
+	int i;
+
+	/* The MSS is rounded down to the table and clamped by ours */
+	for (i = 1; i < NUM_MSS; i++) {
+		make_cookie(&sent, tcp_sc_msstab[i] + 1);
+		ts_echo(&to, &sent);
+		sc = lookup(&inc, IRS, sent.sc_iss, &to, &scs);
+		CU_ASSERT_PTR_NOT_NULL_FATAL(sc);
+		if (tcp_sc_msstab[i] <= clamp)
+			CU_ASSERT_EQUAL(sc->sc_peer_mss, tcp_sc_msstab[i]);
+		CU_ASSERT(sc->sc_peer_mss <= clamp);
+	}
+
+	/* The options come back from the timestamp */
+	make_cookie(&sent, 1460);
+	ts_echo(&to, &sent);
+	sc = lookup(&inc, IRS, sent.sc_iss, &to, &scs);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(sc);
+	CU_ASSERT_EQUAL(sc->sc_irs, IRS);
+	CU_ASSERT_EQUAL(sc->sc_iss, sent.sc_iss);
+	CU_ASSERT(sc->sc_flags & SCF_TIMESTAMP);
+	CU_ASSERT(sc->sc_flags & SCF_SACK);
+	CU_ASSERT(sc->sc_flags & SCF_WINSCALE);
+	CU_ASSERT_EQUAL(sc->sc_requested_s_scale, 7);
+	CU_ASSERT_EQUAL(sc->sc_requested_r_scale, 3);
+	CU_ASSERT_EQUAL(sc->sc_ts, sent.sc_ts);
+
+	/* Without timestamps only the ISS is checked */
+	bzero(&to, sizeof(to));
+	sc = lookup(&inc, IRS, sent.sc_iss, &to, &scs);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(sc);
+	CU_ASSERT(sc->sc_flags & SCF_NOOPT);
+	CU_ASSERT_FALSE(sc->sc_flags & SCF_SACK);
+}
+
+static void test_syncookie_reject(void)
+{
+	struct syncache_head *sch = SCH_BASE;
+	uint32_t saved[SYNCOOKIE_SECRET_SIZE];
+	uint32_t *secbits;
+	struct in_conninfo other;
+	struct syncache sent, scs;
+	struct tcpopt to;
+
+	make_cookie(&sent, 1460);
+	ts_echo(&to, &sent);
+	CU_ASSERT_PTR_NOT_NULL(lookup(&inc, IRS, sent.sc_iss, &to, &scs));
+
+	/* Forged digest or MSS bits of the ISS, or of the timestamp */
+	CU_ASSERT_PTR_NULL(lookup(&inc, IRS, sent.sc_iss ^ 0x80, &to, &scs));
+	CU_ASSERT_PTR_NULL(lookup(&inc, IRS, sent.sc_iss ^ 0x10, &to, &scs));
+	to.to_tsecr ^= 0x400;
+	CU_ASSERT_PTR_NULL(lookup(&inc, IRS, sent.sc_iss, &to, &scs));
+	ts_echo(&to, &sent);
+
+	/* Another connection or initial sequence number */
+	CU_ASSERT_PTR_NULL(lookup(&inc, IRS + 1, sent.sc_iss, &to, &scs));
+	other = inc;
+	other.inc_lport = odp_cpu_to_be_16(81);
+	CU_ASSERT_PTR_NULL(lookup(&other, IRS, sent.sc_iss, &to, &scs));
+
+	/* Stale: the secret of the cookie was reseeded since */
+	secbits = sch->sch_oddeven ?
+		sch->sch_secbits_odd : sch->sch_secbits_even;
+	memcpy(saved, secbits, sizeof(saved));
+	secbits[0] ^= 1;
+	CU_ASSERT_PTR_NULL(lookup(&inc, IRS, sent.sc_iss, &to, &scs));
+	memcpy(secbits, saved, sizeof(saved));
+	CU_ASSERT_PTR_NOT_NULL(lookup(&inc, IRS, sent.sc_iss, &to, &scs));
+
+	/* Stale: the secret outlived its lifetime */
+	sch->sch_reseed = time_uptime - 2 * SYNCOOKIE_LIFETIME;
+	if (time_uptime > 2 * SYNCOOKIE_LIFETIME)
+		CU_ASSERT_PTR_NULL(lookup(&inc, IRS, sent.sc_iss, &to, &scs));
+	sch->sch_reseed = time_uptime + SYNCOOKIE_LIFETIME;
+}
+
+static void test_tfo_server_cookie(void)
+{
+	uint8_t cookie[TCP_FASTOPEN_COOKIE_LEN];
+	uint8_t again[TCP_FASTOPEN_COOKIE_LEN];
+	struct in_conninfo other;
+	struct tcpopt to;
+
+	/* A cookie depends on the client address only */
+	syncache_tfo_cookie(&inc, cookie);
+	syncache_tfo_cookie(&inc, again);
+	CU_ASSERT_EQUAL(memcmp(cookie, again, sizeof(cookie)), 0);
+	other = inc;
+	other.inc_fport = odp_cpu_to_be_16(40001);
+	syncache_tfo_cookie(&other, again);
+	CU_ASSERT_EQUAL(memcmp(cookie, again, sizeof(cookie)), 0);
+	other.inc_faddr.s_addr = odp_cpu_to_be_32(0xc0a80a02);
+	syncache_tfo_cookie(&other, again);
+	CU_ASSERT_NOT_EQUAL(memcmp(cookie, again, sizeof(cookie)), 0);
+
+	bzero(&to, sizeof(to));
+	to.to_tfo_cookie = cookie;
+	to.to_tfo_len = TCP_FASTOPEN_COOKIE_LEN;
+	CU_ASSERT_TRUE(syncache_tfo_valid(&inc, &to));
+	CU_ASSERT_FALSE(syncache_tfo_valid(&other, &to));
+
+	/* Forged or short */
+	to.to_tfo_len = TCP_FASTOPEN_COOKIE_LEN - 1;
+	CU_ASSERT_FALSE(syncache_tfo_valid(&inc, &to));
+	to.to_tfo_len = TCP_FASTOPEN_COOKIE_LEN;
+	cookie[3] ^= 1;
+	CU_ASSERT_FALSE(syncache_tfo_valid(&inc, &to));
+}
+
+static void test_tfo_client_cache(void)
+{
+	uint8_t cookie[TCP_FASTOPEN_MAX_COOKIE_LEN] = { 1, 2, 3, 4, 5, 6 };
+	uint8_t got[TCP_FASTOPEN_MAX_COOKIE_LEN];
+	struct in_conninfo other;
+
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&inc, got), 0);
+
+	/* Cookies of any valid length are kept per server address */
+	ofp_tcp_fastopen_ccache_set(&inc, cookie, 8);
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&inc, got), 8);
+	CU_ASSERT_EQUAL(memcmp(got, cookie, 8), 0);
+	other = inc;
+	other.inc_faddr.s_addr = odp_cpu_to_be_32(0xc0a80a02);
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&other, got), 0);
+
+	ofp_tcp_fastopen_ccache_set(&inc, cookie, TCP_FASTOPEN_MAX_COOKIE_LEN);
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&inc, got),
+			TCP_FASTOPEN_MAX_COOKIE_LEN);
+	ofp_tcp_fastopen_ccache_set(&inc, cookie,
+				    TCP_FASTOPEN_MAX_COOKIE_LEN + 1);
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&inc, got),
+			TCP_FASTOPEN_MAX_COOKIE_LEN);
+
+	/* Forgetting another address keeps the cookie */
+	ofp_tcp_fastopen_ccache_set(&other, NULL, 0);
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&inc, got),
+			TCP_FASTOPEN_MAX_COOKIE_LEN);
+	ofp_tcp_fastopen_ccache_set(&inc, NULL, 0);
+	CU_ASSERT_EQUAL(ofp_tcp_fastopen_ccache_get(&inc, got), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp syn cookies", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_syncookie_fast_valid)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_syncookie_fast_reject)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_syncookie_generate_lookup)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_syncookie_reject)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_tfo_server_cookie)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_tfo_client_cache)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-syncookie");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
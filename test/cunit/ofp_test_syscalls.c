@@ -255,6 +255,68 @@ static void test_select_with_sleep_interrupting_fd(void)
 	TEARDOWN;
 }
 
+static void test_select_skips_fd_without_wakeup(void)
+{
+	SETUP;
+
+	const int fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, 0);
+	ofp_fd_set set;
+
+	OFP_FD_ZERO(&set);
+	OFP_FD_SET(fd, &set);
+	CU_ASSERT_EQUAL(select_readfds(fd + 1, &set), 0);
+
+	/* Found not ready, checked again only after a wakeup */
+	set_listening_socket_readable(fd);
+	OFP_FD_SET(fd, &set);
+	CU_ASSERT_EQUAL(select_readfds(fd + 1, &set), 0);
+
+	ofp_so_ready_set(ofp_get_sock_by_fd(fd), OFP_SO_RCV);
+	OFP_FD_SET(fd, &set);
+	CU_ASSERT_EQUAL(select_readfds(fd + 1, &set), 1);
+	CU_ASSERT_TRUE(OFP_FD_ISSET(fd, &set));
+
+	TEARDOWN;
+}
+
+static void test_poll_with_readable_fd(void)
+{
+	SETUP;
+
+	const int fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, 0);
+	struct ofp_pollfd fds[3] = {
+		{ .fd = fd, .events = OFP_POLLIN },
+		{ .fd = -1, .events = OFP_POLLIN },
+		{ .fd = OFP_SOCK_NUM_OFFSET + OFP_NUM_SOCKETS_MAX - 1,
+		  .events = OFP_POLLIN },
+	};
+
+	set_listening_socket_readable(fd);
+
+	CU_ASSERT_EQUAL(_ofp_poll(fds, 3, -1, sleeper_spy), 2);
+	CU_ASSERT_FALSE(sleeper_called);
+	CU_ASSERT_EQUAL(fds[0].revents, OFP_POLLIN);
+	CU_ASSERT_EQUAL(fds[1].revents, 0);
+	CU_ASSERT_EQUAL(fds[2].revents, OFP_POLLNVAL);
+
+	TEARDOWN;
+}
+
+static void test_poll_times_out(void)
+{
+	SETUP;
+
+	const int fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, 0);
+	struct ofp_pollfd pfd = { .fd = fd, .events = OFP_POLLIN };
+
+	CU_ASSERT_EQUAL(_ofp_poll(&pfd, 1, 5, sleeper_spy), 0);
+	CU_ASSERT_TRUE(sleeper_called);
+	CU_ASSERT_EQUAL(sleeper_timeout, 5000);
+	CU_ASSERT_EQUAL(pfd.revents, 0);
+
+	TEARDOWN;
+}
+
 static char *const_cast(const char *str)
 {
 	return (char *)(uintptr_t)str;
@@ -290,6 +352,12 @@ int main(void)
 		  test_select_with_already_readable_fd },
 		{ const_cast("Select returns the number of readable fds after sleep"),
 		  test_select_with_sleep_interrupting_fd },
+		{ const_cast("Select checks a socket found not ready after a wakeup"),
+		  test_select_skips_fd_without_wakeup },
+		{ const_cast("Poll reports readable and invalid fds"),
+		  test_poll_with_readable_fd },
+		{ const_cast("Poll sleeps for the timeout"),
+		  test_poll_times_out },
 		CU_TEST_INFO_NULL
 	};
 
@@ -409,5 +477,7 @@ int sleeper_fake(void *channel, odp_rwlock_t *mtx, int priority,
 	(void)wmesg;
 	(void)timeout;
 	set_listening_socket_readable(OFP_SOCK_NUM_OFFSET);
+	/* As data arrival does */
+	ofp_so_ready_set(ofp_get_sock_by_fd(OFP_SOCK_NUM_OFFSET), OFP_SO_RCV);
 	return 0;
 }
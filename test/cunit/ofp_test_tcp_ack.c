@@ -0,0 +1,299 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_util.h>
+#include <ofpi_init.h>
+#include <ofpi_portconf.h>
+#include <ofpi_pkt_processing.h>
+#include <ofpi_gro.h>
+#include <ofpi_socketvar.h>
+#include <ofpi_in_pcb.h>
+#include <ofpi_ip.h>
+#include <ofpi_tcp_var.h>
+#include <ofpi_tcp_fsm.h>
+#include <ofpi_tcp.h>
+#include <ofpi_tcp_timer.h>
+#include <ofpi_tcp_shm.h>
+#include <api/ofp_socket.h>
+
+#define PAYLOAD	100
+#define HDRLEN	(sizeof(struct ofp_ip) + sizeof(struct ofp_tcphdr))
+#define LPORT	80
+#define FPORT	40000
+#define ISS	1
+#define IRS	1000
+#define WIN	1024
+
+static uint32_t port = 0, vlan = 0, vrf = 0;
+static uint32_t dev_ip = 0x650AA8C0;   /* C0.A8.0A.65 = 192.168.10.101 */
+/* Off link, the ACKs are counted and dropped */
+static uint32_t peer_ip = 0x0100000A;  /* 0A.00.00.01 = 10.0.0.1 */
+static struct ofp_ifnet *dev;
+
+static int fd;
+static struct tcpcb *tp;
+static tcp_seq rcv_seq;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	ofp_config_interface_up_v4(port, vlan, vrf, dev_ip, 24);
+	dev = ofp_get_ifnet(port, vlan);
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* An established connection from dev_ip:LPORT to peer_ip:FPORT */
+static void setup(void)
+{
+	struct ofp_sockaddr_in sin;
+	struct inpcb *inp;
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(fd >= 0);
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_len = sizeof(sin);
+	sin.sin_family = OFP_AF_INET;
+	sin.sin_port = odp_cpu_to_be_16(LPORT);
+	sin.sin_addr.s_addr = dev_ip;
+	CU_ASSERT_EQUAL_FATAL(ofp_bind(fd, (struct ofp_sockaddr *)&sin,
+				       sizeof(sin)), 0);
+
+	inp = sotoinpcb(ofp_get_sock_by_fd(fd));
+	INP_INFO_WLOCK(&V_tcbinfo);
+	INP_WLOCK(inp);
+	INP_HASH_WLOCK(&V_tcbinfo);
+	inp->inp_faddr.s_addr = peer_ip;
+	inp->inp_fport = odp_cpu_to_be_16(FPORT);
+	ofp_in_pcbrehash(inp);
+	INP_HASH_WUNLOCK(&V_tcbinfo);
+	INP_WUNLOCK(inp);
+	INP_INFO_WUNLOCK(&V_tcbinfo);
+
+	tp = intotcpcb(inp);
+	tp->t_state = TCPS_ESTABLISHED;
+	t_flags_and(tp->t_flags, ~(TF_REQ_TSTMP | TF_REQ_SCALE));
+	tp->t_maxseg = PAYLOAD;
+	tp->snd_una = tp->snd_nxt = tp->snd_max = ISS;
+	tp->snd_wnd = WIN;
+	tp->rcv_nxt = IRS;
+	tp->rcv_wnd = 65535;
+	tp->rcv_adv = IRS + tp->rcv_wnd;
+	rcv_seq = IRS;
+}
+
+static void teardown(void)
+{
+	/* Nothing to send on close, the peer is not reachable */
+	tp->t_state = TCPS_CLOSED;
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+}
+
+/* Pass the next full segment of the peer to TCP input */
+static void input_seg(void)
+{
+	odp_packet_t pkt = ofp_packet_alloc_from_pool(ofp_packet_pool,
+						       HDRLEN + PAYLOAD);
+	struct ofp_ip *ip;
+	struct ofp_tcphdr *th;
+
+	CU_ASSERT_FATAL(pkt != ODP_PACKET_INVALID);
+	odp_packet_l3_offset_set(pkt, 0);
+	odp_packet_l4_offset_set(pkt, sizeof(struct ofp_ip));
+	odp_packet_user_ptr_set(pkt, dev);
+
+	ip = odp_packet_data(pkt);
+	memset(ip, 0, HDRLEN + PAYLOAD);
+	ip->ip_v = OFP_IPVERSION;
+	ip->ip_hl = sizeof(struct ofp_ip) >> 2;
+	ip->ip_len = odp_cpu_to_be_16(HDRLEN + PAYLOAD);
+	ip->ip_ttl = 64;
+	ip->ip_p = OFP_IPPROTO_TCP;
+	ip->ip_src.s_addr = peer_ip;
+	ip->ip_dst.s_addr = dev_ip;
+
+	th = (struct ofp_tcphdr *)(ip + 1);
+	th->th_sport = odp_cpu_to_be_16(FPORT);
+	th->th_dport = odp_cpu_to_be_16(LPORT);
+	th->th_seq = odp_cpu_to_be_32(rcv_seq);
+	th->th_ack = odp_cpu_to_be_32(ISS);
+	th->th_off = sizeof(*th) >> 2;
+	th->th_flags = OFP_TH_ACK;
+	th->th_win = odp_cpu_to_be_16(WIN);
+	th->th_sum = ofp_in4_cksum(pkt);
+	rcv_seq += PAYLOAD;
+
+	if (ofp_tcp_input(&pkt, sizeof(struct ofp_ip)) != OFP_PKT_PROCESSED)
+		odp_packet_free(pkt);
+}
+
+/* ACKs sent for num segments, in a receive burst if burst is set */
+static uint64_t acks_for(int num, int burst)
+{
+	uint64_t acks = V_tcpstat.tcps_sndacks;
+	int i;
+
+	if (burst)
+		ofp_gro_burst_begin();
+	for (i = 0; i < num; i++)
+		input_seg();
+	if (burst) {
+		/* Nothing is sent before the burst ends */
+		if (V_tcp_ack_coalesce)
+			CU_ASSERT_EQUAL(V_tcpstat.tcps_sndacks, acks);
+		ofp_gro_burst_end();
+		CU_ASSERT(!(tp->t_flags & TF_ACKQUEUED));
+	}
+	CU_ASSERT_EQUAL(tp->rcv_nxt, rcv_seq);
+	return V_tcpstat.tcps_sndacks - acks;
+}
+
+static void test_ack_flush(void)
+{
+	setup();
+
+	/* Every second full segment is acknowledged at once */
+	CU_ASSERT_EQUAL(acks_for(4, 0), 2);
+
+	/* Once per connection and burst */
+	CU_ASSERT_EQUAL(acks_for(4, 1), 1);
+	CU_ASSERT_EQUAL(acks_for(6, 1), 1);
+
+	/* Unless turned off */
+	V_tcp_ack_coalesce = 0;
+	CU_ASSERT_EQUAL(acks_for(4, 1), 2);
+	V_tcp_ack_coalesce = 1;
+
+	/* A single segment waits for the delayed ACK timer */
+	CU_ASSERT_EQUAL(acks_for(1, 1), 0);
+	CU_ASSERT(tp->t_flags & TF_DELACK ||
+		  ofp_tcp_timer_active(tp, TT_DELACK));
+
+	teardown();
+}
+
+static void test_ack_with_data(void)
+{
+	uint64_t acks, pkts;
+	char data[10];
+
+	setup();
+
+	/* The ACK goes with data sent before the burst ends */
+	acks = V_tcpstat.tcps_sndacks;
+	ofp_gro_burst_begin();
+	input_seg();
+	input_seg();
+	CU_ASSERT(tp->t_flags & TF_ACKQUEUED);
+	CU_ASSERT(tp->t_flags & TF_ACKNOW);
+
+	memset(data, 0, sizeof(data));
+	pkts = V_tcpstat.tcps_sndpack;
+	CU_ASSERT_EQUAL(ofp_send(fd, data, sizeof(data), 0),
+			(ofp_ssize_t)sizeof(data));
+	CU_ASSERT_EQUAL(V_tcpstat.tcps_sndpack, pkts + 1);
+	CU_ASSERT(!(tp->t_flags & TF_ACKNOW));
+
+	ofp_gro_burst_end();
+	CU_ASSERT_EQUAL(V_tcpstat.tcps_sndacks, acks);
+	CU_ASSERT(!(tp->t_flags & TF_ACKQUEUED));
+
+	teardown();
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp tcp ack coalescing", init_suite,
+				 clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ack_flush)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ack_with_data)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-tcp-ack");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -0,0 +1,407 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_util.h>
+#include <ofpi_systm.h>
+#include <ofpi_cc.h>
+#include <ofpi_tcp_var.h>
+#include <ofpi_tcp_fsm.h>
+#include <api/ofp_socket.h>
+#include <api/ofp_sysctl.h>
+#include <api/ofp_errno.h>
+
+#define MSS 1000
+/* Initial window of RFC 3390 for MSS */
+#define IW (4 * MSS)
+
+static struct tcpcb tp;
+static struct cc_var ccv;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/*
+ * The hooks are called as TCP input and output do, see cc_conn_init(),
+ * cc_ack_received() and ofp_cc_cong_signal(). data_sent() is not,
+ * the rate samples of BBR would depend on the timing of the test.
+ */
+
+/* An established connection with the initial window, as cc_conn_init() */
+static void conn_init(struct cc_algo *algo)
+{
+	memset(&tp, 0, sizeof(tp));
+	memset(&ccv, 0, sizeof(ccv));
+	tp.ccv = &ccv;
+	ccv.type = OFP_IPPROTO_TCP;
+	ccv.ccvc.tcp = &tp;
+	tp.t_state = TCPS_ESTABLISHED;
+	tp.t_maxseg = MSS;
+	tp.snd_wnd = 1 << 20;
+	tp.snd_ssthresh = (uint64_t)OFP_TCP_MAXWIN << OFP_TCP_MAX_WINSHIFT;
+	tp.snd_scale = OFP_TCP_MAX_WINSHIFT;
+	tp.snd_una = tp.snd_nxt = tp.snd_max = 1;
+
+	CC_ALGO(&tp) = algo;
+	if (algo->cb_init)
+		CU_ASSERT_EQUAL(algo->cb_init(&ccv), 0);
+	tp.snd_cwnd = IW;
+	if (algo->conn_init)
+		algo->conn_init(&ccv);
+}
+
+static void send_data(uint32_t len)
+{
+	tp.snd_max += len;
+	tp.snd_nxt = tp.snd_max;
+}
+
+/* An in sequence ACK of len bytes, as cc_ack_received() */
+static void ack(uint32_t len)
+{
+	tp.snd_una += len;
+	ccv.bytes_this_ack = len;
+	ccv.curack = tp.snd_una;
+	if (tp.snd_cwnd <= tp.snd_wnd)
+		ccv.flags |= CCF_CWND_LIMITED;
+	else
+		ccv.flags &= ~CCF_CWND_LIMITED;
+
+	if (tp.snd_cwnd > tp.snd_ssthresh) {
+		tp.t_bytes_acked += ulmin(len, V_tcp_abc_l_var * MSS);
+		if ((uint64_t)tp.t_bytes_acked >= tp.snd_cwnd) {
+			tp.t_bytes_acked -= tp.snd_cwnd;
+			ccv.flags |= CCF_ABC_SENTAWND;
+		}
+	} else {
+		ccv.flags &= ~CCF_ABC_SENTAWND;
+		tp.t_bytes_acked = 0;
+	}
+
+	CC_ALGO(&tp)->ack_received(&ccv, CC_ACK);
+}
+
+/* Send a window and ACK every segment of it */
+static void round_trip(void)
+{
+	uint64_t win = tp.snd_cwnd;
+	uint64_t i;
+
+	send_data(win);
+	for (i = 0; i < win / MSS; i++)
+		ack(MSS);
+}
+
+/* Fast recovery, ended by the ACK of everything sent before the loss */
+static void recover(uint32_t sent_in_recovery)
+{
+	ofp_cc_cong_signal(&tp, NULL, CC_NDUPACK);
+	CU_ASSERT(IN_FASTRECOVERY(tp.t_flags));
+
+	send_data(sent_in_recovery);
+	tp.snd_una = tp.snd_recover;
+	ccv.curack = tp.snd_una;
+	CC_ALGO(&tp)->post_recovery(&ccv);
+	EXIT_RECOVERY(tp.t_flags);
+}
+
+static void rto(void)
+{
+	tp.snd_cwnd_prev = tp.snd_cwnd;
+	t_flags_or(tp.t_flags, TF_PREVVALID);
+	tp.t_rxtshift = 1;
+	ofp_cc_cong_signal(&tp, NULL, CC_RTO);
+	tp.snd_nxt = tp.snd_una;
+}
+
+static void test_cc_newreno(void)
+{
+	uint64_t cwnd;
+
+	conn_init(&ofp_newreno_cc_algo);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, IW);
+
+	/* Slow start doubles the window every round trip */
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 2 * IW);
+	round_trip();
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 8 * IW);
+
+	/* Loss: half the window, restored when the recovery ends */
+	cwnd = tp.snd_cwnd;
+	send_data(cwnd);
+	recover(cwnd);
+	CU_ASSERT_EQUAL(tp.snd_ssthresh, cwnd / 2);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, cwnd / 2);
+
+	/* Congestion avoidance adds a segment per window of ACKs */
+	ack(MSS);
+	cwnd = tp.snd_cwnd;
+	CU_ASSERT_EQUAL(cwnd, tp.snd_ssthresh + MSS);
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, cwnd + MSS);
+
+	/* Timeout: back to one segment and slow start */
+	cwnd = tp.snd_cwnd;
+	rto();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, MSS);
+	CU_ASSERT_EQUAL(tp.snd_ssthresh, ulmax(2, cwnd / 2 / MSS) * MSS);
+	tp.snd_max = tp.snd_una;
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 2 * MSS);
+
+	/* An idle connection restarts from the initial window */
+	tp.snd_cwnd = 8 * IW;
+	CC_ALGO(&tp)->after_idle(&ccv);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, IW);
+}
+
+static void test_cc_cubic(void)
+{
+	uint64_t cwnd, max, w;
+	int i;
+
+	conn_init(&ofp_cubic_cc_algo);
+
+	/* Slow start as NewReno */
+	round_trip();
+	round_trip();
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 8 * IW);
+
+	/* The first loss halves ssthresh, cwnd goes to beta of the max */
+	max = tp.snd_cwnd;
+	send_data(max);
+	recover(max);
+	CU_ASSERT_EQUAL(tp.snd_ssthresh, max / 2);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, (204 * max) >> 8);
+
+	/* Concave growth towards the max, which is not passed while near */
+	tp.t_rttupdated = 8;
+	tp.t_srtt = 10 * TCP_RTT_SCALE;
+	cwnd = tp.snd_cwnd;
+	for (i = 0; i < 5; i++) {
+		w = tp.snd_cwnd;
+		round_trip();
+		CU_ASSERT(tp.snd_cwnd >= w);
+	}
+	CU_ASSERT(tp.snd_cwnd >= cwnd);
+	CU_ASSERT(tp.snd_cwnd <= max);
+
+	/* A loss below the previous max: beta ssthresh, fast convergence */
+	cwnd = tp.snd_cwnd;
+	CU_ASSERT_FATAL(cwnd < max);
+	send_data(cwnd);
+	recover(cwnd);
+	CU_ASSERT_EQUAL(tp.snd_ssthresh, (cwnd * 204) >> 8);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, (204 * ((cwnd * 230) >> 8)) >> 8);
+
+	rto();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, MSS);
+}
+
+static void test_cc_bbr(void)
+{
+	uint64_t cwnd, inflight;
+
+	conn_init(&ofp_bbr_cc_algo);
+
+	/* The initial window is paced over the default RTT of 1 ms */
+	CU_ASSERT(tp.t_pacing_rate >= IW * 1000 * 2);
+
+	/* Without a model startup grows cwnd by the bytes acked */
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 2 * IW);
+	round_trip();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 4 * IW);
+
+	/* A loss keeps what is in flight and does not shrink the window */
+	cwnd = tp.snd_cwnd;
+	send_data(cwnd);
+	inflight = tp.snd_max - tp.snd_una;
+	ofp_cc_cong_signal(&tp, NULL, CC_NDUPACK);
+	CU_ASSERT(IN_FASTRECOVERY(tp.t_flags));
+	CU_ASSERT_EQUAL(tp.snd_ssthresh, inflight);
+	ack(MSS);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, cwnd);
+
+	/* The window before the loss returns after the recovery */
+	tp.snd_cwnd = tp.snd_ssthresh / 2;
+	tp.snd_una = tp.snd_recover;
+	ccv.curack = tp.snd_una;
+	CC_ALGO(&tp)->post_recovery(&ccv);
+	EXIT_RECOVERY(tp.t_flags);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, cwnd);
+
+	/* After a timeout cwnd restarts at the minimum of the model */
+	rto();
+	CU_ASSERT_EQUAL(tp.snd_cwnd, MSS);
+	send_data(MSS);
+	ack(MSS);
+	CU_ASSERT_EQUAL(tp.snd_cwnd, 4 * MSS);
+
+	/* The pacing rate is the algorithm's to release */
+	CC_ALGO(&tp)->cb_destroy(&ccv);
+	CU_ASSERT_EQUAL(tp.t_pacing_rate, 0);
+}
+
+static int sysctl_algo(const char *set, char *get, size_t len)
+{
+	return ofp_sysctl("net.inet.tcp.cc.algorithm", get, &len,
+			  set, set ? strlen(set) + 1 : 0, NULL);
+}
+
+static void test_cc_select(void)
+{
+	char name[OFP_TCP_CA_NAME_MAX];
+	ofp_socklen_t len;
+	int fd;
+
+	CU_ASSERT_PTR_EQUAL(ofp_cc_algo_find("newreno"), &ofp_newreno_cc_algo);
+	CU_ASSERT_PTR_EQUAL(ofp_cc_algo_find("cubic"), &ofp_cubic_cc_algo);
+	CU_ASSERT_PTR_EQUAL(ofp_cc_algo_find("bbr"), &ofp_bbr_cc_algo);
+	CU_ASSERT_PTR_NULL(ofp_cc_algo_find("vegas"));
+
+	/* The default applies to new connections */
+	CU_ASSERT_EQUAL(sysctl_algo(NULL, name, sizeof(name)), 0);
+	CU_ASSERT_STRING_EQUAL(name, "newreno");
+	CU_ASSERT_NOT_EQUAL(sysctl_algo("vegas", NULL, 0), 0);
+	CU_ASSERT_EQUAL(sysctl_algo("cubic", NULL, 0), 0);
+	CU_ASSERT_PTR_EQUAL(CC_DEFAULT(), &ofp_cubic_cc_algo);
+
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(fd >= 0);
+	len = sizeof(name);
+	CU_ASSERT_EQUAL(ofp_getsockopt(fd, OFP_IPPROTO_TCP, OFP_TCP_CONGESTION,
+				       name, &len), 0);
+	CU_ASSERT_STRING_EQUAL(name, "cubic");
+
+	/* And the socket option to one connection */
+	CU_ASSERT_EQUAL(ofp_setsockopt(fd, OFP_IPPROTO_TCP, OFP_TCP_CONGESTION,
+				       "bbr", 4), 0);
+	len = sizeof(name);
+	CU_ASSERT_EQUAL(ofp_getsockopt(fd, OFP_IPPROTO_TCP, OFP_TCP_CONGESTION,
+				       name, &len), 0);
+	CU_ASSERT_STRING_EQUAL(name, "bbr");
+
+	CU_ASSERT_EQUAL(ofp_setsockopt(fd, OFP_IPPROTO_TCP, OFP_TCP_CONGESTION,
+				       "vegas", 6), -1);
+	CU_ASSERT_EQUAL(ofp_errno, OFP_EINVAL);
+	len = sizeof(name);
+	CU_ASSERT_EQUAL(ofp_getsockopt(fd, OFP_IPPROTO_TCP, OFP_TCP_CONGESTION,
+				       name, &len), 0);
+	CU_ASSERT_STRING_EQUAL(name, "bbr");
+
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+	CU_ASSERT_EQUAL(sysctl_algo("newreno", NULL, 0), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp tcp congestion control", init_suite,
+				 clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_cc_newreno)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_cc_cubic)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_cc_bbr)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_cc_select)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-tcp-cc");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
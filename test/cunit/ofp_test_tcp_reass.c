@@ -0,0 +1,329 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_util.h>
+#include <ofpi_socketvar.h>
+#include <ofpi_in_pcb.h>
+#include <ofpi_tcp_var.h>
+#include <ofpi_tcp_fsm.h>
+#include <ofpi_tcp.h>
+#include <ofpi_pkt_processing.h>
+#include <api/ofp_socket.h>
+
+/* Close to a wrap, so that the runs straddle it */
+#define ISS	0xffffffe0
+#define MAX_LEN	128
+/* Several segments of the packet pool */
+#define LONG_LEN	(4 * OFP_PKT_POOL_SEG_LEN_MIN + 100)
+
+static int fd;
+static struct tcpcb *tp;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.pkt_pool.seg_len = OFP_PKT_POOL_SEG_LEN_MIN;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* An established connection expecting ISS, fed by the tests below */
+static void setup(void)
+{
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(fd >= 0);
+	tp = sototcpcb(ofp_get_sock_by_fd(fd));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tp);
+	tp->t_state = TCPS_ESTABLISHED;
+	tp->t_maxseg = 16;
+	tp->rcv_nxt = ISS;
+}
+
+static void teardown(void)
+{
+	/* Nothing to send on close, there is no peer */
+	tp->t_state = TCPS_CLOSED;
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+}
+
+/* The byte at offset off of the stream */
+static uint8_t byte_at(uint32_t off)
+{
+	return (uint8_t)(off * 7 + 1);
+}
+
+/* Hand the segment of bytes [off, off + len) to the reassembly queue */
+static int seg(uint32_t off, int len, uint8_t flags)
+{
+	struct ofp_tcphdr th;
+	uint8_t data[LONG_LEN];
+	odp_packet_t m;
+	int i, ret;
+
+	CU_ASSERT_FATAL(len <= LONG_LEN);
+	m = ofp_packet_alloc(len);
+	CU_ASSERT_FATAL(m != ODP_PACKET_INVALID);
+	for (i = 0; i < len; i++)
+		data[i] = byte_at(off + i);
+	CU_ASSERT_FATAL(odp_packet_copy_from_mem(m, 0, len, data) == 0);
+
+	memset(&th, 0, sizeof(th));
+	th.th_seq = ISS + off;
+	th.th_flags = flags;
+
+	INP_WLOCK(tp->t_inpcb);
+	ret = ofp_tcp_reass(tp, &th, &len, m);
+	INP_WUNLOCK(tp->t_inpcb);
+	return ret;
+}
+
+/* The bytes presented to the socket are the stream from offset 0 */
+static void check_stream(uint32_t len)
+{
+	uint8_t buf[MAX_LEN];
+	uint32_t i;
+
+	CU_ASSERT_EQUAL(tp->rcv_nxt, ISS + len);
+	CU_ASSERT_EQUAL_FATAL(ofp_recv(fd, buf, sizeof(buf),
+				       OFP_MSG_PEEK | OFP_MSG_DONTWAIT),
+			      (ofp_ssize_t)len);
+	for (i = 0; i < len; i++)
+		if (buf[i] != byte_at(i))
+			break;
+	CU_ASSERT_EQUAL(i, len);
+}
+
+static void test_reass_out_of_order(void)
+{
+	setup();
+
+	CU_ASSERT_EQUAL(seg(48, 16, 0), 0);
+	CU_ASSERT_EQUAL(seg(16, 16, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 2);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 32);
+
+	/* The gap between two runs joins them into one */
+	CU_ASSERT_EQUAL(seg(32, 16, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 1);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 48);
+	CU_ASSERT_EQUAL(tp->rcv_nxt, ISS);
+
+	/* The missing head presents the whole run */
+	CU_ASSERT_EQUAL(seg(0, 16, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 0);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 0);
+	CU_ASSERT_PTR_NULL(OFP_LIST_FIRST(&tp->t_segq));
+	CU_ASSERT_PTR_NULL(RB_ROOT(&tp->t_segqtree));
+	check_stream(64);
+
+	teardown();
+}
+
+static void test_reass_overlap(void)
+{
+	setup();
+
+	/* A run covered by a later segment is replaced */
+	CU_ASSERT_EQUAL(seg(20, 10, 0), 0);
+	CU_ASSERT_EQUAL(seg(10, 30, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 1);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 30);
+
+	/* Head overlap with the run before */
+	CU_ASSERT_EQUAL(seg(30, 20, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 1);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 40);
+
+	/* Both ends overlap, the tail is trimmed and takes no FIN */
+	CU_ASSERT_EQUAL(seg(60, 20, 0), 0);
+	CU_ASSERT_EQUAL(seg(45, 25, OFP_TH_FIN), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 1);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 70);
+	CU_ASSERT_EQUAL(OFP_LIST_FIRST(&tp->t_segq)->tqe_flags, 0);
+	CU_ASSERT_EQUAL(odp_packet_len(OFP_LIST_FIRST(&tp->t_segq)->tqe_m),
+			70);
+
+	/* The FIN of the last segment is kept */
+	CU_ASSERT_EQUAL(seg(80, 8, OFP_TH_FIN), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 1);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 78);
+
+	/* And returned once the head arrives, trimmed at the tail */
+	CU_ASSERT_EQUAL(seg(0, 15, 0), OFP_TH_FIN);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 0);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 0);
+	check_stream(88);
+
+	teardown();
+}
+
+static void test_reass_duplicate(void)
+{
+	uint64_t dup;
+
+	setup();
+
+	CU_ASSERT_EQUAL(seg(16, 16, 0), 0);
+	CU_ASSERT_EQUAL(seg(40, 8, 0), 0);
+
+	/* Whole and partial duplicates of queued runs are dropped */
+	dup = V_tcpstat.tcps_rcvduppack;
+	CU_ASSERT_EQUAL(seg(16, 16, 0), 0);
+	CU_ASSERT_EQUAL(seg(20, 8, 0), 0);
+	CU_ASSERT_EQUAL(seg(40, 8, 0), 0);
+	CU_ASSERT_EQUAL(V_tcpstat.tcps_rcvduppack - dup, 3);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 2);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 24);
+
+	/* Only the run at the window edge is presented */
+	CU_ASSERT_EQUAL(seg(0, 16, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 1);
+	CU_ASSERT_EQUAL(tp->t_segqbytes, 8);
+	CU_ASSERT_EQUAL(tp->rcv_nxt, ISS + 32);
+
+	/* The gap, trimmed at the tail, brings in the rest */
+	CU_ASSERT_EQUAL(seg(32, 12, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 0);
+	check_stream(48);
+
+	/* In order data is not held back */
+	CU_ASSERT_EQUAL(seg(48, 8, 0), 0);
+	CU_ASSERT_EQUAL(tp->t_segqlen, 0);
+	check_stream(56);
+
+	teardown();
+}
+
+static void test_reass_multi_segment(void)
+{
+	uint8_t buf[LONG_LEN];
+	ofp_ssize_t n;
+	uint32_t off = 0, i;
+
+	setup();
+
+	CU_ASSERT_EQUAL(seg(0, LONG_LEN, 0), 0);
+	CU_ASSERT_EQUAL(tp->rcv_nxt, ISS + LONG_LEN);
+
+	/* Partial reads cut the head off beyond the first segment */
+	while (off < LONG_LEN) {
+		n = ofp_recv(fd, buf, 3 * OFP_PKT_POOL_SEG_LEN_MIN / 2,
+			     OFP_MSG_DONTWAIT);
+		CU_ASSERT_FATAL(n > 0);
+		for (i = 0; i < (uint32_t)n; i++)
+			if (buf[i] != byte_at(off + i))
+				break;
+		CU_ASSERT_EQUAL(i, (uint32_t)n);
+		off += n;
+	}
+	CU_ASSERT_EQUAL(off, LONG_LEN);
+	CU_ASSERT_EQUAL(ofp_get_sock_by_fd(fd)->so_rcv.sb_cc, 0);
+
+	teardown();
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp tcp reassembly", init_suite,
+				 clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass_out_of_order)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass_overlap)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass_duplicate)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_reass_multi_segment)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-tcp-reass");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
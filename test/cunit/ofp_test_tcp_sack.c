@@ -0,0 +1,332 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_util.h>
+#include <ofpi_socketvar.h>
+#include <ofpi_in_pcb.h>
+#include <ofpi_tcp_var.h>
+#include <ofpi_tcp_fsm.h>
+#include <ofpi_tcp.h>
+#include <api/ofp_socket.h>
+
+#define UNA	1000
+#define MAX	11000
+
+static int fd;
+static struct tcpcb *tp;
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* A connection with [UNA, MAX) in flight */
+static void setup(void)
+{
+	fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(fd >= 0);
+	tp = sototcpcb(ofp_get_sock_by_fd(fd));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(tp);
+	tp->t_state = TCPS_ESTABLISHED;
+	tp->snd_una = UNA;
+	tp->snd_nxt = MAX;
+	tp->snd_max = MAX;
+}
+
+static void teardown(void)
+{
+	INP_WLOCK(tp->t_inpcb);
+	ofp_tcp_free_sackholes(tp);
+	INP_WUNLOCK(tp->t_inpcb);
+	CU_ASSERT_EQUAL(tp->snd_numholes, 0);
+	tp->t_state = TCPS_CLOSED;
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+}
+
+/* An ACK of th_ack with the n SACK blocks of blk */
+static void doack(tcp_seq th_ack, const tcp_seq *blk, int n)
+{
+	uint32_t opt[2 * OFP_TCP_MAX_SACK];
+	struct tcpopt to;
+	int i;
+
+	memset(&to, 0, sizeof(to));
+	for (i = 0; i < 2 * n; i++)
+		opt[i] = odp_cpu_to_be_32(blk[i]);
+	if (n) {
+		to.to_flags = TOF_SACK;
+		to.to_nsacks = n;
+		to.to_sacks = (uint8_t *)opt;
+	}
+
+	INP_WLOCK(tp->t_inpcb);
+	ofp_tcp_sack_doack(tp, &to, th_ack);
+	INP_WUNLOCK(tp->t_inpcb);
+}
+
+/* The scoreboard holds the n holes of exp, in the list and the tree */
+static void check_holes(const tcp_seq *exp, int n)
+{
+	struct sackhole *p, *q;
+	int i = 0;
+
+	CU_ASSERT_EQUAL(tp->snd_numholes, n);
+	q = RB_MIN(sackhole_tree, &tp->snd_holes_tree);
+	OFP_TAILQ_FOREACH(p, &tp->snd_holes, scblink) {
+		CU_ASSERT_FATAL(i < n);
+		CU_ASSERT_EQUAL(p->start, exp[2 * i]);
+		CU_ASSERT_EQUAL(p->end, exp[2 * i + 1]);
+		CU_ASSERT_PTR_EQUAL(q, p);
+		q = RB_NEXT(sackhole_tree, &tp->snd_holes_tree, q);
+		i++;
+	}
+	CU_ASSERT_EQUAL(i, n);
+	CU_ASSERT_PTR_NULL(q);
+}
+
+static struct sackhole *next_hole(int *bytes)
+{
+	struct sackhole *p;
+
+	INP_WLOCK(tp->t_inpcb);
+	p = ofp_tcp_sack_output(tp, bytes);
+	INP_WUNLOCK(tp->t_inpcb);
+	return p;
+}
+
+/* snd_nxt after a timeout moved it back to nxt */
+static tcp_seq adjust(tcp_seq nxt)
+{
+	tp->snd_nxt = nxt;
+	INP_WLOCK(tp->t_inpcb);
+	ofp_tcp_sack_adjust(tp);
+	INP_WUNLOCK(tp->t_inpcb);
+	return tp->snd_nxt;
+}
+
+/* Retransmit all of the hole at tcp_ts_getticks() ts */
+static void rexmit(struct sackhole *p, uint32_t ts)
+{
+	tp->sackhint.sack_bytes_rexmit += p->end - p->rxmit;
+	p->rxmit = p->end;
+	p->rxmit_ts = ts;
+}
+
+static void test_sack_insert_merge(void)
+{
+	const tcp_seq below[] = { 500, 900 };
+	const tcp_seq b1[] = { 2000, 3000 };
+	const tcp_seq b2[] = { 5000, 6000, 2000, 3000 };
+	const tcp_seq b3[] = { 3500, 4000 };
+	const tcp_seq b4[] = { 4000, 5000 };
+	const tcp_seq b5[] = { 3200, 3500, 3000, 3100 };
+	const tcp_seq b6[] = { 3000, 6000 };
+	const tcp_seq h1[] = { 1000, 2000 };
+	const tcp_seq h2[] = { 1000, 2000, 3000, 5000 };
+	const tcp_seq h3[] = { 1000, 2000, 3000, 3500, 4000, 5000 };
+	const tcp_seq h4[] = { 1000, 2000, 3000, 3500 };
+	const tcp_seq h5[] = { 1000, 2000, 3100, 3200 };
+	const tcp_seq h6[] = { 3100, 3200 };
+	int bytes;
+
+	setup();
+
+	/* Blocks outside the window are ignored */
+	doack(UNA, below, 1);
+	check_holes(NULL, 0);
+
+	/* Blocks above fack append holes at the tail */
+	doack(UNA, b1, 1);
+	check_holes(h1, 1);
+	CU_ASSERT_EQUAL(tp->snd_fack, 3000);
+	doack(UNA, b2, 2);
+	check_holes(h2, 2);
+	CU_ASSERT_EQUAL(tp->snd_fack, 6000);
+	CU_ASSERT_PTR_EQUAL(next_hole(&bytes), OFP_TAILQ_FIRST(&tp->snd_holes));
+	CU_ASSERT_EQUAL(bytes, 0);
+
+	/* A block in the middle splits a hole, a whole one removes it */
+	doack(UNA, b3, 1);
+	check_holes(h3, 3);
+	doack(UNA, b4, 1);
+	check_holes(h4, 2);
+
+	/* SACKed data is not sent again after a timeout */
+	CU_ASSERT_EQUAL(adjust(2500), 3000);
+	CU_ASSERT_EQUAL(adjust(4000), 6000);
+	CU_ASSERT_EQUAL(adjust(1500), 1500);
+	tp->snd_nxt = MAX;
+
+	/* Blocks at either end trim a hole */
+	doack(UNA, b5, 2);
+	check_holes(h5, 2);
+	CU_ASSERT_EQUAL(tp->snd_fack, 6000);
+
+	/* The cumulative ACK takes the holes below it */
+	doack(2500, NULL, 0);
+	tp->snd_una = 2500;
+	check_holes(h6, 1);
+	CU_ASSERT_PTR_EQUAL(next_hole(&bytes), OFP_TAILQ_FIRST(&tp->snd_holes));
+
+	/* A block over everything left empties the scoreboard */
+	doack(2500, b6, 1);
+	check_holes(NULL, 0);
+	CU_ASSERT_PTR_NULL(tp->sackhint.nexthole);
+	CU_ASSERT_EQUAL(tp->sackhint.sack_bytes_rexmit, 0);
+
+	teardown();
+}
+
+/* Holes [1000, 1100) and [1200, 1300), both retransmitted, earlier first */
+static void two_rexmits(struct sackhole **a, struct sackhole **b)
+{
+	const tcp_seq blk[] = { 1100, 1200, 1300, 1400 };
+	const tcp_seq h[] = { 1000, 1100, 1200, 1300 };
+	int bytes;
+
+	doack(UNA, blk, 2);
+	check_holes(h, 2);
+	*a = OFP_TAILQ_FIRST(&tp->snd_holes);
+	*b = OFP_TAILQ_NEXT(*a, scblink);
+
+	CU_ASSERT_PTR_EQUAL(next_hole(&bytes), *a);
+	rexmit(*a, 10);
+	CU_ASSERT_PTR_EQUAL(next_hole(&bytes), *b);
+	CU_ASSERT_EQUAL(bytes, 100);
+	rexmit(*b, 100);
+	CU_ASSERT_PTR_NULL(next_hole(&bytes));
+	CU_ASSERT_EQUAL(bytes, 200);
+}
+
+static void test_sack_lost_rexmit(void)
+{
+	const tcp_seq blk[] = { 1200, 1300 };
+	struct sackhole *a, *b;
+	int bytes;
+
+	setup();
+	/* No RTT estimate, the reordering window is the minimum */
+	tp->t_srtt = 0;
+
+	/* The later retransmission arrived, the earlier one is lost */
+	two_rexmits(&a, &b);
+	doack(UNA, blk, 1);
+	CU_ASSERT_EQUAL(tp->snd_numholes, 1);
+	CU_ASSERT_EQUAL(a->rxmit, a->start);
+	CU_ASSERT_EQUAL(tp->sackhint.sack_bytes_rexmit, 0);
+	CU_ASSERT_PTR_EQUAL(next_hole(&bytes), a);
+	CU_ASSERT_EQUAL(bytes, 0);
+
+	INP_WLOCK(tp->t_inpcb);
+	ofp_tcp_free_sackholes(tp);
+	INP_WUNLOCK(tp->t_inpcb);
+
+	/* Without the detection it waits for the retransmit timer */
+	V_tcp_sack_rack = 0;
+	two_rexmits(&a, &b);
+	doack(UNA, blk, 1);
+	CU_ASSERT_EQUAL(tp->snd_numholes, 1);
+	CU_ASSERT_EQUAL(a->rxmit, a->end);
+	CU_ASSERT_EQUAL(tp->sackhint.sack_bytes_rexmit, 100);
+	CU_ASSERT_PTR_NULL(next_hole(&bytes));
+	V_tcp_sack_rack = 1;
+
+	teardown();
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp tcp sack", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_sack_insert_merge)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_sack_lost_rexmit)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-tcp-sack");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
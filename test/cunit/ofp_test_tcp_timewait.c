@@ -0,0 +1,351 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi_callout.h>
+
+/* The TIME_WAIT table runs on the clock of the test */
+static int now_ticks = 1000;
+#undef ticks
+#define ticks now_ticks
+
+#include "../../src/ofp_tcp_timewait.c"
+
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_util.h>
+#include <api/ofp_socket.h>
+
+#define TW_MAX	4
+#define LADDR	0x0a000001
+#define FADDR	0x0a000002
+#define LPORT	80
+#define SND_NXT	5000
+#define RCV_NXT	9000
+#define TS	100
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	params.tcp_tw_max = TW_MAX;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	ofp_term_local();
+	return 0;
+}
+
+/* A socket connected from LPORT to fport, as far as the tuple goes */
+static struct tcpcb *tuple_socket(int *fd, uint16_t fport)
+{
+	struct inpcb *inp;
+
+	*fd = ofp_socket(OFP_AF_INET, OFP_SOCK_STREAM, OFP_IPPROTO_TCP);
+	CU_ASSERT_FATAL(*fd >= 0);
+	inp = sotoinpcb(ofp_get_sock_by_fd(*fd));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(inp);
+	inp->inp_laddr.s_addr = odp_cpu_to_be_32(LADDR);
+	inp->inp_faddr.s_addr = odp_cpu_to_be_32(FADDR);
+	inp->inp_lport = odp_cpu_to_be_16(LPORT);
+	inp->inp_fport = odp_cpu_to_be_16(fport);
+	return intotcpcb(inp);
+}
+
+/* Move a connection to fport into the table, with timestamps if ts */
+static void tw_enter(uint16_t fport, uint32_t ts)
+{
+	struct tcpcb *tp;
+	int fd;
+
+	tp = tuple_socket(&fd, fport);
+	tp->t_state = TCPS_TIME_WAIT;
+	tp->snd_nxt = SND_NXT;
+	tp->rcv_nxt = RCV_NXT;
+	tp->rcv_adv = RCV_NXT + 1024;
+	if (ts) {
+		t_flags_or(tp->t_flags, TF_REQ_TSTMP | TF_RCVD_TSTMP);
+		tp->ts_recent = ts;
+		tp->ts_offset = 5;
+	}
+
+	INP_INFO_WLOCK(&V_tcbinfo);
+	INP_WLOCK(tp->t_inpcb);
+	ofp_tcp_twstart(tp);
+	INP_INFO_WUNLOCK(&V_tcbinfo);
+
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+}
+
+/* Hand a segment from fport to the table, freed here if it passes */
+static int tw_input(uint16_t fport, uint8_t flags, tcp_seq seq, int tlen,
+		    uint32_t tsval)
+{
+	struct ofp_ip ip;
+	struct ofp_tcphdr th;
+	struct tcpopt to;
+	odp_packet_t m;
+	int ret;
+
+	m = ofp_packet_alloc(tlen + 1);
+	CU_ASSERT_FATAL(m != ODP_PACKET_INVALID);
+
+	memset(&ip, 0, sizeof(ip));
+	ip.ip_src.s_addr = odp_cpu_to_be_32(FADDR);
+	ip.ip_dst.s_addr = odp_cpu_to_be_32(LADDR);
+	memset(&th, 0, sizeof(th));
+	th.th_sport = odp_cpu_to_be_16(fport);
+	th.th_dport = odp_cpu_to_be_16(LPORT);
+	th.th_seq = seq;
+	th.th_ack = SND_NXT;
+	th.th_flags = flags;
+	memset(&to, 0, sizeof(to));
+	if (tsval) {
+		to.to_flags = TOF_TS;
+		to.to_tsval = tsval;
+	}
+
+	ret = ofp_tcp_twinput(&ip, &th, &to, m, tlen);
+	if (ret)
+		odp_packet_free(m);
+	return ret;
+}
+
+static int tw_reuse(struct tcpcb *tp)
+{
+	int ret;
+
+	INP_WLOCK(tp->t_inpcb);
+	ret = ofp_tcp_twreuse(tp);
+	INP_WUNLOCK(tp->t_inpcb);
+	return ret;
+}
+
+/* Advance the clock to t, expiring the table on the way */
+static void run_until(int t)
+{
+	while (now_ticks < t) {
+		now_ticks += TCP_TW_SLOT;
+		if (now_ticks > t)
+			now_ticks = t;
+		ofp_tcp_twexpire();
+	}
+}
+
+/* Expire whatever the test left behind */
+static void tw_flush(void)
+{
+	run_until(now_ticks + 2 * ofp_tcp_msl + 2 * TCP_TW_SLOT);
+	CU_ASSERT_EQUAL(V_twtbl.count, 0);
+}
+
+static void test_tw_input(void)
+{
+	uint64_t acks;
+
+	tw_enter(1000, TS);
+	CU_ASSERT_EQUAL(V_twtbl.count, 1);
+
+	/* Another tuple is not in TIME_WAIT */
+	CU_ASSERT_EQUAL(tw_input(1001, OFP_TH_ACK, RCV_NXT, 0, 0), 1);
+
+	/* In sequence data is dropped, a bare ACK is answered */
+	acks = V_tcpstat.tcps_sndacks;
+	CU_ASSERT_EQUAL(tw_input(1000, OFP_TH_ACK, RCV_NXT, 10, 0), 0);
+	CU_ASSERT_EQUAL(V_tcpstat.tcps_sndacks, acks);
+	CU_ASSERT_EQUAL(tw_input(1000, OFP_TH_ACK, RCV_NXT, 0, 0), 0);
+	CU_ASSERT_EQUAL(V_tcpstat.tcps_sndacks, acks + 1);
+
+	/* RSTs are dropped without an answer and keep the entry */
+	CU_ASSERT_EQUAL(tw_input(1000, OFP_TH_RST, RCV_NXT, 0, 0), 0);
+	CU_ASSERT_EQUAL(V_tcpstat.tcps_sndacks, acks + 1);
+
+	/* A SYN with neither a higher sequence nor timestamp is dropped */
+	CU_ASSERT_EQUAL(tw_input(1000, OFP_TH_SYN, RCV_NXT - 1, 0, TS), 0);
+	CU_ASSERT_EQUAL(V_twtbl.count, 1);
+
+	/* A newer timestamp ends TIME_WAIT */
+	CU_ASSERT_EQUAL(tw_input(1000, OFP_TH_SYN, RCV_NXT, 0, TS + 1), 1);
+	CU_ASSERT_EQUAL(tw_input(1000, OFP_TH_ACK, RCV_NXT, 0, 0), 1);
+
+	/* And so does a higher sequence number, timestamps or not */
+	tw_enter(1002, 0);
+	CU_ASSERT_EQUAL(tw_input(1002, OFP_TH_SYN, RCV_NXT, 0, TS + 1), 0);
+	CU_ASSERT_EQUAL(tw_input(1002, OFP_TH_SYN, RCV_NXT + 1, 0, 0), 1);
+	CU_ASSERT_EQUAL(tw_input(1002, OFP_TH_ACK, RCV_NXT, 0, 0), 1);
+
+	tw_flush();
+}
+
+static void test_tw_reuse(void)
+{
+	struct tcpcb *tp;
+	int fd;
+
+	tw_enter(2000, TS);
+	tp = tuple_socket(&fd, 2000);
+	tp->iss = SND_NXT - 100;
+
+	/* Not before a second in TIME_WAIT */
+	now_ticks += hz - 1;
+	CU_ASSERT_EQUAL(tw_reuse(tp), OFP_EADDRINUSE);
+
+	/* Then the new connection starts above the old sequence space */
+	now_ticks++;
+	CU_ASSERT_EQUAL(tw_reuse(tp), 0);
+	CU_ASSERT_EQUAL(tp->iss, SND_NXT + OFP_TCP_MAXWIN);
+	CU_ASSERT_EQUAL(tp->ts_offset, 5);
+	CU_ASSERT_EQUAL(tw_input(2000, OFP_TH_ACK, RCV_NXT, 0, 0), 1);
+
+	/* Not without timestamps to tell the old segments */
+	tw_enter(2000, 0);
+	now_ticks += hz;
+	CU_ASSERT_EQUAL(tw_reuse(tp), OFP_EADDRINUSE);
+
+	/* Nor when turned off */
+	tw_enter(2000, TS);
+	now_ticks += hz;
+	V_tcp_tw_reuse = 0;
+	CU_ASSERT_EQUAL(tw_reuse(tp), OFP_EADDRINUSE);
+	V_tcp_tw_reuse = 1;
+	CU_ASSERT_EQUAL(tw_reuse(tp), 0);
+
+	CU_ASSERT_EQUAL(ofp_close(fd), 0);
+
+	tw_flush();
+}
+
+static void test_tw_expire(void)
+{
+	int start = now_ticks;
+	int i;
+
+	/* Entries stay for 2MSL */
+	tw_enter(3000, TS);
+	run_until(start + 2 * ofp_tcp_msl - 1);
+	CU_ASSERT_EQUAL(V_twtbl.count, 1);
+	CU_ASSERT_EQUAL(tw_input(3000, OFP_TH_SYN, RCV_NXT - 1, 0, 0), 0);
+
+	run_until(start + 2 * ofp_tcp_msl + TCP_TW_SLOT);
+	CU_ASSERT_EQUAL(V_twtbl.count, 0);
+	CU_ASSERT_EQUAL(tw_input(3000, OFP_TH_ACK, RCV_NXT, 0, 0), 1);
+
+	/* A retransmitted FIN restarts 2MSL */
+	start = now_ticks;
+	tw_enter(3000, TS);
+	run_until(start + ofp_tcp_msl);
+	CU_ASSERT_EQUAL(tw_input(3000, OFP_TH_FIN | OFP_TH_ACK, RCV_NXT - 1, 0,
+				 0), 0);
+	run_until(start + 2 * ofp_tcp_msl + TCP_TW_SLOT);
+	CU_ASSERT_EQUAL(V_twtbl.count, 1);
+	run_until(start + 3 * ofp_tcp_msl + TCP_TW_SLOT);
+	CU_ASSERT_EQUAL(V_twtbl.count, 0);
+
+	/* A full table gives up its oldest entry */
+	for (i = 0; i < TW_MAX; i++) {
+		tw_enter(3100 + i, TS);
+		now_ticks += TCP_TW_SLOT;
+	}
+	CU_ASSERT_EQUAL(V_twtbl.count, TW_MAX);
+	tw_enter(3100 + TW_MAX, TS);
+	CU_ASSERT_EQUAL(V_twtbl.count, TW_MAX);
+	CU_ASSERT_EQUAL(tw_input(3100, OFP_TH_ACK, RCV_NXT, 0, 0), 1);
+	for (i = 1; i <= TW_MAX; i++)
+		CU_ASSERT_EQUAL(tw_input(3100 + i, OFP_TH_SYN, RCV_NXT - 1, 0,
+					 0), 0);
+
+	tw_flush();
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp tcp timewait", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_tw_input)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_tw_reuse)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_tw_expire)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-tcp-timewait");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}
@@ -23,6 +23,7 @@
 #include <odp_api.h>
 #include <ofpi_ethernet.h>
 #include "ofpi_log.h"
+#include "ofpi_init.h"
 #include "../../src/ofp_util.c"
 
 /*
@@ -35,6 +36,8 @@ uint8_t ip6addr[16] = {
 0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef
 };
 uint8_t macaddr[6] = { 0xFF, 0xEE, 0xDD, 0xCC, 0xBB, 0xAA };
+/* The port numbers of the tunnel interfaces follow if_max */
+static ofp_global_param_t params = { .if_max = OFP_FP_INTERFACE_MAX };
 
 /*
  * INIT
@@ -55,6 +58,8 @@ init_suite(void)
 		printf("Error: ODP local init failed.\n");
 		return -1;
 	}
+
+	global_param = &params;
 	return 0;
 }
 
@@ -204,6 +209,41 @@ test_ofp_sendf(void)
 #undef BUFLEN
 }
 
+static void test_ofp_sendbuf(void)
+{
+	struct ofp_sendbuf sb;
+	char res[16];
+	int fd, i;
+	long size;
+	FILE *f;
+
+	fd = open(testFileName,
+		  O_WRONLY | O_CREAT | O_TRUNC,
+		  S_IWRITE | S_IREAD);
+	ofp_sendbuf_init(&sb, fd);
+	/* More lines than the buffer holds, written in chunks */
+	for (i = 0; i < 1000; i++)
+		CU_ASSERT_EQUAL(ofp_sendbuf_printf(&sb, "line %04d\r\n", i),
+				11);
+	CU_ASSERT(sb.len < (int)sizeof(sb.buf));
+	CU_ASSERT(ofp_sendbuf_flush(&sb) > 0);
+	CU_ASSERT_EQUAL(sb.len, 0);
+	CU_ASSERT_EQUAL(ofp_sendbuf_flush(&sb), 0);
+	close(fd);
+
+	f = fopen(testFileName, "r");
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	CU_ASSERT_EQUAL(size, 11000);
+	fseek(f, 11 * 999, SEEK_SET);
+	if (fgets(res, sizeof(res), f) != NULL)
+		CU_ASSERT_STRING_EQUAL(res, "line 0999\r\n")
+	else
+		CU_FAIL("Cannot read output file.")
+
+	fclose(f);
+}
+
 static void test_ofp_has_mac(void)
 {
 	int res;
@@ -278,6 +318,10 @@ main(void)
 		CU_cleanup_registry();
 		return CU_get_error();
 	}
+	if (NULL == CU_ADD_TEST(ptr_suite, test_ofp_sendbuf)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
 	if (NULL == CU_ADD_TEST(ptr_suite, test_ofp_has_mac)) {
 		CU_cleanup_registry();
 		return CU_get_error();
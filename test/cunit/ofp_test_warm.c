@@ -0,0 +1,220 @@
+/* Copyright (c) 2026, Nokia
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier:     BSD-3-Clause
+ */
+
+#ifndef OFP_TESTMODE_AUTO
+#define OFP_TESTMODE_AUTO 1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if OFP_TESTMODE_AUTO
+#include <CUnit/Automated.h>
+#else
+#include <CUnit/Basic.h>
+#endif
+
+#include <odp_api.h>
+#include <ofpi.h>
+#include <ofpi_log.h>
+#include <ofpi_init.h>
+#include <ofpi_route.h>
+#include <ofpi_arp.h>
+#include <ofpi_util.h>
+
+#define WARM_FILE "ofp_test_warm.dat"
+
+#define GW	odp_cpu_to_be_32(0xc0a80101)
+#define DST_A	odp_cpu_to_be_32(0x0a010000)
+#define DST_B	odp_cpu_to_be_32(0x0a020000)
+
+static int
+init_suite(void)
+{
+	ofp_global_param_t params;
+	odp_instance_t instance;
+
+	/* Init ODP before calling anything else */
+	if (odp_init_global(&instance, NULL, NULL)) {
+		OFP_ERR("Error: ODP global init failed.\n");
+		return -1;
+	}
+
+	/* Init this thread */
+	if (odp_init_local(instance, ODP_THREAD_CONTROL)) {
+		OFP_ERR("Error: ODP local init failed.\n");
+		return -1;
+	}
+
+	ofp_init_global_param(&params);
+	params.enable_nl_thread = 0;
+	(void) ofp_init_global(instance, &params);
+
+	ofp_init_local();
+
+	return 0;
+}
+
+static int
+clean_suite(void)
+{
+	remove(WARM_FILE);
+	ofp_term_local();
+	return 0;
+}
+
+static int route(uint32_t type, uint32_t dst)
+{
+	struct ofp_route_msg msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.type = type;
+	msg.flags = OFP_RTF_GATEWAY;
+	msg.dst = dst;
+	msg.masklen = 16;
+	msg.gw = GW;
+	return ofp_set_route_msg(&msg);
+}
+
+struct route_find {
+	uint32_t dst;
+	uint32_t flags;
+	int found;
+};
+
+static void find_route(void *arg, const struct ofp_route_msg *msg)
+{
+	struct route_find *f = arg;
+
+	if (msg->dst == f->dst && msg->masklen == 16) {
+		f->flags = msg->flags;
+		f->found = 1;
+	}
+}
+
+/* Flags of the route to dst, -1 if there is none */
+static int64_t route_flags(uint32_t dst)
+{
+	struct route_find f;
+
+	memset(&f, 0, sizeof(f));
+	f.dst = dst;
+	ofp_route_walk(find_route, &f);
+	return f.found ? (int64_t)f.flags : -1;
+}
+
+static void count_arp(void *arg, uint16_t vrf, uint32_t addr,
+		      const uint8_t *mac, odp_bool_t is_manual)
+{
+	(void)vrf;
+	(void)mac;
+	(void)is_manual;
+	if (addr == GW)
+		(*(int *)arg)++;
+}
+
+static int gw_arp_entries(void)
+{
+	int num = 0;
+
+	ofp_arp_walk(count_arp, &num);
+	return num;
+}
+
+static void test_warm_save_restore_reconcile(void)
+{
+	uint8_t mac[OFP_ETHER_ADDR_LEN] = { 0x02, 0, 0, 0, 0, 1 };
+	uint32_t idx;
+
+	CU_ASSERT_EQUAL(ofp_arp_ipv4_insert_entry(GW, mac, 0, TRUE, FALSE,
+						  &idx, FALSE), 0);
+	CU_ASSERT_EQUAL(route(OFP_ROUTE_ADD, DST_A), 0);
+	CU_ASSERT_EQUAL(route(OFP_ROUTE_ADD, DST_B), 0);
+	CU_ASSERT_EQUAL(ofp_warm_save(WARM_FILE), 0);
+
+	/* As if the process restarted: the last route takes the ARP entry */
+	CU_ASSERT_EQUAL(route(OFP_ROUTE_DEL, DST_A), 0);
+	CU_ASSERT_EQUAL(route(OFP_ROUTE_DEL, DST_B), 0);
+	CU_ASSERT_EQUAL(route_flags(DST_A), -1);
+	CU_ASSERT_EQUAL(gw_arp_entries(), 0);
+
+	CU_ASSERT_EQUAL(ofp_warm_restore(WARM_FILE), 0);
+	CU_ASSERT_EQUAL(gw_arp_entries(), 1);
+	CU_ASSERT(route_flags(DST_A) & OFP_RTF_WARM);
+	CU_ASSERT(route_flags(DST_B) & OFP_RTF_WARM);
+
+	/* Added again by the control plane, replacing the restored one */
+	CU_ASSERT_EQUAL(route(OFP_ROUTE_ADD, DST_A), 0);
+	CU_ASSERT_EQUAL(route_flags(DST_A), OFP_RTF_GATEWAY);
+
+	/* The route not added again is stale */
+	CU_ASSERT_EQUAL(ofp_warm_reconcile(), 1);
+	CU_ASSERT_EQUAL(route_flags(DST_A), OFP_RTF_GATEWAY);
+	CU_ASSERT_EQUAL(route_flags(DST_B), -1);
+	CU_ASSERT_EQUAL(ofp_warm_reconcile(), 0);
+
+	/* The replaced route released its reference to the ARP entry */
+	CU_ASSERT_EQUAL(gw_arp_entries(), 1);
+	CU_ASSERT_EQUAL(route(OFP_ROUTE_DEL, DST_A), 0);
+	CU_ASSERT_EQUAL(gw_arp_entries(), 0);
+}
+
+static void test_warm_restore_cold_start(void)
+{
+	remove(WARM_FILE);
+	CU_ASSERT_EQUAL(ofp_warm_restore(WARM_FILE), 0);
+	CU_ASSERT_EQUAL(ofp_warm_reconcile(), 0);
+}
+
+/*
+ * Main
+ */
+int
+main(void)
+{
+	CU_pSuite ptr_suite = NULL;
+	int nr_of_failed_tests = 0;
+	int nr_of_failed_suites = 0;
+
+	/* Initialize the CUnit test registry */
+	if (CUE_SUCCESS != CU_initialize_registry())
+		return CU_get_error();
+
+	/* add a suite to the registry */
+	ptr_suite = CU_add_suite("ofp warm restart", init_suite, clean_suite);
+	if (NULL == ptr_suite) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite,
+				test_warm_save_restore_reconcile)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+	if (NULL == CU_ADD_TEST(ptr_suite, test_warm_restore_cold_start)) {
+		CU_cleanup_registry();
+		return CU_get_error();
+	}
+
+#if OFP_TESTMODE_AUTO
+	CU_set_output_filename("CUnit-warm");
+	CU_automated_run_tests();
+#else
+	/* Run all tests using the CUnit Basic interface */
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+#endif
+
+	nr_of_failed_tests = CU_get_number_of_tests_failed();
+	nr_of_failed_suites = CU_get_number_of_suites_failed();
+	CU_cleanup_registry();
+
+	return (nr_of_failed_suites > 0 ?
+		nr_of_failed_suites : nr_of_failed_tests);
+}